@@ -15,6 +15,8 @@
  */
 package nz.mega.sdk;
 
+import java.nio.ByteBuffer;
+
 import nz.mega.sdk.MegaApi;
 import nz.mega.sdk.MegaTransfer;
 
@@ -164,6 +166,9 @@ class DelegateMegaTransferListener extends MegaTransferListener {
      * MegaTransfer.getDeltaSize(). The SDK retains the ownership of the transfer and buffer parameters.
      * Do not use them after this functions returns. This callback is mainly provided for compatibility with other
      * programming languages.
+     * <p>
+     * The buffer is a read-only direct ByteBuffer on the memory of the SDK. Listeners implementing
+     * MegaTransferDataListenerInterface receive it as is; the others, a copy in a byte array.
      *
      * @param api
      *          MegaApi object that started the transfer.
@@ -173,13 +178,20 @@ class DelegateMegaTransferListener extends MegaTransferListener {
      *          Buffer with the last read bytes.
      * @return
      *          Size of the buffer.
+     * @see MegaTransferDataListenerInterface#onTransferData(MegaApiJava api, MegaTransfer transfer, ByteBuffer buffer)
      * @see MegaTransferListenerInterface#onTransferData(MegaApiJava api, MegaTransfer transfer, byte[] buffer)
-     * @see MegaTransferListener#onTransferData(MegaApi api, MegaTransfer transfer, byte[] buffer)
+     * @see MegaTransferListener#onTransferData(MegaApi api, MegaTransfer transfer, ByteBuffer buffer)
      */
-    public boolean onTransferData(MegaApi api, MegaTransfer transfer, byte[] buffer) {
+    public boolean onTransferData(MegaApi api, MegaTransfer transfer, ByteBuffer buffer) {
         if (listener != null) {
             final MegaTransfer megaTransfer = transfer.copy();
-            return listener.onTransferData(megaApi, megaTransfer, buffer);
+            if (listener instanceof MegaTransferDataListenerInterface) {
+                return ((MegaTransferDataListenerInterface) listener).onTransferData(megaApi, megaTransfer, buffer);
+            }
+
+            byte[] bytes = new byte[buffer.remaining()];
+            buffer.get(bytes);
+            return listener.onTransferData(megaApi, megaTransfer, bytes);
         }
         return false;
     }
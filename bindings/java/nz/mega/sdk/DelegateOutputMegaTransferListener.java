@@ -17,6 +17,7 @@ package nz.mega.sdk;
 
 import java.io.IOException;
 import java.io.OutputStream;
+import java.nio.ByteBuffer;
 
 /**
  * The listener interface for receiving delegateOutputMegaTransfer events.
@@ -31,6 +32,9 @@ import java.io.OutputStream;
 public class DelegateOutputMegaTransferListener extends DelegateMegaTransferListener {
     OutputStream outputStream;
 
+    // reused for every chunk written to the output stream
+    byte[] chunk;
+
     /**
      * Instantiates a new delegate output mega transfer listener.
      *
@@ -60,12 +64,17 @@ public class DelegateOutputMegaTransferListener extends DelegateMegaTransferList
      *              Buffer with the last read bytes.
      * @return
      *              true, if successful.
-     * @see DelegateMegaTransferListener#onTransferData(MegaApi api, MegaTransfer transfer, byte[] buffer)
+     * @see DelegateMegaTransferListener#onTransferData(MegaApi api, MegaTransfer transfer, ByteBuffer buffer)
      */
-    public boolean onTransferData(MegaApi api, MegaTransfer transfer, byte[] buffer) {
+    public boolean onTransferData(MegaApi api, MegaTransfer transfer, ByteBuffer buffer) {
         if (outputStream != null) {
             try {
-                outputStream.write(buffer);
+                int size = buffer.remaining();
+                if (chunk == null || chunk.length < size) {
+                    chunk = new byte[size];
+                }
+                buffer.get(chunk, 0, size);
+                outputStream.write(chunk, 0, size);
                 return true;
             } catch (IOException e) {
             }
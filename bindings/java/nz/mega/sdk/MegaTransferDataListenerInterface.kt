@@ -0,0 +1,45 @@
+/*
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,\
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * @copyright Simplified (2-clause) BSD License.
+ * You should have received a copy of the license along with this
+ * program.
+ */
+package nz.mega.sdk
+
+import java.nio.ByteBuffer
+
+/**
+ * Interface to receive the data of streaming downloads without copying it.
+ *
+ *
+ * Transfer listeners implementing it receive the data in this onTransferData instead of
+ * MegaTransferListenerInterface.onTransferData, that needs a copy of every chunk in a new byte array.
+ */
+interface MegaTransferDataListenerInterface : MegaTransferListenerInterface {
+    /**
+     * This function is called to provide the last read bytes of streaming downloads.
+     *
+     *
+     * The buffer is a read-only direct ByteBuffer on the memory of the SDK, it's only valid until
+     * this function returns. Copy the data to keep it. The SDK retains the ownership of the transfer.
+     *
+     * @param api
+     * MegaApi object that started the transfer.
+     * @param transfer
+     * Information about the transfer.
+     * @param buffer
+     * Buffer with the last read bytes.
+     * @return
+     * true to continue the transfer, false to cancel it.
+     */
+    fun onTransferData(api: MegaApiJava, transfer: MegaTransfer, buffer: ByteBuffer): Boolean
+}
@@ -256,7 +256,24 @@ extern "C" jint JNIEXPORT JNICALL JNI_OnLoad(JavaVM *jvm, void *reserved)
 %}
 #endif
 
-%apply (char *STRING, size_t LENGTH) {(char *buffer, size_t size)};
+// Data buffers (MegaTransferListener::onTransferData) are direct ByteBuffers on the SDK memory instead of
+// byte[] copies of every chunk. Read-only and only valid during the callback: copy the data to keep it.
+%typemap(jni) (char *buffer, size_t size) "jobject"
+%typemap(jtype) (char *buffer, size_t size) "java.nio.ByteBuffer"
+%typemap(jstype) (char *buffer, size_t size) "java.nio.ByteBuffer"
+%typemap(javain) (char *buffer, size_t size) "$javainput"
+%typemap(javadirectorin) (char *buffer, size_t size) "$jniinput.asReadOnlyBuffer()"
+
+%typemap(in) (char *buffer, size_t size)
+%{
+    $1 = $input ? (char *)jenv->GetDirectBufferAddress($input) : nullptr;
+    $2 = $1 ? (size_t)jenv->GetDirectBufferCapacity($input) : 0;
+%}
+
+%typemap(directorin, descriptor="Ljava/nio/ByteBuffer;") (char *buffer, size_t size)
+%{
+    $input = jenv->NewDirectByteBuffer($1, (jlong)$2);
+%}
 
 #if SWIG_VERSION < 0x030012
 %typemap(directorargout) (char *buffer, size_t size)
@@ -266,12 +283,21 @@ extern "C" jint JNIEXPORT JNICALL JNI_OnLoad(JavaVM *jvm, void *reserved)
 #else
 %typemap(directorargout) (char *buffer, size_t size)
 %{
-   // not copying the buffer back to improve performance
+   // nothing to copy back, the buffer is the SDK's memory
 %}
 #endif
 
 #endif
 
+#ifdef SWIGPYTHON
+// Data buffers (MegaTransferListener::onTransferData) are read-only memoryviews on the SDK memory instead of
+// bytes copies of every chunk. Only valid during the callback: copy them (bytes(buffer)) to keep the data.
+%typemap(directorin) (char *buffer, size_t size)
+%{
+    $input = PyMemoryView_FromMemory($1, (Py_ssize_t)$2, PyBUF_READ);
+%}
+#endif
+
 %feature("director") mega::MegaGlobalListener;
 %feature("director") mega::MegaListener;
 %feature("director") mega::MegaTreeProcessor;
@@ -46,7 +46,8 @@ public:
         OnMountChanged,
         OnMountDisabled,
         OnMountEnabled,
-        OnMountRemoved
+        OnMountRemoved,
+        OnBatchedUpdates
     };
 
     QTMegaEvent(MegaApi *megaApi, Type type);
@@ -0,0 +1,110 @@
+#include "QTMegaEventBatcher.h"
+#include "QTMegaEvent.h"
+
+#include <QCoreApplication>
+
+using namespace mega;
+using namespace std;
+
+QTMegaEventBatcher::QTMegaEventBatcher(QObject *receiver)
+{
+    this->receiver = receiver;
+}
+
+void QTMegaEventBatcher::addTransferUpdate(MegaTransfer *transfer)
+{
+    unique_ptr<MegaTransfer> update(transfer->copy());
+
+    lock_guard<std::mutex> g(updatesMutex);
+    transferUpdates[transfer->getTag()] = std::move(update);
+    postBatch();
+}
+
+void QTMegaEventBatcher::addNodesUpdate(MegaNodeList *nodes)
+{
+    lock_guard<std::mutex> g(updatesMutex);
+    if (!nodesPending)
+    {
+        nodesPending = true;
+        this->nodes.reset(nodes ? nodes->copy() : NULL);
+    }
+    else if (this->nodes)
+    {
+        if (!nodes)
+        {
+            // all nodes were updated, which includes the pending ones
+            this->nodes.reset();
+        }
+        else
+        {
+            for (int i = 0; i < nodes->size(); i++)
+            {
+                this->nodes->addNode(nodes->get(i));
+            }
+        }
+    }
+    postBatch();
+}
+
+void QTMegaEventBatcher::postBatch()
+{
+    if (!batchPosted)
+    {
+        batchPosted = true;
+        QCoreApplication::postEvent(receiver, new QTMegaEvent(NULL, (QEvent::Type)QTMegaEvent::OnBatchedUpdates), INT_MIN);
+    }
+}
+
+qint64 QTMegaEventBatcher::beginDelivery()
+{
+    if (lastDelivery.isValid() && lastDelivery.elapsed() < FRAME_INTERVAL_MS)
+    {
+        return FRAME_INTERVAL_MS - lastDelivery.elapsed();
+    }
+    lastDelivery.start();
+
+    lock_guard<std::mutex> g(updatesMutex);
+    batchPosted = false;
+    return 0;
+}
+
+unique_ptr<MegaTransfer> QTMegaEventBatcher::takeTransferUpdate(int tag)
+{
+    lock_guard<std::mutex> g(updatesMutex);
+    auto it = transferUpdates.find(tag);
+    if (it == transferUpdates.end())
+    {
+        return nullptr;
+    }
+
+    unique_ptr<MegaTransfer> update = std::move(it->second);
+    transferUpdates.erase(it);
+    return update;
+}
+
+vector<unique_ptr<MegaTransfer>> QTMegaEventBatcher::takeTransferUpdates()
+{
+    vector<unique_ptr<MegaTransfer>> updates;
+
+    lock_guard<std::mutex> g(updatesMutex);
+    updates.reserve(transferUpdates.size());
+    for (auto& it : transferUpdates)
+    {
+        updates.push_back(std::move(it.second));
+    }
+    transferUpdates.clear();
+    return updates;
+}
+
+bool QTMegaEventBatcher::takeNodesUpdate(unique_ptr<MegaNodeList>& nodes)
+{
+    lock_guard<std::mutex> g(updatesMutex);
+    if (!nodesPending)
+    {
+        return false;
+    }
+
+    nodesPending = false;
+    nodes = std::move(this->nodes);
+    return true;
+}
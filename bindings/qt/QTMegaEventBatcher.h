@@ -0,0 +1,64 @@
+#pragma once
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wconversion"
+#endif
+#include <QElapsedTimer>
+#include <QObject>
+#ifdef __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
+#include "megaapi.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mega
+{
+/**
+ * @brief Merges the frequent updates received in the SDK thread until the Qt event loop delivers them
+ *
+ * Only the latest update of each transfer is kept and the lists of updated nodes are joined, so a single
+ * QTMegaEvent::OnBatchedUpdates event is posted to the receiver for all of them. The receiver delivers the
+ * pending updates at most once per frame interval, and before any other event of the same transfer (or
+ * before any other global event, for the nodes) to keep the order of the callbacks.
+ */
+class QTMegaEventBatcher
+{
+public:
+    static constexpr qint64 FRAME_INTERVAL_MS = 16;
+
+    explicit QTMegaEventBatcher(QObject *receiver);
+
+    // SDK thread
+    void addTransferUpdate(MegaTransfer *transfer);
+    void addNodesUpdate(MegaNodeList *nodes);
+
+    // Qt event loop
+    // Returns the milliseconds to wait until the next delivery.
+    // If it's 0, the pending updates can be taken now and new updates will post a new event.
+    qint64 beginDelivery();
+    std::unique_ptr<MegaTransfer> takeTransferUpdate(int tag);
+    std::vector<std::unique_ptr<MegaTransfer>> takeTransferUpdates();
+    // Returns false if there is no update of nodes pending. A null list means that all nodes were updated.
+    bool takeNodesUpdate(std::unique_ptr<MegaNodeList>& nodes);
+
+private:
+    // Requires the mutex to be locked
+    void postBatch();
+
+    QObject *receiver;
+
+    std::mutex updatesMutex;
+    bool batchPosted = false;
+    std::map<int, std::unique_ptr<MegaTransfer>> transferUpdates;
+    bool nodesPending = false;
+    std::unique_ptr<MegaNodeList> nodes;
+
+    QElapsedTimer lastDelivery;
+};
+}
@@ -2,10 +2,11 @@
 #include "QTMegaEvent.h"
 
 #include <QCoreApplication>
+#include <QTimer>
 
 using namespace mega;
 
-QTMegaGlobalListener::QTMegaGlobalListener(MegaApi *megaApi, MegaGlobalListener *listener) : QObject()
+QTMegaGlobalListener::QTMegaGlobalListener(MegaApi *megaApi, MegaGlobalListener *listener) : QObject(), batcher(this)
 {
     this->megaApi = megaApi;
     this->listener = listener;
@@ -33,9 +34,8 @@ void QTMegaGlobalListener::onUserAlertsUpdate(MegaApi *api, MegaUserAlertList *a
 
 void QTMegaGlobalListener::onNodesUpdate(MegaApi *api, MegaNodeList *nodes)
 {
-    QTMegaEvent *event = new QTMegaEvent(api, (QEvent::Type)QTMegaEvent::OnNodesUpdate);
-    event->setNodes(nodes ? nodes->copy() : NULL);
-    QCoreApplication::postEvent(this, event, INT_MIN);
+    // joined with the next updates of nodes until they are delivered
+    batcher.addNodesUpdate(nodes);
 }
 
 void QTMegaGlobalListener::onAccountUpdate(MegaApi *api)
@@ -63,11 +63,40 @@ void QTMegaGlobalListener::onGlobalSyncStateChanged(MegaApi *api)
     QCoreApplication::postEvent(this, event, INT_MIN);
 }
 
+void QTMegaGlobalListener::deliverBatchedUpdates()
+{
+    if (qint64 wait = batcher.beginDelivery())
+    {
+        QTimer::singleShot(static_cast<int>(wait), this, [this]() { deliverBatchedUpdates(); });
+        return;
+    }
+
+    deliverNodesUpdate();
+}
+
+void QTMegaGlobalListener::deliverNodesUpdate()
+{
+    std::unique_ptr<MegaNodeList> nodes;
+    if (batcher.takeNodesUpdate(nodes) && listener)
+    {
+        listener->onNodesUpdate(megaApi, nodes.get());
+    }
+}
+
 void QTMegaGlobalListener::customEvent(QEvent *e)
 {
     QTMegaEvent *event = (QTMegaEvent *)e;
+    if (QTMegaEvent::MegaType(event->type()) != QTMegaEvent::OnBatchedUpdates)
+    {
+        // the pending update of nodes goes first
+        deliverNodesUpdate();
+    }
+
     switch(QTMegaEvent::MegaType(event->type()))
     {
+        case QTMegaEvent::OnBatchedUpdates:
+            deliverBatchedUpdates();
+            break;
         case QTMegaEvent::OnUsersUpdate:
             if(listener) listener->onUsersUpdate(event->getMegaApi(), event->getUsers());
             break;
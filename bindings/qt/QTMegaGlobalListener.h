@@ -10,6 +10,7 @@
 #endif
 
 #include "megaapi.h"
+#include "QTMegaEventBatcher.h"
 
 namespace mega
 {
@@ -34,8 +35,11 @@ public:
 
 protected:
     void customEvent(QEvent * event) override;
+    void deliverBatchedUpdates();
+    void deliverNodesUpdate();
 
     MegaApi *megaApi;
     MegaGlobalListener *listener;
+    QTMegaEventBatcher batcher;
 };
 }
@@ -2,11 +2,12 @@
 #include "QTMegaEvent.h"
 
 #include <QCoreApplication>
+#include <QTimer>
 
 using namespace mega;
 using namespace std;
 
-QTMegaListener::QTMegaListener(MegaApi *megaApi, MegaListener *listener) : QObject()
+QTMegaListener::QTMegaListener(MegaApi *megaApi, MegaListener *listener) : QObject(), batcher(this)
 {
     this->megaApi = megaApi;
 	this->listener = listener;
@@ -73,9 +74,8 @@ void QTMegaListener::onTransferFinish(MegaApi *api, MegaTransfer *transfer, Mega
 
 void QTMegaListener::onTransferUpdate(MegaApi *api, MegaTransfer *transfer)
 {
-    QTMegaEvent *event = new QTMegaEvent(api, (QEvent::Type)QTMegaEvent::OnTransferUpdate);
-    event->setTransfer(transfer->copy());
-    QCoreApplication::postEvent(this, event, INT_MIN);
+    // merged with the other updates of the transfer until they are delivered
+    batcher.addTransferUpdate(transfer);
 }
 
 void QTMegaListener::onTransferTemporaryError(MegaApi *api, MegaTransfer *transfer, MegaError *e)
@@ -102,9 +102,8 @@ void QTMegaListener::onUserAlertsUpdate(MegaApi *api, MegaUserAlertList *alerts)
 
 void QTMegaListener::onNodesUpdate(MegaApi *api, MegaNodeList *nodes)
 {
-    QTMegaEvent *event = new QTMegaEvent(api, (QEvent::Type)QTMegaEvent::OnNodesUpdate);
-    event->setNodes(nodes ? nodes->copy() : NULL);
-    QCoreApplication::postEvent(this, event, INT_MIN);
+    // joined with the next updates of nodes until they are delivered
+    batcher.addNodesUpdate(nodes);
 }
 
 void QTMegaListener::onAccountUpdate(MegaApi *api)
@@ -194,11 +193,59 @@ void QTMegaListener::onMountRemoved(MegaApi *api, const char* path, int result)
     postMountEvent(QTMegaEvent::OnMountRemoved, api, path, result);
 }
 
+void QTMegaListener::deliverBatchedUpdates()
+{
+    if (qint64 wait = batcher.beginDelivery())
+    {
+        QTimer::singleShot(static_cast<int>(wait), this, [this]() { deliverBatchedUpdates(); });
+        return;
+    }
+
+    for (auto& transfer : batcher.takeTransferUpdates())
+    {
+        if(listener) listener->onTransferUpdate(megaApi, transfer.get());
+    }
+    deliverNodesUpdate();
+}
+
+void QTMegaListener::deliverTransferUpdate(int tag)
+{
+    std::unique_ptr<MegaTransfer> transfer = batcher.takeTransferUpdate(tag);
+    if (transfer && listener)
+    {
+        listener->onTransferUpdate(megaApi, transfer.get());
+    }
+}
+
+void QTMegaListener::deliverNodesUpdate()
+{
+    std::unique_ptr<MegaNodeList> nodes;
+    if (batcher.takeNodesUpdate(nodes) && listener)
+    {
+        listener->onNodesUpdate(megaApi, nodes.get());
+    }
+}
+
 void QTMegaListener::customEvent(QEvent *e)
 {
     QTMegaEvent *event = (QTMegaEvent *)e;
+    int type = event->type();
+    if (event->getTransfer())
+    {
+        // the pending update of the transfer goes first
+        deliverTransferUpdate(event->getTransfer()->getTag());
+    }
+    else if (type >= QTMegaEvent::OnUsersUpdate && type != QTMegaEvent::OnBatchedUpdates)
+    {
+        // and the pending update of nodes goes before any other global event
+        deliverNodesUpdate();
+    }
+
     switch(QTMegaEvent::MegaType(event->type()))
     {
+        case QTMegaEvent::OnBatchedUpdates:
+            deliverBatchedUpdates();
+            break;
         case QTMegaEvent::OnRequestStart:
             if(listener) listener->onRequestStart(event->getMegaApi(), event->getRequest());
             break;
@@ -11,6 +11,7 @@
 
 #include "megaapi.h"
 #include "QTMegaEvent.h"
+#include "QTMegaEventBatcher.h"
 
 namespace mega
 {
@@ -55,6 +56,9 @@ public:
 
 protected:
     void customEvent(QEvent * event) override;
+    void deliverBatchedUpdates();
+    void deliverTransferUpdate(int tag);
+    void deliverNodesUpdate();
 
     using FuseEventHandler =
       void (MegaListener::*)(MegaApi*, const char*, int);
@@ -68,5 +72,6 @@ protected:
 
     MegaApi *megaApi;
     MegaListener *listener;
+    QTMegaEventBatcher batcher;
 };
 }
@@ -1,5 +1,6 @@
 #include "QTMegaTransferListener.h"
 #include <QCoreApplication>
+#include <QTimer>
 #include "QTMegaEvent.h"
 
 using namespace mega;
@@ -13,7 +14,7 @@ struct QtMegaFolderEvent : public QTMegaEvent
     uint32_t filecount;
 };
 
-QTMegaTransferListener::QTMegaTransferListener(MegaApi *megaApi, MegaTransferListener *listener) : QObject()
+QTMegaTransferListener::QTMegaTransferListener(MegaApi *megaApi, MegaTransferListener *listener) : QObject(), batcher(this)
 {
     this->megaApi = megaApi;
     this->listener = listener;
@@ -43,9 +44,8 @@ void QTMegaTransferListener::onTransferFinish(MegaApi *api, MegaTransfer *transf
 
 void QTMegaTransferListener::onTransferUpdate(MegaApi *api, MegaTransfer *transfer)
 {
-    QTMegaEvent *event = new QTMegaEvent(api, (QEvent::Type)QTMegaEvent::OnTransferUpdate);
-    event->setTransfer(transfer->copy());
-    QCoreApplication::postEvent(this, event, INT_MIN);
+    // merged with the other updates of the transfer until they are delivered
+    batcher.addTransferUpdate(transfer);
 }
 
 void QTMegaTransferListener::onTransferTemporaryError(MegaApi *api, MegaTransfer *transfer, MegaError *e)
@@ -67,11 +67,43 @@ void mega::QTMegaTransferListener::onFolderTransferUpdate(mega::MegaApi* api, me
     QCoreApplication::postEvent(this, event, INT_MIN);
 }
 
+void QTMegaTransferListener::deliverBatchedUpdates()
+{
+    if (qint64 wait = batcher.beginDelivery())
+    {
+        QTimer::singleShot(static_cast<int>(wait), this, [this]() { deliverBatchedUpdates(); });
+        return;
+    }
+
+    for (auto& transfer : batcher.takeTransferUpdates())
+    {
+        if(listener) listener->onTransferUpdate(megaApi, transfer.get());
+    }
+}
+
+void QTMegaTransferListener::deliverTransferUpdate(int tag)
+{
+    std::unique_ptr<MegaTransfer> transfer = batcher.takeTransferUpdate(tag);
+    if (transfer && listener)
+    {
+        listener->onTransferUpdate(megaApi, transfer.get());
+    }
+}
+
 void QTMegaTransferListener::customEvent(QEvent *e)
 {
     QTMegaEvent *event = (QTMegaEvent *)e;
+    if (event->getTransfer())
+    {
+        // the pending update of the transfer goes first
+        deliverTransferUpdate(event->getTransfer()->getTag());
+    }
+
     switch(QTMegaEvent::MegaType(event->type()))
     {
+        case QTMegaEvent::OnBatchedUpdates:
+            deliverBatchedUpdates();
+            break;
         case QTMegaEvent::OnTransferStart:
             if(listener) listener->onTransferStart(event->getMegaApi(), event->getTransfer());
             break;
@@ -10,6 +10,7 @@
 #endif
 
 #include <megaapi.h>
+#include "QTMegaEventBatcher.h"
 
 namespace mega
 {
@@ -32,8 +33,11 @@ public:
 
 protected:
     void customEvent(QEvent * event) override;
+    void deliverBatchedUpdates();
+    void deliverTransferUpdate(int tag);
 
     MegaApi *megaApi;
 	MegaTransferListener *listener;
+    QTMegaEventBatcher batcher;
 };
 }
@@ -66,6 +66,7 @@ SOURCES += src/arguments.cpp \
     src/useralerts.cpp \
     src/utils.cpp \
     src/logging.cpp \
+    src/metrics.cpp \
     src/waiterbase.cpp  \
     src/proxy.cpp \
     src/pendingcontactrequest.cpp \
@@ -93,7 +94,8 @@ CONFIG(USE_MEGAAPI) {
         bindings/qt/QTMegaTransferListener.cpp \
         bindings/qt/QTMegaGlobalListener.cpp \
         bindings/qt/QTMegaListener.cpp \
-        bindings/qt/QTMegaEvent.cpp
+        bindings/qt/QTMegaEvent.cpp \
+        bindings/qt/QTMegaEventBatcher.cpp
   }
 }
 
@@ -473,6 +475,7 @@ HEADERS  += include/mega.h \
             include/mega/useralerts.h \
             include/mega/utils.h \
             include/mega/logging.h \
+            include/mega/metrics.h \
             include/mega/waiter.h \
             include/mega/proxy.h \
             include/mega/pendingcontactrequest.h \
@@ -503,7 +506,8 @@ CONFIG(USE_MEGAAPI) {
             bindings/qt/QTMegaTransferListener.h \
             bindings/qt//QTMegaGlobalListener.h \
             bindings/qt/QTMegaListener.h \
-            bindings/qt/QTMegaEvent.h
+            bindings/qt/QTMegaEvent.h \
+            bindings/qt/QTMegaEventBatcher.h
 }
 
 win32 {
@@ -890,6 +894,10 @@ HEADERS += \
     $$FUSE_COMMON_INC/database_forward.h \
     $$FUSE_COMMON_INC/error_or.h \
     $$FUSE_COMMON_INC/error_or_forward.h \
+    $$FUSE_COMMON_INC/file_cache_flags.h \
+    $$FUSE_COMMON_INC/file_cache_flags_forward.h \
+    $$FUSE_COMMON_INC/file_cache_statistics.h \
+    $$FUSE_COMMON_INC/file_cache_statistics_forward.h \
     $$FUSE_COMMON_INC/inode_cache_flags.h \
     $$FUSE_COMMON_INC/inode_cache_flags_forward.h \
     $$FUSE_COMMON_INC/inode_id.h \
@@ -947,6 +955,8 @@ HEADERS += \
     $$FUSE_COMMON_INC/task_executor_flags.h \
     $$FUSE_COMMON_INC/task_executor_forward.h \
     $$FUSE_COMMON_INC/task_executor.h \
+    $$FUSE_COMMON_INC/task_priority_forward.h \
+    $$FUSE_COMMON_INC/task_priority.h \
     $$FUSE_COMMON_INC/task_queue_forward.h \
     $$FUSE_COMMON_INC/task_queue.h \
     $$FUSE_COMMON_INC/transaction_forward.h \
@@ -25,4 +25,8 @@ else()
     check_include_file(dirent.h HAVE_DIRENT_H)
     check_include_file(glob.h HAVE_GLOB_H)
     check_function_exists(aio_write, HAVE_AIO_RT)
+    check_include_file(linux/io_uring.h HAVE_LINUX_IO_URING_H)
+    check_include_file(sys/fanotify.h HAVE_SYS_FANOTIFY_H)
+    check_include_file(sys/epoll.h HAVE_SYS_EPOLL_H)
+    check_include_file(sys/event.h HAVE_SYS_EVENT_H)
 endif()
@@ -1,11 +1,13 @@
 option(ENABLE_SYNC "Turns on sync functionality" ON)
 option(ENABLE_CHAT "Turns on chat management functionality" OFF)
 option(ENABLE_LOG_PERFORMANCE "Faster log message generation" OFF)
+option(ENABLE_TRACING "Record tracing spans of the hot paths, exportable as Chrome trace JSON" OFF)
 option(ENABLE_DRIVE_NOTIFICATIONS "Allows to monitor (external) drives being [dis]connected to the computer" OFF)
 option(ENABLE_QT_BINDINGS "Enable the target to build the Qt Bindings" OFF)
 option(USE_MEDIAINFO "Used to determine media properties and set those as node attributes" ON)
 option(USE_FREEIMAGE "Used to create previews/thumbnails for photos/pictures" ON)
 option(USE_FFMPEG "Used to create previews/thumbnails for video files" ON)
+option(USE_FFMPEG_HWACCEL "Decode the video frames of previews/thumbnails in the GPU when available (VAAPI, VideoToolbox, D3D11VA)" ON)
 option(USE_LIBUV "Includes the library and turns on internal web and ftp server functionality" OFF)
 option(USE_PDFIUM "Used to create previews/thumbnails for PDF files" ON)
 option(USE_C_ARES "If set, the SDK will manage DNS lookups and ipv4/ipv6 itself, using the c-ares library.  Otherwise we rely on cURL" ON)
@@ -34,6 +34,7 @@ set(SDKLIB_HEADERS
     include/mega/autocomplete.h
     include/mega/serialize64.h
     include/mega/nodemanager.h
+    include/mega/nodehandlemap.h
     include/mega/setandelement.h
     include/mega/mega_ccronexpr.h
     include/mega/testhooks.h
@@ -54,6 +55,7 @@ set(SDKLIB_HEADERS
     include/mega/raid.h
     include/mega/raidproxy.h
     include/mega/logging.h
+    include/mega/metrics.h
     include/mega/file.h
     include/mega/sync.h
     include/mega/syncfilter.h
@@ -97,6 +99,7 @@ set(SDKLIB_SOURCES
     src/http.cpp
     src/json.cpp
     src/logging.cpp
+    src/metrics.cpp
     src/mediafileattribute.cpp
     src/mega_ccronexpr.cpp
     src/mega_http_parser.cpp
@@ -166,8 +169,10 @@ target_sources_conditional(SDKlib
     PRIVATE
     include/mega/win32/gfx/worker/comms.h
     include/mega/win32/gfx/worker/comms_client.h
+    include/mega/win32/gfx/worker/shared_memory.h
     src/win32/gfx/worker/comms.cpp
     src/win32/gfx/worker/comms_client.cpp
+    src/win32/gfx/worker/shared_memory.cpp
 )
 
 target_sources_conditional(SDKlib
@@ -176,9 +181,11 @@ target_sources_conditional(SDKlib
     include/mega/posix/gfx/worker/comms.h
     include/mega/posix/gfx/worker/comms_client.h
     include/mega/posix/gfx/worker/socket_utils.h
+    include/mega/posix/gfx/worker/shared_memory.h
     src/posix/gfx/worker/comms.cpp
     src/posix/gfx/worker/comms_client.cpp
     src/posix/gfx/worker/socket_utils.cpp
+    src/posix/gfx/worker/shared_memory.cpp
 )
 
 target_sources_conditional(SDKlib
@@ -192,10 +199,13 @@ target_sources_conditional(SDKlib
     include/mega/gfx/worker/client.h
     include/mega/gfx/worker/comms_client_common.h
     include/mega/gfx/worker/comms_client.h
+    include/mega/gfx/worker/shared_memory.h
+    include/mega/gfx/worker/shared_image_ring.h
     src/gfx/isolatedprocess.cpp
     src/gfx/worker/client.cpp
     src/gfx/worker/commands.cpp
     src/gfx/worker/command_serializer.cpp
+    src/gfx/worker/shared_image_ring.cpp
 )
 
 target_sources_conditional(SDKlib
@@ -342,6 +352,11 @@ if(ENABLE_DRIVE_NOTIFICATIONS)
     set(USE_DRIVE_NOTIFICATIONS 1)
 endif()
 
+if(ENABLE_ISOLATED_GFX AND NOT (WIN32 OR APPLE))
+    # Needed for shm_open before glibc 2.34
+    target_link_libraries(SDKlib PRIVATE rt)
+endif()
+
 if(WIN32)
     target_link_libraries(SDKlib PRIVATE
         ws2_32 winhttp Shlwapi Secur32.lib crypt32.lib Wldap32.lib
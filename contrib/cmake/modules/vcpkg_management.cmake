@@ -73,6 +73,10 @@ macro(process_vcpkg_libraries overlays_path)
         list(APPEND VCPKG_MANIFEST_FEATURES "sdk-tests")
     endif()
 
+    if (ENABLE_SDKLIB_BENCHMARKS)
+        list(APPEND VCPKG_MANIFEST_FEATURES "sdk-benchmarks")
+    endif()
+
     set(CMAKE_TOOLCHAIN_FILE ${CMAKE_TOOLCHAIN_FILE} ${VCPKG_TOOLCHAIN_PATH})
     message(STATUS "Using VCPKG dependencies. VCPKG base path: ${VCPKG_ROOT} and tripplet ${VCPKG_TARGET_TRIPLET}")
     message(STATUS "Overlay for VCPKG ports: ${VCPKG_OVERLAY_PORTS}")
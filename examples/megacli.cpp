@@ -27,6 +27,7 @@
 #include <chrono>
 #include <exception>
 #include <fstream>
+#include <random>
 #include <bitset>
 #include <iostream>
 #include <stdexcept>
@@ -3038,6 +3039,97 @@ void exec_codeTimings(autocomplete::ACState& s)
 
 #endif
 
+static void outputOrSave(const string& content, autocomplete::ACState& s)
+{
+    string filename;
+    if (s.extractflagparam("-tofile", filename))
+    {
+        ofstream(filename) << content;
+        cout << "Written " << content.size() << " bytes to " << filename << endl;
+    }
+    else
+    {
+        cout << content << endl;
+    }
+}
+
+void exec_metrics(autocomplete::ACState& s)
+{
+    bool reset = s.extractflag("-reset");
+    outputOrSave(Metrics::registry().snapshot(reset), s);
+}
+
+void exec_trace(autocomplete::ACState& s)
+{
+    if (s.words[1].s == "dump")
+    {
+        outputOrSave(Tracer::dump(true), s);
+        return;
+    }
+
+    Tracer::setEnabled(s.words[1].s == "on");
+#ifndef ENABLE_TRACING
+    cout << "Note that the SDK was built without ENABLE_TRACING: no spans will be recorded" << endl;
+#endif
+}
+
+// The command being timed. Most commands only queue requests or transfers,
+// so it is done once the client has nothing left to send, to wait for, or to transfer
+struct TimedCommand
+{
+    string line;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::duration execution;
+};
+
+static std::unique_ptr<TimedCommand> timedCommand;
+
+extern autocomplete::ACN autocompleteTemplate;
+
+static void checkTimedCommand()
+{
+    if (!timedCommand
+        || client->reqs.readyToSend() || client->reqs.cmdsInflight()
+        || !appxferq[PUT].empty() || !appxferq[GET].empty())
+    {
+        return;
+    }
+
+    using std::chrono::duration_cast;
+    using std::chrono::milliseconds;
+    cout << "time: " << timedCommand->line << ": "
+         << duration_cast<milliseconds>(std::chrono::steady_clock::now() - timedCommand->start).count() << " ms in total, "
+         << duration_cast<milliseconds>(timedCommand->execution).count() << " ms executing the command" << endl;
+    timedCommand.reset();
+}
+
+void exec_time(autocomplete::ACState& s)
+{
+    if (timedCommand)
+    {
+        cout << "Still timing: " << timedCommand->line << endl;
+        return;
+    }
+
+    string line;
+    for (size_t i = 1; i < s.words.size(); ++i)
+    {
+        line += (i > 1 ? " " : "") + s.words[i].getQuoted();
+    }
+
+    timedCommand.reset(new TimedCommand{line, std::chrono::steady_clock::now(), {}});
+
+    std::string consoleOutput;
+    ac::autoExec(line, string::npos, autocompleteTemplate, false, consoleOutput, true);
+    if (!consoleOutput.empty())
+    {
+        cout << consoleOutput << flush;
+    }
+
+    timedCommand->execution = std::chrono::steady_clock::now() - timedCommand->start;
+    checkTimedCommand();
+}
+
 std::function<void()> onCompletedUploads;
 
 void setAppendAndUploadOnCompletedUploads(string local_path, int count, bool allowDuplicateVersions)
@@ -3312,6 +3404,80 @@ void exec_cycleUploadDownload(autocomplete::ACState& s)
 }
 
 
+// Synthetic load on the account: uploads of generated files, all queued at once so that they run
+// as many in parallel as the client allows, and random searches of node names while they run
+void exec_loadtest(autocomplete::ACState& s)
+{
+    string param;
+    int uploads = 10;
+    int64_t filesize = 1024 * 1024;
+    int searches = 100;
+    if (s.extractflagparam("-uploads", param)) uploads = atoi(param.c_str());
+    if (s.extractflagparam("-filesize", param)) filesize = atoll(param.c_str());
+    if (s.extractflagparam("-searches", param)) searches = atoi(param.c_str());
+
+    fs::path p = pathFromLocalPath(s.words[1].s, true);
+    std::shared_ptr<Node> target = nodeFromRemotePath(s.words[2].s);
+    if (p.empty() || !target || target->type == FILENODE)
+    {
+        cout << "invalid local or remote folder" << endl;
+        return;
+    }
+
+    using std::chrono::duration_cast;
+    using std::chrono::milliseconds;
+    const auto start = std::chrono::steady_clock::now();
+
+    if (uploads > 0)
+    {
+        int totalfilecount = 0, totalfoldercount = 0;
+        vector<LocalPath> localPaths;
+        string prefix = "loadtest_" + std::to_string(m_time());
+        if (!buildLocalFolders(p, prefix, 1, 1, uploads, static_cast<uint64_t>(filesize), totalfilecount, totalfoldercount, &localPaths))
+        {
+            cout << "could not create the files at " << p.u8string() << endl;
+            return;
+        }
+
+        TransferDbCommitter committer(client->tctable);
+        int total = 0;
+        for (auto& lp : localPaths)
+        {
+            uploadLocalPath(FILENODE, lp.leafName().toPath(false), lp, target.get(), "", committer, total, false, NoVersioning, nullptr, false, false);
+        }
+        cout << "loadtest: queued " << total << " uploads of " << filesize << " bytes" << endl;
+
+        onCompletedUploads = [start, uploads, filesize]() {
+            auto ms = duration_cast<milliseconds>(std::chrono::steady_clock::now() - start).count();
+            cout << "loadtest: " << uploads << " uploads in " << ms << " ms, "
+                 << (ms ? uploads * filesize / ms * 1000 / 1024 : 0) << " KB/s" << endl;
+            onCompletedUploads = nullptr;
+        };
+    }
+
+    // random fragments of names, so that the searches hit different nodes
+    std::mt19937 rng(static_cast<unsigned>(start.time_since_epoch().count()));
+    const char letters[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+    Metrics::Histogram latency;
+    size_t found = 0;
+    for (int i = 0; i < searches; ++i)
+    {
+        string fragment{letters[rng() % (sizeof letters - 1)], letters[rng() % (sizeof letters - 1)]};
+        NodeSearchFilter filter;
+        filter.byName(fragment);
+        filter.byAncestors({client->mNodeManager.getRootNodeFiles().as8byte(), UNDEF, UNDEF});
+
+        Metrics::ScopedLatency timer(latency);
+        found += client->mNodeManager.searchNodes(filter, 0, CancelToken(), NodeSearchPage(0, 0)).size();
+    }
+
+    if (searches > 0)
+    {
+        cout << "loadtest: " << searches << " searches found " << found << " nodes in " << latency.sum() / 1000 << " ms, "
+             << "p50 " << latency.percentile(50) << " us, p99 " << latency.percentile(99) << " us, max " << latency.max() << " us" << endl;
+    }
+}
+
 void exec_generate_put_fileversions(autocomplete::ACState& s)
 {
     int count = 100;
@@ -4936,6 +5102,9 @@ autocomplete::ACN autocompleteSyntax()
     p->Add(exec_sendDeferred, sequence(text("senddeferred"), opt(flag("-reset"))));
     p->Add(exec_codeTimings, sequence(text("codetimings"), opt(flag("-reset"))));
 #endif
+    p->Add(exec_metrics, sequence(text("metrics"), opt(flag("-reset")), opt(sequence(flag("-tofile"), param("filename")))));
+    p->Add(exec_trace, sequence(text("trace"), either(text("on"), text("off"), sequence(text("dump"), opt(sequence(flag("-tofile"), param("filename")))))));
+    p->Add(exec_time, sequence(text("time"), param("command"), repeat(param("args"))));
 
 #ifdef USE_FILESYSTEM
     p->Add(exec_treecompare, sequence(text("treecompare"), localFSPath(), remoteFSPath(client, &cwd)));
@@ -4955,6 +5124,11 @@ autocomplete::ACN autocompleteSyntax()
             sequence(flag("-filecount"), param("count")),
             sequence(flag("-filesize"), param("size")),
             sequence(flag("-nameprefix"), param("prefix")))), localFSFolder("localworkingfolder"), remoteFSFolder(client, &cwd, "remoteworkingfolder")));
+    p->Add(exec_loadtest, sequence(text("loadtest"),
+        repeat(either(
+            sequence(flag("-uploads"), param("count")),
+            sequence(flag("-filesize"), param("size")),
+            sequence(flag("-searches"), param("count")))), localFSFolder("localworkingfolder"), remoteFSFolder(client, &cwd, "remoteworkingfolder")));
 
 #endif
     p->Add(exec_querytransferquota, sequence(text("querytransferquota"), param("filesize")));
@@ -6034,7 +6208,7 @@ void exec_get(autocomplete::ACState& s)
                     pread_file_end = offset + count;
                 }
 
-                client->pread(n.get(), offset, count, NULL);
+                client->pread(n.get(), offset, count, static_cast<void*>(nullptr));
             }
             else
             {
@@ -6102,7 +6276,7 @@ void exec_more(autocomplete::ACState& s)
         m_off_t count = (more_offset + MORE_BYTES <= more_node->size)
                 ? MORE_BYTES : (more_node->size - more_offset);
 
-        client->pread(more_node.get(), more_offset, count, NULL);
+        client->pread(more_node.get(), more_offset, count, static_cast<void*>(nullptr));
     }
 }
 
@@ -9715,7 +9889,7 @@ void DemoApp::folderlinkinfo_result(error e, handle owner, handle /*ph*/, string
     publiclink.clear();
 }
 
-bool DemoApp::pread_data(byte* data, m_off_t len, m_off_t pos, m_off_t, m_off_t, void* /*appdata*/)
+bool DemoApp::pread_data(byte* data, m_off_t len, m_off_t pos, m_off_t, m_off_t, void* /*appdata*/, std::shared_ptr<const void>)
 {
     // Improvement: is there a way to have different pread_data receivers for
     // different modes?
@@ -10592,6 +10766,8 @@ void megacli()
             mainloopActions.pop_front();
         }
 
+        checkTimedCommand();
+
     }
 }
 
@@ -212,7 +212,7 @@ struct DemoApp : public MegaApp
     void folderlinkinfo_result(error, handle, handle, string *, string*, m_off_t, uint32_t, uint32_t, m_off_t, uint32_t) override;
 
     dstime pread_failure(const Error&, int, void*, dstime) override;
-    bool pread_data(byte*, m_off_t, m_off_t, m_off_t, m_off_t, void*) override;
+    bool pread_data(byte*, m_off_t, m_off_t, m_off_t, m_off_t, void*, std::shared_ptr<const void>) override;
 
     void transfer_added(Transfer*) override;
     void transfer_removed(Transfer*) override;
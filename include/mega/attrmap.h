@@ -26,25 +26,125 @@
 
 namespace mega {
 
-// maps attribute names to attribute values
-struct attr_map : map<nameid, string>
+// maps attribute names to attribute values.
+// Nodes have just a few attributes, so they are kept in a vector sorted by name, with the interface
+// of a std::map: there is no allocation and no tree node per attribute, which adds up with millions
+// of nodes in memory. Unlike a std::map, adding or removing attributes invalidates references to the others
+struct attr_map
 {
+    using value_type = pair<nameid, string>;
+    using iterator = vector<value_type>::iterator;
+    using const_iterator = vector<value_type>::const_iterator;
+
     attr_map() {}
 
     attr_map(nameid key, string value)
     {
-        (*this)[key] = value;
+        mEntries.emplace_back(key, std::move(value));
     }
 
     attr_map(map<nameid, string>&& m)
+        : mEntries(std::make_move_iterator(m.begin()), std::make_move_iterator(m.end()))
+    {
+    }
+
+    iterator begin() { return mEntries.begin(); }
+    iterator end() { return mEntries.end(); }
+    const_iterator begin() const { return mEntries.begin(); }
+    const_iterator end() const { return mEntries.end(); }
+
+    size_t size() const { return mEntries.size(); }
+    bool empty() const { return mEntries.empty(); }
+    void clear() { mEntries.clear(); }
+    void swap(attr_map& other) { mEntries.swap(other.mEntries); }
+
+    // releases the room left by the growth, once the attributes of a node are set
+    void shrink_to_fit() { mEntries.shrink_to_fit(); }
+
+    iterator find(nameid k)
+    {
+        auto it = lowerBound(k);
+        return it != mEntries.end() && it->first == k ? it : mEntries.end();
+    }
+
+    const_iterator find(nameid k) const
     {
-        m.swap(*this);
+        return const_cast<attr_map*>(this)->find(k);
     }
 
     bool contains(nameid k) const
     {
-        return this->find(k) != this->end();
+        return find(k) != end();
+    }
+
+    size_t count(nameid k) const
+    {
+        return contains(k) ? 1 : 0;
+    }
+
+    string& operator[](nameid k)
+    {
+        return emplace(k, string()).first->second;
+    }
+
+    const string& at(nameid k) const
+    {
+        auto it = find(k);
+        if (it == end())
+        {
+            throw std::out_of_range("attr_map::at");
+        }
+        return it->second;
+    }
+
+    string& at(nameid k)
+    {
+        return const_cast<string&>(static_cast<const attr_map*>(this)->at(k));
+    }
+
+    // like std::map, it's not replaced if already present
+    pair<iterator, bool> emplace(nameid k, string value)
+    {
+        auto it = lowerBound(k);
+        if (it != mEntries.end() && it->first == k)
+        {
+            return { it, false };
+        }
+        return { mEntries.emplace(it, k, std::move(value)), true };
+    }
+
+    pair<iterator, bool> insert(value_type entry)
+    {
+        return emplace(entry.first, std::move(entry.second));
+    }
+
+    iterator erase(const_iterator it)
+    {
+        return mEntries.erase(it);
+    }
+
+    size_t erase(nameid k)
+    {
+        auto it = find(k);
+        if (it == end())
+        {
+            return 0;
+        }
+        mEntries.erase(it);
+        return 1;
+    }
+
+    bool operator==(const attr_map& other) const { return mEntries == other.mEntries; }
+    bool operator!=(const attr_map& other) const { return mEntries != other.mEntries; }
+
+private:
+    iterator lowerBound(nameid k)
+    {
+        return std::lower_bound(mEntries.begin(), mEntries.end(), k,
+                                [](const value_type& entry, nameid key) { return entry.first < key; });
     }
+
+    vector<value_type> mEntries;
 };
 
 struct MEGA_API AttrMap
@@ -72,6 +172,9 @@ struct MEGA_API AttrMap
     // export as raw binary serialize
     void serialize(string*) const;
 
+    // bytes appended by serialize()
+    size_t serializedsize() const;
+
     // import raw binary serialize
     const char* unserialize(const char*, const char*);
 
@@ -40,6 +40,10 @@ public:
     // trigger exponential backoff
     void backoff();
 
+    // trigger a backoff with decorrelated jitter: random between the minimum and three times the previous delay,
+    // so that the clients failing at the same time don't retry at the same time either
+    void backoffDecorrelated();
+
     // set absolute backoff
     void backoff(dstime);
 
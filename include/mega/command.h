@@ -69,6 +69,11 @@ public:
     // filters for JSON parsing in streaming
     std::map<std::string, std::function<bool(JSON *)>> mFilters;
 
+    // true if the response is always processed by mFilters while it's being received, instead of
+    // being buffered for procresult(). The command is sent in its own batch, and its filters must
+    // handle the end of the response ("{" or "[" for the outer element), errors ("#") and parsing failures ("E")
+    bool mStreaming = false;
+
     void cmd(const char*);
     void notself(MegaClient*);
     virtual void cancel(void);
@@ -665,8 +670,20 @@ public:
 
 class MEGA_API CommandAttachFA : public Command
 {
+public:
+    // an attribute blob to attach, and the tag of the request that uploaded it
+    struct Attribute
+    {
+        fatype type;
+        handle fah;
+        int tag;
+    };
+
+private:
     handle h;
-    fatype type;
+
+    // the attributes to notify back to the app
+    vector<Attribute> mAttributes;
 
 public:
     bool procresult(Result, JSON&) override;
@@ -674,6 +691,9 @@ public:
     // use this one for attribute blobs
     CommandAttachFA(MegaClient*, handle, fatype, handle, int);
 
+    // several attribute blobs of the same node at once, each one notified back to the app with its own tag
+    CommandAttachFA(MegaClient*, handle, const vector<Attribute>&);
+
     // use this one for numeric 64 bit attributes (which must be pre-encrypted with XXTEA)
     // multiple attributes can be added at once, encryptedAttributes format "<N>*<attrib>/<M>*<attrib>"
     // only the fatype specified will be notified back to the app
@@ -695,7 +715,10 @@ private:
     NodeHandle targethandle;
     Completion mResultFunction;
 
-    void removePendingDBRecordsAndTempFiles();
+    // Tags of the other callers whose nodes were coalesced into this command.
+    vector<int> mCoalescedTags;
+
+    void removePendingDBRecordsAndTempFiles(int tag);
     void performAppCallback(Error e, vector<NewNode>&, bool targetOverride = false);
 
 public:
@@ -91,6 +91,30 @@ private:
     CryptoPP::GCM<CryptoPP::AES>::Encryption aesgcm_e;
     CryptoPP::GCM<CryptoPP::AES>::Decryption aesgcm_d;
 
+    // The key schedules are only expanded for the modes used after setkey(): most of the ciphers,
+    // such as the temporary ones for node keys and attributes, just use one or two of the ten
+    enum Mode : uint16_t
+    {
+        ECB_E = 1 << 0, ECB_D = 1 << 1,
+        CBC_E = 1 << 2, CBC_D = 1 << 3,
+        CCM16_E = 1 << 4, CCM16_D = 1 << 5,
+        CCM8_E = 1 << 6, CCM8_D = 1 << 7,
+        GCM_E = 1 << 8, GCM_D = 1 << 9,
+    };
+    uint16_t mExpandedModes = 0;
+
+    void expandKey(Mode mode);
+
+    template<typename Cipher>
+    Cipher& keyed(Cipher& cipher, Mode mode)
+    {
+        if (!(mExpandedModes & mode))
+        {
+            expandKey(mode);
+        }
+        return cipher;
+    }
+
     /**
      * @brief Authenticated symmetric encryption using AES in GCM mode.
      *
@@ -695,8 +719,6 @@ public:
  */
 class MEGA_API PBKDF2_HMAC_SHA512
 {
-    CryptoPP::PKCS5_PBKDF2_HMAC<CryptoPP::SHA512> pbkdf2;
-
 public:
     PBKDF2_HMAC_SHA512();
 
@@ -22,6 +22,11 @@
 #ifndef MEGA_DB_H
 #define MEGA_DB_H 1
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
 #include "filesystem.h"
 #include "logging.h"
 #include "node.h"
@@ -48,6 +53,24 @@ enum class DBError
 
 using DBErrorCallback = std::function<void(DBError)>;
 
+// Latency of the commits of a table, kept in a histogram of power-of-two buckets of microseconds.
+// It can be read from any thread
+class MEGA_API DbCommitLatency
+{
+public:
+    void add(std::chrono::microseconds elapsed);
+
+    // upper bound of the latency of 'percentile'% of the commits (ie. 50, 90, 99)
+    std::chrono::microseconds percentile(unsigned percentile) const;
+
+    uint64_t numCommits() const { return mNumCommits; }
+
+private:
+    static constexpr size_t NUM_BUCKETS = 32; // last bucket is >= 2^31 us (~36 minutes)
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> mBuckets{};
+    std::atomic<uint64_t> mNumCommits{0};
+};
+
 
 class MEGA_API DbTable
 {
@@ -57,10 +80,12 @@ protected:
     bool mCheckAlwaysTransacted = false;
     DBTableTransactionCommitter* mTransactionCommitter = nullptr;
     DBErrorCallback mDBErrorCallBack;
+    DbCommitLatency mCommitLatency;
     friend class DBTableTransactionCommitter;
     void checkTransaction();
     // should be called by the subclass' destructor
     void resetCommitter();
+    PrnGen& prnGen() const { return rng; }
 
 public:
     static const int IDSPACING = 16;
@@ -102,6 +127,11 @@ public:
 
     void checkCommitter(DBTableTransactionCommitter*);
 
+    // Move WAL checkpoints out of the thread committing transactions (if the backend supports it)
+    virtual void setBackgroundCheckpoints(bool /*enable*/) { }
+
+    const DbCommitLatency& commitLatency() const { return mCommitLatency; }
+
     // autoincrement
     uint32_t nextid;
 
@@ -112,6 +142,7 @@ public:
 
 class NodeSearchFilter;
 class NodeSearchPage;
+struct NodeView;
 
 class MEGA_API DBTableNodes
 {
@@ -120,6 +151,17 @@ public:
     // add or update a node
     virtual bool put(Node* node) = 0;
 
+    // add or update several nodes at once (ie. after fetchnodes). It returns false if any of them fails
+    virtual bool putNodes(const std::vector<Node*>& nodes)
+    {
+        bool result = true;
+        for (Node* node : nodes)
+        {
+            result = put(node) && result;
+        }
+        return result;
+    }
+
     // remove one node from 'nodes' table
     virtual bool remove(NodeHandle nodehandle) = 0;
 
@@ -140,8 +182,21 @@ public:
     virtual bool getChildrenFromType(NodeHandle parentHandle, nodetype_t nodeType, std::vector<std::pair<NodeHandle, NodeSerialized>>& children, CancelToken cancelFlag) = 0;
     virtual uint64_t getNumberOfChildren(NodeHandle parentHandle) = 0;
     virtual bool getChildren(const NodeSearchFilter& filter, int order, std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes, CancelToken cancelFlag, const NodeSearchPage& page) = 0;
+    // same as above, but only the columns needed for listings are read (no blob is decoded)
+    virtual bool getChildrenViews(const NodeSearchFilter& filter, int order, std::vector<NodeView>& nodes, CancelToken cancelFlag, const NodeSearchPage& page) = 0;
     virtual bool searchNodes(const NodeSearchFilter& filter, int order, std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes, CancelToken cancelFlag, const NodeSearchPage& page) = 0;
 
+    // Read-only access to the table through a connection of its own, so searches and listings can
+    // run concurrently with the writer and among them (without locking the NodeManager). Readers
+    // see the last committed state, so it returns nullptr while the writer has changes pending
+    // to commit, and also if not supported or if all the readers are in use
+    virtual std::shared_ptr<DBTableNodes> acquireReader() { return nullptr; }
+
+    // Same as acquireReader(), but the reader keeps a read transaction open until it's released,
+    // so all its queries see the state of the last commit when it was acquired, whatever is
+    // committed meanwhile. The WAL can't be checkpointed beyond that commit while it's held
+    virtual std::shared_ptr<DBTableNodes> acquireSnapshot() { return nullptr; }
+
     /**
      * @deprecated
      * should be removed along with deprecated MegaApi::search() calls
@@ -166,6 +221,9 @@ public:
     virtual bool getRecentNodes(unsigned maxcount, m_time_t since, std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes) = 0;
     virtual bool getNodesByFingerprint(const std::string& fingerprint, std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes) = 0;
     virtual bool getNodeByFingerprint(const std::string& fingerprint, mega::NodeSerialized& node, NodeHandle& handle) = 0;
+
+    // pass the serialized fingerprint of every node to 'onFingerprint' (in no particular order)
+    virtual bool getFingerprints(std::function<void(const std::string&)> onFingerprint) = 0;
     virtual bool getRootNodes(std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes) = 0;
 
     /**
@@ -194,6 +252,10 @@ public:
 
     virtual bool isAncestor(NodeHandle node, NodeHandle ancestror, CancelToken cancelFlag) = 0;
 
+    // Get the previous versions of the file 'fileHandle' (the chain of its descendants), newest first.
+    // It returns false if they can't be looked up in one query: the chain is walked with getChildren() then
+    virtual bool getVersions(NodeHandle fileHandle, std::vector<std::pair<NodeHandle, NodeSerialized>>& versions) = 0;
+
     // count of items in 'nodes' table. Returns 0 if error
     virtual uint64_t getNumberOfNodes() = 0;
 
@@ -210,6 +272,18 @@ public:
     virtual void updateCounterAndFlags(NodeHandle nodeHandle, uint64_t flags, const std::string& nodeCounterBlob) = 0;
 
     virtual void createIndexes() = 0;
+
+    // -- access granted to the nodes attached to chats --
+
+    // Whether the grants can be kept in the table 'chatgrants', out of the records of their chats,
+    // so a change doesn't rewrite the whole list and they are only read for the chats that need them
+    virtual bool hasChatGrants() const { return false; }
+
+    // Apply the grants (and revocations) of a chat, all at once. If 'replace' is set, any previous grant of the chat is removed first
+    virtual bool putChatGrants(handle /*chatid*/, const std::vector<ChatGrant>& /*grants*/, bool /*replace*/) { return false; }
+
+    // all the grants of a chat
+    virtual bool getChatGrants(handle /*chatid*/, std::vector<ChatGrant>& /*grants*/) { return false; }
 };
 
 class MEGA_API DBTableTransactionCommitter
@@ -307,6 +381,41 @@ enum DbOpenFlag
     DB_OPEN_FLAG_TRANSACTED = 0x2
 }; // DbOpenFlag
 
+// Tuning of the storage engine, applied to the databases opened after it's set
+struct MEGA_API DbPerformanceProfile
+{
+    enum Preset
+    {
+        PRESET_DEFAULT = 0,         // engine defaults
+        PRESET_LOW_MEMORY,          // small page cache, no memory-mapped I/O
+        PRESET_HIGH_PERFORMANCE,    // large page cache and memory-mapped I/O, relaxed fsyncs
+    };
+
+    enum Synchronous
+    {
+        SYNC_DEFAULT = -1,
+        SYNC_OFF = 0,
+        SYNC_NORMAL = 1,
+        SYNC_FULL = 2,
+    };
+
+    // bytes of the database accessed through memory-mapped I/O (0: disabled, < 0: default)
+    int64_t mMmapSize = -1;
+
+    // KiB of page cache per connection (<= 0: default)
+    int64_t mCacheSizeKB = 0;
+
+    // bytes per page, a power of two in [512, 65536]. Only used when the database is created (0: default)
+    int mPageSize = 0;
+
+    // with WAL journal, SYNC_NORMAL may lose the last commits after a power loss, but never corrupts the DB
+    int mSynchronous = SYNC_DEFAULT;
+
+    static bool fromPreset(int preset, DbPerformanceProfile& profile);
+
+    bool isDefault() const;
+};
+
 struct MEGA_API DbAccess
 {
     static const int LEGACY_DB_VERSION;
@@ -336,7 +445,15 @@ struct MEGA_API DbAccess
     // Where are we storing our databases?
     virtual const LocalPath& rootPath() const = 0;
 
+    void setPerformanceProfile(const DbPerformanceProfile& profile);
+    DbPerformanceProfile performanceProfile() const;
+
     int currentDbVersion;
+
+protected:
+    // set from the app's thread, read when the databases are opened
+    mutable std::mutex mPerformanceProfileMutex;
+    DbPerformanceProfile mPerformanceProfile;
 };
 
 // Convenience.
@@ -29,6 +29,9 @@
 
 namespace mega {
 
+class SqliteWalCheckpointer;
+class SqliteReaderPool;
+
 class MEGA_API SqliteDbTable : public DbTable
 {
 protected:
@@ -36,10 +39,19 @@ protected:
     LocalPath dbfile;
     FileSystemAccess *fsaccess;
 
+    // set by setBackgroundCheckpoints(): WAL checkpoints are run by its thread, not by commit()
+    std::unique_ptr<SqliteWalCheckpointer> mCheckpointer;
+
     sqlite3_stmt* pStmt = nullptr;
     sqlite3_stmt* mDelStmt = nullptr;
     sqlite3_stmt* mPutStmt = nullptr;
 
+    // SQLite's default for automatic checkpoints, restored when background checkpoints are disabled
+    static constexpr int WAL_AUTOCHECKPOINT_PAGES = 1000;
+
+    // whether the journal mode of the database is WAL
+    bool isWal() const;
+
     // handler for DB errors ('interrupt' is true if caller can be interrupted by CancelToken)
     void errorHandler(int sqliteError, const std::string& operation, bool interrupt);
 
@@ -54,6 +66,7 @@ public:
     void commit() override;
     void abort() override;
     void remove() override;
+    void setBackgroundCheckpoints(bool enable) override;
 
     SqliteDbTable(PrnGen &rng, sqlite3*, FileSystemAccess &fsAccess, const LocalPath &path, const bool checkAlwaysTransacted, DBErrorCallback dBErrorCallBack);
     virtual ~SqliteDbTable();
@@ -92,6 +105,7 @@ public:
     uint64_t getNumberOfChildren(NodeHandle parentHandle) override;
     // If a cancelFlag is passed, it must be kept alive until this method returns.
     bool getChildren(const mega::NodeSearchFilter& filter, int order, std::vector<std::pair<NodeHandle, NodeSerialized>>& children, CancelToken cancelFlag, const NodeSearchPage& page) override;
+    bool getChildrenViews(const mega::NodeSearchFilter& filter, int order, std::vector<NodeView>& children, CancelToken cancelFlag, const NodeSearchPage& page) override;
     bool searchNodes(const mega::NodeSearchFilter& filter, int order, std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes, CancelToken cancelFlag, const NodeSearchPage& page) override;
 
     /**
@@ -117,11 +131,13 @@ public:
 
     bool getNodesByFingerprint(const std::string& fingerprint, std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes) override;
     bool getNodeByFingerprint(const std::string& fingerprint, mega::NodeSerialized& node, NodeHandle& handle) override;
+    bool getFingerprints(std::function<void(const std::string&)> onFingerprint) override;
     bool getRecentNodes(unsigned maxcount, m_time_t since, std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes) override;
     bool getFavouritesHandles(NodeHandle node, uint32_t count, std::vector<mega::NodeHandle>& nodes) override;
     bool childNodeByNameType(NodeHandle parentHanlde, const std::string& name, nodetype_t nodeType, std::pair<NodeHandle, NodeSerialized>& node) override;
     bool getNodeSizeTypeAndFlags(NodeHandle node, m_off_t& size, nodetype_t& nodeType, uint64_t &oldFlags) override;
     bool isAncestor(mega::NodeHandle node, mega::NodeHandle ancestor, CancelToken cancelFlag) override;
+    bool getVersions(NodeHandle fileHandle, std::vector<std::pair<NodeHandle, NodeSerialized>>& versions) override;
     uint64_t getNumberOfNodes() override;
     uint64_t getNumberOfChildrenByType(NodeHandle parentHandle, nodetype_t nodeType) override;
 
@@ -139,15 +155,25 @@ public:
      */
     bool getNodesByMimetypeExclusiveRecursive(MimeType_t mimeType, std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes, Node::Flags requiredFlags, Node::Flags excludeFlags, Node::Flags excludeRecursiveFlags, NodeHandle anscestorHandle, CancelToken cancelFlag) override;
     bool put(Node* node) override;
+    bool putNodes(const std::vector<Node*>& nodes) override;
     bool remove(mega::NodeHandle nodehandle) override;
     bool removeNodes() override;
 
     void updateCounter(NodeHandle nodeHandle, const std::string& nodeCounterBlob) override;
     void updateCounterAndFlags(NodeHandle nodeHandle, uint64_t flags, const std::string& nodeCounterBlob) override;
     void createIndexes() override;
+    std::shared_ptr<DBTableNodes> acquireReader() override;
+    std::shared_ptr<DBTableNodes> acquireSnapshot() override;
+
+    bool hasChatGrants() const override { return true; }
+    bool putChatGrants(handle chatid, const std::vector<ChatGrant>& grants, bool replace) override;
+    bool getChatGrants(handle chatid, std::vector<ChatGrant>& grants) override;
+
+    // the chat grants go with the chats in 'statecache'
+    void truncate() override;
 
     void remove() override;
-    SqliteAccountState(PrnGen &rng, sqlite3*, FileSystemAccess &fsAccess, const mega::LocalPath &path, const bool checkAlwaysTransacted, DBErrorCallback dBErrorCallBack);
+    SqliteAccountState(PrnGen &rng, sqlite3*, FileSystemAccess &fsAccess, const mega::LocalPath &path, const bool checkAlwaysTransacted, DBErrorCallback dBErrorCallBack, bool hasNameIndex = false, bool hasAncestryIndex = false, bool hasTagIndex = false, bool hasDescriptionIndex = false);
     void finalise();
     virtual ~SqliteAccountState();
 
@@ -164,6 +190,10 @@ public:
     // Gets the mimetype corresponding to the file extension
     static void userGetMimetype(sqlite3_context* context, int argc, sqlite3_value** argv);
 
+    // Method called when query uses 'getnamesortkey'
+    // Gets the key of the name that sorts like naturalsorting_compare() does, with memcmp
+    static void userGetNameSortKey(sqlite3_context* context, int argc, sqlite3_value** argv);
+
     // Check if string (pattern - argv[0]) is contained at data base column from type text (argv[1])
     static void userIsContained(sqlite3_context* context, int argc, sqlite3_value** argv);
 
@@ -171,13 +201,126 @@ public:
     //(string with the tags delimited by TAG_DELIMITER - argv[1]).
     static void userMatchTag(sqlite3_context* context, int argc, sqlite3_value** argv);
 
+    // Register the functions and collations used by the queries on `nodes` (for every connection)
+    static bool registerNodesFunctions(sqlite3* db);
+
+    // Create (and populate, if needed) the FTS5 trigram index of node names 'nodesname'.
+    // It returns false if the SQLite library doesn't support it: searches use REGEXP alone then
+    static bool openNameIndex(sqlite3* db);
+
+    // Build the FTS5 query that preselects the names matching 'pattern' (with wildcards '*' and '?').
+    // Only fragments with 3 or more characters can be looked up in a trigram index: if there
+    // are none, it returns an empty string and the name index can't be used
+    static std::string nameIndexQuery(const std::string& pattern);
+
+    bool hasNameIndex() const { return mHasNameIndex; }
+
+    // Create (and populate, if needed) the table 'nodetags', with a row per tag (folded, see
+    // foldCaseUtf8()) and node, so searches by tag are look-ups of its primary key.
+    // It returns false if it can't be created: searches use matchTag() then
+    static bool openTagIndex(sqlite3* db);
+
+    bool hasTagIndex() const { return mHasTagIndex; }
+
+    // Create (and populate, if needed) the FTS5 trigram index of node descriptions 'nodesdescription'.
+    // It returns false if the SQLite library doesn't support it: searches use isContained() alone then
+    static bool openDescriptionIndex(sqlite3* db);
+
+    bool hasDescriptionIndex() const { return mHasDescriptionIndex; }
+
+    // Create (and populate, if needed) the ancestry index 'nodepaths', which keeps for every node
+    // the path of handles from its root (see ancestryPathSegment()).
+    // It returns false if it can't be created: ancestry is resolved walking 'parenthandle' then
+    static bool openAncestryIndex(sqlite3* db);
+
+    bool hasAncestryIndex() const { return mHasAncestryIndex; }
+
+    // Segment of 'nodehandle' in the paths of the ancestry index: 12 uppercase hex digits, so
+    // paths are compared as text and the subtree of a node is the range (path, path + '~')
+    static std::string ancestryPathSegment(handle nodehandle);
+
 private:
+    // SQL condition matching 'column' (a mimetype) with the category bound at 'sqlParamIndex',
+    // where MIME_TYPE_ALL_DOCS includes every kind of document
+    static std::string mimetypeCondition(const std::string& column, int sqlParamIndex);
+
+    // SQL condition matching the tag bound at 'sqlParamIndex + 1' (when the size bound at
+    // 'sqlParamIndex' isn't 0), through 'nodetags' if available
+    std::string tagCondition(int sqlParamIndex) const;
+
+    // Keep the name index in sync with `nodes`
+    void putNodeName(handle nodehandle, const std::string& name);
+    void removeNodeName(NodeHandle nodehandle);
+
+    // whether 'nodesname' is available to back searches by name
+    bool mHasNameIndex = false;
+
+    // Create the FTS5 trigram index 'table' of the non-NULL values of 'nodes.column', and
+    // populate it when it's new or it doesn't have as many rows as expected
+    static bool openTrigramIndex(sqlite3* db, const std::string& table, const std::string& column);
+
+    // Keep the tag and description indexes in sync with `nodes` ('tags' and 'description' are
+    // nullptr if the node doesn't have them)
+    void putNodeTags(handle nodehandle, const std::string* tags);
+    void removeNodeTags(NodeHandle nodehandle);
+    void putNodeDescription(handle nodehandle, const std::string* description);
+    void removeNodeDescription(NodeHandle nodehandle);
+
+    // whether 'nodetags' is available to back searches by tag
+    bool mHasTagIndex = false;
+
+    // whether 'nodesdescription' is available to back searches by description
+    bool mHasDescriptionIndex = false;
+
+    // Keep the ancestry index in sync with `nodes`. When a node changes its parent (or it's
+    // written after its descendants), the paths of the whole subtree are rebased
+    void putNodePath(handle nodehandle, handle parenthandle);
+    void removeNodePath(NodeHandle nodehandle);
+    bool getNodePath(handle nodehandle, std::string& path);
+
+    // getNodesByMimetypeExclusiveRecursive() when no subtree is excluded, using the ancestry index
+    bool getNodesByMimetypeInSubtree(MimeType_t mimeType, std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes, Node::Flags requiredFlags, Node::Flags excludeFlags, NodeHandle ancestorHandle);
+
+    // whether 'nodepaths' is available to resolve ancestry
+    bool mHasAncestryIndex = false;
+
+    // read-only instances for acquireReader(), created on demand. Readers don't have readers
+    // themselves, and neither do databases not in WAL mode
+    std::shared_ptr<SqliteReaderPool> mReaderPool;
+    bool mNoReaders = false;
+
+    friend class SqliteReaderPool;
+
+    // added to the id of cached searches that use the name index (above the ids of OrderByClause)
+    static constexpr size_t NAME_INDEX_CACHE_ID = 1 << 2;
+
+    // added to the id of cached searches that use the description index
+    static constexpr size_t DESCRIPTION_INDEX_CACHE_ID = 1 << 3;
+
+    // ids of cached queries for keyset paging (NodeSearchPage::cursor()): they include the order
+    // itself from KEYSET_ORDER_SHIFT, and whether they start after the cursor
+    static constexpr size_t KEYSET_CACHE_ID = 1 << 4;
+    static constexpr size_t KEYSET_CURSOR_CACHE_ID = 1 << 5;
+    static constexpr int KEYSET_ORDER_SHIFT = 6;
+
     // Iterate over a SQL query row by row and fill the map
     // Allow at least the following containers:
     bool processSqlQueryNodes(sqlite3_stmt *stmt, std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>>& nodes);
+    bool processSqlQueryNodeViews(sqlite3_stmt* stmt, std::vector<NodeView>& nodes);
+
+    // Bind and insert a node with the already prepared mStmtPutNode. 'nodeSerialized' is reused
+    // between calls to avoid reallocations when many nodes are inserted in a row
+    bool putNode(Node* node, std::string& nodeSerialized);
+    int preparePutNode();
+
+    // Run the getChildren() query selecting 'columns', and pass the statement to 'processRows',
+    // which reports the number of rows retrieved (it may be called more than once per page)
+    bool queryChildren(const mega::NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page,
+                       const char* columns, std::map<size_t, sqlite3_stmt*>& stmtCache, std::function<bool(sqlite3_stmt*, size_t&)> processRows);
 
     // if add a new sqlite3_stmt update finalise()
     sqlite3_stmt* mStmtPutNode = nullptr;
+    sqlite3_stmt* mStmtDelNode = nullptr;
     sqlite3_stmt* mStmtUpdateNode = nullptr;
     sqlite3_stmt* mStmtUpdateNodeAndFlags = nullptr;
     sqlite3_stmt* mStmtTypeAndSizeNode = nullptr;
@@ -190,7 +333,32 @@ private:
     sqlite3_stmt* mStmtChildrenFromType = nullptr;
 
     sqlite3_stmt* mStmtNumChildren = nullptr;
+    sqlite3_stmt* mStmtRootNodes = nullptr;
+
+    /** @deprecated */
+    sqlite3_stmt* mStmtNodesWithSharesOrLink = nullptr;
+
+    sqlite3_stmt* mStmtNumNodes = nullptr;
+    sqlite3_stmt* mStmtPutNodeName = nullptr;
+    sqlite3_stmt* mStmtDelNodeName = nullptr;
+    sqlite3_stmt* mStmtPutNodeTag = nullptr;
+    sqlite3_stmt* mStmtDelNodeTags = nullptr;
+    sqlite3_stmt* mStmtPutNodeDescription = nullptr;
+    sqlite3_stmt* mStmtDelNodeDescription = nullptr;
+    sqlite3_stmt* mStmtGetNodePath = nullptr;
+    sqlite3_stmt* mStmtPutNodePath = nullptr;
+    sqlite3_stmt* mStmtRebaseNodePaths = nullptr;
+    sqlite3_stmt* mStmtDelNodePath = nullptr;
+    sqlite3_stmt* mStmtNodeByMimeTypeInSubtree = nullptr;
+    sqlite3_stmt* mStmtVersions = nullptr;
+    sqlite3_stmt* mStmtPutChatGrant = nullptr;
+    sqlite3_stmt* mStmtDelChatGrant = nullptr;
+    sqlite3_stmt* mStmtChatGrants = nullptr;
+
+    /** @deprecated */
+    sqlite3_stmt* mStmtNodeByNameIndexed = nullptr;
     std::map<size_t, sqlite3_stmt*> mStmtGetChildren;
+    std::map<size_t, sqlite3_stmt*> mStmtGetChildrenViews;
     std::map<size_t, sqlite3_stmt*> mStmtSearchNodes;
 
     /** @deprecated */
@@ -348,6 +516,16 @@ public:
     static std::string get(int order, int sqlParamIndex);
     static size_t getId(int order);
 
+    // Keyset paging. The sort terms are plain columns instead of a CASE, so a composite
+    // index led by the same columns can return the rows in order without sorting them.
+    // "type DESC" isn't included: callers either prepend it or scan one type at a time.
+    static std::string getKeysetOrder(int order);
+
+    // Condition for the rows sorted after the key bound by bindKey() from 'sqlParamIndex'
+    // (3 consecutive parameters: attribute, name and nodehandle), ignoring the type
+    static std::string getAfterKey(int order, int sqlParamIndex);
+    static int bindKey(sqlite3_stmt* stmt, int order, int sqlParamIndex, const NodeView& key);
+
 private:
     enum {
         DEFAULT_ASC = 1, DEFAULT_DESC,
@@ -360,6 +538,9 @@ private:
 
     static std::bitset<2> getDescendingDirs(int order);
     static bool isDescOrder(const int order);
+
+    // column sorted by the attribute criterion, or nullptr if it's the name
+    static const char* getAttributeColumn(int order);
 };
 
 } // namespace
@@ -69,6 +69,45 @@ struct MEGA_API FileAttributeFetch
 
     FileAttributeFetch(handle, string, fatype, int);
 };
+
+// in-memory LRU cache of decrypted file attributes, up to a number of bytes
+class MEGA_API FileAttributeMemoryCache
+{
+public:
+    static constexpr size_t DEFAULT_MAX_SIZE = 32 * 1024 * 1024;
+
+    explicit FileAttributeMemoryCache(size_t maxSize = DEFAULT_MAX_SIZE);
+
+    // the attribute of the node, if cached for the same file attribute string
+    const string* get(handle h, fatype type, const string& fileattrstring);
+
+    // evicts the least recently used attributes beyond the limit
+    void put(handle h, fatype type, const string& fileattrstring, string data);
+
+    void clear();
+
+    size_t size() const { return mSize; }
+
+private:
+    using Key = std::pair<handle, fatype>;
+
+    struct Entry
+    {
+        string fileattrstring;
+        string data;
+        std::list<Key>::iterator lru;
+    };
+
+    void erase(std::map<Key, Entry>::iterator it);
+
+    std::map<Key, Entry> mEntries;
+
+    // most recently used first
+    std::list<Key> mLru;
+
+    size_t mSize = 0;
+    size_t mMaxSize;
+};
 } // namespace
 
 #endif
@@ -168,12 +168,14 @@ extern CodeCounter::ScopeStats g_compareUtfTimings;
 
 class MEGA_API LocalPath
 {
+public:
 #ifdef WIN32
     using string_type = wstring;
 #else // _WIN32
     using string_type = string;
 #endif // ! _WIN32
 
+private:
     // The actual path.  For windows, this is UTF16
     string_type localpath;
 
@@ -286,6 +288,13 @@ public:
     void appendWithSeparator(const LocalPath& additionalPath, bool separatorAlways);
     void prependWithSeparator(const LocalPath& additionalPath);
     LocalPath prependNewWithSeparator(const LocalPath& additionalPath) const;
+
+    // Makes this the path that prependWithSeparator() would build from a chain of names, leaf first,
+    // such as the names of a node and its ancestors, but allocated and written at once.
+    // 'forEachName' is called twice, with a callable to be passed every name of the chain, in that order.
+    template<typename ForEachName>
+    void assignFromLeafNames(ForEachName forEachName);
+
     void trimNonDriveTrailingSeparator();
     bool findNextSeparator(size_t& separatorBytePos) const;
     bool findPrevSeparator(size_t& separatorBytePos, const FileSystemAccess& fsaccess) const;
@@ -381,6 +390,46 @@ public:
     bool related(const LocalPath& other) const;
 };
 
+template<typename ForEachName>
+void LocalPath::assignFromLeafNames(ForEachName forEachName)
+{
+    isFromRoot = false;
+
+    // the length first, adding the separators that prependWithSeparator() would
+    size_t length = 0;
+    bool beginsWithSeparator = false;
+    forEachName([&](const LocalPath& name)
+    {
+        if (length && !beginsWithSeparator && !name.endsInSeparator())
+        {
+            ++length;
+            beginsWithSeparator = true;
+        }
+        length += name.localpath.size();
+        if (!name.localpath.empty())
+        {
+            beginsWithSeparator = name.localpath.front() == localPathSeparator;
+        }
+    });
+
+    // then the names, from the back
+    localpath.assign(length, separator_t());
+    size_t position = length;
+    forEachName([&](const LocalPath& name)
+    {
+        if (position < length && localpath[position] != localPathSeparator && !name.endsInSeparator())
+        {
+            localpath[--position] = localPathSeparator;
+        }
+        assert(name.localpath.size() <= position);
+        position -= name.localpath.size();
+        std::copy(name.localpath.begin(), name.localpath.end(), localpath.begin() + static_cast<std::ptrdiff_t>(position));
+        isFromRoot = name.isFromRoot;
+    });
+    assert(!position);
+    assert(invariant());
+}
+
 inline std::ostream& operator<<(std::ostream& os, const LocalPath& p)
 {
     return os << p.toPath(false);
@@ -755,6 +804,26 @@ struct MEGA_API FileAccess
     // Truncate a file.
     virtual bool ftruncate(m_off_t size = 0) = 0;
 
+    // Alignment of the data, length and position of the writes that can bypass the OS cache
+    static constexpr size_t DIRECT_WRITE_ALIGNMENT = 4096;
+
+    static bool isDirectWriteAligned(const byte* data, size_t len, m_off_t pos)
+    {
+        return !(reinterpret_cast<uintptr_t>(data) % DIRECT_WRITE_ALIGNMENT)
+            && !(len % DIRECT_WRITE_ALIGNMENT)
+            && !(static_cast<uint64_t>(pos) % DIRECT_WRITE_ALIGNMENT);
+    }
+
+    // For a file opened for writing: write the aligned pieces (see isDirectWriteAligned())
+    // straight to disk from now on, the others keep going through the OS cache.
+    // Returns false if the platform or the filesystem don't support it.
+    virtual bool enableDirectWrites() { return false; }
+
+    // For a file opened for writing: reserve the disk space for 'size' bytes, without changing the file size,
+    // so that pieces written out of order end up contiguous on disk.
+    // Returns false if the platform or the filesystem don't support it.
+    virtual bool fpreallocate(m_off_t) { return false; }
+
     FileAccess(Waiter *waiter);
     virtual ~FileAccess();
 
@@ -853,6 +922,27 @@ struct NotificationDeque : ThreadSafeDeque<Notification>
 // filesystem change notification, highly coupled to Syncs and LocalNodes.
 struct MEGA_API DirNotify
 {
+    // Position in the platform's filesystem event journal (only FSEvents has one for now).
+    // Lets a notifier replay the changes made while we weren't running.
+    struct ResumePoint
+    {
+        // Identifies the journal: event IDs from another journal are meaningless.
+        string mJournalID;
+
+        // Last event whose changes have been synced (0 if none).
+        uint64_t mEventID = 0;
+
+        bool operator==(const ResumePoint& rhs) const
+        {
+            return mJournalID == rhs.mJournalID && mEventID == rhs.mEventID;
+        }
+
+        bool operator!=(const ResumePoint& rhs) const
+        {
+            return !(*this == rhs);
+        }
+    }; // ResumePoint
+
     // Thread safe so that a separate thread can listen for filesystem notifications (for windows for now, maybe more platforms later)
     NotificationDeque fsEventq;
 
@@ -884,6 +974,19 @@ public:
     virtual ~DirNotify() {}
 
     bool empty();
+
+    // Journal position up to which events have been queued in fsEventq.
+    virtual ResumePoint resumePoint() const
+    {
+        return ResumePoint();
+    }
+
+    // True if the changes made since the resume point given upon creation are queued too,
+    // so the folders unchanged since then don't need to be scanned again.
+    virtual bool replaysChanges() const
+    {
+        return false;
+    }
 };
 #endif
 
@@ -912,7 +1015,11 @@ struct MEGA_API FileSystemAccess : public EventTrigger
 #ifdef ENABLE_SYNC
     // instantiate DirNotify object (default to periodic scanning handler if no
     // notification configured) with given root path
-    virtual DirNotify* newdirnotify(LocalNode& root, const LocalPath& rootPath, Waiter* waiter);
+    // resumeFrom is only used by platforms with an event journal
+    virtual DirNotify* newdirnotify(LocalNode& root,
+                                    const LocalPath& rootPath,
+                                    Waiter* waiter,
+                                    const DirNotify::ResumePoint& resumeFrom);
 #endif
 
     // Extracts the character encoded by the escape sequence %ab at s,
@@ -1017,12 +1124,20 @@ struct MEGA_API FileSystemAccess : public EventTrigger
     virtual bool initFilesystemNotificationSystem();
 #endif // ENABLE_SYNC
 
+    // If unfingerprinted is supplied, new or changed files are not fingerprinted here:
+    // their indices in results are appended to it so the caller can fingerprintScannedFile() them.
     virtual ScanResult directoryScan(const LocalPath& path,
                                      handle expectedFsid,
                                      map<LocalPath, FSNode>& known,
                                      std::vector<FSNode>& results,
                                      bool followSymLinks,
-                                     unsigned& nFingerprinted) = 0;
+                                     unsigned& nFingerprinted,
+                                     std::vector<size_t>* unfingerprinted = nullptr) = 0;
+
+    // Compute the CRC of a file reported by directoryScan().
+    // The fingerprint's size and mtime are the ones the scan saw.
+    // Returns false if the file couldn't be opened.
+    virtual bool fingerprintScannedFile(const LocalPath& path, FileFingerprint& fingerprint);
 
     // Retrieve the FSID of the item at the specified path.
     // UNDEF is returned if we cannot determine the item's FSID.
@@ -1187,7 +1302,9 @@ public:
             bool followSymlinks,
             LocalPath targetPath,
             handle expectedFsid,
-            map<LocalPath, FSNode>&& priorScanChildren);
+            map<LocalPath, FSNode>&& priorScanChildren,
+            uint64_t volume,
+            std::set<LocalPath>&& recomputeChildren);
 
         MEGA_DISABLE_COPY_MOVE(ScanRequest);
 
@@ -1226,6 +1343,10 @@ public:
         // Details the known children of mTarget.
         map<LocalPath, FSNode> mKnown;
 
+        // Children that may have changed without touching their size or mtime.
+        // Their fingerprints are never taken from the cache.
+        std::set<LocalPath> mRecompute;
+
         // Results of the scan.
         vector<FSNode> mResults;
 
@@ -1235,17 +1356,28 @@ public:
         // fsid that the target path should still referene
         handle mExpectedFsid;
 
+        // Volume (filesystem fingerprint) containing the target, selects the worker threads.
+        const uint64_t mVolume;
+
     }; // ScanRequest
 
     // For convenience.
     using RequestPtr = std::shared_ptr<ScanRequest>;
 
     // Issue a scan for the given target.
-    RequestPtr queueScan(LocalPath targetPath, handle expectedFsid, bool followSymlinks, map<LocalPath, FSNode>&& priorScanChildren, shared_ptr<Waiter> waiter);
+    // Scans of different volumes never wait for each other (ie. a slow network drive doesn't delay the local disk syncs).
+    RequestPtr queueScan(LocalPath targetPath, handle expectedFsid, bool followSymlinks, map<LocalPath, FSNode>&& priorScanChildren, shared_ptr<Waiter> waiter, uint64_t volume = 0, std::set<LocalPath>&& recomputeChildren = {});
 
     // Track performance (debug only)
     static CodeCounter::ScopeStats syncScanTime;
 
+    // Scanning is I/O bound: several folders of the same volume can be listed and fingerprinted in parallel.
+    // This is also the limit of files of one volume being read for fingerprints at the same time.
+    static constexpr size_t NUM_THREADS_PER_VOLUME = 4;
+
+    // Entries kept by the fingerprint cache.
+    static constexpr size_t MAX_CACHED_FINGERPRINTS = 16384;
+
 private:
        // Convenience.
     using ScanRequestPtr = std::shared_ptr<ScanRequest>;
@@ -1254,7 +1386,8 @@ private:
     class Worker
     {
     public:
-        Worker(size_t numThreads = 1);
+        // Threads are started per volume, when its first request is queued.
+        Worker(size_t numThreadsPerVolume = NUM_THREADS_PER_VOLUME);
 
         ~Worker();
 
@@ -1264,24 +1397,96 @@ private:
         void queue(ScanRequestPtr request);
 
     private:
+        // Files of one scan still to be fingerprinted, shared out between the volume's threads.
+        struct FingerprintBatch
+        {
+            FingerprintBatch(ScanRequestPtr request, std::vector<size_t>&& indices);
+
+            MEGA_DISABLE_COPY_MOVE(FingerprintBatch);
+
+            // Scan whose results are being fingerprinted.
+            const ScanRequestPtr mRequest;
+
+            // Indices of the files in mRequest->mResults.
+            const std::vector<size_t> mIndices;
+
+            // Next index to be claimed by a thread.
+            std::atomic<size_t> mNext;
+
+            // How many files could be opened and fingerprinted.
+            std::atomic<unsigned> mFingerprinted;
+
+            // How many claimed files are finished, guarded by mDoneLock.
+            size_t mDone = 0;
+            std::mutex mDoneLock;
+            std::condition_variable mDoneNotifier;
+        };
+
+        // Something for a thread to do: a scan, or helping with another thread's fingerprints.
+        // Neither means terminate.
+        struct Task
+        {
+            ScanRequestPtr mScan;
+            std::shared_ptr<FingerprintBatch> mFingerprints;
+        };
+
+        // Recently computed fingerprints by volume, fsid, size and mtime.
+        // Files moved to another folder, or rescanned after their prior scan was discarded, aren't read again.
+        class FingerprintCache
+        {
+        public:
+            void add(uint64_t volume, const FSNode& node);
+
+            // Fills in the node's fingerprint if there is a match.
+            bool lookup(uint64_t volume, FSNode& node);
+
+        private:
+            using Key = std::tuple<uint64_t, handle, m_off_t, m_time_t>;
+
+            std::map<Key, FileFingerprint> mEntries;
+
+            // Keys in insertion order, oldest are evicted first.
+            std::deque<Key> mOrder;
+
+            std::mutex mLock;
+        };
+
+        // Requests and threads serving one volume.
+        struct Volume
+        {
+            // Pending scan requests and fingerprint batches.
+            std::deque<Task> mPending;
+
+            // Signalled when the above changes.
+            std::condition_variable mPendingNotifier;
+
+            // Worker threads.
+            std::vector<std::thread> mThreads;
+        };
+
         // Thread entry point.
-        void loop();
+        void loop(Volume& volume);
 
         // Processes a scan request.
-        ScanResult scan(ScanRequestPtr request, unsigned& nFingerprinted);
+        // New or changed files are fingerprinted together with the volume's idle threads, if any.
+        ScanResult scan(ScanRequestPtr request, unsigned& nFingerprinted, Volume* volume);
 
-        // Filesystem access.
+        // Fingerprints the batch's files until there are none left to claim.
+        void fingerprint(FingerprintBatch& batch);
+
+        // Filesystem access (directoryScan() keeps no state, so it's shared by all threads).
         std::unique_ptr<FileSystemAccess> mFsAccess;
 
-        // Pending scan requests.
-        std::deque<ScanRequestPtr> mPending;
+        const size_t mNumThreadsPerVolume;
+
+        // Volumes seen so far.
+        std::map<uint64_t, std::unique_ptr<Volume>> mVolumes;
 
         // Guards access to the above.
         std::mutex mPendingLock;
-        std::condition_variable mPendingNotifier;
 
-        // Worker threads.
-        std::vector<std::thread> mThreads;
+        // Shared by all volumes and threads (it has its own lock).
+        FingerprintCache mFingerprintCache;
     }; // Worker
 
     // How many services are currently active.
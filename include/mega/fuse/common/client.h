@@ -133,6 +133,16 @@ public:
     // Query who a node's parent is.
     virtual NodeHandle parentHandle(NodeHandle handle) const = 0;
 
+    // Download a range of a file's content from the cloud.
+    virtual void partialDownload(PartialDownloadCallback callback,
+                                 NodeHandle handle,
+                                 m_off_t offset,
+                                 m_off_t length) = 0;
+
+    ErrorOr<std::string> partialDownload(NodeHandle handle,
+                                         m_off_t offset,
+                                         m_off_t length);
+
     // What permissions are applicable to a node?
     virtual accesslevel_t permissions(NodeHandle handle) const = 0;
 
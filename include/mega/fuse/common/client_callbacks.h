@@ -1,6 +1,7 @@
 #pragma once
 
 #include <functional>
+#include <string>
 #include <utility>
 
 #include <mega/fuse/common/bind_handle_forward.h>
@@ -30,6 +31,9 @@ using MakeDirectoryCallback =
 using MoveCallback =
   std::function<void(Error)>;
 
+using PartialDownloadCallback =
+  std::function<void(ErrorOr<std::string>)>;
+
 using RemoveCallback =
   std::function<void(Error)>;
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+
 namespace mega
 {
 namespace fuse
@@ -9,6 +11,15 @@ constexpr auto FilesystemID = 0x4d454741ul;
 constexpr auto BlockSize = 4096u;
 constexpr auto MaxNameLength = 255u;
 
+// How many transactions can be batched together?
+constexpr auto DatabaseBatchLength = 1024u;
+
+// How long can a batch of transactions remain uncommitted?
+constexpr auto DatabaseBatchDelay = std::chrono::milliseconds(250);
+
+// How many node events are processed before yielding to other requests?
+constexpr auto NodeEventBatchSize = 256u;
+
 } // fuse
 } // mega
 
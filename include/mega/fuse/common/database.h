@@ -1,8 +1,11 @@
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
 #include <string>
 #include <mutex>
+#include <thread>
 
 #include <mega/fuse/common/badge_forward.h>
 #include <mega/fuse/common/database_forward.h>
@@ -31,11 +34,50 @@ namespace detail
 class Database
   : public Lockable<Database>
 {
+    // Commit the current batch, if any.
+    std::string commit();
+
+    // Commits batches that have been left open for too long.
+    void committer();
+
     std::string execute(const char* statement);
 
+    // Stop the committer thread, if it's running.
+    void stop();
+
     sqlite3* mDB;
     std::string mPath;
 
+    // Is a batch of transactions open?
+    bool mBatched;
+
+    // How many transactions are active?
+    std::size_t mDepth;
+
+    // Should the batch be committed as soon as possible?
+    bool mFlush;
+
+    // How many transactions have been committed to the current batch?
+    std::size_t mLength;
+
+    // When was the current batch opened?
+    std::chrono::steady_clock::time_point mOpened;
+
+    // Signalled when a batch is opened or we're being destroyed.
+    std::condition_variable mCommitterCV;
+
+    // Serializes access to the committer's state.
+    std::mutex mCommitterLock;
+
+    // Is there a batch for the committer to look after?
+    bool mPending;
+
+    // Has the committer been asked to terminate?
+    bool mTerminate;
+
+    // Commits batches left open for too long.
+    std::thread mCommitterThread;
+
 public:
     Database(const LocalPath& path);
 
@@ -43,8 +85,19 @@ public:
 
     ~Database();
 
+    // Called when a transaction is started.
+    std::string begin(Badge<Transaction> badge);
+
+    // Called when a transaction has been committed or rolled back.
+    std::string end(Badge<Transaction> badge,
+                    const char* statement,
+                    bool committed);
+
     std::string execute(Badge<Transaction> badge, const char* statement);
 
+    // Make sure all committed transactions are on disk.
+    void flush();
+
     Query query();
 
     Transaction transaction();
@@ -40,6 +40,9 @@ public:
     // Retrieve a list of this directory's children.
     InodeRefVector children() const;
 
+    // Retrieve a list of this directory's children and their descriptions.
+    InodeRefVector children(InodeInfoVector& infos) const;
+
     // Return a specialized reference to this directory.
     DirectoryInodeRef directory() override;
 
@@ -1,19 +1,29 @@
 #pragma once
 
 #include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <utility>
 
+#include <mega/fuse/common/activity_monitor.h>
 #include <mega/fuse/common/bind_handle_forward.h>
 #include <mega/fuse/common/client_forward.h>
 #include <mega/fuse/common/error_or_forward.h>
+#include <mega/fuse/common/file_cache_flags.h>
 #include <mega/fuse/common/file_cache_forward.h>
+#include <mega/fuse/common/file_cache_statistics_forward.h>
 #include <mega/fuse/common/file_extension_db_forward.h>
 #include <mega/fuse/common/file_info_forward.h>
 #include <mega/fuse/common/file_inode_forward.h>
 #include <mega/fuse/common/file_io_context_forward.h>
+#include <mega/fuse/common/inode_db_forward.h>
 #include <mega/fuse/common/inode_id_forward.h>
 #include <mega/fuse/common/lockable.h>
 #include <mega/fuse/common/mount_forward.h>
 #include <mega/fuse/common/task_executor_forward.h>
+#include <mega/fuse/common/task_queue.h>
 #include <mega/fuse/platform/service_context_forward.h>
 
 #include <mega/filesystem.h>
@@ -34,6 +44,16 @@ class FileCache
 {
     friend class FileIOContext;
     friend class FileInfo;
+    friend class InodeDB;
+
+    // Describes a file that's in the cache but not in use.
+    using Entry = std::pair<InodeID, m_off_t>;
+    using EntryList = std::list<Entry>;
+    using EntryListIterator = EntryList::iterator;
+    using EntryPositionMap = std::map<InodeID, EntryListIterator>;
+
+    // Start evicting files if the cache has exceeded its budget.
+    void checkBudget(FileCacheLock& lock);
 
     // Create a new file description based on the file at the specified path.
     //
@@ -47,6 +67,24 @@ class FileCache
                                 FileAccessSharedPtr* fileAccess,
                                 bool create);
 
+    // Evict files until the cache is within its budget.
+    void evict(const Task& task);
+
+    // Try and evict an inode's content from the cache.
+    //
+    // Called by InodeDB once it's determined that the inode's content is
+    // safely in the cloud and that the inode isn't in memory.
+    bool evict(const FileExtension& extension, InodeID id);
+
+    // Called when a periodic flush on a mount has completed.
+    void flushCompleted(NodeHandle mount);
+
+    // Try and begin a periodic flush on a mount.
+    //
+    // Returns false if the mount already has as many periodic flushes in
+    // progress as the service permits.
+    bool flushStarting(NodeHandle mount);
+
     // Get a reference to an inode's file info.
     //
     // If no info is currently associated with the specified inode,
@@ -56,12 +94,52 @@ class FileCache
                      const FileAccess& fileAccess,
                      InodeID id);
 
+    // Has the cache exceeded its budget?
+    bool overBudget(const FileCacheLock& lock) const;
+
+    // Signal that a file is in use or otherwise can't be evicted.
+    void pin(InodeID id, const FileCacheLock& lock) const;
+
     // Remove context from the index.
     void remove(const FileIOContext& context, FileCacheLock lock);
 
     // Remove info from the index.
     void remove(const FileInfo& info, FileCacheLock lock);
 
+    // How many bytes of content are in the cache?
+    std::uint64_t size(const FileCacheLock& lock) const;
+
+    // Signal that a file is no longer in use and can be evicted.
+    void unpin(InodeID id, m_off_t size, const FileCacheLock& lock);
+
+    // Lets cancel() wait for any eviction in progress.
+    ActivityMonitor mActivities;
+
+    // How many files and bytes have been evicted?
+    std::size_t mEvictedFiles;
+    std::uint64_t mEvictedSize;
+
+    // Are we currently evicting files?
+    bool mEvicting;
+
+    // Evicts files when the cache exceeds its budget.
+    Task mEvictionTask;
+
+    // Files that can be evicted, least recently used first.
+    mutable EntryList mEntries;
+
+    // Tracks where each file can be found in mEntries.
+    mutable EntryPositionMap mEntryByID;
+
+    // How large a budget has the cache been given?
+    FileCacheFlags mFlags;
+
+    // How many periodic flushes are in progress on each mount?
+    std::map<NodeHandle, std::size_t> mFlushesByMount;
+
+    // Serializes access to mFlushesByMount.
+    std::mutex mFlushesLock;
+
     // Tracks which context is associated with what inode.
     mutable ToFileIOContextPtrMap<InodeID> mContextByID;
 
@@ -71,8 +149,12 @@ class FileCache
     // Signalled when a context or info instance is removed.
     std::condition_variable_any mRemoved;
 
+    // How many bytes of content are described by mEntries?
+    mutable std::uint64_t mUnpinnedSize;
+
 public:
-    explicit FileCache(platform::ServiceContext& context);
+    FileCache(const FileCacheFlags& flags,
+              platform::ServiceContext& context);
 
     ~FileCache();
 
@@ -104,6 +186,12 @@ public:
     // Who do we call when we want to execute something on another thread?
     TaskExecutor& executor() const;
 
+    // Update the cache's budget.
+    void flags(const FileCacheFlags& flags);
+
+    // Query the cache's budget.
+    FileCacheFlags flags() const;
+
     // Flush zero or more modified inodes to the cloud.
     void flush(const Mount& mount, FileInodeRefVector inodes);
 
@@ -119,9 +207,15 @@ public:
     // Where is an inode's local state located?
     LocalPath path(const FileExtension& extension, InodeID id) const;
 
+    // Where is an inode's partially downloaded content located?
+    LocalPath partialPath(InodeID id, NodeHandle handle) const;
+
     // Remove an inode's content from the cache.
     void remove(const FileExtension& extension, InodeID id);
 
+    // Describe the state of the cache.
+    FileCacheStatistics statistics() const;
+
     // Where is the cache storing its data?
     const LocalPath mCachePath;
 
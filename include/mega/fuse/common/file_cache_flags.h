@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <mega/fuse/common/file_cache_flags_forward.h>
+
+namespace mega
+{
+namespace fuse
+{
+
+struct FileCacheFlags
+{
+    // How many files may the cache store?
+    //
+    // Zero means the cache may store any number of files.
+    std::size_t mMaxFiles = 0u;
+
+    // How many bytes of content may the cache store?
+    //
+    // Zero means the cache may store any amount of content.
+    std::uint64_t mMaxSize = 0u;
+}; // FileCacheFlags
+
+} // fuse
+} // mega
+
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <mega/fuse/common/file_cache_statistics_forward.h>
+
+namespace mega
+{
+namespace fuse
+{
+
+struct FileCacheStatistics
+{
+    // How many files have been evicted from the cache?
+    std::size_t mEvictedFiles = 0u;
+
+    // How many bytes of content have been evicted from the cache?
+    std::uint64_t mEvictedSize = 0u;
+
+    // How many files are in the cache?
+    std::size_t mFiles = 0u;
+
+    // How many of those files are in use and can't be evicted?
+    std::size_t mPinnedFiles = 0u;
+
+    // How many bytes of content are in the cache?
+    std::uint64_t mSize = 0u;
+}; // FileCacheStatistics
+
+} // fuse
+} // mega
+
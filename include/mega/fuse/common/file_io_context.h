@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <cstddef>
 #include <mutex>
 #include <string>
@@ -53,9 +54,21 @@ class FileIOContext
     // Convenience.
     using FlushContextPtr = std::shared_ptr<FlushContext>;
 
+    // Serves reads from a sparse copy of the file's content.
+    class PartialContext;
+
+    // Convenience.
+    using PartialContextPtr = std::shared_ptr<PartialContext>;
+
+    // How long should a throttled flush wait before trying again?
+    static constexpr auto FlushRetryDelay = std::chrono::seconds(1);
+
     // Create the file.
     ErrorOr<FileAccessSharedPtr> create();
 
+    // Compute a digest of the file's current content.
+    ErrorOr<std::string> digest() const;
+
     // Download the file from the cloud.
     ErrorOr<FileAccessSharedPtr> download(const Mount& mount);
 
@@ -73,11 +86,16 @@ class FileIOContext
 
     // Called when it's time to perform a queued flush.
     void onPeriodicFlush(FileIOContextRef& context,
-                         m_time_t lastModified,
                          NodeHandle mountHandle,
                          LocalPath& mountPath,
                          const Task& task);
 
+    // Queue a periodic flush to be performed at some point in the future.
+    void queueFlush(FileIOContextRef context,
+                    NodeHandle mountHandle,
+                    LocalPath mountPath,
+                    std::chrono::steady_clock::time_point when);
+
     // Open the file for IO.
     auto open(FileIOContextLock& lock,
              const Mount& mount,
@@ -89,6 +107,15 @@ class FileIOContext
               m_off_t hint = -1)
       -> ErrorOr<FileAccessSharedPtr>;
 
+    // Read data from the cloud, block by block, as it is needed.
+    ErrorOr<std::string> partialRead(m_off_t offset,
+                                     unsigned int size);
+
+    // Called by manualFlush(...) when the cloud already has our content.
+    //
+    // Updates the cloud's modification time if necessary.
+    Error unchangedFlush(std::unique_lock<std::mutex>& flushLock);
+
     // What file does this entry represent?
     FileInodeRef mFile;
 
@@ -107,12 +134,27 @@ class FileIOContext
     // State required for the current flush, if any.
     FlushContextPtr mFlushContext;
 
+    // Digest of the content we last flushed to the cloud, if any.
+    std::string mFlushedDigest;
+
+    // Modification time of the content we last flushed to the cloud.
+    m_time_t mFlushedModified;
+
     // Serializes access to mFlush* members.
     std::mutex mFlushLock;
 
     // True if we need to flush this file's content to the cloud.
     bool mFlushNeeded;
 
+    // Sparse copy of the file's content used until it's downloaded.
+    PartialContextPtr mPartialContext;
+
+    // Serializes access to mPartialContext.
+    std::mutex mPartialLock;
+
+    // When was the file last modified?
+    std::chrono::steady_clock::time_point mModifiedAt;
+
     // Represents a queued periodic flush, if any.
     Task mPeriodicFlushTask;
 
@@ -156,6 +198,16 @@ public:
                               m_off_t offset,
                               unsigned int size);
 
+    // Read data from the file without buffering it when possible.
+    //
+    // If the file's content is present on disk, reader is passed its
+    // location and the clamped range so that it can transfer the data
+    // itself. In that case, an empty buffer is returned on success.
+    ErrorOr<std::string> read(const Mount& mount,
+                              m_off_t offset,
+                              unsigned int size,
+                              const LocalReader& reader);
+
     // Increment this instance's reference count.
     void ref(RefBadge badge);
 
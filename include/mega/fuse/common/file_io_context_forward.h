@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -8,6 +9,8 @@
 #include <mega/fuse/common/lock_forward.h>
 #include <mega/fuse/common/ref_forward.h>
 
+#include <mega/types.h>
+
 namespace mega
 {
 namespace fuse
@@ -23,6 +26,12 @@ using FileIOContextRef = Ref<FileIOContext>;
 
 using FileIOContextRefVector = std::vector<FileIOContextRef>;
 
+// Transfers a range of a file's local content.
+using LocalReader =
+  std::function<Error(const LocalPath& path,
+                      m_off_t offset,
+                      unsigned int size)>;
+
 template<typename T>
 using ToFileIOContextPtrMap = std::map<T, FileIOContextPtr>;
 
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <map>
 #include <mutex>
 #include <string>
@@ -20,6 +22,7 @@
 #include <mega/fuse/common/inode_db_forward.h>
 #include <mega/fuse/common/inode_forward.h>
 #include <mega/fuse/common/inode_id_forward.h>
+#include <mega/fuse/common/inode_info_forward.h>
 #include <mega/fuse/common/lockable.h>
 #include <mega/fuse/common/node_event_forward.h>
 #include <mega/fuse/common/node_event_observer.h>
@@ -168,9 +171,6 @@ class InodeDB final
         // What is the next free inode ID?
         Query mGetNextInodeID;
 
-        // Increment the next free inode ID.
-        Query mIncrementNextInodeID;
-
         // Remove an inode specified by ID.
         Query mRemoveInodeByID;
 
@@ -185,6 +185,9 @@ class InodeDB final
 
         // Set an inode's name and parent handle.
         Query mSetNameParentHandleByID;
+
+        // Advance the next free inode ID.
+        Query mSetNextInodeID;
     }; // Queries
 
     // Add a new inode to the index.
@@ -223,7 +226,12 @@ class InodeDB final
                       NodeHandle parentHandle);
 
     // Retrieve a reference to a directory's children.
-    InodeRefVector children(const DirectoryInode& parent) const;
+    //
+    // If infos is provided, it receives a description of each child as
+    // reported by the client. Children with local state are described
+    // by an invalid InodeInfo and should be asked for their description.
+    InodeRefVector children(const DirectoryInode& parent,
+                            InodeInfoVector* infos = nullptr) const;
 
     // Are we discarding node events?
     bool discard() const;
@@ -331,6 +339,12 @@ class InodeDB final
     // Whether we should discard node events.
     bool mDiscard;
 
+    // What ID should we assign to the next new file?
+    //
+    // Seeded from the database when we're constructed so that allocating
+    // an ID doesn't require us to query the database first.
+    std::atomic<std::uint64_t> mNextInodeID;
+
     // What queries do we perform?
     mutable Queries mQueries;
 
@@ -368,6 +382,12 @@ public:
     // Discard node events.
     void discard(bool discard);
 
+    // Try and evict a file's content from the file cache.
+    //
+    // Content is only evicted if the file isn't in memory and
+    // its content is known to be safely stored in the cloud.
+    bool evict(InodeID id);
+
     // Check if an inode is in the database.
     bool exists(InodeID id) const;
 
@@ -44,6 +44,12 @@ class Mount
     // Specifies how the mount should behave.
     MountFlags mFlags;
 
+    // Tracks how often each inode has been accessed via this mount.
+    FromInodeIDMap<std::size_t> mHits;
+
+    // Serializes access to mHits.
+    std::mutex mHitsLock;
+
     // Protects access to this mount's flags.
     mutable std::mutex mLock;
 
@@ -74,6 +80,12 @@ protected:
     void unpin(InodeRef inode, std::size_t num);
 
 public:
+    // Called when an inode has been opened via this mount.
+    //
+    // Used to determine which inodes should be prefetched the next time
+    // this mount is enabled.
+    void accessed(InodeID id);
+
     // Add a context to our context set.
     void contextAdded(platform::ContextBadge badge,
                       platform::Context& context);
@@ -43,9 +43,18 @@ class MountDB
     {
         Queries(Database& database);
 
+        // Add a hot inode to the database.
+        Query mAddHotInode;
+
         // Add a mount to the database.
         Query mAddMount;
 
+        // Age the hit counts of a mount's hot inodes.
+        Query mAgeHotInodesByPath;
+
+        // Get a mount's hottest inodes.
+        Query mGetHotInodesByPath;
+
         // Get a mount by path.
         Query mGetMountByPath;
 
@@ -67,6 +76,12 @@ class MountDB
         // What mounts should be enabled at startup?
         Query mGetMountsEnabledAtStartup;
 
+        // Increase a hot inode's hit count.
+        Query mIncrementHotInodeHits;
+
+        // Discard all but a mount's hottest inodes.
+        Query mPruneHotInodesByPath;
+
         // Remove a specified mount.
         Query mRemoveMountByPath;
 
@@ -80,6 +95,9 @@ class MountDB
         Query mSetMountStartupStateByPath;
     }; // Queries
 
+    // How many hot inodes do we remember for each mount?
+    static constexpr std::size_t MaxHotInodes = 256u;
+
     // Checks whether info is a valid description of a mount.
     MountResult check(const MountInfo& info);
 
@@ -93,6 +111,9 @@ class MountDB
     // Enable all persistent mounts.
     void enable();
 
+    // Retrieve a mount's hottest inodes.
+    InodeIDVector hotInodes(const LocalPath& path, std::size_t count) const;
+
     // Invalidate information cached by all mounts.
     void invalidate();
 
@@ -188,9 +209,16 @@ public:
     // Retrieve a list of known mounts.
     MountInfoVector get(bool enabled) const;
 
+    // Record how often a mount's inodes have been accessed.
+    void hotInodes(const LocalPath& path,
+                   const FromInodeIDMap<std::size_t>& hits);
+
     // Query which path a named mount is associated with.
     NormalizedPathVector paths(const std::string& name) const;
 
+    // Load a mount's hottest inodes into memory.
+    void prefetch(const LocalPath& path);
+
     // Prune stale mount entries from the database.
     MountResult prune();
 
@@ -6,6 +6,7 @@
 
 #include <mega/fuse/common/client_forward.h>
 #include <mega/fuse/common/error_or_forward.h>
+#include <mega/fuse/common/file_cache_statistics_forward.h>
 #include <mega/fuse/common/inode_info_forward.h>
 #include <mega/fuse/common/log_level_forward.h>
 #include <mega/fuse/common/mount_flags_forward.h>
@@ -73,6 +74,9 @@ public:
     // Execute a function on some thread.
     Task execute(std::function<void(const Task&)> function);
 
+    // Describe the state of the file cache.
+    FileCacheStatistics fileCacheStatistics() const;
+
     // Update a mount's flags.
     MountResult flags(const NormalizedPath& path,
                       const MountFlags& flags);
@@ -4,6 +4,7 @@
 
 #include <mega/fuse/common/client_forward.h>
 #include <mega/fuse/common/error_or_forward.h>
+#include <mega/fuse/common/file_cache_statistics_forward.h>
 #include <mega/fuse/common/inode_info_forward.h>
 #include <mega/fuse/common/mount_flags_forward.h>
 #include <mega/fuse/common/mount_info_forward.h>
@@ -68,6 +69,9 @@ public:
     // Execute a function on some thread.
     virtual Task execute(std::function<void(const Task&)> function) = 0;
 
+    // Describe the state of the file cache.
+    virtual FileCacheStatistics fileCacheStatistics() const = 0;
+
     // Update a mount's flags.
     virtual MountResult flags(const LocalPath& path,
                               const MountFlags& flags) = 0;
@@ -3,6 +3,7 @@
 #include <cstddef>
 #include <chrono>
 
+#include <mega/fuse/common/file_cache_flags.h>
 #include <mega/fuse/common/inode_cache_flags.h>
 #include <mega/fuse/common/log_level.h>
 #include <mega/fuse/common/service_flags_forward.h>
@@ -18,9 +19,17 @@ struct ServiceFlags
     // How long should we wait before we flush after a write?
     std::chrono::seconds mFlushDelay = std::chrono::seconds(4);
 
+    // Controls how much content the service may cache.
+    FileCacheFlags mFileCacheFlags;
+
     // Controls how the service caches inodes.
     InodeCacheFlags mInodeCacheFlags;
 
+    // How many periodic flushes may be in progress on a mount at once?
+    //
+    // A value of zero means that there's no limit.
+    std::size_t mMaxConcurrentFlushes = 4u;
+
     // How verbose should FUSE's logs be?
     LogLevel mLogLevel = LOG_LEVEL_INFO;
 
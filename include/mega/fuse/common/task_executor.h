@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <chrono>
 #include <condition_variable>
 #include <list>
@@ -8,6 +9,7 @@
 
 #include <mega/fuse/common/task_executor_flags.h>
 #include <mega/fuse/common/task_executor.h>
+#include <mega/fuse/common/task_priority.h>
 #include <mega/fuse/common/task_queue.h>
 
 namespace mega
@@ -24,9 +26,18 @@ class TaskExecutor
     using WorkerPtr = std::unique_ptr<Worker>;
     using WorkerList = std::list<WorkerPtr>;
 
+    // Can a worker begin executing a task of the specified priority?
+    //
+    // Tasks of lower priority are never allowed to occupy every worker so
+    // that they can't delay more urgent tasks such as lookups.
+    bool eligible(TaskPriority priority) const;
+
     // Tracks how many workers are waiting for work.
     std::size_t mAvailableWorkers;
 
+    // Tracks how many workers are executing tasks of each priority.
+    std::array<std::size_t, TASK_PRIORITY_ALL> mBusyWorkers;
+
     // Signalled when we want our worker's attention.
     std::condition_variable mCV;
 
@@ -36,8 +47,8 @@ class TaskExecutor
     // Serializes access to instance members.
     mutable std::mutex mLock;
 
-    // Tracks what tasks we've queued.
-    TaskQueue mTaskQueue;
+    // Tracks what tasks we've queued, by priority.
+    std::array<TaskQueue, TASK_PRIORITY_ALL> mTaskQueues;
 
     // Lets the workers know when they should terminate.
     bool mTerminating;
@@ -53,26 +64,31 @@ public:
     // Execute a task at some point in time.
     Task execute(std::function<void(const Task&)> function,
                  std::chrono::steady_clock::time_point when,
-                 bool spawnWorker);
+                 bool spawnWorker,
+                 TaskPriority priority = TASK_PRIORITY_METADATA);
 
     // Execute a task at some point in the future.
     template<typename Rep, typename Period>
     Task execute(std::function<void(const Task&)> function,
                  std::chrono::duration<Rep, Period> when,
-                 bool spawnWorker)
+                 bool spawnWorker,
+                 TaskPriority priority = TASK_PRIORITY_METADATA)
     {
         return execute(std::move(function),
                        std::chrono::steady_clock::now() + when,
-                       spawnWorker);
+                       spawnWorker,
+                       priority);
     }
 
     // Execute a task now.
     Task execute(std::function<void(const Task&)> function,
-                 bool spawnWorker)
+                 bool spawnWorker,
+                 TaskPriority priority = TASK_PRIORITY_METADATA)
     {
         return execute(std::move(function),
                        std::chrono::steady_clock::now(),
-                       spawnWorker);
+                       spawnWorker,
+                       priority);
     }
 
     // Update this executor's flags.
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <mega/fuse/common/task_priority_forward.h>
+
+namespace mega
+{
+namespace fuse
+{
+
+// Describes how urgently a task should be executed.
+//
+// Ready tasks are always executed in order of priority.
+enum TaskPriority : unsigned int
+{
+    // Latency-sensitive operations such as lookups and attribute queries.
+    TASK_PRIORITY_METADATA,
+    // Operations that transfer file content such as reads and writes.
+    TASK_PRIORITY_DATA,
+    // Long-running operations such as flushes and uploads.
+    TASK_PRIORITY_FLUSH
+}; // TaskPriority
+
+constexpr auto TASK_PRIORITY_ALL = TASK_PRIORITY_FLUSH + 1;
+
+} // fuse
+} // mega
+
@@ -0,0 +1,12 @@
+#pragma once
+
+namespace mega
+{
+namespace fuse
+{
+
+enum TaskPriority : unsigned int;
+
+} // fuse
+} // mega
+
@@ -22,6 +22,8 @@
 #ifndef GFX_H
 #define GFX_H 1
 
+#include <condition_variable>
+#include <functional>
 #include <mutex>
 
 #include "mega/types.h"
@@ -55,6 +57,9 @@ public:
 
     // resulting images
     vector<string *> images;
+
+    // of the file, to look the images up in the GfxCache (if it's valid)
+    FileFingerprint fingerprint;
 };
 
 class MEGA_API GfxJobQueue
@@ -62,11 +67,63 @@ class MEGA_API GfxJobQueue
     protected:
         std::deque<GfxJob *> jobs;
         std::mutex mutex;
+        std::condition_variable cv;
+        bool stopped = false;
 
     public:
         GfxJobQueue();
+
+        // jobs of uploads go ahead of the ones for existing nodes, in the order they are pushed
         void push(GfxJob *job);
         GfxJob *pop();
+
+        // blocks until there is a job, or returns NULL once the queue is stopped
+        GfxJob *waitpop();
+        void stop();
+};
+
+// Generated images kept on disk by the fingerprint of their files, so that files uploaded
+// several times (to several places, again after a sync reset...) are processed only once.
+// The least recently used ones are removed to keep it within its size. Thread safe
+class MEGA_API GfxCache
+{
+public:
+    static constexpr m_off_t DEFAULT_MAX_SIZE = 100 * 1024 * 1024;
+
+    GfxCache(const LocalPath& folder, m_off_t maxSize = DEFAULT_MAX_SIZE);
+
+    // the image of that type (a GfxProc::meta_t) for the file, if it's in the cache
+    bool get(const FileFingerprint& fingerprint, fatype type, string& image);
+
+    void put(const FileFingerprint& fingerprint, fatype type, const string& image);
+
+    // of the images in the cache
+    m_off_t size();
+
+private:
+    struct Entry
+    {
+        m_off_t size;
+        m_time_t lastUse;
+    };
+
+    static string entryName(const FileFingerprint& fingerprint, fatype type);
+
+    LocalPath entryPath(const string& name) const;
+
+    // the entries already in the folder, the first time it's used
+    void load();
+
+    // the least recently used entries, until it fits in mMaxSize
+    void evict();
+
+    std::mutex mMutex;
+    std::unique_ptr<FileSystemAccess> mFsAccess;
+    LocalPath mFolder;
+    m_off_t mMaxSize;
+    m_off_t mSize = 0;
+    bool mLoaded = false;
+    std::map<string, Entry> mEntries;
 };
 
 class MEGA_API GfxDimension
@@ -111,6 +168,20 @@ public:
     // list of supported video extensions (NULL if no pre-filtering is needed)
     virtual const char* supportedvideoformats() = 0;
 
+    // another instance for a concurrent processing thread,
+    // NULL if all of them have to share this one
+    virtual std::unique_ptr<IGfxProvider> clone() const { return nullptr; }
+
+    // Generates the images of several files, calling onImages with the index of each one as they are ready
+    // (in any order, once for each file). Providers that save per call overhead with it override it
+    // (together with maxBatchSize()), by default the files are processed one after another
+    using FileDimensions = std::pair<LocalPath, std::vector<GfxDimension>>;
+    using ImagesCallback = std::function<void(size_t, std::vector<std::string>&&)>;
+    virtual void generateImagesBatch(const std::vector<FileDimensions>& files, const ImagesCallback& onImages);
+
+    // how many files it is worth passing to generateImagesBatch() at once
+    virtual size_t maxBatchSize() const { return 1; }
+
     static std::unique_ptr<IGfxProvider> createInternalGfxProvider();
 };
 
@@ -137,6 +208,9 @@ private:
     int width() { return w; }
     int height() { return h; }
 
+    // whether a w*h bitmap has to be upscaled for the dimension
+    static bool upscales(int w, int h, const GfxDimension& dimension);
+
 protected:
     // coordinate transformation
     static void transform(int&, int&, int&, int&, int&, int&);
@@ -147,26 +221,36 @@ protected:
 // bitmap graphics processor
 class MEGA_API GfxProc
 {
-    bool finished = false;
-    WAIT_CLASS waiter;
+    // processing thread, with its own provider or NULL to share mGfxProvider
+    struct Worker
+    {
+        GfxProc* gfxProc;
+        std::unique_ptr<IGfxProvider> provider;
+        THREAD_CLASS thread;
+    };
+
     std::mutex mutex;
-    THREAD_CLASS thread;
-    bool threadstarted = false;
+    std::vector<std::unique_ptr<Worker>> mWorkers;
     SymmCipher mCheckEventsKey;
     GfxJobQueue requests;
     GfxJobQueue responses;
     std::unique_ptr<IGfxProvider>  mGfxProvider;
 
     static void *threadEntryPoint(void *param);
-    void loop();
+    void loop(IGfxProvider* provider);
 
     std::vector<GfxDimension> getJobDimensions(GfxJob *job);
 
-    // Caller should give dimensions from high resolution to low resolution
+    // Dimensions in any order, the images are resized one from another starting from the largest one
     std::vector<std::string> generateImages(const LocalPath& localfilepath, const std::vector<GfxDimension>& dimensions);
 
     std::string generateOneImage(const LocalPath& localfilepath, const GfxDimension& dimension);
 
+    // the images of the job from the cache, if all of them are there
+    bool getCachedImages(GfxJob* job);
+
+    std::unique_ptr<GfxCache> mCache;
+
 public:
     // synchronously processes the results of gendimensionsputfa() (if any) in a thread safe manner
     int checkevents(Waiter*);
@@ -184,7 +268,11 @@ public:
     // handle is uploadhandle or nodehandle
     // - must respect JPEG EXIF rotation tag
     // - must save at 85% quality (120*120 pixel result: ~4 KB)
-    int gendimensionsputfa(const LocalPath&, NodeOrUploadHandle, SymmCipher*, int missingattr);
+    // The images of files with a valid fingerprint are taken from the cache, if it's set and has them
+    int gendimensionsputfa(const LocalPath&, NodeOrUploadHandle, SymmCipher*, int missingattr, const FileFingerprint& fingerprint);
+
+    // keep the generated images in a cache, before startProcessingThread()
+    void setCache(std::unique_ptr<GfxCache> cache);
 
     // FIXME: read dynamically from API server
     typedef enum { THUMBNAIL, PREVIEW } meta_t;
@@ -200,8 +288,12 @@ public:
 
     MegaClient* client = nullptr;
 
-    // start a thread that will do the processing
-    void startProcessingThread();
+    // default number of processing threads: decoded images can take hundreds of MB each
+    static unsigned defaultNumThreads();
+
+    // start the threads that will do the processing (0 for the default number of them).
+    // Only one if the provider can't be cloned
+    void startProcessingThread(unsigned numThreads = 0);
 
     // The provided IGfxProvider implements library specific image processing
     // Thread safety among IGfxProvider methods is guaranteed by GfxProc
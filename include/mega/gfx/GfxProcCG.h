@@ -37,6 +37,8 @@ private: // mega::GfxProc implementations
     bool resizebitmap(int, int, mega::string*) override;
     void freebitmap() override;
 public:
+    std::unique_ptr<mega::IGfxProvider> clone() const override;
+
     GfxProviderCG();
     ~GfxProviderCG();
 };
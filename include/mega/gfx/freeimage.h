@@ -44,12 +44,21 @@ class MEGA_API GfxProviderFreeImage : public IGfxLocalProvider
 
 public:
     bool readbitmap(const LocalPath&, int) override;
+
+#ifdef HAVE_PDFIUM
+    // releases the PDF document read for the images
+    std::vector<std::string> generateImages(const LocalPath& localfilepath,
+                                            const std::vector<GfxDimension>& dimensions) override;
+#endif
     bool resizebitmap(int, int, string*) override;
     void freebitmap() override;
 
     const char* supportedformats() override;
     const char* supportedvideoformats() override;
 
+    // the bitmaps are per instance, the libraries are initialized once
+    std::unique_ptr<IGfxProvider> clone() const override;
+
     GfxProviderFreeImage();
     ~GfxProviderFreeImage();
 
@@ -66,6 +75,9 @@ protected:
     const char* supportedformatsFfmpeg();
     bool isFfmpegFile(const string &ext);
     bool readbitmapFfmpeg(const LocalPath&, int);
+
+    // decodes with the hardware decoder if requested and available for the codec, reported in hwaccelUsed
+    bool readbitmapFfmpeg(const LocalPath&, int, bool hwaccel, bool& hwaccelUsed);
 #endif
 
 #ifdef HAVE_PDFIUM
@@ -37,21 +37,48 @@ class PdfiumReader
 private:
     static unsigned initialized;
 
+    // the last document read, kept open to render it at other sizes
+    struct CachedDocument
+    {
+        LocalPath path;
+        FPDF_DOCUMENT document = nullptr;
+#ifdef _WIN32
+        // copy, or contents in memory, of documents with non-ascii paths
+        LocalPath tmpFilePath;
+        std::unique_ptr<byte[]> buffer;
+#endif
+    };
+    static CachedDocument cachedDocument;
+
+    // these are called with pdfMutex locked
+#ifdef _WIN32
+    static FPDF_DOCUMENT loadDocument(const LocalPath &path, const LocalPath &workingDirFolder);
+#else
+    static FPDF_DOCUMENT loadDocument(const LocalPath &path);
+#endif
+    static void closeDocumentLocked();
+
 public:
     // Initializes the library and increases the internal counter of initializations. See destroy().
     // PdfiumReader member method calling init() is responsible for locking pdfMutex
     static void init();
 
+    // The first page is rendered at the resolution whose smaller side is 'size' pixels (1 pixel per point if 0),
+    // within 3500 pixels in any dimension. w and h return the dimensions of the bitmap.
 #ifdef _WIN32
     // BGRA format, 4 bytes per pixel (32bits), byte order: blue, green, red, alpha.
     // init() is called internally if library is not initialized.
     // workingDirFolder : Path to create a temporary file.
-    static unique_ptr<char[]> readBitmapFromPdf(int &w, int &h, int &orientation, const LocalPath &path, const LocalPath &workingDirFolder);
+    static unique_ptr<char[]> readBitmapFromPdf(int &w, int &h, int &orientation, const LocalPath &path, const LocalPath &workingDirFolder, int size = 0);
 #else
     // Returns a bitmap in BGRA format, 4 bytes per pixel (32bits), byte order: blue, green, red, alpha.
     // init() is called internally if library is not initialized.
-    static unique_ptr<char[]> readBitmapFromPdf(int &w, int &h, int &orientation, const LocalPath &path);
+    static unique_ptr<char[]> readBitmapFromPdf(int &w, int &h, int &orientation, const LocalPath &path, int size = 0);
 #endif
+
+    // Closes the document kept open by readBitmapFromPdf()
+    static void closeDocument();
+
     // It decreases the initializations internal counter and destroys the library once it reaches zero.
     static void destroy();
 
@@ -139,23 +139,105 @@ private:
     HelloBeater mBeater;
 };
 
+// Several isolated processes, each one with its own endpoint so that a crash only affects the requests to it.
+// minSize of them are started upfront and kept running (warm), more are started while all of them are busy
+// (up to maxSize), and these extra ones are stopped once they have been idle for the keep alive period
+class GfxIsolatedProcessPool
+{
+public:
+    GfxIsolatedProcessPool(const GfxIsolatedProcess::Params& params, size_t minSize, size_t maxSize);
+
+    // A worker for one request, released when destroyed
+    class Lease
+    {
+    public:
+        Lease(GfxIsolatedProcessPool& pool, size_t index, const std::string& endpointName);
+
+        ~Lease();
+
+        Lease(const Lease&) = delete;
+
+        Lease& operator=(const Lease&) = delete;
+
+        const std::string& endpointName() const { return mEndpointName; }
+    private:
+        GfxIsolatedProcessPool& mPool;
+
+        size_t mIndex;
+
+        std::string mEndpointName;
+    };
+
+    // An idle worker in round-robin order, a new one if all of them are busy, or the least busy one
+    std::unique_ptr<Lease> acquire();
+
+    // The endpoint of the first one, always running
+    const std::string& endpointName() const { return mParams.endpointName; }
+
+    size_t maxSize() const { return mWorkers.size(); }
+private:
+
+    struct Worker
+    {
+        std::unique_ptr<GfxIsolatedProcess> process;
+
+        // requests in progress
+        size_t busy = 0;
+
+        std::chrono::steady_clock::time_point lastUsed;
+    };
+
+    void release(size_t index);
+
+    // stops the extra workers idle for too long
+    std::vector<std::unique_ptr<GfxIsolatedProcess>> retireIdle();
+
+    void start(size_t index);
+
+    GfxIsolatedProcess::Params mParams;
+
+    size_t mMinSize;
+
+    std::vector<Worker> mWorkers;
+
+    // where the round-robin goes on from
+    size_t mNext = 0;
+
+    std::mutex mMutex;
+};
+
 class GfxProviderIsolatedProcess : public IGfxProvider
 {
 public:
 
-    GfxProviderIsolatedProcess(std::unique_ptr<GfxIsolatedProcess> process);
+    GfxProviderIsolatedProcess(std::shared_ptr<GfxIsolatedProcessPool> pool);
 
     std::vector<std::string> generateImages(const LocalPath& localfilepath,
                                             const std::vector<GfxDimension>& dimensions) override;
 
+    // the files are sent in one request, the worker processes them concurrently
+    void generateImagesBatch(const std::vector<FileDimensions>& files, const ImagesCallback& onImages) override;
+
+    size_t maxBatchSize() const override { return MAX_BATCH_SIZE; }
+
     const char* supportedformats() override;
 
     const char* supportedvideoformats() override;
 
+    // another provider of the same pool, if it can have several workers
+    std::unique_ptr<IGfxProvider> clone() const override;
+
+    //
+    // poolSize workers are kept running, up to maxPoolSize of them while they are busy
+    //
     static std::unique_ptr<GfxProviderIsolatedProcess> create(const std::string& endpointName,
-                                                              const std::string& executable);
+                                                              const std::string& executable,
+                                                              size_t poolSize = 1,
+                                                              size_t maxPoolSize = 1);
 private:
 
+    static constexpr size_t MAX_BATCH_SIZE = 16;
+
     // thread safe formats accessor
     class Formats
     {
@@ -181,11 +263,12 @@ private:
 
     const char* getformats(const char* (Formats::*formatsFunc)() const);
 
-    Formats mFormats;
+    GfxProviderIsolatedProcess(std::shared_ptr<GfxIsolatedProcessPool> pool, std::shared_ptr<Formats> formats);
 
-    std::unique_ptr<GfxIsolatedProcess> mProcess;
+    // shared with the clones
+    std::shared_ptr<Formats> mFormats;
 
-    std::string mEndpointName;
+    std::shared_ptr<GfxIsolatedProcessPool> mPool;
 };
 
 }
@@ -21,7 +21,9 @@
 #include "mega/gfx.h"
 #include "mega/gfx/worker/comms.h"
 #include "mega/gfx/worker/comms_client.h"
+#include "mega/gfx/worker/tasks.h"
 
+#include <functional>
 #include <memory>
 #include <vector>
 #include <string>
@@ -53,6 +55,12 @@ public:
                     const std::vector<GfxDimension>& dimensions,
                     std::vector<std::string>& images);
 
+    // Several tasks in one round trip (at most CommandNewGfxBatch::MAX_TASKS), the paths as for runGfxTask.
+    // onImages is called with the index of each successful task as the server finishes it, in any order.
+    // It returns false if any of them couldn't be processed
+    using BatchImagesCallback = std::function<void(size_t index, std::vector<std::string>&& images)>;
+    bool runGfxBatch(const std::vector<GfxTask>& tasks, const BatchImagesCallback& onImages);
+
     bool runSupportFormats(std::string& formats, std::string& videoformats);
 
     static GfxClient create(const std::string& endpointName);
@@ -37,7 +37,9 @@ enum class CommandType
     HELLO_RESPONSE              = 7,
     SUPPORT_FORMATS             = 8,
     SUPPORT_FORMATS_RESPONSE    = 9,
-    END                         = 10  // 1 more than the last valid one
+    NEW_GFX_BATCH               = 10,
+    NEW_GFX_BATCH_RESPONSE      = 11,
+    END                         = 12  // 1 more than the last valid one
 };
 
 class ICommand
@@ -96,6 +98,7 @@ struct CommandNewGfxResponse : public ICommand
     uint32_t    ErrorCode;
     std::string ErrorText;
     std::vector<std::string> Images;
+    GfxSharedImages SharedImages;   // instead of Images, if it has a Name
 
     CommandType type() const override { return CommandType::NEW_GFX_RESPONSE; }
 
@@ -106,6 +109,40 @@ struct CommandNewGfxResponse : public ICommand
     bool unserialize(const std::string& data) override;
 };
 
+// Several tasks in one request. The server sends a NEW_GFX_BATCH_RESPONSE
+// for each of them on the same connection, as soon as it is done
+struct CommandNewGfxBatch : public ICommand
+{
+    static constexpr size_t MAX_TASKS = 100;
+
+    std::vector<GfxTask> Tasks;
+
+    CommandType type() const override { return CommandType::NEW_GFX_BATCH; }
+
+    std::string typeStr() const override { return "NEW_GFX_BATCH"; };
+
+    std::string serialize() const override;
+
+    bool unserialize(const std::string& data) override;
+};
+
+struct CommandNewGfxBatchResponse : public ICommand
+{
+    uint32_t    Index;      // of the task in the batch
+    uint32_t    ErrorCode;
+    std::string ErrorText;
+    std::vector<std::string> Images;
+    GfxSharedImages SharedImages;   // instead of Images, if it has a Name
+
+    CommandType type() const override { return CommandType::NEW_GFX_BATCH_RESPONSE; }
+
+    std::string typeStr() const override { return "NEW_GFX_BATCH_RESPONSE"; };
+
+    std::string serialize() const override;
+
+    bool unserialize(const std::string& data) override;
+};
+
 struct CommandHello : public ICommand
 {
     std::string Text;
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "mega/gfx/worker/tasks.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mega {
+namespace gfx {
+
+class SharedMemory;
+
+/**
+ * @brief A ring of regions in shared memory for the images generated by the worker process,
+ *        so that only their location (GfxSharedImages) goes through the pipe.
+ *
+ * The worker process creates it and is the only one allocating regions, the client copies the
+ * images out and frees the region. Regions not freed in time (the client gave up) are reused.
+ */
+class SharedImageRing
+{
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 16 * 1024 * 1024;
+
+    // regions not freed by the client for this long are reused
+    static constexpr std::chrono::seconds EXPIRY{60};
+
+    ~SharedImageRing();
+
+    // the worker side. Null if the shared memory couldn't be created
+    static std::unique_ptr<SharedImageRing> create(const std::string& name, size_t capacity = DEFAULT_CAPACITY);
+
+    // copies the images to a new region. Empty location Name if there isn't room, they go inline then
+    GfxSharedImages write(const std::vector<std::string>& images);
+
+    // the client side: copies the images out and frees the region.
+    // False if they couldn't be read, such as the region was reused
+    static bool read(const GfxSharedImages& location, std::vector<std::string>& images);
+
+    size_t capacity() const { return mCapacity; }
+
+private:
+    enum RegionState : uint32_t
+    {
+        FREE     = 0,
+        RESERVED = 1,   // being written by the worker
+        WRITTEN  = 2,
+    };
+
+    // at the beginning of each region, followed by the images
+    struct RegionHeader
+    {
+        std::atomic<uint32_t> state;
+        std::atomic<uint32_t> generation;
+        uint64_t              size;     // of the images
+    };
+
+    struct Region
+    {
+        size_t                                offset;
+        size_t                                length;
+        std::chrono::steady_clock::time_point written;
+    };
+
+    SharedImageRing(std::unique_ptr<SharedMemory> memory, size_t capacity);
+
+    RegionHeader* header(size_t offset) const;
+
+    void reclaim();
+
+    bool allocate(size_t length, size_t& offset);
+
+    // the regions in use, from the oldest one
+    std::deque<Region> mRegions;
+
+    // where the next one starts
+    size_t mHead = 0;
+
+    uint32_t mGeneration = 0;
+
+    std::mutex mMutex;
+
+    std::unique_ptr<SharedMemory> mMemory;
+
+    size_t mCapacity;
+};
+
+} // namespace
+}
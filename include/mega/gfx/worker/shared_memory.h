@@ -0,0 +1,12 @@
+/**
+ * Covenience, include this file instead of platform headers
+ *
+ * */
+
+#pragma once
+
+#if defined(WIN32)
+#include "mega/win32/gfx/worker/shared_memory.h"
+#else
+#include "mega/posix/gfx/worker/shared_memory.h"
+#endif
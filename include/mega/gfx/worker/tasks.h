@@ -34,6 +34,18 @@ struct GfxTask final
     std::vector<GfxDimension> Dimensions;
 };
 
+/**
+ * @brief Where the images of a task are in the shared memory of the worker process,
+ *        sent instead of the images themselves. See SharedImageRing.
+ */
+struct GfxSharedImages final
+{
+    std::string           Name;            // of the shared memory, empty if the images are sent inline
+    uint64_t              Offset = 0;      // of the region with the images, one after another
+    uint32_t              Generation = 0;  // of the region, it's been reused if it's changed
+    std::vector<uint32_t> Sizes;           // of each image
+};
+
 /**
  * @brief Defines the possible result status of GfxProcessor::process
  */
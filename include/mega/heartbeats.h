@@ -118,7 +118,11 @@ private:
 
     Syncs& syncs;
 
-    void beatBackupInfo(UnifiedSync& us);
+    // next time the syncs are checked for heartbeats (the sync loop may run many times per second)
+    dstime mNextBeat = 0;
+
+    // Check the state of the sync and add its heartbeat to 'heartbeats' if it's due
+    void beatBackupInfo(UnifiedSync& us, std::vector<std::function<void(MegaClient&)>>& heartbeats);
 };
 
 #endif
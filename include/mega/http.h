@@ -238,6 +238,46 @@ private:
     m_off_t aggregateProgressForTimePeriod(dstime timePeriodToAggregate, dstime totalTime, m_off_t bytesToAggregate) const;
 };
 
+// Weighted fair share of a bandwidth limit between the traffic classes, with a token bucket per class.
+// The classes with traffic get the tokens in proportion to their weights, and the tokens that don't fit
+// in their buckets (the class is idle or slower than its share) overflow to a shared bucket that any
+// class can use: streaming keeps its share while sync and backup transfers take whatever is left.
+class MEGA_API BandwidthScheduler
+{
+public:
+    static const unsigned WEIGHTS[BW_CLASSES];
+    // buckets hold the tokens of this time at their rates...
+    static constexpr dstime BURST_DS = 5;
+    // ...but at least this, so that a whole cURL write fits in them
+    static constexpr m_off_t MIN_BURST = 64 * 1024;
+    // classes without traffic for this time don't get tokens
+    static constexpr dstime IDLE_DS = 10;
+
+    // limit in bytes per second (0 for no limit)
+    void setLimit(m_off_t bps);
+    m_off_t limit() const { return mLimit; }
+
+    // add the tokens of the time elapsed until 'now'
+    void refill(dstime now);
+
+    // bytes that a request of the class can transfer right now (the class becomes active)
+    m_off_t available(bwclass_t c, dstime now);
+
+    // account transferred bytes: from the bucket of the class first, then from the shared one.
+    // Consuming more than available is allowed, the class gets no more tokens until it pays it back
+    void consume(bwclass_t c, m_off_t bytes);
+
+private:
+    m_off_t mLimit = 0;
+    dstime mLastRefill = 0;
+    std::array<m_off_t, BW_CLASSES> mTokens{};
+    std::array<dstime, BW_CLASSES> mLastActive{};
+    std::array<bool, BW_CLASSES> mActive{};
+    m_off_t mShared = 0;
+
+    m_off_t burst(m_off_t bps) const;
+};
+
 extern std::mutex g_APIURL_default_mutex;
 extern string g_APIURL_default;
 extern bool g_disablepkp_default;
@@ -327,12 +367,50 @@ struct MEGA_API HttpIO : public EventTrigger
     // get max upload speed
     virtual m_off_t getmaxuploadspeed();
 
+    // multiplex requests to the same host over HTTP/2 connections
+    virtual bool sethttp2(bool enable);
+
+    // check if requests are multiplexed over HTTP/2 connections
+    virtual bool gethttp2();
+
     virtual bool cacheresolvedurls(const std::vector<string>&, std::vector<string>&&) { return false; }
 
+    // start resolving the hosts of the URLs not resolved yet, ahead of the first request to them
+    virtual void prefetchdns(const std::vector<string>&) { }
+
     HttpIO();
     virtual ~HttpIO() { }
 };
 
+// Slab allocator for the data buffers of binary HTTP requests and RaidBufferManager::FilePiece.
+// Sizes are rounded up to power-of-two classes (MIN_SLAB_SIZE to MAX_SLAB_SIZE) and released slabs
+// are kept for reuse, up to MAX_CACHED_BYTES: the connections of a (CloudRAID) download request and
+// combine buffers of the same few sizes over and over. Other sizes go straight to the heap.
+// Pooled buffers are aligned to ALIGNMENT, so downloaded data can be written with direct (unbuffered) I/O.
+// Buffers can be released from any thread.
+class MEGA_API HttpBufferPool
+{
+public:
+    static constexpr size_t ALIGNMENT = 4096;
+    static constexpr size_t MIN_SLAB_SIZE = 64 * 1024;
+    static constexpr size_t MAX_SLAB_SIZE = 64 * 1024 * 1024;
+#if defined(__ANDROID__) || defined(USE_IOS)
+    static constexpr size_t MAX_CACHED_BYTES = 32 * 1024 * 1024;
+#else
+    static constexpr size_t MAX_CACHED_BYTES = 256 * 1024 * 1024;
+#endif
+
+    // returns a buffer of at least `len` bytes. It must be released with release()
+    static byte* allocate(size_t len);
+    static void release(byte* buf);
+
+    // bytes kept in released slabs
+    static size_t cachedBytes();
+
+    // free the released slabs
+    static void clear();
+};
+
 // outgoing HTTP request
 struct MEGA_API HttpReq
 {
@@ -352,6 +430,9 @@ struct MEGA_API HttpReq
     bool mExpectRedirect = false;
     bool mChunked = false;
 
+    // share of the bandwidth limits this request belongs to
+    bwclass_t bwclass = BW_INTERACTIVE;
+
     bool sslcheckfailed;
     string sslfakeissuer;
     string mRedirectURL;
@@ -378,6 +459,9 @@ struct MEGA_API HttpReq
     // time left related to a bandwidth overquota
     m_time_t timeleft;
 
+    // seconds to wait before retrying, as requested by the server (Retry-After), or -1
+    m_time_t retryafter;
+
     // Content-Type of the response
     string contenttype;
 
@@ -419,7 +503,7 @@ struct MEGA_API HttpReq
         size_t start;
         size_t end;
 
-        http_buf_t(byte* b, size_t s, size_t e);  // takes ownership of the byte*, which must have been allocated with new[]
+        http_buf_t(byte* b, size_t s, size_t e);  // takes ownership of the byte*, which must have been allocated with HttpBufferPool::allocate()
         ~http_buf_t();
         void swap(http_buf_t& other);
         bool isNull() const;
@@ -506,7 +590,7 @@ public:
 
     bool encrypt(m_off_t pos, m_off_t npos, string& urlSuffix);
 
-private:
+protected:
     SymmCipher* key;
     chunkmac_map* macs;
     uint64_t ctriv;     // initialization vector for CTR mode
@@ -87,10 +87,22 @@ public:
     bool storeKeyValueFromObject(string& key, string& value);
 
     bool storeobject(string* = NULL);
+
+    // same as above, without copying the value: the view points into the JSON data being parsed,
+    // so it remains valid as long as that data, usually the whole response or batch of action packets
+    bool storeobject(std::string_view&);
     bool skipnullvalue();
 
     static void unescape(string*);
 
+    // position of the first '"', '\\' or terminating null at or after `ptr`
+    // (scans 16 bytes per step with SSE2/NEON if available)
+    static const char* findStringDelimiter(const char* ptr);
+
+    // position of the unescaped '"' closing a string whose contents start at `ptr`,
+    // or of the terminating null if the string is not complete
+    static const char* findStringEnd(const char* ptr);
+
     /**
      * @brief Extract a string value for a name in a JSON string
      * @param json JSON string to check
@@ -92,11 +92,14 @@
 #include <array>
 #include <atomic>
 #include <cassert>
+#include <condition_variable>
 #include <cstring>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 // define MEGA_QT_LOGGING to support QString
@@ -755,6 +758,67 @@ inline bool isWithinActivePeriod(const TimeUnit sleepDuration, const TimeUnit ac
 #define LOG_err_timed(SLEEP, ACTIVE) LOG_generic_timed(::mega::logError, SLEEP, ACTIVE)
 #define LOG_fatal_timed(SLEEP, ACTIVE) LOG_generic_timed(::mega::logFatal, SLEEP, ACTIVE)
 
+// Spans of the hot paths (sync passes, db queries, command batches...), to find what causes stalls.
+// While tracing is enabled they are recorded into buffers of each thread, and then exported as
+// Chrome trace JSON, that chrome://tracing and Perfetto (ui.perfetto.dev) can open, with a track per thread.
+// TRACE_SPAN and TRACE_THREAD_NAME compile to nothing unless ENABLE_TRACING is defined.
+class Tracer
+{
+public:
+    // events kept per thread: the oldest ones are overwritten
+    static constexpr size_t EVENTS_PER_THREAD = 8192;
+
+    static void setEnabled(bool enable);
+    static bool enabled() { return mEnabled.load(std::memory_order_relaxed); }
+
+    // name of the track of the calling thread. It must outlive the thread (e.g. a literal)
+    static void setThreadName(const char* name);
+
+    // microseconds of a steady clock
+    static int64_t now();
+
+    // the name must outlive the tracing (e.g. a literal)
+    static void record(const char* name, int64_t startUs, int64_t endUs);
+
+    // Chrome trace JSON of the events recorded so far, which are discarded if 'clear' is set
+    static std::string dump(bool clear);
+
+private:
+    static std::atomic<bool> mEnabled;
+};
+
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char* name)
+        : mName(Tracer::enabled() ? name : nullptr)
+        , mStart(mName ? Tracer::now() : 0)
+    {
+    }
+
+    ~TraceSpan()
+    {
+        if (mName) Tracer::record(mName, mStart, Tracer::now());
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* mName;
+    int64_t mStart;
+};
+
+#ifdef ENABLE_TRACING
+#define MEGA_TRACE_JOIN_(A, B) A##B
+#define MEGA_TRACE_JOIN(A, B) MEGA_TRACE_JOIN_(A, B)
+#define TRACE_SPAN(NAME) ::mega::TraceSpan MEGA_TRACE_JOIN(traceSpan, __LINE__)(NAME)
+#define TRACE_THREAD_NAME(NAME) ::mega::Tracer::setThreadName(NAME)
+#else
+#define TRACE_SPAN(NAME) (void)0
+#define TRACE_THREAD_NAME(NAME) (void)0
+#endif
+
 #if (defined(ANDROID) || defined(__ANDROID__))
 inline void crashlytics_log(const char* msg)
 {
@@ -829,6 +893,96 @@ public:
 };
 
 
+class AsyncLogger : public Logger
+{
+    // An adapter that moves the output of the logs out of the threads that log them.
+    // Each thread copies its messages into a ring buffer of its own, without locking, and a
+    // background thread delivers them to the target logger (or writes them in binary form to a
+    // stream, to be decoded offline with decodeBinaryLog). If a ring is full, the message is
+    // dropped and counted rather than making the thread wait.
+    //
+    // Usage: SimpleLogger::setOutputClass(&asyncLogger). Restore the previous output class
+    // before destroying it; the messages still in the rings are delivered by the destructor.
+    // Each thread keeps the ring of the last AsyncLogger it logged to, so only one of them
+    // should be in use at a time.
+
+public:
+    static constexpr size_t DEFAULT_RING_SLOTS = 128;
+
+    // interval of the deliveries of the background thread, unless a ring gets half full before
+    static constexpr unsigned DRAIN_INTERVAL_MS = 20;
+
+    explicit AsyncLogger(Logger& target, size_t ringSlots = DEFAULT_RING_SLOTS);
+    explicit AsyncLogger(std::ostream& binaryOutput, size_t ringSlots = DEFAULT_RING_SLOTS);
+    ~AsyncLogger();
+
+    void log(const char *time, int loglevel, const char *source, const char *message
+#ifdef ENABLE_LOG_PERFORMANCE
+        , const char **directMessages, size_t *directMessagesSizes, unsigned numberMessages
+#endif
+    ) override;
+
+    // deliver the messages logged so far before returning
+    void flush();
+
+    // number of messages dropped because the ring of their thread was full
+    uint64_t droppedMessages() const { return mDropped.load(std::memory_order_relaxed); }
+
+    // convert the output written in binary mode into text lines. Returns false if it's not valid
+    static bool decodeBinaryLog(std::istream& in, std::ostream& out);
+
+private:
+    struct Record
+    {
+        int64_t timestamp = 0; // microseconds since the epoch
+        int level = 0;
+        char time[16];
+        char source[64];
+        char text[LOGGER_CHUNKS_SIZE];
+        size_t size = 0;
+        std::string longText; // for the messages that don't fit in text
+        bool hasTime = false;
+        bool hasSource = false;
+
+        const char* message() const { return longText.empty() ? text : longText.c_str(); }
+    };
+
+    // single producer (the owner thread), single consumer (serialized by mDrainMutex)
+    struct Ring
+    {
+        Ring(size_t slots, unsigned number) : records(slots), threadNumber(number) {}
+
+        std::vector<Record> records;
+        std::atomic<size_t> head{0};
+        std::atomic<size_t> tail{0};
+        unsigned threadNumber;
+    };
+
+    Ring* threadRing();
+    void start();
+    void loop();
+    void drain();
+    void deliver(const Record& record, unsigned threadNumber);
+
+    Logger* mTarget = nullptr;
+    std::ostream* mBinaryOutput = nullptr;
+    const size_t mRingSlots;
+    const uint64_t mInstanceId;
+
+    std::mutex mRingsMutex;
+    std::vector<std::shared_ptr<Ring>> mRings;
+    unsigned mNextThreadNumber = 0;
+
+    std::mutex mDrainMutex;
+    std::mutex mWakeMutex;
+    std::condition_variable mWake;
+    bool mStop = false;
+    std::atomic<uint64_t> mDropped{0};
+    uint64_t mReportedDropped = 0;
+    std::thread mThread;
+};
+
+
 // This used to be a static member of MegaApi_impl
 // However, megacli could not use or test it from there since it
 // uses the SDK core directly, and not the intermediate layer
@@ -25,6 +25,7 @@
 #include "types.h"
 #include "json.h"
 #include "filesystem.h"
+#include <mutex>
 #include <string>
 
 namespace mega {
@@ -145,6 +146,40 @@ struct MEGA_API MediaFileInfo
     // Check if we should retry video property extraction, due to previous failure with older library
     bool timeToRetryMediaPropertyExtraction(const std::string& fileattributes, uint32_t fakey[4]);
 
+    // Uploads extract the properties in the background while the data is sent. The attribute key is only known
+    // once the upload has completed: that's when they are queued for putnodes, or as soon as they are available
+    struct PendingExtraction
+    {
+        bool extracted = false;
+        MediaProperties vp;
+
+        // the upload is waiting for the properties, with this key
+        bool uploadCompleted = false;
+        uint32_t fakey[4];
+    };
+    std::map<UploadHandle, PendingExtraction> pendingExtractions;
+
+    // filled in by the worker threads
+    struct ExtractedProperties
+    {
+        std::mutex mutex;
+        std::vector<std::pair<UploadHandle, MediaProperties>> results;
+    };
+    std::shared_ptr<ExtractedProperties> extractedProperties = std::make_shared<ExtractedProperties>();
+
+    // start extracting the properties of a file to upload in the background
+    void startMediaPropertiesExtraction(MegaClient* client, const LocalPath& localpath, UploadHandle uploadHandle);
+
+    // the upload has completed: queue the properties for putnodes, now or once they are extracted.
+    // Returns false if the extraction wasn't started for it
+    bool completeMediaPropertiesExtraction(MegaClient* client, uint32_t fakey[4], UploadHandle uploadHandle, Transfer* transfer);
+
+    // take the results of the worker threads, on the client thread. Returns true if there were any
+    bool checkMediaPropertiesExtractions(MegaClient* client);
+
+    // the transfer is gone before completing. Completed ones are cleaned up when the properties arrive
+    void forgetMediaPropertiesExtraction(UploadHandle uploadHandle);
+
     MediaFileInfo();
 };
 
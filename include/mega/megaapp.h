@@ -133,6 +133,9 @@ struct MEGA_API MegaApp
     // nodes now (nearly) current
     virtual void nodes_current() { }
 
+    // the records of the local cache deferred by a fast resume are loaded
+    virtual void deferred_cache_loaded() { }
+
     // up to date with API (regarding actionpackets)
     virtual void catchup_result() { }
 
@@ -207,9 +210,9 @@ struct MEGA_API MegaApp
     virtual void openfilelink_result(const Error&) { }
     virtual void openfilelink_result(handle, const byte*, m_off_t, string*, string*, int) { }
 
-    // pread result
+    // pread result (the last parameter owns the data: holding it keeps the data valid past the call)
     virtual dstime pread_failure(const Error&, int, void*, dstime) { return ~(dstime)0; }
-    virtual bool pread_data(byte*, m_off_t, m_off_t, m_off_t, m_off_t, void*) { return false; }
+    virtual bool pread_data(byte*, m_off_t, m_off_t, m_off_t, m_off_t, void*, std::shared_ptr<const void>) { return false; }
 
     // event reporting result
     virtual void reportevent_result(error) { }
@@ -466,6 +466,21 @@ private:
 
     std::string computeSymmetricKey(handle user);
 
+    // the keys of computeSymmetricKey() for several users (those it can't compute are left out),
+    // with the key agreements at the client's worker threads when there are many of them
+    static constexpr size_t SYMMETRIC_KEY_BATCH_SIZE = 16;
+    std::map<handle, std::string> computeSymmetricKeys(const std::set<handle>& users);
+
+    // the Cu25519 public key of a contact, if cached
+    const string* contactCu25519PubKey(handle user);
+
+    // the key shared with the owner of 'pubKey' (thread safe)
+    static std::string deriveSymmetricKey(const string& privKey, const string& pubKey);
+
+    // encryption of share keys with the key shared with a contact
+    static std::string encryptShareKeyWith(const std::string& sharedKey, const std::string& shareKey);
+    static std::string decryptShareKeyWith(const std::string& sharedKey, const std::string& key);
+
     // validates data in `km`: ie. downgrade attack, tampered keys...
     bool isValidKeysContainer(const KeyManager& km);
 
@@ -507,6 +522,13 @@ public:
     handle me;
     string uid;
 
+    // users whose attributes are decoded in memory, and the clock of their last use (see User::loadattrs())
+    size_t mUsersWithAttrs = 0;
+    uint64_t mUserAttrsClock = 0;
+
+    // above it, the attributes of the least recently used users are dropped, to be decoded again from the cache
+    size_t mMaxUsersWithAttrs = 1000;
+
     // all users
     user_map users;
 
@@ -619,6 +641,7 @@ public:
     void login(const char*, const byte*, const char* = NULL, CommandLogin::Completion completion = nullptr);
 
     // user login: e-mail, password, salt
+    // (the key is derived at a worker thread, the login goes on from checkevents() once it's ready)
     void login2(const char*, const char*, const string *, const char* = NULL, CommandLogin::Completion completion = nullptr);
 
     // user login: e-mail, derivedkey, 2FA pin
@@ -825,6 +848,7 @@ public:
 
     // enqueue/abort direct read
     void pread(Node*, m_off_t, m_off_t, void*);
+    void pread(Node*, m_off_t, m_off_t, DirectReadListener*);
     void pread(handle, SymmCipher* key, int64_t, m_off_t, m_off_t, void*, bool = false,  const char* = NULL, const char* = NULL, const char* = NULL);
     void preadabort(Node*, m_off_t = -1, m_off_t = -1);
     void preadabort(handle, m_off_t = -1, m_off_t = -1);
@@ -834,6 +858,24 @@ public:
 
     MegaClientAsyncQueue mAsyncQueue;
 
+#ifdef USE_MEDIAINFO
+    // extraction of the media properties of uploads, while their data is sent
+    MegaClientAsyncQueue mMediaPropertiesQueue;
+#endif
+
+    // the login key being derived at mAsyncQueue, and what to do with it on this thread
+    struct PendingKeyDerivation
+    {
+        std::mutex mutex;
+        bool done = false;
+        vector<byte> derivedKey;
+        std::function<void(const vector<byte>&)> continuation;
+    };
+    std::shared_ptr<PendingKeyDerivation> mPendingKeyDerivation;
+
+    // runs the continuation of the key derivation, if done
+    bool checkPendingKeyDerivation();
+
     // number of parallel connections per transfer (PUT/GET)
     unsigned char connections[2];
 
@@ -853,6 +895,13 @@ public:
     // folders)
     void putnodes(NodeHandle, VersioningOption vo, vector<NewNode>&&, const char *, int tag, bool canChangeVault, CommandPutNodes::Completion&& completion = nullptr);
 
+    // Like putnodes(), but nodes for the same target, sent during the same exec() pass, share one command.
+    // Each caller still gets its own completion (or putnodes_result) and tag, with only its nodes and their errors.
+    void putnodesCoalesced(NodeHandle, VersioningOption vo, vector<NewNode>&&, int tag, putsource_t source, bool canChangeVault, CommandPutNodes::Completion&& completion = nullptr);
+
+    // Most nodes gathered into one coalesced putnodes command.
+    static constexpr size_t MAX_COALESCED_PUTNODES = 500;
+
     // send files/folders to user
     void putnodes(const char*, vector<NewNode>&&, int tag, CommandPutNodes::Completion&& completion = nullptr);
 
@@ -864,6 +913,9 @@ public:
     // move as many as possible from pendingfa to activefa
     void activatefa();
 
+    // attach the uploaded file attributes of the nodes that aren't waiting for any other
+    void attachpendingfa();
+
     // queue file attribute retrieval
     error getfa(handle h, string *fileattrstring, const string &nodekey, fatype, int = 0);
 
@@ -1247,6 +1299,12 @@ public:
     // get max upload speed
     m_off_t getmaxuploadspeed();
 
+    // multiplex requests over HTTP/2 connections
+    bool sethttp2(bool enable);
+
+    // check if requests are multiplexed over HTTP/2 connections
+    bool gethttp2();
+
     // get the handle of the older version for a NewNode
     std::shared_ptr<Node> getovnode(Node *parent, string *name);
 
@@ -1420,6 +1478,33 @@ private:
     // List of Notification IDs that should show in Notification Center
     std::vector<uint32_t> mEnabledNotifications;
 
+    // Nodes gathered by putnodesCoalesced() for one target
+    struct CoalescedPutnodes
+    {
+        struct Part
+        {
+            size_t mNumNodes;
+            int mTag;
+            CommandPutNodes::Completion mCompletion;
+        };
+
+        vector<NewNode> mNodes;
+
+        // Callers, in the order of their nodes
+        vector<Part> mParts;
+    };
+
+    // Target, versioning, source, vault access, and whether the nodes are tagged (ie. modified by this client)
+    using CoalescedPutnodesKey = std::tuple<NodeHandle, VersioningOption, putsource_t, bool, bool>;
+
+    std::map<CoalescedPutnodesKey, CoalescedPutnodes> mCoalescedPutnodes;
+
+    // Sends one coalesced putnodes command
+    void sendCoalescedPutnodes(const CoalescedPutnodesKey& key, CoalescedPutnodes&& batch);
+
+    // Sends everything gathered so far (at the end of each exec() pass)
+    void sendCoalescedPutnodes();
+
 public:
     // notify URL for new server-client commands
     string scnotifyurl;
@@ -1436,6 +1521,9 @@ public:
 
         // auth token that relates the usage of the folder link to a user's session id ('&sid=' param in the POST)
         string mAccountAuth;    // (optional, set by the app)
+
+        // folder of the link whose subtree is the only one fetched, instead of the whole link
+        NodeHandle mFetchRoot;  // (optional, set by the app)
     };
     FolderLink mFolderLink;
 
@@ -1474,6 +1562,21 @@ public:
     // i.e., there must be at least this number of raid transfers to let us predict whether the next download transfer will be raided or non-raided
     static const unsigned MEANINGFUL_PORTION_OF_MAXTRANSFERS_QUEUE_FOR_RAID_PREDICTIVE_SYSTEM;
 
+    // uploads smaller than this are dominated by per-file overhead rather than by bandwidth
+    static const m_off_t MAX_TINY_UPLOAD_SIZE;
+
+    // number of tiny uploads that are accounted as a single transfer slot
+    static const unsigned TINY_UPLOADS_PER_SLOT;
+
+    // share of the transfer limits taken by a transfer (tiny uploads take only a fraction of a slot)
+    static double transferSlotWeight(const Transfer* t);
+
+#ifdef ENABLE_SYNC
+    // backup id of the sync that requested a transfer (UNDEF for the transfers of the app).
+    // dispatchTransfers() shares the slots of each direction fairly among the syncs with transfers
+    static handle syncOfTransfer(const Transfer* t);
+#endif
+
     // maximum number of queued putfa before halting the upload queue
     static const int MAXQUEUEDFA;
 
@@ -1489,6 +1592,14 @@ public:
     // fetch state serialize from local cache
     bool fetchsc(DbTable*);
 
+    // records of the local cache (user alerts and Sets) left to load after a fast resume
+    bool mLoadingDeferredScRecords = false;
+    std::deque<pair<uint32_t, string>> mDeferredScRecords;
+    static constexpr size_t DEFERRED_SCRECORDS_PER_EXEC = 256;
+
+    // load up to maxRecords of the deferred records, and notify the app once all of them are loaded
+    void loadDeferredScRecords(size_t maxRecords);
+
     // fetch statusTable from local cache
     bool fetchStatusTable(DbTable*);
 
@@ -1566,7 +1677,7 @@ public:
     bool isprivatehandle(handle*);
 
     // add direct read
-    void queueread(handle, bool, SymmCipher*, int64_t, m_off_t, m_off_t, void*, const char* = NULL, const char* = NULL, const char* = NULL);
+    void queueread(handle, bool, SymmCipher*, int64_t, m_off_t, m_off_t, void*, const char* = NULL, const char* = NULL, const char* = NULL, DirectReadListener* = nullptr);
 
     // execute pending direct reads
     bool execdirectreads();
@@ -1602,6 +1713,18 @@ public:
     // enable / disable the gfx layer
     bool gfxdisabled;
 
+    // complete the session resumption from the local cache before the user alerts and Sets are loaded
+    bool fastResume = false;
+
+    // reserve the disk space of the downloads when they start (see TransferSlot::MIN_FILESIZE_FOR_PREALLOCATION)
+    bool preallocateDownloads = true;
+
+    // headless processes that only transfer files: user alerts are neither fetched nor kept
+    bool lowMemoryMode = false;
+
+    // memory shared by the buffers of the requests of all the transfer slots
+    TransferBufferBudget transferBufferBudget;
+
     // DB access
     DbAccess* dbaccess = nullptr;
 
@@ -1616,6 +1739,12 @@ public:
     // there is data to commit to the database when possible
     bool pendingsccommit;
 
+    // Group commit of action packets: commits of 'sctable' are spaced 'window' ds at least, so the
+    // changes of several batches are made durable together, and WAL checkpoints are moved to a
+    // background thread. A window of 0 (default) commits after every batch and checkpoints inline
+    void setScGroupCommitWindow(dstime window);
+    dstime scGroupCommitWindow() const { return mScGroupCommitWindow; }
+
     // transfer cache table
     unique_ptr<DbTable> tctable;
 
@@ -1665,6 +1794,10 @@ public:
     list<shared_ptr<HttpReqFA>> queuedfa;
     list<shared_ptr<HttpReqFA>> activefa;
 
+    // attributes uploaded for existing nodes, attached with a single "pfa" per node
+    // once the other attributes queued for the same node (usually thumbnail and preview) are uploaded too
+    map<handle, vector<CommandAttachFA::Attribute>> pendingattachfa;
+
     // API request queue double buffering:
     // reqs[r] is open for adding commands
     // reqs[r^1] is being processed on the API server
@@ -1689,6 +1822,12 @@ public:
     // open/create "statecache" and "nodes" tables in DB
     void opensctable();
 
+    // commit a postponed group commit of 'sctable' once its window has elapsed
+    void checkScGroupCommit();
+    bool insideScGroupCommitWindow() const;
+    dstime mScGroupCommitWindow = 0;
+    dstime mLastScCommit = 0;
+
     // opens (or creates if non existing) a status database table.
     //   if loadFromCache is true, it will load status from the table.
     void openStatusTable(bool loadFromCache);
@@ -1767,6 +1906,7 @@ public:
     dsdrn_map dsdrns;      // indicates the time at which DRNs should be retried
     dr_list drq;           // DirectReads that are in DirectReadNodes which have fectched URLs
     drs_list drss;         // DirectReadSlot for each DR in drq, up to Max
+    DirectReadCache drcache; // decrypted data recently streamed, shared by every DirectRead
     void removeAppData(void* t); // remove appdata (usually a MegaTransfer*) from every DirectRead
 
     // merge newly received share into nodes
@@ -1786,6 +1926,11 @@ public:
     transfer_multimap multi_transfers[2];
     BackoffTimerGroupTracker transferRetryBackoffs[2];
     uint32_t lastKnownCancelCount = 0;
+    uint32_t lastKnownSlotsCancelCount = 0;
+
+    // transfers by the cancel tokens of their files, so cancels don't walk all the transfers
+    std::unordered_map<const void*, std::set<Transfer*>> mTransfersByCancelToken;
+    void indexCancelToken(Transfer*, const CancelToken&);
 #ifdef ENABLE_SYNC
     // track puts that may need finishing if sync abandoned before putnodes happens
     TransferBackstop transferBackstop;
@@ -1876,6 +2021,9 @@ public:
     textchat_map chatnotify;
     void notifychat(TextChat *);
 
+    // the table of the account where the chats keep the grants of their attachments, if any
+    DBTableNodes* chatGrantsTable() const;
+
     // process mcsm array at fetchnodes
     void procmcsm(JSON*);
 #endif
@@ -1888,6 +2036,9 @@ public:
     // application
     void notifypurge();
 
+    // drops the attributes of the least recently used users, once they are more than mMaxUsersWithAttrs
+    void trimUserAttributes();
+
     // If it's necessary, load nodes from data base
     shared_ptr<Node> nodeByHandle(NodeHandle);
     shared_ptr<Node> nodebyhandle(handle);
@@ -2340,7 +2491,11 @@ public:
 #endif
         uint64_t transferStarts = 0, transferFinishes = 0;
         uint64_t transferTempErrors = 0, transferFails = 0;
+#ifdef ENABLE_SYNC
+        uint64_t syncPasses = 0, syncRowsVisited = 0, syncRowsSkipped = 0;
+#endif
         uint64_t prepwaitImmediate = 0, prepwaitZero = 0, prepwaitHttpio = 0, prepwaitFsaccess = 0, nonzeroWait = 0;
+        uint64_t transferslotPasses = 0, transferslotsServiced = 0, transferslotsSkipped = 0;
         CodeCounter::DurationSum csRequestWaitTime;
         CodeCounter::DurationSum transfersActiveTime;
         std::string report(bool reset, HttpIO* httpio, Waiter* waiter, const RequestDispatcher& reqs);
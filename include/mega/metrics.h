@@ -0,0 +1,149 @@
+/**
+ * @file metrics.h
+ * @brief Counters, gauges and latency histograms of the hot paths
+ *
+ * (c) 2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace mega {
+
+namespace Metrics {
+
+// Unlike CodeCounter, these are always built in, so they are kept cheap enough for production:
+// recording is a few relaxed atomic operations, from any thread, and the names are only looked
+// up once per call site, e.g.
+//
+//     static auto& latency = Metrics::registry().histogram("MegaClient_exec");
+//     Metrics::ScopedLatency timer(latency);
+
+class Counter
+{
+public:
+    void add(uint64_t n = 1) { mValue.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return mValue.load(std::memory_order_relaxed); }
+    void reset() { mValue.store(0, std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> mValue{0};
+};
+
+class Gauge
+{
+public:
+    void set(int64_t v) { mValue.store(v, std::memory_order_relaxed); }
+    void add(int64_t n) { mValue.fetch_add(n, std::memory_order_relaxed); }
+    int64_t value() const { return mValue.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> mValue{0};
+};
+
+// Latency histogram of microseconds, in the style of HDR histograms: each power of two is split
+// in SUB_BUCKETS linear buckets, so the values reported are within 25% of the real ones at any scale
+class Histogram
+{
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 2;
+    static constexpr unsigned SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static constexpr unsigned MAX_POWER = 40; // ~12 days: longer values go to the last bucket
+    static constexpr unsigned BUCKETS = (MAX_POWER - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    void record(uint64_t us);
+
+    void record(std::chrono::steady_clock::duration d)
+    {
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+        record(us > 0 ? static_cast<uint64_t>(us) : 0);
+    }
+
+    uint64_t count() const { return mCount.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return mSum.load(std::memory_order_relaxed); }
+    uint64_t max() const { return mMax.load(std::memory_order_relaxed); }
+
+    // upper bound of the bucket of the given percentile [0, 100] of the values recorded, 0 if none
+    uint64_t percentile(double p) const;
+
+    void reset();
+
+    static unsigned bucketOf(uint64_t us);
+    static uint64_t bucketUpperBound(unsigned bucket);
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> mBuckets{};
+    std::atomic<uint64_t> mCount{0};
+    std::atomic<uint64_t> mSum{0};
+    std::atomic<uint64_t> mMax{0};
+};
+
+// Records the time of a scope in a histogram
+class ScopedLatency
+{
+public:
+    explicit ScopedLatency(Histogram& histogram)
+        : mHistogram(histogram)
+    {
+    }
+
+    ~ScopedLatency()
+    {
+        mHistogram.record(std::chrono::steady_clock::now() - mStart);
+    }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    Histogram& mHistogram;
+    std::chrono::steady_clock::time_point mStart = std::chrono::steady_clock::now();
+};
+
+// Process-wide set of named metrics. The references returned stay valid for the whole process
+class Registry
+{
+public:
+    Counter& counter(const std::string& name);
+    Gauge& gauge(const std::string& name);
+    Histogram& histogram(const std::string& name);
+
+    // JSON object with all the metrics: {"counters":{..},"gauges":{..},"histograms":{"name":{"count":..,
+    // "sum_us":..,"max_us":..,"p50_us":..,"p90_us":..,"p99_us":..,"p999_us":..},..}}
+    // Counters and histograms start again from zero if 'reset' is set
+    std::string snapshot(bool reset);
+
+private:
+    std::mutex mMutex;
+    std::map<std::string, std::unique_ptr<Counter>> mCounters;
+    std::map<std::string, std::unique_ptr<Gauge>> mGauges;
+    std::map<std::string, std::unique_ptr<Histogram>> mHistograms;
+};
+
+Registry& registry();
+
+} // namespace Metrics
+
+} // namespace mega
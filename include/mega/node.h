@@ -28,6 +28,7 @@
 #include "attrmap.h"
 #include "syncfilter.h"
 #include "backofftimer.h"
+#include "nodehandlemap.h"
 #include <bitset>
 
 namespace mega {
@@ -143,14 +144,22 @@ public:
     shared_ptr<Node> getNodeInRam(bool updatePositionAtLRU = true);
     NodeHandle getNodeHandle() const;
 
-    std::list<std::shared_ptr<Node> >::const_iterator mLRUPosition;
+    // Intrusive links for NodeManager's cache LRU, so hits don't allocate nor copy shared pointers.
+    // While the node is at the LRU, 'mLRUNode' keeps it loaded in RAM.
+    NodeManagerNode* mLRUPrev = nullptr;
+    NodeManagerNode* mLRUNext = nullptr;
+    shared_ptr<Node> mLRUNode;
+    // set upon hits when the CLOCK policy is in use (second chance before eviction)
+    bool mLRUReferenced = false;
+
+    bool isAtCacheLRU() const { return mLRUNode != nullptr; }
 
 private:
     NodeHandle mNodeHandle;
     NodeManager& mNodeManager;
     weak_ptr<Node> mNode;
 };
-typedef std::map<NodeHandle, NodeManagerNode>::iterator NodePosition;
+typedef NodeHandleMap<NodeManagerNode>::iterator NodePosition;
 
 struct CommandChain
 {
@@ -244,6 +253,33 @@ struct MEGA_API Node : public NodeCore, FileFingerprint
     // try to resolve node key string
     bool applykey();
 
+    // applykey() split in stages, so the expensive part (unwrapping the node key, decrypting and
+    // parsing the attributes) can run in worker threads for many nodes (see NodeManager::applyKeys)
+    struct KeyDecryption
+    {
+        std::shared_ptr<Node> mNode;
+
+        // symmetrically encrypted node key and the key to unwrap it (empty if mKey is already decrypted)
+        string mEncryptedKey;
+        byte mUnwrapKey[FOLDERNODEKEYLENGTH];
+
+        byte mKey[FILENODEKEYLENGTH];
+        bool mKeyDecrypted = false;
+
+        // decrypted attributes, if they could be decrypted with mKey
+        unique_ptr<AttrMap> mAttrs;
+    };
+
+    // locate the key to decrypt the node key (to be called from the SDK thread)
+    // returns false if there's nothing to decrypt or the key is not available yet
+    bool prepareKeyDecryption(KeyDecryption& job);
+
+    // unwrap the node key and decrypt the attributes. It doesn't modify the node, so it can run in any thread
+    static void decryptKeyAndAttrs(KeyDecryption& job, SymmCipher& cipher);
+
+    // apply the result of decryptKeyAndAttrs() (to be called from the SDK thread). Returns the same as applykey()
+    bool applyKeyDecryption(KeyDecryption& job);
+
     // Returns false if the share key can't correctly decrypt the key and the
     // attributes of the node. Otherwise, it returns true. There are cases in
     // which it's not possible to check if the key is valid (for example when
@@ -470,6 +506,15 @@ private:
     NodeCounter mCounter;
 
     static nameid getExtensionNameId(const std::string& ext);
+
+    // locate the (sub)key of nodekeydata that can be decrypted and the cipher to decrypt it
+    bool findDecryptableKey(const char*& k, SymmCipher*& sc);
+
+    // set the decrypted node key (nullptr if decryption failed) and the attributes
+    bool applyDecryptedKey(const byte* key, unique_ptr<AttrMap> decryptedAttrs);
+
+    // set the decrypted attributes and track the changes
+    void applyAttrs(AttrMap&& newAttrs);
 };
 
 inline const string& Node::nodekey() const
@@ -506,6 +551,15 @@ class NodeData
 public:
     NodeData(const char* ptr, size_t size, int component) : mStart(ptr), mEnd(ptr + size), mComp(component) {}
 
+    // The blob written by Node::serialize() starts with a fixed-offset header:
+    // size/type, handle, parent handle, owner and ctime. These getters only decode
+    // that header, so they don't pay for attributes, keys or shares.
+    nodetype_t getType();
+    m_off_t getSize();
+    handle getParentHandle();
+    handle getOwner();
+    m_time_t getCtime();
+
     m_time_t getMtime();
     int getLabel();
     std::string getDescription();
@@ -526,6 +580,9 @@ public:
     };
 
 private:
+    bool readHeader();
+    bool headerReadFailed() { return !mHeaderRead && !readHeader(); }
+
     bool readComponents();
     bool readFailed() { return (mReadAttempted && !mReadSucceeded) || (!mReadAttempted && !readComponents()); }
 
@@ -554,6 +611,7 @@ private:
     m_time_t mPubLinkCts = 0;
     bool mPubLinkTakenDown = false;
 
+    bool mHeaderRead = false;
     bool mReadAttempted = false;
     bool mReadSucceeded = false;
 };
@@ -606,9 +664,6 @@ struct MEGA_API LocalNodeCore
     // null means either the entry has no shortname or it's the same as the (normal) longname
     std::unique_ptr<LocalPath> slocalname = nullptr;
 
-    // whether this node knew its shortname (otherwise it was loaded from an old db)
-    bool slocalname_in_db = false;
-
     // related cloud node, if any
     NodeHandle syncedCloudNodeHandle;
 
@@ -618,10 +673,31 @@ struct MEGA_API LocalNodeCore
     // FILENODE or FOLDERNODE
     nodetype_t type = TYPE_UNKNOWN;
 
+    // whether this node knew its shortname (otherwise it was loaded from an old db)
+    // (next to the other small members, there can be millions of LocalNodes)
+    bool slocalname_in_db = false;
+
     // Once the local and remote names match exactly (taking into account escaping), we will keep them matching
     // This is so users can, for example, change uppercase/lowercase and have that synchronized.
     bool namesSynchronized = false;
 
+    // Folders only: the directory as it was the last time its scan matched all the children.
+    // On startup, folders that still match it are rescanned after the rest of the sync.
+    struct ScanSignature
+    {
+        m_time_t mtime = 0;
+        uint32_t childCount = 0;
+
+        // identifies the mount (see Sync::mScanSignatureTag), 0 if there is no signature
+        uint32_t filesystemTag = 0;
+
+        bool operator==(const ScanSignature& other) const
+        {
+            return mtime == other.mtime && childCount == other.childCount && filesystemTag == other.filesystemTag;
+        }
+    };
+    ScanSignature scanSignature;
+
 }; // LocalNodeCore
 
 struct MEGA_API LocalNode
@@ -643,28 +719,29 @@ struct MEGA_API LocalNode
     localnode_map children;
 
     unique_ptr<LocalPath> cloneShortname() const;
-    localnode_map schildren;
+
+    // children by shortname, only allocated if any child has one
+    unique_ptr<localnode_map> schildren;
+    LocalNode* childByShortname(const LocalPath& name) const;
 
     // The last scan of the folder (for folders).
     // Removed again when the folder is fully synced.
     std::unique_ptr<vector<FSNode>> lastFolderScan;
 
     // If we can regenerate the filsystem data at this node, no need to store it, save some RAM
-    void clearRegeneratableFolderScan(SyncPath& fullPath, vector<SyncRow>& childRows);
+    void clearRegeneratableFolderScan(SyncPath& fullPath, vector<SyncRow>& childRows, const FSNode* fsNode);
 
-    fsid_localnode_map::iterator fsid_lastSynced_it;
+    // Record the state of the directory once its scan matches the children, and check it on startup
+    void updateScanSignature(const FSNode& fsNode);
+    bool scanSignatureMatches(const FSNode& fsNode) const;
 
     // we also need to track what fsid corresponded to our FSNode last time, even if not synced (not serialized)
     // if it changes, we should rescan, in case of LocalNode pre-existing with no FSNode, then one appears.  Or, now it's different
     handle fsid_asScanned = ::mega::UNDEF;
-    fsid_localnode_map::iterator fsid_asScanned_it;
 
     // Fingerprint of the file as of the last scan.  TODO: does this make LocalNode too large?
     FileFingerprint scannedFingerprint;
 
-    // related cloud node, if any
-    nodehandle_localnode_map::iterator syncedCloudNodeHandle_it;
-
     // using a per-Localnode scan delay prevents self-notifications delaying the whole sync
     dstime scanDelayUntil = 0;
     unsigned expectedSelfNotificationCount = 0;
@@ -736,6 +813,12 @@ struct MEGA_API LocalNode
         // that makes it impossible to sync properly.  The user must be informed.
         // eg. Synology SMB network drive from windows, and filenames with trailing spaces
         unsigned localFSCannotStoreThisName : 1;
+
+        // whether this node is in Syncs' localnodeBySyncedFsid, localnodeByScannedFsid and localnodeByNodeHandle.
+        // We don't keep iterators into those hashed maps, as rehashing invalidates them
+        unsigned inSyncedFsidMap : 1;
+        unsigned inScannedFsidMap : 1;
+        unsigned inNodeHandleMap : 1;
     };
 
     // Fields which are hardly ever used.
@@ -0,0 +1,366 @@
+/**
+ * @file mega/nodehandlemap.h
+ * @brief Compact open-addressing hash map keyed by NodeHandle
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+
+namespace mega {
+
+/**
+ * @brief Hash map from NodeHandle to T with stable element addresses
+ *
+ * It's a drop-in replacement for the subset of std::map<NodeHandle, T> used by the
+ * NodeManager, tuned for millions of entries:
+ *
+ *  - Values live in fixed-size chunks of slots that are never moved, so iterators,
+ *    pointers and references to elements remain valid until the element is erased
+ *    (same guarantee given by std::map). Freed slots are recycled.
+ *  - The index is a power-of-two open-addressing table of 32-bit slot numbers with
+ *    linear probing and backward-shift deletion (no tombstones). Growing the table
+ *    only rebuilds the index, elements are not touched.
+ *
+ * Node handles are random 48-bit values, but they are mixed anyway to avoid degenerate
+ * probing with non-random keys (ie. in tests).
+ *
+ * Iteration order follows the slots, not the keys.
+ */
+template<typename T>
+class NodeHandleMap
+{
+    static constexpr uint32_t SLOTS_PER_CHUNK = 1024;
+    static constexpr uint32_t EMPTY = 0;          // index entries store slot number + 1
+    static constexpr uint32_t NPOS = UINT32_MAX;
+
+public:
+    using key_type = NodeHandle;
+    using mapped_type = T;
+    using value_type = std::pair<const NodeHandle, T>;
+
+private:
+    struct Slot
+    {
+        alignas(value_type) unsigned char mStorage[sizeof(value_type)];
+        bool mUsed = false;
+        uint32_t mNextFree = NPOS;
+
+        value_type* value() { return std::launder(reinterpret_cast<value_type*>(mStorage)); }
+        const value_type* value() const { return std::launder(reinterpret_cast<const value_type*>(mStorage)); }
+    };
+
+    template<typename MapType, typename ValueType>
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = ValueType;
+        using difference_type = std::ptrdiff_t;
+        using pointer = ValueType*;
+        using reference = ValueType&;
+
+        Iterator() = default;
+
+        Iterator(MapType* map, uint32_t slot)
+          : mMap(map)
+          , mSlot(slot)
+        {
+        }
+
+        // iterator -> const_iterator
+        template<typename M, typename V>
+        Iterator(const Iterator<M, V>& other)
+          : mMap(other.mMap)
+          , mSlot(other.mSlot)
+        {
+        }
+
+        reference operator*() const { return *mMap->slot(mSlot).value(); }
+        pointer operator->() const { return mMap->slot(mSlot).value(); }
+
+        Iterator& operator++()
+        {
+            mSlot = mMap->nextUsedSlot(mSlot + 1);
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator it(*this);
+            ++*this;
+            return it;
+        }
+
+        template<typename M, typename V>
+        bool operator==(const Iterator<M, V>& rhs) const { return mSlot == rhs.mSlot; }
+
+        template<typename M, typename V>
+        bool operator!=(const Iterator<M, V>& rhs) const { return mSlot != rhs.mSlot; }
+
+    private:
+        template<typename M, typename V> friend class Iterator;
+        friend class NodeHandleMap;
+
+        MapType* mMap = nullptr;
+        uint32_t mSlot = NPOS;
+    };
+
+public:
+    using iterator = Iterator<NodeHandleMap, value_type>;
+    using const_iterator = Iterator<const NodeHandleMap, const value_type>;
+
+    NodeHandleMap() = default;
+
+    NodeHandleMap(const NodeHandleMap&) = delete;
+    NodeHandleMap& operator=(const NodeHandleMap&) = delete;
+
+    ~NodeHandleMap()
+    {
+        clear();
+    }
+
+    iterator begin() { return iterator(this, nextUsedSlot(0)); }
+    iterator end() { return iterator(this, NPOS); }
+    const_iterator begin() const { return const_iterator(this, nextUsedSlot(0)); }
+    const_iterator end() const { return const_iterator(this, NPOS); }
+
+    size_t size() const { return mSize; }
+    bool empty() const { return !mSize; }
+
+    iterator find(NodeHandle key)
+    {
+        return iterator(this, findSlot(key));
+    }
+
+    const_iterator find(NodeHandle key) const
+    {
+        return const_iterator(this, findSlot(key));
+    }
+
+    size_t count(NodeHandle key) const
+    {
+        return findSlot(key) != NPOS;
+    }
+
+    // same semantics as std::map::emplace(): if 'key' exists, 'args' are not used
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(NodeHandle key, Args&&... args)
+    {
+        uint32_t existing = findSlot(key);
+        if (existing != NPOS)
+        {
+            return std::make_pair(iterator(this, existing), false);
+        }
+
+        if ((mSize + 1) * 4 > mIndex.size() * 3)
+        {
+            rehash(mIndex.empty() ? 16 : mIndex.size() * 2);
+        }
+
+        uint32_t s = allocateSlot();
+        Slot& newSlot = slot(s);
+        new (newSlot.mStorage) value_type(std::piecewise_construct,
+                                          std::forward_as_tuple(key),
+                                          std::forward_as_tuple(std::forward<Args>(args)...));
+        newSlot.mUsed = true;
+
+        mIndex[probeForInsertion(key)] = s + 1;
+        ++mSize;
+
+        return std::make_pair(iterator(this, s), true);
+    }
+
+    T& operator[](NodeHandle key)
+    {
+        return emplace(key).first->second;
+    }
+
+    void erase(iterator it)
+    {
+        assert(it.mMap == this && it.mSlot != NPOS && slot(it.mSlot).mUsed);
+        eraseSlot(it.mSlot);
+    }
+
+    size_t erase(NodeHandle key)
+    {
+        uint32_t s = findSlot(key);
+        if (s == NPOS) return 0;
+
+        eraseSlot(s);
+        return 1;
+    }
+
+    void clear()
+    {
+        for (uint32_t s = nextUsedSlot(0); s != NPOS; s = nextUsedSlot(s + 1))
+        {
+            slot(s).value()->~value_type();
+        }
+
+        mChunks.clear();
+        mIndex.clear();
+        mSize = 0;
+        mSlotsInUse = 0;
+        mFreeList = NPOS;
+    }
+
+    // approximate number of bytes used by the container (excluding memory owned by the values)
+    size_t memoryUsage() const
+    {
+        return sizeof(*this)
+               + mChunks.capacity() * sizeof(typename decltype(mChunks)::value_type)
+               + mChunks.size() * SLOTS_PER_CHUNK * sizeof(Slot)
+               + mIndex.capacity() * sizeof(uint32_t);
+    }
+
+private:
+    std::vector<std::unique_ptr<Slot[]>> mChunks;
+    std::vector<uint32_t> mIndex;   // slot number + 1, or EMPTY
+    size_t mSize = 0;
+    uint32_t mSlotsInUse = 0;       // high-water mark of allocated slots
+    uint32_t mFreeList = NPOS;      // erased slots, ready to be reused
+
+    static size_t hash(NodeHandle key)
+    {
+        // Fibonacci hashing of the 6-byte handle
+        return static_cast<size_t>((key.as8byte() * 0x9E3779B97F4A7C15ull) >> 16);
+    }
+
+    size_t mask() const
+    {
+        return mIndex.size() - 1;
+    }
+
+    Slot& slot(uint32_t s)
+    {
+        return mChunks[s / SLOTS_PER_CHUNK][s % SLOTS_PER_CHUNK];
+    }
+
+    const Slot& slot(uint32_t s) const
+    {
+        return mChunks[s / SLOTS_PER_CHUNK][s % SLOTS_PER_CHUNK];
+    }
+
+    uint32_t nextUsedSlot(uint32_t s) const
+    {
+        for (; s < mSlotsInUse; ++s)
+        {
+            if (slot(s).mUsed) return s;
+        }
+
+        return NPOS;
+    }
+
+    uint32_t findSlot(NodeHandle key) const
+    {
+        if (mIndex.empty()) return NPOS;
+
+        for (size_t i = hash(key) & mask(); mIndex[i] != EMPTY; i = (i + 1) & mask())
+        {
+            uint32_t s = mIndex[i] - 1;
+            if (slot(s).value()->first == key)
+            {
+                return s;
+            }
+        }
+
+        return NPOS;
+    }
+
+    size_t probeForInsertion(NodeHandle key) const
+    {
+        size_t i = hash(key) & mask();
+        while (mIndex[i] != EMPTY)
+        {
+            i = (i + 1) & mask();
+        }
+
+        return i;
+    }
+
+    uint32_t allocateSlot()
+    {
+        if (mFreeList != NPOS)
+        {
+            uint32_t s = mFreeList;
+            mFreeList = slot(s).mNextFree;
+            return s;
+        }
+
+        if (mSlotsInUse == mChunks.size() * SLOTS_PER_CHUNK)
+        {
+            mChunks.emplace_back(new Slot[SLOTS_PER_CHUNK]);
+        }
+
+        return mSlotsInUse++;
+    }
+
+    void eraseSlot(uint32_t s)
+    {
+        Slot& target = slot(s);
+
+        // locate the index entry pointing to the slot
+        size_t i = hash(target.value()->first) & mask();
+        while (mIndex[i] != s + 1)
+        {
+            assert(mIndex[i] != EMPTY);
+            i = (i + 1) & mask();
+        }
+
+        // backward-shift deletion: move back the following entries of the cluster
+        // that are not in their ideal position, so lookups never need tombstones
+        for (size_t j = (i + 1) & mask(); mIndex[j] != EMPTY; j = (j + 1) & mask())
+        {
+            size_t ideal = hash(slot(mIndex[j] - 1).value()->first) & mask();
+            if (((j - ideal) & mask()) >= ((j - i) & mask()))
+            {
+                mIndex[i] = mIndex[j];
+                i = j;
+            }
+        }
+        mIndex[i] = EMPTY;
+
+        target.value()->~value_type();
+        target.mUsed = false;
+        target.mNextFree = mFreeList;
+        mFreeList = s;
+        --mSize;
+    }
+
+    void rehash(size_t newIndexSize)
+    {
+        mIndex.assign(newIndexSize, EMPTY);
+        for (uint32_t s = nextUsedSlot(0); s != NPOS; s = nextUsedSlot(s + 1))
+        {
+            mIndex[probeForInsertion(slot(s).value()->first)] = s + 1;
+        }
+    }
+};
+
+} // namespace mega
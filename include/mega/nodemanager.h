@@ -23,11 +23,20 @@
 #ifndef NODEMANAGER_H
 #define NODEMANAGER_H 1
 
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <list>
 #include <map>
 #include <limits>
+#include <optional>
 #include <set>
+#include <shared_mutex>
+#include <tuple>
 #include <vector>
 #include "node.h"
+#include "nodehandlemap.h"
 #include "types.h"
 
 namespace mega {
@@ -67,6 +76,7 @@ public:
     }
 
     void byAncestors(std::vector<handle>&& ancs) { assert(ancs.size() == 3); mLocationHandles.swap(ancs); }
+    void byName(const std::string& name) { mNameFilter = name; }
     void setIncludedShares(ShareType_t s) { mIncludedShares = s; }
 
     const std::string& byName() const { return mNameFilter; }
@@ -108,16 +118,71 @@ private:
     std::string mTagFilter;
 };
 
+// Read-only summary of a node, filled straight from the columns of the "nodes" table.
+// It's meant for listings of big folders: the Node can be created, if needed, through
+// NodeManager::getNodeByHandle(mHandle)
+struct NodeView
+{
+    NodeHandle mHandle;
+    std::string mName;
+    nodetype_t mType = TYPE_UNKNOWN;
+    m_off_t mSize = 0;
+    m_time_t mCtime = 0;
+    m_time_t mMtime = 0;
+    bool mFav = false;
+    int mLabel = 0;
+};
+
 class NodeSearchPage
 {
 public:
     NodeSearchPage(size_t startingOffset, size_t size) : mOffset(startingOffset), mSize(size) {}
+
+    // Keyset paging: the page starts right after 'lastResult', the last entry of the previous
+    // page retrieved with the same filter and order. Unlike an offset, the cost doesn't grow
+    // with the number of results already retrieved.
+    NodeSearchPage(const NodeView& lastResult, size_t size) : mOffset(0), mSize(size), mCursor(lastResult) {}
+
     const size_t& startingOffset() const { return mOffset; }
     const size_t& size() const { return mSize; }
+    const NodeView* cursor() const { return mCursor ? &*mCursor : nullptr; }
 
 private:
     size_t mOffset;
     size_t mSize;
+    std::optional<NodeView> mCursor;
+};
+
+// Read-only view of the tree at a point in time (the last commit to DB when it was taken, see
+// DBTableNodes::acquireSnapshot()), for long reads like exports or analysis of big subtrees.
+// Queries don't lock the NodeManager, and the changes applied or committed meanwhile (ie. by
+// actionpackets) aren't seen, so results are consistent among them. Nodes are returned as
+// values, which don't change: the current Node can be retrieved by NodeManager::getNodeByHandle().
+// It can be used from any thread, but its queries are serialized
+class MEGA_API NodeSnapshot
+{
+public:
+    // same as NodeManager::getChildrenViews()
+    std::vector<NodeView> getChildren(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page);
+
+    uint64_t getNumberOfChildren(NodeHandle parent);
+
+    // counter of the subtree of the node (files, folders, versions and their storage). False if it doesn't exist
+    bool getCounter(NodeHandle node, NodeCounter& counter);
+
+    bool isAncestor(NodeHandle node, NodeHandle ancestor, CancelToken cancelFlag);
+
+    // Pass the nodes below 'ancestor' (but the previous versions of files) to 'visit', each folder before
+    // its children, until it returns false. It returns false if it was stopped, cancelled or a query failed
+    bool forEachDescendant(NodeHandle ancestor, CancelToken cancelFlag, std::function<bool(const NodeView&)> visit);
+
+private:
+    friend class NodeManager;
+    explicit NodeSnapshot(std::shared_ptr<DBTableNodes> table);
+
+    // a connection of its own, which can be used by one thread at a time
+    std::shared_ptr<DBTableNodes> mTable;
+    std::mutex mMutex;
 };
 
 /**
@@ -135,6 +200,7 @@ class MEGA_API NodeManager
 {
 public:
     NodeManager(MegaClient& client);
+    ~NodeManager();
 
     // set interface to access to "nodes" table
     void setTable(DBTableNodes *table);
@@ -156,6 +222,13 @@ public:
 
     sharedNode_vector getChildren(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page);
 
+    // same as above, but nodes are neither decoded nor loaded in memory
+    std::vector<NodeView> getChildrenViews(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page);
+
+    // Snapshot of the tree as of the last commit to DB (see NodeSnapshot). nullptr while there are changes
+    // pending to commit (they wouldn't be included), and also if not supported or all the readers are in use
+    std::unique_ptr<NodeSnapshot> getSnapshot();
+
     // read children from type (folder or file) from DB and load them in memory
     sharedNode_vector getChildrenFromType(const NodeHandle &parent, nodetype_t type, CancelToken cancelToken);
 
@@ -257,6 +330,25 @@ public:
     // update the counter of 'n' when its parent is updated (from 'oldParent' to 'n.parent')
     void updateCounter(std::shared_ptr<Node> n, std::shared_ptr<Node> oldParent);
 
+    // While a batch is alive, the changes of counters caused by added and moved nodes are
+    // accumulated at the parent they were applied to, and propagated to the ancestors when
+    // the last batch ends (or before counters are read). Every ancestor is updated once,
+    // instead of once per node of the batch.
+    // The propagation is linear, so it gives the same result even if the tree changes again
+    // before the batch ends: pending changes follow the ancestors at the end of the batch.
+    class TreeUpdateBatch
+    {
+    public:
+        explicit TreeUpdateBatch(NodeManager& nodeManager);
+        ~TreeUpdateBatch();
+
+        TreeUpdateBatch(const TreeUpdateBatch&) = delete;
+        TreeUpdateBatch& operator=(const TreeUpdateBatch&) = delete;
+
+    private:
+        NodeManager& mNodeManager;
+    };
+
     // true if 'h' is a rootnode: cloud, inbox or rubbish bin
     bool isRootNode(NodeHandle h) const;
 
@@ -269,7 +361,6 @@ public:
     // Remove fingerprint from mFingerprint
     void removeFingerprint(Node* node, bool unloadNode = false);
     FingerprintPosition invalidFingerprintPos();
-    std::list<std::shared_ptr<Node>>::const_iterator invalidCacheLRUPos() const;
 
     // Node has received last updates and it's ready to store in DB
     void saveNodeInDb(Node *node);
@@ -288,6 +379,9 @@ public:
     // Returns the number of versions for a node (including the current version)
     int getNumVersions(NodeHandle nodeHandle);
 
+    // Returns the versions of a file, starting with the file itself (the current version)
+    sharedNode_vector getVersions(NodeHandle fileHandle);
+
     NodeHandle getRootNodeFiles() const;
     NodeHandle getRootNodeVault() const;
     NodeHandle getRootNodeRubbish() const;
@@ -304,7 +398,7 @@ public:
 
     std::shared_ptr<Node> getNodeFromNodeManagerNode(NodeManagerNode& nodeManagerNode);
 
-    void insertNodeCacheLRU(std::shared_ptr<Node> node);
+    void insertNodeCacheLRU(const std::shared_ptr<Node>& node);
 
     void increaseNumNodesInRam();
     void decreaseNumNodesInRam();
@@ -314,9 +408,48 @@ public:
 
     uint64_t getNumNodesAtCacheLRU() const;
 
+    // Replacement policy of the cache LRU
+    enum class CacheLRUPolicy
+    {
+        // strict least-recently-used order: every hit moves the node to the front
+        LRU = 0,
+        // CLOCK (second chance): hits only flag the node, which is moved to the front
+        // when it reaches the back of the cache instead of being evicted
+        CLOCK = 1,
+    };
+
+    CacheLRUPolicy getCacheLRUPolicy() const;
+    void setCacheLRUPolicy(CacheLRUPolicy policy);
+
+    // Accesses to nodes already at the cache LRU (hits) and to nodes that had to be
+    // (re)inserted into it (misses), since the NodeManager was created
+    uint64_t getCacheLRUHits() const;
+    uint64_t getCacheLRUMisses() const;
+
+    // Speculative prefetch of the folders likely to be opened next: after a listing (see prefetchChildren()),
+    // the children of up to 'folders' of the subfolders listed are loaded at the cache LRU and their children
+    // index is built, by a thread of the NodeManager. 0 (the default) disables it.
+    void setChildrenPrefetch(unsigned folders);
+    unsigned getChildrenPrefetch() const;
+
+    // Start the prefetch of the folders among the 'listed' nodes, the most recently created and the
+    // biggest ones first. It cancels the prefetch started by the previous listing, if still running
+    void prefetchChildren(const sharedNode_vector& listed);
+
+    // Time the standard workloads on the local database (counting nodes, listing the
+    // children of the Cloud root, searching by name, recent nodes and fingerprint lookups)
+    // so DB performance profiles can be compared on the device. Nodes in RAM aren't used,
+    // every query runs against the DB. Results are the average duration of 'repetitions'
+    // runs of each workload, in the order they were executed.
+    std::vector<std::pair<std::string, std::chrono::microseconds>> benchmarkDbQueries(unsigned repetitions);
+
     // true when the filesystem has been initialized
     bool ready();
 
+    // Drop the entry of 'h' from the index of nodes in RAM, only if the node it refers to is gone.
+    // It's called upon Node destruction, so it doesn't require the main mutex to be locked.
+    void removeExpiredNodeFromRamIndex(NodeHandle h);
+
 private:
     MegaClient& mClient;
 
@@ -361,11 +494,118 @@ private:
         std::set<FileFingerprint, FileFingerprintCmp> mAllFingerprintsLoaded;
     };
 
+    // Bloom filter of the fingerprints stored in DB, so lookups of fingerprints that aren't there
+    // (ie. every new file found by a sync) don't need a query. It's built upon the first lookup,
+    // and updated as nodes are written to DB. A false positive only costs the query
+    class FingerprintFilter
+    {
+    public:
+        bool isBuilt() const { return !mBits.empty(); }
+
+        // 'expectedEntries' are going to be added (more can be added later, see add())
+        void build(size_t expectedEntries);
+
+        // no-op if it isn't built. When it gets too full, it's cleared so it's rebuilt bigger
+        void add(const std::string& fingerprint);
+
+        bool mayContain(const std::string& fingerprint) const;
+        void clear();
+
+    private:
+        static constexpr size_t BITS_PER_ENTRY = 16;   // with 4 probes, ~0.25% of false positives
+        static constexpr unsigned NUM_PROBES = 4;
+
+        std::vector<uint64_t> mBits;
+        size_t mCapacity = 0;
+        size_t mEntries = 0;
+
+        // probes are h1 + i * h2 (double hashing)
+        static std::pair<uint64_t, uint64_t> hash(const std::string& fingerprint);
+    };
+
     // Stores nodes that have been loaded in RAM from DB (not necessarily all of them)
-    std::map<NodeHandle, NodeManagerNode> mNodes;
+    NodeHandleMap<NodeManagerNode> mNodes;
+
+    // Lock-striped index of the nodes currently loaded in RAM (a subset of `mNodes`).
+    // Lookups only take a shared lock on the stripe the handle maps to, so getNodeByHandle()
+    // can resolve nodes in RAM without waiting for the main mutex, which may be held for a long
+    // time by the SDK thread (ie. while processing actionpackets).
+    // Writers must hold the main mutex as well, so the index is consistent with `mNodes`.
+    class NodeRamIndex
+    {
+    public:
+        std::shared_ptr<Node> find(NodeHandle h) const;
+        void insert(const std::shared_ptr<Node>& node);
+        void erase(NodeHandle h);
+        void eraseIfExpired(NodeHandle h);
+        void clear();
+
+    private:
+        static constexpr size_t NUM_STRIPES = 64;
+
+        struct Stripe
+        {
+            mutable std::shared_mutex mMutex;
+            NodeHandleMap<std::weak_ptr<Node>> mNodes;
+        };
+
+        Stripe& stripe(NodeHandle h);
+        const Stripe& stripe(NodeHandle h) const;
+
+        std::array<Stripe, NUM_STRIPES> mStripes;
+    } mNodeRamIndex;
 
     uint64_t mCacheLRUMaxSize = std::numeric_limits<uint64_t>::max();
-    std::list<std::shared_ptr<Node> > mCacheLRU;
+
+    // Intrusive doubly linked list of the NodeManagerNode at cache LRU (most recent at front).
+    // NodeManagerNode are never moved by `mNodes`, so the links remain valid.
+    class CacheLRU
+    {
+    public:
+        bool contains(const NodeManagerNode& entry) const { return entry.isAtCacheLRU(); }
+
+        // link 'entry' at the front, keeping 'node' in RAM while it's at the cache
+        void pushFront(NodeManagerNode& entry, const std::shared_ptr<Node>& node);
+        void moveToFront(NodeManagerNode& entry);
+        // unlink 'entry' and return the reference that kept the node in RAM
+        std::shared_ptr<Node> remove(NodeManagerNode& entry);
+
+        NodeManagerNode* back() const { return mTail; }
+        uint64_t size() const { return mSize; }
+        void clear();
+
+    private:
+        void link(NodeManagerNode& entry);
+        void unlink(NodeManagerNode& entry);
+
+        NodeManagerNode* mHead = nullptr;
+        NodeManagerNode* mTail = nullptr;
+        uint64_t mSize = 0;
+    } mCacheLRU;
+
+    CacheLRUPolicy mCacheLRUPolicy = CacheLRUPolicy::LRU;
+    std::atomic<uint64_t> mCacheLRUHits{0};
+    std::atomic<uint64_t> mCacheLRUMisses{0};
+
+    // Prefetch of children (see setChildrenPrefetch()). It runs on a thread of its own, started upon the first
+    // round, since it waits for mMutex: the workers of MegaClient::mAsyncQueue may be needed by the thread
+    // holding it. Only the last round is pending or running, the previous one is cancelled
+    std::atomic<unsigned> mChildrenPrefetchFolders{0};
+    std::mutex mChildrenPrefetchMutex;
+    std::condition_variable mChildrenPrefetchCondition;
+    std::vector<NodeHandle> mChildrenPrefetchPending;
+    CancelToken mChildrenPrefetchCancel;
+    bool mChildrenPrefetchExit = false;
+    std::thread mChildrenPrefetchThread;
+    void childrenPrefetchLoop();
+
+    // nodes loaded by a round: a quarter of the cache LRU at most, so it doesn't evict the nodes in use
+    static constexpr uint64_t MAX_CHILDREN_PREFETCH_NODES = 5000;
+    uint64_t childrenPrefetchBudget() const;
+
+    // run by the thread of the prefetch, without mMutex locked
+    void runChildrenPrefetch(const std::vector<NodeHandle>& folders, CancelToken cancelToken);
+    void cancelChildrenPrefetch();
 
     std::atomic<uint64_t> mNodesInRam;
 
@@ -388,6 +628,68 @@ private:
     // If operationType is INCREASE, nc is added, in other case is decreased (ie. upon deletion)
     void updateTreeCounter(std::shared_ptr<Node> origin, NodeCounter nc, OperationType operation, sharedNode_vector* nodesToReport);
 
+    // number of alive TreeUpdateBatch
+    unsigned mTreeUpdateBatches = 0;
+
+    // changes of counters not propagated yet, by the node they were applied to
+    struct PendingCounterChange
+    {
+        std::shared_ptr<Node> mNode;
+        NodeCounter mIncrease;
+        NodeCounter mDecrease;
+    };
+    std::map<NodeHandle, PendingCounterChange> mPendingCounterChanges;
+
+    // apply the pending changes of counters to the nodes and their ancestors (deepest first)
+    void applyPendingCounterChanges_internal();
+
+    // Handle, type and name of all the children of a folder, sorted by type and name, so
+    // childNodeByNameType() doesn't query the DB for folders whose children aren't all in RAM.
+    // Built from the DB, so it's dropped whenever the DB rows of the children may change
+    // (children added, removed or written). Matches are checked against the node.
+    struct ChildrenIndex
+    {
+        struct Entry
+        {
+            nodetype_t mType;
+            std::string mName;
+            NodeHandle mHandle;
+
+            bool operator<(const Entry& other) const
+            {
+                return std::tie(mType, mName) < std::tie(other.mType, other.mName);
+            }
+        };
+
+        std::vector<Entry> mEntries;
+        std::list<NodeHandle>::iterator mLRUPosition;
+    };
+    std::map<NodeHandle, ChildrenIndex> mChildrenIndexes;
+    std::list<NodeHandle> mChildrenIndexLRU;   // most recently used first
+    size_t mChildrenIndexEntries = 0;
+
+    // Files and folders directly under the folders asked by getNumberOfChildrenByType, which apps
+    // call for every folder they show. Dropped with the children index of the folder, when its children change.
+    std::map<NodeHandle, std::array<size_t, 2>> mChildrenTypeCounts;
+    static constexpr size_t MAX_CHILDREN_TYPE_COUNTS = 10000;
+
+    // Parent the DB row of a moved node still refers to, until the node is written or removed from DB:
+    // the children index and counts of that parent, built meanwhile, include the node and are dropped then
+    std::map<NodeHandle, NodeHandle> mParentsInDbOfMovedNodes;
+
+    // drop the children index and counts of the parent the DB row of 'node' refers to, and those of its new parent
+    void invalidateParentsInDb_internal(NodeHandle node, NodeHandle parent);
+
+    // entries of all the indexes together, unless the cache LRU is smaller
+    static constexpr size_t MAX_CHILDREN_INDEX_ENTRIES = 100000;
+    static constexpr uint64_t CHILDREN_INDEX_ENTRIES_PER_NODE = 4;
+    size_t childrenIndexBudget() const;
+
+    // nullptr if the folder has more children than the budget
+    const ChildrenIndex* getChildrenIndex_internal(const Node& parent);
+    void invalidateChildrenIndex_internal(NodeHandle parent);
+    void trimChildrenIndexes_internal(size_t budget);
+
     // returns nullptr if there are unserialization errors. Also triggers a full reload (fetchnodes)
     shared_ptr<Node> getNodeFromNodeSerialized(const NodeSerialized& nodeSerialized);
 
@@ -400,6 +702,12 @@ private:
     // Container storing FileFingerprint* (Node* in practice) ordered by fingerprint
     FingerprintContainer mFingerPrints;
 
+    // Fingerprints of all the nodes in DB (see FingerprintFilter)
+    FingerprintFilter mFingerprintFilter;
+
+    // false if no node in DB has the serialized 'fingerprint' (it builds mFingerprintFilter if needed)
+    bool fingerprintMayBeInDb(const std::string& fingerprint);
+
     // Return a node from Data base, node shouldn't be in RAM previously
     shared_ptr<Node> getNodeFromDataBase(NodeHandle handle);
 
@@ -412,15 +720,54 @@ private:
     // If a valid object is passed, it must be kept alive until this method returns.
     sharedNode_vector processUnserializedNodes(const std::vector<std::pair<NodeHandle, NodeSerialized>>& nodesFromTable, NodeHandle ancestorHandle = NodeHandle(), CancelToken cancelFlag = CancelToken());
 
+    // Check if ancestorHandle is an ancestor of a node not loaded in RAM, using the parent
+    // handle from its serialized header before falling back to a recursive query in DB
+    bool isAncestorOfSerializedNode(NodeHandle handle, const NodeSerialized& nodeSerialized, NodeHandle ancestorHandle, CancelToken cancelFlag);
+
     sharedNode_vector searchNodes_internal(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page);
     sharedNode_vector processUnserializedNodes(const std::vector<std::pair<NodeHandle, NodeSerialized>>& nodesFromTable, CancelToken cancelFlag);
     sharedNode_vector getChildren_internal(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page);
 
+    // Validate the filter and check in RAM whether the db look-up can be skipped: false if nothing can match
+    bool searchMayMatch_internal(const NodeSearchFilter& filter);
+    bool childrenMayMatch_internal(const NodeSearchFilter& filter);
+
+    // Searches and listings run their db look-up through a reader (see DBTableNodes::acquireReader())
+    // without holding mMutex, so they don't block each other nor the SDK thread. If none is
+    // available, they query mTable with the mutex locked as usual
+    std::shared_ptr<DBTableNodes> acquireReader_internal();
+
+    // Same as processUnserializedNodes(), for rows read by a reader: nodes not loaded in RAM
+    // are read again from mTable, which includes the changes not committed yet
+    sharedNode_vector processNodesFromReader(const std::vector<std::pair<NodeHandle, NodeSerialized>>& nodesFromTable, CancelToken cancelFlag);
+
     // node temporary in memory, which will be removed upon write to DB
     std::shared_ptr<Node> mNodeToWriteInDb;
 
+    // Nodes received by fetchnodes that are written to DB without being kept in RAM: instead of an
+    // entry at `mNodes` (and at the children of its parent), only the relationship with their parent
+    // is kept, so the whole tree is not materialized in RAM during the fetch. It's only needed to
+    // calculate the node counters upon initCompleted(), and released afterwards.
+    struct StreamedNode
+    {
+        NodeHandle mParent;
+        NodeHandle mNode;
+    };
+    std::vector<StreamedNode> mStreamedNodes;
+    // true once `mStreamedNodes` are sorted by parent, ready for look-ups
+    bool mStreamedNodesSorted = false;
+
     // Stores (or updates) the node in the DB. It also tries to decrypt it for the last time before storing it.
-    void putNodeInDb(Node* node) const;
+    void putNodeInDb(Node* node);
+
+    // Same as above for several nodes, which are written in a row to the DB
+    void putNodesInDb(const sharedNode_vector& nodes);
+
+    // Last attempt to decrypt the node before storing it
+    void prepareNodeForDb(Node* node) const;
+
+    // True if 'node' is notified for no other reason than an update of its counter
+    static bool onlyChangedCounter(const Node& node);
 
     // true when the NodeManager has been inicialized and contains a valid filesystem
     bool mInitialized = false;
@@ -472,6 +819,10 @@ private:
     void cleanNodes_internal();
     std::shared_ptr<Node> getNodeFromBlob_internal(const string* nodeSerialized);
     void applyKeys_internal(uint32_t appliedKeys);
+
+    // run Node::decryptKeyAndAttrs() for the jobs, in batches at the client's worker threads
+    static constexpr size_t KEY_DECRYPTION_BATCH_SIZE = 256;
+    void decryptKeys(std::vector<Node::KeyDecryption>& jobs);
     void notifyNode_internal(std::shared_ptr<Node> node, sharedNode_vector* nodesToReport);
     bool loadNodes_internal();
     uint64_t getNodeCount_internal();
@@ -488,7 +839,7 @@ private:
     void setRootNodeVault_internal(NodeHandle h);
     void setRootNodeRubbish_internal(NodeHandle h);
     void initCompleted_internal();
-    void insertNodeCacheLRU_internal(std::shared_ptr<Node> node);
+    void insertNodeCacheLRU_internal(const std::shared_ptr<Node>& node);
     void unLoadNodeFromCacheLRU();
 };
 
@@ -47,7 +47,8 @@ public:
 
     DirNotify* newdirnotify(LocalNode& root,
                             const LocalPath& rootPath,
-                            Waiter* waiter) override;
+                            Waiter* waiter,
+                            const DirNotify::ResumePoint& resumeFrom) override;
 #endif // ENABLE_SYNC
 
 private:
@@ -71,15 +72,21 @@ public:
     MacDirNotify(MacFileSystemAccess& owner,
                  LocalNode& root,
                  const LocalPath& rootPath,
-                 Waiter& waiter);
+                 Waiter& waiter,
+                 const ResumePoint& resumeFrom);
 
     ~MacDirNotify();
 
+    ResumePoint resumePoint() const override;
+
+    bool replaysChanges() const override;
+
 private:
     // Invoked by the trampoline.
     void callback(const FSEventStreamEventFlags* flags,
                   std::size_t numEvents,
-                  const char** paths);
+                  const char** paths,
+                  const FSEventStreamEventId* ids);
 
     // Invoked by the run loop when it receives a filesystem event.
     static void trampoline(ConstFSEventStreamRef stream,
@@ -103,6 +110,15 @@ private:
 
     // How we tell the engine it has work to do.
     Waiter& mWaiter;
+
+    // Identifies the FSEvents journal of the root's volume (empty if it has none).
+    std::string mJournalID;
+
+    // Latest event passed to the engine.
+    std::atomic<FSEventStreamEventId> mLastEventID;
+
+    // Are the events since the last run replayed?
+    bool mReplaysChanges = false;
 }; // MacDirNotify
 
 #endif // ENABLE_SYNC
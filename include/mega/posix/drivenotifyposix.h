@@ -29,6 +29,7 @@
 
 #include <thread>
 #include <atomic>
+#include <chrono>
 #include <map>
 
 struct udev;
@@ -56,9 +57,15 @@ private:
     void evaluateDevice(udev_device* dev);  // dev must Not be null
     std::string getMountPoint(const std::string& device);
 
+    // look up the mount points of the partitions added but not mounted yet
+    void checkPendingMounts();
+
     udev* mUdev = nullptr;
     udev_monitor* mUdevMon = nullptr;
     std::map<std::string, std::string> mMounted;
+
+    // partitions added but not mounted yet, and when to stop waiting for their mount point
+    std::map<std::string, std::chrono::steady_clock::time_point> mPendingMounts;
 };
 
 } // namespace
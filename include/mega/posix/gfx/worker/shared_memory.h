@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace mega {
+namespace gfx {
+
+// A named POSIX shared memory object mapped in this process
+class SharedMemory
+{
+public:
+    SharedMemory(const SharedMemory&) = delete;
+
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    ~SharedMemory();
+
+    // create a new one, removed from the system once this instance is destroyed
+    static std::unique_ptr<SharedMemory> create(const std::string& name, size_t size);
+
+    // map an existing one, with the size it was created with
+    static std::unique_ptr<SharedMemory> open(const std::string& name);
+
+    uint8_t* data() const { return static_cast<uint8_t*>(mData); }
+
+    size_t size() const { return mSize; }
+
+    const std::string& name() const { return mName; }
+
+private:
+    SharedMemory(const std::string& name, void* data, size_t size, bool owner);
+
+    // the name of the object for shm_open
+    static std::string toShmName(const std::string& name);
+
+    std::string mName;
+
+    void* mData = nullptr;
+
+    size_t mSize = 0;
+
+    // whether it's unlinked on destruction
+    bool mOwner = false;
+};
+
+} // namespace
+}
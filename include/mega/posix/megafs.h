@@ -37,6 +37,13 @@
 
 #ifdef HAVE_AIO_RT
 #include <aio.h>
+
+// io_uring is preferred to POSIX AIO where available (glibc emulates AIO with a thread per operation).
+// Android is excluded: its seccomp policy doesn't allow io_uring for apps.
+#if defined(HAVE_LINUX_IO_URING_H) && !defined(__ANDROID__)
+#define USE_IO_URING 1
+#include <sys/uio.h>
+#endif
 #endif
 
 #include "mega.h"
@@ -117,7 +124,10 @@ public:
                              map<LocalPath, FSNode>& known,
                              std::vector<FSNode>& results,
                              bool followSymLinks,
-                             unsigned& nFingerprinted) override;
+                             unsigned& nFingerprinted,
+                             std::vector<size_t>* unfingerprinted) override;
+
+    bool fingerprintScannedFile(const LocalPath& path, FileFingerprint& fingerprint) override;
 
 #ifdef ENABLE_SYNC
     bool fsStableIDs(const LocalPath& path) const override;
@@ -137,6 +147,12 @@ struct MEGA_API PosixAsyncIOContext : public AsyncIOContext
     void finish() override;
 
     struct aiocb *aiocb;
+
+#ifdef USE_IO_URING
+    // true while the operation is submitted to io_uring (aiocb is not used then)
+    bool inIoUring = false;
+    struct iovec iov;
+#endif
 };
 #endif
 
@@ -144,6 +160,10 @@ class MEGA_API PosixFileAccess : public FileAccess
 {
 private:
     int fd;
+    int mDirectFd = -1;   // same file opened with O_DIRECT, for aligned writes (see enableDirectWrites())
+
+    int writeDescriptor(const byte*, unsigned, m_off_t) const;
+    void closeDirectDescriptor();
 public:
     int stealFileDescriptor();
     int defaultfilepermissions;
@@ -166,6 +186,10 @@ public:
 
     bool ftruncate(m_off_t size) override;
 
+    bool enableDirectWrites() override;
+
+    bool fpreallocate(m_off_t size) override;
+
     bool sysread(byte *, unsigned, m_off_t) override;
     bool sysstat(m_time_t*, m_off_t*, FSLogging) override;
     bool sysopen(bool async, FSLogging) override;
@@ -214,7 +238,8 @@ public:
 
     DirNotify* newdirnotify(LocalNode& root,
                             const LocalPath& rootPath,
-                            Waiter* waiter) override;
+                            Waiter* waiter,
+                            const DirNotify::ResumePoint& resumeFrom) override;
 
 private:
     // Tracks which notifiers were created by this instance.
@@ -226,6 +251,36 @@ private:
     // Tracks which nodes are associated with what inotify handle.
     WatchMap mWatches;
 
+#ifdef USE_FANOTIFY
+    // Filesystem marked for a notifier.
+    struct FanotifyMark
+    {
+        // Path used to place (and later remove) the mark.
+        string mPath;
+
+        // How many notifiers rely on this mark.
+        unsigned mNotifiers = 0;
+    }; // FanotifyMark
+
+    // Fanotify descriptor, only valid if we're allowed to mark whole filesystems.
+    int mFanotifyFd = -EINVAL;
+
+    // Marked filesystems, keyed by their kernel fsid.
+    map<string, FanotifyMark> mFanotifyMarks;
+
+    // Maps a directory's file handle to the (negative) watch handle used in mWatches.
+    map<string, int> mFanotifyHandles;
+
+    // Reverse of the above, so we can release handles.
+    map<int, string> mFanotifyHandleKeys;
+
+    // Next watch handle to issue for a directory file handle.
+    int mNextFanotifyHandle = -1;
+
+    // Releases a fanotify watch handle no longer used by any node.
+    void releaseFanotifyHandle(int handle);
+#endif // USE_FANOTIFY
+
 #endif // ENABLE_SYNC
 }; // LinuxFileSystemAccess
 
@@ -251,6 +306,14 @@ public:
     void removeWatch(WatchMapIterator entry);
 
 private:
+#ifdef USE_FANOTIFY
+    // Computes the key identifying a directory in fanotify events.
+    bool fanotifyHandleKey(const LocalPath& path, string& key) const;
+
+    // Fsid of the filesystem we've marked, empty if we're using inotify.
+    string mFanotifyFsid;
+#endif // USE_FANOTIFY
+
     // The LFSA that we are associated with.
     LinuxFileSystemAccess& mOwner;
 
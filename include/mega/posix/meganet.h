@@ -92,6 +92,7 @@ protected:
     CURLM* curlm[3];
 
     CURLSH* curlsh;
+    void initcurlshare();
 #ifdef MEGA_USE_C_ARES
     ares_channel ares;
 #endif
@@ -111,6 +112,15 @@ protected:
     std::map<string, CurlDNSEntry> dnscache;
     int pkpErrors;
 
+    // DNS records shared by all the instances of the process
+    static std::mutex shareddnsMutex;
+    static std::map<string, CurlDNSEntry> shareddnscache;
+    string shareddnskey(const string& host) const;
+    void publishdnsentry(const string& host, const CurlDNSEntry&);
+    bool fetchshareddnsentry(const string& host, CurlDNSEntry&);
+    void invalidateshareddnsentry(const string& host, const string& ip, bool ipv6);
+    void purgeshareddnscache();
+
     void send_pending_requests();
     void drop_pending_requests();
 
@@ -196,10 +206,21 @@ protected:
     SockInfoMap curlsockets[3];
     m_time_t curltimeoutreset[3];
     bool arerequestspaused[3];
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+    // curl sockets of each direction registered in the waiter
+    bool curlsocketswatched[3] = { false, false, false };
+#endif
     int numconnections[3];
     set<CURL *>pausedrequests[3];
-    m_off_t partialdata[2];
-    m_off_t maxspeed[2];
+
+    // download and upload limits, shared between the traffic classes of the requests
+    BandwidthScheduler bandwidth[2];
+    void resumepausedrequests(direction_t d);
+    bool allrequestspaused(direction_t d) const;
+
+    // multiplex requests over HTTP/2 connections when the server supports it
+    bool http2 = false;
+    void applyhttp2();
 
 public:
     void post(HttpReq*, const char* = 0, unsigned = 0) override;
@@ -231,14 +252,25 @@ public:
     // get max upload speed
     m_off_t getmaxuploadspeed() override;
 
+    // multiplex requests to the same host over HTTP/2 connections
+    bool sethttp2(bool enable) override;
+
+    // check if requests are multiplexed over HTTP/2 connections
+    bool gethttp2() override;
+
     bool cacheresolvedurls(const std::vector<string>& urls, std::vector<string>&& ips) override;
 
+    void prefetchdns(const std::vector<string>& urls) override;
+
     CurlHttpIO();
     ~CurlHttpIO();
 
 #ifdef WIN32
     HANDLE mSocketsWaitEvent;
     bool mSocketsWaitEvent_curl_call_needed = false;
+
+    // whether the sockets of each direction may have network events, since the sockets event was signalled
+    std::array<bool, 3> mSocketsWaitEvent_signalled{};
 #endif
 
 private:
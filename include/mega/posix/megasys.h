@@ -111,6 +111,15 @@
     #include <sys/inotify.h>
 #endif
 
+// Whole-filesystem notifications, used instead of per-directory inotify watches when we're permitted.
+// Android is excluded: marking a filesystem requires CAP_SYS_ADMIN.
+#if defined(USE_INOTIFY) && defined(HAVE_SYS_FANOTIFY_H) && !defined(__ANDROID__)
+    #include <sys/fanotify.h>
+    #ifdef FAN_REPORT_DFID_NAME
+        #define USE_FANOTIFY 1
+    #endif
+#endif
+
 #include <sys/select.h>
 
 #include <curl/curl.h>
@@ -23,9 +23,21 @@
 #define WAIT_CLASS PosixWaiter
 
 #include "mega/waiter.h"
+#include <atomic>
 #include <mutex>
+#include <unordered_map>
 
+// epoll (Linux) or kqueue (macOS/BSD) keep the registered sockets in the kernel, so the
+// cost of a wakeup does not depend on the number of sockets (no FD_SETSIZE limit either)
 #ifndef USE_POLL
+    #if defined(HAVE_SYS_EPOLL_H)
+        #define USE_EPOLL 1
+    #elif defined(HAVE_SYS_EVENT_H)
+        #define USE_KQUEUE 1
+    #endif
+#endif
+
+#if !defined(USE_POLL) && !defined(USE_EPOLL) && !defined(USE_KQUEUE)
     #define MEGA_FD_ZERO FD_ZERO
     #define MEGA_FD_SET FD_SET
     #define MEGA_FD_ISSET FD_ISSET
@@ -36,9 +48,11 @@
     #define MEGA_FD_SET PosixWaiter::fdset
     #define MEGA_FD_ISSET PosixWaiter::fdisset
 
+#ifdef USE_POLL
     #define POLLIN_SET  (POLLRDNORM | POLLRDBAND | POLLIN | POLLHUP | POLLERR) // Ready for reading
     #define POLLOUT_SET (POLLWRBAND | POLLWRNORM | POLLOUT | POLLERR) // Ready for writing
     #define POLLEX_SET  (POLLPRI) // Exceptional condition
+#endif
     typedef std::set<int> mega_fd_set_t ;
 
 #endif
@@ -51,10 +65,11 @@ struct PosixWaiter : public Waiter
 
     int maxfd;
 
+    // fds to wait for in the current cycle. After wait(), only the ready ones remain set.
     mega_fd_set_t rfds, wfds, efds;
     mega_fd_set_t ignorefds;
 
-#ifdef USE_POLL
+#if defined(USE_POLL) || defined(USE_EPOLL) || defined(USE_KQUEUE)
 
     static void clear_fdset(mega_fd_set_t *s)
     {
@@ -78,10 +93,62 @@ struct PosixWaiter : public Waiter
 
     void notify();
 
+    enum
+    {
+        WATCH_READ = 1,
+        WATCH_WRITE = 2
+    };
+
+    // true if fds can be registered once with watchfd() instead of in every cycle
+    static constexpr bool persistentfds()
+    {
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // (un)register an fd across cycles (WATCH_* bitmask, 0 to stop watching it).
+    // Ready fds are reported in rfds/wfds after wait(), like the per-cycle ones.
+    // Only the groups enabled with enablegroup() in the current cycle are waited for.
+    void watchfd(int fd, int events, int group);
+
+    // wait for the fds of the group in the current cycle
+    void enablegroup(int group);
+
 protected:
     int m_pipe[2];
     std::mutex mMutex;
-    bool alreadyNotified = false;
+    std::atomic<bool> alreadyNotified{false};
+
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+    struct WatchedFd
+    {
+        int events = 0;
+        int group = 0;
+    };
+
+    // epoll/kqueue descriptor
+    int mPollFd = -1;
+
+    // fds registered by watchfd()
+    std::unordered_map<int, WatchedFd> mWatched;
+
+    // fds added to rfds/wfds/efds in the previous cycle, and the events requested for them
+    std::unordered_map<int, int> mCycleFds;
+
+    // events currently registered in the kernel, per fd
+    std::unordered_map<int, int> mKernelFds;
+
+    // groups enabled in the current cycle, and the ones applied to the kernel
+    unsigned mEnabledGroups = 0;
+    unsigned mKernelGroups = 0;
+
+    int desiredevents(int fd) const;
+    void updatekernel(int fd, bool rearm);
+    void updatecyclefds();
+#endif
 };
 } // namespace
 
@@ -142,6 +142,19 @@ namespace mega {
         // returns how far we are through the file on average, including uncombined data
         m_off_t progress() const;
 
+        // Interleave the sectors of the 5 data parts (parts[1..5]) into raid lines. `partslen` bytes of
+        // each part are consumed (a multiple of RAIDSECTOR). A missing data part (nullptr) is recovered
+        // from the parity (parts[0]) and the others. Uses SSE2/AVX2/NEON kernels when the CPU supports them.
+        static void combineRaidLines(byte* dest, const byte* const parts[RAIDPARTS], size_t partslen);
+
+        // Recover the sector of data part `missing` (1..5) in each of `numLines` consecutive raid lines, already
+        // interleaved in `lines`, from the other sectors of the line and its parity sector (`parity` holds one per line).
+        // Uses SSE2/AVX2/NEON kernels when the CPU supports them.
+        static void recoverRaidLines(byte* lines, const byte* parity, unsigned missing, size_t numLines);
+
+        // dest[i] ^= src[i] for i in [0, n)
+        static void xorBytes(byte* dest, const byte* src, size_t n);
+
         RaidBufferManager();
         ~RaidBufferManager();
 
@@ -208,7 +221,6 @@ namespace mega {
         // take raid input part buffers and combine to form the asyncoutputbuffers
         void combineRaidParts(unsigned connectionNum);
         FilePiece* combineRaidParts(size_t partslen, size_t bufflen, m_off_t filepos, FilePiece& prevleftoverchunk);
-        void recoverSectorFromParity(byte* dest, byte* inputbufs[], unsigned offset);
         void combineLastRaidLine(byte* dest, size_t nbytes);
         void rollInputBuffers(size_t dataToDiscard);
         virtual void bufferWriteCompletedAction(FilePiece& r);
@@ -268,6 +280,27 @@ namespace mega {
         friend class DebugTestHook;
     };
 
+    // Memory for the buffers of the requests of all the transfer slots (shared by the MegaClient).
+    // Slots reserve the size of each new request, and wait while the budget is used up, so that
+    // many concurrent transfers slow down instead of growing memory without bounds.
+    // The first request of each slot is always granted, so every transfer keeps moving.
+    class MEGA_API TransferBufferBudget
+    {
+    public:
+        // 0 means no limit
+        void setLimit(m_off_t limit) { mLimit = limit; }
+        m_off_t limit() const { return mLimit; }
+        m_off_t used() const { return mUsed; }
+
+        // reserves 'size' bytes if they fit in the limit, or whenever 'mustGrant'
+        bool acquire(m_off_t size, bool mustGrant);
+        void release(m_off_t size);
+
+    private:
+        m_off_t mLimit = 0;
+        m_off_t mUsed = 0;
+    };
+
     class MEGA_API CloudRaid
     {
     private:
@@ -51,6 +51,38 @@ using raidTime = ::mega::dstime;
 class RaidReq;
 class RaidReqPool;
 
+/**
+ * Rolling model of the throughput of the connection of a part.
+ *
+ * Every completed request is a sample of 'latency + bytes / bandwidth' milliseconds. Exponentially
+ * weighted moments of the samples give the current throughput and, when request sizes vary enough,
+ * the per-request latency (the cost of starting the fetch on another connection).
+ */
+class PartThroughput
+{
+    double mBytes{};                                          // rolling average of request sizes
+    double mMs{};                                             // rolling average of request times
+    double mBytesSq{};                                        // rolling average of squared request sizes
+    double mBytesMs{};                                        // rolling average of request sizes by times
+    unsigned mSamples{};                                      // number of samples since the last reset
+
+public:
+    static constexpr double SAMPLE_WEIGHT = 0.25;             // weight of the latest sample in the rolling averages
+    static constexpr unsigned MIN_SAMPLES = 4;                // samples needed for predictions
+
+    void addSample(m_off_t bytes, int64_t ms);                // account a completed request of 'bytes' that took 'ms' milliseconds
+    void reset();                                             // forget the samples (ie. the connection has been replaced)
+    unsigned samples() const { return mSamples; }
+    double bytesPerMs() const;                                // rolling throughput, 0 without samples
+    double latencyMs() const;                                 // rolling per-request latency, 0 if it can't be told apart from the transfer time
+    double predictedMs(m_off_t rem) const;                    // predicted time to receive 'rem' more bytes at the current throughput
+};
+
+// Part predicted to finish last among the non-null 'models' with enough samples and pending 'rem' bytes, if handing its data over to a
+// fresh connection (reconstructing it from parity) is predicted to finish significantly sooner. RAIDPARTS otherwise.
+// The fresh connection is expected to perform like the average of the other parts.
+uint8_t predictLaggingPart(const std::array<const PartThroughput*, RAIDPARTS>& models, const std::array<m_off_t, RAIDPARTS>& rem);
+
 class PartFetcher
 {
     friend class RaidReq;
@@ -72,6 +104,7 @@ class PartFetcher
     int64_t mTimeInflight{};                                  // total time in flight for this part
     m_off_t mReqBytesReceived{};                              // total number of bytes received for this part
     bool mPostCompleted{};                                    // whether a HttpReq::post has been completed
+    PartThroughput mThroughput;                               // rolling throughput of the current connection, to identify slow sources
 
     m_off_t mSourcesize{};                                    // full source size (which can be smaller than RaidReq::paddedpartsize)
     m_off_t mPos{};                                           // part current position
@@ -119,7 +152,6 @@ class RaidReq
     size_t mDataSize;                                         // size of mData
     size_t mParitySize;                                       // size of mParity
     std::array<m_off_t, RAIDPARTS> mPartpos{};                // incoming part positions relative to dataline
-    std::array<unsigned, RAIDPARTS> mFeedlag{};               // accumulated remfeed at shiftata() to identify slow sources
     alignas(RAIDSECTOR) std::unique_ptr<byte[]> mData;        // always starts on a RAID line boundary
     alignas(RAIDSECTOR) std::unique_ptr<byte[]> mParity;      // parity sectors
     std::unique_ptr<char[]> mInvalid;                         // bitfield indicating which sectors have yet to be received
@@ -132,7 +164,7 @@ class RaidReq
     m_off_t mReqStartPos;                                     // RaidReq offset - starting pos (a RaidReq can request just a part of the whole file)
     m_off_t mPaddedpartsize;                                  // the size of the biggest part (0) rounded up to the next RAIDSECTOR boundary
 
-    int mLagrounds{};                                         // number of accumulated additions to feedlag[]
+    int mLagrounds{};                                         // number of processFeedLag() calls since the last check
     raidTime lastdata;                                        // timestamp of RaidReq creation or last data chunk forwarded to user
     bool mHaddata{};                                          // flag indicating whether any data was forwarded to user on this RaidReq
     bool mReported{};                                         // whether a feed stuck (RaidReq not progressing) has been already reported
@@ -147,7 +179,7 @@ class RaidReq
     uint8_t hangingSources(uint8_t*, uint8_t*);               // how many sources are hanging (lastdata from the HttpReq exceeds the hanging time value 'LASTDATA_DSTIME_FOR_HANGING_SOURCE')
     void watchdog();                                          // check hanging sources
     bool differenceBetweenPartsSpeedIsSignificant(uint8_t part1, uint8_t part2) const;  // return whether there is a significant difference between two parts based on a ratio (part1 should be faster than part2)
-    bool getSlowestAndFastestParts(uint8_t&, uint8_t&, bool = true) const; // Get slowest and fastest parts (using feedlag)
+    bool getSlowestAndFastestParts(uint8_t&, uint8_t&, bool = true) const; // Get slowest and fastest parts (using their rolling throughput)
 
 public:
     struct Params
@@ -156,6 +188,7 @@ public:
         size_t filesize;
         m_off_t reqStartPos;
         size_t reqlen;
+        bwclass_t bwclass = BW_INTERACTIVE;
         Params(const std::vector<std::string>& tempUrls, size_t cfilesize, m_off_t creqStartPos, size_t creqlen)
             : tempUrls(tempUrls), filesize(cfilesize), reqStartPos(creqStartPos), reqlen(creqlen) {}
     };
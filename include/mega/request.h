@@ -71,10 +71,18 @@ public:
     // if contains only one command and that command is FetchNodes
     bool isFetchNodes() const;
 
+    // if contains only one command and its response is processed in streaming
+    bool isStreaming() const;
+
     Command* getCurrentCommand();
 };
 
 
+// Only one Request is in flight at a time. The API serializes the requests of a session
+// (concurrent ones are answered with -3 and retried), retries must resend exactly the same
+// batch with the same id for idempotence, and seqtags in responses must be matched in
+// order with the action packets. Throughput for bursts comes from batching instead:
+// everything queued while a Request is in flight goes in the next one (up to MAX_COMMANDS).
 class MEGA_API RequestDispatcher
 {
     // these ones have been sent to the server, but we haven't received the response yet
@@ -111,8 +119,9 @@ public:
     /**
      * @brief get the set of commands to be sent to the server (could be a retry)
      * @param includesFetchingNodes set to whether the commands include fetch nodes
+     * @param streaming set to whether the response must be processed in chunks (see Command::mStreaming)
      */
-    string serverrequest(bool &includesFetchingNodes, bool& v3, MegaClient* client, string& idempotenceId);
+    string serverrequest(bool &includesFetchingNodes, bool& streaming, bool& v3, MegaClient* client, string& idempotenceId);
 
     // Once we get a successful reply from the server, call this to complete everything
     // Since we need to support idempotence, we cannot add anything more to the in-progress request
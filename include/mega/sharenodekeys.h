@@ -31,7 +31,16 @@ class MEGA_API ShareNodeKeys
     sharedNode_vector shares;
     vector<string> items;
 
-    string keys;
+    // node keys to be encrypted with the key of a share, for an item
+    struct Key
+    {
+        int share;
+        int item;
+        size_t pos; // in 'nodekeys'
+        size_t len;
+    };
+    vector<Key> keys;
+    string nodekeys;
 
     int addshare(std::shared_ptr<Node>);
 
@@ -187,6 +187,9 @@ public:
     // Only meaningful when a sync is in CDM_PERIODIC_SCANNING mode.
     unsigned mScanIntervalSec = 0;
 
+    // Where filesystem notifications can resume from on platforms with an event journal.
+    DirNotify::ResumePoint mNotifierResumePoint;
+
     // enum to string conversion
     static const char* synctypename(const Type type);
     static bool synctypefromname(const string& name, Type& type);
@@ -457,18 +460,25 @@ public:
     // insertion/update queue
     localnode_set insertq;
 
+    // deletion queue (dbids of the removed LocalNodes)
+    vector<uint32_t> deleteq;
+
     // adds an entry to the delete queue - removes it from insertq
     void statecachedel(LocalNode*);
 
-    // adds an entry to the insert queue - removes it from deleteq
+    // adds an entry to the insert queue
     void statecacheadd(LocalNode*);
 
     // recursively add children
     void addstatecachechildren(uint32_t, idlocalnode_map*, LocalPath&, LocalNode*, int);
 
-    // Caches all synchronized LocalNode
+    // Caches all synchronized LocalNode: writes both queues in one transaction
     void cachenodes();
 
+    // Whether the queues should be written now. While the sync is busy they are written in batches
+    // (by size or time), and as soon as it settles
+    bool statecacheFlushDue() const;
+
     // change state, signal to application
     void changestate(SyncError newSyncError, bool newEnableFlag, bool notifyApp, bool keepSyncDb);
 
@@ -493,6 +503,14 @@ public:
         vector<FSNode>& fsNodes,
         vector<SyncRow>& inferredRows) const;
 
+    // Like inferRegeneratableTriplets, but only for the children whose subtree is flagged
+    // (plus the ignore file), for folders that need no action themselves.
+    bool inferFlaggedChildTriplets(
+        const SyncRow& row,
+        vector<CloudNode>& cloudNodes,
+        vector<FSNode>& fsNodes,
+        vector<SyncRow>& inferredRows) const;
+
     struct PerFolderLogSummaryCounts
     {
         // in order to not swamp the logs, but still be able to diagnose.
@@ -504,6 +522,17 @@ public:
     };
 
     bool recursiveSync(SyncRow& row, SyncPath& fullPath, bool belowRemovedCloudNode, bool belowRemovedFsNode, unsigned depth);
+
+    // Bounds how long a single recursiveSync() may run, so that a slow sync doesn't hold up the others.
+    // The slice doubles each time it is used up, so even the largest traversal eventually completes.
+    void beginRecursionSlice();
+
+    // True if the traversal was cut short by its slice (and needs to resume soon).
+    bool endRecursionSlice();
+
+    // Whether recursiveSync() should unwind now (outside request or slice used up).
+    bool recursionMustExit();
+
     bool syncItem_checkMoves(SyncRow& row, SyncRow& parentRow, SyncPath& fullPath, bool belowRemovedCloudNode, bool belowRemovedFsNode);
     bool syncItem_checkFilenameClashes(SyncRow& row, SyncRow& parentRow, SyncPath& fullPath);
     bool syncItem_checkBackupCloudNameClash(SyncRow& row, SyncRow& parentRow, SyncPath& fullPath);
@@ -554,6 +583,10 @@ public:
     bool checkMovesWereComplete();
     bool movesWereComplete() const;
 
+    // Records how far the notifier's events have been fully synced, so that
+    // the next session can replay later changes without waiting for a full scan.
+    void saveNotifierResumePoint();
+
     void recursiveCollectNameConflicts(SyncRow& row, SyncPath& fullPath, list<NameConflict>* ncs, size_t& count, size_t& limit);
     void recursiveCollectNameConflicts(list<NameConflict>* conflicts, size_t* count = nullptr, size_t* limit = nullptr);
 
@@ -583,6 +616,16 @@ public:
     // does the filesystem have stable IDs? (FAT does not)
     bool fsstableids = false;
 
+    // Derived from the current filesystem fingerprint: a LocalNode::ScanSignature recorded
+    // with another value (ie. before a remount) is not trusted.
+    uint32_t mScanSignatureTag = 0;
+
+    // When mNotifierResumePoint was last saved to the config.
+    dstime mNotifierResumePointSavedDs = 0;
+
+    // Limits how often the config is rewritten just to record a new resume point.
+    static const dstime NOTIFIER_RESUME_POINT_SAVE_INTERVAL_DS;
+
     // true if the local synced folder is a network folder
     bool isnetwork = false;
 
@@ -592,11 +635,34 @@ public:
     // How deep is this sync's cloud root?
     unsigned mCurrentRootDepth = 0;
 
+    // Base time slice for one recursiveSync() traversal.
+    static const unsigned RECURSION_SLICE_MS;
+
+    // State of the current recursiveSync() time slice.
+    std::chrono::steady_clock::time_point mRecursionDeadline;
+    bool mRecursionSliceExpired = false;
+
+    // How many traversals in a row have been cut short.
+    unsigned mRecursionSlicesExpired = 0;
+
+    // Batches of LocalNode changes written to the state cache by cachenodes().
+    static const size_t STATECACHE_BATCH_NODES;
+    static const unsigned STATECACHE_FLUSH_INTERVAL_MS;
+    std::chrono::steady_clock::time_point mLastStatecacheFlush;
+
     Sync(UnifiedSync&, const string&, const LocalPath&, bool, const string& logname, SyncError& e);
     ~Sync();
 
-    // Asynchronous scan request / result.
-    std::shared_ptr<ScanService::ScanRequest> mActiveScanRequestGeneral;
+    // Asynchronous scan requests / results.
+    // Several folders are scanned at once, so big syncs keep all the scan threads of the volume busy.
+    static constexpr size_t MAX_CONCURRENT_SCANS = ScanService::NUM_THREADS_PER_VOLUME;
+    std::array<std::shared_ptr<ScanService::ScanRequest>, MAX_CONCURRENT_SCANS> mActiveScanRequestsGeneral;
+
+    // True if no more general scan requests can be issued until one completes.
+    bool allGeneralScanSlotsBusy() const;
+
+    // True if there is no general scan request (neither in progress nor pending to be processed).
+    bool noGeneralScanRequests() const;
 
     // we can additionally be scanning one more yet-unscanned folder
     // in order to always be progressing even when downloads are
@@ -1055,6 +1121,14 @@ struct SyncFlags
 
     bool earlyRecurseExitRequested = false;
 
+    // how much of the LocalNode tree recursiveSync() had to look at
+    size_t rowsVisitedThisPass = 0;
+    size_t rowsVisitedLastPass = 0;
+
+    // rows under visited folders that we didn't need to look at
+    size_t rowsSkippedThisPass = 0;
+    size_t rowsSkippedLastPass = 0;
+
     // to help with slowing down retries in stall state
     dstime recursiveSyncLastCompletedDs = 0;
 
@@ -1098,6 +1172,40 @@ using IsImmediateStallPredicate =
 using SyncControllerPtr = std::shared_ptr<SyncController>;
 using SyncControllerWeakPtr = std::weak_ptr<SyncController>;
 
+// The overlay icon states reported to the app, for MegaApiImpl::syncPathState to look them up
+// without waiting for the sync thread.  The sync thread records the changes and publishes them
+// as a new snapshot that is never modified afterwards, so readers just load the current one.
+// The paths are grouped by their folder, so a new snapshot only copies the folders that changed.
+class SyncPathStates
+{
+public:
+    // sync thread only
+    void update(const LocalPath& path, treestate_t ts);
+    void remove(const LocalPath& path, bool withDescendants);
+    void publish();
+
+    // any thread
+    bool lookup(const LocalPath& path, treestate_t& ts) const;
+
+private:
+    using Folder = map<LocalPath::string_type, treestate_t>;
+    using Snapshot = map<LocalPath::string_type, shared_ptr<const Folder>>;
+
+    // the path of the containing folder (with its trailing separator) and the leaf name
+    static std::pair<LocalPath::string_type, LocalPath::string_type> split(const LocalPath& path);
+
+    // the latest states, the folders not in mCopied are shared with the published snapshot
+    map<LocalPath::string_type, shared_ptr<Folder>> mCurrent;
+    set<LocalPath::string_type> mCopied;
+    bool mChanged = false;
+    std::chrono::steady_clock::time_point mLastPublished;
+
+    // only accessed through std::atomic_load and std::atomic_store
+    shared_ptr<const Snapshot> mPublished;
+
+    static const std::chrono::milliseconds PUBLISH_INTERVAL;
+};
+
 struct SyncSensitiveData
 {
     // Attributes necessary to manipulate the sync config database.
@@ -1330,6 +1438,9 @@ public:
     // for quick lock free reference by MegaApiImpl::syncPathState (don't slow down windows explorer)
     bool mSyncVecIsEmpty = true;
 
+    // states of the synced paths, also looked up by MegaApiImpl::syncPathState without locking
+    SyncPathStates mSyncPathStates;
+
     // directly accessed flag that makes sync-related logging a lot more detailed
     bool mDetailedSyncLogging = true;
 
@@ -1581,6 +1692,12 @@ private:
     map<LocalPath, bool> triggerLocalpaths;
     mutex triggerMutex;
 
+    // Cloud roots of the syncs that are running, so the client only queues the node changes below them.
+    // Replaced by the sync thread when the syncs change, only accessed through std::atomic_load and std::atomic_store
+    shared_ptr<const set<NodeHandle>> mRunningSyncRoots;
+    void updateRunningSyncRoots();
+    bool isBelowRunningSyncRoot(NodeHandle h);
+
     // Keep track of files that we can't move yet because they are changing
     struct FileChangingState
     {
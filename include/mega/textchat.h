@@ -234,7 +234,16 @@ private:
     string unifiedKey;   // byte array
     handle ou = UNDEF;
     m_time_t ts = 0;     // creation time
-    attachments_map attachedNodes;
+
+    // Grants of the attached nodes. If the chat is kept in a database with 'chatgrants' (see DBTableNodes::hasChatGrants()),
+    // they aren't in the record of the chat: they are loaded on first use, and only their changes are written (see saveGrants())
+    mutable attachments_map attachedNodes;
+    mutable bool mGrantsLoaded = true;
+    bool mGrantsInTable = false;
+    std::vector<ChatGrant> mGrantsChanged;
+    MegaClient* mClient = nullptr;
+    void loadGrants() const;
+
     bool meeting = false;     // chat is meeting room
     byte chatOptions = 0; // each chat option is represented in 1 bit (check ChatOptions struct at types.h)
 
@@ -313,6 +322,11 @@ public:
 
     // return false if failed
     bool setNodeUserAccess(handle h, handle uh, bool revoke = false);
+
+    // Write the grants changed since the previous call (all of them, the first time) to 'table', where the chat is about to be
+    // written too. If 'table' doesn't support them, they are kept in the record of the chat instead. It returns false if failed
+    bool saveGrants(DBTableNodes* table);
+
     bool addOrUpdateChatOptions(int speakRequest = -1, int waitingRoom = -1, int openInvite = -1);
     bool setFlag(bool value, uint8_t offset = 0xFF);
     bool setFlags(byte newFlags);
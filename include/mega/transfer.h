@@ -102,6 +102,9 @@ struct MEGA_API Transfer : public FileFingerprint
     // file is removed
     file_list files;
 
+    // cancel tokens of the files, as indexed in MegaClient::mTransfersByCancelToken
+    std::set<const void*> mCancelTokenIds;
+
     shared_ptr<FileDistributor> downloadDistributor;
 
     // failures/backoff
@@ -197,8 +200,12 @@ struct MEGA_API Transfer : public FileFingerprint
     bool serialize(string*) const override;
 
     // unserialize a Transfer and add it to the transfer map
+    // the chunk MACs are kept serialized until the transfer is taken from the cache, see materialize()
     static Transfer* unserialize(MegaClient *, string*, transfer_multimap *);
 
+    // unserialize the chunk MACs of a cached transfer when it's resumed, and calculate its progress
+    bool materialize();
+
     // examine a file on disk for video/audio attributes to attach to the file, on upload/download
     void addAnyMissingMediaFileAttributes(Node* node, LocalPath& localpath);
 
@@ -211,6 +218,9 @@ struct MEGA_API Transfer : public FileFingerprint
     // whether the transfer is a Sync upload transfer
     bool mIsSyncUpload = false;
 
+    // the serialized chunk MACs of a cached transfer that hasn't been materialized yet
+    string mCachedChunkmacs;
+
 private:
     FileDistributor::TargetNameExistsResolution toTargetNameExistsResolution(CollisionResolution resolution);
 };
@@ -675,6 +685,123 @@ private:
     m_off_t calcThroughput(m_off_t numBytes, m_off_t timeCount) const;
 };
 
+// decrypted data recently streamed by DirectReads, so reads of the same ranges (several
+// clients streaming the same file, players seeking back) don't fetch them again
+class MEGA_API DirectReadCache
+{
+public:
+    // chunks are aligned to this size and, but for the last one of a file, have this size
+    static constexpr m_off_t CHUNK_SIZE = 1024 * 1024;
+
+    static constexpr size_t DEFAULT_MAX_SIZE = 64 * 1024 * 1024;
+
+    // store the chunk starting at pos of file h (decrypted with ctriv), evicting the least
+    // recently used chunks to stay within the budget
+    void add(handle h, int64_t ctriv, m_off_t pos, string&& data);
+
+    // chunk of file h containing pos, if any. Valid until the cache is modified
+    const string* find(handle h, int64_t ctriv, m_off_t pos);
+
+    void clear();
+
+    size_t maxSize() const;
+    void setMaxSize(size_t maxSize);
+
+    // bytes currently cached
+    size_t size() const;
+
+private:
+    using Key = std::tuple<handle, int64_t, m_off_t>;
+
+    struct Entry
+    {
+        Key key;
+        string data;
+    };
+
+    // most recently used first
+    list<Entry> mEntries;
+    map<Key, list<Entry>::iterator> mIndex;
+
+    size_t mSize = 0;
+    size_t mMaxSize = DEFAULT_MAX_SIZE;
+
+    void evict();
+};
+
+// receives the data of a direct read in place of MegaApp::pread_data() / pread_failure()
+struct MEGA_API DirectReadListener
+{
+    virtual ~DirectReadListener() = default;
+
+    // same contract as MegaApp::pread_data(): return false to end the read
+    virtual bool onData(byte* buffer, m_off_t len, m_off_t pos) = 0;
+
+    // same contract as MegaApp::pread_failure(): return the desired retry delay
+    virtual dstime onFailure(const Error& e, int retry, dstime timeLeft) = 0;
+};
+
+// learns how the app streams a file (sequential reads, scrubbing, container metadata read
+// from the end of the file first) and fetches the ranges likely to be requested next into
+// the DirectReadCache. One per DirectReadNode
+class MEGA_API DirectReadAhead : public DirectReadListener
+{
+public:
+    enum Pattern
+    {
+        PATTERN_UNKNOWN,
+        PATTERN_SEQUENTIAL, // each read starts where the previous one ended
+        PATTERN_SCRUBBING,  // the user is seeking around: prefetching would be wasted
+        PATTERN_TAIL_FIRST, // the end of the file is read first (ie. MP4 moov atom), the start comes next
+    };
+
+    // reads requested within this interval count as the same scrub
+    static constexpr dstime SCRUB_INTERVAL_DS = 50;
+    static constexpr size_t SCRUB_READS = 3;
+
+    // reads starting this close to the end of the file are looking for container metadata
+    static constexpr m_off_t TAIL_SIZE = 4 * DirectReadCache::CHUNK_SIZE;
+
+    // data prefetched: this many deciseconds of the measured consumption rate, within limits
+    static constexpr dstime WINDOW_DS = 100;
+    static constexpr m_off_t MIN_WINDOW = DirectReadCache::CHUNK_SIZE;
+    static constexpr m_off_t MAX_WINDOW = 16 * DirectReadCache::CHUNK_SIZE;
+
+    explicit DirectReadAhead(DirectReadNode*);
+
+    // a read has been requested by the app: update the pattern and prefetch accordingly
+    void requested(m_off_t offset, m_off_t count);
+
+    // data has been delivered to the app
+    void delivered(m_off_t len);
+
+    Pattern pattern() const;
+
+    // prefetched data only goes to the cache
+    bool onData(byte*, m_off_t len, m_off_t pos) override;
+    dstime onFailure(const Error&, int retry, dstime timeLeft) override;
+
+private:
+    DirectReadNode* mDrn;
+    Pattern mPattern;
+
+    // when the latest reads were requested, within SCRUB_INTERVAL_DS
+    deque<dstime> mRequestTimes;
+
+    // where the latest read requested ends, -1 if there wasn't any
+    m_off_t mLastEnd;
+
+    // to measure how fast the app consumes data
+    dstime mFirstDeliveryDs;
+    m_off_t mDelivered;
+
+    // the running prefetch, if any
+    DirectRead* prefetching() const;
+
+    void prefetch(m_off_t offset, m_off_t count);
+    m_off_t window(m_off_t count) const;
+};
+
 struct MEGA_API DirectRead
 {
     m_off_t count;
@@ -692,12 +819,30 @@ struct MEGA_API DirectRead
 
     void* appdata;
 
+    // if set, it receives the data instead of the app (appdata still identifies the read)
+    DirectReadListener* listener;
+
     int reqtag;
 
+    // data of the chunk being received, added to the client's DirectReadCache once complete
+    string cachebuf;
+    m_off_t cachepos;
+
     void abort();
     m_off_t drMaxReqSize() const;
 
-    DirectRead(DirectReadNode*, m_off_t, m_off_t, int, void*);
+    // deliver the leading part of the range found in the client's DirectReadCache and set the
+    // buffer up to fetch the rest. Returns false if nothing is left to fetch
+    bool start();
+
+    // keep data received from storage in the client's DirectReadCache
+    void cacheData(const byte*, m_off_t len, m_off_t pos);
+
+    // forward data / failures to the listener, or to the app if there is none
+    bool deliverData(byte*, m_off_t len, m_off_t pos, m_off_t speed, m_off_t meanSpeed, std::shared_ptr<const void> owner);
+    dstime deliverFailure(const Error&, int retry, dstime timeLeft);
+
+    DirectRead(DirectReadNode*, m_off_t, m_off_t, int, void*, DirectReadListener* = nullptr);
     ~DirectRead();
 };
 
@@ -724,6 +869,8 @@ struct MEGA_API DirectReadNode
 
     dr_list reads;
 
+    DirectReadAhead readahead;
+
     MegaClient* client;
 
     handledrn_map::iterator hdrn_it;
@@ -733,7 +880,7 @@ struct MEGA_API DirectReadNode
     void cmdresult(const Error&, dstime = 0);
 
     // enqueue new read
-    void enqueue(m_off_t, m_off_t, int, void*);
+    DirectRead* enqueue(m_off_t, m_off_t, int, void*, DirectReadListener* = nullptr);
 
     // dispatch all reads
     void dispatch();
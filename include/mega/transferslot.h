@@ -47,6 +47,54 @@ public:
 
 class TransferDbCommitter;
 
+// Adjusts how many connections a non-raid transfer uses, and the size of its download requests,
+// from the throughput, errors and request durations observed (TCP style probing):
+//  - after each quiet interval one more connection is tried, and given back if throughput didn't improve
+//  - errors halve both the connections and the request size
+//  - requests that finish quickly (ie. latency bound) make the next ones larger, slow ones make them smaller
+class MEGA_API TransferConnectionController
+{
+public:
+    // how often the controller is fed a sample
+    static const dstime SAMPLE_INTERVAL_DS;
+
+    // throughput gain for an extra connection to be kept, in percent
+    static const unsigned MIN_GAIN_PERCENT;
+
+    // samples to wait before probing again after an extra connection didn't help, or after errors
+    static const unsigned HOLD_SAMPLES;
+
+    // requests shorter than this are dominated by latency, longer ones make retries and progress too coarse
+    static const dstime SHORT_REQUEST_DS;
+    static const dstime LONG_REQUEST_DS;
+
+    TransferConnectionController(unsigned initialConnections, unsigned maxConnections,
+                                 m_off_t initialRequestSize, m_off_t minRequestSize, m_off_t maxRequestSize);
+
+    // What was observed since the previous sample.
+    // canGrow is false when the connections of all the transfers already reach the global limit.
+    void sample(m_off_t bytes, unsigned failures, dstime meanRequestDs, bool canGrow);
+
+    unsigned connections() const { return mConnections; }
+    m_off_t requestSize() const { return mRequestSize; }
+
+private:
+    unsigned mConnections;
+    const unsigned mMaxConnections;
+
+    m_off_t mRequestSize;
+    const m_off_t mMinRequestSize;
+    const m_off_t mMaxRequestSize;
+
+    // bytes transferred during the previous sample
+    m_off_t mLastBytes = 0;
+
+    // the previous sample added a connection
+    bool mProbing = false;
+
+    unsigned mHold = 0;
+};
+
 // active transfer
 struct MEGA_API TransferSlot
 {
@@ -81,6 +129,15 @@ struct MEGA_API TransferSlot
     // maximum gap between chunks for uploads
     static const m_off_t MAX_GAP_SIZE;
 
+    // min file size for downloads to write their (aligned) pieces bypassing the OS cache
+    static const m_off_t MIN_FILESIZE_FOR_DIRECT_WRITES;
+
+    // min file size for downloads to reserve their disk space when they start
+    static const m_off_t MIN_FILESIZE_FOR_PREALLOCATION;
+
+    // min time between download progress updates in the transfer cache
+    static const dstime DOWNLOAD_PROGRESS_CACHE_INTERVAL_DS;
+
     m_off_t maxRequestSize;
 
     m_off_t progressreported;
@@ -100,6 +157,16 @@ struct MEGA_API TransferSlot
     int connections;
     vector<std::shared_ptr<HttpReqXfer>> reqs;
 
+    // Non-raid transfers of several connections adapt how many of them are in use (the first ones).
+    // The others only finish the requests they have.
+    std::unique_ptr<TransferConnectionController> mConnectionController;
+    int activeConnections() const;
+
+    // Bytes of the MegaClient::transferBufferBudget reserved by the current request of each connection
+    vector<m_off_t> mBufferReserved;
+    bool reserveRequestBuffer(int connection, m_off_t size);
+    void releaseRequestBuffer(int connection);
+
     // Keep track of transfer network speed per channel, and overall
     vector<SpeedController> mReqSpeeds;
     SpeedController mTransferSpeed;
@@ -112,6 +179,10 @@ struct MEGA_API TransferSlot
     TransferBufferManager transferbuf;
 
     bool initCloudRaid(MegaClient* client);
+
+    // share of the bandwidth limits for the requests (transfers only wanted by syncs are background ones)
+    bwclass_t bandwidthClass() const;
+
     shared_ptr<CloudRaid> getcloudRaidPtr()
     {
         return cloudRaid;
@@ -120,12 +191,36 @@ struct MEGA_API TransferSlot
     // async IO operations
     AsyncIOContext** asyncIO;
 
+    // Uploads: the next request of each connection, read and encrypted at the worker threads while
+    // the current one is in flight, so the connection doesn't stall between requests.
+    struct UploadPrefetch
+    {
+        std::shared_ptr<HttpReqXfer> req;
+        AsyncIOContext* asyncIO = nullptr;
+        m_off_t size = 0;
+    };
+    vector<UploadPrefetch> mUploadPrefetch;
+
+    // read-ahead data of mUploadPrefetch (back-pressure: no more read-ahead beyond the limit)
+    m_off_t mUploadPrefetchBytes = 0;
+    static const m_off_t MAX_UPLOAD_PREFETCH_BYTES;
+
     // handle I/O for this slot
     void doio(MegaClient*, TransferDbCommitter&);
 
+    // whether doio() has anything to do: a connection not in flight, data transferred since
+    // the previous call, or the periodic checks (timeouts, progress) after IDLE_SERVICE_DS
+    bool needsService(MegaClient*);
+    static const dstime IDLE_SERVICE_DS;
+    dstime mLastServiceDs = 0;
+    m_off_t mLastServiceTransferred = -1;
+
     // Prepare an HTTP request
     void prepareRequest(const std::shared_ptr<HttpReqXfer>&, const string& tempURL, m_off_t pos, m_off_t npos);
 
+    // Prepare an upload request at the worker threads (REQ_ENCRYPTING -> REQ_PREPARED)
+    void encryptUploadRequest(const std::shared_ptr<HttpReqXfer>&, unsigned connectionNum, m_off_t pos, m_off_t npos);
+
     // Process a request failure
     // Return values:
     // Error: the ErrorCode. If different from API_OK, it means that the transfer is considered as failed and transfer->failed() should be called.
@@ -176,11 +271,37 @@ private:
 
     void toggleport(HttpReqXfer* req);
     bool checkDownloadTransferFinished(TransferDbCommitter& committer, MegaClient* client);
+
+    // save the written pieces (chunk MACs) of the download in the transfer cache, at most every
+    // DOWNLOAD_PROGRESS_CACHE_INTERVAL_DS: the chunk MACs of a big download with out-of-order pieces are large.
+    // The slot destructor saves whatever is left, so only a crash refetches data (up to that interval)
+    void cacheDownloadProgress(TransferDbCommitter& committer, MegaClient* client);
+    dstime mDownloadProgressCachedDs = 0;
+    m_off_t mDownloadProgressCached = -1;
     bool checkMetaMacWithMissingLateEntries();
     bool tryRaidRecoveryFromHttpGetError(unsigned i, bool incrementErrors);
 
+    // read the next upload request for the connection ahead of time, if allowed by the back-pressure limit
+    void startUploadPrefetch(unsigned connectionNum);
+
+    // encrypt the read-ahead data when its read finishes. Returns false if the read failed permanently
+    bool processUploadPrefetch(unsigned connectionNum, dstime& backoff);
+
+    // make the read-ahead request the current one of the connection. Returns false if there isn't any
+    bool useUploadPrefetch(unsigned connectionNum);
+
     // returns true if connection haven't received data recently (set incrementErrors) or if slower than other connections (reset incrementErrors)
     bool testForSlowRaidConnection(unsigned connectionNum, bool& incrementErrors);
+
+    // what mConnectionController is fed, gathered since its last sample
+    dstime mControlSampleDs = 0;
+    m_off_t mControlBytes = 0;
+    unsigned mControlFailures = 0;
+    dstime mControlRequestsDs = 0;
+    unsigned mControlRequests = 0;
+
+    // feed mConnectionController when a sample interval has passed
+    void sampleConnectionController();
 };
 
 } // namespace
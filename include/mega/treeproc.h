@@ -52,6 +52,8 @@ public:
     void proc(MegaClient*, std::shared_ptr<Node>);
 };
 
+// The new nodes are built in a single walk of the tree. allocnodes() then puts them in the order
+// expected by putnodes (parents first), and further walks (as the old two-pass usage did) do nothing.
 class MEGA_API TreeProcCopy : public TreeProc
 {
 public:
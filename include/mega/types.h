@@ -70,6 +70,7 @@ namespace mega {
 #include <chrono>
 #include <mutex>
 #include <thread>
+#include <unordered_map>
 
 namespace mega {
 
@@ -81,6 +82,7 @@ using std::list;
 using std::vector;
 using std::pair;
 using std::multimap;
+using std::unordered_multimap;
 using std::deque;
 using std::multiset;
 using std::queue;
@@ -108,8 +110,10 @@ class Command;
 class CommandPubKeyRequest;
 struct BusinessPlan;
 struct CurrencyData;
+class DBTableNodes;
 struct DirectRead;
 struct DirectReadNode;
+struct DirectReadListener;
 struct DirectReadSlot;
 struct FileAccess;
 struct FileSystemAccess;
@@ -175,6 +179,10 @@ typedef enum { METHOD_POST, METHOD_GET, METHOD_NONE} httpmethod_t;
 
 typedef enum { REQ_BINARY, REQ_JSON } contenttype_t;
 
+// traffic classes sharing the bandwidth limits, from the most to the least latency sensitive:
+// streaming (direct reads), transfers started by the user, and sync/backup transfers
+typedef enum { BW_STREAMING = 0, BW_INTERACTIVE, BW_BACKGROUND, BW_CLASSES } bwclass_t;
+
 // new node source types
 typedef enum { NEW_NODE, NEW_PUBLIC, NEW_UPLOAD } newnodesource_t;
 
@@ -300,6 +308,11 @@ inline bool operator!=(NodeHandle a, handle b) { return a.ne(b); }
 inline bool operator!=(NodeHandle a, NodeHandle b) { return a.ne(b); }
 std::ostream& operator<<(std::ostream&, NodeHandle h);
 
+struct NodeHandleHash
+{
+    size_t operator()(NodeHandle h) const { return std::hash<handle>()(h.as8byte()); }
+};
+
 struct UploadHandle
 {
     handle h = 0xFFFFFFFFFFFFFFFF;
@@ -544,11 +557,12 @@ typedef vector<LocalNode*> localnode_vector;
 
 // fsid is not necessarily unique because multiple filesystems may be involved
 // Hence, we use a multimap and check other parameters too when looking for a match.
-typedef multimap<handle, LocalNode*> fsid_localnode_map;
+// Lookups by fsid are only ever exact, so they are hashed rather than ordered.
+typedef unordered_multimap<handle, LocalNode*> fsid_localnode_map;
 
 // A similar type for looking up LocalNode by node handle, analagously
 // Keep the type separate by inheriting
-typedef multimap<NodeHandle, LocalNode*> nodehandle_localnode_map;
+typedef unordered_multimap<NodeHandle, LocalNode*, NodeHandleHash> nodehandle_localnode_map;
 
 typedef set<LocalNode*> localnode_set;
 
@@ -1053,6 +1067,14 @@ typedef enum
 }
 BackupType;
 
+// Access of a user to a node attached to a chat (see DBTableNodes::putChatGrants())
+struct ChatGrant
+{
+    handle node = UNDEF;
+    handle user = UNDEF;
+    bool revoked = false;
+};
+
 typedef mega::byte ChatOptions_t;
 struct ChatOptions
 {
@@ -1186,7 +1208,8 @@ public:
     {
         if (value)
         {
-            ++tokensCancelledCount;
+            // it may be assigned to anything later: not a cancel of a known token
+            recordCancel(nullptr);
         }
     }
 
@@ -1196,10 +1219,16 @@ public:
         if (flag)
         {
             *flag = true;
-            ++tokensCancelledCount;
+            recordCancel(flag.get());
         }
     }
 
+    // identifies the token (and its copies) while it exists
+    const void* id() const
+    {
+        return flag.get();
+    }
+
     bool isCancelled() const
     {
         return !!flag && *flag;
@@ -1224,6 +1253,19 @@ public:
             return true;
         }
     }
+
+    // Same as above, also providing the ids of the tokens cancelled. If they can't be known
+    // (too many cancels since lastKnownCancelCount, or tokens created already cancelled),
+    // the ids are left empty and any token may have been cancelled.
+    static bool haveAnyCancelsOccurredSince(uint32_t& lastKnownCancelCount, vector<const void*>& ids);
+
+private:
+    // the latest cancels are kept, with their value of tokensCancelledCount
+    static const size_t MAX_RECORDED_CANCELS = 1024;
+    static std::mutex recordedCancelsMutex;
+    static std::deque<std::pair<uint32_t, const void*>> recordedCancels;
+
+    static void recordCancel(const void* id);
 };
 
 typedef std::map<NodeHandle, Node*> nodePtr_map;
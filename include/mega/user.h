@@ -106,14 +106,30 @@ struct MEGA_API User : public Cacheable
 
 private:
     // persistent attributes (keyring, firstname...)
-    userattr_map attrs;
+    mutable userattr_map attrs;
 
     // version of each attribute
-    userattr_map attrsv;
+    mutable userattr_map attrsv;
 
     // source tag
     int tag;
 
+    // The attributes of the users loaded from the cache are decoded from their record when first used,
+    // and only the most recently used ones are kept decoded (see MegaClient::trimUserAttributes())
+    MegaClient* mClient = nullptr;
+    mutable bool mAttrsLoaded = true;
+
+    // the attributes in memory are the ones of the record in the cache
+    mutable bool mAttrsSaved = false;
+
+    // position of the attributes in the record, and their format
+    mutable uint32_t mAttrsOffset = 0;
+    mutable char mAttrsVersion = '2';
+
+    mutable uint64_t mAttrsLastUse = 0;
+
+    static bool readattrs(const char*& ptr, const char* end, char attrVersion, userattr_map* attrs, userattr_map* attrsv);
+
     static constexpr char NO_VERSION[] = "N";
     static constexpr char NON_EXISTING[] = "-9";
 
@@ -139,6 +155,15 @@ public:
     // Only mark own attributes that it doesn't exist
     void setNonExistingAttribute(attr_t at);
 
+    // decodes the attributes from the cache, if they aren't yet
+    void loadattrs() const;
+
+    // drops the decoded attributes, if they can be decoded again from the cache
+    bool unloadattrs();
+
+    bool attrsloaded() const { return mAttrsLoaded; }
+    uint64_t attrslastuse() const { return mAttrsLastUse; }
+
     static string attr2string(attr_t at);
     static string attr2longname(attr_t at);
     static attr_t string2attr(const char *name);
@@ -171,6 +196,10 @@ public:
     void resetTag();
 
     User(const char* = NULL);
+    ~User();
+
+    // the users of the client are accounted for in MegaClient::mUsersWithAttrs
+    void setClient(MegaClient* client);
 
     // merges the new values in the given TLV. Returns true if TLV is changed.
     static bool mergeUserAttribute(attr_t type, const string_map &newValuesMap, TLVstore &tlv);
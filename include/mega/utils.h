@@ -22,10 +22,14 @@
 #ifndef MEGA_UTILS_H
 #define MEGA_UTILS_H 1
 
+#include <array>
+#include <atomic>
+#include <iterator>
 #include <type_traits>
 #include <condition_variable>
 #include <thread>
 #include <mutex>
+#include <string_view>
 
 #include "types.h"
 #undef SSIZE_MAX
@@ -446,6 +450,9 @@ public:
     static string toUpperUtf8(const string& text);
     static string toLowerUtf8(const string& text);
 
+    // True if all the bytes are below 0x80: such text needs no normalization, and its case mapping is ASCII's.
+    static bool isAscii(const string& text);
+
     // Platform-independent case-insensitive comparison.
     static int icasecmp(const std::string& lhs,
                         const std::string& rhs,
@@ -559,6 +566,7 @@ public:
     int64_t macsmac_gaps(SymmCipher *cipher, size_t g1, size_t g2, size_t g3, size_t g4);
     void serialize(string& d) const;
     bool unserialize(const char*& ptr, const char* end);
+    static bool skip(const char*& ptr, const char* end);
     void calcprogress(m_off_t size, m_off_t& chunkpos, m_off_t& completedprogress, m_off_t* sumOfPartialChunks = nullptr);
     m_off_t nextUnprocessedPosFrom(m_off_t pos);
     m_off_t expandUnprocessedPiece(m_off_t pos, m_off_t npos, m_off_t fileSize, m_off_t maxReqSize);
@@ -596,6 +604,9 @@ struct CacheableWriter
     CacheableWriter(string& d);
     string& dest;
 
+    // make room for 'len' more bytes, so that the fields serialized next don't grow the string piece by piece
+    void reserve(size_t len);
+
     void serializebinary(byte* data, size_t len);
     void serializecstr(const char* field, bool storeNull);  // may store the '\0' also for backward compatibility. Only use for utf8!  (std::string storing double byte chars will only store 1 byte)
     void serializepstr(const string* field);  // uses string size() not strlen
@@ -629,6 +640,7 @@ struct CacheableWriter
 struct CacheableReader
 {
     CacheableReader(const string& d);
+    CacheableReader(const char* data, size_t len);
     const char* ptr;
     const char* end;
     unsigned fieldnum;
@@ -637,6 +649,11 @@ struct CacheableReader
     bool unserializecstr(string& s, bool removeNull); // set removeNull if this field stores the terminating '\0' at the end
     bool unserializestring(string& s);
     bool unserializestring_u32(string& s);
+
+    // same as above, but without copies: the views point into the source data, which must outlive them
+    bool unserializecstr(std::string_view& s, bool removeNull);
+    bool unserializestring(std::string_view& s);
+    bool unserializestring_u32(std::string_view& s);
     bool unserializecompressedu64(uint64_t& field);
     bool unserializecompressedi64(int64_t& field) { return unserializecompressedu64(reinterpret_cast<uint64_t&>(field)); }
 
@@ -655,6 +672,7 @@ struct CacheableReader
     bool unserializeNodeHandle(NodeHandle& s);
     bool unserializebool(bool& s);
     bool unserializechunkmacs(chunkmac_map& m);
+    bool unserializechunkmacs(std::string_view& data);  // the serialized MACs, to be unserialized later
     bool unserializefingerprint(FileFingerprint& fp);
     bool unserializedirection(direction_t& field);  // historic; size varies by compiler.  todo: Remove when we next roll the transfer db version
 
@@ -687,12 +705,29 @@ bool CompareLocalFileMetaMacWithNode(FileAccess* fa, Node* node);
 // Helper class for MegaClient.  Suitable for expansion/templatizing for other use caes.
 // Maintains a small thread pool for executing independent operations such as encrypt/decrypt a block of data
 // The number of threads can be 0 (eg. for helper MegaApi that deals with public folder links) in which case something queued is
-// immediately executed synchronously on the caller's thread
+// immediately executed synchronously on the caller's thread.
+// THREADS_PER_CORE starts as many threads as hardware threads are available.
+// Operations are run by priority, and in order within the same priority.
 struct MegaClientAsyncQueue
 {
-    void push(std::function<void(SymmCipher&)> f, bool discardable);
+    static constexpr unsigned THREADS_PER_CORE = ~0u;
+
+    enum Priority
+    {
+        INTERACTIVE,    // short operations the caller is waiting for
+        TRANSFER,       // data of the transfers
+        BACKGROUND,     // long operations nobody is waiting for
+        NUM_PRIORITIES
+    };
+
+    void push(std::function<void(SymmCipher&)> f, bool discardable, Priority priority = TRANSFER);
     void clearDiscardable();
 
+    // Run 'f' for the ranges [begin, end) of up to 'batchSize' items in [0, count), at INTERACTIVE priority,
+    // and wait for all of them. The caller runs batches too, so it doesn't depend on the workers
+    // being free. As the caller waits, 'f' can refer to its local variables
+    void runBatches(size_t count, size_t batchSize, std::function<void(size_t begin, size_t end, SymmCipher&)> f);
+
     MegaClientAsyncQueue(Waiter& w, unsigned threadCount);
     ~MegaClientAsyncQueue();
 
@@ -700,6 +735,7 @@ private:
     Waiter& mWaiter;
     std::mutex mMutex;
     std::condition_variable mConditionVariable;
+    bool mExit = false;
 
     struct Entry
     {
@@ -710,7 +746,7 @@ private:
         {}
     };
 
-    std::deque<Entry> mQueue;
+    std::array<std::deque<Entry>, NUM_PRIORITIES> mQueues;
     std::vector<std::thread> mThreads;
     SymmCipher mZeroThreadsCipher;
 
@@ -779,6 +815,82 @@ public:
 
 };
 
+// Intrusive queue for many producer threads and one consumer: the elements are linked through their 'next' member.
+// Pushing never blocks, and the consumer takes all the pushed elements at once, in the order they were pushed.
+// The consumer side (drain) must be serialized by the owner, usually with the mutex of the container it drains to.
+template<class T, T* T::*next>
+class MpscInbox
+{
+    std::atomic<T*> mHead{nullptr};
+
+public:
+    // returns true if the inbox was empty, that is, if the consumer may need to be woken up
+    bool push(T* t)
+    {
+        T* head = mHead.load(std::memory_order_relaxed);
+        do
+        {
+            t->*next = head;
+        }
+        while (!mHead.compare_exchange_weak(head, t));
+        return !head;
+    }
+
+    // pushes the elements of [begin, end) at once, so they are drained together, in the same order
+    template<class It>
+    bool push(It begin, It end)
+    {
+        if (begin == end)
+        {
+            return false;
+        }
+
+        T* oldest = *begin;
+        T* newest = oldest;
+        for (It it = std::next(begin); it != end; ++it)
+        {
+            (*it)->*next = newest;
+            newest = *it;
+        }
+
+        T* head = mHead.load(std::memory_order_relaxed);
+        do
+        {
+            oldest->*next = head;
+        }
+        while (!mHead.compare_exchange_weak(head, newest));
+        return !head;
+    }
+
+    bool empty() const
+    {
+        return !mHead.load();
+    }
+
+    // calls f(T*) for every pushed element, the oldest first
+    template<class F>
+    void drain(F&& f)
+    {
+        // the pushed elements are linked from the newest one
+        T* pending = nullptr;
+        for (T* t = mHead.exchange(nullptr); t; )
+        {
+            T* older = t->*next;
+            t->*next = pending;
+            pending = t;
+            t = older;
+        }
+
+        while (pending)
+        {
+            T* t = pending;
+            pending = t->*next;
+            t->*next = nullptr;
+            f(t);
+        }
+    }
+};
+
 template<typename CharT>
 struct UnicodeCodepointIteratorTraits;
 
@@ -1109,6 +1221,10 @@ int icuLikeCompare(const uint8_t* zPattern, /* LIKE pattern */
                    const uint8_t* zString, /* The UTF-8 string to compare against */
                    const UChar32 uEsc); /* The escape character */
 
+// Fold the case of an UTF-8 string, code point by code point as icuLikeCompare() does, so two
+// strings are equal once folded if icuLikeCompare() finds them equal (without wildcards)
+std::string foldCaseUtf8(const std::string& value);
+
 // Get the current process ID
 unsigned long getCurrentPid();
 
@@ -1273,6 +1389,14 @@ ScopedValue<T> makeScopedValue(T& what, T value)
  */
 int naturalsorting_compare(const char* i, const char* j);
 
+/**
+ * @brief Binary key of a char string for natural sorting ignoring case
+ *
+ * Keys compare with memcmp (shorter first if one is a prefix of the other) in the same order
+ * as naturalsorting_compare() does with the strings, so they can be stored and indexed.
+ */
+std::string naturalsorting_key(const char* s);
+
 } // namespace mega
 
 #endif // MEGA_UTILS_H
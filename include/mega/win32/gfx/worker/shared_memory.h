@@ -0,0 +1,51 @@
+#pragma once
+#include "mega/types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace mega {
+namespace gfx {
+
+// A named file mapping backed by the paging file, mapped in this process.
+// The system removes it once all the processes using it close it.
+class SharedMemory
+{
+public:
+    SharedMemory(const SharedMemory&) = delete;
+
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    ~SharedMemory();
+
+    // create a new one
+    static std::unique_ptr<SharedMemory> create(const std::string& name, size_t size);
+
+    // map an existing one, with the size it was created with
+    static std::unique_ptr<SharedMemory> open(const std::string& name);
+
+    uint8_t* data() const { return static_cast<uint8_t*>(mData); }
+
+    size_t size() const { return mSize; }
+
+    const std::string& name() const { return mName; }
+
+private:
+    SharedMemory(const std::string& name, HANDLE mapping, void* data, size_t size);
+
+    // the name of the file mapping object, in the session namespace
+    static std::wstring toMappingName(const std::string& name);
+
+    std::string mName;
+
+    HANDLE mMapping = NULL;
+
+    void* mData = nullptr;
+
+    size_t mSize = 0;
+};
+
+} // namespace
+}
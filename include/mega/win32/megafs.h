@@ -59,7 +59,7 @@ public:
     unique_ptr<DirAccess>  newdiraccess() override;
 
 #ifdef ENABLE_SYNC
-    DirNotify* newdirnotify(LocalNode& root, const LocalPath& rootPath, Waiter* waiter) override;
+    DirNotify* newdirnotify(LocalNode& root, const LocalPath& rootPath, Waiter* waiter, const DirNotify::ResumePoint& resumeFrom) override;
 #endif
 
     bool issyncsupported(const LocalPath&, bool&, SyncError&, SyncWarning&) override;
@@ -89,7 +89,8 @@ public:
     static void emptydirlocal(const LocalPath&, dev_t = 0);
 
     ScanResult directoryScan(const LocalPath& path, handle expectedFsid,
-        map<LocalPath, FSNode>& known, std::vector<FSNode>& results, bool followSymlinks, unsigned& nFingerprinted) override;
+        map<LocalPath, FSNode>& known, std::vector<FSNode>& results, bool followSymlinks, unsigned& nFingerprinted,
+        std::vector<size_t>* unfingerprinted) override;
 
     WinFileSystemAccess();
     ~WinFileSystemAccess();
@@ -127,6 +128,7 @@ private:
     Waiter* clientWaiter;
 
     string notifybuf;
+    string processbuf;
     DWORD dwBytes;
     OVERLAPPED overlapped;
 
@@ -134,6 +136,27 @@ private:
     void process(DWORD wNumberOfBytesTransfered);
     void readchanges();
 
+    // The volume's USN journal, if we're allowed to read it (it needs administrator rights).
+    // Lets the changes made while we weren't running be replayed on the next start.
+    HANDLE hVolume = INVALID_HANDLE_VALUE;
+    string mJournalID;
+
+    // USN up to which changes have surely been queued, and the one that will be once
+    // the next batch of notifications arrives (notifications lag the journal a little).
+    std::atomic<uint64_t> mLastUsn{0};
+    std::atomic<uint64_t> mPendingUsn{0};
+
+    // true if the changes journaled since the last run were queued
+    bool mReplaysChanges = false;
+
+    bool openJournal(const std::wstring& path);
+    bool queryJournal(uint64_t& nextUsn);
+    // queues the changes journaled from fromUsn to toUsn, false if some of them can't be read
+    bool replayJournal(uint64_t fromUsn, uint64_t toUsn);
+
+    // after notifications were lost, queues the changes of the folders touched since the last batch, from the journal
+    bool recoverFromJournal();
+
     static std::atomic<unsigned> smNotifierCount;
     static std::mutex smNotifyMutex;
     static HANDLE smEventHandle;
@@ -146,9 +169,14 @@ public:
     WinDirNotify(LocalNode& root,
                  const LocalPath& rootPath,
                  WinFileSystemAccess* owner,
-                 Waiter* waiter);
+                 Waiter* waiter,
+                 const ResumePoint& resumeFrom);
 
     ~WinDirNotify();
+
+    ResumePoint resumePoint() const override;
+
+    bool replaysChanges() const override;
 };
 #endif
 
@@ -158,7 +186,12 @@ struct MEGA_API WinAsyncIOContext : public AsyncIOContext
     virtual ~WinAsyncIOContext();
     virtual void finish();
 
-    OVERLAPPED *overlapped;
+    // sets up the OVERLAPPED of the next ReadFileEx/WriteFileEx at posOfBuffer.
+    // It's part of the context, so the operations don't allocate one each
+    OVERLAPPED* prepareoverlapped();
+
+    OVERLAPPED overlapped;
+    bool pending = false;
 };
 
 class MEGA_API WinFileAccess : public FileAccess
@@ -182,6 +215,8 @@ public:
 
     bool ftruncate(m_off_t size) override;
 
+    bool fpreallocate(m_off_t size) override;
+
     bool sysread(byte *, unsigned, m_off_t) override;
     bool sysstat(m_time_t*, m_off_t*, FSLogging) override;
     bool sysopen(bool async, FSLogging) override;
@@ -74,6 +74,7 @@ class MegaScheduledCopy;
 class MegaSync;
 class MegaStringList;
 class MegaNodeList;
+class MegaNodeChangeList;
 class MegaUserList;
 class MegaUserAlertList;
 class MegaContactRequestList;
@@ -84,6 +85,8 @@ class MegaTimeZoneDetails;
 class MegaPushNotificationSettings;
 class MegaBackgroundMediaUpload;
 class MegaCancelToken;
+class MegaUploadBatch;
+class MegaDownloadBatch;
 class MegaApi;
 class MegaSemaphore;
 class MegaScheduledMeeting;
@@ -3813,6 +3816,81 @@ class MegaNodeList
         virtual void addNode(MegaNode* node);
 };
 
+/**
+ * @brief Compact list of changes of nodes
+ *
+ * Instead of full MegaNode objects, every entry has the handle of a node, the handle of its
+ * parent and the bitmask of its changes (see MegaNode::getChanges). Changes received for a
+ * node while it was waiting to be taken by the app are merged into a single entry. When
+ * MegaNode::CHANGE_TYPE_REMOVED is set, the node doesn't exist anymore.
+ *
+ * Current values of the nodes can be obtained using MegaApi::getNodeByHandle, only when
+ * the app needs them.
+ *
+ * Objects of this class are immutable.
+ *
+ * @see MegaApi::setNodeChangesBufferSize, MegaApi::popNodeChanges
+ */
+class MegaNodeChangeList
+{
+    protected:
+        MegaNodeChangeList();
+
+    public:
+        virtual ~MegaNodeChangeList();
+
+        virtual MegaNodeChangeList* copy() const;
+
+        /**
+         * @brief Returns the number of changed nodes in the list
+         * @return Number of changed nodes in the list
+         */
+        virtual int size() const;
+
+        /**
+         * @brief Returns the handle of the node at the position i in the list
+         *
+         * If the index is >= the size of the list, this function returns INVALID_HANDLE.
+         *
+         * @param i Position of the change in the list
+         * @return Handle of the changed node
+         */
+        virtual MegaHandle getHandle(int i) const;
+
+        /**
+         * @brief Returns the handle of the parent of the node at the position i in the list
+         *
+         * It's the parent after the last change. If the index is >= the size of the list, or the
+         * node has no parent, this function returns INVALID_HANDLE.
+         *
+         * @param i Position of the change in the list
+         * @return Handle of the parent of the changed node
+         */
+        virtual MegaHandle getParentHandle(int i) const;
+
+        /**
+         * @brief Returns the bitmask of changes of the node at the position i in the list
+         *
+         * The values are the same of MegaNode::getChanges. If the index is >= the size of
+         * the list, this function returns 0.
+         *
+         * @param i Position of the change in the list
+         * @return Bitmask of changes of the node
+         */
+        virtual uint64_t getChanges(int i) const;
+
+        /**
+         * @brief Returns true if some changes were lost before this list
+         *
+         * It happens when more nodes changed than the buffer could hold, or when the full
+         * account was reloaded. The app should then reload the nodes it's showing, as it
+         * would do when MegaGlobalListener::onNodesUpdate receives NULL.
+         *
+         * @return True if changes were lost
+         */
+        virtual bool isIncomplete() const;
+};
+
 /**
  * @brief Lists of file and folder children MegaNode objects
  *
@@ -4523,7 +4601,10 @@ class MegaRequest
             TYPE_ENABLE_MOUNT                                               = 189,
             TYPE_REMOVE_MOUNT                                               = 190,
             TYPE_SET_MOUNT_FLAGS                                            = 191,
-            TOTAL_OF_REQUEST_TYPES                                          = 192,
+            TYPE_GET_THUMBNAILS                                             = 192,
+            TYPE_SEARCH_NODES                                               = 193,
+            TYPE_GET_USER_ATTRIBUTES                                        = 194,
+            TOTAL_OF_REQUEST_TYPES                                          = 195,
         };
 
         virtual ~MegaRequest();
@@ -5378,6 +5459,19 @@ class MegaRequest
          */
         virtual MegaSetElementList* getMegaSetElementList() const;
 
+        /**
+         * @brief Returns a list of nodes
+         *
+         * The SDK retains the ownership of the returned value. It will be valid until
+         * the MegaRequest object is deleted.
+         *
+         * This value is valid for these requests in onRequestUpdate and onRequestFinish:
+         * - MegaApi::searchNodes - Returns the nodes found since the previous callback
+         *
+         * @return List of nodes
+         */
+        virtual MegaNodeList* getMegaNodeList() const;
+
         virtual MegaBackupInfoList* getMegaBackupInfoList() const;
 
 #ifdef ENABLE_SYNC
@@ -5485,6 +5579,7 @@ public:
         EVENT_DOWNGRADE_ATTACK          = 19, // A downgrade attack has been detected. Removed shares may have reappeared. Please tread carefully.
         EVENT_CONFIRM_USER_EMAIL        = 20, // Ephemeral account confirmed the associated email
         EVENT_CREDIT_CARD_EXPIRY        = 21, // Credit card is due to expire soon or when a new card is registered
+        EVENT_DEFERRED_CACHE_LOADED     = 22, // User alerts and Sets of the local cache loaded after a fast resume
     };
 
     enum
@@ -8095,6 +8190,24 @@ class MegaTransferListener
          */
         virtual void onTransferStart(MegaApi *api, MegaTransfer *transfer);
 
+        /**
+         * @brief This function is called when several transfers are about to start being processed
+         *
+         * It is called instead of onTransferStart for the transfers submitted together with
+         * MegaApi::startUploads or MegaApi::startDownloads that start while their batch is
+         * being processed. The listener passed to those functions and the listeners registered
+         * with MegaApi::addTransferListener receive a single callback for all of them.
+         *
+         * By default, it calls onTransferStart for each transfer in the list.
+         *
+         * The SDK retains the ownership of the transfers parameter.
+         * Don't use it after this functions returns.
+         *
+         * @param api MegaApi object that started the transfers
+         * @param transfers Information about the transfers
+         */
+        virtual void onTransfersStart(MegaApi *api, MegaTransferList *transfers);
+
         /**
          * @brief This function is called when a transfer has finished
          *
@@ -8140,6 +8253,24 @@ class MegaTransferListener
          */
         virtual void onTransferUpdate(MegaApi *api, MegaTransfer *transfer);
 
+        /**
+         * @brief This function is called to inform about the progress of several transfers at once
+         *
+         * It is only called for listeners registered with MegaApi::addTransferListener or MegaApi::addListener,
+         * if MegaApi::setTransferUpdatesBatched is enabled. In that case, their onTransferUpdate isn't called
+         * for the progress of the transfers anymore: the latest progress of each transfer is delivered here,
+         * at most once per interval set by MegaApi::setTransferUpdateInterval.
+         *
+         * By default, it calls onTransferUpdate for each transfer in the list.
+         *
+         * The SDK retains the ownership of the transfers parameter.
+         * Don't use it after this functions returns.
+         *
+         * @param api MegaApi object that started the transfers
+         * @param transfers Information about the transfers
+         */
+        virtual void onTransfersUpdate(MegaApi *api, MegaTransferList *transfers);
+
         /**
          * @brief This function is called to inform about the progress of a folder transfer
          *
@@ -8363,6 +8494,20 @@ class MegaGlobalListener
          */
         virtual void onNodesUpdate(MegaApi* api, MegaNodeList *nodes);
 
+        /**
+         * @brief This function is called when there are changes of nodes ready to be taken
+         *
+         * It's only used when a buffer of node changes has been set with
+         * MegaApi::setNodeChangesBufferSize. In that case, onNodesUpdate isn't called.
+         *
+         * It's called when changes arrive and there were none pending, so the app should take
+         * them with MegaApi::popNodeChanges until it returns an empty list. This function doesn't
+         * need to do that itself, they can be taken from any thread.
+         *
+         * @param api MegaApi object connected to the account
+         */
+        virtual void onNodeChangesAvailable(MegaApi* api);
+
         /**
          * @brief This function is called when the account has been updated (confirmed/upgraded/downgraded)
          *
@@ -8611,6 +8756,9 @@ class MegaGlobalListener
          * - MegaEvent::EVENT_CREDIT_CARD_EXPIRY: Credit card is due to expire soon or a new card has been registered. After receiving this event,
          * app should call to MegaApi::fetchCreditCardInfo to receive info about credit card
          *
+         * - MegaEvent::EVENT_DEFERRED_CACHE_LOADED: The user alerts and Sets of the local cache are available
+         * after a session was resumed with MegaApi::setFastResume enabled.
+         *
          * @param api MegaApi object connected to the account
          * @param event Details about the event
          */
@@ -8728,6 +8876,24 @@ class MegaListener
          */
         virtual void onTransferStart(MegaApi *api, MegaTransfer *transfer);
 
+        /**
+         * @brief This function is called when several transfers are about to start being processed
+         *
+         * It is called instead of onTransferStart for the transfers submitted together with
+         * MegaApi::startUploads or MegaApi::startDownloads that start while their batch is
+         * being processed. The listener passed to those functions and the listeners registered
+         * with MegaApi::addListener receive a single callback for all of them.
+         *
+         * By default, it calls onTransferStart for each transfer in the list.
+         *
+         * The SDK retains the ownership of the transfers parameter.
+         * Don't use it after this functions returns.
+         *
+         * @param api MegaApi object that started the transfers
+         * @param transfers Information about the transfers
+         */
+        virtual void onTransfersStart(MegaApi *api, MegaTransferList *transfers);
+
         /**
          * @brief This function is called when a transfer has finished
          *
@@ -8776,6 +8942,24 @@ class MegaListener
          */
         virtual void onTransferUpdate(MegaApi *api, MegaTransfer *transfer);
 
+        /**
+         * @brief This function is called to inform about the progress of several transfers at once
+         *
+         * It is only called for listeners registered with MegaApi::addTransferListener or MegaApi::addListener,
+         * if MegaApi::setTransferUpdatesBatched is enabled. In that case, their onTransferUpdate isn't called
+         * for the progress of the transfers anymore: the latest progress of each transfer is delivered here,
+         * at most once per interval set by MegaApi::setTransferUpdateInterval.
+         *
+         * By default, it calls onTransferUpdate for each transfer in the list.
+         *
+         * The SDK retains the ownership of the transfers parameter.
+         * Don't use it after this functions returns.
+         *
+         * @param api MegaApi object that started the transfers
+         * @param transfers Information about the transfers
+         */
+        virtual void onTransfersUpdate(MegaApi *api, MegaTransferList *transfers);
+
         /**
          * @brief This function is called when there is a temporary error processing a transfer
          *
@@ -8837,6 +9021,20 @@ class MegaListener
          */
         virtual void onNodesUpdate(MegaApi* api, MegaNodeList *nodes);
 
+        /**
+         * @brief This function is called when there are changes of nodes ready to be taken
+         *
+         * It's only used when a buffer of node changes has been set with
+         * MegaApi::setNodeChangesBufferSize. In that case, onNodesUpdate isn't called.
+         *
+         * It's called when changes arrive and there were none pending, so the app should take
+         * them with MegaApi::popNodeChanges until it returns an empty list. This function doesn't
+         * need to do that itself, they can be taken from any thread.
+         *
+         * @param api MegaApi object connected to the account
+         */
+        virtual void onNodeChangesAvailable(MegaApi* api);
+
         /**
          * @brief This function is called when the account has been updated (confirmed/upgraded/downgraded)
          *
@@ -9226,6 +9424,9 @@ class MegaListener
          *
          * - MegaEvent::EVENT_DOWNGRADE_ATTACK: A downgrade attack has been detected. Removed shares may have reappeared. Please tread carefully.
          *
+         * - MegaEvent::EVENT_DEFERRED_CACHE_LOADED: The user alerts and Sets of the local cache are available
+         * after a session was resumed with MegaApi::setFastResume enabled.
+         *
          * @param api MegaApi object connected to the account
          * @param event Details about the event
          */
@@ -9365,8 +9566,13 @@ public:
      * and takes up the same amount of space on the device. The size of the portions must first be calculated by using
      * the 'adjustsizeonly' parameter, and iterating from the start of the file, specifying the approximate sizes of the portions.
      *
-     * Encryption is done by reading small pieces of the file, encrypting them, and outputting to the new file,
-     * so that RAM usage is not excessive.
+     * Encryption is done by reading pieces of the file of up to 16 MB, encrypting their chunks in parallel with the
+     * worker threads of the SDK, and outputting them to the new file, so that RAM usage is not excessive.
+     *
+     * Large files don't need to be encrypted in a single call: encrypting them by portions, the upload of
+     * each portion can start as soon as it is encrypted, while the next one is being encrypted. The state needed
+     * to continue (the MACs of the chunks encrypted so far) is part of MegaBackgroundMediaUpload::serialize, so
+     * an interrupted operation resumes from the last portion completed, with a new call for the next one.
      *
      * You take ownership of the returned value.
      *
@@ -9770,6 +9976,24 @@ public:
      */
     static MegaSearchPage* createInstance(size_t startingOffset, size_t size);
 
+    /**
+     * @brief Creates a new instance of MegaSearchPage that starts right after a given node
+     *
+     * This is keyset paging: the page starts after the last node of the previous page, obtained
+     * with the same filter and order, instead of skipping a number of results. Retrieving a page
+     * takes the same time no matter how many results were retrieved before, which makes it the
+     * preferred option to scroll through big folders. Nodes added or removed in the meantime don't
+     * shift the following pages either. The first page is obtained with createInstance(0, size).
+     *
+     * The relevant attributes of the node are copied, so it can be deleted after this call.
+     *
+     * @param lastNode Last node of the previous page
+     * @param size The maximum number of results included in the page, or 0 to return all (remaining) results
+     *
+     * @return A pointer of current type, a superclass of the private object
+     */
+    static MegaSearchPage* createInstanceAfter(MegaNode* lastNode, size_t size);
+
     /**
      * @brief Create a copy of this instance.
      *
@@ -9798,6 +10022,14 @@ public:
      * @return maximum number of results included in the page, or 0 to return all (remaining) results
      */
     virtual size_t size() const;
+
+    /**
+     * @brief Return the handle of the node after which the page starts
+     *
+     * @return handle of the node passed to createInstanceAfter(), or INVALID_HANDLE
+     * if the page starts at startingOffset()
+     */
+    virtual MegaHandle lastNodeHandle() const;
 };
 
 class MegaNodeTree
@@ -10180,6 +10412,7 @@ class MegaApi
         static constexpr int64_t INVALID_CUSTOM_MOD_TIME = -1;
         static constexpr int CHAT_OPTIONS_EMPTY = 0;
         static constexpr int MAX_NODE_DESCRIPTION_SIZE = 3000;
+        static constexpr unsigned WORKER_THREADS_PER_CORE = ~0u;
 
         /**
          * @brief Constructor suitable for most applications
@@ -10195,6 +10428,8 @@ class MegaApi
          * @param workerThreadCount The number of worker threads for encryption or other operations
          * Using worker threads means that synchronous function calls on MegaApi will be blocked less,
          * and uploads and downloads can proceed more quickly on very fast connections.
+         * Pass MegaApi::WORKER_THREADS_PER_CORE to start one worker thread per hardware thread,
+         * so the transfer crypto of servers with many cores doesn't fall behind the network.
          *
          * @param clientType Client type (default, VPN or Password Manager) enables SDK to function differently
          *
@@ -10224,6 +10459,8 @@ class MegaApi
          * @param workerThreadCount The number of worker threads for encryption or other operations
          * Using worker threads means that synchronous function calls on MegaApi will be blocked less,
          * and uploads and downloads can proceed more quickly on very fast connections.
+         * Pass MegaApi::WORKER_THREADS_PER_CORE to start one worker thread per hardware thread,
+         * so the transfer crypto of servers with many cores doesn't fall behind the network.
          *
          * @param clientType Client type (default, VPN or Password Manager) enables SDK to function differently
          *
@@ -10254,6 +10491,8 @@ class MegaApi
          * @param workerThreadCount The number of worker threads for encryption or other operations
          * Using worker threads means that synchronous function calls on MegaApi will be blocked less,
          * and uploads and downloads can proceed more quickly on very fast connections.
+         * Pass MegaApi::WORKER_THREADS_PER_CORE to start one worker thread per hardware thread,
+         * so the transfer crypto of servers with many cores doesn't fall behind the network.
          *
          * @param clientType Client type (default, VPN or Password Manager) enables SDK to function differently
          *
@@ -10302,6 +10541,41 @@ class MegaApi
          */
         void addGlobalListener(MegaGlobalListener* listener);
 
+        /**
+         * @brief Receive the changes of nodes through a buffer instead of MegaNode lists
+         *
+         * By default, every change of nodes is notified by onNodesUpdate with copies of the
+         * changed nodes. It can be too expensive when many nodes change at once (ie. tens of
+         * thousands of nodes moved).
+         *
+         * When the buffer is set, the changes are stored as MegaNodeChangeList entries (handle,
+         * parent and bitmask of changes), listeners are notified by onNodeChangesAvailable and
+         * the app takes the changes with MegaApi::popNodeChanges. New changes of a node that is
+         * already in the buffer are merged into its entry.
+         *
+         * If more nodes than 'size' get changes before the app takes them, the changes are
+         * dropped and the next list returned by MegaApi::popNodeChanges is incomplete.
+         *
+         * Changing the size drops the changes in the buffer.
+         *
+         * @param size Maximum number of changed nodes in the buffer. 0 disables it (the default)
+         */
+        void setNodeChangesBufferSize(unsigned int size);
+
+        /**
+         * @brief Take the oldest changes of nodes from the buffer
+         *
+         * It can be called from any thread.
+         *
+         * You take the ownership of the returned value.
+         *
+         * @param maxCount Maximum number of changes to take. 0 takes all of them
+         * @return List of changes of nodes, empty if there are none pending
+         *
+         * @see MegaApi::setNodeChangesBufferSize
+         */
+        MegaNodeChangeList* popNodeChanges(unsigned int maxCount);
+
         /**
          * @brief Add a listener for all events related to backups
          * @param listener Listener that will receive backup events
@@ -12300,6 +12574,54 @@ class MegaApi
          */
         static void log(int logLevel, const char* message, const char *filename = "", int line = -1);
 
+        /**
+         * @brief Get the performance metrics of the SDK, to profile it without verbose logs
+         *
+         * The metrics are collected by all the MegaApi instances of the process, and they are
+         * always enabled. The result is a JSON object with these members:
+         * - "counters": number of events since the last reset, by name
+         * - "gauges": current values, by name
+         * - "histograms": latencies of the hot paths of the SDK (e.g. "MegaClient_exec",
+         * "TransferSlot_doio" or "SqliteAccountState_query"), by name. Each one is an object with
+         * the number of samples ("count"), their sum ("sum_us"), the maximum ("max_us") and the
+         * percentiles 50, 90, 99 and 99.9 ("p50_us", "p90_us", "p99_us" and "p999_us"), in microseconds.
+         * Percentiles are approximated to an error of 25% at most.
+         *
+         * The names of the metrics are not part of the API and may change between versions.
+         *
+         * You take the ownership of the returned value. Use delete [] to free it.
+         *
+         * @param reset True to start the counters and the histograms again from zero
+         * @return JSON object with the metrics
+         */
+        static char* getPerformanceSnapshot(bool reset = false);
+
+        /**
+         * @brief Start or stop recording the timeline of the hot paths of the SDK
+         *
+         * While enabled, the SDK records spans of its main operations (e.g. the processing of a
+         * batch of commands, a sync pass, a database query), in buffers of each thread that keep
+         * the latest ones. Use MegaApi::dumpTrace to get them.
+         *
+         * Tracing is only available if the SDK is built with ENABLE_TRACING. It's disabled by default.
+         *
+         * @param enable True to record the spans
+         */
+        static void setTracingEnabled(bool enable);
+
+        /**
+         * @brief Get the spans recorded since the previous call, in Chrome trace JSON format
+         *
+         * The result can be opened with chrome://tracing or https://ui.perfetto.dev, and it shows
+         * a track for each thread of the SDK (e.g. "request", "sync", "transfer", "fuse").
+         * The spans returned are discarded.
+         *
+         * You take the ownership of the returned value. Use delete [] to free it.
+         *
+         * @return Chrome trace JSON
+         */
+        static char* dumpTrace();
+
         /**
          * @brief Differentiate MegaApi log output from different instances.
          *
@@ -12937,6 +13259,35 @@ class MegaApi
          */
         void getThumbnail(MegaNode* node, const char *dstFilePath, MegaRequestListener *listener = NULL);
 
+        /**
+         * @brief Get the thumbnails of a set of nodes in memory
+         *
+         * This is intended for grids of thumbnails: the thumbnails are not written to files, but delivered
+         * in batches as they arrive, and the latest ones are kept decrypted in a RAM cache for the next calls.
+         * Nodes without a thumbnail are ignored.
+         *
+         * The thumbnails are requested in the order of the list, so the visible nodes should come first.
+         * The thumbnails still pending for previous calls that are not in this list are considered off-screen
+         * and cancelled. An empty list cancels all of them.
+         *
+         * The associated request type with this request is MegaRequest::TYPE_GET_THUMBNAILS
+         * Valid data in the MegaRequest object received on callbacks:
+         * - MegaRequest::getMegaHandleList - Returns the handles of the nodes
+         * - MegaRequest::getParamType - Returns MegaApi::ATTR_TYPE_THUMBNAIL
+         *
+         * Valid data in the MegaRequest object received in onRequestUpdate and onRequestFinish:
+         * - MegaRequest::getMegaStringMap - Returns the thumbnails received since the previous callback.
+         * The keys are the Base64-encoded handles of the nodes and the values the Base64-encoded JPEG thumbnails
+         * - MegaRequest::getNumber - Returns the number of thumbnails still pending
+         *
+         * The request finishes when there are no thumbnails pending, with MegaError::API_EINCOMPLETE
+         * if some of them were cancelled or failed.
+         *
+         * @param nodeHandles Handles of the nodes to get the thumbnails
+         * @param listener MegaRequestListener to track this request
+         */
+        void getThumbnails(MegaHandleList* nodeHandles, MegaRequestListener *listener = NULL);
+
         /**
          * @brief Get the preview of a node
          *
@@ -13237,6 +13588,34 @@ class MegaApi
          */
         void getUserAttribute(const char *email_or_handle, int type, MegaRequestListener *listener = NULL);
 
+        /**
+         * @brief Get a public attribute of a set of users at once
+         *
+         * This is intended for lists of contacts or of chat participants: the values already known are
+         * taken from the local cache, and the rest are requested to the servers together, instead of
+         * one request per user.
+         *
+         * The associated request type with this request is MegaRequest::TYPE_GET_USER_ATTRIBUTES
+         * Valid data in the MegaRequest object received on callbacks:
+         * - MegaRequest::getMegaHandleList - Returns the handles of the users
+         * - MegaRequest::getParamType - Returns the attribute type
+         *
+         * Valid data in the MegaRequest object received in onRequestFinish:
+         * - MegaRequest::getMegaStringMap - Returns the values of the attribute. The keys are the
+         * Base64-encoded handles of the users and the values the Base64-encoded values of the attribute
+         *
+         * The request finishes with MegaError::API_EINCOMPLETE if the attribute couldn't be obtained for
+         * some of the users, other than the ones that don't have it. The values obtained are provided anyway.
+         *
+         * @param users Handles of the users
+         * @param type Attribute type. Only the public ones, other than the avatar, are valid:
+         * MegaApi::USER_ATTR_FIRSTNAME, MegaApi::USER_ATTR_LASTNAME, MegaApi::USER_ATTR_ED25519_PUBLIC_KEY,
+         * MegaApi::USER_ATTR_CU25519_PUBLIC_KEY, MegaApi::USER_ATTR_SIG_RSA_PUBLIC_KEY and
+         * MegaApi::USER_ATTR_SIG_CU255_PUBLIC_KEY
+         * @param listener MegaRequestListener to track this request
+         */
+        void getUserAttributes(MegaHandleList* users, int type, MegaRequestListener *listener = NULL);
+
         /**
          * @brief Get an attribute of the current account.
          *
@@ -13752,6 +14131,73 @@ class MegaApi
          */
         void setNodeSensitive(MegaNode* node, bool sensitive, MegaRequestListener* listener = NULL);
 
+        /**
+         * @brief Set the label of several nodes at once
+         *
+         * The commands for all the nodes are sent to MEGA in the same batch, and the request
+         * finishes once all of them have been processed. Valid values for the label are the ones
+         * of MegaApi::setNodeLabel, MegaNode::NODE_LBL_UNKNOWN removes it.
+         *
+         * The associated request type with this request is MegaRequest::TYPE_SET_ATTR_NODE
+         * Valid data in the MegaRequest object received on callbacks:
+         * - MegaRequest::getMegaHandleList - Returns the handles of the nodes
+         * - MegaRequest::getNumDetails - Returns the label for the nodes
+         * - MegaRequest::getFlag - Returns true (official attribute)
+         * - MegaRequest::getParamType - Returns MegaApi::NODE_ATTR_LABEL
+         *
+         * If any of the nodes doesn't exist or can't be modified, no node is changed and
+         * onRequestFinish will be called with the error code MegaError::API_ENOENT or
+         * MegaError::API_EACCESS. If the update of a node fails, the rest are still updated
+         * and onRequestFinish reports the first error found.
+         *
+         * @param nodes Nodes that will receive the information.
+         * @param label Label of the nodes
+         * @param listener MegaRequestListener to track this request
+         */
+        void setNodesLabel(MegaNodeList* nodes, int label, MegaRequestListener* listener = NULL);
+
+        /**
+         * @brief Set or remove the favourite attribute of several nodes at once
+         *
+         * The commands for all the nodes are sent to MEGA in the same batch, and the request
+         * finishes once all of them have been processed.
+         *
+         * The associated request type with this request is MegaRequest::TYPE_SET_ATTR_NODE
+         * Valid data in the MegaRequest object received on callbacks:
+         * - MegaRequest::getMegaHandleList - Returns the handles of the nodes
+         * - MegaRequest::getNumDetails - Returns 1 if nodes are set as favourite, otherwise return 0
+         * - MegaRequest::getFlag - Returns true (official attribute)
+         * - MegaRequest::getParamType - Returns MegaApi::NODE_ATTR_FAV
+         *
+         * Errors are reported as in MegaApi::setNodesLabel.
+         *
+         * @param nodes Nodes that will receive the information.
+         * @param fav if true set nodes as favourite, otherwise remove the attribute
+         * @param listener MegaRequestListener to track this request
+         */
+        void setNodesFavourite(MegaNodeList* nodes, bool fav, MegaRequestListener* listener = NULL);
+
+        /**
+         * @brief Mark or unmark several nodes as sensitive at once
+         *
+         * The commands for all the nodes are sent to MEGA in the same batch, and the request
+         * finishes once all of them have been processed.
+         *
+         * The associated request type with this request is MegaRequest::TYPE_SET_ATTR_NODE
+         * Valid data in the MegaRequest object received on callbacks:
+         * - MegaRequest::getMegaHandleList - Returns the handles of the nodes
+         * - MegaRequest::getNumDetails - Returns 1 if nodes are set as sensitive, otherwise return 0
+         * - MegaRequest::getFlag - Returns true (official attribute)
+         * - MegaRequest::getParamType - Returns MegaApi::NODE_ATTR_SEN
+         *
+         * Errors are reported as in MegaApi::setNodesLabel.
+         *
+         * @param nodes Nodes that will receive the information.
+         * @param sensitive if true set nodes as sensitive, otherwise remove the attribute
+         * @param listener MegaRequestListener to track this request
+         */
+        void setNodesSensitive(MegaNodeList* nodes, bool sensitive, MegaRequestListener* listener = NULL);
+
         /**
         * @brief Ascertain if the node is marked as sensitive or a descendent of such
         *
@@ -13890,6 +14336,30 @@ class MegaApi
          */
         void addNodeTag(MegaNode* node, const char* tag, MegaRequestListener* listener = NULL);
 
+        /**
+         * @brief Add a new tag to several nodes at once
+         *
+         * The commands for all the nodes are sent to MEGA in the same batch, and the request
+         * finishes once all of them have been processed. Nodes that already have the tag are
+         * left as they are.
+         *
+         * The associated request type with this request is MegaRequest::TYPE_TAG_NODE
+         * Valid data in the MegaRequest object received on callbacks:
+         * - MegaRequest::getMegaHandleList - Returns the handles of the nodes
+         * - MegaRequest::getParamType - Returns operation type (0 - Add tag)
+         * - MegaRequest::getText - Returns tag
+         *
+         * The tag is validated as in MegaApi::addNodeTag. If any of the nodes doesn't exist, no
+         * node is changed and onRequestFinish will be called with the error code MegaError::API_ENOENT.
+         * If the update of a node fails (i.e. too many tags), the rest are still updated and
+         * onRequestFinish reports the first error found.
+         *
+         * @param nodes Nodes that will receive the information.
+         * @param tag New tag
+         * @param listener MegaRequestListener to track this request
+         */
+        void addNodesTag(MegaNodeList* nodes, const char* tag, MegaRequestListener* listener = NULL);
+
         /**
          * @brief Remove a tag stored as a node attribute
          *
@@ -14083,6 +14553,52 @@ class MegaApi
          */
         void fetchNodes(MegaRequestListener *listener = NULL);
 
+        /**
+         * @brief Enable or disable the fast resumption of sessions from the local cache
+         *
+         * When enabled, MegaApi::fetchNodes finishes as soon as the nodes, contacts and chats
+         * of the local cache are loaded. The user alerts and the Sets are loaded in the background
+         * afterwards, and the event MegaEvent::EVENT_DEFERRED_CACHE_LOADED is received once they are
+         * available. Until then, MegaApi::getUserAlerts and the functions to get Sets and Elements
+         * may return partial results.
+         *
+         * The setting applies to the next call to MegaApi::fetchNodes. It's disabled by default.
+         *
+         * @param enable True to enable the fast resumption of sessions
+         */
+        void setFastResume(bool enable);
+
+        /**
+         * @brief Enable or disable the low memory mode, for headless processes that only perform transfers
+         *
+         * When enabled, user alerts are neither fetched nor kept in memory or in the local cache,
+         * and the requests of transfers are sized so that the buffers of all the active transfers
+         * stay near the given budget. MegaApi::setLRUCacheSize limits the nodes kept in memory.
+         *
+         * The user alerts setting applies to the next call to MegaApi::fetchNodes. It's disabled by default.
+         *
+         * @param enable True to enable the low memory mode
+         * @param transferMemoryBudget Bytes for the buffers of all the transfers, or 0 for no limit.
+         * When they are used up, transfers wait for the requests of the others to finish before starting new ones.
+         */
+        void setLowMemoryMode(bool enable, long long transferMemoryBudget = 0);
+
+        /**
+         * @brief Fetch only the subtree of a folder of the folder link, instead of the whole link
+         *
+         * Opening a big folder link at one of its folders is much faster this way: only the
+         * nodes below that folder are downloaded, decrypted and kept, and that folder becomes the
+         * root node of the link (MegaApi::getRootNode). The nodes of the subtree are cached apart
+         * from the ones of the whole link, so they are loaded from the local cache next time.
+         *
+         * It must be called after MegaApi::loginToFolder (which resets it) and applies to the next
+         * call to MegaApi::fetchNodes. To browse the whole link afterwards, call MegaApi::loginToFolder
+         * again.
+         *
+         * @param folder Handle of the folder of the link, or INVALID_HANDLE to fetch the whole link
+         */
+        void setFolderLinkFetchRoot(MegaHandle folder);
+
         /**
          * @brief Get the sum of sizes of all the files stored in the MEGA cloud.
          *
@@ -15552,6 +16068,42 @@ class MegaApi
          */
         void startDownload(MegaNode* node, const char* localPath, const char *customName, const char *appData, bool startFirst, MegaCancelToken *cancelToken, int collisionCheck, int collisionResolution, bool undelete, MegaTransferListener *listener = NULL);
 
+        /**
+         * @brief Upload several files or folders at once
+         *
+         * Each upload of the batch behaves like one started by MegaApi::startUpload with the same
+         * parameters, but all of them are queued with a single operation and created in the same
+         * iteration of the SDK thread, saving the transfers to the local cache in a single transaction.
+         * That is much faster than calling MegaApi::startUpload for each file when starting many of them.
+         *
+         * The transfers that start while the batch is processed are reported with a single call to
+         * MegaTransferListener::onTransfersStart, instead of a call to MegaTransferListener::onTransferStart
+         * for each of them. The rest of the callbacks are received for each transfer as usual.
+         *
+         * @param batch Uploads to start. App retains the ownership of this param, and it can be
+         * deleted or reused as soon as this function returns.
+         * @param listener MegaTransferListener to track all the transfers of the batch
+         */
+        void startUploads(MegaUploadBatch* batch, MegaTransferListener *listener = NULL);
+
+        /**
+         * @brief Download several files or folders from MEGA at once
+         *
+         * Each download of the batch behaves like one started by MegaApi::startDownload with the same
+         * parameters, but all of them are queued with a single operation and created in the same
+         * iteration of the SDK thread, saving the transfers to the local cache in a single transaction.
+         * That is much faster than calling MegaApi::startDownload for each file when starting many of them.
+         *
+         * The transfers that start while the batch is processed are reported with a single call to
+         * MegaTransferListener::onTransfersStart, instead of a call to MegaTransferListener::onTransferStart
+         * for each of them. The rest of the callbacks are received for each transfer as usual.
+         *
+         * @param batch Downloads to start. App retains the ownership of this param, and it can be
+         * deleted or reused as soon as this function returns.
+         * @param listener MegaTransferListener to track all the transfers of the batch
+         */
+        void startDownloads(MegaDownloadBatch* batch, MegaTransferListener *listener = NULL);
+
         /**
          * @brief Start an streaming download for a file in MEGA
          *
@@ -15973,6 +16525,29 @@ class MegaApi
          */
         void setMaxConnections(int connections, MegaRequestListener* listener = NULL);
 
+        /**
+         * @brief Set the minimum interval between progress updates of each transfer
+         *
+         * The intermediate progress of a transfer within the interval is not notified: the next
+         * MegaTransferListener::onTransferUpdate reports all of it. Changes of state and priority,
+         * and the first and last progress, are always notified. By default it is 100 ms.
+         *
+         * @param milliseconds Minimum interval, rounded up to tenths of a second
+         */
+        void setTransferUpdateInterval(int milliseconds);
+
+        /**
+         * @brief Deliver the progress of the transfers in batches to the global listeners
+         *
+         * When enabled, the listeners registered with MegaApi::addTransferListener or MegaApi::addListener
+         * receive the progress of the transfers with MegaTransferListener::onTransfersUpdate, once per interval
+         * set by MegaApi::setTransferUpdateInterval, instead of one onTransferUpdate per transfer.
+         * The listeners of each transfer keep receiving onTransferUpdate. It is disabled by default.
+         *
+         * @param enable True to deliver the progress of the transfers in batches
+         */
+        void setTransferUpdatesBatched(bool enable);
+
         /**
          * @brief Set the transfer method for downloads
          *
@@ -16065,6 +16640,28 @@ class MegaApi
          */
         int getMaxUploadSpeed();
 
+        /**
+         * @brief Enable or disable HTTP/2 multiplexing for API requests and transfers
+         *
+         * When enabled, requests to the same host are multiplexed over a few HTTP/2
+         * connections instead of using one HTTP/1.1 connection per request. This saves
+         * TLS handshakes, especially behind proxies. Servers without HTTP/2 support
+         * keep using HTTP/1.1. The setting applies to new requests.
+         *
+         * This mode is disabled by default.
+         *
+         * @param enable True to enable HTTP/2 multiplexing, false to disable it
+         * @return true if the network layer allows to change the mode, otherwise false
+         */
+        bool setHttp2Enabled(bool enable);
+
+        /**
+         * @brief Check if HTTP/2 multiplexing is enabled
+         *
+         * @return true if HTTP/2 multiplexing is enabled, otherwise false
+         */
+        bool isHttp2Enabled();
+
         /**
          * @brief Return the current download speed
          * @return Download speed in bytes per second
@@ -17127,6 +17724,121 @@ class MegaApi
          */
         unsigned long long getNumNodesAtCacheLRU() const;
 
+        enum
+        {
+            LRU_CACHE_POLICY_LRU = 0,
+            LRU_CACHE_POLICY_CLOCK = 1,
+        };
+
+        /**
+         * @brief Set the replacement policy of the LRU cache of nodes
+         *
+         * Valid values for this parameter are:
+         * - MegaApi::LRU_CACHE_POLICY_LRU = 0
+         * Strict least-recently-used order. It's the default policy.
+         *
+         * - MegaApi::LRU_CACHE_POLICY_CLOCK = 1
+         * CLOCK (second chance) approximation of LRU. Hits are cheaper, since nodes are only
+         * flagged as referenced, at the cost of a less precise eviction order.
+         *
+         * @param policy Replacement policy of the LRU cache
+         */
+        void setLRUCachePolicy(int policy);
+
+        /**
+         * @brief Returns the number of accesses to nodes that were already at cache LRU
+         *
+         * @return Number of hits of the cache LRU
+         */
+        unsigned long long getLRUCacheHits() const;
+
+        /**
+         * @brief Returns the number of accesses to nodes that were not at cache LRU
+         *
+         * Those nodes are loaded from the local database (or were still in RAM, but out of the
+         * cache LRU) and inserted into it.
+         *
+         * @return Number of misses of the cache LRU
+         */
+        unsigned long long getLRUCacheMisses() const;
+
+        /**
+         * @brief Set the number of subfolders to prefetch after a listing of children
+         *
+         * When enabled, once MegaApi::getChildren returns, the children of up to \c folders of
+         * the subfolders it listed (the most recent and the biggest ones first) are loaded in the
+         * background from the local database, so opening any of them doesn't need to wait for it.
+         * A new listing cancels the prefetch of the previous one. The nodes prefetched by a
+         * listing are limited to a quarter of the size of the LRU cache (see MegaApi::setLRUCacheSize).
+         *
+         * By default it's disabled.
+         *
+         * @param folders Subfolders to prefetch after each listing, 0 to disable the prefetch
+         */
+        void setChildrenPrefetch(unsigned int folders);
+
+        enum
+        {
+            DB_PERFORMANCE_PROFILE_DEFAULT = 0,
+            DB_PERFORMANCE_PROFILE_LOW_MEMORY = 1,
+            DB_PERFORMANCE_PROFILE_HIGH_PERFORMANCE = 2,
+        };
+
+        /**
+         * @brief Set the tuning of the local database of the account
+         *
+         * Valid values for this parameter are:
+         * - MegaApi::DB_PERFORMANCE_PROFILE_DEFAULT = 0
+         * Defaults of the database engine. It's the default profile.
+         *
+         * - MegaApi::DB_PERFORMANCE_PROFILE_LOW_MEMORY = 1
+         * Small page cache and no memory-mapped I/O, for devices with little RAM.
+         *
+         * - MegaApi::DB_PERFORMANCE_PROFILE_HIGH_PERFORMANCE = 2
+         * Large page cache, memory-mapped I/O and larger pages for new databases. Commits
+         * aren't synced to disk until the journal is checkpointed, so the last changes
+         * could be lost upon a power loss (they are fetched again from the servers).
+         *
+         * The profile is applied to the databases opened after this call, so it should be
+         * set before the session is resumed or before MegaApi::fetchNodes.
+         *
+         * @param profile Performance profile of the database
+         */
+        void setDatabasePerformanceProfile(int profile);
+
+        /**
+         * @brief Set custom tuning parameters for the local database of the account
+         *
+         * Like MegaApi::setDatabasePerformanceProfile, the parameters are applied to the
+         * databases opened after this call.
+         *
+         * @param mmapSize Bytes of the database accessed through memory-mapped I/O. Use 0 to
+         * disable memory-mapped I/O or a negative value to keep the default.
+         * @param cacheSizeKB KiB of page cache per database connection. Use 0 to keep the default.
+         * @param pageSize Bytes per page of new databases, a power of two from 512 to 65536. Use 0
+         * to keep the default. Existing databases keep their page size.
+         * @param synchronous 0 (OFF), 1 (NORMAL) or 2 (FULL) syncs of the commits. Use -1 to keep the default.
+         */
+        void setDatabasePerformanceParameters(long long mmapSize, long long cacheSizeKB, int pageSize, int synchronous);
+
+        /**
+         * @brief Time the standard queries on the local database of the account
+         *
+         * It runs, 'repetitions' times each, the queries used to count nodes, to list the
+         * children of the Cloud Drive, to search by name, to get recent nodes and to look up
+         * fingerprints, always against the database (nodes in RAM aren't used). It's meant to
+         * compare the performance profiles on a device.
+         *
+         * This function is synchronous and blocks the SDK while the queries run. Call it only
+         * after the nodes have been fetched.
+         *
+         * You take the ownership of the returned value.
+         *
+         * @param repetitions Number of runs of each query
+         * @return Map from the name of each query to its average duration, in microseconds
+         */
+        MegaStringMap* benchmarkDatabase(int repetitions);
+
         enum { ORDER_NONE = 0, ORDER_DEFAULT_ASC, ORDER_DEFAULT_DESC,
             ORDER_SIZE_ASC, ORDER_SIZE_DESC,
             ORDER_CREATION_ASC, ORDER_CREATION_DESC,
@@ -17719,6 +18431,30 @@ class MegaApi
         */
         MegaUserAlertList* getUserAlerts();
 
+        /**
+        * @brief Get a page of the MegaUserAlerts for the logged in user
+        *
+        * The alerts are in the same order as in MegaApi::getUserAlerts: the page
+        * starts at the alert in position \c offset of that list. Only the alerts of
+        * the page are copied, so it's cheaper to list them in pages when there are many.
+        *
+        * You take the ownership of the returned value
+        *
+        * @param offset Position of the first alert of the page
+        * @param size Maximum number of alerts in the page
+        * @return List of MegaUserAlert objects, empty if there are no alerts at \c offset
+        */
+        MegaUserAlertList* getUserAlerts(int offset, int size);
+
+        /**
+         * @brief Get the number of user alerts for the logged in user
+         *
+         * It's the size of the list returned by MegaApi::getUserAlerts, without creating it.
+         *
+         * @return Number of user alerts
+         */
+        int getNumUserAlerts();
+
         /**
          * @brief Get the number of unread user alerts for the logged in user
          *
@@ -18469,6 +19205,34 @@ class MegaApi
          */
         MegaNodeList* search(const MegaSearchFilter* filter, int order = ORDER_NONE, MegaCancelToken* cancelToken = nullptr, const MegaSearchPage* searchPage = nullptr);
 
+        /**
+         * @brief Search nodes in the background, receiving the results in pages
+         *
+         * This is the asynchronous version of MegaApi::search: the results are delivered to the listener
+         * as they are read from the local cache, one page at a time, so big results are shown while the
+         * search goes on, and the SDK isn't blocked by it. Every page is retrieved right after the last node
+         * of the previous one, so it doesn't get slower as the search goes on.
+         *
+         * The associated request type with this request is MegaRequest::TYPE_SEARCH_NODES
+         * Valid data in the MegaRequest object received on callbacks:
+         * - MegaRequest::getParamType - Returns the order of the results
+         * - MegaRequest::getTotalBytes - Returns the size of the pages
+         *
+         * Valid data in the MegaRequest object received in onRequestUpdate and onRequestFinish:
+         * - MegaRequest::getMegaNodeList - Returns the page of nodes found since the previous callback
+         * - MegaRequest::getNumber - Returns the number of nodes found so far
+         *
+         * The request finishes along with the last page (that may be empty). If the search is cancelled
+         * by the cancel token, it finishes with MegaError::API_EINCOMPLETE.
+         *
+         * @param filter Container for filtering options, cannot be null
+         * @param order Order for the returned list, same values as in MegaApi::search
+         * @param pageSize Number of nodes per page, it can't be 0
+         * @param cancelToken MegaCancelToken to be able to cancel the search at any time
+         * @param listener MegaRequestListener to track this request
+         */
+        void searchNodes(const MegaSearchFilter* filter, int order, size_t pageSize, MegaCancelToken* cancelToken = nullptr, MegaRequestListener* listener = nullptr);
+
         /**
          * @brief Search nodes containing a search string in their name
          *
@@ -20468,6 +21232,35 @@ class MegaApi
          */
         int httpServerGetMaxOutputSize();
 
+        /**
+         * @brief Set the number of threads used by the HTTP proxy server to serve connections
+         *
+         * Each thread runs its own event loop with a listening socket bound to the same port,
+         * and the operating system distributes the incoming connections among them. This
+         * allows to serve many concurrent streams without being limited by a single thread.
+         *
+         * Additional threads are only used on platforms that balance connections among
+         * sockets sharing the port (SO_REUSEPORT on Linux), and not for TLS connections.
+         * In any other case the server falls back to a single thread.
+         *
+         * The new value will be taken into account the next time the HTTP proxy server is
+         * started. It's possible and effective to call this function before the server
+         * has been started.
+         *
+         * @param numThreads Number of threads, or a number <= 0 to use a single thread
+         * (default)
+         */
+        void httpServerSetNumThreads(int numThreads);
+
+        /**
+         * @brief Get the number of threads used by the HTTP proxy server
+         *
+         * See MegaApi::httpServerSetNumThreads
+         *
+         * @return Number of threads used by the HTTP proxy server
+         */
+        int httpServerGetNumThreads();
+
         /**
          * @brief Start an FTP server in specified port
          *
@@ -22444,6 +23237,23 @@ class MegaApi
          */
         MegaSetElementList* getSetElements(MegaHandle sid, bool includeElementsInRubbishBin = true);
 
+        /**
+         * @brief Get a page of the Elements in the Set with given id, for current user.
+         *
+         * The Elements are sorted by their order (MegaSetElement::order), and then by id.
+         * Only the Elements of the page are copied, so it's cheaper to list big Sets in pages.
+         *
+         * You take the ownership of the returned value
+         *
+         * @param sid the id of the Set owning the Elements
+         * @param offset position of the first Element of the page
+         * @param size maximum number of Elements in the page
+         * @param includeElementsInRubbishBin consider or filter out Elements in Rubbish Bin
+         *
+         * @return the Elements of the page, or null if the Set was not found or has no Elements
+         */
+        MegaSetElementList* getSetElements(MegaHandle sid, int offset, int size, bool includeElementsInRubbishBin = true);
+
         /**
          * @brief Get a particular Element in a particular Set, for current user.
          *
@@ -24546,6 +25356,109 @@ public:
     virtual bool isCancelled() const = 0;
 };
 
+/**
+ * @brief List of uploads to start together with MegaApi::startUploads
+ */
+class MegaUploadBatch
+{
+protected:
+    MegaUploadBatch();
+
+public:
+    /**
+     * @brief Creates a new instance of MegaUploadBatch
+     *
+     * You take ownership of the returned value.
+     *
+     * @return A pointer to the new object
+     */
+    static MegaUploadBatch* createInstance();
+
+    virtual ~MegaUploadBatch();
+
+    /**
+     * @brief Add an upload to the batch
+     *
+     * The parameters are the same as those of MegaApi::startUpload, except the listener,
+     * which is shared by all the transfers of the batch. They are copied, so the
+     * app retains the ownership of all of them.
+     *
+     * @param localPath Local path of the file or folder
+     * @param parent Parent node for the file or folder in the MEGA account
+     * @param fileName Custom file name for the file or folder in MEGA
+     *  + If you don't need this param provide NULL as value
+     * @param mtime Custom modification time for the file in MEGA (in seconds since the epoch)
+     *  + If you don't need this param provide MegaApi::INVALID_CUSTOM_MOD_TIME as value
+     * @param appData Custom app data to save in the MegaTransfer object
+     *  + If you don't need this param provide NULL as value
+     * @param isSourceTemporary Pass the ownership of the file to the SDK, that will DELETE it when the upload finishes.
+     *  + If you don't need this param provide false as value
+     * @param startFirst puts the transfer on top of the upload queue
+     *  + If you don't need this param provide false as value
+     * @param cancelToken MegaCancelToken to be able to cancel the upload.
+     *  + If you don't need this param provide NULL as value
+     */
+    virtual void add(const char *localPath, MegaNode *parent, const char *fileName, int64_t mtime, const char *appData, bool isSourceTemporary, bool startFirst, MegaCancelToken *cancelToken) = 0;
+
+    /**
+     * @brief Returns the number of uploads in the batch
+     * @return Number of uploads in the batch
+     */
+    virtual unsigned int size() const = 0;
+};
+
+/**
+ * @brief List of downloads to start together with MegaApi::startDownloads
+ */
+class MegaDownloadBatch
+{
+protected:
+    MegaDownloadBatch();
+
+public:
+    /**
+     * @brief Creates a new instance of MegaDownloadBatch
+     *
+     * You take ownership of the returned value.
+     *
+     * @return A pointer to the new object
+     */
+    static MegaDownloadBatch* createInstance();
+
+    virtual ~MegaDownloadBatch();
+
+    /**
+     * @brief Add a download to the batch
+     *
+     * The parameters are the same as those of MegaApi::startDownload, except the listener,
+     * which is shared by all the transfers of the batch. They are copied, so the
+     * app retains the ownership of all of them.
+     *
+     * @param node MegaNode that identifies the file or folder
+     * @param localPath Destination path for the file or folder
+     * If this path is a local folder, it must end with a '\' or '/' character and the file name
+     * in MEGA will be used to store a file inside that folder.
+     * @param customName Custom file name for the file or folder in local destination
+     *  + If you don't need this param provide NULL as value
+     * @param appData Custom app data to save in the MegaTransfer object
+     *  + If you don't need this param provide NULL as value
+     * @param startFirst puts the transfer on top of the download queue
+     *  + If you don't need this param provide false as value
+     * @param cancelToken MegaCancelToken to be able to cancel the download.
+     *  + If you don't need this param provide NULL as value
+     * @param collisionCheck Indicates the collision check on same files, see MegaApi::startDownload
+     * @param collisionResolution Indicates how to save same files, see MegaApi::startDownload
+     * @param undelete Indicates a special request for a node that has been completely deleted
+     */
+    virtual void add(MegaNode* node, const char* localPath, const char *customName, const char *appData, bool startFirst, MegaCancelToken *cancelToken, int collisionCheck, int collisionResolution, bool undelete) = 0;
+
+    /**
+     * @brief Returns the number of downloads in the batch
+     * @return Number of downloads in the batch
+     */
+    virtual unsigned int size() const = 0;
+};
+
 /**
  * @brief Container class to store and load Mega VPN credentials data.
  *
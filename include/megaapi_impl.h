@@ -225,7 +225,8 @@ public:
     bool isCancelledByFolderTransferToken() const;
 
     // check if we have received onTransferFinishCallback for every transfersTotalCount
-    bool allSubtransfersResolved()              { return  transfersFinishedCount >= transfersTotalCount; }
+    // (and no more sub-transfers are yet to be generated)
+    bool allSubtransfersResolved()              { return  !mGeneratingSubtransfers && transfersFinishedCount >= transfersTotalCount; }
 
     // setter/getter for transfersTotalCount
     void setTransfersTotalCount (size_t count)  { transfersTotalCount = count; }
@@ -260,6 +261,10 @@ protected:
     // flag to notify STAGE_TRANSFERRING_FILES to apps, when all sub-transfers have been queued in SDK core already
     bool startedTransferring = false;
 
+    // set while sub-transfers are still being generated and sent in batches (only used from MegaApiImpl's thread):
+    // transfersTotalCount is not final yet, so the operation can't complete even if all the sent ones are resolved
+    bool mGeneratingSubtransfers = false;
+
     // If the thread was started, it queues a completion before exiting
     // That will be executed when the queued request is procesed
     // We also keep a pointer to it here, so cancel() can execute it early.
@@ -284,6 +289,9 @@ protected:
     // return true if thread is stopped or canceled by transfer token
     bool isStoppedOrCancelled(const std::string& name) const;
 
+    // notify STAGE_TRANSFERRING_FILES once all the sub-transfers have been started
+    void checkAllSubtransfersStarted();
+
 private:
     // client ptr to only be used from the MegaApiImpl's thread
     MegaClient* mMegaapiThreadClient;
@@ -353,7 +361,8 @@ protected:
     /* Scan entire tree recursively, and retrieve folder structure and files to be uploaded.
      * A putnodes command can only add subtrees under same target, so in case we need to add
      * subtrees under different targets, this method will generate a subtree for each one.
-     * This happens on the worker thread.
+     * This happens on the worker thread. The folders are listed and fingerprinted in parallel
+     * by the threads of the ScanService.
      */
     enum scanFolder_result { scanFolder_succeeded, scanFolder_cancelled, scanFolder_failed };
     scanFolder_result scanFolder(Tree& tree, LocalPath& localPath, uint32_t& foldercount, uint32_t& filecount);
@@ -450,6 +459,9 @@ protected:
     handle currentHandle;
     std::string currentName;
     std::list<LocalPath> pendingFolders;
+    // the folders of the previous complete backup matching the local ones still to be backed up,
+    // whose unchanged files are copied instead of uploaded
+    std::map<LocalPath, handle> previousFolders;
     std::vector<MegaTransfer *> failedTransfers;
     int recursive;
     int pendingTransfers;
@@ -465,9 +477,14 @@ protected:
     long long totalFiles;
     long long numberFolders;
 
+    // lets the completions of the copies know if the controller is still there
+    std::shared_ptr<bool> mAlive = std::make_shared<bool>(true);
+
 
     // internal methods
     void onFolderAvailable(MegaHandle handle);
+    void copyUnchangedFiles(MegaHandle target, std::vector<std::shared_ptr<Node>> nodes, std::vector<LocalPath> paths, FileSystemType fsType);
+    handle getLastCompleteBackupHandle();
     bool checkCompletion();
     bool isBusy() const;
     int64_t getLastBackupTime();
@@ -534,12 +551,30 @@ protected:
     };
     vector<LocalTree> mLocalTree;
 
+    // children of a folder retrieved from the DB at once while scanning
+    static constexpr size_t SCAN_PAGE_SIZE = 1024;
+
+    // the worker thread hands over the transfers generated so far when there are this many of them,
+    // or after this long, so the downloads of the files of the folders already created start meanwhile
+    static constexpr size_t HANDOFF_TRANSFERS = 512;
+    static constexpr std::chrono::milliseconds HANDOFF_INTERVAL{100};
+
+    // transfers generated by the worker thread, yet to be sent by MegaApiImpl's thread
+    std::mutex mReadyTransfersMutex;
+    std::unique_ptr<TransferQueue> mReadyTransfers;
+
     // Scan entire tree recursively, and retrieve folder structure and files to be downloaded.
     enum scanFolder_result { scanFolder_succeeded, scanFolder_cancelled, scanFolder_failed };
     scanFolder_result scanFolder(MegaNode *node, LocalPath& path, FileSystemType fsType, unsigned& fileAddedCount);
 
-    // Create all local directories in one shot. This happens on the worker thread.
-    std::unique_ptr<TransferQueue> createFolderGenDownloadTransfersForFiles(FileSystemType fsType, uint32_t fileCount, Error& e);
+    // Create all local directories, handing over the transfers of their files as it goes. This happens on the worker thread.
+    void createFolderGenDownloadTransfersForFiles(FileSystemType fsType, uint32_t fileCount, Error& e);
+
+    // Called from the worker thread: moves 'transfers' to mReadyTransfers, and returns true if it was empty
+    bool handOffTransfers(TransferQueue& transfers);
+
+    // Start the transfers handed over by the worker thread. This happens on MegaApiImpl's thread.
+    void sendReadyTransfers(const LocalPath& path);
 
     // Iterate through all pending files, and adds all download transfers
     bool genDownloadTransfersForFiles(TransferQueue* transferQueue,
@@ -655,6 +690,9 @@ class MegaNodePrivate : public MegaNode, public Cacheable
         static MegaNode *fromNode(Node *node);
         MegaNode *copy() override;
 
+        // MegaNode::CHANGE_TYPE_* flags of the pending changes of the node
+        static uint64_t getChangesBitmask(const Node& node);
+
         char *serialize() override;
         bool serialize(string*) const override;  // only FILENODEs
         static MegaNodePrivate* unserialize(string*);  // only FILENODEs
@@ -1038,6 +1076,66 @@ inline CancelToken convertToCancelToken(MegaCancelToken* mct)
     return static_cast<MegaCancelTokenPrivate*>(mct)->cancelFlag;
 }
 
+class MegaUploadBatchPrivate : public MegaUploadBatch
+{
+public:
+    struct Upload
+    {
+        std::optional<string> localPath;
+        unique_ptr<MegaNode> parent;
+        std::optional<string> fileName;
+        int64_t mtime;
+        std::optional<string> appData;
+        bool isSourceTemporary;
+        bool startFirst;
+        CancelToken cancelToken;
+    };
+
+    void add(const char *localPath, MegaNode *parent, const char *fileName, int64_t mtime, const char *appData, bool isSourceTemporary, bool startFirst, MegaCancelToken *cancelToken) override;
+    unsigned int size() const override;
+
+    const vector<Upload>& uploads() const { return mUploads; }
+
+private:
+    vector<Upload> mUploads;
+};
+
+class MegaDownloadBatchPrivate : public MegaDownloadBatch
+{
+public:
+    struct Download
+    {
+        unique_ptr<MegaNode> node;
+        std::optional<string> localPath;
+        std::optional<string> customName;
+        std::optional<string> appData;
+        bool startFirst;
+        CancelToken cancelToken;
+        int collisionCheck;
+        int collisionResolution;
+        bool undelete;
+    };
+
+    void add(MegaNode* node, const char* localPath, const char *customName, const char *appData, bool startFirst, MegaCancelToken *cancelToken, int collisionCheck, int collisionResolution, bool undelete) override;
+    unsigned int size() const override;
+
+    const vector<Download>& downloads() const { return mDownloads; }
+
+private:
+    vector<Download> mDownloads;
+};
+
+// Transfers submitted together by MegaApi::startUploads/startDownloads.
+// The starts of the ones processed by the same MegaApiImpl::sendPendingTransfers() are reported together
+struct TransferBatch
+{
+    // transfers of the batch still in the TransferQueue
+    size_t queued = 0;
+
+    // transfers already started, pending to be reported
+    vector<MegaTransferPrivate*> started;
+};
+
 class CollisionChecker
 {
 public:
@@ -1109,7 +1207,7 @@ class MegaTransferPrivate : public MegaTransfer, public Cacheable
         void setForeignOverquota(bool backupTransfer);
         void setForceNewUpload(bool forceNewUpload);
         void setStreamingTransfer(bool streamingTransfer);
-        void setLastBytes(char *lastBytes);
+        void setLastBytes(char *lastBytes, std::shared_ptr<const void> lastBytesOwner = nullptr);
         void setLastError(const MegaError *e);
         void setFolderTransferTag(int tag);
         void setNotificationNumber(long long notificationNumber);
@@ -1159,6 +1257,8 @@ class MegaTransferPrivate : public MegaTransfer, public Cacheable
         bool isForeignOverquota() const override;
         bool isForceNewUpload() const override;
         char *getLastBytes() const override;
+        // Keeps the last bytes valid past onTransferData() while referenced (if set)
+        std::shared_ptr<const void> getLastBytesOwner() const;
         MegaError getLastError() const override;
         const MegaError *getLastErrorExtended() const override;
         bool isFolderTransfer() const override;
@@ -1181,6 +1281,12 @@ class MegaTransferPrivate : public MegaTransfer, public Cacheable
         long long getPlaceInQueue() const;
         void setPlaceInQueue(long long value);
 
+        const shared_ptr<TransferBatch>& getBatch() const { return mBatch; }
+        void setBatch(shared_ptr<TransferBatch> batch) { mBatch = std::move(batch); }
+
+        // link of the TransferQueue while the transfer is being pushed to it
+        MegaTransferPrivate* mNextInQueue = nullptr;
+
         MegaCancelToken* getCancelToken() override;
         bool isRecursive() const { return recursiveOperation.get() != nullptr; }
         size_t getTotalRecursiveOperation() const;
@@ -1237,6 +1343,7 @@ protected:
         const char* parentPath; //used as targetUser for uploads
         const char* fileName;
         char *lastBytes;
+        std::shared_ptr<const void> lastBytesOwner;
         MegaNode *publicNode;
         std::unique_ptr<MegaNode> nodeToUndelete;
         long long startPos;
@@ -1245,6 +1352,7 @@ protected:
         int maxRetries;
 
         long long placeInQueue = 0;
+        shared_ptr<TransferBatch> mBatch;
 
         MegaTransferListener *listener;
         Transfer *transfer = nullptr;
@@ -1659,6 +1767,9 @@ class MegaRequestPrivate : public MegaRequest
         MegaSetElementList* getMegaSetElementList() const override;
         void setMegaSetElementList(std::unique_ptr<MegaSetElementList> els);
 
+        MegaNodeList* getMegaNodeList() const override;
+        void setMegaNodeList(std::unique_ptr<MegaNodeList> nodes);
+
         const MegaIntegerList* getMegaIntegerList() const override;
         void setMegaIntegerList(std::unique_ptr<MegaIntegerList> ints);
 
@@ -1674,6 +1785,9 @@ class MegaRequestPrivate : public MegaRequest
         const MegaNodeTree* getMegaNodeTree() const override;
         void setMegaNodeTree(MegaNodeTree* megaNodeTree);
 
+        // link of the RequestQueue while the request is being pushed to it
+        MegaRequestPrivate* mNextInQueue = nullptr;
+
 protected:
         std::shared_ptr<AccountDetails> accountDetails;
         MegaPricingPrivate *megaPricing;
@@ -1727,6 +1841,7 @@ protected:
         unique_ptr<MegaBannerListPrivate> mBannerList;
         unique_ptr<MegaSet> mMegaSet;
         unique_ptr<MegaSetElementList> mMegaSetElementList;
+        unique_ptr<MegaNodeList> mMegaNodeList;
         unique_ptr<MegaIntegerList> mMegaIntegerList;
         unique_ptr<MegaBackupInfoList> mMegaBackupInfoList;
         unique_ptr<MegaVpnCredentials> mMegaVpnCredentials;
@@ -2242,6 +2357,65 @@ class MegaNodeListPrivate : public MegaNodeList
 		int s;
 };
 
+// Bounded FIFO of changes of nodes pending to be taken by the app (see MegaApi::setNodeChangesBufferSize).
+// Changes to a node that is already in the buffer are merged into its entry, so every node appears
+// once at most. It's filled from the SDK thread and drained from any thread.
+class NodeChangeBuffer
+{
+public:
+    struct Change
+    {
+        handle mHandle = UNDEF;
+        handle mParentHandle = UNDEF;
+        uint64_t mChanges = 0;
+    };
+
+    // 0 disables the buffer. Pending changes are dropped
+    void setCapacity(size_t capacity);
+    bool enabled() const;
+
+    // Returns true if the buffer had nothing to report before, so the app has to be told.
+    // If the new nodes don't fit, every pending change is dropped and the buffer is incomplete
+    bool push(const std::vector<Change>& changes);
+
+    // Drop the pending changes (ie. the full account is reloaded). Returns like push()
+    bool setIncomplete();
+
+    // Take the oldest 'maxCount' changes (all of them if 0). 'incomplete' is set if changes
+    // were dropped before them and it's reset for the next call
+    std::vector<Change> pop(size_t maxCount, bool& incomplete);
+
+    size_t size() const;
+
+private:
+    mutable std::mutex mMutex;
+    std::vector<Change> mRing;
+    size_t mHead = 0;
+    size_t mCount = 0;
+    bool mIncomplete = false;
+
+    // position in mRing of the pending change of every node
+    std::unordered_map<handle, size_t> mPositions;
+
+    bool idle() const { return !mCount && !mIncomplete; }
+};
+
+class MegaNodeChangeListPrivate : public MegaNodeChangeList
+{
+    public:
+        MegaNodeChangeListPrivate(std::vector<NodeChangeBuffer::Change>&& changes, bool incomplete);
+        MegaNodeChangeList* copy() const override;
+        int size() const override;
+        MegaHandle getHandle(int i) const override;
+        MegaHandle getParentHandle(int i) const override;
+        uint64_t getChanges(int i) const override;
+        bool isIncomplete() const override;
+
+    private:
+        std::vector<NodeChangeBuffer::Change> mChanges;
+        bool mIncomplete;
+};
+
 class MegaChildrenListsPrivate : public MegaChildrenLists
 {
     public:
@@ -2388,6 +2562,12 @@ public:
                              SymmCipher* cipher, chunkmac_map* chunkmacs, uint64_t ctriv);
 
     byte* nextbuffer(unsigned bufsize) override;
+
+    // Same as encrypt(), but the file is read and written by windows of several chunks, and the chunks of
+    // each window are encrypted in parallel at 'queue'. The chunk MACs are complete at the end of each window
+    bool encryptInParallel(m_off_t pos, m_off_t npos, string& urlSuffix, const byte* filekey, MegaClientAsyncQueue& queue);
+
+    static const m_off_t ENCRYPTION_WINDOW = 16 * 1024 * 1024;
 };
 
 class MegaBackgroundMediaUploadPrivate : public MegaBackgroundMediaUpload
@@ -2478,16 +2658,23 @@ private:
 };
 
 //Thread safe request queue
+//Requests are pushed without locking, and moved to the queue in batches by the other operations
 class RequestQueue
 {
     protected:
+        MpscInbox<MegaRequestPrivate, &MegaRequestPrivate::mNextInQueue> inbox;
         std::deque<MegaRequestPrivate *> requests;
         std::mutex mutex;
 
+        // requires the mutex
+        void drainInbox();
+
     public:
         RequestQueue();
-        void push(MegaRequestPrivate *request);
-        void push(std::unique_ptr<MegaRequestPrivate> request);
+
+        // returns true if the queue had no pushed requests pending to be processed
+        bool push(MegaRequestPrivate *request);
+        bool push(std::unique_ptr<MegaRequestPrivate> request);
         void push_front(MegaRequestPrivate *request);
         MegaRequestPrivate * pop();
         MegaRequestPrivate * front();
@@ -2497,16 +2684,27 @@ class RequestQueue
 
 
 //Thread safe transfer queue
+//Transfers are pushed without locking, and moved to the queue in batches by the other operations
 class TransferQueue
 {
     protected:
+        MpscInbox<MegaTransferPrivate, &MegaTransferPrivate::mNextInQueue> inbox;
         std::deque<MegaTransferPrivate *> transfers;
         std::mutex mutex;
         int lastPushedTransferTag = 0;
 
+        // requires the mutex. The place in the queue is set here, in the order of the pushes
+        void drainInbox();
+
     public:
         TransferQueue();
-        void push(MegaTransferPrivate *transfer);
+
+        // returns true if the queue had no pushed transfers pending to be processed,
+        // so the pushes of a batch only need to wake up the SDK thread once
+        bool push(MegaTransferPrivate *transfer);
+
+        // pushes the transfers at once, they are kept together in the queue
+        bool push(const vector<MegaTransferPrivate *>& transfers);
         void push_front(MegaTransferPrivate *transfer);
         MegaTransferPrivate * pop();
         bool empty();
@@ -2523,7 +2721,7 @@ class TransferQueue
 
         void removeWithFolderTag(int folderTag, std::function<void(MegaTransferPrivate *)> callback);
         void removeListener(MegaTransferListener *listener);
-        int getLastPushedTag() const;
+        int getLastPushedTag();
         void setAllCancelled(CancelToken t, int direction);
 };
 
@@ -2859,13 +3057,19 @@ class MegaSearchPagePrivate : public MegaSearchPage
 {
 public:
     MegaSearchPagePrivate(size_t startingOffset, size_t size) : mOffset(startingOffset), mSize(size) {}
+    MegaSearchPagePrivate(MegaNode* lastNode, size_t size);
     MegaSearchPagePrivate* copy() const override { return new MegaSearchPagePrivate(*this); }
     size_t startingOffset() const override { return mOffset; }
     size_t size() const override { return mSize; }
+    MegaHandle lastNodeHandle() const override { return mCursor ? mCursor->mHandle.as8byte() : INVALID_HANDLE; }
+
+    // page for the NodeManager, 'searchPage' can be null (all results)
+    static NodeSearchPage toNodeSearchPage(const MegaSearchPage* searchPage);
 
 private:
     size_t mOffset;
     size_t mSize;
+    std::optional<NodeView> mCursor; // sort key of the last node of the previous page
 };
 
 
@@ -2916,6 +3120,8 @@ class MegaApiImpl : public MegaApp
         void addTransferListener(MegaTransferListener* listener);
         void addScheduledCopyListener(MegaScheduledCopyListener* listener);
         void addGlobalListener(MegaGlobalListener* listener);
+        void setNodeChangesBufferSize(unsigned int size);
+        MegaNodeChangeList* popNodeChanges(unsigned int maxCount);
         bool removeListener(MegaListener* listener);
         bool removeRequestListener(MegaRequestListener* listener);
         bool removeTransferListener(MegaTransferListener* listener);
@@ -3033,6 +3239,9 @@ class MegaApiImpl : public MegaApp
         static void removeLoggerClass(MegaLogger *megaLogger, bool singleExclusiveLogger);
         static void setLogToConsole(bool enable);
         static void log(int logLevel, const char* message, const char *filename = NULL, int line = -1);
+        static char* getPerformanceSnapshot(bool reset);
+        static void setTracingEnabled(bool enable);
+        static char* dumpTrace();
         void setLoggingName(const char* loggingName);
 
         void createFolder(const char* name, MegaNode *parent, MegaRequestListener *listener = NULL);
@@ -3064,6 +3273,7 @@ class MegaApiImpl : public MegaApp
         const char *buildPublicLink(const char *publicHandle, const char *key, bool isFolder);
         void getThumbnail(MegaNode* node, const char *dstFilePath, MegaRequestListener *listener = NULL);
 		void cancelGetThumbnail(MegaNode* node, MegaRequestListener *listener = NULL);
+        void getThumbnails(MegaHandleList* nodeHandles, MegaRequestListener *listener = NULL);
         void setThumbnail(MegaNode* node, const char *srcFilePath, MegaRequestListener *listener = NULL);
         void putThumbnail(MegaBackgroundMediaUpload* node, const char *srcFilePath, MegaRequestListener *listener = NULL);
         void setThumbnailByHandle(MegaNode* node, MegaHandle attributehandle, MegaRequestListener *listener = NULL);
@@ -3083,6 +3293,7 @@ class MegaApiImpl : public MegaApp
         bool testAllocation(unsigned allocCount, size_t allocSize);
         void getUserAttribute(MegaUser* user, int type, MegaRequestListener *listener = NULL);
         void getUserAttribute(const char* email_or_handle, int type, MegaRequestListener *listener = NULL);
+        void getUserAttributes(MegaHandleList* users, int type, MegaRequestListener *listener = NULL);
         void getChatUserAttribute(const char* email_or_handle, int type, const char* ph, MegaRequestListener *listener = NULL);
         void getUserAttr(const char* email_or_handle, int type, const char *dstFilePath, int number = 0, MegaRequestListener *listener = NULL);
         void getChatUserAttr(const char* email_or_handle, int type, const char *dstFilePath, const char *ph = NULL, int number = 0, MegaRequestListener *listener = NULL);
@@ -3103,9 +3314,13 @@ class MegaApiImpl : public MegaApp
         void setNodeFavourite(MegaNode *node, bool fav, MegaRequestListener *listener = NULL);
         void getFavourites(MegaNode* node, int count, MegaRequestListener* listener = nullptr);
         void setNodeSensitive(MegaNode* node, bool sensitive, MegaRequestListener* listener);
+        void setNodesLabel(MegaNodeList* nodes, int label, MegaRequestListener* listener = NULL);
+        void setNodesFavourite(MegaNodeList* nodes, bool fav, MegaRequestListener* listener = NULL);
+        void setNodesSensitive(MegaNodeList* nodes, bool sensitive, MegaRequestListener* listener = NULL);
         void setNodeCoordinates(MegaNode *node, bool unshareable, double latitude, double longitude, MegaRequestListener *listener = NULL);
         void setNodeDescription(MegaNode* node, const char* description, MegaRequestListener* listener = NULL);
         void addNodeTag(MegaNode* node, const char* tag, MegaRequestListener* listener = NULL);
+        void addNodesTag(MegaNodeList* nodes, const char* tag, MegaRequestListener* listener = NULL);
         void removeNodeTag(MegaNode* node, const char* tag, MegaRequestListener* listener = NULL);
         void updateNodeTag(MegaNode* node,
                        const char* newTag,
@@ -3115,6 +3330,9 @@ class MegaApiImpl : public MegaApp
         void exportNode(MegaNode *node, int64_t expireTime, bool writable, bool megaHosted, MegaRequestListener *listener = NULL);
         void disableExport(MegaNode *node, MegaRequestListener *listener = NULL);
         void fetchNodes(MegaRequestListener *listener = NULL);
+        void setFastResume(bool enable);
+        void setLowMemoryMode(bool enable, long long transferMemoryBudget);
+        void setFolderLinkFetchRoot(MegaHandle folder);
         void getPricing(MegaRequestListener *listener = NULL);
         void getRecommendedProLevel(MegaRequestListener* listener = NULL);
         void getPaymentId(handle productHandle, handle lastPublicHandle, int lastPublicHandleType, int64_t lastAccessTimestamp, MegaRequestListener *listener = NULL);
@@ -3167,6 +3385,8 @@ class MegaApiImpl : public MegaApp
         MegaTransferPrivate* createUploadTransfer(bool startFirst, const char *localPath, MegaNode *parent, const char *fileName, const char *targetUser, int64_t mtime, int folderTransferTag, bool isBackup, const char *appData, bool isSourceFileTemporary, bool forceNewUpload, FileSystemType fsType, CancelToken cancelToken, MegaTransferListener *listener, const FileFingerprint* preFingerprintedFile = nullptr);
         void startDownload (bool startFirst, MegaNode *node, const char* localPath, const char *customName, int folderTransferTag, const char *appData, CancelToken cancelToken, int collisionCheck, int collisionResolution, bool undelete, MegaTransferListener *listener);
         MegaTransferPrivate* createDownloadTransfer(bool startFirst, MegaNode *node, const char* localPath, const char *customName, int folderTransferTag, const char *appData, CancelToken cancelToken, int collisionCheck, int collisionResolution, bool undelete, MegaTransferListener *listener, FileSystemType fsType);
+        void startUploads(MegaUploadBatch* batch, MegaTransferListener* listener);
+        void startDownloads(MegaDownloadBatch* batch, MegaTransferListener* listener);
         void startStreaming(MegaNode* node, m_off_t startPos, m_off_t size, MegaTransferListener *listener);
         void setStreamingMinimumRate(int bytesPerSecond);
         void retryTransfer(MegaTransfer *transfer, MegaTransferListener *listener = NULL);
@@ -3183,12 +3403,16 @@ class MegaApiImpl : public MegaApp
         bool areTransfersPaused(int direction);
         void setUploadLimit(int bpslimit);
         void setMaxConnections(int direction, int connections, MegaRequestListener* listener = NULL);
+        void setTransferUpdateInterval(int milliseconds);
+        void setTransferUpdatesBatched(bool enable);
         void setDownloadMethod(int method);
         void setUploadMethod(int method);
         bool setMaxDownloadSpeed(m_off_t bpslimit);
         bool setMaxUploadSpeed(m_off_t bpslimit);
         int getMaxDownloadSpeed();
         int getMaxUploadSpeed();
+        bool setHttp2Enabled(bool enable);
+        bool isHttp2Enabled();
         int getCurrentDownloadSpeed();
         int getCurrentUploadSpeed();
         int getCurrentSpeed(int type);
@@ -3279,6 +3503,7 @@ class MegaApiImpl : public MegaApp
         MegaHandle getSetCover(MegaHandle sid);
         unsigned getSetElementCount(MegaHandle sid, bool includeElementsInRubbishBin);
         MegaSetElementList* getSetElements(MegaHandle sid, bool includeElementsInRubbishBin);
+        MegaSetElementList* getSetElements(MegaHandle sid, int offset, int size, bool includeElementsInRubbishBin);
         MegaSetElement* getSetElement(MegaHandle sid, MegaHandle eid);
         const char* getPublicLinkForExportedSet(MegaHandle sid);
         void fetchPublicSet(const char* publicSetLink, MegaRequestListener* listener = nullptr);
@@ -3369,6 +3594,13 @@ class MegaApiImpl : public MegaApp
         void updateStats();
         void setLRUCacheSize(unsigned long long size);
         unsigned long long getNumNodesAtCacheLRU() const;
+        void setLRUCachePolicy(int policy);
+        unsigned long long getLRUCacheHits() const;
+        unsigned long long getLRUCacheMisses() const;
+        void setChildrenPrefetch(unsigned int folders);
+        void setDatabasePerformanceProfile(int profile);
+        void setDatabasePerformanceParameters(long long mmapSize, long long cacheSizeKB, int pageSize, int synchronous);
+        MegaStringMap* benchmarkDatabase(int repetitions);
         unsigned long long getNumNodes();
         unsigned long long getAccurateNumNodes();
         long long getTotalDownloadedBytes();
@@ -3402,6 +3634,8 @@ class MegaApiImpl : public MegaApp
         MegaUserList* getContacts();
         MegaUser* getContact(const char* uid);
         MegaUserAlertList* getUserAlerts();
+        MegaUserAlertList* getUserAlerts(int offset, int size);
+        int getNumUserAlerts();
         int getNumUnreadUserAlerts();
         MegaNodeList *getInShares(MegaUser* user, int order);
         MegaNodeList *getInShares(int order);
@@ -3468,6 +3702,7 @@ public:
         void getRecentActionsAsync(unsigned days, unsigned maxnodes, MegaRequestListener *listener = NULL);
 
         MegaNodeList* search(const MegaSearchFilter* filter, int order, CancelToken cancelToken, const MegaSearchPage* searchPage);
+        void searchNodes(const MegaSearchFilter* filter, int order, size_t pageSize, CancelToken cancelToken, MegaRequestListener* listener = nullptr);
 
         // deprecated
         MegaNodeList* search(MegaNode *node, const char *searchString, CancelToken cancelToken, bool recursive = true, int order = MegaApi::ORDER_NONE, int mimeType = MegaApi::FILE_TYPE_DEFAULT, int target = MegaApi::SEARCH_TARGET_ALL, bool includeSensitive = true);
@@ -3598,6 +3833,8 @@ public:
         int httpServerGetMaxBufferSize();
         void httpServerSetMaxOutputSize(int outputSize);
         int httpServerGetMaxOutputSize();
+        void httpServerSetNumThreads(int numThreads);
+        int httpServerGetNumThreads();
 
         // permissions
         void httpServerEnableFileServer(bool enable);
@@ -3763,8 +4000,11 @@ public:
         void fetchCreditCardInfo(MegaRequestListener* listener = nullptr);
 
         void fireOnTransferStart(MegaTransferPrivate *transfer);
+        void fireOnTransfersStart(TransferBatch& batch);
         void fireOnTransferFinish(MegaTransferPrivate *transfer, unique_ptr<MegaErrorPrivate> e); // deletes `transfer` !!
         void fireOnTransferUpdate(MegaTransferPrivate *transfer);
+        void fireOnTransferProgress(MegaTransferPrivate *transfer);
+        void fireOnTransfersUpdate();
         void fireOnFolderTransferUpdate(MegaTransferPrivate *transfer, int stage, uint32_t foldercount, uint32_t createdfoldercount, uint32_t filecount, const LocalPath* currentFolder, const LocalPath* currentFileLeafname);
         void fireOnTransferTemporaryError(MegaTransferPrivate *transfer, unique_ptr<MegaErrorPrivate> e);
         map<int, MegaTransferPrivate *> transferMap;
@@ -3821,6 +4061,7 @@ private:
         void fireOnUsersUpdate(MegaUserList *users);
         void fireOnUserAlertsUpdate(MegaUserAlertList *alerts);
         void fireOnNodesUpdate(MegaNodeList *nodes);
+        void fireOnNodeChangesAvailable();
         void fireOnAccountUpdate();
         void fireOnSetsUpdate(MegaSetList* sets);
         void fireOnSetElementsUpdate(MegaSetElementList* elements);
@@ -3882,6 +4123,7 @@ private:
         MegaHTTPServer *httpServer;
         int httpServerMaxBufferSize;
         int httpServerMaxOutputSize;
+        int httpServerNumThreads;
         bool httpServerEnableFiles;
         bool httpServerEnableFolders;
         bool httpServerOfflineAttributeEnabled;
@@ -3902,6 +4144,44 @@ private:
         TransferQueue transferQueue;
         map<int, MegaRequestPrivate *> requestMap;
 
+        // decrypted thumbnails of MegaApi::getThumbnails
+        FileAttributeMemoryCache mThumbnailCache;
+
+        struct BulkThumbnailsRequest
+        {
+            MegaRequestPrivate* request = nullptr;
+            set<handle> pending;
+
+            // received since the last callback
+            unique_ptr<MegaStringMap> batch;
+
+            // some thumbnails were cancelled or failed
+            bool incomplete = false;
+        };
+        map<int, BulkThumbnailsRequest> mBulkThumbnailsRequests;
+
+        struct PendingBulkThumbnail
+        {
+            string fileattrstring;
+
+            // tags of the getThumbnails requests waiting for it
+            set<int> tags;
+        };
+        map<handle, PendingBulkThumbnail> mPendingBulkThumbnails;
+
+        // searches of MegaApi::searchNodes, one page of each of them is retrieved per iteration of the SDK loop
+        struct PagedSearch
+        {
+            MegaRequestPrivate* request = nullptr;
+            shared_ptr<MegaSearchFilter> filter;
+            CancelToken cancelToken;
+
+            // the next page starts right after it
+            unique_ptr<MegaNode> lastNode;
+            long long found = 0;
+        };
+        map<int, PagedSearch> mPagedSearches;
+
         // sc requests to close existing wsc and immediately retrieve pending actionpackets
         RequestQueue scRequestQueue;
 
@@ -3914,6 +4194,21 @@ private:
         long long totalDownloadBytes;
         long long totalUploadBytes;
         long long notificationNumber;
+
+        // minimum time between progress updates of each transfer
+        dstime mTransferUpdateInterval = 1;
+
+        // progress updates for the global listeners, delivered together by fireOnTransfersUpdate()
+        bool mTransferUpdatesBatched = false;
+        set<int> mBatchedTransferUpdates;
+        dstime mLastTransfersUpdate = 0;
+
+        // batch of transfers being processed by sendPendingTransfers(), their starts are reported together
+        TransferBatch* mStartingBatch = nullptr;
+
+        // queues the transfers of a batch with a single push
+        void pushTransferBatch(const vector<MegaTransferPrivate*>& transfers);
+
         set<MegaRequestListener *> requestListeners;
         set<MegaTransferListener *> transferListeners;
         set<MegaScheduledCopyListener *> backupListeners;
@@ -3926,6 +4221,7 @@ private:
 
         set<MegaGlobalListener *> globalListeners;
         set<MegaListener *> listeners;
+        NodeChangeBuffer mNodeChanges;
         retryreason_t waitingRequest;
         mutable std::recursive_timed_mutex sdkMutex;
         using SdkMutexGuard = std::unique_lock<std::recursive_timed_mutex>;   // (equivalent to typedef)
@@ -4021,6 +4317,7 @@ private:
         void userattr_update(User*, int, const char*) override;
 
         void nodes_current() override;
+        void deferred_cache_loaded() override;
         void catchup_result() override;
         void key_modified(handle, attr_t) override;
         void upgrading_security() override;
@@ -4096,7 +4393,7 @@ private:
         void transfer_update(Transfer*) override;
 
         dstime pread_failure(const Error&, int, void*, dstime) override;
-        bool pread_data(byte*, m_off_t, m_off_t, m_off_t, m_off_t, void*) override;
+        bool pread_data(byte*, m_off_t, m_off_t, m_off_t, m_off_t, void*, std::shared_ptr<const void>) override;
 
         void reportevent_result(error) override;
         void sessions_killed(handle sessionid, error e) override;
@@ -4233,6 +4530,8 @@ private:
 
         void sendPendingScRequest();
         void sendPendingRequests();
+        void flushBulkThumbnails();
+        void continuePagedSearches();
         unsigned sendPendingTransfers(TransferQueue *queue, MegaRecursiveOperation* = nullptr, m_off_t availableDiskSpace = 0);
         void updateBackups();
 
@@ -4242,6 +4541,8 @@ private:
 
         void getNodeAttribute(MegaNode* node, int type, const char *dstFilePath, MegaRequestListener *listener = NULL);
         void cancelGetNodeAttribute(MegaNode *node, int type, MegaRequestListener *listener = NULL);
+        void bulkThumbnailReceived(handle h, const char* data, uint32_t len);
+        void bulkThumbnailFailed(handle h);
         void setNodeAttribute(MegaNode* node, int type, const char *srcFilePath, MegaHandle attributehandle, MegaRequestListener *listener = NULL);
         void putNodeAttribute(MegaBackgroundMediaUpload* bu, int type, const char *srcFilePath, MegaRequestListener *listener = NULL);
         void setUserAttr(int type, const char *value, MegaRequestListener *listener = NULL);
@@ -4293,6 +4594,10 @@ private:
         error performRequest_createAccount(MegaRequestPrivate* request);
         error performRequest_retryPendingConnections(MegaRequestPrivate* request);
         error performRequest_setAttrNode(MegaRequestPrivate* request);
+        error performRequest_setAttrNodes(MegaRequestPrivate* request);
+        void setAttrOnVersions(std::shared_ptr<Node> node, const attr_map& attrUpdates);
+        error setAttrOnNodes(MegaRequestPrivate* request,
+                             std::function<error(std::shared_ptr<Node>, CommandSetAttr::Completion&)> setNodeAttr);
         error performRequest_setAttrFile(MegaRequestPrivate* request);
         error performRequest_setAttrUser(MegaRequestPrivate* request);
         error performRequest_getAttrUser(MegaRequestPrivate* request);
@@ -4305,6 +4610,7 @@ private:
         error copyTreeFromOwnedNode(shared_ptr<Node> node, const char *newName, shared_ptr<Node> target, vector<NewNode>& treeCopy);
         error performRequest_login(MegaRequestPrivate* request);
         error performRequest_tagNode(MegaRequestPrivate* request);
+        error performRequest_tagNodes(MegaRequestPrivate* request);
         void CRUDNodeTagOperation(MegaNode* node,
                                   int operationType,
                                   const char* tag,
@@ -4358,20 +4664,26 @@ class StreamingBuffer
 public:
     StreamingBuffer();
     ~StreamingBuffer();
-    // Allocate buffer and reset class members
+    // Set the buffer capacity and reset class members
     void init(size_t capacity);
-    // Reset positions for body writting ("forgets" buffered external data such as headers, which use the same buffer) [Default: 0 -> the whole buffer]
+    // Forget the latest buffered data not handed out to the consumer yet (such as headers) [Default: 0 -> all of it]
     void reset(bool freeData, size_t sizeToReset = 0);
-    // Add data to the buffer. This will mainly come from the Transfer (or from a cache file if it's included someday).
+    // Add a copy of data to the buffer (such as headers).
     size_t append(const char *buf, size_t len);
+    // Add data to the buffer without copying it. This will mainly come from the Transfer: 'owner' keeps it alive until it has been written to the consumer.
+    size_t append(std::shared_ptr<const void> owner, const char *buf, size_t len);
+    // Add a copy of data before the buffered data not handed out yet (such as headers for data already buffered). The capacity grows to fit it.
+    size_t prepend(const char *buf, size_t len);
+    // Drop the oldest buffered data not handed out yet
+    void discard(size_t len);
     // Get buffered data size
     size_t availableData() const;
     // Get free space available in buffer
     size_t availableSpace() const;
     // Get total buffer capacity
     size_t availableCapacity() const;
-    // Get the uv_buf_t for the consumer with as much buffered data as possible
-    uv_buf_t nextBuffer();
+    // Get the uv_buf_t for the consumer with as much buffered data as possible (up to maxLen bytes)
+    uv_buf_t nextBuffer(size_t maxLen = std::numeric_limits<size_t>::max());
     // Increase the free data counter
     void freeData(size_t len);
     // Set upper bound limit for capacity
@@ -4400,19 +4712,29 @@ private:
     // Recalculate maxBufferSize and maxOutputSize taking into accout the byteRate (for media files) and DirectReadSlot read chunk size.
     void calcMaxBufferAndMaxOutputSize();
 
+    // Piece of appended data, released once it has been written to the consumer
+    struct Chunk
+    {
+        std::shared_ptr<const void> owner;
+        const char* data;
+        size_t len;
+    };
+
 protected:
-    // Circular buffer to store data to feed the consumer
-    char* buffer;
+    // Appended data to feed the consumer, in order. The first chunks may have been handed out already
+    std::deque<Chunk> chunks;
     // Total buffer size
     size_t capacity;
     // Buffered data size
     size_t size;
     // Available free space in buffer
     size_t free;
-    // Index for last buffered data
-    size_t inpos;
-    // Index for last written data (to the consumer)
+    // Index of the chunk with the next data to be handed out to the consumer
+    size_t outchunk;
+    // Index of the next data to be handed out (to the consumer) within that chunk
     size_t outpos;
+    // Data of the first chunk already written (to the consumer)
+    size_t freedpos;
     // Upper bound limit for capacity
     size_t maxBufferSize;
     // Upper bound limit for chunk size to write to the consumer
@@ -4425,6 +4747,7 @@ protected:
 };
 
 class MegaTCPServer;
+struct MegaTCPWorker;
 class MegaTCPContext : public MegaTransferListener, public MegaRequestListener
 {
 public:
@@ -4433,6 +4756,7 @@ public:
 
     // Connection management
     MegaTCPServer *server;
+    MegaTCPWorker *worker; // NULL for connections accepted by the main loop
     uv_tcp_t tcphandle;
     uv_async_t asynchandle;
     uv_mutex_t mutex;
@@ -4468,10 +4792,21 @@ public:
 
 };
 
+// Additional loop accepting connections in the same port (SO_REUSEPORT), in its own thread
+struct MegaTCPWorker
+{
+    uv_loop_t loop;
+    uv_async_t exit_handle;
+    uv_tcp_t listener;
+    MegaThread thread;
+    list<MegaTCPContext*> connections;
+};
+
 class MegaTCPServer
 {
 protected:
     static void *threadEntryPoint(void *param);
+    static void *workerEntryPoint(void *param);
     static http_parser_settings parsercfg;
 
     uv_loop_t uv_loop;
@@ -4494,6 +4829,8 @@ protected:
     int port;
     bool closing;
     int remainingcloseevents;
+    int numThreads;
+    std::vector<std::unique_ptr<MegaTCPWorker>> workers;
 
 #ifdef ENABLE_EVT_TLS
     // TLS
@@ -4526,6 +4863,7 @@ protected:
     static void onExitHandleClose(uv_handle_t* handle);
 
     static void onCloseRequested(uv_async_t* handle);
+    static void onWorkerCloseRequested(uv_async_t* handle);
 
     static void onWriteFinished(uv_write_t* req, int status); //This might need to go to HTTPServer
 #ifdef ENABLE_EVT_TLS
@@ -4533,9 +4871,13 @@ protected:
 #endif
     static void closeConnection(MegaTCPContext *tcpctx);
     static void closeTCPConnection(MegaTCPContext *tcpctx);
+    static list<MegaTCPContext*>& connectionsOf(MegaTCPContext *tcpctx);
 
     void run();
     void initializeAndStartListening();
+    static bool enableReusePort(uv_tcp_t *handle);
+    void startWorkers(uv_connection_cb onNewClientCB);
+    void joinWorkers();
 
     void answer(MegaTCPContext* tcpctx, const char *rsp, size_t rlen);
 
@@ -4566,6 +4908,8 @@ public:
     void setMaxOutputSize(int outputSize);
     int getMaxBufferSize();
     int getMaxOutputSize();
+    void setNumThreads(int threads);
+    int getNumThreads();
     void setRestrictedMode(int mode);
     int getRestrictedMode();
     bool isHandleAllowed(handle h);
@@ -4636,6 +4980,14 @@ public:
     uv_mutex_t mutex_responses;
     std::list<std::string> responses;
 
+    // Persistent connections
+    bool keepAlive; // the connection will wait for another request after the current response
+    bool responding; // a request has been received and its response hasn't been completed yet
+    std::string pendingRequests; // pipelined requests, parsed after the current response
+    MegaHandle streamingHandle; // node being streamed to streamingBuffer
+    m_off_t streamingPos; // position of the next data expected from the streaming transfer
+    m_off_t streamingEnd; // end of the range requested to the streaming transfer
+
     virtual void onTransferStart(MegaApi *, MegaTransfer *transfer);
     virtual bool onTransferData(MegaApi *, MegaTransfer *transfer, char *buffer, size_t size);
     virtual void onTransferFinish(MegaApi* api, MegaTransfer *transfer, MegaError *e);
@@ -4671,9 +5023,11 @@ protected:
     static int onBody(http_parser* parser, const char* at, size_t length);
     static int onMessageComplete(http_parser* parser);
 
-    static void sendHeaders(MegaHTTPContext *httpctx, string *headers);
+    static void sendHeaders(MegaHTTPContext *httpctx, string *headers, bool beforeBufferedData = false);
     static void sendNextBytes(MegaHTTPContext *httpctx);
     static int streamNode(MegaHTTPContext *httpctx);
+    static void prepareForNextRequest(MegaHTTPContext *httpctx);
+    static void stopStreaming(MegaHTTPContext *httpctx);
 
     //Utility funcitons
     static std::string getHTTPMethodName(int httpmethod);
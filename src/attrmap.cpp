@@ -129,6 +129,22 @@ void AttrMap::serialize(string* d) const
     d->append("", 1);
 }
 
+size_t AttrMap::serializedsize() const
+{
+    char buf[8];
+    size_t size = 1;
+
+    for (attr_map::const_iterator it = map.begin(); it != map.end(); it++)
+    {
+        if (unsigned char l = static_cast<unsigned char>(nameid2string(it->first, buf)))
+        {
+            size += sizeof l + l + sizeof(unsigned short) + static_cast<unsigned short>(it->second.size());
+        }
+    }
+
+    return size;
+}
+
 // read binary serialize, return final offset
 const char* AttrMap::unserialize(const char* ptr , const char *end)
 {
@@ -162,6 +178,7 @@ const char* AttrMap::unserialize(const char* ptr , const char *end)
         ptr += ll;
     }
 
+    map.shrink_to_fit();
     return ptr;
 }
 
@@ -291,6 +308,8 @@ void AttrMap::fromjson(const char* buf)
     {
         JSON::unescape(t);
     }
+
+    map.shrink_to_fit();
 }
 
 } // namespace
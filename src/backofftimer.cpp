@@ -52,6 +52,14 @@ void BackoffTimer::backoff()
     delta = base + (dstime)((base / 2.0) * (rng.genuint32(RAND_MAX)/((double)RAND_MAX)));
 }
 
+void BackoffTimer::backoffDecorrelated()
+{
+    dstime upper = std::min<dstime>(6000, std::max<dstime>(delta, 1) * 3);
+    delta = 1 + (dstime)((upper - 1) * (rng.genuint32(RAND_MAX)/((double)RAND_MAX)));
+    base = delta;
+    next = Waiter::ds + delta;
+}
+
 void BackoffTimer::backoff(dstime newdelta)
 {
     next = (newdelta == NEVER) ? NEVER : (Waiter::ds + newdelta);
@@ -143,58 +151,38 @@ void BackoffTimerGroupTracker::update(dstime* waituntil, bool transfers)
     // which is to say, the `waituntil` parameter will be updated with the soonest time that we would need to
     // wake up from any of the timers in this group, should any of them be in a back-off state.
     // There are also some side-effects specfic to transfers which are preserved from the old system.
+    // The timers are sorted by their timeout: only the expired ones and the soonest pending one are visited.
 
     vector<BackoffTimerTracked*> v;
-    v.reserve(timeouts.size());
 
-    if (transfers)
+    // put the ones to work on in a vector, as working on them changes their position in the map
+    for (auto t : timeouts)
     {
-        for (auto t : timeouts)
+        if (t.first <= Waiter::ds)
         {
-            // put the ones to work on in a vector, as working on them changes their position in the map
-            if (t.first <= Waiter::ds)
-            {
-                v.push_back(t.second);
-            }
-            else
-            {
-                break;
-            }
+            v.push_back(t.second);
         }
-
-        for (auto t : v)
+        else
         {
-            t->update(waituntil);
-            if (t->armed())
+            // the soonest timeout in the future
+            if (t.first < *waituntil)
             {
-                // fire the timer only once but keeping it armed
-                t->set(0);
-                LOG_debug << "Disabling armed transfer backoff";
+                *waituntil = t.first;
             }
+            break;
         }
-
     }
-    else
-    {
-        // put the ones to work on in a vector, as working on them changes their position in the map
-        for (auto t : timeouts)
-        {
-            if (t.second->armed())
-            {
-                v.push_back(t.second);
-            }
-            if (t.first > Waiter::ds)
-            {
-                break;
-            }
-        }
 
-        for (auto t : v)
+    for (auto t : v)
+    {
+        // update may set next=1 so we can't just call the first one.
+        t->update(waituntil);
+        if (transfers && t->armed())
         {
-            // update may set next=1 so we can't just call the first one.
-            t->update(waituntil);
+            // fire the timer only once but keeping it armed
+            t->set(0);
+            LOG_debug << "Disabling armed transfer backoff";
         }
-
     }
 }
 
@@ -19,66 +19,250 @@
  * program.
  */
 
+#include <cstdint>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define MEGA_BASE64_SSSE3
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define MEGA_BASE64_NEON
+#include <arm_neon.h>
+#endif
+
+// The vector decoders read whole blocks of characters, which may include bytes beyond
+// the end of the string (never beyond its page). That is harmless, but address sanitizers report it.
+#if defined(__SANITIZE_ADDRESS__)
+#define MEGA_BASE64_NO_SIMD_DECODE
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define MEGA_BASE64_NO_SIMD_DECODE
+#endif
+#endif
+
 #include "mega/base64.h"
 #include "mega/utils.h"
 
 namespace mega {
-// modified base64 conversion (no trailing '=' and '-_' instead of '+/')
-unsigned char Base64::to64(byte c)
+
+namespace {
+
+const char ALPHABET64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// values of the characters, 255 if invalid (both the '-_' and the standard '+/' are accepted)
+struct From64Table
 {
-    c &= 63;
+    byte values[256];
 
-    if (c < 26)
+    constexpr From64Table()
+      : values{}
     {
-        return static_cast<unsigned char>(c + 'A');
+        for (int i = 0; i < 256; ++i)
+        {
+            values[i] = 255;
+        }
+        for (int i = 0; i < 64; ++i)
+        {
+            values[static_cast<unsigned char>(ALPHABET64[i])] = static_cast<byte>(i);
+        }
+        values[static_cast<unsigned char>('+')] = 62;
+        values[static_cast<unsigned char>('/')] = 63;
     }
+};
+
+constexpr From64Table FROM64;
+
+// The block codecs convert as many whole blocks as they can, within the given limits,
+// and return the number of bytes (encoding) or characters (decoding) consumed.
+// The remainder is left to the scalar code, which also finds where a decoding stops.
+using EncodeBlocksFunc = size_t (*)(const byte*, size_t, char*);
+using DecodeBlocksFunc = size_t (*)(const char*, byte*, size_t);
+
+size_t encodeBlocksScalar(const byte*, size_t, char*)
+{
+    return 0;
+}
+
+size_t decodeBlocksScalar(const char*, byte*, size_t)
+{
+    return 0;
+}
+
+#if defined(MEGA_BASE64_SSSE3)
+// 12 bytes to 16 characters per iteration, loading 16 bytes
+__attribute__((target("ssse3")))
+size_t encodeBlocksSSSE3(const byte* b, size_t blen, char* a)
+{
+    const __m128i spread = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
 
-    if (c < 52)
+    // offsets from the 6-bit values to their characters, by range: [0] 26..51, [1..10] 52..61, [11] 62, [12] 63, [13] 0..25
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '-' - 62, '_' - 63, 'A', 0, 0);
+
+    size_t i = 0;
+    for (; i + 16 <= blen; i += 12, a += 16)
     {
-        return static_cast<unsigned char>(c - 26 + 'a');
+        __m128i in = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)), spread);
+
+        // the four 6-bit values of each 3 bytes, one per byte
+        __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+        __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+        __m128i values = _mm_or_si128(t0, t1);
+
+        __m128i range = _mm_subs_epu8(values, _mm_set1_epi8(51));
+        range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), values), _mm_set1_epi8(13)));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(a), _mm_add_epi8(values, _mm_shuffle_epi8(offsets, range)));
     }
+    return i;
+}
 
-    if (c < 62)
+// 16 characters to 12 bytes per iteration, storing 16 bytes
+__attribute__((target("ssse3")))
+size_t decodeBlocksSSSE3(const char* a, byte* b, size_t blen)
+{
+    const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    size_t i = 0;
+    for (; (i / 4) * 3 + 16 <= blen && (reinterpret_cast<uintptr_t>(a + i) & 4095) <= 4096 - 16; i += 16, b += 12)
     {
-        return static_cast<unsigned char>(c - 52 + '0');
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+
+        // signed comparisons: characters above 127 are in none of the ranges
+        __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+        __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('z' + 1)));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+        __m128i c62 = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('-')), _mm_cmpeq_epi8(v, _mm_set1_epi8('+')));
+        __m128i c63 = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('_')), _mm_cmpeq_epi8(v, _mm_set1_epi8('/')));
+
+        __m128i valid = _mm_or_si128(_mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, c62)), c63);
+        if (_mm_movemask_epi8(valid) != 0xFFFF)
+        {
+            break;
+        }
+
+        __m128i values = _mm_or_si128(_mm_or_si128(_mm_and_si128(upper, _mm_sub_epi8(v, _mm_set1_epi8('A'))),
+                                                   _mm_and_si128(lower, _mm_sub_epi8(v, _mm_set1_epi8('a' - 26)))),
+                                      _mm_or_si128(_mm_or_si128(_mm_and_si128(digit, _mm_add_epi8(v, _mm_set1_epi8(52 - '0'))),
+                                                                _mm_and_si128(c62, _mm_set1_epi8(62))),
+                                                   _mm_and_si128(c63, _mm_set1_epi8(63))));
+
+        // merge the 6-bit values into 24 bits per 32-bit lane, then put their bytes in order
+        __m128i merged = _mm_madd_epi16(_mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140)), _mm_set1_epi32(0x00011000));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(b), _mm_shuffle_epi8(merged, pack));
     }
+    return i;
+}
+#endif
 
-    if (c == 62)
+#if defined(MEGA_BASE64_NEON)
+// 48 bytes to 64 characters per iteration
+size_t encodeBlocksNEON(const byte* b, size_t blen, char* a)
+{
+    uint8x16x4_t alphabet;
+    for (int k = 0; k < 4; ++k)
     {
-        return '-';
+        alphabet.val[k] = vld1q_u8(reinterpret_cast<const uint8_t*>(ALPHABET64) + 16 * k);
     }
+    const uint8x16_t mask = vdupq_n_u8(63);
 
-    return '_';
+    size_t i = 0;
+    for (; i + 48 <= blen; i += 48, a += 64)
+    {
+        uint8x16x3_t in = vld3q_u8(b + i);
+        uint8x16x4_t out;
+        out.val[0] = vshrq_n_u8(in.val[0], 2);
+        out.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(in.val[0], 4), vshrq_n_u8(in.val[1], 4)), mask);
+        out.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(in.val[1], 2), vshrq_n_u8(in.val[2], 6)), mask);
+        out.val[3] = vandq_u8(in.val[2], mask);
+        for (int k = 0; k < 4; ++k)
+        {
+            out.val[k] = vqtbl4q_u8(alphabet, out.val[k]);
+        }
+        vst4q_u8(reinterpret_cast<uint8_t*>(a), out);
+    }
+    return i;
 }
 
-unsigned char Base64::from64(byte c)
+// 64 characters to 48 bytes per iteration
+size_t decodeBlocksNEON(const char* a, byte* b, size_t blen)
 {
-    if ((c >= 'A') && (c <= 'Z'))
+    // the values of the characters 0..63 and 64..127, the others are invalid
+    uint8x16x4_t low, high;
+    for (int k = 0; k < 4; ++k)
     {
-        return static_cast<unsigned char>(c - 'A');
+        low.val[k] = vld1q_u8(FROM64.values + 16 * k);
+        high.val[k] = vld1q_u8(FROM64.values + 64 + 16 * k);
     }
+    const uint8x16_t offset = vdupq_n_u8(64);
 
-    if ((c >= 'a') && (c <= 'z'))
+    size_t i = 0;
+    for (; (i / 4) * 3 + 48 <= blen && (reinterpret_cast<uintptr_t>(a + i) & 4095) <= 4096 - 64; i += 64, b += 48)
     {
-        return static_cast<unsigned char>(c - 'a' + 26);
-    }
+        uint8x16x4_t in = vld4q_u8(reinterpret_cast<const uint8_t*>(a + i));
+        uint8x16_t invalid = vdupq_n_u8(0);
+        for (int k = 0; k < 4; ++k)
+        {
+            uint8x16_t c = in.val[k];
+            in.val[k] = vorrq_u8(vorrq_u8(vqtbl4q_u8(low, c), vqtbl4q_u8(high, vsubq_u8(c, offset))), vcgeq_u8(c, vdupq_n_u8(128)));
+            invalid = vorrq_u8(invalid, in.val[k]);
+        }
+        if (vmaxvq_u8(invalid) > 63)
+        {
+            break;
+        }
 
-    if ((c >= '0') && (c <= '9'))
-    {
-        return static_cast<unsigned char>(c - '0' + 52);
+        uint8x16x3_t out;
+        out.val[0] = vorrq_u8(vshlq_n_u8(in.val[0], 2), vshrq_n_u8(in.val[1], 4));
+        out.val[1] = vorrq_u8(vshlq_n_u8(in.val[1], 4), vshrq_n_u8(in.val[2], 2));
+        out.val[2] = vorrq_u8(vshlq_n_u8(in.val[2], 6), in.val[3]);
+        vst3q_u8(b, out);
     }
+    return i;
+}
+#endif
 
-    if (c == '-' || c == '+')
+EncodeBlocksFunc selectEncodeBlocks()
+{
+#if defined(MEGA_BASE64_SSSE3)
+    if (__builtin_cpu_supports("ssse3"))
     {
-        return static_cast<unsigned char>(62);
+        return encodeBlocksSSSE3;
     }
+#elif defined(MEGA_BASE64_NEON)
+    return encodeBlocksNEON;
+#endif
+    return encodeBlocksScalar;
+}
 
-    if (c == '_' || c == '/')
+DecodeBlocksFunc selectDecodeBlocks()
+{
+#if !defined(MEGA_BASE64_NO_SIMD_DECODE)
+#if defined(MEGA_BASE64_SSSE3)
+    if (__builtin_cpu_supports("ssse3"))
     {
-        return static_cast<unsigned char>(63);
+        return decodeBlocksSSSE3;
     }
+#elif defined(MEGA_BASE64_NEON)
+    return decodeBlocksNEON;
+#endif
+#endif
+    return decodeBlocksScalar;
+}
+
+// below this, the blocks are not worth even a call
+const size_t MIN_BLOCKS_SIZE = 64;
+
+} // namespace
+
+// modified base64 conversion (no trailing '=' and '-_' instead of '+/')
+unsigned char Base64::to64(byte c)
+{
+    return static_cast<unsigned char>(ALPHABET64[c & 63]);
+}
 
-    return static_cast<unsigned char>(255);
+unsigned char Base64::from64(byte c)
+{
+    return FROM64.values[c];
 }
 
 
@@ -105,6 +289,32 @@ int Base64::atob(const char* a, byte* b, int blen)
     int i;
     int p = 0;
 
+    if (blen >= static_cast<int>(MIN_BLOCKS_SIZE))
+    {
+        static const DecodeBlocksFunc decodeBlocks = selectDecodeBlocks();
+        size_t n = decodeBlocks(a, b, static_cast<size_t>(blen));
+        a += n;
+        p += static_cast<int>(n / 4 * 3);
+    }
+
+    // whole groups of 4 characters while there's room for them
+    while (p + 3 <= blen)
+    {
+        byte c0 = from64(static_cast<byte>(a[0]));
+        byte c1 = c0 > 63 ? 255 : from64(static_cast<byte>(a[1]));
+        byte c2 = c1 > 63 ? 255 : from64(static_cast<byte>(a[2]));
+        byte c3 = c2 > 63 ? 255 : from64(static_cast<byte>(a[3]));
+        if (c3 > 63)
+        {
+            break;
+        }
+
+        b[p++] = static_cast<byte>((c0 << 2) | (c1 >> 4));
+        b[p++] = static_cast<byte>((c1 << 4) | (c2 >> 2));
+        b[p++] = static_cast<byte>((c2 << 6) | c3);
+        a += 4;
+    }
+
     for (;;)
     {
         for (i = 0; i < 4; i++)
@@ -223,6 +433,25 @@ int Base64::btoa(const byte* b, int blen, char* a)
 {
     int p = 0;
 
+    if (blen >= static_cast<int>(MIN_BLOCKS_SIZE))
+    {
+        static const EncodeBlocksFunc encodeBlocks = selectEncodeBlocks();
+        size_t n = encodeBlocks(b, static_cast<size_t>(blen), a);
+        b += n;
+        blen -= static_cast<int>(n);
+        p += static_cast<int>(n / 3 * 4);
+    }
+
+    // whole groups of 3 bytes
+    for (; blen >= 3; blen -= 3, b += 3)
+    {
+        unsigned v = (unsigned(b[0]) << 16) | (unsigned(b[1]) << 8) | b[2];
+        a[p++] = ALPHABET64[v >> 18];
+        a[p++] = ALPHABET64[(v >> 12) & 63];
+        a[p++] = ALPHABET64[(v >> 6) & 63];
+        a[p++] = ALPHABET64[v & 63];
+    }
+
     for (;;)
     {
         if (blen <= 0)
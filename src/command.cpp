@@ -227,7 +227,14 @@ void Command::createSchedMeetingJson(const ScheduledMeeting* schedMeeting)
 bool Command::cacheresolvedurls(const std::vector<string>& urls, std::vector<string>&& ips)
 {
     // cache resolved URLs if received
-    return client->httpio->cacheresolvedurls(urls, std::move(ips));
+    if (client->httpio->cacheresolvedurls(urls, std::move(ips)))
+    {
+        return true;
+    }
+
+    // otherwise, they are resolved while the transfer gets ready
+    client->httpio->prefetchdns(urls);
+    return false;
 }
 
 // Store ips from response in the vector passed
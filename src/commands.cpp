@@ -291,21 +291,34 @@ bool CommandGetFA::procresult(Result r, JSON& json)
 }
 
 CommandAttachFA::CommandAttachFA(MegaClient *client, handle nh, fatype t, handle ah, int ctag)
+    : CommandAttachFA(client, nh, vector<Attribute>{ { t, ah, ctag } })
 {
+}
+
+CommandAttachFA::CommandAttachFA(MegaClient*, handle nh, const vector<Attribute>& attributes)
+    : mAttributes(attributes)
+{
+    assert(!attributes.empty());
+
     mSeqtagArray = true;
     cmd("pfa");
 
     arg("n", (byte*)&nh, MegaClient::NODEHANDLE);
 
-    char buf[64];
+    // "<N>*<attrib>/<M>*<attrib>"
+    string fa;
+    for (auto& attribute : attributes)
+    {
+        char buf[64];
 
-    snprintf(buf, sizeof(buf), "%u*", t);
-    Base64::btoa((byte*)&ah, sizeof(ah), strchr(buf + 2, 0));
-    arg("fa", buf);
+        snprintf(buf, sizeof(buf), "%s%u*", fa.empty() ? "" : "/", attribute.type);
+        Base64::btoa((byte*)&attribute.fah, sizeof(attribute.fah), strchr(buf, 0));
+        fa.append(buf);
+    }
+    arg("fa", fa.c_str());
 
     h = nh;
-    type = t;
-    tag = ctag;
+    tag = attributes.front().tag;
 }
 
 CommandAttachFA::CommandAttachFA(MegaClient *client, handle nh, fatype t, const std::string& encryptedAttributes, int ctag)
@@ -318,15 +331,26 @@ CommandAttachFA::CommandAttachFA(MegaClient *client, handle nh, fatype t, const
     arg("fa", encryptedAttributes.c_str());
 
     h = nh;
-    type = t;
+    mAttributes.push_back({ t, UNDEF, ctag });
     tag = ctag;
 }
 
 bool CommandAttachFA::procresult(Result r, JSON& json)
 {
+    auto notify = [this](error e)
+    {
+        // each attribute may belong to a different request
+        for (auto& attribute : mAttributes)
+        {
+            client->restag = attribute.tag;
+            client->app->putfa_result(h, attribute.type, e);
+        }
+        client->restag = tag;
+    };
+
     if (r.wasErrorOrOK())
     {
-        client->app->putfa_result(h, type, r.errorOrOK());
+        notify(r.errorOrOK());
         return true;
     }
     else
@@ -338,11 +362,11 @@ bool CommandAttachFA::procresult(Result r, JSON& json)
             shared_ptr<Node> n = client->nodebyhandle(h);
             assert(!n || n->fileattrstring == fa);
 #endif
-            client->app->putfa_result(h, type, API_OK);
+            notify(API_OK);
             return true;
         }
     }
-    client->app->putfa_result(h, type, API_EINTERNAL);
+    notify(API_EINTERNAL);
     return false;
 }
 
@@ -1210,9 +1234,9 @@ CommandPutNodes::CommandPutNodes(MegaClient* client, NodeHandle th,
 }
 
 // add new nodes and handle->node handle mapping
-void CommandPutNodes::removePendingDBRecordsAndTempFiles()
+void CommandPutNodes::removePendingDBRecordsAndTempFiles(int requestTag)
 {
-    pendingdbid_map::iterator it = client->pendingtcids.find(tag);
+    pendingdbid_map::iterator it = client->pendingtcids.find(requestTag);
     if (it != client->pendingtcids.end())
     {
         if (client->tctable)
@@ -1229,7 +1253,7 @@ void CommandPutNodes::removePendingDBRecordsAndTempFiles()
         }
         client->pendingtcids.erase(it);
     }
-    pendingfiles_map::iterator pit = client->pendingfiles.find(tag);
+    pendingfiles_map::iterator pit = client->pendingfiles.find(requestTag);
     if (pit != client->pendingfiles.end())
     {
         vector<LocalPath> &pfs = pit->second;
@@ -1249,7 +1273,12 @@ void CommandPutNodes::performAppCallback(Error e, vector<NewNode>& newnodes, boo
 
 bool CommandPutNodes::procresult(Result r, JSON& json)
 {
-    removePendingDBRecordsAndTempFiles();
+    removePendingDBRecordsAndTempFiles(tag);
+
+    for (auto coalescedTag : mCoalescedTags)
+    {
+        removePendingDBRecordsAndTempFiles(coalescedTag);
+    }
 
     if (r.hasJsonArray() || r.hasJsonObject())
     {
@@ -6183,7 +6212,8 @@ CommandFetchNodes::CommandFetchNodes(MegaClient* client,
         arg("ca", 1);
     }
 
-    if (client->isClientType(MegaClient::ClientType::PASSWORD_MANAGER))
+    if (client->isClientType(MegaClient::ClientType::PASSWORD_MANAGER) ||
+        (client->loggedIntoFolder() && !partialFetchRoot.isUndef()))
     {
         arg("n", partialFetchRoot);
         arg("part", 1);
@@ -21,6 +21,24 @@
 
 #include "mega.h"
 
+// Hardware AES for the CTR + CBC-MAC loop of SymmCipher::ctr_crypt():
+// AES-NI is detected at runtime on x86 (GCC/Clang/MSVC), ARMv8 crypto extensions are
+// used when the build targets them (ie. -march=armv8-a+crypto, or any Apple arm64)
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define MEGA_CTR_AESNI
+#include <cpuid.h>
+#include <wmmintrin.h>
+#define MEGA_CTR_AESNI_TARGET __attribute__((target("aes,sse2")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define MEGA_CTR_AESNI
+#include <intrin.h>
+#include <wmmintrin.h>
+#define MEGA_CTR_AESNI_TARGET
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#define MEGA_CTR_ARMV8
+#include <arm_neon.h>
+#endif
+
 namespace mega {
 #ifndef htobe64
 #define htobe64(x) (((uint64_t)htonl((uint32_t)((x) >> 32))) | (((uint64_t)htonl((uint32_t)x)) << 32))
@@ -72,20 +90,27 @@ void SymmCipher::setkey(const byte* newkey, int type)
         xorblock(newkey + KEYLENGTH, key);
     }
 
-    aesecb_e.SetKey(key, KEYLENGTH);
-    aesecb_d.SetKey(key, KEYLENGTH);
-
-    aescbc_e.SetKeyWithIV(key, KEYLENGTH, zeroiv);
-    aescbc_d.SetKeyWithIV(key, KEYLENGTH, zeroiv);
-
-    aesccm8_e.SetKeyWithIV(key, KEYLENGTH, zeroiv);
-    aesccm8_d.SetKeyWithIV(key, KEYLENGTH, zeroiv);
+    // the modes get the new key when used
+    mExpandedModes = 0;
+}
 
-    aesccm16_e.SetKeyWithIV(key, KEYLENGTH, zeroiv);
-    aesccm16_d.SetKeyWithIV(key, KEYLENGTH, zeroiv);
+void SymmCipher::expandKey(Mode mode)
+{
+    switch (mode)
+    {
+        case ECB_E: aesecb_e.SetKey(key, KEYLENGTH); break;
+        case ECB_D: aesecb_d.SetKey(key, KEYLENGTH); break;
+        case CBC_E: aescbc_e.SetKeyWithIV(key, KEYLENGTH, zeroiv); break;
+        case CBC_D: aescbc_d.SetKeyWithIV(key, KEYLENGTH, zeroiv); break;
+        case CCM16_E: aesccm16_e.SetKeyWithIV(key, KEYLENGTH, zeroiv); break;
+        case CCM16_D: aesccm16_d.SetKeyWithIV(key, KEYLENGTH, zeroiv); break;
+        case CCM8_E: aesccm8_e.SetKeyWithIV(key, KEYLENGTH, zeroiv); break;
+        case CCM8_D: aesccm8_d.SetKeyWithIV(key, KEYLENGTH, zeroiv); break;
+        case GCM_E: aesgcm_e.SetKeyWithIV(key, KEYLENGTH, zeroiv); break;
+        case GCM_D: aesgcm_d.SetKeyWithIV(key, KEYLENGTH, zeroiv); break;
+    }
 
-    aesgcm_e.SetKeyWithIV(key, KEYLENGTH, zeroiv);
-    aesgcm_d.SetKeyWithIV(key, KEYLENGTH, zeroiv);
+    mExpandedModes = static_cast<uint16_t>(mExpandedModes | mode);
 }
 
 bool SymmCipher::setkey(const string* key)
@@ -105,6 +130,7 @@ bool SymmCipher::cbc_encrypt_with_key(const std::string& plain, std::string& cip
     try
     {
         aescbc_e.SetKeyWithIV(key, keylen, iv ? iv: zeroiv);
+        mExpandedModes = static_cast<uint16_t>(mExpandedModes | CBC_E);
         StringSource ss(plain, true, new StreamTransformationFilter(aescbc_e, new StringSink(cipher)));
         return true;
     }
@@ -120,6 +146,7 @@ bool SymmCipher::cbc_decrypt_with_key(const std::string& cipher, std::string& pl
     try
     {
         aescbc_d.SetKeyWithIV(key, keylen, iv ? iv: zeroiv);
+        mExpandedModes = static_cast<uint16_t>(mExpandedModes | CBC_D);
         StringSource ss(cipher, true, new StreamTransformationFilter(aescbc_d, new StringSink(plain)));
         return true;
     }
@@ -134,7 +161,7 @@ bool SymmCipher::cbc_encrypt(byte* data, size_t len, const byte* iv)
 {
     try
     {
-        aescbc_e.Resynchronize(iv ? iv : zeroiv);
+        keyed(aescbc_e, CBC_E).Resynchronize(iv ? iv : zeroiv);
         aescbc_e.ProcessData(data, data, len);
         return true;
     }
@@ -149,7 +176,7 @@ bool SymmCipher::cbc_decrypt(byte* data, size_t len, const byte* iv)
 {
     try
     {
-        aescbc_d.Resynchronize(iv ? iv : zeroiv);
+        keyed(aescbc_d, CBC_D).Resynchronize(iv ? iv : zeroiv);
         aescbc_d.ProcessData(data, data, len);
         return true;
     }
@@ -173,7 +200,7 @@ bool SymmCipher::cbc_encrypt_pkcs_padding(const string *data, const byte *iv, st
     try
     {
         // Update IV.
-        aescbc_e.Resynchronize(iv ? iv : zeroiv);
+        keyed(aescbc_e, CBC_E).Resynchronize(iv ? iv : zeroiv);
 
         // Create sink.
         unique_ptr<StringSink> sink =
@@ -213,7 +240,7 @@ bool SymmCipher::cbc_decrypt_pkcs_padding(const std::string* data, const byte* i
         using Transformation = StreamTransformationFilter;
 
         // Update IV.
-        aescbc_d.Resynchronize(iv ? iv : zeroiv);
+        keyed(aescbc_d, CBC_D).Resynchronize(iv ? iv : zeroiv);
 
         // Create sink.
         unique_ptr<StringSink> sink =
@@ -257,7 +284,7 @@ bool SymmCipher::cbc_decrypt_pkcs_padding(const byte* data,
         using Transformation = StreamTransformationFilter;
 
         // Update IV.
-        aescbc_d.Resynchronize(iv ? iv : zeroiv);
+        keyed(aescbc_d, CBC_D).Resynchronize(iv ? iv : zeroiv);
 
         // Create sink.
         unique_ptr<StringSink> sink =
@@ -287,12 +314,12 @@ bool SymmCipher::cbc_decrypt_pkcs_padding(const byte* data,
 
 void SymmCipher::ecb_encrypt(byte* data, byte* dst, size_t len)
 {
-    aesecb_e.ProcessData(dst ? dst : data, data, len);
+    keyed(aesecb_e, ECB_E).ProcessData(dst ? dst : data, data, len);
 }
 
 void SymmCipher::ecb_decrypt(byte* data, size_t len)
 {
-    aesecb_d.ProcessData(data, data, len);
+    keyed(aesecb_d, ECB_D).ProcessData(data, data, len);
 }
 
 bool SymmCipher::ccm_encrypt(const string *data, const byte *iv, unsigned ivlen, unsigned taglen, string *result)
@@ -307,14 +334,14 @@ bool SymmCipher::ccm_encrypt(const string *data, const byte *iv, unsigned ivlen,
     {
         if (taglen == 16)
         {
-            aesccm16_e.Resynchronize(iv, ivlen);
+            keyed(aesccm16_e, CCM16_E).Resynchronize(iv, ivlen);
             aesccm16_e.SpecifyDataLengths(0, data->size(), 0);
             StringSource ss(*data, true, new AuthenticatedEncryptionFilter(aesccm16_e, new StringSink(*result)));
             return true;
         }
         else if (taglen == 8)
         {
-            aesccm8_e.Resynchronize(iv, ivlen);
+            keyed(aesccm8_e, CCM8_E).Resynchronize(iv, ivlen);
             aesccm8_e.SpecifyDataLengths(0, data->size(), 0);
             StringSource ss(*data, true, new AuthenticatedEncryptionFilter(aesccm8_e, new StringSink(*result)));
             return true;
@@ -339,14 +366,14 @@ bool SymmCipher::ccm_decrypt(const string *data, const byte *iv, unsigned ivlen,
     {
         if (taglen == 16)
         {
-            aesccm16_d.Resynchronize(iv, ivlen);
+            keyed(aesccm16_d, CCM16_D).Resynchronize(iv, ivlen);
             aesccm16_d.SpecifyDataLengths(0, data->size() - taglen, 0);
             StringSource ss(*data, true, new AuthenticatedDecryptionFilter(aesccm16_d, new StringSink(*result)));
             return true;
         }
         else if (taglen == 8)
         {
-            aesccm8_d.Resynchronize(iv, ivlen);
+            keyed(aesccm8_d, CCM8_D).Resynchronize(iv, ivlen);
             aesccm8_d.SpecifyDataLengths(0, data->size() - taglen, 0);
             StringSource ss(*data, true, new AuthenticatedDecryptionFilter(aesccm8_d, new StringSink(*result)));
             return true;
@@ -370,7 +397,7 @@ bool SymmCipher::gcm_encrypt(const string *data, const byte *iv, unsigned ivlen,
 
     try
     {
-        aesgcm_e.Resynchronize(iv, ivlen);
+        keyed(aesgcm_e, GCM_E).Resynchronize(iv, ivlen);
         StringSource ss(*data, true, new AuthenticatedEncryptionFilter(aesgcm_e, new StringSink(*result), false, taglen));
     }
     catch (CryptoPP::Exception const &e)
@@ -414,12 +441,13 @@ bool SymmCipher::gcm_encrypt(const byte* data, const size_t datasize, const byte
         if (!key || !keylen)
         {
             // resynchronizes with the provided IV
-            aesgcm_e.Resynchronize(iv, static_cast<int>(ivlen));
+            keyed(aesgcm_e, GCM_E).Resynchronize(iv, static_cast<int>(ivlen));
         }
         else
         {
             // resynchronizes with the provided Key and IV
             aesgcm_e.SetKeyWithIV(key, keylen, iv, ivlen);
+            mExpandedModes = static_cast<uint16_t>(mExpandedModes | GCM_E);
         }
 
         AuthenticatedEncryptionFilter ef (aesgcm_e, new StringSink(result), false, static_cast<int>(taglen));
@@ -458,7 +486,7 @@ bool SymmCipher::gcm_decrypt(const string *data, const byte *iv, unsigned ivlen,
 
     try
     {
-        aesgcm_d.Resynchronize(iv, ivlen);
+        keyed(aesgcm_d, GCM_D).Resynchronize(iv, ivlen);
         StringSource ss(*data, true, new AuthenticatedDecryptionFilter(aesgcm_d, new StringSink(*result), taglen));
     }
     catch (CryptoPP::Exception const& e)
@@ -488,12 +516,13 @@ bool SymmCipher::gcm_decrypt(const byte* data, const size_t datalen, const byte*
         if (!key || !keylength)
         {
             // resynchronizes with provided IV
-            aesgcm_d.Resynchronize(iv, static_cast<int>(ivlen));
+            keyed(aesgcm_d, GCM_D).Resynchronize(iv, static_cast<int>(ivlen));
         }
         else
         {
             // resynchronizes with the provided Key and IV
             aesgcm_d.SetKeyWithIV(key, keylength, iv, ivlen);
+            mExpandedModes = static_cast<uint16_t>(mExpandedModes | GCM_D);
         }
 
         unsigned int flags = AuthenticatedDecryptionFilter::MAC_AT_BEGIN | AuthenticatedDecryptionFilter::THROW_EXCEPTION;
@@ -683,6 +712,233 @@ SymmCipher& SymmCipher::operator=(const SymmCipher& ref)
 // encryption: data must be NUL-padded to BLOCKSIZE
 // decryption: data must be padded to BLOCKSIZE
 // len must be < 2^31
+namespace {
+
+#if defined(MEGA_CTR_AESNI)
+
+bool hasAesNi()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 25)) != 0;
+#else
+    unsigned eax, ebx, ecx, edx;
+    return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_AES);
+#endif
+}
+
+template<int Rcon>
+MEGA_CTR_AESNI_TARGET __m128i expandKeyStep(__m128i key)
+{
+    __m128i assist = _mm_shuffle_epi32(_mm_aeskeygenassist_si128(key, Rcon), _MM_SHUFFLE(3, 3, 3, 3));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, assist);
+}
+
+MEGA_CTR_AESNI_TARGET void expandKey(const byte* key, __m128i rk[11])
+{
+    rk[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key));
+    rk[1] = expandKeyStep<0x01>(rk[0]);
+    rk[2] = expandKeyStep<0x02>(rk[1]);
+    rk[3] = expandKeyStep<0x04>(rk[2]);
+    rk[4] = expandKeyStep<0x08>(rk[3]);
+    rk[5] = expandKeyStep<0x10>(rk[4]);
+    rk[6] = expandKeyStep<0x20>(rk[5]);
+    rk[7] = expandKeyStep<0x40>(rk[6]);
+    rk[8] = expandKeyStep<0x80>(rk[7]);
+    rk[9] = expandKeyStep<0x1b>(rk[8]);
+    rk[10] = expandKeyStep<0x36>(rk[9]);
+}
+
+// two independent encryptions, interleaved to hide the latency of the serial CBC-MAC chain
+MEGA_CTR_AESNI_TARGET void encrypt2(const __m128i rk[11], __m128i& a, __m128i& b)
+{
+    a = _mm_xor_si128(a, rk[0]);
+    b = _mm_xor_si128(b, rk[0]);
+    for (int r = 1; r < 10; ++r)
+    {
+        a = _mm_aesenc_si128(a, rk[r]);
+        b = _mm_aesenc_si128(b, rk[r]);
+    }
+    a = _mm_aesenclast_si128(a, rk[10]);
+    b = _mm_aesenclast_si128(b, rk[10]);
+}
+
+MEGA_CTR_AESNI_TARGET void encrypt1(const __m128i rk[11], __m128i& a)
+{
+    a = _mm_xor_si128(a, rk[0]);
+    for (int r = 1; r < 10; ++r)
+    {
+        a = _mm_aesenc_si128(a, rk[r]);
+    }
+    a = _mm_aesenclast_si128(a, rk[10]);
+}
+
+MEGA_CTR_AESNI_TARGET
+void ctrCryptHw(const byte* key, byte* data, unsigned len, byte* ctr, byte* mac, bool encrypt)
+{
+    __m128i rk[11];
+    expandKey(key, rk);
+
+    __m128i m = mac ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(mac)) : _mm_setzero_si128();
+    uint64_t index = MemAccess::get<uint64_t>(reinterpret_cast<const char*>(ctr + 8));
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    index = htobe64(index);
+#endif
+
+    for (; (int)len > 0; len -= SymmCipher::BLOCKSIZE, data += SymmCipher::BLOCKSIZE)
+    {
+        SymmCipher::setint64(static_cast<int64_t>(index++), ctr + 8);
+        __m128i ks = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctr));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+
+        if (encrypt)
+        {
+            // the padding of the last block is part of the MAC, as ctr_crypt() always did
+            if (mac)
+            {
+                m = _mm_xor_si128(m, d);
+                encrypt2(rk, m, ks);
+            }
+            else
+            {
+                encrypt1(rk, ks);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(data), _mm_xor_si128(d, ks));
+        }
+        else
+        {
+            encrypt1(rk, ks);
+            d = _mm_xor_si128(d, ks);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(data), d);
+
+            if (mac)
+            {
+                if (len < (unsigned)SymmCipher::BLOCKSIZE)
+                {
+                    // only the actual data of the last block is part of the MAC
+                    alignas(16) byte last[SymmCipher::BLOCKSIZE] = {};
+                    memcpy(last, data, len);
+                    d = _mm_load_si128(reinterpret_cast<const __m128i*>(last));
+                }
+                m = _mm_xor_si128(m, d);
+                encrypt1(rk, m);
+            }
+        }
+    }
+
+    SymmCipher::setint64(static_cast<int64_t>(index), ctr + 8);
+    if (mac)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(mac), m);
+    }
+}
+
+bool hasHardwareAes()
+{
+    static const bool available = hasAesNi();
+    return available;
+}
+
+#elif defined(MEGA_CTR_ARMV8)
+
+void expandKey(const byte* key, uint8x16_t rk[11])
+{
+    static const uint32_t rcon[10] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36 };
+
+    uint32_t w[44];
+    memcpy(w, key, 16);
+    for (int i = 4; i < 44; ++i)
+    {
+        uint32_t t = w[i - 1];
+        if (i % 4 == 0)
+        {
+            // SubWord: AESE with a zero round key applies SubBytes, and ShiftRows has
+            // no effect when the four columns are equal
+            uint8x16_t v = vaeseq_u8(vreinterpretq_u8_u32(vdupq_n_u32(t)), vdupq_n_u8(0));
+            t = vgetq_lane_u32(vreinterpretq_u32_u8(v), 0);
+            t = ((t >> 8) | (t << 24)) ^ rcon[i / 4 - 1];   // RotWord (little endian words)
+        }
+        w[i] = w[i - 4] ^ t;
+    }
+
+    for (int r = 0; r < 11; ++r)
+    {
+        rk[r] = vld1q_u8(reinterpret_cast<const uint8_t*>(w + 4 * r));
+    }
+}
+
+inline uint8x16_t encryptBlock(const uint8x16_t rk[11], uint8x16_t a)
+{
+    for (int r = 0; r < 9; ++r)
+    {
+        a = vaesmcq_u8(vaeseq_u8(a, rk[r]));
+    }
+    return veorq_u8(vaeseq_u8(a, rk[9]), rk[10]);
+}
+
+void ctrCryptHw(const byte* key, byte* data, unsigned len, byte* ctr, byte* mac, bool encrypt)
+{
+    uint8x16_t rk[11];
+    expandKey(key, rk);
+
+    uint8x16_t m = mac ? vld1q_u8(mac) : vdupq_n_u8(0);
+    uint64_t index = MemAccess::get<uint64_t>(reinterpret_cast<const char*>(ctr + 8));
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    index = htobe64(index);
+#endif
+
+    for (; (int)len > 0; len -= SymmCipher::BLOCKSIZE, data += SymmCipher::BLOCKSIZE)
+    {
+        SymmCipher::setint64(static_cast<int64_t>(index++), ctr + 8);
+        uint8x16_t d = vld1q_u8(data);
+
+        if (encrypt)
+        {
+            uint8x16_t ks = encryptBlock(rk, vld1q_u8(ctr));
+            if (mac)
+            {
+                m = encryptBlock(rk, veorq_u8(m, d));
+            }
+            vst1q_u8(data, veorq_u8(d, ks));
+        }
+        else
+        {
+            d = veorq_u8(d, encryptBlock(rk, vld1q_u8(ctr)));
+            vst1q_u8(data, d);
+
+            if (mac)
+            {
+                if (len < (unsigned)SymmCipher::BLOCKSIZE)
+                {
+                    byte last[SymmCipher::BLOCKSIZE] = {};
+                    memcpy(last, data, len);
+                    d = vld1q_u8(last);
+                }
+                m = encryptBlock(rk, veorq_u8(m, d));
+            }
+        }
+    }
+
+    SymmCipher::setint64(static_cast<int64_t>(index), ctr + 8);
+    if (mac)
+    {
+        vst1q_u8(mac, m);
+    }
+}
+
+bool hasHardwareAes()
+{
+    return true;
+}
+
+#endif
+
+} // namespace
+
 void SymmCipher::ctr_crypt(byte* data, unsigned len, m_off_t pos, ctr_iv ctriv, byte* mac, bool encrypt, bool initmac)
 {
     assert(!(pos & (KEYLENGTH - 1)));
@@ -698,6 +954,16 @@ void SymmCipher::ctr_crypt(byte* data, unsigned len, m_off_t pos, ctr_iv ctriv,
         memcpy(mac + sizeof ctriv, ctr, sizeof ctriv);
     }
 
+#if defined(MEGA_CTR_AESNI) || defined(MEGA_CTR_ARMV8)
+    // single pass with hardware AES, unless the block counter would carry into the IV
+    uint64_t blocks = (uint64_t(len) + BLOCKSIZE - 1) / BLOCKSIZE;
+    if (hasHardwareAes() && uint64_t(pos / BLOCKSIZE) + blocks >= uint64_t(pos / BLOCKSIZE))
+    {
+        ctrCryptHw(key, data, len, ctr, mac, encrypt);
+        return;
+    }
+#endif
+
     while ((int)len > 0)
     {
         if (encrypt)
@@ -1162,6 +1428,69 @@ void HMACSHA256::setkey(const byte* key, const size_t length)
     hmac.SetKey(key, length);
 }
 
+// PBKDF2 with HMAC-SHA512 runs the compression function directly: the states after the key pads are computed once,
+// and every iteration takes two compressions of a single padded block, rather than the four (and the copies
+// and buffering) of restarting an HMAC each time. The results are the same as PKCS5_PBKDF2_HMAC<SHA512>
+namespace {
+
+using CryptoPP::word64;
+
+constexpr size_t SHA512_BLOCK = CryptoPP::SHA512::BLOCKSIZE;
+constexpr size_t SHA512_DIGEST = CryptoPP::SHA512::DIGESTSIZE;
+constexpr size_t SHA512_WORDS = SHA512_DIGEST / sizeof(word64);
+
+void loadBigEndian(const byte* data, word64* words, size_t count)
+{
+    for (size_t w = 0; w < count; w++, data += sizeof(word64))
+    {
+        word64 v = 0;
+        for (size_t b = 0; b < sizeof(word64); b++)
+        {
+            v = (v << 8) | data[b];
+        }
+        words[w] = v;
+    }
+}
+
+void storeBigEndian(const word64* words, byte* data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        data[i] = static_cast<byte>(words[i / sizeof(word64)] >> (8 * (sizeof(word64) - 1 - i % sizeof(word64))));
+    }
+}
+
+// completes the SHA-512 of 'processed' bytes (whole blocks) already in 'state' with 'data'
+void sha512Final(word64* state, uint64_t processed, const byte* data, size_t len)
+{
+    alignas(16) word64 block[SHA512_BLOCK / sizeof(word64)];
+    uint64_t bits = (processed + len) * 8;
+
+    for (; len >= SHA512_BLOCK; data += SHA512_BLOCK, len -= SHA512_BLOCK)
+    {
+        loadBigEndian(data, block, SHA512_BLOCK / sizeof(word64));
+        CryptoPP::SHA512::Transform(state, block);
+    }
+
+    // the rest, 0x80 and the length in bits (128 bits), in one or two blocks
+    byte last[2 * SHA512_BLOCK] = {};
+    memcpy(last, data, len);
+    last[len] = 0x80;
+    size_t lastLen = len + 1 + 16 <= SHA512_BLOCK ? SHA512_BLOCK : 2 * SHA512_BLOCK;
+    for (size_t b = 0; b < sizeof bits; b++)
+    {
+        last[lastLen - 1 - b] = static_cast<byte>(bits >> (8 * b));
+    }
+
+    for (size_t offset = 0; offset < lastLen; offset += SHA512_BLOCK)
+    {
+        loadBigEndian(last + offset, block, SHA512_BLOCK / sizeof(word64));
+        CryptoPP::SHA512::Transform(state, block);
+    }
+}
+
+} // namespace
+
 PBKDF2_HMAC_SHA512::PBKDF2_HMAC_SHA512()
 {
 }
@@ -1176,36 +1505,95 @@ bool PBKDF2_HMAC_SHA512::deriveKey(byte* derivedkey,
 {
     assert(derivedkey);
     assert(derivedkeyLen > 0);
-    assert(pwd);
-    assert(pwdLen > 0);
+    assert(pwd || !pwdLen); // empty passwords are valid HMAC keys
     assert(salt);
     assert(saltLen > 0);
     assert(iterations > 0);
 
-    try
+    if (!derivedkey || !derivedkeyLen || !iterations)
     {
-        pbkdf2.DeriveKey(
-            // buffer that holds the derived key
-            derivedkey, derivedkeyLen,
-            // purpose byte. unused by this PBKDF implementation.
-            0x00,
-            // password bytes. careful to be consistent with encoding...
-            pwd, pwdLen,
-            // salt bytes
-            salt, saltLen,
-            // iteration count. See SP 800-132 for details. You want this as large as you can tolerate.
-            // make sure to use the same iteration count on both sides...
-            iterations
-        );
-        return true;
+        return false;
     }
-    catch (const CryptoPP::Exception& e)
+
+    // the HMAC key, hashed if longer than a block
+    byte key[SHA512_BLOCK] = {};
+    if (pwdLen > SHA512_BLOCK)
     {
-        // DeriveKey() should throw CryptoPP::InvalidDerivedLength, however that is not present in all
-        // versions of the lib, i.e. Linux system lib
-        LOG_err << "PKCS5_PBKDF2_HMAC<T>::DeriveKey() exception: " << e.what();
-        return false;
+        alignas(16) word64 state[SHA512_WORDS];
+        CryptoPP::SHA512::InitState(state);
+        sha512Final(state, 0, pwd, pwdLen);
+        storeBigEndian(state, key, SHA512_DIGEST);
     }
+    else if (pwdLen)
+    {
+        memcpy(key, pwd, pwdLen);
+    }
+
+    // the states after the inner and outer pads
+    alignas(16) word64 inner[SHA512_WORDS];
+    alignas(16) word64 outer[SHA512_WORDS];
+    alignas(16) word64 block[SHA512_BLOCK / sizeof(word64)];
+    byte pad[SHA512_BLOCK];
+
+    for (size_t i = 0; i < SHA512_BLOCK; i++) pad[i] = key[i] ^ 0x36;
+    loadBigEndian(pad, block, SHA512_BLOCK / sizeof(word64));
+    CryptoPP::SHA512::InitState(inner);
+    CryptoPP::SHA512::Transform(inner, block);
+
+    for (size_t i = 0; i < SHA512_BLOCK; i++) pad[i] = key[i] ^ 0x5c;
+    loadBigEndian(pad, block, SHA512_BLOCK / sizeof(word64));
+    CryptoPP::SHA512::InitState(outer);
+    CryptoPP::SHA512::Transform(outer, block);
+
+    // the block hashed after the pads in every iteration: a digest, padded as a message of a block and a digest
+    std::fill(std::begin(block), std::end(block), word64(0));
+    block[SHA512_WORDS] = word64(1) << 63;
+    block[SHA512_BLOCK / sizeof(word64) - 1] = (SHA512_BLOCK + SHA512_DIGEST) * 8;
+
+    std::vector<byte> message(salt, salt + saltLen);
+    message.resize(saltLen + 4);
+
+    alignas(16) word64 state[SHA512_WORDS];
+    word64 t[SHA512_WORDS];
+
+    size_t done = 0;
+    for (uint32_t index = 1; done < derivedkeyLen; index++)
+    {
+        // U1 = HMAC(password, salt || index)
+        for (size_t b = 0; b < 4; b++)
+        {
+            message[saltLen + b] = static_cast<byte>(index >> (8 * (3 - b)));
+        }
+        memcpy(state, inner, sizeof state);
+        sha512Final(state, SHA512_BLOCK, message.data(), message.size());
+        memcpy(block, state, sizeof state);
+        memcpy(state, outer, sizeof state);
+        CryptoPP::SHA512::Transform(state, block);
+        memcpy(t, state, sizeof t);
+
+        // Uc = HMAC(password, Uc-1), all of them xored
+        for (unsigned c = 1; c < iterations; c++)
+        {
+            memcpy(block, state, sizeof state);
+            memcpy(state, inner, sizeof state);
+            CryptoPP::SHA512::Transform(state, block);
+
+            memcpy(block, state, sizeof state);
+            memcpy(state, outer, sizeof state);
+            CryptoPP::SHA512::Transform(state, block);
+
+            for (size_t w = 0; w < SHA512_WORDS; w++)
+            {
+                t[w] ^= state[w];
+            }
+        }
+
+        size_t len = std::min(SHA512_DIGEST, derivedkeyLen - done);
+        storeBigEndian(t, derivedkey + done, len);
+        done += len;
+    }
+
+    return true;
 }
 
 } // namespace
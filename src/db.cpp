@@ -132,6 +132,42 @@ void DbTable::checkCommitter(DBTableTransactionCommitter*)
     assert(mTransactionCommitter);
 }
 
+void DbCommitLatency::add(std::chrono::microseconds elapsed)
+{
+    size_t bucket = 0;
+    for (auto us = static_cast<uint64_t>(std::max<std::chrono::microseconds::rep>(elapsed.count(), 0));
+         us > 1 && bucket < NUM_BUCKETS - 1;
+         us >>= 1)
+    {
+        ++bucket;
+    }
+
+    ++mBuckets[bucket];
+    ++mNumCommits;
+}
+
+std::chrono::microseconds DbCommitLatency::percentile(unsigned percentile) const
+{
+    uint64_t numCommits = mNumCommits;
+    if (!numCommits)
+    {
+        return std::chrono::microseconds(0);
+    }
+
+    uint64_t target = (numCommits * std::min(percentile, 100u) + 99) / 100;
+    uint64_t accumulated = 0;
+    for (size_t bucket = 0; bucket < NUM_BUCKETS; ++bucket)
+    {
+        accumulated += mBuckets[bucket];
+        if (accumulated >= target)
+        {
+            return std::chrono::microseconds(uint64_t(1) << (bucket + 1));
+        }
+    }
+
+    return std::chrono::microseconds(uint64_t(1) << NUM_BUCKETS);
+}
+
 const int DbAccess::LEGACY_DB_VERSION = 13;
 const int DbAccess::DB_VERSION = DbAccess::LEGACY_DB_VERSION + 1;
 const int DbAccess::LAST_DB_VERSION_WITHOUT_NOD = 12;
@@ -142,4 +178,46 @@ DbAccess::DbAccess()
     currentDbVersion = LEGACY_DB_VERSION;
 }
 
+void DbAccess::setPerformanceProfile(const DbPerformanceProfile& profile)
+{
+    std::lock_guard<std::mutex> g(mPerformanceProfileMutex);
+    mPerformanceProfile = profile;
+}
+
+DbPerformanceProfile DbAccess::performanceProfile() const
+{
+    std::lock_guard<std::mutex> g(mPerformanceProfileMutex);
+    return mPerformanceProfile;
+}
+
+bool DbPerformanceProfile::fromPreset(int preset, DbPerformanceProfile& profile)
+{
+    profile = DbPerformanceProfile();
+
+    switch (preset)
+    {
+        case PRESET_DEFAULT:
+            return true;
+
+        case PRESET_LOW_MEMORY:
+            profile.mMmapSize = 0;
+            profile.mCacheSizeKB = 256;
+            return true;
+
+        case PRESET_HIGH_PERFORMANCE:
+            profile.mMmapSize = 256 * 1024 * 1024;
+            profile.mCacheSizeKB = 32 * 1024;
+            profile.mPageSize = 8192;
+            profile.mSynchronous = SYNC_NORMAL;
+            return true;
+    }
+
+    return false;
+}
+
+bool DbPerformanceProfile::isDefault() const
+{
+    return mMmapSize < 0 && mCacheSizeKB <= 0 && !mPageSize && mSynchronous == SYNC_DEFAULT;
+}
+
 } // namespace
@@ -140,6 +140,20 @@ static int
     return naturalsorting_compare(s1.c_str(), s2.c_str());
 }
 
+// Run a query returning a single integer (ie. SELECT count(*))
+static bool sqlite_query_count(sqlite3* db, const char* query, int64_t& result)
+{
+    sqlite3_stmt* stmt = nullptr;
+    bool succeeded = sqlite3_prepare_v2(db, query, -1, &stmt, nullptr) == SQLITE_OK &&
+                     sqlite3_step(stmt) == SQLITE_ROW;
+    if (succeeded)
+    {
+        result = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return succeeded;
+}
+
 DbTable *SqliteDbAccess::openTableWithNodes(PrnGen &rng, FileSystemAccess &fsAccess, const string &name, const int flags, DBErrorCallback dBErrorCallBack)
 {
     sqlite3 *db = nullptr;
@@ -149,21 +163,8 @@ DbTable *SqliteDbAccess::openTableWithNodes(PrnGen &rng, FileSystemAccess &fsAcc
         return nullptr;
     }
 
-    if (sqlite3_create_function(db, u8"getmimetype", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, 0, &SqliteAccountState::userGetMimetype, 0, 0) != SQLITE_OK)
-    {
-        LOG_err << "Data base error(sqlite3_create_function userGetMimetype): " << sqlite3_errmsg(db);
-        sqlite3_close(db);
-        return nullptr;
-    }
-
-    if (sqlite3_create_collation(db,
-                                 "NATURALNOCASE",
-                                 SQLITE_UTF8,
-                                 nullptr,
-                                 sqlite_naturalsorting_compare))
+    if (!SqliteAccountState::registerNodesFunctions(db))
     {
-        LOG_err << "Data base error(sqlite3_create_collation NATURALNOCASE): "
-                << sqlite3_errmsg(db);
         sqlite3_close(db);
         return nullptr;
     }
@@ -173,7 +174,8 @@ DbTable *SqliteDbAccess::openTableWithNodes(PrnGen &rng, FileSystemAccess &fsAcc
                       "parenthandle int64, name text, fingerprint BLOB, origFingerprint BLOB, "
                       "type tinyint, mimetype tinyint AS (getmimetype(name)) VIRTUAL, size int64, share tinyint, fav tinyint, "
                       "ctime int64, mtime int64 DEFAULT 0, flags int64, counter BLOB NOT NULL, node BLOB NOT NULL, "
-                      "label tinyint DEFAULT 0, description text, tags text)";
+                      "label tinyint DEFAULT 0, description text, tags text, "
+                      "namesortkey BLOB AS (getnamesortkey(name)) VIRTUAL)";
     int result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
     if (result)
     {
@@ -204,6 +206,10 @@ DbTable *SqliteDbAccess::openTableWithNodes(PrnGen &rng, FileSystemAccess &fsAcc
          "text",
          NodeData::COMPONENT_TAGS,
          NewColumn::extractDataFromNodeData<TagsType>       },
+        {"namesortkey",
+         "BLOB AS (getnamesortkey(name)) VIRTUAL",
+         NodeData::COMPONENT_NONE,
+         nullptr                                            },
         };
 
 
@@ -213,56 +219,45 @@ DbTable *SqliteDbAccess::openTableWithNodes(PrnGen &rng, FileSystemAccess &fsAcc
         return nullptr;
     }
 
-#if __ANDROID__
-    // Android doesn't provide a temporal directory -> change default policy for temp
-    // store (FILE=1) to avoid failures on large queries, so it relies on MEMORY=2
-    result = sqlite3_exec(db, "PRAGMA temp_store=2;", nullptr, nullptr, nullptr);
-    if (result)
-    {
-        LOG_err << "PRAGMA temp_store error " << sqlite3_errmsg(db);
-        sqlite3_close(db);
-        return nullptr;
-    }
-#endif
-
-    result = sqlite3_create_function(db, "regexp", 2, SQLITE_ANY,0, &SqliteAccountState::userRegexp, 0, 0);
-    if (result)
-    {
-        LOG_err << "Data base error(sqlite3_create_function userRegexp): " << sqlite3_errmsg(db);
-        sqlite3_close(db);
-        return nullptr;
-    }
-
-    result = sqlite3_create_function(db, "ismimetype", 2, SQLITE_ANY,0, &SqliteAccountState::userIsMimetype, 0, 0);
+    // Access granted to the nodes attached to chats (see DBTableNodes::putChatGrants()):
+    // a row per chat, node and user, so the grants of a chat are a range of the primary key
+    result = sqlite3_exec(db, "CREATE TABLE IF NOT EXISTS chatgrants (chatid int64 NOT NULL, nodehandle int64 NOT NULL, "
+                              "userhandle int64 NOT NULL, PRIMARY KEY (chatid, nodehandle, userhandle)) WITHOUT ROWID",
+                          nullptr, nullptr, nullptr);
     if (result)
     {
-        LOG_err << "Data base error(sqlite3_create_function userIsMimetype): " << sqlite3_errmsg(db);
+        LOG_err << "Data base error: " << sqlite3_errmsg(db);
         sqlite3_close(db);
         return nullptr;
     }
 
-    result = sqlite3_create_function(db, "isContained", 2, SQLITE_ANY,0, &SqliteAccountState::userIsContained, 0, 0);
+#if __ANDROID__
+    // Android doesn't provide a temporal directory -> change default policy for temp
+    // store (FILE=1) to avoid failures on large queries, so it relies on MEMORY=2
+    result = sqlite3_exec(db, "PRAGMA temp_store=2;", nullptr, nullptr, nullptr);
     if (result)
     {
-        LOG_err << "Data base error(sqlite3_create_function userIsContained): " << sqlite3_errmsg(db);
+        LOG_err << "PRAGMA temp_store error " << sqlite3_errmsg(db);
         sqlite3_close(db);
         return nullptr;
     }
+#endif
 
-    result = sqlite3_create_function(db, "matchTag", 2, SQLITE_ANY,0, &SqliteAccountState::userMatchTag, 0, 0);
-    if (result)
-    {
-        LOG_err << "Data base error(sqlite3_create_function userMatchTag): " << sqlite3_errmsg(db);
-        sqlite3_close(db);
-        return nullptr;
-    }
+    bool hasNameIndex = SqliteAccountState::openNameIndex(db);
+    bool hasAncestryIndex = SqliteAccountState::openAncestryIndex(db);
+    bool hasTagIndex = SqliteAccountState::openTagIndex(db);
+    bool hasDescriptionIndex = SqliteAccountState::openDescriptionIndex(db);
 
     return new SqliteAccountState(rng,
                                 db,
                                 fsAccess,
                                 dbPath,
                                 (flags & DB_OPEN_FLAG_TRANSACTED) > 0,
-                                std::move(dBErrorCallBack));
+                                std::move(dBErrorCallBack),
+                                hasNameIndex,
+                                hasAncestryIndex,
+                                hasTagIndex,
+                                hasDescriptionIndex);
 }
 
 bool SqliteDbAccess::probe(FileSystemAccess& fsAccess, const string& name) const
@@ -286,6 +281,40 @@ const LocalPath& SqliteDbAccess::rootPath() const
     return mRootPath;
 }
 
+// Set the tuning pragmas of the profile. Database-wide settings are only applied by writers
+static void sqlite_apply_performance_profile(sqlite3* db, const DbPerformanceProfile& profile, bool writer)
+{
+    std::ostringstream pragmas;
+
+    // it only has effect until the database file is initialized
+    if (writer && profile.mPageSize)
+    {
+        pragmas << "PRAGMA page_size=" << profile.mPageSize << ";";
+    }
+
+    if (profile.mMmapSize >= 0)
+    {
+        pragmas << "PRAGMA mmap_size=" << profile.mMmapSize << ";";
+    }
+
+    if (profile.mCacheSizeKB > 0)
+    {
+        // negative values are KiB instead of pages
+        pragmas << "PRAGMA cache_size=" << -profile.mCacheSizeKB << ";";
+    }
+
+    if (writer && profile.mSynchronous != DbPerformanceProfile::SYNC_DEFAULT)
+    {
+        pragmas << "PRAGMA synchronous=" << profile.mSynchronous << ";";
+    }
+
+    if (pragmas.tellp() > 0 && sqlite3_exec(db, pragmas.str().c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        // not fatal, the engine defaults are used
+        LOG_warn << "Failed to apply DB performance profile: " << sqlite3_errmsg(db);
+    }
+}
+
 bool SqliteDbAccess::openDBAndCreateStatecache(sqlite3 **db, FileSystemAccess &fsAccess, const string &name, LocalPath &dbPath, const int flags)
 {
     checkDbFileAndAdjustLegacy(fsAccess, name, flags, dbPath);
@@ -304,6 +333,9 @@ bool SqliteDbAccess::openDBAndCreateStatecache(sqlite3 **db, FileSystemAccess &f
         return false;
     }
 
+    // before the journal mode is set, since a new database is initialized by it
+    sqlite_apply_performance_profile(*db, performanceProfile(), true);
+
 #if !(TARGET_OS_IPHONE)
     result = sqlite3_exec(*db, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr);
     if (result)
@@ -594,6 +626,208 @@ bool SqliteDbAccess::migrateDataToColumns(sqlite3* db, vector<NewColumn>&& cols)
 }
 
 
+// Runs PASSIVE checkpoints of a WAL database from its own thread and connection, so the
+// thread committing transactions doesn't wait for the WAL to be copied into the database
+class SqliteWalCheckpointer
+{
+public:
+    explicit SqliteWalCheckpointer(const LocalPath& dbPath)
+      : mThread(&SqliteWalCheckpointer::loop, this, dbPath.toPath(false))
+    {
+    }
+
+    ~SqliteWalCheckpointer()
+    {
+        {
+            std::lock_guard<std::mutex> g(mMutex);
+            mExit = true;
+        }
+        mCondition.notify_one();
+        mThread.join();
+    }
+
+    void notifyCommit()
+    {
+        {
+            std::lock_guard<std::mutex> g(mMutex);
+            mPendingCommit = true;
+        }
+        mCondition.notify_one();
+    }
+
+private:
+    // checkpoints are spaced this much at least, commits in between are checkpointed together
+    static constexpr std::chrono::seconds MIN_INTERVAL{1};
+
+    void loop(std::string path)
+    {
+        sqlite3* db = nullptr;
+        if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_FULLMUTEX, nullptr) != SQLITE_OK)
+        {
+            LOG_err << "Failed to open DB for WAL checkpoints: " << (db ? sqlite3_errmsg(db) : "");
+            sqlite3_close(db);
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (!mExit)
+        {
+            mCondition.wait(lock, [this]() { return mExit || mPendingCommit; });
+            if (mExit)
+            {
+                break;
+            }
+            mPendingCommit = false;
+
+            lock.unlock();
+
+            // PASSIVE never blocks the writer: frames still in use are left for the next one
+            int logFrames = 0;
+            int checkpointedFrames = 0;
+            int result = sqlite3_wal_checkpoint_v2(db, nullptr, SQLITE_CHECKPOINT_PASSIVE, &logFrames, &checkpointedFrames);
+            if (result != SQLITE_OK && result != SQLITE_BUSY)
+            {
+                LOG_warn << "WAL checkpoint failed: " << sqlite3_errmsg(db);
+            }
+
+            lock.lock();
+            mCondition.wait_for(lock, MIN_INTERVAL, [this]() { return mExit; });
+        }
+        lock.unlock();
+
+        sqlite3_close(db);
+    }
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mPendingCommit = false;
+    bool mExit = false;
+    std::thread mThread;
+};
+
+// Read-only instances of a SqliteAccountState, each one with its own connection. They are
+// opened on demand up to MAX_READERS and kept idle between uses. Leased readers keep the pool
+// alive, and they're closed instead of pooled if the pool was closed in the meantime.
+class SqliteReaderPool : public std::enable_shared_from_this<SqliteReaderPool>
+{
+public:
+    SqliteReaderPool(PrnGen& rng, FileSystemAccess& fsAccess, const LocalPath& dbPath, bool hasNameIndex, bool hasAncestryIndex,
+                     bool hasTagIndex, bool hasDescriptionIndex, const DbPerformanceProfile& profile)
+      : mRng(rng)
+      , mFsAccess(fsAccess)
+      , mDbPath(dbPath)
+      , mHasNameIndex(hasNameIndex)
+      , mHasAncestryIndex(hasAncestryIndex)
+      , mHasTagIndex(hasTagIndex)
+      , mHasDescriptionIndex(hasDescriptionIndex)
+      , mProfile(profile)
+    {
+    }
+
+    std::shared_ptr<DBTableNodes> acquire()
+    {
+        std::unique_ptr<SqliteAccountState> reader;
+        {
+            std::lock_guard<std::mutex> g(mMutex);
+            if (mClosed)
+            {
+                return nullptr;
+            }
+
+            if (!mIdle.empty())
+            {
+                reader = std::move(mIdle.back());
+                mIdle.pop_back();
+            }
+            else if (mNumReaders < MAX_READERS)
+            {
+                ++mNumReaders;
+            }
+            else
+            {
+                return nullptr;
+            }
+        }
+
+        if (!reader)
+        {
+            reader.reset(open());
+            if (!reader)
+            {
+                std::lock_guard<std::mutex> g(mMutex);
+                --mNumReaders;
+                return nullptr;
+            }
+        }
+
+        std::shared_ptr<SqliteReaderPool> pool = shared_from_this();
+        return std::shared_ptr<DBTableNodes>(reader.release(), [pool](DBTableNodes* table)
+        {
+            pool->release(std::unique_ptr<SqliteAccountState>(static_cast<SqliteAccountState*>(table)));
+        });
+    }
+
+    // close the idle readers, the leased ones are closed as soon as they're released
+    void close()
+    {
+        std::vector<std::unique_ptr<SqliteAccountState>> idle;
+        {
+            std::lock_guard<std::mutex> g(mMutex);
+            mClosed = true;
+            mNumReaders -= mIdle.size();
+            idle.swap(mIdle);
+        }
+    }
+
+private:
+    static constexpr size_t MAX_READERS = 3;
+
+    SqliteAccountState* open()
+    {
+        sqlite3* db = nullptr;
+        if (sqlite3_open_v2(mDbPath.toPath(false).c_str(), &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK ||
+            !SqliteAccountState::registerNodesFunctions(db))
+        {
+            LOG_err << "Failed to open DB reader: " << (db ? sqlite3_errmsg(db) : "");
+            sqlite3_close(db);
+            return nullptr;
+        }
+
+        sqlite_apply_performance_profile(db, mProfile, false);
+
+        auto reader = new SqliteAccountState(mRng, db, mFsAccess, mDbPath, false, nullptr, mHasNameIndex, mHasAncestryIndex,
+                                             mHasTagIndex, mHasDescriptionIndex);
+        reader->mNoReaders = true;
+        return reader;
+    }
+
+    void release(std::unique_ptr<SqliteAccountState> reader)
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        if (mClosed)
+        {
+            --mNumReaders;
+            return; // closed when 'reader' goes out of scope
+        }
+
+        mIdle.push_back(std::move(reader));
+    }
+
+    PrnGen& mRng;
+    FileSystemAccess& mFsAccess;
+    LocalPath mDbPath;
+    bool mHasNameIndex;
+    bool mHasAncestryIndex;
+    bool mHasTagIndex;
+    bool mHasDescriptionIndex;
+    DbPerformanceProfile mProfile;
+
+    std::mutex mMutex;
+    std::vector<std::unique_ptr<SqliteAccountState>> mIdle;
+    size_t mNumReaders = 0; // idle and leased
+    bool mClosed = false;
+};
+
 SqliteDbTable::SqliteDbTable(PrnGen &rng, sqlite3* db, FileSystemAccess &fsAccess, const LocalPath &path, const bool checkAlwaysTransacted, DBErrorCallback dBErrorCallBack)
   : DbTable(rng, checkAlwaysTransacted, dBErrorCallBack)
   , db(db)
@@ -620,6 +854,9 @@ SqliteDbTable::~SqliteDbTable()
         abort();
     }
 
+    // the last connection to be closed checkpoints the WAL and deletes it
+    mCheckpointer.reset();
+
     sqlite3_close(db);
     LOG_debug << "Database closed " << dbfile;
 }
@@ -824,8 +1061,16 @@ void SqliteDbTable::commit()
 
     LOG_debug << "DB transaction COMMIT " << dbfile;
 
+    auto start = std::chrono::steady_clock::now();
     int rc = sqlite3_exec(db, "COMMIT", 0, 0, NULL);
+    mCommitLatency.add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start));
+
     errorHandler(rc, "Commit transaction", false);
+
+    if (mCheckpointer && rc == SQLITE_OK)
+    {
+        mCheckpointer->notifyCommit();
+    }
 }
 
 // abort transaction
@@ -861,6 +1106,8 @@ void SqliteDbTable::remove()
         abort();
     }
 
+    mCheckpointer.reset();
+
     sqlite3_close(db);
 
     db = NULL;
@@ -868,6 +1115,42 @@ void SqliteDbTable::remove()
     fsaccess->unlinklocal(dbfile);
 }
 
+bool SqliteDbTable::isWal() const
+{
+    sqlite3_stmt* stmt = nullptr;
+    bool wal = sqlite3_prepare_v2(db, "PRAGMA journal_mode", -1, &stmt, nullptr) == SQLITE_OK
+               && sqlite3_step(stmt) == SQLITE_ROW
+               && !strcmp(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)), "wal");
+    sqlite3_finalize(stmt);
+    return wal;
+}
+
+void SqliteDbTable::setBackgroundCheckpoints(bool enable)
+{
+    if (!db || enable == static_cast<bool>(mCheckpointer))
+    {
+        return;
+    }
+
+    if (!enable)
+    {
+        mCheckpointer.reset();
+        sqlite3_wal_autocheckpoint(db, WAL_AUTOCHECKPOINT_PAGES);
+        return;
+    }
+
+    // only WAL databases have something to checkpoint (not used in iOS)
+    if (!isWal())
+    {
+        LOG_debug << "Background checkpoints not used, the DB isn't in WAL mode " << dbfile;
+        return;
+    }
+
+    sqlite3_wal_autocheckpoint(db, 0);
+    mCheckpointer = std::make_unique<SqliteWalCheckpointer>(dbfile);
+    LOG_debug << "Background checkpoints enabled " << dbfile;
+}
+
 void SqliteDbTable::errorHandler(int sqliteError, const string& operation, bool interrupt)
 {
     DBError dbError = DBError::DB_ERROR_UNKNOWN;
@@ -911,397 +1194,1339 @@ void SqliteDbTable::errorHandler(int sqliteError, const string& operation, bool
     }
 }
 
-SqliteAccountState::SqliteAccountState(PrnGen &rng, sqlite3 *pdb, FileSystemAccess &fsAccess, const LocalPath &path, const bool checkAlwaysTransacted, DBErrorCallback dBErrorCallBack)
+SqliteAccountState::SqliteAccountState(PrnGen &rng, sqlite3 *pdb, FileSystemAccess &fsAccess, const LocalPath &path, const bool checkAlwaysTransacted, DBErrorCallback dBErrorCallBack, bool hasNameIndex, bool hasAncestryIndex, bool hasTagIndex, bool hasDescriptionIndex)
     : SqliteDbTable(rng, pdb, fsAccess, path, checkAlwaysTransacted, dBErrorCallBack)
+    , mHasNameIndex(hasNameIndex)
+    , mHasTagIndex(hasTagIndex)
+    , mHasDescriptionIndex(hasDescriptionIndex)
+    , mHasAncestryIndex(hasAncestryIndex)
 {
 }
 
 SqliteAccountState::~SqliteAccountState()
 {
-    finalise();
-}
-
-int SqliteAccountState::progressHandler(void *param)
-{
-    CancelToken* cancelFlag = static_cast<CancelToken*>(param);
-    return cancelFlag->isCancelled();
-}
-
-bool SqliteAccountState::processSqlQueryNodes(sqlite3_stmt *stmt, std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>>& nodes)
-{
-    assert(stmt);
-    int sqlResult = SQLITE_ERROR;
-    while ((sqlResult = sqlite3_step(stmt)) == SQLITE_ROW)
+    if (mReaderPool)
     {
-        NodeHandle nodeHandle;
-        nodeHandle.set6byte(sqlite3_column_int64(stmt, 0));
-
-        NodeSerialized node;
-
-        // Blob node counter
-        const void* data = sqlite3_column_blob(stmt, 1);
-        int size = sqlite3_column_bytes(stmt, 1);
-        if (data && size)
-        {
-            node.mNodeCounter = std::string(static_cast<const char*>(data), size);
-        }
-
-        // blob node
-        data = sqlite3_column_blob(stmt, 2);
-        size = sqlite3_column_bytes(stmt, 2);
-        if (data && size)
-        {
-            node.mNode = std::string(static_cast<const char*>(data), size);
-            nodes.insert(nodes.end(), std::make_pair(nodeHandle, std::move(node)));
-        }
+        mReaderPool->close();
     }
 
-    errorHandler(sqlResult, "Process sql query", true);
-
-    return sqlResult == SQLITE_DONE;
+    finalise();
 }
 
-bool SqliteAccountState::remove(NodeHandle nodehandle)
+bool SqliteAccountState::registerNodesFunctions(sqlite3* db)
 {
-    if (!db)
+    if (sqlite3_create_function(db, u8"getmimetype", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, 0, &SqliteAccountState::userGetMimetype, 0, 0) != SQLITE_OK)
     {
+        LOG_err << "Data base error(sqlite3_create_function userGetMimetype): " << sqlite3_errmsg(db);
         return false;
     }
 
-    checkTransaction();
-
-    char buf[64];
+    if (sqlite3_create_function(db, u8"getnamesortkey", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, 0, &SqliteAccountState::userGetNameSortKey, 0, 0) != SQLITE_OK)
+    {
+        LOG_err << "Data base error(sqlite3_create_function userGetNameSortKey): " << sqlite3_errmsg(db);
+        return false;
+    }
 
-    snprintf(buf, sizeof(buf), "DELETE FROM nodes WHERE nodehandle = %" PRId64, nodehandle.as8byte());
+    // Not used by the current indexes (see 'namesortkey'), but by the ones of previous versions
+    if (sqlite3_create_collation(db,
+                                 "NATURALNOCASE",
+                                 SQLITE_UTF8,
+                                 nullptr,
+                                 sqlite_naturalsorting_compare))
+    {
+        LOG_err << "Data base error(sqlite3_create_collation NATURALNOCASE): "
+                << sqlite3_errmsg(db);
+        return false;
+    }
 
-    int sqlResult = sqlite3_exec(db, buf, 0, 0, NULL);
-    errorHandler(sqlResult, "Delete node", false);
+    if (sqlite3_create_function(db, "regexp", 2, SQLITE_ANY,0, &SqliteAccountState::userRegexp, 0, 0))
+    {
+        LOG_err << "Data base error(sqlite3_create_function userRegexp): " << sqlite3_errmsg(db);
+        return false;
+    }
 
-    return sqlResult == SQLITE_OK;
-}
+    if (sqlite3_create_function(db, "ismimetype", 2, SQLITE_ANY,0, &SqliteAccountState::userIsMimetype, 0, 0))
+    {
+        LOG_err << "Data base error(sqlite3_create_function userIsMimetype): " << sqlite3_errmsg(db);
+        return false;
+    }
 
-bool SqliteAccountState::removeNodes()
-{
-    if (!db)
+    if (sqlite3_create_function(db, "isContained", 2, SQLITE_ANY,0, &SqliteAccountState::userIsContained, 0, 0))
     {
+        LOG_err << "Data base error(sqlite3_create_function userIsContained): " << sqlite3_errmsg(db);
         return false;
     }
 
+    if (sqlite3_create_function(db, "matchTag", 2, SQLITE_ANY,0, &SqliteAccountState::userMatchTag, 0, 0))
+    {
+        LOG_err << "Data base error(sqlite3_create_function userMatchTag): " << sqlite3_errmsg(db);
+        return false;
+    }
+
+    return true;
+}
+
+std::shared_ptr<DBTableNodes> SqliteAccountState::acquireReader()
+{
+    // The writer is always in a transaction, but it only matters once something has been
+    // written: those changes wouldn't be visible to readers, so the writer is used meanwhile
+    if (!db || mNoReaders || sqlite3_txn_state(db, nullptr) == SQLITE_TXN_WRITE)
+    {
+        return nullptr;
+    }
+
+    if (!mReaderPool)
+    {
+        // with a rollback journal (iOS), readers and the writer would block each other
+        if (!isWal())
+        {
+            LOG_debug << "Concurrent readers not used, the DB isn't in WAL mode " << dbfile;
+            mNoReaders = true;
+            return nullptr;
+        }
+
+        // readers use the same memory settings of the writer
+        DbPerformanceProfile readerProfile;
+        int64_t cacheSize = 0;
+        int64_t pageSize = 0;
+        sqlite_query_count(db, "PRAGMA mmap_size", readerProfile.mMmapSize);
+        if (sqlite_query_count(db, "PRAGMA cache_size", cacheSize) &&
+            sqlite_query_count(db, "PRAGMA page_size", pageSize))
+        {
+            readerProfile.mCacheSizeKB = cacheSize < 0 ? -cacheSize : cacheSize * pageSize / 1024;
+        }
+
+        mReaderPool = std::make_shared<SqliteReaderPool>(prnGen(), *fsaccess, dbfile, mHasNameIndex, mHasAncestryIndex,
+                                                           mHasTagIndex, mHasDescriptionIndex, readerProfile);
+    }
+
+    return mReaderPool->acquire();
+}
+
+std::shared_ptr<DBTableNodes> SqliteAccountState::acquireSnapshot()
+{
+    std::shared_ptr<DBTableNodes> reader = acquireReader();
+    if (!reader)
+    {
+        return nullptr;
+    }
+
+    // in WAL mode, the snapshot is taken by the first read of the transaction
+    auto snapshot = static_cast<SqliteAccountState*>(reader.get());
+    if (sqlite3_exec(snapshot->db, "BEGIN; SELECT 1 FROM nodes LIMIT 1", nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        LOG_err << "Failed to start a DB snapshot: " << sqlite3_errmsg(snapshot->db);
+        if (!sqlite3_get_autocommit(snapshot->db))
+        {
+            sqlite3_exec(snapshot->db, "ROLLBACK", nullptr, nullptr, nullptr);
+        }
+        return nullptr;
+    }
+
+    // the transaction is ended before the reader goes back to the pool
+    return std::shared_ptr<DBTableNodes>(snapshot, [reader](DBTableNodes* table)
+    {
+        sqlite3_exec(static_cast<SqliteAccountState*>(table)->db, "COMMIT", nullptr, nullptr, nullptr);
+    });
+}
+
+int SqliteAccountState::progressHandler(void *param)
+{
+    CancelToken* cancelFlag = static_cast<CancelToken*>(param);
+    return cancelFlag->isCancelled();
+}
+
+bool SqliteAccountState::processSqlQueryNodes(sqlite3_stmt *stmt, std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>>& nodes)
+{
+    static auto& queryLatency = Metrics::registry().histogram("SqliteAccountState_query");
+    static auto& nodesLoaded = Metrics::registry().counter("SqliteAccountState_nodesLoaded");
+    Metrics::ScopedLatency queryTimer(queryLatency);
+    TRACE_SPAN("SqliteAccountState_query");
+    size_t loadedBefore = nodes.size();
+
+    assert(stmt);
+    int sqlResult = SQLITE_ERROR;
+    while ((sqlResult = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        NodeHandle nodeHandle;
+        nodeHandle.set6byte(sqlite3_column_int64(stmt, 0));
+
+        NodeSerialized node;
+
+        // Blob node counter
+        const void* data = sqlite3_column_blob(stmt, 1);
+        int size = sqlite3_column_bytes(stmt, 1);
+        if (data && size)
+        {
+            node.mNodeCounter = std::string(static_cast<const char*>(data), size);
+        }
+
+        // blob node
+        data = sqlite3_column_blob(stmt, 2);
+        size = sqlite3_column_bytes(stmt, 2);
+        if (data && size)
+        {
+            node.mNode = std::string(static_cast<const char*>(data), size);
+            nodes.insert(nodes.end(), std::make_pair(nodeHandle, std::move(node)));
+        }
+    }
+
+    errorHandler(sqlResult, "Process sql query", true);
+    nodesLoaded.add(nodes.size() - loadedBefore);
+
+    return sqlResult == SQLITE_DONE;
+}
+
+bool SqliteAccountState::processSqlQueryNodeViews(sqlite3_stmt* stmt, std::vector<NodeView>& nodes)
+{
+    static auto& queryLatency = Metrics::registry().histogram("SqliteAccountState_queryViews");
+    Metrics::ScopedLatency queryTimer(queryLatency);
+    TRACE_SPAN("SqliteAccountState_queryViews");
+
+    assert(stmt);
+    int sqlResult = SQLITE_ERROR;
+    while ((sqlResult = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        NodeView view;
+        view.mHandle.set6byte(sqlite3_column_int64(stmt, 0));
+
+        const unsigned char* name = sqlite3_column_text(stmt, 1);
+        if (name)
+        {
+            view.mName.assign(reinterpret_cast<const char*>(name), sqlite3_column_bytes(stmt, 1));
+        }
+
+        view.mType = static_cast<nodetype_t>(sqlite3_column_int(stmt, 2));
+        view.mSize = sqlite3_column_int64(stmt, 3);
+        view.mCtime = sqlite3_column_int64(stmt, 4);
+        view.mMtime = sqlite3_column_int64(stmt, 5);
+        view.mFav = sqlite3_column_int(stmt, 6) != 0;
+        view.mLabel = sqlite3_column_int(stmt, 7);
+        nodes.push_back(std::move(view));
+    }
+
+    errorHandler(sqlResult, "Process sql query (views)", true);
+
+    return sqlResult == SQLITE_DONE;
+}
+
+bool SqliteAccountState::remove(NodeHandle nodehandle)
+{
+    if (!db)
+    {
+        return false;
+    }
+
+    checkTransaction();
+
+    // prepared once: removing a subtree (or a purge of versions) deletes many nodes in a row
+    int sqlResult = SQLITE_OK;
+    if (!mStmtDelNode)
+    {
+        sqlResult = sqlite3_prepare_v2(db, "DELETE FROM nodes WHERE nodehandle = ?", -1, &mStmtDelNode, NULL);
+    }
+
+    if (sqlResult == SQLITE_OK &&
+        (sqlResult = sqlite3_bind_int64(mStmtDelNode, 1, nodehandle.as8byte())) == SQLITE_OK)
+    {
+        sqlResult = sqlite3_step(mStmtDelNode);
+        if (sqlResult == SQLITE_DONE)
+        {
+            sqlResult = SQLITE_OK;
+        }
+    }
+
+    errorHandler(sqlResult, "Delete node", false);
+    sqlite3_reset(mStmtDelNode);
+
+    removeNodeName(nodehandle);
+    removeNodeTags(nodehandle);
+    removeNodeDescription(nodehandle);
+    removeNodePath(nodehandle);
+
+    return sqlResult == SQLITE_OK;
+}
+
+bool SqliteAccountState::removeNodes()
+{
+    if (!db)
+    {
+        return false;
+    }
+
+    checkTransaction();
+
+    int sqlResult = sqlite3_exec(db, "DELETE FROM nodes", 0, 0, NULL);
+    errorHandler(sqlResult, "Delete nodes", false);
+
+    if (mHasNameIndex)
+    {
+        sqlResult = sqlite3_exec(db, "DELETE FROM nodesname", 0, 0, NULL);
+        errorHandler(sqlResult, "Delete node names", false);
+    }
+
+    if (mHasTagIndex)
+    {
+        sqlResult = sqlite3_exec(db, "DELETE FROM nodetags", 0, 0, NULL);
+        errorHandler(sqlResult, "Delete node tags", false);
+    }
+
+    if (mHasDescriptionIndex)
+    {
+        sqlResult = sqlite3_exec(db, "DELETE FROM nodesdescription", 0, 0, NULL);
+        errorHandler(sqlResult, "Delete node descriptions", false);
+    }
+
+    if (mHasAncestryIndex)
+    {
+        sqlResult = sqlite3_exec(db, "DELETE FROM nodepaths", 0, 0, NULL);
+        errorHandler(sqlResult, "Delete node paths", false);
+    }
+
+    return sqlResult == SQLITE_OK;
+}
+
+void SqliteAccountState::updateCounter(NodeHandle nodeHandle, const std::string& nodeCounterBlob)
+{
+    if (!db)
+    {
+        return;
+    }
+
+    checkTransaction();
+
+    int sqlResult = SQLITE_OK;
+    if (!mStmtUpdateNode)
+    {
+        sqlResult = sqlite3_prepare_v2(db, "UPDATE nodes SET counter = ?  WHERE nodehandle = ?", -1, &mStmtUpdateNode, NULL);
+    }
+
+    if (sqlResult == SQLITE_OK)
+    {
+        if ((sqlResult = sqlite3_bind_blob(mStmtUpdateNode, 1, nodeCounterBlob.data(), static_cast<int>(nodeCounterBlob.size()), SQLITE_STATIC)) == SQLITE_OK)
+        {
+            if ((sqlResult = sqlite3_bind_int64(mStmtUpdateNode, 2, nodeHandle.as8byte())) == SQLITE_OK)
+            {
+                sqlResult = sqlite3_step(mStmtUpdateNode);
+            }
+        }
+
+    }
+
+    errorHandler(sqlResult, "Update counter", false);
+
+    sqlite3_reset(mStmtUpdateNode);
+}
+
+void SqliteAccountState::updateCounterAndFlags(NodeHandle nodeHandle, uint64_t flags, const std::string& nodeCounterBlob)
+{
+    if (!db)
+    {
+        return;
+    }
+
+    checkTransaction();
+
+    int sqlResult = SQLITE_OK;
+    if (!mStmtUpdateNodeAndFlags)
+    {
+        sqlResult = sqlite3_prepare_v2(db, "UPDATE nodes SET counter = ?, flags = ? WHERE nodehandle = ?", -1, &mStmtUpdateNodeAndFlags, NULL);
+    }
+
+    if (sqlResult == SQLITE_OK)
+    {
+        if ((sqlResult = sqlite3_bind_blob(mStmtUpdateNodeAndFlags, 1, nodeCounterBlob.data(), static_cast<int>(nodeCounterBlob.size()), SQLITE_STATIC)) == SQLITE_OK)
+        {
+            if ((sqlResult = sqlite3_bind_int64(mStmtUpdateNodeAndFlags, 2, flags)) == SQLITE_OK)
+            {
+                if ((sqlResult = sqlite3_bind_int64(mStmtUpdateNodeAndFlags, 3, nodeHandle.as8byte())) == SQLITE_OK)
+                {
+                    sqlResult = sqlite3_step(mStmtUpdateNodeAndFlags);
+                }
+            }
+        }
+    }
+
+    errorHandler(sqlResult, "Update counter and flags", false);
+
+    sqlite3_reset(mStmtUpdateNodeAndFlags);
+}
+
+void SqliteAccountState::createIndexes()
+{
+    if (!db)
+    {
+        return;
+    }
+    // Create index for column that is not primary key (which already has an index by default)
+    std::string sql = "CREATE INDEX IF NOT EXISTS parenthandleindex on nodes (parenthandle)";
+    int result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
+    {
+        LOG_err << "Data base error while creating index (parenthandleindex): " << sqlite3_errmsg(db);
+    }
+
+    sql = "CREATE INDEX IF NOT EXISTS fingerprintindex on nodes (fingerprint)";
+    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
+    {
+        LOG_err << "Data base error while creating index (fingerprintindex): " << sqlite3_errmsg(db);
+    }
+
+#if defined( __ANDROID__) || defined(USE_IOS)
+    sql = "CREATE INDEX IF NOT EXISTS origFingerprintindex on nodes (origFingerprint)";
+    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
+    {
+        LOG_err << "Data base error while creating index (origFingerprintindex): " << sqlite3_errmsg(db);
+    }
+#endif
+
+    sql = "CREATE INDEX IF NOT EXISTS shareindex on nodes (share)";
+    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
+    {
+        LOG_err << "Data base error while creating index (shareindex): " << sqlite3_errmsg(db);
+    }
+
+    sql = "CREATE INDEX IF NOT EXISTS favindex on nodes (fav)";
+    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
+    {
+        LOG_err << "Data base error while creating index (favindex): " << sqlite3_errmsg(db);
+    }
+
+    sql = "CREATE INDEX IF NOT EXISTS ctimeindex on nodes (ctime)";
+    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
+    {
+        LOG_err << "Data base error while creating index (ctimeindex): " << sqlite3_errmsg(db);
+    }
+
+    // 'mimetype' is a virtual column, but its index stores the value computed when the node is
+    // written, so category look-ups don't call getmimetype() per row. Rows come out ordered by
+    // ctime for a given category (timelines), and flags can be checked without reading the row
+    sql = "CREATE INDEX IF NOT EXISTS mimetypeindex on nodes (mimetype, ctime, flags)";
+    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
+    {
+        LOG_err << "Data base error while creating index (mimetypeindex): " << sqlite3_errmsg(db);
+    }
+
+    // Previous children indexes sorted the name with the NATURALNOCASE collation, called for
+    // every comparison. They are replaced by the ones below
+    static const std::vector<std::string> legacyChildrenIndexes{
+        "childrennameindex", "childrensizeindex", "childrenctimeindex",
+        "childrenmtimeindex", "childrenlabelindex", "childrenfavindex"};
+
+    for (const auto& indexName : legacyChildrenIndexes)
+    {
+        sql = "DROP INDEX IF EXISTS " + indexName;
+        result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+        if (result)
+        {
+            LOG_err << "Data base error while dropping index (" << indexName << "): " << sqlite3_errmsg(db);
+        }
+    }
+
+    // Keyset paging of children (see OrderByClause::getKeysetOrder()): one index per sort attribute
+    // after the equality terms. For a given type, it's scanned forward for ASC and backwards for DESC
+    // (fav and label sort the attribute in the opposite direction than the name and the nodehandle).
+    // 'namesortkey' is a virtual column, but the indexes store the key computed when the node is
+    // written, so sorted pages are plain index scans comparing blobs
+    static const std::vector<std::pair<std::string, std::string>> childrenIndexes{
+        {"childrennamekeyindex", ""},
+        {"childrensizekeyindex", "size, "},
+        {"childrenctimekeyindex", "ctime, "},
+        {"childrenmtimekeyindex", "mtime, "},
+        {"childrenlabelkeyindex", "label DESC, "},
+        {"childrenfavkeyindex", "fav DESC, "}};
+
+    for (const auto& [indexName, attribute] : childrenIndexes)
+    {
+        sql = "CREATE INDEX IF NOT EXISTS " + indexName + " on nodes (parenthandle, type, " + attribute +
+              "namesortkey, nodehandle)";
+        result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+        if (result)
+        {
+            LOG_err << "Data base error while creating index (" << indexName << "): " << sqlite3_errmsg(db);
+        }
+    }
+}
+
+std::string SqliteAccountState::tagCondition(int sqlParamIndex) const
+{
+    // the size of the tag is bound at 'sqlParamIndex' and the tag itself at the next one
+    const std::string sizeParam = "?" + std::to_string(sqlParamIndex);
+    const std::string tagParam = "?" + std::to_string(sqlParamIndex + 1);
+    if (mHasTagIndex)
+    {
+        return "(" + sizeParam + " = 0 OR nodehandle IN (SELECT nodehandle FROM nodetags WHERE tag = " + tagParam + "))";
+    }
+
+    return "(" + sizeParam + " = 0 OR matchTag(" + tagParam + ", tags))";
+}
+
+std::string SqliteAccountState::mimetypeCondition(const std::string& column, int sqlParamIndex)
+{
+    const std::string param = "?" + std::to_string(sqlParamIndex);
+    return "((" + param + " = " + std::to_string(MIME_TYPE_ALL_DOCS) +
+                " AND " + column + " IN (" + std::to_string(MIME_TYPE_DOCUMENT) +
+                                       ',' + std::to_string(MIME_TYPE_PDF) +
+                                       ',' + std::to_string(MIME_TYPE_PRESENTATION) +
+                                       ',' + std::to_string(MIME_TYPE_SPREADSHEET) + "))"
+           " OR " + column + " = " + param + ")";
+}
+
+void SqliteAccountState::remove()
+{
+    if (mReaderPool)
+    {
+        mReaderPool->close();
+        mReaderPool.reset();
+    }
+
+    finalise();
+
+    SqliteDbTable::remove();
+}
+
+void SqliteAccountState::finalise()
+{
+    sqlite3_finalize(mStmtPutNode);
+    mStmtPutNode = nullptr;
+
+    sqlite3_finalize(mStmtUpdateNode);
+    mStmtUpdateNode = nullptr;
+
+    sqlite3_finalize(mStmtUpdateNodeAndFlags);
+    mStmtUpdateNodeAndFlags = nullptr;
+
+    sqlite3_finalize(mStmtTypeAndSizeNode);
+    mStmtTypeAndSizeNode = nullptr;
+
+    sqlite3_finalize(mStmtGetNode);
+    mStmtGetNode = nullptr;
+
+    sqlite3_finalize(mStmtChildren);
+    mStmtChildren = nullptr;
+
+    sqlite3_finalize(mStmtChildrenFromType);
+    mStmtChildrenFromType = nullptr;
+
+    sqlite3_finalize(mStmtNumChildren);
+    mStmtNumChildren = nullptr;
+
+    sqlite3_finalize(mStmtRootNodes);
+    mStmtRootNodes = nullptr;
+
+    sqlite3_finalize(mStmtNodesWithSharesOrLink);
+    mStmtNodesWithSharesOrLink = nullptr;
+
+    sqlite3_finalize(mStmtNumNodes);
+    mStmtNumNodes = nullptr;
+
+    sqlite3_finalize(mStmtPutNodeName);
+    mStmtPutNodeName = nullptr;
+
+    sqlite3_finalize(mStmtDelNodeName);
+    mStmtDelNodeName = nullptr;
+
+    sqlite3_finalize(mStmtPutNodeTag);
+    mStmtPutNodeTag = nullptr;
+
+    sqlite3_finalize(mStmtDelNodeTags);
+    mStmtDelNodeTags = nullptr;
+
+    sqlite3_finalize(mStmtPutNodeDescription);
+    mStmtPutNodeDescription = nullptr;
+
+    sqlite3_finalize(mStmtDelNodeDescription);
+    mStmtDelNodeDescription = nullptr;
+
+    sqlite3_finalize(mStmtNodeByNameIndexed);
+    mStmtNodeByNameIndexed = nullptr;
+
+    sqlite3_finalize(mStmtGetNodePath);
+    mStmtGetNodePath = nullptr;
+
+    sqlite3_finalize(mStmtPutNodePath);
+    mStmtPutNodePath = nullptr;
+
+    sqlite3_finalize(mStmtRebaseNodePaths);
+    mStmtRebaseNodePaths = nullptr;
+
+    sqlite3_finalize(mStmtDelNodePath);
+    mStmtDelNodePath = nullptr;
+
+    sqlite3_finalize(mStmtDelNode);
+    mStmtDelNode = nullptr;
+
+    sqlite3_finalize(mStmtNodeByMimeTypeInSubtree);
+    mStmtNodeByMimeTypeInSubtree = nullptr;
+
+    sqlite3_finalize(mStmtVersions);
+    mStmtVersions = nullptr;
+
+    sqlite3_finalize(mStmtPutChatGrant);
+    mStmtPutChatGrant = nullptr;
+
+    sqlite3_finalize(mStmtDelChatGrant);
+    mStmtDelChatGrant = nullptr;
+
+    sqlite3_finalize(mStmtChatGrants);
+    mStmtChatGrants = nullptr;
+
+    for (auto& s : mStmtGetChildren)
+    {
+        sqlite3_finalize(s.second);
+    }
+    mStmtGetChildren.clear();
+
+    for (auto& s : mStmtGetChildrenViews)
+    {
+        sqlite3_finalize(s.second);
+    }
+    mStmtGetChildrenViews.clear();
+
+    for (auto& s : mStmtSearchNodes)
+    {
+        sqlite3_finalize(s.second);
+    }
+    mStmtSearchNodes.clear();
+
+    sqlite3_finalize(mStmtNodeByName);
+    mStmtNodeByName = nullptr;
+
+    sqlite3_finalize(mStmtNodeByNameNoRecursive);
+    mStmtNodeByNameNoRecursive = nullptr;
+
+    sqlite3_finalize(mStmtInShareOutShareByName);
+    mStmtInShareOutShareByName = nullptr;
+
+    sqlite3_finalize(mStmtNodeByMimeType);
+    mStmtNodeByMimeType = nullptr;
+
+    sqlite3_finalize(mStmtNodesByFp);
+    mStmtNodesByFp = nullptr;
+
+    sqlite3_finalize(mStmtNodeByFp);
+    mStmtNodeByFp = nullptr;
+
+    sqlite3_finalize(mStmtNodeByOrigFp);
+    mStmtNodeByOrigFp = nullptr;
+
+    sqlite3_finalize(mStmtChildNode);
+    mStmtChildNode = nullptr;
+
+    sqlite3_finalize(mStmtIsAncestor);
+    mStmtIsAncestor = nullptr;
+
+    sqlite3_finalize(mStmtNumChild);
+    mStmtNumChild = nullptr;
+
+    sqlite3_finalize(mStmtRecents);
+    mStmtRecents = nullptr;
+
+    sqlite3_finalize(mStmtFavourites);
+    mStmtFavourites = nullptr;
+}
+
+bool SqliteAccountState::put(Node *node)
+{
+    if (!db)
+    {
+        return false;
+    }
+
+    checkTransaction();
+
+    int sqlResult = preparePutNode();
+    if (sqlResult != SQLITE_OK)
+    {
+        errorHandler(sqlResult, "Put node", false);
+        return false;
+    }
+
+    string nodeSerialized;
+    return putNode(node, nodeSerialized);
+}
+
+bool SqliteAccountState::putNodes(const std::vector<Node*>& nodes)
+{
+    if (!db)
+    {
+        return false;
+    }
+
+    // all of them are written in the same transaction and with the same statement
     checkTransaction();
 
-    int sqlResult = sqlite3_exec(db, "DELETE FROM nodes", 0, 0, NULL);
-    errorHandler(sqlResult, "Delete nodes", false);
+    int sqlResult = preparePutNode();
+    if (sqlResult != SQLITE_OK)
+    {
+        errorHandler(sqlResult, "Put nodes", false);
+        return false;
+    }
+
+    bool result = true;
+    string nodeSerialized;
+    for (Node* node : nodes)
+    {
+        result = putNode(node, nodeSerialized) && result;
+    }
+
+    return result;
+}
+
+int SqliteAccountState::preparePutNode()
+{
+    if (mStmtPutNode)
+    {
+        return SQLITE_OK;
+    }
+
+    return sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO nodes (nodehandle, parenthandle, "
+                                  "name, fingerprint, origFingerprint, type, size, share, fav, ctime, mtime, flags, counter, node, label, description, tags) "
+                                  "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)", -1, &mStmtPutNode, NULL);
+}
+
+bool SqliteAccountState::putNode(Node* node, string& nodeSerialized)
+{
+    assert(mStmtPutNode);
+
+    nodeSerialized.clear();
+    node->serialize(&nodeSerialized);
+    assert(nodeSerialized.size());
+
+    sqlite3_bind_int64(mStmtPutNode, 1, node->nodehandle);
+    sqlite3_bind_int64(mStmtPutNode, 2, node->parenthandle);
+
+    std::string name = node->displayname();
+    sqlite3_bind_text(mStmtPutNode, 3, name.c_str(), static_cast<int>(name.length()), SQLITE_STATIC);
+
+    string fp;
+    node->FileFingerprint::serialize(&fp);
+    sqlite3_bind_blob(mStmtPutNode, 4, fp.data(), static_cast<int>(fp.size()), SQLITE_STATIC);
+
+    std::string origFingerprint;
+    attr_map::const_iterator attrIt = node->attrs.map.find(MAKENAMEID2('c', '0'));
+    if (attrIt != node->attrs.map.end())
+    {
+       origFingerprint = attrIt->second;
+    }
+    sqlite3_bind_blob(mStmtPutNode, 5, origFingerprint.data(), static_cast<int>(origFingerprint.size()), SQLITE_STATIC);
+
+    sqlite3_bind_int(mStmtPutNode, 6, node->type);
+    sqlite3_bind_int64(mStmtPutNode, 7, node->size);
+
+    int shareType = node->getShareType();
+    sqlite3_bind_int(mStmtPutNode, 8, shareType);
+
+    // node->attrstring has value => node is encrypted
+    static const nameid favId = AttrMap::string2nameid("fav");
+    auto favIt = node->attrs.map.find(favId);
+    bool fav = (favIt != node->attrs.map.end() && favIt->second == "1"); // test 'fav' attr value (only "1" is valid)
+    sqlite3_bind_int(mStmtPutNode, 9, fav);
+    sqlite3_bind_int64(mStmtPutNode, 10, node->ctime);
+    sqlite3_bind_int64(mStmtPutNode, 11, node->mtime);
+    sqlite3_bind_int64(mStmtPutNode, 12, node->getDBFlags());
+    std::string nodeCountersBlob = node->getCounter().serialize();
+    sqlite3_bind_blob(mStmtPutNode, 13, nodeCountersBlob.data(), static_cast<int>(nodeCountersBlob.size()), SQLITE_STATIC);
+    sqlite3_bind_blob(mStmtPutNode, 14, nodeSerialized.data(), static_cast<int>(nodeSerialized.size()), SQLITE_STATIC);
+
+    static nameid labelId = AttrMap::string2nameid("lbl");
+    auto labelIt = node->attrs.map.find(labelId);
+    int label = (labelIt == node->attrs.map.end()) ? LBL_UNKNOWN : std::atoi(labelIt->second.c_str());
+    sqlite3_bind_int(mStmtPutNode, 15, label);
+
+    static const nameid descriptionId = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_DESCRIPTION);
+    const std::string* description = nullptr;
+    if (auto descriptionIt = node->attrs.map.find(descriptionId);
+        descriptionIt != node->attrs.map.end())
+    {
+        description = &descriptionIt->second;
+        sqlite3_bind_text(mStmtPutNode,
+                          16,
+                          description->c_str(),
+                          static_cast<int>(description->length()),
+                          SQLITE_STATIC);
+    }
+    else
+    {
+        sqlite3_bind_null(mStmtPutNode, 16);
+    }
+
+    static const nameid tagId = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_TAGS);
+    const std::string* tags = nullptr;
+    if (auto tagIt = node->attrs.map.find(tagId); tagIt != node->attrs.map.end())
+    {
+        tags = &tagIt->second;
+        const std::string& tag = tagIt->second;
+        sqlite3_bind_text(mStmtPutNode,
+                          17,
+                          tag.c_str(),
+                          static_cast<int>(tag.length()),
+                          SQLITE_STATIC);
+    }
+    else
+    {
+        sqlite3_bind_null(mStmtPutNode, 17);
+    }
+
+    int sqlResult = sqlite3_step(mStmtPutNode);
+
+    errorHandler(sqlResult, "Put node", false);
+
+    sqlite3_reset(mStmtPutNode);
+
+    if (sqlResult == SQLITE_DONE)
+    {
+        putNodeName(node->nodehandle, name);
+        putNodeTags(node->nodehandle, tags);
+        putNodeDescription(node->nodehandle, description);
+        putNodePath(node->nodehandle, node->parenthandle);
+    }
+
+    return sqlResult == SQLITE_DONE;
+}
+
+void SqliteAccountState::putNodeName(handle nodehandle, const std::string& name)
+{
+    if (!mHasNameIndex)
+    {
+        return;
+    }
+
+    int sqlResult = SQLITE_OK;
+    if (!mStmtPutNodeName)
+    {
+        sqlResult = sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO nodesname (rowid, name) VALUES (?, ?)", -1, &mStmtPutNodeName, NULL);
+    }
+
+    if (sqlResult == SQLITE_OK &&
+        (sqlResult = sqlite3_bind_int64(mStmtPutNodeName, 1, nodehandle)) == SQLITE_OK &&
+        (sqlResult = sqlite3_bind_text(mStmtPutNodeName, 2, name.c_str(), static_cast<int>(name.length()), SQLITE_STATIC)) == SQLITE_OK)
+    {
+        sqlResult = sqlite3_step(mStmtPutNodeName);
+    }
+
+    errorHandler(sqlResult, "Put node name", false);
+
+    sqlite3_reset(mStmtPutNodeName);
+}
+
+void SqliteAccountState::removeNodeName(NodeHandle nodehandle)
+{
+    if (!mHasNameIndex)
+    {
+        return;
+    }
+
+    int sqlResult = SQLITE_OK;
+    if (!mStmtDelNodeName)
+    {
+        sqlResult = sqlite3_prepare_v2(db, "DELETE FROM nodesname WHERE rowid = ?", -1, &mStmtDelNodeName, NULL);
+    }
+
+    if (sqlResult == SQLITE_OK &&
+        (sqlResult = sqlite3_bind_int64(mStmtDelNodeName, 1, nodehandle.as8byte())) == SQLITE_OK)
+    {
+        sqlResult = sqlite3_step(mStmtDelNodeName);
+    }
+
+    errorHandler(sqlResult, "Delete node name", false);
+
+    sqlite3_reset(mStmtDelNodeName);
+}
+
+bool SqliteAccountState::openNameIndex(sqlite3* db)
+{
+    return openTrigramIndex(db, "nodesname", "name");
+}
+
+bool SqliteAccountState::openDescriptionIndex(sqlite3* db)
+{
+    return openTrigramIndex(db, "nodesdescription", "description");
+}
+
+bool SqliteAccountState::openTrigramIndex(sqlite3* db, const std::string& table, const std::string& column)
+{
+    auto count = [db](const std::string& query, int64_t& result)
+    {
+        return sqlite_query_count(db, query.c_str(), result);
+    };
+
+    int64_t existing = 0;
+    count("SELECT count(*) FROM sqlite_master WHERE type = 'table' AND name = '" + table + "'", existing);
+
+    // requires SQLite built with FTS5 (3.34 or newer for the trigram tokenizer)
+    int64_t numValues = 0;
+    std::string sql = "CREATE VIRTUAL TABLE IF NOT EXISTS " + table + " USING fts5(" + column + ", tokenize = 'trigram')";
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK
+        || !count("SELECT count(*) FROM " + table, numValues))
+    {
+        LOG_warn << "Index " << table << " not available, searches by " << column << " won't use it: " << sqlite3_errmsg(db);
+        return false;
+    }
+
+    // The index is rebuilt when it's new, or when the DB has been written by a version
+    // that doesn't maintain it (detected by the number of rows, so it's a best effort)
+    int64_t numNodes = 0;
+    if (!count("SELECT count(*) FROM nodes WHERE " + column + " IS NOT NULL", numNodes))
+    {
+        return false;
+    }
+
+    if (existing && numValues == numNodes)
+    {
+        return true;
+    }
+
+    LOG_debug << "Building index " << table << " for " << numNodes << " nodes";
+    if (sqlite3_exec(db, "BEGIN", nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        return false;
+    }
+
+    std::string deleteAll = "DELETE FROM " + table;
+    std::string insertAll = "INSERT INTO " + table + " (rowid, " + column + ") SELECT nodehandle, " + column +
+                            " FROM nodes WHERE " + column + " IS NOT NULL";
+    if (sqlite3_exec(db, deleteAll.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK
+        || sqlite3_exec(db, insertAll.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        LOG_err << "Failed to build index " << table << ": " << sqlite3_errmsg(db);
+        sqlite3_exec(db, "ROLLBACK", nullptr, nullptr, nullptr);
+        return false;
+    }
+
+    return sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+bool SqliteAccountState::openTagIndex(sqlite3* db)
+{
+    auto count = [db](const char* query, int64_t& result)
+    {
+        return sqlite_query_count(db, query, result);
+    };
+
+    int64_t existing = 0;
+    count("SELECT count(*) FROM sqlite_master WHERE type = 'table' AND name = 'nodetags'", existing);
+
+    if (sqlite3_exec(db, "CREATE TABLE IF NOT EXISTS nodetags (tag text NOT NULL, nodehandle int64 NOT NULL, "
+                         "PRIMARY KEY (tag, nodehandle)) WITHOUT ROWID", nullptr, nullptr, nullptr) != SQLITE_OK
+        || sqlite3_exec(db, "CREATE INDEX IF NOT EXISTS nodetagshandleindex on nodetags (nodehandle)", nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        LOG_warn << "Tag index not available, searches by tag won't use it: " << sqlite3_errmsg(db);
+        return false;
+    }
+
+    // Rebuilt like the name index: when it's new, or when the number of tagged nodes
+    // doesn't match (written by a version that doesn't maintain it)
+    int64_t numTagged = 0;
+    int64_t numNodes = 0;
+    if (!count("SELECT count(DISTINCT nodehandle) FROM nodetags", numTagged)
+        || !count("SELECT count(*) FROM nodes WHERE tags IS NOT NULL AND tags != ''", numNodes))
+    {
+        return false;
+    }
+
+    if (existing && numTagged == numNodes)
+    {
+        return true;
+    }
+
+    LOG_debug << "Building tag index for " << numNodes << " nodes";
+    if (sqlite3_exec(db, "BEGIN", nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        return false;
+    }
+
+    sqlite3_stmt* select = nullptr;
+    sqlite3_stmt* insert = nullptr;
+    bool result = sqlite3_exec(db, "DELETE FROM nodetags", nullptr, nullptr, nullptr) == SQLITE_OK
+                  && sqlite3_prepare_v2(db, "SELECT nodehandle, tags FROM nodes WHERE tags IS NOT NULL AND tags != ''", -1, &select, nullptr) == SQLITE_OK
+                  && sqlite3_prepare_v2(db, "INSERT OR IGNORE INTO nodetags (tag, nodehandle) VALUES (?, ?)", -1, &insert, nullptr) == SQLITE_OK;
+
+    int sqlResult = SQLITE_OK;
+    while (result && (sqlResult = sqlite3_step(select)) == SQLITE_ROW)
+    {
+        handle nodehandle = sqlite3_column_int64(select, 0);
+        std::string tags{reinterpret_cast<const char*>(sqlite3_column_text(select, 1))};
+        for (const std::string& tag : splitString(tags, MegaClient::TAG_DELIMITER))
+        {
+            std::string folded = foldCaseUtf8(tag);
+            result = sqlite3_bind_text(insert, 1, folded.c_str(), static_cast<int>(folded.size()), SQLITE_STATIC) == SQLITE_OK
+                     && sqlite3_bind_int64(insert, 2, nodehandle) == SQLITE_OK
+                     && sqlite3_step(insert) == SQLITE_DONE
+                     && sqlite3_reset(insert) == SQLITE_OK;
+            if (!result)
+            {
+                break;
+            }
+        }
+    }
+    result = result && sqlResult == SQLITE_DONE;
+
+    sqlite3_finalize(select);
+    sqlite3_finalize(insert);
 
-    return sqlResult == SQLITE_OK;
+    if (!result)
+    {
+        LOG_err << "Failed to build tag index: " << sqlite3_errmsg(db);
+        sqlite3_exec(db, "ROLLBACK", nullptr, nullptr, nullptr);
+        return false;
+    }
+
+    return sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr) == SQLITE_OK;
 }
 
-void SqliteAccountState::updateCounter(NodeHandle nodeHandle, const std::string& nodeCounterBlob)
+void SqliteAccountState::putNodeTags(handle nodehandle, const std::string* tags)
 {
-    if (!db)
+    if (!mHasTagIndex)
     {
         return;
     }
 
-    checkTransaction();
+    // the previous tags are replaced (usually, just one of them has changed)
+    removeNodeTags(NodeHandle().set6byte(nodehandle));
+    if (!tags || tags->empty())
+    {
+        return;
+    }
 
     int sqlResult = SQLITE_OK;
-    if (!mStmtUpdateNode)
+    if (!mStmtPutNodeTag)
     {
-        sqlResult = sqlite3_prepare_v2(db, "UPDATE nodes SET counter = ?  WHERE nodehandle = ?", -1, &mStmtUpdateNode, NULL);
+        sqlResult = sqlite3_prepare_v2(db, "INSERT OR IGNORE INTO nodetags (tag, nodehandle) VALUES (?, ?)", -1, &mStmtPutNodeTag, NULL);
     }
 
-    if (sqlResult == SQLITE_OK)
+    for (const std::string& tag : splitString(*tags, MegaClient::TAG_DELIMITER))
     {
-        if ((sqlResult = sqlite3_bind_blob(mStmtUpdateNode, 1, nodeCounterBlob.data(), static_cast<int>(nodeCounterBlob.size()), SQLITE_STATIC)) == SQLITE_OK)
+        if (sqlResult != SQLITE_OK)
         {
-            if ((sqlResult = sqlite3_bind_int64(mStmtUpdateNode, 2, nodeHandle.as8byte())) == SQLITE_OK)
-            {
-                sqlResult = sqlite3_step(mStmtUpdateNode);
-            }
+            break;
         }
 
-    }
+        std::string folded = foldCaseUtf8(tag);
+        if ((sqlResult = sqlite3_bind_text(mStmtPutNodeTag, 1, folded.c_str(), static_cast<int>(folded.size()), SQLITE_STATIC)) == SQLITE_OK &&
+            (sqlResult = sqlite3_bind_int64(mStmtPutNodeTag, 2, nodehandle)) == SQLITE_OK &&
+            (sqlResult = sqlite3_step(mStmtPutNodeTag)) == SQLITE_DONE)
+        {
+            sqlResult = SQLITE_OK;
+        }
 
-    errorHandler(sqlResult, "Update counter", false);
+        sqlite3_reset(mStmtPutNodeTag);
+    }
 
-    sqlite3_reset(mStmtUpdateNode);
+    errorHandler(sqlResult, "Put node tags", false);
 }
 
-void SqliteAccountState::updateCounterAndFlags(NodeHandle nodeHandle, uint64_t flags, const std::string& nodeCounterBlob)
+void SqliteAccountState::removeNodeTags(NodeHandle nodehandle)
 {
-    if (!db)
+    if (!mHasTagIndex)
     {
         return;
     }
 
-    checkTransaction();
-
     int sqlResult = SQLITE_OK;
-    if (!mStmtUpdateNodeAndFlags)
+    if (!mStmtDelNodeTags)
     {
-        sqlResult = sqlite3_prepare_v2(db, "UPDATE nodes SET counter = ?, flags = ? WHERE nodehandle = ?", -1, &mStmtUpdateNodeAndFlags, NULL);
+        sqlResult = sqlite3_prepare_v2(db, "DELETE FROM nodetags WHERE nodehandle = ?", -1, &mStmtDelNodeTags, NULL);
     }
 
-    if (sqlResult == SQLITE_OK)
+    if (sqlResult == SQLITE_OK &&
+        (sqlResult = sqlite3_bind_int64(mStmtDelNodeTags, 1, nodehandle.as8byte())) == SQLITE_OK)
     {
-        if ((sqlResult = sqlite3_bind_blob(mStmtUpdateNodeAndFlags, 1, nodeCounterBlob.data(), static_cast<int>(nodeCounterBlob.size()), SQLITE_STATIC)) == SQLITE_OK)
-        {
-            if ((sqlResult = sqlite3_bind_int64(mStmtUpdateNodeAndFlags, 2, flags)) == SQLITE_OK)
-            {
-                if ((sqlResult = sqlite3_bind_int64(mStmtUpdateNodeAndFlags, 3, nodeHandle.as8byte())) == SQLITE_OK)
-                {
-                    sqlResult = sqlite3_step(mStmtUpdateNodeAndFlags);
-                }
-            }
-        }
+        sqlResult = sqlite3_step(mStmtDelNodeTags);
     }
 
-    errorHandler(sqlResult, "Update counter and flags", false);
+    errorHandler(sqlResult, "Delete node tags", false);
 
-    sqlite3_reset(mStmtUpdateNodeAndFlags);
+    sqlite3_reset(mStmtDelNodeTags);
 }
 
-void SqliteAccountState::createIndexes()
+void SqliteAccountState::putNodeDescription(handle nodehandle, const std::string* description)
 {
-    if (!db)
+    if (!mHasDescriptionIndex)
     {
         return;
     }
-    // Create index for column that is not primary key (which already has an index by default)
-    std::string sql = "CREATE INDEX IF NOT EXISTS parenthandleindex on nodes (parenthandle)";
-    int result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
-    if (result)
+
+    if (!description)
     {
-        LOG_err << "Data base error while creating index (parenthandleindex): " << sqlite3_errmsg(db);
+        removeNodeDescription(NodeHandle().set6byte(nodehandle));
+        return;
     }
 
-    sql = "CREATE INDEX IF NOT EXISTS fingerprintindex on nodes (fingerprint)";
-    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
-    if (result)
+    int sqlResult = SQLITE_OK;
+    if (!mStmtPutNodeDescription)
     {
-        LOG_err << "Data base error while creating index (fingerprintindex): " << sqlite3_errmsg(db);
+        sqlResult = sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO nodesdescription (rowid, description) VALUES (?, ?)", -1, &mStmtPutNodeDescription, NULL);
     }
 
-#if defined( __ANDROID__) || defined(USE_IOS)
-    sql = "CREATE INDEX IF NOT EXISTS origFingerprintindex on nodes (origFingerprint)";
-    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
-    if (result)
+    if (sqlResult == SQLITE_OK &&
+        (sqlResult = sqlite3_bind_int64(mStmtPutNodeDescription, 1, nodehandle)) == SQLITE_OK &&
+        (sqlResult = sqlite3_bind_text(mStmtPutNodeDescription, 2, description->c_str(), static_cast<int>(description->length()), SQLITE_STATIC)) == SQLITE_OK)
     {
-        LOG_err << "Data base error while creating index (origFingerprintindex): " << sqlite3_errmsg(db);
+        sqlResult = sqlite3_step(mStmtPutNodeDescription);
     }
-#endif
 
-    sql = "CREATE INDEX IF NOT EXISTS shareindex on nodes (share)";
-    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
-    if (result)
+    errorHandler(sqlResult, "Put node description", false);
+
+    sqlite3_reset(mStmtPutNodeDescription);
+}
+
+void SqliteAccountState::removeNodeDescription(NodeHandle nodehandle)
+{
+    if (!mHasDescriptionIndex)
     {
-        LOG_err << "Data base error while creating index (shareindex): " << sqlite3_errmsg(db);
+        return;
     }
 
-    sql = "CREATE INDEX IF NOT EXISTS favindex on nodes (fav)";
-    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
-    if (result)
+    int sqlResult = SQLITE_OK;
+    if (!mStmtDelNodeDescription)
     {
-        LOG_err << "Data base error while creating index (favindex): " << sqlite3_errmsg(db);
+        sqlResult = sqlite3_prepare_v2(db, "DELETE FROM nodesdescription WHERE rowid = ?", -1, &mStmtDelNodeDescription, NULL);
     }
 
-    sql = "CREATE INDEX IF NOT EXISTS ctimeindex on nodes (ctime)";
-    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
-    if (result)
+    if (sqlResult == SQLITE_OK &&
+        (sqlResult = sqlite3_bind_int64(mStmtDelNodeDescription, 1, nodehandle.as8byte())) == SQLITE_OK)
     {
-        LOG_err << "Data base error while creating index (ctimeindex): " << sqlite3_errmsg(db);
+        sqlResult = sqlite3_step(mStmtDelNodeDescription);
     }
-}
 
-void SqliteAccountState::remove()
-{
-    finalise();
+    errorHandler(sqlResult, "Delete node description", false);
 
-    SqliteDbTable::remove();
+    sqlite3_reset(mStmtDelNodeDescription);
 }
 
-void SqliteAccountState::finalise()
+std::string SqliteAccountState::ancestryPathSegment(handle nodehandle)
 {
-    sqlite3_finalize(mStmtPutNode);
-    mStmtPutNode = nullptr;
+    char segment[16];
+    snprintf(segment, sizeof(segment), "%012" PRIX64, static_cast<uint64_t>(nodehandle) & 0xFFFFFFFFFFFF);
+    return segment;
+}
 
-    sqlite3_finalize(mStmtUpdateNode);
-    mStmtUpdateNode = nullptr;
+bool SqliteAccountState::getNodePath(handle nodehandle, std::string& path)
+{
+    int sqlResult = SQLITE_OK;
+    if (!mStmtGetNodePath)
+    {
+        sqlResult = sqlite3_prepare_v2(db, "SELECT path FROM nodepaths WHERE nodehandle = ?", -1, &mStmtGetNodePath, NULL);
+    }
 
-    sqlite3_finalize(mStmtUpdateNodeAndFlags);
-    mStmtUpdateNodeAndFlags = nullptr;
+    bool found = false;
+    if (sqlResult == SQLITE_OK &&
+        (sqlResult = sqlite3_bind_int64(mStmtGetNodePath, 1, nodehandle)) == SQLITE_OK &&
+        (sqlResult = sqlite3_step(mStmtGetNodePath)) == SQLITE_ROW)
+    {
+        const char* data = reinterpret_cast<const char*>(sqlite3_column_text(mStmtGetNodePath, 0));
+        path.assign(data ? data : "", static_cast<size_t>(sqlite3_column_bytes(mStmtGetNodePath, 0)));
+        found = true;
+    }
 
-    sqlite3_finalize(mStmtTypeAndSizeNode);
-    mStmtTypeAndSizeNode = nullptr;
+    if (sqlResult != SQLITE_ROW && sqlResult != SQLITE_DONE)
+    {
+        errorHandler(sqlResult, "Get node path", false);
+    }
 
-    sqlite3_finalize(mStmtGetNode);
-    mStmtGetNode = nullptr;
+    sqlite3_reset(mStmtGetNodePath);
 
-    sqlite3_finalize(mStmtChildren);
-    mStmtChildren = nullptr;
+    return found;
+}
 
-    sqlite3_finalize(mStmtChildrenFromType);
-    mStmtChildrenFromType = nullptr;
+void SqliteAccountState::putNodePath(handle nodehandle, handle parenthandle)
+{
+    if (!mHasAncestryIndex)
+    {
+        return;
+    }
 
-    sqlite3_finalize(mStmtNumChildren);
-    mStmtNumChildren = nullptr;
+    // nodes written before their parent hang from the parent's handle until it's written
+    std::string path;
+    if (parenthandle != UNDEF && !getNodePath(parenthandle, path))
+    {
+        path = ancestryPathSegment(parenthandle);
+    }
+    path += ancestryPathSegment(nodehandle);
 
-    for (auto& s : mStmtGetChildren)
+    std::string oldPath;
+    bool existing = getNodePath(nodehandle, oldPath);
+    if (existing && oldPath == path)
     {
-        sqlite3_finalize(s.second);
+        return;
     }
-    mStmtGetChildren.clear();
 
-    for (auto& s : mStmtSearchNodes)
+    if (!existing)
     {
-        sqlite3_finalize(s.second);
+        // prefix of the descendants written before this node, if any
+        oldPath = ancestryPathSegment(nodehandle);
     }
-    mStmtSearchNodes.clear();
 
-    sqlite3_finalize(mStmtNodeByName);
-    mStmtNodeByName = nullptr;
+    int sqlResult = SQLITE_OK;
+    if (oldPath != path)
+    {
+        if (!mStmtRebaseNodePaths)
+        {
+            sqlResult = sqlite3_prepare_v2(db, "UPDATE nodepaths SET path = ?1 || substr(path, ?2) WHERE path > ?3 AND path < ?3 || '~'", -1, &mStmtRebaseNodePaths, NULL);
+        }
 
-    sqlite3_finalize(mStmtNodeByNameNoRecursive);
-    mStmtNodeByNameNoRecursive = nullptr;
+        if (sqlResult == SQLITE_OK &&
+            (sqlResult = sqlite3_bind_text(mStmtRebaseNodePaths, 1, path.c_str(), static_cast<int>(path.size()), SQLITE_STATIC)) == SQLITE_OK &&
+            (sqlResult = sqlite3_bind_int(mStmtRebaseNodePaths, 2, static_cast<int>(oldPath.size() + 1))) == SQLITE_OK &&
+            (sqlResult = sqlite3_bind_text(mStmtRebaseNodePaths, 3, oldPath.c_str(), static_cast<int>(oldPath.size()), SQLITE_STATIC)) == SQLITE_OK)
+        {
+            sqlResult = sqlite3_step(mStmtRebaseNodePaths);
+        }
 
-    sqlite3_finalize(mStmtInShareOutShareByName);
-    mStmtInShareOutShareByName = nullptr;
+        errorHandler(sqlResult, "Rebase node paths", false);
 
-    sqlite3_finalize(mStmtNodeByMimeType);
-    mStmtNodeByMimeType = nullptr;
+        sqlite3_reset(mStmtRebaseNodePaths);
+    }
 
-    sqlite3_finalize(mStmtNodesByFp);
-    mStmtNodesByFp = nullptr;
+    sqlResult = SQLITE_OK;
+    if (!mStmtPutNodePath)
+    {
+        sqlResult = sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO nodepaths (nodehandle, path) VALUES (?, ?)", -1, &mStmtPutNodePath, NULL);
+    }
 
-    sqlite3_finalize(mStmtNodeByFp);
-    mStmtNodeByFp = nullptr;
+    if (sqlResult == SQLITE_OK &&
+        (sqlResult = sqlite3_bind_int64(mStmtPutNodePath, 1, nodehandle)) == SQLITE_OK &&
+        (sqlResult = sqlite3_bind_text(mStmtPutNodePath, 2, path.c_str(), static_cast<int>(path.size()), SQLITE_STATIC)) == SQLITE_OK)
+    {
+        sqlResult = sqlite3_step(mStmtPutNodePath);
+    }
 
-    sqlite3_finalize(mStmtNodeByOrigFp);
-    mStmtNodeByOrigFp = nullptr;
+    errorHandler(sqlResult, "Put node path", false);
 
-    sqlite3_finalize(mStmtChildNode);
-    mStmtChildNode = nullptr;
+    sqlite3_reset(mStmtPutNodePath);
+}
 
-    sqlite3_finalize(mStmtIsAncestor);
-    mStmtIsAncestor = nullptr;
+void SqliteAccountState::removeNodePath(NodeHandle nodehandle)
+{
+    if (!mHasAncestryIndex)
+    {
+        return;
+    }
 
-    sqlite3_finalize(mStmtNumChild);
-    mStmtNumChild = nullptr;
+    int sqlResult = SQLITE_OK;
+    if (!mStmtDelNodePath)
+    {
+        sqlResult = sqlite3_prepare_v2(db, "DELETE FROM nodepaths WHERE nodehandle = ?", -1, &mStmtDelNodePath, NULL);
+    }
 
-    sqlite3_finalize(mStmtRecents);
-    mStmtRecents = nullptr;
+    if (sqlResult == SQLITE_OK &&
+        (sqlResult = sqlite3_bind_int64(mStmtDelNodePath, 1, nodehandle.as8byte())) == SQLITE_OK)
+    {
+        sqlResult = sqlite3_step(mStmtDelNodePath);
+    }
 
-    sqlite3_finalize(mStmtFavourites);
-    mStmtFavourites = nullptr;
+    errorHandler(sqlResult, "Delete node path", false);
+
+    sqlite3_reset(mStmtDelNodePath);
 }
 
-bool SqliteAccountState::put(Node *node)
+bool SqliteAccountState::openAncestryIndex(sqlite3* db)
 {
-    if (!db)
+    int64_t existing = 0;
+    sqlite_query_count(db, "SELECT count(*) FROM sqlite_master WHERE type = 'table' AND name = 'nodepaths'", existing);
+
+    int64_t numPaths = 0;
+    if (sqlite3_exec(db, "CREATE TABLE IF NOT EXISTS nodepaths (nodehandle INTEGER PRIMARY KEY NOT NULL, path text NOT NULL)", nullptr, nullptr, nullptr) != SQLITE_OK
+        || sqlite3_exec(db, "CREATE INDEX IF NOT EXISTS pathindex on nodepaths (path)", nullptr, nullptr, nullptr) != SQLITE_OK
+        || !sqlite_query_count(db, "SELECT count(*) FROM nodepaths", numPaths))
     {
+        LOG_warn << "Ancestry index not available: " << sqlite3_errmsg(db);
         return false;
     }
 
-    checkTransaction();
-
-    int sqlResult = SQLITE_OK;
-    if (!mStmtPutNode)
+    // Same as the name index: rebuilt when it's new or it doesn't match 'nodes'
+    int64_t numNodes = 0;
+    if (!sqlite_query_count(db, "SELECT count(*) FROM nodes", numNodes))
     {
-        sqlResult = sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO nodes (nodehandle, parenthandle, "
-                                           "name, fingerprint, origFingerprint, type, size, share, fav, ctime, mtime, flags, counter, node, label, description, tags) "
-                                           "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)", -1, &mStmtPutNode, NULL);
+        return false;
     }
 
-    if (sqlResult == SQLITE_OK)
+    if (existing && numPaths == numNodes)
     {
-        string nodeSerialized;
-        node->serialize(&nodeSerialized);
-        assert(nodeSerialized.size());
-
-        sqlite3_bind_int64(mStmtPutNode, 1, node->nodehandle);
-        sqlite3_bind_int64(mStmtPutNode, 2, node->parenthandle);
-
-        std::string name = node->displayname();
-        sqlite3_bind_text(mStmtPutNode, 3, name.c_str(), static_cast<int>(name.length()), SQLITE_STATIC);
-
-        string fp;
-        node->FileFingerprint::serialize(&fp);
-        sqlite3_bind_blob(mStmtPutNode, 4, fp.data(), static_cast<int>(fp.size()), SQLITE_STATIC);
+        return true;
+    }
 
-        std::string origFingerprint;
-        attr_map::const_iterator attrIt = node->attrs.map.find(MAKENAMEID2('c', '0'));
-        if (attrIt != node->attrs.map.end())
-        {
-           origFingerprint = attrIt->second;
-        }
-        sqlite3_bind_blob(mStmtPutNode, 5, origFingerprint.data(), static_cast<int>(origFingerprint.size()), SQLITE_STATIC);
+    LOG_debug << "Building ancestry index for " << numNodes << " nodes";
+    if (sqlite3_exec(db, "BEGIN", nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        return false;
+    }
 
-        sqlite3_bind_int(mStmtPutNode, 6, node->type);
-        sqlite3_bind_int64(mStmtPutNode, 7, node->size);
+    // same paths as putNodePath(): nodes whose parent isn't in the DB start with the parent's handle
+    std::string undefStr = std::to_string(static_cast<sqlite3_int64>(UNDEF));
+    std::string build =
+        "WITH RECURSIVE paths(nodehandle, path) AS "
+            "(SELECT nodehandle, CASE WHEN parenthandle = " + undefStr + " THEN printf('%012X', nodehandle) "
+                                     "ELSE printf('%012X%012X', parenthandle, nodehandle) END "
+             "FROM nodes WHERE parenthandle NOT IN (SELECT nodehandle FROM nodes) "
+             "UNION ALL "
+             "SELECT N.nodehandle, P.path || printf('%012X', N.nodehandle) "
+             "FROM nodes AS N INNER JOIN paths AS P ON N.parenthandle = P.nodehandle) "
+        "INSERT INTO nodepaths (nodehandle, path) SELECT nodehandle, path FROM paths";
 
-        int shareType = node->getShareType();
-        sqlite3_bind_int(mStmtPutNode, 8, shareType);
+    if (sqlite3_exec(db, "DELETE FROM nodepaths", nullptr, nullptr, nullptr) != SQLITE_OK
+        || sqlite3_exec(db, build.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        LOG_err << "Failed to build ancestry index: " << sqlite3_errmsg(db);
+        sqlite3_exec(db, "ROLLBACK", nullptr, nullptr, nullptr);
+        return false;
+    }
 
-        // node->attrstring has value => node is encrypted
-        nameid favId = AttrMap::string2nameid("fav");
-        auto favIt = node->attrs.map.find(favId);
-        bool fav = (favIt != node->attrs.map.end() && favIt->second == "1"); // test 'fav' attr value (only "1" is valid)
-        sqlite3_bind_int(mStmtPutNode, 9, fav);
-        sqlite3_bind_int64(mStmtPutNode, 10, node->ctime);
-        sqlite3_bind_int64(mStmtPutNode, 11, node->mtime);
-        sqlite3_bind_int64(mStmtPutNode, 12, node->getDBFlags());
-        std::string nodeCountersBlob = node->getCounter().serialize();
-        sqlite3_bind_blob(mStmtPutNode, 13, nodeCountersBlob.data(), static_cast<int>(nodeCountersBlob.size()), SQLITE_STATIC);
-        sqlite3_bind_blob(mStmtPutNode, 14, nodeSerialized.data(), static_cast<int>(nodeSerialized.size()), SQLITE_STATIC);
+    return sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr) == SQLITE_OK;
+}
 
-        static nameid labelId = AttrMap::string2nameid("lbl");
-        auto labelIt = node->attrs.map.find(labelId);
-        int label = (labelIt == node->attrs.map.end()) ? LBL_UNKNOWN : std::atoi(labelIt->second.c_str());
-        sqlite3_bind_int(mStmtPutNode, 15, label);
+std::string SqliteAccountState::nameIndexQuery(const std::string& pattern)
+{
+    std::string query;
+    std::string fragment;
+    size_t fragmentLength = 0; // in characters, not bytes
 
-        nameid descriptionId = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_DESCRIPTION);
-        if (auto descriptionIt = node->attrs.map.find(descriptionId);
-            descriptionIt != node->attrs.map.end())
-        {
-            const std::string& description = descriptionIt->second;
-            sqlite3_bind_text(mStmtPutNode,
-                              16,
-                              description.c_str(),
-                              static_cast<int>(description.length()),
-                              SQLITE_STATIC);
-        }
-        else
+    auto addFragment = [&query, &fragment, &fragmentLength]()
+    {
+        if (fragmentLength >= 3)
         {
-            sqlite3_bind_null(mStmtPutNode, 16);
+            if (!query.empty())
+            {
+                query += " AND ";
+            }
+            query += '"' + fragment + '"';
         }
+        fragment.clear();
+        fragmentLength = 0;
+    };
 
-        nameid tagId = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_TAGS);
-        if (auto tagIt = node->attrs.map.find(tagId); tagIt != node->attrs.map.end())
+    for (char c : pattern)
+    {
+        if (c == WILDCARD_MATCH_ALL || c == WILDCARD_MATCH_ONE)
         {
-            const std::string& tag = tagIt->second;
-            sqlite3_bind_text(mStmtPutNode,
-                              17,
-                              tag.c_str(),
-                              static_cast<int>(tag.length()),
-                              SQLITE_STATIC);
+            addFragment();
+            continue;
         }
-        else
+
+        // double quotes are escaped by doubling them inside FTS5 strings
+        fragment += (c == '"') ? std::string("\"\"") : std::string(1, c);
+        if ((static_cast<unsigned char>(c) & 0xC0) != 0x80) // not an UTF-8 continuation byte
         {
-            sqlite3_bind_null(mStmtPutNode, 17);
+            ++fragmentLength;
         }
-
-        sqlResult = sqlite3_step(mStmtPutNode);
     }
+    addFragment();
 
-    errorHandler(sqlResult, "Put node", false);
-
-    sqlite3_reset(mStmtPutNode);
-
-    return sqlResult == SQLITE_DONE;
+    return query;
 }
 
 bool SqliteAccountState::getNode(NodeHandle nodehandle, NodeSerialized &nodeSerialized)
 {
+    static auto& getNodeLatency = Metrics::registry().histogram("SqliteAccountState_getNode");
+    Metrics::ScopedLatency getNodeTimer(getNodeLatency);
+
     bool success = false;
     if (!db)
     {
@@ -1385,23 +2610,27 @@ bool SqliteAccountState::getRootNodes(std::vector<std::pair<NodeHandle, NodeSeri
         return false;
     }
 
-    sqlite3_stmt *stmt = nullptr;
     bool result = false;
-    int sqlResult = sqlite3_prepare_v2(db, "SELECT nodehandle, counter, node FROM nodes WHERE type >= ? AND type <= ?", -1, &stmt, NULL);
+    int sqlResult = SQLITE_OK;
+    if (!mStmtRootNodes)
+    {
+        sqlResult = sqlite3_prepare_v2(db, "SELECT nodehandle, counter, node FROM nodes WHERE type >= ? AND type <= ?", -1, &mStmtRootNodes, NULL);
+    }
+
     if (sqlResult == SQLITE_OK)
     {
-        if ((sqlResult = sqlite3_bind_int(stmt, 1, nodetype_t::ROOTNODE)) == SQLITE_OK)
+        if ((sqlResult = sqlite3_bind_int(mStmtRootNodes, 1, nodetype_t::ROOTNODE)) == SQLITE_OK)
         {
-            if ((sqlResult = sqlite3_bind_int(stmt, 2, nodetype_t::RUBBISHNODE)) == SQLITE_OK)
+            if ((sqlResult = sqlite3_bind_int(mStmtRootNodes, 2, nodetype_t::RUBBISHNODE)) == SQLITE_OK)
             {
-                result = processSqlQueryNodes(stmt, nodes);
+                result = processSqlQueryNodes(mStmtRootNodes, nodes);
             }
         }
     }
 
     errorHandler(sqlResult, "Get root nodes", false);
 
-    sqlite3_finalize(stmt);
+    sqlite3_reset(mStmtRootNodes);
 
     return result;
 }
@@ -1414,20 +2643,24 @@ bool SqliteAccountState::getNodesWithSharesOrLink(std::vector<std::pair<NodeHand
         return false;
     }
 
-    sqlite3_stmt *stmt = nullptr;
     bool result = false;
-    int sqlResult = sqlite3_prepare_v2(db, "SELECT nodehandle, counter, node FROM nodes WHERE share & ? != 0", -1, &stmt, NULL);
+    int sqlResult = SQLITE_OK;
+    if (!mStmtNodesWithSharesOrLink)
+    {
+        sqlResult = sqlite3_prepare_v2(db, "SELECT nodehandle, counter, node FROM nodes WHERE share & ? != 0", -1, &mStmtNodesWithSharesOrLink, NULL);
+    }
+
     if (sqlResult == SQLITE_OK)
     {
-        if ((sqlResult = sqlite3_bind_int(stmt, 1, static_cast<int>(shareType))) == SQLITE_OK)
+        if ((sqlResult = sqlite3_bind_int(mStmtNodesWithSharesOrLink, 1, static_cast<int>(shareType))) == SQLITE_OK)
         {
-            result = processSqlQueryNodes(stmt, nodes);
+            result = processSqlQueryNodes(mStmtNodesWithSharesOrLink, nodes);
         }
     }
 
     errorHandler(sqlResult, "Get nodes with shares or link", false);
 
-    sqlite3_finalize(stmt);
+    sqlite3_reset(mStmtNodesWithSharesOrLink);
 
     return result;
 }
@@ -1544,6 +2777,31 @@ uint64_t SqliteAccountState::getNumberOfChildren(NodeHandle parentHandle)
 }
 
 bool SqliteAccountState::getChildren(const mega::NodeSearchFilter& filter, int order, vector<pair<NodeHandle, NodeSerialized>>& children, CancelToken cancelFlag, const NodeSearchPage& page)
+{
+    return queryChildren(filter, order, cancelFlag, page, "nodehandle, counter, node", mStmtGetChildren,
+                         [this, &children](sqlite3_stmt* stmt, size_t& numRows)
+                         {
+                             size_t previousSize = children.size();
+                             bool result = processSqlQueryNodes(stmt, children);
+                             numRows = children.size() - previousSize;
+                             return result;
+                         });
+}
+
+bool SqliteAccountState::getChildrenViews(const mega::NodeSearchFilter& filter, int order, vector<NodeView>& children, CancelToken cancelFlag, const NodeSearchPage& page)
+{
+    return queryChildren(filter, order, cancelFlag, page, "nodehandle, name, type, size, ctime, mtime, fav, label", mStmtGetChildrenViews,
+                         [this, &children](sqlite3_stmt* stmt, size_t& numRows)
+                         {
+                             size_t previousSize = children.size();
+                             bool result = processSqlQueryNodeViews(stmt, children);
+                             numRows = children.size() - previousSize;
+                             return result;
+                         });
+}
+
+bool SqliteAccountState::queryChildren(const mega::NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page,
+                                       const char* columns, std::map<size_t, sqlite3_stmt*>& stmtCache, std::function<bool(sqlite3_stmt*, size_t&)> processRows)
 {
     if (!db)
     {
@@ -1555,17 +2813,11 @@ bool SqliteAccountState::getChildren(const mega::NodeSearchFilter& filter, int o
         sqlite3_progress_handler(db, NUM_VIRTUAL_MACHINE_INSTRUCTIONS, SqliteAccountState::progressHandler, static_cast<void*>(&cancelFlag));
     }
 
-    // There are 2 criteria used (so far) in ORDER BY clause.
-    // For every combination of order-by directions, a separate query will be necessary.
-    size_t cacheId = OrderByClause::getId(order);
-    sqlite3_stmt*& stmt = mStmtGetChildren[cacheId];
-
-    int sqlResult = SQLITE_OK;
-    if (!stmt)
+    // Inherited sensitivity is not a concern here. When filtering out sensitive nodes, the parent of all children
+    // would be checked before getting here. There's no point in making this query recursive just because of that.
+    auto prepare = [this, columns](const std::string& orderAndLimit, sqlite3_stmt** stmt)
     {
-        // Inherited sensitivity is not a concern here. When filtering out sensitive nodes, the parent of all children
-        // would be checked before getting here. There's no point in making this query recursive just because of that.
-        std::string sqlQuery = "SELECT nodehandle, counter, node "
+        std::string sqlQuery = std::string("SELECT ") + columns + " "
                                "FROM nodes "
                                "WHERE (flags & ?1 = 0) " // Versions aren't taken in consideration
                                  "AND (parenthandle = ?2) "
@@ -1582,56 +2834,126 @@ bool SqliteAccountState::getChildren(const mega::NodeSearchFilter& filter, int o
                                               " OR mimetype = ?8))) "
                                  "AND (?11 = 0 OR (name REGEXP ?9)) "
                                  "AND (?14 = 0 OR isContained(?15, description)) "
-                                 "AND (?16 = 0 OR matchTag(?17, tags)) "
+                                 "AND " + tagCondition(16) + " "
                                  "AND (?18 = " + std::to_string(static_cast<int>(NodeSearchFilter::BoolFilter::disabled)) + " OR ?19 = fav)"
                                  "AND (?20 = " + std::to_string(static_cast<int>(NodeSearchFilter::BoolFilter::disabled)) +  // Sensitive nodes
                                      " OR (?20 = " + std::to_string(static_cast<int>(NodeSearchFilter::BoolFilter::onlyTrue)) +
                                         " AND (flags & ?21) = 0)"
                                      " OR (?20 = " + std::to_string(static_cast<int>(NodeSearchFilter::BoolFilter::onlyFalse)) +
-                                        " AND (flags & ?21) = ?21))" //
+                                        " AND (flags & ?21) = ?21)) " //
                                  // Leading and trailing '*' will be added to argument '?' so we are looking for substrings containing name
                                  // Our REGEXP implementation is case insensitive
+                               + orderAndLimit;
 
-                               "ORDER BY \n" +
-                                  OrderByClause::get(order, 10) + " \n" + // use ?10 for bound value
-
-                               "LIMIT ?12 OFFSET ?13";
-
-        sqlResult = sqlite3_prepare_v2(db, sqlQuery.c_str(), -1, &stmt, NULL);
-    }
-
-    bool result = false;
-    uint64_t versionFlag = (1 << Node::FLAGS_IS_VERSION); // exclude file versions
-    uint64_t senstivityFlag = 1 << Node::FLAGS_IS_MARKED_SENSTIVE; // filter by sensitivity
-
-    if (sqlResult == SQLITE_OK &&
-        (sqlResult = sqlite3_bind_int64(stmt, 1, versionFlag)) == SQLITE_OK &&
-        (sqlResult = sqlite3_bind_int64(stmt, 2, filter.byParentHandle())) == SQLITE_OK &&
-        (sqlResult = sqlite3_bind_int(stmt, 3, filter.byNodeType())) == SQLITE_OK &&
-        (sqlResult = sqlite3_bind_int64(stmt, 4, filter.byCreationTimeLowerLimit())) == SQLITE_OK &&
-        (sqlResult = sqlite3_bind_int64(stmt, 5, filter.byCreationTimeUpperLimit())) == SQLITE_OK &&
-        (sqlResult = sqlite3_bind_int64(stmt, 6, filter.byModificationTimeLowerLimit())) == SQLITE_OK &&
-        (sqlResult = sqlite3_bind_int64(stmt, 7, filter.byModificationTimeUpperLimit())) == SQLITE_OK &&
-        (sqlResult = sqlite3_bind_int(stmt, 8, filter.byCategory())) == SQLITE_OK)
-    {
-        const string& nameFilter = filter.byName();
-        bool matchWildcard = std::any_of(nameFilter.begin(), nameFilter.end(), [](const char& c) { return c != '*'; });
-        const string& wildCardName = matchWildcard ? '*' + filter.byName() + '*' : nameFilter;
-        if ((sqlResult = sqlite3_bind_text(stmt, 9, wildCardName.c_str(), static_cast<int>(wildCardName.length()), SQLITE_STATIC)) == SQLITE_OK &&
+        return sqlite3_prepare_v2(db, sqlQuery.c_str(), -1, stmt, NULL);
+    };
+
+    uint64_t versionFlag = (1 << Node::FLAGS_IS_VERSION); // exclude file versions
+    uint64_t senstivityFlag = 1 << Node::FLAGS_IS_MARKED_SENSTIVE; // filter by sensitivity
+    const string& nameFilter = filter.byName();
+    bool matchWildcard = std::any_of(nameFilter.begin(), nameFilter.end(), [](const char& c) { return c != '*'; });
+    const string& wildCardName = matchWildcard ? '*' + filter.byName() + '*' : nameFilter;
+    const string tagFilter = mHasTagIndex ? foldCaseUtf8(filter.byTag()) : filter.byTag();
+
+    auto bind = [&](sqlite3_stmt* stmt, size_t limit, size_t offset)
+    {
+        int sqlResult = SQLITE_OK;
+        if ((sqlResult = sqlite3_bind_int64(stmt, 1, versionFlag)) == SQLITE_OK &&
+            (sqlResult = sqlite3_bind_int64(stmt, 2, filter.byParentHandle())) == SQLITE_OK &&
+            (sqlResult = sqlite3_bind_int(stmt, 3, filter.byNodeType())) == SQLITE_OK &&
+            (sqlResult = sqlite3_bind_int64(stmt, 4, filter.byCreationTimeLowerLimit())) == SQLITE_OK &&
+            (sqlResult = sqlite3_bind_int64(stmt, 5, filter.byCreationTimeUpperLimit())) == SQLITE_OK &&
+            (sqlResult = sqlite3_bind_int64(stmt, 6, filter.byModificationTimeLowerLimit())) == SQLITE_OK &&
+            (sqlResult = sqlite3_bind_int64(stmt, 7, filter.byModificationTimeUpperLimit())) == SQLITE_OK &&
+            (sqlResult = sqlite3_bind_int(stmt, 8, filter.byCategory())) == SQLITE_OK &&
+            (sqlResult = sqlite3_bind_text(stmt, 9, wildCardName.c_str(), static_cast<int>(wildCardName.length()), SQLITE_STATIC)) == SQLITE_OK &&
             (sqlResult = sqlite3_bind_int(stmt, 10, order)) == SQLITE_OK &&
             (sqlResult = sqlite3_bind_int(stmt, 11, matchWildcard)) == SQLITE_OK &&
-            (sqlResult = sqlite3_bind_int64(stmt, 12, page.size() ? static_cast<sqlite3_int64>(page.size()) : -1)) == SQLITE_OK &&
-            (sqlResult = sqlite3_bind_int64(stmt, 13, page.startingOffset())) == SQLITE_OK &&
+            (sqlResult = sqlite3_bind_int64(stmt, 12, limit ? static_cast<sqlite3_int64>(limit) : -1)) == SQLITE_OK &&
+            (sqlResult = sqlite3_bind_int64(stmt, 13, offset)) == SQLITE_OK &&
             (sqlResult = sqlite3_bind_int(stmt, 14, static_cast<int>(filter.byDescription().size()))) == SQLITE_OK &&
             (sqlResult = sqlite3_bind_text(stmt, 15, filter.byDescription().c_str(), static_cast<int>(filter.byDescription().size()), SQLITE_STATIC)) == SQLITE_OK &&
             (sqlResult = sqlite3_bind_int(stmt, 16, static_cast<int>(filter.byTag().size()))) == SQLITE_OK &&
-            (sqlResult = sqlite3_bind_text(stmt, 17, filter.byTag().c_str(), static_cast<int>(filter.byTag().size()), SQLITE_STATIC)) == SQLITE_OK &&
+            (sqlResult = sqlite3_bind_text(stmt, 17, tagFilter.c_str(), static_cast<int>(tagFilter.size()), SQLITE_STATIC)) == SQLITE_OK &&
             (sqlResult = sqlite3_bind_int(stmt, 18, static_cast<int>(filter.byFavourite()))) == SQLITE_OK &&
             (sqlResult = sqlite3_bind_int(stmt, 19, filter.byFavourite() == NodeSearchFilter::BoolFilter::onlyTrue)) == SQLITE_OK &&
-            (sqlResult = sqlite3_bind_int(stmt, 20, static_cast<int>(filter.bySensitivity()))) == SQLITE_OK &&
-            (sqlResult = sqlite3_bind_int64(stmt, 21, senstivityFlag)) == SQLITE_OK)
+            (sqlResult = sqlite3_bind_int(stmt, 20, static_cast<int>(filter.bySensitivity()))) == SQLITE_OK)
+        {
+            sqlResult = sqlite3_bind_int64(stmt, 21, senstivityFlag);
+        }
+        return sqlResult;
+    };
+
+    bool result = false;
+    int sqlResult = SQLITE_OK;
+    const NodeView* cursor = page.cursor();
+    if (!cursor)
+    {
+        // There are 2 criteria used (so far) in ORDER BY clause.
+        // For every combination of order-by directions, a separate query will be necessary.
+        size_t cacheId = OrderByClause::getId(order);
+        sqlite3_stmt*& stmt = stmtCache[cacheId];
+        if (!stmt)
+        {
+            sqlResult = prepare("ORDER BY \n" + OrderByClause::get(order, 10) + " \n" // use ?10 for bound value
+                                "LIMIT ?12 OFFSET ?13", &stmt);
+        }
+
+        size_t numRows = 0;
+        if (sqlResult == SQLITE_OK &&
+            (sqlResult = bind(stmt, page.size(), page.startingOffset())) == SQLITE_OK)
+        {
+            result = processRows(stmt, numRows);
+        }
+
+        sqlite3_reset(stmt);
+    }
+    else
+    {
+        // Keyset paging: one type at a time (like "type DESC" does), every one of them is a range of
+        // the children index of the sorting attribute, starting right after the cursor for its type.
+        // The query isn't parametrized by 'order', so it's cached per order instead of per directions.
+        result = true;
+        size_t remaining = page.size();
+        for (int type = cursor->mType; result && type >= FILENODE; --type)
         {
-            result = processSqlQueryNodes(stmt, children);
+            if (filter.byNodeType() != TYPE_UNKNOWN && filter.byNodeType() != type)
+            {
+                continue;
+            }
+
+            bool fromCursor = type == cursor->mType;
+            size_t cacheId = KEYSET_CACHE_ID | (fromCursor ? KEYSET_CURSOR_CACHE_ID : 0) |
+                             (static_cast<size_t>(order) << KEYSET_ORDER_SHIFT);
+            sqlite3_stmt*& stmt = stmtCache[cacheId];
+            if (!stmt)
+            {
+                sqlResult = prepare("AND type = ?22 " +
+                                    (fromCursor ? "AND " + OrderByClause::getAfterKey(order, 23) + " " : std::string()) +
+                                    "ORDER BY " + OrderByClause::getKeysetOrder(order) + " "
+                                    "LIMIT ?12", &stmt);
+            }
+
+            size_t numRows = 0;
+            result = false;
+            if (sqlResult == SQLITE_OK &&
+                (sqlResult = bind(stmt, remaining, 0)) == SQLITE_OK &&
+                (sqlResult = sqlite3_bind_int(stmt, 22, type)) == SQLITE_OK &&
+                (!fromCursor || (sqlResult = OrderByClause::bindKey(stmt, order, 23, *cursor)) == SQLITE_OK))
+            {
+                result = processRows(stmt, numRows);
+            }
+
+            sqlite3_reset(stmt);
+
+            if (page.size())
+            {
+                if (numRows >= remaining)
+                {
+                    break;
+                }
+                remaining -= numRows;
+            }
         }
     }
 
@@ -1641,8 +2963,6 @@ bool SqliteAccountState::getChildren(const mega::NodeSearchFilter& filter, int o
     string errMsg("Get children with filter");
     errorHandler(sqlResult, errMsg, true);
 
-    sqlite3_reset(stmt);
-
     return result;
 }
 
@@ -1660,7 +2980,17 @@ bool SqliteAccountState::searchNodes(const NodeSearchFilter& filter, int order,
 
     // There are multiple criteria used in ORDER BY clause.
     // For every combination of order-by directions, a separate query will be necessary.
-    size_t cacheId = OrderByClause::getId(order);
+    // Queries that preselect names (or descriptions) through their index are cached apart too.
+    // Keyset paging (by cursor) sorts plain columns, so those queries are cached per order.
+    const string& byName = filter.byName();
+    string nameQuery = mHasNameIndex ? nameIndexQuery(byName) : string();
+    // the description is matched literally: any fragment between wildcards is contained as well
+    string descriptionQuery = mHasDescriptionIndex ? nameIndexQuery(filter.byDescription()) : string();
+    const string tagFilter = mHasTagIndex ? foldCaseUtf8(filter.byTag()) : filter.byTag();
+    const NodeView* cursor = page.cursor();
+    size_t cacheId = (cursor ? KEYSET_CACHE_ID | (static_cast<size_t>(order) << KEYSET_ORDER_SHIFT) : OrderByClause::getId(order)) |
+                     (nameQuery.empty() ? 0 : NAME_INDEX_CACHE_ID) |
+                     (descriptionQuery.empty() ? 0 : DESCRIPTION_INDEX_CACHE_ID);
     sqlite3_stmt*& stmt = mStmtSearchNodes[cacheId];
 
     int sqlResult = SQLITE_OK;
@@ -1705,7 +3035,7 @@ bool SqliteAccountState::searchNodes(const NodeSearchFilter& filter, int order,
 
         string columnsForNodeAndOrderBy =
             "nodehandle, counter, node, " // for nodes
-            "type, size, ctime, mtime, name, label, fav"; // for ORDER BY only
+            "type, size, ctime, mtime, namesortkey, label, fav"; // for ORDER BY only
 
         string whereClause =
             "(flags & ?1 = 0) \n" // Versions aren't taken in consideration
@@ -1720,9 +3050,11 @@ bool SqliteAccountState::searchNodes(const NodeSearchFilter& filter, int order,
                                            ',' + std::to_string(MIME_TYPE_PRESENTATION) +
                                            ',' + std::to_string(MIME_TYPE_SPREADSHEET) + "))"
                          " OR mimetype = ?8))) \n"
-            "AND (?13 = 0 OR (name REGEXP ?9)) \n"
+            "AND (?13 = 0 OR (name REGEXP ?9)) \n" +
+            string(nameQuery.empty() ? "" : "AND nodehandle IN (SELECT rowid FROM nodesname WHERE nodesname MATCH ?25) \n") +
+            string(descriptionQuery.empty() ? "" : "AND nodehandle IN (SELECT rowid FROM nodesdescription WHERE nodesdescription MATCH ?30) \n") +
             "AND (?17 = 0 OR isContained(?18, description)) \n"
-            "AND (?19 = 0 OR matchTag(?20, tags)) \n"
+            "AND " + tagCondition(19) + " \n"
             "AND (?21 = " + std::to_string(static_cast<int>(NodeSearchFilter::BoolFilter::disabled)) + " OR ?22 = fav)"
             "AND (?23 = " + std::to_string(static_cast<int>(NodeSearchFilter::BoolFilter::disabled)) +   // Sensitive nodes
                 " OR (?23 = " + std::to_string(static_cast<int>(NodeSearchFilter::BoolFilter::onlyTrue)) +
@@ -1753,8 +3085,10 @@ bool SqliteAccountState::searchNodes(const NodeSearchFilter& filter, int order,
              nodesAfterFilters + "\n\n" +
 
             "SELECT " + columnsForNodeAndOrderBy + " \n"
-            "FROM nodesAfterFilters \n"
-            "ORDER BY \n" + OrderByClause::get(order, 10) + " \n" + // use ?10 for bound value
+            "FROM nodesAfterFilters \n" +
+            (cursor ? "WHERE type < ?26 OR (type = ?26 AND " + OrderByClause::getAfterKey(order, 27) + ") \n"
+                      "ORDER BY type DESC, " + OrderByClause::getKeysetOrder(order) + " \n"
+                    : "ORDER BY \n" + OrderByClause::get(order, 10) + " \n") + // use ?10 for bound value
             "LIMIT ?14 OFFSET ?15";
 
         sqlResult = sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, NULL);
@@ -1775,7 +3109,6 @@ bool SqliteAccountState::searchNodes(const NodeSearchFilter& filter, int order,
         (sqlResult = sqlite3_bind_int(stmt, 8, filter.byCategory())) == SQLITE_OK)
     {
         assert(filter.byAncestorHandles().size() >= 3); // support at least 3 ancestors
-        const string& byName = filter.byName();
         bool matchWildcard = std::any_of(byName.begin(), byName.end(), [](const char& c) { return c != '*'; });
         const string& nameFilter = matchWildcard ? '*' + byName + '*' : byName;
         if ((sqlResult = sqlite3_bind_text(stmt, 9, nameFilter.c_str(), static_cast<int>(nameFilter.size()), SQLITE_STATIC)) == SQLITE_OK &&
@@ -1789,11 +3122,18 @@ bool SqliteAccountState::searchNodes(const NodeSearchFilter& filter, int order,
             (sqlResult = sqlite3_bind_int(stmt, 17, static_cast<int>(filter.byDescription().size()))) == SQLITE_OK &&
             (sqlResult = sqlite3_bind_text(stmt, 18, filter.byDescription().c_str(), static_cast<int>(filter.byDescription().size()), SQLITE_STATIC)) == SQLITE_OK &&
             (sqlResult = sqlite3_bind_int(stmt, 19, static_cast<int>(filter.byTag().size()))) == SQLITE_OK &&
-            (sqlResult = sqlite3_bind_text(stmt, 20, filter.byTag().c_str(), static_cast<int>(filter.byTag().size()), SQLITE_STATIC)) == SQLITE_OK &&
+            (sqlResult = sqlite3_bind_text(stmt, 20, tagFilter.c_str(), static_cast<int>(tagFilter.size()), SQLITE_STATIC)) == SQLITE_OK &&
             (sqlResult = sqlite3_bind_int(stmt, 21, static_cast<int>(filter.byFavourite()))) == SQLITE_OK &&
             (sqlResult = sqlite3_bind_int(stmt, 22, filter.byFavourite() == NodeSearchFilter::BoolFilter::onlyTrue)) == SQLITE_OK &&
             (sqlResult = sqlite3_bind_int(stmt, 23, static_cast<int>(filter.bySensitivity()))) == SQLITE_OK &&
-            (sqlResult = sqlite3_bind_int64(stmt, 24, senstivityFlag)) == SQLITE_OK)
+            (sqlResult = sqlite3_bind_int64(stmt, 24, senstivityFlag)) == SQLITE_OK &&
+            (nameQuery.empty() ||
+             (sqlResult = sqlite3_bind_text(stmt, 25, nameQuery.c_str(), static_cast<int>(nameQuery.size()), SQLITE_STATIC)) == SQLITE_OK) &&
+            (descriptionQuery.empty() ||
+             (sqlResult = sqlite3_bind_text(stmt, 30, descriptionQuery.c_str(), static_cast<int>(descriptionQuery.size()), SQLITE_STATIC)) == SQLITE_OK) &&
+            (!cursor ||
+             ((sqlResult = sqlite3_bind_int(stmt, 26, cursor->mType)) == SQLITE_OK &&
+              (sqlResult = OrderByClause::bindKey(stmt, order, 27, *cursor)) == SQLITE_OK)))
         {
             result = processSqlQueryNodes(stmt, nodes);
         }
@@ -1824,26 +3164,37 @@ bool SqliteAccountState::searchForNodesByName(const std::string &name, std::vect
         sqlite3_progress_handler(db, NUM_VIRTUAL_MACHINE_INSTRUCTIONS, SqliteAccountState::progressHandler, static_cast<void*>(&cancelFlag));
     }
 
+    // the name index preselects the candidates, REGEXP keeps the exact semantics
+    string nameQuery = mHasNameIndex ? nameIndexQuery(name) : string();
+    sqlite3_stmt*& stmt = nameQuery.empty() ? mStmtNodeByName : mStmtNodeByNameIndexed;
+
     int sqlResult = SQLITE_OK;
-    if (!mStmtNodeByName)
+    if (!stmt)
     {
         uint64_t excludeFlags = (1 << Node::FLAGS_IS_VERSION);
         std::string sqlQuery = "SELECT n1.nodehandle, n1.counter, n1.node "
                                "FROM nodes n1 "
-                               "WHERE n1.flags & " + std::to_string(excludeFlags) + " = 0 AND n1.name REGEXP ?";
+                               "WHERE n1.flags & " + std::to_string(excludeFlags) + " = 0 AND n1.name REGEXP ?1";
         // Leading and trailing '*' will be added to argument '?' so we are looking for a substring of name
         // Our REGEXP implementation is case insensitive
 
-        sqlResult = sqlite3_prepare_v2(db, sqlQuery.c_str(), -1, &mStmtNodeByName, NULL);
+        if (!nameQuery.empty())
+        {
+            sqlQuery += " AND n1.nodehandle IN (SELECT rowid FROM nodesname WHERE nodesname MATCH ?2)";
+        }
+
+        sqlResult = sqlite3_prepare_v2(db, sqlQuery.c_str(), -1, &stmt, NULL);
     }
 
     bool result = false;
     if (sqlResult == SQLITE_OK)
     {
         string wildCardName = "*" + name + "*";
-        if ((sqlResult = sqlite3_bind_text(mStmtNodeByName, 1, wildCardName.c_str(), static_cast<int>(wildCardName.length()), SQLITE_STATIC)) == SQLITE_OK)
+        if ((sqlResult = sqlite3_bind_text(stmt, 1, wildCardName.c_str(), static_cast<int>(wildCardName.length()), SQLITE_STATIC)) == SQLITE_OK &&
+            (nameQuery.empty() ||
+             (sqlResult = sqlite3_bind_text(stmt, 2, nameQuery.c_str(), static_cast<int>(nameQuery.length()), SQLITE_STATIC)) == SQLITE_OK))
         {
-            result = processSqlQueryNodes(mStmtNodeByName, nodes);
+            result = processSqlQueryNodes(stmt, nodes);
         }
     }
 
@@ -1852,7 +3203,7 @@ bool SqliteAccountState::searchForNodesByName(const std::string &name, std::vect
 
     errorHandler(sqlResult, "Search nodes by name", true);
 
-    sqlite3_reset(mStmtNodeByName);
+    sqlite3_reset(stmt);
 
     return result;
 }
@@ -2031,6 +3382,35 @@ bool SqliteAccountState::getNodeByFingerprint(const std::string &fingerprint, me
     return result;
 }
 
+bool SqliteAccountState::getFingerprints(std::function<void(const std::string&)> onFingerprint)
+{
+    if (!db)
+    {
+        return false;
+    }
+
+    // read from 'fingerprintindex' alone (if it exists), without visiting the rows
+    sqlite3_stmt* stmt = nullptr;
+    int sqlResult = sqlite3_prepare_v2(db, "SELECT fingerprint FROM nodes", -1, &stmt, NULL);
+    if (sqlResult == SQLITE_OK)
+    {
+        std::string fingerprint;
+        while ((sqlResult = sqlite3_step(stmt)) == SQLITE_ROW)
+        {
+            const void* data = sqlite3_column_blob(stmt, 0);
+            int size = sqlite3_column_bytes(stmt, 0);
+            fingerprint.assign(data ? static_cast<const char*>(data) : "", data ? static_cast<size_t>(size) : 0);
+            onFingerprint(fingerprint);
+        }
+    }
+
+    errorHandler(sqlResult, "Get fingerprints", false);
+
+    sqlite3_finalize(stmt);
+
+    return sqlResult == SQLITE_DONE;
+}
+
 bool SqliteAccountState::getRecentNodes(unsigned maxcount, m_time_t since, std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes)
 {
     if (!db)
@@ -2207,6 +3587,24 @@ bool SqliteAccountState::isAncestor(NodeHandle node, NodeHandle ancestor, Cancel
         return result;
     }
 
+    if (mHasAncestryIndex && !ancestor.isUndef())
+    {
+        // the ancestors of a node are the leading segments of its path
+        std::string path;
+        if (getNodePath(node.as8byte(), path))
+        {
+            const std::string segment = ancestryPathSegment(ancestor.as8byte());
+            for (size_t i = 0; i + segment.size() < path.size(); i += segment.size())
+            {
+                if (!path.compare(i, segment.size(), segment))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+
     std::string sqlQuery = "WITH nodesCTE(nodehandle, parenthandle) "
             "AS (SELECT nodehandle, parenthandle FROM nodes WHERE nodehandle = ? "
             "UNION ALL SELECT A.nodehandle, A.parenthandle FROM nodes AS A INNER JOIN nodesCTE "
@@ -2259,13 +3657,17 @@ uint64_t SqliteAccountState::getNumberOfNodes()
         return count;
     }
 
-    sqlite3_stmt *stmt = nullptr;
-    int sqlResult = sqlite3_prepare_v2(db, "SELECT count(*) FROM nodes", -1, &stmt, NULL);
+    int sqlResult = SQLITE_OK;
+    if (!mStmtNumNodes)
+    {
+        sqlResult = sqlite3_prepare_v2(db, "SELECT count(*) FROM nodes", -1, &mStmtNumNodes, NULL);
+    }
+
     if (sqlResult == SQLITE_OK)
     {
-        if ((sqlResult = sqlite3_step(stmt)) == SQLITE_ROW)
+        if ((sqlResult = sqlite3_step(mStmtNumNodes)) == SQLITE_ROW)
         {
-            count = sqlite3_column_int64(stmt, 0);
+            count = sqlite3_column_int64(mStmtNumNodes, 0);
         }
     }
 
@@ -2274,7 +3676,7 @@ uint64_t SqliteAccountState::getNumberOfNodes()
         errorHandler(sqlResult, "Get number of nodes", false);
     }
 
-    sqlite3_finalize(stmt);
+    sqlite3_reset(mStmtNumNodes);
 
     return count;
 }
@@ -2336,7 +3738,7 @@ bool SqliteAccountState::getNodesByMimetype(MimeType_t mimeType, std::vector<std
     {
         // exclude previous versions <- parent handle is of type != FILENODE
         std::string query = "SELECT n1.nodehandle, n1.counter, n1.node FROM nodes n1 "
-            "INNER JOIN nodes n2 on n2.nodehandle = n1.parenthandle where ismimetype(n1.name, ?) = 1 AND n1.flags & ? = ? AND n1.flags & ? = 0 AND n2.type !=";
+            "INNER JOIN nodes n2 on n2.nodehandle = n1.parenthandle where " + mimetypeCondition("n1.mimetype", 1) + " AND n1.flags & ? = ? AND n1.flags & ? = 0 AND n2.type !=";
         query.append(std::to_string(FILENODE))
             .append(" AND n1.type =")
             .append(std::to_string(FILENODE));
@@ -2387,6 +3789,15 @@ bool SqliteAccountState::getNodesByMimetypeExclusiveRecursive(MimeType_t mimeTyp
     bool result = false;
     int sqlResult = SQLITE_OK;
 
+    if (mHasAncestryIndex && excludeRecursiveFlags.none())
+    {
+        // nothing to prune: the descendants are a range of the ancestry index
+        result = getNodesByMimetypeInSubtree(mimeType, nodes, requiredFlags, excludeFlags, ancestorHandle);
+
+        sqlite3_progress_handler(db, -1, nullptr, nullptr);
+        return result;
+    }
+
     if (!mStmtNodeByMimeTypeExcludeRecursiveFlags)
     {
         // recursive query from ancestorHandle
@@ -2395,11 +3806,11 @@ bool SqliteAccountState::getNodesByMimetypeExclusiveRecursive(MimeType_t mimeTyp
         // exclude previous versions <- parent handle is of type != FILENODE
         //query = "SELECT nodehandle, counter, node FROM nodes";
 
-        std::string query = "WITH nodesCTE(nodehandle, parenthandle, flags, name, type, counter, node) AS (SELECT nodehandle, parenthandle, flags, name, type, counter, node "
-            "FROM nodes WHERE parenthandle = ? UNION ALL SELECT N.nodehandle, N.parenthandle, N.flags, N.name, N.type, N.counter, N.node "
+        std::string query = "WITH nodesCTE(nodehandle, parenthandle, flags, mimetype, type, counter, node) AS (SELECT nodehandle, parenthandle, flags, mimetype, type, counter, node "
+            "FROM nodes WHERE parenthandle = ? UNION ALL SELECT N.nodehandle, N.parenthandle, N.flags, N.mimetype, N.type, N.counter, N.node "
             "FROM nodes AS N INNER JOIN nodesCTE AS P ON (N.parenthandle = P.nodehandle AND N.flags & ? = 0)) "
             "SELECT node.nodehandle, node.counter, node.node "
-            "FROM nodesCTE AS node INNER JOIN nodes parent on node.parenthandle = parent.nodehandle AND ismimetype(node.name, ?) = 1 AND node.flags & ? = ? AND node.flags & ? = 0 AND parent.type != "
+            "FROM nodesCTE AS node INNER JOIN nodes parent on node.parenthandle = parent.nodehandle AND " + mimetypeCondition("node.mimetype", 3) + " AND node.flags & ? = ? AND node.flags & ? = 0 AND parent.type != "
                             + std::to_string(FILENODE) + " AND node.type = " + std::to_string(FILENODE);
 
         sqlResult = sqlite3_prepare_v2(db, query.c_str(), -1, &mStmtNodeByMimeTypeExcludeRecursiveFlags, nullptr);
@@ -2431,6 +3842,193 @@ bool SqliteAccountState::getNodesByMimetypeExclusiveRecursive(MimeType_t mimeTyp
     return result;
 }
 
+bool SqliteAccountState::getNodesByMimetypeInSubtree(MimeType_t mimeType, std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes, Node::Flags requiredFlags, Node::Flags excludeFlags, NodeHandle ancestorHandle)
+{
+    std::string ancestorPath;
+    if (!getNodePath(ancestorHandle.as8byte(), ancestorPath))
+    {
+        // not in the DB, but its children may be (see putNodePath())
+        ancestorPath = ancestryPathSegment(ancestorHandle.as8byte());
+    }
+
+    int sqlResult = SQLITE_OK;
+    if (!mStmtNodeByMimeTypeInSubtree)
+    {
+        // exclude previous versions <- parent handle is of type != FILENODE
+        std::string query = "SELECT node.nodehandle, node.counter, node.node "
+            "FROM nodepaths AS np INNER JOIN nodes AS node ON node.nodehandle = np.nodehandle "
+            "INNER JOIN nodes AS parent ON parent.nodehandle = node.parenthandle "
+            "WHERE np.path > ?1 AND np.path < ?1 || '~' AND " + mimetypeCondition("node.mimetype", 2) +
+            " AND node.flags & ?3 = ?3 AND node.flags & ?4 = 0 AND parent.type != " + std::to_string(FILENODE) +
+            " AND node.type = " + std::to_string(FILENODE);
+
+        sqlResult = sqlite3_prepare_v2(db, query.c_str(), -1, &mStmtNodeByMimeTypeInSubtree, nullptr);
+    }
+
+    bool result = false;
+    if (sqlResult == SQLITE_OK &&
+        (sqlResult = sqlite3_bind_text (mStmtNodeByMimeTypeInSubtree, 1, ancestorPath.c_str(), static_cast<int>(ancestorPath.size()), SQLITE_STATIC)) == SQLITE_OK &&
+        (sqlResult = sqlite3_bind_int  (mStmtNodeByMimeTypeInSubtree, 2, static_cast<int>(mimeType))) == SQLITE_OK &&
+        (sqlResult = sqlite3_bind_int64(mStmtNodeByMimeTypeInSubtree, 3, static_cast<sqlite3_int64>(requiredFlags.to_ulong()))) == SQLITE_OK &&
+        (sqlResult = sqlite3_bind_int64(mStmtNodeByMimeTypeInSubtree, 4, static_cast<sqlite3_int64>(excludeFlags.to_ulong()))) == SQLITE_OK)
+    {
+        result = processSqlQueryNodes(mStmtNodeByMimeTypeInSubtree, nodes);
+    }
+
+    if (sqlResult != SQLITE_OK)
+    {
+        errorHandler(sqlResult, "Get by mime type in subtree", true);
+    }
+
+    sqlite3_reset(mStmtNodeByMimeTypeInSubtree);
+
+    return result;
+}
+
+bool SqliteAccountState::getVersions(NodeHandle fileHandle, std::vector<std::pair<NodeHandle, NodeSerialized>>& versions)
+{
+    if (!db || !mHasAncestryIndex)
+    {
+        return false;
+    }
+
+    std::string filePath;
+    if (!getNodePath(fileHandle.as8byte(), filePath))
+    {
+        return false;
+    }
+
+    int sqlResult = SQLITE_OK;
+    if (!mStmtVersions)
+    {
+        // the only descendants of files are their versions, and the path of each one extends
+        // the path of the newer one: ordered by path, they come as in the chain
+        sqlResult = sqlite3_prepare_v2(db, "SELECT node.nodehandle, node.counter, node.node "
+                                           "FROM nodepaths AS np INNER JOIN nodes AS node ON node.nodehandle = np.nodehandle "
+                                           "WHERE np.path > ?1 AND np.path < ?1 || '~' ORDER BY np.path", -1, &mStmtVersions, nullptr);
+    }
+
+    bool result = false;
+    if (sqlResult == SQLITE_OK &&
+        (sqlResult = sqlite3_bind_text(mStmtVersions, 1, filePath.c_str(), static_cast<int>(filePath.size()), SQLITE_STATIC)) == SQLITE_OK)
+    {
+        result = processSqlQueryNodes(mStmtVersions, versions);
+    }
+
+    if (sqlResult != SQLITE_OK)
+    {
+        errorHandler(sqlResult, "Get versions", true);
+    }
+
+    sqlite3_reset(mStmtVersions);
+
+    return result;
+}
+
+bool SqliteAccountState::putChatGrants(handle chatid, const std::vector<ChatGrant>& grants, bool replace)
+{
+    if (!db)
+    {
+        return false;
+    }
+
+    checkTransaction();
+
+    int sqlResult = SQLITE_OK;
+    if (replace)
+    {
+        sqlite3_stmt* stmt = nullptr;
+        if ((sqlResult = sqlite3_prepare_v2(db, "DELETE FROM chatgrants WHERE chatid = ?", -1, &stmt, nullptr)) == SQLITE_OK
+            && (sqlResult = sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(chatid))) == SQLITE_OK)
+        {
+            sqlResult = sqlite3_step(stmt);
+        }
+        sqlite3_finalize(stmt);
+
+        if (sqlResult != SQLITE_DONE)
+        {
+            errorHandler(sqlResult, "Replace chat grants", false);
+            return false;
+        }
+        sqlResult = SQLITE_OK;
+    }
+
+    if (!mStmtPutChatGrant)
+    {
+        sqlResult = sqlite3_prepare_v2(db, "INSERT OR IGNORE INTO chatgrants (chatid, nodehandle, userhandle) VALUES (?, ?, ?)", -1, &mStmtPutChatGrant, nullptr);
+    }
+
+    if (sqlResult == SQLITE_OK && !mStmtDelChatGrant)
+    {
+        sqlResult = sqlite3_prepare_v2(db, "DELETE FROM chatgrants WHERE chatid = ? AND nodehandle = ? AND userhandle = ?", -1, &mStmtDelChatGrant, nullptr);
+    }
+
+    for (auto it = grants.begin(); sqlResult == SQLITE_OK && it != grants.end(); ++it)
+    {
+        sqlite3_stmt* stmt = it->revoked ? mStmtDelChatGrant : mStmtPutChatGrant;
+        if ((sqlResult = sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(chatid))) == SQLITE_OK
+            && (sqlResult = sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(it->node))) == SQLITE_OK
+            && (sqlResult = sqlite3_bind_int64(stmt, 3, static_cast<sqlite3_int64>(it->user))) == SQLITE_OK
+            && (sqlResult = sqlite3_step(stmt)) == SQLITE_DONE)
+        {
+            sqlResult = SQLITE_OK;
+        }
+        sqlite3_reset(stmt);
+    }
+
+    errorHandler(sqlResult, "Put chat grants", false);
+
+    return sqlResult == SQLITE_OK;
+}
+
+bool SqliteAccountState::getChatGrants(handle chatid, std::vector<ChatGrant>& grants)
+{
+    if (!db)
+    {
+        return false;
+    }
+
+    int sqlResult = SQLITE_OK;
+    if (!mStmtChatGrants)
+    {
+        sqlResult = sqlite3_prepare_v2(db, "SELECT nodehandle, userhandle FROM chatgrants WHERE chatid = ?", -1, &mStmtChatGrants, nullptr);
+    }
+
+    if (sqlResult == SQLITE_OK
+        && (sqlResult = sqlite3_bind_int64(mStmtChatGrants, 1, static_cast<sqlite3_int64>(chatid))) == SQLITE_OK)
+    {
+        while ((sqlResult = sqlite3_step(mStmtChatGrants)) == SQLITE_ROW)
+        {
+            ChatGrant grant;
+            grant.node = static_cast<handle>(sqlite3_column_int64(mStmtChatGrants, 0));
+            grant.user = static_cast<handle>(sqlite3_column_int64(mStmtChatGrants, 1));
+            grants.push_back(grant);
+        }
+    }
+
+    if (sqlResult != SQLITE_DONE)
+    {
+        errorHandler(sqlResult, "Get chat grants", true);
+    }
+
+    sqlite3_reset(mStmtChatGrants);
+
+    return sqlResult == SQLITE_DONE;
+}
+
+void SqliteAccountState::truncate()
+{
+    SqliteDbTable::truncate();
+
+    if (!db)
+    {
+        return;
+    }
+
+    int sqlResult = sqlite3_exec(db, "DELETE FROM chatgrants", nullptr, nullptr, nullptr);
+    errorHandler(sqlResult, "Truncate chat grants", false);
+}
+
 void SqliteAccountState::userRegexp(sqlite3_context* context, int argc, sqlite3_value** argv)
 {
     if (argc != 2)
@@ -2491,6 +4089,27 @@ void SqliteAccountState::userGetMimetype(sqlite3_context* context, int argc, sql
     sqlite3_result_int(context, result);
 }
 
+void SqliteAccountState::userGetNameSortKey(sqlite3_context* context, int argc, sqlite3_value** argv)
+{
+    if (argc != 1)
+    {
+        LOG_err << "Invalid parameters for userGetNameSortKey";
+        assert(argc == 1);
+        sqlite3_result_null(context);
+        return;
+    }
+
+    const char* name = reinterpret_cast<const char*>(sqlite3_value_text(argv[0]));
+    if (!name)
+    {
+        sqlite3_result_null(context);
+        return;
+    }
+
+    std::string key = naturalsorting_key(name);
+    sqlite3_result_blob(context, key.data(), static_cast<int>(key.size()), SQLITE_TRANSIENT);
+}
+
 void SqliteAccountState::userIsContained(sqlite3_context* context, int argc, sqlite3_value** argv)
 {
     if (argc != 2)
@@ -2547,9 +4166,10 @@ std::string OrderByClause::get(int order, int sqlParamIndex)
     // The sorting is done with this attributes preference:
     // - type: Folders always first
     // - attribute: depends on DESC/ASC (inverted for fav and label)
-    // - nodehandle: depends on DESC/ASC
+    // - name and nodehandle: depend on DESC/ASC (nodehandle makes the order total, so
+    //   keyset paging can tell which rows come after any given one)
 
-    static const std::string nameSort = "name COLLATE NATURALNOCASE";
+    static const std::string nameSort = "namesortkey";
     // clang-format off
     static const std::string fieldToSort =
         "WHEN " + std::to_string(DEFAULT_ASC)  + " THEN "+ nameSort + " \n"
@@ -2572,10 +4192,117 @@ std::string OrderByClause::get(int order, int sqlParamIndex)
     static const std::string typeSort = "type DESC";
     const std::string attrSort = "CASE ?" + std::to_string(sqlParamIndex) + " " + fieldToSort +
                                  "END " + boolToDesc[directions[0]];
-    const std::string tiebreaker = nameSort + " " + boolToDesc[directions[1]];
+    const std::string tiebreaker = nameSort + " " + boolToDesc[directions[1]] + ", nodehandle " + boolToDesc[directions[1]];
     return typeSort + ", \n" + attrSort + ", \n" + tiebreaker;
 }
 
+std::string OrderByClause::getKeysetOrder(int order)
+{
+    static const std::string nameSort = "namesortkey";
+    static const std::array<std::string, 2> boolToDesc{"", " DESC"};
+
+    const std::bitset<2> directions = getDescendingDirs(order);
+    const std::string tiebreaker = nameSort + boolToDesc[directions[1]] + ", nodehandle" + boolToDesc[directions[1]];
+
+    const char* attribute = getAttributeColumn(order);
+    return attribute ? attribute + boolToDesc[directions[0]] + ", " + tiebreaker : tiebreaker;
+}
+
+std::string OrderByClause::getAfterKey(int order, int sqlParamIndex)
+{
+    static const std::array<std::string, 2> after{">", "<"};
+
+    const std::bitset<2> directions = getDescendingDirs(order);
+    const std::string attrParam = "?" + std::to_string(sqlParamIndex);
+    const std::string nameParam = "?" + std::to_string(sqlParamIndex + 1);
+    const std::string handleParam = "?" + std::to_string(sqlParamIndex + 2);
+    const std::string tiebreaker = "(namesortkey, nodehandle) " + after[directions[1]] +
+                                   " (" + nameParam + ", " + handleParam + ")";
+
+    const char* attribute = getAttributeColumn(order);
+    if (!attribute)
+    {
+        return tiebreaker;
+    }
+
+    if (directions[0] == directions[1])
+    {
+        // a row value comparison is resolved as a range of the index
+        return std::string("(") + attribute + ", namesortkey, nodehandle) " + after[directions[1]] +
+               " (" + attrParam + ", " + nameParam + ", " + handleParam + ")";
+    }
+
+    // fav and label: mixed directions can't be expressed as a row value, but the first term
+    // still limits the range of the index
+    return std::string("(") + attribute + " " + after[directions[0]] + "= " + attrParam + " AND (" +
+           attribute + " " + after[directions[0]] + " " + attrParam + " OR " + tiebreaker + "))";
+}
+
+int OrderByClause::bindKey(sqlite3_stmt* stmt, int order, int sqlParamIndex, const NodeView& key)
+{
+    int sqlResult = SQLITE_OK;
+    switch (order)
+    {
+        case SIZE_ASC:
+        case SIZE_DESC:
+            sqlResult = sqlite3_bind_int64(stmt, sqlParamIndex, key.mSize);
+            break;
+        case CTIME_ASC:
+        case CTIME_DESC:
+            sqlResult = sqlite3_bind_int64(stmt, sqlParamIndex, key.mCtime);
+            break;
+        case MTIME_ASC:
+        case MTIME_DESC:
+            sqlResult = sqlite3_bind_int64(stmt, sqlParamIndex, key.mMtime);
+            break;
+        case LABEL_ASC:
+        case LABEL_DESC:
+            sqlResult = sqlite3_bind_int(stmt, sqlParamIndex, key.mLabel);
+            break;
+        case FAV_ASC:
+        case FAV_DESC:
+            sqlResult = sqlite3_bind_int(stmt, sqlParamIndex, key.mFav);
+            break;
+        default:
+            // not used by the name orders (see getAfterKey())
+            sqlResult = sqlite3_bind_null(stmt, sqlParamIndex);
+            break;
+    }
+
+    const std::string nameKey = naturalsorting_key(key.mName.c_str());
+    if (sqlResult == SQLITE_OK &&
+        (sqlResult = sqlite3_bind_blob(stmt, sqlParamIndex + 1, nameKey.data(), static_cast<int>(nameKey.size()), SQLITE_TRANSIENT)) == SQLITE_OK)
+    {
+        sqlResult = sqlite3_bind_int64(stmt, sqlParamIndex + 2, key.mHandle.as8byte());
+    }
+
+    return sqlResult;
+}
+
+const char* OrderByClause::getAttributeColumn(int order)
+{
+    switch (order)
+    {
+        case SIZE_ASC:
+        case SIZE_DESC:
+            return "size";
+        case CTIME_ASC:
+        case CTIME_DESC:
+            return "ctime";
+        case MTIME_ASC:
+        case MTIME_DESC:
+            return "mtime";
+        case LABEL_ASC:
+        case LABEL_DESC:
+            return "label";
+        case FAV_ASC:
+        case FAV_DESC:
+            return "fav";
+        default:
+            return nullptr;
+    }
+}
+
 size_t OrderByClause::getId(int order)
 {
     std::bitset<2> dirs = getDescendingDirs(order);
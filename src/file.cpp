@@ -423,15 +423,13 @@ void File::sendPutnodesOfUpload(MegaClient* client, UploadHandle fileAttrMatchHa
             }
         }
 
-        client->reqs.add(new CommandPutNodes(client,
-                                             th, NULL,
-                                             mVersioningOption,
-                                             std::move(newnodes),
-                                             tag,
-                                             source,
-                                             nullptr,
-                                             std::move(completion),
-                                             canChangeVault));
+        client->putnodesCoalesced(th,
+                                  mVersioningOption,
+                                  std::move(newnodes),
+                                  tag,
+                                  source,
+                                  canChangeVault,
+                                  std::move(completion));
     }
 }
 
@@ -484,15 +482,13 @@ void File::sendPutnodesToCloneNode(MegaClient* client, Node* nodeToClone,
         NodeHandle th = h;
         assert(syncxfer);
         newnode->ovhandle = ovHandle;
-        client->reqs.add(new CommandPutNodes(client,
-                                             th, NULL,
-                                             mVersioningOption,
-                                             std::move(newnodes),
-                                             tag,
-                                             source,
-                                             nullptr,
-                                             std::move(completion),
-                                             canChangeVault));
+        client->putnodesCoalesced(th,
+                                  mVersioningOption,
+                                  std::move(newnodes),
+                                  tag,
+                                  source,
+                                  canChangeVault,
+                                  std::move(completion));
     }
 }
 
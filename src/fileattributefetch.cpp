@@ -186,4 +186,65 @@ void FileAttributeFetchChannel::failed()
         }
     }
 }
+
+FileAttributeMemoryCache::FileAttributeMemoryCache(size_t maxSize)
+    : mMaxSize(maxSize)
+{
+}
+
+const string* FileAttributeMemoryCache::get(handle h, fatype type, const string& fileattrstring)
+{
+    auto it = mEntries.find(Key(h, type));
+    if (it == mEntries.end())
+    {
+        return nullptr;
+    }
+
+    if (it->second.fileattrstring != fileattrstring)
+    {
+        // the attributes of the node have changed
+        erase(it);
+        return nullptr;
+    }
+
+    mLru.splice(mLru.begin(), mLru, it->second.lru);
+    return &it->second.data;
+}
+
+void FileAttributeMemoryCache::put(handle h, fatype type, const string& fileattrstring, string data)
+{
+    if (data.size() > mMaxSize)
+    {
+        return;
+    }
+
+    auto it = mEntries.find(Key(h, type));
+    if (it != mEntries.end())
+    {
+        erase(it);
+    }
+
+    while (mSize + data.size() > mMaxSize)
+    {
+        erase(mEntries.find(mLru.back()));
+    }
+
+    mSize += data.size();
+    mLru.push_front(Key(h, type));
+    mEntries.emplace(Key(h, type), Entry{ fileattrstring, std::move(data), mLru.begin() });
+}
+
+void FileAttributeMemoryCache::clear()
+{
+    mEntries.clear();
+    mLru.clear();
+    mSize = 0;
+}
+
+void FileAttributeMemoryCache::erase(std::map<Key, Entry>::iterator it)
+{
+    mSize -= it->second.data.size();
+    mLru.erase(it->second.lru);
+    mEntries.erase(it);
+}
 } // namespace
@@ -29,6 +29,11 @@ namespace {
 
 constexpr int MAXFULL = 8192;
 
+// The samples of large files that are closer than a page are read together, up to this much:
+// reading them one by one would fetch the same pages from the disk anyway
+constexpr m_off_t SAMPLE_COALESCE_GAP = 4096;
+constexpr m_off_t SAMPLE_COALESCE_MAX = 65536;
+
 } // anonymous
 
 namespace mega {
@@ -189,24 +194,53 @@ bool FileFingerprint::genfingerprint(FileAccess* fa, bool ignoremtime)
     {
         // large file: sparse coverage, four sparse CRC32s
         HashCRC32 crc32;
-        byte block[4 * sizeof crc];
-        const unsigned blocks = MAXFULL / unsigned(sizeof block * crc.size());
+        const m_off_t blockSize = 4 * sizeof crc;
+        const unsigned blocks = MAXFULL / unsigned(blockSize * crc.size());
+        const unsigned samples = unsigned(crc.size()) * blocks;
+
+        auto sampleOffset = [this, blockSize, samples](unsigned sample)
+        {
+            return (size - blockSize) * sample / (samples - 1);
+        };
+
+        // the samples read so far, from runStart to runEnd in the file
+        std::vector<byte> run;
+        m_off_t runStart = 0;
+        m_off_t runEnd = 0;
 
         for (unsigned i = 0; i < crc.size(); i++)
         {
             for (unsigned j = 0; j < blocks; j++)
             {
-                if (!fa->frawread(block, sizeof block,
-                                  (size - sizeof block)
-                                  * (i * blocks + j)
-                                  / (crc.size() * blocks - 1), true, FSLogging::logOnError))
+                unsigned sample = i * blocks + j;
+                m_off_t offset = sampleOffset(sample);
+
+                if (offset + blockSize > runEnd)
                 {
-                    size = -1;
-                    fa->closef();
-                    return true;
+                    runStart = offset;
+                    runEnd = offset + blockSize;
+
+                    for (unsigned next = sample + 1; next < samples; next++)
+                    {
+                        m_off_t nextOffset = sampleOffset(next);
+                        if (nextOffset - runEnd > SAMPLE_COALESCE_GAP
+                            || nextOffset + blockSize - runStart > SAMPLE_COALESCE_MAX)
+                        {
+                            break;
+                        }
+                        runEnd = nextOffset + blockSize;
+                    }
+
+                    run.resize(size_t(runEnd - runStart));
+                    if (!fa->frawread(run.data(), unsigned(run.size()), runStart, true, FSLogging::logOnError))
+                    {
+                        size = -1;
+                        fa->closef();
+                        return true;
+                    }
                 }
 
-                crc32.add(block, sizeof block);
+                crc32.add(run.data() + (offset - runStart), unsigned(blockSize));
             }
 
             crc32.get((byte*)&crcval);
@@ -123,6 +123,57 @@ UnicodeCodepointIterator<CharT> skipPrefix(const UnicodeCodepointIterator<CharT>
 
 #endif // _WIN32
 
+// Plain ASCII strings are compared unit by unit, with no decoding, while there are no escapes to decode.
+// Returns false, for the full comparison, if it finds anything else before the result is known.
+template<typename CharT, typename CharU>
+bool compareAscii(const std::basic_string<CharT>& s1, bool unescaping1,
+                  const std::basic_string<CharU>& s2, bool unescaping2,
+                  bool caseInsensitive, int& result)
+{
+#ifdef _WIN32
+    // prefixes such as \\?\ are skipped by the full comparison
+    if ((!s1.empty() && s1[0] == '\\') || (!s2.empty() && s2[0] == '\\'))
+    {
+        return false;
+    }
+#endif // _WIN32
+
+    size_t length = std::min(s1.size(), s2.size());
+    for (size_t i = 0; i < length; ++i)
+    {
+        auto c1 = static_cast<typename std::make_unsigned<CharT>::type>(s1[i]);
+        auto c2 = static_cast<typename std::make_unsigned<CharU>::type>(s2[i]);
+
+        if (c1 >= 0x80 || c2 >= 0x80
+            || (unescaping1 && c1 == escapeChar)
+            || (unescaping2 && c2 == escapeChar))
+        {
+            return false;
+        }
+
+        if (c1 != c2)
+        {
+            int u1 = static_cast<int>(c1);
+            int u2 = static_cast<int>(c2);
+
+            if (caseInsensitive)
+            {
+                if (u1 >= 'a' && u1 <= 'z') u1 -= 'a' - 'A';
+                if (u2 >= 'a' && u2 <= 'z') u2 -= 'a' - 'A';
+            }
+
+            if (u1 != u2)
+            {
+                result = u1 - u2;
+                return true;
+            }
+        }
+    }
+
+    result = s1.size() == s2.size() ? 0 : s1.size() < s2.size() ? -1 : 1;
+    return true;
+}
+
 // the case when the strings are over different character types (just uses match())
 template<typename CharT, typename CharU, typename UnaryOperation>
 int compareUtf(UnicodeCodepointIterator<CharT> first1, bool unescaping1,
@@ -361,6 +412,12 @@ bool fsfp_tracker_t::remove(const fsfp_t& id)
 
 int compareUtf(const string& s1, bool unescaping1, const string& s2, bool unescaping2, bool caseInsensitive)
 {
+    int result;
+    if (detail::compareAscii(s1, unescaping1, s2, unescaping2, caseInsensitive, result))
+    {
+        return result;
+    }
+
     return detail::compareUtf(
                 unicodeCodepointIterator(s1), unescaping1,
                 unicodeCodepointIterator(s2), unescaping2,
@@ -369,6 +426,12 @@ int compareUtf(const string& s1, bool unescaping1, const string& s2, bool unesca
 
 int compareUtf(const string& s1, bool unescaping1, const LocalPath& s2, bool unescaping2, bool caseInsensitive)
 {
+    int result;
+    if (detail::compareAscii(s1, unescaping1, s2.localpath, unescaping2, caseInsensitive, result))
+    {
+        return result;
+    }
+
     return detail::compareUtf(
         unicodeCodepointIterator(s1), unescaping1,
         unicodeCodepointIterator(s2.localpath), unescaping2,
@@ -377,6 +440,12 @@ int compareUtf(const string& s1, bool unescaping1, const LocalPath& s2, bool une
 
 int compareUtf(const LocalPath& s1, bool unescaping1, const string& s2, bool unescaping2, bool caseInsensitive)
 {
+    int result;
+    if (detail::compareAscii(s1.localpath, unescaping1, s2, unescaping2, caseInsensitive, result))
+    {
+        return result;
+    }
+
     return detail::compareUtf(
         unicodeCodepointIterator(s1.localpath), unescaping1,
         unicodeCodepointIterator(s2), unescaping2,
@@ -385,6 +454,12 @@ int compareUtf(const LocalPath& s1, bool unescaping1, const string& s2, bool une
 
 int compareUtf(const LocalPath& s1, bool unescaping1, const LocalPath& s2, bool unescaping2, bool caseInsensitive)
 {
+    int result;
+    if (detail::compareAscii(s1.localpath, unescaping1, s2.localpath, unescaping2, caseInsensitive, result))
+    {
+        return result;
+    }
+
     return detail::compareUtf(
         unicodeCodepointIterator(s1.localpath), unescaping1,
         unicodeCodepointIterator(s2.localpath), unescaping2,
@@ -947,6 +1022,9 @@ void LocalPath::utf8_normalize(string* filename)
 {
     if (!filename) return;
 
+    // NFC leaves ASCII as it is
+    if (Utils::isAscii(*filename)) return;
+
     const char* cfilename = filename->c_str();
     size_t fnsize = filename->size();
     string result;
@@ -999,6 +1077,17 @@ handle FileSystemAccess::fsidOf(const LocalPath& path, bool follow, bool skipcas
     return UNDEF;
 }
 
+bool FileSystemAccess::fingerprintScannedFile(const LocalPath& path, FileFingerprint& fingerprint)
+{
+    auto fileAccess = newfileaccess();
+
+    if (!fileAccess->fopen(path, true, false, FSLogging::logOnError))
+        return false;
+
+    fingerprint.genfingerprint(fileAccess.get());
+    return true;
+}
+
 #ifdef ENABLE_SYNC
 
 bool FileSystemAccess::initFilesystemNotificationSystem()
@@ -1059,7 +1148,7 @@ void DirNotify::notify(NotificationDeque& q, LocalNode* l, Notification::ScanReq
     q.pushBack(std::move(n));
 }
 
-DirNotify* FileSystemAccess::newdirnotify(LocalNode&, const LocalPath& rootPath, Waiter*)
+DirNotify* FileSystemAccess::newdirnotify(LocalNode&, const LocalPath& rootPath, Waiter*, const DirNotify::ResumePoint&)
 {
     return new DirNotify(rootPath);
 }
@@ -2426,10 +2515,10 @@ ScanService::~ScanService()
     }
 }
 
-auto ScanService::queueScan(LocalPath targetPath, handle expectedFsid, bool followSymlinks, map<LocalPath, FSNode>&& priorScanChildren, shared_ptr<Waiter> waiter) -> RequestPtr
+auto ScanService::queueScan(LocalPath targetPath, handle expectedFsid, bool followSymlinks, map<LocalPath, FSNode>&& priorScanChildren, shared_ptr<Waiter> waiter, uint64_t volume, std::set<LocalPath>&& recomputeChildren) -> RequestPtr
 {
     // Create a request to represent the scan.
-    auto request = std::make_shared<ScanRequest>(std::move(waiter), followSymlinks, targetPath, expectedFsid, std::move(priorScanChildren));
+    auto request = std::make_shared<ScanRequest>(std::move(waiter), followSymlinks, targetPath, expectedFsid, std::move(priorScanChildren), volume, std::move(recomputeChildren));
 
     // Queue request for processing.
     mWorker->queue(request);
@@ -2441,43 +2530,30 @@ ScanService::ScanRequest::ScanRequest(shared_ptr<Waiter> waiter,
     bool followSymLinks,
     LocalPath targetPath,
     handle expectedFsid,
-    map<LocalPath, FSNode>&& priorScanChildren)
+    map<LocalPath, FSNode>&& priorScanChildren,
+    uint64_t volume,
+    std::set<LocalPath>&& recomputeChildren)
     : mWaiter(waiter)
     , mScanResult(SCAN_INPROGRESS)
     , mFollowSymLinks(followSymLinks)
     , mKnown(std::move(priorScanChildren))
+    , mRecompute(std::move(recomputeChildren))
     , mResults()
     , mTargetPath(std::move(targetPath))
     , mExpectedFsid(expectedFsid)
+    , mVolume(volume)
 {
 }
 
-ScanService::Worker::Worker(size_t numThreads)
+ScanService::Worker::Worker(size_t numThreadsPerVolume)
     : mFsAccess(new FSACCESS_CLASS())
-    , mPending()
+    , mNumThreadsPerVolume(numThreadsPerVolume)
+    , mVolumes()
     , mPendingLock()
-    , mPendingNotifier()
-    , mThreads()
 {
     // Always at least one thread.
-    assert(numThreads > 0);
-
-    LOG_debug << "Starting ScanService worker...";
+    assert(numThreadsPerVolume > 0);
 
-    // Start the threads.
-    while (numThreads--)
-    {
-        try
-        {
-            mThreads.emplace_back([this]() { loop(); });
-        }
-        catch (std::system_error& e)
-        {
-            LOG_err << "Failed to start worker thread: " << e.what();
-        }
-    }
-
-    LOG_debug << mThreads.size() << " worker thread(s) started.";
     LOG_debug << "ScanService worker started.";
 }
 
@@ -2488,18 +2564,25 @@ ScanService::Worker::~Worker()
     // Queue the 'terminate' sentinel.
     {
         std::unique_lock<std::mutex> lock(mPendingLock);
-        mPending.emplace_back();
-    }
+        for (auto& volume : mVolumes)
+        {
+            volume.second->mPending.emplace_back();
 
-    // Wake any sleeping threads.
-    mPendingNotifier.notify_all();
+            // Wake any sleeping threads.
+            volume.second->mPendingNotifier.notify_all();
+        }
+    }
 
     LOG_debug << "Waiting for worker thread(s) to terminate...";
 
     // Wait for the threads to terminate.
-    for (auto& thread : mThreads)
+    // No need to lock: there can't be new volumes while we're being destroyed.
+    for (auto& volume : mVolumes)
     {
-        thread.join();
+        for (auto& thread : volume.second->mThreads)
+        {
+            thread.join();
+        }
     }
 
     LOG_debug << "ScanService worker stopped.";
@@ -2507,50 +2590,90 @@ ScanService::Worker::~Worker()
 
 void ScanService::Worker::queue(ScanRequestPtr request)
 {
-    // Queue the request.
+    std::unique_lock<std::mutex> lock(mPendingLock);
+
+    auto& volume = mVolumes[request->mVolume];
+    if (!volume)
     {
-        std::unique_lock<std::mutex> lock(mPendingLock);
-        mPending.emplace_back(std::move(request));
+        volume.reset(new Volume());
+
+        // Start the threads for this volume.
+        for (size_t i = 0; i < mNumThreadsPerVolume; ++i)
+        {
+            try
+            {
+                Volume* v = volume.get();
+                volume->mThreads.emplace_back([this, v]() { loop(*v); });
+            }
+            catch (std::system_error& e)
+            {
+                LOG_err << "Failed to start worker thread: " << e.what();
+            }
+        }
+
+        LOG_debug << volume->mThreads.size() << " worker thread(s) started for volume " << request->mVolume;
+    }
+
+    if (volume->mThreads.empty())
+    {
+        // Process it right here rather than leaving it pending forever.
+        lock.unlock();
+        unsigned nFingerprinted = 0;
+        request->mScanResult = scan(request, nFingerprinted, nullptr);
+        request->mWaiter->notify();
+        return;
     }
 
+    // Queue the request.
+    volume->mPending.push_back(Task{std::move(request), nullptr});
+
     // Tell the lucky thread it has something to do.
-    mPendingNotifier.notify_one();
+    volume->mPendingNotifier.notify_one();
 }
 
-void ScanService::Worker::loop()
+void ScanService::Worker::loop(Volume& volume)
 {
     // We're ready when we have some work to do.
-    auto ready = [this]() { return !mPending.empty(); };
+    auto ready = [&volume]() { return !volume.mPending.empty(); };
 
     for ( ; ; )
     {
-        ScanRequestPtr request;
+        Task task;
 
         {
             // Wait for something to do.
             std::unique_lock<std::mutex> lock(mPendingLock);
-            mPendingNotifier.wait(lock, ready);
+            volume.mPendingNotifier.wait(lock, ready);
 
             assert(ready()); // condition variable should have taken care of this
 
             // Are we being told to terminate?
-            if (!mPending.front())
+            if (!volume.mPending.front().mScan && !volume.mPending.front().mFingerprints)
             {
                 // Bail, don't deque the sentinel.
                 return;
             }
 
-            request = std::move(mPending.front());
-            mPending.pop_front();
+            task = std::move(volume.mPending.front());
+            volume.mPending.pop_front();
         }
 
+        // Are we helping another thread with its fingerprints?
+        if (task.mFingerprints)
+        {
+            fingerprint(*task.mFingerprints);
+            continue;
+        }
+
+        auto request = std::move(task.mScan);
+
         LOG_verbose << "Directory scan begins: " << request->mTargetPath;
         using namespace std::chrono;
         auto scanStart = high_resolution_clock::now();
 
         // Process the request.
         unsigned nFingerprinted = 0;
-        auto result = scan(request, nFingerprinted);
+        auto result = scan(request, nFingerprinted, &volume);
         auto scanEnd = high_resolution_clock::now();
 
         if (result == SCAN_SUCCESS)
@@ -2570,27 +2693,145 @@ void ScanService::Worker::loop()
     }
 }
 
-// Really we only have one worker despite the vector of threads - maybe we should just have one
-// regardless of multiple clients too - there is only one filesystem after all (but not singleton!!)
+// One worker is shared by all the clients - there is only one filesystem after all (but not singleton!!)
 CodeCounter::ScopeStats ScanService::syncScanTime = { "folderScan" };
 
-auto ScanService::Worker::scan(ScanRequestPtr request, unsigned& nFingerprinted) -> ScanResult
+auto ScanService::Worker::scan(ScanRequestPtr request, unsigned& nFingerprinted, Volume* volume) -> ScanResult
 {
     CodeCounter::ScopeTimer rst(syncScanTime);
 
+    std::vector<size_t> unfingerprinted;
+
     auto result = mFsAccess->directoryScan(request->mTargetPath,
         request->mExpectedFsid,
         request->mKnown,
         request->mResults,
         request->mFollowSymLinks,
-        nFingerprinted);
+        nFingerprinted,
+        &unfingerprinted);
 
     // No need to keep this data around anymore.
     request->mKnown.clear();
 
+    if (result != SCAN_SUCCESS)
+        return result;
+
+    // Don't read files again if we fingerprinted them recently.
+    auto& results = request->mResults;
+
+    unfingerprinted.erase(std::remove_if(unfingerprinted.begin(), unfingerprinted.end(), [&](size_t i) {
+        return !request->mRecompute.count(results[i].localname)
+               && mFingerprintCache.lookup(request->mVolume, results[i]);
+    }), unfingerprinted.end());
+
+    request->mRecompute.clear();
+
+    if (unfingerprinted.empty())
+        return result;
+
+    auto batch = std::make_shared<FingerprintBatch>(request, std::move(unfingerprinted));
+
+    // Let the volume's other threads help, so a folder with many new files
+    // isn't read one file at a time (the number of threads bounds the I/O).
+    if (volume && batch->mIndices.size() > 1)
+    {
+        std::lock_guard<std::mutex> lock(mPendingLock);
+
+        auto numHelpers = std::min(volume->mThreads.size(), batch->mIndices.size()) - 1;
+
+        for (size_t i = 0; i < numHelpers; ++i)
+        {
+            // Ahead of other scans: this one's already under way.
+            volume->mPending.push_front(Task{nullptr, batch});
+        }
+
+        volume->mPendingNotifier.notify_all();
+    }
+
+    fingerprint(*batch);
+
+    // Wait for the helpers to finish the files they claimed.
+    {
+        std::unique_lock<std::mutex> lock(batch->mDoneLock);
+        batch->mDoneNotifier.wait(lock, [&batch]() { return batch->mDone == batch->mIndices.size(); });
+    }
+
+    nFingerprinted += batch->mFingerprinted;
+
     return result;
 }
 
+void ScanService::Worker::fingerprint(FingerprintBatch& batch)
+{
+    auto& request = *batch.mRequest;
+
+    for (auto n = batch.mNext++; n < batch.mIndices.size(); n = batch.mNext++)
+    {
+        auto& node = request.mResults[batch.mIndices[n]];
+
+        auto path = request.mTargetPath;
+        path.appendWithSeparator(node.localname, false);
+
+        if (mFsAccess->fingerprintScannedFile(path, node.fingerprint))
+        {
+            ++batch.mFingerprinted;
+            mFingerprintCache.add(request.mVolume, node);
+        }
+
+        std::lock_guard<std::mutex> lock(batch.mDoneLock);
+
+        if (++batch.mDone == batch.mIndices.size())
+            batch.mDoneNotifier.notify_all();
+    }
+}
+
+ScanService::Worker::FingerprintBatch::FingerprintBatch(ScanRequestPtr request, std::vector<size_t>&& indices)
+    : mRequest(std::move(request))
+    , mIndices(std::move(indices))
+    , mNext(0)
+    , mFingerprinted(0)
+{
+}
+
+void ScanService::Worker::FingerprintCache::add(uint64_t volume, const FSNode& node)
+{
+    // Without these the key wouldn't identify the file.
+    if (!volume || node.fsid == UNDEF || !node.fingerprint.isvalid)
+        return;
+
+    Key key(volume, node.fsid, node.fingerprint.size, node.fingerprint.mtime);
+
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (!mEntries.insert_or_assign(key, node.fingerprint).second)
+        return;
+
+    mOrder.push_back(key);
+
+    while (mOrder.size() > MAX_CACHED_FINGERPRINTS)
+    {
+        mEntries.erase(mOrder.front());
+        mOrder.pop_front();
+    }
+}
+
+bool ScanService::Worker::FingerprintCache::lookup(uint64_t volume, FSNode& node)
+{
+    if (!volume || node.fsid == UNDEF)
+        return false;
+
+    Key key(volume, node.fsid, node.fingerprint.size, node.fingerprint.mtime);
+
+    std::lock_guard<std::mutex> lock(mLock);
+
+    auto it = mEntries.find(key);
+    if (it == mEntries.end())
+        return false;
+
+    node.fingerprint = it->second;
+    return true;
+}
+
 unique_ptr<FSNode> FSNode::fromFOpened(FileAccess& fa, const LocalPath& fullPath, FileSystemAccess& fsa)
 {
     unique_ptr<FSNode> result(new FSNode);
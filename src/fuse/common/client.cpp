@@ -170,6 +170,30 @@ Error Client::move(NodeHandle source,
     return waitFor(notifier->get_future());
 }
 
+ErrorOr<std::string> Client::partialDownload(NodeHandle handle,
+                                             m_off_t offset,
+                                             m_off_t length)
+{
+    // Sanity.
+    assert(!handle.isUndef());
+    assert(offset >= 0);
+    assert(length > 0);
+
+    // So we can wait for the client's result.
+    auto notifier = makeSharedPromise<ErrorOr<std::string>>();
+
+    // Transmits the client's result to our notifier.
+    auto downloaded = [notifier](ErrorOr<std::string> result) {
+        notifier->set_value(std::move(result));
+    }; // downloaded
+
+    // Ask the client to download the range.
+    partialDownload(std::move(downloaded), handle, offset, length);
+
+    // Return the client's result to our caller.
+    return waitFor(notifier->get_future());
+}
+
 Error Client::remove(NodeHandle handle)
 {
     // So we can wait for the client's result.
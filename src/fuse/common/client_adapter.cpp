@@ -72,6 +72,42 @@ public:
     void completed(Error result);
 }; // ClientDownload
 
+class ClientPartialDownload
+  : public DirectReadListener
+{
+    // How many times will we retry a failed read?
+    static constexpr int MaxRetries = 8;
+
+    // Called when the client has some of our content.
+    bool onData(byte* buffer, m_off_t length, m_off_t position) override;
+
+    // Called when the read has failed.
+    dstime onFailure(const Error& result, int retry, dstime timeLeft) override;
+
+    // Forwards result to callback and deletes the instance.
+    void completed(ErrorOr<std::string> result);
+
+    // The content we've received so far.
+    std::string mBuffer;
+
+    // Who do we call when we've completed?
+    PartialDownloadCallback mCallback;
+
+    // Which client is performing our read?
+    MegaClient& mClient;
+
+    // How much content do we want?
+    m_off_t mLength;
+
+public:
+    ClientPartialDownload(PartialDownloadCallback callback,
+                          MegaClient& client,
+                          m_off_t length);
+
+    // Begin the read.
+    void begin(Node& node, m_off_t offset);
+}; // ClientPartialDownload
+
 class ClientNodeEvent
   : public NodeEvent
 {
@@ -806,6 +842,54 @@ NodeHandle ClientAdapter::parentHandle(NodeHandle handle) const
     return NodeHandle();
 }
 
+void ClientAdapter::partialDownload(PartialDownloadCallback callback,
+                                    NodeHandle handle,
+                                    m_off_t offset,
+                                    m_off_t length)
+{
+    // Sanity.
+    assert(callback);
+    assert(!handle.isUndef());
+    assert(offset >= 0);
+    assert(length > 0);
+
+    // Asks the client to read part of the file.
+    auto download = [=](PartialDownloadCallback& callback,
+                        const Task& task) {
+        // Client's being torn down.
+        if (task.cancelled())
+            return callback(API_EINCOMPLETE);
+
+        // Try and locate the node to be read.
+        auto node = mClient.nodeByHandle(handle);
+
+        // Node doesn't exist.
+        if (!node)
+            return callback(API_ENOENT);
+
+        // Node's not a file.
+        if (node->type != FILENODE)
+            return callback(API_EARGS);
+
+        // Caller wants content beyond the end of the file.
+        if (offset + length > node->size)
+            return callback(API_EARGS);
+
+        // Instantiate a read for the range.
+        auto download = new ClientPartialDownload(std::move(callback),
+                                                  mClient,
+                                                  length);
+
+        // Read is now owned by the client.
+        download->begin(*node, offset);
+    }; // download
+
+    // Ask the client to read the range.
+    execute(std::bind(std::move(download),
+                      wrap(std::move(callback)),
+                      std::placeholders::_1));
+}
+
 accesslevel_t ClientAdapter::permissions(NodeHandle handle) const
 {
     // Make sure deinitialize(...) waits for this call to complete.
@@ -1146,6 +1230,80 @@ bool ClientDownload::begin(MegaClient& client)
     return false;
 }
 
+bool ClientPartialDownload::onData(byte* buffer,
+                                   m_off_t length,
+                                   m_off_t)
+{
+    // Latch the content we've received.
+    mBuffer.append(reinterpret_cast<const char*>(buffer),
+                   static_cast<std::size_t>(length));
+
+    // We're still waiting for more content.
+    if (static_cast<m_off_t>(mBuffer.size()) < mLength)
+        return true;
+
+    // Transmit our content to the waiter.
+    completed(std::move(mBuffer));
+
+    // Let the client know the read is complete.
+    return false;
+}
+
+dstime ClientPartialDownload::onFailure(const Error& result,
+                                        int retry,
+                                        dstime)
+{
+    // The failure's transient so try again later.
+    if (retry <= MaxRetries
+        && result != API_EINCOMPLETE
+        && !(result == API_ETOOMANY && result.hasExtraInfo()))
+        return retry <= 1 ? 0 : static_cast<dstime>(1 << (retry - 1));
+
+    // Make sure the client forgets about us.
+    mClient.removeAppData(this);
+
+    // Tell waiter that we encountered an error.
+    completed(result ? static_cast<error>(result) : API_EINCOMPLETE);
+
+    // Don't retry the read.
+    return NEVER;
+}
+
+void ClientPartialDownload::completed(ErrorOr<std::string> result)
+{
+    // Tell waiter the read has completed.
+    mCallback(std::move(result));
+
+    // Delete ourselves.
+    delete this;
+}
+
+ClientPartialDownload::ClientPartialDownload(PartialDownloadCallback callback,
+                                             MegaClient& client,
+                                             m_off_t length)
+  : DirectReadListener()
+  , mBuffer()
+  , mCallback(std::move(callback))
+  , mClient(client)
+  , mLength(length)
+{
+    // Sanity.
+    assert(mCallback);
+    assert(mLength > 0);
+
+    // Make sure we have enough space for our content.
+    mBuffer.reserve(static_cast<std::size_t>(mLength));
+}
+
+void ClientPartialDownload::begin(Node& node, m_off_t offset)
+{
+    // Ask the client to read our range.
+    mClient.pread(&node, offset, mLength, this);
+
+    // Make sure the client notices the read.
+    mClient.waiter->notify();
+}
+
 std::shared_ptr<Node> child(MegaClient& client,
                             NodeHandle parent,
                             const std::string& name)
@@ -6,6 +6,7 @@
 #include <sqlite3.h>
 
 #include <mega/fuse/common/badge.h>
+#include <mega/fuse/common/constants.h>
 #include <mega/fuse/common/database.h>
 #include <mega/fuse/common/logging.h>
 #include <mega/fuse/common/query.h>
@@ -20,6 +21,94 @@ namespace fuse
 namespace detail
 {
 
+std::string Database::commit()
+{
+    // No batch to commit.
+    if (!mBatched)
+        return std::string();
+
+    // A batch can't be committed while transactions are active.
+    assert(!mDepth);
+
+    auto message = execute("commit");
+
+    // Couldn't commit the batch: Try again later.
+    if (!message.empty())
+        return message;
+
+    FUSEDebugF("Committed a batch of %zu transaction(s)", mLength);
+
+    mBatched = false;
+    mFlush = false;
+    mLength = 0;
+
+    {
+        std::lock_guard<std::mutex> guard(mCommitterLock);
+
+        // No batch for the committer to look after.
+        mPending = false;
+    }
+
+    mCommitterCV.notify_one();
+
+    return std::string();
+}
+
+void Database::committer()
+{
+    FUSEDebug1("Database committer started");
+
+    std::unique_lock<std::mutex> lock(mCommitterLock);
+
+    while (true)
+    {
+        // Wait for a batch to be opened.
+        mCommitterCV.wait(lock, [&]() {
+            return mPending || mTerminate;
+        });
+
+        // Give the batch some time to grow.
+        if (!mTerminate)
+            mCommitterCV.wait_until(lock,
+                                    mOpened + DatabaseBatchDelay,
+                                    [&]() { return !mPending || mTerminate; });
+
+        // We've been asked to terminate.
+        if (mTerminate)
+            break;
+
+        // Batch's already been committed.
+        if (!mPending)
+            continue;
+
+        // We're looking after this batch.
+        mPending = false;
+
+        // Let transactions proceed while we wait for the database.
+        lock.unlock();
+
+        DatabaseLock guard(*this);
+
+        // Transactions are active: The last to end will commit the batch.
+        auto message = mDepth ? std::string() : commit();
+
+        guard.unlock();
+
+        lock.lock();
+
+        // Couldn't commit the batch: Try again later.
+        if (!message.empty())
+        {
+            FUSEWarningF("Unable to commit batch: %s", message.c_str());
+
+            mOpened = std::chrono::steady_clock::now();
+            mPending = true;
+        }
+    }
+
+    FUSEDebug1("Database committer stopped");
+}
+
 std::string Database::execute(const char* statement)
 {
     assert(mDB);
@@ -47,6 +136,16 @@ Database::Database(const LocalPath& path)
   : Lockable()
   , mDB(nullptr)
   , mPath(path.toPath(false))
+  , mBatched(false)
+  , mDepth(0u)
+  , mFlush(false)
+  , mLength(0u)
+  , mOpened()
+  , mCommitterCV()
+  , mCommitterLock()
+  , mPending(false)
+  , mTerminate(false)
+  , mCommitterThread()
 {
     constexpr auto flags = SQLITE_OPEN_CREATE
                            | SQLITE_OPEN_FULLMUTEX
@@ -87,9 +186,33 @@ Database::Database(const LocalPath& path)
 Database::Database(Database&& other)
   : mDB()
   , mPath()
+  , mBatched(false)
+  , mDepth(0u)
+  , mFlush(false)
+  , mLength(0u)
+  , mOpened()
+  , mCommitterCV()
+  , mCommitterLock()
+  , mPending(false)
+  , mTerminate(false)
+  , mCommitterThread()
 {
+    // The committer refers to other so it can't outlive the move.
+    other.stop();
+
     DatabaseLock guard(other);
 
+    // Can't move a database with active transactions.
+    assert(!other.mDepth);
+
+    // Make sure the moved batch, if any, is on disk.
+    auto message = other.commit();
+
+    if (!message.empty())
+        throw FUSEErrorF("Unable to commit batch: %s: %s",
+                         other.mPath.c_str(),
+                         message.c_str());
+
     mDB = other.mDB;
     mPath = std::move(other.mPath);
 
@@ -98,21 +221,146 @@ Database::Database(Database&& other)
 
 Database::~Database()
 {
+    stop();
+
+    // Make sure the current batch, if any, is on disk.
+    if (mDB)
+    {
+        DatabaseLock guard(*this);
+
+        auto message = commit();
+
+        if (!message.empty())
+            FUSEWarningF("Unable to commit batch: %s: %s",
+                         mPath.c_str(),
+                         message.c_str());
+    }
+
     sqlite3_close(mDB);
 
     FUSEDebugF("Database closed: %s", mPath.c_str());
 }
 
+std::string Database::begin(Badge<Transaction>)
+{
+    DatabaseLock guard(*this);
+
+    // Open a new batch if necessary.
+    if (!mBatched)
+    {
+        auto message = execute("begin");
+
+        if (!message.empty())
+            return message;
+
+        mBatched = true;
+        mLength = 0;
+
+        {
+            std::lock_guard<std::mutex> lock(mCommitterLock);
+
+            // Let the committer know a batch has been opened.
+            mOpened = std::chrono::steady_clock::now();
+            mPending = true;
+        }
+
+        mCommitterCV.notify_one();
+
+        // Start the committer if it isn't already running.
+        if (!mCommitterThread.joinable())
+            mCommitterThread = std::thread(&Database::committer, this);
+    }
+
+    // Each transaction is a savepoint within the batch.
+    auto message = execute("savepoint txn");
+
+    if (message.empty())
+        ++mDepth;
+
+    return message;
+}
+
+std::string Database::end(Badge<Transaction>,
+                          const char* statement,
+                          bool committed)
+{
+    DatabaseLock guard(*this);
+
+    auto message = execute(statement);
+
+    if (!message.empty())
+        return message;
+
+    assert(mDepth);
+
+    mLength += committed;
+
+    // Other transactions are still active.
+    if (--mDepth)
+        return std::string();
+
+    // Is the batch large or old enough to be committed?
+    auto elapsed = std::chrono::steady_clock::now() - mOpened;
+
+    if (!mFlush
+        && mLength < DatabaseBatchLength
+        && elapsed < DatabaseBatchDelay)
+        return std::string();
+
+    message = commit();
+
+    // The transaction's part of the batch: The batch will be retried.
+    if (!message.empty())
+        FUSEWarningF("Unable to commit batch: %s: %s",
+                     mPath.c_str(),
+                     message.c_str());
+
+    return std::string();
+}
+
 std::string Database::execute(Badge<Transaction>, const char* statement)
 {
     return execute(statement);
 }
 
+void Database::flush()
+{
+    DatabaseLock guard(*this);
+
+    // Transactions are active: The last to end will commit the batch.
+    if (mDepth)
+    {
+        mFlush = true;
+        return;
+    }
+
+    auto message = commit();
+
+    if (!message.empty())
+        FUSEWarningF("Unable to flush database: %s: %s",
+                     mPath.c_str(),
+                     message.c_str());
+}
+
 Query Database::query()
 {
     return Query({}, *mDB);
 }
 
+void Database::stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(mCommitterLock);
+
+        mTerminate = true;
+    }
+
+    mCommitterCV.notify_one();
+
+    if (mCommitterThread.joinable())
+        mCommitterThread.join();
+}
+
 Transaction Database::transaction()
 {
     return Transaction({}, *this);
@@ -23,22 +23,26 @@ static std::size_t currentVersion(Query& query);
 static void downgrade10(Query& query);
 static void downgrade21(Query& query);
 static void downgrade32(Query& query);
+static void downgrade43(Query& query);
 
-static void upgrade01(Query& query);
+void upgrade01(Query& query);
 static void upgrade12(Query& query);
 static void upgrade23(Query& query);
+static void upgrade34(Query& query);
 
 static const std::vector<DowngradeFunction> downgrades = {
     nullptr,
     &downgrade10,
     &downgrade21,
     &downgrade32,
+    &downgrade43,
 }; // downgrades
 
 static const std::vector<UpgradeFunction> upgrades = {
     &upgrade01,
     &upgrade12,
     &upgrade23,
+    &upgrade34,
 }; // upgrades
 
 template<typename Function>
@@ -51,6 +55,9 @@ void DatabaseBuilder::withQuery(Function&& function)
     function(query);
 
     transaction.commit();
+
+    // Make sure the database's schema is on disk.
+    mDatabase.flush();
 }
 
 DatabaseBuilder::DatabaseBuilder(Database& database)
@@ -165,6 +172,12 @@ void downgrade32(Query& query)
     query.execute();
 }
 
+void downgrade43(Query& query)
+{
+    query = "drop table hot_inodes";
+    query.execute();
+}
+
 void upgrade01(Query& query)
 {
     // Tracks all inodes with local state.
@@ -337,6 +350,30 @@ void upgrade23(Query& query)
     query.execute();
 }
 
+void upgrade34(Query& query)
+{
+    // Tracks which inodes are most frequently accessed under each mount.
+    query = "create table hot_inodes ( "
+            "  hits integer "
+            "  constraint nn_hot_inodes_hits "
+            "             not null, "
+            "  id integer "
+            "  constraint nn_hot_inodes_id "
+            "             not null, "
+            "  path text "
+            "  constraint nn_hot_inodes_path "
+            "             not null, "
+            "  constraint fk_hot_inodes_path "
+            "             foreign key (path) "
+            "             references mounts (path) "
+            "             on delete cascade, "
+            "  constraint pk_hot_inodes "
+            "             primary key (path, id) "
+            ")";
+
+    query.execute();
+}
+
 } // fuse
 } // mega
 
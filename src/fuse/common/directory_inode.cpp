@@ -80,6 +80,14 @@ InodeRefVector DirectoryInode::children() const
     return mInodeDB.children(*this);
 }
 
+InodeRefVector DirectoryInode::children(InodeInfoVector& infos) const
+{
+    InodeLock guard(*this);
+
+    // Ask the Inode DB what children we contain and what they look like.
+    return mInodeDB.children(*this, &infos);
+}
+
 DirectoryInodeRef DirectoryInode::directory()
 {
     return DirectoryInodeRef(this);
@@ -1,14 +1,19 @@
+#include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <chrono>
+#include <functional>
 #include <mutex>
 #include <stdexcept>
+#include <string>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 #include <mega/fuse/common/bind_handle.h>
 #include <mega/fuse/common/client.h>
 #include <mega/fuse/common/file_cache.h>
+#include <mega/fuse/common/file_cache_statistics.h>
 #include <mega/fuse/common/file_info.h>
 #include <mega/fuse/common/file_inode.h>
 #include <mega/fuse/common/file_io_context.h>
@@ -16,6 +21,7 @@
 #include <mega/fuse/common/inode_id.h>
 #include <mega/fuse/common/logging.h>
 #include <mega/fuse/common/ref.h>
+#include <mega/fuse/common/task_executor.h>
 #include <mega/fuse/platform/service_context.h>
 
 namespace mega
@@ -23,10 +29,42 @@ namespace mega
 namespace fuse
 {
 
+// What suffix identifies partially downloaded content?
+static const std::string PartialSuffix = ".partial";
+
 static LocalPath cachePath(const Client& client);
 
 static void ensureCachePathExists(Client& client, const LocalPath& path);
 
+// Does this name describe partially downloaded content?
+static bool isPartial(const std::string& name);
+
+void FileCache::checkBudget(FileCacheLock& lock)
+{
+    // Cache's within its budget.
+    if (!overBudget(lock))
+        return;
+
+    // Files are already being evicted.
+    if (mEvicting)
+        return;
+
+    // Evicts files on one of the executor's threads.
+    auto evict = [](Activity&, FileCache& cache, const Task& task) {
+        cache.evict(task);
+    }; // evict
+
+    mEvicting = true;
+
+    // Queue the eviction for execution.
+    mEvictionTask = executor().execute(std::bind(std::move(evict),
+                                                 mActivities.begin(),
+                                                 std::ref(*this),
+                                                 std::placeholders::_1),
+                                       true,
+                                       TASK_PRIORITY_FLUSH);
+}
+
 ErrorOr<FileInfoRef> FileCache::create(const FileExtension& extension,
                                        const LocalPath& path,
                                        InodeID id,
@@ -78,6 +116,88 @@ ErrorOr<FileInfoRef> FileCache::create(const FileExtension& extension,
     return info;
 }
 
+void FileCache::evict(const Task& task)
+{
+    // Convenience.
+    auto& inodeDB = mContext.mInodeDB;
+
+    // Evict files until we're within budget.
+    while (!task.cancelled())
+    {
+        // Which file was least recently used?
+        auto id = ([this]() {
+            // Acquire lock.
+            FileCacheLock guard(*this);
+
+            // Cache's within budget or there's nothing left to evict.
+            if (!overBudget(guard) || mEntries.empty())
+                return InodeID();
+
+            // Return the file's ID to the caller.
+            return mEntries.front().first;
+        })();
+
+        // No file needs to be evicted.
+        if (!id)
+            break;
+
+        // InodeDB will let us know if the file can be evicted.
+        if (inodeDB.evict(id))
+            continue;
+
+        FUSEDebugF("Unable to evict %s from the file cache",
+                   toString(id).c_str());
+
+        // Acquire lock.
+        FileCacheLock guard(*this);
+
+        // File can't be evicted so stop considering it.
+        pin(id, guard);
+    }
+
+    // Acquire lock.
+    FileCacheLock guard(*this);
+
+    // Any future eviction needs to be queued.
+    mEvicting = false;
+}
+
+bool FileCache::evict(const FileExtension& extension, InodeID id)
+{
+    // Acquire lock.
+    FileCacheLock guard(*this);
+
+    // File's in use.
+    if (mContextByID.count(id) || mInfoByID.count(id))
+        return false;
+
+    // Is the file still a candidate for eviction?
+    auto i = mEntryByID.find(id);
+
+    // File's no longer a candidate for eviction.
+    if (i == mEntryByID.end())
+        return false;
+
+    // Latch the file's size.
+    auto size = i->second->second;
+
+    // Couldn't remove the file.
+    if (!client().fsAccess().unlinklocal(path(extension, id)))
+        return false;
+
+    // File's gone so it's no longer a candidate for eviction.
+    pin(id, guard);
+
+    // Update statistics.
+    mEvictedFiles += 1;
+    mEvictedSize  += static_cast<std::uint64_t>(size);
+
+    FUSEDebugF("Evicted %s from the file cache", toString(id).c_str());
+
+    // Let the caller know the file's been evicted.
+    return true;
+}
+
 FileInfoRef FileCache::info(const FileExtension& extension,
                             const FileAccess& fileAccess,
                             InodeID id)
@@ -97,10 +217,43 @@ FileInfoRef FileCache::info(const FileExtension& extension,
     // Add the info to the index.
     i = mInfoByID.emplace(id, std::move(info)).first;
 
+    // File's in use and can't be evicted.
+    pin(id, guard);
+
     // Return a reference to the caller.
     return FileInfoRef(i->second.get());
 }
 
+bool FileCache::overBudget(const FileCacheLock& lock) const
+{
+    // Convenience.
+    auto files = mEntries.size() + mInfoByID.size();
+
+    // Cache's storing too many files.
+    if (mFlags.mMaxFiles && files > mFlags.mMaxFiles)
+        return true;
+
+    // Cache's storing too much content.
+    return mFlags.mMaxSize && size(lock) > mFlags.mMaxSize;
+}
+
+void FileCache::pin(InodeID id, const FileCacheLock&) const
+{
+    // Is the file a candidate for eviction?
+    auto i = mEntryByID.find(id);
+
+    // File isn't a candidate for eviction.
+    if (i == mEntryByID.end())
+        return;
+
+    // File's content no longer counts toward mUnpinnedSize.
+    mUnpinnedSize -= static_cast<std::uint64_t>(i->second->second);
+
+    // File's no longer a candidate for eviction.
+    mEntries.erase(i->second);
+    mEntryByID.erase(i);
+}
+
 void FileCache::remove(const FileIOContext& context,
                        FileCacheLock lock)
 {
@@ -140,6 +293,12 @@ void FileCache::remove(const FileInfo& info, FileCacheLock lock)
     // Remove the info from the index.
     mInfoByID.erase(i);
 
+    // File's no longer in use and can be evicted.
+    unpin(ptr->id(), ptr->size(), lock);
+
+    // Make sure the cache stays within its budget.
+    checkBudget(lock);
+
     // Release the lock.
     lock.unlock();
 
@@ -147,11 +306,50 @@ void FileCache::remove(const FileInfo& info, FileCacheLock lock)
     ptr.reset();
 }
 
-FileCache::FileCache(platform::ServiceContext& context)
+std::uint64_t FileCache::size(const FileCacheLock&) const
+{
+    // How much content is stored in files that aren't in use?
+    auto size = mUnpinnedSize;
+
+    // How much content is stored in files that are in use?
+    for (auto& i : mInfoByID)
+        size += static_cast<std::uint64_t>(i.second->size());
+
+    // Return size to caller.
+    return size;
+}
+
+void FileCache::unpin(InodeID id, m_off_t size, const FileCacheLock& lock)
+{
+    // Make sure the file's only described once.
+    pin(id, lock);
+
+    // File's now the most recently used candidate for eviction.
+    auto i = mEntries.emplace(mEntries.end(), id, size);
+
+    mEntryByID.emplace(id, i);
+
+    // File's content now counts toward mUnpinnedSize.
+    mUnpinnedSize += static_cast<std::uint64_t>(size);
+}
+
+FileCache::FileCache(const FileCacheFlags& flags,
+                     platform::ServiceContext& context)
   : Lockable()
+  , mActivities()
+  , mEvictedFiles(0u)
+  , mEvictedSize(0u)
+  , mEvicting(false)
+  , mEvictionTask()
+  , mEntries()
+  , mEntryByID()
+  , mFlags(flags)
+  , mFlushesByMount()
+  , mFlushesLock()
   , mContextByID()
   , mInfoByID()
   , mRemoved()
+  , mUnpinnedSize(0u)
   , mCachePath(cachePath(context.client()))
   , mContext(context)
 {
@@ -170,6 +368,21 @@ FileCache::~FileCache()
 
 void FileCache::cancel()
 {
+    // Make sure no further evictions take place.
+    ([this]() {
+        // Acquire lock.
+        FileCacheLock guard(*this);
+
+        // Cache no longer has a budget.
+        mFlags = FileCacheFlags();
+
+        // Cancel any pending eviction.
+        mEvictionTask.cancel();
+    })();
+
+    // Wait for any eviction in progress to complete.
+    mActivities.waitUntilIdle();
+
     // What contexts currently exist?
     auto contexts = ([this]() {
         // Acquire lock.
@@ -307,6 +520,12 @@ void FileCache::current()
     LocalPath name;
     nodetype_t type;
 
+    // Describes a file that may be a candidate for eviction.
+    using Candidate = std::tuple<m_time_t, InodeID, m_off_t>;
+
+    // Files we've kept, along with when they were last modified.
+    std::vector<Candidate> candidates;
+
     // Iterate over each file the cache.
     while (dirAccess->dnext(path, name, false, &type))
     {
@@ -321,9 +540,33 @@ void FileCache::current()
         if (!id)
             continue;
 
+        // Entry contains partially downloaded content.
+        if (isPartial(name.toPath(false)))
+        {
+            // Acquire lock.
+            FileCacheLock guard(*this);
+
+            // Content's still being used by the inode's context.
+            if (mContextByID.count(id))
+                continue;
+        }
         // Inode's still present in the database.
-        if (mContext.mInodeDB.exists(id))
+        else if (mContext.mInodeDB.exists(id))
+        {
+            ScopedLengthRestore restorer(path);
+
+            path.appendWithSeparator(name, true);
+
+            auto fileAccess = fsAccess.newfileaccess(false);
+
+            // Latch the file's size and modification time.
+            if (fileAccess->fopen(path, true, false, FSLogging::eNoLogging))
+                candidates.emplace_back(fileAccess->mtime,
+                                        id,
+                                        fileAccess->size);
+
             continue;
+        }
 
         ScopedLengthRestore restorer(path);
 
@@ -334,6 +577,49 @@ void FileCache::current()
             FUSEWarningF("Couldn't remove stale cache file: %s",
                          path.toPath(false).c_str());
     }
+
+    // Least recently modified files are evicted first.
+    std::sort(candidates.begin(), candidates.end());
+
+    // Acquire lock.
+    FileCacheLock guard(*this);
+
+    // Record which files are candidates for eviction.
+    for (auto& candidate : candidates)
+    {
+        // Convenience.
+        auto id = std::get<1>(candidate);
+
+        // File's in use or is already a candidate.
+        if (mInfoByID.count(id) || mEntryByID.count(id))
+            continue;
+
+        unpin(id, std::get<2>(candidate), guard);
+    }
+
+    // Make sure the cache stays within its budget.
+    checkBudget(guard);
+}
+
+void FileCache::flags(const FileCacheFlags& flags)
+{
+    // Acquire lock.
+    FileCacheLock guard(*this);
+
+    // Update the cache's budget.
+    mFlags = flags;
+
+    // Make sure the cache stays within its new budget.
+    checkBudget(guard);
+}
+
+FileCacheFlags FileCache::flags() const
+{
+    // Acquire lock.
+    FileCacheLock guard(*this);
+
+    // Return the cache's budget to the caller.
+    return mFlags;
 }
 
 TaskExecutor& FileCache::executor() const
@@ -360,6 +646,44 @@ void FileCache::flush(const Mount& mount, FileInodeRefVector inodes)
     }
 }
 
+void FileCache::flushCompleted(NodeHandle mount)
+{
+    // Acquire lock.
+    std::lock_guard<std::mutex> guard(mFlushesLock);
+
+    // Locate the mount's counter.
+    auto i = mFlushesByMount.find(mount);
+
+    // Sanity.
+    assert(i != mFlushesByMount.end());
+    assert(i->second);
+
+    // Mount has no more flushes in progress.
+    if (!--i->second)
+        mFlushesByMount.erase(i);
+}
+
+bool FileCache::flushStarting(NodeHandle mount)
+{
+    // How many flushes may be in progress on a mount?
+    auto limit = mContext.serviceFlags().mMaxConcurrentFlushes;
+
+    // Acquire lock.
+    std::lock_guard<std::mutex> guard(mFlushesLock);
+
+    // How many flushes are in progress on this mount?
+    auto& count = mFlushesByMount[mount];
+
+    // Mount's already flushing as much as it's allowed to.
+    if (limit && count >= limit)
+        return false;
+
+    // Flush can proceed.
+    ++count;
+
+    return true;
+}
+
 FileInfoRef FileCache::info(const FileExtension& extension,
                             InodeID id,
                             bool inMemoryOnly) const
@@ -396,6 +720,9 @@ FileInfoRef FileCache::info(const FileExtension& extension,
     // Add info to the index.
     i = mInfoByID.emplace(id, std::move(info)).first;
 
+    // File's in use and can't be evicted.
+    pin(id, guard);
+
     // Return info to the caller.
     return FileInfoRef(i->second.get());
 }
@@ -411,6 +738,20 @@ LocalPath FileCache::path(const FileExtension& extension, InodeID id) const
     return path;
 }
 
+LocalPath FileCache::partialPath(InodeID id, NodeHandle handle) const
+{
+    // Content is tagged with its node so that stale readers never collide.
+    auto name = LocalPath::fromRelativePath(toFileName(id)
+                                            + "."
+                                            + toNodeHandle(handle)
+                                            + PartialSuffix);
+    auto path = mCachePath;
+
+    path.appendWithSeparator(name, false);
+
+    return path;
+}
+
 void FileCache::remove(const FileExtension& extension, InodeID id)
 {
     // Sanity.
@@ -430,10 +771,31 @@ void FileCache::remove(const FileExtension& extension, InodeID id)
     if (mInfoByID.count(id))
         return;
 
+    // File's no longer a candidate for eviction.
+    pin(id, guard);
+
     // Try and remove the file.
     client().fsAccess().unlinklocal(path(extension, id));
 }
 
+FileCacheStatistics FileCache::statistics() const
+{
+    // Acquire lock.
+    FileCacheLock guard(*this);
+
+    FileCacheStatistics statistics;
+
+    // Populate statistics.
+    statistics.mEvictedFiles = mEvictedFiles;
+    statistics.mEvictedSize = mEvictedSize;
+    statistics.mFiles = mEntries.size() + mInfoByID.size();
+    statistics.mPinnedFiles = mInfoByID.size();
+    statistics.mSize = size(guard);
+
+    // Return statistics to caller.
+    return statistics;
+}
+
 LocalPath cachePath(const Client& client)
 {
     auto name = LocalPath::fromRelativePath("fuse-cache");
@@ -457,6 +819,18 @@ void ensureCachePathExists(Client& client, const LocalPath& path)
                      path.toPath(false).c_str());
 }
 
+bool isPartial(const std::string& name)
+{
+    // Name's too short to contain the suffix.
+    if (name.size() < PartialSuffix.size())
+        return false;
+
+    // Check whether the name ends with the suffix.
+    return !name.compare(name.size() - PartialSuffix.size(),
+                         PartialSuffix.size(),
+                         PartialSuffix);
+}
+
 } // fuse
 } // mega
 
@@ -2,6 +2,9 @@
 #include <chrono>
 #include <condition_variable>
 #include <future>
+#include <iterator>
+#include <map>
+#include <memory>
 #include <utility>
 
 #include <mega/fuse/common/bind_handle.h>
@@ -83,6 +86,7 @@ class FileIOContext::FlushContext
 
 public:
     FlushContext(FileIOContext& context,
+                 std::string digest,
                  LocalPath logicalPath);
 
     // Try and cancel any upload in progress.
@@ -90,8 +94,105 @@ public:
 
     // Retrieve the upload's result.
     Error result() const;
+
+    // Digest of the content we're uploading.
+    const std::string mDigest;
+
+    // When was the content we're uploading last modified?
+    const m_time_t mModified;
 }; // FlushContext
 
+class FileIOContext::PartialContext
+  : public std::enable_shared_from_this<PartialContext>
+{
+    // Convenience.
+    using RangeMap = std::map<m_off_t, m_off_t>;
+
+    // Granularity of the content we fetch from the cloud.
+    static constexpr m_off_t BlockSize = 1 << 20;
+
+    // Largest range we'll fetch with a single request.
+    static constexpr m_off_t MaxFetchSize = 8 * BlockSize;
+
+    // How far ahead will we read for a sequential reader?
+    static constexpr m_off_t MaxReadahead = 16 * BlockSize;
+
+    // Called when a range has been fetched from the cloud.
+    void fetched(m_off_t begin,
+                 m_off_t end,
+                 ErrorOr<std::string> result);
+
+    // Fetch any part of [begin, end) that isn't present or pending.
+    void fetch(std::unique_lock<std::mutex>& lock,
+               m_off_t begin,
+               m_off_t end);
+
+    // Does [begin, end) overlap any range in ranges?
+    static bool overlaps(const RangeMap& ranges,
+                         m_off_t begin,
+                         m_off_t end);
+
+    // Is [begin, end) present locally?
+    bool present(m_off_t begin, m_off_t end) const;
+
+    // The client we fetch content with.
+    Client& mClient;
+
+    // Signalled when a fetch has completed.
+    std::condition_variable mCV;
+
+    // How we manipulate the sparse file on disk.
+    FileAccessSharedPtr mFileAccess;
+
+    // What node's content are we fetching?
+    const NodeHandle mHandle;
+
+    // Serializes access to instance members.
+    mutable std::mutex mLock;
+
+    // Where is our sparse file located?
+    const LocalPath mPath;
+
+    // Which ranges are being fetched from the cloud?
+    RangeMap mPending;
+
+    // Which ranges are present in the sparse file?
+    RangeMap mPresent;
+
+    // How far ahead are we reading?
+    m_off_t mReadahead;
+
+    // Why did the last fetch fail?
+    Error mResult;
+
+    // Where did the last read end?
+    m_off_t mSequentialEnd;
+
+    // How large is the file?
+    const m_off_t mSize;
+
+public:
+    PartialContext(Client& client,
+                   FileAccessSharedPtr fileAccess,
+                   NodeHandle handle,
+                   LocalPath path,
+                   m_off_t size);
+
+    ~PartialContext();
+
+    // Create a sparse file to contain a node's content.
+    static ErrorOr<PartialContextPtr> create(Client& client,
+                                             NodeHandle handle,
+                                             LocalPath path,
+                                             m_off_t size);
+
+    // What node's content are we fetching?
+    NodeHandle handle() const;
+
+    // Read data, fetching it from the cloud if necessary.
+    ErrorOr<std::string> read(m_off_t offset, unsigned int size);
+}; // PartialContext
+
 ErrorOr<FileAccessSharedPtr> FileIOContext::create()
 {
     // Sanity.
@@ -127,6 +228,53 @@ ErrorOr<FileAccessSharedPtr> FileIOContext::create()
     return fileAccess;
 }
 
+ErrorOr<std::string> FileIOContext::digest() const
+{
+    // Sanity.
+    assert(mFileInfo);
+
+    // How large a chunk of content should we hash at a time?
+    constexpr unsigned int ChunkSize = 1u << 20;
+
+    // Try and open the file for reading.
+    auto fileAccess = mFileCache.client().fsAccess().newfileaccess(false);
+
+    if (!fileAccess->fopen(mFileInfo->path(), true, false, FSLogging::logOnError))
+        return API_EREAD;
+
+    std::string buffer(ChunkSize, '\0');
+    HashSHA256 hash;
+
+    // Hash the file's content, chunk by chunk.
+    for (m_off_t offset = 0; offset < fileAccess->size; )
+    {
+        // How much content should we hash this time around?
+        auto remaining = fileAccess->size - offset;
+        auto size = static_cast<unsigned int>(
+                      std::min<m_off_t>(remaining, ChunkSize));
+
+        // Convenience.
+        auto data = reinterpret_cast<byte*>(&buffer[0]);
+
+        // Couldn't read the content.
+        if (!fileAccess->frawread(data, size, offset, true, FSLogging::logOnError))
+            return API_EREAD;
+
+        // Hash the content.
+        hash.add(data, size);
+
+        offset += size;
+    }
+
+    std::string digest;
+
+    // Extract the digest.
+    hash.get(&digest);
+
+    // Return the digest to the caller.
+    return digest;
+}
+
 ErrorOr<FileAccessSharedPtr> FileIOContext::download(const Mount& mount)
 {
     // Sanity.
@@ -135,6 +283,12 @@ ErrorOr<FileAccessSharedPtr> FileIOContext::download(const Mount& mount)
     assert(!mFileInfo);
     assert(mFilePath.empty());
 
+    // Discard any partially downloaded content.
+    {
+        std::lock_guard<std::mutex> guard(mPartialLock);
+        mPartialContext.reset();
+    }
+
     // Convenience.
     auto& client = mFileCache.client();
 
@@ -245,12 +399,25 @@ Error FileIOContext::manualFlush(FileIOContextSharedLock& contextLock,
         if (!filePath)
             return API_OK;
 
+        // Compute a digest of the file's current content.
+        auto digest = this->digest();
+
+        // File's content is identical to what we last flushed.
+        if (digest
+            && !mFile->handle().isUndef()
+            && !mFlushedDigest.empty()
+            && *digest == mFlushedDigest)
+            return unchangedFlush(flushLock);
+
         // Add the inode's path to the mount's.
         mountPath.appendWithSeparator(*filePath, false);
 
         // Instantiate a new flush context.
         mFlushContext =
-          std::make_shared<FlushContext>(*this, std::move(mountPath));
+          std::make_shared<FlushContext>(*this,
+                                         digest ? std::move(*digest)
+                                                : std::string(),
+                                         std::move(mountPath));
     }
 
     // Retrieve flush context.
@@ -296,6 +463,10 @@ Error FileIOContext::manualFlush(FileIOContextSharedLock& contextLock,
     if (result != API_OK)
         return result;
 
+    // Remember what content we flushed to the cloud.
+    mFlushedDigest = context->mDigest;
+    mFlushedModified = context->mModified;
+
     // Content's been flushed to the cloud.
     if (mFlushNeeded)
         mFile->modified(false);
@@ -307,7 +478,6 @@ Error FileIOContext::manualFlush(FileIOContextSharedLock& contextLock,
 }
 
 void FileIOContext::onPeriodicFlush(FileIOContextRef& context,
-                                    m_time_t lastModified,
                                     NodeHandle mountHandle,
                                     LocalPath& mountPath,
                                     const Task& task)
@@ -325,31 +495,29 @@ void FileIOContext::onPeriodicFlush(FileIOContextRef& context,
     if (task.cancelled() || !mFlushNeeded)
         return;
 
-    // When was our content last modified?
-    auto modified = mFileInfo->modified();
+    // Another task will flush the modifications.
+    if (mPeriodicFlushTask != task)
+        return;
+
+    // When should we flush the file's content?
+    auto when = mModifiedAt + flushDelay();
 
     // Content was modified since the flush was queued.
-    if (lastModified != modified)
-    {
-        // Another task will flush the modifications.
-        if (mPeriodicFlushTask != task)
-            return;
-
-        // Reschedule the flush for later.
-        mPeriodicFlushTask = mFileCache.executor().execute(
-                               std::bind(&FileIOContext::onPeriodicFlush,
-                                         this,
-                                         std::move(context),
-                                         modified,
-                                         mountHandle,
-                                         std::move(mountPath),
-                                         std::placeholders::_1),
-                               flushDelay(),
-                               true);
-
-        // We're all done for now.
-        return;
-    }
+    //
+    // Keep deferring the flush until the file's been left alone for a
+    // while so that a burst of writes results in a single upload.
+    if (std::chrono::steady_clock::now() < when)
+        return queueFlush(std::move(context),
+                          mountHandle,
+                          std::move(mountPath),
+                          when);
+
+    // Mount's already flushing as many files as it's allowed to.
+    if (!mFileCache.flushStarting(mountHandle))
+        return queueFlush(std::move(context),
+                          mountHandle,
+                          std::move(mountPath),
+                          std::chrono::steady_clock::now() + FlushRetryDelay);
 
     // Perform the flush.
     manualFlush(contextLock,
@@ -357,6 +525,9 @@ void FileIOContext::onPeriodicFlush(FileIOContextRef& context,
                 mountHandle,
                 std::move(mountPath));
 
+    // Let the cache know another flush can proceed on this mount.
+    mFileCache.flushCompleted(mountHandle);
+
     // Sanity.
     assert(contextLock.owns_lock());
     assert(flushLock.owns_lock());
@@ -451,8 +622,13 @@ FileIOContext::FileIOContext(FileCache& cache,
   , mFileInfo(std::move(info))
   , mFilePath()
   , mFlushContext()
+  , mFlushedDigest()
+  , mFlushedModified(0)
   , mFlushLock()
   , mFlushNeeded(modified)
+  , mPartialContext()
+  , mPartialLock()
+  , mModifiedAt()
   , mPeriodicFlushTask()
   , mReferences(0u)
 {
@@ -543,6 +719,12 @@ Error FileIOContext::manualFlush(const Mount& mount)
     // Cancel periodic flush.
     flushTask.cancel();
 
+    // Release context lock.
+    contextLock.unlock();
+
+    // Make sure the file's metadata is on disk.
+    mFileCache.mContext.mDatabase.flush();
+
     // Return result to caller.
     return result;
 }
@@ -558,21 +740,21 @@ void FileIOContext::modified(const Mount& mount)
 
     mFlushNeeded = true;
 
+    // Remember when the file was last modified.
+    mModifiedAt = std::chrono::steady_clock::now();
+
     // A flush has already been queued.
+    //
+    // The queued flush will notice that the file's been modified since it
+    // was queued and defer itself accordingly.
     if (mPeriodicFlushTask && !mPeriodicFlushTask.completed())
         return;
 
     // Queue a periodic flush.
-    mPeriodicFlushTask = mFileCache.executor().execute(
-                           std::bind(&FileIOContext::onPeriodicFlush,
-                                     this,
-                                     FileIOContextRef(this),
-                                     mFileInfo->modified(),
-                                     mount.handle(),
-                                     mount.path(),
-                                     std::placeholders::_1),
-                           flushDelay(),
-                           true);
+    queueFlush(FileIOContextRef(this),
+               mount.handle(),
+               mount.path(),
+               mModifiedAt + flushDelay());
 }
 
 Error FileIOContext::open(const Mount& mount,
@@ -589,9 +771,35 @@ Error FileIOContext::open(const Mount& mount,
     return API_OK;
 }
 
+void FileIOContext::queueFlush(FileIOContextRef context,
+                               NodeHandle mountHandle,
+                               LocalPath mountPath,
+                               std::chrono::steady_clock::time_point when)
+{
+    // Queue the flush.
+    mPeriodicFlushTask = mFileCache.executor().execute(
+                           std::bind(&FileIOContext::onPeriodicFlush,
+                                     this,
+                                     std::move(context),
+                                     mountHandle,
+                                     std::move(mountPath),
+                                     std::placeholders::_1),
+                           when,
+                           true,
+                           TASK_PRIORITY_FLUSH);
+}
+
 ErrorOr<std::string> FileIOContext::read(const Mount& mount,
                                          m_off_t offset,
                                          unsigned int size)
+{
+    return read(mount, offset, size, LocalReader());
+}
+
+ErrorOr<std::string> FileIOContext::read(const Mount& mount,
+                                         m_off_t offset,
+                                         unsigned int size,
+                                         const LocalReader& reader)
 {
     assert(offset >= 0);
     assert(size);
@@ -602,6 +810,10 @@ ErrorOr<std::string> FileIOContext::read(const Mount& mount,
     // Make sure nothing else is touching this file.
     FileIOContextSharedLock guard(*this);
 
+    // File's content hasn't been downloaded: fetch only what's needed.
+    if (!mFileInfo && !mFile->handle().isUndef() && !mFile->removed())
+        return partialRead(offset, size);
+
     // Make sure the file's present and open.
     auto result = open(guard, mount);
 
@@ -628,6 +840,23 @@ ErrorOr<std::string> FileIOContext::read(const Mount& mount,
     if (!size)
         return std::string();
 
+    // Let the reader transfer the content itself.
+    if (reader)
+    {
+        // Sanity.
+        assert(!mFilePath.empty());
+
+        // Try and transfer the content.
+        auto result = reader(mFilePath, offset, size);
+
+        // Couldn't transfer the content.
+        if (result != API_OK)
+            return result;
+
+        // Content's been transferred.
+        return std::string();
+    }
+
     std::string buffer;
 
     // Couldn't read from the file.
@@ -642,6 +871,46 @@ ErrorOr<std::string> FileIOContext::read(const Mount& mount,
     return buffer;
 }
 
+ErrorOr<std::string> FileIOContext::partialRead(m_off_t offset,
+                                                unsigned int size)
+{
+    PartialContextPtr context;
+
+    // Retrieve or create the context serving this file's reads.
+    {
+        // Acquire partial lock.
+        std::lock_guard<std::mutex> guard(mPartialLock);
+
+        // The file's content has changed in the cloud.
+        if (mPartialContext
+            && mPartialContext->handle() != mFile->handle())
+            mPartialContext.reset();
+
+        // Create a new context if necessary.
+        if (!mPartialContext)
+        {
+            auto result =
+              PartialContext::create(mFileCache.client(),
+                                     mFile->handle(),
+                                     mFileCache.partialPath(mFile->id(),
+                                                            mFile->handle()),
+                                     mFile->info().mSize);
+
+            // Couldn't create the context.
+            if (!result)
+                return result.error();
+
+            mPartialContext = std::move(*result);
+        }
+
+        // Latch the context.
+        context = mPartialContext;
+    }
+
+    // Read the data, fetching it from the cloud if necessary.
+    return context->read(offset, size);
+}
+
 void FileIOContext::ref(RefBadge) 
 {
     // Make sure nothing else touches our reference count.
@@ -872,6 +1141,39 @@ ErrorOr<std::size_t> FileIOContext::write(const Mount& mount,
     return static_cast<std::size_t>(length);
 }
 
+Error FileIOContext::unchangedFlush(std::unique_lock<std::mutex>& flushLock)
+{
+    // Sanity.
+    assert(flushLock.owns_lock());
+    assert(!mFile->handle().isUndef());
+
+    // When was the file's content last modified?
+    auto modified = mFileInfo->modified();
+
+    // Only the content's modification time has changed.
+    if (modified != mFlushedModified)
+    {
+        // Try and update the cloud's idea of when the file was modified.
+        auto result = mFileCache.client().touch(mFile->handle(), modified);
+
+        // Couldn't update the file's modification time.
+        if (result != API_OK)
+            return result;
+
+        // Remember the modification time we flushed.
+        mFlushedModified = modified;
+    }
+
+    // Cloud already has the file's content.
+    if (mFlushNeeded)
+        mFile->modified(false);
+
+    mFlushNeeded = false;
+
+    // Let the caller know the flush succeeded.
+    return API_OK;
+}
+
 void doRef(RefBadge badge, FileIOContext& entry)
 {
     entry.ref(badge);
@@ -882,6 +1184,280 @@ void doUnref(RefBadge badge, FileIOContext& entry)
     entry.unref(badge);
 }
 
+void FileIOContext::PartialContext::fetched(m_off_t begin,
+                                            m_off_t end,
+                                            ErrorOr<std::string> result)
+{
+    // Acquire lock.
+    std::lock_guard<std::mutex> guard(mLock);
+
+    // Range is no longer being fetched.
+    mPending.erase(begin);
+
+    // Wake any readers waiting for this range.
+    //
+    // They won't observe our state until we release the lock.
+    mCV.notify_all();
+
+    // Couldn't fetch the range.
+    if (!result)
+        return void(mResult = result.error());
+
+    // Convenience.
+    auto data = reinterpret_cast<const byte*>(result->data());
+    auto size = static_cast<unsigned int>(result->size());
+
+    // Couldn't write the range to disk.
+    if (result->size() != static_cast<std::size_t>(end - begin)
+        || !mFileAccess->fwrite(data, size, begin))
+        return void(mResult = API_EWRITE);
+
+    // Merge the range with any adjacent or overlapping ranges.
+    auto i = mPresent.upper_bound(begin);
+
+    if (i != mPresent.begin() && std::prev(i)->second >= begin)
+        begin = (--i)->first;
+
+    while (i != mPresent.end() && i->first <= end)
+    {
+        end = std::max(end, i->second);
+        i = mPresent.erase(i);
+    }
+
+    // Range is now present locally.
+    mPresent.emplace(begin, end);
+}
+
+void FileIOContext::PartialContext::fetch(std::unique_lock<std::mutex>& lock,
+                                          m_off_t begin,
+                                          m_off_t end)
+{
+    // Sanity.
+    assert(lock.owns_lock());
+
+    std::vector<std::pair<m_off_t, m_off_t>> ranges;
+
+    // Compute which ranges we need to fetch.
+    while (begin < end)
+    {
+        // Skip over any content that's present or being fetched.
+        for (auto* map : {&mPresent, &mPending})
+        {
+            auto i = map->upper_bound(begin);
+
+            if (i != map->begin() && std::prev(i)->second > begin)
+                begin = std::prev(i)->second;
+        }
+
+        // Everything's present or being fetched.
+        if (begin >= end)
+            break;
+
+        // Where does the next present or pending range begin?
+        auto next = std::min(end, begin + MaxFetchSize);
+
+        for (auto* map : {&mPresent, &mPending})
+        {
+            auto i = map->upper_bound(begin);
+
+            if (i != map->end())
+                next = std::min(next, i->first);
+        }
+
+        // Range is now being fetched.
+        mPending.emplace(begin, next);
+        ranges.emplace_back(begin, next);
+
+        begin = next;
+    }
+
+    // Clear stale error.
+    if (!ranges.empty())
+        mResult = API_OK;
+
+    // Release lock.
+    lock.unlock();
+
+    // Ask the client to fetch our ranges.
+    for (auto& range : ranges)
+    {
+        mClient.partialDownload(std::bind(&PartialContext::fetched,
+                                          shared_from_this(),
+                                          range.first,
+                                          range.second,
+                                          std::placeholders::_1),
+                                mHandle,
+                                range.first,
+                                range.second - range.first);
+    }
+
+    // Reacquire lock.
+    lock.lock();
+}
+
+bool FileIOContext::PartialContext::overlaps(const RangeMap& ranges,
+                                             m_off_t begin,
+                                             m_off_t end)
+{
+    // Locate the first range that begins after begin.
+    auto i = ranges.upper_bound(begin);
+
+    // Preceding range extends into [begin, end).
+    if (i != ranges.begin() && std::prev(i)->second > begin)
+        return true;
+
+    // Following range begins before end.
+    return i != ranges.end() && i->first < end;
+}
+
+bool FileIOContext::PartialContext::present(m_off_t begin,
+                                            m_off_t end) const
+{
+    // Ranges are merged so one range must contain all of [begin, end).
+    auto i = mPresent.upper_bound(begin);
+
+    // No range begins at or before begin.
+    if (i == mPresent.begin())
+        return false;
+
+    // Let the caller know if the range contains [begin, end).
+    return (--i)->second >= end;
+}
+
+FileIOContext::PartialContext::PartialContext(Client& client,
+                                              FileAccessSharedPtr fileAccess,
+                                              NodeHandle handle,
+                                              LocalPath path,
+                                              m_off_t size)
+  : std::enable_shared_from_this<PartialContext>()
+  , mClient(client)
+  , mCV()
+  , mFileAccess(std::move(fileAccess))
+  , mHandle(handle)
+  , mLock()
+  , mPath(std::move(path))
+  , mPending()
+  , mPresent()
+  , mReadahead(0)
+  , mResult(API_OK)
+  , mSequentialEnd(-1)
+  , mSize(size)
+{
+    // Sanity.
+    assert(mFileAccess);
+    assert(!mHandle.isUndef());
+    assert(mSize >= 0);
+}
+
+FileIOContext::PartialContext::~PartialContext()
+{
+    // Close the sparse file.
+    mFileAccess.reset();
+
+    // Remove the sparse file from disk.
+    if (!mClient.fsAccess().unlinklocal(mPath))
+        FUSEWarningF("Couldn't remove partial content: %s",
+                     mPath.toPath(false).c_str());
+}
+
+auto FileIOContext::PartialContext::create(Client& client,
+                                           NodeHandle handle,
+                                           LocalPath path,
+                                           m_off_t size)
+  -> ErrorOr<PartialContextPtr>
+{
+    // Instantiate a new file access object.
+    FileAccessSharedPtr fileAccess = client.fsAccess().newfileaccess(false);
+
+    // Couldn't create the sparse file.
+    if (!fileAccess->fopen(path, true, true, FSLogging::logOnError))
+        return API_EWRITE;
+
+    // Extend the file to its full size without allocating any storage.
+    if (!fileAccess->ftruncate(size))
+    {
+        fileAccess.reset();
+        client.fsAccess().unlinklocal(path);
+
+        return API_EWRITE;
+    }
+
+    // Return context to caller.
+    return std::make_shared<PartialContext>(client,
+                                            std::move(fileAccess),
+                                            handle,
+                                            std::move(path),
+                                            size);
+}
+
+NodeHandle FileIOContext::PartialContext::handle() const
+{
+    return mHandle;
+}
+
+ErrorOr<std::string> FileIOContext::PartialContext::read(m_off_t offset,
+                                                         unsigned int size)
+{
+    // Acquire lock.
+    std::unique_lock<std::mutex> lock(mLock);
+
+    // Clamp offset.
+    offset = std::min(offset, mSize);
+
+    // Clamp size.
+    size = static_cast<unsigned int>(
+             std::min<m_off_t>(mSize - offset, size));
+
+    // No data available for reading.
+    if (!size)
+        return std::string();
+
+    // Convenience.
+    auto end = offset + static_cast<m_off_t>(size);
+
+    // Reader's reading sequentially: widen the readahead window.
+    if (offset == mSequentialEnd)
+        mReadahead = std::min(std::max(mReadahead * 2, BlockSize), MaxReadahead);
+    else
+        mReadahead = 0;
+
+    // Remember where this read ended.
+    mSequentialEnd = end;
+
+    // Which blocks contain the data the reader wants?
+    auto blockBegin = offset / BlockSize * BlockSize;
+    auto blockEnd = std::min(mSize, (end + BlockSize - 1) / BlockSize * BlockSize);
+
+    // Fetch the blocks we need.
+    fetch(lock, blockBegin, blockEnd);
+
+    // Fetch the content the reader is likely to want next.
+    if (mReadahead)
+        fetch(lock, blockEnd, std::min(mSize, blockEnd + mReadahead));
+
+    // Wait for the blocks we need to be fetched.
+    mCV.wait(lock, [&]() {
+        return !overlaps(mPending, blockBegin, blockEnd);
+    });
+
+    // Couldn't fetch the blocks we need.
+    if (!present(offset, end))
+        return mResult != API_OK ? mResult : Error(API_EREAD);
+
+    std::string buffer;
+
+    // Couldn't read from the file.
+    if (!mFileAccess->fread(&buffer,
+                            size,
+                            0,
+                            offset,
+                            FSLogging::logOnError))
+        return API_EREAD;
+
+    // Return result to caller.
+    return buffer;
+}
+
 Client& FileIOContext::FlushContext::client() const
 {
     return mContext.mFileCache.client();
@@ -934,11 +1510,14 @@ void FileIOContext::FlushContext::uploaded(ErrorOr<UploadResult> result)
 }
 
 FileIOContext::FlushContext::FlushContext(FileIOContext& context,
+                                          std::string digest,
                                           LocalPath logicalPath)
   : mCV()
   , mContext(context)
   , mLock()
   , mUpload()
+  , mDigest(std::move(digest))
+  , mModified(context.mFileInfo->modified())
 {
     // Sanity.
     assert(mContext.mFile);
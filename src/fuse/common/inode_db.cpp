@@ -1,12 +1,15 @@
 #include <cassert>
 #include <chrono>
 #include <map>
+#include <set>
+#include <thread>
 #include <tuple>
 
 #include <mega/fuse/common/any_lock.h>
 #include <mega/fuse/common/any_lock_set.h>
 #include <mega/fuse/common/bind_handle.h>
 #include <mega/fuse/common/client.h>
+#include <mega/fuse/common/constants.h>
 #include <mega/fuse/common/database.h>
 #include <mega/fuse/common/directory_inode.h>
 #include <mega/fuse/common/error_or.h>
@@ -41,6 +44,9 @@ class InodeDB::EventObserver
     // Called when a node's been added.
     void added(const NodeEvent& event);
 
+    // Let foreground requests proceed between batches of events.
+    void breathe();
+
     // Retrieve a reference to the database.
     Database& database() const;
 
@@ -50,6 +56,22 @@ class InodeDB::EventObserver
     // Retrieve a reference to the file extension DB.
     FileExtensionDB& fileExtensionDB() const;
 
+    // Queue accumulated invalidations on each mount.
+    void invalidate();
+
+    // Record that an inode's attributes need to be invalidated.
+    void invalidateAttributes(InodeID id);
+
+    // Record that a directory entry needs to be invalidated.
+    void invalidateEntry(const std::string& name,
+                         InodeID child,
+                         InodeID parent);
+
+    void invalidateEntry(const std::string& name, InodeID parent);
+
+    // Record that a pinned inode needs to be invalidated.
+    void invalidatePin(InodeID id);
+
     // Called when a node's been modified.
     void modified(const NodeEvent& event);
 
@@ -80,6 +102,15 @@ class InodeDB::EventObserver
     // So we can perform queries.
     Transaction mTransaction;
 
+    // Which inodes need to have their attributes invalidated?
+    InodeIDSet mInvalidatedAttributes;
+
+    // Which directory entries need to be invalidated?
+    std::map<InodeID, std::map<std::string, InodeIDSet>> mInvalidatedEntries;
+
+    // Which pinned inodes need to be invalidated?
+    InodeIDSet mInvalidatedPins;
+
 public:
     EventObserver(InodeDB& inodeDB);
 
@@ -104,12 +135,12 @@ InodeDB::Queries::Queries(Database& database)
   , mGetModifiedByID(database.query())
   , mGetModifiedInodes(database.query())
   , mGetNextInodeID(database.query())
-  , mIncrementNextInodeID(database.query())
   , mRemoveInodeByID(database.query())
   , mSetBindHandleByID(database.query())
   , mSetBindHandleHandleNameParentHandleByID(database.query())
   , mSetModifiedByID(database.query())
   , mSetNameParentHandleByID(database.query())
+  , mSetNextInodeID(database.query())
 {
     mAddInode = "insert into inodes values ( "
                 "  :bind_handle, "
@@ -175,8 +206,6 @@ InodeDB::Queries::Queries(Database& database)
 
     mGetNextInodeID = "select next from inode_id";
 
-    mIncrementNextInodeID = "update inode_id set next = next + 1";
-
     mRemoveInodeByID = "delete from inodes where id = :id";
 
     mSetBindHandleByID = "update inodes "
@@ -198,6 +227,8 @@ InodeDB::Queries::Queries(Database& database)
                                "   set name = :name "
                                "     , parent_handle = :parent_handle "
                                " where id = :id";
+
+    mSetNextInodeID = "update inode_id set next = max(next, :next)";
 }
 
 InodeRef InodeDB::add(InodePtr (InodeDB::*build)(const NodeInfo&),
@@ -230,19 +261,16 @@ InodeID InodeDB::addFile(const FileExtension& extension,
                          NodeHandle parentHandle,
                          Transaction& transaction)
 {
-    auto query = transaction.query(mQueries.mGetNextInodeID);
-
     // Allocate a new inode ID.
-    query.execute();
-
-    auto id = query.field("next").inode();
+    auto id = InodeID(mNextInodeID.fetch_add(1));
 
     // Make sure we haven't wrapped around.
     assert(id);
 
     // Mark ID as having been allocated.
-    query = transaction.query(mQueries.mIncrementNextInodeID);
+    auto query = transaction.query(mQueries.mSetNextInodeID);
 
+    query.param(":next") = InodeID(id.get() + 1);
     query.execute();
 
     // Add the file to the database.
@@ -354,7 +382,8 @@ void InodeDB::childRemoved(const Inode& inode,
     mByParentHandleAndName.erase(i);
 }
 
-InodeRefVector InodeDB::children(const DirectoryInode& parent) const
+InodeRefVector InodeDB::children(const DirectoryInode& parent,
+                                 InodeInfoVector* infos) const
 {
     // So we can look up strings by reference.
     struct StringPtrLess {
@@ -489,6 +518,19 @@ InodeRefVector InodeDB::children(const DirectoryInode& parent) const
     // Prepare query.
     query = transaction.query(mQueries.mGetExtensionAndInodeIDByHandle);
 
+    // Describes a child that has local state.
+    auto local = [&]() {
+        if (infos)
+            infos->emplace_back();
+    }; // local
+
+    // Make sure the caller has room for each child's description.
+    if (infos)
+    {
+        infos->clear();
+        infos->reserve(storage.size() + pending.size());
+    }
+
     // Instantiate cloud children.
     while (!storage.empty())
     {
@@ -505,7 +547,31 @@ InodeRefVector InodeDB::children(const DirectoryInode& parent) const
 
             // Child's already in memory.
             if (h != mByHandle.end())
-                return InodeRef(h->second->accessed());
+            {
+                auto ref = InodeRef(h->second->accessed());
+                auto file = ref->file();
+
+                // Child has local state.
+                if (file && file->fileInfo())
+                {
+                    local();
+                    return ref;
+                }
+
+                // Child's description is exactly what the client reported.
+                if (infos)
+                    infos->emplace_back(ref->id(), info);
+
+                return ref;
+            }
+
+            // Child's description is exactly what the client reported.
+            if (infos)
+                infos->emplace_back(InodeID(info.mHandle), info);
+
+            // Child's a directory.
+            if (info.mIsDirectory)
+                return self.add(&InodeDB::buildDirectory, info);
 
             // Child's a directory.
             if (info.mIsDirectory)
@@ -538,6 +604,10 @@ InodeRefVector InodeDB::children(const DirectoryInode& parent) const
                 return self.add(&InodeDB::buildFile, info);
             }
 
+            // File has local state.
+            if (infos)
+                infos->back() = InodeInfo();
+
             // Instantiate child.
             auto ptr = std::make_unique<FileInode>(id, info, self);
 
@@ -578,6 +648,9 @@ InodeRefVector InodeDB::children(const DirectoryInode& parent) const
             // Add child to vector.
             children.emplace_back(i->second->accessed());
 
+            // Child only exists locally.
+            local();
+
             // Process next child.
             continue;
         }
@@ -610,6 +683,9 @@ InodeRefVector InodeDB::children(const DirectoryInode& parent) const
         // Add child to vector.
         children.emplace_back(ptr.get());
 
+        // Child only exists locally.
+        local();
+
         // Add child to index.
         mByID.emplace(id, std::move(ptr));
     }
@@ -1518,6 +1594,7 @@ InodeDB::InodeDB(platform::ServiceContext& context)
   , mCV()
   , mContext(context)
   , mDiscard(false)
+  , mNextInodeID(0u)
   , mQueries(context.mDatabase)
 {
     FUSEDebug1("Inode DB constructed");
@@ -1528,6 +1605,13 @@ InodeDB::InodeDB(platform::ServiceContext& context)
 
     query.execute();
 
+    // Latch the next free inode ID.
+    query = transaction.query(mQueries.mGetNextInodeID);
+
+    query.execute();
+
+    mNextInodeID = query.field("next").inode().get();
+
     transaction.commit();
 }
 
@@ -1687,6 +1771,50 @@ void InodeDB::discard(bool discard)
     mDiscard = discard;
 }
 
+bool InodeDB::evict(InodeID id)
+{
+    assert(id);
+
+    // Acquire database lock.
+    auto guard = lockAll(mContext.mDatabase, *this);
+
+    // Inode's in memory so its content may be in use.
+    if (mByID.count(id))
+        return false;
+
+    auto transaction = mContext.mDatabase.transaction();
+    auto query = transaction.query(mQueries.mGetInodeByID);
+
+    query.param(":id") = id;
+    query.execute();
+
+    // Inode isn't in the database.
+    if (!query)
+        return false;
+
+    // Inode's content hasn't been flushed to the cloud.
+    if (query.field("handle").null() || query.field("modified"))
+        return false;
+
+    // Convenience.
+    auto extension = fileExtensionDB().get(query.field("extension"));
+
+    // Couldn't evict the inode's content.
+    if (!fileCache().evict(extension, id))
+        return false;
+
+    // Inode's now only present in the cloud.
+    query = transaction.query(mQueries.mRemoveInodeByID);
+
+    query.param(":id") = id;
+    query.execute();
+
+    transaction.commit();
+
+    // Let the caller know the content's been evicted.
+    return true;
+}
+
 bool InodeDB::exists(InodeID id) const
 {
     // Check if the inode's in memory.
@@ -1722,20 +1850,32 @@ InodeRef InodeDB::get(NodeHandle handle, bool inMemoryOnly) const
 {
     assert(!handle.isUndef());
 
+    // Check if the inode's already in memory.
+    {
+        // Acquire inode DB lock.
+        InodeDBLock guard(*this);
+
+        auto h = mByHandle.find(handle);
+
+        // Inode's in memory (match on current handle.)
+        if (h != mByHandle.end())
+            return InodeRef(h->second->accessed());
+
+        // Inode's not in memory and we don't want to load it.
+        if (inMemoryOnly)
+            return InodeRef();
+    }
+
     // Acquire database lock.
     auto lock = lockAll(mContext.mDatabase, *this);
 
-    // Check if the inode's already in memory.
+    // Check if the inode was loaded while we were acquiring the lock.
     auto h = mByHandle.find(handle);
 
     // Inode's in memory (match on current handle.)
     if (h != mByHandle.end())
         return InodeRef(h->second->accessed());
 
-    // Inode's not in memory and we don't want to load it.
-    if (inMemoryOnly)
-        return InodeRef();
-
     // Check if the inode's in the file cache.
     if (auto ptr = get(fileCache(), handle, std::move(lock)))
         return ptr;
@@ -1748,20 +1888,32 @@ InodeRef InodeDB::get(InodeID id, bool inMemoryOnly) const
 {
     assert(id);
 
+    // Check if the inode's already in memory.
+    {
+        // Acquire inode DB lock.
+        InodeDBLock guard(*this);
+
+        auto i = mByID.find(id);
+
+        // Inode's already in memory.
+        if (i != mByID.end())
+            return InodeRef(i->second->accessed());
+
+        // Inode's not in memory and we don't want to load it.
+        if (inMemoryOnly)
+            return InodeRef();
+    }
+
     // Acquire database lock.
     auto lock = lockAll(mContext.mDatabase, *this);
 
-    // Check if the inode's already in memory.
+    // Check if the inode was loaded while we were acquiring the lock.
     auto i = mByID.find(id);
 
     // Inode's already in memory.
     if (i != mByID.end())
         return InodeRef(i->second->accessed());
 
-    // Inode's not in memory and we don't want to load it.
-    if (inMemoryOnly)
-        return InodeRef();
-
     // Check if the inode's in the file cache.
     if (auto ptr = get(fileCache(), id, std::move(lock)))
         return ptr;
@@ -1979,9 +2131,7 @@ void InodeDB::EventObserver::added(const NodeEvent& event)
         ref->removed(true);
 
         // Invalidate any associated directory entries.
-        return mountDB().each([&](Mount& mount) {
-            mount.invalidatePin(ref->id());
-        });
+        return invalidatePin(ref->id());
     }
 
     // Does the node replace an inode that's not in memory?
@@ -2016,9 +2166,28 @@ void InodeDB::EventObserver::added(const NodeEvent& event)
     }
 
     // Invalidate any associated directory entries.
-    mountDB().each([&](Mount& mount) {
-        mount.invalidateEntry(name, InodeID(parentHandle));
-    });
+    invalidateEntry(name, InodeID(parentHandle));
+}
+
+void InodeDB::EventObserver::breathe()
+{
+    // Queue the invalidations we've accumulated so far.
+    invalidate();
+
+    // Persist database changes.
+    mTransaction.commit();
+
+    // Give foreground requests a chance to acquire the locks.
+    mInodeDB.unlock();
+    mDatabaseLock.unlock();
+
+    std::this_thread::yield();
+
+    // Reacquire necessary locks.
+    std::lock(mDatabaseLock, mInodeDB);
+
+    // Establish a transaction for future queries.
+    mTransaction = database().transaction();
 }
 
 Database& InodeDB::EventObserver::database() const
@@ -2056,9 +2225,76 @@ void InodeDB::EventObserver::modified(const NodeEvent& event)
         return;
 
     // Invalidate the inode's attributes.
+    invalidateAttributes(ref->id());
+}
+
+void InodeDB::EventObserver::invalidate()
+{
+    // No invalidations have been accumulated.
+    if (mInvalidatedAttributes.empty()
+        && mInvalidatedEntries.empty()
+        && mInvalidatedPins.empty())
+        return;
+
+    FUSEDebugF("Invalidating %zu attribute(s), %zu directory(s) and %zu pin(s)",
+               mInvalidatedAttributes.size(),
+               mInvalidatedEntries.size(),
+               mInvalidatedPins.size());
+
+    // Hand each mount every invalidation in one pass.
     mountDB().each([&](Mount& mount) {
-        mount.invalidateAttributes(ref->id());
+        for (auto id : mInvalidatedPins)
+            mount.invalidatePin(id);
+
+        for (auto id : mInvalidatedAttributes)
+            mount.invalidateAttributes(id);
+
+        for (auto& parent : mInvalidatedEntries)
+        {
+            for (auto& entry : parent.second)
+            {
+                // Invalidate the entry's negative alias.
+                if (entry.second.empty())
+                    mount.invalidateEntry(entry.first, parent.first);
+
+                // Invalidate the entry's children.
+                for (auto child : entry.second)
+                    mount.invalidateEntry(entry.first, child, parent.first);
+            }
+        }
     });
+
+    mInvalidatedAttributes.clear();
+    mInvalidatedEntries.clear();
+    mInvalidatedPins.clear();
+}
+
+void InodeDB::EventObserver::invalidateAttributes(InodeID id)
+{
+    mInvalidatedAttributes.emplace(id);
+}
+
+void InodeDB::EventObserver::invalidateEntry(const std::string& name,
+                                             InodeID child,
+                                             InodeID parent)
+{
+    invalidateEntry(name, parent);
+
+    mInvalidatedEntries[parent][name].emplace(child);
+}
+
+void InodeDB::EventObserver::invalidateEntry(const std::string& name,
+                                             InodeID parent)
+{
+    // A directory's attributes change along with its entries.
+    invalidateAttributes(parent);
+
+    mInvalidatedEntries[parent][name];
+}
+
+void InodeDB::EventObserver::invalidatePin(InodeID id)
+{
+    mInvalidatedPins.emplace(id);
 }
 
 void InodeDB::EventObserver::moved(const NodeEvent& event)
@@ -2135,20 +2371,15 @@ void InodeDB::EventObserver::moved(const NodeEvent& event)
         // Update the inode's description.
         ref->info(event.info());
 
-        // Invalidate associated directory entries.
-        return mountDB().each([&](Mount& mount) {
-            // Invalidate source.
-            mount.invalidatePin(ref->id());
+        // Invalidate source.
+        invalidatePin(ref->id());
 
-            // Invalidate target.
-            mount.invalidateEntry(name, InodeID(parentHandle));
-        });
+        // Invalidate target.
+        return invalidateEntry(name, InodeID(parentHandle));
     }
 
     // Invalidate any negative directory entries.
-    mountDB().each([&](Mount& mount) {
-        mount.invalidateEntry(name, InodeID(parentHandle));
-    });
+    invalidateEntry(name, InodeID(parentHandle));
 }
 
 MountDB& InodeDB::EventObserver::mountDB() const
@@ -2156,9 +2387,35 @@ MountDB& InodeDB::EventObserver::mountDB() const
     return mInodeDB.mContext.mMountDB;
 }
 
-void InodeDB::EventObserver::permissions(const NodeEvent&)
+void InodeDB::EventObserver::permissions(const NodeEvent& event)
 {
-    // TODO: To be improved later.
+    // Convenience.
+    auto& client = mInodeDB.client();
+    auto  handle = event.handle();
+    auto& name = event.name();
+
+    FUSEDebugF("Node permissions changed: %s (%s)",
+               name.c_str(),
+               toNodeHandle(handle).c_str());
+
+    // Invalidate the attributes of any inodes below the share.
+    for (auto& entry : mInodeDB.mByHandle)
+    {
+        // Ascend until we reach the share or the root.
+        for (auto current = entry.first;
+             !current.isUndef();
+             current = client.parentHandle(current))
+        {
+            // Inode isn't below the share.
+            if (current != handle)
+                continue;
+
+            // Inode's permissions may have changed.
+            invalidateAttributes(entry.second->id());
+
+            break;
+        }
+    }
 }
 
 auto InodeDB::EventObserver::queries() const -> Queries&
@@ -2198,9 +2455,7 @@ void InodeDB::EventObserver::removed(const NodeEvent& event)
         ref->removed(true);
 
         // Invalidate any associated directory entries.
-        return mountDB().each([&](Mount& mount) {
-            mount.invalidateEntry(name, id, InodeID(parentHandle));
-        });
+        return invalidateEntry(name, id, InodeID(parentHandle));
     }
 
     auto query = mTransaction.query(queries().mGetExtensionAndInodeIDByHandle);
@@ -2232,9 +2487,7 @@ void InodeDB::EventObserver::removed(const NodeEvent& event)
     }
 
     // Invalidate any associated directory entries.
-    mountDB().each([&](Mount& mount) {
-        mount.invalidateEntry(name, InodeID(parentHandle));
-    });
+    invalidateEntry(name, InodeID(parentHandle));
 }
 
 InodeDB::EventObserver::EventObserver(InodeDB& inodeDB)
@@ -2242,6 +2495,9 @@ InodeDB::EventObserver::EventObserver(InodeDB& inodeDB)
   , mDatabaseLock(database(), std::defer_lock)
   , mInodeDBLock(mInodeDB, std::defer_lock)
   , mTransaction()
+  , mInvalidatedAttributes()
+  , mInvalidatedEntries()
+  , mInvalidatedPins()
 {
     // Acquire necessary locks.
     std::lock(mDatabaseLock, mInodeDB);
@@ -2278,10 +2534,19 @@ void InodeDB::EventObserver::operator()(NodeEventQueue& events)
     FUSEDebugF("Processing %zu node event(s)", events.size());
 
     auto began = high_resolution_clock::now();
+    auto processed = 0u;
 
     // Process each event.
     for ( ; !events.empty(); events.pop_front())
     {
+        // Let foreground requests proceed now and then.
+        if (processed++ == NodeEventBatchSize)
+        {
+            breathe();
+
+            processed = 1;
+        }
+
         // What's the next event in the queue?
         auto& event = events.front();
 
@@ -2301,6 +2566,9 @@ void InodeDB::EventObserver::operator()(NodeEventQueue& events)
         (this->*handler)(event);
     }
 
+    // Queue any remaining invalidations.
+    invalidate();
+
     // Persist database changes.
     mTransaction.commit();
 
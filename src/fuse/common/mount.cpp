@@ -9,6 +9,7 @@
 #include <mega/fuse/common/inode_info.h>
 #include <mega/fuse/common/logging.h>
 #include <mega/fuse/common/mount.h>
+#include <mega/fuse/common/mount_db.h>
 #include <mega/fuse/common/mount_event.h>
 #include <mega/fuse/common/mount_event_type.h>
 #include <mega/fuse/common/mount_inode_id.h>
@@ -73,6 +74,8 @@ Mount::Mount(const MountInfo& info, platform::MountDB& mountDB)
   , mContextsLock()
   , mDisabled()
   , mFlags(info.mFlags)
+  , mHits()
+  , mHitsLock()
   , mHandle(info.mHandle)
   , mPath(info.mPath)
   , mPins()
@@ -92,6 +95,10 @@ Mount::~Mount()
     for (auto* context : contexts)
         delete context;
 
+    // Remember which inodes were accessed via this mount.
+    if (!mHits.empty())
+        mMountDB.hotInodes(mPath, mHits);
+
     // Broadcast a mount disabled event.
     mMountDB.client().emitEvent({
         path(),
@@ -182,6 +189,13 @@ void Mount::unpin(InodeRef inode, std::size_t num)
     }
 }
 
+void Mount::accessed(InodeID id)
+{
+    std::lock_guard<std::mutex> guard(mHitsLock);
+
+    ++mHits[id];
+}
+
 void Mount::contextAdded(platform::ContextBadge, platform::Context& context)
 {
     std::lock_guard<std::mutex> guard(mContextsLock);
@@ -213,6 +227,9 @@ void Mount::enabled()
 
     // Flush any modified files contained by this mount.
     fileCache.flush(*this, inodeDB.modified(mHandle));
+
+    // Load this mount's most frequently accessed inodes into memory.
+    mMountDB.prefetch(mPath);
 }
 
 void Mount::executorFlags(const TaskExecutorFlags&)
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <stdexcept>
@@ -5,8 +6,10 @@
 #include <mega/fuse/common/any_lock.h>
 #include <mega/fuse/common/any_lock_set.h>
 #include <mega/fuse/common/client.h>
+#include <mega/fuse/common/database.h>
 #include <mega/fuse/common/error_or.h>
 #include <mega/fuse/common/inode.h>
+#include <mega/fuse/common/inode_db.h>
 #include <mega/fuse/common/inode_id.h>
 #include <mega/fuse/common/logging.h>
 #include <mega/fuse/common/mount_db.h>
@@ -17,6 +20,8 @@
 #include <mega/fuse/common/node_info.h>
 #include <mega/fuse/common/ref.h>
 #include <mega/fuse/common/scoped_query.h>
+#include <mega/fuse/common/service_flags.h>
+#include <mega/fuse/common/task_executor.h>
 #include <mega/fuse/common/transaction.h>
 #include <mega/fuse/platform/mount.h>
 #include <mega/fuse/platform/mount_db.h>
@@ -30,7 +35,10 @@ namespace fuse
 {
 
 MountDB::Queries::Queries(Database& mDatabase)
-  : mAddMount(mDatabase.query())
+  : mAddHotInode(mDatabase.query())
+  , mAddMount(mDatabase.query())
+  , mAgeHotInodesByPath(mDatabase.query())
+  , mGetHotInodesByPath(mDatabase.query())
   , mGetMountByPath(mDatabase.query())
   , mGetMountFlagsByPath(mDatabase.query())
   , mGetMountInodeByPath(mDatabase.query())
@@ -38,11 +46,19 @@ MountDB::Queries::Queries(Database& mDatabase)
   , mGetMountStartupStateByPath(mDatabase.query())
   , mGetMounts(mDatabase.query())
   , mGetMountsEnabledAtStartup(mDatabase.query())
+  , mIncrementHotInodeHits(mDatabase.query())
+  , mPruneHotInodesByPath(mDatabase.query())
   , mRemoveMountByPath(mDatabase.query())
   , mRemoveTransientMounts(mDatabase.query())
   , mSetMountFlagsByPath(mDatabase.query())
   , mSetMountStartupStateByPath(mDatabase.query())
 {
+    mAddHotInode = "insert or ignore into hot_inodes values ( "
+                   "  0, "
+                   "  :id, "
+                   "  :path "
+                   ")";
+
     mAddMount = "insert into mounts values ( "
                 "  :enable_at_startup, "
                 "  :id, "
@@ -52,6 +68,16 @@ MountDB::Queries::Queries(Database& mDatabase)
                 "  :read_only "
                 ")";
 
+    mAgeHotInodesByPath = "update hot_inodes "
+                          "   set hits = hits / 2 "
+                          " where path = :path";
+
+    mGetHotInodesByPath = "   select id "
+                          "     from hot_inodes "
+                          "    where path = :path "
+                          " order by hits desc "
+                          "    limit :count";
+
     mGetMountByPath = "select * from mounts where path = :path";
 
     mGetMountFlagsByPath = "select enable_at_startup "
@@ -77,6 +103,21 @@ MountDB::Queries::Queries(Database& mDatabase)
                                  " where enable_at_startup = true "
                                  "   and persistent = true";
 
+    mIncrementHotInodeHits = "update hot_inodes "
+                             "   set hits = hits + :hits "
+                             " where id = :id "
+                             "   and path = :path";
+
+    mPruneHotInodesByPath = "delete from hot_inodes "
+                            " where path = :path "
+                            "   and id not in ( "
+                            "         select id "
+                            "           from hot_inodes "
+                            "          where path = :path "
+                            "       order by hits desc "
+                            "          limit :count "
+                            "       )";
+
     mRemoveMountByPath = "delete from mounts where path = :path";
 
     mRemoveTransientMounts = "delete from mounts where persistent = false";
@@ -216,6 +257,28 @@ catch (std::runtime_error& exception)
                exception.what());
 }
 
+InodeIDVector MountDB::hotInodes(const LocalPath& path,
+                                 std::size_t count) const
+{
+    // Acquire database lock.
+    DatabaseLock guard(mContext.mDatabase);
+
+    // Retrieve the mount's hottest inodes.
+    auto transaction = mContext.mDatabase.transaction();
+    auto query = transaction.query(mQueries.mGetHotInodesByPath);
+
+    query.param(":count").uint64(count);
+    query.param(":path") = path;
+
+    InodeIDVector ids;
+
+    for (query.execute(); query; ++query)
+        ids.emplace_back(query.field("id").inode());
+
+    // Return the inodes to our caller.
+    return ids;
+}
+
 void MountDB::invalidate()
 {
     // Tracks which inodes have been invalidated.
@@ -278,6 +341,9 @@ platform::MountPtr MountDB::mount(const LocalPath& path) const
 
 platform::MountPtr MountDB::remove(platform::Mount& mount)
 {
+    // Make sure the mount's changes are on disk.
+    mContext.mDatabase.flush();
+
     MountDBLock guard(*this);
 
     // Is the mount in the index?
@@ -983,6 +1049,54 @@ catch (std::runtime_error& exception)
     return MountInfoVector();
 }
 
+void MountDB::hotInodes(const LocalPath& path,
+                        const FromInodeIDMap<std::size_t>& hits)
+try
+{
+    // Acquire database lock.
+    DatabaseLock guard(mContext.mDatabase);
+
+    auto transaction = mContext.mDatabase.transaction();
+
+    // Age existing hit counts so that stale inodes cool off over time.
+    auto query = transaction.query(mQueries.mAgeHotInodesByPath);
+
+    query.param(":path") = path;
+    query.execute();
+
+    // Record how often each inode was accessed.
+    for (auto& h : hits)
+    {
+        query = transaction.query(mQueries.mAddHotInode);
+
+        query.param(":id") = h.first;
+        query.param(":path") = path;
+        query.execute();
+
+        query = transaction.query(mQueries.mIncrementHotInodeHits);
+
+        query.param(":hits").uint64(h.second);
+        query.param(":id") = h.first;
+        query.param(":path") = path;
+        query.execute();
+    }
+
+    // Only remember the mount's hottest inodes.
+    query = transaction.query(mQueries.mPruneHotInodesByPath);
+
+    query.param(":count").uint64(MaxHotInodes);
+    query.param(":path") = path;
+    query.execute();
+
+    transaction.commit();
+}
+catch (std::runtime_error& exception)
+{
+    FUSEErrorF("Unable to record hot inodes for mount %s: %s",
+               path.toPath(false).c_str(),
+               exception.what());
+}
+
 NormalizedPathVector MountDB::paths(const std::string& name) const
 try
 {
@@ -1009,6 +1123,66 @@ catch (std::runtime_error& exception)
     return NormalizedPathVector();
 }
 
+void MountDB::prefetch(const LocalPath& path)
+{
+    // Loads the mount's hottest inodes into memory.
+    auto prefetch = [this](Activity&,
+                           const LocalPath& path,
+                           const Task& task) {
+        // Prefetch's been cancelled.
+        if (task.cancelled())
+            return;
+
+        // Don't load more inodes than the cache can keep in memory.
+        auto count = std::min(MaxHotInodes,
+                              mContext.serviceFlags().mInodeCacheFlags.mMaxSize);
+
+        // Which inodes are hot under this mount?
+        auto ids = ([&]() {
+            try
+            {
+                return hotInodes(path, count);
+            }
+            catch (std::runtime_error& exception)
+            {
+                FUSEErrorF("Unable to retrieve hot inodes for mount %s: %s",
+                           path.toPath(false).c_str(),
+                           exception.what());
+
+                return InodeIDVector();
+            }
+        })();
+
+        // Convenience.
+        auto& inodeDB = mContext.mInodeDB;
+
+        // Load each inode into memory.
+        //
+        // Retrieving an inode adds it to the inode cache which will
+        // keep it in memory after we've released our reference.
+        for (auto& id : ids)
+        {
+            // Executor's being torn down.
+            if (task.cancelled())
+                return;
+
+            inodeDB.get(id);
+        }
+
+        FUSEDebugF("Prefetched %zu hot inode(s) for mount %s",
+                   ids.size(),
+                   path.toPath(false).c_str());
+    }; // prefetch
+
+    // Queue the prefetch for execution.
+    mContext.mExecutor.execute(std::bind(std::move(prefetch),
+                                         mActivities.begin(),
+                                         path,
+                                         std::placeholders::_1),
+                               true,
+                               TASK_PRIORITY_FLUSH);
+}
+
 MountResult MountDB::prune()
 try
 {
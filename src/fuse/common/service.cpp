@@ -3,6 +3,7 @@
 
 #include <mega/fuse/common/client.h>
 #include <mega/fuse/common/error_or.h>
+#include <mega/fuse/common/file_cache_statistics.h>
 #include <mega/fuse/common/inode_info.h>
 #include <mega/fuse/common/logging.h>
 #include <mega/fuse/common/mount_event_type.h>
@@ -153,6 +154,14 @@ Task Service::execute(std::function<void(const Task&)> function)
     return task;
 }
 
+FileCacheStatistics Service::fileCacheStatistics() const
+{
+    if (mContext)
+        return mContext->fileCacheStatistics();
+
+    return FileCacheStatistics();
+}
+
 MountResult Service::flags(const NormalizedPath& path,
                            const MountFlags& flags)
 {
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <thread>
@@ -34,12 +35,32 @@ public:
     ~Worker();
 }; // Worker
 
+bool TaskExecutor::eligible(TaskPriority priority) const
+{
+    // How many workers are busy with tasks of this priority or lower?
+    std::size_t busy = 0u;
+
+    for (auto i = static_cast<std::size_t>(priority); i < TASK_PRIORITY_ALL; ++i)
+        busy += mBusyWorkers[i];
+
+    // Each step down in priority reserves another worker.
+    auto limit = mFlags.mMaxWorkers;
+
+    if (limit > priority)
+        limit -= priority;
+    else
+        limit = 1u;
+
+    return busy < limit;
+}
+
 TaskExecutor::TaskExecutor(const TaskExecutorFlags& flags)
   : mAvailableWorkers(0u)
+  , mBusyWorkers()
   , mCV()
   , mFlags(flags)
   , mLock()
-  , mTaskQueue()
+  , mTaskQueues()
   , mTerminating(false)
   , mWorkers()
 {
@@ -81,10 +102,12 @@ TaskExecutor::~TaskExecutor()
 
 Task TaskExecutor::execute(std::function<void(const Task&)> function,
                            std::chrono::steady_clock::time_point when,
-                           bool spawnWorker)
+                           bool spawnWorker,
+                           TaskPriority priority)
 {
     // Sanity.
     assert(function);
+    assert(priority < TASK_PRIORITY_ALL);
 
     // Instantiate a new task.
     auto task = Task(std::move(function), when);
@@ -131,7 +154,7 @@ Task TaskExecutor::execute(std::function<void(const Task&)> function,
     assert(!mWorkers.empty());
 
     // Queue the task for execution.
-    mTaskQueue.queue(task);
+    mTaskQueues[priority].queue(task);
 
     // Release executor lock.
     lock.unlock();
@@ -166,29 +189,67 @@ void TaskExecutor::Worker::loop()
 
     // Convenience.
     auto& availableWorkers = mExecutor.mAvailableWorkers;
+    auto& busyWorkers = mExecutor.mBusyWorkers;
     auto& cv = mExecutor.mCV;
     auto& flags = mExecutor.mFlags;
-    auto& taskQueue = mExecutor.mTaskQueue;
+    auto& taskQueues = mExecutor.mTaskQueues;
     auto& terminating = mExecutor.mTerminating;
     auto& workers = mExecutor.mWorkers;
 
+    // Are any tasks queued?
+    auto hasTasks = [&]() {
+        for (auto& taskQueue : taskQueues)
+        {
+            if (!taskQueue.empty())
+                return true;
+        }
+
+        return false;
+    }; // hasTasks
+
+    // What's the most urgent task we can execute right now, if any?
+    auto nextPriority = [&]() {
+        for (auto i = 0u; i < TASK_PRIORITY_ALL; ++i)
+        {
+            auto priority = static_cast<TaskPriority>(i);
+
+            if (taskQueues[i].ready() && mExecutor.eligible(priority))
+                return i;
+        }
+
+        return TASK_PRIORITY_ALL;
+    }; // nextPriority
+
     // When should we wake up?
     auto nextWakeup = [&]() {
-        if (!taskQueue.empty())
-            return taskQueue.when();
-
         using std::chrono::steady_clock;
 
-        return steady_clock::now() + flags.mIdleTime;
+        auto when = steady_clock::now() + flags.mIdleTime;
+
+        // Wake up when the earliest task we could execute is due.
+        //
+        // Tasks we're not yet eligible to execute will be signalled
+        // when a worker completes a task of lower priority.
+        for (auto i = 0u; i < TASK_PRIORITY_ALL; ++i)
+        {
+            auto priority = static_cast<TaskPriority>(i);
+
+            if (!taskQueues[i].empty() && mExecutor.eligible(priority))
+                when = std::min(when, taskQueues[i].when());
+        }
+
+        return when;
     }; // nextWakeup
 
     // Should we wake up?
     auto shouldWake = [&]() {
-        return terminating || taskQueue.ready();
+        return terminating || nextPriority() < TASK_PRIORITY_ALL;
     }; // shouldWake
 
     FUSEDebug1("Worker thread started");
 
+    TRACE_THREAD_NAME("fuse");
+
     // Execute queued tasks.
     while (true)
     {
@@ -207,7 +268,7 @@ void TaskExecutor::Worker::loop()
                 continue;
 
             // Keep at least a single worker alive if there tasks pending.
-            if (!taskQueue.empty() && workers.size() < 2)
+            if (hasTasks() && workers.size() < 2)
                 continue;
 
             // So we don't block on our own removal.
@@ -224,26 +285,41 @@ void TaskExecutor::Worker::loop()
         if (mExecutor.mTerminating)
             break;
 
+        // What's the most urgent task we can execute?
+        auto priority = nextPriority();
+
+        // Sanity.
+        assert(priority < TASK_PRIORITY_ALL);
+
         // Pop a task from the queue.
-        auto task = taskQueue.dequeue();
+        auto task = taskQueues[priority].dequeue();
 
         // Sanity.
         assert(task);
 
         // Let the executor know we're busy.
         --availableWorkers;
+        ++busyWorkers[priority];
 
         // Release the lock so other workers can proceed.
         lock.unlock();
 
         // Complete the task.
-        task.complete();
+        {
+            TRACE_SPAN("fuse_task");
+            task.complete();
+        }
 
         // Reacquire lock.
         lock.lock();
 
         // Let the executor know we're available.
         ++availableWorkers;
+        --busyWorkers[priority];
+
+        // A worker may now be eligible to execute a less urgent task.
+        if (priority != TASK_PRIORITY_METADATA)
+            cv.notify_one();
     }
 
     --availableWorkers;
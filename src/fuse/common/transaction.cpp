@@ -26,7 +26,7 @@ Transaction::Transaction()
 Transaction::Transaction(Badge<Database>, Database& database)
   : mDB(&database)
 {
-    auto message = mDB->execute({}, "savepoint txn");
+    auto message = mDB->begin({});
 
     if (!message.empty())
         throw FUSEErrorF("Unable to start transaction: %s",
@@ -67,7 +67,7 @@ void Transaction::commit()
     if (!mDB)
         throw FUSEError1("Can't commit an inactive transaction");
 
-    auto message = mDB->execute({}, "release savepoint txn");
+    auto message = mDB->end({}, "release savepoint txn", true);
 
     if (!message.empty())
         throw FUSEErrorF("Unable to commit transaction: %s",
@@ -101,7 +101,7 @@ void Transaction::rollback()
     auto message = mDB->execute({}, "rollback transaction to savepoint txn");
 
     if (message.empty())
-        message = mDB->execute({}, "release savepoint txn");
+        message = mDB->end({}, "release savepoint txn", false);
 
     if (!message.empty())
         throw FUSEErrorF("Unable to rollback transaction: %s",
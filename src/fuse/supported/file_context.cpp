@@ -21,6 +21,9 @@ FileContext::FileContext(FileIOContextRef context,
 {
     FUSEDebugF("File Context %s created",
                toString(mContext->id()).c_str());
+
+    // Let the mount know the file's been accessed.
+    mount.accessed(mContext->id());
 }
 
 FileContext::~FileContext()
@@ -49,6 +52,13 @@ ErrorOr<std::string> FileContext::read(m_off_t offset, unsigned int size)
     return mContext->read(mount(), offset, size);
 }
 
+ErrorOr<std::string> FileContext::read(m_off_t offset,
+                                       unsigned int size,
+                                       const LocalReader& reader)
+{
+    return mContext->read(mount(), offset, size, reader);
+}
+
 Error FileContext::touch(m_time_t modified)
 {
     return mContext->touch(mount(), modified);
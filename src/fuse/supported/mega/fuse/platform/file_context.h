@@ -44,6 +44,11 @@ public:
     // Read data from the file.
     ErrorOr<std::string> read(m_off_t offset, unsigned int size);
 
+    // Read data from the file, letting reader transfer local content.
+    ErrorOr<std::string> read(m_off_t offset,
+                              unsigned int size,
+                              const LocalReader& reader);
+
     // Update the file's modification time.
     Error touch(m_time_t modified);
 
@@ -65,6 +65,9 @@ public:
     // Execute a function on some thread.
     Task execute(std::function<void(const Task&)> function) override;
 
+    // Describe the state of the file cache.
+    FileCacheStatistics fileCacheStatistics() const override;
+
     // Update a mount's flags.
     MountResult flags(const LocalPath& path,
                       const MountFlags& flags) override;
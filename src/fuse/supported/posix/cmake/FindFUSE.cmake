@@ -1,25 +1,53 @@
+# Prefer libfuse3 where it's available.
 find_path(FUSE_INCLUDE_DIR
-          fuse_common.h
+          fuse_lowlevel.h
           HINTS
           $ENV{FUSE_PREFIX}
           PATH_SUFFIXES
-          include/fuse
+          include/fuse3
 )
 
 find_library(FUSE_LIBRARY
-             libfuse.dylib
-             libfuse.so
+             libfuse3.so
              HINTS
              $ENV{FUSE_PREFIX}
              PATH_SUFFIXES
              lib
 )
 
+if (FUSE_INCLUDE_DIR AND FUSE_LIBRARY)
+    set(FUSE_USE_FUSE3 TRUE)
+else()
+    unset(FUSE_INCLUDE_DIR CACHE)
+    unset(FUSE_LIBRARY CACHE)
+
+    find_path(FUSE_INCLUDE_DIR
+              fuse_common.h
+              HINTS
+              $ENV{FUSE_PREFIX}
+              PATH_SUFFIXES
+              include/fuse
+    )
+
+    find_library(FUSE_LIBRARY
+                 libfuse.dylib
+                 libfuse.so
+                 HINTS
+                 $ENV{FUSE_PREFIX}
+                 PATH_SUFFIXES
+                 lib
+    )
+endif()
+
 if (FUSE_INCLUDE_DIR AND FUSE_LIBRARY)
     find_package(Threads)
 
     set(FUSE_DEFINITIONS -D_FILE_OFFSET_BITS=64)
 
+    if (FUSE_USE_FUSE3)
+        list(APPEND FUSE_DEFINITIONS -DHAVE_FUSE3)
+    endif()
+
     if (CMAKE_VERSION VERSION_GREATER_EQUAL "3.20.0")
         cmake_path(GET FUSE_INCLUDE_DIR PARENT_PATH FUSE_INCLUDE_DIRS)
     else()
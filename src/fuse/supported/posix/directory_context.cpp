@@ -2,6 +2,7 @@
 #include <mega/fuse/common/inode.h>
 #include <mega/fuse/common/inode_info.h>
 #include <mega/fuse/common/logging.h>
+#include <mega/fuse/common/mount.h>
 #include <mega/fuse/platform/directory_context.h>
 
 namespace mega
@@ -16,8 +17,11 @@ void DirectoryContext::populate() const
     std::lock_guard<std::mutex> guard(mLock);
 
     // Retrieve children if necessary.
+    //
+    // Each child's description is captured at the same time so that we
+    // don't have to ask the client about each child individually.
     if (!mPopulated)
-        mChildren = mDirectory->children();
+        mChildren = mDirectory->children(mInfos);
 
     // Remember that we've retrieved this directory's children.
     mPopulated = true;
@@ -28,6 +32,7 @@ DirectoryContext::DirectoryContext(DirectoryInodeRef directory,
   : Context(mount)
   , mChildren()
   , mDirectory(std::move(directory))
+  , mInfos()
   , mLock()
   , mParent(mDirectory->parent())
   , mPopulated(false)
@@ -35,6 +40,9 @@ DirectoryContext::DirectoryContext(DirectoryInodeRef directory,
     FUSEDebugF("Directory Context %s created",
                toString(mDirectory->id()).c_str());
 
+    // Let the mount know the directory's been accessed.
+    mount.accessed(mDirectory->id());
+
     // Directory has no parent but one must be reported.
     if (!mParent)
         mParent = mDirectory;
@@ -70,6 +78,23 @@ InodeInfo DirectoryContext::get(std::size_t index) const
     if (!child || child->removed())
         return InodeInfo();
 
+    // Have we already captured the child's description?
+    if (index >= 2 && mInfos[index - 2].mID)
+    {
+        auto info = mInfos[index - 2];
+
+        // Child may have been moved since we captured its description.
+        info.mName = child->name(CachedOnly);
+        info.mParentID = InodeID(child->parentHandle(CachedOnly));
+
+        // Child's no longer below this directory.
+        if (info.mParentID != mDirectory->id())
+            return InodeInfo();
+
+        // Return description to caller.
+        return info;
+    }
+
     // Get our hands on the child's description.
     auto info = child->info();
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
 
 #include <mega/fuse/common/constants.h>
@@ -11,8 +12,20 @@ namespace fuse
 namespace platform
 {
 
-constexpr auto AttributeTimeout = 120.0;
-constexpr auto EntryTimeout = 120.0;
+// How long the kernel may cache attributes and directory entries.
+//
+// These are long as InodeDB invalidates the kernel's cache whenever a
+// node changes in the cloud. Anything the kernel caches is pinned and so
+// always in memory when an event arrives for it.
+constexpr auto AttributeTimeout = 86400.0;
+constexpr auto EntryTimeout = 86400.0;
+
+// Largest read and write the kernel should send us.
+constexpr unsigned int MaxReadSize = 1u << 20;
+constexpr unsigned int MaxWriteSize = 1u << 20;
+
+// Reads at least this large are spliced from the file cache.
+constexpr std::size_t SpliceThreshold = 64u << 10;
 
 extern const std::string FilesystemName;
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <mega/fuse/common/directory_inode_forward.h>
+#include <mega/fuse/common/inode_info.h>
 #include <mega/fuse/common/ref.h>
 #include <mega/fuse/platform/context.h>
 #include <mega/fuse/platform/directory_context_forward.h>
@@ -24,6 +25,9 @@ class DirectoryContext
     // The directory we're iterating.
     DirectoryInodeRef mDirectory;
 
+    // What each child looked like when we retrieved it.
+    mutable InodeInfoVector mInfos;
+
     // Serializes access to instance members.
     mutable std::mutex mLock;
 
@@ -1,5 +1,10 @@
 #pragma once
 
+#ifdef HAVE_FUSE3
+#define FUSE_USE_VERSION 35
+#include <fuse3/fuse_lowlevel.h>
+#else // HAVE_FUSE3
 #define FUSE_USE_VERSION 26
 #include <fuse/fuse_lowlevel.h>
+#endif // ! HAVE_FUSE3
 
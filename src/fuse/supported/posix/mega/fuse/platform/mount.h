@@ -12,6 +12,7 @@
 #include <mega/fuse/common/tags.h>
 #include <mega/fuse/common/task_executor_flags_forward.h>
 #include <mega/fuse/common/task_executor.h>
+#include <mega/fuse/common/task_priority.h>
 #include <mega/fuse/platform/inode_invalidator.h>
 #include <mega/fuse/platform/library.h>
 #include <mega/fuse/platform/mount_forward.h>
@@ -45,6 +46,18 @@ class Mount final
     void execute(void (Mount::*callback)(Parameters...),
                  bool spawnWorker,
                  Arguments&&... arguments)
+    {
+        execute(callback,
+                TASK_PRIORITY_METADATA,
+                spawnWorker,
+                std::forward<Arguments>(arguments)...);
+    }
+
+    template<typename... Arguments, typename... Parameters>
+    void execute(void (Mount::*callback)(Parameters...),
+                 TaskPriority priority,
+                 bool spawnWorker,
+                 Arguments&&... arguments)
     {
         using Callback = std::function<void()>;
         using Wrapper = std::function<void(const Task&)>;
@@ -63,7 +76,7 @@ class Mount final
                                      std::move(callback_),
                                      std::placeholders::_1);
 
-        mExecutor.execute(std::move(wrapper_), spawnWorker);
+        mExecutor.execute(std::move(wrapper_), spawnWorker, priority);
     }
 
     void lookup(Request request,
@@ -119,6 +132,14 @@ class Mount final
                  off_t offset,
                  fuse_file_info& info);
 
+#ifdef HAVE_FUSE3
+    void readdirplus(Request request,
+                     MountInodeID inode,
+                     std::size_t size,
+                     off_t offset,
+                     fuse_file_info& info);
+#endif // HAVE_FUSE3
+
     void release(Request request,
                  MountInodeID inode,
                  fuse_file_info& info);
@@ -29,6 +29,14 @@ public:
                      const std::size_t offset,
                      const std::size_t size);
 
+#ifdef HAVE_FUSE3
+    bool addDirEntryPlus(const struct fuse_entry_param& entry,
+                         std::string& buffer,
+                         const std::string& name,
+                         const std::size_t offset,
+                         const std::size_t size);
+#endif // HAVE_FUSE3
+
     gid_t group() const;
 
     uid_t owner() const;
@@ -40,6 +48,8 @@ public:
 
     void replyBuffer(const std::string& buffer);
 
+    void replyData(int descriptor, off_t offset, std::size_t size);
+
     void replyEntry(const struct fuse_entry_param& entry);
 
     void replyError(int error);
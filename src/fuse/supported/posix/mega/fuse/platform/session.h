@@ -1,7 +1,9 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <mega/fuse/common/mount_inode_id.h>
 #include <mega/fuse/platform/library.h>
@@ -82,6 +84,14 @@ class Session
                         off_t offset,
                         fuse_file_info* info);
 
+#ifdef HAVE_FUSE3
+    static void readdirplus(fuse_req_t request,
+                            fuse_ino_t inode,
+                            std::size_t size,
+                            off_t offset,
+                            fuse_file_info* info);
+#endif // HAVE_FUSE3
+
     static void release(fuse_req_t request,
                         fuse_ino_t inode,
                         fuse_file_info* info);
@@ -94,7 +104,12 @@ class Session
                        fuse_ino_t sourceParent,
                        const char* sourceName,
                        fuse_ino_t targetParent,
+#ifdef HAVE_FUSE3
+                       const char* targetName,
+                       unsigned int flags);
+#else // HAVE_FUSE3
                        const char* targetName);
+#endif // ! HAVE_FUSE3
 
     static void rmdir(fuse_req_t request,
                       fuse_ino_t parent,
@@ -120,11 +135,33 @@ class Session
                       off_t offset,
                       fuse_file_info* info);
 
+#ifdef HAVE_FUSE3
+    // Who do we send notifications to?
+    fuse_session* notifier() const;
+
+    // Receives requests from FUSE.
+    fuse_buf mBuffer;
+#else // HAVE_FUSE3
+    // Who do we send notifications to?
+    fuse_chan* notifier() const;
+
+    // Receives requests from FUSE.
+    std::vector<char> mBuffer;
+#endif // ! HAVE_FUSE3
+
+    // How large is the request in mBuffer?
+    std::size_t mBufferSize;
+
+#ifndef HAVE_FUSE3
     fuse_chan* mChannel;
+#endif // ! HAVE_FUSE3
     Mount& mMount;
     static const fuse_lowlevel_ops mOperations;
     fuse_session* mSession;
 
+    // Is the kernel caching writes for us?
+    std::atomic<bool> mWritebackCache;
+
 public:
     Session(Mount& mount);
 
@@ -133,12 +170,15 @@ public:
     // What descriptor is the session using to communicate with FUSE?
     int descriptor() const;
 
-    // Dispatch a request received from FUSE.
-    void dispatch(std::string request);
+    // Dispatch the request last received from FUSE.
+    void dispatch();
 
     // Has this session exited?
     bool exited() const;
 
+    // Is the kernel caching writes for us?
+    bool writebackCache() const;
+
     // Invalidate an inode's attributes.
     void invalidateAttributes(MountInodeID id);
 
@@ -157,8 +197,8 @@ public:
     void invalidateEntry(const std::string& name,
                          MountInodeID parent);
 
-    // Retrieve the next request from FUSE.
-    std::string nextRequest();
+    // Receive the next request from FUSE.
+    void nextRequest();
 }; // Session
 
 } // platform
@@ -1,3 +1,5 @@
+#include <fcntl.h>
+
 #include <chrono>
 
 #include <cassert>
@@ -17,6 +19,7 @@
 #include <mega/fuse/platform/constants.h>
 #include <mega/fuse/platform/directory_context.h>
 #include <mega/fuse/platform/file_context.h>
+#include <mega/fuse/platform/file_descriptor.h>
 #include <mega/fuse/platform/library.h>
 #include <mega/fuse/platform/mount.h>
 #include <mega/fuse/platform/mount_db.h>
@@ -348,7 +351,10 @@ void Mount::open(Request request,
         flags |= FOF_WRITABLE;
 
         // User wants to append data to the file.
-        if ((info.flags & O_APPEND))
+        //
+        // When the kernel's caching writes, it resolves the offset of
+        // each append itself so we mustn't adjust it again.
+        if ((info.flags & O_APPEND) && !mSession.writebackCache())
             flags |= FOF_APPEND;
 
         // User wants to truncate existing content.
@@ -422,13 +428,49 @@ void Mount::read(Request request,
     // Sanity.
     assert(context);
 
+    // Whether the data was spliced straight from the file cache.
+    auto spliced = false;
+
+    // Hands the file's local content directly to FUSE.
+    auto splice = [&](const LocalPath& path,
+                      m_off_t offset,
+                      unsigned int size) -> Error {
+        // Try and open the file's local content.
+        FileDescriptor descriptor(::open(path.toPath(false).c_str(),
+                                         O_RDONLY));
+
+        // Couldn't open the file's local content.
+        if (!descriptor)
+            return API_EREAD;
+
+        // Pass the content to FUSE.
+        request.replyData(descriptor.get(), offset, size);
+
+        // Let our caller know the data's been transferred.
+        spliced = true;
+
+        return API_OK;
+    }; // splice
+
+    // Small reads aren't worth the cost of opening a descriptor.
+    auto reader = LocalReader();
+
+    if (size >= SpliceThreshold)
+        reader = std::move(splice);
+
     // Try and read the file.
-    auto result = context->read(offset, static_cast<unsigned int>(size));
+    auto result = context->read(offset,
+                                static_cast<unsigned int>(size),
+                                reader);
 
     // Couldn't read the file.
     if (!result)
         return request.replyError(translate(result.error()));
 
+    // Data's already been passed to FUSE.
+    if (spliced)
+        return;
+
     // Pass read data to FUSE.
     request.replyBuffer(std::move(*result));
 }
@@ -491,6 +533,96 @@ void Mount::readdir(Request request,
     request.replyBuffer(std::move(buffer));
 }
 
+#ifdef HAVE_FUSE3
+
+void Mount::readdirplus(Request request,
+                        MountInodeID inode,
+                        std::size_t size,
+                        off_t offset,
+                        fuse_file_info& info)
+{
+    // Retrieve directory context.
+    auto* context = reinterpret_cast<DirectoryContext*>(info.fh);
+
+    // Sanity.
+    assert(context);
+    assert(offset >= 0);
+
+    // Where we'll be storing directory entries.
+    std::string buffer;
+
+    // Type safety.
+    auto m = static_cast<std::size_t>(offset);
+    auto n = context->size();
+
+    // Collect directory entries.
+    //
+    // NOTE: Like readdir(...), the first two entries are . and ..
+    while (m < n)
+    {
+        // Get information about the current child.
+        auto info = context->get(m);
+
+        // Child no longer exists.
+        if (!info.mID)
+        {
+            // Either we or our parent no longer exist.
+            if (m++ < 2)
+                return request.replyBuffer(std::string());
+
+            // Process the next child.
+            continue;
+        }
+
+        // The kernel only bumps the lookup count of real children.
+        auto pinned = m >= 2;
+
+        InodeRef childRef;
+
+        // Make sure the child's still around if we need to pin it.
+        if (pinned && !(childRef = get(map(info.mID))))
+        {
+            ++m;
+            continue;
+        }
+
+        // Mount's not writable.
+        if (!writable())
+            info.mPermissions = RDONLY;
+
+        auto entry = fuse_entry_param();
+
+        std::memset(&entry, 0, sizeof(entry));
+
+        entry.attr_timeout = AttributeTimeout;
+        entry.entry_timeout = EntryTimeout;
+
+        // Translate info into something meaningful.
+        translate(entry, map(info.mID), info);
+
+        // . and .. don't carry attributes.
+        if (!pinned)
+            entry.ino = 0;
+
+        // Try and add the entry to our buffer.
+        if (!request.addDirEntryPlus(entry,
+                                     buffer,
+                                     info.mName,
+                                     ++m,
+                                     size - buffer.size()))
+            break;
+
+        // Kernel's now holding a reference to this child.
+        if (pinned)
+            pin(std::move(childRef), info);
+    }
+
+    // Report directory entries to FUSE.
+    request.replyBuffer(std::move(buffer));
+}
+
+#endif // HAVE_FUSE3
+
 void Mount::release(Request request,
                     MountInodeID inode,
                     fuse_file_info& info)
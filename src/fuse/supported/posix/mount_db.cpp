@@ -180,11 +180,11 @@ void MountDB::dispatch()
             if (!descriptors.set(*session))
                 continue;
 
-            // Retrieve the latest request from the session.
-            auto request = session->nextRequest();
+            // Receive the latest request from the session.
+            session->nextRequest();
 
             // Dispatch the request.
-            session->dispatch(std::move(request));
+            session->dispatch();
         }
     }
 }
@@ -202,6 +202,8 @@ void MountDB::loop()
 {
     FUSEDebug1("Mount Request Dispatcher started");
 
+    TRACE_THREAD_NAME("fuse dispatcher");
+
     dispatch();
 
     FUSEDebug1("Mount Request Dispatcher stopped");
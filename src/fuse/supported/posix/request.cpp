@@ -69,6 +69,46 @@ bool Request::addDirEntry(const struct stat& attributes,
     return true;
 }
 
+#ifdef HAVE_FUSE3
+
+bool Request::addDirEntryPlus(const struct fuse_entry_param& entry,
+                              std::string& buffer,
+                              const std::string& name,
+                              const std::size_t offset,
+                              const std::size_t size)
+{
+    // How much have we written to the buffer?
+    auto current = buffer.size();
+
+    // How much space does this entry need?
+    auto required = fuse_add_direntry_plus(mRequest,
+                                           nullptr,
+                                           0,
+                                           name.c_str(),
+                                           nullptr,
+                                           0);
+
+    // Don't have enough space for this entry.
+    if (current + required > size)
+        return false;
+
+    // Expand the buffer.
+    buffer.resize(current + required);
+
+    // Add the entry to the buffer.
+    fuse_add_direntry_plus(mRequest,
+                           &buffer[current],
+                           required,
+                           name.c_str(),
+                           &entry,
+                           static_cast<off_t>(offset));
+
+    // Let the caller know the entry's been added.
+    return true;
+}
+
+#endif // HAVE_FUSE3
+
 gid_t Request::group() const
 {
     return fuse_req_ctx(mRequest)->gid;
@@ -101,6 +141,21 @@ void Request::replyBuffer(const std::string& buffer)
     });
 }
 
+void Request::replyData(int descriptor, off_t offset, std::size_t size)
+{
+    reply([&](fuse_req_t request) {
+        fuse_bufvec buffer = FUSE_BUFVEC_INIT(size);
+
+        // Let FUSE move the data straight from the descriptor.
+        buffer.buf[0].flags =
+          static_cast<fuse_buf_flags>(FUSE_BUF_IS_FD | FUSE_BUF_FD_SEEK);
+        buffer.buf[0].fd = descriptor;
+        buffer.buf[0].pos = offset;
+
+        return fuse_reply_data(request, &buffer, FUSE_BUF_SPLICE_MOVE);
+    });
+}
+
 void Request::replyEntry(const struct fuse_entry_param& entry)
 {
     reply([&](fuse_req_t request) {
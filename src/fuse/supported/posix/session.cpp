@@ -1,4 +1,5 @@
 #include <cassert>
+#include <cstdlib>
 #include <cstring>
 #include <vector>
 
@@ -14,6 +15,8 @@
 #include <mega/fuse/platform/service_context.h>
 #include <mega/fuse/platform/session.h>
 
+#include <mega/metrics.h>
+
 namespace mega
 {
 namespace fuse
@@ -67,6 +70,9 @@ const fuse_lowlevel_ops Session::mOperations = {
     /*   forget_multi */ &forget_multi,
     /*          flock */ nullptr,
     /*      fallocate */ nullptr,
+#ifdef HAVE_FUSE3
+    /*    readdirplus */ &readdirplus,
+#endif // HAVE_FUSE3
 #ifdef __APPLE__
     /*     reserved00 */ nullptr,
     /*     reserved01 */ nullptr,
@@ -97,13 +103,19 @@ void Session::access(fuse_req_t request,
                            mask);
 }
 
-void Session::init(void*, fuse_conn_info* connection)
+void Session::init(void* context, fuse_conn_info* connection)
 {
 #define ENTRY(name) {#name, name}
     const std::map<std::string, unsigned int> capabilities = {
         ENTRY(FUSE_CAP_ASYNC_READ),
         ENTRY(FUSE_CAP_ATOMIC_O_TRUNC),
+#ifdef HAVE_FUSE3
+        ENTRY(FUSE_CAP_PARALLEL_DIROPS),
+        ENTRY(FUSE_CAP_READDIRPLUS),
+        ENTRY(FUSE_CAP_WRITEBACK_CACHE),
+#else // HAVE_FUSE3
         ENTRY(FUSE_CAP_BIG_WRITES),
+#endif // ! HAVE_FUSE3
         ENTRY(FUSE_CAP_DONT_MASK),
         ENTRY(FUSE_CAP_EXPORT_SUPPORT),
         ENTRY(FUSE_CAP_FLOCK_LOCKS),
@@ -117,6 +129,26 @@ void Session::init(void*, fuse_conn_info* connection)
 
     connection->want |= FUSE_CAP_ATOMIC_O_TRUNC;
 
+    // Let FUSE splice read replies out of the file cache where it can.
+    connection->want |= connection->capable
+                        & (FUSE_CAP_SPLICE_MOVE | FUSE_CAP_SPLICE_WRITE);
+
+#ifdef HAVE_FUSE3
+    // Let the kernel send us larger writes.
+    connection->max_write = MaxWriteSize;
+
+    // Let the kernel coalesce writes, run lookups in parallel and send
+    // us attributes along with directory entries.
+    connection->want |= connection->capable
+                        & (FUSE_CAP_PARALLEL_DIROPS
+                           | FUSE_CAP_READDIRPLUS
+                           | FUSE_CAP_WRITEBACK_CACHE);
+
+    // Latch whether the kernel's caching writes for us.
+    mount(context).mSession.mWritebackCache =
+      (connection->want & FUSE_CAP_WRITEBACK_CACHE) > 0;
+#endif // HAVE_FUSE3
+
     for (auto& entry : capabilities)
     {
         auto capable = (connection->capable & entry.second) > 0;
@@ -155,6 +187,7 @@ void Session::flush(fuse_req_t request,
                request);
 
     mount(request).execute(&Mount::flush,
+                           TASK_PRIORITY_FLUSH,
                            true,
                            Request(request),
                            inode_,
@@ -209,6 +242,7 @@ void Session::fsync(fuse_req_t request,
                request);
 
     mount(request).execute(&Mount::fsync,
+                           TASK_PRIORITY_FLUSH,
                            true,
                            Request(request),
                            inode_,
@@ -325,6 +359,7 @@ void Session::read(fuse_req_t request,
                size);
 
     mount(request).execute(&Mount::read,
+                           TASK_PRIORITY_DATA,
                            true,
                            Request(request),
                            inode_,
@@ -357,6 +392,34 @@ void Session::readdir(fuse_req_t request,
                            *info);
 }
 
+#ifdef HAVE_FUSE3
+
+void Session::readdirplus(fuse_req_t request,
+                          fuse_ino_t inode,
+                          std::size_t size,
+                          off_t offset,
+                          fuse_file_info* info)
+{
+    MountInodeID inode_(inode);
+
+    FUSEDebugF("readdirplus: info: %p, inode: %s, offset: %d, size: %zu, request: %p",
+               info,
+               toString(inode_).c_str(),
+               offset,
+               size,
+               request);
+
+    mount(request).execute(&Mount::readdirplus,
+                           true,
+                           Request(request),
+                           inode_,
+                           size,
+                           offset,
+                           *info);
+}
+
+#endif // HAVE_FUSE3
+
 void Session::release(fuse_req_t request,
                       fuse_ino_t inode,
                       fuse_file_info* info)
@@ -396,8 +459,19 @@ void Session::rename(fuse_req_t request,
                      fuse_ino_t parent,
                      const char* name,
                      fuse_ino_t newParent,
+#ifdef HAVE_FUSE3
+                     const char* newName,
+                     unsigned int flags)
+#else // HAVE_FUSE3
                      const char* newName)
+#endif // ! HAVE_FUSE3
 {
+#ifdef HAVE_FUSE3
+    // We don't support RENAME_EXCHANGE or RENAME_NOREPLACE.
+    if (flags)
+        return Request(request).replyError(EINVAL);
+#endif // HAVE_FUSE3
+
     MountInodeID parent_(parent);
     MountInodeID newParent_(newParent);
 
@@ -524,6 +598,7 @@ void Session::write(fuse_req_t request,
                size);
 
     mount(request).execute(&Mount::write,
+                           TASK_PRIORITY_DATA,
                            true,
                            Request(request),
                            inode_,
@@ -533,9 +608,14 @@ void Session::write(fuse_req_t request,
 }
 
 Session::Session(Mount& mount)
-  : mChannel(nullptr)
+  : mBuffer()
+  , mBufferSize(0)
+#ifndef HAVE_FUSE3
+  , mChannel(nullptr)
+#endif // ! HAVE_FUSE3
   , mMount(mount)
   , mSession(nullptr)
+  , mWritebackCache(false)
 {
     std::vector<char*> pointers;
     std::vector<std::string> values;
@@ -546,8 +626,13 @@ Session::Session(Mount& mount)
     values.emplace_back(format("-ofsname=%s",  FilesystemName.c_str()));
     values.emplace_back(format("-osubtype=%s", FilesystemName.c_str()));
 
+#ifdef HAVE_FUSE3
+    // Let the kernel send us larger reads.
+    values.emplace_back(format("-omax_read=%u", MaxReadSize));
+#else // HAVE_FUSE3
     LINUX_ONLY(values.emplace_back("-ononempty"));
     POSIX_ONLY(values.emplace_back("-ovolname=" + mMount.name()));
+#endif // ! HAVE_FUSE3
 
     for (auto& value : values)
         pointers.emplace_back(&value[0]);
@@ -562,6 +647,25 @@ Session::Session(Mount& mount)
 
     auto path = mMount.path().toPath(false);
 
+#ifdef HAVE_FUSE3
+    mSession = fuse_session_new(&arguments,
+                                &mOperations,
+                                sizeof(mOperations),
+                                &mMount);
+
+    if (!mSession)
+        throw FUSEErrorF("Unable to construct session: %s", path.c_str());
+
+    if (fuse_session_mount(mSession, path.c_str()))
+    {
+        fuse_session_destroy(mSession);
+
+        throw FUSEErrorF("Unable to mount session: %s", path.c_str());
+    }
+
+    // The buffer's allocated by libfuse when we receive our first request.
+    std::memset(&mBuffer, 0, sizeof(mBuffer));
+#else // HAVE_FUSE3
     mChannel = fuse_mount(path.c_str(), &arguments);
     if (!mChannel)
         throw FUSEErrorF("Unable to construct channel: %s", path.c_str());
@@ -580,35 +684,53 @@ Session::Session(Mount& mount)
 
     fuse_session_add_chan(mSession, mChannel);
 
+    // Allocate a buffer large enough to hold any request.
+    mBuffer.resize(fuse_chan_bufsize(mChannel));
+#endif // ! HAVE_FUSE3
+
     FUSEDebugF("Session constructed: %s", path.c_str());
 }
 
 Session::~Session()
 {
-    assert(mChannel);
     assert(mSession);
 
-    fuse_session_remove_chan(mChannel);
+    auto path = mMount.path().toPath(false);
+
+#ifdef HAVE_FUSE3
+    fuse_session_unmount(mSession);
     fuse_session_destroy(mSession);
 
-    auto path = mMount.path().toPath(false);
+    // Release the buffer allocated by libfuse.
+    std::free(mBuffer.mem);
+#else // HAVE_FUSE3
+    assert(mChannel);
+
+    fuse_session_remove_chan(mChannel);
+    fuse_session_destroy(mSession);
 
     fuse_unmount(path.c_str(), mChannel);
+#endif // ! HAVE_FUSE3
 
     FUSEDebugF("Session destroyed: %s", path.c_str());
 }
 
 int Session::descriptor() const
 {
+#ifdef HAVE_FUSE3
+    assert(mSession);
+
+    return fuse_session_fd(mSession);
+#else // HAVE_FUSE3
     assert(mChannel);
 
     return fuse_chan_fd(mChannel);
+#endif // ! HAVE_FUSE3
 }
 
-void Session::dispatch(std::string request)
+void Session::dispatch()
 {
     // Sanity.
-    assert(mChannel);
     assert(mSession);
 
     // Session's been terminated.
@@ -616,13 +738,31 @@ void Session::dispatch(std::string request)
         return mMount.destroy();
 
     // Sanity.
-    assert(!request.empty());
+    assert(mBufferSize);
+
+    static auto& dispatchLatency = Metrics::registry().histogram("fuse_dispatch");
+    Metrics::ScopedLatency dispatchTimer(dispatchLatency);
+    TRACE_SPAN("fuse_dispatch");
 
     // Dispatch the request.
+    //
+    // Our handlers copy whatever they need so the buffer can be reused
+    // as soon as this call returns.
+#ifdef HAVE_FUSE3
+    fuse_session_process_buf(mSession, &mBuffer);
+#else // HAVE_FUSE3
+    assert(mChannel);
+
     fuse_session_process(mSession,
-                         request.data(),
-                         request.size(),
+                         mBuffer.data(),
+                         mBufferSize,
                          mChannel);
+#endif // ! HAVE_FUSE3
+}
+
+bool Session::writebackCache() const
+{
+    return mWritebackCache;
 }
 
 bool Session::exited() const
@@ -632,6 +772,26 @@ bool Session::exited() const
     return fuse_session_exited(mSession);
 }
 
+#ifdef HAVE_FUSE3
+
+fuse_session* Session::notifier() const
+{
+    assert(mSession);
+
+    return mSession;
+}
+
+#else // HAVE_FUSE3
+
+fuse_chan* Session::notifier() const
+{
+    assert(mChannel);
+
+    return mChannel;
+}
+
+#endif // ! HAVE_FUSE3
+
 void Session::invalidateAttributes(MountInodeID id)
 {
     return invalidateData(id, -1, 0);
@@ -639,12 +799,11 @@ void Session::invalidateAttributes(MountInodeID id)
 
 void Session::invalidateData(MountInodeID id, off_t offset, off_t length)
 {
-    assert(mChannel);
     assert(mSession);
 
     while (!fuse_session_exited(mSession))
     {
-        auto result = fuse_lowlevel_notify_inval_inode(mChannel,
+        auto result = fuse_lowlevel_notify_inval_inode(notifier(),
                                                        id.get(),
                                                        offset,
                                                        length);
@@ -671,12 +830,11 @@ void Session::invalidateEntry(const std::string& name,
                               MountInodeID parent)
 {
     assert(!name.empty());
-    assert(mChannel);
     assert(mSession);
 
     while (!fuse_session_exited(mSession))
     {
-        auto result = fuse_lowlevel_notify_delete(mChannel,
+        auto result = fuse_lowlevel_notify_delete(notifier(),
                                                   parent.get(),
                                                   child.get(),
                                                   name.c_str(),
@@ -699,12 +857,11 @@ void Session::invalidateEntry(const std::string& name,
 void Session::invalidateEntry(const std::string& name, MountInodeID parent)
 {
     assert(!name.empty());
-    assert(mChannel);
     assert(mSession);
 
     while (!fuse_session_exited(mSession))
     {
-        auto result = fuse_lowlevel_notify_inval_entry(mChannel,
+        auto result = fuse_lowlevel_notify_inval_entry(notifier(),
                                                        parent.get(),
                                                        name.c_str(),
                                                        name.size());
@@ -722,25 +879,30 @@ void Session::invalidateEntry(const std::string& name, MountInodeID parent)
     }
 }
 
-std::string Session::nextRequest()
+void Session::nextRequest()
 {
-    assert(mChannel);
     assert(mSession);
 
-    std::string buffer(fuse_chan_bufsize(mChannel), '\0');
+    mBufferSize = 0;
 
     while (true)
     {
-        auto result = fuse_chan_recv(&mChannel, &buffer[0], buffer.size());
+#ifdef HAVE_FUSE3
+        auto result = fuse_session_receive_buf(mSession, &mBuffer);
+#else // HAVE_FUSE3
+        assert(mChannel);
+
+        auto result = fuse_chan_recv(&mChannel, mBuffer.data(), mBuffer.size());
+#endif // ! HAVE_FUSE3
 
         if (!result)
-            return std::string();
+            return;
 
         if (result > 0)
         {
-            buffer.resize(static_cast<std::size_t>(result));
+            mBufferSize = static_cast<std::size_t>(result);
 
-            return buffer;
+            return;
         }
 
         if (result == -EINTR)
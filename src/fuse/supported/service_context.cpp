@@ -4,6 +4,7 @@
 #include <mega/fuse/common/client.h>
 #include <mega/fuse/common/database_builder.h>
 #include <mega/fuse/common/error_or.h>
+#include <mega/fuse/common/file_cache_statistics.h>
 #include <mega/fuse/common/inode_info.h>
 #include <mega/fuse/common/inode.h>
 #include <mega/fuse/common/mount_info.h>
@@ -36,7 +37,7 @@ ServiceContext::ServiceContext(const ServiceFlags& flags, Service& service)
   , mExecutor(flags.mServiceExecutorFlags)
   , mFileExtensionDB()
   , mInodeDB(*this)
-  , mFileCache(*this)
+  , mFileCache(flags.mFileCacheFlags, *this)
   , mInodeCache(flags.mInodeCacheFlags)
   , mUnmounter(*this)
   , mMountDB(*this)
@@ -165,6 +166,11 @@ Task ServiceContext::execute(std::function<void(const Task&)> function)
     return mExecutor.execute(std::move(function), true);
 }
 
+FileCacheStatistics ServiceContext::fileCacheStatistics() const
+{
+    return mFileCache.statistics();
+}
+
 MountResult ServiceContext::flags(const LocalPath& path,
                                   const MountFlags& flags)
 {
@@ -203,6 +209,9 @@ MountResult ServiceContext::remove(const LocalPath& path)
 
 void ServiceContext::serviceFlags(const ServiceFlags& flags)
 {
+    // Update the file cache's flags.
+    mFileCache.flags(flags.mFileCacheFlags);
+
     // Update the inode cache's flags.
     mInodeCache.flags(flags.mInodeCacheFlags);
 
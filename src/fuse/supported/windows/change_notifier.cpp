@@ -0,0 +1,197 @@
+#include <cassert>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+#include <mega/fuse/common/directory_inode.h>
+#include <mega/fuse/common/error_or.h>
+#include <mega/fuse/common/inode.h>
+#include <mega/fuse/common/logging.h>
+#include <mega/fuse/common/mount_inode_id.h>
+#include <mega/fuse/common/ref.h>
+#include <mega/fuse/platform/change_notifier.h>
+#include <mega/fuse/platform/constants.h>
+#include <mega/fuse/platform/dispatcher.h>
+#include <mega/fuse/platform/mount.h>
+#include <mega/fuse/platform/utility.h>
+
+namespace mega
+{
+namespace fuse
+{
+namespace platform
+{
+
+// Compute the path of an inode relative to the mount's root.
+static ErrorOr<std::wstring> pathOf(Mount& mount, InodeID id)
+{
+    // The mount's root is always at the same place.
+    if (id == InodeID(mount.handle()))
+        return std::wstring(L"\\");
+
+    // Get our hands on the inode.
+    auto inode = mount.get(MountInodeID(id), true);
+
+    // The inode isn't in memory so WinFSP can't have cached anything about it.
+    if (!inode)
+        return API_ENOENT;
+
+    // Compute the inode's path relative to the mount.
+    auto path = inode->path(mount.handle());
+
+    // The inode no longer lives below the mount.
+    if (!path)
+        return path.error();
+
+    return L"\\" + toWideString(path->toPath(false));
+}
+
+auto ChangeNotifier::change(InodeID id) -> Change&
+{
+    // Let the worker know there's a change to deliver.
+    mCV.notify_one();
+
+    // Changes to the same inode are coalesced.
+    return mChanges[id];
+}
+
+void ChangeNotifier::loop()
+{
+    FUSEDebug1("Change Notifier Worker thread started");
+
+    std::unique_lock<std::mutex> lock(mLock);
+
+    auto hasWork = [&]() {
+        return mTerminate || !mChanges.empty();
+    }; // hasWork
+
+    while (true)
+    {
+        // Wait until we have some work to do.
+        mCV.wait(lock, hasWork);
+
+        // We're being terminated.
+        if (mTerminate)
+            break;
+
+        // Give related changes (a move, say) a chance to be queued.
+        mCV.wait_for(lock, ChangeNotifierDelay, [&]() { return !!mTerminate; });
+
+        // Latch the changes to deliver.
+        auto changes = std::move(mChanges);
+
+        mChanges.clear();
+
+        // Release the lock so further changes can be queued.
+        lock.unlock();
+
+        // Translate the changes into something WinFSP understands.
+        std::vector<FileChange> fileChanges;
+
+        for (auto& [id, change] : changes)
+        {
+            auto path = pathOf(mMount, id);
+
+            // The inode's not visible through this mount.
+            if (!path)
+                continue;
+
+            if (change.mModified)
+                fileChanges.push_back({*path,
+                                       FILE_NOTIFY_CHANGE_ATTRIBUTES
+                                       | FILE_NOTIFY_CHANGE_LAST_WRITE
+                                       | FILE_NOTIFY_CHANGE_SIZE,
+                                       FILE_ACTION_MODIFIED});
+
+            if (change.mEntries.empty())
+                continue;
+
+            // Figure out which entries have been added or removed.
+            auto inode = mMount.get(MountInodeID(id), id != InodeID(mMount.handle()));
+            auto directory = inode ? inode->directory() : DirectoryInodeRef();
+
+            // Entries are always below a directory.
+            if (!directory)
+                continue;
+
+            auto prefix = *path;
+
+            if (prefix.back() != L'\\')
+                prefix.push_back(L'\\');
+
+            for (auto& name : change.mEntries)
+            {
+                auto action = directory->hasChild(name) ? FILE_ACTION_ADDED
+                                                        : FILE_ACTION_REMOVED;
+
+                fileChanges.push_back({prefix + toWideString(name),
+                                       FILE_NOTIFY_CHANGE_DIR_NAME
+                                       | FILE_NOTIFY_CHANGE_FILE_NAME,
+                                       static_cast<UINT32>(action)});
+            }
+        }
+
+        // Deliver the changes, waiting for any operations in progress.
+        while (!fileChanges.empty()
+               && !mTerminate
+               && !mDispatcher.notify(fileChanges))
+            std::this_thread::sleep_for(ChangeNotifierDelay);
+
+        // Reacquire lock.
+        lock.lock();
+    }
+
+    FUSEDebug1("Change Notifier Worker thread stopped");
+}
+
+ChangeNotifier::ChangeNotifier(Dispatcher& dispatcher, Mount& mount)
+  : mCV()
+  , mChanges()
+  , mDispatcher(dispatcher)
+  , mLock()
+  , mMount(mount)
+  , mTerminate{false}
+  , mWorker(&ChangeNotifier::loop, this)
+{
+    FUSEDebug1("Change Notifier constructed");
+}
+
+ChangeNotifier::~ChangeNotifier()
+{
+    // Let the worker know it has to terminate.
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+
+        mTerminate = true;
+    }
+
+    // Wake up the worker if it's sleeping.
+    mCV.notify_one();
+
+    // Wait for the worker to terminate.
+    mWorker.join();
+
+    FUSEDebug1("Change Notifier destroyed");
+}
+
+void ChangeNotifier::modified(InodeID id)
+{
+    std::lock_guard<std::mutex> guard(mLock);
+
+    change(id).mModified = true;
+}
+
+void ChangeNotifier::entry(InodeID parent, const std::string& name)
+{
+    // Sanity.
+    assert(!name.empty());
+
+    std::lock_guard<std::mutex> guard(mLock);
+
+    change(parent).mEntries.emplace(name);
+}
+
+} // platform
+} // fuse
+} // mega
+
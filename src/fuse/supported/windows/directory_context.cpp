@@ -1,5 +1,6 @@
 #include <mega/fuse/common/directory_inode.h>
 #include <mega/fuse/common/inode_info.h>
+#include <mega/fuse/common/mount.h>
 #include <mega/fuse/platform/directory_context.h>
 #include <mega/fuse/platform/utility.h>
 
@@ -67,6 +68,9 @@ DirectoryContext::DirectoryContext(DirectoryInodeRef directory,
 {
     FUSEDebugF("Directory Context %s created",
                toString(mDirectory->id()).c_str());
+
+    // Let the mount know the directory's been accessed.
+    mount.accessed(mDirectory->id());
 }
 
 DirectoryContext::~DirectoryContext()
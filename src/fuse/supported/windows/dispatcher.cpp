@@ -613,7 +613,13 @@ Dispatcher::Dispatcher(Mount& mount)
     parameters.PersistentAcls = true;
     parameters.ReadOnlyVolume = !mount.writable();
     parameters.SectorSize = 512;
-    parameters.FileInfoTimeout = 128;
+    parameters.FileInfoTimeout = FileInfoTimeout;
+    parameters.DirInfoTimeoutValid = true;
+    parameters.DirInfoTimeout = FileInfoTimeout;
+    parameters.SecurityTimeoutValid = true;
+    parameters.SecurityTimeout = FileInfoTimeout;
+    parameters.VolumeInfoTimeoutValid = true;
+    parameters.VolumeInfoTimeout = VolumeInfoTimeout;
     parameters.SectorsPerAllocationUnit = BlockSize / parameters.SectorSize;
     parameters.UmFileContextIsUserContext2 = true;
     parameters.UnicodeOnDisk = true;
@@ -693,10 +699,70 @@ FSP_FSCTL_TRANSACT_REQ& Dispatcher::request() const
     return *context->Request;
 }
 
+bool Dispatcher::notify(const std::vector<FileChange>& changes)
+{
+    // Operations in progress must complete before WinFSP can be notified.
+    auto result = FspFileSystemNotifyBegin(mFilesystem,
+                                           NotifyBeginTimeout);
+
+    // Some operations are still in progress.
+    if (result == STATUS_CANT_WAIT)
+        return false;
+
+    // Couldn't notify WinFSP.
+    if (!NT_SUCCESS(result))
+    {
+        FUSEWarningF("Couldn't notify changes: %s: %lx",
+                     mMount.path().toPath(false).c_str(),
+                     result);
+
+        return true;
+    }
+
+    // Large enough for any notification.
+    std::vector<UINT64> buffer;
+
+    for (auto& change : changes)
+    {
+        // How large is this notification?
+        auto length = change.mPath.size() * sizeof(wchar_t);
+        auto size = sizeof(FSP_FSCTL_NOTIFY_INFO) + length;
+
+        // Make sure the buffer can contain the notification.
+        buffer.resize(size / sizeof(UINT64) + 1);
+
+        auto* info = reinterpret_cast<FSP_FSCTL_NOTIFY_INFO*>(buffer.data());
+
+        // Populate the notification.
+        info->Size = static_cast<UINT16>(size);
+        info->Filter = change.mFilter;
+        info->Action = change.mAction;
+
+        std::memcpy(info->FileNameBuf, change.mPath.data(), length);
+
+        FUSEDebugF("Notifying change: %s: %lx",
+                   fromWideString(change.mPath).c_str(),
+                   change.mAction);
+
+        // Let WinFSP know about the change.
+        result = FspFileSystemNotify(mFilesystem, info, size);
+
+        if (!NT_SUCCESS(result))
+            FUSEWarningF("Couldn't notify change: %s: %lx",
+                         fromWideString(change.mPath).c_str(),
+                         result);
+    }
+
+    FspFileSystemNotifyEnd(mFilesystem);
+
+    return true;
+}
+
 void Dispatcher::start()
 {
     // Try and start the dispatcher.
-    auto result = FspFileSystemStartDispatcher(mFilesystem, 0);
+    auto result = FspFileSystemStartDispatcher(mFilesystem,
+                                               DispatcherThreadCount());
 
     // Couldn't start the dispatcher.
     if (!NT_SUCCESS(result))
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+#include <mega/fuse/common/inode_id.h>
+#include <mega/fuse/platform/dispatcher_forward.h>
+#include <mega/fuse/platform/mount_forward.h>
+
+namespace mega
+{
+namespace fuse
+{
+namespace platform
+{
+
+// Lets WinFSP know when the inodes of a mount have changed in the cloud
+// so that it can drop what it has cached about them.
+//
+// WinFSP can't be notified from within a filesystem operation so changes
+// are queued and delivered by a worker thread. Several changes to the
+// same inode are delivered as one.
+class ChangeNotifier
+{
+    // Describes the changes to be delivered for an inode.
+    struct Change
+    {
+        // Which of the inode's entries have changed?
+        std::set<std::string> mEntries;
+
+        // Have the inode's attributes or data changed?
+        bool mModified = false;
+    }; // Change
+
+    // Get the change associated with an inode.
+    Change& change(InodeID id);
+
+    // Delivers changes to WinFSP.
+    void loop();
+
+    // Signalled when there are changes to deliver.
+    std::condition_variable mCV;
+
+    // What inodes have changed?
+    std::map<InodeID, Change> mChanges;
+
+    // Who should we deliver changes to?
+    Dispatcher& mDispatcher;
+
+    // Serializes access to instance members.
+    std::mutex mLock;
+
+    // What mount are we delivering changes for?
+    Mount& mMount;
+
+    // Signals the worker that it's time to terminate.
+    std::atomic<bool> mTerminate;
+
+    // The thread on which changes are delivered.
+    std::thread mWorker;
+
+public:
+    ChangeNotifier(Dispatcher& dispatcher, Mount& mount);
+
+    ~ChangeNotifier();
+
+    // An inode's attributes or data have changed.
+    void modified(InodeID id);
+
+    // An entry has been added to or removed from a directory.
+    void entry(InodeID parent, const std::string& name);
+}; // ChangeNotifier
+
+} // platform
+} // fuse
+} // mega
+
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
 #include <string>
+#include <thread>
 
 #include <mega/fuse/common/constants.h>
 #include <mega/fuse/platform/library.h>
@@ -20,6 +23,31 @@ constexpr auto MaxVolumePrefixLength =
 
 extern const std::wstring UNCPrefix;
 
+// How long WinFSP may cache file information, directory listings and
+// security descriptors, in milliseconds.
+//
+// These are long as the mount notifies WinFSP whenever a node changes
+// in the cloud (see ChangeNotifier.)
+constexpr UINT32 FileInfoTimeout = 86400u * 1000u;
+
+// How long WinFSP may cache the volume's size and free space.
+constexpr UINT32 VolumeInfoTimeout = 10u * 1000u;
+
+// How long to wait for operations in progress before notifying WinFSP.
+constexpr ULONG NotifyBeginTimeout = 100u;
+
+// How long to wait for related changes before notifying WinFSP.
+constexpr auto ChangeNotifierDelay = std::chrono::milliseconds(50);
+
+// How many threads should be dispatching requests from WinFSP.
+//
+// Explorer issues many concurrent enumerations and reads, some of which
+// may block waiting on the cloud, so we want a few more than one per core.
+inline ULONG DispatcherThreadCount()
+{
+    return std::max(8u, std::thread::hardware_concurrency());
+}
+
 } // platform
 } // fuse
 } // mega
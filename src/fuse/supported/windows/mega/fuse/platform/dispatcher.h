@@ -1,6 +1,8 @@
 #pragma once
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include <mega/fuse/platform/dispatcher_forward.h>
 #include <mega/fuse/platform/library.h>
@@ -13,6 +15,19 @@ namespace fuse
 namespace platform
 {
 
+// Describes a change WinFSP should be notified about.
+struct FileChange
+{
+    // What file has changed, relative to the mount's root?
+    std::wstring mPath;
+
+    // What kind of change? (FILE_NOTIFY_CHANGE_*)
+    UINT32 mFilter;
+
+    // What happened to the file? (FILE_ACTION_*)
+    UINT32 mAction;
+}; // FileChange
+
 // Responsible for receiving and dispatching filesystem requests.
 class Dispatcher
 {
@@ -152,6 +167,12 @@ public:
 
     FSP_FSCTL_TRANSACT_REQ& request() const;
 
+    // Let WinFSP know that some files have changed so that it can drop
+    // what it has cached about them.
+    //
+    // Returns false if WinFSP couldn't be notified yet.
+    bool notify(const std::vector<FileChange>& changes);
+
     void start();
 
     void stop();
@@ -8,6 +8,7 @@
 #include <mega/fuse/common/mount.h>
 #include <mega/fuse/common/mount_result_forward.h>
 #include <mega/fuse/common/task_executor.h>
+#include <mega/fuse/platform/change_notifier.h>
 #include <mega/fuse/platform/context_forward.h>
 #include <mega/fuse/platform/dispatcher.h>
 #include <mega/fuse/platform/library.h>
@@ -22,6 +23,9 @@ namespace platform
 class Mount
   : public fuse::Mount
 {
+    // So the notifier can compute the path of our inodes.
+    friend class ChangeNotifier;
+
     // So the dispatcher can invoke our callbacks.
     friend class Dispatcher;
 
@@ -127,6 +131,9 @@ class Mount
     // Responsible for receiving requests from WinFSP.
     Dispatcher mDispatcher;
 
+    // Lets WinFSP know when our inodes have changed.
+    ChangeNotifier mNotifier;
+
     // Responsible for performing select requests.
     TaskExecutor mExecutor;
 
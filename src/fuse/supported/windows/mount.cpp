@@ -528,7 +528,8 @@ NTSTATUS Mount::read(PVOID context,
     mExecutor.execute(std::bind(std::move(read),
                                 mActivities.begin(),
                                 std::placeholders::_1),
-                      true);
+                      true,
+                      TASK_PRIORITY_DATA);
 
     // Let the caller know their read is underway.
     return STATUS_PENDING;
@@ -575,7 +576,8 @@ NTSTATUS Mount::readDirectory(PVOID context,
     mExecutor.execute(std::bind(std::move(read),
                                 mActivities.begin(),
                                 std::placeholders::_1),
-                      true);
+                      true,
+                      TASK_PRIORITY_DATA);
 
     // Let the caller know their request is in progress.
     return STATUS_PENDING;
@@ -826,7 +828,8 @@ NTSTATUS Mount::write(PVOID context,
     mExecutor.execute(std::bind(std::move(write),
                                 mActivities.begin(),
                                 std::placeholders::_1),
-                      true);
+                      true,
+                      TASK_PRIORITY_DATA);
 
     // Let the caller know the write is underway.
     return STATUS_PENDING;
@@ -837,6 +840,7 @@ Mount::Mount(const MountInfo& info,
   : fuse::Mount(info, mountDB)
   , mActivities()
   , mDispatcher(*this)
+  , mNotifier(mDispatcher, *this)
   , mExecutor(mountDB.executorFlags())
 {
     mDispatcher.start();
@@ -859,27 +863,33 @@ Mount::~Mount()
 
 void Mount::invalidateAttributes(InodeID id)
 {
+    mNotifier.modified(id);
 }
 
 void Mount::invalidateData(InodeID id,
-                           m_off_t offset,
-                           m_off_t size)
+                           m_off_t,
+                           m_off_t)
 {
+    // WinFSP drops the whole file's cached data.
+    mNotifier.modified(id);
 }
 
 void Mount::invalidateData(InodeID id)
 {
+    mNotifier.modified(id);
 }
 
 void Mount::invalidateEntry(const std::string& name,
-                            InodeID child,
+                            InodeID,
                             InodeID parent)
 {
+    mNotifier.entry(parent, name);
 }
 
 void Mount::invalidateEntry(const std::string& name,
                             InodeID parent)
 {
+    mNotifier.entry(parent, name);
 }
 
 InodeID Mount::map(MountInodeID id) const
@@ -52,6 +52,9 @@ public:
     // Execute a function on some task.
     Task execute(std::function<void(const Task&)> function) override;
 
+    // Describe the state of the file cache.
+    FileCacheStatistics fileCacheStatistics() const override;
+
     // Update a mount's flags.
     MountResult flags(const LocalPath& path,
                       const MountFlags& flags) override;
@@ -1,5 +1,6 @@
 #include <mega/fuse/common/client.h>
 #include <mega/fuse/common/error_or.h>
+#include <mega/fuse/common/file_cache_statistics.h>
 #include <mega/fuse/common/inode_info.h>
 #include <mega/fuse/common/mount_event_type.h>
 #include <mega/fuse/common/mount_event.h>
@@ -89,6 +90,11 @@ Task ServiceContext::execute(std::function<void(const Task&)> function)
     return task;
 }
 
+FileCacheStatistics ServiceContext::fileCacheStatistics() const
+{
+    return FileCacheStatistics();
+}
+
 MountResult ServiceContext::flags(const LocalPath&, const MountFlags&)
 {
     return MOUNT_UNKNOWN;
@@ -23,7 +23,10 @@
 #include "mega/gfx.h"
 #include "mega/logging.h"
 #include "mega/gfx/GfxProcCG.h"
+#include <iomanip>
 #include <numeric>
+#include <sstream>
+#include <thread>
 #include <tuple>
 
 namespace mega {
@@ -115,10 +118,18 @@ bool GfxProc::isvideo(const LocalPath& localfilename)
     return false;
 }
 
+void IGfxProvider::generateImagesBatch(const std::vector<FileDimensions>& files, const ImagesCallback& onImages)
+{
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        onImages(i, generateImages(files[i].first, files[i].second));
+    }
+}
+
 void *GfxProc::threadEntryPoint(void *param)
 {
-    GfxProc* gfxProcessor = (GfxProc*)param;
-    gfxProcessor->loop();
+    Worker* worker = (Worker*)param;
+    worker->gfxProc->loop(worker->provider.get());
     return NULL;
 }
 
@@ -134,47 +145,76 @@ std::vector<GfxDimension> GfxProc::getJobDimensions(GfxJob *job)
     return jobDimensions;
 }
 
-void GfxProc::loop()
+void GfxProc::loop(IGfxProvider* provider)
 {
     GfxJob *job = NULL;
-    while (!finished)
+    while ((job = requests.waitpop()))
     {
-        waiter.init(NEVER);
-        waiter.wait();
-        while ((job = requests.pop()))
+        // providers with a per call overhead take the queued jobs at once
+        std::vector<GfxJob*> batch{ job };
+        size_t maxBatchSize = (provider ? provider : mGfxProvider.get())->maxBatchSize();
+        while (batch.size() < maxBatchSize && (job = requests.pop()))
         {
-            if (finished)
+            batch.push_back(job);
+        }
+
+        // the ones already generated for the same file before don't need to be processed
+        auto cached = std::remove_if(batch.begin(), batch.end(), [this](GfxJob* j)
+        {
+            if (!getCachedImages(j))
             {
-                delete job;
-                break;
+                return false;
             }
 
-            LOG_debug << "Processing media file: " << job->h;
+            LOG_debug << "Media file images taken from the cache: " << j->h;
+            responses.push(j);
+            return true;
+        });
 
-            auto images = generateImages(job->localfilename, getJobDimensions(job));
-            for (auto& image : images)
+        if (cached != batch.end())
+        {
+            batch.erase(cached, batch.end());
+            client->waiter->notify();
+            if (batch.empty())
             {
-                string* jpeg = image.empty() ? nullptr : new string(std::move(image));
-                job->images.push_back(jpeg);
+                continue;
             }
+        }
 
-            responses.push(job);
-            client->waiter->notify();
+        std::vector<IGfxProvider::FileDimensions> files;
+        for (GfxJob* j : batch)
+        {
+            LOG_debug << "Processing media file: " << j->h;
+            files.emplace_back(j->localfilename, getJobDimensions(j));
         }
-    }
 
-    while ((job = requests.pop()))
-    {
-        delete job;
-    }
+        auto onImages = [this, &batch](size_t i, std::vector<std::string>&& images)
+        {
+            GfxJob* done = batch[i];
+            for (size_t n = 0; n < images.size(); n++)
+            {
+                if (mCache && done->fingerprint.isvalid && !images[n].empty())
+                {
+                    mCache->put(done->fingerprint, done->imagetypes[n], images[n]);
+                }
 
-    while ((job = responses.pop()))
-    {
-        for (unsigned i = 0; i < job->imagetypes.size(); i++)
+                string* jpeg = images[n].empty() ? nullptr : new string(std::move(images[n]));
+                done->images.push_back(jpeg);
+            }
+
+            responses.push(done);
+            client->waiter->notify();
+        };
+
+        if (provider)
         {
-            delete job->images[i];
+            provider->generateImagesBatch(files, onImages);
+        }
+        else
+        {
+            std::lock_guard<std::mutex> g(mutex);
+            mGfxProvider->generateImagesBatch(files, onImages);
         }
-        delete job;
     }
 }
 
@@ -238,6 +278,18 @@ int GfxProc::checkevents(Waiter *)
     return needexec ? Waiter::NEEDEXEC : 0;
 }
 
+bool IGfxLocalProvider::upscales(int w, int h, const GfxDimension& dimension)
+{
+    if (!w || !h)
+    {
+        return false;
+    }
+
+    int sw = w, sh = h, rw = dimension.w(), rh = dimension.h(), px, py;
+    transform(sw, sh, rw, rh, px, py);
+    return sw > w || sh > h;
+}
+
 std::vector<std::string> IGfxLocalProvider::generateImages(const LocalPath& localfilepath,
                                                            const std::vector<GfxDimension>& dimensions)
 {
@@ -249,30 +301,53 @@ std::vector<std::string> IGfxLocalProvider::generateImages(const LocalPath& loca
         0,
         [](int max, const GfxDimension& d) { return std::max(max, std::max(d.w(), d.h())); });
 
-    if (readbitmap(localfilepath, maxDimension))
+    // The bitmap is decoded once, at the smallest scale that fits the largest image, and resizebitmap()
+    // may replace it with its result: the largest images go first, each one resized from the previous one
+    std::vector<size_t> order(dimensions.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&dimensions](size_t a, size_t b)
+    {
+        return std::max(dimensions[a].w(), dimensions[a].h()) > std::max(dimensions[b].w(), dimensions[b].h());
+    });
+
+    if (!readbitmap(localfilepath, maxDimension))
+    {
+        LOG_err << "Error reading bitmap for " << localfilepath;
+        return images;
+    }
+
+    int decodedWidth = width(), decodedHeight = height();
+    for (size_t n = 0; n < order.size(); ++n)
     {
-        for (unsigned int i = 0; i < dimensions.size(); ++i)
+        size_t i = order[n];
+
+        // unless the previous image is too small for this one (e.g. the thumbnail of a panorama)
+        if (n && upscales(width(), height(), dimensions[i]) && !upscales(decodedWidth, decodedHeight, dimensions[i]))
         {
-            string jpeg;
-            int targetWidth = dimensions[i].w(), targetHeight = dimensions[i].h();
-            if (width() < targetWidth && height() < targetHeight)
-            {
-                LOG_debug << "Skipping upsizing of local preview";
-                targetWidth = width();
-                targetHeight = height();
-            }
-            // LOG_verbose << "resizebitmap w/h: " << targetWidth << "/" << targetHeight;
-            if (resizebitmap(targetWidth, targetHeight, &jpeg))
+            LOG_debug << "Decoding the bitmap again for " << dimensions[i].w() << "x" << dimensions[i].h();
+            freebitmap();
+            if (!readbitmap(localfilepath, maxDimension))
             {
-                images[i] = std::move(jpeg);
+                LOG_err << "Error reading bitmap for " << localfilepath;
+                return images;
             }
         }
-        freebitmap();
-    }
-    else
-    {
-        LOG_err << "Error reading bitmap for " << localfilepath;
+
+        string jpeg;
+        int targetWidth = dimensions[i].w(), targetHeight = dimensions[i].h();
+        if (width() < targetWidth && height() < targetHeight)
+        {
+            LOG_debug << "Skipping upsizing of local preview";
+            targetWidth = width();
+            targetHeight = height();
+        }
+        // LOG_verbose << "resizebitmap w/h: " << targetWidth << "/" << targetHeight;
+        if (resizebitmap(targetWidth, targetHeight, &jpeg))
+        {
+            images[i] = std::move(jpeg);
+        }
     }
+    freebitmap();
 
     return images;
 }
@@ -321,7 +396,7 @@ void IGfxLocalProvider::transform(int& w, int& h, int& rw, int& rh, int& px, int
 }
 
 // load bitmap image, generate all designated sizes, attach to specified upload/node handle
-int GfxProc::gendimensionsputfa(const LocalPath& localfilename, NodeOrUploadHandle th, SymmCipher* key, int missing)
+int GfxProc::gendimensionsputfa(const LocalPath& localfilename, NodeOrUploadHandle th, SymmCipher* key, int missing, const FileFingerprint& fingerprint)
 {
     LOG_debug << "Creating thumb/preview for " << localfilename;
 
@@ -329,6 +404,7 @@ int GfxProc::gendimensionsputfa(const LocalPath& localfilename, NodeOrUploadHand
     job->h = th;
     memcpy(job->key, key->key, SymmCipher::KEYLENGTH);
     job->localfilename = localfilename;
+    job->fingerprint = fingerprint;
 
     int generatingAttrs = 0;
     for (fatype i = static_cast<fatype>(DIMENSIONS.size()); i--; )
@@ -347,10 +423,38 @@ int GfxProc::gendimensionsputfa(const LocalPath& localfilename, NodeOrUploadHand
     }
 
     requests.push(job);
-    waiter.notify();
     return generatingAttrs;
 }
 
+bool GfxProc::getCachedImages(GfxJob* job)
+{
+    if (!mCache || !job->fingerprint.isvalid)
+    {
+        return false;
+    }
+
+    std::vector<string> images(job->imagetypes.size());
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        if (!mCache->get(job->fingerprint, job->imagetypes[i], images[i]))
+        {
+            return false;
+        }
+    }
+
+    for (auto& image : images)
+    {
+        job->images.push_back(new string(std::move(image)));
+    }
+    return true;
+}
+
+void GfxProc::setCache(std::unique_ptr<GfxCache> cache)
+{
+    assert(mWorkers.empty());
+    mCache = std::move(cache);
+}
+
 std::vector<std::string> GfxProc::generateImages(const LocalPath& localfilepath, const std::vector<GfxDimension>& dimensions)
 {
     std::lock_guard<std::mutex> g(mutex);
@@ -398,23 +502,238 @@ GfxProc::GfxProc(std::unique_ptr<IGfxProvider> middleware)
 {
 }
 
-void GfxProc::startProcessingThread()
+unsigned GfxProc::defaultNumThreads()
+{
+    return std::max(1u, std::min(4u, std::thread::hardware_concurrency() / 2));
+}
+
+void GfxProc::startProcessingThread(unsigned numThreads)
 {
-    thread.start(threadEntryPoint, this);
-    threadstarted = true;
+    assert(mWorkers.empty());
+    if (!numThreads)
+    {
+        numThreads = defaultNumThreads();
+    }
+
+    // the first thread uses the provider shared with the synchronous operations,
+    // the others their own ones, if the provider supports it
+    for (unsigned i = 0; i < numThreads; i++)
+    {
+        auto worker = std::make_unique<Worker>();
+        worker->gfxProc = this;
+        if (i && !(worker->provider = mGfxProvider->clone()))
+        {
+            break;
+        }
+
+        worker->thread.start(threadEntryPoint, worker.get());
+        mWorkers.push_back(std::move(worker));
+    }
+
+    LOG_debug << "Started " << mWorkers.size() << " media processing threads";
 }
 
 GfxProc::~GfxProc()
 {
-    finished = true;
-    waiter.notify();
-    assert(threadstarted);
-    if (threadstarted)
+    requests.stop();
+    assert(!mWorkers.empty());
+    for (auto& worker : mWorkers)
+    {
+        worker->thread.join();
+    }
+
+    GfxJob *job = NULL;
+    while ((job = requests.pop()))
+    {
+        delete job;
+    }
+
+    while ((job = responses.pop()))
+    {
+        for (unsigned i = 0; i < job->images.size(); i++)
+        {
+            delete job->images[i];
+        }
+        delete job;
+    }
+}
+
+GfxCache::GfxCache(const LocalPath& folder, m_off_t maxSize)
+    : mFsAccess(std::make_unique<FSACCESS_CLASS>())
+    , mFolder(folder)
+    , mMaxSize(maxSize)
+{
+}
+
+string GfxCache::entryName(const FileFingerprint& fingerprint, fatype type)
+{
+    std::ostringstream name;
+    name << std::hex << std::setfill('0')
+         << std::setw(16) << static_cast<uint64_t>(fingerprint.size)
+         << std::setw(16) << static_cast<uint64_t>(fingerprint.mtime);
+    for (int32_t crc : fingerprint.crc)
+    {
+        name << std::setw(8) << static_cast<uint32_t>(crc);
+    }
+    name << "." << std::dec << type;
+    return name.str();
+}
+
+LocalPath GfxCache::entryPath(const string& name) const
+{
+    LocalPath path = mFolder;
+    path.appendWithSeparator(LocalPath::fromRelativePath(name), false);
+    return path;
+}
+
+void GfxCache::load()
+{
+    if (mLoaded)
+    {
+        return;
+    }
+    mLoaded = true;
+
+    mFsAccess->mkdirlocal(mFolder, false, false);
+
+    LocalPath folder = mFolder;
+    unique_ptr<DirAccess> da(mFsAccess->newdiraccess());
+    if (!da->dopen(&folder, nullptr, false))
+    {
+        LOG_warn << "Unable to open the gfx cache folder: " << mFolder;
+        return;
+    }
+
+    LocalPath leafName;
+    nodetype_t type;
+    std::vector<LocalPath> leftovers;
+    while (da->dnext(folder, leafName, false, &type))
+    {
+        if (type != FILENODE)
+        {
+            continue;
+        }
+
+        LocalPath path = mFolder;
+        path.appendWithSeparator(leafName, false);
+
+        // files being written when the app was closed
+        string name = leafName.toPath(false);
+        if (name.size() > 4 && !name.compare(name.size() - 4, 4, ".tmp"))
+        {
+            leftovers.push_back(path);
+            continue;
+        }
+
+        auto fa = mFsAccess->newfileaccess();
+        if (fa->fopen(path, FSLogging::logOnError))
+        {
+            mEntries[name] = Entry{ fa->size, fa->mtime };
+            mSize += fa->size;
+        }
+    }
+
+    for (auto& path : leftovers)
+    {
+        mFsAccess->unlinklocal(path);
+    }
+
+    LOG_debug << "Gfx cache loaded: " << mEntries.size() << " images, " << mSize << " bytes";
+    evict();
+}
+
+void GfxCache::evict()
+{
+    while (mSize > mMaxSize && !mEntries.empty())
     {
-        thread.join();
+        auto oldest = std::min_element(mEntries.begin(), mEntries.end(), [](const std::pair<const string, Entry>& a, const std::pair<const string, Entry>& b)
+        {
+            return a.second.lastUse < b.second.lastUse;
+        });
+
+        mFsAccess->unlinklocal(entryPath(oldest->first));
+        mSize -= oldest->second.size;
+        mEntries.erase(oldest);
     }
 }
 
+bool GfxCache::get(const FileFingerprint& fingerprint, fatype type, string& image)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    load();
+
+    string name = entryName(fingerprint, type);
+    auto it = mEntries.find(name);
+    if (it == mEntries.end())
+    {
+        return false;
+    }
+
+    LocalPath path = entryPath(name);
+    auto fa = mFsAccess->newfileaccess();
+    if (!fa->fopen(path, true, false, FSLogging::logOnError)
+        || !fa->fread(&image, static_cast<unsigned>(fa->size), 0, 0, FSLogging::logOnError)
+        || image.empty())
+    {
+        LOG_warn << "Unable to read the gfx cache entry " << name;
+        fa.reset();
+        mFsAccess->unlinklocal(path);
+        mSize -= it->second.size;
+        mEntries.erase(it);
+        return false;
+    }
+    fa.reset();
+
+    // the modification time keeps the order of use for the next sessions
+    it->second.lastUse = m_time();
+    mFsAccess->setmtimelocal(path, it->second.lastUse);
+    return true;
+}
+
+void GfxCache::put(const FileFingerprint& fingerprint, fatype type, const string& image)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    load();
+
+    if (static_cast<m_off_t>(image.size()) > mMaxSize)
+    {
+        return;
+    }
+
+    string name = entryName(fingerprint, type);
+    LocalPath path = entryPath(name);
+    LocalPath tmpPath = entryPath(name + ".tmp");
+
+    // written to a temporary file first, so that there are no partial images after a crash
+    auto fa = mFsAccess->newfileaccess();
+    bool written = fa->fopen(tmpPath, false, true, FSLogging::logOnError)
+                   && fa->fwrite(reinterpret_cast<const byte*>(image.data()), static_cast<unsigned>(image.size()), 0);
+    fa.reset();
+    if (!written || !mFsAccess->renamelocal(tmpPath, path, true))
+    {
+        LOG_warn << "Unable to write the gfx cache entry " << name;
+        mFsAccess->unlinklocal(tmpPath);
+        return;
+    }
+
+    auto it = mEntries.find(name);
+    if (it != mEntries.end())
+    {
+        mSize -= it->second.size;
+    }
+
+    mEntries[name] = Entry{ static_cast<m_off_t>(image.size()), m_time() };
+    mSize += static_cast<m_off_t>(image.size());
+    evict();
+}
+
+m_off_t GfxCache::size()
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    load();
+    return mSize;
+}
+
 GfxJobQueue::GfxJobQueue()
 {
 
@@ -423,8 +742,42 @@ GfxJobQueue::GfxJobQueue()
 void GfxJobQueue::push(GfxJob *job)
 {
     mutex.lock();
-    jobs.push_back(job);
+
+    // putnodes of the uploads waits for their attributes, not so for existing nodes
+    auto it = jobs.end();
+    if (!job->h.isNodeHandle())
+    {
+        while (it != jobs.begin() && (*(it - 1))->h.isNodeHandle())
+        {
+            it--;
+        }
+    }
+    jobs.insert(it, job);
+
+    mutex.unlock();
+    cv.notify_one();
+}
+
+GfxJob *GfxJobQueue::waitpop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this]() { return stopped || !jobs.empty(); });
+    if (stopped)
+    {
+        return NULL;
+    }
+
+    GfxJob *job = jobs.front();
+    jobs.pop_front();
+    return job;
+}
+
+void GfxJobQueue::stop()
+{
+    mutex.lock();
+    stopped = true;
     mutex.unlock();
+    cv.notify_all();
 }
 
 GfxJob *GfxJobQueue::pop()
@@ -49,6 +49,10 @@ GfxProviderCG::~GfxProviderCG() {
     }
 }
 
+std::unique_ptr<mega::IGfxProvider> GfxProviderCG::clone() const {
+    return std::make_unique<GfxProviderCG>();
+}
+
 const char* GfxProviderCG::supportedformats() {
     return ".bmp.cr2.crw.cur.dng.gif.heic.ico.j2c.jp2.jpf.jpeg.jpg.nef.orf.pbm.pdf.pgm.png.pnm.ppm.psd.raf.rw2.rwl.tga.tif.tiff.3g2.3gp.avi.m4v.mov.mp4.mqv.qt.webp.";
 }
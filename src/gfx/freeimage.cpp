@@ -38,6 +38,14 @@ typedef const char freeimage_filename_char_t;
 #define OLD_FREEIMAGE
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MEGA_GFX_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#define MEGA_GFX_NEON
+#include <arm_neon.h>
+#endif
+
 
 #ifdef HAVE_FFMPEG
 extern "C" {
@@ -48,11 +56,119 @@ extern "C" {
 #include <libavutil/mathematics.h>
 #include <libavutil/display.h>
 #include <libavutil/imgutils.h>
+#include <libavutil/hwcontext.h>
 }
+
+#if LIBAVCODEC_VERSION_MAJOR < 58
+#undef USE_FFMPEG_HWACCEL // no hardware configurations in the decoders
+#endif
 #endif
 
 namespace mega {
 
+namespace {
+
+// 255 * 256 still fits in the 16-bit row accumulators
+const unsigned MAX_SHRINK_FACTOR = 256;
+
+// add the bytes of a row to 16-bit accumulators
+void accumulateRow(uint16_t* acc, const BYTE* row, size_t len)
+{
+    size_t i = 0;
+#if defined(MEGA_GFX_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i + 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + i), _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + i + 8), _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero)));
+    }
+#elif defined(MEGA_GFX_NEON)
+    for (; i + 16 <= len; i += 16)
+    {
+        uint8x16_t v = vld1q_u8(row + i);
+        vst1q_u16(acc + i, vaddw_u8(vld1q_u16(acc + i), vget_low_u8(v)));
+        vst1q_u16(acc + i + 8, vaddw_u8(vld1q_u16(acc + i + 8), vget_high_u8(v)));
+    }
+#endif
+    for (; i < len; i++)
+    {
+        acc[i] = static_cast<uint16_t>(acc[i] + row[i]);
+    }
+}
+
+// shrink a 24/32-bit bitmap by an integer factor, averaging blocks of factor*factor pixels
+FIBITMAP* shrinkBitmap(FIBITMAP* src, unsigned factor)
+{
+    unsigned bpp = FreeImage_GetBPP(src);
+    unsigned bytesPerPixel = bpp / 8;
+    unsigned dw = FreeImage_GetWidth(src) / factor;
+    unsigned dh = FreeImage_GetHeight(src) / factor;
+
+    FIBITMAP* dst = FreeImage_Allocate(static_cast<int>(dw), static_cast<int>(dh), static_cast<int>(bpp),
+                                       FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK);
+    if (!dst)
+    {
+        return NULL;
+    }
+
+    size_t rowLen = size_t(dw) * factor * bytesPerPixel;
+    std::vector<uint16_t> acc(rowLen);
+    unsigned divisor = factor * factor;
+
+    for (unsigned y = 0; y < dh; y++)
+    {
+        std::fill(acc.begin(), acc.end(), uint16_t(0));
+        for (unsigned r = 0; r < factor; r++)
+        {
+            accumulateRow(acc.data(), FreeImage_GetScanLine(src, static_cast<int>(y * factor + r)), rowLen);
+        }
+
+        BYTE* out = FreeImage_GetScanLine(dst, static_cast<int>(y));
+        const uint16_t* block = acc.data();
+        for (unsigned x = 0; x < dw; x++, block += factor * bytesPerPixel)
+        {
+            for (unsigned c = 0; c < bytesPerPixel; c++)
+            {
+                uint32_t sum = 0;
+                for (unsigned k = 0; k < factor; k++)
+                {
+                    sum += block[k * bytesPerPixel + c];
+                }
+                *out++ = static_cast<BYTE>((sum + divisor / 2) / divisor);
+            }
+        }
+    }
+
+    FreeImage_CloneMetadata(dst, src);
+    return dst;
+}
+
+// Big downscales are mostly averaging: the bitmap is shrunk by an integer factor first,
+// so the bilinear filter (whose cost grows with the ratio) only does the last few times
+FIBITMAP* rescaleBitmap(FIBITMAP* dib, int w, int h)
+{
+    unsigned bpp = FreeImage_GetBPP(dib);
+    unsigned factor = std::min(FreeImage_GetWidth(dib) / static_cast<unsigned>(w),
+                               FreeImage_GetHeight(dib) / static_cast<unsigned>(h)) / 2;
+
+    if (factor >= 2 && FreeImage_GetImageType(dib) == FIT_BITMAP && (bpp == 24 || bpp == 32))
+    {
+        if (FIBITMAP* shrunk = shrinkBitmap(dib, std::min(factor, MAX_SHRINK_FACTOR)))
+        {
+            FIBITMAP* result = FreeImage_Rescale(shrunk, w, h, FILTER_BILINEAR);
+            FreeImage_Unload(shrunk);
+            return result;
+        }
+    }
+
+    return FreeImage_Rescale(dib, w, h, FILTER_BILINEAR);
+}
+
+} // namespace
+
 #if defined(HAVE_FFMPEG) || defined(HAVE_PDFIUM)
 std::mutex GfxProviderFreeImage::gfxMutex;
 #endif
@@ -71,10 +187,9 @@ GfxProviderFreeImage::GfxProviderFreeImage()
 #ifdef FREEIMAGE_LIB
     {
         std::unique_lock<std::mutex> guard(libFreeImageInitializedMutex);
-        if (!libFreeImageInitialized)
+        if (!libFreeImageInitialized++)
         {
             FreeImage_Initialise(TRUE);
-            libFreeImageInitialized++;
         }
     }
 #endif
@@ -93,10 +208,9 @@ GfxProviderFreeImage::~GfxProviderFreeImage()
 #ifdef FREEIMAGE_LIB
     {
         std::unique_lock<std::mutex> guard(libFreeImageInitializedMutex);
-        if (libFreeImageInitialized)
+        if (libFreeImageInitialized && !--libFreeImageInitialized)
         {
             FreeImage_DeInitialise();
-            libFreeImageInitialized--;
         }
     }
 #endif
@@ -111,6 +225,11 @@ GfxProviderFreeImage::~GfxProviderFreeImage()
 #endif
 }
 
+std::unique_ptr<IGfxProvider> GfxProviderFreeImage::clone() const
+{
+    return std::make_unique<GfxProviderFreeImage>();
+}
+
 #ifdef USE_MEDIAINFO
 bool GfxProviderFreeImage::readbitmapMediaInfo(const LocalPath& imagePath)
 {
@@ -239,8 +358,95 @@ private:
 template<class F, class P>
 ScopeGuard<F, P> makeScopeGuard(F f, P p){ return ScopeGuard<F, P>(f, p);	}
 
+#ifdef USE_FFMPEG_HWACCEL
+#if defined(_WIN32)
+static const AVHWDeviceType HWACCEL_DEVICE_TYPE = AV_HWDEVICE_TYPE_D3D11VA;
+#elif defined(__APPLE__)
+static const AVHWDeviceType HWACCEL_DEVICE_TYPE = AV_HWDEVICE_TYPE_VIDEOTOOLBOX;
+#else
+static const AVHWDeviceType HWACCEL_DEVICE_TYPE = AV_HWDEVICE_TYPE_VAAPI;
+#endif
+
+// the device is opened once and shared by all the decoders, null if not available
+static AVBufferRef* hwaccelDevice()
+{
+    static std::mutex deviceMutex;
+    static std::unique_ptr<AVBufferRef*, void(*)(AVBufferRef**)> device(nullptr, [](AVBufferRef** d) { av_buffer_unref(d); delete d; });
+    static bool opened = false;
+
+    std::lock_guard<std::mutex> g(deviceMutex);
+    if (!opened)
+    {
+        opened = true;
+        AVBufferRef* d = nullptr;
+        if (av_hwdevice_ctx_create(&d, HWACCEL_DEVICE_TYPE, NULL, NULL, 0) < 0)
+        {
+            LOG_info << "Hardware video decoding not available: " << av_hwdevice_get_type_name(HWACCEL_DEVICE_TYPE);
+            return nullptr;
+        }
+        device.reset(new AVBufferRef*(d));
+    }
+    return device ? *device : nullptr;
+}
+
+static AVPixelFormat getHwaccelFormat(AVCodecContext* codecContext, const AVPixelFormat* formats)
+{
+    AVPixelFormat hwPixelFormat = *static_cast<AVPixelFormat*>(codecContext->opaque);
+    for (const AVPixelFormat* f = formats; *f != AV_PIX_FMT_NONE; f++)
+    {
+        if (*f == hwPixelFormat)
+        {
+            return hwPixelFormat;
+        }
+    }
+
+    LOG_debug << "Hardware pixel format not offered, decoding in software";
+    return avcodec_default_get_format(codecContext, formats);
+}
+
+// the pixel format of the frames decoded by the device, if the decoder supports it
+static AVPixelFormat setupHwaccel(const AVCodec* decoder, AVCodecContext* codecContext)
+{
+    for (int i = 0; const AVCodecHWConfig* config = avcodec_get_hw_config(decoder, i); i++)
+    {
+        if ((config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX) && config->device_type == HWACCEL_DEVICE_TYPE)
+        {
+            AVBufferRef* device = hwaccelDevice();
+            if (!device)
+            {
+                return AV_PIX_FMT_NONE;
+            }
+
+            codecContext->hw_device_ctx = av_buffer_ref(device);
+            return config->pix_fmt;
+        }
+    }
+    return AV_PIX_FMT_NONE;
+}
+#endif
+
 bool GfxProviderFreeImage::readbitmapFfmpeg(const LocalPath& imagePath, int size)
 {
+    bool hwaccelUsed = false;
+    if (readbitmapFfmpeg(imagePath, size, true, hwaccelUsed))
+    {
+        return true;
+    }
+
+    if (!hwaccelUsed)
+    {
+        return false;
+    }
+
+    // software remains the fallback
+    LOG_debug << "Hardware video decoding failed, trying in software: " << imagePath;
+    return readbitmapFfmpeg(imagePath, size, false, hwaccelUsed);
+}
+
+bool GfxProviderFreeImage::readbitmapFfmpeg(const LocalPath& imagePath, int size, bool hwaccel, bool& hwaccelUsed)
+{
+    hwaccelUsed = false;
+
 #ifndef DEBUG
     av_log_set_level(AV_LOG_PANIC);
 #endif
@@ -311,6 +517,9 @@ bool GfxProviderFreeImage::readbitmapFfmpeg(const LocalPath& imagePath, int size
         return false;
     }
 
+    // declared before the context, which points to it
+    AVPixelFormat hwPixelFormat = AV_PIX_FMT_NONE;
+
     AVCodecContext *codecContext = avcodec_alloc_context3(decoder);
     auto codecContextGuard = makeScopeGuard(avcodec_free_context, &codecContext);
     if (!codecContext || avcodec_parameters_to_context(codecContext, codecParm) < 0)
@@ -326,17 +535,42 @@ bool GfxProviderFreeImage::readbitmapFfmpeg(const LocalPath& imagePath, int size
         codecContext->flags |= CAP_TRUNCATED;
     }
 
-    AVPixelFormat sourcePixelFormat = static_cast<AVPixelFormat>(codecParm->format);
-    AVPixelFormat targetPixelFormat = AV_PIX_FMT_BGR24; //raw data expected by freeimage is in this format
-    SwsContext* swsContext = sws_getContext(width, height, sourcePixelFormat,
-                                            width, height, targetPixelFormat,
-                                            SWS_FAST_BILINEAR, NULL, NULL, NULL);
-    auto swsContextGuard = makeScopeGuard(sws_freeContext, swsContext);
-    if (!swsContext)
+    // Only the intra frames are decoded: the frame is taken from the key frame found by the seeking
+    codecContext->skip_frame = AVDISCARD_NONINTRA;
+
+#ifdef USE_FFMPEG_HWACCEL
+    if (hwaccel && (hwPixelFormat = setupHwaccel(decoder, codecContext)) != AV_PIX_FMT_NONE)
     {
-        LOG_warn << "SWS Context not found: " << sourcePixelFormat;
-        return false;
+        hwaccelUsed = true;
+        codecContext->opaque = &hwPixelFormat;
+        codecContext->get_format = getHwaccelFormat;
     }
+#else
+    (void)hwaccel;
+#endif
+
+    // The frame is scaled directly to the size needed for the images (the smaller side fits the largest one)
+    int targetWidth = width;
+    int targetHeight = height;
+    if (size > 0 && std::min(width, height) > size)
+    {
+        if (width < height)
+        {
+            targetWidth = size;
+            targetHeight = static_cast<int>(static_cast<int64_t>(height) * size / width);
+        }
+        else
+        {
+            targetHeight = size;
+            targetWidth = static_cast<int>(static_cast<int64_t>(width) * size / height);
+        }
+    }
+
+    AVPixelFormat targetPixelFormat = AV_PIX_FMT_BGR24; //raw data expected by freeimage is in this format
+
+    // created for the format of the decoded frames, which may come from the hardware decoder
+    SwsContext* swsContext = nullptr;
+    auto swsContextGuard = makeScopeGuard([](SwsContext** c) { sws_freeContext(*c); }, &swsContext);
 
     // Open codec
     if (avcodec_open2(codecContext, decoder, NULL) < 0)
@@ -352,15 +586,19 @@ bool GfxProviderFreeImage::readbitmapFfmpeg(const LocalPath& imagePath, int size
     AVFrame* targetFrame = av_frame_alloc();
     auto targetFrameGuard = makeScopeGuard(av_frame_free, &targetFrame);
 
-    if (!videoFrame || !targetFrame)
+    // frames downloaded from the hardware decoder
+    AVFrame* downloadedFrame = av_frame_alloc();
+    auto downloadedFrameGuard = makeScopeGuard(av_frame_free, &downloadedFrame);
+
+    if (!videoFrame || !targetFrame || !downloadedFrame)
     {
         LOG_warn << "Error allocating video frames";
         return false;
     }
 
     targetFrame->format = targetPixelFormat;
-    targetFrame->width = width;
-    targetFrame->height = height;
+    targetFrame->width = targetWidth;
+    targetFrame->height = targetHeight;
     if (av_image_alloc(targetFrame->data, targetFrame->linesize, targetFrame->width, targetFrame->height, targetPixelFormat, 32) < 0)
     {
         LOG_warn << "Error allocating frame";
@@ -416,19 +654,34 @@ bool GfxProviderFreeImage::readbitmapFfmpeg(const LocalPath& imagePath, int size
 
            while (avcodec_receive_frame(codecContext, videoFrame) >= 0)
            {
-                if (sourcePixelFormat != codecContext->pix_fmt)
+                AVFrame* frame = videoFrame;
+                if (hwPixelFormat != AV_PIX_FMT_NONE && videoFrame->format == hwPixelFormat)
                 {
-                    LOG_warn << "Error: pixel format changed from " << sourcePixelFormat << " to " << codecContext->pix_fmt;
+                    if (av_hwframe_transfer_data(downloadedFrame, videoFrame, 0) < 0)
+                    {
+                        LOG_warn << "Error downloading the frame from the hardware decoder";
+                        return false;
+                    }
+                    frame = downloadedFrame;
+                }
+
+                AVPixelFormat sourcePixelFormat = static_cast<AVPixelFormat>(frame->format);
+                swsContext = sws_getCachedContext(swsContext, frame->width, frame->height, sourcePixelFormat,
+                                                  targetWidth, targetHeight, targetPixelFormat,
+                                                  targetWidth < frame->width ? SWS_AREA : SWS_FAST_BILINEAR, NULL, NULL, NULL);
+                if (!swsContext)
+                {
+                    LOG_warn << "SWS Context not found: " << sourcePixelFormat;
                     return false;
                 }
 
-                scalingResult = sws_scale(swsContext, videoFrame->data, videoFrame->linesize,
-                                          0, codecParm->height, targetFrame->data, targetFrame->linesize);
+                scalingResult = sws_scale(swsContext, frame->data, frame->linesize,
+                                          0, frame->height, targetFrame->data, targetFrame->linesize);
 
                 if (scalingResult > 0)
                 {
                     const int legacy_align = 1;
-                    int imagesize = av_image_get_buffer_size(targetPixelFormat, width, height, legacy_align);
+                    int imagesize = av_image_get_buffer_size(targetPixelFormat, targetWidth, targetHeight, legacy_align);
                     FIMEMORY fmemory;
                     fmemory.data = malloc(imagesize);
                     if (!fmemory.data)
@@ -440,16 +693,16 @@ bool GfxProviderFreeImage::readbitmapFfmpeg(const LocalPath& imagePath, int size
 
                     if (av_image_copy_to_buffer((uint8_t *)fmemory.data, imagesize,
                                 targetFrame->data, targetFrame->linesize,
-                                targetPixelFormat, width, height, legacy_align) <= 0)
+                                targetPixelFormat, targetWidth, targetHeight, legacy_align) <= 0)
                     {
                         LOG_warn << "Error copying frame";
                         return false;
                     }
 
                     //int pitch = imagesize/height;
-                    int pitch = width*3;
+                    int pitch = targetWidth*3;
 
-                    if (!(dib = FreeImage_ConvertFromRawBits((BYTE*)fmemory.data,width,height,
+                    if (!(dib = FreeImage_ConvertFromRawBits((BYTE*)fmemory.data,targetWidth,targetHeight,
                                                              pitch, 24, FI_RGBA_RED_SHIFT, FI_RGBA_GREEN_MASK,
                                                              FI_RGBA_BLUE_MASK | 0xFFFF, TRUE) ) )
                     {
@@ -496,6 +749,17 @@ bool GfxProviderFreeImage::isPdfFile(const string &ext)
     return false;
 }
 
+std::vector<std::string> GfxProviderFreeImage::generateImages(const LocalPath& localfilepath,
+                                                              const std::vector<GfxDimension>& dimensions)
+{
+    std::vector<std::string> images = IGfxLocalProvider::generateImages(localfilepath, dimensions);
+    if (pdfiumInitialized)
+    {
+        PdfiumReader::closeDocument();
+    }
+    return images;
+}
+
 bool GfxProviderFreeImage::readbitmapPdf(const LocalPath& imagePath, int size)
 {
     std::lock_guard<std::mutex> g(gfxMutex);
@@ -520,9 +784,9 @@ bool GfxProviderFreeImage::readbitmapPdf(const LocalPath& imagePath, int size)
         workingDir = LocalPath::fromPlatformEncodedAbsolute(tmpPath.c_str());
     }
 
-    unique_ptr<char[]> data = PdfiumReader::readBitmapFromPdf(w, h, orientation, imagePath, workingDir);
+    unique_ptr<char[]> data = PdfiumReader::readBitmapFromPdf(w, h, orientation, imagePath, workingDir, size);
 #else
-    unique_ptr<char[]> data = PdfiumReader::readBitmapFromPdf(w, h, orientation, imagePath);
+    unique_ptr<char[]> data = PdfiumReader::readBitmapFromPdf(w, h, orientation, imagePath, size);
 #endif
 
     if (!data || !w || !h)
@@ -631,7 +895,7 @@ bool GfxProviderFreeImage::resizebitmap(int rw, int rh, string* jpegout)
 
     jpegout->clear();
 
-    if ((tdib = FreeImage_Rescale(dib, w, h, FILTER_BILINEAR)))
+    if ((tdib = rescaleBitmap(dib, w, h)))
     {
         FreeImage_Unload(dib);
 
@@ -682,6 +946,7 @@ void GfxProviderFreeImage::freebitmap()
     if (dib != NULL)
     {
         FreeImage_Unload(dib);
+        dib = NULL;
     }
 }
 } // namespace
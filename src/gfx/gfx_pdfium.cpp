@@ -25,11 +25,14 @@
 #ifdef HAVE_PDFIUM
 
 #define MAX_PDF_MEM_SIZE 1024*1024*100
+#define MAX_PDF_BITMAP_DIMENSION 3500
+#define PDF_RENDER_BAND_HEIGHT 256
 
 namespace mega {
 
 std::mutex PdfiumReader::pdfMutex;
 unsigned PdfiumReader::initialized = 0;
+PdfiumReader::CachedDocument PdfiumReader::cachedDocument;
 
 void PdfiumReader::init()
 {
@@ -51,26 +54,27 @@ void PdfiumReader::destroy()
     std::lock_guard<std::mutex> g(pdfMutex);
     if (!--initialized)
     {
+        closeDocumentLocked();
         FPDF_DestroyLibrary();
         LOG_debug << "PDFium library destroyed.";
     }
 }
 
 #ifdef _WIN32
-std::unique_ptr<char[]> PdfiumReader::readBitmapFromPdf(int &w, int &h, int &orientation, const LocalPath &path, const LocalPath &workingDirFolder)
+FPDF_DOCUMENT PdfiumReader::loadDocument(const LocalPath &path, const LocalPath &workingDirFolder)
 #else
-std::unique_ptr<char[]> PdfiumReader::readBitmapFromPdf(int &w, int &h, int &orientation, const LocalPath &path)
+FPDF_DOCUMENT PdfiumReader::loadDocument(const LocalPath &path)
 #endif
 {
-
-    std::lock_guard<std::mutex> g(pdfMutex);
-    assert (initialized);
+    if (cachedDocument.document && cachedDocument.path == path)
+    {
+        LOG_debug << "Reusing the open PDF document " << path;
+        return cachedDocument.document;
+    }
+    closeDocumentLocked();
 
     FPDF_DOCUMENT pdf_doc = FPDF_LoadDocument(path.toPath(false).c_str(), nullptr);
 #ifdef _WIN32
-    LocalPath tmpFilePath;
-    bool removetemporaryfile = false;
-    std::unique_ptr<byte[]> buffer;
     FSACCESS_CLASS fa;
 
     // In Windows it fails if the path has non-ascii chars
@@ -84,123 +88,163 @@ std::unique_ptr<char[]> PdfiumReader::readBitmapFromPdf(int &w, int &h, int &ori
                 if (!workingDirFolder.empty())
                 {
                     LocalPath originPath = path;
-                    tmpFilePath = workingDirFolder;
+                    LocalPath tmpFilePath = workingDirFolder;
                     tmpFilePath.appendWithSeparator(LocalPath::fromRelativePath(".megapdftmp"),false);
                     if (fa.copylocal(originPath, tmpFilePath, pdfFile->mtime))
                     {
                         pdf_doc = FPDF_LoadDocument(tmpFilePath.toPath(false).c_str(), nullptr);
-                        removetemporaryfile = true;
+                        cachedDocument.tmpFilePath = tmpFilePath;
                     }
                 }
             }
             else if (pdfFile->openf(FSLogging::logOnError))
             {
-                buffer.reset(new byte[pdfFile->size]);
-                pdfFile->frawread(buffer.get(), static_cast<unsigned>(pdfFile->size), static_cast<m_off_t>(0), true, FSLogging::logOnError);
+                cachedDocument.buffer.reset(new byte[pdfFile->size]);
+                pdfFile->frawread(cachedDocument.buffer.get(), static_cast<unsigned>(pdfFile->size), static_cast<m_off_t>(0), true, FSLogging::logOnError);
                 pdfFile->closef();
-                pdf_doc = FPDF_LoadMemDocument(buffer.get(), static_cast<int>(pdfFile->size), nullptr);
+                pdf_doc = FPDF_LoadMemDocument(cachedDocument.buffer.get(), static_cast<int>(pdfFile->size), nullptr);
             }
         }
     }
 #endif
-    if (pdf_doc != nullptr)
+
+    cachedDocument.document = pdf_doc;
+    cachedDocument.path = path;
+    if (!pdf_doc)
     {
-        int page_count = FPDF_GetPageCount(pdf_doc);
-        if (page_count > 0)
-        {
-            FPDF_PAGE page = FPDF_LoadPage(pdf_doc, 0 /*pageIndex*/);
-            if (page != nullptr)
-            {
-                w = static_cast<int>(FPDF_GetPageWidth(page));
-                h = static_cast<int>(FPDF_GetPageHeight(page));
-
-                // we should restrict the maximum size of PDF pages to process, otherwise
-                // it may require too much memory (and CPU).
-                // as a compromise, the A0 standarized size should be enough for most cases,
-                // A0: 841 x 1188 mm -> 2384 x 3368 points (as returned by FPDF_GetPageX())
-                // to allow some margins, and rotated ones, avoid larger than 3500 points in
-                // any dimension, which would require a buffer of maximum 3500x3500x4 = ~47MB
-
-                if ((!w || !h)  // error reading size
-                        || (w > 3500 || h > 3500))  // page too large
-                {
-                    if (!w || !h)
-                    {
-                        LOG_err << "Error reading PDF page size for " << path;
-                    }
-                    else
-                    {
-                        LOG_err << "Page size too large. Skipping PDF preview for " << path;
-                    }
-                    FPDF_ClosePage(page);
-                    FPDF_CloseDocument(pdf_doc);
+        LOG_err << "Error loading PDF to create thumbnail for " << path << " " << FPDF_GetLastError();
+        closeDocumentLocked();
+    }
+    return pdf_doc;
+}
+
+void PdfiumReader::closeDocument()
+{
+    std::lock_guard<std::mutex> g(pdfMutex);
+    closeDocumentLocked();
+}
+
+void PdfiumReader::closeDocumentLocked()
+{
+    if (cachedDocument.document)
+    {
+        FPDF_CloseDocument(cachedDocument.document);
+    }
 #ifdef _WIN32
-                if (removetemporaryfile)
-                {
-                    fa.unlinklocal(tmpFilePath);
-                }
+    if (!cachedDocument.tmpFilePath.empty())
+    {
+        FSACCESS_CLASS fa;
+        fa.unlinklocal(cachedDocument.tmpFilePath);
+    }
 #endif
-                    return nullptr;
-                }
+    cachedDocument = CachedDocument();
+}
 
-                // BGRA format, 4 bytes per pixel (32bits), byte order: blue, green, red, alpha.
-                std::unique_ptr<char[]> buffer(new char[w*h*4]);
-                FPDF_BITMAP bitmap = FPDFBitmap_CreateEx(w, h, FPDFBitmap_BGRA, buffer.get(), w * 4);
-                if (!bitmap) //out of memory
-                {
-                    LOG_warn << "Error generating bitmap image (OOM)";
-                    FPDF_ClosePage(page);
-                    FPDF_CloseDocument(pdf_doc);
 #ifdef _WIN32
-                    if (removetemporaryfile)
-                    {
-                        fa.unlinklocal(tmpFilePath);
-                    }
+std::unique_ptr<char[]> PdfiumReader::readBitmapFromPdf(int &w, int &h, int &orientation, const LocalPath &path, const LocalPath &workingDirFolder, int size)
+#else
+std::unique_ptr<char[]> PdfiumReader::readBitmapFromPdf(int &w, int &h, int &orientation, const LocalPath &path, int size)
 #endif
-                    return nullptr;
-                }
+{
+
+    std::lock_guard<std::mutex> g(pdfMutex);
+    assert (initialized);
 
-                FPDFBitmap_FillRect(bitmap, 0, 0, w, h, 0xFFFFFFFF);
-                FPDF_RenderPageBitmap(bitmap, page, 0, 0, w, h, 2, 0);
-                FPDFBitmap_Destroy(bitmap);
-                FPDF_ClosePage(page);
-                FPDF_CloseDocument(pdf_doc);
 #ifdef _WIN32
-                if (removetemporaryfile)
-                {
-                    fa.unlinklocal(tmpFilePath);
-                }
+    FPDF_DOCUMENT pdf_doc = loadDocument(path, workingDirFolder);
+#else
+    FPDF_DOCUMENT pdf_doc = loadDocument(path);
 #endif
-                // Needed by Qt: ROTATION_DOWN = 3
-                orientation = 3;
-                return buffer;
-            }
-            else
-            {
-                FPDF_CloseDocument(pdf_doc);
-                LOG_err << "Error loading PDF page to create thumb for " << path;
-            }
+    if (pdf_doc == nullptr)
+    {
+        return nullptr;
+    }
+
+    if (FPDF_GetPageCount(pdf_doc) <= 0)
+    {
+        LOG_err << "Error getting number of pages for " << path;
+        closeDocumentLocked();
+        return nullptr;
+    }
+
+    FPDF_PAGE page = FPDF_LoadPage(pdf_doc, 0 /*pageIndex*/);
+    if (page == nullptr)
+    {
+        LOG_err << "Error loading PDF page to create thumb for " << path;
+        closeDocumentLocked();
+        return nullptr;
+    }
+
+    double pageWidth = FPDF_GetPageWidth(page);
+    double pageHeight = FPDF_GetPageHeight(page);
+
+    // The page is rendered at the resolution of the images to generate (its smaller side fits the largest
+    // one), instead of 1 pixel per point: big pages don't need big bitmaps, and small ones keep the detail.
+    // Without a size, it is rendered in points, as long as it's not larger than A0 with some margins:
+    // A0: 841 x 1188 mm -> 2384 x 3368 points (as returned by FPDF_GetPageX())
+    double scale = 1;
+    if (size > 0 && pageWidth >= 1 && pageHeight >= 1)
+    {
+        scale = size / std::min(pageWidth, pageHeight);
+    }
+
+    // and the bitmap is never larger than 3500 pixels in any dimension (3500x3500x4 = ~47MB)
+    if (size > 0 && std::max(pageWidth, pageHeight) * scale > MAX_PDF_BITMAP_DIMENSION)
+    {
+        scale = MAX_PDF_BITMAP_DIMENSION / std::max(pageWidth, pageHeight);
+    }
+
+    w = static_cast<int>(pageWidth * scale);
+    h = static_cast<int>(pageHeight * scale);
+
+    if ((w <= 0 || h <= 0)  // error reading size
+            || (w > MAX_PDF_BITMAP_DIMENSION || h > MAX_PDF_BITMAP_DIMENSION))  // page too large
+    {
+        if (w <= 0 || h <= 0)
+        {
+            LOG_err << "Error reading PDF page size for " << path;
         }
         else
         {
-            FPDF_CloseDocument(pdf_doc);
-            LOG_err << "Error getting number of pages for " << path;
+            LOG_err << "Page size too large. Skipping PDF preview for " << path;
         }
-    }
-    else
-    {
-        LOG_err << "Error loading PDF to create thumbnail for " << path << " " << FPDF_GetLastError();
+        FPDF_ClosePage(page);
+        closeDocumentLocked();
+        return nullptr;
     }
 
-#ifdef _WIN32
-    if (removetemporaryfile)
+    // BGRA format, 4 bytes per pixel (32bits), byte order: blue, green, red, alpha.
+    std::unique_ptr<char[]> buffer(new char[static_cast<size_t>(w) * static_cast<size_t>(h) * 4]);
+
+    // Rendered in bands of rows, straight into the buffer, to bound the memory used by PDFium for the
+    // page contents (its devices, masks and transparency groups are the size of the bitmap rendered)
+    for (int y = 0; y < h; y += PDF_RENDER_BAND_HEIGHT)
     {
-        fa.unlinklocal(tmpFilePath);
+        int bandHeight = std::min(PDF_RENDER_BAND_HEIGHT, h - y);
+        FPDF_BITMAP bitmap = FPDFBitmap_CreateEx(w, bandHeight, FPDFBitmap_BGRA, buffer.get() + static_cast<size_t>(y) * static_cast<size_t>(w) * 4, w * 4);
+        if (!bitmap) //out of memory
+        {
+            LOG_warn << "Error generating bitmap image (OOM)";
+            FPDF_ClosePage(page);
+            closeDocumentLocked();
+            return nullptr;
+        }
+
+        // from the page in points to this band of the device
+        FS_MATRIX matrix = { static_cast<float>(scale), 0, 0, static_cast<float>(scale), 0, static_cast<float>(-y) };
+        FS_RECTF clipping = { 0, 0, static_cast<float>(w), static_cast<float>(bandHeight) };
+
+        FPDFBitmap_FillRect(bitmap, 0, 0, w, bandHeight, 0xFFFFFFFF);
+        FPDF_RenderPageBitmapWithMatrix(bitmap, page, &matrix, &clipping, FPDF_LCD_TEXT);
+        FPDFBitmap_Destroy(bitmap);
     }
-#endif
+    FPDF_ClosePage(page);
 
-    return nullptr;
+    // the document stays open until closeDocument(), in case it's rendered at other sizes
 
+    // Needed by Qt: ROTATION_DOWN = 3
+    orientation = 3;
+    return buffer;
 }
 
 } // namespace mega
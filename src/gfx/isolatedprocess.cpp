@@ -87,12 +87,24 @@ const char* GfxProviderIsolatedProcess::Formats::videoformats() const
 
 std::unique_ptr<GfxProviderIsolatedProcess> GfxProviderIsolatedProcess::create(
     const std::string &endpointName,
-    const std::string &executable)
+    const std::string &executable,
+    size_t poolSize,
+    size_t maxPoolSize)
 {
     if (endpointName.empty() || executable.empty()) return nullptr;
 
-    auto process = std::make_unique<GfxIsolatedProcess>(endpointName, executable);
-    return std::make_unique<GfxProviderIsolatedProcess>(std::move(process));
+    auto pool = std::make_shared<GfxIsolatedProcessPool>(GfxIsolatedProcess::Params{endpointName, executable},
+                                                         poolSize,
+                                                         maxPoolSize);
+    return std::make_unique<GfxProviderIsolatedProcess>(std::move(pool));
+}
+
+std::unique_ptr<IGfxProvider> GfxProviderIsolatedProcess::clone() const
+{
+    // a single worker is better used by a single thread, with batches
+    if (mPool->maxSize() < 2) return nullptr;
+
+    return std::unique_ptr<IGfxProvider>(new GfxProviderIsolatedProcess(mPool, mFormats));
 }
 
 void GfxProviderIsolatedProcess::Formats::setOnce(const std::string& formats, const std::string& videoformats)
@@ -105,11 +117,17 @@ void GfxProviderIsolatedProcess::Formats::setOnce(const std::string& formats, co
     mIsValid = true;
 }
 
-GfxProviderIsolatedProcess::GfxProviderIsolatedProcess(std::unique_ptr<GfxIsolatedProcess> process)
-    : mProcess(std::move(process))
-    , mEndpointName(mProcess->endpointName())
+GfxProviderIsolatedProcess::GfxProviderIsolatedProcess(std::shared_ptr<GfxIsolatedProcessPool> pool)
+    : GfxProviderIsolatedProcess(std::move(pool), std::make_shared<Formats>())
+{
+}
+
+GfxProviderIsolatedProcess::GfxProviderIsolatedProcess(std::shared_ptr<GfxIsolatedProcessPool> pool,
+                                                       std::shared_ptr<Formats> formats)
+    : mFormats(std::move(formats))
+    , mPool(std::move(pool))
 {
-    assert(mProcess);
+    assert(mPool);
 }
 
 std::vector<std::string> GfxProviderIsolatedProcess::generateImages(
@@ -119,12 +137,41 @@ std::vector<std::string> GfxProviderIsolatedProcess::generateImages(
     // default return
     std::vector<std::string> images(dimensions.size());
 
-    auto gfxclient = GfxClient::create(mEndpointName);
+    auto worker = mPool->acquire();
+    auto gfxclient = GfxClient::create(worker->endpointName());
     gfxclient.runGfxTask(localfilepath.toPath(false), dimensions, images);
 
     return images;
 }
 
+void GfxProviderIsolatedProcess::generateImagesBatch(const std::vector<FileDimensions>& files,
+                                                     const ImagesCallback& onImages)
+{
+    std::vector<gfx::GfxTask> tasks;
+    for (const auto& file : files)
+    {
+        tasks.push_back(gfx::GfxTask{ file.first.toPath(false), file.second });
+    }
+
+    std::vector<bool> done(files.size());
+    auto worker = mPool->acquire();
+    auto gfxclient = GfxClient::create(worker->endpointName());
+    gfxclient.runGfxBatch(tasks, [&done, &onImages](size_t index, std::vector<std::string>&& images)
+    {
+        done[index] = true;
+        onImages(index, std::move(images));
+    });
+
+    // default return for the ones that failed
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        if (!done[i])
+        {
+            onImages(i, std::vector<std::string>(files[i].second.size()));
+        }
+    }
+}
+
 const char* GfxProviderIsolatedProcess::supportedformats()
 {
     return getformats(&Formats::formats);
@@ -138,21 +185,21 @@ const char* GfxProviderIsolatedProcess::supportedvideoformats()
 const char* GfxProviderIsolatedProcess::getformats(const char* (Formats::*formatsFn)() const)
 {
     // already fetched from the server
-    if (mFormats.isValid())
+    if (mFormats->isValid())
     {
-        return (mFormats.*formatsFn)();
+        return ((*mFormats).*formatsFn)();
     }
 
     // do fetching
     std::string formats, videoformats;
-    if (!GfxClient::create(mEndpointName).runSupportFormats(formats, videoformats))
+    if (!GfxClient::create(mPool->endpointName()).runSupportFormats(formats, videoformats))
     {
         return nullptr;
     }
     else
     {
-        mFormats.setOnce(formats, videoformats);
-        return (mFormats.*formatsFn)();
+        mFormats->setOnce(formats, videoformats);
+        return ((*mFormats).*formatsFn)();
     }
 }
 
@@ -353,4 +400,124 @@ GfxIsolatedProcess::GfxIsolatedProcess(const std::string& endpointName,
 {
 }
 
+GfxIsolatedProcessPool::GfxIsolatedProcessPool(const GfxIsolatedProcess::Params& params, size_t minSize, size_t maxSize)
+    : mParams(params)
+    , mMinSize(std::max<size_t>(minSize, 1))
+    , mWorkers(std::max(maxSize, mMinSize))
+{
+    // warm standby: the launch and the initialization of the libraries don't delay the first requests
+    for (size_t i = 0; i < mMinSize; ++i)
+    {
+        start(i);
+    }
+
+    LOG_debug << "Started " << mMinSize << " isolated gfx processes, up to " << mWorkers.size();
+}
+
+void GfxIsolatedProcessPool::start(size_t index)
+{
+    // the first one keeps the given endpoint
+    GfxIsolatedProcess::Params params = mParams;
+    if (index)
+    {
+        params.endpointName += "_" + std::to_string(index);
+    }
+
+    mWorkers[index].process = std::make_unique<GfxIsolatedProcess>(params);
+    mWorkers[index].lastUsed = steady_clock::now();
+}
+
+std::vector<std::unique_ptr<GfxIsolatedProcess>> GfxIsolatedProcessPool::retireIdle()
+{
+    std::vector<std::unique_ptr<GfxIsolatedProcess>> retired;
+    const auto now = steady_clock::now();
+    for (size_t i = mMinSize; i < mWorkers.size(); ++i)
+    {
+        Worker& worker = mWorkers[i];
+        if (worker.process && !worker.busy && now - worker.lastUsed > mParams.keepAliveInSeconds)
+        {
+            LOG_debug << "Stopping idle isolated gfx process " << worker.process->endpointName();
+            retired.push_back(std::move(worker.process));
+        }
+    }
+    return retired;
+}
+
+std::unique_ptr<GfxIsolatedProcessPool::Lease> GfxIsolatedProcessPool::acquire()
+{
+    std::vector<std::unique_ptr<GfxIsolatedProcess>> retired;
+    std::unique_ptr<Lease> lease;
+    {
+        const std::lock_guard<std::mutex> l(mMutex);
+        retired = retireIdle();
+
+        const size_t size = mWorkers.size();
+        size_t chosen = size;
+        size_t stopped = size;
+        for (size_t n = 0; n < size; ++n)
+        {
+            const size_t i = (mNext + n) % size;
+            const Worker& worker = mWorkers[i];
+            if (!worker.process)
+            {
+                if (stopped == size) stopped = i;
+            }
+            else if (!worker.busy)
+            {
+                chosen = i;
+                break;
+            }
+        }
+
+        // all of them are busy: a new one if allowed, otherwise the one with fewer requests
+        if (chosen == size && stopped != size)
+        {
+            LOG_debug << "All the isolated gfx processes are busy, starting another one";
+            start(stopped);
+            chosen = stopped;
+        }
+
+        if (chosen == size)
+        {
+            for (size_t n = 0; n < size; ++n)
+            {
+                const size_t i = (mNext + n) % size;
+                if (mWorkers[i].process && (chosen == size || mWorkers[i].busy < mWorkers[chosen].busy))
+                {
+                    chosen = i;
+                }
+            }
+        }
+
+        mWorkers[chosen].busy++;
+        mNext = (chosen + 1) % size;
+        lease = std::make_unique<Lease>(*this, chosen, mWorkers[chosen].process->endpointName());
+    }
+
+    // stopping the retired ones waits for their threads, out of the lock
+    retired.clear();
+
+    return lease;
+}
+
+void GfxIsolatedProcessPool::release(size_t index)
+{
+    const std::lock_guard<std::mutex> l(mMutex);
+    assert(mWorkers[index].busy);
+    mWorkers[index].busy--;
+    mWorkers[index].lastUsed = steady_clock::now();
+}
+
+GfxIsolatedProcessPool::Lease::Lease(GfxIsolatedProcessPool& pool, size_t index, const std::string& endpointName)
+    : mPool(pool)
+    , mIndex(index)
+    , mEndpointName(endpointName)
+{
+}
+
+GfxIsolatedProcessPool::Lease::~Lease()
+{
+    mPool.release(mIndex);
+}
+
 }
@@ -2,6 +2,7 @@
 #include "mega/gfx/worker/command_serializer.h"
 #include "mega/gfx/worker/commands.h"
 #include "mega/gfx/worker/comms.h"
+#include "mega/gfx/worker/shared_image_ring.h"
 #include "mega/logging.h"
 #include "mega/filesystem.h"
 #include "mega/types.h"
@@ -98,6 +99,12 @@ bool GfxClient::runGfxTask(const std::string& localpath,
                  <<  localpath;
         return false;
     }
+    else if (!addReponse->SharedImages.Name.empty()
+             && !SharedImageRing::read(addReponse->SharedImages, addReponse->Images))
+    {
+        LOG_err << "GfxClient couldn't read the gfxTask images from the shared memory, " << localpath;
+        return false;
+    }
     else
     {
         LOG_verbose << "GfxClient gets gfxTask response successfully, " << localpath;
@@ -106,6 +113,70 @@ bool GfxClient::runGfxTask(const std::string& localpath,
     }
 }
 
+bool GfxClient::runGfxBatch(const std::vector<GfxTask>& tasks, const BatchImagesCallback& onImages)
+{
+    assert(!tasks.empty() && tasks.size() <= CommandNewGfxBatch::MAX_TASKS);
+
+    // 3 seconds at most
+    auto endpoint = connectWithRetry(milliseconds(100), 30);
+    if (!endpoint)
+    {
+        LOG_err << "runGfxBatch Couldn't connect";
+        return false;
+    }
+
+    CommandNewGfxBatch command;
+    for (const auto& task : tasks)
+    {
+        command.Tasks.push_back(GfxTask{ LocalPath::fromAbsolutePath(task.Path).platformEncoded(), task.Dimensions });
+    }
+
+    ProtocolWriter writer(endpoint.get());
+    if (!writer.writeCommand(&command, TimeoutMs(5000)))
+    {
+        LOG_err << "GfxClient couldn't send gfxBatch request";
+        return false;
+    }
+
+    // the results come as each task finishes: the timeout applies to each of them, like for single tasks
+    bool allSucceeded = true;
+    std::vector<bool> received(tasks.size());
+    ProtocolReader reader(endpoint.get());
+    for (size_t n = 0; n < tasks.size(); ++n)
+    {
+        auto response = reader.readCommand(TimeoutMs(5000));
+        auto result = dynamic_cast<CommandNewGfxBatchResponse*>(response.get());
+        if (!result || result->Index >= tasks.size() || received[result->Index])
+        {
+            LOG_err << "GfxClient couldn't get gfxBatch response, " << n << " of " << tasks.size() << " received";
+            return false;
+        }
+
+        received[result->Index] = true;
+        if (result->ErrorCode == static_cast<uint32_t>(GfxTaskProcessStatus::ERR))
+        {
+            LOG_info << "GfxClient gets gfxBatch response with error: "
+                     << result->ErrorText
+                     << ", "
+                     << tasks[result->Index].Path;
+            allSucceeded = false;
+            continue;
+        }
+
+        if (!result->SharedImages.Name.empty() && !SharedImageRing::read(result->SharedImages, result->Images))
+        {
+            LOG_err << "GfxClient couldn't read the gfxBatch images from the shared memory, " << tasks[result->Index].Path;
+            allSucceeded = false;
+            continue;
+        }
+
+        LOG_verbose << "GfxClient gets gfxBatch response successfully, " << tasks[result->Index].Path;
+        onImages(result->Index, std::move(result->Images));
+    }
+
+    return allSucceeded;
+}
+
 bool GfxClient::runSupportFormats(std::string& formats, std::string& videoformats)
 {
     auto endpoint = connectWithRetry(milliseconds(100), 30); // 3 seconds at most
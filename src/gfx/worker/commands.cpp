@@ -8,6 +8,8 @@ namespace
 using mega::CacheableWriter;
 using mega::CacheableReader;
 using mega::GfxDimension;
+using mega::gfx::GfxTask;
+using mega::gfx::GfxSharedImages;
 
 class GfxSerializationHelper
 {
@@ -22,6 +24,22 @@ public:
     {
         writer.serializestring_u32(source);
     }
+    static void serialize(CacheableWriter& writer, const uint32_t source)
+    {
+        writer.serializeu32(source);
+    }
+    static void serialize(CacheableWriter& writer, const GfxSharedImages& source)
+    {
+        writer.serializestring_u32(source.Name);
+        writer.serializeu64(source.Offset);
+        writer.serializeu32(source.Generation);
+        GfxSerializationHelper::serialize(writer, source.Sizes);
+    }
+    static void serialize(CacheableWriter& writer, const GfxTask& source)
+    {
+        writer.serializestring_u32(source.Path);
+        GfxSerializationHelper::serialize(writer, source.Dimensions);
+    }
     template<typename T>
     static void serialize(CacheableWriter& writer, const std::vector<T>& target)
     {
@@ -53,6 +71,24 @@ public:
     {
         return reader.unserializestring_u32(target);
     }
+    static bool unserialize(CacheableReader& reader, uint32_t& target)
+    {
+        return reader.unserializeu32(target);
+    }
+    static bool unserialize(CacheableReader& reader, GfxSharedImages& target)
+    {
+        return reader.unserializestring_u32(target.Name)
+               && reader.unserializeu64(target.Offset)
+               && reader.unserializeu32(target.Generation)
+               && GfxSerializationHelper::unserialize(reader, target.Sizes);
+    }
+    static bool unserialize(CacheableReader& reader, GfxTask& target)
+    {
+        // empty dimensions considered an invalid task
+        return reader.unserializestring_u32(target.Path)
+               && GfxSerializationHelper::unserialize(reader, target.Dimensions)
+               && !target.Dimensions.empty();
+    }
     template<typename T>
     static bool unserialize(CacheableReader& reader, std::vector<T>& target, const size_t maxVectSize = MAX_VECT_SIZE)
     {
@@ -102,6 +138,10 @@ std::unique_ptr<ICommand> ICommand::factory(CommandType type)
         return std::make_unique<CommandSupportFormats>();
     case CommandType::SUPPORT_FORMATS_RESPONSE:
         return std::make_unique<CommandSupportFormatsResponse>();
+    case CommandType::NEW_GFX_BATCH:
+        return std::make_unique<CommandNewGfxBatch>();
+    case CommandType::NEW_GFX_BATCH_RESPONSE:
+        return std::make_unique<CommandNewGfxBatchResponse>();
     default:
         assert(false);
         return nullptr;
@@ -165,6 +205,7 @@ std::string CommandNewGfxResponse::serialize() const
     writer.serializeu32(ErrorCode);
     writer.serializestring_u32(ErrorText);
     GfxSerializationHelper::serialize(writer, Images);
+    GfxSerializationHelper::serialize(writer, SharedImages);
     return toret;
 }
 
@@ -186,6 +227,78 @@ bool CommandNewGfxResponse::unserialize(const std::string& data)
     {
         return false;
     }
+    // or where they are
+    if (!GfxSerializationHelper::unserialize(reader, SharedImages))
+    {
+        return false;
+    }
+    return true;
+}
+
+std::string CommandNewGfxBatch::serialize() const
+{
+    std::string toret;
+    CacheableWriter writer(toret);
+    GfxSerializationHelper::serialize(writer, Tasks);
+    return toret;
+}
+
+bool CommandNewGfxBatch::unserialize(const std::string& data)
+{
+    CacheableReader reader(data);
+    // tasks
+    if (!GfxSerializationHelper::unserialize(reader, Tasks, MAX_TASKS))
+    {
+        return false;
+    }
+    // empty batch considered an invalid command
+    if (Tasks.empty())
+    {
+        return false;
+    }
+    return true;
+}
+
+std::string CommandNewGfxBatchResponse::serialize() const
+{
+    std::string toret;
+    CacheableWriter writer(toret);
+    writer.serializeu32(Index);
+    writer.serializeu32(ErrorCode);
+    writer.serializestring_u32(ErrorText);
+    GfxSerializationHelper::serialize(writer, Images);
+    GfxSerializationHelper::serialize(writer, SharedImages);
+    return toret;
+}
+
+bool CommandNewGfxBatchResponse::unserialize(const std::string& data)
+{
+    CacheableReader reader(data);
+    // Index
+    if (!reader.unserializeu32(Index))
+    {
+        return false;
+    }
+    // ErrorCode
+    if (!reader.unserializeu32(ErrorCode))
+    {
+        return false;
+    }
+    // ErrorText
+    if (!reader.unserializestring_u32(ErrorText))
+    {
+        return false;
+    }
+    // images
+    if (!GfxSerializationHelper::unserialize(reader, Images))
+    {
+        return false;
+    }
+    // or where they are
+    if (!GfxSerializationHelper::unserialize(reader, SharedImages))
+    {
+        return false;
+    }
     return true;
 }
 
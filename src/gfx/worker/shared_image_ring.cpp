@@ -0,0 +1,252 @@
+#include "mega/gfx/worker/shared_image_ring.h"
+#include "mega/gfx/worker/shared_memory.h"
+#include "mega/logging.h"
+
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+namespace mega {
+namespace gfx {
+
+namespace {
+
+constexpr uint32_t RING_MAGIC = 0x4D474952; // "MGIR"
+
+// the regions start after this, every one of them aligned to it
+constexpr size_t ALIGNMENT = 64;
+
+struct RingHeader
+{
+    uint32_t magic;
+    uint32_t reserved;
+    uint64_t capacity;
+};
+
+static_assert(sizeof(RingHeader) <= ALIGNMENT, "the ring header doesn't fit");
+
+size_t alignUp(size_t n)
+{
+    return (n + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+}
+
+constexpr size_t SharedImageRing::DEFAULT_CAPACITY;
+constexpr std::chrono::seconds SharedImageRing::EXPIRY;
+
+SharedImageRing::SharedImageRing(std::unique_ptr<SharedMemory> memory, size_t capacity)
+    : mMemory(std::move(memory))
+    , mCapacity(capacity)
+{
+    auto ringHeader = reinterpret_cast<RingHeader*>(mMemory->data());
+    ringHeader->magic = RING_MAGIC;
+    ringHeader->reserved = 0;
+    ringHeader->capacity = capacity;
+}
+
+SharedImageRing::~SharedImageRing() = default;
+
+std::unique_ptr<SharedImageRing> SharedImageRing::create(const std::string& name, size_t capacity)
+{
+    capacity = alignUp(capacity);
+    auto memory = SharedMemory::create(name, ALIGNMENT + capacity);
+    if (!memory)
+    {
+        return nullptr;
+    }
+
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "the ring needs address-free atomics");
+    return std::unique_ptr<SharedImageRing>(new SharedImageRing(std::move(memory), capacity));
+}
+
+SharedImageRing::RegionHeader* SharedImageRing::header(size_t offset) const
+{
+    return reinterpret_cast<RegionHeader*>(mMemory->data() + ALIGNMENT + offset);
+}
+
+void SharedImageRing::reclaim()
+{
+    auto now = std::chrono::steady_clock::now();
+    while (!mRegions.empty())
+    {
+        const Region& region = mRegions.front();
+        RegionHeader* regionHeader = header(region.offset);
+
+        uint32_t expected = WRITTEN;
+        if (regionHeader->state.load(std::memory_order_acquire) != FREE
+            && !(now - region.written > EXPIRY && regionHeader->state.compare_exchange_strong(expected, FREE)))
+        {
+            break;
+        }
+
+        mRegions.pop_front();
+    }
+
+    if (mRegions.empty())
+    {
+        mHead = 0;
+    }
+}
+
+bool SharedImageRing::allocate(size_t length, size_t& offset)
+{
+    if (mRegions.empty())
+    {
+        offset = 0;
+        if (length > mCapacity) return false;
+    }
+    else
+    {
+        size_t tail = mRegions.front().offset;
+        if (tail < mHead)
+        {
+            // [tail, mHead) in use: after it, or wrap around to the beginning
+            if (mCapacity - mHead >= length)
+            {
+                offset = mHead;
+            }
+            else if (tail >= length)
+            {
+                offset = 0;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        else if (tail - mHead >= length)
+        {
+            // wrapped around: only the gap up to the oldest one is free
+            offset = mHead;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    mHead = offset + length;
+    return true;
+}
+
+GfxSharedImages SharedImageRing::write(const std::vector<std::string>& images)
+{
+    GfxSharedImages location;
+
+    size_t total = 0;
+    for (const auto& image : images)
+    {
+        if (image.size() > std::numeric_limits<uint32_t>::max()) return location;
+        total += image.size();
+    }
+
+    size_t offset = 0;
+    uint32_t generation = 0;
+    RegionHeader* regionHeader = nullptr;
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        reclaim();
+        if (!allocate(alignUp(sizeof(RegionHeader) + total), offset))
+        {
+            LOG_debug << "No room in the shared memory for " << total << " bytes of images";
+            return location;
+        }
+
+        generation = ++mGeneration;
+        regionHeader = header(offset);
+        regionHeader->state.store(RESERVED, std::memory_order_relaxed);
+        regionHeader->generation.store(generation, std::memory_order_relaxed);
+        regionHeader->size = total;
+
+        // a client still reading an expired region sees the new generation before the new images
+        std::atomic_thread_fence(std::memory_order_release);
+
+        mRegions.push_back(Region{ offset, alignUp(sizeof(RegionHeader) + total), std::chrono::steady_clock::now() });
+    }
+
+    uint8_t* out = reinterpret_cast<uint8_t*>(regionHeader + 1);
+    for (const auto& image : images)
+    {
+        std::memcpy(out, image.data(), image.size());
+        out += image.size();
+        location.Sizes.push_back(static_cast<uint32_t>(image.size()));
+    }
+    regionHeader->state.store(WRITTEN, std::memory_order_release);
+
+    location.Name = mMemory->name();
+    location.Offset = offset;
+    location.Generation = generation;
+    return location;
+}
+
+bool SharedImageRing::read(const GfxSharedImages& location, std::vector<std::string>& images)
+{
+    // the worker's shared memory stays mapped, until it's replaced by another one (a new worker process)
+    static std::mutex mappingMutex;
+    static std::shared_ptr<SharedMemory> mapping;
+
+    std::shared_ptr<SharedMemory> memory;
+    {
+        std::lock_guard<std::mutex> g(mappingMutex);
+        if (!mapping || mapping->name() != location.Name)
+        {
+            mapping = SharedMemory::open(location.Name);
+            if (mapping && (mapping->size() < ALIGNMENT
+                            || reinterpret_cast<RingHeader*>(mapping->data())->magic != RING_MAGIC))
+            {
+                LOG_err << "Invalid shared memory for images: " << location.Name;
+                mapping.reset();
+            }
+        }
+        memory = mapping;
+    }
+
+    if (!memory)
+    {
+        return false;
+    }
+
+    uint64_t capacity = std::min<uint64_t>(reinterpret_cast<RingHeader*>(memory->data())->capacity,
+                                           memory->size() - ALIGNMENT);
+    uint64_t total = std::accumulate(location.Sizes.begin(), location.Sizes.end(), uint64_t(0));
+    if (location.Offset % ALIGNMENT || location.Offset + sizeof(RegionHeader) + total > capacity)
+    {
+        LOG_err << "Invalid location of images in the shared memory: " << location.Offset << " " << total;
+        return false;
+    }
+
+    auto regionHeader = reinterpret_cast<RegionHeader*>(memory->data() + ALIGNMENT + location.Offset);
+    if (regionHeader->generation.load(std::memory_order_acquire) != location.Generation
+        || regionHeader->state.load(std::memory_order_acquire) != WRITTEN
+        || regionHeader->size != total)
+    {
+        LOG_warn << "The images in the shared memory are not there anymore";
+        return false;
+    }
+
+    const char* in = reinterpret_cast<const char*>(regionHeader + 1);
+    images.clear();
+    for (uint32_t size : location.Sizes)
+    {
+        images.emplace_back(in, size);
+        in += size;
+    }
+
+    // the worker could have reused it meanwhile, if it had expired
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (regionHeader->generation.load(std::memory_order_relaxed) != location.Generation)
+    {
+        LOG_warn << "The images in the shared memory were overwritten while reading them";
+        images.clear();
+        return false;
+    }
+
+    uint32_t expected = WRITTEN;
+    regionHeader->state.compare_exchange_strong(expected, FREE, std::memory_order_release);
+    return true;
+}
+
+} // namespace
+}
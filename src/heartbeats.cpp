@@ -29,6 +29,7 @@ namespace mega {
 #ifdef ENABLE_SYNC
 
 static constexpr int FREQUENCY_HEARTBEAT_DS = 300;
+static constexpr int FREQUENCY_CHECK_DS = 10;
 
 HeartBeatBackupInfo::HeartBeatBackupInfo()
 {
@@ -302,7 +303,7 @@ bool BackupInfoSync::operator!=(const BackupInfoSync &o) const
     return !(*this == o);
 }
 
-void BackupMonitor::beatBackupInfo(UnifiedSync& us)
+void BackupMonitor::beatBackupInfo(UnifiedSync& us, std::vector<std::function<void(MegaClient&)>>& heartbeats)
 {
     assert(syncs.onSyncThread());
 
@@ -358,11 +359,11 @@ void BackupMonitor::beatBackupInfo(UnifiedSync& us)
         auto backupId = us.mConfig.mBackupId;
         auto status = hbs->sphbStatus();
         auto pendingUps = static_cast<uint32_t>(reportCounts.mUploads.mPending);
-        auto pendingDowns = static_cast<uint32_t>(reportCounts.mUploads.mPending);
+        auto pendingDowns = static_cast<uint32_t>(reportCounts.mDownloads.mPending);
         auto lastAction = hbs->lastAction();
         auto lastItemUpdated = hbs->lastItemUpdated();
 
-        syncs.queueClient([=](MegaClient& mc, DBTableTransactionCommitter& committer)
+        heartbeats.emplace_back([=](MegaClient& mc)
             {
                 mc.reqs.add(
                     new CommandBackupPutHeartBeat(&mc, backupId, status,
@@ -385,14 +386,35 @@ void BackupMonitor::beat()
 {
     assert(syncs.onSyncThread());
 
+    if (Waiter::ds < mNextBeat)
+    {
+        return;
+    }
+    mNextBeat = Waiter::ds + FREQUENCY_CHECK_DS;
+
     // Only send heartbeats for enabled active syncs.
+    std::vector<std::function<void(MegaClient&)>> heartbeats;
     for (auto& us : syncs.mSyncVec)
     {
         if (us->mSync && us->mConfig.getEnabled())
         {
-            beatBackupInfo(*us);
+            beatBackupInfo(*us, heartbeats);
         }
     };
+
+    if (heartbeats.empty())
+    {
+        return;
+    }
+
+    // the heartbeats of all the syncs due now go to the API in the same batch
+    syncs.queueClient([heartbeats = std::move(heartbeats)](MegaClient& mc, DBTableTransactionCommitter&)
+        {
+            for (auto& heartbeat : heartbeats)
+            {
+                heartbeat(mc);
+            }
+        });
 }
 
 #endif
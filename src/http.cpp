@@ -40,6 +40,148 @@
 
 namespace mega {
 
+namespace {
+
+struct HttpBufferPoolState
+{
+    // header right in front of every buffer: the size class, or NO_CLASS if it's not pooled
+    static constexpr size_t HEADER_SIZE = 16;   // keeps the data aligned as new[] would
+    static constexpr uint32_t NO_CLASS = UINT32_MAX;
+    static constexpr unsigned NUM_CLASSES = 11;  // 64 KB .. 64 MB
+
+    std::mutex mMutex;
+    std::vector<byte*> mFree[NUM_CLASSES];      // released buffers (not slabs)
+    size_t mCachedBytes = 0;
+
+    static size_t classSize(unsigned c)
+    {
+        return HttpBufferPool::MIN_SLAB_SIZE << c;
+    }
+
+    // pooled slabs start a whole ALIGNMENT before their data, so it keeps the alignment
+    static byte* newBuffer(uint32_t c, size_t capacity)
+    {
+        byte* buf;
+        if (c == NO_CLASS)
+        {
+            buf = new byte[capacity + HEADER_SIZE] + HEADER_SIZE;
+        }
+        else
+        {
+            static_assert(HttpBufferPool::ALIGNMENT >= HEADER_SIZE, "header must fit before aligned data");
+            buf = static_cast<byte*>(::operator new[](capacity + HttpBufferPool::ALIGNMENT, std::align_val_t(HttpBufferPool::ALIGNMENT)))
+                  + HttpBufferPool::ALIGNMENT;
+        }
+        memcpy(buf - HEADER_SIZE, &c, sizeof c);
+        return buf;
+    }
+
+    static void deleteBuffer(byte* buf, uint32_t c)
+    {
+        if (c == NO_CLASS)
+        {
+            delete[] (buf - HEADER_SIZE);
+        }
+        else
+        {
+            ::operator delete[](buf - HttpBufferPool::ALIGNMENT, std::align_val_t(HttpBufferPool::ALIGNMENT));
+        }
+    }
+
+    ~HttpBufferPoolState()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        for (uint32_t c = 0; c < NUM_CLASSES; c++)
+        {
+            for (byte* buf : mFree[c])
+            {
+                deleteBuffer(buf, c);
+            }
+            mFree[c].clear();
+        }
+        mCachedBytes = 0;
+    }
+};
+
+static_assert((HttpBufferPool::MIN_SLAB_SIZE << (HttpBufferPoolState::NUM_CLASSES - 1)) == HttpBufferPool::MAX_SLAB_SIZE, "size classes");
+
+HttpBufferPoolState& httpBufferPoolState()
+{
+    // never destroyed: buffers can still be released by other threads during the static destruction
+    static auto* state = new HttpBufferPoolState;
+    return *state;
+}
+
+} // namespace
+
+byte* HttpBufferPool::allocate(size_t len)
+{
+    uint32_t c = HttpBufferPoolState::NO_CLASS;
+    if (len >= MIN_SLAB_SIZE / 2 && len <= MAX_SLAB_SIZE)
+    {
+        c = 0;
+        while (HttpBufferPoolState::classSize(c) < len)
+        {
+            c++;
+        }
+
+        auto& state = httpBufferPoolState();
+        std::lock_guard<std::mutex> g(state.mMutex);
+        if (!state.mFree[c].empty())
+        {
+            byte* buf = state.mFree[c].back();
+            state.mFree[c].pop_back();
+            state.mCachedBytes -= HttpBufferPoolState::classSize(c);
+            return buf;
+        }
+    }
+
+    size_t capacity = c == HttpBufferPoolState::NO_CLASS ? len : HttpBufferPoolState::classSize(c);
+    return HttpBufferPoolState::newBuffer(c, capacity);
+}
+
+void HttpBufferPool::release(byte* buf)
+{
+    if (!buf)
+    {
+        return;
+    }
+
+    uint32_t c;
+    memcpy(&c, buf - HttpBufferPoolState::HEADER_SIZE, sizeof c);
+
+    if (c != HttpBufferPoolState::NO_CLASS)
+    {
+        auto& state = httpBufferPoolState();
+        std::lock_guard<std::mutex> g(state.mMutex);
+        if (state.mCachedBytes + HttpBufferPoolState::classSize(c) <= MAX_CACHED_BYTES)
+        {
+            state.mFree[c].push_back(buf);
+            state.mCachedBytes += HttpBufferPoolState::classSize(c);
+            return;
+        }
+    }
+
+    HttpBufferPoolState::deleteBuffer(buf, c);
+}
+
+size_t HttpBufferPool::cachedBytes()
+{
+    auto& state = httpBufferPoolState();
+    std::lock_guard<std::mutex> g(state.mMutex);
+    return state.mCachedBytes;
+}
+
+void HttpBufferPool::clear()
+{
+    httpBufferPoolState().clear();
+}
+
 // data receive timeout (ds)
 const int HttpIO::NETWORKTIMEOUT = 6000;
 
@@ -383,6 +525,16 @@ m_off_t HttpIO::getmaxdownloadspeed()
     return 0;
 }
 
+bool HttpIO::sethttp2(bool)
+{
+    return false;
+}
+
+bool HttpIO::gethttp2()
+{
+    return false;
+}
+
 m_off_t HttpIO::getmaxuploadspeed()
 {
     return 0;
@@ -491,7 +643,7 @@ HttpReq::~HttpReq()
         httpio->cancel(this);
     }
 
-    delete[] buf;
+    HttpBufferPool::release(buf);
 }
 
 void HttpReq::init()
@@ -503,6 +655,7 @@ void HttpReq::init()
     notifiedbufpos = 0;
     contentlength = 0;
     timeleft = -1;
+    retryafter = -1;
     lastdata = NEVER;
     outpos = 0;
     in.clear();
@@ -569,7 +722,7 @@ HttpReq::http_buf_t::http_buf_t(byte* b, size_t s, size_t e)
 
 HttpReq::http_buf_t::~http_buf_t()
 {
-    delete[] buf;
+    HttpBufferPool::release(buf);
 }
 
 void HttpReq::http_buf_t::swap(http_buf_t& other)
@@ -724,13 +877,13 @@ void HttpReqDL::prepare(const char* tempurl, SymmCipher* /*key*/,
         // (re)allocate buffer
         if (buf)
         {
-            delete[] buf;
+            HttpBufferPool::release(buf);
             buf = NULL;
         }
 
         if (size)
         {
-            buf = new byte[(size + SymmCipher::BLOCKSIZE - 1) & - SymmCipher::BLOCKSIZE];
+            buf = HttpBufferPool::allocate((size + SymmCipher::BLOCKSIZE - 1) & - SymmCipher::BLOCKSIZE);
         }
         buflen = size;
     }
@@ -1127,4 +1280,89 @@ m_off_t SpeedController::aggregateProgressForTimePeriod(dstime timePeriodToAggre
     return (timePeriodToAggregate * bytesToAggregate) / totalTime;
 }
 
+/************************\
+ *  BandwidthScheduler  *
+\************************/
+
+const unsigned BandwidthScheduler::WEIGHTS[BW_CLASSES] = { 8, 4, 1 }; // streaming, interactive, background
+
+void BandwidthScheduler::setLimit(m_off_t bps)
+{
+    mLimit = bps;
+    mTokens.fill(0);
+    mShared = 0;
+}
+
+m_off_t BandwidthScheduler::burst(m_off_t bps) const
+{
+    return std::max(bps * BURST_DS / SpeedController::DS_PER_SECOND, MIN_BURST);
+}
+
+void BandwidthScheduler::refill(dstime now)
+{
+    if (!mLimit || now <= mLastRefill)
+    {
+        mLastRefill = std::max(mLastRefill, now);
+        return;
+    }
+
+    // the buckets can't hold more than this anyway
+    dstime elapsed = std::min<dstime>(now - mLastRefill, BURST_DS);
+    mLastRefill = now;
+
+    m_off_t overflow = mLimit * elapsed / SpeedController::DS_PER_SECOND;
+    m_off_t tokens = overflow;
+
+    unsigned totalWeight = 0;
+    for (int c = 0; c < BW_CLASSES; c++)
+    {
+        if (mActive[c] && now - mLastActive[c] > IDLE_DS)
+        {
+            // idle classes keep their debt, but not their tokens
+            mActive[c] = false;
+            overflow += std::max<m_off_t>(mTokens[c], 0);
+            mTokens[c] = std::min<m_off_t>(mTokens[c], 0);
+        }
+
+        if (mActive[c])
+        {
+            totalWeight += WEIGHTS[c];
+        }
+    }
+
+    for (int c = 0; totalWeight && c < BW_CLASSES; c++)
+    {
+        if (mActive[c])
+        {
+            m_off_t share = tokens * WEIGHTS[c] / totalWeight;
+            m_off_t room = burst(mLimit * WEIGHTS[c] / totalWeight) - mTokens[c];
+            m_off_t added = std::max<m_off_t>(std::min(share, room), 0);
+            mTokens[c] += added;
+            overflow -= added;
+        }
+    }
+
+    mShared = std::min(mShared + overflow, burst(mLimit));
+}
+
+m_off_t BandwidthScheduler::available(bwclass_t c, dstime now)
+{
+    mActive[c] = true;
+    mLastActive[c] = now;
+    return mTokens[c] + mShared;
+}
+
+void BandwidthScheduler::consume(bwclass_t c, m_off_t bytes)
+{
+    m_off_t own = std::min(bytes, std::max<m_off_t>(mTokens[c], 0));
+    mTokens[c] -= own;
+    bytes -= own;
+
+    m_off_t shared = std::min(bytes, mShared);
+    mShared -= shared;
+    bytes -= shared;
+
+    mTokens[c] -= bytes;
+}
+
 } // namespace
@@ -21,6 +21,27 @@
 #include <cctype>
 #include <cstdint>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MEGA_JSON_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define MEGA_JSON_NEON
+#include <arm_neon.h>
+#endif
+
+// Vector scans read whole aligned blocks, which may include bytes beyond the terminating
+// null (never beyond its page). That is harmless, but address sanitizers report it.
+#if defined(__SANITIZE_ADDRESS__)
+#define MEGA_JSON_NO_SIMD
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define MEGA_JSON_NO_SIMD
+#endif
+#endif
+
 #include "mega/json.h"
 #include "mega/base64.h"
 #include "mega/megaclient.h"
@@ -32,13 +53,117 @@ namespace mega {
 bool g_jsonLoggingOn = false;
 #define JSON_verbose if (g_jsonLoggingOn) LOG_verbose
 
+const char* JSON::findStringDelimiter(const char* ptr)
+{
+#if !defined(MEGA_JSON_NO_SIMD) && (defined(MEGA_JSON_SSE2) || defined(MEGA_JSON_NEON))
+    // aligned 16-byte blocks: the first one is masked to ignore the bytes before `ptr`
+    const char* block = reinterpret_cast<const char*>(reinterpret_cast<uintptr_t>(ptr) & ~uintptr_t(15));
+    unsigned skip = unsigned(ptr - block);
+
+#if defined(MEGA_JSON_SSE2)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i zero = _mm_setzero_si128();
+
+    for (unsigned mask = ~0u << skip; ; mask = ~0u, block += 16)
+    {
+        __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(block));
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                    _mm_cmpeq_epi8(v, zero));
+        unsigned bits = unsigned(_mm_movemask_epi8(hits)) & mask;
+        if (bits)
+        {
+#if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long index;
+            _BitScanForward(&index, bits);
+            return block + index;
+#else
+            return block + __builtin_ctz(bits);
+#endif
+        }
+    }
+#else
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+
+    for (uint64_t mask = ~0ull << (skip * 4); ; mask = ~0ull, block += 16)
+    {
+        uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(block));
+        uint8x16_t hits = vorrq_u8(vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, backslash)), vceqzq_u8(v));
+
+        // narrow each byte to a nibble, as NEON has no movemask
+        uint64_t bits = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hits), 4)), 0) & mask;
+        if (bits)
+        {
+            return block + (__builtin_ctzll(bits) >> 2);
+        }
+    }
+#endif
+#else
+    while (*ptr && *ptr != '"' && *ptr != '\\')
+    {
+        ptr++;
+    }
+
+    return ptr;
+#endif
+}
+
+const char* JSON::findStringEnd(const char* ptr)
+{
+    for (;;)
+    {
+        ptr = findStringDelimiter(ptr);
+        if (*ptr != '\\')
+        {
+            return ptr;
+        }
+
+        // skip the escaped character
+        if (!*++ptr)
+        {
+            return ptr;
+        }
+        ptr++;
+    }
+}
+
+namespace {
+
+// position of the first '"' or terminating null at or after `ptr`: names are not unescaped
+const char* findNameEnd(const char* ptr)
+{
+    ptr = JSON::findStringDelimiter(ptr);
+    while (*ptr == '\\')
+    {
+        ptr = JSON::findStringDelimiter(ptr + 1);
+    }
+    return ptr;
+}
+
+} // namespace
+
 // store array or object in string s
 // reposition after object
 bool JSON::storeobject(string* s)
+{
+    std::string_view v;
+    if (!storeobject(v))
+    {
+        return false;
+    }
+
+    if (s)
+    {
+        s->assign(v.data(), v.size());
+    }
+    return true;
+}
+
+bool JSON::storeobject(std::string_view& s)
 {
     int openobject[2] = { 0 };
     const char* ptr;
-    bool escaped = false;
 
     while (*(const signed char*)pos > 0 && *pos <= ' ')
     {
@@ -73,13 +198,7 @@ bool JSON::storeobject(string* s)
         }
         else if (*ptr == '"')
         {
-            ptr++;
-
-            while (*ptr && (escaped || *ptr != '"'))
-            {
-                escaped = *ptr == '\\' && !escaped;
-                ptr++;
-            }
+            ptr = findStringEnd(ptr + 1);
 
             if (!*ptr)
             {
@@ -108,16 +227,13 @@ bool JSON::storeobject(string* s)
 
         if (!openobject[0] && !openobject[1])
         {
-            if (s)
+            if (*pos == '"')
             {
-                if (*pos == '"')
-                {
-                    s->assign(pos + 1, ptr - pos - 2);
-                }
-                else
-                {
-                    s->assign(pos, ptr - pos);
-                }
+                s = std::string_view(pos + 1, static_cast<size_t>(ptr - pos - 2));
+            }
+            else
+            {
+                s = std::string_view(pos, static_cast<size_t>(ptr - pos));
             }
 
             pos = ptr;
@@ -231,13 +347,10 @@ std::string JSON::getname()
 
     if (*ptr++ == '"')
     {
-        while (*ptr && *ptr != '"')
-        {
-            name += *ptr;
-            ptr++;
-        }
+        const char* end = findNameEnd(ptr);
+        name.assign(ptr, end);
 
-        pos = ptr + 2;
+        pos = end + 2;
     }
 
     return name;
@@ -255,11 +368,7 @@ std::string JSON::getnameWithoutAdvance() const
 
     if (*ptr++ == '"')
     {
-        while (*ptr && *ptr != '"')
-        {
-            name += *ptr;
-            ptr++;
-        }
+        name.assign(ptr, findNameEnd(ptr));
     }
 
     return name;
@@ -1434,19 +1543,10 @@ bool JSONSplitter::isStarting()
 
 int JSONSplitter::strEnd()
 {
-    const char* ptr = mPos;
-    while ((ptr = strchr(ptr + 1, '"')))
+    const char* ptr = JSON::findStringEnd(mPos + 1);
+    if (*ptr == '"')
     {
-        const char *e = ptr;
-        while (*(--e) == '\\')
-        {
-            // noop
-        }
-
-        if ((ptr - e) & 1)
-        {
-            return int(ptr + 1 - mPos);
-        }
+        return int(ptr + 1 - mPos);
     }
 
     return -1;
@@ -1455,7 +1555,7 @@ int JSONSplitter::strEnd()
 int JSONSplitter::numEnd()
 {
     const char* ptr = mPos;
-    while (*ptr && strchr("0123456789-+eE.", *ptr))
+    while ((*ptr >= '0' && *ptr <= '9') || *ptr == '-' || *ptr == '+' || *ptr == 'e' || *ptr == 'E' || *ptr == '.')
     {
         ptr++;
     }
@@ -24,7 +24,10 @@
 
 #include "mega/logging.h"
 
+#include <algorithm>
+#include <chrono>
 #include <ctime>
+#include <limits>
 
 namespace mega {
 
@@ -191,4 +194,479 @@ void ExclusiveLogger::log(const char *time, int loglevel, const char *source, co
     );
 }
 
+
+namespace {
+
+std::atomic<uint64_t> nextAsyncLoggerId{1};
+
+const char BINARY_LOG_MAGIC[8] = { 'M', 'E', 'G', 'A', 'L', 'O', 'G', '\x01' };
+
+// thread number of the records created by the AsyncLogger itself
+const unsigned NO_THREAD_NUMBER = std::numeric_limits<unsigned>::max();
+
+void copyTruncated(char* dst, size_t dstSize, const char* src)
+{
+    size_t size = std::min(strlen(src), dstSize - 1);
+    memcpy(dst, src, size);
+    dst[size] = '\0';
+}
+
+// binary records are written in host byte order, to be decoded on the same platform
+template<typename T>
+void writeValue(std::ostream& out, T value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template<typename T>
+bool readValue(std::istream& in, T& value)
+{
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+} // namespace
+
+AsyncLogger::AsyncLogger(Logger& target, size_t ringSlots)
+    : mTarget(&target)
+    , mRingSlots(ringSlots)
+    , mInstanceId(nextAsyncLoggerId++)
+{
+    start();
+}
+
+AsyncLogger::AsyncLogger(std::ostream& binaryOutput, size_t ringSlots)
+    : mBinaryOutput(&binaryOutput)
+    , mRingSlots(ringSlots)
+    , mInstanceId(nextAsyncLoggerId++)
+{
+    mBinaryOutput->write(BINARY_LOG_MAGIC, sizeof(BINARY_LOG_MAGIC));
+    start();
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    {
+        std::lock_guard<std::mutex> g(mWakeMutex);
+        mStop = true;
+    }
+    mWake.notify_one();
+    mThread.join();
+
+    drain();
+}
+
+void AsyncLogger::start()
+{
+    assert(mRingSlots > 1);
+    mThread = std::thread(&AsyncLogger::loop, this);
+}
+
+AsyncLogger::Ring* AsyncLogger::threadRing()
+{
+    struct ThreadRing
+    {
+        uint64_t instanceId = 0;
+        std::shared_ptr<Ring> ring;
+    };
+    static thread_local ThreadRing threadRing;
+
+    if (threadRing.instanceId != mInstanceId)
+    {
+        // first message of this thread: the only time it takes a lock
+        std::lock_guard<std::mutex> g(mRingsMutex);
+        threadRing.ring = std::make_shared<Ring>(mRingSlots, mNextThreadNumber++);
+        threadRing.instanceId = mInstanceId;
+        mRings.push_back(threadRing.ring);
+    }
+    return threadRing.ring.get();
+}
+
+void AsyncLogger::log(const char *time, int loglevel, const char *source, const char *message
+#ifdef ENABLE_LOG_PERFORMANCE
+    , const char **directMessages, size_t *directMessagesSizes, unsigned numberMessages
+#endif
+)
+{
+    Ring* ring = threadRing();
+
+    size_t head = ring->head.load(std::memory_order_relaxed);
+    size_t used = head - ring->tail.load(std::memory_order_acquire);
+    if (used >= ring->records.size())
+    {
+        mDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Record& record = ring->records[head % ring->records.size()];
+    record.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::system_clock::now().time_since_epoch()).count();
+    record.level = loglevel;
+    record.hasTime = time != nullptr;
+    if (time)
+    {
+        copyTruncated(record.time, sizeof(record.time), time);
+    }
+    record.hasSource = source != nullptr;
+    if (source)
+    {
+        copyTruncated(record.source, sizeof(record.source), source);
+    }
+
+    if (!message)
+    {
+        message = "";
+    }
+    size_t messageSize = strlen(message);
+    size_t size = messageSize;
+#ifdef ENABLE_LOG_PERFORMANCE
+    for (unsigned i = 0; i < numberMessages; ++i)
+    {
+        size += directMessagesSizes[i];
+    }
+#endif
+
+    if (size < sizeof(record.text))
+    {
+        char* it = std::copy(message, message + messageSize, record.text);
+#ifdef ENABLE_LOG_PERFORMANCE
+        for (unsigned i = 0; i < numberMessages; ++i)
+        {
+            it = std::copy(directMessages[i], directMessages[i] + directMessagesSizes[i], it);
+        }
+#endif
+        *it = '\0';
+    }
+    else
+    {
+        record.longText.reserve(size);
+        record.longText.assign(message);
+#ifdef ENABLE_LOG_PERFORMANCE
+        for (unsigned i = 0; i < numberMessages; ++i)
+        {
+            record.longText.append(directMessages[i], directMessagesSizes[i]);
+        }
+#endif
+    }
+    record.size = size;
+
+    ring->head.store(head + 1, std::memory_order_release);
+
+    if (used + 1 == ring->records.size() / 2)
+    {
+        mWake.notify_one();
+    }
+}
+
+void AsyncLogger::flush()
+{
+    drain();
+}
+
+void AsyncLogger::loop()
+{
+    // this is the log-output thread: messages logged by the targets are ignored, to prevent cycles
+    SimpleLogger::mThreadLocalLoggingDisabled = true;
+
+    std::unique_lock<std::mutex> lock(mWakeMutex);
+    while (!mStop)
+    {
+        mWake.wait_for(lock, std::chrono::milliseconds(DRAIN_INTERVAL_MS));
+        lock.unlock();
+        drain();
+        lock.lock();
+    }
+}
+
+void AsyncLogger::drain()
+{
+    std::lock_guard<std::mutex> g(mDrainMutex);
+
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard<std::mutex> rg(mRingsMutex);
+
+        // forget the rings of the threads that have finished, once they are empty
+        mRings.erase(std::remove_if(mRings.begin(), mRings.end(), [](const std::shared_ptr<Ring>& ring)
+            {
+                return ring.use_count() == 1
+                    && ring->head.load(std::memory_order_acquire) == ring->tail.load(std::memory_order_relaxed);
+            }), mRings.end());
+        rings = mRings;
+    }
+
+    // deliver what is there now, in timestamp order across the threads.
+    // Messages logged meanwhile wait for the next pass
+    std::vector<size_t> heads(rings.size());
+    for (size_t i = 0; i < rings.size(); ++i)
+    {
+        heads[i] = rings[i]->head.load(std::memory_order_acquire);
+    }
+
+    for (;;)
+    {
+        Ring* next = nullptr;
+        size_t nextTail = 0;
+        for (size_t i = 0; i < rings.size(); ++i)
+        {
+            size_t tail = rings[i]->tail.load(std::memory_order_relaxed);
+            if (tail != heads[i]
+                && (!next || rings[i]->records[tail % mRingSlots].timestamp < next->records[nextTail % mRingSlots].timestamp))
+            {
+                next = rings[i].get();
+                nextTail = tail;
+            }
+        }
+
+        if (!next)
+        {
+            break;
+        }
+
+        Record& record = next->records[nextTail % mRingSlots];
+        deliver(record, next->threadNumber);
+        if (!record.longText.empty())
+        {
+            std::string().swap(record.longText);
+        }
+        next->tail.store(nextTail + 1, std::memory_order_release);
+    }
+
+    uint64_t dropped = mDropped.load(std::memory_order_relaxed);
+    if (dropped != mReportedDropped)
+    {
+        Record record;
+        record.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+                               std::chrono::system_clock::now().time_since_epoch()).count();
+        record.level = logWarning;
+        record.size = static_cast<size_t>(snprintf(record.text, sizeof(record.text),
+                                                   "AsyncLogger: %llu messages dropped",
+                                                   static_cast<unsigned long long>(dropped - mReportedDropped)));
+        deliver(record, NO_THREAD_NUMBER);
+        mReportedDropped = dropped;
+    }
+
+    if (mBinaryOutput)
+    {
+        mBinaryOutput->flush();
+    }
+}
+
+void AsyncLogger::deliver(const Record& record, unsigned threadNumber)
+{
+    if (mBinaryOutput)
+    {
+        uint16_t sourceSize = record.hasSource ? static_cast<uint16_t>(strlen(record.source)) : 0;
+        writeValue(*mBinaryOutput, record.timestamp);
+        writeValue(*mBinaryOutput, static_cast<uint32_t>(threadNumber));
+        writeValue(*mBinaryOutput, static_cast<uint8_t>(record.level));
+        writeValue(*mBinaryOutput, sourceSize);
+        mBinaryOutput->write(record.source, sourceSize);
+        writeValue(*mBinaryOutput, static_cast<uint32_t>(record.size));
+        mBinaryOutput->write(record.message(), static_cast<std::streamsize>(record.size));
+        return;
+    }
+
+    mTarget->log(record.hasTime ? record.time : nullptr, record.level, record.hasSource ? record.source : nullptr, record.message()
+#ifdef ENABLE_LOG_PERFORMANCE
+        , nullptr, nullptr, 0
+#endif
+    );
+}
+
+bool AsyncLogger::decodeBinaryLog(std::istream& in, std::ostream& out)
+{
+    char magic[sizeof(BINARY_LOG_MAGIC)];
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, BINARY_LOG_MAGIC, sizeof(magic)))
+    {
+        return false;
+    }
+
+    std::string source;
+    std::string text;
+    for (;;)
+    {
+        int64_t timestamp;
+        if (!readValue(in, timestamp))
+        {
+            // the end of the log is only valid between records
+            return in.eof() && !in.gcount();
+        }
+
+        uint32_t threadNumber;
+        uint8_t level;
+        uint16_t sourceSize;
+        uint32_t textSize;
+        if (!readValue(in, threadNumber) || !readValue(in, level) || level > logMax || !readValue(in, sourceSize))
+        {
+            return false;
+        }
+        source.resize(sourceSize);
+        if ((sourceSize && !in.read(&source[0], sourceSize)) || !readValue(in, textSize))
+        {
+            return false;
+        }
+        text.resize(textSize);
+        if (textSize && !in.read(&text[0], textSize))
+        {
+            return false;
+        }
+
+        char ts[32];
+        time_t t = static_cast<time_t>(timestamp / 1000000);
+        std::tm tm{};
+#ifdef WIN32
+        gmtime_s(&tm, &t);
+#else
+        gmtime_r(&t, &tm);
+#endif
+        if (!std::strftime(ts, sizeof(ts), "%Y-%m-%d %H:%M:%S", &tm))
+        {
+            ts[0] = '\0';
+        }
+        char us[8];
+        snprintf(us, sizeof(us), ".%06d", static_cast<int>(timestamp % 1000000));
+
+        out << "[" << ts << us << "][" << SimpleLogger::toStr(static_cast<LogLevel>(level)) << "][";
+        if (threadNumber == NO_THREAD_NUMBER)
+        {
+            out << "-";
+        }
+        else
+        {
+            out << "t" << threadNumber;
+        }
+        out << "] ";
+        if (sourceSize)
+        {
+            out << source << " ";
+        }
+        out << text << "\n";
+    }
+}
+
+namespace {
+
+struct ThreadTrace
+{
+    struct Event
+    {
+        const char* name;
+        int64_t start;
+        int64_t duration;
+    };
+
+    std::mutex mutex; // only contended while dumping
+    const char* name = nullptr;
+    unsigned tid = 0;
+    std::vector<Event> events;
+    size_t next = 0;
+};
+
+std::mutex threadTracesMutex;
+std::vector<std::shared_ptr<ThreadTrace>> threadTraces;
+unsigned nextTraceTid = 1;
+
+thread_local const char* traceThreadName = nullptr;
+thread_local std::shared_ptr<ThreadTrace> threadTrace;
+
+} // namespace
+
+std::atomic<bool> Tracer::mEnabled{false};
+
+void Tracer::setEnabled(bool enable)
+{
+    mEnabled.store(enable, std::memory_order_relaxed);
+}
+
+void Tracer::setThreadName(const char* name)
+{
+    traceThreadName = name;
+    if (threadTrace)
+    {
+        std::lock_guard<std::mutex> g(threadTrace->mutex);
+        threadTrace->name = name;
+    }
+}
+
+int64_t Tracer::now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracer::record(const char* name, int64_t startUs, int64_t endUs)
+{
+    if (!threadTrace)
+    {
+        auto trace = std::make_shared<ThreadTrace>();
+        trace->name = traceThreadName;
+        trace->events.reserve(EVENTS_PER_THREAD);
+
+        std::lock_guard<std::mutex> g(threadTracesMutex);
+        trace->tid = nextTraceTid++;
+        threadTraces.push_back(trace);
+        threadTrace = std::move(trace);
+    }
+
+    ThreadTrace& trace = *threadTrace;
+    std::lock_guard<std::mutex> g(trace.mutex);
+    ThreadTrace::Event event{ name, startUs, endUs - startUs };
+    if (trace.events.size() < EVENTS_PER_THREAD)
+    {
+        trace.events.push_back(event);
+    }
+    else
+    {
+        trace.events[trace.next] = event;
+    }
+    trace.next = (trace.next + 1) % EVENTS_PER_THREAD;
+}
+
+std::string Tracer::dump(bool clear)
+{
+    std::vector<std::shared_ptr<ThreadTrace>> traces;
+    {
+        std::lock_guard<std::mutex> g(threadTracesMutex);
+        traces = threadTraces;
+        if (clear)
+        {
+            // forget the threads that have finished
+            threadTraces.erase(std::remove_if(threadTraces.begin(), threadTraces.end(), [](const std::shared_ptr<ThreadTrace>& trace)
+                {
+                    return trace.use_count() == 2; // this one and the copy in 'traces'
+                }), threadTraces.end());
+        }
+    }
+
+    std::ostringstream json;
+    json << "{\"traceEvents\":[";
+    bool first = true;
+    for (auto& trace : traces)
+    {
+        std::lock_guard<std::mutex> g(trace->mutex);
+
+        json << (first ? "" : ",") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << trace->tid
+             << ",\"args\":{\"name\":\"" << (trace->name ? trace->name : "thread") << " " << trace->tid << "\"}}";
+        first = false;
+
+        // oldest first
+        size_t size = trace->events.size();
+        size_t start = size < EVENTS_PER_THREAD ? 0 : trace->next;
+        for (size_t i = 0; i < size; ++i)
+        {
+            const auto& event = trace->events[(start + i) % size];
+            json << ",{\"name\":\"" << event.name << "\",\"cat\":\"mega\",\"ph\":\"X\",\"pid\":1,\"tid\":" << trace->tid
+                 << ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+        }
+
+        if (clear)
+        {
+            trace->events.clear();
+            trace->next = 0;
+        }
+    }
+    json << "],\"displayTimeUnit\":\"ms\"}";
+    return json.str();
+}
+
 } // namespace
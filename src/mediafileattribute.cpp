@@ -25,6 +25,7 @@
 #include "mega/command.h"
 #include "mega/megaclient.h"
 #include "mega/megaapp.h"
+#include "megafs.h"
 
 #ifdef USE_MEDIAINFO
 #include "MediaInfo/MediaInfo.h"
@@ -276,6 +277,101 @@ void MediaFileInfo::sendOrQueueMediaPropertiesFileAttributesForExistingFile(Medi
     }
 }
 
+void MediaFileInfo::startMediaPropertiesExtraction(MegaClient* client, const LocalPath& localpath, UploadHandle uploadHandle)
+{
+    requestCodecMappingsOneTime(client, LocalPath());
+
+    pendingExtractions[uploadHandle] = PendingExtraction();
+    LOG_debug << "Extracting media attributes in the background for upload " << toHandle(uploadHandle.h);
+
+    // discardable: on logout they are not needed anymore
+    std::shared_ptr<ExtractedProperties> results = extractedProperties;
+    client->mMediaPropertiesQueue.push([localpath, uploadHandle, results](SymmCipher&)
+    {
+        FSACCESS_CLASS fsAccess;
+        LocalPath path = localpath;
+        MediaProperties vp;
+        vp.extractMediaPropertyFileAttributes(path, &fsAccess);
+
+        std::lock_guard<std::mutex> g(results->mutex);
+        results->results.emplace_back(uploadHandle, std::move(vp));
+    }, true, MegaClientAsyncQueue::BACKGROUND);
+}
+
+bool MediaFileInfo::completeMediaPropertiesExtraction(MegaClient* client, uint32_t fakey[4], UploadHandle uploadHandle, Transfer* transfer)
+{
+    auto it = pendingExtractions.find(uploadHandle);
+    if (it == pendingExtractions.end())
+    {
+        return false;
+    }
+
+    if (it->second.extracted)
+    {
+        queueMediaPropertiesFileAttributesForUpload(it->second.vp, fakey, client, uploadHandle, transfer);
+        pendingExtractions.erase(it);
+    }
+    else
+    {
+        // hold the transfer until they are ready
+        it->second.uploadCompleted = true;
+        memcpy(it->second.fakey, fakey, sizeof(it->second.fakey));
+        client->fileAttributesUploading.setFileAttributePending(uploadHandle, fatype(fa_media), transfer);
+        LOG_debug << "Upload waiting for the media attributes being extracted";
+    }
+    return true;
+}
+
+bool MediaFileInfo::checkMediaPropertiesExtractions(MegaClient* client)
+{
+    std::vector<std::pair<UploadHandle, MediaProperties>> results;
+    {
+        std::lock_guard<std::mutex> g(extractedProperties->mutex);
+        results.swap(extractedProperties->results);
+    }
+
+    for (auto& result : results)
+    {
+        auto it = pendingExtractions.find(result.first);
+        if (it == pendingExtractions.end())
+        {
+            continue; // the upload is gone
+        }
+
+        if (!it->second.uploadCompleted)
+        {
+            it->second.extracted = true;
+            it->second.vp = std::move(result.second);
+            continue;
+        }
+
+        UploadHandle uploadHandle = result.first;
+        PendingExtraction pending = std::move(it->second);
+        pendingExtractions.erase(it);
+
+        if (auto uploadFAPtr = client->fileAttributesUploading.lookupExisting(uploadHandle))
+        {
+            if (!queueMediaPropertiesFileAttributesForUpload(result.second, pending.fakey, client, uploadHandle, uploadFAPtr->transfer))
+            {
+                // let the upload complete without them
+                uploadFAPtr->pendingfa.erase(fatype(fa_media));
+            }
+            client->checkfacompletion(uploadHandle);
+        }
+    }
+
+    return !results.empty();
+}
+
+void MediaFileInfo::forgetMediaPropertiesExtraction(UploadHandle uploadHandle)
+{
+    auto it = pendingExtractions.find(uploadHandle);
+    if (it != pendingExtractions.end() && !it->second.uploadCompleted)
+    {
+        pendingExtractions.erase(it);
+    }
+}
+
 void MediaFileInfo::addUploadMediaFileAttributes(UploadHandle uploadhandle, std::string* s)
 {
     std::map<UploadHandle, MediaFileInfo::queuedvp>::iterator i = uploadFileAttributes.find(uploadhandle);
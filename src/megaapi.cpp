@@ -228,6 +228,46 @@ void MegaNodeList::addNode(MegaNode *node)
 
 }
 
+MegaNodeChangeList::MegaNodeChangeList()
+{
+
+}
+
+MegaNodeChangeList::~MegaNodeChangeList()
+{
+
+}
+
+MegaNodeChangeList* MegaNodeChangeList::copy() const
+{
+    return NULL;
+}
+
+int MegaNodeChangeList::size() const
+{
+    return 0;
+}
+
+MegaHandle MegaNodeChangeList::getHandle(int) const
+{
+    return INVALID_HANDLE;
+}
+
+MegaHandle MegaNodeChangeList::getParentHandle(int) const
+{
+    return INVALID_HANDLE;
+}
+
+uint64_t MegaNodeChangeList::getChanges(int) const
+{
+    return 0;
+}
+
+bool MegaNodeChangeList::isIncomplete() const
+{
+    return false;
+}
+
 MegaTransferList::~MegaTransferList() { }
 
 MegaTransfer *MegaTransferList::get(int)
@@ -1177,6 +1217,11 @@ MegaSetElementList* MegaRequest::getMegaSetElementList() const
     return nullptr;
 }
 
+MegaNodeList* MegaRequest::getMegaNodeList() const
+{
+    return nullptr;
+}
+
 MegaBackupInfoList* MegaRequest::getMegaBackupInfoList() const
 {
     return nullptr;
@@ -1753,10 +1798,24 @@ MegaError *SynchronousRequestListener::getError() const
 //Transfer callbacks
 void MegaTransferListener::onTransferStart(MegaApi *, MegaTransfer *)
 { }
+void MegaTransferListener::onTransfersStart(MegaApi *api, MegaTransferList *transfers)
+{
+    for (int i = 0; i < transfers->size(); i++)
+    {
+        onTransferStart(api, transfers->get(i));
+    }
+}
 void MegaTransferListener::onTransferFinish(MegaApi*, MegaTransfer *, MegaError*)
 { }
 void MegaTransferListener::onTransferUpdate(MegaApi *, MegaTransfer *)
 { }
+void MegaTransferListener::onTransfersUpdate(MegaApi *api, MegaTransferList *transfers)
+{
+    for (int i = 0; i < transfers->size(); i++)
+    {
+        onTransferUpdate(api, transfers->get(i));
+    }
+}
 void MegaTransferListener::onFolderTransferUpdate(MegaApi *, MegaTransfer *, int stage, uint32_t foldercount, uint32_t filecount, uint32_t createdfoldercount, const char* currentFolder, const char* currentFileLeafname)
 { }
 bool MegaTransferListener::onTransferData(MegaApi *, MegaTransfer *, char *, size_t)
@@ -1831,6 +1890,8 @@ void MegaGlobalListener::onUserAlertsUpdate(MegaApi *api, MegaUserAlertList *ale
 { }
 void MegaGlobalListener::onNodesUpdate(MegaApi *, MegaNodeList *)
 { }
+void MegaGlobalListener::onNodeChangesAvailable(MegaApi *)
+{ }
 void MegaGlobalListener::onAccountUpdate(MegaApi *)
 { }
 void MegaGlobalListener::onSetsUpdate(MegaApi *, MegaSetList *)
@@ -1861,10 +1922,24 @@ void MegaListener::onRequestTemporaryError(MegaApi *, MegaRequest *, MegaError *
 { }
 void MegaListener::onTransferStart(MegaApi *, MegaTransfer *)
 { }
+void MegaListener::onTransfersStart(MegaApi *api, MegaTransferList *transfers)
+{
+    for (int i = 0; i < transfers->size(); i++)
+    {
+        onTransferStart(api, transfers->get(i));
+    }
+}
 void MegaListener::onTransferFinish(MegaApi *, MegaTransfer *, MegaError *)
 { }
 void MegaListener::onTransferUpdate(MegaApi *, MegaTransfer *)
 { }
+void MegaListener::onTransfersUpdate(MegaApi *api, MegaTransferList *transfers)
+{
+    for (int i = 0; i < transfers->size(); i++)
+    {
+        onTransferUpdate(api, transfers->get(i));
+    }
+}
 void MegaListener::onTransferTemporaryError(MegaApi *, MegaTransfer *, MegaError *)
 { }
 void MegaListener::onUsersUpdate(MegaApi *, MegaUserList *)
@@ -1873,6 +1948,8 @@ void MegaListener::onUserAlertsUpdate(MegaApi *, MegaUserAlertList *)
 { }
 void MegaListener::onNodesUpdate(MegaApi *, MegaNodeList *)
 { }
+void MegaListener::onNodeChangesAvailable(MegaApi *)
+{ }
 void MegaListener::onAccountUpdate(MegaApi *)
 { }
 void MegaListener::onSetsUpdate(MegaApi *, MegaSetList *)
@@ -2158,6 +2235,21 @@ void MegaApi::log(int logLevel, const char *message, const char *filename, int l
     MegaApiImpl::log(logLevel, message, filename, line);
 }
 
+char* MegaApi::getPerformanceSnapshot(bool reset)
+{
+    return MegaApiImpl::getPerformanceSnapshot(reset);
+}
+
+void MegaApi::setTracingEnabled(bool enable)
+{
+    MegaApiImpl::setTracingEnabled(enable);
+}
+
+char* MegaApi::dumpTrace()
+{
+    return MegaApiImpl::dumpTrace();
+}
+
 void MegaApi::setLoggingName(const char* loggingName)
 {
     pImpl->setLoggingName(loggingName);
@@ -2719,6 +2811,16 @@ void MegaApi::cancelGetThumbnail(MegaNode* node, MegaRequestListener *listener)
 	pImpl->cancelGetThumbnail(node, listener);
 }
 
+void MegaApi::getThumbnails(MegaHandleList* nodeHandles, MegaRequestListener *listener)
+{
+    pImpl->getThumbnails(nodeHandles, listener);
+}
+
+void MegaApi::getUserAttributes(MegaHandleList* users, int type, MegaRequestListener *listener)
+{
+    pImpl->getUserAttributes(users, type, listener);
+}
+
 void MegaApi::setThumbnail(MegaNode* node, const char *srcFilePath, MegaRequestListener *listener)
 {
     pImpl->setThumbnail(node, srcFilePath, listener);
@@ -2899,6 +3001,21 @@ void MegaApi::setNodeSensitive(MegaNode* node, bool sensitive, MegaRequestListen
     pImpl->setNodeSensitive(node, sensitive, listener);
 }
 
+void MegaApi::setNodesLabel(MegaNodeList* nodes, int label, MegaRequestListener* listener)
+{
+    pImpl->setNodesLabel(nodes, label, listener);
+}
+
+void MegaApi::setNodesFavourite(MegaNodeList* nodes, bool fav, MegaRequestListener* listener)
+{
+    pImpl->setNodesFavourite(nodes, fav, listener);
+}
+
+void MegaApi::setNodesSensitive(MegaNodeList* nodes, bool sensitive, MegaRequestListener* listener)
+{
+    pImpl->setNodesSensitive(nodes, sensitive, listener);
+}
+
 void MegaApi::setNodeCoordinates(MegaNode *node, double latitude, double longitude, MegaRequestListener *listener)
 {
     pImpl->setNodeCoordinates(node, false, latitude, longitude, listener);
@@ -2919,6 +3036,11 @@ void MegaApi::addNodeTag(MegaNode* node, const char* tag, MegaRequestListener* l
     pImpl->addNodeTag(node, tag, listener);
 }
 
+void MegaApi::addNodesTag(MegaNodeList* nodes, const char* tag, MegaRequestListener* listener)
+{
+    pImpl->addNodesTag(nodes, tag, listener);
+}
+
 void MegaApi::removeNodeTag(MegaNode* node, const char* tag, MegaRequestListener* listener)
 {
     pImpl->removeNodeTag(node, tag, listener);
@@ -2959,6 +3081,21 @@ void MegaApi::fetchNodes(MegaRequestListener *listener)
     pImpl->fetchNodes(listener);
 }
 
+void MegaApi::setFastResume(bool enable)
+{
+    pImpl->setFastResume(enable);
+}
+
+void MegaApi::setFolderLinkFetchRoot(MegaHandle folder)
+{
+    pImpl->setFolderLinkFetchRoot(folder);
+}
+
+void MegaApi::setLowMemoryMode(bool enable, long long transferMemoryBudget)
+{
+    pImpl->setLowMemoryMode(enable, transferMemoryBudget);
+}
+
 void MegaApi::getCloudStorageUsed(MegaRequestListener *listener)
 {
     pImpl->getCloudStorageUsed(listener);
@@ -3459,6 +3596,16 @@ void MegaApi::setMaxConnections(int connections, MegaRequestListener *listener)
     pImpl->setMaxConnections(-1,  connections, listener);
 }
 
+void MegaApi::setTransferUpdateInterval(int milliseconds)
+{
+    pImpl->setTransferUpdateInterval(milliseconds);
+}
+
+void MegaApi::setTransferUpdatesBatched(bool enable)
+{
+    pImpl->setTransferUpdatesBatched(enable);
+}
+
 void MegaApi::setDownloadMethod(int method)
 {
     pImpl->setDownloadMethod(method);
@@ -3479,6 +3626,16 @@ int MegaApi::getMaxUploadSpeed()
     return pImpl->getMaxUploadSpeed();
 }
 
+bool MegaApi::setHttp2Enabled(bool enable)
+{
+    return pImpl->setHttp2Enabled(enable);
+}
+
+bool MegaApi::isHttp2Enabled()
+{
+    return pImpl->isHttp2Enabled();
+}
+
 bool MegaApi::setMaxDownloadSpeed(long long bpslimit)
 {
     return pImpl->setMaxDownloadSpeed(bpslimit);
@@ -3608,6 +3765,16 @@ void MegaApi::startDownload(MegaNode* node, const char* localPath, const char *c
     pImpl->startDownload(startFirst, node, localPath, customName, 0 /*folderTransferTag*/, appData, convertToCancelToken(cancelToken), collisionCheck, collisionResolution, undelete, listener);
 }
 
+void MegaApi::startUploads(MegaUploadBatch* batch, MegaTransferListener *listener)
+{
+    pImpl->startUploads(batch, listener);
+}
+
+void MegaApi::startDownloads(MegaDownloadBatch* batch, MegaTransferListener *listener)
+{
+    pImpl->startDownloads(batch, listener);
+}
+
 void MegaApi::cancelTransfer(MegaTransfer *t, MegaRequestListener *listener)
 {
     pImpl->cancelTransfer(t, listener);
@@ -4000,6 +4167,16 @@ MegaUserAlertList* MegaApi::getUserAlerts()
     return pImpl->getUserAlerts();
 }
 
+MegaUserAlertList* MegaApi::getUserAlerts(int offset, int size)
+{
+    return pImpl->getUserAlerts(offset, size);
+}
+
+int MegaApi::getNumUserAlerts()
+{
+    return pImpl->getNumUserAlerts();
+}
+
 int MegaApi::getNumUnreadUserAlerts()
 {
     return pImpl->getNumUnreadUserAlerts();
@@ -4310,6 +4487,11 @@ MegaNodeList* MegaApi::search(const MegaSearchFilter* filter, int order, MegaCan
     return pImpl->search(filter, order, convertToCancelToken(cancelToken), searchPage);
 }
 
+void MegaApi::searchNodes(const MegaSearchFilter* filter, int order, size_t pageSize, MegaCancelToken* cancelToken, MegaRequestListener* listener)
+{
+    pImpl->searchNodes(filter, order, pageSize, convertToCancelToken(cancelToken), listener);
+}
+
 MegaNodeList* MegaApi::search(MegaNode* n, const char* searchString, bool recursive, int order)
 {
     return pImpl->search(n, searchString, CancelToken(), recursive, order);
@@ -4440,6 +4622,16 @@ void MegaApi::addGlobalListener(MegaGlobalListener* listener)
     pImpl->addGlobalListener(listener);
 }
 
+void MegaApi::setNodeChangesBufferSize(unsigned int size)
+{
+    pImpl->setNodeChangesBufferSize(size);
+}
+
+MegaNodeChangeList* MegaApi::popNodeChanges(unsigned int maxCount)
+{
+    return pImpl->popNodeChanges(maxCount);
+}
+
 void MegaApi::addScheduledCopyListener(MegaScheduledCopyListener *listener)
 {
     pImpl->addScheduledCopyListener(listener);
@@ -4625,6 +4817,41 @@ unsigned long long MegaApi::getNumNodesAtCacheLRU() const
     return pImpl->getNumNodesAtCacheLRU();
 }
 
+void MegaApi::setLRUCachePolicy(int policy)
+{
+    pImpl->setLRUCachePolicy(policy);
+}
+
+unsigned long long MegaApi::getLRUCacheHits() const
+{
+    return pImpl->getLRUCacheHits();
+}
+
+unsigned long long MegaApi::getLRUCacheMisses() const
+{
+    return pImpl->getLRUCacheMisses();
+}
+
+void MegaApi::setChildrenPrefetch(unsigned int folders)
+{
+    pImpl->setChildrenPrefetch(folders);
+}
+
+void MegaApi::setDatabasePerformanceProfile(int profile)
+{
+    pImpl->setDatabasePerformanceProfile(profile);
+}
+
+void MegaApi::setDatabasePerformanceParameters(long long mmapSize, long long cacheSizeKB, int pageSize, int synchronous)
+{
+    pImpl->setDatabasePerformanceParameters(mmapSize, cacheSizeKB, pageSize, synchronous);
+}
+
+MegaStringMap* MegaApi::benchmarkDatabase(int repetitions)
+{
+    return pImpl->benchmarkDatabase(repetitions);
+}
+
 long long MegaApi::getTotalDownloadedBytes()
 {
     return pImpl->getTotalDownloadedBytes();
@@ -4857,6 +5084,16 @@ int MegaApi::httpServerGetMaxOutputSize()
     return pImpl->httpServerGetMaxOutputSize();
 }
 
+void MegaApi::httpServerSetNumThreads(int numThreads)
+{
+    pImpl->httpServerSetNumThreads(numThreads);
+}
+
+int MegaApi::httpServerGetNumThreads()
+{
+    return pImpl->httpServerGetNumThreads();
+}
+
 //FTP Server:
 bool MegaApi::ftpServerStart(bool localOnly, int port, int dataportBegin, int dataPortEnd, bool useTLS, const char * certificatepath, const char * keypath)
 {
@@ -5822,6 +6059,11 @@ MegaSetElementList* MegaApi::getSetElements(MegaHandle sid, bool includeElements
     return pImpl->getSetElements(sid, includeElementsInRubbishBin);
 }
 
+MegaSetElementList* MegaApi::getSetElements(MegaHandle sid, int offset, int size, bool includeElementsInRubbishBin)
+{
+    return pImpl->getSetElements(sid, offset, size, includeElementsInRubbishBin);
+}
+
 MegaSetElement* MegaApi::getSetElement(MegaHandle sid, MegaHandle eid)
 {
     return pImpl->getSetElement(sid, eid);
@@ -7063,6 +7305,11 @@ MegaSearchPage* MegaSearchPage::createInstance(size_t startingOffset, size_t siz
     return new MegaSearchPagePrivate(startingOffset, size);
 }
 
+MegaSearchPage* MegaSearchPage::createInstanceAfter(MegaNode* lastNode, size_t size)
+{
+    return new MegaSearchPagePrivate(lastNode, size);
+}
+
 MegaSearchPage* MegaSearchPage::copy() const
 {
     return nullptr;
@@ -7082,6 +7329,11 @@ size_t MegaSearchPage::size() const
     return 0u;
 }
 
+MegaHandle MegaSearchPage::lastNodeHandle() const
+{
+    return INVALID_HANDLE;
+}
+
 MegaApiLock::MegaApiLock(MegaApiImpl* ptr, bool lock) : api(ptr)
 {
     if (lock)
@@ -7857,6 +8109,36 @@ MegaCancelToken::~MegaCancelToken()
 
 }
 
+MegaUploadBatch* MegaUploadBatch::createInstance()
+{
+    return new MegaUploadBatchPrivate();
+}
+
+MegaUploadBatch::MegaUploadBatch()
+{
+
+}
+
+MegaUploadBatch::~MegaUploadBatch()
+{
+
+}
+
+MegaDownloadBatch* MegaDownloadBatch::createInstance()
+{
+    return new MegaDownloadBatchPrivate();
+}
+
+MegaDownloadBatch::MegaDownloadBatch()
+{
+
+}
+
+MegaDownloadBatch::~MegaDownloadBatch()
+{
+
+}
+
 MegaIntegerList::~MegaIntegerList()
 {
 
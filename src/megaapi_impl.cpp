@@ -86,6 +86,16 @@ std::unique_ptr<GfxProc> createGfxProc(MegaGfxProcessor* processor)
     return provider ? std::make_unique<GfxProc>(std::move(provider)) : nullptr;
 }
 
+std::optional<std::string> optionalString(const char* value)
+{
+    return value ? std::optional<std::string>(value) : std::nullopt;
+}
+
+const char* optionalCString(const std::optional<std::string>& value)
+{
+    return value ? value->c_str() : nullptr;
+}
+
 }
 namespace mega {
 
@@ -268,6 +278,23 @@ MegaNodePrivate::MegaNodePrivate(Node *node)
     this->mFavourite = false;
     this->mLabel = LBL_UNKNOWN;
 
+    // ids of the attributes decoded below, computed once instead of for every attribute of every node
+    static const nameid ID_DURATION = AttrMap::string2nameid("d");
+    static const nameid ID_COORDINATES = AttrMap::string2nameid("l");
+    static const nameid ID_GPS = AttrMap::string2nameid("gp");
+    static const nameid ID_RESTORE = AttrMap::string2nameid("rr");
+    static const nameid ID_FINGERPRINT = AttrMap::string2nameid("c");
+    static const nameid ID_ORIGINAL_FINGERPRINT = AttrMap::string2nameid("c0");
+    static const nameid ID_FAVOURITE = AttrMap::string2nameid("fav");
+    static const nameid ID_SENSITIVE = AttrMap::string2nameid("sen");
+    static const nameid ID_LABEL = AttrMap::string2nameid("lbl");
+    static const nameid ID_DEVICE = AttrMap::string2nameid("dev-id");
+    static const nameid ID_DRIVE = AttrMap::string2nameid("drv-id");
+    static const nameid ID_S4 = AttrMap::string2nameid("s4");
+    static const nameid ID_PASSWORD_MANAGER = AttrMap::string2nameid(MegaClient::NODE_ATTR_PASSWORD_MANAGER);
+    static const nameid ID_DESCRIPTION = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_DESCRIPTION);
+    static const nameid ID_TAGS = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_TAGS);
+
     char buf[10];
     for (attr_map::iterator it = node->attrs.map.begin(); it != node->attrs.map.end(); it++)
     {
@@ -285,27 +312,27 @@ MegaNodePrivate::MegaNodePrivate(Node *node)
         }
         else
         {
-            if (it->first == AttrMap::string2nameid("d"))
+            if (it->first == ID_DURATION)
             {
                if (node->type == FILENODE)
                {
                    duration = int(Base64::atoi(&it->second));
                }
             }
-            else if (it->first == AttrMap::string2nameid("l") || it->first == AttrMap::string2nameid("gp"))
+            else if (it->first == ID_COORDINATES || it->first == ID_GPS)
             {
                 if (node->type == FILENODE)
                 {
                     string coords = it->second;
-                    if ((it->first == AttrMap::string2nameid("l") && coords.size() != 8) ||
-                        (it->first == AttrMap::string2nameid("gp") && coords.size() != Base64Str<16>::STRLEN))
+                    if ((it->first == ID_COORDINATES && coords.size() != 8) ||
+                        (it->first == ID_GPS && coords.size() != Base64Str<16>::STRLEN))
                     {
                        LOG_warn << "Malformed GPS coordinates attribute";
                     }
                     else
                     {
                         bool ok = true;
-                        if (it->first == AttrMap::string2nameid("gp"))
+                        if (it->first == ID_GPS)
                         {
                             if (node->client && node->client->unshareablekey.size() == Base64Str<SymmCipher::KEYLENGTH>::STRLEN && coords.size() == Base64Str<16>::STRLEN)
                             {
@@ -360,7 +387,7 @@ MegaNodePrivate::MegaNodePrivate(Node *node)
                     }
                }
             }
-            else if (it->first == AttrMap::string2nameid("rr"))
+            else if (it->first == ID_RESTORE)
             {
                 handle rr = 0;
                 if (Base64::atob(it->second.c_str(), (byte *)&rr, sizeof(rr)) == MegaClient::NODEHANDLE)
@@ -368,15 +395,15 @@ MegaNodePrivate::MegaNodePrivate(Node *node)
                     restorehandle = rr;
                 }
             }
-            else if (it->first == AttrMap::string2nameid("c") && !fingerprint)
+            else if (it->first == ID_FINGERPRINT && !fingerprint)
             {
                 fingerprint = MegaApi::strdup(it->second.c_str());
             }
-            else if (it->first == AttrMap::string2nameid("c0"))
+            else if (it->first == ID_ORIGINAL_FINGERPRINT)
             {
                 originalfingerprint = MegaApi::strdup(it->second.c_str());
             }
-            else if (it->first == AttrMap::string2nameid("fav"))
+            else if (it->first == ID_FAVOURITE)
             {
                 try
                 {
@@ -395,7 +422,7 @@ MegaNodePrivate::MegaNodePrivate(Node *node)
                     LOG_err << "Conversion failure for node attr fav: " << ex.what();
                 }
             }
-            else if (it->first == AttrMap::string2nameid("sen"))
+            else if (it->first == ID_SENSITIVE)
             {
                 try
                 {
@@ -414,7 +441,7 @@ MegaNodePrivate::MegaNodePrivate(Node *node)
                     LOG_err << "Conversion failure for node attr sen: " << ex.what();
                 }
             }
-            else if (it->first == AttrMap::string2nameid("lbl"))
+            else if (it->first == ID_LABEL)
             {
                 try
                 {
@@ -433,18 +460,18 @@ MegaNodePrivate::MegaNodePrivate(Node *node)
                     LOG_err << "Conversion failure for node attr lbl: " << ex.what();
                 }
             }
-            else if (it->first == AttrMap::string2nameid("dev-id") ||
-                     it->first == AttrMap::string2nameid("drv-id"))
+            else if (it->first == ID_DEVICE ||
+                     it->first == ID_DRIVE)
             {
                 mDeviceId = it->second;
             }
-            else if (it->first == AttrMap::string2nameid("s4"))
+            else if (it->first == ID_S4)
             {
                 mS4 = it->second;
             }
-            else if (it->first == AttrMap::string2nameid(MegaClient::NODE_ATTR_PASSWORD_MANAGER) ||
-                     it->first == AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_DESCRIPTION) ||
-                     it->first == AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_TAGS))
+            else if (it->first == ID_PASSWORD_MANAGER ||
+                     it->first == ID_DESCRIPTION ||
+                     it->first == ID_TAGS)
             {
                 if (!mOfficialAttrs) mOfficialAttrs = std::make_unique<attr_map>();
 
@@ -465,100 +492,107 @@ MegaNodePrivate::MegaNodePrivate(Node *node)
     this->fileattrstring = node->fileattrstring;
     this->nodekey = node->nodekeyUnchecked();
 
-    this->changed = 0;
-    if(node->changed.attrs)
+    this->changed = getChangesBitmask(*node);
+
+    this->thumbnailAvailable = (node->hasfileattribute(0) != 0);
+    this->previewAvailable = (node->hasfileattribute(1) != 0);
+    this->isPublicNode = false;
+    this->foreign = false;
+
+    // if there's only one share and it has no user --> public link
+    this->outShares = (node->outshares) ? (node->outshares->size() > 1 || node->outshares->begin()->second->user) : false;
+    this->inShare = node->inshare != nullptr;
+    this->plink = node->plink ? new PublicLink(*node->plink) : NULL;
+    this->mNewLinkFormat = node->client->mNewLinkFormat;
+    if (plink && type == FOLDERNODE && node->sharekey)
     {
-        this->changed |= MegaNode::CHANGE_TYPE_ATTRIBUTES;
+        char key[FOLDERNODEKEYLENGTH*4/3+3];
+        Base64::btoa(node->sharekey->key, FOLDERNODEKEYLENGTH, key);
+        this->sharekey = new string(key);
     }
-    if(node->changed.ctime)
+    else
     {
-        this->changed |= MegaNode::CHANGE_TYPE_TIMESTAMP;
+        this->sharekey = NULL;
     }
-    if(node->changed.fileattrstring)
+}
+
+uint64_t MegaNodePrivate::getChangesBitmask(const Node& node)
+{
+    uint64_t changes = 0;
+    if(node.changed.attrs)
     {
-        this->changed |= MegaNode::CHANGE_TYPE_FILE_ATTRIBUTES;
+        changes |= MegaNode::CHANGE_TYPE_ATTRIBUTES;
     }
-    if(node->changed.inshare)
+    if(node.changed.ctime)
     {
-        this->changed |= MegaNode::CHANGE_TYPE_INSHARE;
+        changes |= MegaNode::CHANGE_TYPE_TIMESTAMP;
     }
-    if(node->changed.outshares)
+    if(node.changed.fileattrstring)
     {
-        this->changed |= MegaNode::CHANGE_TYPE_OUTSHARE;
+        changes |= MegaNode::CHANGE_TYPE_FILE_ATTRIBUTES;
     }
-    if(node->changed.pendingshares)
+    if(node.changed.inshare)
     {
-        this->changed |= MegaNode::CHANGE_TYPE_PENDINGSHARE;
+        changes |= MegaNode::CHANGE_TYPE_INSHARE;
     }
-    if(node->changed.owner)
+    if(node.changed.outshares)
     {
-        this->changed |= MegaNode::CHANGE_TYPE_OWNER;
+        changes |= MegaNode::CHANGE_TYPE_OUTSHARE;
     }
-    if(node->changed.parent)
+    if(node.changed.pendingshares)
     {
-        this->changed |= MegaNode::CHANGE_TYPE_PARENT;
+        changes |= MegaNode::CHANGE_TYPE_PENDINGSHARE;
     }
-    if(node->changed.removed)
+    if(node.changed.owner)
     {
-        this->changed |= MegaNode::CHANGE_TYPE_REMOVED;
+        changes |= MegaNode::CHANGE_TYPE_OWNER;
     }
-    if(node->changed.publiclink)
+    if(node.changed.parent)
     {
-        this->changed |= MegaNode::CHANGE_TYPE_PUBLIC_LINK;
+        changes |= MegaNode::CHANGE_TYPE_PARENT;
     }
-    if(node->changed.newnode)
+    if(node.changed.removed)
     {
-        this->changed |= MegaNode::CHANGE_TYPE_NEW;
+        changes |= MegaNode::CHANGE_TYPE_REMOVED;
     }
-    if (node->changed.name)
+    if(node.changed.publiclink)
     {
-        this->changed |= MegaNode::CHANGE_TYPE_NAME;
+        changes |= MegaNode::CHANGE_TYPE_PUBLIC_LINK;
     }
-    if (node->changed.favourite)
+    if(node.changed.newnode)
     {
-        this->changed |= MegaNode::CHANGE_TYPE_FAVOURITE;
+        changes |= MegaNode::CHANGE_TYPE_NEW;
     }
-    if (node->changed.counter)
+    if (node.changed.name)
     {
-        this->changed |= MegaNode::CHANGE_TYPE_COUNTER;
+        changes |= MegaNode::CHANGE_TYPE_NAME;
     }
-    if (node->changed.sensitive)
+    if (node.changed.favourite)
     {
-        this->changed |= MegaNode::CHANGE_TYPE_SENSITIVE;
+        changes |= MegaNode::CHANGE_TYPE_FAVOURITE;
     }
-    if (node->changed.pwd)
+    if (node.changed.counter)
     {
-        this->changed |= MegaNode::CHANGE_TYPE_PWD;
+        changes |= MegaNode::CHANGE_TYPE_COUNTER;
     }
-    if (node->changed.description)
+    if (node.changed.sensitive)
     {
-        this->changed |= MegaNode::CHANGE_TYPE_DESCRIPTION;
+        changes |= MegaNode::CHANGE_TYPE_SENSITIVE;
     }
-    if (node->changed.tags)
+    if (node.changed.pwd)
     {
-        this->changed |= MegaNode::CHANGE_TYPE_TAGS;
+        changes |= MegaNode::CHANGE_TYPE_PWD;
     }
-
-    this->thumbnailAvailable = (node->hasfileattribute(0) != 0);
-    this->previewAvailable = (node->hasfileattribute(1) != 0);
-    this->isPublicNode = false;
-    this->foreign = false;
-
-    // if there's only one share and it has no user --> public link
-    this->outShares = (node->outshares) ? (node->outshares->size() > 1 || node->outshares->begin()->second->user) : false;
-    this->inShare = node->inshare != nullptr;
-    this->plink = node->plink ? new PublicLink(*node->plink) : NULL;
-    this->mNewLinkFormat = node->client->mNewLinkFormat;
-    if (plink && type == FOLDERNODE && node->sharekey)
+    if (node.changed.description)
     {
-        char key[FOLDERNODEKEYLENGTH*4/3+3];
-        Base64::btoa(node->sharekey->key, FOLDERNODEKEYLENGTH, key);
-        this->sharekey = new string(key);
+        changes |= MegaNode::CHANGE_TYPE_DESCRIPTION;
     }
-    else
+    if (node.changed.tags)
     {
-        this->sharekey = NULL;
+        changes |= MegaNode::CHANGE_TYPE_TAGS;
     }
+
+    return changes;
 }
 
 string* MegaNodePrivate::getSharekey()
@@ -1304,7 +1338,7 @@ char *MegaBackgroundMediaUploadPrivate::encryptFile(const char* inputFilepath, i
 
                     EncryptFilePieceByChunks ef(fain.get(), startPos, faout.get(), 0, &cipher, &chunkmacs, ctriv);
                     string urlSuffix;
-                    if (ef.encrypt(startPos, endPos, urlSuffix))
+                    if (ef.encryptInParallel(startPos, endPos, urlSuffix, filekey, api->client->mAsyncQueue))
                     {
                         ((int64_t*)filekey)[3] = chunkmacs.macsmac(&cipher);
                         return MegaApi::strdup(urlSuffix.c_str());
@@ -1353,6 +1387,66 @@ byte *EncryptFilePieceByChunks::nextbuffer(unsigned bufsize)
     return (byte*)buffer.data();
 }
 
+bool EncryptFilePieceByChunks::encryptInParallel(m_off_t pos, m_off_t npos, string& urlSuffix, const byte* filekey, MegaClientAsyncQueue& queue)
+{
+    std::mutex macsMutex;
+    vector<std::pair<m_off_t, m_off_t>> chunks;
+
+    for (m_off_t windowStart = pos; windowStart < npos; )
+    {
+        chunks.clear();
+        m_off_t windowEnd = windowStart;
+        while (windowEnd < npos && windowEnd - windowStart < ENCRYPTION_WINDOW)
+        {
+            m_off_t chunkEnd = ChunkedHash::chunkceil(windowEnd, npos);
+            chunks.emplace_back(windowEnd, chunkEnd);
+            windowEnd = chunkEnd;
+        }
+
+        // only the last chunk can be shorter than a block, and it's padded with zeroes
+        unsigned windowSize = unsigned(windowEnd - windowStart);
+        buffer.assign(windowSize + SymmCipher::BLOCKSIZE, '\0');
+        if (!fain->frawread((byte*)buffer.data(), windowSize, inpos, false, FSLogging::logOnError))
+        {
+            return false;
+        }
+        inpos += windowSize;
+
+        // each batch has its own cipher: the one of the queue isn't exclusive when it runs no threads
+        queue.runBatches(chunks.size(), 1, [this, &chunks, &macsMutex, windowStart, filekey](size_t begin, size_t end, SymmCipher&)
+        {
+            SymmCipher cipher;
+            cipher.setkey(filekey);
+            chunkmac_map chunkMacs;
+            for (size_t i = begin; i < end; i++)
+            {
+                byte* chunk = (byte*)buffer.data() + (chunks[i].first - windowStart);
+                chunkMacs.ctr_encrypt(chunks[i].first, &cipher, chunk, unsigned(chunks[i].second - chunks[i].first), chunks[i].first, ctriv, false);
+            }
+
+            std::lock_guard<std::mutex> g(macsMutex);
+            chunkMacs.copyEntriesTo(*macs);
+        });
+
+        LOG_debug << "Encrypted window: " << windowStart << " - " << windowEnd << "   Chunks: " << chunks.size();
+
+        updateCRC((byte*)buffer.data(), windowSize, unsigned(windowStart - pos));
+
+        if (!faout->fwrite((byte*)buffer.data(), windowSize, outpos))
+        {
+            return false;
+        }
+        outpos += windowSize;
+        windowStart = windowEnd;
+    }
+
+    ostringstream s;
+    s << "/" << pos << "?d=" << Base64Str<EncryptByChunks::CRCSIZE>(crc);
+    urlSuffix = s.str();
+
+    return true;
+}
+
 /* BEGIN MEGAAPIIMPL */
 
 #ifdef ENABLE_SYNC
@@ -2970,6 +3064,11 @@ char * MegaTransferPrivate::getLastBytes() const
     return lastBytes;
 }
 
+std::shared_ptr<const void> MegaTransferPrivate::getLastBytesOwner() const
+{
+    return lastBytesOwner;
+}
+
 MegaError MegaTransferPrivate::getLastError() const
 {
     return lastError ? *lastError.get() : MegaTransfer::getLastError();
@@ -3353,9 +3452,10 @@ void MegaTransferPrivate::setTotalBytes(long long totalBytes)
     this->totalBytes = totalBytes;
 }
 
-void MegaTransferPrivate::setLastBytes(char *lastBytes)
+void MegaTransferPrivate::setLastBytes(char *lastBytes, std::shared_ptr<const void> lastBytesOwner)
 {
     this->lastBytes = lastBytes;
+    this->lastBytesOwner = std::move(lastBytesOwner);
 }
 
 void MegaTransferPrivate::setLastError(const MegaError *e)
@@ -3887,6 +3987,7 @@ MegaRequestPrivate::MegaRequestPrivate(MegaRequestPrivate *request)
     this->mMegaBackupInfoList.reset(request->mMegaBackupInfoList ? request->mMegaBackupInfoList->copy() : nullptr);
     this->mMegaSet.reset(request->mMegaSet ? request->mMegaSet->copy() : nullptr);
     this->mMegaSetElementList.reset(request->mMegaSetElementList ? request->mMegaSetElementList->copy() : nullptr);
+    this->mMegaNodeList.reset(request->mMegaNodeList ? request->mMegaNodeList->copy() : nullptr);
     this->mMegaIntegerList.reset(request->mMegaIntegerList ? request->mMegaIntegerList->copy() : nullptr);
 #ifdef ENABLE_SYNC
     if (request->mSyncStallList)
@@ -4506,6 +4607,16 @@ void MegaRequestPrivate::setMegaSetElementList(std::unique_ptr<MegaSetElementLis
     mMegaSetElementList.swap(els);
 }
 
+MegaNodeList* MegaRequestPrivate::getMegaNodeList() const
+{
+    return mMegaNodeList.get();
+}
+
+void MegaRequestPrivate::setMegaNodeList(std::unique_ptr<MegaNodeList> nodes)
+{
+    mMegaNodeList.swap(nodes);
+}
+
 const MegaIntegerList* MegaRequestPrivate::getMegaIntegerList() const
 {
     return mMegaIntegerList.get();
@@ -4731,6 +4842,9 @@ const char *MegaRequestPrivate::getRequestString() const
         case TYPE_ENABLE_MOUNT:    return "TYPE_ENABLE_MOUNT";
         case TYPE_REMOVE_MOUNT:    return "TYPE_REMOVE_MOUNT";
         case TYPE_SET_MOUNT_FLAGS: return "TYPE_SET_MOUNT_FLAGS";
+        case TYPE_GET_THUMBNAILS: return "GET_THUMBNAILS";
+        case TYPE_SEARCH_NODES: return "SEARCH_NODES";
+        case TYPE_GET_USER_ATTRIBUTES: return "GET_USER_ATTRIBUTES";
     }
     return "UNKNOWN";
 }
@@ -6138,6 +6252,45 @@ int MegaSearchFilterPrivate::validateBoolFilterOption(const int value)
     }
 }
 
+MegaSearchPagePrivate::MegaSearchPagePrivate(MegaNode* lastNode, size_t size)
+    : mOffset(0)
+    , mSize(size)
+{
+    if (!lastNode)
+    {
+        LOG_warn << "Search page without last node, starting from the first result";
+        return;
+    }
+
+    // same values as the columns of the "nodes" table
+    NodeView cursor;
+    cursor.mHandle.set6byte(lastNode->getHandle());
+    cursor.mName = lastNode->getName() ? lastNode->getName() : "";
+    cursor.mType = static_cast<nodetype_t>(lastNode->getType());
+    cursor.mSize = lastNode->getSize();
+    cursor.mCtime = lastNode->getCreationTime();
+    cursor.mMtime = lastNode->getModificationTime();
+    cursor.mFav = lastNode->isFavourite();
+    cursor.mLabel = lastNode->getLabel();
+    mCursor = std::move(cursor);
+}
+
+NodeSearchPage MegaSearchPagePrivate::toNodeSearchPage(const MegaSearchPage* searchPage)
+{
+    if (!searchPage)
+    {
+        return NodeSearchPage(0u, 0u);
+    }
+
+    auto page = dynamic_cast<const MegaSearchPagePrivate*>(searchPage);
+    if (page && page->mCursor)
+    {
+        return NodeSearchPage(*page->mCursor, page->size());
+    }
+
+    return NodeSearchPage(searchPage->startingOffset(), searchPage->size());
+}
+
 std::unique_ptr<MegaGfxProviderPrivate> MegaGfxProviderPrivate::createIsolatedInstance(
     const std::string& endpointName,
     const std::string& executable)
@@ -6171,6 +6324,8 @@ void *MegaApiImpl::threadEntryPoint(void *param)
     ::sigaction(SIGPIPE, &noaction, 0);
 #endif
 
+    TRACE_THREAD_NAME("request");
+
     MegaApiImpl *megaApiImpl = (MegaApiImpl *)param;
     megaApiImpl->loop();
     return 0;
@@ -6199,6 +6354,9 @@ MegaApiImpl::MegaApiImpl(MegaApi *api, const char *appKey, MegaGfxProvider* prov
     init(api, appKey, std::move(gfxproc), basePath, userAgent, workerThreadCount, clientType);
 }
 
+static_assert(MegaApi::WORKER_THREADS_PER_CORE == MegaClientAsyncQueue::THREADS_PER_CORE,
+              "The worker thread count is passed to the MegaClient as is");
+
 void MegaApiImpl::init(MegaApi *api, const char *appKey, std::unique_ptr<GfxProc> gfxproc, const char *basePath, const char *userAgent, unsigned clientWorkerThreadCount, int clientType)
 {
     this->api = api;
@@ -6221,6 +6379,7 @@ void MegaApiImpl::init(MegaApi *api, const char *appKey, std::unique_ptr<GfxProc
     httpServer = NULL;
     httpServerMaxBufferSize = 0;
     httpServerMaxOutputSize = 0;
+    httpServerNumThreads = 1;
     httpServerEnableFiles = true;
     httpServerEnableFolders = false;
     httpServerOfflineAttributeEnabled = false;
@@ -6255,6 +6414,12 @@ void MegaApiImpl::init(MegaApi *api, const char *appKey, std::unique_ptr<GfxProc
     gfxAccess = gfxproc.release();
     if (gfxAccess)
     {
+        if (basePath)
+        {
+            LocalPath cacheFolder = LocalPath::fromAbsolutePath(basePath);
+            cacheFolder.appendWithSeparator(LocalPath::fromRelativePath("gfxcache"), false);
+            gfxAccess->setCache(std::make_unique<GfxCache>(cacheFolder));
+        }
         gfxAccess->startProcessingThread();
     }
 
@@ -6596,6 +6761,21 @@ void MegaApiImpl::log(int logLevel, const char *message, const char *filename, i
     SimpleLogger::postLog(LogLevel(logLevel), message, filename, line);
 }
 
+char* MegaApiImpl::getPerformanceSnapshot(bool reset)
+{
+    return MegaApi::strdup(Metrics::registry().snapshot(reset).c_str());
+}
+
+void MegaApiImpl::setTracingEnabled(bool enable)
+{
+    Tracer::setEnabled(enable);
+}
+
+char* MegaApiImpl::dumpTrace()
+{
+    return MegaApi::strdup(Tracer::dump(true).c_str());
+}
+
 void MegaApiImpl::setLoggingName(const char* loggingName)
 {
     SdkMutexGuard g(sdkMutex);
@@ -7305,6 +7485,7 @@ void MegaApiImpl::loop()
             }
             sendPendingRequests();
             sendPendingScRequest();
+            continuePagedSearches();
             if (threadExit)
             {
                 break;
@@ -7313,6 +7494,8 @@ void MegaApiImpl::loop()
             {
                 SdkMutexGuard g(sdkMutex);
                 client->exec();
+                flushBulkThumbnails();
+                fireOnTransfersUpdate();
             }
         }
     }
@@ -7672,6 +7855,113 @@ void MegaApiImpl::cancelGetThumbnail(MegaNode* node, MegaRequestListener *listen
     cancelGetNodeAttribute(node, GfxProc::THUMBNAIL, listener);
 }
 
+void MegaApiImpl::getThumbnails(MegaHandleList* nodeHandles, MegaRequestListener *listener)
+{
+    MegaRequestPrivate* request = new MegaRequestPrivate(MegaRequest::TYPE_GET_THUMBNAILS, listener);
+    if (nodeHandles)
+    {
+        request->setMegaHandleList(nodeHandles);
+    }
+    request->setParamType(GfxProc::THUMBNAIL);
+
+    request->performRequest = [this, request]()
+        {
+            const MegaHandleList* nodeHandles = request->getMegaHandleList();
+            if (!nodeHandles)
+            {
+                return API_EARGS;
+            }
+
+            set<handle> wanted;
+            for (unsigned i = 0; i < nodeHandles->size(); i++)
+            {
+                wanted.insert(nodeHandles->get(i));
+            }
+
+            // the thumbnails of previous calls not in this one are off-screen: stop fetching them,
+            // unless getThumbnail is waiting for them too
+            set<handle> singleRequests;
+            for (auto& r : requestMap)
+            {
+                if (r.second && r.second->getType() == MegaRequest::TYPE_GET_ATTR_FILE && r.second->getParamType() == GfxProc::THUMBNAIL)
+                {
+                    singleRequests.insert(r.second->getNodeHandle());
+                }
+            }
+
+            for (auto it = mPendingBulkThumbnails.begin(); it != mPendingBulkThumbnails.end(); )
+            {
+                if (wanted.count(it->first))
+                {
+                    it++;
+                    continue;
+                }
+
+                if (!singleRequests.count(it->first))
+                {
+                    client->getfa(it->first, &it->second.fileattrstring, string(), GfxProc::THUMBNAIL, 1);
+                }
+
+                for (int tag : it->second.tags)
+                {
+                    auto bulk = mBulkThumbnailsRequests.find(tag);
+                    if (bulk != mBulkThumbnailsRequests.end())
+                    {
+                        bulk->second.pending.erase(it->first);
+                        bulk->second.incomplete = true;
+                    }
+                }
+                it = mPendingBulkThumbnails.erase(it);
+            }
+
+            BulkThumbnailsRequest& bulk = mBulkThumbnailsRequests[request->getTag()];
+            bulk.request = request;
+            bulk.batch.reset(MegaStringMap::createInstance());
+
+            // in the order of the list, the visible ones first
+            for (unsigned i = 0; i < nodeHandles->size(); i++)
+            {
+                handle h = nodeHandles->get(i);
+                std::shared_ptr<Node> node = client->nodebyhandle(h);
+                if (!node || !node->hasfileattribute(GfxProc::THUMBNAIL) || bulk.pending.count(h))
+                {
+                    continue;
+                }
+
+                if (const string* data = mThumbnailCache.get(h, GfxProc::THUMBNAIL, node->fileattrstring))
+                {
+                    bulk.batch->set(Base64Str<MegaClient::NODEHANDLE>(h), Base64::btoa(*data).c_str());
+                    continue;
+                }
+
+                PendingBulkThumbnail& pending = mPendingBulkThumbnails[h];
+                if (pending.tags.empty())
+                {
+                    // fetched without a tag, so a getThumbnail request of the same node can take it over
+                    pending.fileattrstring = node->fileattrstring;
+                    int reqtag = client->reqtag;
+                    client->reqtag = 0;
+                    error e = client->getfa(h, &pending.fileattrstring, node->nodekey(), GfxProc::THUMBNAIL);
+                    client->reqtag = reqtag;
+
+                    if (e != API_OK && e != API_EEXIST)
+                    {
+                        mPendingBulkThumbnails.erase(h);
+                        continue;
+                    }
+                }
+                pending.tags.insert(request->getTag());
+                bulk.pending.insert(h);
+            }
+
+            // the thumbnails are delivered in batches by flushBulkThumbnails()
+            return API_OK;
+        };
+
+    requestQueue.push(request);
+    waiter->notify();
+}
+
 void MegaApiImpl::setThumbnail(MegaNode* node, const char *srcFilePath, MegaRequestListener *listener)
 {
     setNodeAttribute(node, GfxProc::THUMBNAIL, srcFilePath, INVALID_HANDLE, listener);
@@ -7851,6 +8141,84 @@ void MegaApiImpl::getUserAttribute(const char* email_or_handle, int type, MegaRe
     getUserAttr(email_or_handle, type ? type : -1, NULL, 0, listener);
 }
 
+void MegaApiImpl::getUserAttributes(MegaHandleList* users, int type, MegaRequestListener *listener)
+{
+    MegaRequestPrivate* request = new MegaRequestPrivate(MegaRequest::TYPE_GET_USER_ATTRIBUTES, listener);
+    if (users)
+    {
+        request->setMegaHandleList(users);
+    }
+    request->setParamType(type);
+
+    request->performRequest = [this, request]()
+        {
+            const MegaHandleList* users = request->getMegaHandleList();
+            attr_t type = static_cast<attr_t>(request->getParamType());
+            char scope = MegaApiImpl::userAttributeToScope(type);
+            if (!users || !client->loggedin() || type == ATTR_AVATAR || (scope != '+' && scope != '0'))
+            {
+                return API_EARGS;
+            }
+
+            // the values cached are taken in place, and the commands for the rest are sent in the same batch
+            struct Batch
+            {
+                unique_ptr<MegaStringMap> values{MegaStringMap::createInstance()};
+                unsigned pending = 1;
+                bool failed = false;
+            };
+            auto batch = std::make_shared<Batch>();
+
+            auto completed = [this, request, batch]()
+            {
+                if (!--batch->pending)
+                {
+                    request->setMegaStringMap(batch->values.get());
+                    fireOnRequestFinish(request, std::make_unique<MegaErrorPrivate>(batch->failed ? API_EINCOMPLETE : API_OK));
+                }
+            };
+
+            for (unsigned i = 0; i < users->size(); i++)
+            {
+                handle uh = users->get(i);
+                Base64Str<MegaClient::USERHANDLE> uid(uh);
+                ++batch->pending;
+
+                CommandGetUA::CompletionErr completionErr = [batch, completed](error e)
+                {
+                    batch->failed |= e != API_ENOENT;
+                    completed();
+                };
+
+                CommandGetUA::CompletionBytes completionBytes = [batch, completed, uid](byte* data, unsigned len, attr_t)
+                {
+                    batch->values->set(uid, Base64::btoa(string(reinterpret_cast<char*>(data), len)).c_str());
+                    completed();
+                };
+
+                CommandGetUA::CompletionTLV completionTLV = [completed](TLVstore*, attr_t)
+                {
+                    completed();
+                };
+
+                if (User* user = client->finduser(uh, 0))
+                {
+                    client->getua(user, type, -1, completionErr, completionBytes, completionTLV);
+                }
+                else
+                {
+                    client->getua(uid, type, nullptr, -1, completionErr, completionBytes, completionTLV);
+                }
+            }
+
+            completed();
+            return API_OK;
+        };
+
+    requestQueue.push(request);
+    waiter->notify();
+}
+
 void MegaApiImpl::getChatUserAttribute(const char *email_or_handle, int type, const char *ph, MegaRequestListener *listener)
 {
     getChatUserAttr(email_or_handle, type ? type : -1, NULL, ph, 0, listener);
@@ -8088,6 +8456,68 @@ void MegaApiImpl::setNodeSensitive(MegaNode* node, bool sensitive, MegaRequestLi
     waiter->notify();
 }
 
+static vector<handle> nodeListToHandles(MegaNodeList* nodes)
+{
+    vector<handle> handles;
+    handles.reserve(static_cast<size_t>(nodes->size()));
+    for (int i = 0; i < nodes->size(); i++)
+    {
+        handles.push_back(nodes->get(i)->getHandle());
+    }
+    return handles;
+}
+
+void MegaApiImpl::setNodesLabel(MegaNodeList* nodes, int label, MegaRequestListener* listener)
+{
+    MegaRequestPrivate* request = new MegaRequestPrivate(MegaRequest::TYPE_SET_ATTR_NODE, listener);
+    if (nodes) request->setMegaHandleList(nodeListToHandles(nodes));
+    request->setParamType(MegaApi::NODE_ATTR_LABEL);
+    request->setNumDetails(label);
+    request->setFlag(true);     // is official attribute or not
+
+    request->performRequest = [this, request]()
+    {
+        return performRequest_setAttrNodes(request);
+    };
+
+    requestQueue.push(request);
+    waiter->notify();
+}
+
+void MegaApiImpl::setNodesFavourite(MegaNodeList* nodes, bool fav, MegaRequestListener* listener)
+{
+    MegaRequestPrivate* request = new MegaRequestPrivate(MegaRequest::TYPE_SET_ATTR_NODE, listener);
+    if (nodes) request->setMegaHandleList(nodeListToHandles(nodes));
+    request->setParamType(MegaApi::NODE_ATTR_FAV);
+    request->setNumDetails(fav);
+    request->setFlag(true);     // is official attribute or not
+
+    request->performRequest = [this, request]()
+    {
+        return performRequest_setAttrNodes(request);
+    };
+
+    requestQueue.push(request);
+    waiter->notify();
+}
+
+void MegaApiImpl::setNodesSensitive(MegaNodeList* nodes, bool sensitive, MegaRequestListener* listener)
+{
+    MegaRequestPrivate* request = new MegaRequestPrivate(MegaRequest::TYPE_SET_ATTR_NODE, listener);
+    if (nodes) request->setMegaHandleList(nodeListToHandles(nodes));
+    request->setParamType(MegaApi::NODE_ATTR_SEN);
+    request->setNumDetails(sensitive);
+    request->setFlag(true);     // is official attribute or not
+
+    request->performRequest = [this, request]()
+    {
+        return performRequest_setAttrNodes(request);
+    };
+
+    requestQueue.push(request);
+    waiter->notify();
+}
+
 bool MegaApiImpl::isSensitiveInherited(MegaNode* mnode)
 {
     // there is no MegaNode::getParentNode() so the traversal must be here in MegaApi
@@ -8171,6 +8601,22 @@ void MegaApiImpl::addNodeTag(MegaNode* node, const char* tag, MegaRequestListene
     CRUDNodeTagOperation(node, MegaApi::TAG_NODE_SET, tag, nullptr, listener);
 }
 
+void MegaApiImpl::addNodesTag(MegaNodeList* nodes, const char* tag, MegaRequestListener* listener)
+{
+    MegaRequestPrivate* request = new MegaRequestPrivate(MegaRequest::TYPE_TAG_NODE, listener);
+    if (nodes) request->setMegaHandleList(nodeListToHandles(nodes));
+    request->setParamType(MegaApi::TAG_NODE_SET);
+    request->setText(tag);
+
+    request->performRequest = [this, request]()
+    {
+        return performRequest_tagNodes(request);
+    };
+
+    requestQueue.push(request);
+    waiter->notify();
+}
+
 void MegaApiImpl::removeNodeTag(MegaNode* node, const char* tag, MegaRequestListener* listener)
 {
     CRUDNodeTagOperation(node, MegaApi::TAG_NODE_REMOVE, tag, nullptr, listener);
@@ -8687,6 +9133,11 @@ void MegaApiImpl::abortPendingActions(error preverror)
     backupsMap.clear();
 
     // -- CS Requests in progress --
+    mBulkThumbnailsRequests.clear();
+    mPendingBulkThumbnails.clear();
+    mThumbnailCache.clear();
+    mPagedSearches.clear();
+
     deque<MegaRequestPrivate*> requests;
     for (auto requestPair : requestMap)
     {
@@ -8953,6 +9404,17 @@ int MegaApiImpl::getMaxUploadSpeed()
     return int(client->getmaxuploadspeed());
 }
 
+bool MegaApiImpl::setHttp2Enabled(bool enable)
+{
+    SdkMutexGuard g(sdkMutex);
+    return client->sethttp2(enable);
+}
+
+bool MegaApiImpl::isHttp2Enabled()
+{
+    return client->gethttp2();
+}
+
 int MegaApiImpl::getCurrentDownloadSpeed()
 {
     return int(httpio->downloadSpeed);
@@ -9353,23 +9815,98 @@ MegaTransferPrivate* MegaApiImpl::createUploadTransfer(bool startFirst, const ch
 void MegaApiImpl::startUpload(bool startFirst, const char* localPath, MegaNode* parent, const char* fileName, const char* targetUser, int64_t mtime, int folderTransferTag, bool isBackup, const char* appData, bool isSourceFileTemporary, bool forceNewUpload, FileSystemType fsType, CancelToken cancelToken, MegaTransferListener* listener)
 {
     MegaTransferPrivate* transfer = createUploadTransfer(startFirst, localPath, parent, fileName, targetUser, mtime, folderTransferTag, isBackup, appData, isSourceFileTemporary, forceNewUpload, fsType, cancelToken, listener);
-    transferQueue.push(transfer);
-    waiter->notify();
+    if (transferQueue.push(transfer))
+    {
+        waiter->notify();
+    }
 }
 
 void MegaApiImpl::startUploadForSupport(const char* localPath, bool isSourceFileTemporary, FileSystemType fsType, MegaTransferListener* listener)
 {
     MegaTransferPrivate* transfer = createUploadTransfer(true, localPath, nullptr, nullptr, MegaClient::SUPPORT_USER_HANDLE.c_str(), MegaApi::INVALID_CUSTOM_MOD_TIME, 0, false, nullptr, isSourceFileTemporary, false, fsType, CancelToken(), listener);
-    transferQueue.push(transfer);
-    waiter->notify();
+    if (transferQueue.push(transfer))
+    {
+        waiter->notify();
+    }
 }
 
 void MegaApiImpl::startDownload (bool startFirst, MegaNode *node, const char* localPath, const char *customName, int folderTransferTag, const char *appData, CancelToken cancelToken, int collisionCheck, int collisionResolution, bool undelete, MegaTransferListener *listener)
 {
     FileSystemType fsType = fsAccess->getlocalfstype(LocalPath::fromAbsolutePath(localPath));
     MegaTransferPrivate *transfer = createDownloadTransfer(startFirst, node, localPath, customName, folderTransferTag, appData, cancelToken, collisionCheck, collisionResolution, undelete, listener, fsType);
-    transferQueue.push(transfer);
-    waiter->notify();
+    if (transferQueue.push(transfer))
+    {
+        waiter->notify();
+    }
+}
+
+void MegaApiImpl::startUploads(MegaUploadBatch* batch, MegaTransferListener* listener)
+{
+    if (!batch)
+    {
+        return;
+    }
+
+    vector<MegaTransferPrivate*> transfers;
+    for (const auto& u : static_cast<MegaUploadBatchPrivate*>(batch)->uploads())
+    {
+        transfers.push_back(createUploadTransfer(u.startFirst, optionalCString(u.localPath), u.parent.get(), optionalCString(u.fileName),
+                                                 nullptr /*targetUser*/, u.mtime, 0 /*folderTransferTag*/, false /*isBackup*/,
+                                                 optionalCString(u.appData), u.isSourceTemporary, false /*forceNewUpload*/,
+                                                 FS_UNKNOWN, u.cancelToken, listener));
+    }
+    pushTransferBatch(transfers);
+}
+
+void MegaApiImpl::startDownloads(MegaDownloadBatch* batch, MegaTransferListener* listener)
+{
+    if (!batch)
+    {
+        return;
+    }
+
+    // downloads of a batch usually share the destination, and getting its type may be expensive
+    map<string, FileSystemType> fsTypes;
+
+    vector<MegaTransferPrivate*> transfers;
+    for (const auto& d : static_cast<MegaDownloadBatchPrivate*>(batch)->downloads())
+    {
+        FileSystemType fsType = FS_UNKNOWN;
+        if (d.localPath)
+        {
+            auto it = fsTypes.find(*d.localPath);
+            if (it == fsTypes.end())
+            {
+                it = fsTypes.emplace(*d.localPath, fsAccess->getlocalfstype(LocalPath::fromAbsolutePath(*d.localPath))).first;
+            }
+            fsType = it->second;
+        }
+
+        transfers.push_back(createDownloadTransfer(d.startFirst, d.node.get(), optionalCString(d.localPath), optionalCString(d.customName),
+                                                   0 /*folderTransferTag*/, optionalCString(d.appData), d.cancelToken,
+                                                   d.collisionCheck, d.collisionResolution, d.undelete, listener, fsType));
+    }
+    pushTransferBatch(transfers);
+}
+
+void MegaApiImpl::pushTransferBatch(const vector<MegaTransferPrivate*>& transfers)
+{
+    if (transfers.empty())
+    {
+        return;
+    }
+
+    auto batch = std::make_shared<TransferBatch>();
+    batch->queued = transfers.size();
+    for (MegaTransferPrivate* transfer : transfers)
+    {
+        transfer->setBatch(batch);
+    }
+
+    if (transferQueue.push(transfers))
+    {
+        waiter->notify();
+    }
 }
 
 MegaTransferPrivate* MegaApiImpl::createDownloadTransfer(bool startFirst, MegaNode *node, const char* localPath, const char *customName, int folderTransferTag, const char *appData, CancelToken cancelToken, int collisionCheck, int collisionResolution, bool undelete, MegaTransferListener *listener, FileSystemType fsType)
@@ -9478,8 +10015,10 @@ void MegaApiImpl::startStreaming(MegaNode* node, m_off_t startPos, m_off_t size,
     transfer->setStartPos(startPos);
     transfer->setEndPos(startPos + size - 1);
     transfer->setMaxRetries(maxRetries);
-    transferQueue.push(transfer);
-    waiter->notify();
+    if (transferQueue.push(transfer))
+    {
+        waiter->notify();
+    }
 }
 
 void MegaApiImpl::setStreamingMinimumRate(int bytesPerSecond)
@@ -9538,6 +10077,14 @@ int MegaApiImpl::syncPathState(string* platformEncoded)
 
     if (containingSyncId == UNDEF) return MegaApi::STATE_IGNORED;
 
+    // The states already reported are published by the sync thread for lookups with no locking
+    treestate_t published;
+    if (client->syncs.mSyncPathStates.lookup(localpath, published))
+    {
+        mRecentlyRequestedOverlayIconPaths.addOrUpdate(localpath, published);
+        return published;
+    }
+
     // Avoid blocking on the mutex for a long time, as we may be blocking windows explorer (or another platform's equivalent) from opening or displaying a window, unrelated to sync folders
     // We try to lock the SDK mutex.  If we can't get it in 10ms then we return a simple default, and subsequent requests try to lock the mutex but don't wait.
     std::unique_lock<std::timed_mutex> g(client->syncs.mLocalNodeChangeMutex, std::defer_lock);
@@ -10215,6 +10762,7 @@ bool MegaApiImpl::httpServerStart(bool localOnly, int port, bool useTLS, const c
     httpServer = new MegaHTTPServer(this, basePath, useTLS, certificatepath ? certificatepath : string(), keypath ? keypath : string(), useIPv6);
     httpServer->setMaxBufferSize(httpServerMaxBufferSize);
     httpServer->setMaxOutputSize(httpServerMaxOutputSize);
+    httpServer->setNumThreads(httpServerNumThreads);
     httpServer->enableFileServer(httpServerEnableFiles);
     httpServer->enableOfflineAttribute(httpServerOfflineAttributeEnabled);
     httpServer->enableFolderServer(httpServerEnableFolders);
@@ -10405,6 +10953,18 @@ int MegaApiImpl::httpServerGetMaxOutputSize()
     }
 }
 
+void MegaApiImpl::httpServerSetNumThreads(int numThreads)
+{
+    SdkMutexGuard g(sdkMutex);
+    httpServerNumThreads = numThreads <= 0 ? 1 : numThreads;
+}
+
+int MegaApiImpl::httpServerGetNumThreads()
+{
+    SdkMutexGuard g(sdkMutex);
+    return httpServerNumThreads;
+}
+
 void MegaApiImpl::httpServerEnableFileServer(bool enable)
 {
     SdkMutexGuard g(sdkMutex);
@@ -11278,6 +11838,33 @@ MegaUserAlertList* MegaApiImpl::getUserAlerts()
     return new MegaUserAlertListPrivate(v.data(), int(v.size()), client);
 }
 
+MegaUserAlertList* MegaApiImpl::getUserAlerts(int offset, int size)
+{
+    SdkMutexGuard g(sdkMutex);
+
+    vector<UserAlert::Base*> v;
+    if (offset >= 0 && size > 0)
+    {
+        v.reserve(std::min(static_cast<size_t>(size), client->useralerts.alerts.size()));
+        int position = 0;
+        for (auto it = client->useralerts.alerts.begin(); it != client->useralerts.alerts.end() && int(v.size()) < size; ++it)
+        {
+            if (!(*it)->removed() && position++ >= offset)
+            {
+                v.push_back(*it);
+            }
+        }
+    }
+    return new MegaUserAlertListPrivate(v.data(), int(v.size()), client);
+}
+
+int MegaApiImpl::getNumUserAlerts()
+{
+    SdkMutexGuard g(sdkMutex);
+    return static_cast<int>(std::count_if(client->useralerts.alerts.begin(), client->useralerts.alerts.end(),
+                                          [](const UserAlert::Base* a) { return !a->removed(); }));
+}
+
 int MegaApiImpl::getNumUnreadUserAlerts()
 {
     int result = 0;
@@ -11903,6 +12490,19 @@ void MegaApiImpl::setPSA(int id, MegaRequestListener *listener)
     setUserAttr(MegaApi::USER_ATTR_LAST_PSA, value.c_str(), listener);
 }
 
+void MegaApiImpl::setTransferUpdateInterval(int milliseconds)
+{
+    SdkMutexGuard g(sdkMutex);
+    mTransferUpdateInterval = std::max<dstime>(1, static_cast<dstime>((std::max(milliseconds, 0) + 99) / 100));
+}
+
+void MegaApiImpl::setTransferUpdatesBatched(bool enable)
+{
+    SdkMutexGuard g(sdkMutex);
+    mTransferUpdatesBatched = enable;
+    mLastTransfersUpdate = Waiter::ds;
+}
+
 void MegaApiImpl::disableGfxFeatures(bool disable)
 {
     client->gfxdisabled = disable;
@@ -12336,27 +12936,128 @@ MegaNodeList* MegaApiImpl::search(const MegaSearchFilter* filter, int order, Can
 
     sharedNode_vector searchResults;
 
-    // search
+    // search: the NodeManager has its own lock (like getChildren() with a filter), so sdkMutex
+    // isn't taken and searches run concurrently with the SDK thread and among them
+    switch (filter->byLocation())
+    {
+    case MegaApi::SEARCH_TARGET_ALL:
+    case MegaApi::SEARCH_TARGET_ROOTNODE: // Search on Cloud root and Vault, excluding Rubbish
+    case MegaApi::SEARCH_TARGET_INSHARE:
+    case MegaApi::SEARCH_TARGET_OUTSHARE:
+    case MegaApi::SEARCH_TARGET_PUBLICLINK:
+        searchResults = searchInNodeManager(filter, order, cancelToken, searchPage);
+        break;
+    default:
+        LOG_err << "Search not implemented for Location " << filter->byLocation();
+    }
+
+    MegaNodeListPrivate* nodeList = new MegaNodeListPrivate(searchResults);
+
+    return nodeList;
+}
+
+void MegaApiImpl::searchNodes(const MegaSearchFilter* filter, int order, size_t pageSize, CancelToken cancelToken, MegaRequestListener* listener)
+{
+    MegaRequestPrivate* request = new MegaRequestPrivate(MegaRequest::TYPE_SEARCH_NODES, listener);
+    request->setParamType(order);
+    request->setTotalBytes(static_cast<long long>(pageSize));
+
+    shared_ptr<MegaSearchFilter> searchFilter(filter ? filter->copy() : nullptr);
+    request->performRequest = [this, request, searchFilter, cancelToken]()
+        {
+            if (!searchFilter || !request->getTotalBytes())
+            {
+                return API_EARGS;
+            }
+
+            // the pages are retrieved by continuePagedSearches(), after the requests of this iteration
+            PagedSearch& search = mPagedSearches[request->getTag()];
+            search.request = request;
+            search.filter = searchFilter;
+            search.cancelToken = cancelToken;
+            return API_OK;
+        };
+
+    requestQueue.push(request);
+    waiter->notify();
+}
+
+void MegaApiImpl::continuePagedSearches()
+{
+    if (mPagedSearches.empty())
+    {
+        return;
+    }
+
+    vector<int> tags;
+    for (auto& s : mPagedSearches)
+    {
+        tags.push_back(s.first);
+    }
+
+    for (int tag : tags)
     {
+        shared_ptr<MegaSearchFilter> filter;
+        CancelToken cancelToken;
+        unique_ptr<MegaSearchPage> page;
+        int order;
+        size_t pageSize;
+        {
+            SdkMutexGuard g(sdkMutex);
+            auto it = mPagedSearches.find(tag);
+            if (it == mPagedSearches.end())
+            {
+                continue;
+            }
+
+            PagedSearch& search = it->second;
+            filter = search.filter;
+            cancelToken = search.cancelToken;
+            order = search.request->getParamType();
+            pageSize = static_cast<size_t>(search.request->getTotalBytes());
+            page.reset(search.lastNode ? new MegaSearchPagePrivate(search.lastNode.get(), pageSize)
+                                       : new MegaSearchPagePrivate(size_t(0), pageSize));
+        }
+
+        // the look-up doesn't need sdkMutex, and the NodeManager only locks itself to turn this page into nodes
+        unique_ptr<MegaNodeList> nodes(cancelToken.isCancelled() ? new MegaNodeListPrivate()
+                                                                 : search(filter.get(), order, cancelToken, page.get()));
+        bool cancelled = cancelToken.isCancelled();
+        bool last = cancelled || static_cast<size_t>(nodes->size()) < pageSize;
+
         SdkMutexGuard g(sdkMutex);
+        auto it = mPagedSearches.find(tag);
+        if (it == mPagedSearches.end())
+        {
+            continue;
+        }
 
-        switch (filter->byLocation())
+        PagedSearch& search = it->second;
+        MegaRequestPrivate* request = search.request;
+        if (nodes->size())
         {
-        case MegaApi::SEARCH_TARGET_ALL:
-        case MegaApi::SEARCH_TARGET_ROOTNODE: // Search on Cloud root and Vault, excluding Rubbish
-        case MegaApi::SEARCH_TARGET_INSHARE:
-        case MegaApi::SEARCH_TARGET_OUTSHARE:
-        case MegaApi::SEARCH_TARGET_PUBLICLINK:
-            searchResults = searchInNodeManager(filter, order, cancelToken, searchPage);
-            break;
-        default:
-            LOG_err << "Search not implemented for Location " << filter->byLocation();
+            search.lastNode.reset(nodes->get(nodes->size() - 1)->copy());
+            search.found += nodes->size();
         }
-    } // end scope for mutex guard
+        request->setNumber(search.found);
+        request->setMegaNodeList(std::move(nodes));
 
-    MegaNodeListPrivate* nodeList = new MegaNodeListPrivate(searchResults);
+        if (last)
+        {
+            mPagedSearches.erase(it);
+            fireOnRequestFinish(request, std::make_unique<MegaErrorPrivate>(cancelled ? API_EINCOMPLETE : API_OK));
+        }
+        else
+        {
+            fireOnRequestUpdate(request);
+        }
+    }
 
-    return nodeList;
+    if (!mPagedSearches.empty())
+    {
+        // next pages in the next iteration
+        waiter->notify();
+    }
 }
 
 sharedNode_vector MegaApiImpl::searchInNodeManager(const MegaSearchFilter* filter, int order, CancelToken cancelToken, const MegaSearchPage* searchPage)
@@ -12383,7 +13084,7 @@ sharedNode_vector MegaApiImpl::searchInNodeManager(const MegaSearchFilter* filte
         nf.setIncludedShares(IN_SHARES);
     }
 
-    const NodeSearchPage& np = searchPage ? NodeSearchPage(searchPage->startingOffset(), searchPage->size()) : NodeSearchPage(0, 0);
+    const NodeSearchPage np = MegaSearchPagePrivate::toNodeSearchPage(searchPage);
     sharedNode_vector results = client->mNodeManager.searchNodes(nf, order, cancelToken, np);
     return results;
 }
@@ -12974,14 +13675,14 @@ void MegaApiImpl::transfer_update(Transfer *t)
         }
 
         if (it == t->files.begin()
-                && transfer->getUpdateTime() == Waiter::ds
+                && Waiter::ds - transfer->getUpdateTime() < mTransferUpdateInterval
                 && transfer->getState() == t->state
                 && transfer->getPriority() == t->priority
                 && (!t->slot
                     || (t->slot->progressreported
                         && t->slot->progressreported != t->size)))
         {
-            // don't send more than one callback per decisecond
+            // don't send more than one callback per interval (a decisecond by default)
             // if the state doesn't change, the priority doesn't change
             // and there isn't anything new or it's not the first
             // nor the last callback
@@ -13094,7 +13795,7 @@ dstime MegaApiImpl::pread_failure(const Error &e, int retry, void* param, dstime
     }
 }
 
-bool MegaApiImpl::pread_data(byte *buffer, m_off_t len, m_off_t, m_off_t speed, m_off_t meanSpeed, void* param)
+bool MegaApiImpl::pread_data(byte *buffer, m_off_t len, m_off_t, m_off_t speed, m_off_t meanSpeed, void* param, std::shared_ptr<const void> owner)
 {
     MegaTransferPrivate *transfer = (MegaTransferPrivate *)param;
     LOG_verbose << "Read new data received from transfer: len = " << len << ", speed = " << (speed/1024) << " KB/s, meanSpeed = " << (meanSpeed/1024) << " KB/s, total transferred bytes = " << transfer->getTransferredBytes() << "";
@@ -13103,14 +13804,19 @@ bool MegaApiImpl::pread_data(byte *buffer, m_off_t len, m_off_t, m_off_t speed,
     transfer->setState(MegaTransfer::STATE_ACTIVE);
     transfer->setUpdateTime(currentTime);
     transfer->setDeltaSize(len);
-    transfer->setLastBytes((char *)buffer);
+    transfer->setLastBytes((char *)buffer, std::move(owner));
     transfer->setTransferredBytes(transfer->getTransferredBytes() + len);
     transfer->setSpeed(speed);
     transfer->setMeanSpeed(meanSpeed);
 
     bool end = (transfer->getTransferredBytes() == transfer->getTotalBytes());
     fireOnTransferUpdate(transfer);
-    if (!fireOnTransferData(transfer) || end)
+    bool keepReading = fireOnTransferData(transfer);
+
+    // listeners interested in the data have taken their own reference already
+    transfer->setLastBytes((char *)buffer);
+
+    if (!keepReading || end)
     {
         LOG_debug << "[MegaApiImpl::pread_data] Finish. Transfer: " << param << ", end = " << end << " [this = " << this << "]";
         transfer->setState(end ? MegaTransfer::STATE_COMPLETED : MegaTransfer::STATE_CANCELLED);
@@ -14439,8 +15145,13 @@ void MegaApiImpl::updatepcr_result(error e, ipcactions_t action)
     fireOnRequestFinish(request, std::make_unique<MegaErrorPrivate>(e));
 }
 
-void MegaApiImpl::fa_complete(handle, fatype, const char* data, uint32_t len)
+void MegaApiImpl::fa_complete(handle h, fatype type, const char* data, uint32_t len)
 {
+    if (type == GfxProc::THUMBNAIL)
+    {
+        bulkThumbnailReceived(h, data, len);
+    }
+
     int tag = client->restag;
     while(tag)
     {
@@ -14464,8 +15175,13 @@ void MegaApiImpl::fa_complete(handle, fatype, const char* data, uint32_t len)
     }
 }
 
-int MegaApiImpl::fa_failed(handle, fatype, int retries, error e)
+int MegaApiImpl::fa_failed(handle h, fatype type, int retries, error e)
 {
+    if (type == GfxProc::THUMBNAIL && retries >= 2)
+    {
+        bulkThumbnailFailed(h);
+    }
+
     int tag = client->restag;
     while(tag)
     {
@@ -14488,6 +15204,81 @@ int MegaApiImpl::fa_failed(handle, fatype, int retries, error e)
     return (retries >= 2);
 }
 
+void MegaApiImpl::bulkThumbnailReceived(handle h, const char* data, uint32_t len)
+{
+    auto it = mPendingBulkThumbnails.find(h);
+    if (it == mPendingBulkThumbnails.end())
+    {
+        return;
+    }
+
+    string thumbnail(data, len);
+    string encoded = Base64::btoa(thumbnail);
+    for (int tag : it->second.tags)
+    {
+        auto bulk = mBulkThumbnailsRequests.find(tag);
+        if (bulk != mBulkThumbnailsRequests.end())
+        {
+            bulk->second.pending.erase(h);
+            bulk->second.batch->set(Base64Str<MegaClient::NODEHANDLE>(h), encoded.c_str());
+        }
+    }
+
+    mThumbnailCache.put(h, GfxProc::THUMBNAIL, it->second.fileattrstring, std::move(thumbnail));
+    mPendingBulkThumbnails.erase(it);
+}
+
+void MegaApiImpl::bulkThumbnailFailed(handle h)
+{
+    auto it = mPendingBulkThumbnails.find(h);
+    if (it == mPendingBulkThumbnails.end())
+    {
+        return;
+    }
+
+    for (int tag : it->second.tags)
+    {
+        auto bulk = mBulkThumbnailsRequests.find(tag);
+        if (bulk != mBulkThumbnailsRequests.end())
+        {
+            bulk->second.pending.erase(h);
+            bulk->second.incomplete = true;
+        }
+    }
+    mPendingBulkThumbnails.erase(it);
+}
+
+void MegaApiImpl::flushBulkThumbnails()
+{
+    for (auto it = mBulkThumbnailsRequests.begin(); it != mBulkThumbnailsRequests.end(); )
+    {
+        BulkThumbnailsRequest& bulk = it->second;
+        if (!bulk.batch->size() && !bulk.pending.empty())
+        {
+            it++;
+            continue;
+        }
+
+        // one callback for all the thumbnails received by this iteration
+        MegaRequestPrivate* request = bulk.request;
+        request->setMegaStringMap(bulk.batch.get());
+        request->setNumber(static_cast<long long>(bulk.pending.size()));
+        bulk.batch.reset(MegaStringMap::createInstance());
+
+        if (bulk.pending.empty())
+        {
+            error e = bulk.incomplete ? API_EINCOMPLETE : API_OK;
+            it = mBulkThumbnailsRequests.erase(it);
+            fireOnRequestFinish(request, std::make_unique<MegaErrorPrivate>(e));
+        }
+        else
+        {
+            fireOnRequestUpdate(request);
+            it++;
+        }
+    }
+}
+
 void MegaApiImpl::putfa_result(handle h, fatype, error e)
 {
     if(requestMap.find(client->restag) == requestMap.end()) return;
@@ -15338,6 +16129,31 @@ void MegaApiImpl::nodes_updated(sharedNode_vector* nodes, int count)
         return;
     }
 
+    if (mNodeChanges.enabled())
+    {
+        bool notify = false;
+        if (nodes)
+        {
+            std::vector<NodeChangeBuffer::Change> changes;
+            changes.reserve(nodes->size());
+            for (auto& node : *nodes)
+            {
+                changes.push_back({node->nodehandle, node->parent ? node->parent->nodehandle : UNDEF, MegaNodePrivate::getChangesBitmask(*node)});
+            }
+            notify = mNodeChanges.push(changes);
+        }
+        else
+        {
+            notify = mNodeChanges.setIncomplete();
+        }
+
+        if (notify)
+        {
+            fireOnNodeChangesAvailable();
+        }
+        return;
+    }
+
     MegaNodeList *nodeList = NULL;
     if (nodes != NULL)
     {
@@ -15938,6 +16754,12 @@ void MegaApiImpl::nodes_current()
     fireOnEvent(event);
 }
 
+void MegaApiImpl::deferred_cache_loaded()
+{
+    MegaEventPrivate *event = new MegaEventPrivate(MegaEvent::EVENT_DEFERRED_CACHE_LOADED);
+    fireOnEvent(event);
+}
+
 void MegaApiImpl::catchup_result()
 {
     // sc requests are sent sequentially, it must be the one at front and already started (tag == 1)
@@ -16511,6 +17333,18 @@ void MegaApiImpl::addGlobalListener(MegaGlobalListener* listener)
     globalListeners.insert(listener);
 }
 
+void MegaApiImpl::setNodeChangesBufferSize(unsigned int size)
+{
+    mNodeChanges.setCapacity(size);
+}
+
+MegaNodeChangeList* MegaApiImpl::popNodeChanges(unsigned int maxCount)
+{
+    bool incomplete = false;
+    auto changes = mNodeChanges.pop(maxCount, incomplete);
+    return new MegaNodeChangeListPrivate(std::move(changes), incomplete);
+}
+
 bool MegaApiImpl::removeListener(MegaListener* listener)
 {
     if(!listener) return false;
@@ -16721,6 +17555,13 @@ void MegaApiImpl::fireOnTransferStart(MegaTransferPrivate *transfer)
     notificationNumber++;
     transfer->setNotificationNumber(notificationNumber);
 
+    if (mStartingBatch && transfer->getBatch().get() == mStartingBatch)
+    {
+        // reported together with the rest of the batch by fireOnTransfersStart()
+        mStartingBatch->started.push_back(transfer);
+        return;
+    }
+
     for(set<MegaTransferListener *>::iterator it = transferListeners.begin(); it != transferListeners.end() ;)
     {
         (*it++)->onTransferStart(api, transfer);
@@ -16738,9 +17579,54 @@ void MegaApiImpl::fireOnTransferStart(MegaTransferPrivate *transfer)
     }
 }
 
+void MegaApiImpl::fireOnTransfersStart(TransferBatch& batch)
+{
+    assert(threadId == std::this_thread::get_id());
+    if (batch.started.empty())
+    {
+        return;
+    }
+
+    vector<MegaTransfer*> transfers(batch.started.begin(), batch.started.end());
+    batch.started.clear();
+
+    MegaTransferListPrivate transferList(transfers.data(), static_cast<int>(transfers.size()));
+    for(set<MegaTransferListener *>::iterator it = transferListeners.begin(); it != transferListeners.end() ;)
+    {
+        (*it++)->onTransfersStart(api, &transferList);
+    }
+
+    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+    {
+        (*it++)->onTransfersStart(api, &transferList);
+    }
+
+    // all the transfers of a batch have the same listener
+    MegaTransferListener* listener = static_cast<MegaTransferPrivate*>(transfers.front())->getListener();
+    if(listener)
+    {
+        listener->onTransfersStart(api, &transferList);
+    }
+}
+
 void MegaApiImpl::fireOnTransferFinish(MegaTransferPrivate *transfer, unique_ptr<MegaErrorPrivate> e)
 {
     assert(threadId == std::this_thread::get_id());
+    if (mStartingBatch && transfer->getBatch().get() == mStartingBatch)
+    {
+        // it finishes before the start of its batch is reported
+        auto& started = mStartingBatch->started;
+        auto it = std::find(started.begin(), started.end(), transfer);
+        if (it != started.end())
+        {
+            started.erase(it);
+            TransferBatch single;
+            single.started.push_back(transfer);
+            fireOnTransfersStart(single);
+        }
+    }
+
+    mBatchedTransferUpdates.erase(transfer->getTag());
     notificationNumber++;
     transfer->setNotificationNumber(notificationNumber);
     transfer->setLastError(e.get());
@@ -16845,6 +17731,58 @@ void MegaApiImpl::fireOnTransferUpdate(MegaTransferPrivate *transfer)
     }
 }
 
+void MegaApiImpl::fireOnTransferProgress(MegaTransferPrivate *transfer)
+{
+    if (!mTransferUpdatesBatched)
+    {
+        fireOnTransferUpdate(transfer);
+        return;
+    }
+
+    assert(threadId == std::this_thread::get_id());
+    notificationNumber++;
+    transfer->setNotificationNumber(notificationNumber);
+
+    // the global listeners get the latest progress with the next batch
+    mBatchedTransferUpdates.insert(transfer->getTag());
+
+    MegaTransferListener* listener = transfer->getListener();
+    if(listener)
+    {
+        listener->onTransferUpdate(api, transfer);
+    }
+}
+
+void MegaApiImpl::fireOnTransfersUpdate()
+{
+    if (mBatchedTransferUpdates.empty() || Waiter::ds - mLastTransfersUpdate < mTransferUpdateInterval)
+    {
+        return;
+    }
+    mLastTransfersUpdate = Waiter::ds;
+
+    vector<MegaTransfer*> transfers;
+    for (int tag : mBatchedTransferUpdates)
+    {
+        if (MegaTransferPrivate* transfer = getMegaTransferPrivate(tag))
+        {
+            transfers.push_back(transfer);
+        }
+    }
+    mBatchedTransferUpdates.clear();
+
+    MegaTransferListPrivate transferList(transfers.data(), static_cast<int>(transfers.size()));
+    for(set<MegaTransferListener *>::iterator it = transferListeners.begin(); it != transferListeners.end() ;)
+    {
+        (*it++)->onTransfersUpdate(api, &transferList);
+    }
+
+    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+    {
+        (*it++)->onTransfersUpdate(api, &transferList);
+    }
+}
+
 void MegaApiImpl::fireOnFolderTransferUpdate(MegaTransferPrivate *transfer, int stage, uint32_t foldercount, uint32_t createdfoldercount, uint32_t filecount, const LocalPath* currentFolder, const LocalPath* currentFileLeafname)
 {
     // this occurs on worker thread for scanning stage (for uploads) and create tree (for downloads), and on SDK thread for the rest of calls
@@ -16937,6 +17875,20 @@ void MegaApiImpl::fireOnNodesUpdate(MegaNodeList *nodes)
     }
 }
 
+void MegaApiImpl::fireOnNodeChangesAvailable()
+{
+    assert(threadId == std::this_thread::get_id());
+
+    for(set<MegaGlobalListener *>::iterator it = globalListeners.begin(); it != globalListeners.end() ;)
+    {
+        (*it++)->onNodeChangesAvailable(api);
+    }
+    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+    {
+        (*it++)->onNodeChangesAvailable(api);
+    }
+}
+
 void MegaApiImpl::fireOnAccountUpdate()
 {
     assert(threadId == std::this_thread::get_id());
@@ -17222,7 +18174,7 @@ void MegaApiImpl::processTransferUpdate(Transfer *tr, MegaTransferPrivate *trans
     transfer->setState(tr->state);
     transfer->setPriority(tr->priority);
     transfer->setUpdateTime(currentTime);
-    fireOnTransferUpdate(transfer);
+    fireOnTransferProgress(transfer);
 }
 
 void MegaApiImpl::processTransferComplete(Transfer *tr, MegaTransferPrivate *transfer)
@@ -17962,8 +18914,12 @@ MegaNodeList *MegaApiImpl::getChildren(const MegaSearchFilter* filter, int order
 
     NodeSearchFilter nf;
     nf.copyFrom(*filter);
-    const NodeSearchPage& np = searchPage ? NodeSearchPage(searchPage->startingOffset(), searchPage->size()) : NodeSearchPage(0u, 0u);
+    const NodeSearchPage np = MegaSearchPagePrivate::toNodeSearchPage(searchPage);
     sharedNode_vector results = client->mNodeManager.getChildren(nf, order, cancelToken, np);
+    if (!cancelToken.isCancelled())
+    {
+        client->mNodeManager.prefetchChildren(results);
+    }
 
     return new MegaNodeListPrivate(results);
 }
@@ -17990,6 +18946,10 @@ MegaNodeList *MegaApiImpl::getChildren(const MegaNode* p, int order, CancelToken
         }
 
         sortByComparatorFunction(childrenNodes, order, *client);
+        if (!cancelToken.isCancelled())
+        {
+            client->mNodeManager.prefetchChildren(childrenNodes);
+        }
     }
 
     return new MegaNodeListPrivate(childrenNodes);
@@ -18034,31 +18994,7 @@ MegaNodeList *MegaApiImpl::getVersions(MegaNode *node)
     }
 
     SdkMutexGuard g(sdkMutex);
-    std::shared_ptr<Node> current = client->nodebyhandle(node->getHandle());
-    if (!current || current->type != FILENODE)
-    {
-        return new MegaNodeListPrivate();
-    }
-
-    vector<std::shared_ptr<Node> > versions;
-    versions.push_back(current);
-    bool lookingFor = true;
-    while (lookingFor)
-    {
-        sharedNode_list nodeList = client->getChildren(current.get());
-        if (nodeList.empty())
-        {
-            lookingFor = false;
-        }
-        else
-        {
-            assert(nodeList.back()->parent == current);
-            current = nodeList.back();
-            assert(current->type == FILENODE);
-            versions.push_back(current);
-        }
-    }
-
+    sharedNode_vector versions = client->mNodeManager.getVersions(NodeHandle().set6byte(node->getHandle()));
     return new MegaNodeListPrivate(versions);
 }
 
@@ -18486,8 +19422,27 @@ unsigned MegaApiImpl::sendPendingTransfers(TransferQueue *queue, MegaRecursiveOp
     // passed to the SDK.
     bool canSplit = !queue;
 
+    // the transfers of a batch are processed in one shot too, and their starts are reported together
+    shared_ptr<TransferBatch> startingBatch;
+    TransferBatch* previousStartingBatch = mStartingBatch;
+
     while (MegaTransferPrivate *transfer = auxQueue.pop())
     {
+        if (transfer->getBatch() != startingBatch)
+        {
+            if (startingBatch)
+            {
+                fireOnTransfersStart(*startingBatch);
+            }
+            startingBatch = transfer->getBatch();
+            mStartingBatch = startingBatch.get();
+        }
+
+        if (startingBatch)
+        {
+            startingBatch->queued--;
+        }
+
         error e = API_OK;
         int nextTag = client->nextreqtag();
         transfer->setState(MegaTransfer::STATE_QUEUED);
@@ -18644,7 +19599,6 @@ unsigned MegaApiImpl::sendPendingTransfers(TransferQueue *queue, MegaRecursiveOp
                             TreeProcCopy tc;
                             client->proctree(samenode, &tc, false, true);
                             tc.allocnodes();
-                            client->proctree(samenode, &tc, false, true);
                             tc.nn[0].parenthandle = UNDEF;
 
                             SymmCipher key;
@@ -19022,11 +19976,18 @@ unsigned MegaApiImpl::sendPendingTransfers(TransferQueue *queue, MegaRecursiveOp
             fireOnTransferFinish(transfer, std::make_unique<MegaErrorPrivate>(e));
         }
 
-        if (canSplit && (++count > 100 || std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count() > 100))
+        if (canSplit && (++count > 100 || std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count() > 100)
+                && !(startingBatch && startingBatch->queued))
         {
             break;
         }
     }
+
+    if (startingBatch)
+    {
+        fireOnTransfersStart(*startingBatch);
+    }
+    mStartingBatch = previousStartingBatch;
     return count;
 }
 
@@ -19584,6 +20545,33 @@ error MegaApiImpl::performRequest_tagNode(MegaRequestPrivate* request)
     return API_EARGS;
 }
 
+error MegaApiImpl::performRequest_tagNodes(MegaRequestPrivate* request)
+{
+    if (!request->getText() || request->getParamType() != MegaApi::TAG_NODE_SET)
+    {
+        return API_EARGS;
+    }
+
+    std::string tag = request->getText();
+
+    if (tag.find(MegaClient::TAG_DELIMITER) != std::string::npos)
+    {
+        return API_EARGS;
+    }
+
+    return setAttrOnNodes(request, [this, &tag](std::shared_ptr<Node> node, CommandSetAttr::Completion& completion)
+    {
+        error e = client->addTagToNode(node, tag, CommandSetAttr::Completion(completion));
+        if (e == API_EEXIST)
+        {
+            // already tagged, nothing to do for this one
+            completion(node->nodeHandle(), API_OK);
+            return API_OK;
+        }
+        return e;
+    });
+}
+
 void MegaApiImpl::CRUDNodeTagOperation(MegaNode* node,
                                        int operationType,
                                        const char* tag,
@@ -19849,13 +20837,10 @@ void MegaApiImpl::moveNode(MegaNode* node, MegaNode* newParent, const char* newN
                     }
                 }
 
-                // determine number of nodes to be copied
+                // build new nodes array
                 client->proctree(node, &tc, !ovhandle.isUndef());
                 tc.allocnodes();
                 nc = tc.nc;
-
-                // build new nodes array
-                client->proctree(node, &tc, !ovhandle.isUndef());
                 if (!nc)
                 {
                     e = API_EARGS;
@@ -20088,13 +21073,10 @@ error MegaApiImpl::copyTreeFromOwnedNode(shared_ptr<Node> node, const char* newN
         fileAlreadyExisted = node->isvalid && ovn->isvalid && node->EqualExceptValidFlag(*ovn);
     }
 
-    // determine number of nodes to be copied
+    // build new nodes array
     TreeProcCopy tc;
     client->proctree(node, &tc, false, !ovhandle.isUndef());
     tc.allocnodes();
-
-    // build new nodes array
-    client->proctree(node, &tc, false, !ovhandle.isUndef());
     if (tc.nn.empty())
     {
         LOG_err << "Failed to copy owned node: Failed to find nodes";
@@ -20484,6 +21466,25 @@ void MegaApiImpl::fetchNodes(MegaRequestListener* listener)
     waiter->notify();
 }
 
+void MegaApiImpl::setFastResume(bool enable)
+{
+    SdkMutexGuard g(sdkMutex);
+    client->fastResume = enable;
+}
+
+void MegaApiImpl::setLowMemoryMode(bool enable, long long transferMemoryBudget)
+{
+    SdkMutexGuard g(sdkMutex);
+    client->lowMemoryMode = enable;
+    client->transferBufferBudget.setLimit(enable ? std::max<m_off_t>(transferMemoryBudget, 0) : 0);
+}
+
+void MegaApiImpl::setFolderLinkFetchRoot(MegaHandle folder)
+{
+    SdkMutexGuard g(sdkMutex);
+    client->mFolderLink.mFetchRoot = NodeHandle().set6byte(folder);
+}
+
 void MegaApiImpl::getCloudStorageUsed(MegaRequestListener* listener)
 {
     MegaRequestPrivate* request = new MegaRequestPrivate(MegaRequest::TYPE_GET_CLOUD_STORAGE_USED, listener);
@@ -21135,6 +22136,155 @@ error MegaApiImpl::performRequest_setAttrFile(MegaRequestPrivate* request)
             return API_OK;
 }
 
+// updates of the label, favourite and sensitive attributes, 'value' as in MegaRequest::getNumDetails
+static error flagAttributeUpdates(int type, int value, attr_map& attrUpdates)
+{
+    bool remove = false;
+    nameid nid = 0;
+    if (type == MegaApi::NODE_ATTR_LABEL)
+    {
+        if (value < LBL_UNKNOWN || value > LBL_GREY)
+        {
+            return API_EARGS;
+        }
+
+        nid = AttrMap::string2nameid("lbl");
+        remove = (value == LBL_UNKNOWN);
+    }
+    else if (type == MegaApi::NODE_ATTR_SEN)
+    {
+        nid = AttrMap::string2nameid("sen");
+        remove = !value;
+        value = 1;
+    }
+    else if (type == MegaApi::NODE_ATTR_FAV)
+    {
+        nid = AttrMap::string2nameid("fav");
+        remove = !value;
+        value = 1;
+    }
+    else
+    {
+        return API_EARGS;
+    }
+
+    if (remove)
+    {
+        attrUpdates[nid] = "";
+    }
+    else
+    {
+        attrUpdates[nid] = std::to_string(value);
+    }
+
+    return API_OK;
+}
+
+void MegaApiImpl::setAttrOnVersions(std::shared_ptr<Node> node, const attr_map& attrUpdates)
+{
+    // update file versions if any
+    if (node->type == FILENODE)
+    {
+        sharedNode_list childrens = client->getChildren(node.get());
+        while (childrens.size())
+        {
+            assert(childrens.size() == 1);  // versions are 1-child chains
+            std::shared_ptr<Node> n = *childrens.begin();
+            client->setattr(n, attr_map(attrUpdates), nullptr, false); // no callback for these
+            childrens = client->getChildren(n.get());
+        }
+    }
+}
+
+error MegaApiImpl::setAttrOnNodes(MegaRequestPrivate* request,
+                                  std::function<error(std::shared_ptr<Node>, CommandSetAttr::Completion&)> setNodeAttr)
+{
+    const MegaHandleList* handles = request->getMegaHandleList();
+    if (!handles || !handles->size())
+    {
+        return API_EARGS;
+    }
+
+    sharedNode_vector nodes;
+    nodes.reserve(handles->size());
+    for (unsigned i = 0; i < handles->size(); i++)
+    {
+        std::shared_ptr<Node> node = client->nodebyhandle(handles->get(i));
+        if (!node)
+        {
+            return API_ENOENT;
+        }
+
+        if (!client->checkaccess(node.get(), FULL))
+        {
+            return API_EACCESS;
+        }
+
+        nodes.push_back(std::move(node));
+    }
+
+    // All the commands are queued now, so they go to the API in the same batch (and their action packets
+    // are applied to the local cache together). The request finishes once all of them have completed,
+    // with the first error if any. The extra count keeps it from finishing while they are being queued.
+    struct Progress
+    {
+        size_t pending = 1;
+        error result = API_OK;
+    };
+    auto progress = std::make_shared<Progress>();
+
+    CommandSetAttr::Completion completion = [this, request, progress](NodeHandle, Error e)
+    {
+        if (e != API_OK && progress->result == API_OK)
+        {
+            progress->result = e;
+        }
+
+        if (!--progress->pending)
+        {
+            fireOnRequestFinish(request, std::make_unique<MegaErrorPrivate>(progress->result));
+        }
+    };
+
+    for (auto& node : nodes)
+    {
+        progress->pending++;
+        error e = setNodeAttr(node, completion);
+        if (e != API_OK)
+        {
+            completion(node->nodeHandle(), e);
+        }
+    }
+
+    if (!--progress->pending)
+    {
+        // nothing was sent
+        if (progress->result != API_OK)
+        {
+            return progress->result;
+        }
+        fireOnRequestFinish(request, std::make_unique<MegaErrorPrivate>(API_OK));
+    }
+
+    return API_OK;
+}
+
+error MegaApiImpl::performRequest_setAttrNodes(MegaRequestPrivate* request)
+{
+    attr_map attrUpdates;
+    error e = flagAttributeUpdates(request->getParamType(), request->getNumDetails(), attrUpdates);
+    if (e != API_OK)
+    {
+        return e;
+    }
+
+    return setAttrOnNodes(request, [this, &attrUpdates](std::shared_ptr<Node> node, CommandSetAttr::Completion& completion)
+    {
+        setAttrOnVersions(node, attrUpdates);
+        return client->setattr(node, attr_map(attrUpdates), CommandSetAttr::Completion(completion), false);
+    });
+}
+
 error MegaApiImpl::performRequest_setAttrNode(MegaRequestPrivate* request)
 {
             std::shared_ptr<Node> node = client->nodebyhandle(request->getNodeHandle());
@@ -21209,57 +22359,15 @@ error MegaApiImpl::performRequest_setAttrNode(MegaRequestPrivate* request)
                 }
                 else if (type == MegaApi::NODE_ATTR_LABEL || type == MegaApi::NODE_ATTR_FAV || type == MegaApi::NODE_ATTR_SEN)
                 {
-                    std::shared_ptr<Node> current = node;
-                    bool remove = false;
-                    nameid nid = 0;
-                    int value = 0;
-                    if (type == MegaApi::NODE_ATTR_LABEL)
-                    {
-                        value = request->getNumDetails();
-                        if (value < LBL_UNKNOWN || value > LBL_GREY)
-                        {
-                            return API_EARGS;
-                        }
-
-                        nid = AttrMap::string2nameid("lbl");
-                        remove = (value == LBL_UNKNOWN);
-                    }
-                    else if (type == MegaApi::NODE_ATTR_SEN)
-                    {
-                        nid = AttrMap::string2nameid("sen");
-                        remove = !request->getNumDetails();
-                        value = 1;
-                    }
-                    else
-                    {
-                        nid = AttrMap::string2nameid("fav");
-                        remove = !request->getNumDetails();
-                        value = 1;
-                    }
-
-                    if (remove)
-                    {
-                        attrUpdates[nid] = "";
-                    }
-                    else
+                    e = flagAttributeUpdates(type, request->getNumDetails(), attrUpdates);
+                    if (e != API_OK)
                     {
-                        attrUpdates[nid] = std::to_string(value);
+                        return e;
                     }
 
-                    // update file versions if any
-                    if (current->type == FILENODE)
-                    {
-                        sharedNode_list childrens = client->getChildren(current.get());
-                        while (childrens.size())
-                        {
-                            assert(childrens.size() == 1);  // versions are 1-child chains
-                            std::shared_ptr<Node> n = *childrens.begin();
-                            client->setattr(n, attr_map(attrUpdates), nullptr, false); // no callback for these
-                            childrens = client->getChildren(n.get());
-                        }
-                    }
+                    setAttrOnVersions(node, attrUpdates);
 
-                    return client->setattr(current, std::move(attrUpdates),
+                    return client->setattr(node, std::move(attrUpdates),
                         [request, this](NodeHandle h, Error e)
                         {
                             request->setNodeHandle(h.as8byte());
@@ -21447,6 +22555,11 @@ void MegaApiImpl::cancelGetNodeAttribute(MegaNode* node, int type, MegaRequestLi
                         fireOnRequestFinish(r, std::make_unique<MegaErrorPrivate>(API_EINCOMPLETE));
                     }
                 }
+
+                if (type == GfxProc::THUMBNAIL)
+                {
+                    bulkThumbnailFailed(h);
+                }
                 fireOnRequestFinish(request, std::make_unique<MegaErrorPrivate>(e));
             }
             return e;
@@ -25463,6 +26576,84 @@ unsigned long long MegaApiImpl::getNumNodesAtCacheLRU() const
     return client->mNodeManager.getNumNodesAtCacheLRU();
 }
 
+void MegaApiImpl::setLRUCachePolicy(int policy)
+{
+    if (policy != MegaApi::LRU_CACHE_POLICY_LRU && policy != MegaApi::LRU_CACHE_POLICY_CLOCK)
+    {
+        LOG_err << "Invalid policy for LRU cache: " << policy;
+        return;
+    }
+
+    client->mNodeManager.setCacheLRUPolicy(static_cast<NodeManager::CacheLRUPolicy>(policy));
+}
+
+unsigned long long MegaApiImpl::getLRUCacheHits() const
+{
+    return client->mNodeManager.getCacheLRUHits();
+}
+
+unsigned long long MegaApiImpl::getLRUCacheMisses() const
+{
+    return client->mNodeManager.getCacheLRUMisses();
+}
+
+void MegaApiImpl::setChildrenPrefetch(unsigned int folders)
+{
+    client->mNodeManager.setChildrenPrefetch(folders);
+}
+
+void MegaApiImpl::setDatabasePerformanceProfile(int profile)
+{
+    DbPerformanceProfile dbProfile;
+    if (!DbPerformanceProfile::fromPreset(profile, dbProfile))
+    {
+        LOG_err << "Invalid DB performance profile: " << profile;
+        return;
+    }
+
+    if (client->dbaccess)
+    {
+        client->dbaccess->setPerformanceProfile(dbProfile);
+    }
+}
+
+void MegaApiImpl::setDatabasePerformanceParameters(long long mmapSize, long long cacheSizeKB, int pageSize, int synchronous)
+{
+    if ((pageSize && (pageSize < 512 || pageSize > 65536 || (pageSize & (pageSize - 1)))) ||
+        synchronous < DbPerformanceProfile::SYNC_DEFAULT || synchronous > DbPerformanceProfile::SYNC_FULL)
+    {
+        LOG_err << "Invalid DB performance parameters. Page size: " << pageSize << " synchronous: " << synchronous;
+        return;
+    }
+
+    DbPerformanceProfile dbProfile;
+    dbProfile.mMmapSize = mmapSize;
+    dbProfile.mCacheSizeKB = cacheSizeKB;
+    dbProfile.mPageSize = pageSize;
+    dbProfile.mSynchronous = synchronous;
+
+    if (client->dbaccess)
+    {
+        client->dbaccess->setPerformanceProfile(dbProfile);
+    }
+}
+
+MegaStringMap* MegaApiImpl::benchmarkDatabase(int repetitions)
+{
+    MegaStringMap* results = new MegaStringMapPrivate();
+    if (repetitions <= 0)
+    {
+        return results;
+    }
+
+    for (auto& result : client->mNodeManager.benchmarkDbQueries(static_cast<unsigned>(repetitions)))
+    {
+        results->set(result.first.c_str(), std::to_string(result.second.count()).c_str());
+    }
+
+    return results;
+}
+
 long long MegaApiImpl::getTotalDownloadedBytes()
 {
     return totalDownloadedBytes;
@@ -26234,6 +27425,37 @@ MegaSetElementList* MegaApiImpl::getSetElements(MegaHandle sid, bool includeElem
     return eList;
 }
 
+MegaSetElementList* MegaApiImpl::getSetElements(MegaHandle sid, int offset, int size, bool includeElementsInRubbishBin)
+{
+    SdkMutexGuard g(sdkMutex);
+
+    auto* elements = client->getSetElements(sid);
+    if (!elements || offset < 0 || size < 0)
+    {
+        return nullptr;
+    }
+
+    vector<const SetElement*> v;
+    v.reserve(elements->size());
+    for (const auto& e : *elements)
+    {
+        if (includeElementsInRubbishBin || !nodeInRubbishCheck(e.second.node()))
+        {
+            v.push_back(&e.second);
+        }
+    }
+
+    // only the Elements up to the end of the page need to be sorted
+    size_t first = std::min(static_cast<size_t>(offset), v.size());
+    size_t last = std::min(first + static_cast<size_t>(size), v.size());
+    std::partial_sort(v.begin(), v.begin() + static_cast<ptrdiff_t>(last), v.end(), [](const SetElement* a, const SetElement* b)
+    {
+        return a->order() != b->order() ? a->order() < b->order() : a->id() < b->id();
+    });
+
+    return new MegaSetElementListPrivate(v.data() + first, static_cast<int>(last - first));
+}
+
 MegaSetElement* MegaApiImpl::getSetElement(MegaHandle sid, MegaHandle eid)
 {
     SdkMutexGuard g(sdkMutex);
@@ -27263,8 +28485,10 @@ MegaFlagPrivate* MegaApiImpl::getFlag(const char* flagName, bool commit, MegaReq
 
 /* END MEGAAPIIMPL */
 
-int TransferQueue::getLastPushedTag() const
+int TransferQueue::getLastPushedTag()
 {
+    std::lock_guard<std::mutex> g(mutex);
+    drainInbox();
     return lastPushedTransferTag;
 }
 
@@ -27272,40 +28496,57 @@ TransferQueue::TransferQueue()
 {
 }
 
-void TransferQueue::push(MegaTransferPrivate *transfer)
+void TransferQueue::drainInbox()
 {
-    std::lock_guard<std::mutex> g(mutex);
-    transfers.push_back(transfer);
-    transfer->setPlaceInQueue(++lastPushedTransferTag);
+    inbox.drain([this](MegaTransferPrivate* transfer)
+    {
+        transfers.push_back(transfer);
+        transfer->setPlaceInQueue(++lastPushedTransferTag);
+    });
+}
+
+bool TransferQueue::push(MegaTransferPrivate *transfer)
+{
+    return inbox.push(transfer);
+}
+
+bool TransferQueue::push(const vector<MegaTransferPrivate *>& transfers)
+{
+    return inbox.push(transfers.begin(), transfers.end());
 }
 
 void TransferQueue::push_front(MegaTransferPrivate *transfer)
 {
     std::lock_guard<std::mutex> g(mutex);
+    drainInbox();
     transfers.push_front(transfer);
 }
 
 bool TransferQueue::empty()
 {
     std::lock_guard<std::mutex> g(mutex);
+    drainInbox();
     return transfers.empty();
 }
 
 size_t TransferQueue::size()
 {
     std::lock_guard<std::mutex> g(mutex);
+    drainInbox();
     return transfers.size();
 }
 
 void TransferQueue::clear()
 {
     std::lock_guard<std::mutex> g(mutex);
+    drainInbox();
     return transfers.clear();
 }
 
 MegaTransferPrivate *TransferQueue::pop()
 {
     std::lock_guard<std::mutex> g(mutex);
+    drainInbox();
     if(transfers.empty())
     {
         return NULL;
@@ -27318,6 +28559,7 @@ MegaTransferPrivate *TransferQueue::pop()
 std::vector<MegaTransferPrivate *> TransferQueue::popUpTo(int lastQueuedTransfer, int direction)
 {
     std::lock_guard<std::mutex> g(mutex);
+    drainInbox();
     std::vector<MegaTransferPrivate*> toret;
     for (auto it = transfers.begin(); it != transfers.end();)
     {
@@ -27348,6 +28590,7 @@ void TransferQueue::removeWithFolderTag(int folderTag, std::function<void(MegaTr
     // However the callback (including its calls to fireOnXYZ() ) must be careful not to lock any mutex which
     // may have been locked during other MegaApi function calls.
     std::lock_guard<std::mutex> g(mutex);
+    drainInbox();
 
     for (auto it = transfers.begin(); it != transfers.end();)
     {
@@ -27369,6 +28612,7 @@ void TransferQueue::removeWithFolderTag(int folderTag, std::function<void(MegaTr
 void TransferQueue::removeListener(MegaTransferListener *listener)
 {
     std::lock_guard<std::mutex> g(mutex);
+    drainInbox();
 
     std::deque<MegaTransferPrivate *>::iterator it = transfers.begin();
     while(it != transfers.end())
@@ -27383,6 +28627,7 @@ void TransferQueue::removeListener(MegaTransferListener *listener)
 void TransferQueue::setAllCancelled(CancelToken cancelled, int direction)
 {
     std::lock_guard<std::mutex> g(mutex);
+    drainInbox();
     for (auto& t : transfers)
     {
         if (t->getType() == direction
@@ -27398,30 +28643,35 @@ RequestQueue::RequestQueue()
 {
 }
 
-void RequestQueue::push(MegaRequestPrivate *request)
+void RequestQueue::drainInbox()
 {
-    std::lock_guard<std::mutex> g(mutex);
-    requests.push_back(request);
+    inbox.drain([this](MegaRequestPrivate* request)
+    {
+        requests.push_back(request);
+    });
 }
 
-void RequestQueue::push(std::unique_ptr<MegaRequestPrivate> request)
+bool RequestQueue::push(MegaRequestPrivate *request)
 {
-    std::lock_guard<std::mutex> guard(mutex);
-
-    requests.push_back(request.get());
+    return inbox.push(request);
+}
 
-    request.release();
+bool RequestQueue::push(std::unique_ptr<MegaRequestPrivate> request)
+{
+    return inbox.push(request.release());
 }
 
 void RequestQueue::push_front(MegaRequestPrivate *request)
 {
     std::lock_guard<std::mutex> g(mutex);
+    drainInbox();
     requests.push_front(request);
 }
 
 MegaRequestPrivate *RequestQueue::pop()
 {
     std::lock_guard<std::mutex> g(mutex);
+    drainInbox();
     if(requests.empty())
     {
         return NULL;
@@ -27434,6 +28684,7 @@ MegaRequestPrivate *RequestQueue::pop()
 MegaRequestPrivate *RequestQueue::front()
 {
     std::lock_guard<std::mutex> g(mutex);
+    drainInbox();
     if(requests.empty())
     {
         return NULL;
@@ -27445,6 +28696,7 @@ MegaRequestPrivate *RequestQueue::front()
 void RequestQueue::removeListener(MegaRequestListener *listener)
 {
     std::lock_guard<std::mutex> g(mutex);
+    drainInbox();
 
     std::deque<MegaRequestPrivate *>::iterator it = requests.begin();
     while(it != requests.end())
@@ -27459,6 +28711,7 @@ void RequestQueue::removeListener(MegaRequestListener *listener)
 void RequestQueue::removeListener(MegaScheduledCopyListener *listener)
 {
     std::lock_guard<std::mutex> g(mutex);
+    drainInbox();
 
     std::deque<MegaRequestPrivate *>::iterator it = requests.begin();
     while(it != requests.end())
@@ -28804,7 +30057,22 @@ void MegaRecursiveOperation::onTransferStart(MegaApi *, MegaTransfer *t)
     assert(transfer);
 
     ++transfersStartedCount;
+    checkAllSubtransfersStarted();
+
+    if (transfer)
+    {
+        transfer->setState(t->getState());
+        transfer->setPriority(t->getPriority());
+        transfer->setTotalBytes(transfer->getTotalBytes() + t->getTotalBytes());
+        transfer->setUpdateTime(Waiter::ds);
+        megaApi->fireOnTransferUpdate(transfer);
+    }
+}
+
+void MegaRecursiveOperation::checkAllSubtransfersStarted()
+{
     if (transfersStartedCount == transfersTotalCount &&
+        !mGeneratingSubtransfers &&
         !transfer->accessCancelToken().isCancelled() &&
         !startedTransferring)
     {
@@ -28814,15 +30082,6 @@ void MegaRecursiveOperation::onTransferStart(MegaApi *, MegaTransfer *t)
         megaApi->fireOnFolderTransferUpdate(transfer, MegaTransfer::STAGE_TRANSFERRING_FILES, 0, 0, unsigned(transfersTotalCount), nullptr, nullptr);
         startedTransferring = true;
     }
-
-    if (transfer)
-    {
-        transfer->setState(t->getState());
-        transfer->setPriority(t->getPriority());
-        transfer->setTotalBytes(transfer->getTotalBytes() + t->getTotalBytes());
-        transfer->setUpdateTime(Waiter::ds);
-        megaApi->fireOnTransferUpdate(transfer);
-    }
 }
 
 void MegaRecursiveOperation::onTransferUpdate(MegaApi *, MegaTransfer *t)
@@ -28882,73 +30141,140 @@ MegaFolderUploadController::~MegaFolderUploadController()
     //we shouldn't need to detach as transfer listener: all listened transfer should have been cancelled/completed
 }
 
+namespace {
+
+// Wakes up the scanning thread of a folder upload when one of its directory scans completes
+class FolderScanWaiter : public Waiter
+{
+public:
+    // returns when notified, or after a while to let the thread check for cancellation
+    int wait() override
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mNotifier.wait_for(lock, std::chrono::milliseconds(100), [this]() { return mNotified; });
+        mNotified = false;
+        return 0;
+    }
+
+    void notify() override
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mNotified = true;
+        mNotifier.notify_one();
+    }
+
+private:
+    std::mutex mMutex;
+    std::condition_variable mNotifier;
+    bool mNotified = false;
+};
+
+} // namespace
+
 MegaFolderUploadController::scanFolder_result MegaFolderUploadController::scanFolder(Tree& tree, LocalPath& localPath, uint32_t& foldercount, uint32_t& filecount)
 {
-    recursive++;
-    unique_ptr<DirAccess> da(fsaccess->newdiraccess());
-    if (!da->dopen(&localPath, nullptr, false))
+    // the scan service needs the fsid of the folders, to be sure they are the ones we expect
+    auto fa = fsaccess->newfileaccess();
+    if (!fa->fopen(localPath, true, false, FSLogging::logOnError, nullptr, false, true) || !fa->fsidvalid || fa->type != FOLDERNODE)
     {
         LOG_err << "Can't open local directory" << localPath;
-        recursive--;
         return scanFolder_failed;
     }
+    handle rootFsid = fa->fsid;
+    fa.reset();
+
+    struct FolderScan
+    {
+        Tree* tree;
+        LocalPath path;
+        handle fsid;
+        ScanService::RequestPtr request;
+    };
+
+    // Several folders are listed and their files fingerprinted at the same time by the threads of the scan service,
+    // the subfolders found by a scan are queued as soon as it completes
+    ScanService scanService;
+    auto waiter = std::make_shared<FolderScanWaiter>();
+    uint64_t volume = fsaccess->fsFingerprint(localPath).fingerprint();
+
+    std::deque<FolderScan> pending;
+    std::vector<FolderScan> scanning;
+    pending.push_back(FolderScan{ &tree, localPath, rootFsid, nullptr });
 
     megaApi->fireOnFolderTransferUpdate(transfer, MegaTransfer::STAGE_SCAN, foldercount, 0, filecount, &localPath, nullptr);
 
-    LocalPath localname;
-    nodetype_t dirEntryType;
-    while (da->dnext(localPath, localname, false, &dirEntryType))
+    while (!pending.empty() || !scanning.empty())
     {
         if (isStoppedOrCancelled("MegaFolderUploadController::scanFolder"))
         {
+            // scans in progress complete on their own, their results are discarded
             return scanFolder_cancelled;
         }
 
-        megaApi->fireOnFolderTransferUpdate(transfer, MegaTransfer::STAGE_SCAN, foldercount, 0, filecount, &localPath, &localname);
+        // a few more than the threads of the volume, so none of them idles while we process a result
+        while (!pending.empty() && scanning.size() < 2 * ScanService::NUM_THREADS_PER_VOLUME)
+        {
+            FolderScan& scan = pending.front();
+            scan.request = scanService.queueScan(scan.path, scan.fsid, false, {}, waiter, volume);
+            scanning.push_back(std::move(scan));
+            pending.pop_front();
+        }
 
-        ScopedLengthRestore restoreLen(localPath);
-        localPath.appendWithSeparator(localname, false);
-        if (dirEntryType == FILENODE)
+        waiter->wait();
+
+        for (auto it = scanning.begin(); it != scanning.end(); )
         {
-            // Do the fingerprinting for uploads on the scan thread, so we don't lock the main mutex for so long
-            FileFingerprint fp;
-            auto fa = fsaccess->newfileaccess();
-            if (fa->fopen(localPath, true, false, FSLogging::logOnError))
+            if (!it->request->completed())
             {
-                fp.genfingerprint(fa.get());
+                ++it;
+                continue;
             }
 
-            // if we couldn't get the fingerprint, !isvalid and we'll fail the transfer
-            tree.files.emplace_back(localPath, fp);
+            if (it->request->completionResult() != SCAN_SUCCESS)
+            {
+                LOG_err << "Can't scan local directory" << it->path << " result: " << it->request->completionResult();
+                return scanFolder_failed;
+            }
 
-            filecount += 1;
-        }
-        else if (dirEntryType == FOLDERNODE)
-        {
-            // generate new subtree
-            unique_ptr<Tree> newTreeNode(new Tree);
-            newTreeNode->folderName = localname.toName(*fsaccess);
-            newTreeNode->fsType = fsaccess->getlocalfstype(localPath);
+            Tree& scanned = *it->tree;
+            for (FSNode& node : it->request->resultNodes())
+            {
+                LocalPath childPath = it->path;
+                childPath.appendWithSeparator(node.localname, false);
 
-            // generate fresh random key and node attributes
-            MegaClient::putnodes_prepareOneFolder(&newTreeNode->newnode, newTreeNode->folderName, rng, tmpnodecipher, false);
+                if (node.type == FILENODE)
+                {
+                    // if we couldn't get the fingerprint, !isvalid and we'll fail the transfer
+                    scanned.files.emplace_back(childPath, node.fingerprint);
+                    filecount += 1;
+                }
+                else if (node.type == FOLDERNODE)
+                {
+                    // generate new subtree
+                    unique_ptr<Tree> newTreeNode(new Tree);
+                    newTreeNode->folderName = node.localname.toName(*fsaccess);
+                    newTreeNode->fsType = fsaccess->getlocalfstype(childPath);
 
-            // set nodeHandle
-            newTreeNode->newnode.nodehandle = nextUploadId();
-            newTreeNode->newnode.parenthandle = tree.newnode.nodehandle;
+                    // generate fresh random key and node attributes
+                    MegaClient::putnodes_prepareOneFolder(&newTreeNode->newnode, newTreeNode->folderName, rng, tmpnodecipher, false);
 
-            scanFolder_result sr = scanFolder(*newTreeNode, localPath, foldercount, filecount);
-            if (sr != scanFolder_succeeded)
-            {
-                recursive--;
-                return sr;
+                    // set nodeHandle
+                    newTreeNode->newnode.nodehandle = nextUploadId();
+                    newTreeNode->newnode.parenthandle = scanned.newnode.nodehandle;
+
+                    pending.push_back(FolderScan{ newTreeNode.get(), std::move(childPath), node.fsid, nullptr });
+                    scanned.subtrees.push_back(std::move(newTreeNode));
+
+                    foldercount += 1;
+                }
+                // symlinks and special files are skipped, as they were by DirAccess
             }
-            tree.subtrees.push_back(std::move(newTreeNode));
 
-            foldercount += 1;
+            megaApi->fireOnFolderTransferUpdate(transfer, MegaTransfer::STAGE_SCAN, foldercount, 0, filecount, &it->path, nullptr);
+            it = scanning.erase(it);
         }
     }
-    recursive--;
+
     return scanFolder_succeeded;
 }
 
@@ -29474,6 +30800,34 @@ int64_t MegaScheduledCopyController::getLastBackupTime()
     return latesttime;
 }
 
+handle MegaScheduledCopyController::getLastCompleteBackupHandle()
+{
+    handle latest = UNDEF;
+    int64_t latesttime = 0;
+
+    std::unique_ptr<MegaNode> parentNode(megaApi->getNodeByHandle(parenthandle));
+    if (parentNode)
+    {
+        std::unique_ptr<MegaNodeList> children(megaApi->getChildren(parentNode.get(), MegaApi::ORDER_NONE));
+        for (int i = 0; children && i < children->size(); i++)
+        {
+            MegaNode *childNode = children->get(i);
+            const char *backstvalue = childNode->getCustomAttr("BACKST");
+            if (childNode->getHandle() != currentHandle && isBackup(childNode->getName(), backupName)
+                    && backstvalue && !strcmp(backstvalue, "COMPLETE"))
+            {
+                int64_t timeofbackup = getTimeOfBackup(childNode->getName());
+                if (timeofbackup > latesttime)
+                {
+                    latesttime = timeofbackup;
+                    latest = childNode->getHandle();
+                }
+            }
+        }
+    }
+    return latest;
+}
+
 bool MegaScheduledCopyController::isBackup(string localname, string backupname) const
 {
     return ( localname.compare(0, backupname.length(), backupname) == 0) && (localname.find("_bk_") != string::npos);
@@ -29666,6 +31020,7 @@ void MegaScheduledCopyController::clearCurrentBackupData()
     this->recursive = 0;
     this->pendingTransfers = 0;
     this->pendingFolders.clear();
+    this->previousFolders.clear();
     for (std::vector<MegaTransfer *>::iterator it = failedTransfers.begin(); it != failedTransfers.end(); it++)
     {
         delete *it;
@@ -29731,6 +31086,13 @@ void MegaScheduledCopyController::start(bool skip)
 
         if(!child || !child->isFolder())
         {
+            // files that haven't changed since the last complete backup are copied from it
+            handle previous = getLastCompleteBackupHandle();
+            if (previous != UNDEF)
+            {
+                previousFolders[localpath] = previous;
+            }
+
             pendingFolders.push_back(localpath);
             megaApi->createFolder(backupname.c_str(), parent, this);
         }
@@ -29772,6 +31134,15 @@ void MegaScheduledCopyController::onFolderAvailable(MegaHandle handle)
     LocalPath localPath = pendingFolders.front();
     pendingFolders.pop_front();
 
+    // the matching folder of the previous complete backup, if any
+    std::shared_ptr<Node> previousFolder;
+    auto previousIt = previousFolders.find(localPath);
+    if (previousIt != previousFolders.end())
+    {
+        previousFolder = client->nodebyhandle(previousIt->second);
+        previousFolders.erase(previousIt);
+    }
+
     if (state == SCHEDULED_COPY_ONGOING)
     {
         LocalPath localname;
@@ -29779,6 +31150,8 @@ void MegaScheduledCopyController::onFolderAvailable(MegaHandle handle)
         if (da->dopen(&localPath, NULL, false))
         {
             FileSystemType fsType = client->fsaccess->getlocalfstype(localPath);
+            std::vector<std::shared_ptr<Node>> unchangedNodes;
+            std::vector<LocalPath> unchangedPaths;
 
             while (da->dnext(localPath, localname, false))
             {
@@ -29793,6 +31166,15 @@ void MegaScheduledCopyController::onFolderAvailable(MegaHandle handle)
                     string name = localname.toName(*client->fsaccess);
                     if(fa->type == FILENODE)
                     {
+                        // same size and modification time as in the previous backup: no need to upload it again
+                        std::shared_ptr<Node> previous = previousFolder ? client->childnodebyname(previousFolder.get(), name.c_str(), true) : nullptr;
+                        if (previous && previous->isvalid && previous->size == fa->size && previous->mtime == fa->mtime)
+                        {
+                            unchangedNodes.push_back(std::move(previous));
+                            unchangedPaths.push_back(localPath);
+                            continue;
+                        }
+
                         pendingTransfers++;
 
                         totalFiles++;
@@ -29802,6 +31184,15 @@ void MegaScheduledCopyController::onFolderAvailable(MegaHandle handle)
                     }
                     else
                     {
+                        if (previousFolder)
+                        {
+                            std::shared_ptr<Node> previous = client->childnodebyname(previousFolder.get(), name.c_str());
+                            if (previous && previous->type == FOLDERNODE)
+                            {
+                                previousFolders[localPath] = previous->nodehandle;
+                            }
+                        }
+
                         MegaNode *child = megaApi->getChildNode(parent, name.c_str());
                         if(!child || !child->isFolder())
                         {
@@ -29817,6 +31208,11 @@ void MegaScheduledCopyController::onFolderAvailable(MegaHandle handle)
                     }
                 }
             }
+
+            if (!unchangedNodes.empty())
+            {
+                copyUnchangedFiles(handle, std::move(unchangedNodes), std::move(unchangedPaths), fsType);
+            }
         }
     }
     else if (state == SCHEDULED_COPY_SKIPPING)
@@ -29834,6 +31230,67 @@ void MegaScheduledCopyController::onFolderAvailable(MegaHandle handle)
     checkCompletion();
 }
 
+// copies the unchanged files of a folder from the previous backup, all of them with a single putnodes
+void MegaScheduledCopyController::copyUnchangedFiles(MegaHandle target, std::vector<std::shared_ptr<Node>> nodes, std::vector<LocalPath> paths, FileSystemType fsType)
+{
+    assert(nodes.size() == paths.size());
+
+    vector<NewNode> nn;
+    nn.reserve(nodes.size());
+    for (auto& node : nodes)
+    {
+        TreeProcCopy tc;
+        client->proctree(node, &tc, false, true);
+        tc.allocnodes();
+        assert(tc.nn.size() == 1);
+
+        nn.push_back(std::move(tc.nn[0]));
+        nn.back().parenthandle = UNDEF;
+    }
+
+    LOG_debug << "Copying " << nn.size() << " unchanged files from the previous backup";
+    pendingTransfers += static_cast<int>(nn.size());
+    totalFiles += static_cast<long long>(nn.size());
+
+    std::weak_ptr<bool> alive = mAlive;
+    handle instance = currentHandle;
+    client->putnodes(NodeHandle().set6byte(target), UseLocalVersioningFlag, std::move(nn), nullptr, client->nextreqtag(), false,
+        [this, alive, instance, target, paths = std::move(paths), fsType](const Error& e, targettype_t, vector<NewNode>& nn, bool, int)
+        {
+            // the controller is gone, or it went on with another backup
+            if (alive.expired() || instance != currentHandle)
+            {
+                return;
+            }
+
+            std::unique_ptr<MegaNode> parent(megaApi->getNodeByHandle(target));
+            for (size_t i = 0; i < paths.size(); i++)
+            {
+                if (e == API_OK && i < nn.size() && nn[i].mError == API_OK)
+                {
+                    pendingTransfers--;
+                    numberFiles++;
+                }
+                else if (parent)
+                {
+                    // upload it instead
+                    LOG_warn << "Could not copy unchanged file from the previous backup: " << paths[i] << ". Uploading it";
+                    megaApi->startUpload(false, paths[i].toPath(false).c_str(),
+                                                        parent.get(), nullptr, nullptr, -1, folderTransferTag, true,
+                                                        nullptr, false, false, fsType, CancelToken(), this);
+                }
+                else
+                {
+                    LOG_err << "Could not copy unchanged file from the previous backup: " << paths[i];
+                    pendingTransfers--;
+                }
+            }
+
+            megaApi->fireOnBackupUpdate(this);
+            checkCompletion();
+        });
+}
+
 bool MegaScheduledCopyController::checkCompletion()
 {
     if(!recursive && !pendingFolders.size() && !pendingTransfers && !pendingTags)
@@ -30339,12 +31796,15 @@ void MegaFolderDownloadController::start(MegaNode *node)
         // it's mandatory to notify stage change from MegaApiImpl's thread to avoid deadlocks and other issues
         notifyStage(MegaTransfer::STAGE_CREATE_TREE);
 
+        // the transfers are sent in batches while the tree is created, the operation can't complete meanwhile
+        mGeneratingSubtransfers = true;
+
         // start worker thread to create local folder tree
         mWorkerThread = std::thread([this, fsType, path, fileAddedCount](){
 
             // local folder creation runs on the download worker thread (and checks the cancelled flag)
             Error e;
-            std::shared_ptr<TransferQueue> transferQueue = createFolderGenDownloadTransfersForFiles(fsType, fileAddedCount, e);
+            createFolderGenDownloadTransfersForFiles(fsType, fileAddedCount, e);
 
             // mCompletionForMegaApiThread lambda will be executed on the MegaApiImpl's thread
             // use a weak_ptr in case this 'this' object doesn't exist anymore when lambda starts executing
@@ -30352,7 +31812,7 @@ void MegaFolderDownloadController::start(MegaNode *node)
 
             // the thread always queues a function to execute on MegaApi thread for onFinish()
             // we keep a pointer to it in case we need to cancel()
-            mCompletionForMegaApiThread.reset(new ExecuteOnce([this, e, transferQueue, path, weak_this]() {
+            mCompletionForMegaApiThread.reset(new ExecuteOnce([this, e, path, weak_this]() {
 
                 // double check our object still exists when completion function starts executing
                 if (!weak_this.lock()) return;
@@ -30368,32 +31828,61 @@ void MegaFolderDownloadController::start(MegaNode *node)
                     mWorkerThread.join();
                 }
 
-                if (e)
+                // all the transfers are known now (batches of them may have been sent already)
+                mGeneratingSubtransfers = false;
+                std::unique_ptr<TransferQueue> transferQueue;
                 {
-                    complete(e);
+                    std::lock_guard<std::mutex> g(mReadyTransfersMutex);
+                    transferQueue = std::move(mReadyTransfers);
                 }
-                else
+
+                if (e)
                 {
-                    // downloadFiles must run on the megaApi thread, as it may call fireOnTransferXYZ()
-                    if (!transferQueue)
+                    // the transfers not sent yet are dropped
+                    while (MegaTransferPrivate* t = transferQueue ? transferQueue->pop() : nullptr)
                     {
-                        complete(API_EINCOMPLETE, true);
+                        delete t;
                     }
-                    else if (transferQueue->empty())
+
+                    if (!transfersTotalCount)
                     {
-                        complete(API_OK);
+                        complete(e);
                     }
                     else
                     {
-                        // once we call sendPendingTransfers, we are guaranteed start/finish callbacks for each file transfer
-                        // the last callback of onFinish for one of these will also complete and destroy this MegaFolderUploadController
-                        transfersTotalCount = transferQueue->size();
+                        // the transfers sent already finish on their own (cancelled, if that's the case),
+                        // but the folder is incomplete anyway
+                        mIncompleteTransfers++;
+                        if (allSubtransfersResolved())
+                        {
+                            complete(API_EINCOMPLETE);
+                        }
+                    }
+                }
+                else if (transferQueue && !transferQueue->empty())
+                {
+                    // once we call sendPendingTransfers, we are guaranteed start/finish callbacks for each file transfer
+                    // the last callback of onFinish for one of these will also complete and destroy this MegaFolderDownloadController
+                    transfersTotalCount += transferQueue->size();
 
-                        megaApi->sendPendingTransfers(transferQueue.get(), this, megaapiThreadClient()->fsaccess->availableDiskSpace(path));
-                        // no further code can be added here, this object may now be deleted (eg, due to cancel token activation)
+                    megaApi->sendPendingTransfers(transferQueue.get(), this, megaapiThreadClient()->fsaccess->availableDiskSpace(path));
+                    // no further code can be added here, this object may now be deleted (eg, due to cancel token activation)
 
-                        // complete() will finally be called when the last sub-transfer finishes
-                    }
+                    // complete() will finally be called when the last sub-transfer finishes
+                }
+                else if (!transfersTotalCount)
+                {
+                    complete(API_OK);
+                }
+                else if (allSubtransfersResolved())
+                {
+                    // the last batch sent has finished already
+                    complete(mIncompleteTransfers ? API_EINCOMPLETE : API_OK);
+                }
+                else
+                {
+                    // complete() will be called when the last sub-transfer finishes
+                    checkAllSubtransfersStarted();
                 }
             }));
 
@@ -30423,53 +31912,76 @@ MegaFolderDownloadController::scanFolder_result MegaFolderDownloadController::sc
 
     megaApi->fireOnFolderTransferUpdate(transfer, MegaTransfer::STAGE_SCAN, unsigned(mLocalTree.size()), 0, fileAddedCount, &localpath, nullptr);
 
-    MegaNodeList *children = nullptr;
-    unique_ptr<MegaNodeList> autoDelChildren;
-    if (node->isForeign())
-    {
-        children = node->getChildren();
-    }
-    else
-    {
-        children = megaApi->getChildren(node, MegaApi::ORDER_NONE);  // no order is much faster for a very large folder (or nested folders with large subfolders)
-        autoDelChildren.reset(children);
-    }
+    // children of owned nodes are retrieved from the DB in pages (following the name index),
+    // so a huge folder isn't loaded at once. Foreign nodes already have them.
+    MegaSearchFilterPrivate filter;
+    filter.byLocationHandle(node->getHandle());
+    unique_ptr<MegaSearchPage> page(new MegaSearchPagePrivate(size_t(0), SCAN_PAGE_SIZE));
 
-    if (!children)
-    {
-        LOG_err << "Child nodes not found: " << localpath;
-        recursive--;
-        return scanFolder_failed;
-    }
-
-    for (int i = 0; i < children->size(); i++)
+    for (;;)
     {
-        if (isCancelledByFolderTransferToken())
+        MegaNodeList *children = nullptr;
+        unique_ptr<MegaNodeList> autoDelChildren;
+        if (node->isForeign())
         {
-            return scanFolder_cancelled;
+            children = node->getChildren();
+        }
+        else
+        {
+            children = megaApi->getChildren(&filter, MegaApi::ORDER_DEFAULT_ASC, transfer->accessCancelToken(), page.get());
+            autoDelChildren.reset(children);
         }
 
-        MegaNode *child = children->get(i);
-        if (child->getType() == MegaNode::TYPE_FILE)
+        if (!children)
         {
-            // Add child node to vector in mLocalTree at index we have stored it's localPath
-            ::mega::unique_ptr<MegaNode> childNode (child->copy());
-            mLocalTree.at(index).childrenNodes.push_back(std::move(childNode));
-            fileAddedCount += 1;
+            LOG_err << "Child nodes not found: " << localpath;
+            recursive--;
+            return scanFolder_failed;
         }
-        else
+
+        for (int i = 0; i < children->size(); i++)
         {
-            ScopedLengthRestore restoreLen(localpath);
-            localpath.appendWithSeparator(LocalPath::fromRelativeName(child->getName(), *fsaccess, fsType), true);
-            scanFolder_result result = scanFolder(child, localpath, fsType, fileAddedCount);
+            if (isCancelledByFolderTransferToken())
+            {
+                return scanFolder_cancelled;
+            }
 
-            if (result != scanFolder_succeeded)
+            MegaNode *child = children->get(i);
+            if (child->getType() == MegaNode::TYPE_FILE)
             {
-                recursive--;
-                return result;
+                // Add child node to vector in mLocalTree at index we have stored it's localPath
+                ::mega::unique_ptr<MegaNode> childNode (child->copy());
+                mLocalTree.at(index).childrenNodes.push_back(std::move(childNode));
+                fileAddedCount += 1;
             }
+            else
+            {
+                ScopedLengthRestore restoreLen(localpath);
+                localpath.appendWithSeparator(LocalPath::fromRelativeName(child->getName(), *fsaccess, fsType), true);
+                scanFolder_result result = scanFolder(child, localpath, fsType, fileAddedCount);
+
+                if (result != scanFolder_succeeded)
+                {
+                    recursive--;
+                    return result;
+                }
+            }
+        }
+
+        if (isCancelledByFolderTransferToken())
+        {
+            return scanFolder_cancelled;
         }
+
+        if (node->isForeign() || static_cast<size_t>(children->size()) < SCAN_PAGE_SIZE)
+        {
+            break;
+        }
+
+        // next page, right after the last child of this one
+        page.reset(new MegaSearchPagePrivate(children->get(children->size() - 1), SCAN_PAGE_SIZE));
     }
+
     recursive--;
     return scanFolder_succeeded;
 }
@@ -30489,14 +32001,16 @@ bool MegaRecursiveOperation::isStoppedOrCancelled(const std::string& name) const
     return false;
 }
 
-// Create all local directories in one shot (on the download worker thread)
-// for performance and reducing UI waiting time, we combine createFolder and transferQueue generating in one loop
-std::unique_ptr<TransferQueue> MegaFolderDownloadController::createFolderGenDownloadTransfersForFiles(FileSystemType fsType, uint32_t fileCount, Error &e)
+// Create all local directories (on the download worker thread)
+// for performance and reducing UI waiting time, we combine createFolder and transferQueue generating in one loop,
+// and the transfers are handed over to MegaApiImpl's thread in batches, as their folders are created
+void MegaFolderDownloadController::createFolderGenDownloadTransfersForFiles(FileSystemType fsType, uint32_t fileCount, Error &e)
 {
     unsigned created = 0;
     assert(mMainThreadId != std::this_thread::get_id());
 
     auto transferQueue = std::make_unique<TransferQueue>();
+    auto lastHandoff = std::chrono::steady_clock::now();
 
     // update stage to begin
     if (!mLocalTree.empty())
@@ -30511,7 +32025,7 @@ std::unique_ptr<TransferQueue> MegaFolderDownloadController::createFolderGenDown
         if (isStoppedOrCancelled("MegaFolderDownloadController::createFolderGenDownloadTransfersForFiles"))
         {
             e = API_EINCOMPLETE;
-            return nullptr;
+            return;
         }
 
         LocalPath &localpath = it->localPath;
@@ -30523,7 +32037,7 @@ std::unique_ptr<TransferQueue> MegaFolderDownloadController::createFolderGenDown
         if (e && e != API_EEXIST)
         {
             mLocalTree.clear();
-            return nullptr;
+            return;
         }
 
         auto folderAlreadyExist = (e && e == API_EEXIST);
@@ -30531,17 +32045,81 @@ std::unique_ptr<TransferQueue> MegaFolderDownloadController::createFolderGenDown
         if (!genDownloadTransfersForFiles(transferQueue.get(), *it, fsType, folderAlreadyExist))
         {
             e = API_EINCOMPLETE;
-            return nullptr;
+            return;
+        }
+
+        // the files of the folders created so far can be downloaded already
+        auto now = std::chrono::steady_clock::now();
+        if (transferQueue->size() >= HANDOFF_TRANSFERS ||
+            (!transferQueue->empty() && now - lastHandoff >= HANDOFF_INTERVAL))
+        {
+            lastHandoff = now;
+            if (handOffTransfers(*transferQueue))
+            {
+                weak_ptr<MegaFolderDownloadController> weak_this = shared_from_this();
+                LocalPath rootPath = mLocalTree.front().localPath;
+                megaApi->executeOnThread(std::make_shared<ExecuteOnce>([this, weak_this, rootPath]() {
+                    if (!weak_this.lock()) return;
+                    sendReadyTransfers(rootPath);
+                }));
+            }
         }
 
+        // the folder's files are not needed anymore
+        it->childrenNodes.clear();
+        it->childrenNodes.shrink_to_fit();
+
         ++it;
         ++created;
 
         megaApi->fireOnFolderTransferUpdate(transfer, MegaTransfer::STAGE_CREATE_TREE, unsigned(mLocalTree.size()), created, fileCount, nullptr, nullptr);
     }
 
+    // the rest are sent by the completion
+    handOffTransfers(*transferQueue);
     e = API_OK;
-    return transferQueue;
+}
+
+bool MegaFolderDownloadController::handOffTransfers(TransferQueue& transfers)
+{
+    std::lock_guard<std::mutex> g(mReadyTransfersMutex);
+    bool wasEmpty = !mReadyTransfers || mReadyTransfers->empty();
+    if (!mReadyTransfers)
+    {
+        mReadyTransfers = std::make_unique<TransferQueue>();
+    }
+
+    while (MegaTransferPrivate* t = transfers.pop())
+    {
+        mReadyTransfers->push(t);
+    }
+    return wasEmpty;
+}
+
+void MegaFolderDownloadController::sendReadyTransfers(const LocalPath& path)
+{
+    assert(mMainThreadId == std::this_thread::get_id());
+
+    // once the completion has run, it has sent the rest already
+    if (!mGeneratingSubtransfers)
+    {
+        return;
+    }
+
+    std::unique_ptr<TransferQueue> transferQueue;
+    {
+        std::lock_guard<std::mutex> g(mReadyTransfersMutex);
+        transferQueue = std::move(mReadyTransfers);
+    }
+
+    if (!transferQueue || transferQueue->empty())
+    {
+        return;
+    }
+
+    // while mGeneratingSubtransfers is set, the operation can't complete here (not even if the batch is cancelled)
+    transfersTotalCount += transferQueue->size();
+    megaApi->sendPendingTransfers(transferQueue.get(), this, megaapiThreadClient()->fsaccess->availableDiskSpace(path));
 }
 
 bool MegaFolderDownloadController::genDownloadTransfersForFiles(
@@ -30594,9 +32172,9 @@ bool MegaFolderDownloadController::genDownloadTransfersForFiles(
 StreamingBuffer::StreamingBuffer()
 {
     this->capacity = 0;
-    this->buffer = NULL;
-    this->inpos = 0;
+    this->outchunk = 0;
     this->outpos = 0;
+    this->freedpos = 0;
     this->size = 0;
     this->free = 0;
     this->maxBufferSize = MAX_BUFFER_SIZE;
@@ -30607,7 +32185,6 @@ StreamingBuffer::StreamingBuffer()
 
 StreamingBuffer::~StreamingBuffer()
 {
-    delete [] buffer;
 }
 
 void StreamingBuffer::init(size_t capacity)
@@ -30642,9 +32219,10 @@ void StreamingBuffer::init(size_t capacity)
     }
 
     this->capacity = static_cast<unsigned>(capacity);
-    this->buffer = new char[this->capacity];
-    this->inpos = 0;
+    this->chunks.clear();
+    this->outchunk = 0;
     this->outpos = 0;
+    this->freedpos = 0;
     this->size = 0;
     this->free = this->capacity;
 }
@@ -30686,13 +32264,29 @@ void StreamingBuffer::reset(bool freeData, size_t sizeToReset)
     {
         sizeToReset = size;
     }
-    LOG_warn << "[Streaming] Reset streaming buffer. Actual size: " << size << ", free: " << free << ", capacity = " << capacity << ", size to reset: " << sizeToReset << "] [inpos = " << inpos << ", outpos = " << outpos << "]";
-    this->inpos = this->inpos >= sizeToReset ?
-                        this->inpos - sizeToReset :
-                        this->capacity - (sizeToReset - this->inpos);
-    this->outpos = this->outpos >= sizeToReset ?
-                        this->outpos - sizeToReset :
-                        this->capacity - (sizeToReset - this->outpos);
+    LOG_warn << "[Streaming] Reset streaming buffer. Actual size: " << size << ", free: " << free << ", capacity = " << capacity << ", size to reset: " << sizeToReset << "] [chunks = " << chunks.size() << ", outchunk = " << outchunk << ", outpos = " << outpos << "]";
+
+    // drop the latest data, which hasn't been handed out yet
+    for (size_t pending = sizeToReset; pending; )
+    {
+        Chunk& last = chunks.back();
+        bool isOutChunk = (chunks.size() - 1 == outchunk);
+        size_t dropped = std::min(pending, last.len - (isOutChunk ? outpos : 0));
+        last.len -= dropped;
+        pending -= dropped;
+
+        if (!last.len)
+        {
+            chunks.pop_back();
+        }
+        else if (isOutChunk && outpos == last.len)
+        {
+            // whatever is left of it has been handed out already
+            outchunk++;
+            outpos = 0;
+        }
+    }
+
     this->size -= sizeToReset;
     if (freeData)
     {
@@ -30702,7 +32296,13 @@ void StreamingBuffer::reset(bool freeData, size_t sizeToReset)
 
 size_t StreamingBuffer::append(const char *buf, size_t len)
 {
-    if (!buffer)
+    std::shared_ptr<std::string> copy = std::make_shared<std::string>(buf, len);
+    return append(copy, copy->data(), len);
+}
+
+size_t StreamingBuffer::append(std::shared_ptr<const void> owner, const char *buf, size_t len)
+{
+    if (!capacity)
     {
         // initialize the buffer if it's not initialized yet
         init(len);
@@ -30717,31 +32317,64 @@ size_t StreamingBuffer::append(const char *buf, size_t len)
         len = free;
     }
 
+    if (!len)
+    {
+        return 0;
+    }
+
     // update the internal state
-    size_t currentIndex = inpos;
-    inpos += len;
-    int remaining = static_cast<int>(inpos - capacity);
-    inpos %= capacity;
     size += len;
     free -= len;
 
-    // append the new data
-    if (remaining <= 0)
+    // keep the data alive until it's written
+    chunks.push_back(Chunk{std::move(owner), buf, len});
+
+    return len;
+}
+
+size_t StreamingBuffer::prepend(const char *buf, size_t len)
+{
+    if (!capacity)
     {
-        memcpy(buffer + currentIndex, buf, len);
+        // initialize the buffer if it's not initialized yet
+        init(len);
     }
-    else
+
+    if (outpos)
     {
-        size_t num = static_cast<size_t>(static_cast<int>(len) - remaining);
-        LOG_debug << "[Streaming] Length exceeds limits of circular buffer. Writting a piece of " << num << " bytes to the end and the others " << remaining << " bytes from the beginning"
-                    << " [current index = " << currentIndex << ", len = " << len << ", capacity = " << capacity << "]";
-        memcpy(buffer + currentIndex, buf, num);
-        memcpy(buffer, buf + num, static_cast<size_t>(remaining));
+        // split the chunk being handed out, so that the new data goes right before its remainder
+        Chunk& current = chunks[outchunk];
+        Chunk remainder{current.owner, current.data + outpos, current.len - outpos};
+        current.len = outpos;
+        chunks.insert(chunks.begin() + static_cast<ptrdiff_t>(outchunk) + 1, std::move(remainder));
+        outchunk++;
+        outpos = 0;
     }
 
+    std::shared_ptr<std::string> copy = std::make_shared<std::string>(buf, len);
+    chunks.insert(chunks.begin() + static_cast<ptrdiff_t>(outchunk), Chunk{copy, copy->data(), len});
+
+    // the data doesn't take the free space of the buffered data
+    capacity += len;
+    size += len;
     return len;
 }
 
+void StreamingBuffer::discard(size_t len)
+{
+    while (len)
+    {
+        uv_buf_t dropped = nextBuffer(len);
+        if (!dropped.len)
+        {
+            break;
+        }
+
+        freeData(dropped.len);
+        len -= dropped.len;
+    }
+}
+
 size_t StreamingBuffer::availableData() const
 {
     return size;
@@ -30757,32 +32390,30 @@ size_t StreamingBuffer::availableCapacity() const
     return capacity;
 }
 
-uv_buf_t StreamingBuffer::nextBuffer()
+uv_buf_t StreamingBuffer::nextBuffer(size_t maxLen)
 {
-    if (!size)
+    if (!size || !maxLen)
     {
         // no data available
         return uv_buf_init(NULL, 0);
     }
 
-    // prepare output buffer
-    char *outbuf = buffer + outpos;
-    size_t len = size < maxOutputSize ? size : maxOutputSize;
-    if (outpos + len > capacity)
-    {
-        LOG_debug << "[Streaming] Available length exceeds limits of circular buffer: "
-                    << "Truncating output buffer length to " << (capacity-outpos) << " bytes"
-                    << " [outpos = " << outpos << ", len = " << len << ", capacity = " << capacity << "]";
-        len = capacity - outpos;
-    }
+    // prepare output buffer, handing out the data of appended chunks as they are (no copies)
+    const Chunk& chunk = chunks[outchunk];
+    const char *outbuf = chunk.data + outpos;
+    size_t len = std::min({chunk.len - outpos, maxOutputSize, maxLen});
 
     // update the internal state
     size -= len;
     outpos += len;
-    outpos %= capacity;
+    if (outpos == chunk.len)
+    {
+        outchunk++;
+        outpos = 0;
+    }
 
     // return the buffer
-    return uv_buf_init(outbuf, (unsigned int)(len));
+    return uv_buf_init(const_cast<char *>(outbuf), (unsigned int)(len));
 }
 
 void StreamingBuffer::freeData(size_t len)
@@ -30790,6 +32421,28 @@ void StreamingBuffer::freeData(size_t len)
     LOG_verbose << "[Streaming] Streaming buffer free data: len = " << len << ", actual free = " << free << ", new free = " << (free+len) << ", size = " << size << " [capacity = " << capacity << "]";
     // update the internal state
     free += len;
+
+    // release the chunks written completely
+    while (len && outchunk)
+    {
+        size_t remaining = chunks.front().len - freedpos;
+        if (len < remaining)
+        {
+            freedpos += len;
+            break;
+        }
+
+        len -= remaining;
+        chunks.pop_front();
+        outchunk--;
+        freedpos = 0;
+    }
+
+    if (len && !outchunk)
+    {
+        // part of the chunk being handed out
+        freedpos += len;
+    }
 }
 
 void StreamingBuffer::setMaxBufferSize(unsigned int bufferSize)
@@ -30906,6 +32559,7 @@ MegaTCPServer::MegaTCPServer(MegaApiImpl *megaApi, string basePath, bool tls, st
     this->lastHandle = INVALID_HANDLE;
     this->remainingcloseevents = 0;
     this->closing = false;
+    this->numThreads = 1;
     this->thread = new MegaThread();
 #ifdef ENABLE_EVT_TLS
     this->certificatepath = certificatepath;
@@ -30938,6 +32592,7 @@ MegaTCPServer::~MegaTCPServer()
 
     thread->join();
     delete thread;
+    joinWorkers();
 
     semaphoresdestroyed = true;
     uv_sem_destroy(&semaphoreStartup);
@@ -30961,6 +32616,9 @@ bool MegaTCPServer::start(int port, bool localOnly)
     this->port = port;
     this->localOnly = localOnly;
 
+    // loops of a previous run stopped without waiting
+    joinWorkers();
+
     thread->start(threadEntryPoint, this);
     uv_sem_wait(&semaphoreStartup);
 
@@ -31027,13 +32685,23 @@ void MegaTCPServer::run()
 #endif
 
     uv_loop_init(&uv_loop);
+    uv_loop.data = NULL;
 
     uv_async_init(&uv_loop, &exit_handle, onCloseRequested);
     exit_handle.data = this;
 
-    uv_tcp_init(&uv_loop, &server);
+    // connections are balanced among loops by the kernel, all listeners need SO_REUSEPORT
+    // TLS connections share the evt context, so they are kept in the main loop
+    bool reusePort = numThreads > 1 && !useTLS;
+    uv_tcp_init_ex(&uv_loop, &server, reusePort ? (useIPv6 ? AF_INET6 : AF_INET) : AF_UNSPEC);
     server.data = this;
 
+    if (reusePort && !enableReusePort(&server))
+    {
+        LOG_warn << "SO_REUSEPORT not available, TCP server will use a single loop. port = " << port;
+        reusePort = false;
+    }
+
     uv_tcp_keepalive(&server, 0, 0);
 
     union {
@@ -31097,7 +32765,12 @@ void MegaTCPServer::run()
         return;
     }
 
-    LOG_info << "TCP" << (useTLS ? "(tls)" : "") << " server started on port " << port;
+    if (reusePort)
+    {
+        startWorkers(onNewClientCB);
+    }
+
+    LOG_info << "TCP" << (useTLS ? "(tls)" : "") << " server started on port " << port << " loops = " << workers.size() + 1;
     started = true;
     uv_sem_post(&semaphoreStartup);
 
@@ -31141,6 +32814,7 @@ void MegaTCPServer::initializeAndStartListening()
 #endif
 
     uv_loop_init(&uv_loop);
+    uv_loop.data = NULL;
 
     uv_async_init(&uv_loop, &exit_handle, onCloseRequested);
     exit_handle.data = this;
@@ -31219,15 +32893,84 @@ void MegaTCPServer::stop(bool doNotWait)
 
     LOG_debug << "Stopping MegaTCPServer port = " << port;
     uv_async_send(&exit_handle);
+    for (auto& worker : workers)
+    {
+        uv_async_send(&worker->exit_handle);
+    }
+
     if (!doNotWait)
     {
         LOG_verbose << "Waiting for sempahoreEnd to conclude server stop port = " << port;
         uv_sem_wait(&semaphoreEnd); //this is signaled when closed my last connection
+        joinWorkers();
     }
     LOG_debug << "Stopped MegaTCPServer port = " << port;
     started = false;
 }
 
+bool MegaTCPServer::enableReusePort(uv_tcp_t *handle)
+{
+    // other platforms either lack SO_REUSEPORT or don't balance the connections with it
+#if defined(__linux__) && defined(SO_REUSEPORT)
+    uv_os_fd_t fd;
+    int enable = 1;
+    return !uv_fileno((uv_handle_t*)handle, &fd)
+            && !setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+#else
+    return false;
+#endif
+}
+
+void MegaTCPServer::startWorkers(uv_connection_cb onNewClientCB)
+{
+    // bind to the address actually used by the main listener, in case the port was chosen by the system
+    struct sockaddr_storage address;
+    int namelen = sizeof(address);
+    if (uv_tcp_getsockname(&server, (struct sockaddr*)&address, &namelen))
+    {
+        LOG_warn << "Unable to get the address of the TCP server. port = " << port;
+        return;
+    }
+
+    for (int i = 1; i < numThreads; i++)
+    {
+        std::unique_ptr<MegaTCPWorker> worker(new MegaTCPWorker());
+        uv_loop_init(&worker->loop);
+        worker->loop.data = worker.get();
+
+        uv_async_init(&worker->loop, &worker->exit_handle, onWorkerCloseRequested);
+        worker->exit_handle.data = worker.get();
+
+        uv_tcp_init_ex(&worker->loop, &worker->listener, address.ss_family);
+        worker->listener.data = this;
+        uv_tcp_keepalive(&worker->listener, 0, 0);
+
+        if (!enableReusePort(&worker->listener)
+                || uv_tcp_bind(&worker->listener, (const struct sockaddr*)&address, 0)
+                || uv_listen((uv_stream_t*)&worker->listener, 32, onNewClientCB))
+        {
+            LOG_warn << "TCP worker failed to bind/listen port = " << port;
+            uv_close((uv_handle_t *)&worker->exit_handle, NULL);
+            uv_close((uv_handle_t *)&worker->listener, NULL);
+            uv_run(&worker->loop, UV_RUN_DEFAULT); // so that resources are cleaned peacefully
+            uv_loop_close(&worker->loop);
+            return;
+        }
+
+        worker->thread.start(workerEntryPoint, worker.get());
+        workers.push_back(std::move(worker));
+    }
+}
+
+void MegaTCPServer::joinWorkers()
+{
+    for (auto& worker : workers)
+    {
+        worker->thread.join();
+    }
+    workers.clear();
+}
+
 int MegaTCPServer::getPort()
 {
     return port;
@@ -31258,6 +33001,16 @@ int MegaTCPServer::getMaxBufferSize()
     return StreamingBuffer::MAX_BUFFER_SIZE;
 }
 
+void MegaTCPServer::setNumThreads(int threads)
+{
+    numThreads = threads > 0 ? threads : 1;
+}
+
+int MegaTCPServer::getNumThreads()
+{
+    return numThreads;
+}
+
 int MegaTCPServer::getMaxOutputSize()
 {
     if (maxOutputSize)
@@ -31370,6 +33123,20 @@ void *MegaTCPServer::threadEntryPoint(void *param)
     return NULL;
 }
 
+void *MegaTCPServer::workerEntryPoint(void *param)
+{
+    MegaTCPWorker *worker = (MegaTCPWorker *)param;
+
+    // the loop ends when onWorkerCloseRequested has closed all its handles
+    uv_run(&worker->loop, UV_RUN_DEFAULT);
+    int closeVal = uv_loop_close(&worker->loop);
+    if (closeVal)
+    {
+        LOG_err << "[MegaTCPServer::workerEntryPoint] Error closing uv_loop: " << uv_strerror(closeVal);
+    }
+    return NULL;
+}
+
 #ifdef ENABLE_EVT_TLS
 void MegaTCPServer::evt_on_rd(evt_tls_t *evt_tls, char *bfr, int sz)
 {
@@ -31437,17 +33204,18 @@ void MegaTCPServer::onNewClient_tls(uv_stream_t *server_handle, int status)
 
     // Create an object to save context information
     MegaTCPContext* tcpctx = ((MegaTCPServer *)server_handle->data)->initializeContext(server_handle);
+    tcpctx->worker = (MegaTCPWorker *)server_handle->loop->data;
 
-    LOG_debug << "Connection received at port " << tcpctx->server->port << " ! " << tcpctx->server->connections.size();
+    LOG_debug << "Connection received at port " << tcpctx->server->port << " ! " << connectionsOf(tcpctx).size();
 
     // Mutex to protect the data buffer
     uv_mutex_init(&tcpctx->mutex);
 
     // Async handle to perform writes
-    uv_async_init(&tcpctx->server->uv_loop, &tcpctx->asynchandle, onAsyncEvent);
+    uv_async_init(server_handle->loop, &tcpctx->asynchandle, onAsyncEvent);
 
     // Accept the connection
-    uv_tcp_init(&tcpctx->server->uv_loop, &tcpctx->tcphandle);
+    uv_tcp_init(server_handle->loop, &tcpctx->tcphandle);
     if (uv_accept(server_handle, (uv_stream_t*)&tcpctx->tcphandle))
     {
         LOG_err << "uv_accept failed";
@@ -31465,7 +33233,7 @@ void MegaTCPServer::onNewClient_tls(uv_stream_t *server_handle, int status)
         return;
     }
 
-    tcpctx->server->connections.push_back(tcpctx);
+    connectionsOf(tcpctx).push_back(tcpctx);
 
     tcpctx->server->readData(tcpctx);
 }
@@ -31496,17 +33264,18 @@ void MegaTCPServer::onNewClient(uv_stream_t* server_handle, int status)
 
     // Create an object to save context information
     MegaTCPContext* tcpctx = ((MegaTCPServer *)server_handle->data)->initializeContext(server_handle);
+    tcpctx->worker = (MegaTCPWorker *)server_handle->loop->data;
 
-    LOG_debug << "Connection received at port " << tcpctx->server->port << "! " << tcpctx->server->connections.size() << " tcpctx = " << tcpctx;
+    LOG_debug << "Connection received at port " << tcpctx->server->port << "! " << connectionsOf(tcpctx).size() << " tcpctx = " << tcpctx;
 
     // Mutex to protect the data buffer
     uv_mutex_init(&tcpctx->mutex);
 
     // Async handle to perform writes
-    uv_async_init(&tcpctx->server->uv_loop, &tcpctx->asynchandle, onAsyncEvent);
+    uv_async_init(server_handle->loop, &tcpctx->asynchandle, onAsyncEvent);
 
     // Accept the connection
-    uv_tcp_init(&tcpctx->server->uv_loop, &tcpctx->tcphandle);
+    uv_tcp_init(server_handle->loop, &tcpctx->tcphandle);
     if (uv_accept(server_handle, (uv_stream_t*)&tcpctx->tcphandle))
     {
         LOG_err << "uv_accept failed";
@@ -31514,7 +33283,7 @@ void MegaTCPServer::onNewClient(uv_stream_t* server_handle, int status)
         return;
     }
 
-    tcpctx->server->connections.push_back(tcpctx);
+    connectionsOf(tcpctx).push_back(tcpctx);
     if (tcpctx->server->respondNewConnection(tcpctx))
     {
         // Start reading
@@ -31577,8 +33346,8 @@ void MegaTCPServer::onClose(uv_handle_t* handle)
     tcpctx->megaApi->removeTransferListener(tcpctx);
     tcpctx->megaApi->removeRequestListener(tcpctx);
 
-    tcpctx->server->connections.remove(tcpctx);
-    LOG_debug << "Connection closed: " << tcpctx->server->connections.size() << " port = " << tcpctx->server->port << " closing async handle";
+    connectionsOf(tcpctx).remove(tcpctx);
+    LOG_debug << "Connection closed: " << connectionsOf(tcpctx).size() << " port = " << tcpctx->server->port << " closing async handle";
     uv_close((uv_handle_t *)&tcpctx->asynchandle, onAsyncEventClose);
 }
 
@@ -31589,15 +33358,23 @@ void MegaTCPServer::onAsyncEventClose(uv_handle_t *handle)
 
     int port = tcpctx->server->port;
 
-    tcpctx->server->remainingcloseevents--;
-    tcpctx->server->processOnAsyncEventClose(tcpctx);
+    if (tcpctx->worker)
+    {
+        // worker loops finish by themselves once all their handles are closed
+        tcpctx->server->processOnAsyncEventClose(tcpctx);
+    }
+    else
+    {
+        tcpctx->server->remainingcloseevents--;
+        tcpctx->server->processOnAsyncEventClose(tcpctx);
 
-    LOG_verbose << "At onAsyncEventClose port = " << tcpctx->server->port << " remaining=" << tcpctx->server->remainingcloseevents;
+        LOG_verbose << "At onAsyncEventClose port = " << tcpctx->server->port << " remaining=" << tcpctx->server->remainingcloseevents;
 
-    if (!tcpctx->server->remainingcloseevents && tcpctx->server->closing && !tcpctx->server->semaphoresdestroyed)
-    {
-        uv_sem_post(&tcpctx->server->semaphoreStartup);
-        uv_sem_post(&tcpctx->server->semaphoreEnd);
+        if (!tcpctx->server->remainingcloseevents && tcpctx->server->closing && !tcpctx->server->semaphoresdestroyed)
+        {
+            uv_sem_post(&tcpctx->server->semaphoreStartup);
+            uv_sem_post(&tcpctx->server->semaphoreEnd);
+        }
     }
 
     uv_mutex_destroy(&tcpctx->mutex);
@@ -31689,6 +33466,7 @@ MegaTCPContext::MegaTCPContext()
     invalid = false;
 #endif
     server = NULL;
+    worker = NULL;
     megaApi = NULL;
 }
 
@@ -31761,6 +33539,19 @@ void MegaTCPServer::onCloseRequested(uv_async_t *handle)
     uv_close((uv_handle_t *)&tcpServer->exit_handle, onExitHandleClose);
 }
 
+void MegaTCPServer::onWorkerCloseRequested(uv_async_t *handle)
+{
+    MegaTCPWorker *worker = (MegaTCPWorker*) handle->data;
+
+    for (MegaTCPContext *tcpctx : worker->connections)
+    {
+        closeTCPConnection(tcpctx);
+    }
+
+    uv_close((uv_handle_t *)&worker->listener, NULL);
+    uv_close((uv_handle_t *)&worker->exit_handle, NULL);
+}
+
 void MegaTCPServer::closeConnection(MegaTCPContext *tcpctx)
 {
     LOG_verbose << "At closeConnection port = " << tcpctx->server->port;
@@ -31784,12 +33575,20 @@ void MegaTCPServer::closeTCPConnection(MegaTCPContext *tcpctx)
     tcpctx->finished = true;
     if (!uv_is_closing((uv_handle_t*)&tcpctx->tcphandle))
     {
-        tcpctx->server->remainingcloseevents++;
-        LOG_verbose << "At closeTCPConnection port = " << tcpctx->server->port << " remainingcloseevent = " << tcpctx->server->remainingcloseevents;
+        if (!tcpctx->worker)
+        {
+            tcpctx->server->remainingcloseevents++;
+            LOG_verbose << "At closeTCPConnection port = " << tcpctx->server->port << " remainingcloseevent = " << tcpctx->server->remainingcloseevents;
+        }
         uv_close((uv_handle_t*)&tcpctx->tcphandle, onClose);
     }
 }
 
+list<MegaTCPContext*>& MegaTCPServer::connectionsOf(MegaTCPContext *tcpctx)
+{
+    return tcpctx->worker ? tcpctx->worker->connections : tcpctx->server->connections;
+}
+
 void MegaTCPServer::processOnAsyncEventClose(MegaTCPContext *tcpctx) // without this closing breaks!
 {
     LOG_debug << "At supposed to be virtual processOnAsyncEventClose";
@@ -31857,8 +33656,17 @@ void MegaHTTPServer::processReceivedData(MegaTCPContext *tcpctx, ssize_t nread,
 
     LOG_debug << "Received " << nread << " bytes";
 
+    // limit for pipelined requests waiting for the current response
+    static const size_t MAX_PENDING_REQUESTS_SIZE = 65536;
+
     ssize_t parsed = -1;
-    if (nread >= 0)
+    if (nread > 0 && HTTP_PARSER_ERRNO(&httpctx->parser) == HPE_PAUSED)
+    {
+        // a response is in progress, the request will be parsed after it
+        httpctx->pendingRequests.append(buf->base, nread);
+        parsed = httpctx->pendingRequests.size() > MAX_PENDING_REQUESTS_SIZE ? -1 : nread;
+    }
+    else if (nread >= 0)
     {
         if (nread == 0 && httpctx->parser.method == HTTP_PUT) //otherwise it will fail for files >65k in GVFS-DAV
         {
@@ -31868,6 +33676,12 @@ void MegaHTTPServer::processReceivedData(MegaTCPContext *tcpctx, ssize_t nread,
         else
         {
             parsed = http_parser_execute(&httpctx->parser, &parsercfg, buf->base, nread);
+            if (parsed < nread && HTTP_PARSER_ERRNO(&httpctx->parser) == HPE_PAUSED)
+            {
+                // pipelined requests, the parser was paused at the end of the previous one
+                httpctx->pendingRequests.append(buf->base + parsed, nread - parsed);
+                parsed = nread;
+            }
         }
     }
 
@@ -31906,6 +33720,12 @@ void MegaHTTPServer::processWriteFinished(MegaTCPContext* tcpctx, int status)
             {
                 httpctx->resultCode = API_OK;
             }
+
+            if (httpctx->keepAlive)
+            {
+                prepareForNextRequest(httpctx);
+                return;
+            }
         }
 
         closeConnection(httpctx);
@@ -31923,12 +33743,15 @@ void MegaHTTPServer::processWriteFinished(MegaTCPContext* tcpctx, int status)
         if (httpctx->streamingBuffer.availableSpace() >= DirectReadSlot::MAX_DELIVERY_CHUNK)
         {
             httpctx->pause = false;
-            m_off_t start = httpctx->rangeStart + httpctx->rangeWritten + httpctx->streamingBuffer.availableData();
-            m_off_t len =  httpctx->rangeEnd - httpctx->rangeStart - httpctx->rangeWritten - httpctx->streamingBuffer.availableData();
+            m_off_t start = httpctx->streamingPos;
+            m_off_t len = httpctx->streamingEnd - httpctx->streamingPos;
 
-            LOG_debug << "[Streaming] Resuming streaming from " << start << " len: " << len
-                      << " " << httpctx->streamingBuffer.bufferStatus();
-            httpctx->megaApi->startStreaming(httpctx->node, start, len, httpctx);
+            if (len > 0)
+            {
+                LOG_debug << "[Streaming] Resuming streaming from " << start << " len: " << len
+                          << " " << httpctx->streamingBuffer.bufferStatus();
+                httpctx->megaApi->startStreaming(httpctx->node, start, len, httpctx);
+            }
         }
     }
     httpctx->lastBufferLen = 0;
@@ -31956,6 +33779,49 @@ void MegaHTTPServer::processOnAsyncEventClose(MegaTCPContext* tcpctx)
     httpctx->node = NULL;
 }
 
+void MegaHTTPServer::prepareForNextRequest(MegaHTTPContext *httpctx)
+{
+    LOG_debug << "Keeping the connection alive for the next request";
+
+    {
+        uv_mutex_lock(&httpctx->mutex);
+        httpctx->streamingBuffer.freeData(httpctx->lastBufferLen);
+        httpctx->lastBufferLen = 0;
+        uv_mutex_unlock(&httpctx->mutex);
+    }
+
+    // the streaming transfer (if any) keeps filling the buffer, in case the next request continues it
+    if (httpctx->transfer)
+    {
+        httpctx->megaApi->fireOnStreamingFinish(httpctx->transfer.release(), std::make_unique<MegaErrorPrivate>(httpctx->resultCode));
+    }
+
+    // forget the previous request
+    httpctx->resultCode = API_EINTERNAL;
+    httpctx->keepAlive = false;
+    httpctx->range = false;
+    httpctx->rangeStart = -1;
+    httpctx->rangeEnd = -1;
+    httpctx->path.clear();
+    httpctx->nodehandle.clear();
+    httpctx->nodekey.clear();
+    httpctx->nodename.clear();
+    httpctx->nodesize = -1;
+    httpctx->nodepubauth.clear();
+    httpctx->nodeprivauth.clear();
+    httpctx->nodechatauth.clear();
+    httpctx->subpathrelative.clear();
+    httpctx->lastheader.clear();
+    httpctx->host.clear();
+    httpctx->destination.clear();
+    httpctx->depth = -1;
+    httpctx->overwrite = true;
+    httpctx->responding = false;
+
+    // the parser is resumed from the loop, as this could be called while it's running
+    uv_async_send(&httpctx->asynchandle);
+}
+
 bool MegaHTTPServer::respondNewConnection(MegaTCPContext* tcpctx)
 {
     return true;
@@ -32704,6 +34570,12 @@ int MegaHTTPServer::onMessageComplete(http_parser *parser)
     MegaHTTPContext* httpctx = (MegaHTTPContext*) parser->data;
     httpctx->bytesWritten = 0;
     httpctx->size = 0;
+    httpctx->keepAlive = false;
+
+    // the next request (if any) won't be parsed until this one has been answered
+    httpctx->responding = true;
+    http_parser_pause(parser, 1);
+
     httpctx->streamingBuffer.setMaxBufferSize(httpctx->server->getMaxBufferSize());
     httpctx->streamingBuffer.setMaxOutputSize(httpctx->server->getMaxOutputSize());
 
@@ -33571,15 +35443,19 @@ int MegaHTTPServer::streamNode(MegaHTTPContext *httpctx)
         response << "HTTP/1.1 200 OK\r\n";
     }
 
+    // persistent connections are only supported for file data (players requesting consecutive ranges)
+    httpctx->keepAlive = (httpctx->parser.method == HTTP_GET || httpctx->parser.method == HTTP_HEAD)
+            && (len || httpctx->parser.method == HTTP_HEAD)
+            && http_should_keep_alive(&httpctx->parser);
+
     response << "Content-Type: " << mimeType << "\r\n"
-        << "Connection: close\r\n"
+        << "Connection: " << (httpctx->keepAlive ? "keep-alive" : "close") << "\r\n"
         << "Content-Length: " << len << "\r\n"
         << "Access-Control-Allow-Origin: *\r\n"
         << "Accept-Ranges: bytes\r\n"
         << "\r\n";
 
     delete [] mimeType;
-    httpctx->pause = false;
     httpctx->lastBuffer = NULL;
     httpctx->lastBufferLen = 0;
     if (httpctx->transfer)
@@ -33592,26 +35468,62 @@ int MegaHTTPServer::streamNode(MegaHTTPContext *httpctx)
     httpctx->streamingBuffer.setDuration(httpctx->node->getDuration());
 
     string resstr = response.str();
-    if (httpctx->parser.method != HTTP_HEAD)
+    if (httpctx->parser.method == HTTP_HEAD)
     {
-        httpctx->streamingBuffer.init(std::max(static_cast<size_t>(len), resstr.size()));
-        httpctx->server->setMaxBufferSize(httpctx->streamingBuffer.getMaxBufferSize());
-        httpctx->server->setMaxOutputSize(httpctx->streamingBuffer.getMaxOutputSize());
-        httpctx->size = len;
+        // data kept from a previous request on this connection stays there for the next one
+        sendHeaders(httpctx, &resstr, httpctx->streamingHandle != INVALID_HANDLE);
+        return 0;
     }
 
-    sendHeaders(httpctx, &resstr);
-    if (httpctx->parser.method == HTTP_HEAD)
+    httpctx->size = len;
+    httpctx->rangeWritten = 0;
+
+    // continue the streaming transfer of a previous request on this connection if it has reached this range,
+    // instead of starting a new one: the buffered data is sent right away
+    if (httpctx->streamingHandle == node->getHandle())
     {
-        return 0;
+        bool reuse = false;
+        uv_mutex_lock(&httpctx->mutex);
+        m_off_t bufferedStart = httpctx->streamingPos - static_cast<m_off_t>(httpctx->streamingBuffer.availableData());
+        if (start >= bufferedStart && start <= httpctx->streamingPos && httpctx->rangeEnd <= httpctx->streamingEnd)
+        {
+            httpctx->streamingBuffer.discard(static_cast<size_t>(start - bufferedStart));
+            reuse = true;
+        }
+        uv_mutex_unlock(&httpctx->mutex);
+
+        if (reuse)
+        {
+            LOG_debug << "Continuing the streaming of a previous request. From " << start << "  size " << len
+                      << " " << httpctx->streamingBuffer.bufferStatus();
+            sendHeaders(httpctx, &resstr, true);
+            return 0;
+        }
     }
 
+    stopStreaming(httpctx);
+    httpctx->pause = false;
+    httpctx->streamingBuffer.init(std::max(static_cast<size_t>(len), resstr.size()));
+    httpctx->server->setMaxBufferSize(httpctx->streamingBuffer.getMaxBufferSize());
+    httpctx->server->setMaxOutputSize(httpctx->streamingBuffer.getMaxOutputSize());
+
+    sendHeaders(httpctx, &resstr);
+
     LOG_debug << "Requesting range. From " << start << "  size " << len;
-    httpctx->rangeWritten = 0;
     if (start || len)
     {
+        // in persistent connections, the transfer goes on after the range (until the buffer is full),
+        // in case the next request continues it
+        m_off_t streamingLen = httpctx->keepAlive ? totalSize - start : len;
+
+        uv_mutex_lock(&httpctx->mutex);
         httpctx->streamingBuffer.reset(!httpctx->lastBufferLen, resstr.size());
-        httpctx->megaApi->startStreaming(node, start, len, httpctx);
+        httpctx->streamingHandle = node->getHandle();
+        httpctx->streamingPos = start;
+        httpctx->streamingEnd = start + streamingLen;
+        uv_mutex_unlock(&httpctx->mutex);
+
+        httpctx->megaApi->startStreaming(node, start, streamingLen, httpctx);
     }
     else
     {
@@ -33622,11 +35534,42 @@ int MegaHTTPServer::streamNode(MegaHTTPContext *httpctx)
     return 0;
 }
 
-void MegaHTTPServer::sendHeaders(MegaHTTPContext *httpctx, string *headers)
+void MegaHTTPServer::stopStreaming(MegaHTTPContext *httpctx)
+{
+    if (httpctx->streamingHandle == INVALID_HANDLE)
+    {
+        return;
+    }
+
+    // forget the data of the streaming transfer kept from a previous request,
+    // the transfer itself ends with the next data it delivers
+    uv_mutex_lock(&httpctx->mutex);
+    httpctx->streamingBuffer.discard(httpctx->streamingBuffer.availableData());
+    httpctx->streamingHandle = INVALID_HANDLE;
+    httpctx->streamingPos = -1;
+    httpctx->streamingEnd = -1;
+    uv_mutex_unlock(&httpctx->mutex);
+}
+
+void MegaHTTPServer::sendHeaders(MegaHTTPContext *httpctx, string *headers, bool beforeBufferedData)
 {
     LOG_debug << "Response headers: " << *headers;
-    httpctx->streamingBuffer.append(headers->data(), headers->size());
+    if (!beforeBufferedData)
+    {
+        stopStreaming(httpctx);
+    }
+
+    uv_mutex_lock(&httpctx->mutex);
+    if (beforeBufferedData)
+    {
+        httpctx->streamingBuffer.prepend(headers->data(), headers->size());
+    }
+    else
+    {
+        httpctx->streamingBuffer.append(headers->data(), headers->size());
+    }
     uv_buf_t resbuf = httpctx->streamingBuffer.nextBuffer();
+    uv_mutex_unlock(&httpctx->mutex);
     httpctx->size += headers->size();
     httpctx->lastBuffer = resbuf.base;
     httpctx->lastBufferLen = resbuf.len;
@@ -33681,6 +35624,24 @@ void MegaHTTPServer::processAsyncEvent(MegaTCPContext* tcpctx)
         return;
     }
 
+    if (!httpctx->responding && HTTP_PARSER_ERRNO(&httpctx->parser) == HPE_PAUSED)
+    {
+        // the previous response has been sent, go on with the next request
+        http_parser_init(&httpctx->parser, HTTP_REQUEST);
+
+        string pending;
+        pending.swap(httpctx->pendingRequests);
+        if (pending.size())
+        {
+            uv_buf_t buf = uv_buf_init(&pending[0], static_cast<unsigned>(pending.size()));
+            processReceivedData(httpctx, static_cast<ssize_t>(pending.size()), &buf);
+            if (httpctx->finished)
+            {
+                return;
+            }
+        }
+    }
+
     uv_mutex_lock(&httpctx->mutex_responses);
     while (httpctx->responses.size())
     {
@@ -33744,7 +35705,9 @@ void MegaHTTPServer::sendNextBytes(MegaHTTPContext *httpctx)
         return;
     }
 
-    uv_buf_t resbuf = httpctx->streamingBuffer.nextBuffer();
+    // data buffered beyond the requested range is kept for the next request
+    m_off_t remaining = std::max<m_off_t>(httpctx->size - httpctx->bytesWritten, 0);
+    uv_buf_t resbuf = httpctx->streamingBuffer.nextBuffer(static_cast<size_t>(remaining));
     uv_mutex_unlock(&httpctx->mutex);
 
     if (!resbuf.len)
@@ -33811,6 +35774,11 @@ MegaHTTPContext::MegaHTTPContext()
     overwrite = true; //GVFS-DAV via command line does not include this header (assumed true)
     lastBuffer = NULL;
     lastBufferLen = 0;
+    keepAlive = false;
+    responding = false;
+    streamingHandle = INVALID_HANDLE;
+    streamingPos = -1;
+    streamingEnd = -1;
 
     // Mutex to protect the data buffer
     uv_mutex_init(&mutex_responses);
@@ -33851,6 +35819,14 @@ bool MegaHTTPContext::onTransferData(MegaApi *, MegaTransfer *transfer, char *bu
 
     // append the data to the buffer
     uv_mutex_lock(&mutex);
+    m_off_t position = transfer->getStartPos() + transfer->getTransferredBytes() - static_cast<m_off_t>(size);
+    if (position != streamingPos)
+    {
+        LOG_debug << "[Streaming] Discarding data of a previous streaming transfer at " << position;
+        uv_mutex_unlock(&mutex);
+        return false;
+    }
+
     long long remaining = size + (transfer->getTotalBytes() - transfer->getTransferredBytes());
     long long availableSpace = streamingBuffer.availableSpace();
     if ((remaining > availableSpace) && ((availableSpace - size) < static_cast<long long>(DirectReadSlot::MAX_DELIVERY_CHUNK)))
@@ -33858,7 +35834,23 @@ bool MegaHTTPContext::onTransferData(MegaApi *, MegaTransfer *transfer, char *bu
         LOG_debug << "[Streaming] Buffer full: Pausing streaming. " << streamingBuffer.bufferStatus();
         pause = true;
     }
-    streamingBuffer.append(buffer, size);
+    // queue the transfer's own data rather than a copy of it, if it can be kept
+    size_t appended;
+    if (auto owner = static_cast<MegaTransferPrivate*>(transfer)->getLastBytesOwner())
+    {
+        appended = streamingBuffer.append(std::move(owner), buffer, size);
+    }
+    else
+    {
+        appended = streamingBuffer.append(buffer, size);
+    }
+
+    streamingPos += static_cast<m_off_t>(appended);
+    if (appended < size)
+    {
+        // the rest will be requested again when there is room for it
+        pause = true;
+    }
     uv_mutex_unlock(&mutex);
 
     // notify the HTTP server
@@ -33994,6 +35986,7 @@ void MegaHTTPContext::onRequestFinish(MegaApi *, MegaRequest *request, MegaError
     }
     else if (request->getType() == MegaRequest::TYPE_GET_PUBLIC_NODE)
     {
+        delete node;
         node = request->getPublicMegaNode();
         nodereceived = true;
     }
@@ -36377,7 +38370,15 @@ bool MegaFTPDataContext::onTransferData(MegaApi *, MegaTransfer *transfer, char
         LOG_debug << "[Streaming] Buffer full: Pausing streaming. " << streamingBuffer.bufferStatus();
         pause = true;
     }
-    streamingBuffer.append(buffer, size);
+    // queue the transfer's own data rather than a copy of it, if it can be kept
+    if (auto owner = static_cast<MegaTransferPrivate*>(transfer)->getLastBytesOwner())
+    {
+        streamingBuffer.append(std::move(owner), buffer, size);
+    }
+    else
+    {
+        streamingBuffer.append(buffer, size);
+    }
     uv_mutex_unlock(&mutex);
 
     // notify the HTTP server
@@ -37200,6 +39201,7 @@ const char *MegaEventPrivate::getEventString(int type)
         case MegaEvent::EVENT_UPGRADE_SECURITY: return "UPGRADE_SECURITY";
         case MegaEvent::EVENT_DOWNGRADE_ATTACK: return "DOWNGRADE_ATTACK";
         case MegaEvent::EVENT_CREDIT_CARD_EXPIRY: return "CREDIT_CARD_EXPIRY";
+        case MegaEvent::EVENT_DEFERRED_CACHE_LOADED: return "DEFERRED_CACHE_LOADED";
     }
 
     return "UNKNOWN";
@@ -37370,6 +39372,138 @@ MegaNodeList *MegaChildrenListsPrivate::getFolderList()
     return folders.get();
 }
 
+void NodeChangeBuffer::setCapacity(size_t capacity)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    mRing.assign(capacity, Change());
+    mPositions.clear();
+    mHead = 0;
+    mCount = 0;
+    mIncomplete = false;
+}
+
+bool NodeChangeBuffer::enabled() const
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    return !mRing.empty();
+}
+
+bool NodeChangeBuffer::push(const std::vector<Change>& changes)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    if (mRing.empty())
+    {
+        return false;
+    }
+
+    bool wasIdle = idle();
+    for (const Change& change : changes)
+    {
+        auto it = mPositions.find(change.mHandle);
+        if (it != mPositions.end())
+        {
+            Change& pending = mRing[it->second];
+            pending.mChanges |= change.mChanges;
+            pending.mParentHandle = change.mParentHandle;
+            continue;
+        }
+
+        if (mCount == mRing.size())
+        {
+            LOG_warn << "Buffer of node changes is full (" << mCount << "), pending changes dropped";
+            mPositions.clear();
+            mHead = 0;
+            mCount = 0;
+            mIncomplete = true;
+        }
+
+        size_t position = (mHead + mCount) % mRing.size();
+        mRing[position] = change;
+        mPositions[change.mHandle] = position;
+        ++mCount;
+    }
+
+    return wasIdle && !idle();
+}
+
+bool NodeChangeBuffer::setIncomplete()
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    if (mRing.empty())
+    {
+        return false;
+    }
+
+    bool wasIdle = idle();
+    mPositions.clear();
+    mHead = 0;
+    mCount = 0;
+    mIncomplete = true;
+    return wasIdle;
+}
+
+std::vector<NodeChangeBuffer::Change> NodeChangeBuffer::pop(size_t maxCount, bool& incomplete)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+
+    size_t count = maxCount ? std::min(maxCount, mCount) : mCount;
+    std::vector<Change> changes;
+    changes.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        changes.push_back(mRing[mHead]);
+        mPositions.erase(mRing[mHead].mHandle);
+        mHead = (mHead + 1) % mRing.size();
+        --mCount;
+    }
+
+    incomplete = mIncomplete;
+    mIncomplete = false;
+    return changes;
+}
+
+size_t NodeChangeBuffer::size() const
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    return mCount;
+}
+
+MegaNodeChangeListPrivate::MegaNodeChangeListPrivate(std::vector<NodeChangeBuffer::Change>&& changes, bool incomplete)
+  : mChanges(std::move(changes))
+  , mIncomplete(incomplete)
+{
+}
+
+MegaNodeChangeList* MegaNodeChangeListPrivate::copy() const
+{
+    return new MegaNodeChangeListPrivate(std::vector<NodeChangeBuffer::Change>(mChanges), mIncomplete);
+}
+
+int MegaNodeChangeListPrivate::size() const
+{
+    return static_cast<int>(mChanges.size());
+}
+
+MegaHandle MegaNodeChangeListPrivate::getHandle(int i) const
+{
+    return i >= 0 && i < size() ? mChanges[i].mHandle : INVALID_HANDLE;
+}
+
+MegaHandle MegaNodeChangeListPrivate::getParentHandle(int i) const
+{
+    return i >= 0 && i < size() ? mChanges[i].mParentHandle : INVALID_HANDLE;
+}
+
+uint64_t MegaNodeChangeListPrivate::getChanges(int i) const
+{
+    return i >= 0 && i < size() ? mChanges[i].mChanges : 0;
+}
+
+bool MegaNodeChangeListPrivate::isIncomplete() const
+{
+    return mIncomplete;
+}
+
 MegaChildrenListsPrivate::MegaChildrenListsPrivate()
     : folders(new MegaNodeListPrivate())
     , files(new MegaNodeListPrivate())
@@ -38303,6 +40437,41 @@ bool MegaCancelTokenPrivate::isCancelled() const
     return cancelFlag.isCancelled();
 }
 
+void MegaUploadBatchPrivate::add(const char *localPath, MegaNode *parent, const char *fileName, int64_t mtime, const char *appData, bool isSourceTemporary, bool startFirst, MegaCancelToken *cancelToken)
+{
+    mUploads.push_back(Upload{ optionalString(localPath),
+                               unique_ptr<MegaNode>(parent ? parent->copy() : nullptr),
+                               optionalString(fileName),
+                               mtime,
+                               optionalString(appData),
+                               isSourceTemporary,
+                               startFirst,
+                               convertToCancelToken(cancelToken) });
+}
+
+unsigned int MegaUploadBatchPrivate::size() const
+{
+    return static_cast<unsigned int>(mUploads.size());
+}
+
+void MegaDownloadBatchPrivate::add(MegaNode* node, const char* localPath, const char *customName, const char *appData, bool startFirst, MegaCancelToken *cancelToken, int collisionCheck, int collisionResolution, bool undelete)
+{
+    mDownloads.push_back(Download{ unique_ptr<MegaNode>(node ? node->copy() : nullptr),
+                                   optionalString(localPath),
+                                   optionalString(customName),
+                                   optionalString(appData),
+                                   startFirst,
+                                   convertToCancelToken(cancelToken),
+                                   collisionCheck,
+                                   collisionResolution,
+                                   undelete });
+}
+
+unsigned int MegaDownloadBatchPrivate::size() const
+{
+    return static_cast<unsigned int>(mDownloads.size());
+}
+
 /* MegaVpnCredentialsPrivate BEGIN */
 MegaVpnCredentialsPrivate::MegaVpnCredentialsPrivate(MapSlotIDToCredentialInfo&& mapSlotIDToCredentialInfo,
                                                     MapClusterPublicKeys&& mapClusterPubKeys,
@@ -85,6 +85,12 @@ const unsigned MegaClient::MAX_RAIDTRANSFERS_FOR_MOBILE = std::max<unsigned>(MAX
 // i.e., there must be at least this number of raid transfers to let us predict whether the next download transfer will be raided or non-raided
 const unsigned MegaClient::MEANINGFUL_PORTION_OF_MAXTRANSFERS_QUEUE_FOR_RAID_PREDICTIVE_SYSTEM = std::max<unsigned>(MAXTRANSFERS / 6, 1);
 
+// uploads smaller than this are dominated by per-file overhead rather than by bandwidth
+const m_off_t MegaClient::MAX_TINY_UPLOAD_SIZE = 64 * 1024;
+
+// number of tiny uploads that are accounted as a single transfer slot
+const unsigned MegaClient::TINY_UPLOADS_PER_SLOT = 4;
+
 // maximum number of queued putfa before halting the upload queue
 const int MegaClient::MAXQUEUEDFA = 30;
 
@@ -1639,6 +1645,9 @@ void MegaClient::init()
 
 MegaClient::MegaClient(MegaApp* a, shared_ptr<Waiter> w, HttpIO* h, DbAccess* d, GfxProc* g, const char* k, const char* u, unsigned workerThreadCount, ClientType clientType)
    : mAsyncQueue(*w, workerThreadCount)
+#ifdef USE_MEDIAINFO
+   , mMediaPropertiesQueue(*w, std::min(workerThreadCount, 2u))
+#endif
    , mCachedStatus(this)
    , useralerts(*this)
    , btugexpiration(rng)
@@ -1863,9 +1872,21 @@ std::string MegaClient::getWritableLinkAuthKey(handle nodeHandle)
 void MegaClient::exec()
 {
     CodeCounter::ScopeTimer ccst(performanceStats.execFunction);
+    static auto& execLatency = Metrics::registry().histogram("MegaClient_exec");
+    Metrics::ScopedLatency execTimer(execLatency);
+    TRACE_SPAN("MegaClient_exec");
 
     WAIT_CLASS::bumpds();
 
+    checkScGroupCommit();
+
+    if (mLoadingDeferredScRecords)
+    {
+        // new commands of the app may need them, otherwise they are loaded a few at a time
+        bool needed = fetchnodesAlreadyCompletedThisSession && reqs.readyToSend();
+        loadDeferredScRecords(needed ? mDeferredScRecords.size() : DEFERRED_SCRECORDS_PER_EXEC);
+    }
+
     if (overquotauntil && overquotauntil < Waiter::ds)
     {
         overquotauntil = 0;
@@ -2048,8 +2069,8 @@ void MegaClient::exec()
                                 {
                                     if (std::shared_ptr<Node> n = nodeByHandle(fa->th.nodeHandle()))
                                     {
-                                        LOG_debug << "Attaching file attribute to Node";
-                                        reqs.add(new CommandAttachFA(this, n->nodehandle, fa->type, fah, fa->tag));
+                                        LOG_debug << "File attribute to be attached to Node";
+                                        pendingattachfa[n->nodehandle].push_back({ fa->type, fah, fa->tag });
                                     }
                                     else
                                     {
@@ -2149,6 +2170,11 @@ void MegaClient::exec()
             }
         }
 
+        if (pendingattachfa.size())
+        {
+            attachpendingfa();
+        }
+
         if (btpfa.armed())
         {
             faretrying = false;
@@ -2268,6 +2294,7 @@ void MegaClient::exec()
             {
                 // handle retry reason for requests
                 retryreason_t reason = RETRY_NONE;
+                dstime serverDelay = 0;
 
                 if (pendingcs->status == REQ_SUCCESS || pendingcs->status == REQ_FAILURE)
                 {
@@ -2354,7 +2381,7 @@ void MegaClient::exec()
                                 pendingcs = NULL;
 
                                 notifypurge();
-                                if (sctable && pendingsccommit && !reqs.readyToSend() && scsn.ready())
+                                if (sctable && pendingsccommit && !reqs.readyToSend() && scsn.ready() && !insideScGroupCommitWindow())
                                 {
                                     LOG_debug << "Executing postponed DB commit 2 (sessionid: " << string(sessionid, sizeof(sessionid)) << ")";
                                     sctable->commit();
@@ -2362,6 +2389,7 @@ void MegaClient::exec()
                                     sctable->begin();
                                     app->notify_dbcommit();
                                     pendingsccommit = false;
+                                    mLastScCommit = Waiter::ds;
                                 }
 
                                 if (auto completion = std::move(mOnCSCompletion))
@@ -2484,15 +2512,21 @@ void MegaClient::exec()
                             }
                         }
 
-                        // failure, repeat with capped exponential backoff
+                        // failure, repeat with capped, jittered backoff
                         app->request_response_progress(pendingcs->bufpos, -1);
+                        serverDelay = pendingcs->retryafter > 0 ? dstime(pendingcs->retryafter * 10) : 0;
 
                         delete pendingcs;
                         pendingcs = NULL;
 
                         if (!reason) reason = RETRY_UNKNOWN;
 
-                        btcs.backoff();
+                        btcs.backoffDecorrelated();
+                        if (serverDelay > btcs.retryin())
+                        {
+                            // what the servers request, spread over up to half of it more
+                            btcs.backoff(serverDelay + rng.genuint32(serverDelay / 2 + 1));
+                        }
                         app->notify_retry(btcs.retryin(), reason);
                         csretrying = true;
                         LOG_warn << "Retrying cs request in " << btcs.retryin() << " ds";
@@ -2521,8 +2555,9 @@ void MegaClient::exec()
                     pendingcs_serverBusySent = false;
 
                     bool v3;
+                    bool streaming;
                     string idempotenceId;
-                    *pendingcs->out = reqs.serverrequest(pendingcs->includesFetchingNodes, v3, this, idempotenceId);
+                    *pendingcs->out = reqs.serverrequest(pendingcs->includesFetchingNodes, streaming, v3, this, idempotenceId);
 
                     pendingcs->posturl = httpio->APIURL;
                     pendingcs->posturl.append("cs?id=");
@@ -2544,9 +2579,14 @@ void MegaClient::exec()
                     }
                     pendingcs->type = REQ_JSON;
 
-                    if (pendingcs->includesFetchingNodes && !mNodeManager.hasCacheLoaded())
+                    if (streaming)
+                    {
+                        // the command processes its response with JSON filters as it arrives
+                        pendingcs->mChunked = true;
+                    }
+                    else if (pendingcs->includesFetchingNodes && !mNodeManager.hasCacheLoaded())
                     {
-                        // Currently only fetchnodes requests can take advantage of chunked processing
+                        // fetchnodes only needs chunked processing when the nodes are not cached
                         // However VPN client shouldn't need it, because it'll receive a minimal response
                         pendingcs->mChunked = !isClientType(ClientType::VPN);
                     }
@@ -2590,7 +2630,7 @@ void MegaClient::exec()
                     error e = (error)atoi(pendingscUserAlerts->in.c_str());
                     if (e == API_EAGAIN || e == API_ERATELIMIT)
                     {
-                        btsc.backoff();
+                        btsc.backoffDecorrelated();
                         pendingscUserAlerts.reset();
                         LOG_warn << "Backing off before retrying useralerts request: " << btsc.retryin();
                         break;
@@ -2739,8 +2779,8 @@ void MegaClient::exec()
                 }
                 else
                 {
-                    // failure, repeat with capped exponential backoff
-                    btsc.backoff();
+                    // failure, repeat with capped, jittered backoff
+                    btsc.backoffDecorrelated();
                     LOG_debug << clientname << "sc backing off with delay ds: " << btsc.retryin();
                 }
                 break;
@@ -2962,6 +3002,10 @@ void MegaClient::exec()
         {
             TransferDbCommitter committer(tctable);
 
+            // only walk the files of the slots if any cancel tokens were activated
+            bool cancelsOccurred = CancelToken::haveAnyCancelsOccurredSince(lastKnownSlotsCancelCount);
+            ++performanceStats.transferslotPasses;
+
             while (slotit != tslots.end())
             {
                 transferslot_list::iterator it = slotit;
@@ -2969,7 +3013,11 @@ void MegaClient::exec()
                 slotit++;
 
                 // remove transfer files whose MegaTransfer associated has been cancelled (via cancel token)
-                (*it)->transfer->removeCancelledTransferFiles(&committer);
+                if (cancelsOccurred)
+                {
+                    (*it)->transfer->removeCancelledTransferFiles(&committer);
+                }
+
                 if ((*it)->transfer->files.empty())
                 {
                     // this also removes it from slots
@@ -2978,7 +3026,16 @@ void MegaClient::exec()
                 else if ((!xferpaused[(*it)->transfer->type] || (*it)->transfer->isForSupport())
                         && (!(*it)->retrying || (*it)->retrybt.armed()))
                 {
-                    (*it)->doio(this, committer);
+                    // slots whose connections are waiting for data are left for a later pass
+                    if ((*it)->retrying || (*it)->needsService(this))
+                    {
+                        ++performanceStats.transferslotsServiced;
+                        (*it)->doio(this, committer);
+                    }
+                    else
+                    {
+                        ++performanceStats.transferslotsSkipped;
+                    }
                 }
             }
         }
@@ -3099,6 +3156,9 @@ void MegaClient::exec()
 
         httpio->updatedownloadspeed();
         httpio->updateuploadspeed();
+
+        // Whatever putnodes this pass gathered go out together
+        sendCoalescedPutnodes();
     } while (httpio->doio() || execdirectreads() || (!pendingcs && reqs.readyToSend() && btcs.armed()));
 
 
@@ -3113,6 +3173,9 @@ void MegaClient::exec()
         }
     }
 
+    static auto& transferSlotsGauge = Metrics::registry().gauge("transfer_slots");
+    transferSlotsGauge.set(static_cast<int64_t>(tslots.size()));
+
 #ifdef MEGA_MEASURE_CODE
     ccst.complete();
     performanceStats.transfersActiveTime.start(!tslots.empty() && !performanceStats.transfersActiveTime.inprogress());
@@ -3163,6 +3226,11 @@ int MegaClient::preparewait()
     // get current dstime and clear wait events
     WAIT_CLASS::bumpds();
 
+    if (mLoadingDeferredScRecords)
+    {
+        return Waiter::NEEDEXEC;
+    }
+
 #ifdef ENABLE_SYNC
     if (!syncs.clientThreadActions.empty())
     {
@@ -3277,6 +3345,20 @@ int MegaClient::preparewait()
             btugexpiration.update(&nds);
         }
 
+        // postponed group commit
+        if (pendingsccommit && mScGroupCommitWindow)
+        {
+            dstime commitds = mLastScCommit + mScGroupCommitWindow;
+            if (commitds > Waiter::ds && commitds < nds)
+            {
+                nds = commitds;
+            }
+            else if (commitds <= Waiter::ds)
+            {
+                nds = 0;
+            }
+        }
+
         // detect stuck network
         if (EVER(httpio->lastdata) && !pendingcs)
         {
@@ -3430,6 +3512,16 @@ int MegaClient::checkevents()
     {
         r |= gfx->checkevents(waiter.get());
     }
+#ifdef USE_MEDIAINFO
+    if (mediaFileInfo.checkMediaPropertiesExtractions(this))
+    {
+        r |= Waiter::NEEDEXEC;
+    }
+#endif
+    if (checkPendingKeyDerivation())
+    {
+        r |= Waiter::NEEDEXEC;
+    }
     return r;
 }
 
@@ -3517,24 +3609,41 @@ bool MegaClient::abortbackoff(bool includexfers)
     return r;
 }
 
+void MegaClient::indexCancelToken(Transfer* transfer, const CancelToken& token)
+{
+    if (const void* id = token.id())
+    {
+        if (transfer->mCancelTokenIds.insert(id).second)
+        {
+            mTransfersByCancelToken[id].insert(transfer);
+        }
+    }
+}
+
 // activate enough queued transfers as necessary to keep the system busy - but not too busy
 void MegaClient::dispatchTransfers()
 {
-    if (CancelToken::haveAnyCancelsOccurredSince(lastKnownCancelCount))
+    vector<const void*> cancelledTokens;
+    if (CancelToken::haveAnyCancelsOccurredSince(lastKnownCancelCount, cancelledTokens))
     {
         // first deal with the possibility of cancelled transfers
         // only do this if any cancel tokens were activated
-        // as walking the whole list on every exec() would be too expensive for large sets of transfers
-        static direction_t putget[] = { PUT, GET };
-        for (direction_t direction : putget)
+        TransferDbCommitter committer(tctable);
+        if (!cancelledTokens.empty())
         {
-            TransferDbCommitter committer(tctable);
-            auto& directionList = multi_transfers[direction];
-            for (auto i = directionList.begin(); i != directionList.end(); )
+            // only the transfers with files of those tokens
+            std::set<Transfer*> cancelled;
+            for (const void* id : cancelledTokens)
             {
-                auto it = i++;  // in case this entry is removed
-                Transfer* transfer = it->second;
+                auto it = mTransfersByCancelToken.find(id);
+                if (it != mTransfersByCancelToken.end())
+                {
+                    cancelled.insert(it->second.begin(), it->second.end());
+                }
+            }
 
+            for (Transfer* transfer : cancelled)
+            {
                 transfer->removeCancelledTransferFiles(&committer);
                 if (transfer->files.empty())
                 {
@@ -3543,6 +3652,27 @@ void MegaClient::dispatchTransfers()
                 }
             }
         }
+        else
+        {
+            // the tokens are unknown, walking the whole list is expensive for large sets of transfers
+            static direction_t putget[] = { PUT, GET };
+            for (direction_t direction : putget)
+            {
+                auto& directionList = multi_transfers[direction];
+                for (auto i = directionList.begin(); i != directionList.end(); )
+                {
+                    auto it = i++;  // in case this entry is removed
+                    Transfer* transfer = it->second;
+
+                    transfer->removeCancelledTransferFiles(&committer);
+                    if (transfer->files.empty())
+                    {
+                        // this also removes it from slots
+                        transfer->removeAndDeleteSelf(TRANSFERSTATE_CANCELLED);
+                    }
+                }
+            }
+        }
     }
 
     // do we have any transfer slots available?
@@ -3578,6 +3708,13 @@ void MegaClient::dispatchTransfers()
     };
     std::array<counter, 6> counters;
 
+#ifdef ENABLE_SYNC
+    // slots taken by each sync, per direction. A sync can take its fair share of MAXTRANSFERS among
+    // the syncs seen so far (with active transfers or queued ones), so one sync with a huge queue can't
+    // keep the others waiting. A sync on its own can still take all of them
+    map<handle, std::array<double, 2>> syncSlots;
+#endif
+
     // Exponential function to calculate the maximum transfer queue size
     // This function uses a threshold (in KB/s) so the function has two different behaviors:
     // 1. Before the threshold, the function grows slowly from the minSize to the maxSize
@@ -3686,8 +3823,17 @@ void MegaClient::dispatchTransfers()
             }
         }
         auto transferWeight = transferWeightKnown != 0.0 ? transferWeightKnown : calcTransferWeight(tc.direction);
+        transferWeight *= transferSlotWeight(ts->transfer);
         counters[tc.index()].addexisting(ts->transfer->size, ts->progressreported, transferWeight);
         counters[tc.directionIndex()].addexisting(ts->transfer->size, ts->progressreported, transferWeight);
+
+#ifdef ENABLE_SYNC
+        handle syncId = syncOfTransfer(ts->transfer);
+        if (syncId != UNDEF)
+        {
+            syncSlots[syncId][tc.directionIndex()] += transferWeight;
+        }
+#endif
     }
     if (tslots.empty())
     {
@@ -3716,7 +3862,7 @@ void MegaClient::dispatchTransfers()
             return true;
     };
 
-    std::function<bool(Transfer*)> testAddTransferFunction = [&counters, this, &calcTransferWeight](Transfer* t)
+    std::function<bool(Transfer*)> testAddTransferFunction = [&, this](Transfer* t)
         {
             TransferCategory tc(t);
 
@@ -3737,7 +3883,25 @@ void MegaClient::dispatchTransfers()
                 return false;
             }
 
-            auto transferWeight = calcTransferWeight(tc.direction);
+            // tiny uploads are packed several per slot, so more of their upload URLs
+            // are requested within the same batch and their putnodes can be coalesced
+            auto transferWeight = calcTransferWeight(tc.direction) * transferSlotWeight(t);
+
+#ifdef ENABLE_SYNC
+            handle syncId = syncOfTransfer(t);
+            if (syncId != UNDEF)
+            {
+                // the sync is registered even if it gets nothing now, so the shares of the others shrink
+                double& syncUsed = syncSlots[syncId][tc.directionIndex()];
+                double share = std::max(1.0, static_cast<double>(MAXTRANSFERS) / static_cast<double>(syncSlots.size()));
+                if (syncUsed + transferWeight > share)
+                {
+                    return false;
+                }
+                syncUsed += transferWeight;
+            }
+#endif
+
             counters[tc.index()].addnew(t->size, transferWeight);
             counters[tc.directionIndex()].addnew(t->size, transferWeight);
 
@@ -3984,7 +4148,7 @@ void MegaClient::dispatchTransfers()
                             if (!gfxdisabled && gfx && gfx->isgfx(nexttransfer->localfilename))
                             {
                                 // we want all imagery to be safely tucked away before completing the upload, so we bump minfa
-                                int bitmask = gfx->gendimensionsputfa(nexttransfer->localfilename, NodeOrUploadHandle(nexttransfer->uploadhandle), nexttransfer->transfercipher(), -1);
+                                int bitmask = gfx->gendimensionsputfa(nexttransfer->localfilename, NodeOrUploadHandle(nexttransfer->uploadhandle), nexttransfer->transfercipher(), -1, nexttransfer->fingerprint());
 
                                 if (bitmask & (1 << GfxProc::THUMBNAIL))
                                 {
@@ -3996,10 +4160,35 @@ void MegaClient::dispatchTransfers()
                                     fileAttributesUploading.setFileAttributePending(nexttransfer->uploadhandle, GfxProc::PREVIEW, nexttransfer);
                                 }
                             }
+
+#ifdef USE_MEDIAINFO
+                            // the media properties are extracted while the data is uploaded, so they are ready for putnodes
+                            string ext;
+                            if (nexttransfer->size >= 16 && !mediaFileInfo.mediaCodecsFailed &&
+                                fsaccess->getextension(nexttransfer->localfilename, ext) &&
+                                MediaProperties::isMediaFilenameExt(ext))
+                            {
+                                mediaFileInfo.startMediaPropertiesExtraction(this, nexttransfer->localfilename, nexttransfer->uploadhandle);
+                            }
+#endif
                         }
                     }
                     else
                     {
+                        // very large downloads don't fill the OS cache with data that won't be read again soon
+                        if (nexttransfer->size >= TransferSlot::MIN_FILESIZE_FOR_DIRECT_WRITES && ts->fa->enableDirectWrites())
+                        {
+                            LOG_debug << "Direct writes enabled for " << nexttransfer->localfilename;
+                        }
+
+                        // the pieces of the parallel (and RAID) connections arrive out of order: reserving the space
+                        // keeps the file from fragmenting as they fill it
+                        if (preallocateDownloads && nexttransfer->size >= TransferSlot::MIN_FILESIZE_FOR_PREALLOCATION
+                                && ts->fa->fpreallocate(nexttransfer->size))
+                        {
+                            LOG_debug << "Disk space reserved for " << nexttransfer->localfilename;
+                        }
+
                         for (file_list::iterator it = nexttransfer->files.begin();
                             it != nexttransfer->files.end(); it++)
                         {
@@ -4347,6 +4536,10 @@ void MegaClient::locallogout(bool removecaches, bool keepSyncsConfigFile)
     executingLocalLogout = true;
 
     mAsyncQueue.clearDiscardable();
+    mPendingKeyDerivation.reset();
+#ifdef USE_MEDIAINFO
+    mMediaPropertiesQueue.clearDiscardable();
+#endif
 
     mV1PswdVault.reset();
 
@@ -4414,6 +4607,7 @@ void MegaClient::locallogout(bool removecaches, bool keepSyncsConfigFile)
     unshareablekey.clear();
     mFolderLink.mPublicHandle = UNDEF;
     mFolderLink.mWriteAuth.clear();
+    mFolderLink.mFetchRoot = NodeHandle();
     cachedscsn = UNDEF;
     achievements_enabled = false;
     isNewSession = false;
@@ -4441,6 +4635,8 @@ void MegaClient::locallogout(bool removecaches, bool keepSyncsConfigFile)
 #endif
     mSets.clear();
     mSetElements.clear();
+    mDeferredScRecords.clear();
+    mLoadingDeferredScRecords = false;
     stopSetPreview();
 
 #ifdef ENABLE_CHAT
@@ -4483,6 +4679,7 @@ void MegaClient::locallogout(bool removecaches, bool keepSyncsConfigFile)
     mNodeManager.reset();
 
     reqs.clear();
+    mCoalescedPutnodes.clear();
 
     delete pendingcs;
     pendingcs = NULL;
@@ -4502,6 +4699,7 @@ void MegaClient::locallogout(bool removecaches, bool keepSyncsConfigFile)
 
     queuedfa.clear();
     activefa.clear();
+    pendingattachfa.clear();
     pendinghttp.clear();
     bttimers.clear();
     xferpaused[PUT] = false;
@@ -4700,6 +4898,12 @@ void MegaClient::httprequest(const char *url, int method, bool binary, const cha
 // process server-client request
 bool MegaClient::procsc()
 {
+    // action packets apply to the whole state of the local cache
+    if (mLoadingDeferredScRecords)
+    {
+        loadDeferredScRecords(mDeferredScRecords.size());
+    }
+
     // prevent the sync thread from looking things up while we change the tree
     std::unique_lock<mutex> nodeTreeIsChanging(nodeTreeMutex);
 
@@ -4707,10 +4911,16 @@ bool MegaClient::procsc()
     actionpacketsCurrent = false;
 
     CodeCounter::ScopeTimer ccst(performanceStats.scProcessingTime);
+    static auto& procscLatency = Metrics::registry().histogram("MegaClient_procsc");
+    Metrics::ScopedLatency procscTimer(procscLatency);
+    TRACE_SPAN("MegaClient_procsc");
     nameid name;
 
     std::shared_ptr<Node> lastAPDeletedNode;
 
+    // consecutive tree packets ('t', 'd', 'u') update the counters of the ancestors once, at the end
+    std::optional<NodeManager::TreeUpdateBatch> treeUpdateBatch;
+
     for (;;)
     {
         if (!insca)
@@ -4732,7 +4942,12 @@ bool MegaClient::procsc()
                     notifypurge();
                     if (sctable)
                     {
-                        if (!pendingcs && !csretrying && !reqs.readyToSend())
+                        if (insideScGroupCommitWindow())
+                        {
+                            // committed with the next batches, by checkScGroupCommit()
+                            pendingsccommit = true;
+                        }
+                        else if (!pendingcs && !csretrying && !reqs.readyToSend())
                         {
                             LOG_debug << "DB transaction COMMIT (sessionid: " << string(sessionid, sizeof(sessionid)) << ")";
                             sctable->commit();
@@ -4740,6 +4955,7 @@ bool MegaClient::procsc()
                             sctable->begin();
                             app->notify_dbcommit();
                             pendingsccommit = false;
+                            mLastScCommit = Waiter::ds;
                         }
                         else
                         {
@@ -4798,7 +5014,12 @@ bool MegaClient::procsc()
                             WAIT_CLASS::bumpds();
                             fnstats.timeToSyncsResumed = Waiter::ds - fnstats.startTime;
 
-                            if (!loggedIntoFolder())
+                            if (lowMemoryMode)
+                            {
+                                // user alerts are not kept, no need to catch up with them
+                                useralerts.catchupdone = true;
+                            }
+                            else if (!loggedIntoFolder())
                             {
                                 // historic user alerts are not supported for public folders
                                 // now that we have fetched everything and caught up actionpackets since that state,
@@ -4933,7 +5154,7 @@ bool MegaClient::procsc()
                         }
                     }
 
-                    if (pendingsccommit && sctable && !reqs.cmdsInflight() && scsn.ready())
+                    if (pendingsccommit && sctable && !reqs.cmdsInflight() && scsn.ready() && !insideScGroupCommitWindow())
                     {
                         LOG_debug << "Executing postponed DB commit 1";
                         sctable->commit();
@@ -4941,9 +5162,10 @@ bool MegaClient::procsc()
                         sctable->begin();
                         app->notify_dbcommit();
                         pendingsccommit = false;
+                        mLastScCommit = Waiter::ds;
                     }
 
-                    if (pendingsccommit)
+                    if (pendingsccommit && !insideScGroupCommitWindow())
                     {
                         LOG_debug << "Postponing DB commit until cs requests finish (spoonfeeding)";
                     }
@@ -5009,6 +5231,19 @@ bool MegaClient::procsc()
 #ifdef ENABLE_CHAT
                         bool readingPublicChat = false;
 #endif
+                        if (name == 'u' || name == 't' || name == 'd')
+                        {
+                            if (!treeUpdateBatch)
+                            {
+                                treeUpdateBatch.emplace(mNodeManager);
+                            }
+                        }
+                        else
+                        {
+                            // other packets may rely on the counters
+                            treeUpdateBatch.reset();
+                        }
+
                         switch (name)
                         {
                             case 'u':
@@ -5323,6 +5558,13 @@ void MegaClient::initsc()
         bool complete;
 
         assert(sctable->inTransaction());
+
+        // the attributes not decoded yet are in the records about to be removed
+        for (auto& it : users)
+        {
+            it.second.loadattrs();
+        }
+
         sctable->truncate();
 
         // 1. write current scsn
@@ -5377,9 +5619,10 @@ void MegaClient::initsc()
         if (complete)
         {
             // 7. write new or modified chats
+            DBTableNodes* grantsTable = chatGrantsTable();
             for (textchat_map::iterator it = chats.begin(); it != chats.end(); it++)
             {
-                if (!(complete = sctable->put(CACHEDCHAT, it->second, &key)))
+                if (!(complete = it->second->saveGrants(grantsTable) && sctable->put(CACHEDCHAT, it->second, &key)))
                 {
                     break;
                 }
@@ -5532,11 +5775,12 @@ void MegaClient::updatesc()
 #ifdef ENABLE_CHAT
         if (complete)
         {
-            // 6. write new or modified chats
+            // 6. write new or modified chats (only the changes of the grants of their attachments, all at once)
+            DBTableNodes* grantsTable = chatGrantsTable();
             for (textchat_map::iterator it = chatnotify.begin(); it != chatnotify.end(); it++)
             {
                 LOG_verbose << "Adding chat to database: " << Base64Str<sizeof(handle)>(it->second->getChatId());
-                if (!(complete = sctable->put(CACHEDCHAT, it->second, &key)))
+                if (!(complete = it->second->saveGrants(grantsTable) && sctable->put(CACHEDCHAT, it->second, &key)))
                 {
                     break;
                 }
@@ -5653,6 +5897,11 @@ error MegaClient::getfa(handle h, string *fileattrstring, const string &nodekey,
             {
                 *fafp = new FileAttributeFetch(h, nodekey, t, reqtag);
             }
+            else if (!(*fafp)->tag && reqtag)
+            {
+                // fetched without a request (bulk thumbnails): this one is notified now
+                (*fafp)->tag = reqtag;
+            }
             else
             {
                 restag = (*fafp)->tag;
@@ -5662,6 +5911,11 @@ error MegaClient::getfa(handle h, string *fileattrstring, const string &nodekey,
         else
         {
             FileAttributeFetch** fafp = &(*fafcp)->fafs[1][fah];
+            if (!(*fafp)->tag && reqtag)
+            {
+                (*fafp)->tag = reqtag;
+                return API_OK;
+            }
             restag = (*fafp)->tag;
             return API_EEXIST;
         }
@@ -5727,12 +5981,92 @@ void MegaClient::activatefa()
     }
 }
 
+void MegaClient::attachpendingfa()
+{
+    auto waiting = [this](handle h)
+    {
+        for (auto* fas : { &activefa, &queuedfa })
+        {
+            for (auto& fa : *fas)
+            {
+                if (fa->th.isNodeHandle() && fa->th.nodeHandle().as8byte() == h)
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+
+    for (auto it = pendingattachfa.begin(); it != pendingattachfa.end(); )
+    {
+        if (waiting(it->first))
+        {
+            ++it;
+            continue;
+        }
+
+        if (nodebyhandle(it->first))
+        {
+            LOG_debug << "Attaching " << it->second.size() << " file attribute(s) to Node " << toNodeHandle(it->first);
+            reqs.add(new CommandAttachFA(this, it->first, it->second));
+        }
+        else
+        {
+            LOG_debug << "Node to attach file attributes to no longer exists";
+        }
+        it = pendingattachfa.erase(it);
+    }
+}
+
 // has the limit of concurrent transfer tslots been reached?
 bool MegaClient::slotavail() const
 {
-    return !mBlocked && tslots.size() < MAXTOTALTRANSFERS;
+    if (mBlocked)
+    {
+        return false;
+    }
+
+    if (tslots.size() < MAXTOTALTRANSFERS)
+    {
+        return true;
+    }
+
+    double used = 0;
+    for (const TransferSlot* ts : tslots)
+    {
+        used += transferSlotWeight(ts->transfer);
+    }
+    return used < MAXTOTALTRANSFERS;
 }
 
+double MegaClient::transferSlotWeight(const Transfer* t)
+{
+    if (t->type == PUT && t->size < MAX_TINY_UPLOAD_SIZE)
+    {
+        return 1.0 / TINY_UPLOADS_PER_SLOT;
+    }
+    return 1.0;
+}
+
+#ifdef ENABLE_SYNC
+handle MegaClient::syncOfTransfer(const Transfer* t)
+{
+    for (File* f : t->files)
+    {
+        if (f->syncxfer)
+        {
+            auto syncFile = dynamic_cast<SyncTransfer_inClient*>(f);
+            if (syncFile && syncFile->syncThreadSafeState)
+            {
+                return syncFile->syncThreadSafeState->backupId();
+            }
+        }
+    }
+    return UNDEF;
+}
+#endif
+
 bool MegaClient::setstoragestatus(storagestatus_t status)
 {
     // transition from paywall to red should not happen
@@ -8221,6 +8555,42 @@ void MegaClient::notifypurge(void)
 #endif
 
     totalNodes.store(mNodeManager.getNodeCount());
+
+    trimUserAttributes();
+}
+
+void MegaClient::trimUserAttributes()
+{
+    if (mUsersWithAttrs <= mMaxUsersWithAttrs)
+    {
+        return;
+    }
+
+    // down to 3/4 of the limit, so that it isn't done again at every notification
+    vector<User*> loaded;
+    for (auto& it : users)
+    {
+        if (it.second.attrsloaded())
+        {
+            loaded.push_back(&it.second);
+        }
+    }
+
+    size_t target = mMaxUsersWithAttrs / 4 * 3;
+    if (loaded.size() > target)
+    {
+        size_t excess = loaded.size() - target;
+        // the least recently used ones first
+        std::nth_element(loaded.begin(), loaded.begin() + static_cast<ptrdiff_t>(excess - 1), loaded.end(),
+                         [](const User* a, const User* b) { return a->attrslastuse() < b->attrslastuse(); });
+
+        size_t dropped = 0;
+        for (size_t i = 0; i < excess; ++i)
+        {
+            dropped += loaded[i]->unloadattrs();
+        }
+        LOG_debug << "Attributes of " << dropped << " users dropped from memory (" << mUsersWithAttrs << " kept)";
+    }
 }
 
 void MegaClient::persistAlert(UserAlert::Base* a)
@@ -8832,6 +9202,97 @@ void MegaClient::putnodes(NodeHandle h, VersioningOption vo, vector<NewNode>&& n
     reqs.add(new CommandPutNodes(this, h, NULL, vo, std::move(newnodes), tag, PUTNODES_APP, cauth, std::move(resultFunction), canChangeVault));
 }
 
+void MegaClient::putnodesCoalesced(NodeHandle h, VersioningOption vo, vector<NewNode>&& newnodes, int tag, putsource_t source, bool canChangeVault, CommandPutNodes::Completion&& completion)
+{
+    assert(!newnodes.empty());
+
+    CoalescedPutnodesKey key(h, vo, source, canChangeVault, tag != 0);
+    auto& batch = mCoalescedPutnodes[key];
+
+    batch.mParts.push_back(CoalescedPutnodes::Part{newnodes.size(), tag, std::move(completion)});
+    batch.mNodes.insert(batch.mNodes.end(), std::make_move_iterator(newnodes.begin()), std::make_move_iterator(newnodes.end()));
+
+    if (batch.mNodes.size() >= MAX_COALESCED_PUTNODES)
+    {
+        auto it = mCoalescedPutnodes.find(key);
+        sendCoalescedPutnodes(it->first, std::move(it->second));
+        mCoalescedPutnodes.erase(it);
+    }
+}
+
+void MegaClient::sendCoalescedPutnodes()
+{
+    for (auto& batch : mCoalescedPutnodes)
+    {
+        sendCoalescedPutnodes(batch.first, std::move(batch.second));
+    }
+
+    mCoalescedPutnodes.clear();
+}
+
+void MegaClient::sendCoalescedPutnodes(const CoalescedPutnodesKey& key, CoalescedPutnodes&& batch)
+{
+    NodeHandle h = std::get<0>(key);
+    VersioningOption vo = std::get<1>(key);
+    putsource_t source = std::get<2>(key);
+    bool canChangeVault = std::get<3>(key);
+
+    assert(!batch.mParts.empty());
+
+    if (batch.mParts.size() == 1)
+    {
+        auto& part = batch.mParts.front();
+        reqs.add(new CommandPutNodes(this, h, NULL, vo, std::move(batch.mNodes), part.mTag, source, nullptr, std::move(part.mCompletion), canChangeVault));
+        return;
+    }
+
+    LOG_debug << "Coalescing " << batch.mParts.size() << " putnodes (" << batch.mNodes.size() << " nodes) into one for target " << h;
+
+    auto parts = std::make_shared<vector<CoalescedPutnodes::Part>>(std::move(batch.mParts));
+
+    // split the result back, as if each caller had sent its own command
+    auto completion = [this, parts](const Error& e, targettype_t t, vector<NewNode>& nn, bool targetOverride, int)
+    {
+        size_t offset = 0;
+
+        for (auto& part : *parts)
+        {
+            assert(offset + part.mNumNodes <= nn.size());
+            auto begin = nn.begin() + static_cast<ptrdiff_t>(std::min(offset, nn.size()));
+            auto end = nn.begin() + static_cast<ptrdiff_t>(std::min(offset + part.mNumNodes, nn.size()));
+            offset += part.mNumNodes;
+
+            vector<NewNode> partNodes(std::make_move_iterator(begin), std::make_move_iterator(end));
+
+            // OK if any of its nodes were added, otherwise its own last node error (or the command's)
+            Error partError = e;
+            if (std::any_of(partNodes.begin(), partNodes.end(), [](const NewNode& n) { return n.added; }))
+            {
+                partError = API_OK;
+            }
+            else
+            {
+                for (auto& n : partNodes)
+                {
+                    if (n.mError != API_OK) partError = n.mError;
+                }
+            }
+
+            if (part.mCompletion) part.mCompletion(partError, t, partNodes, targetOverride, part.mTag);
+            else app->putnodes_result(partError, t, partNodes, targetOverride, part.mTag);
+        }
+    };
+
+    auto command = new CommandPutNodes(this, h, NULL, vo, std::move(batch.mNodes), parts->front().mTag, source, nullptr, std::move(completion), canChangeVault);
+
+    for (size_t i = 1; i < parts->size(); ++i)
+    {
+        command->mCoalescedTags.push_back((*parts)[i].mTag);
+    }
+
+    reqs.add(command);
+}
+
 // drop nodes into a user's inbox (must have RSA keypair) - obsolete feature, kept for sending logs to helpdesk
 void MegaClient::putnodes(const char* user, vector<NewNode>&& newnodes, int tag, CommandPutNodes::Completion&& completion)
 {
@@ -9695,10 +10156,6 @@ int MegaClient::readnode(JSON* j, int notify, putsource_t source, vector<NewNode
                     }
                 }
 
-                string fas;
-
-                JSON::copystring(&fas, fa);
-
                 // fallback timestamps
                 if (!(ts + 1))
                 {
@@ -9710,7 +10167,8 @@ int MegaClient::readnode(JSON* j, int notify, putsource_t source, vector<NewNode
                     sts = ts;
                 }
 
-                n = std::make_shared<Node>(*this, NodeHandle().set6byte(h), NodeHandle().set6byte(ph), t, s, u, fas.c_str(), ts);
+                // Node copies the file attributes straight from the JSON data, up to the closing quote
+                n = std::make_shared<Node>(*this, NodeHandle().set6byte(h), NodeHandle().set6byte(ph), t, s, u, fa, ts);
                 n->changed.newnode = true;
                 n->changed.modifiedByThisClient = modifiedByThisClient;
 
@@ -10720,6 +11178,7 @@ error MegaClient::folderaccess(const char *folderlink, const char * authKey)
             mFolderLink.mWriteAuth = authKey;
         }
         mFolderLink.mPublicHandle = h;
+        mFolderLink.mFetchRoot = NodeHandle();
         // mFolderLink.mAccountAuth remain unchanged, since it can be reused for multiple links
         key.setkey(folderkey);
 
@@ -10771,9 +11230,54 @@ void MegaClient::login2(const char *email, const char *password, const string *s
     string bsalt;
     Base64::atob(*salt, bsalt);
 
-    vector<byte> derivedKey = deriveKey(password, bsalt, 2 * SymmCipher::KEYLENGTH);
+    // the derivation takes long on slow devices, this thread goes on with the rest meanwhile
+    auto pending = std::make_shared<PendingKeyDerivation>();
+    string emailCopy(email);
+    string pinCopy(pin ? pin : "");
+    bool hasPin = pin != nullptr;
+    int tag = reqtag;
+    pending->continuation = [this, emailCopy, pinCopy, hasPin, tag, completion = std::move(completion)]
+                            (const vector<byte>& derivedKey) mutable
+    {
+        int creqtag = reqtag;
+        reqtag = tag;
+        login2(emailCopy.c_str(), derivedKey.data(), hasPin ? pinCopy.c_str() : nullptr, std::move(completion));
+        reqtag = creqtag;
+    };
+    mPendingKeyDerivation = pending;
 
-    login2(email, derivedKey.data(), pin, std::move(completion));
+    // discardable: a logout forgets about it
+    mAsyncQueue.push([pending, passwordCopy = string(password), bsalt](SymmCipher&)
+    {
+        vector<byte> derivedKey = deriveKey(passwordCopy.c_str(), bsalt, 2 * SymmCipher::KEYLENGTH);
+
+        std::lock_guard<std::mutex> g(pending->mutex);
+        pending->derivedKey = std::move(derivedKey);
+        pending->done = true;
+    }, true, MegaClientAsyncQueue::INTERACTIVE);
+}
+
+bool MegaClient::checkPendingKeyDerivation()
+{
+    if (!mPendingKeyDerivation)
+    {
+        return false;
+    }
+
+    vector<byte> derivedKey;
+    {
+        std::lock_guard<std::mutex> g(mPendingKeyDerivation->mutex);
+        if (!mPendingKeyDerivation->done)
+        {
+            return false;
+        }
+        derivedKey.swap(mPendingKeyDerivation->derivedKey);
+    }
+
+    // the continuation may start another one
+    auto pending = std::move(mPendingKeyDerivation);
+    pending->continuation(derivedKey);
+    return true;
 }
 
 void MegaClient::login2(const char *email, const byte *derivedKey, const char* pin, CommandLogin::Completion completion)
@@ -10975,12 +11479,9 @@ bool MegaClient::validatepwdlocally(const char* pswd)
             return false;
         }
 
-        byte derivedKey[2 * SymmCipher::KEYLENGTH];
-        CryptoPP::PKCS5_PBKDF2_HMAC<CryptoPP::SHA512> pbkdf2;
-        pbkdf2.DeriveKey(derivedKey, sizeof(derivedKey), 0, (byte*)pswd, strlen(pswd),
-            (const byte*)accountsalt.data(), accountsalt.size(), 100000);
+        vector<byte> derivedKey = deriveKey(pswd, accountsalt, 2 * SymmCipher::KEYLENGTH);
 
-        SymmCipher cipher(derivedKey);
+        SymmCipher cipher(derivedKey.data());
         cipher.ecb_decrypt((byte*)tmpk.data());
     }
     else
@@ -11136,6 +11637,12 @@ void MegaClient::opensctable()
         {
             dbname.resize(NODEHANDLE * 4 / 3 + 3);
             dbname.resize(Base64::btoa((const byte*)&mFolderLink.mPublicHandle, NODEHANDLE, (char*)dbname.c_str()));
+
+            // the nodes of a subtree are cached apart from the ones of the whole link
+            if (!mFolderLink.mFetchRoot.isUndef())
+            {
+                dbname.append("_").append(toNodeHandle(mFolderLink.mFetchRoot));
+            }
         }
 
         if (dbname.size())
@@ -11168,6 +11675,8 @@ void MegaClient::opensctable()
                 // We only commit once we have an up to date SCSN and the table state matches it.
                 sctable->begin();
                 assert(sctable->inTransaction());
+
+                sctable->setBackgroundCheckpoints(mScGroupCommitWindow > 0);
             }
             else
             {
@@ -11178,6 +11687,45 @@ void MegaClient::opensctable()
     }
 }
 
+void MegaClient::setScGroupCommitWindow(dstime window)
+{
+    mScGroupCommitWindow = window;
+
+    if (sctable)
+    {
+        sctable->setBackgroundCheckpoints(window > 0);
+    }
+}
+
+bool MegaClient::insideScGroupCommitWindow() const
+{
+    return mScGroupCommitWindow && Waiter::ds < mLastScCommit + mScGroupCommitWindow;
+}
+
+void MegaClient::checkScGroupCommit()
+{
+    // not in the middle of a batch of action packets, so the DB matches the last SCSN
+    if (!mScGroupCommitWindow || !pendingsccommit || !sctable || jsonsc.pos
+        || insideScGroupCommitWindow()
+        || pendingcs || csretrying || reqs.readyToSend() || !scsn.ready())
+    {
+        return;
+    }
+
+    LOG_debug << "DB transaction group COMMIT (sessionid: " << string(sessionid, sizeof(sessionid)) << ")";
+    sctable->commit();
+    assert(!sctable->inTransaction());
+    sctable->begin();
+    app->notify_dbcommit();
+    pendingsccommit = false;
+    mLastScCommit = Waiter::ds;
+
+    const DbCommitLatency& latency = sctable->commitLatency();
+    LOG_verbose << "DB commit latency (us): p50 " << latency.percentile(50).count()
+                << " p90 " << latency.percentile(90).count()
+                << " p99 " << latency.percentile(99).count();
+}
+
 void MegaClient::doOpenStatusTable()
 {
     if (dbaccess && !statusTable)
@@ -11264,6 +11812,7 @@ User* MegaClient::finduser(const char* uid, int add)
 
         // add user by lowercase e-mail address
         u = &users[++userid];
+        u->setClient(this);
         u->uid = nuid;
         JSON::copystring(&u->email, nuid.c_str());
         umindex[nuid] = userid;
@@ -11296,6 +11845,7 @@ User* MegaClient::finduser(handle uh, int add)
 
         // add user by binary handle
         u = &users[++userid];
+        u->setClient(this);
 
         char uid[12];
         Base64::btoa((byte*)&uh, MegaClient::USERHANDLE, uid);
@@ -11495,21 +12045,52 @@ void MegaClient::proctree(std::shared_ptr<Node> n, TreeProc* tp, bool skipinshar
 {
     if (!n) return;
 
-    if (!skipversions || n->type != FILENODE)
+    // Depth-first, children before their parent, with a work stack instead of recursion.
+    // Only the nodes of the current path are held: the children waiting at each level are
+    // kept as handles, so the nodes of huge subtrees can leave the cache LRU once processed.
+    struct Level
     {
-        sharedNode_list children = getChildren(n.get());
-        for (sharedNode_list::iterator it = children.begin(); it != children.end(); )
+        std::shared_ptr<Node> node;
+        vector<NodeHandle> pending; // in reverse order
+    };
+
+    auto childrenOf = [this](const Node& parent)
+    {
+        sharedNode_list children = getChildren(&parent);
+        vector<NodeHandle> handles;
+        handles.reserve(children.size());
+        for (auto it = children.rbegin(); it != children.rend(); it++)
         {
-            auto& node = *it;
-            it++;
-            if (!(skipinshares && node->inshare))
-            {
-                proctree(node, tp, skipinshares);
-            }
+            handles.push_back((*it)->nodeHandle());
         }
-    }
+        return handles;
+    };
+
+    // versions are skipped at the top level only
+    vector<Level> stack;
+    stack.push_back({ n, (!skipversions || n->type != FILENODE) ? childrenOf(*n) : vector<NodeHandle>() });
 
-    tp->proc(this, n);
+    while (!stack.empty())
+    {
+        Level& level = stack.back();
+        if (level.pending.empty())
+        {
+            std::shared_ptr<Node> node = std::move(level.node);
+            stack.pop_back();
+            tp->proc(this, node);
+            continue;
+        }
+
+        std::shared_ptr<Node> child = nodeByHandle(level.pending.back());
+        level.pending.pop_back();
+
+        // it could have been removed while processing its siblings
+        if (child && !(skipinshares && child->inshare))
+        {
+            vector<NodeHandle> children = childrenOf(*child);
+            stack.push_back({ std::move(child), std::move(children) });
+        }
+    }
 }
 
 // queue PubKeyAction request to be triggered upon availability of the user's
@@ -12650,6 +13231,12 @@ void MegaClient::notifychat(TextChat *chat)
         chatnotify[chat->getChatId()] = chat;
     }
 }
+
+DBTableNodes* MegaClient::chatGrantsTable() const
+{
+    auto table = dynamic_cast<DBTableNodes*>(sctable.get());
+    return table && table->hasChatGrants() ? table : nullptr;
+}
 #endif
 
 // process request for share node keys
@@ -13922,8 +14509,8 @@ void MegaClient::fillCypheredAccountDataV2(const char* password, vector<byte>& c
 vector<byte> MegaClient::deriveKey(const char* password, const string& salt, size_t derivedKeySize)
 {
     vector<byte> derivedKey(derivedKeySize);
-    CryptoPP::PKCS5_PBKDF2_HMAC<CryptoPP::SHA512> pbkdf2;
-    pbkdf2.DeriveKey(derivedKey.data(), derivedKey.size(), 0, (const byte*)password, strlen(password),
+    PBKDF2_HMAC_SHA512 pbkdf2;
+    pbkdf2.deriveKey(derivedKey.data(), derivedKey.size(), (const byte*)password, strlen(password),
         (const byte*)salt.data(), salt.size(), 100000);
 
     return derivedKey;
@@ -14132,6 +14719,12 @@ bool MegaClient::fetchsc(DbTable* sctable)
 
             case CACHEDALERT:
             {
+                if (fastResume)
+                {
+                    mDeferredScRecords.emplace_back(id, std::move(data));
+                    break;
+                }
+
                 if (!useralerts.unserializeAlert(&data, id))
                 {
                     LOG_err << "Failed - user notification read error";
@@ -14166,6 +14759,12 @@ bool MegaClient::fetchsc(DbTable* sctable)
                 break;
             case CACHEDSET:
             {
+                if (fastResume)
+                {
+                    mDeferredScRecords.emplace_back(id, std::move(data));
+                    break;
+                }
+
                 if (!fetchscset(&data, id))
                 {
                     return false;
@@ -14175,6 +14774,12 @@ bool MegaClient::fetchsc(DbTable* sctable)
 
             case CACHEDSETELEMENT:
             {
+                if (fastResume)
+                {
+                    mDeferredScRecords.emplace_back(id, std::move(data));
+                    break;
+                }
+
                 if (!fetchscsetelement(&data, id))
                 {
                     return false;
@@ -14237,9 +14842,52 @@ bool MegaClient::fetchsc(DbTable* sctable)
         app->sequencetag_update(mScDbStateRecord.seqTag);
     }
 
+    if (fastResume)
+    {
+        LOG_debug << "Records of the local cache deferred: " << mDeferredScRecords.size();
+        mLoadingDeferredScRecords = true;
+    }
+
     return true;
 }
 
+void MegaClient::loadDeferredScRecords(size_t maxRecords)
+{
+    // the records are loaded in the order they were read
+    for (; maxRecords && !mDeferredScRecords.empty(); maxRecords--)
+    {
+        uint32_t id = mDeferredScRecords.front().first;
+        string& data = mDeferredScRecords.front().second;
+        switch (id & (DbTable::IDSPACING - 1))
+        {
+            case CACHEDALERT:
+                if (!useralerts.unserializeAlert(&data, id))
+                {
+                    LOG_err << "Failed - user notification read error";
+                }
+                break;
+
+            case CACHEDSET:
+                // the session is already resumed: records that can't be read are skipped
+                fetchscset(&data, id);
+                break;
+
+            case CACHEDSETELEMENT:
+                fetchscsetelement(&data, id);
+                break;
+        }
+        mDeferredScRecords.pop_front();
+    }
+
+    if (mDeferredScRecords.empty())
+    {
+        mLoadingDeferredScRecords = false;
+        std::deque<pair<uint32_t, string>>().swap(mDeferredScRecords);
+        LOG_debug << "Deferred records of the local cache loaded";
+        app->deferred_cache_loaded();
+    }
+}
+
 
 bool MegaClient::fetchStatusTable(DbTable* table)
 {
@@ -14708,7 +15356,7 @@ void MegaClient::fetchnodes(bool nocache, bool loadSyncs, bool forceLoadFromServ
         else
         {
             actionpacketsCurrent = false;
-            reqs.add(new CommandFetchNodes(this, reqtag, nocache, loadSyncs));
+            reqs.add(new CommandFetchNodes(this, reqtag, nocache, loadSyncs, mFolderLink.mFetchRoot));
         }
     }
 }
@@ -15696,6 +16344,8 @@ void MegaClient::purgenodesusersabortsc(bool keepOwnUser)
         delete hdrns.begin()->second;
     }
 
+    drcache.clear();
+
     mNodeManager.cleanNodes();
 
 #ifdef ENABLE_SYNC
@@ -15790,6 +16440,15 @@ void MegaClient::pread(Node* n, m_off_t offset, m_off_t count, void* appdata)
               offset, count, appdata);
 }
 
+// request direct read by node pointer, delivering the data to a listener
+// (the listener also acts as the read's appdata, so removeAppData() detaches it)
+void MegaClient::pread(Node* n, m_off_t offset, m_off_t count, DirectReadListener* listener)
+{
+    queueread(n->nodehandle, true, n->nodecipher(),
+              MemAccess::get<int64_t>((const char*)n->nodekey().data() + SymmCipher::KEYLENGTH),
+              offset, count, listener, NULL, NULL, NULL, listener);
+}
+
 // request direct read by exported handle / key
 void MegaClient::pread(handle ph, SymmCipher* key, int64_t ctriv, m_off_t offset, m_off_t count, void* appdata, bool isforeign, const char *privauth, const char *pubauth, const char *cauth)
 {
@@ -15810,7 +16469,7 @@ bool MegaClient::isprivatehandle(handle* hp)
     return ((char*)hp)[NODEHANDLE] != 0;
 }
 
-void MegaClient::queueread(handle h, bool p, SymmCipher* key, int64_t ctriv, m_off_t offset, m_off_t count, void* appdata, const char* privauth, const char *pubauth, const char *cauth)
+void MegaClient::queueread(handle h, bool p, SymmCipher* key, int64_t ctriv, m_off_t offset, m_off_t count, void* appdata, const char* privauth, const char *pubauth, const char *cauth, DirectReadListener* listener)
 {
     handledrn_map::iterator it;
 
@@ -15823,28 +16482,33 @@ void MegaClient::queueread(handle h, bool p, SymmCipher* key, int64_t ctriv, m_o
         // this handle is not being accessed yet: insert
         it = hdrns.insert(hdrns.end(), pair<handle, DirectReadNode*>(h, new DirectReadNode(this, h, p, key, ctriv, privauth, pubauth, cauth)));
         it->second->hdrn_it = it;
-        it->second->enqueue(offset, count, reqtag, appdata);
+        DirectRead* dr = it->second->enqueue(offset, count, reqtag, appdata, listener);
 
         if (overquotauntil && overquotauntil > Waiter::ds)
         {
             dstime timeleft = dstime(overquotauntil - Waiter::ds);
-            app->pread_failure(API_EOVERQUOTA, 0, appdata, timeleft);
+            dr->deliverFailure(API_EOVERQUOTA, 0, timeleft);
             it->second->schedule(timeleft);
         }
         else
         {
+            it->second->readahead.requested(offset, count);
             it->second->dispatch();
         }
     }
     else
     {
-        it->second->enqueue(offset, count, reqtag, appdata);
+        DirectRead* dr = it->second->enqueue(offset, count, reqtag, appdata, listener);
         if (overquotauntil && overquotauntil > Waiter::ds)
         {
             dstime timeleft = dstime(overquotauntil - Waiter::ds);
-            app->pread_failure(API_EOVERQUOTA, 0, appdata, timeleft);
+            dr->deliverFailure(API_EOVERQUOTA, 0, timeleft);
             it->second->schedule(timeleft);
         }
+        else
+        {
+            it->second->readahead.requested(offset, count);
+        }
     }
 }
 
@@ -15891,7 +16555,7 @@ void MegaClient::abortreads(handle h, bool p, m_off_t offset, m_off_t count)
         {
             if ((offset < 0 || offset == (*it)->offset) && (count < 0 || count == (*it)->count))
             {
-                app->pread_failure(API_EINCOMPLETE, (*it)->drn->retries, (*it)->appdata, 0);
+                (*it)->deliverFailure(API_EINCOMPLETE, (*it)->drn->retries, 0);
 
                 delete *(it++);
             }
@@ -15911,12 +16575,23 @@ bool MegaClient::execdirectreads()
     if (drq.size() < MAXDRSLOTS)
     {
         // fill slots
-        for (dr_list::iterator it = drq.begin(); it != drq.end(); it++)
+        for (dr_list::iterator it = drq.begin(); it != drq.end(); )
         {
-            if (!(*it)->drs)
+            DirectRead* dr = *(it++);
+            if (!dr->drs)
             {
-                drs = new DirectReadSlot(*it);
-                (*it)->drs = drs;
+                if (dr->drbuf.tempUrlVector().empty() && !dr->start())
+                {
+                    // served entirely from the cache (or ended by the app)
+                    DirectReadNode* drn = dr->drn;
+                    delete dr;
+                    drn->schedule(DirectReadSlot::TEMPURL_TIMEOUT_DS);
+                    r = true;
+                    break;
+                }
+
+                drs = new DirectReadSlot(dr);
+                dr->drs = drs;
                 r = true;
 
                 if (drq.size() >= MAXDRSLOTS) break;
@@ -16619,7 +17294,6 @@ void MegaClient::execmovetosyncdebris(Node* requestedNode, std::function<void(No
                     TreeProcCopy tc;
                     proctree(n, &tc, false, false);
                     tc.allocnodes();
-                    proctree(n, &tc, false, false);
                     tc.nn[0].parenthandle = UNDEF;
                     putnodes(debrisTarget->nodeHandle(), NoVersioning, std::move(tc.nn), nullptr, reqtag, rec.mCanChangeVault, [this, rec](const Error&e, targettype_t, vector<NewNode>&, bool, int)
                     {
@@ -16897,6 +17571,7 @@ bool MegaClient::startxfer(direction_t d, File* f, TransferDbCommitter& committe
             f->file_it = t->files.insert(t->files.end(), f);
             f->transfer = t;
             f->tag = tag;
+            indexCancelToken(t, f->cancelToken);
             if (!f->dbid && !donotpersist)
             {
                 filecacheadd(f, committer);
@@ -16992,6 +17667,16 @@ bool MegaClient::startxfer(direction_t d, File* f, TransferDbCommitter& committe
 
             if (t)
             {
+                // the cached transfer is about to be resumed
+                if (!t->materialize())
+                {
+                    LOG_warn << "Discarding the progress of a cached transfer";
+                    t->tempurls.clear();
+                    t->ultoken.reset();
+                    t->pos = 0;
+                    t->progresscompleted = 0;
+                }
+
                 bool hadAnyData = t->pos > 0;
                 if ((d == GET && !t->pos) || ((m_time() - t->lastaccesstime) >= 172500))
                 {
@@ -17076,6 +17761,7 @@ bool MegaClient::startxfer(direction_t d, File* f, TransferDbCommitter& committe
 
             f->file_it = t->files.insert(t->files.end(), f);
             f->transfer = t;
+            indexCancelToken(t, f->cancelToken);
             if (!f->dbid && !donotpersist)
             {
                 filecacheadd(f, committer);
@@ -17529,6 +18215,16 @@ m_off_t MegaClient::getmaxuploadspeed()
     return httpio->getmaxuploadspeed();
 }
 
+bool MegaClient::sethttp2(bool enable)
+{
+    return httpio->sethttp2(enable);
+}
+
+bool MegaClient::gethttp2()
+{
+    return httpio->gethttp2();
+}
+
 std::shared_ptr<Node> MegaClient::getovnode(Node *parent, string *name)
 {
     if (parent && name)
@@ -18427,12 +19123,14 @@ std::string MegaClient::PerformanceStats::report(bool reset, HttpIO* httpio, Wai
         << syncItemCSX.report(reset) << "\n"
         << syncItemCSF.report(reset) << "\n"
         << clientThreadActions.report(reset) << "\n"
+        << " sync passes/rows visited/rows skipped: " << syncPasses << " " << syncRowsVisited << " " << syncRowsSkipped << "\n"
 #endif
         << " cs Request waiting time: " << csRequestWaitTime.report(reset) << "\n"
         << " cs requests sent/received: " << reqs.csRequestsSent << "/" << reqs.csRequestsCompleted << " batches: " << reqs.csBatchesSent << "/" << reqs.csBatchesReceived << "\n"
         << " transfers active time: " << transfersActiveTime.report(reset) << "\n"
         << " transfer starts/finishes: " << transferStarts << " " << transferFinishes << "\n"
         << " transfer temperror/fails: " << transferTempErrors << " " << transferFails << "\n"
+        << " transfer slot passes/serviced/skipped: " << transferslotPasses << " " << transferslotsServiced << " " << transferslotsSkipped << "\n"
         << " nowait reason: immedate: " << prepwaitImmediate << " zero: " << prepwaitZero << " httpio: " << prepwaitHttpio << " fsaccess: " << prepwaitFsaccess << " nonzero waits: " << nonzeroWait << "\n";
     if (auto curlhttpio = dynamic_cast<CurlHttpIO*>(httpio))
     {
@@ -18456,6 +19154,10 @@ std::string MegaClient::PerformanceStats::report(bool reset, HttpIO* httpio, Wai
     {
         transferStarts = transferFinishes = transferTempErrors = transferFails = 0;
         prepwaitImmediate = prepwaitZero = prepwaitHttpio = prepwaitFsaccess = nonzeroWait = 0;
+        transferslotPasses = transferslotsServiced = transferslotsSkipped = 0;
+#ifdef ENABLE_SYNC
+        syncPasses = syncRowsVisited = syncRowsSkipped = 0;
+#endif
     }
     return s.str();
 }
@@ -20193,7 +20895,11 @@ void MegaClient::notifypurgesetelements()
     {
         if (e->hasChanged(SetElement::CH_EL_REMOVED))
         {
-            mSetElements[e->set()].erase(e->id());
+            auto itS = mSetElements.find(e->set());
+            if (itS != mSetElements.end())
+            {
+                itS->second.erase(e->id());
+            }
         }
         else
         {
@@ -20207,13 +20913,10 @@ void MegaClient::notifypurgesetelements()
 
 void MegaClient::clearsetelementnotify(handle sid)
 {
-    for (size_t i = setelementnotify.size(); i; --i)
-    {
-        if (setelementnotify[i - 1]->set() == sid)
-        {
-            setelementnotify.erase(setelementnotify.begin() + i - 1);
-        }
-    }
+    // in one pass: all the Elements of a big Set can be pending to be notified
+    setelementnotify.erase(std::remove_if(setelementnotify.begin(), setelementnotify.end(),
+                                          [sid](const SetElement* e) { return e->set() == sid; }),
+                           setelementnotify.end());
 }
 
 void MegaClient::setProFlexi(bool newProFlexi)
@@ -21033,6 +21736,11 @@ string KeyManager::encryptShareKeyTo(handle userhandle, std::string shareKey)
         return std::string();
     }
 
+    return encryptShareKeyWith(sharedKey, shareKey);
+}
+
+string KeyManager::encryptShareKeyWith(const std::string& sharedKey, const std::string& shareKey)
+{
     std::string encryptedKey;
     encryptedKey.resize(CryptoPP::AES::BLOCKSIZE);
 
@@ -21055,6 +21763,11 @@ string KeyManager::decryptShareKeyFrom(handle userhandle, std::string key)
         return std::string();
     }
 
+    return decryptShareKeyWith(sharedKey, key);
+}
+
+string KeyManager::decryptShareKeyWith(const std::string& sharedKey, const std::string& key)
+{
     std::string shareKey;
     shareKey.resize(CryptoPP::AES::BLOCKSIZE);
 
@@ -21090,6 +21803,29 @@ bool KeyManager::promotePendingShares()
     bool newshares = false;
     std::vector<std::string> keysToDelete;
 
+    // the contacts may have many shares, and their keys are computed only once (and at once),
+    // the shares are then promoted in the same order as always
+    std::set<handle> users;
+    for (const auto& it : mPendingOutShares)
+    {
+        for (const auto& uid : it.second)
+        {
+            User *u = mClient.finduser(uid.c_str(), 0);
+            if (u && !verificationRequired(u->userhandle))
+            {
+                users.insert(u->userhandle);
+            }
+        }
+    }
+    for (const auto& it : mPendingInShares)
+    {
+        if (!verificationRequired(it.second.first))
+        {
+            users.insert(it.second.first);
+        }
+    }
+    std::map<handle, std::string> sharedKeys = computeSymmetricKeys(users);
+
     for (const auto& it : mPendingOutShares)
     {
         handle nodehandle = it.first;
@@ -21102,7 +21838,8 @@ bool KeyManager::promotePendingShares()
                 auto shareit = mShareKeys.find(nodehandle);
                 if (shareit != mShareKeys.end())
                 {
-                    std::string encryptedKey = encryptShareKeyTo(u->userhandle, shareit->second.first);
+                    auto sharedKeyIt = sharedKeys.find(u->userhandle);
+                    std::string encryptedKey = sharedKeyIt != sharedKeys.end() ? encryptShareKeyWith(sharedKeyIt->second, shareit->second.first) : std::string();
                     if (encryptedKey.size())
                     {
                         mClient.reqs.add(new CommandPendingKeys(&mClient, u->userhandle, nodehandle, (byte *)encryptedKey.data(),
@@ -21156,7 +21893,8 @@ bool KeyManager::promotePendingShares()
             }
 
             LOG_debug << "Promoting pending inshare of node " << toNodeHandle(nodeHandle) << " for " << toHandle(userHandle);
-            std::string shareKey = decryptShareKeyFrom(userHandle, encryptedShareKey);
+            auto sharedKeyIt = sharedKeys.find(userHandle);
+            std::string shareKey = sharedKeyIt != sharedKeys.end() ? decryptShareKeyWith(sharedKeyIt->second, encryptedShareKey) : std::string();
             if (shareKey.size())
             {
                 auto skit = mShareKeys.find(nodeHandle);
@@ -22054,11 +22792,67 @@ bool KeyManager::deserializeWarnings(KeyManager& km, const string &blob)
 
 
 string KeyManager::computeSymmetricKey(handle user)
+{
+    const string* cachedav = contactCu25519PubKey(user);
+    if (!cachedav)
+    {
+        return std::string();
+    }
+
+    return deriveSymmetricKey(string(reinterpret_cast<const char*>(mClient.chatkey->getPrivKey()), ECDH::PRIVATE_KEY_LENGTH), *cachedav);
+}
+
+std::map<handle, std::string> KeyManager::computeSymmetricKeys(const std::set<handle>& users)
+{
+    // the public keys are looked up here, only the key agreements run at the worker threads
+    std::vector<std::pair<handle, const string*>> pubKeys;
+    for (handle user : users)
+    {
+        if (const string* pubKey = contactCu25519PubKey(user))
+        {
+            pubKeys.emplace_back(user, pubKey);
+        }
+    }
+
+    std::vector<std::string> sharedKeys(pubKeys.size());
+    string privKey(reinterpret_cast<const char*>(mClient.chatkey->getPrivKey()), ECDH::PRIVATE_KEY_LENGTH);
+
+    if (pubKeys.size() < 2 * SYMMETRIC_KEY_BATCH_SIZE)
+    {
+        for (size_t i = 0; i < pubKeys.size(); ++i)
+        {
+            sharedKeys[i] = deriveSymmetricKey(privKey, *pubKeys[i].second);
+        }
+    }
+    else
+    {
+        // this thread waits for all of them, so they can refer to the local variables
+        mClient.mAsyncQueue.runBatches(pubKeys.size(), SYMMETRIC_KEY_BATCH_SIZE, [&pubKeys, &sharedKeys, &privKey](size_t begin, size_t end, SymmCipher&)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                sharedKeys[i] = deriveSymmetricKey(privKey, *pubKeys[i].second);
+            }
+        });
+    }
+
+    std::map<handle, std::string> result;
+    for (size_t i = 0; i < pubKeys.size(); ++i)
+    {
+        if (!sharedKeys[i].empty())
+        {
+            result.emplace(pubKeys[i].first, std::move(sharedKeys[i]));
+        }
+    }
+    return result;
+}
+
+const string* KeyManager::contactCu25519PubKey(handle user)
 {
     User *u = mClient.finduser(user, 0);
     if (!u)
     {
-        return std::string();
+        return nullptr;
     }
 
     const string *cachedav = u->getattr(ATTR_CU25519_PUBK);
@@ -22073,11 +22867,16 @@ string KeyManager::computeSymmetricKey(handle user)
             assert(false);
             mClient.sendevent(99464, "KeyMgr / Ed/Cu retrieval failed");
         }
-        return std::string();
+        return nullptr;
     }
 
+    return cachedav;
+}
+
+string KeyManager::deriveSymmetricKey(const string& privKey, const string& pubKey)
+{
     std::string sharedSecret;
-    ECDH ecdh(mClient.chatkey->getPrivKey(), *cachedav);
+    ECDH ecdh(reinterpret_cast<const unsigned char*>(privKey.data()), pubKey);
     if (!ecdh.computeSymmetricKey(sharedSecret))
     {
         return std::string();
@@ -0,0 +1,207 @@
+/**
+ * @file metrics.cpp
+ * @brief Counters, gauges and latency histograms of the hot paths
+ *
+ * (c) 2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "mega/metrics.h"
+#include "mega/json.h"
+
+namespace mega {
+
+namespace Metrics {
+
+unsigned Histogram::bucketOf(uint64_t us)
+{
+    if (us < SUB_BUCKETS)
+    {
+        return static_cast<unsigned>(us);
+    }
+
+    unsigned power = 0;
+    while ((us >> power) > 1)
+    {
+        ++power;
+    }
+    if (power > MAX_POWER)
+    {
+        return BUCKETS - 1;
+    }
+
+    unsigned sub = static_cast<unsigned>(us >> (power - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return (power - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t Histogram::bucketUpperBound(unsigned bucket)
+{
+    if (bucket < SUB_BUCKETS)
+    {
+        return bucket;
+    }
+
+    unsigned power = bucket / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    uint64_t sub = bucket % SUB_BUCKETS;
+    uint64_t width = uint64_t(1) << (power - SUB_BUCKET_BITS);
+    return ((SUB_BUCKETS + sub) << (power - SUB_BUCKET_BITS)) + width - 1;
+}
+
+void Histogram::record(uint64_t us)
+{
+    mBuckets[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+    mCount.fetch_add(1, std::memory_order_relaxed);
+    mSum.fetch_add(us, std::memory_order_relaxed);
+
+    uint64_t max = mMax.load(std::memory_order_relaxed);
+    while (us > max && !mMax.compare_exchange_weak(max, us, std::memory_order_relaxed))
+    {
+    }
+}
+
+uint64_t Histogram::percentile(double p) const
+{
+    // the buckets may be being updated meanwhile: use their own total
+    uint64_t total = 0;
+    std::array<uint64_t, BUCKETS> counts;
+    for (unsigned i = 0; i < BUCKETS; ++i)
+    {
+        counts[i] = mBuckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (!total)
+    {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(p / 100 * static_cast<double>(total));
+    rank = std::max<uint64_t>(1, std::min(rank, total));
+
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < BUCKETS; ++i)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+        {
+            // the last bucket has no upper bound
+            return std::min(bucketUpperBound(i), max());
+        }
+    }
+    return max();
+}
+
+void Histogram::reset()
+{
+    for (auto& bucket : mBuckets)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    mCount.store(0, std::memory_order_relaxed);
+    mSum.store(0, std::memory_order_relaxed);
+    mMax.store(0, std::memory_order_relaxed);
+}
+
+Counter& Registry::counter(const std::string& name)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    auto& counter = mCounters[name];
+    if (!counter)
+    {
+        counter.reset(new Counter);
+    }
+    return *counter;
+}
+
+Gauge& Registry::gauge(const std::string& name)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    auto& gauge = mGauges[name];
+    if (!gauge)
+    {
+        gauge.reset(new Gauge);
+    }
+    return *gauge;
+}
+
+Histogram& Registry::histogram(const std::string& name)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    auto& histogram = mHistograms[name];
+    if (!histogram)
+    {
+        histogram.reset(new Histogram);
+    }
+    return *histogram;
+}
+
+std::string Registry::snapshot(bool reset)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+
+    JSONWriter json;
+    json.beginobject();
+
+    json.beginobject("counters");
+    for (auto& counter : mCounters)
+    {
+        json.arg(counter.first.c_str(), static_cast<m_off_t>(counter.second->value()));
+        if (reset)
+        {
+            counter.second->reset();
+        }
+    }
+    json.endobject();
+
+    json.beginobject("gauges");
+    for (auto& gauge : mGauges)
+    {
+        json.arg(gauge.first.c_str(), static_cast<m_off_t>(gauge.second->value()));
+    }
+    json.endobject();
+
+    json.beginobject("histograms");
+    for (auto& histogram : mHistograms)
+    {
+        const Histogram& h = *histogram.second;
+        json.beginobject(histogram.first.c_str());
+        json.arg("count", static_cast<m_off_t>(h.count()));
+        json.arg("sum_us", static_cast<m_off_t>(h.sum()));
+        json.arg("max_us", static_cast<m_off_t>(h.max()));
+        json.arg("p50_us", static_cast<m_off_t>(h.percentile(50)));
+        json.arg("p90_us", static_cast<m_off_t>(h.percentile(90)));
+        json.arg("p99_us", static_cast<m_off_t>(h.percentile(99)));
+        json.arg("p999_us", static_cast<m_off_t>(h.percentile(99.9)));
+        json.endobject();
+        if (reset)
+        {
+            histogram.second->reset();
+        }
+    }
+    json.endobject();
+
+    json.endobject();
+    return json.getstring();
+}
+
+Registry& registry()
+{
+    static Registry registry;
+    return registry;
+}
+
+} // namespace Metrics
+
+} // namespace mega
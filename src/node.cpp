@@ -99,6 +99,7 @@ Node::~Node()
     client->preadabort(this);
 
     client->mNodeManager.decreaseNumNodesInRam();
+    client->mNodeManager.removeExpiredNodeFromRamIndex(nodeHandle());
 }
 int Node::getShareType() const
 {
@@ -565,6 +566,12 @@ bool Node::serialize(string* d) const
 
     s = type ? -type : size;
 
+    // the fixed-size fields and the byte strings, without the shares, to avoid growing the string piece by piece
+    CacheableWriter(*d).reserve(128 + 2 * nodekeydata.size() + fileattrstring.size() + attrs.serializedsize()
+                                + (attrstring ? attrstring->size() : 0));
+
+    // size/type, handles, owner and ctime form a fixed-offset header that NodeData
+    // reads without decoding the rest of the blob: don't change their order or width
     d->append((char*)&s, sizeof s);
 
     d->append((char*)&nodehandle, MegaClient::NODEHANDLE);
@@ -791,32 +798,38 @@ void Node::setattr()
 
     if (attrstring && (cipher = nodecipher()) && (buf = decryptattr(cipher, attrstring->c_str(), attrstring->size())))
     {
-        AttrMap oldAttrs(attrs);
-        attrs.map.clear();
-        attrs.fromjson(reinterpret_cast<char*>(buf) + 5);
+        AttrMap newAttrs;
+        newAttrs.fromjson(reinterpret_cast<char*>(buf) + 5);
+        delete[] buf;
 
-        auto it = attrs.map.find('n');
-        if (it != std::end(attrs.map)) LocalPath::utf8_normalize(&it->second);
+        auto it = newAttrs.map.find('n');
+        if (it != std::end(newAttrs.map)) LocalPath::utf8_normalize(&it->second);
 
-        changed.name = attrs.hasDifferentValue('n', oldAttrs.map);
-        changed.favourite = attrs.hasDifferentValue(AttrMap::string2nameid("fav"), oldAttrs.map);
-        changed.sensitive = attrs.hasDifferentValue(AttrMap::string2nameid("sen"), oldAttrs.map);
+        applyAttrs(std::move(newAttrs));
+    }
+}
 
-        const auto pwdNameid = AttrMap::string2nameid(MegaClient::NODE_ATTR_PASSWORD_MANAGER);
-        changed.pwd = attrs.hasDifferentValue(pwdNameid, oldAttrs.map);
+void Node::applyAttrs(AttrMap&& newAttrs)
+{
+    AttrMap oldAttrs(std::move(attrs));
+    attrs = std::move(newAttrs);
 
-        const auto descriptionNameid = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_DESCRIPTION);
-        changed.description = attrs.hasDifferentValue(descriptionNameid, oldAttrs.map);
+    changed.name = attrs.hasDifferentValue('n', oldAttrs.map);
+    changed.favourite = attrs.hasDifferentValue(AttrMap::string2nameid("fav"), oldAttrs.map);
+    changed.sensitive = attrs.hasDifferentValue(AttrMap::string2nameid("sen"), oldAttrs.map);
 
-        const auto tagsNameid = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_TAGS);
-        changed.tags = attrs.hasDifferentValue(tagsNameid, oldAttrs.map);
+    const auto pwdNameid = AttrMap::string2nameid(MegaClient::NODE_ATTR_PASSWORD_MANAGER);
+    changed.pwd = attrs.hasDifferentValue(pwdNameid, oldAttrs.map);
 
-        setfingerprint();
+    const auto descriptionNameid = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_DESCRIPTION);
+    changed.description = attrs.hasDifferentValue(descriptionNameid, oldAttrs.map);
 
-        delete[] buf;
+    const auto tagsNameid = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_TAGS);
+    changed.tags = attrs.hasDifferentValue(tagsNameid, oldAttrs.map);
 
-        attrstring.reset();
-    }
+    setfingerprint();
+
+    attrstring.reset();
 }
 
 nameid Node::sdsId()
@@ -1131,11 +1144,27 @@ bool Node::applykey()
         return false;
     }
 
+    const char* k = nullptr;
+    SymmCipher* sc = nullptr;
+    if (!findDecryptableKey(k, sc))
+    {
+        return false;
+    }
+
+    byte key[FILENODEKEYLENGTH];
+    unsigned keylength = (type == FILENODE) ? FILENODEKEYLENGTH : FOLDERNODEKEYLENGTH;
+
+    bool decrypted = client->decryptkey(k, key, keylength, sc, 0, nodehandle);
+    return applyDecryptedKey(decrypted ? key : nullptr, nullptr);
+}
+
+bool Node::findDecryptableKey(const char*& k, SymmCipher*& sc)
+{
     int l = -1;
     size_t t = 0;
     handle h;
-    const char* k = NULL;
-    SymmCipher* sc = &client->key;
+    k = nullptr;
+    sc = &client->key;
     handle me = client->loggedIntoFolder() ? client->mNodeManager.getRootNodeFiles().as8byte() : client->me;
 
     while ((t = nodekeydata.find_first_of(':', t)) != string::npos)
@@ -1214,15 +1243,111 @@ bool Node::applykey()
         }
     }
 
-    byte key[FILENODEKEYLENGTH];
+    return true;
+}
+
+bool Node::prepareKeyDecryption(KeyDecryption& job)
+{
+    if (type > FOLDERNODE)
+    {
+        //Root nodes contain an empty attrstring
+        attrstring.reset();
+    }
+
+    if (keyApplied() || !nodekeydata.size())
+    {
+        return false;
+    }
+
+    const char* k = nullptr;
+    SymmCipher* sc = nullptr;
+    if (!findDecryptableKey(k, sc))
+    {
+        return false;
+    }
+
+    // measure key length (same as MegaClient::decryptkey())
+    const char* ptr = k;
+    while (*ptr && *ptr != '"' && *ptr != '/')
+    {
+        ptr++;
+    }
+
+    if (ptr - k > 4 * FILENODEKEYLENGTH / 3 + 1)
+    {
+        // RSA-encrypted keys are decrypted here: the private key is not meant to be used concurrently
+        unsigned keylength = (type == FILENODE) ? FILENODEKEYLENGTH : FOLDERNODEKEYLENGTH;
+        job.mKeyDecrypted = client->decryptkey(k, job.mKey, static_cast<int>(keylength), sc, 0, nodehandle);
+    }
+    else
+    {
+        // `sc` may be the recycled temporary cipher: keep a copy of its key
+        job.mEncryptedKey.assign(k, ptr);
+        memcpy(job.mUnwrapKey, sc->key, sizeof job.mUnwrapKey);
+    }
+
+    return true;
+}
+
+void Node::decryptKeyAndAttrs(KeyDecryption& job, SymmCipher& cipher)
+{
+    const Node& node = *job.mNode;
+    int keylength = (node.type == FILENODE) ? FILENODEKEYLENGTH : FOLDERNODEKEYLENGTH;
+
+    if (!job.mEncryptedKey.empty())
+    {
+        if (Base64::atob(job.mEncryptedKey.c_str(), job.mKey, keylength) != keylength)
+        {
+            LOG_warn << "Corrupt or invalid symmetric node key";
+            return;
+        }
+
+        cipher.setkey(job.mUnwrapKey);
+        cipher.ecb_decrypt(job.mKey, static_cast<size_t>(keylength));
+        job.mKeyDecrypted = true;
+    }
+
+    if (!job.mKeyDecrypted || !node.attrstring)
+    {
+        return;
+    }
+
+    cipher.setkey(job.mKey, node.type);
+    std::unique_ptr<byte[]> buf(decryptattr(&cipher, node.attrstring->c_str(), node.attrstring->size()));
+    if (buf)
+    {
+        job.mAttrs.reset(new AttrMap);
+        job.mAttrs->fromjson(reinterpret_cast<char*>(buf.get()) + 5);
+
+        auto it = job.mAttrs->map.find('n');
+        if (it != std::end(job.mAttrs->map)) LocalPath::utf8_normalize(&it->second);
+    }
+}
+
+bool Node::applyKeyDecryption(KeyDecryption& job)
+{
+    assert(job.mNode.get() == this);
+    return applyDecryptedKey(job.mKeyDecrypted ? job.mKey : nullptr, std::move(job.mAttrs));
+}
+
+bool Node::applyDecryptedKey(const byte* key, unique_ptr<AttrMap> decryptedAttrs)
+{
     unsigned keylength = (type == FILENODE) ? FILENODEKEYLENGTH : FOLDERNODEKEYLENGTH;
 
-    if (client->decryptkey(k, key, keylength, sc, 0, nodehandle))
+    if (key)
     {
         std::string undecryptedKey = nodekeydata;
         client->mAppliedKeyNodeCount++;
         nodekeydata.assign((const char*)key, keylength);
-        setattr();
+        if (decryptedAttrs)
+        {
+            applyAttrs(std::move(*decryptedAttrs));
+        }
+        else
+        {
+            setattr();
+        }
+
         if (attrstring)
         {
             if (foreignkey)
@@ -1441,12 +1566,14 @@ bool Node::isPasswordNodeFolder() const
 }
 
 
-bool NodeData::readComponents()
+// size of the fixed-offset header at the beginning of a serialized node (see Node::serialize())
+static constexpr size_t NODE_HEADER_SIZE = sizeof(m_off_t) + 2 * MegaClient::NODEHANDLE + MegaClient::USERHANDLE + 2 * sizeof(time_t);
+
+bool NodeData::readHeader()
 {
-    mReadAttempted = true;
     const char* ptr = mStart;
 
-    if (!ptr || ptr + sizeof(m_off_t) + MegaClient::NODEHANDLE > mEnd)
+    if (!ptr || ptr + NODE_HEADER_SIZE > mEnd)
     {
         return false;
     }
@@ -1455,55 +1582,54 @@ bool NodeData::readComponents()
     mSize = MemAccess::get<m_off_t>(ptr);
     ptr += sizeof(m_off_t);
     mType = (mSize < 0 && mSize >= -RUBBISHNODE) ? (nodetype_t)-mSize : FILENODE;
-    int nodeKeyLen = (mType == FILENODE) ? FILENODEKEYLENGTH : ((mType == FOLDERNODE) ? FOLDERNODEKEYLENGTH : 0);
 
     /// node handle
     memcpy((char*)&mHandle, ptr, MegaClient::NODEHANDLE);
     ptr += MegaClient::NODEHANDLE;
 
-    // size of next data chunk
-    constexpr int lenBeforeNodeKey = MegaClient::NODEHANDLE + MegaClient::USERHANDLE + 2 * sizeof(time_t);
-
-    if (mComp == COMPONENT_ALL)
+    /// parent handle
+    memcpy((char*)&mParentHandle, ptr, MegaClient::NODEHANDLE);
+    if (!mParentHandle)
     {
-        if (ptr + lenBeforeNodeKey + nodeKeyLen > mEnd)
-        {
-            return false;
-        }
+        mParentHandle = UNDEF;
+    }
+    ptr += MegaClient::NODEHANDLE;
 
-        /// parent handle
-        memcpy((char*)&mParentHandle, ptr, MegaClient::NODEHANDLE);
-        if (!mParentHandle)
-        {
-            mParentHandle = UNDEF;
-        }
-        ptr += MegaClient::NODEHANDLE;
+    /// user handle
+    memcpy((char*)&mUserHandle, ptr, MegaClient::USERHANDLE);
+    ptr += MegaClient::USERHANDLE;
 
-        /// user handle
-        memcpy((char*)&mUserHandle, ptr, MegaClient::USERHANDLE);
-        ptr += MegaClient::USERHANDLE;
+    /// ctime
+    ptr += sizeof(time_t); // FIME: use m_time_t / Serialize64 instead
+    mCtime = (uint32_t)MemAccess::get<time_t>(ptr);
 
-        /// ctime
-        ptr += sizeof(time_t); // FIME: use m_time_t / Serialize64 instead
-        mCtime = (uint32_t)MemAccess::get<time_t>(ptr);
-        ptr += sizeof(time_t);
+    mHeaderRead = true;
+    return true;
+}
 
-        /// node key
-        if ((mType == FILENODE) || (mType == FOLDERNODE))
-        {
-            if (ptr + nodeKeyLen > mEnd)
-            {
-                return false;
-            }
+bool NodeData::readComponents()
+{
+    mReadAttempted = true;
 
-            mNodeKey.assign(ptr, nodeKeyLen);
-            ptr += nodeKeyLen;
-        }
+    if (headerReadFailed())
+    {
+        return false;
     }
-    else
+
+    const char* ptr = mStart + NODE_HEADER_SIZE;
+    int nodeKeyLen = (mType == FILENODE) ? FILENODEKEYLENGTH : ((mType == FOLDERNODE) ? FOLDERNODEKEYLENGTH : 0);
+
+    /// node key
+    if (ptr + nodeKeyLen > mEnd)
     {
-        ptr += lenBeforeNodeKey + nodeKeyLen;
+        return false;
+    }
+
+    if (mComp == COMPONENT_ALL && nodeKeyLen)
+    {
+        mNodeKey.assign(ptr, nodeKeyLen);
     }
+    ptr += nodeKeyLen;
 
     /// file attributes
     if (mType == FILENODE)
@@ -1775,6 +1901,31 @@ std::string NodeData::getTags()
     return attrIt == mAttrs.map.end() ? std::string() : attrIt->second.c_str();
 }
 
+nodetype_t NodeData::getType()
+{
+    return headerReadFailed() ? TYPE_UNKNOWN : mType;
+}
+
+m_off_t NodeData::getSize()
+{
+    return headerReadFailed() || mType != FILENODE ? 0 : mSize;
+}
+
+handle NodeData::getParentHandle()
+{
+    return headerReadFailed() ? UNDEF : mParentHandle;
+}
+
+handle NodeData::getOwner()
+{
+    return headerReadFailed() ? UNDEF : mUserHandle;
+}
+
+m_time_t NodeData::getCtime()
+{
+    return headerReadFailed() ? 0 : mCtime;
+}
+
 handle NodeData::getHandle()
 {
     if (readFailed())
@@ -1921,10 +2072,13 @@ void LocalNode::setnameparent(LocalNode* newparent, const LocalPath& newlocalpat
             parentChange || shortnameChange))
         {
             // remove existing child linkage for slocalname
-            auto it = parent->schildren.find(*slocalname);
-            if (it != parent->schildren.end() && it->second == this)
+            if (parent->schildren)
             {
-                parent->schildren.erase(it);
+                auto it = parent->schildren->find(*slocalname);
+                if (it != parent->schildren->end() && it->second == this)
+                {
+                    parent->schildren->erase(it);
+                }
             }
         }
     }
@@ -1979,7 +2133,11 @@ void LocalNode::setnameparent(LocalNode* newparent, const LocalPath& newlocalpat
     {
         // it's quite possible that the new folder still has an older LocalNode with clashing shortname, that represents a file/folder since moved, but which we don't know about yet.
         // just assign the new one, we forget the old reference.  The other LocalNode will not remove this one since the LocalNode* will not match.
-        parent->schildren[*slocalname] = this;
+        if (!parent->schildren)
+        {
+            parent->schildren.reset(new localnode_map);
+        }
+        (*parent->schildren)[*slocalname] = this;
     }
 
     // reset treestate
@@ -2069,12 +2227,11 @@ LocalNode::LocalNode(Sync* csync)
 , certainlyOrphaned(0)
 , neverScanned(0)
 , localFSCannotStoreThisName(0)
+, inSyncedFsidMap(0)
+, inScannedFsidMap(0)
+, inNodeHandleMap(0)
 , mIsIgnoreFile(false)
 {
-    fsid_lastSynced_it = sync->syncs.localnodeBySyncedFsid.end();
-    fsid_asScanned_it = sync->syncs.localnodeByScannedFsid.end();
-    syncedCloudNodeHandle_it = sync->syncs.localnodeByNodeHandle.end();
-
     sync->syncs.totalLocalNodes++;
 }
 
@@ -2367,7 +2524,7 @@ bool LocalNode::scanRequired() const
     return scanAgain != TREE_RESOLVED;
 }
 
-void LocalNode::clearRegeneratableFolderScan(SyncPath& fullPath, vector<SyncRow>& childRows)
+void LocalNode::clearRegeneratableFolderScan(SyncPath& fullPath, vector<SyncRow>& childRows, const FSNode* fsNode)
 {
     if (lastFolderScan &&
         lastFolderScan->size() == children.size())
@@ -2403,10 +2560,50 @@ void LocalNode::clearRegeneratableFolderScan(SyncPath& fullPath, vector<SyncRow>
             // LocalNodes are now consistent with the last scan.
             LOG_debug << sync->syncname << "Clearing regeneratable folder scan records (" << lastFolderScan->size() << ") at " << fullPath.localPath;
             lastFolderScan.reset();
+
+            if (fsNode)
+            {
+                updateScanSignature(*fsNode);
+            }
         }
     }
 }
 
+void LocalNode::updateScanSignature(const FSNode& fsNode)
+{
+    // the root's FSNode is not scanned (it's generated from its synced details), and it's not in the DB anyway
+    if (!parent || fsNode.type != FOLDERNODE || fsNode.fsid != fsid_lastSynced)
+    {
+        return;
+    }
+
+    ScanSignature signature;
+    signature.mtime = fsNode.fingerprint.mtime;
+    signature.childCount = static_cast<uint32_t>(children.size());
+    signature.filesystemTag = sync->mScanSignatureTag;
+
+    if (!(scanSignature == signature))
+    {
+        scanSignature = signature;
+        sync->statecacheadd(this);
+    }
+}
+
+bool LocalNode::scanSignatureMatches(const FSNode& fsNode) const
+{
+    // Same directory, same mount, and no entries added, removed or renamed since we last
+    // matched it (its mtime would have changed). Files modified in place don't change it,
+    // which is why a matching folder is only trusted if the notifier replays the changes made
+    // since the last run (see processBackgroundFolderScan()).
+    return parent
+        && scanSignature.filesystemTag
+        && scanSignature.filesystemTag == sync->mScanSignatureTag
+        && fsNode.type == FOLDERNODE
+        && fsNode.fsid == fsid_lastSynced
+        && fsNode.fingerprint.mtime == scanSignature.mtime
+        && children.size() == scanSignature.childCount;
+}
+
 bool LocalNode::mightHaveMoves() const
 {
     return checkMovesAgain != TREE_RESOLVED;
@@ -2458,19 +2655,51 @@ bool LocalNode::processBackgroundFolderScan(SyncRow& row, SyncPath& fullPath)
     std::shared_ptr<ScanService::ScanRequest> ourScanRequest = scanInProgress ? rare().scanRequest  : nullptr;
 
     std::shared_ptr<ScanService::ScanRequest>* availableScanSlot = nullptr;
-    if (!sync->mActiveScanRequestGeneral || sync->mActiveScanRequestGeneral->completed())
+    for (auto& generalSlot : sync->mActiveScanRequestsGeneral)
     {
-        availableScanSlot = &sync->mActiveScanRequestGeneral;
+        if (!generalSlot || generalSlot->completed())
+        {
+            availableScanSlot = &generalSlot;
+            break;
+        }
     }
-    else if (neverScanned &&
+
+    if (!availableScanSlot && neverScanned &&
             (!sync->mActiveScanRequestUnscanned || sync->mActiveScanRequestUnscanned->completed()))
     {
         availableScanSlot = &sync->mActiveScanRequestUnscanned;
     }
 
+    string notifierFailure;
+    if (!ourScanRequest && neverScanned && scanSignatureMatches(*row.fsNode) &&
+        sync->dirnotify && sync->dirnotify->replaysChanges() && !sync->dirnotify->getFailed(notifierFailure))
+    {
+        // Unchanged since the last run, and the changes made inside meanwhile are notified by the replay:
+        // its entries are the synced ones, no need to scan it. Otherwise it's scanned as usual
+        lastFolderScan.reset(new vector<FSNode>);
+        for (auto& childIt : children)
+        {
+            auto& child = *childIt.second;
+            if (child.fsid_lastSynced != UNDEF && (child.type != FILENODE || child.syncedFingerprint.isvalid))
+            {
+                lastFolderScan->push_back(child.getLastSyncedFSDetails());
+            }
+        }
+
+        LOG_verbose << sync->syncname << "Folder matches its scan signature, skipping its first scan: " << fullPath.localPath;
+
+        neverScanned = 0;
+        --sync->threadSafeState->neverScannedFolderCount;
+
+        scanDelayUntil = Waiter::ds + 20; // don't scan too frequently
+        scanAgain = TREE_RESOLVED;
+        setSyncAgain(false, true, false);
+        return true;
+    }
+
     if (!ourScanRequest && availableScanSlot)
     {
-        // we can start a single new request if we are still recursing and the last request from this sync completed already
+        // we can start a new request if we are still recursing and this sync has a free slot for it
         if (scanDelayUntil != 0 && Waiter::ds < scanDelayUntil)
         {
             LOG_verbose << sync->syncname << "Too soon to scan this folder, needs more ds: " << scanDelayUntil - Waiter::ds;
@@ -2484,6 +2713,9 @@ bool LocalNode::processBackgroundFolderScan(SyncRow& row, SyncPath& fullPath)
             // If enough details of the scan are the same, we can reuse fingerprints instead of recalculating
             map<LocalPath, FSNode> priorScanChildren;
 
+            // Files notified as changed must be read again, even if their size and mtime are the same
+            std::set<LocalPath> recomputeChildren;
+
             if (lastFolderScan)
             {
                 // use the same fingerprint shortcut data as the last time we scanned,
@@ -2507,6 +2739,11 @@ bool LocalNode::processBackgroundFolderScan(SyncRow& row, SyncPath& fullPath)
                 bool forceRecompute = child.recomputeFingerprint;
                 child.recomputeFingerprint = false;
 
+                if (child.type == FILENODE && forceRecompute)
+                {
+                    recomputeChildren.insert(child.localname);
+                }
+
                 // Can't fingerprint directories.
                 if (child.type != FILENODE || forceRecompute)
                 {
@@ -2534,7 +2771,7 @@ bool LocalNode::processBackgroundFolderScan(SyncRow& row, SyncPath& fullPath)
             }
 
             ourScanRequest = sync->syncs.mScanService->queueScan(fullPath.localPath,
-                row.fsNode->fsid, false, move(priorScanChildren), sync->syncs.waiter);
+                row.fsNode->fsid, false, move(priorScanChildren), sync->syncs.waiter, sync->fsfp().fingerprint(), move(recomputeChildren));
 
             rare().scanRequest = ourScanRequest;
             *availableScanSlot = ourScanRequest;
@@ -2545,7 +2782,10 @@ bool LocalNode::processBackgroundFolderScan(SyncRow& row, SyncPath& fullPath)
     else if (ourScanRequest &&
              ourScanRequest->completed())
     {
-        if (ourScanRequest == sync->mActiveScanRequestGeneral) sync->mActiveScanRequestGeneral.reset();
+        for (auto& generalSlot : sync->mActiveScanRequestsGeneral)
+        {
+            if (ourScanRequest == generalSlot) generalSlot.reset();
+        }
         if (ourScanRequest == sync->mActiveScanRequestUnscanned) sync->mActiveScanRequestUnscanned.reset();
 
         scanInProgress = false;
@@ -2696,7 +2936,9 @@ void LocalNode::recursiveSetAndReportTreestate(treestate_t ts, bool recurse, boo
     if (reportToApp && ts != mReportedSyncState)
     {
         assert(sync->syncs.onSyncThread());
-        sync->syncs.mClient.app->syncupdate_treestate(sync->getConfig(), getLocalPath(), ts, type);
+        LocalPath localPath = getLocalPath();
+        sync->syncs.mSyncPathStates.update(localPath, ts);
+        sync->syncs.mClient.app->syncupdate_treestate(sync->getConfig(), localPath, ts, type);
     }
 
     mReportedSyncState = ts;
@@ -2747,17 +2989,34 @@ treestate_t LocalNode::checkTreestate(bool notifyChangeToApp)
 }
 
 
+// remove the entry of a LocalNode from one of the fsid/handle maps, among the others with the same key
+template<class Map>
+static void eraseLocalNodeEntry(Map& m, const typename Map::key_type& key, LocalNode* ln)
+{
+    auto range = m.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it->second == ln)
+        {
+            m.erase(it);
+            return;
+        }
+    }
+    assert(false);
+}
+
 // set fsid - assume that an existing assignment of the same fsid is no longer current and revoke
 void LocalNode::setSyncedFsid(handle newfsid, fsid_localnode_map& fsidnodes, const LocalPath& fsName, std::unique_ptr<LocalPath> newshortname)
 {
-    if (fsid_lastSynced_it != fsidnodes.end())
+    if (inSyncedFsidMap)
     {
         if (newfsid == fsid_lastSynced && localname == fsName)
         {
             return;
         }
 
-        fsidnodes.erase(fsid_lastSynced_it);
+        eraseLocalNodeEntry(fsidnodes, fsid_lastSynced, this);
+        inSyncedFsidMap = false;
     }
 
     fsid_lastSynced = newfsid;
@@ -2774,13 +3033,10 @@ void LocalNode::setSyncedFsid(handle newfsid, fsid_localnode_map& fsidnodes, con
 
     // LOG_verbose << "localnode " << this << " fsid " << toHandle(fsid_lastSynced) << " localname " << fsName.toPath() << " parent " << parent;
 
-    if (fsid_lastSynced == UNDEF)
-    {
-        fsid_lastSynced_it = fsidnodes.end();
-    }
-    else
+    if (fsid_lastSynced != UNDEF)
     {
-        fsid_lastSynced_it = fsidnodes.insert(std::make_pair(fsid_lastSynced, this));
+        fsidnodes.emplace(fsid_lastSynced, this);
+        inSyncedFsidMap = true;
     }
 
 //    assert(localname.empty() || name.empty() || (!parent && parent_dbid == UNDEF) || parent_dbid == 0 ||
@@ -2789,9 +3045,10 @@ void LocalNode::setSyncedFsid(handle newfsid, fsid_localnode_map& fsidnodes, con
 
 void LocalNode::setScannedFsid(handle newfsid, fsid_localnode_map& fsidnodes, const LocalPath& fsName, const FileFingerprint& scanfp)
 {
-    if (fsid_asScanned_it != fsidnodes.end())
+    if (inScannedFsidMap)
     {
-        fsidnodes.erase(fsid_asScanned_it);
+        eraseLocalNodeEntry(fsidnodes, fsid_asScanned, this);
+        inScannedFsidMap = false;
     }
 
     fsid_asScanned = newfsid;
@@ -2799,13 +3056,10 @@ void LocalNode::setScannedFsid(handle newfsid, fsid_localnode_map& fsidnodes, co
 
     scannedFingerprint = scanfp;
 
-    if (fsid_asScanned == UNDEF)
-    {
-        fsid_asScanned_it = fsidnodes.end();
-    }
-    else
+    if (fsid_asScanned != UNDEF)
     {
-        fsid_asScanned_it = fsidnodes.insert(std::make_pair(fsid_asScanned, this));
+        fsidnodes.emplace(fsid_asScanned, this);
+        inScannedFsidMap = true;
     }
 
     assert(fsid_asScanned == UNDEF || 0 == compareUtf(localname, true, fsName, true, true));
@@ -2813,33 +3067,29 @@ void LocalNode::setScannedFsid(handle newfsid, fsid_localnode_map& fsidnodes, co
 
 void LocalNode::setSyncedNodeHandle(NodeHandle h)
 {
-    if (syncedCloudNodeHandle_it != sync->syncs.localnodeByNodeHandle.end())
+    if (inNodeHandleMap)
     {
         if (h == syncedCloudNodeHandle)
         {
             return;
         }
 
-        assert(syncedCloudNodeHandle_it->first == syncedCloudNodeHandle);
-
         // too verbose for million-node syncs
         //LOG_verbose << sync->syncname << "removing synced handle " << syncedCloudNodeHandle << " for " << localnodedisplaypath(*sync->syncs.fsaccess);
 
-        sync->syncs.localnodeByNodeHandle.erase(syncedCloudNodeHandle_it);
+        eraseLocalNodeEntry(sync->syncs.localnodeByNodeHandle, syncedCloudNodeHandle, this);
+        inNodeHandleMap = false;
     }
 
     syncedCloudNodeHandle = h;
 
-    if (syncedCloudNodeHandle == UNDEF)
-    {
-        syncedCloudNodeHandle_it = sync->syncs.localnodeByNodeHandle.end();
-    }
-    else
+    if (syncedCloudNodeHandle != UNDEF)
     {
         // too verbose for million-node syncs
         //LOG_verbose << sync->syncname << "adding synced handle " << syncedCloudNodeHandle << " for " << localnodedisplaypath(*sync->syncs.fsaccess);
 
-        syncedCloudNodeHandle_it = sync->syncs.localnodeByNodeHandle.insert(std::make_pair(syncedCloudNodeHandle, this));
+        sync->syncs.localnodeByNodeHandle.emplace(syncedCloudNodeHandle, this);
+        inNodeHandleMap = true;
     }
 
 //    assert(localname.empty() || name.empty() || (!parent && parent_dbid == UNDEF) || parent_dbid == 0 ||
@@ -2874,20 +3124,27 @@ LocalNode::~LocalNode()
         sync->syncs.mMoveInvolvedLocalNodes.erase(this);
 
         // remove from fsidnode map, if present
-        if (fsid_lastSynced_it != sync->syncs.localnodeBySyncedFsid.end())
+        if (inSyncedFsidMap)
         {
-            sync->syncs.localnodeBySyncedFsid.erase(fsid_lastSynced_it);
+            eraseLocalNodeEntry(sync->syncs.localnodeBySyncedFsid, fsid_lastSynced, this);
         }
-        if (fsid_asScanned_it != sync->syncs.localnodeByScannedFsid.end())
+        if (inScannedFsidMap)
         {
-            sync->syncs.localnodeByScannedFsid.erase(fsid_asScanned_it);
+            eraseLocalNodeEntry(sync->syncs.localnodeByScannedFsid, fsid_asScanned, this);
         }
-        if (syncedCloudNodeHandle_it != sync->syncs.localnodeByNodeHandle.end())
+        if (inNodeHandleMap)
         {
-            sync->syncs.localnodeByNodeHandle.erase(syncedCloudNodeHandle_it);
+            eraseLocalNodeEntry(sync->syncs.localnodeByNodeHandle, syncedCloudNodeHandle, this);
         }
     }
 
+    // Nodes detach from their parent before deleting their children, so only the topmost
+    // deleted node is still attached to the tree and removes the states below it too.
+    if (!sync->mDestructorRunning && parent && (parent->parent || parent == sync->localroot.get()))
+    {
+        sync->syncs.mSyncPathStates.remove(getLocalPath(), type != FILENODE);
+    }
+
     sync->syncs.totalLocalNodes--;
     sync->threadSafeState->incrementSyncNodeCount(type, -1);
 
@@ -2959,15 +3216,16 @@ LocalPath LocalNode::getLocalPath() const
 
 void LocalNode::getlocalpath(LocalPath& path) const
 {
-    path.clear();
-
-    for (const LocalNode* l = this; l != nullptr; l = l->parent)
+    // the nodes keep just their leaf name (the sync root, its absolute path), so the path is built
+    // from them every time, at once rather than prepending one name after the other
+    path.assignFromLeafNames([this](auto&& name)
     {
-        assert(!l->parent || l->parent->sync == sync);
-
-        // sync root has absolute path, the rest are just their leafname
-        path.prependWithSeparator(l->localname);
-    }
+        for (const LocalNode* l = this; l != nullptr; l = l->parent)
+        {
+            assert(!l->parent || l->parent->sync == sync);
+            name(l->localname);
+        }
+    });
 }
 
 string LocalNode::getCloudPath(bool guessLeafName) const
@@ -3029,14 +3287,30 @@ LocalNode* LocalNode::childbyname(LocalPath* localname)
 {
     localnode_map::iterator it;
 
-    if (!localname || ((it = children.find(*localname)) == children.end() && (it = schildren.find(*localname)) == schildren.end()))
+    if (!localname)
     {
         return NULL;
     }
 
+    if ((it = children.find(*localname)) == children.end())
+    {
+        return childByShortname(*localname);
+    }
+
     return it->second;
 }
 
+LocalNode* LocalNode::childByShortname(const LocalPath& name) const
+{
+    if (!schildren)
+    {
+        return nullptr;
+    }
+
+    auto it = schildren->find(name);
+    return it == schildren->end() ? nullptr : it->second;
+}
+
 LocalNode* LocalNode::findChildWithSyncedNodeHandle(NodeHandle h)
 {
     for (auto& c : children)
@@ -3231,12 +3505,16 @@ bool LocalNodeCore::write(string& destination, uint32_t parentID) const
     // We need size even if we're not synced.
     auto size = syncedFingerprint.isvalid ? syncedFingerprint.size : 0;
 
+    auto name = localname.platformEncoded();
+    auto shortname = slocalname ? slocalname->platformEncoded() : string();
+
     CacheableWriter w(destination);
+    w.reserve(96 + name.size() + shortname.size());
     w.serializei64(type ? -type : size);
     w.serializehandle(fsid_lastSynced);
     w.serializeu32(parentID);
     w.serializenodehandle(syncedCloudNodeHandle.as8byte());
-    w.serializestring(localname.platformEncoded());
+    w.serializestring(name);
     if (type == FILENODE)
     {
         if (syncedFingerprint.isvalid)
@@ -3259,12 +3537,20 @@ bool LocalNodeCore::write(string& destination, uint32_t parentID) const
 
     // first flag indicates we are storing slocalname.
     // Storing it is much, much faster than looking it up on startup.
-    w.serializeexpansionflags(1, 1);
-    auto tmpstr = slocalname ? slocalname->platformEncoded() : string();
-    w.serializepstr(slocalname ? &tmpstr : nullptr);
+    // third flag indicates we are storing the folder's scan signature.
+    bool hasScanSignature = type == FOLDERNODE && scanSignature.filesystemTag;
+    w.serializeexpansionflags(1, 1, hasScanSignature);
+    w.serializepstr(slocalname ? &shortname : nullptr);
 
     w.serializebool(namesSynchronized);
 
+    if (hasScanSignature)
+    {
+        w.serializecompressedi64(scanSignature.mtime);
+        w.serializeu32(scanSignature.childCount);
+        w.serializeu32(scanSignature.filesystemTag);
+    }
+
     return true;
 }
 
@@ -3360,13 +3646,14 @@ bool LocalNodeCore::read(const string& source, uint32_t& parentID)
 
     handle fsid;
     handle h = 0;
-    string localname, shortname;
+    std::string_view localname, shortname;
     m_time_t mtime = 0;
     int32_t crc[4];
     memset(crc, 0, sizeof crc);
     byte syncable = 1;
     unsigned char expansionflags[8] = { 0 };
     bool ns = false;
+    ScanSignature signature;
 
     if (!r.unserializehandle(fsid) ||
         !r.unserializeu32(parentID) ||
@@ -3375,9 +3662,12 @@ bool LocalNodeCore::read(const string& source, uint32_t& parentID)
         (type == FILENODE && !r.unserializebinary((byte*)crc, sizeof(crc))) ||
         (type == FILENODE && !r.unserializecompressedi64(mtime)) ||
         (r.hasdataleft() && !r.unserializebyte(syncable)) ||
-        (r.hasdataleft() && !r.unserializeexpansionflags(expansionflags, 2)) ||
+        (r.hasdataleft() && !r.unserializeexpansionflags(expansionflags, 3)) ||
         (expansionflags[0] && !r.unserializecstr(shortname, false)) ||
-        (expansionflags[1] && !r.unserializebool(ns)))
+        (expansionflags[1] && !r.unserializebool(ns)) ||
+        (expansionflags[2] && !r.unserializecompressedi64(signature.mtime)) ||
+        (expansionflags[2] && !r.unserializeu32(signature.childCount)) ||
+        (expansionflags[2] && !r.unserializeu32(signature.filesystemTag)))
     {
         LOG_err << "LocalNode unserialization failed at field " << r.fieldnum;
         assert(false);
@@ -3388,10 +3678,11 @@ bool LocalNodeCore::read(const string& source, uint32_t& parentID)
     this->type = type;
     this->syncedFingerprint.size = size;
     this->fsid_lastSynced = fsid;
-    this->localname = LocalPath::fromPlatformEncodedRelative(localname);
-    this->slocalname.reset(shortname.empty() ? nullptr : new LocalPath(LocalPath::fromPlatformEncodedRelative(shortname)));
+    this->localname = LocalPath::fromPlatformEncodedRelative(string(localname));
+    this->slocalname.reset(shortname.empty() ? nullptr : new LocalPath(LocalPath::fromPlatformEncodedRelative(string(shortname))));
     this->slocalname_in_db = 0 != expansionflags[0];
     this->namesSynchronized = ns;
+    this->scanSignature = signature;
 
     memcpy(this->syncedFingerprint.crc.data(), crc, sizeof crc);
 
@@ -3917,8 +4208,7 @@ bool CloudNode::isIgnoreFile() const
 }
 
 NodeManagerNode::NodeManagerNode(NodeManager& nodeManager, NodeHandle nodeHandle)
-    : mLRUPosition(nodeManager.invalidCacheLRUPos())
-    , mNodeHandle(nodeHandle)
+    : mNodeHandle(nodeHandle)
     , mNodeManager(nodeManager)
 {
 }
@@ -35,6 +35,20 @@ NodeManager::NodeManager(MegaClient& client)
 {
 }
 
+NodeManager::~NodeManager()
+{
+    {
+        std::lock_guard<std::mutex> g(mChildrenPrefetchMutex);
+        mChildrenPrefetchExit = true;
+    }
+    cancelChildrenPrefetch();
+    mChildrenPrefetchCondition.notify_one();
+    if (mChildrenPrefetchThread.joinable())
+    {
+        mChildrenPrefetchThread.join();
+    }
+}
+
 void NodeManager::setTable(DBTableNodes *table)
 {
     LockGuard g(mMutex);
@@ -45,6 +59,7 @@ void NodeManager::setTable_internal(DBTableNodes *table)
 {
     assert(mMutex.owns_lock());
     mTable = table;
+    mFingerprintFilter.clear();
 }
 
 void NodeManager::reset()
@@ -56,6 +71,7 @@ void NodeManager::reset()
 void NodeManager::reset_internal()
 {
     assert(mMutex.owns_lock());
+    cancelChildrenPrefetch();
     setTable_internal(nullptr);
     cleanNodes_internal();
 }
@@ -204,6 +220,13 @@ bool NodeManager::addNode_internal(std::shared_ptr<Node> node, bool notify, bool
     if (keepNodeInMemory)
     {
         saveNodeInRAM(node, rootNode || isFolderLink, missingParentNodes);   // takes ownership
+
+        if (isFetching && !notify)
+        {
+            // some of its children may be streamed to DB (before or after this node is received),
+            // and they are not tracked by `mNodes`: they must be loaded from DB
+            node->mNodePosition->second.mAllChildrenHandleLoaded = false;
+        }
     }
     else
     {
@@ -211,12 +234,15 @@ bool NodeManager::addNode_internal(std::shared_ptr<Node> node, bool notify, bool
         assert(!mNodeToWriteInDb);
         mNodeToWriteInDb = node;
 
-        // when keepNodeInMemory is true, NodeManager::addChild is called by Node::setParent (from NodeManager::saveNodeInRAM)
-        auto pair = mNodes.emplace(node->nodeHandle(), NodeManagerNode(*this, node->nodeHandle()));
-        // The NodeManagerNode could have been added by NodeManager::addChild() but, in that case, mNode would be invalid
-        auto& nodePosition = pair.first;
-        nodePosition->second.mAllChildrenHandleLoaded = true; // Receive a new node, children aren't received yet or they are stored in nodesWithMissingParents
-        addChild_internal(node->parentHandle(), node->nodeHandle(), nullptr);
+        // the node is streamed to DB: keep only the relationship with its parent (see `mStreamedNodes`)
+        mStreamedNodes.push_back({node->parentHandle(), node->nodeHandle()});
+        mStreamedNodesSorted = false;
+
+        auto parentIt = mNodes.find(node->parentHandle());
+        if (parentIt != mNodes.end())
+        {
+            parentIt->second.mAllChildrenHandleLoaded = false;
+        }
     }
 
     return true;
@@ -245,6 +271,29 @@ bool NodeManager::updateNode_internal(Node *node)
 
 std::shared_ptr<Node> NodeManager::getNodeByHandle(NodeHandle handle)
 {
+    if (handle.isUndef()) return nullptr;
+
+    // fast path: nodes already loaded in RAM are resolved through the lock-striped index
+    if (std::shared_ptr<Node> node = mNodeRamIndex.find(handle))
+    {
+        std::unique_lock<MutexType> g(mMutex, std::try_to_lock);
+        if (!g.owns_lock())
+        {
+            // the main mutex is busy (ie. SDK thread processing actionpackets): don't wait for it
+            // just to update the position at the LRU. It will be updated upon next access.
+            return node;
+        }
+
+        // the node could have been removed between the look-up and the lock
+        if (mNodeRamIndex.find(handle) == node)
+        {
+            insertNodeCacheLRU_internal(node);
+            return node;
+        }
+
+        return getNodeByHandle_internal(handle);
+    }
+
     LockGuard g(mMutex);
     return getNodeByHandle_internal(handle);
 }
@@ -382,19 +431,63 @@ sharedNode_list NodeManager::getChildren_internal(const Node *parent, CancelToke
 
 sharedNode_vector NodeManager::getChildren(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page)
 {
+    std::shared_ptr<DBTableNodes> reader;
+    {
+        LockGuard g(mMutex);
+        reader = acquireReader_internal();
+        if (!reader)
+        {
+            return getChildren_internal(filter, order, cancelFlag, page);
+        }
+
+        if (!childrenMayMatch_internal(filter))
+        {
+            return sharedNode_vector();
+        }
+    }
+
+    // db look-up, without holding the mutex
+    vector<pair<NodeHandle, NodeSerialized>> nodesFromTable;
+    if (!reader->getChildren(filter, order, nodesFromTable, cancelFlag, page))
+    {
+        return sharedNode_vector();
+    }
+    reader.reset();
+
     LockGuard g(mMutex);
-    return getChildren_internal(filter, order, cancelFlag, page);
+    return processNodesFromReader(nodesFromTable, cancelFlag);
 }
 
 sharedNode_vector NodeManager::getChildren_internal(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page)
 {
     assert(mMutex.owns_lock());
 
+    if (!childrenMayMatch_internal(filter))
+    {
+        return sharedNode_vector();
+    }
+
+    // db look-up
+    vector<pair<NodeHandle, NodeSerialized>> nodesFromTable;
+    if (!mTable->getChildren(filter, order, nodesFromTable, cancelFlag, page))
+    {
+        return sharedNode_vector();
+    }
+
+    sharedNode_vector nodes = processUnserializedNodes(nodesFromTable, cancelFlag);
+
+    return nodes;
+}
+
+bool NodeManager::childrenMayMatch_internal(const NodeSearchFilter& filter)
+{
+    assert(mMutex.owns_lock());
+
     // validation
     if (filter.byParentHandle() == UNDEF || !mTable || mNodes.empty())
     {
         assert(filter.byParentHandle() != UNDEF && mTable && !mNodes.empty());
-        return sharedNode_vector();
+        return false;
     }
 
     // small optimization to possibly skip the db look-up
@@ -403,20 +496,140 @@ sharedNode_vector NodeManager::getChildren_internal(const NodeSearchFilter& filt
         shared_ptr<Node> node = getNodeByHandle_internal(NodeHandle().set6byte(filter.byParentHandle()));
         if (!node || node->isSensitiveInherited())
         {
-            return sharedNode_vector();
+            return false;
         }
     }
 
-    // db look-up
-    vector<pair<NodeHandle, NodeSerialized>> nodesFromTable;
-    if (!mTable->getChildren(filter, order, nodesFromTable, cancelFlag, page))
+    return true;
+}
+
+std::vector<NodeView> NodeManager::getChildrenViews(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page)
+{
+    std::shared_ptr<DBTableNodes> reader;
     {
-        return sharedNode_vector();
+        LockGuard g(mMutex);
+        if (!childrenMayMatch_internal(filter))
+        {
+            return std::vector<NodeView>();
+        }
+
+        reader = acquireReader_internal();
+        if (!reader)
+        {
+            std::vector<NodeView> views;
+            if (!mTable->getChildrenViews(filter, order, views, cancelFlag, page))
+            {
+                views.clear();
+            }
+            return views;
+        }
     }
 
-    sharedNode_vector nodes = processUnserializedNodes(nodesFromTable, cancelFlag);
+    // views don't need the mutex at all
+    std::vector<NodeView> views;
+    if (!reader->getChildrenViews(filter, order, views, cancelFlag, page))
+    {
+        views.clear();
+    }
 
-    return nodes;
+    return views;
+}
+
+std::unique_ptr<NodeSnapshot> NodeManager::getSnapshot()
+{
+    LockGuard g(mMutex);
+    if (!mTable || mNodes.empty())
+    {
+        return nullptr;
+    }
+
+    std::shared_ptr<DBTableNodes> table = mTable->acquireSnapshot();
+    if (!table)
+    {
+        return nullptr;
+    }
+
+    return std::unique_ptr<NodeSnapshot>(new NodeSnapshot(std::move(table)));
+}
+
+NodeSnapshot::NodeSnapshot(std::shared_ptr<DBTableNodes> table)
+    : mTable(std::move(table))
+{
+}
+
+std::vector<NodeView> NodeSnapshot::getChildren(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+
+    std::vector<NodeView> views;
+    if (!mTable->getChildrenViews(filter, order, views, cancelFlag, page))
+    {
+        views.clear();
+    }
+    return views;
+}
+
+uint64_t NodeSnapshot::getNumberOfChildren(NodeHandle parent)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    return mTable->getNumberOfChildren(parent);
+}
+
+bool NodeSnapshot::getCounter(NodeHandle node, NodeCounter& counter)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+
+    NodeSerialized nodeSerialized;
+    if (!mTable->getNode(node, nodeSerialized))
+    {
+        return false;
+    }
+
+    counter = NodeCounter(nodeSerialized.mNodeCounter);
+    return true;
+}
+
+bool NodeSnapshot::isAncestor(NodeHandle node, NodeHandle ancestor, CancelToken cancelFlag)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    return mTable->isAncestor(node, ancestor, cancelFlag);
+}
+
+bool NodeSnapshot::forEachDescendant(NodeHandle ancestor, CancelToken cancelFlag, std::function<bool(const NodeView&)> visit)
+{
+    // breadth first, so only the folders of a level are pending at a time
+    std::deque<NodeHandle> folders{ancestor};
+    while (!folders.empty())
+    {
+        NodeSearchFilter filter;
+        filter.byAncestors({folders.front().as8byte(), UNDEF, UNDEF});
+        folders.pop_front();
+
+        std::vector<NodeView> children;
+        {
+            std::lock_guard<std::mutex> g(mMutex);
+            if (cancelFlag.isCancelled() ||
+                !mTable->getChildrenViews(filter, 0 /*MegaApi::ORDER_NONE*/, children, cancelFlag, NodeSearchPage(0, 0)))
+            {
+                return false;
+            }
+        }
+
+        for (const NodeView& child : children)
+        {
+            if (!visit(child))
+            {
+                return false;
+            }
+
+            if (child.mType != FILENODE)
+            {
+                folders.push_back(child.mHandle);
+            }
+        }
+    }
+
+    return true;
 }
 
 sharedNode_vector NodeManager::getChildrenFromType(const NodeHandle& parent, nodetype_t type, CancelToken cancelToken)
@@ -476,6 +689,8 @@ uint64_t NodeManager::getNodeCount_internal()
 {
     assert(mMutex.owns_lock());
 
+    applyPendingCounterChanges_internal();
+
     if (mNodes.empty())
     {
         return 0;
@@ -529,19 +744,63 @@ uint64_t NodeManager::getNodeCount_internal()
 
 sharedNode_vector NodeManager::searchNodes(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page)
 {
+    std::shared_ptr<DBTableNodes> reader;
+    {
+        LockGuard g(mMutex);
+        reader = acquireReader_internal();
+        if (!reader)
+        {
+            return searchNodes_internal(filter, order, cancelFlag, page);
+        }
+
+        if (!searchMayMatch_internal(filter))
+        {
+            return sharedNode_vector();
+        }
+    }
+
+    // db look-up, without holding the mutex
+    vector<pair<NodeHandle, NodeSerialized>> nodesFromTable;
+    if (!reader->searchNodes(filter, order, nodesFromTable, cancelFlag, page))
+    {
+        return sharedNode_vector();
+    }
+    reader.reset();
+
     LockGuard g(mMutex);
-    return searchNodes_internal(filter, order, cancelFlag, page);
+    return processNodesFromReader(nodesFromTable, cancelFlag);
 }
 
 sharedNode_vector NodeManager::searchNodes_internal(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page)
 {
     assert(mMutex.owns_lock());
 
+    if (!searchMayMatch_internal(filter))
+    {
+        return sharedNode_vector();
+    }
+
+    // db look-up
+    vector<pair<NodeHandle, NodeSerialized>> nodesFromTable;
+    if (!mTable->searchNodes(filter, order, nodesFromTable, cancelFlag, page))
+    {
+        return sharedNode_vector();
+    }
+
+    sharedNode_vector nodes = processUnserializedNodes(nodesFromTable, cancelFlag);
+
+    return nodes;
+}
+
+bool NodeManager::searchMayMatch_internal(const NodeSearchFilter& filter)
+{
+    assert(mMutex.owns_lock());
+
     // validation
     if (!mTable || mNodes.empty())
     {
         assert(mTable && !mNodes.empty());
-        return sharedNode_vector();
+        return false;
     }
 
     // small optimization to possibly skip the db look-up
@@ -556,19 +815,22 @@ sharedNode_vector NodeManager::searchNodes_internal(const NodeSearchFilter& filt
                         return node && node->isSensitiveInherited();
                     }))
     {
-        return sharedNode_vector();
+        return false;
     }
 
-    // db look-up
-    vector<pair<NodeHandle, NodeSerialized>> nodesFromTable;
-    if (!mTable->searchNodes(filter, order, nodesFromTable, cancelFlag, page))
+    return true;
+}
+
+std::shared_ptr<DBTableNodes> NodeManager::acquireReader_internal()
+{
+    assert(mMutex.owns_lock());
+
+    if (!mTable || mNodes.empty())
     {
-        return sharedNode_vector();
+        return nullptr;
     }
 
-    sharedNode_vector nodes = processUnserializedNodes(nodesFromTable, cancelFlag);
-
-    return nodes;
+    return mTable->acquireReader();
 }
 
 
@@ -730,10 +992,15 @@ sharedNode_vector NodeManager::getNodesByFingerprint_internal(FileFingerprint &f
         return nodes;
     }
 
-    // Look for nodes at DB
-    std::vector<std::pair<NodeHandle, NodeSerialized>> nodesFromTable;
     std::string fingerprintString;
     fingerprint.FileFingerprint::serialize(&fingerprintString);
+    if (!fingerprintMayBeInDb(fingerprintString))
+    {
+        return nodes;
+    }
+
+    // Look for nodes at DB
+    std::vector<std::pair<NodeHandle, NodeSerialized>> nodesFromTable;
     mTable->getNodesByFingerprint(fingerprintString, nodesFromTable);
     if (nodesFromTable.size())
     {
@@ -817,9 +1084,14 @@ std::shared_ptr<Node> NodeManager::getNodeByFingerprint_internal(FileFingerprint
         return n->mNodePosition->second.getNodeInRam();
     }
 
-    NodeSerialized nodeSerialized;
     std::string fingerprintString;
     fingerprint.FileFingerprint::serialize(&fingerprintString);
+    if (!fingerprintMayBeInDb(fingerprintString))
+    {
+        return nullptr;
+    }
+
+    NodeSerialized nodeSerialized;
     NodeHandle handle;
     mTable->getNodeByFingerprint(fingerprintString, nodeSerialized, handle);
     auto itNode = mNodes.find(handle);
@@ -886,6 +1158,23 @@ std::shared_ptr<Node> NodeManager::childNodeByNameType_internal(const Node* pare
         return nullptr; // There is no match
     }
 
+    if (const ChildrenIndex* index = getChildrenIndex_internal(*parent))
+    {
+        ChildrenIndex::Entry key{nodeType, name, NodeHandle()};
+        auto range = std::equal_range(index->mEntries.begin(), index->mEntries.end(), key);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            // the DB may still have the previous name or parent of the node
+            shared_ptr<Node> node = getNodeByHandle_internal(it->mHandle);
+            if (node && node->parent.get() == parent && name == node->displayname())
+            {
+                return node;
+            }
+        }
+
+        return nullptr;
+    }
+
     std::pair<NodeHandle, NodeSerialized> nodeSerialized;
     if (!mTable->childNodeByNameType(parent->nodeHandle(), name, nodeType, nodeSerialized))
     {
@@ -1109,6 +1398,22 @@ void NodeManager::updateTreeCounter(std::shared_ptr<Node> origin, NodeCounter nc
 {
     assert(mMutex.owns_lock());
 
+    // changes reported upon purge are never deferred
+    if (mTreeUpdateBatches && origin && !nodesToReport)
+    {
+        PendingCounterChange& pending = mPendingCounterChanges[origin->nodeHandle()];
+        pending.mNode = origin;
+        if (operation == INCREASE)
+        {
+            pending.mIncrease += nc;
+        }
+        else
+        {
+            pending.mDecrease += nc;
+        }
+        return;
+    }
+
     while (origin)
     {
         NodeCounter ancestorCounter = origin->getCounter();
@@ -1128,33 +1433,109 @@ void NodeManager::updateTreeCounter(std::shared_ptr<Node> origin, NodeCounter nc
     }
 }
 
-NodeCounter NodeManager::calculateNodeCounter(const NodeHandle& nodehandle, nodetype_t parentType, std::shared_ptr<Node> node, bool isInRubbish)
+NodeManager::TreeUpdateBatch::TreeUpdateBatch(NodeManager& nodeManager)
+  : mNodeManager(nodeManager)
+{
+    LockGuard g(mNodeManager.mMutex);
+    ++mNodeManager.mTreeUpdateBatches;
+}
+
+NodeManager::TreeUpdateBatch::~TreeUpdateBatch()
+{
+    LockGuard g(mNodeManager.mMutex);
+    assert(mNodeManager.mTreeUpdateBatches);
+    if (!--mNodeManager.mTreeUpdateBatches)
+    {
+        mNodeManager.applyPendingCounterChanges_internal();
+    }
+}
+
+void NodeManager::applyPendingCounterChanges_internal()
 {
     assert(mMutex.owns_lock());
 
-    NodeCounter nc;
-    if (!mTable)
+    if (mPendingCounterChanges.empty())
     {
-        assert(false);
-        return nc;
+        return;
     }
 
-    m_off_t nodeSize = 0u;
-    uint64_t flags = 0;
-    nodetype_t nodeType = TYPE_UNKNOWN;
-    if (node)
+    // bucket the nodes by depth, so every node gets the changes of its descendants before
+    // passing its own ones to its parent
+    std::vector<std::vector<NodeHandle>> byDepth;
+    auto depthOf = [](const Node* n)
     {
-        nodeType = node->type;
-        nodeSize = node->size;
-        flags = node->getDBFlags();
+        size_t depth = 0;
+        for (n = n->parent.get(); n; n = n->parent.get()) ++depth;
+        return depth;
+    };
+
+    for (auto& it : mPendingCounterChanges)
+    {
+        size_t depth = depthOf(it.second.mNode.get());
+        if (byDepth.size() <= depth) byDepth.resize(depth + 1);
+        byDepth[depth].push_back(it.first);
     }
-    else
+
+    size_t updated = mPendingCounterChanges.size();
+    for (size_t depth = byDepth.size(); depth--; )
     {
-        if (!mTable->getNodeSizeTypeAndFlags(nodehandle, nodeSize, nodeType, flags))
+        for (NodeHandle h : byDepth[depth])
         {
-            assert(false);
-            return nc;
-        }
+            PendingCounterChange change = std::move(mPendingCounterChanges[h]);
+            mPendingCounterChanges.erase(h);
+
+            NodeCounter counter = change.mNode->getCounter();
+            counter += change.mIncrease;
+            counter -= change.mDecrease;
+            setNodeCounter(change.mNode, counter, true, nullptr);
+
+            if (std::shared_ptr<Node> parent = change.mNode->parent)
+            {
+                auto inserted = mPendingCounterChanges.emplace(parent->nodeHandle(), PendingCounterChange());
+                PendingCounterChange& parentChange = inserted.first->second;
+                if (inserted.second)
+                {
+                    parentChange.mNode = parent;
+                    byDepth[depth - 1].push_back(parent->nodeHandle());
+                    ++updated;
+                }
+                parentChange.mIncrease += change.mIncrease;
+                parentChange.mDecrease += change.mDecrease;
+            }
+        }
+    }
+
+    assert(mPendingCounterChanges.empty());
+    LOG_verbose << "Deferred node counters applied to " << updated << " nodes";
+}
+
+NodeCounter NodeManager::calculateNodeCounter(const NodeHandle& nodehandle, nodetype_t parentType, std::shared_ptr<Node> node, bool isInRubbish)
+{
+    assert(mMutex.owns_lock());
+
+    NodeCounter nc;
+    if (!mTable)
+    {
+        assert(false);
+        return nc;
+    }
+
+    m_off_t nodeSize = 0u;
+    uint64_t flags = 0;
+    nodetype_t nodeType = TYPE_UNKNOWN;
+    if (node)
+    {
+        nodeType = node->type;
+        nodeSize = node->size;
+        flags = node->getDBFlags();
+    }
+    else
+    {
+        if (!mTable->getNodeSizeTypeAndFlags(nodehandle, nodeSize, nodeType, flags))
+        {
+            assert(false);
+            return nc;
+        }
         std::bitset<Node::FLAGS_SIZE> bitset(flags);
         flags = Node::getDBFlags(flags, isInRubbish, parentType == FILENODE, bitset.test(Node::FLAGS_IS_MARKED_SENSTIVE));
     }
@@ -1175,6 +1556,36 @@ NodeCounter NodeManager::calculateNodeCounter(const NodeHandle& nodehandle, node
         }
     }
 
+    // children streamed to DB during fetchnodes (without an entry at `mNodes`)
+    if (!mStreamedNodes.empty())
+    {
+        if (!mStreamedNodesSorted)
+        {
+            std::sort(mStreamedNodes.begin(), mStreamedNodes.end(), [](const StreamedNode& a, const StreamedNode& b)
+            {
+                return a.mParent.as8byte() < b.mParent.as8byte();
+            });
+            mStreamedNodesSorted = true;
+        }
+
+        auto range = std::equal_range(mStreamedNodes.begin(), mStreamedNodes.end(), StreamedNode{nodehandle, NodeHandle()},
+                                      [](const StreamedNode& a, const StreamedNode& b)
+        {
+            return a.mParent.as8byte() < b.mParent.as8byte();
+        });
+
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            // it could have been loaded in RAM afterwards, so it's already accounted above
+            if (children && children->count(it->mNode))
+            {
+                continue;
+            }
+
+            nc += calculateNodeCounter(it->mNode, nodeType, getNodeInRAM(it->mNode), isInRubbish);
+        }
+    }
+
     if (nodeType == FILENODE)
     {
         bool isVersion = parentType == FILENODE;
@@ -1269,7 +1680,20 @@ size_t NodeManager::getNumberOfChildrenByType_internal(NodeHandle parentHandle,
 
     assert(nodeType == FILENODE || nodeType == FOLDERNODE);
 
-    return mTable->getNumberOfChildrenByType(parentHandle, nodeType);
+    auto it = mChildrenTypeCounts.find(parentHandle);
+    if (it == mChildrenTypeCounts.end())
+    {
+        if (mChildrenTypeCounts.size() >= MAX_CHILDREN_TYPE_COUNTS)
+        {
+            mChildrenTypeCounts.clear();
+        }
+
+        std::array<size_t, 2> counts = { mTable->getNumberOfChildrenByType(parentHandle, FILENODE),
+                                         mTable->getNumberOfChildrenByType(parentHandle, FOLDERNODE) };
+        it = mChildrenTypeCounts.emplace(parentHandle, counts).first;
+    }
+
+    return it->second[nodeType == FILENODE ? 0 : 1];
 }
 
 bool NodeManager::isAncestor(NodeHandle nodehandle, NodeHandle ancestor, CancelToken cancelFlag)
@@ -1322,11 +1746,19 @@ void NodeManager::cleanNodes_internal()
     assert(mMutex.owns_lock());
 
     mFingerPrints.clear();
-    mNodes.clear();
+    mFingerprintFilter.clear();
+    mNodeRamIndex.clear();
     mCacheLRU.clear();
+    mNodes.clear();
     mNodesInRam = 0;
     mNodeToWriteInDb.reset();
     mNodeNotify.clear();
+    mPendingCounterChanges.clear();
+    trimChildrenIndexes_internal(0);
+    mChildrenTypeCounts.clear();
+    mParentsInDbOfMovedNodes.clear();
+    std::vector<StreamedNode>().swap(mStreamedNodes);
+    mStreamedNodesSorted = false;
 
     rootnodes.clear();
 
@@ -1364,6 +1796,7 @@ shared_ptr<Node> NodeManager::unserializeNode(const std::string *d, bool fromOld
         auto& nodePosition = pair.first;
         nodePosition->second.setNode(n);
         n->mNodePosition = nodePosition;
+        mNodeRamIndex.insert(n);
 
         insertNodeCacheLRU_internal(n);
 
@@ -1395,14 +1828,53 @@ void NodeManager::applyKeys_internal(uint32_t appliedKeys)
 
     if (mNodes.size() > appliedKeys)
     {
+        // locate the keys here, decrypt keys and attributes in parallel and apply the results in order
+        std::vector<Node::KeyDecryption> jobs;
         for (auto& it : mNodes)
         {
             if (shared_ptr<Node> node = it.second.getNodeInRam(false))
             {
-               node->applykey();
+                jobs.emplace_back();
+                jobs.back().mNode = node;
+                if (!node->prepareKeyDecryption(jobs.back()))
+                {
+                    jobs.pop_back();
+                }
             }
         }
+
+        decryptKeys(jobs);
+
+        for (auto& job : jobs)
+        {
+            job.mNode->applyKeyDecryption(job);
+        }
+    }
+}
+
+void NodeManager::decryptKeys(std::vector<Node::KeyDecryption>& jobs)
+{
+    assert(mMutex.owns_lock());
+
+    if (jobs.size() < KEY_DECRYPTION_BATCH_SIZE)
+    {
+        SymmCipher cipher;
+        for (auto& job : jobs)
+        {
+            Node::decryptKeyAndAttrs(job, cipher);
+        }
+        return;
     }
+
+    // the jobs don't access the NodeManager nor the client. This thread waits for all of them, but it
+    // runs batches too: it can't depend on the workers, which may be waiting for mMutex
+    mClient.mAsyncQueue.runBatches(jobs.size(), KEY_DECRYPTION_BATCH_SIZE, [&jobs](size_t begin, size_t end, SymmCipher& cipher)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            Node::decryptKeyAndAttrs(jobs[i], cipher);
+        }
+    });
 }
 
 void NodeManager::notifyPurge()
@@ -1411,6 +1883,8 @@ void NodeManager::notifyPurge()
     sharedNode_vector nodesToReport;
     {
         LockGuard g(mMutex);
+        // ancestors with new counters have to be reported and written too
+        applyPendingCounterChanges_internal();
         nodesToReport.swap(mNodeNotify);
     }
 
@@ -1448,6 +1922,9 @@ void NodeManager::notifyPurge()
                 LOG_warn << "NO_KEY node: " << n->type << " " << n->size << " " << toNodeHandle(n->nodehandle) << " " << n->nodekeyUnchecked().size();
             }
 
+            // ancestors of added, moved or removed nodes are notified just with new counters
+            bool onlyCounterChanged = n->changed.counter && onlyChangedCounter(*n);
+
             if (n->changed.removed)
             {
                 // remove inbound share
@@ -1475,8 +1952,13 @@ void NodeManager::notifyPurge()
                 NodeHandle h = n->nodeHandle();
 
                 // This will also require notifying/updating parents back to the root.  Report and
-                // update them in this same operation, to ensure consistency in case of commit
-                updateTreeCounter(n->parent, n->getCounter(), DECREASE, &nodesToReport);
+                // update them in this same operation, to ensure consistency in case of commit.
+                // When the parent is being removed too (a subtree), its own counter still includes
+                // this node, and its removal updates the ancestors for the whole subtree at once.
+                if (!(n->parent && n->parent->changed.removed))
+                {
+                    updateTreeCounter(n->parent, n->getCounter(), DECREASE, &nodesToReport);
+                }
 
                 if (n->parent)
                 {
@@ -1494,18 +1976,25 @@ void NodeManager::notifyPurge()
                 removeFingerprint(n.get());
 
                 // effectively delete node from RAM
-                if (n->mNodePosition->second.mLRUPosition != invalidCacheLRUPos())
+                if (mCacheLRU.contains(n->mNodePosition->second))
                 {
-                    mCacheLRU.erase(n->mNodePosition->second.mLRUPosition);
+                    mCacheLRU.remove(n->mNodePosition->second);
                 }
 
+                mNodeRamIndex.erase(h);
                 mNodes.erase(n->mNodePosition);
                 n->mNodePosition = mNodes.end();
 
                 mTable->remove(h);
+                invalidateParentsInDb_internal(h, NodeHandle());
 
                 removed += 1;
             }
+            else if (onlyCounterChanged)
+            {
+                // the serialized node is the same, only its 'counter' column needs to be written
+                mTable->updateCounter(n->nodeHandle(), n->getCounter().serialize());
+            }
             else
             {
                 putNodeInDb(n.get());
@@ -1585,6 +2074,7 @@ void NodeManager::saveNodeInRAM(std::shared_ptr<Node> node, bool isRootnode, Mis
     nodePosition->second.setNode(node);
     nodePosition->second.mAllChildrenHandleLoaded = true; // Receive a new node, children aren't received yet or they are stored a mNodesWithMissingParents
     node->mNodePosition = nodePosition;
+    mNodeRamIndex.insert(node);
 
     insertNodeCacheLRU_internal(node);
 
@@ -1638,6 +2128,65 @@ int NodeManager::getNumVersions(NodeHandle nodeHandle)
     return static_cast<int>(node->getCounter().versions) + 1;
 }
 
+sharedNode_vector NodeManager::getVersions(NodeHandle fileHandle)
+{
+    LockGuard g(mMutex);
+
+    shared_ptr<Node> current = getNodeByHandle_internal(fileHandle);
+    if (!current || current->type != FILENODE)
+    {
+        return sharedNode_vector();
+    }
+
+    sharedNode_vector versions;
+    versions.push_back(current);
+
+    size_t numPrevious = static_cast<size_t>(current->getCounter().versions);
+    if (!numPrevious)
+    {
+        return versions;
+    }
+
+    // the whole chain in one query, as long as the DB has caught up with the nodes in RAM
+    std::vector<std::pair<NodeHandle, NodeSerialized>> nodesFromTable;
+    if (mTable && mTable->getVersions(fileHandle, nodesFromTable) && nodesFromTable.size() == numPrevious)
+    {
+        sharedNode_vector previous = processUnserializedNodes(nodesFromTable, CancelToken());
+        bool chained = previous.size() == numPrevious;
+        for (size_t i = 0; chained && i < previous.size(); i++)
+        {
+            chained = previous[i]->type == FILENODE && previous[i]->parentHandle() == versions.back()->nodeHandle();
+            if (chained)
+            {
+                versions.push_back(std::move(previous[i]));
+            }
+        }
+
+        if (chained)
+        {
+            return versions;
+        }
+
+        versions.resize(1);
+    }
+
+    // one level at a time
+    for (;;)
+    {
+        sharedNode_list children = getChildren_internal(versions.back().get());
+        if (children.empty())
+        {
+            break;
+        }
+
+        assert(children.size() == 1);  // versions are 1-child chains
+        assert(children.back()->type == FILENODE);
+        versions.push_back(children.back());
+    }
+
+    return versions;
+}
+
 NodeHandle NodeManager::getRootNodeFiles() const
 {
     LockGuard g(mMutex);
@@ -1728,7 +2277,7 @@ std::shared_ptr<Node> NodeManager::getNodeFromNodeManagerNode(NodeManagerNode& n
     return node;
 }
 
-void NodeManager::insertNodeCacheLRU(std::shared_ptr<Node> node)
+void NodeManager::insertNodeCacheLRU(const std::shared_ptr<Node>& node)
 {
     LockGuard g(mMutex);
     insertNodeCacheLRU_internal(node);
@@ -1755,6 +2304,7 @@ void NodeManager::setCacheLRUMaxSize(uint64_t cacheLRUMaxSize)
     mCacheLRUMaxSize = cacheLRUMaxSize;
 
     unLoadNodeFromCacheLRU(); // check if it's necessary unload nodes
+    trimChildrenIndexes_internal(childrenIndexBudget());
 }
 
 uint64_t NodeManager::getNumNodesAtCacheLRU() const
@@ -1763,165 +2313,540 @@ uint64_t NodeManager::getNumNodesAtCacheLRU() const
     return mCacheLRU.size();
 }
 
-void NodeManager::initCompleted_internal()
+NodeManager::CacheLRUPolicy NodeManager::getCacheLRUPolicy() const
 {
-    assert(mMutex.owns_lock());
-
-    if (!mTable)
-    {
-        assert(false);
-        return;
-    }
-
-    sharedNode_vector rootNodes = getRootNodesAndInshares();
-    for (auto& node : rootNodes)
-    {
-        calculateNodeCounter(node->nodeHandle(), TYPE_UNKNOWN, node, node->type == RUBBISHNODE);
-    }
-
-    mTable->createIndexes();
-    mInitialized = true;
+    LockGuard g(mMutex);
+    return mCacheLRUPolicy;
 }
 
-bool NodeManager::ready()
+void NodeManager::setCacheLRUPolicy(CacheLRUPolicy policy)
 {
-    return mInitialized;
+    LockGuard g(mMutex);
+    mCacheLRUPolicy = policy;
 }
 
-void NodeManager::insertNodeCacheLRU_internal(std::shared_ptr<Node> node)
+uint64_t NodeManager::getCacheLRUHits() const
 {
-    assert(mMutex.owns_lock() && "Mutex should be locked by this thread");
-    if (node->mNodePosition->second.mLRUPosition != mCacheLRU.end())
-    {
-        mCacheLRU.erase(node->mNodePosition->second.mLRUPosition);
-    }
-
-    node->mNodePosition->second.mLRUPosition = mCacheLRU.insert(mCacheLRU.begin(), node);
-    unLoadNodeFromCacheLRU(); // check if it's necessary unload nodes
+    return mCacheLRUHits;
+}
 
-    // setfingerprint again to force to insert into NodeManager::mFingerPrints
-    // only nodes in LRU are at NodeManager::mFingerPrints
-    if (node->mFingerPrintPosition == invalidFingerprintPos())
-    {
-        node->setfingerprint();
-    }
+uint64_t NodeManager::getCacheLRUMisses() const
+{
+    return mCacheLRUMisses;
 }
 
-void NodeManager::unLoadNodeFromCacheLRU()
+void NodeManager::setChildrenPrefetch(unsigned folders)
 {
-    assert(mMutex.owns_lock() && "Mutex should be locked by this thread");
-    while (mCacheLRU.size() > mCacheLRUMaxSize)
+    mChildrenPrefetchFolders = folders;
+    if (!folders)
     {
-        std::shared_ptr<Node> node = mCacheLRU.back();
-        removeFingerprint(node.get(), true);
-        node->mNodePosition->second.mLRUPosition = invalidCacheLRUPos();
-        mCacheLRU.pop_back();
+        cancelChildrenPrefetch();
     }
 }
 
-NodeCounter NodeManager::getCounterOfRootNodes()
+unsigned NodeManager::getChildrenPrefetch() const
 {
-    LockGuard g(mMutex);
-    return getCounterOfRootNodes_internal();
+    return mChildrenPrefetchFolders;
 }
 
-NodeCounter NodeManager::getCounterOfRootNodes_internal()
+void NodeManager::prefetchChildren(const sharedNode_vector& listed)
 {
-    assert(mMutex.owns_lock());
-
-    NodeCounter c;
+    unsigned maxFolders = mChildrenPrefetchFolders;
+    if (!maxFolders)
+    {
+        return;
+    }
 
-    // if not logged in yet, node counters are not available
-    if (mNodes.empty())
+    struct Candidate
     {
-        assert((rootnodes.files.isUndef()
-                && rootnodes.vault.isUndef()
-                && rootnodes.rubbish.isUndef())
-               || (mClient.loggedIntoFolder()));
+        NodeHandle mHandle;
+        m_time_t mCtime;
+        m_off_t mStorage;
+        size_t mRank = 0;
+    };
 
-        return c;
+    std::vector<Candidate> candidates;
+    for (const auto& node : listed)
+    {
+        if (node && node->type == FOLDERNODE)
+        {
+            candidates.push_back({node->nodeHandle(), node->ctime, node->getCounter().storage});
+        }
     }
 
-    sharedNode_vector rootNodes = getRootNodes_internal();
-    for (auto& node : rootNodes)
+    if (candidates.empty())
     {
-        c += node->getCounter();
+        return;
     }
 
-    return c;
-}
+    // the positions by creation time and by size are added up: the lowest ranks go first
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.mCtime > b.mCtime; });
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        candidates[i].mRank = i;
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.mStorage > b.mStorage; });
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        candidates[i].mRank += i;
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.mRank < b.mRank; });
 
-void NodeManager::updateCounter(std::shared_ptr<Node> n, std::shared_ptr<Node> oldParent)
-{
-    LockGuard g(mMutex);
-    updateCounter_internal(n, oldParent);
-}
+    std::vector<NodeHandle> folders;
+    for (size_t i = 0; i < candidates.size() && i < maxFolders; ++i)
+    {
+        folders.push_back(candidates[i].mHandle);
+    }
 
-void NodeManager::updateCounter_internal(std::shared_ptr<Node> n, std::shared_ptr<Node> oldParent)
-{
-    assert(mMutex.owns_lock());
+    {
+        std::lock_guard<std::mutex> g(mChildrenPrefetchMutex);
+        if (mChildrenPrefetchExit)
+        {
+            return;
+        }
 
-    NodeCounter nc = n->getCounter();
-    updateTreeCounter(oldParent, nc, DECREASE, nullptr);
+        mChildrenPrefetchCancel.cancel();
+        mChildrenPrefetchCancel = CancelToken(false);
+        mChildrenPrefetchPending = std::move(folders);
 
-    // if node is a new version
-    if (n->parent && n->parent->type == FILENODE)
-    {
-        if (nc.files > 0)
+        if (!mChildrenPrefetchThread.joinable())
         {
-            assert(nc.files == 1);
-            // discount the old version, previously counted as file
-            nc.files--;
-            nc.storage -= n->size;
-            nc.versions++;
-            nc.versionStorage += n->size;
-            setNodeCounter(n, nc, true, nullptr);
+            try
+            {
+                mChildrenPrefetchThread = std::thread([this]()
+                {
+                    TRACE_THREAD_NAME("prefetch");
+                    childrenPrefetchLoop();
+                });
+            }
+            catch (std::system_error& e)
+            {
+                LOG_err << "Failed to start the thread of the prefetch of children: " << e.what();
+                mChildrenPrefetchPending.clear();
+                return;
+            }
         }
     }
-    // newest element at chain versions has been removed, the second one element is the newest now. Update node counter properly
-    else if (oldParent && oldParent->type == FILENODE && n->parent && n->parent->type != FILENODE)
-    {
-        nc.files++;
-        nc.storage += n->size;
-        nc.versions--;
-        nc.versionStorage -= n->size;
-        setNodeCounter(n, nc, true, nullptr);
-    }
-
-    updateTreeCounter(n->parent, nc, INCREASE, nullptr);
+    mChildrenPrefetchCondition.notify_one();
 }
 
-FingerprintPosition NodeManager::insertFingerprint(Node *node)
+void NodeManager::childrenPrefetchLoop()
 {
-    LockGuard g(mMutex);
-    return insertFingerprint_internal(node);
-}
+    for (;;)
+    {
+        std::vector<NodeHandle> folders;
+        CancelToken cancelToken;
+        {
+            std::unique_lock<std::mutex> g(mChildrenPrefetchMutex);
+            mChildrenPrefetchCondition.wait(g, [this]() { return mChildrenPrefetchExit || !mChildrenPrefetchPending.empty(); });
+            if (mChildrenPrefetchExit)
+            {
+                return;
+            }
 
-FingerprintPosition NodeManager::insertFingerprint_internal(Node *node)
-{
-    assert(mMutex.owns_lock());
+            folders.swap(mChildrenPrefetchPending);
+            cancelToken = mChildrenPrefetchCancel;
+        }
 
-    // if node is not to be kept in memory, don't save the pointer in the set
-    // since it will be invalid once node is written to DB
-    if (node->type == FILENODE && mNodeToWriteInDb.get() != node)
-    {
-        return mFingerPrints.insert(node);
+        runChildrenPrefetch(folders, cancelToken);
     }
-
-    return mFingerPrints.end();
 }
 
-void NodeManager::removeFingerprint(Node *node, bool unloadNode)
+uint64_t NodeManager::childrenPrefetchBudget() const
 {
-    LockGuard g(mMutex);
-    removeFingerprint_internal(node, unloadNode);
+    return std::min(MAX_CHILDREN_PREFETCH_NODES, mCacheLRUMaxSize / 4);
 }
 
-void NodeManager::removeFingerprint_internal(Node *node, bool unloadNode)
+void NodeManager::runChildrenPrefetch(const std::vector<NodeHandle>& folders, CancelToken cancelToken)
 {
-    assert(mMutex.owns_lock());
-
-    if (node->type == FILENODE && node->mFingerPrintPosition != mFingerPrints.end())  // remove from mFingerPrints
+    uint64_t budget = childrenPrefetchBudget();
+    for (NodeHandle folder : folders)
+    {
+        if (cancelToken.isCancelled())
+        {
+            return;
+        }
+
+        std::shared_ptr<DBTableNodes> reader;
+        {
+            LockGuard g(mMutex);
+            if (mChildrenIndexes.find(folder) != mChildrenIndexes.end())
+            {
+                continue;   // opened recently, its children are likely in RAM already
+            }
+
+            reader = acquireReader_internal();
+            if (!reader)
+            {
+                return;
+            }
+        }
+
+        // db look-ups, without holding the mutex
+        uint64_t children = reader->getNumberOfChildren(folder);
+        if (!children || children > budget)
+        {
+            continue;
+        }
+        budget -= children;
+
+        NodeSearchFilter filter;
+        filter.byAncestors({folder.as8byte(), UNDEF, UNDEF});
+        vector<pair<NodeHandle, NodeSerialized>> nodesFromTable;
+        if (!reader->getChildren(filter, 0 /*MegaApi::ORDER_NONE*/, nodesFromTable, cancelToken, NodeSearchPage(0, 0)))
+        {
+            continue;
+        }
+        reader.reset();
+
+        LockGuard g(mMutex);
+        if (cancelToken.isCancelled() || !mTable)
+        {
+            return;
+        }
+
+        // the nodes loaded from DB are inserted at the cache LRU
+        processNodesFromReader(nodesFromTable, cancelToken);
+        if (shared_ptr<Node> node = getNodeByHandle_internal(folder))
+        {
+            getChildrenIndex_internal(*node);
+        }
+    }
+}
+
+void NodeManager::cancelChildrenPrefetch()
+{
+    std::lock_guard<std::mutex> g(mChildrenPrefetchMutex);
+    mChildrenPrefetchCancel.cancel();
+    mChildrenPrefetchPending.clear();
+}
+
+std::vector<std::pair<std::string, std::chrono::microseconds>> NodeManager::benchmarkDbQueries(unsigned repetitions)
+{
+    LockGuard g(mMutex);
+
+    std::vector<std::pair<std::string, std::chrono::microseconds>> results;
+    if (!mTable || !repetitions)
+    {
+        return results;
+    }
+
+    constexpr int defaultAsc = 1; // MegaApi::ORDER_DEFAULT_ASC
+    constexpr int sizeDesc = 4;   // MegaApi::ORDER_SIZE_DESC
+    constexpr size_t pageSize = 100;
+
+    NodeSearchFilter childrenFilter;
+    childrenFilter.byAncestors({rootnodes.files.as8byte(), UNDEF, UNDEF});
+
+    NodeSearchFilter searchFilter;
+    searchFilter.byAncestors({rootnodes.files.as8byte(), rootnodes.vault.as8byte(), rootnodes.rubbish.as8byte()});
+    searchFilter.byName("a");
+
+    // the encoded fingerprint of a file that can't exist, so the lookup is always a miss
+    const std::string missingFingerprint(24, '\0');
+
+    const std::vector<std::pair<std::string, std::function<void()>>> workloads = {
+        {"countNodes", [this]() { mTable->getNumberOfNodes(); }},
+        {"listChildren", [&]()
+        {
+            std::vector<NodeView> views;
+            mTable->getChildrenViews(childrenFilter, defaultAsc, views, CancelToken(), NodeSearchPage(0, pageSize));
+        }},
+        {"listChildrenBySize", [&]()
+        {
+            std::vector<NodeView> views;
+            mTable->getChildrenViews(childrenFilter, sizeDesc, views, CancelToken(), NodeSearchPage(0, pageSize));
+        }},
+        {"searchByName", [&]()
+        {
+            std::vector<std::pair<NodeHandle, NodeSerialized>> nodes;
+            mTable->searchNodes(searchFilter, defaultAsc, nodes, CancelToken(), NodeSearchPage(0, pageSize));
+        }},
+        {"recentNodes", [&]()
+        {
+            std::vector<std::pair<NodeHandle, NodeSerialized>> nodes;
+            mTable->getRecentNodes(pageSize, 0, nodes);
+        }},
+        {"fingerprintLookup", [&]()
+        {
+            std::vector<std::pair<NodeHandle, NodeSerialized>> nodes;
+            mTable->getNodesByFingerprint(missingFingerprint, nodes);
+        }},
+    };
+
+    for (auto& workload : workloads)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < repetitions; ++i)
+        {
+            workload.second();
+        }
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        results.emplace_back(workload.first, elapsed / repetitions);
+        LOG_debug << "DB benchmark: " << workload.first << " " << results.back().second.count() << " us";
+    }
+
+    return results;
+}
+
+void NodeManager::initCompleted_internal()
+{
+    assert(mMutex.owns_lock());
+
+    if (!mTable)
+    {
+        assert(false);
+        return;
+    }
+
+    sharedNode_vector rootNodes = getRootNodesAndInshares();
+    for (auto& node : rootNodes)
+    {
+        calculateNodeCounter(node->nodeHandle(), TYPE_UNKNOWN, node, node->type == RUBBISHNODE);
+    }
+
+    // counters are calculated, the relationships of streamed nodes are not needed anymore
+    std::vector<StreamedNode>().swap(mStreamedNodes);
+    mStreamedNodesSorted = false;
+
+    mTable->createIndexes();
+    mInitialized = true;
+}
+
+bool NodeManager::ready()
+{
+    return mInitialized;
+}
+
+void NodeManager::removeExpiredNodeFromRamIndex(NodeHandle h)
+{
+    // no locking of the main mutex for this one, the stripe is locked by the index
+    mNodeRamIndex.eraseIfExpired(h);
+}
+
+void NodeManager::insertNodeCacheLRU_internal(const std::shared_ptr<Node>& node)
+{
+    assert(mMutex.owns_lock() && "Mutex should be locked by this thread");
+
+    NodeManagerNode& entry = node->mNodePosition->second;
+    if (mCacheLRU.contains(entry))
+    {
+        ++mCacheLRUHits;
+
+        if (mCacheLRUPolicy == CacheLRUPolicy::CLOCK)
+        {
+            // the position is only updated when it reaches the back of the cache
+            entry.mLRUReferenced = true;
+        }
+        else
+        {
+            mCacheLRU.moveToFront(entry);
+        }
+
+        return;
+    }
+
+    ++mCacheLRUMisses;
+    mCacheLRU.pushFront(entry, node);
+    unLoadNodeFromCacheLRU(); // check if it's necessary unload nodes
+
+    // setfingerprint again to force to insert into NodeManager::mFingerPrints
+    // only nodes in LRU are at NodeManager::mFingerPrints
+    if (node->mFingerPrintPosition == invalidFingerprintPos())
+    {
+        node->setfingerprint();
+    }
+}
+
+void NodeManager::unLoadNodeFromCacheLRU()
+{
+    assert(mMutex.owns_lock() && "Mutex should be locked by this thread");
+    while (mCacheLRU.size() > mCacheLRUMaxSize)
+    {
+        NodeManagerNode& entry = *mCacheLRU.back();
+        if (entry.mLRUReferenced)
+        {
+            // CLOCK: second chance for nodes accessed since they were (re)inserted
+            entry.mLRUReferenced = false;
+            mCacheLRU.moveToFront(entry);
+            continue;
+        }
+
+        // keep the node alive until the fingerprint is removed
+        std::shared_ptr<Node> node = mCacheLRU.remove(entry);
+        removeFingerprint(node.get(), true);
+    }
+}
+
+void NodeManager::CacheLRU::pushFront(NodeManagerNode& entry, const std::shared_ptr<Node>& node)
+{
+    assert(!entry.isAtCacheLRU() && node);
+    entry.mLRUNode = node;
+    entry.mLRUReferenced = false;
+    link(entry);
+    ++mSize;
+}
+
+void NodeManager::CacheLRU::moveToFront(NodeManagerNode& entry)
+{
+    assert(entry.isAtCacheLRU());
+    if (mHead == &entry)
+    {
+        return;
+    }
+
+    unlink(entry);
+    link(entry);
+}
+
+std::shared_ptr<Node> NodeManager::CacheLRU::remove(NodeManagerNode& entry)
+{
+    assert(entry.isAtCacheLRU());
+    unlink(entry);
+    --mSize;
+    entry.mLRUReferenced = false;
+    return std::move(entry.mLRUNode);
+}
+
+void NodeManager::CacheLRU::clear()
+{
+    while (mHead)
+    {
+        remove(*mHead);
+    }
+
+    assert(!mSize && !mTail);
+}
+
+void NodeManager::CacheLRU::link(NodeManagerNode& entry)
+{
+    entry.mLRUPrev = nullptr;
+    entry.mLRUNext = mHead;
+    if (mHead)
+    {
+        mHead->mLRUPrev = &entry;
+    }
+    else
+    {
+        mTail = &entry;
+    }
+    mHead = &entry;
+}
+
+void NodeManager::CacheLRU::unlink(NodeManagerNode& entry)
+{
+    (entry.mLRUPrev ? entry.mLRUPrev->mLRUNext : mHead) = entry.mLRUNext;
+    (entry.mLRUNext ? entry.mLRUNext->mLRUPrev : mTail) = entry.mLRUPrev;
+    entry.mLRUPrev = nullptr;
+    entry.mLRUNext = nullptr;
+}
+
+NodeCounter NodeManager::getCounterOfRootNodes()
+{
+    LockGuard g(mMutex);
+    return getCounterOfRootNodes_internal();
+}
+
+NodeCounter NodeManager::getCounterOfRootNodes_internal()
+{
+    assert(mMutex.owns_lock());
+
+    applyPendingCounterChanges_internal();
+
+    NodeCounter c;
+
+    // if not logged in yet, node counters are not available
+    if (mNodes.empty())
+    {
+        assert((rootnodes.files.isUndef()
+                && rootnodes.vault.isUndef()
+                && rootnodes.rubbish.isUndef())
+               || (mClient.loggedIntoFolder()));
+
+        return c;
+    }
+
+    sharedNode_vector rootNodes = getRootNodes_internal();
+    for (auto& node : rootNodes)
+    {
+        c += node->getCounter();
+    }
+
+    return c;
+}
+
+void NodeManager::updateCounter(std::shared_ptr<Node> n, std::shared_ptr<Node> oldParent)
+{
+    LockGuard g(mMutex);
+    updateCounter_internal(n, oldParent);
+}
+
+void NodeManager::updateCounter_internal(std::shared_ptr<Node> n, std::shared_ptr<Node> oldParent)
+{
+    assert(mMutex.owns_lock());
+
+    NodeCounter nc = n->getCounter();
+    updateTreeCounter(oldParent, nc, DECREASE, nullptr);
+
+    // if node is a new version
+    if (n->parent && n->parent->type == FILENODE)
+    {
+        if (nc.files > 0)
+        {
+            assert(nc.files == 1);
+            // discount the old version, previously counted as file
+            nc.files--;
+            nc.storage -= n->size;
+            nc.versions++;
+            nc.versionStorage += n->size;
+            setNodeCounter(n, nc, true, nullptr);
+        }
+    }
+    // newest element at chain versions has been removed, the second one element is the newest now. Update node counter properly
+    else if (oldParent && oldParent->type == FILENODE && n->parent && n->parent->type != FILENODE)
+    {
+        nc.files++;
+        nc.storage += n->size;
+        nc.versions--;
+        nc.versionStorage -= n->size;
+        setNodeCounter(n, nc, true, nullptr);
+    }
+
+    updateTreeCounter(n->parent, nc, INCREASE, nullptr);
+}
+
+FingerprintPosition NodeManager::insertFingerprint(Node *node)
+{
+    LockGuard g(mMutex);
+    return insertFingerprint_internal(node);
+}
+
+FingerprintPosition NodeManager::insertFingerprint_internal(Node *node)
+{
+    assert(mMutex.owns_lock());
+
+    // if node is not to be kept in memory, don't save the pointer in the set
+    // since it will be invalid once node is written to DB
+    if (node->type == FILENODE && mNodeToWriteInDb.get() != node)
+    {
+        return mFingerPrints.insert(node);
+    }
+
+    return mFingerPrints.end();
+}
+
+void NodeManager::removeFingerprint(Node *node, bool unloadNode)
+{
+    LockGuard g(mMutex);
+    removeFingerprint_internal(node, unloadNode);
+}
+
+void NodeManager::removeFingerprint_internal(Node *node, bool unloadNode)
+{
+    assert(mMutex.owns_lock());
+
+    if (node->type == FILENODE && node->mFingerPrintPosition != mFingerPrints.end())  // remove from mFingerPrints
     {
         mFingerPrints.erase(node->mFingerPrintPosition);
         node->mFingerPrintPosition = mFingerPrints.end();
@@ -1940,12 +2865,6 @@ FingerprintPosition NodeManager::invalidFingerprintPos()
     return mFingerPrints.end();
 }
 
-std::list<std::shared_ptr<Node> >::const_iterator NodeManager::invalidCacheLRUPos() const
-{
-    // no locking for this one, it returns a constant
-    return mCacheLRU.end();
-}
-
 void NodeManager::dumpNodes()
 {
     LockGuard g(mMutex);
@@ -1962,14 +2881,25 @@ void NodeManager::dumpNodes_internal()
         return;
     }
 
+    // nodes are written in batches, reusing the same statement and buffers
+    static constexpr size_t DUMP_BATCH_SIZE = 1024;
+    sharedNode_vector batch;
+    batch.reserve(DUMP_BATCH_SIZE);
+
     for (auto &it : mNodes)
     {
         shared_ptr<Node> node = getNodeFromNodeManagerNode(it.second);
         if (node)
         {
-            putNodeInDb(node.get());
+            batch.push_back(std::move(node));
+            if (batch.size() == DUMP_BATCH_SIZE)
+            {
+                putNodesInDb(batch);
+                batch.clear();
+            }
         }
     }
+    putNodesInDb(batch);
 
     mTable->createIndexes();
     mInitialized = true;
@@ -2017,6 +2947,8 @@ void NodeManager::addChild_internal(NodeHandle parent, NodeHandle child, Node* n
 {
     assert(mMutex.owns_lock());
 
+    invalidateChildrenIndex_internal(parent);
+
     auto pair = mNodes.emplace(parent, NodeManagerNode(*this, parent));
     // The NodeManagerNode could have been added in add node, only update the child
     if (!pair.first->second.mChildren)
@@ -2034,6 +2966,107 @@ void NodeManager::addChild_internal(NodeHandle parent, NodeHandle child, Node* n
     (*pair.first->second.mChildren)[child] = nodeManagerNode;
 }
 
+size_t NodeManager::childrenIndexBudget() const
+{
+    // an entry takes a small fraction of the memory of a node
+    uint64_t lruBudget = mCacheLRUMaxSize > std::numeric_limits<uint64_t>::max() / CHILDREN_INDEX_ENTRIES_PER_NODE
+                         ? std::numeric_limits<uint64_t>::max()
+                         : mCacheLRUMaxSize * CHILDREN_INDEX_ENTRIES_PER_NODE;
+    return static_cast<size_t>(std::min<uint64_t>(MAX_CHILDREN_INDEX_ENTRIES, lruBudget));
+}
+
+const NodeManager::ChildrenIndex* NodeManager::getChildrenIndex_internal(const Node& parent)
+{
+    assert(mMutex.owns_lock());
+
+    auto it = mChildrenIndexes.find(parent.nodeHandle());
+    if (it != mChildrenIndexes.end())
+    {
+        mChildrenIndexLRU.splice(mChildrenIndexLRU.begin(), mChildrenIndexLRU, it->second.mLRUPosition);
+        return &it->second;
+    }
+
+    size_t budget = childrenIndexBudget();
+    if (!budget || mTable->getNumberOfChildren(parent.nodeHandle()) > budget)
+    {
+        return nullptr;
+    }
+
+    NodeSearchFilter filter;
+    filter.byAncestors({parent.nodeHandle().as8byte(), UNDEF, UNDEF});
+    std::vector<NodeView> children;
+    if (!mTable->getChildrenViews(filter, 0 /*MegaApi::ORDER_NONE*/, children, CancelToken(), NodeSearchPage(0, 0)))
+    {
+        return nullptr;
+    }
+
+    ChildrenIndex index;
+    index.mEntries.reserve(children.size());
+    for (NodeView& child : children)
+    {
+        index.mEntries.push_back({child.mType, std::move(child.mName), child.mHandle});
+    }
+    std::sort(index.mEntries.begin(), index.mEntries.end());
+
+    trimChildrenIndexes_internal(budget - index.mEntries.size());
+
+    mChildrenIndexEntries += index.mEntries.size();
+    mChildrenIndexLRU.push_front(parent.nodeHandle());
+    index.mLRUPosition = mChildrenIndexLRU.begin();
+    return &mChildrenIndexes.emplace(parent.nodeHandle(), std::move(index)).first->second;
+}
+
+void NodeManager::invalidateChildrenIndex_internal(NodeHandle parent)
+{
+    assert(mMutex.owns_lock());
+
+    if (!mChildrenTypeCounts.empty())
+    {
+        mChildrenTypeCounts.erase(parent);
+    }
+
+    if (mChildrenIndexes.empty())
+    {
+        return;
+    }
+
+    auto it = mChildrenIndexes.find(parent);
+    if (it != mChildrenIndexes.end())
+    {
+        mChildrenIndexEntries -= it->second.mEntries.size();
+        mChildrenIndexLRU.erase(it->second.mLRUPosition);
+        mChildrenIndexes.erase(it);
+    }
+}
+
+void NodeManager::invalidateParentsInDb_internal(NodeHandle node, NodeHandle parent)
+{
+    assert(mMutex.owns_lock());
+
+    if (!parent.isUndef())
+    {
+        invalidateChildrenIndex_internal(parent);
+    }
+
+    auto it = mParentsInDbOfMovedNodes.find(node);
+    if (it != mParentsInDbOfMovedNodes.end())
+    {
+        invalidateChildrenIndex_internal(it->second);
+        mParentsInDbOfMovedNodes.erase(it);
+    }
+}
+
+void NodeManager::trimChildrenIndexes_internal(size_t budget)
+{
+    assert(mMutex.owns_lock());
+
+    while (mChildrenIndexEntries > budget)
+    {
+        assert(!mChildrenIndexLRU.empty());
+        invalidateChildrenIndex_internal(mChildrenIndexLRU.back());
+    }
+}
+
 void NodeManager::removeChild(Node* parent, NodeHandle child)
 {
     LockGuard g(mMutex);
@@ -2044,6 +3077,9 @@ void NodeManager::removeChild_internal(Node* parent, NodeHandle child)
 {
     assert(mMutex.owns_lock());
 
+    invalidateChildrenIndex_internal(parent->nodeHandle());
+    mParentsInDbOfMovedNodes.emplace(child, parent->nodeHandle());
+
     assert(parent->mNodePosition->second.mChildren);
     if (parent->mNodePosition->second.mChildren)
     {
@@ -2114,6 +3150,67 @@ sharedNode_vector NodeManager::processUnserializedNodes(const vector<pair<NodeHa
     return nodes;
 }
 
+sharedNode_vector NodeManager::processNodesFromReader(const vector<pair<NodeHandle, NodeSerialized>>& nodesFromTable, CancelToken cancelFlag)
+{
+    assert(mMutex.owns_lock());
+
+    // the table may have been closed (ie. logout) while the reader was in use
+    if (!mTable)
+    {
+        return sharedNode_vector();
+    }
+
+    sharedNode_vector nodes;
+    for (const auto& nodeIt : nodesFromTable)
+    {
+        if (cancelFlag.isCancelled()) break;
+
+        shared_ptr<Node> n = getNodeInRAM(nodeIt.first);
+        if (!n)
+        {
+            // The reader doesn't see the ongoing transaction: the current version comes from
+            // the writer, and nodes removed since the last commit are skipped
+            NodeSerialized nodeSerialized;
+            if (!mTable->getNode(nodeIt.first, nodeSerialized))
+            {
+                continue;
+            }
+
+            n = getNodeFromNodeSerialized(nodeSerialized);
+            if (!n)
+            {
+                nodes.clear();
+                return nodes;
+            }
+        }
+
+        nodes.push_back(std::move(n));
+    }
+
+    return nodes;
+}
+
+bool NodeManager::isAncestorOfSerializedNode(NodeHandle handle, const NodeSerialized& nodeSerialized, NodeHandle ancestorHandle, CancelToken cancelFlag)
+{
+    assert(mMutex.owns_lock());
+
+    // the parent handle is at a fixed offset of the blob: if the parent is the ancestor
+    // or it's loaded in RAM, there's no need to walk the tree in DB
+    NodeData nd(nodeSerialized.mNode.data(), nodeSerialized.mNode.size(), NodeData::COMPONENT_NONE);
+    NodeHandle parentHandle = NodeHandle().set6byte(nd.getParentHandle());
+    if (parentHandle == ancestorHandle)
+    {
+        return true;
+    }
+
+    if (shared_ptr<Node> parent = getNodeInRAM(parentHandle))
+    {
+        return parent->isAncestor(ancestorHandle);
+    }
+
+    return mTable->isAncestor(handle, ancestorHandle, cancelFlag);
+}
+
 sharedNode_vector NodeManager::processUnserializedNodes(const std::vector<std::pair<NodeHandle, NodeSerialized> >& nodesFromTable, NodeHandle ancestorHandle, CancelToken cancelFlag)
 {
     assert(mMutex.owns_lock());
@@ -2130,7 +3227,7 @@ sharedNode_vector NodeManager::processUnserializedNodes(const std::vector<std::p
         if (!ancestorHandle.isUndef())  // filter results by subtree (nodeHandle)
         {
             bool skip = n ? !n->isAncestor(ancestorHandle)
-                          : !mTable->isAncestor(nodeIt.first, ancestorHandle, cancelFlag);
+                          : !isAncestorOfSerializedNode(nodeIt.first, nodeIt.second, ancestorHandle, cancelFlag);
 
             if (skip) continue;
         }
@@ -2151,13 +3248,173 @@ sharedNode_vector NodeManager::processUnserializedNodes(const std::vector<std::p
     return nodes;
 }
 
-void NodeManager::putNodeInDb(Node* node) const
+void NodeManager::putNodeInDb(Node* node)
 {
     if (!node)
     {
         return;
     }
 
+    prepareNodeForDb(node);
+    mTable->put(node);
+    invalidateParentsInDb_internal(node->nodeHandle(), node->parentHandle());
+
+    if (mFingerprintFilter.isBuilt())
+    {
+        std::string fingerprint;
+        node->FileFingerprint::serialize(&fingerprint);
+        mFingerprintFilter.add(fingerprint);
+    }
+}
+
+void NodeManager::putNodesInDb(const sharedNode_vector& nodes)
+{
+    if (nodes.empty())
+    {
+        return;
+    }
+
+    std::vector<Node*> rawNodes;
+    rawNodes.reserve(nodes.size());
+    for (const auto& node : nodes)
+    {
+        prepareNodeForDb(node.get());
+        rawNodes.push_back(node.get());
+    }
+
+    mTable->putNodes(rawNodes);
+    for (const auto& node : nodes)
+    {
+        invalidateParentsInDb_internal(node->nodeHandle(), node->parentHandle());
+    }
+
+    if (mFingerprintFilter.isBuilt())
+    {
+        std::string fingerprint;
+        for (const auto& node : nodes)
+        {
+            fingerprint.clear();
+            node->FileFingerprint::serialize(&fingerprint);
+            mFingerprintFilter.add(fingerprint);
+        }
+    }
+}
+
+bool NodeManager::fingerprintMayBeInDb(const std::string& fingerprint)
+{
+    assert(mMutex.owns_lock());
+
+    if (!mFingerprintFilter.isBuilt())
+    {
+        uint64_t numNodes = mTable->getNumberOfNodes();
+        mFingerprintFilter.build(static_cast<size_t>(numNodes + numNodes / 2));
+        if (!mTable->getFingerprints([this](const std::string& fp) { mFingerprintFilter.add(fp); }))
+        {
+            // query the DB, and retry to build it next time
+            mFingerprintFilter.clear();
+            return true;
+        }
+
+        if (!mFingerprintFilter.isBuilt())
+        {
+            return true; // more fingerprints than expected, it will be rebuilt bigger
+        }
+    }
+
+    return mFingerprintFilter.mayContain(fingerprint);
+}
+
+void NodeManager::FingerprintFilter::build(size_t expectedEntries)
+{
+    mCapacity = std::max<size_t>(expectedEntries, 1024);
+    mBits.assign((mCapacity * BITS_PER_ENTRY + 63) / 64, 0);
+    mEntries = 0;
+}
+
+void NodeManager::FingerprintFilter::add(const std::string& fingerprint)
+{
+    if (!isBuilt())
+    {
+        return;
+    }
+
+    if (++mEntries > mCapacity)
+    {
+        LOG_debug << "Fingerprint filter is full (" << mCapacity << " entries), it will be rebuilt";
+        clear();
+        return;
+    }
+
+    auto h = hash(fingerprint);
+    uint64_t numBits = mBits.size() * 64;
+    for (unsigned i = 0; i < NUM_PROBES; ++i)
+    {
+        uint64_t bit = (h.first + i * h.second) % numBits;
+        mBits[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+}
+
+bool NodeManager::FingerprintFilter::mayContain(const std::string& fingerprint) const
+{
+    if (!isBuilt())
+    {
+        return true;
+    }
+
+    auto h = hash(fingerprint);
+    uint64_t numBits = mBits.size() * 64;
+    for (unsigned i = 0; i < NUM_PROBES; ++i)
+    {
+        uint64_t bit = (h.first + i * h.second) % numBits;
+        if (!(mBits[bit / 64] & (uint64_t(1) << (bit % 64))))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void NodeManager::FingerprintFilter::clear()
+{
+    std::vector<uint64_t>().swap(mBits);
+    mCapacity = 0;
+    mEntries = 0;
+}
+
+std::pair<uint64_t, uint64_t> NodeManager::FingerprintFilter::hash(const std::string& fingerprint)
+{
+    // FNV-1a, then a splitmix64 finalizer for the second hash
+    uint64_t h1 = 0xcbf29ce484222325ull;
+    for (unsigned char c : fingerprint)
+    {
+        h1 = (h1 ^ c) * 0x100000001b3ull;
+    }
+
+    uint64_t h2 = h1 + 0x9e3779b97f4a7c15ull;
+    h2 = (h2 ^ (h2 >> 30)) * 0xbf58476d1ce4e5b9ull;
+    h2 = (h2 ^ (h2 >> 27)) * 0x94d049bb133111ebull;
+    h2 ^= h2 >> 31;
+
+    return std::make_pair(h1, h2 | 1);
+}
+
+bool NodeManager::onlyChangedCounter(const Node& node)
+{
+    // 'changed' is reset with memset(), so it can be compared the same way
+    decltype(node.changed) otherChanges;
+    memcpy(&otherChanges, &node.changed, sizeof(otherChanges));
+    otherChanges.counter = false;
+    otherChanges.modifiedByThisClient = false;
+
+    decltype(node.changed) noChanges;
+    memset(&noChanges, 0, sizeof(noChanges));
+
+    return !memcmp(&otherChanges, &noChanges, sizeof(noChanges));
+}
+
+void NodeManager::prepareNodeForDb(Node* node) const
+{
     if (node->attrstring)
     {
         // Last attempt to decrypt the node before storing it.
@@ -2170,8 +3427,6 @@ void NodeManager::putNodeInDb(Node* node) const
             LOG_debug << "Storing an encrypted node.";
         }
     }
-
-    mTable->put(node);
 }
 
 size_t NodeManager::nodeNotifySize() const
@@ -2210,4 +3465,62 @@ void NodeManager::Rootnodes::clear()
     vault.setUndef();
 }
 
+std::shared_ptr<Node> NodeManager::NodeRamIndex::find(NodeHandle h) const
+{
+    const Stripe& s = stripe(h);
+    std::shared_lock<std::shared_mutex> g(s.mMutex);
+
+    auto it = s.mNodes.find(h);
+    return it != s.mNodes.end() ? it->second.lock() : nullptr;
+}
+
+void NodeManager::NodeRamIndex::insert(const std::shared_ptr<Node>& node)
+{
+    Stripe& s = stripe(node->nodeHandle());
+    std::unique_lock<std::shared_mutex> g(s.mMutex);
+
+    s.mNodes[node->nodeHandle()] = node;
+}
+
+void NodeManager::NodeRamIndex::erase(NodeHandle h)
+{
+    Stripe& s = stripe(h);
+    std::unique_lock<std::shared_mutex> g(s.mMutex);
+
+    s.mNodes.erase(h);
+}
+
+void NodeManager::NodeRamIndex::eraseIfExpired(NodeHandle h)
+{
+    Stripe& s = stripe(h);
+    std::unique_lock<std::shared_mutex> g(s.mMutex);
+
+    // a new instance of the node could have been loaded already, keep it
+    auto it = s.mNodes.find(h);
+    if (it != s.mNodes.end() && it->second.expired())
+    {
+        s.mNodes.erase(it);
+    }
+}
+
+void NodeManager::NodeRamIndex::clear()
+{
+    for (auto& s : mStripes)
+    {
+        std::unique_lock<std::shared_mutex> g(s.mMutex);
+        s.mNodes.clear();
+    }
+}
+
+NodeManager::NodeRamIndex::Stripe& NodeManager::NodeRamIndex::stripe(NodeHandle h)
+{
+    // handles are random, so the lowest bits are evenly distributed
+    return mStripes[h.as8byte() % NUM_STRIPES];
+}
+
+const NodeManager::NodeRamIndex::Stripe& NodeManager::NodeRamIndex::stripe(NodeHandle h) const
+{
+    return mStripes[h.as8byte() % NUM_STRIPES];
+}
+
 } // namespace
@@ -322,30 +322,77 @@ bool MacFileSystemAccess::initFilesystemNotificationSystem()
 
 DirNotify* MacFileSystemAccess::newdirnotify(LocalNode& root,
                                              const LocalPath& rootPath,
-                                             Waiter* waiter)
+                                             Waiter* waiter,
+                                             const DirNotify::ResumePoint& resumeFrom)
 {
     // Make sure we've been passed a sane waiter.
     assert(waiter);
 
-    return new MacDirNotify(*this, root, rootPath, *waiter);
+    return new MacDirNotify(*this, root, rootPath, *waiter, resumeFrom);
+}
+
+// Identifies the FSEvents journal of the volume containing path.
+static std::string journalID(const LocalPath& path)
+{
+    struct stat buffer;
+
+    if (stat(path.localpath.c_str(), &buffer))
+        return std::string();
+
+    // Null if the volume has no journal (ie. it's read-only).
+    auto uuid = FSEventsCopyUUIDForDevice(buffer.st_dev);
+
+    if (!uuid)
+        return std::string();
+
+    auto text = CFUUIDCreateString(nullptr, uuid);
+
+    CFRelease(uuid);
+
+    char id[64];
+
+    auto result = CFStringGetCString(text, id, sizeof(id), kCFStringEncodingUTF8);
+
+    CFRelease(text);
+
+    return result ? std::string(id) : std::string();
 }
 
 MacDirNotify::MacDirNotify(MacFileSystemAccess& owner,
                            LocalNode& root,
                            const LocalPath& rootPath,
-                           Waiter& waiter)
+                           Waiter& waiter,
+                           const ResumePoint& resumeFrom)
   : DirNotify(rootPath)
   , mEventStream(nullptr)
   , mOwner(owner)
   , mRoot(root)
   , mRootPathLength()
   , mWaiter(waiter)
+  , mJournalID(journalID(rootPath))
+  , mLastEventID(FSEventsGetCurrentEventId())
 {
     // Assume we'll be unable to create the event stream.
     setFailed(1, "Unable to create filesystem event stream.");
 
+    // Where should the stream begin?
+    FSEventStreamEventId since = kFSEventStreamEventIdSinceNow;
+
+    // Replay the changes made since we last ran, if the journal is the same.
+    if (resumeFrom.mEventID && !mJournalID.empty() && resumeFrom.mJournalID == mJournalID)
+    {
+        LOG_debug << "Resuming filesystem events for "
+                  << rootPath
+                  << " from event "
+                  << resumeFrom.mEventID;
+
+        since = resumeFrom.mEventID;
+        mLastEventID = since;
+        mReplaysChanges = true;
+    }
+
     // Create the event stream.
-    mEventStream = ([&rootPath, this]{
+    mEventStream = ([&rootPath, since, this]{
         // What path are we monitoring?
         auto path = CFStringCreateWithCString(
                       nullptr,
@@ -379,7 +426,7 @@ MacDirNotify::MacDirNotify(MacFileSystemAccess& owner,
                                           &MacDirNotify::trampoline,
                                           &context,
                                           paths,
-                                          kFSEventStreamEventIdSinceNow,
+                                          since,
                                           latency,
                                           flags);
 
@@ -440,16 +487,46 @@ MacDirNotify::~MacDirNotify()
     --mOwner.mNumNotifiers;
 }
 
+bool MacDirNotify::replaysChanges() const
+{
+    return mReplaysChanges;
+}
+
+auto MacDirNotify::resumePoint() const -> ResumePoint
+{
+    ResumePoint point;
+
+    // Event IDs can't be trusted without a journal.
+    if (mJournalID.empty())
+        return point;
+
+    point.mJournalID = mJournalID;
+    point.mEventID = mLastEventID.load();
+
+    return point;
+}
+
 void MacDirNotify::callback(const FSEventStreamEventFlags* flags,
                             std::size_t numEvents,
-                            const char** paths)
+                            const char** paths,
+                            const FSEventStreamEventId* ids)
 {
+    auto lastEventID = mLastEventID.load();
+
     while (numEvents--)
     {
         auto flag = *flags++;
 
         auto path = *paths++;
 
+        auto id = *ids++;
+
+        // IDs start over once they've wrapped.
+        if ((flag & kFSEventStreamEventFlagEventIdsWrapped))
+            lastEventID = id;
+        else
+            lastEventID = std::max(lastEventID, id);
+
         LOG_debug << "FSNotification: " << flag << " " << path;
 
         path += mRootPathLength;
@@ -499,6 +576,10 @@ void MacDirNotify::callback(const FSEventStreamEventFlags* flags,
         if (flag & kFSEventStreamEventFlagItemIsLastHardlink) LOG_debug << "FSEv is last hard link";
         //if (flag & kFSEventStreamEventFlagItemCloned) LOG_debug << "FSEv item cloned";
 
+        // Marks the end of the replayed events: it isn't a change.
+        if ((flag & kFSEventStreamEventFlagHistoryDone))
+            continue;
+
         // Pass the notification to the engine.
         notify(fsEventq,
                &mRoot,
@@ -531,6 +612,9 @@ void MacDirNotify::callback(const FSEventStreamEventFlags* flags,
                LocalPath::fromPlatformEncodedRelative(path));
     }
 
+    // Only published once the events are queued: see Sync::saveNotifierResumePoint().
+    mLastEventID = lastEventID;
+
     // Let the engine know it has events to process.
     mWaiter.notify();
 }
@@ -540,13 +624,13 @@ void MacDirNotify::trampoline(ConstFSEventStreamRef,
                               std::size_t numPaths,
                               void* paths,
                               const FSEventStreamEventFlags* flags,
-                              const FSEventStreamEventId*)
+                              const FSEventStreamEventId* ids)
 {
     // What instance is associated with these events?
     auto instance = reinterpret_cast<MacDirNotify*>(context);
 
     // Let the instance process the events.
-    instance->callback(flags, numPaths, static_cast<const char**>(paths));
+    instance->callback(flags, numPaths, static_cast<const char**>(paths), ids);
 }
 
 #endif // ENABLE_SYNC
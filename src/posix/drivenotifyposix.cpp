@@ -32,6 +32,9 @@
 
 namespace mega {
 
+// time to wait for the mount point of a partition after it's added
+static constexpr std::chrono::milliseconds MOUNT_TIMEOUT(2000);
+
 //
 // DriveNotifyPosix
 /////////////////////////////////////////////
@@ -87,6 +90,7 @@ void DriveNotifyPosix::notifierTeardown()
     }
 
     mMounted.clear();
+    mPendingMounts.clear();
 }
 
 
@@ -103,19 +107,21 @@ void DriveNotifyPosix::doInThread()
 
         timeval tv;
         tv.tv_sec = 0;
-        tv.tv_usec = 250 * 1000; // 250ms
+        tv.tv_usec = (mPendingMounts.empty() ? 250 : 100) * 1000; // 100ms while waiting for mount points
 
         int ret = select(fd+1, &fds, nullptr, nullptr, &tv);
-        if (ret <= 0 || !FD_ISSET(fd, &fds))  continue;
-
-        // get any [dis]connected device
-        udev_device* dev = udev_monitor_receive_device(mUdevMon);
-        if (dev)
+        if (ret > 0 && FD_ISSET(fd, &fds))
         {
-            evaluateDevice(dev);
+            // get all the [dis]connected devices (the monitor doesn't block)
+            while (udev_device* dev = udev_monitor_receive_device(mUdevMon))
+            {
+                evaluateDevice(dev);
 
-            udev_device_unref(dev);
+                udev_device_unref(dev);
+            }
         }
+
+        checkPendingMounts();
     }
 
     // do some cleanup
@@ -153,23 +159,21 @@ void DriveNotifyPosix::evaluateDevice(udev_device* dev)  // dev must Not be null
         // the relevant locations by the time getMountPoint() will attempt to read it
         drvInfo.mountPoint = mMounted[devNodeStr];
         mMounted.erase(devNodeStr); // remove from cache
+        mPendingMounts.erase(devNodeStr);
     }
     else // added
     {
-        // reading it might happen before the relevant locations have been updated,
-        // so allow retrying a few times, say at 100ms intervals
-        for (int i = 0; i < 5; ++i)
-        {
-            drvInfo.mountPoint = getMountPoint(devNodeStr);
+        drvInfo.mountPoint = getMountPoint(devNodeStr);
 
-            if (!drvInfo.mountPoint.empty())
-            {
-                mMounted[devNodeStr] = drvInfo.mountPoint; // cache it
-                break;
-            }
-
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (drvInfo.mountPoint.empty())
+        {
+            // reading it might happen before the relevant locations have been updated:
+            // it's retried along with the other partitions waiting, without blocking the events
+            mPendingMounts[devNodeStr] = std::chrono::steady_clock::now() + MOUNT_TIMEOUT;
+            return;
         }
+
+        mMounted[devNodeStr] = drvInfo.mountPoint; // cache it
     }
 
     // send notification
@@ -181,6 +185,34 @@ void DriveNotifyPosix::evaluateDevice(udev_device* dev)  // dev must Not be null
 
 
 
+void DriveNotifyPosix::checkPendingMounts()
+{
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = mPendingMounts.begin(); it != mPendingMounts.end(); )
+    {
+        DriveInfo drvInfo;
+        drvInfo.connected = true;
+        drvInfo.mountPoint = getMountPoint(it->first);
+
+        if (!drvInfo.mountPoint.empty())
+        {
+            mMounted[it->first] = drvInfo.mountPoint; // cache it
+            add(std::move(drvInfo));
+            it = mPendingMounts.erase(it);
+        }
+        else if (now >= it->second)
+        {
+            it = mPendingMounts.erase(it); // not mounted (or not by now)
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+
+
 std::string DriveNotifyPosix::getMountPoint(const std::string& device)
 {
     std::string mountPoint;
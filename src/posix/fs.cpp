@@ -41,16 +41,30 @@
 extern JavaVM *MEGAjvm;
 #endif
 
+#ifdef USE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
 #if defined(__MACH__) && !(TARGET_OS_IPHONE)
 #include <uuid/uuid.h>
 #endif
 
+#ifdef __APPLE__
+#include <sys/clonefile.h>
+#endif
+
 #ifdef __linux__
 
 #ifndef __ANDROID__
 #include <linux/magic.h>
 #endif /* ! __ANDROID__ */
 
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+
 #include <sys/sysmacros.h>
 #include <sys/vfs.h>
 
@@ -212,6 +226,302 @@ int platformCompareUtf(const LocalPath& p1, bool unescape1, const LocalPath& p2,
 }
 
 #ifdef HAVE_AIO_RT
+#ifdef USE_IO_URING
+namespace {
+
+// Minimal io_uring wrapper (raw syscalls, no liburing dependency) shared by all the
+// PosixFileAccess objects of the process. Submissions from any thread go to the same
+// submission queue, and a single thread reaps the completions and notifies the contexts.
+class IoUring
+{
+public:
+    // nullptr if io_uring can't be used (old kernel, blocked by seccomp...): use POSIX AIO then
+    static IoUring* instance()
+    {
+        static std::unique_ptr<IoUring> ring = create();
+        return ring.get();
+    }
+
+    ~IoUring()
+    {
+        if (mFd < 0)
+        {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> g(mMutex);
+            mStopping = true;
+            io_uring_sqe* sqe = nextSqe();
+            if (sqe)
+            {
+                sqe->opcode = IORING_OP_NOP;
+                sqe->user_data = 0;
+                submitPending();
+            }
+        }
+
+        if (mThread.joinable())
+        {
+            mThread.join();
+        }
+
+        munmap(mSqes, mSqesSize);
+        munmap(mSqRing, mSqRingSize);
+        if (mCqRing != mSqRing)
+        {
+            munmap(mCqRing, mCqRingSize);
+        }
+        close(mFd);
+    }
+
+    // false if the operation couldn't be queued (ie. too many operations in progress)
+    bool submit(PosixAsyncIOContext* context, int fd)
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        if (mStopping || mInFlight >= mEntries)
+        {
+            return false;
+        }
+
+        io_uring_sqe* sqe = nextSqe();
+        if (!sqe)
+        {
+            return false;
+        }
+
+        context->iov.iov_base = context->dataBuffer;
+        context->iov.iov_len = context->dataBufferLen;
+        context->inIoUring = true;
+
+        sqe->opcode = context->op == AsyncIOContext::READ ? IORING_OP_READV : IORING_OP_WRITEV;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uintptr_t>(&context->iov);
+        sqe->len = 1;
+        sqe->off = static_cast<uint64_t>(context->posOfBuffer);
+        sqe->user_data = reinterpret_cast<uintptr_t>(context);
+        ++mInFlight;
+
+        // everything queued and not consumed yet by the kernel is submitted in the same call
+        submitPending();
+        return true;
+    }
+
+private:
+    static constexpr unsigned ENTRIES = 256;
+
+    int mFd = -1;
+    unsigned mEntries = 0;
+    unsigned mInFlight = 0;
+    bool mStopping = false;
+    std::mutex mMutex;
+    std::thread mThread;
+
+    void* mSqRing = nullptr;
+    void* mCqRing = nullptr;
+    size_t mSqRingSize = 0;
+    size_t mCqRingSize = 0;
+    io_uring_sqe* mSqes = nullptr;
+    size_t mSqesSize = 0;
+
+    unsigned* mSqHead = nullptr;
+    unsigned* mSqTail = nullptr;
+    unsigned* mSqMask = nullptr;
+    unsigned* mSqArray = nullptr;
+    unsigned* mCqHead = nullptr;
+    unsigned* mCqTail = nullptr;
+    unsigned* mCqMask = nullptr;
+    io_uring_cqe* mCqes = nullptr;
+
+    static std::unique_ptr<IoUring> create()
+    {
+        std::unique_ptr<IoUring> ring(new IoUring());
+        if (!ring->init())
+        {
+            LOG_info << "io_uring not available, using POSIX AIO. Error: " << errno;
+            return nullptr;
+        }
+
+        LOG_debug << "Using io_uring for async file operations";
+        return ring;
+    }
+
+    static int enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+
+    static unsigned* at(void* ring, unsigned offset)
+    {
+        return reinterpret_cast<unsigned*>(static_cast<char*>(ring) + offset);
+    }
+
+    bool init()
+    {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        mFd = static_cast<int>(syscall(__NR_io_uring_setup, ENTRIES, &params));
+        if (mFd < 0)
+        {
+            return false;
+        }
+
+        mEntries = params.sq_entries;
+        mSqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        mCqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+        {
+            mSqRingSize = mCqRingSize = std::max(mSqRingSize, mCqRingSize);
+        }
+
+        mSqRing = mmap(nullptr, mSqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFd, IORING_OFF_SQ_RING);
+        if (mSqRing == MAP_FAILED)
+        {
+            close(mFd);
+            mFd = -1;
+            return false;
+        }
+
+        mCqRing = mSqRing;
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP))
+        {
+            mCqRing = mmap(nullptr, mCqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFd, IORING_OFF_CQ_RING);
+            if (mCqRing == MAP_FAILED)
+            {
+                munmap(mSqRing, mSqRingSize);
+                close(mFd);
+                mFd = -1;
+                return false;
+            }
+        }
+
+        mSqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        mSqes = static_cast<io_uring_sqe*>(mmap(nullptr, mSqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFd, IORING_OFF_SQES));
+        if (mSqes == MAP_FAILED)
+        {
+            if (mCqRing != mSqRing)
+            {
+                munmap(mCqRing, mCqRingSize);
+            }
+            munmap(mSqRing, mSqRingSize);
+            close(mFd);
+            mFd = -1;
+            return false;
+        }
+
+        mSqHead = at(mSqRing, params.sq_off.head);
+        mSqTail = at(mSqRing, params.sq_off.tail);
+        mSqMask = at(mSqRing, params.sq_off.ring_mask);
+        mSqArray = at(mSqRing, params.sq_off.array);
+        mCqHead = at(mCqRing, params.cq_off.head);
+        mCqTail = at(mCqRing, params.cq_off.tail);
+        mCqMask = at(mCqRing, params.cq_off.ring_mask);
+        mCqes = reinterpret_cast<io_uring_cqe*>(static_cast<char*>(mCqRing) + params.cq_off.cqes);
+
+        mThread = std::thread([this]() { reapCompletions(); });
+        return true;
+    }
+
+    // with mMutex locked
+    io_uring_sqe* nextSqe()
+    {
+        unsigned tail = *mSqTail;
+        if (tail - __atomic_load_n(mSqHead, __ATOMIC_ACQUIRE) >= mEntries)
+        {
+            return nullptr;
+        }
+
+        unsigned index = tail & *mSqMask;
+        io_uring_sqe* sqe = &mSqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        mSqArray[index] = index;
+        __atomic_store_n(mSqTail, tail + 1, __ATOMIC_RELEASE);
+        return sqe;
+    }
+
+    // with mMutex locked
+    void submitPending()
+    {
+        unsigned pending = *mSqTail - __atomic_load_n(mSqHead, __ATOMIC_ACQUIRE);
+        while (pending && enter(mFd, pending, 0, 0) < 0 && errno == EINTR);
+        // on other errors (EAGAIN, EBUSY) the entries stay queued and go with the next submission
+    }
+
+    void reapCompletions()
+    {
+        for (;;)
+        {
+            if (enter(mFd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+            {
+                LOG_err << "io_uring_enter failed: " << errno;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+
+            unsigned head = *mCqHead;
+            unsigned tail = __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE);
+            unsigned completed = 0;
+            bool stop = false;
+            for (; head != tail; ++head)
+            {
+                const io_uring_cqe& cqe = mCqes[head & *mCqMask];
+                if (!cqe.user_data)
+                {
+                    stop = true;    // NOP queued by the destructor
+                    continue;
+                }
+
+                ++completed;
+                operationFinished(reinterpret_cast<PosixAsyncIOContext*>(static_cast<uintptr_t>(cqe.user_data)), cqe.res);
+            }
+            __atomic_store_n(mCqHead, head, __ATOMIC_RELEASE);
+
+            std::lock_guard<std::mutex> g(mMutex);
+            mInFlight -= completed;
+
+            // retry submissions that the kernel couldn't accept before
+            submitPending();
+
+            if (stop)
+            {
+                return;
+            }
+        }
+    }
+
+    static void operationFinished(PosixAsyncIOContext* context, int result)
+    {
+        context->retry = (result == -EAGAIN);
+        context->failed = (result < 0);
+        if (!context->failed)
+        {
+            if (context->op == AsyncIOContext::READ && context->pad)
+            {
+                memset(context->dataBuffer + context->dataBufferLen, 0, context->pad);
+                LOG_verbose << "Async read finished OK";
+            }
+            else
+            {
+                LOG_verbose << "Async write finished OK";
+            }
+        }
+        else
+        {
+            LOG_warn << "Async operation finished with error: " << -result;
+        }
+
+        asyncfscallback userCallback = context->userCallback;
+        void *userData = context->userData;
+        context->finished = true;
+        if (userCallback)
+        {
+            userCallback(userData);
+        }
+    }
+};
+
+} // namespace
+#endif // USE_IO_URING
+
 PosixAsyncIOContext::PosixAsyncIOContext() : AsyncIOContext()
 {
     aiocb = NULL;
@@ -225,6 +535,18 @@ PosixAsyncIOContext::~PosixAsyncIOContext()
 
 void PosixAsyncIOContext::finish()
 {
+#ifdef USE_IO_URING
+    if (inIoUring)
+    {
+        if (!finished)
+        {
+            LOG_debug << "Synchronously waiting for async operation";
+            AsyncIOContext::finish();
+        }
+        inIoUring = false;
+    }
+#endif
+
     if (aiocb)
     {
         if (!finished)
@@ -425,6 +747,17 @@ void PosixFileAccess::asyncsysread([[maybe_unused]] AsyncIOContext *context)
         return;
     }
 
+#ifdef USE_IO_URING
+    if (IoUring* ring = IoUring::instance())
+    {
+        if (ring->submit(posixContext, fd))
+        {
+            return;
+        }
+        LOG_debug << "io_uring queue full, using POSIX AIO";
+    }
+#endif
+
     struct aiocb *aiocbp = new struct aiocb;
     memset(aiocbp, 0, sizeof (struct aiocb));
 
@@ -474,10 +807,21 @@ void PosixFileAccess::asyncsyswrite([[maybe_unused]] AsyncIOContext *context)
         return;
     }
 
+#ifdef USE_IO_URING
+    if (IoUring* ring = IoUring::instance())
+    {
+        if (ring->submit(posixContext, writeDescriptor(posixContext->dataBuffer, posixContext->dataBufferLen, posixContext->posOfBuffer)))
+        {
+            return;
+        }
+        LOG_debug << "io_uring queue full, using POSIX AIO";
+    }
+#endif
+
     struct aiocb *aiocbp = new struct aiocb;
     memset(aiocbp, 0, sizeof (struct aiocb));
 
-    aiocbp->aio_fildes = fd;
+    aiocbp->aio_fildes = writeDescriptor(posixContext->dataBuffer, posixContext->dataBufferLen, posixContext->posOfBuffer);
     aiocbp->aio_buf = (void *)posixContext->dataBuffer;
     aiocbp->aio_nbytes = posixContext->dataBufferLen;
     aiocbp->aio_offset = posixContext->posOfBuffer;
@@ -532,17 +876,102 @@ void PosixFileAccess::fclose()
     dp = nullptr;
 #endif // HAVE_FDOPENDIR
 
+    closeDirectDescriptor();
+
     if (fd >= 0)
         close(fd);
 
     fd = -1;
 }
 
+bool PosixFileAccess::enableDirectWrites()
+{
+#if defined(__linux__) && !defined(__ANDROID__)
+    if (mDirectFd >= 0)
+    {
+        return true;
+    }
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    // a second descriptor of the same file: O_DIRECT applies to all the writes of a descriptor
+    std::string path = "/proc/self/fd/" + std::to_string(fd);
+    mDirectFd = open(path.c_str(), O_WRONLY | O_DIRECT);
+    if (mDirectFd < 0)
+    {
+        LOG_debug << "Direct writes not available: error " << errno << ": " << PosixFileSystemAccess::getErrorMessage(errno);
+        return false;
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool PosixFileAccess::fpreallocate(m_off_t size)
+{
+    if (fd < 0 || size <= 0)
+    {
+        return false;
+    }
+
+#if defined(__linux__)
+    // the file keeps its size: the unwritten parts are reserved but are not part of the file yet
+    if (!fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, size))
+    {
+        return true;
+    }
+#elif defined(__APPLE__)
+    // contiguous if possible, otherwise anywhere. The space beyond the end of the file is reserved as well
+    fstore_t store = { F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0, size, 0 };
+    if (fcntl(fd, F_PREALLOCATE, &store) != -1)
+    {
+        return true;
+    }
+
+    store.fst_flags = F_ALLOCATEALL;
+    if (fcntl(fd, F_PREALLOCATE, &store) != -1)
+    {
+        return true;
+    }
+#endif
+
+    LOG_debug << "Preallocation not available: error " << errno << ": " << PosixFileSystemAccess::getErrorMessage(errno);
+    return false;
+}
+
+int PosixFileAccess::writeDescriptor(const byte* data, unsigned len, m_off_t pos) const
+{
+    return (mDirectFd >= 0 && isDirectWriteAligned(data, len, pos)) ? mDirectFd : fd;
+}
+
+void PosixFileAccess::closeDirectDescriptor()
+{
+    if (mDirectFd >= 0)
+    {
+        close(mDirectFd);
+        mDirectFd = -1;
+    }
+}
+
 bool PosixFileAccess::fwrite(const byte* data, unsigned len, m_off_t pos)
 {
     retry = false;
 #ifndef __ANDROID__
-    return pwrite(fd, data, len, pos) == len;
+    int wfd = writeDescriptor(data, len, pos);
+    ssize_t written = pwrite(wfd, data, len, pos);
+    if (written < 0 && wfd == mDirectFd && errno == EINVAL)
+    {
+        // the filesystem has stricter requirements: go on through the OS cache
+        LOG_warn << "Direct write failed, disabling direct writes";
+        closeDirectDescriptor();
+        written = pwrite(fd, data, len, pos);
+    }
+    return written == static_cast<ssize_t>(len);
 #else
     lseek64(fd, pos, SEEK_SET);
     return write(fd, data, len) == len;
@@ -590,6 +1019,7 @@ bool PosixFileAccess::ftruncate(m_off_t size)
 
 int PosixFileAccess::stealFileDescriptor()
 {
+    closeDirectDescriptor();
     int toret = fd;
     fd = -1;
     return toret;
@@ -816,6 +1246,19 @@ PosixFileSystemAccess::PosixFileSystemAccess()
 
 bool LinuxFileSystemAccess::initFilesystemNotificationSystem()
 {
+#ifdef USE_FANOTIFY
+    // Notifiers will only be able to mark filesystems if we're privileged.
+    // Otherwise, or if the kernel is too old, they'll fall back to inotify.
+    mFanotifyFd = fanotify_init(FAN_CLASS_NOTIF | FAN_REPORT_DFID_NAME | FAN_CLOEXEC | FAN_NONBLOCK,
+                                O_RDONLY | O_LARGEFILE);
+
+    if (mFanotifyFd < 0)
+    {
+        LOG_debug << "fanotify isn't available, using inotify. Error: " << errno;
+        mFanotifyFd = -errno;
+    }
+#endif // USE_FANOTIFY
+
     mNotifyFd = inotify_init1(IN_NONBLOCK);
 
     if (mNotifyFd < 0)
@@ -836,6 +1279,12 @@ LinuxFileSystemAccess::~LinuxFileSystemAccess()
     if (mNotifyFd >= 0)
         close(mNotifyFd);
 
+#ifdef USE_FANOTIFY
+    // Release fanotify descriptor, if any (removes all of its marks).
+    if (mFanotifyFd >= 0)
+        close(mFanotifyFd);
+#endif // USE_FANOTIFY
+
 #endif // ENABLE_SYNC
 }
 
@@ -886,10 +1335,20 @@ void LinuxFileSystemAccess::addevents(Waiter* waiter, int flags)
 
     w->bumpmaxfd(mNotifyFd);
 
+#ifdef USE_FANOTIFY
+    if (mFanotifyFd >= 0)
+    {
+        MEGA_FD_SET(mFanotifyFd, &w->rfds);
+        MEGA_FD_SET(mFanotifyFd, &w->ignorefds);
+
+        w->bumpmaxfd(mFanotifyFd);
+    }
+#endif // USE_FANOTIFY
+
 #endif // ENABLE_SYNC
 }
 
-// read all pending inotify events and queue them for processing
+// read all pending inotify (and fanotify) events and queue them for processing
 int LinuxFileSystemAccess::checkevents(Waiter* waiter)
 {
     int result = 0;
@@ -907,16 +1366,13 @@ int LinuxFileSystemAccess::checkevents(Waiter* waiter)
 
     auto* w = static_cast<PosixWaiter*>(waiter);
 
-    if (!MEGA_FD_ISSET(mNotifyFd, &w->rfds))
-        return result;
-
     char buf[sizeof(struct inotify_event) + NAME_MAX + 1];
     ssize_t p, l;
     inotify_event* in;
     WatchMapIterator it;
     string localpath;
 
-    auto notifyAll = [&](int handle, const string& name)
+    auto notifyAll = [&](int handle, const string& name, bool deletedSelf, bool permissionsChanged)
     {
         // Loop over and notify all associated nodes.
         auto associated = mWatches.equal_range(handle);
@@ -935,7 +1391,7 @@ int LinuxFileSystemAccess::checkevents(Waiter* waiter)
                 << " Path: "
                 << name;
 
-            if ((in->mask & IN_DELETE_SELF))
+            if (deletedSelf)
             {
                 // The FS directory watched is gone
                 node.mWatchHandle.invalidate();
@@ -956,7 +1412,7 @@ int LinuxFileSystemAccess::checkevents(Waiter* waiter)
             // the directory's contents before. If we didn't rescan, we
             // wouldn't notice these files until some other event is
             // triggered in or below this directory.
-            if (in->mask == (IN_ATTRIB | IN_ISDIR))
+            if (permissionsChanged)
                 notifier.notify(notifier.fsEventq,
                                 &node,
                                 Notification::FOLDER_NEEDS_SELF_SCAN,
@@ -964,8 +1420,90 @@ int LinuxFileSystemAccess::checkevents(Waiter* waiter)
 
             result |= Waiter::NEEDEXEC;
         }
+
+#ifdef USE_FANOTIFY
+        // Forget the directory's file handle if no node is associated with it anymore.
+        if (handle < 0 && deletedSelf && !mWatches.count(handle))
+            releaseFanotifyHandle(handle);
+#endif // USE_FANOTIFY
     };
 
+#ifdef USE_FANOTIFY
+    if (mFanotifyFd >= 0 && MEGA_FD_ISSET(mFanotifyFd, &w->rfds))
+    {
+        alignas(fanotify_event_metadata) char events[8192];
+
+        while ((l = read(mFanotifyFd, events, sizeof events)) > 0)
+        {
+            auto* event = reinterpret_cast<fanotify_event_metadata*>(events);
+
+            for ( ; FAN_EVENT_OK(event, l); event = FAN_EVENT_NEXT(event, l))
+            {
+                if (event->vers != FANOTIFY_METADATA_VERSION)
+                {
+                    LOG_err << "fanotify: unexpected metadata version: " << static_cast<int>(event->vers);
+                    notifyTransientFailure();
+                    break;
+                }
+
+                if ((event->mask & FAN_Q_OVERFLOW))
+                {
+                    LOG_err << "fanotify FAN_Q_OVERFLOW";
+                    notifyTransientFailure();
+                    continue;
+                }
+
+                // We report file handles, so no descriptor was opened for the event.
+                if (event->event_len < sizeof(*event) + sizeof(fanotify_event_info_fid))
+                    continue;
+
+                auto* info = reinterpret_cast<fanotify_event_info_fid*>(event + 1);
+                auto type = info->hdr.info_type;
+
+                if (type != FAN_EVENT_INFO_TYPE_DFID_NAME
+                    && type != FAN_EVENT_INFO_TYPE_DFID
+                    && type != FAN_EVENT_INFO_TYPE_FID)
+                    continue;
+
+                // Which directory does the event refer to?
+                auto* fh = reinterpret_cast<file_handle*>(info->handle);
+
+                string key(reinterpret_cast<const char*>(&info->fsid), sizeof(info->fsid));
+                key.append(reinterpret_cast<const char*>(&fh->handle_type), sizeof(fh->handle_type));
+                key.append(reinterpret_cast<const char*>(fh->f_handle), fh->handle_bytes);
+
+                auto handle = mFanotifyHandles.find(key);
+
+                // The filesystem is shared with directories we don't sync.
+                if (handle == mFanotifyHandles.end())
+                    continue;
+
+                // Events on the directory itself have no name (or ".").
+                string name;
+
+                if (type == FAN_EVENT_INFO_TYPE_DFID_NAME)
+                {
+                    name = reinterpret_cast<const char*>(fh->f_handle + fh->handle_bytes);
+
+                    if (name == ".")
+                        name.clear();
+                }
+
+                LOG_verbose << "Filesystem notification:"
+                    << " event " << name << ": " << std::hex << event->mask;
+
+                notifyAll(handle->second,
+                          name,
+                          (event->mask & FAN_DELETE_SELF) != 0,
+                          event->mask == (FAN_ATTRIB | FAN_ONDIR));
+            }
+        }
+    }
+#endif // USE_FANOTIFY
+
+    if (!MEGA_FD_ISSET(mNotifyFd, &w->rfds))
+        return result;
+
     while ((l = read(mNotifyFd, buf, sizeof buf)) > 0)
     {
         for (p = 0; p < l; p += offsetof(inotify_event, name) + in->len)
@@ -994,7 +1532,10 @@ int LinuxFileSystemAccess::checkevents(Waiter* waiter)
                 if (it != mWatches.end())
                 {
                     // What nodes are associated with this handle?
-                    notifyAll(it->first, in->len? in->name : "");
+                    notifyAll(it->first,
+                              in->len? in->name : "",
+                              (in->mask & IN_DELETE_SELF) != 0,
+                              in->mask == (IN_ATTRIB | IN_ISDIR));
                 }
             }
         }
@@ -1038,6 +1579,35 @@ bool PosixFileSystemAccess::renamelocal(const LocalPath& oldname, const LocalPat
     return false;
 }
 
+// copy the whole content without reading it into userspace, if the filesystem supports it:
+// as a reflink sharing the blocks (btrfs, xfs) or as a copy in the kernel (which NFS and SMB can offload to the server).
+// If it fails, both files are left at the offsets where the copy should go on
+static bool copyInKernel(int sfd, int tfd)
+{
+#ifdef __linux__
+    if (!ioctl(tfd, FICLONE, sfd))
+    {
+        LOG_verbose << "Copied via FICLONE";
+        return true;
+    }
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+    ssize_t t;
+    while ((t = copy_file_range(sfd, nullptr, tfd, nullptr, 1024 * 1024 * 1024, 0)) > 0);
+    if (!t)
+    {
+        LOG_verbose << "Copied via copy_file_range";
+        return true;
+    }
+#endif
+#else
+    static_cast<void>(sfd);
+    static_cast<void>(tfd);
+#endif
+
+    return false;
+}
+
 bool PosixFileSystemAccess::copylocal(const LocalPath& oldname, const LocalPath& newname, m_time_t mtime)
 {
     AdjustBasePathResult oldnamestr = adjustBasePath(oldname);
@@ -1046,6 +1616,18 @@ bool PosixFileSystemAccess::copylocal(const LocalPath& oldname, const LocalPath&
     int sfd, tfd;
     ssize_t t = -1;
 
+#ifdef __APPLE__
+    // APFS clones share the blocks of the original until they are modified: instant and with no extra space
+    if (!clonefile(oldnamestr.c_str(), newnamestr.c_str(), CLONE_NOFOLLOW))
+    {
+        LOG_verbose << "Copied via clonefile";
+
+        // the clone gets the permissions of the original
+        chmod(newnamestr.c_str(), defaultfilepermissions);
+        t = 0;
+    }
+    else
+#endif
 #ifdef HAVE_SENDFILE
     // Linux-specific - kernel 2.6.33+ required
     if ((sfd = open(oldnamestr.c_str(), O_RDONLY | O_DIRECT)) >= 0)
@@ -1055,18 +1637,31 @@ bool PosixFileSystemAccess::copylocal(const LocalPath& oldname, const LocalPath&
         if ((tfd = open(newnamestr.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, defaultfilepermissions)) >= 0)
         {
             umask(mode);
-            while ((t = sendfile(tfd, sfd, NULL, 1024 * 1024 * 1024)) > 0);
+            if (copyInKernel(sfd, tfd))
+            {
+                t = 0;
+            }
+            else
+            {
+                while ((t = sendfile(tfd, sfd, NULL, 1024 * 1024 * 1024)) > 0);
+            }
 #else
-    char buf[16384];
-
     if ((sfd = open(oldnamestr.c_str(), O_RDONLY)) >= 0)
     {
-        LOG_verbose << "Copying via read/write";
         mode_t mode = umask(0);
         if ((tfd = open(newnamestr.c_str(), O_WRONLY | O_CREAT | O_TRUNC, defaultfilepermissions)) >= 0)
         {
             umask(mode);
-            while (((t = read(sfd, buf, sizeof buf)) > 0) && write(tfd, buf, t) == t);
+            if (copyInKernel(sfd, tfd))
+            {
+                t = 0;
+            }
+            else
+            {
+                LOG_verbose << "Copying via read/write";
+                char buf[16384];
+                while (((t = read(sfd, buf, sizeof buf)) > 0) && write(tfd, buf, t) == t);
+            }
 #endif
             close(tfd);
         }
@@ -1627,6 +2222,65 @@ void PosixFileSystemAccess::statsid(string *id) const
 #if defined(ENABLE_SYNC)
 #if defined(__linux__)
 
+#ifdef USE_FANOTIFY
+
+// Same events as our inotify watches, but for every directory on the filesystem.
+static const uint64_t FANOTIFY_EVENTS = FAN_ATTRIB
+                                        | FAN_CLOSE_WRITE
+                                        | FAN_CREATE
+                                        | FAN_DELETE
+                                        | FAN_DELETE_SELF
+                                        | FAN_MOVED_FROM
+                                        | FAN_MOVED_TO
+                                        | FAN_ONDIR;
+
+// Kernel fsid of the filesystem containing path, as reported in fanotify events.
+static bool fanotifyFsid(const char* path, string& fsid)
+{
+    struct statfs buffer;
+
+    if (statfs(path, &buffer))
+        return false;
+
+    fsid.assign(reinterpret_cast<const char*>(&buffer.f_fsid), sizeof(buffer.f_fsid));
+
+    return true;
+}
+
+void LinuxFileSystemAccess::releaseFanotifyHandle(int handle)
+{
+    auto i = mFanotifyHandleKeys.find(handle);
+
+    if (i == mFanotifyHandleKeys.end())
+        return;
+
+    mFanotifyHandles.erase(i->second);
+    mFanotifyHandleKeys.erase(i);
+}
+
+bool LinuxDirNotify::fanotifyHandleKey(const LocalPath& path, string& key) const
+{
+    // Is the directory on the filesystem we've marked?
+    if (!fanotifyFsid(path.localpath.c_str(), key) || key != mFanotifyFsid)
+        return false;
+
+    alignas(file_handle) char buffer[sizeof(file_handle) + MAX_HANDLE_SZ];
+    auto* fh = reinterpret_cast<file_handle*>(buffer);
+    int mountID;
+
+    fh->handle_bytes = MAX_HANDLE_SZ;
+
+    if (name_to_handle_at(AT_FDCWD, path.localpath.c_str(), fh, &mountID, 0))
+        return false;
+
+    key.append(reinterpret_cast<const char*>(&fh->handle_type), sizeof(fh->handle_type));
+    key.append(reinterpret_cast<const char*>(fh->f_handle), fh->handle_bytes);
+
+    return true;
+}
+
+#endif // USE_FANOTIFY
+
 LinuxDirNotify::LinuxDirNotify(LinuxFileSystemAccess& owner,
     LocalNode& root,
     const LocalPath& rootPath)
@@ -1640,10 +2294,68 @@ LinuxDirNotify::LinuxDirNotify(LinuxFileSystemAccess& owner,
     // Did our owner initialize correctly?
     if (owner.mNotifyFd >= 0)
         setFailed(0, "");
+
+#ifdef USE_FANOTIFY
+    string fsid;
+
+    // Try and monitor the sync's whole filesystem with a single mark.
+    if (owner.mFanotifyFd < 0 || !fanotifyFsid(rootPath.localpath.c_str(), fsid))
+        return;
+
+    auto& mark = owner.mFanotifyMarks[fsid];
+
+    if (!mark.mNotifiers
+        && fanotify_mark(owner.mFanotifyFd,
+                         FAN_MARK_ADD | FAN_MARK_FILESYSTEM,
+                         FANOTIFY_EVENTS,
+                         AT_FDCWD,
+                         rootPath.localpath.c_str()))
+    {
+        LOG_warn << "Unable to monitor filesystem with fanotify, using inotify: "
+                 << rootPath
+                 << ": Error: "
+                 << errno;
+
+        owner.mFanotifyMarks.erase(fsid);
+        return;
+    }
+
+    if (!mark.mNotifiers++)
+        mark.mPath = rootPath.localpath;
+
+    mFanotifyFsid = std::move(fsid);
+
+    // Fanotify works even if inotify couldn't be initialized.
+    setFailed(0, "");
+
+    LOG_debug << "Monitoring filesystem with fanotify: " << rootPath;
+#endif // USE_FANOTIFY
 }
 
 LinuxDirNotify::~LinuxDirNotify()
 {
+#ifdef USE_FANOTIFY
+    // Remove our filesystem's mark if no other notifier needs it.
+    auto i = mOwner.mFanotifyMarks.find(mFanotifyFsid);
+
+    if (i != mOwner.mFanotifyMarks.end() && !--i->second.mNotifiers)
+    {
+        if (fanotify_mark(mOwner.mFanotifyFd,
+                          FAN_MARK_REMOVE | FAN_MARK_FILESYSTEM,
+                          FANOTIFY_EVENTS,
+                          AT_FDCWD,
+                          i->second.mPath.c_str()))
+        {
+            LOG_warn << "Unable to remove fanotify mark: "
+                     << i->second.mPath
+                     << ": Error: "
+                     << errno;
+        }
+
+        mOwner.mFanotifyMarks.erase(i);
+    }
+#endif // USE_FANOTIFY
+
     // Remove ourselves from our owner's list of notiifers.
     mOwner.mNotifiers.erase(mNotifiersIt);
 }
@@ -1662,6 +2374,28 @@ AddWatchResult LinuxDirNotify::addWatch(LocalNode& node,
     // Convenience.
     auto& watches = mOwner.mWatches;
 
+#ifdef USE_FANOTIFY
+    string key;
+
+    // Our filesystem mark already covers the directory: just remember its file handle.
+    if (!mFanotifyFsid.empty() && fanotifyHandleKey(path, key))
+    {
+        auto known = mOwner.mFanotifyHandles.emplace(key, mOwner.mNextFanotifyHandle);
+
+        if (known.second)
+            mOwner.mFanotifyHandleKeys.emplace(mOwner.mNextFanotifyHandle--, std::move(key));
+
+        auto entry =
+            watches.emplace(piecewise_construct,
+                forward_as_tuple(known.first->second),
+                forward_as_tuple(&node, fsid));
+
+        return make_pair(entry, WR_SUCCESS);
+    }
+
+    // Otherwise, the directory's on another filesystem (or has no file handle).
+#endif // USE_FANOTIFY
+
     auto handle =
         inotify_add_watch(mOwner.mNotifyFd,
             path.localpath.c_str(),
@@ -1704,7 +2438,9 @@ void LinuxDirNotify::removeWatch(WatchMapIterator entry)
     auto& watches = mOwner.mWatches;
 
     auto handle = entry->first;
+#ifndef USE_FANOTIFY
     assert(handle >= 0);
+#endif // ! USE_FANOTIFY
 
     watches.erase(entry); // Removes first instance
 
@@ -1724,6 +2460,12 @@ void LinuxDirNotify::removeWatch(WatchMapIterator entry)
         return;
     }
 
+#ifdef USE_FANOTIFY
+    // Fanotify handles don't hold any resource in the kernel.
+    if (handle < 0)
+        return mOwner.releaseFanotifyHandle(handle);
+#endif // USE_FANOTIFY
+
     auto const removedResult = inotify_rm_watch(mOwner.mNotifyFd, handle);
 
     if (removedResult)
@@ -1818,7 +2560,8 @@ ScanResult PosixFileSystemAccess::directoryScan(const LocalPath& targetPath,
                                                 map<LocalPath, FSNode>& known,
                                                 std::vector<FSNode>& results,
                                                 bool followSymLinks,
-                                                unsigned& nFingerprinted)
+                                                unsigned& nFingerprinted,
+                                                std::vector<size_t>* unfingerprinted)
 {
     // Scan path should always be absolute.
     assert(targetPath.isAbsolute());
@@ -1845,6 +2588,19 @@ ScanResult PosixFileSystemAccess::directoryScan(const LocalPath& targetPath,
         return !::stat(path, &metadata);
     };
 
+    // Same, for the entries of the directory being iterated: fstatat() relative to the
+    // directory descriptor avoids resolving the whole path again for every entry.
+    auto statAt = [&](int dirFd, const char* name, struct stat& metadata) {
+        auto result = !fstatat(dirFd, name, &metadata, AT_SYMLINK_NOFOLLOW);
+
+        if (!result) return false;
+
+        if (!followSymLinks || !S_ISLNK(metadata.st_mode))
+            return result;
+
+        return !fstatat(dirFd, name, &metadata, 0);
+    };
+
     // Where we store file information.
     struct stat metadata;
 
@@ -1900,6 +2656,9 @@ ScanResult PosixFileSystemAccess::directoryScan(const LocalPath& targetPath,
     // What device is this directory on?
     auto device = metadata.st_dev;
 
+    // Descriptor the entries are stat'ed relative to.
+    auto directoryFd = dirfd(directory);
+
     // Iterate over the directory's children.
     auto entry = readdir(directory);
     auto path = targetPath;
@@ -1925,7 +2684,8 @@ ScanResult PosixFileSystemAccess::directoryScan(const LocalPath& targetPath,
         path.appendWithSeparator(result.localname, false);
 
         // Try and get information about this entry.
-        if (!stat(path.localpath.c_str(), metadata))
+        if (directoryFd < 0 ? !stat(path.localpath.c_str(), metadata)
+                            : !statAt(directoryFd, entry->d_name, metadata))
         {
             LOG_warn << "directoryScan: "
                      << "Unable to stat(...) file: "
@@ -2026,26 +2786,16 @@ ScanResult PosixFileSystemAccess::directoryScan(const LocalPath& targetPath,
             continue;
         }
 
-        // Try and open the file for reading.
-        UnixStreamAccess isAccess(path.localpath.c_str(),
-                                  result.fingerprint.size);
-
-        // Only fingerprint the file if we could actually open it.
-        if (!isAccess)
+        // Has the caller asked to fingerprint the file itself?
+        if (unfingerprinted)
         {
-            LOG_warn << "directoryScan: "
-                     << "Unable to open file for fingerprinting: "
-                     << path
-                     << ". Error was: "
-                     << errno;
+            unfingerprinted->push_back(results.size() - 1);
             continue;
         }
 
         // Fingerprint the file.
-        result.fingerprint.genfingerprint(
-          &isAccess, result.fingerprint.mtime);
-
-        ++nFingerprinted;
+        if (fingerprintScannedFile(path, result.fingerprint))
+            ++nFingerprinted;
     }
 
     // We're done iterating the directory.
@@ -2054,6 +2804,28 @@ ScanResult PosixFileSystemAccess::directoryScan(const LocalPath& targetPath,
     return SCAN_SUCCESS;
 }
 
+bool PosixFileSystemAccess::fingerprintScannedFile(const LocalPath& path,
+                                                   FileFingerprint& fingerprint)
+{
+    // Try and open the file for reading.
+    UnixStreamAccess isAccess(path.localpath.c_str(), fingerprint.size);
+
+    // Only fingerprint the file if we could actually open it.
+    if (!isAccess)
+    {
+        LOG_warn << "directoryScan: "
+                 << "Unable to open file for fingerprinting: "
+                 << path
+                 << ". Error was: "
+                 << errno;
+        return false;
+    }
+
+    fingerprint.genfingerprint(&isAccess, fingerprint.mtime);
+
+    return true;
+}
+
 #ifndef __APPLE__
 
 // Determine which device contains the specified path.
@@ -2408,7 +3180,8 @@ unique_ptr<DirAccess>  PosixFileSystemAccess::newdiraccess()
 #ifdef ENABLE_SYNC
 DirNotify* LinuxFileSystemAccess::newdirnotify(LocalNode& root,
     const LocalPath& rootPath,
-    Waiter*)
+    Waiter*,
+    const DirNotify::ResumePoint&)
 {
     return new LinuxDirNotify(*this, root, rootPath);
 }
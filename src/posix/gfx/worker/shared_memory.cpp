@@ -0,0 +1,98 @@
+#include "mega/posix/gfx/worker/shared_memory.h"
+#include "mega/logging.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace mega {
+namespace gfx {
+
+SharedMemory::SharedMemory(const std::string& name, void* data, size_t size, bool owner)
+    : mName(name)
+    , mData(data)
+    , mSize(size)
+    , mOwner(owner)
+{
+}
+
+SharedMemory::~SharedMemory()
+{
+    ::munmap(mData, mSize);
+    if (mOwner)
+    {
+        ::shm_unlink(toShmName(mName).c_str());
+    }
+}
+
+std::string SharedMemory::toShmName(const std::string& name)
+{
+    // only a leading slash is portable, and macOS allows 31 characters at most
+    return "/" + name.substr(0, 30);
+}
+
+std::unique_ptr<SharedMemory> SharedMemory::create(const std::string& name, size_t size)
+{
+    const std::string shmName = toShmName(name);
+
+    // readable by this user only, a leftover of a crashed process with the same name is replaced
+    ::shm_unlink(shmName.c_str());
+    int fd = ::shm_open(shmName.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (fd < 0)
+    {
+        LOG_err << "shm_open create " << shmName << " error: " << std::strerror(errno);
+        return nullptr;
+    }
+
+    void* data = MAP_FAILED;
+    if (::ftruncate(fd, static_cast<off_t>(size)) == 0)
+    {
+        data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    int error = errno;
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        LOG_err << "Shared memory " << shmName << " of " << size << " bytes couldn't be mapped: " << std::strerror(error);
+        ::shm_unlink(shmName.c_str());
+        return nullptr;
+    }
+
+    return std::unique_ptr<SharedMemory>(new SharedMemory(name, data, size, true));
+}
+
+std::unique_ptr<SharedMemory> SharedMemory::open(const std::string& name)
+{
+    const std::string shmName = toShmName(name);
+    int fd = ::shm_open(shmName.c_str(), O_RDWR, 0);
+    if (fd < 0)
+    {
+        LOG_err << "shm_open " << shmName << " error: " << std::strerror(errno);
+        return nullptr;
+    }
+
+    void* data = MAP_FAILED;
+    struct stat info;
+    if (::fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+        data = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    int error = errno;
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        LOG_err << "Shared memory " << shmName << " couldn't be mapped: " << std::strerror(error);
+        return nullptr;
+    }
+
+    return std::unique_ptr<SharedMemory>(new SharedMemory(name, data, static_cast<size_t>(info.st_size), false));
+}
+
+} // namespace
+}
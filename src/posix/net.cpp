@@ -36,6 +36,7 @@ extern JavaVM *MEGAjvm;
 #define DNS_CACHE_TIMEOUT_DS 18000
 #define DNS_CACHE_EXPIRES 0
 #define MAX_SPEED_CONTROL_TIMEOUT_MS 500
+#define HAPPY_EYEBALLS_TIMEOUT_MS 1000
 
 namespace mega {
 
@@ -153,6 +154,11 @@ SockInfo::~SockInfo()
 
 std::mutex CurlHttpIO::curlMutex;
 
+// Processes running many MegaApi instances (one per account) would otherwise resolve
+// the same MEGA hosts once per instance, so the resolved addresses are shared by all of them
+std::mutex CurlHttpIO::shareddnsMutex;
+std::map<string, CurlDNSEntry> CurlHttpIO::shareddnscache;
+
 #if defined(USE_OPENSSL) && !defined(OPENSSL_IS_BORINGSSL)
 
 std::recursive_mutex **CurlHttpIO::sslMutexes = NULL;
@@ -262,8 +268,6 @@ CurlHttpIO::CurlHttpIO()
     reset = false;
     statechange = false;
     disconnecting = false;
-    maxspeed[GET] = 0;
-    maxspeed[PUT] = 0;
     pkpErrors = 0;
 
     WAIT_CLASS::bumpds();
@@ -366,9 +370,9 @@ CurlHttpIO::CurlHttpIO()
     curltimeoutreset[PUT] = -1;
     arerequestspaused[PUT] = false;
 
-    curlsh = curl_share_init();
-    curl_share_setopt(curlsh, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
-    curl_share_setopt(curlsh, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    applyhttp2();
+
+    initcurlshare();
 
     contenttypejson = curl_slist_append(NULL, "Content-Type: application/json");
     contenttypejson = curl_slist_append(contenttypejson, "Expect:");
@@ -599,6 +603,23 @@ void CurlHttpIO::addcurlevents(Waiter *waiter, direction_t d)
 #endif
 
     SockInfoMap &socketmap = curlsockets[d];
+
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+    // sockets are kept registered by socket_callback(), only those created before
+    // knowing the waiter have to be added here
+    auto *posixwaiter = static_cast<PosixWaiter*>(waiter);
+    posixwaiter->enablegroup(d);
+    if (!curlsocketswatched[d])
+    {
+        for (auto& it : socketmap)
+        {
+            posixwaiter->watchfd(it.second.fd, it.second.mode, d);
+        }
+        curlsocketswatched[d] = true;
+    }
+    return;
+#endif
+
     for (SockInfoMap::iterator it = socketmap.begin(); it != socketmap.end(); it++)
     {
         SockInfo &info = it->second;
@@ -672,6 +693,14 @@ void CurlHttpIO::closecurlevents(direction_t d)
     {
         it->second.closeEvent(false);
     }
+#elif defined(USE_EPOLL) || defined(USE_KQUEUE)
+    if (waiter)
+    {
+        for (auto& it : socketmap)
+        {
+            waiter->watchfd(it.second.fd, 0, d);
+        }
+    }
 #endif
     socketmap.clear();
 }
@@ -726,26 +755,52 @@ void CurlHttpIO::processcurlevents(direction_t d)
     CodeCounter::ScopeTimer ccst(countProcessCurlEventsCode);
 #endif
 
-#ifdef WIN32
-    mSocketsWaitEvent_curl_call_needed = false;
-#else
+#ifndef WIN32
     auto *rfds = &((PosixWaiter *)waiter)->rfds;
     auto *wfds = &((PosixWaiter *)waiter)->wfds;
 #endif
 
     int dummy = 0;
     SockInfoMap *socketmap = &curlsockets[d];
-    bool *paused = &arerequestspaused[d];
 
-    for (SockInfoMap::iterator it = socketmap->begin(); !(*paused) && it != socketmap->end();)
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+    // the waiter only reports the ready sockets, no need to check all of them
+    std::vector<int> ready(rfds->begin(), rfds->end());
+    ready.insert(ready.end(), wfds->begin(), wfds->end());
+    std::sort(ready.begin(), ready.end());
+    ready.erase(std::unique(ready.begin(), ready.end()), ready.end());
+
+    for (auto fd = ready.begin(); !allrequestspaused(d) && fd != ready.end(); fd++)
+    {
+        auto it = socketmap->find(*fd);
+        if (it == socketmap->end())
+        {
+            continue;
+        }
+
+        SockInfo &info = it->second;
+        if (!info.mode)
+        {
+            continue;
+        }
+#else
+    for (SockInfoMap::iterator it = socketmap->begin(); !allrequestspaused(d) && it != socketmap->end();)
     {
         SockInfo &info = (it++)->second;
         if (!info.mode)
         {
             continue;
         }
+#endif
 
 #if defined(_WIN32)
+        // network events are only recorded for the sockets if their shared event was signalled,
+        // but the writable ones are checked anyway (see checkEvent)
+        if (!mSocketsWaitEvent_signalled[d] && !(info.mode & SockInfo::WRITE))
+        {
+            continue;
+        }
+
         bool read, write;
         if (info.checkEvent(read, write)) // if checkEvent returns true, both `read` and `write` have been set.
         {
@@ -765,6 +820,14 @@ void CurlHttpIO::processcurlevents(direction_t d)
 #endif
     }
 
+#if defined(_WIN32)
+    if (!allrequestspaused(d))
+    {
+        // all the sockets have been checked
+        mSocketsWaitEvent_signalled[d] = false;
+    }
+#endif
+
     if (curltimeoutreset[d] >= 0 && curltimeoutreset[d] <= Waiter::ds)
     {
         curltimeoutreset[d] = -1;
@@ -824,6 +887,19 @@ CurlHttpIO::~CurlHttpIO()
 
 int CurlHttpIO::instanceCount = 0;
 
+// DNS entries, TLS sessions and idle connections are shared by the API, GET and PUT multi
+// handles, so a new request reuses what any of them already set up with the same host
+void CurlHttpIO::initcurlshare()
+{
+    curlsh = curl_share_init();
+    curl_share_setopt(curlsh, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(curlsh, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900 // At least cURL 7.57.0
+    // all of them are used from the same thread, no lock functions needed
+    curl_share_setopt(curlsh, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+}
+
 void CurlHttpIO::setuseragent(string* u)
 {
     useragent = *u;
@@ -861,6 +937,10 @@ void CurlHttpIO::disconnect()
     curl_multi_cleanup(curlm[GET]);
     curl_multi_cleanup(curlm[PUT]);
 
+    // idle connections live in the share, drop them too
+    curl_share_cleanup(curlsh);
+    initcurlshare();
+
     if (numconnections[API] || numconnections[GET] || numconnections[PUT])
     {
         LOG_err << "Disconnecting without cancelling all requests first";
@@ -927,6 +1007,8 @@ void CurlHttpIO::disconnect()
     curltimeoutreset[PUT] = -1;
     arerequestspaused[PUT] = false;
 
+    applyhttp2();
+
     disconnecting = false;
 #ifdef MEGA_USE_C_ARES
     if (dnsservers.size())
@@ -949,24 +1031,61 @@ void CurlHttpIO::disconnect()
 
 bool CurlHttpIO::setmaxdownloadspeed(m_off_t bpslimit)
 {
-    maxspeed[GET] = bpslimit;
+    bandwidth[GET].setLimit(bpslimit);
     return true;
 }
 
 bool CurlHttpIO::setmaxuploadspeed(m_off_t bpslimit)
 {
-    maxspeed[PUT] = bpslimit;
+    bandwidth[PUT].setLimit(bpslimit);
     return true;
 }
 
+bool CurlHttpIO::sethttp2(bool enable)
+{
+#if LIBCURL_VERSION_NUM >= 0x072f00 // At least cURL 7.47.0
+    curl_version_info_data* data = curl_version_info(CURLVERSION_NOW);
+    if (enable && !(data->features & CURL_VERSION_HTTP2))
+    {
+        LOG_warn << "cURL built without HTTP/2 support";
+        return false;
+    }
+
+    LOG_debug << "HTTP/2 multiplexing " << (enable ? "enabled" : "disabled");
+    http2 = enable;
+    applyhttp2();
+    return true;
+#else
+    return !enable;
+#endif
+}
+
+bool CurlHttpIO::gethttp2()
+{
+    return http2;
+}
+
+// new requests wait for an existing connection to the same host to know if it can be
+// multiplexed (PIPEWAIT), so chunks and commands share a few TLS connections instead of
+// opening one per request. Servers without HTTP/2 get the usual HTTP/1.1 connections.
+void CurlHttpIO::applyhttp2()
+{
+#if LIBCURL_VERSION_NUM >= 0x072f00 // At least cURL 7.47.0
+    for (CURLM* multi : curlm)
+    {
+        curl_multi_setopt(multi, CURLMOPT_PIPELINING, http2 ? CURLPIPE_MULTIPLEX : CURLPIPE_NOTHING);
+    }
+#endif
+}
+
 m_off_t CurlHttpIO::getmaxdownloadspeed()
 {
-    return maxspeed[GET];
+    return bandwidth[GET].limit();
 }
 
 m_off_t CurlHttpIO::getmaxuploadspeed()
 {
-    return maxspeed[PUT];
+    return bandwidth[PUT].limit();
 }
 
 bool CurlHttpIO::cacheresolvedurls(const std::vector<string>& urls, std::vector<string>&& ips)
@@ -994,11 +1113,159 @@ bool CurlHttpIO::cacheresolvedurls(const std::vector<string>& urls, std::vector<
         dnsEntry.ipv6 = std::move(ips[2 * i + 1]);
         dnsEntry.ipv6timestamp = Waiter::ds;
         dnsEntry.mNeedsResolvingAgain = false;
+        publishdnsentry(host, dnsEntry);
     }
 
     return true;
 }
 
+void CurlHttpIO::prefetchdns(const std::vector<string>& urls)
+{
+#ifdef MEGA_USE_C_ARES
+    if (proxyurl.size())
+    {
+        // the proxy resolves them
+        return;
+    }
+
+    for (const string& url : urls)
+    {
+        string host, dummyscheme;
+        int dummyport;
+        if (!crackurl(&url, &dummyscheme, &host, &dummyport) || host.empty())
+        {
+            continue;
+        }
+
+        CurlDNSEntry& dnsEntry = dnscache[host];
+        fetchshareddnsentry(host, dnsEntry);
+        if ((dnsEntry.ipv4.size() && !dnsEntry.isIPv4Expired())
+                || (ipv6requestsenabled && dnsEntry.ipv6.size() && !dnsEntry.isIPv6Expired()))
+        {
+            continue;
+        }
+
+        // as a cancelled request: the context is released in ares_completed_callback() once the records are cached
+        CurlHttpContext* httpctx = new CurlHttpContext;
+        httpctx->req = NULL;
+        httpctx->curl = NULL;
+        httpctx->httpio = this;
+        httpctx->hostname = host;
+        httpctx->ares_pending = 1;
+
+        if (ipv6requestsenabled)
+        {
+            httpctx->ares_pending++;
+            NET_debug << "Prefetching IPv6 address for " << host;
+            ares_gethostbyname(ares, host.c_str(), PF_INET6, ares_completed_callback, httpctx);
+        }
+
+        NET_debug << "Prefetching IPv4 address for " << host;
+        ares_gethostbyname(ares, host.c_str(), PF_INET, ares_completed_callback, httpctx);
+    }
+#else
+    (void)urls;
+#endif
+}
+
+string CurlHttpIO::shareddnskey(const string& host) const
+{
+#ifdef MEGA_USE_C_ARES
+    // instances using different DNS servers don't share their records
+    return dnsservers + '/' + host;
+#else
+    return host;
+#endif
+}
+
+void CurlHttpIO::publishdnsentry(const string& host, const CurlDNSEntry& entry)
+{
+    std::lock_guard<std::mutex> g(shareddnsMutex);
+    CurlDNSEntry& shared = shareddnscache[shareddnskey(host)];
+
+    if (entry.ipv4.size() && entry.ipv4timestamp >= shared.ipv4timestamp)
+    {
+        shared.ipv4 = entry.ipv4;
+        shared.ipv4timestamp = entry.ipv4timestamp;
+    }
+
+    if (entry.ipv6.size() && entry.ipv6timestamp >= shared.ipv6timestamp)
+    {
+        shared.ipv6 = entry.ipv6;
+        shared.ipv6timestamp = entry.ipv6timestamp;
+    }
+}
+
+// fills in the missing or expired addresses of 'entry' with those resolved by other instances
+bool CurlHttpIO::fetchshareddnsentry(const string& host, CurlDNSEntry& entry)
+{
+    std::lock_guard<std::mutex> g(shareddnsMutex);
+    auto it = shareddnscache.find(shareddnskey(host));
+    if (it == shareddnscache.end())
+    {
+        return false;
+    }
+
+    CurlDNSEntry& shared = it->second;
+    bool updated = false;
+
+    if (shared.ipv4.size() && !shared.isIPv4Expired() && (!entry.ipv4.size() || entry.isIPv4Expired()))
+    {
+        entry.ipv4 = shared.ipv4;
+        entry.ipv4timestamp = shared.ipv4timestamp;
+        updated = true;
+    }
+
+    if (shared.ipv6.size() && !shared.isIPv6Expired() && (!entry.ipv6.size() || entry.isIPv6Expired()))
+    {
+        entry.ipv6 = shared.ipv6;
+        entry.ipv6timestamp = shared.ipv6timestamp;
+        updated = true;
+    }
+
+    return updated;
+}
+
+void CurlHttpIO::invalidateshareddnsentry(const string& host, const string& ip, bool ipv6)
+{
+    std::lock_guard<std::mutex> g(shareddnsMutex);
+    auto it = shareddnscache.find(shareddnskey(host));
+    if (it == shareddnscache.end())
+    {
+        return;
+    }
+
+    // other instances could have resolved a different address meanwhile
+    CurlDNSEntry& shared = it->second;
+    if (ipv6 && shared.ipv6 == ip)
+    {
+        shared.ipv6.clear();
+        shared.ipv6timestamp = 0;
+    }
+    else if (!ipv6 && shared.ipv4 == ip)
+    {
+        shared.ipv4.clear();
+        shared.ipv4timestamp = 0;
+    }
+}
+
+void CurlHttpIO::purgeshareddnscache()
+{
+    std::lock_guard<std::mutex> g(shareddnsMutex);
+    for (auto it = shareddnscache.begin(); it != shareddnscache.end(); )
+    {
+        CurlDNSEntry& entry = it->second;
+        if ((!entry.ipv4.size() || entry.isIPv4Expired()) && (!entry.ipv6.size() || entry.isIPv6Expired()))
+        {
+            it = shareddnscache.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+}
+
 // wake up from cURL I/O
 void CurlHttpIO::addevents(Waiter* w, int)
 {
@@ -1036,14 +1303,16 @@ void CurlHttpIO::addevents(Waiter* w, int)
 
     for (int d = GET; d == GET || d == PUT; d += PUT - GET)
     {
-        if (arerequestspaused[d])
+        if (!pausedrequests[d].empty())
         {
+            // wake up with the next tokens of the bandwidth limit
             if (curltimeoutms < 0 || curltimeoutms > 100)
             {
                 curltimeoutms = 100;
             }
         }
-        else
+
+        if (!allrequestspaused((direction_t)d))
         {
             addcurlevents(waiter, (direction_t)d);
             if (curltimeoutreset[d] >= 0)
@@ -1300,6 +1569,8 @@ void CurlHttpIO::ares_completed_callback(void* arg, int status, int, struct host
             dnsEntry.ipv4timestamp = Waiter::ds;
         }
 
+        httpio->publishdnsentry(httpctx->hostname, dnsEntry);
+
         // IPv6 takes precedence over IPv4
         if (!httpctx->hostip.size() || (host->h_addrtype == PF_INET6 && !httpctx->curl))
         {
@@ -1550,12 +1821,36 @@ void CurlHttpIO::send_request(CurlHttpContext* httpctx)
         curl_easy_setopt(curl, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1);
         curl_easy_setopt(curl, CURLOPT_NOSIGNAL, true);
         curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, HttpIO::CONNECTTIMEOUT / 10);
+
+        // Happy Eyeballs, in short: when IPv6 doesn't connect promptly and IPv4 is available, the request falls back to it
+        if (httpctx->isIPv6 && !httpio->proxyip.size())
+        {
+            auto dnsIt = httpio->dnscache.find(httpctx->hostname);
+            if ((dnsIt != httpio->dnscache.end() && dnsIt->second.ipv4.size() && !dnsIt->second.isIPv4Expired())
+#ifdef MEGA_USE_C_ARES
+                    || httpctx->ares_pending
+#endif
+                    )
+            {
+                curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, long(HAPPY_EYEBALLS_TIMEOUT_MS));
+            }
+        }
         curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
         curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE,  90L);
         curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, 60L);
         curl_easy_setopt(curl, CURLOPT_SOCKOPTFUNCTION, sockopt_callback);
         curl_easy_setopt(curl, CURLOPT_SOCKOPTDATA, (void*)req);
         curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+#if LIBCURL_VERSION_NUM >= 0x072f00 // At least cURL 7.47.0
+        if (httpio->http2)
+        {
+            curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+            curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+
+            // API requests must not wait behind the bulk data of the streams sharing the connection
+            curl_easy_setopt(curl, CURLOPT_STREAM_WEIGHT, req->type == REQ_JSON ? 256L : 16L);
+        }
+#endif
 #ifndef MEGA_USE_C_ARES
         curl_easy_setopt(curl, CURLOPT_QUICK_EXIT, 1L);
 #endif
@@ -1563,7 +1858,7 @@ void CurlHttpIO::send_request(CurlHttpContext* httpctx)
         // Some networks (eg vodafone UK) seem to block TLS 1.3 ClientHello.  1.2 is secure, and works:
         curl_easy_setopt(curl, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1_2 | CURL_SSLVERSION_MAX_TLSv1_2);
 
-        if (httpio->maxspeed[GET] && httpio->maxspeed[GET] <= 102400)
+        if (httpio->bandwidth[GET].limit() && httpio->bandwidth[GET].limit() <= 102400)
         {
             LOG_debug << "Low maxspeed, set curl buffer size to 4 KB";
             curl_easy_setopt(curl, CURLOPT_BUFFERSIZE, 4096L);
@@ -1986,6 +2281,7 @@ void CurlHttpIO::post(HttpReq* req, const char* data, unsigned len)
             }
         }
 
+        purgeshareddnscache();
         lastdnspurge = Waiter::ds;
     }
 
@@ -2024,6 +2320,17 @@ void CurlHttpIO::post(HttpReq* req, const char* data, unsigned len)
         dnsEntry = &it->second;
     }
 
+    if (!dnsEntry || (!(ipv6requestsenabled && dnsEntry->ipv6.size() && !dnsEntry->isIPv6Expired())
+                      && !(dnsEntry->ipv4.size() && !dnsEntry->isIPv4Expired())))
+    {
+        // another instance could have resolved it already
+        CurlDNSEntry sharedEntry = dnsEntry ? *dnsEntry : CurlDNSEntry();
+        if (fetchshareddnsentry(httpctx->hostname, sharedEntry))
+        {
+            dnsEntry = &(dnscache[httpctx->hostname] = std::move(sharedEntry));
+        }
+    }
+
     if (ipv6requestsenabled)
     {
         if (dnsEntry && dnsEntry->ipv6.size() && !dnsEntry->isIPv6Expired())
@@ -2181,31 +2488,27 @@ bool CurlHttpIO::doio()
     result = statechange;
     statechange = false;
 
+#ifdef WIN32
+    // the events of the sockets of each direction are pending until they are checked
+    if (mSocketsWaitEvent_curl_call_needed)
+    {
+        mSocketsWaitEvent_signalled.fill(true);
+        mSocketsWaitEvent_curl_call_needed = false;
+    }
+#endif
+
     processcurlevents(API);
     result |= multidoio(curlm[API]);
 
     for (int d = GET; d == GET || d == PUT; d += PUT - GET)
     {
-        partialdata[d] = 0;
-        if (arerequestspaused[d])
+        bandwidth[d].refill(Waiter::ds);
+        if (!pausedrequests[d].empty())
         {
-            arerequestspaused[d] = false;
-            set<CURL *>::iterator it = pausedrequests[d].begin();
-            while (!arerequestspaused[d] && it != pausedrequests[d].end())
-            {
-                CURL *easy_handle = *it;
-                pausedrequests[d].erase(it++);
-                curl_easy_pause(easy_handle, CURLPAUSE_CONT);
-            }
-
-            if (!arerequestspaused[d])
-            {
-                int dummy;
-                curl_multi_socket_action(curlm[d], CURL_SOCKET_TIMEOUT, 0, &dummy);
-            }
+            resumepausedrequests((direction_t)d);
         }
 
-        if (!arerequestspaused[d])
+        if (!allrequestspaused((direction_t)d))
         {
             processcurlevents((direction_t)d);
             result |= multidoio(curlm[d]);
@@ -2215,6 +2518,51 @@ bool CurlHttpIO::doio()
     return result;
 }
 
+// resume the requests paused by the bandwidth limit whose classes have tokens again,
+// the most latency sensitive classes first
+void CurlHttpIO::resumepausedrequests(direction_t d)
+{
+    bool resumed = false;
+    for (int c = 0; c < BW_CLASSES; c++)
+    {
+        set<CURL *>::iterator it = pausedrequests[d].begin();
+        while (it != pausedrequests[d].end())
+        {
+            CURL *easy_handle = *it++;
+            HttpReq *req = nullptr;
+            if (curl_easy_getinfo(easy_handle, CURLINFO_PRIVATE, (char**)&req) != CURLE_OK || !req)
+            {
+                pausedrequests[d].erase(easy_handle);
+                continue;
+            }
+
+            if (req->bwclass != c || bandwidth[d].available(req->bwclass, Waiter::ds) <= 0)
+            {
+                continue;
+            }
+
+            // the request can be paused again (and inserted back) while resuming it
+            pausedrequests[d].erase(easy_handle);
+            curl_easy_pause(easy_handle, CURLPAUSE_CONT);
+            resumed = true;
+            it = pausedrequests[d].upper_bound(easy_handle);
+        }
+    }
+
+    arerequestspaused[d] = !pausedrequests[d].empty();
+    if (resumed)
+    {
+        int dummy;
+        curl_multi_socket_action(curlm[d], CURL_SOCKET_TIMEOUT, 0, &dummy);
+    }
+}
+
+// no request of the direction can go on until the bandwidth limit has tokens again
+bool CurlHttpIO::allrequestspaused(direction_t d) const
+{
+    return arerequestspaused[d] && pausedrequests[d].size() >= size_t(std::max(numconnections[d], 0));
+}
+
 bool CurlHttpIO::multidoio(CURLM *curlmhandle)
 {
     int dummy = 0;
@@ -2396,6 +2744,7 @@ bool CurlHttpIO::multidoio(CURLM *curlmhandle)
                 {
                     // remove the IP from the DNS cache
                     CurlDNSEntry &dnsEntry = dnscache[httpctx->hostname];
+                    invalidateshareddnsentry(httpctx->hostname, httpctx->isIPv6 ? dnsEntry.ipv6 : dnsEntry.ipv4, httpctx->isIPv6);
 
                     if (httpctx->isIPv6)
                     {
@@ -2572,12 +2921,12 @@ size_t CurlHttpIO::read_data(void* ptr, size_t size, size_t nmemb, void* source)
 
     req->lastdata = Waiter::ds;
 
-    if (httpio->maxspeed[PUT])
+    if (httpio->bandwidth[PUT].limit())
     {
         bool isApi = (req->type == REQ_JSON);
         if (!isApi)
         {
-            long maxbytes = long( ((httpio->maxspeed[PUT] - httpio->uploadSpeed) * SpeedController::SPEED_MEAN_CIRCULAR_BUFFER_SIZE_SECONDS) - httpio->partialdata[PUT] );
+            m_off_t maxbytes = httpio->bandwidth[PUT].available(req->bwclass, Waiter::ds);
             if (maxbytes <= 0)
             {
                 httpio->pausedrequests[PUT].insert(httpctx->curl);
@@ -2587,9 +2936,9 @@ size_t CurlHttpIO::read_data(void* ptr, size_t size, size_t nmemb, void* source)
 
             if (nread > (size_t)maxbytes)
             {
-                nread = maxbytes;
+                nread = size_t(maxbytes);
             }
-            httpio->partialdata[PUT] += nread;
+            httpio->bandwidth[PUT].consume(req->bwclass, m_off_t(nread));
         }
     }
 
@@ -2606,21 +2955,22 @@ size_t CurlHttpIO::write_data(void* ptr, size_t size, size_t nmemb, void* target
     CurlHttpIO* httpio = (CurlHttpIO*)req->httpio;
     if (httpio)
     {
-        if (httpio->maxspeed[GET])
+        if (httpio->bandwidth[GET].limit())
         {
             CurlHttpContext* httpctx = (CurlHttpContext*)req->httpiohandle;
             bool isUpload = httpctx->data ? httpctx->len : req->out->size();
             bool isApi = (req->type == REQ_JSON);
             if (!isApi && !isUpload)
             {
-                if ((httpio->downloadSpeed + ((httpio->partialdata[GET] + len) / static_cast<m_off_t>(SpeedController::SPEED_MEAN_CIRCULAR_BUFFER_SIZE_SECONDS))) > httpio->maxspeed[GET])
+                // cURL writes can't be split: bigger ones than a bucket can hold only need it full
+                m_off_t available = httpio->bandwidth[GET].available(req->bwclass, Waiter::ds);
+                if (available < std::min<m_off_t>(len, BandwidthScheduler::MIN_BURST))
                 {
-                    CurlHttpContext* httpctx = (CurlHttpContext*)req->httpiohandle;
                     httpio->pausedrequests[GET].insert(httpctx->curl);
                     httpio->arerequestspaused[GET] = true;
                     return CURL_WRITEFUNC_PAUSE;
                 }
-                httpio->partialdata[GET] += len;
+                httpio->bandwidth[GET].consume(req->bwclass, len);
             }
         }
 
@@ -2674,6 +3024,11 @@ size_t CurlHttpIO::check_header(void* ptr, size_t size, size_t nmemb, void* targ
     {
         req->timeleft = atol((char*)ptr + 17);
     }
+    else if (len > 12 && !strncasecmp((char*)ptr, "Retry-After:", 12))
+    {
+        // only the delay in seconds is sent by the servers, not the HTTP date
+        req->retryafter = atol((char*)ptr + 12);
+    }
     else if (len > 15 && !memcmp(ptr, "Content-Type:", 13))
     {
         req->contenttype.assign((char *)ptr + 13, len - 15);
@@ -2749,6 +3104,11 @@ int CurlHttpIO::socket_callback(CURL *, curl_socket_t s, int what, void *userp,
 
 #if defined(_WIN32)
             it->second.closeEvent();
+#elif defined(USE_EPOLL) || defined(USE_KQUEUE)
+            if (httpio->waiter)
+            {
+                httpio->waiter->watchfd(s, 0, d);
+            }
 #endif
             it->second.mode = 0;
         }
@@ -2782,6 +3142,11 @@ int CurlHttpIO::socket_callback(CURL *, curl_socket_t s, int what, void *userp,
         {
             info.signalledWrite = true;
         }
+#elif defined(USE_EPOLL) || defined(USE_KQUEUE)
+        if (httpio->waiter)
+        {
+            httpio->waiter->watchfd(s, what & (SockInfo::READ | SockInfo::WRITE), d);
+        }
 #endif
     }
 
@@ -24,6 +24,10 @@
 
 #ifdef USE_POLL
     #include <poll.h> //poll
+#elif defined(USE_EPOLL)
+    #include <sys/epoll.h>
+#elif defined(USE_KQUEUE)
+    #include <sys/event.h>
 #endif
 
 namespace mega {
@@ -42,6 +46,19 @@ PosixWaiter::PosixWaiter()
         LOG_err << "fcntl error";
     }
 
+#if defined(USE_EPOLL)
+    mPollFd = epoll_create1(EPOLL_CLOEXEC);
+#elif defined(USE_KQUEUE)
+    mPollFd = kqueue();
+#endif
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+    if (mPollFd < 0)
+    {
+        LOG_fatal << "Error creating the event queue: " << errno;
+        throw std::runtime_error("Error creating the event queue");
+    }
+#endif
+
     maxfd = -1;
 }
 
@@ -49,6 +66,10 @@ PosixWaiter::~PosixWaiter()
 {
     close(m_pipe[0]);
     close(m_pipe[1]);
+
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+    close(mPollFd);
+#endif
 }
 
 void PosixWaiter::init(dstime ds)
@@ -61,6 +82,10 @@ void PosixWaiter::init(dstime ds)
     MEGA_FD_ZERO(&wfds);
     MEGA_FD_ZERO(&efds);
     MEGA_FD_ZERO(&ignorefds);
+
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+    mEnabledGroups = 0;
+#endif
 }
 
 // update monotonously increasing timestamp in deciseconds
@@ -97,6 +122,177 @@ bool PosixWaiter::fd_filter(int nfds, mega_fd_set_t* fds, mega_fd_set_t* ignoref
 // wait for supplied events (sockets, filesystem changes), plus timeout + application events
 // maxds specifies the maximum amount of time to wait in deciseconds (or ~0 if no timeout scheduled)
 // returns application-specific bitmask. bit 0 set indicates that exec() needs to be called.
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+
+// fds in efds, only used internally
+static const int WATCH_EXCEPT = 4;
+
+// maximum number of ready fds reported by a single wait (others remain ready for the next one)
+static const int MAX_READY_EVENTS = 256;
+
+void PosixWaiter::watchfd(int fd, int events, int group)
+{
+    assert(group >= 0 && group < 32);
+
+    if (events)
+    {
+        WatchedFd& watched = mWatched[fd];
+        watched.events = events;
+        watched.group = group;
+    }
+    else
+    {
+        mWatched.erase(fd);
+    }
+
+    updatekernel(fd, false);
+}
+
+void PosixWaiter::enablegroup(int group)
+{
+    assert(group >= 0 && group < 32);
+    mEnabledGroups |= 1u << group;
+}
+
+int PosixWaiter::desiredevents(int fd) const
+{
+    int events = 0;
+
+    auto watched = mWatched.find(fd);
+    if (watched != mWatched.end() && (mKernelGroups & (1u << watched->second.group)))
+    {
+        events |= watched->second.events;
+    }
+
+    auto cycle = mCycleFds.find(fd);
+    if (cycle != mCycleFds.end())
+    {
+        events |= cycle->second;
+    }
+
+    return events;
+}
+
+// 'rearm' registers the fd again even if nothing changed: closed fds leave the kernel
+// queue by themselves, and their number may already belong to a new socket
+void PosixWaiter::updatekernel(int fd, bool rearm)
+{
+    int desired = desiredevents(fd);
+
+    auto it = mKernelFds.find(fd);
+    int current = it == mKernelFds.end() ? 0 : it->second;
+
+    if (desired == current && !(rearm && desired))
+    {
+        return;
+    }
+
+#if defined(USE_EPOLL)
+    epoll_event ev{};
+    ev.data.fd = fd;
+    ev.events = ((desired & WATCH_READ) ? EPOLLIN : 0u)
+              | ((desired & WATCH_WRITE) ? EPOLLOUT : 0u)
+              | ((desired & WATCH_EXCEPT) ? EPOLLPRI : 0u);
+
+    int op = !desired ? EPOLL_CTL_DEL : (current ? EPOLL_CTL_MOD : EPOLL_CTL_ADD);
+    int r = epoll_ctl(mPollFd, op, fd, &ev);
+    if (r < 0 && errno == ENOENT && op == EPOLL_CTL_MOD)
+    {
+        r = epoll_ctl(mPollFd, EPOLL_CTL_ADD, fd, &ev);
+    }
+    else if (r < 0 && errno == EEXIST && op == EPOLL_CTL_ADD)
+    {
+        r = epoll_ctl(mPollFd, EPOLL_CTL_MOD, fd, &ev);
+    }
+
+    if (r < 0 && op != EPOLL_CTL_DEL)
+    {
+        LOG_warn << "epoll_ctl error for fd " << fd << ": " << errno;
+    }
+#else
+    static const int READ_EVENTS = WATCH_READ | WATCH_EXCEPT;
+    const struct { short filter; bool wanted; bool registered; } filters[] = {
+        { EVFILT_READ, (desired & READ_EVENTS) != 0, (current & READ_EVENTS) != 0 },
+        { EVFILT_WRITE, (desired & WATCH_WRITE) != 0, (current & WATCH_WRITE) != 0 },
+    };
+
+    for (auto& f : filters)
+    {
+        if (f.wanted == f.registered && !(rearm && f.wanted))
+        {
+            continue;
+        }
+
+        struct kevent change;
+        EV_SET(&change, fd, f.filter, f.wanted ? EV_ADD : EV_DELETE, 0, 0, nullptr);
+        if (kevent(mPollFd, &change, 1, nullptr, 0, nullptr) < 0 && f.wanted)
+        {
+            LOG_warn << "kevent error for fd " << fd << ": " << errno;
+        }
+    }
+#endif
+
+    if (desired)
+    {
+        mKernelFds[fd] = desired;
+    }
+    else if (it != mKernelFds.end())
+    {
+        mKernelFds.erase(it);
+    }
+}
+
+// apply the fds added to rfds/wfds/efds for this cycle and the enabled groups
+void PosixWaiter::updatecyclefds()
+{
+    std::unordered_map<int, int> cycleFds;
+    for (int fd : rfds) cycleFds[fd] |= WATCH_READ;
+    for (int fd : wfds) cycleFds[fd] |= WATCH_WRITE;
+    for (int fd : efds) cycleFds[fd] |= WATCH_EXCEPT;
+
+    mCycleFds.swap(cycleFds);
+
+    for (auto& previous : cycleFds)
+    {
+        if (!mCycleFds.count(previous.first))
+        {
+            updatekernel(previous.first, false);
+        }
+    }
+
+    // per-cycle fds are few (pipe, filesystem notifications, DNS), and their owners may
+    // close and reopen them between cycles without telling us
+    for (auto& current : mCycleFds)
+    {
+        updatekernel(current.first, true);
+    }
+
+    unsigned toggled = mEnabledGroups ^ mKernelGroups;
+    mKernelGroups = mEnabledGroups;
+    if (toggled)
+    {
+        for (auto& watched : mWatched)
+        {
+            if (toggled & (1u << watched.second.group))
+            {
+                updatekernel(watched.first, false);
+            }
+        }
+    }
+}
+
+#else
+
+void PosixWaiter::watchfd(int, int, int)
+{
+}
+
+void PosixWaiter::enablegroup(int)
+{
+}
+
+#endif
+
 int PosixWaiter::wait()
 {
     int numfd = 0;
@@ -115,7 +311,57 @@ int PosixWaiter::wait()
         tv.tv_usec = (suseconds_t)(us - tv.tv_sec * 1000000);
     }
 
-#ifdef USE_POLL
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+    updatecyclefds();
+
+    MEGA_FD_ZERO(&rfds);
+    MEGA_FD_ZERO(&wfds);
+    MEGA_FD_ZERO(&efds);
+
+#if defined(USE_EPOLL)
+    int timeoutInMs = -1;
+    if (maxds != std::numeric_limits<dstime>::max() &&
+        maxds <= std::numeric_limits<int>::max() / 100)
+    {
+        timeoutInMs = static_cast<int>(maxds) * 100;
+    }
+
+    epoll_event events[MAX_READY_EVENTS];
+    numfd = epoll_wait(mPollFd, events, MAX_READY_EVENTS, timeoutInMs);
+
+    for (int i = 0; i < numfd; i++)
+    {
+        int fd = events[i].data.fd;
+        uint32_t e = events[i].events;
+        if (e & (EPOLLIN | EPOLLHUP | EPOLLERR)) MEGA_FD_SET(fd, &rfds);
+        if (e & (EPOLLOUT | EPOLLHUP | EPOLLERR)) MEGA_FD_SET(fd, &wfds);
+        if (e & EPOLLPRI) MEGA_FD_SET(fd, &efds);
+    }
+#else
+    timespec ts;
+    if (maxds + 1)
+    {
+        ts.tv_sec = tv.tv_sec;
+        ts.tv_nsec = tv.tv_usec * 1000;
+    }
+
+    struct kevent events[MAX_READY_EVENTS];
+    numfd = kevent(mPollFd, nullptr, 0, events, MAX_READY_EVENTS, maxds + 1 ? &ts : nullptr);
+
+    for (int i = 0; i < numfd; i++)
+    {
+        int fd = static_cast<int>(events[i].ident);
+        bool error = events[i].flags & EV_ERROR;
+        if (events[i].filter == EVFILT_READ || error)
+        {
+            MEGA_FD_SET(fd, &rfds);
+            auto cycle = mCycleFds.find(fd);
+            if (cycle != mCycleFds.end() && (cycle->second & WATCH_EXCEPT)) MEGA_FD_SET(fd, &efds);
+        }
+        if (events[i].filter == EVFILT_WRITE || error) MEGA_FD_SET(fd, &wfds);
+    }
+#endif
+#elif defined(USE_POLL)
     // wait infinite (-1) if maxds is max dstime OR it would overflow platform's int
     int timeoutInMs = -1;
     if (maxds != std::numeric_limits<dstime>::max() &&
@@ -172,7 +418,21 @@ int PosixWaiter::wait()
     }
 
     // request exec() to be run only if a non-ignored fd was triggered
-#ifdef USE_POLL
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+    for (int fd : rfds)
+    {
+        if (!MEGA_FD_ISSET(fd, &ignorefds)) return NEEDEXEC;
+    }
+    for (int fd : wfds)
+    {
+        if (!MEGA_FD_ISSET(fd, &ignorefds)) return NEEDEXEC;
+    }
+    for (int fd : efds)
+    {
+        if (!MEGA_FD_ISSET(fd, &ignorefds)) return NEEDEXEC;
+    }
+    return 0;
+#elif defined(USE_POLL)
     for (unsigned int i = 0 ; i < total ; i++)
     {
         if  ((fds[i].revents & (POLLIN_SET | POLLOUT_SET | POLLEX_SET) )  && !MEGA_FD_ISSET(fds[i].fd, &ignorefds) )
@@ -191,6 +451,12 @@ int PosixWaiter::wait()
 
 void PosixWaiter::notify()
 {
+    // many threads notify while the SDK thread is busy: only the first one after the wait takes the mutex
+    if (alreadyNotified)
+    {
+        return;
+    }
+
     std::lock_guard<std::mutex> g(mMutex);
     if (!alreadyNotified)
     {
@@ -26,11 +26,343 @@
 #include "mega.h" // for thread definitions
 #include "mega/raidproxy.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MEGA_RAID_SSE2
+#include <emmintrin.h>
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define MEGA_RAID_AVX2
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON)
+#define MEGA_RAID_NEON
+#include <arm_neon.h>
+#endif
+
 #undef min //avoids issues with std::min
 
 namespace mega
 {
 
+namespace {
+
+// index of the missing data part, or 0 if all data parts are present
+unsigned missingDataPart(const byte* const parts[RAIDPARTS])
+{
+    unsigned missing = 0;
+    for (unsigned j = 1; j < RAIDPARTS; ++j)
+    {
+        if (!parts[j])
+        {
+            assert(!missing && parts[0]);  // only one part can be recovered
+            missing = j;
+        }
+    }
+    return missing;
+}
+
+void combineRaidLinesScalar(byte* dest, const byte* const parts[RAIDPARTS], size_t partslen)
+{
+    unsigned missing = missingDataPart(parts);
+
+    for (size_t i = 0; i < partslen; i += RAIDSECTOR)
+    {
+        for (unsigned j = 1; j < RAIDPARTS; ++j, dest += RAIDSECTOR)
+        {
+            if (j != missing)
+            {
+                memcpy(dest, parts[j] + i, RAIDSECTOR);
+                continue;
+            }
+
+            uint64_t x[2] = { 0, 0 };
+            for (unsigned k = 0; k < RAIDPARTS; ++k)
+            {
+                if (k != missing)
+                {
+                    uint64_t v[2];
+                    memcpy(v, parts[k] + i, RAIDSECTOR);
+                    x[0] ^= v[0];
+                    x[1] ^= v[1];
+                }
+            }
+            memcpy(dest, x, RAIDSECTOR);
+        }
+    }
+}
+
+#if defined(MEGA_RAID_SSE2)
+void combineRaidLinesSSE2(byte* dest, const byte* const parts[RAIDPARTS], size_t partslen)
+{
+    unsigned missing = missingDataPart(parts);
+
+    for (size_t i = 0; i < partslen; i += RAIDSECTOR, dest += RAIDLINE)
+    {
+        __m128i v[RAIDPARTS];
+        __m128i x = _mm_setzero_si128();
+        for (unsigned k = 0; k < RAIDPARTS; ++k)
+        {
+            if (parts[k] && (k || missing))   // parity only needed to recover
+            {
+                v[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(parts[k] + i));
+                x = _mm_xor_si128(x, v[k]);
+            }
+        }
+
+        if (missing)
+        {
+            v[missing] = x;
+        }
+
+        for (unsigned j = 1; j < RAIDPARTS; ++j)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + (j - 1) * RAIDSECTOR), v[j]);
+        }
+    }
+}
+#endif
+
+#if defined(MEGA_RAID_AVX2)
+// two raid lines per iteration
+__attribute__((target("avx2")))
+void combineRaidLinesAVX2(byte* dest, const byte* const parts[RAIDPARTS], size_t partslen)
+{
+    unsigned missing = missingDataPart(parts);
+
+    size_t i = 0;
+    for (; i + 2 * RAIDSECTOR <= partslen; i += 2 * RAIDSECTOR, dest += 2 * RAIDLINE)
+    {
+        __m256i v[RAIDPARTS];
+        __m256i x = _mm256_setzero_si256();
+        for (unsigned k = 0; k < RAIDPARTS; ++k)
+        {
+            if (parts[k] && (k || missing))   // parity only needed to recover
+            {
+                v[k] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(parts[k] + i));
+                x = _mm256_xor_si256(x, v[k]);
+            }
+        }
+
+        if (missing)
+        {
+            v[missing] = x;
+        }
+
+        for (unsigned j = 1; j < RAIDPARTS; ++j)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + (j - 1) * RAIDSECTOR), _mm256_castsi256_si128(v[j]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + RAIDLINE + (j - 1) * RAIDSECTOR), _mm256_extracti128_si256(v[j], 1));
+        }
+    }
+
+    if (i < partslen)
+    {
+        const byte* tail[RAIDPARTS];
+        for (unsigned k = 0; k < RAIDPARTS; ++k)
+        {
+            tail[k] = parts[k] ? parts[k] + i : nullptr;
+        }
+        combineRaidLinesSSE2(dest, tail, partslen - i);
+    }
+}
+#endif
+
+#if defined(MEGA_RAID_NEON)
+void combineRaidLinesNEON(byte* dest, const byte* const parts[RAIDPARTS], size_t partslen)
+{
+    unsigned missing = missingDataPart(parts);
+
+    for (size_t i = 0; i < partslen; i += RAIDSECTOR, dest += RAIDLINE)
+    {
+        uint8x16_t v[RAIDPARTS];
+        uint8x16_t x = vdupq_n_u8(0);
+        for (unsigned k = 0; k < RAIDPARTS; ++k)
+        {
+            if (parts[k] && (k || missing))   // parity only needed to recover
+            {
+                v[k] = vld1q_u8(parts[k] + i);
+                x = veorq_u8(x, v[k]);
+            }
+        }
+
+        if (missing)
+        {
+            v[missing] = x;
+        }
+
+        for (unsigned j = 1; j < RAIDPARTS; ++j)
+        {
+            vst1q_u8(dest + (j - 1) * RAIDSECTOR, v[j]);
+        }
+    }
+}
+#endif
+
+void recoverRaidLinesScalar(byte* lines, const byte* parity, unsigned missing, size_t numLines)
+{
+    for (size_t i = 0; i < numLines; ++i, lines += RAIDLINE, parity += RAIDSECTOR)
+    {
+        uint64_t x[2];
+        memcpy(x, parity, RAIDSECTOR);
+        for (unsigned j = 1; j < RAIDPARTS; ++j)
+        {
+            if (j != missing)
+            {
+                uint64_t v[2];
+                memcpy(v, lines + (j - 1) * RAIDSECTOR, RAIDSECTOR);
+                x[0] ^= v[0];
+                x[1] ^= v[1];
+            }
+        }
+        memcpy(lines + (missing - 1) * RAIDSECTOR, x, RAIDSECTOR);
+    }
+}
+
+#if defined(MEGA_RAID_SSE2)
+void recoverRaidLinesSSE2(byte* lines, const byte* parity, unsigned missing, size_t numLines)
+{
+    for (size_t i = 0; i < numLines; ++i, lines += RAIDLINE, parity += RAIDSECTOR)
+    {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(parity));
+        for (unsigned j = 1; j < RAIDPARTS; ++j)
+        {
+            if (j != missing)
+            {
+                x = _mm_xor_si128(x, _mm_loadu_si128(reinterpret_cast<const __m128i*>(lines + (j - 1) * RAIDSECTOR)));
+            }
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lines + (missing - 1) * RAIDSECTOR), x);
+    }
+}
+#endif
+
+#if defined(MEGA_RAID_AVX2)
+// two raid lines per iteration (their parity sectors are contiguous)
+__attribute__((target("avx2")))
+void recoverRaidLinesAVX2(byte* lines, const byte* parity, unsigned missing, size_t numLines)
+{
+    size_t i = 0;
+    for (; i + 2 <= numLines; i += 2, lines += 2 * RAIDLINE, parity += 2 * RAIDSECTOR)
+    {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(parity));
+        for (unsigned j = 1; j < RAIDPARTS; ++j)
+        {
+            if (j != missing)
+            {
+                const byte* sector = lines + (j - 1) * RAIDSECTOR;
+                __m256i v = _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(sector)));
+                v = _mm256_inserti128_si256(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(sector + RAIDLINE)), 1);
+                x = _mm256_xor_si256(x, v);
+            }
+        }
+
+        byte* target = lines + (missing - 1) * RAIDSECTOR;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target), _mm256_castsi256_si128(x));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + RAIDLINE), _mm256_extracti128_si256(x, 1));
+    }
+
+    if (i < numLines)
+    {
+        recoverRaidLinesSSE2(lines, parity, missing, numLines - i);
+    }
+}
+#endif
+
+#if defined(MEGA_RAID_NEON)
+void recoverRaidLinesNEON(byte* lines, const byte* parity, unsigned missing, size_t numLines)
+{
+    for (size_t i = 0; i < numLines; ++i, lines += RAIDLINE, parity += RAIDSECTOR)
+    {
+        uint8x16_t x = vld1q_u8(parity);
+        for (unsigned j = 1; j < RAIDPARTS; ++j)
+        {
+            if (j != missing)
+            {
+                x = veorq_u8(x, vld1q_u8(lines + (j - 1) * RAIDSECTOR));
+            }
+        }
+        vst1q_u8(lines + (missing - 1) * RAIDSECTOR, x);
+    }
+}
+#endif
+
+using CombineRaidLinesFunc = void (*)(byte*, const byte* const[RAIDPARTS], size_t);
+using RecoverRaidLinesFunc = void (*)(byte*, const byte*, unsigned, size_t);
+
+CombineRaidLinesFunc selectCombineRaidLines()
+{
+#if defined(MEGA_RAID_AVX2)
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return combineRaidLinesAVX2;
+    }
+#endif
+#if defined(MEGA_RAID_SSE2)
+    return combineRaidLinesSSE2;
+#elif defined(MEGA_RAID_NEON)
+    return combineRaidLinesNEON;
+#else
+    return combineRaidLinesScalar;
+#endif
+}
+
+RecoverRaidLinesFunc selectRecoverRaidLines()
+{
+#if defined(MEGA_RAID_AVX2)
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return recoverRaidLinesAVX2;
+    }
+#endif
+#if defined(MEGA_RAID_SSE2)
+    return recoverRaidLinesSSE2;
+#elif defined(MEGA_RAID_NEON)
+    return recoverRaidLinesNEON;
+#else
+    return recoverRaidLinesScalar;
+#endif
+}
+
+} // namespace
+
+void RaidBufferManager::combineRaidLines(byte* dest, const byte* const parts[RAIDPARTS], size_t partslen)
+{
+    assert(partslen % RAIDSECTOR == 0);
+
+    static const CombineRaidLinesFunc combine = selectCombineRaidLines();
+    combine(dest, parts, partslen);
+}
+
+void RaidBufferManager::recoverRaidLines(byte* lines, const byte* parity, unsigned missing, size_t numLines)
+{
+    assert(missing > 0 && missing < RAIDPARTS);
+
+    static const RecoverRaidLinesFunc recover = selectRecoverRaidLines();
+    recover(lines, parity, missing, numLines);
+}
+
+void RaidBufferManager::xorBytes(byte* dest, const byte* src, size_t n)
+{
+    size_t i = 0;
+#if defined(MEGA_RAID_SSE2)
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dest + i));
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_xor_si128(d, s));
+    }
+#elif defined(MEGA_RAID_NEON)
+    for (; i + 16 <= n; i += 16)
+    {
+        vst1q_u8(dest + i, veorq_u8(vld1q_u8(dest + i), vld1q_u8(src + i)));
+    }
+#endif
+    for (; i < n; ++i)
+    {
+        // Integer promotion with bitwise operators
+        dest[i] = static_cast<byte>(dest[i] ^ src[i]);
+    }
+}
+
 const unsigned RAID_ACTIVE_CHANNEL_FAIL_THRESHOLD = 5;
 
 struct FaultyServers
@@ -115,7 +447,7 @@ RaidBufferManager::FilePiece::FilePiece()
 
 RaidBufferManager::FilePiece::FilePiece(m_off_t p, size_t len)
     : pos(p)
-    , buf(new byte[len + std::min<size_t>(SymmCipher::BLOCKSIZE, RAIDSECTOR)], 0, len)   // SymmCipher::ctr_crypt requirement: decryption: data must be padded to BLOCKSIZE.  Also make sure we can xor up to RAIDSECTOR more for convenience
+    , buf(HttpBufferPool::allocate(len + std::min<size_t>(SymmCipher::BLOCKSIZE, RAIDSECTOR)), 0, len)   // SymmCipher::ctr_crypt requirement: decryption: data must be padded to BLOCKSIZE.  Also make sure we can xor up to RAIDSECTOR more for convenience
 {
 }
 
@@ -581,7 +913,7 @@ RaidBufferManager::FilePiece* RaidBufferManager::combineRaidParts(size_t partsle
     // usual case, for simple and fast processing: all input buffers are the same size, and aligned, and a multiple of raidsector
     if (partslen > 0)
     {
-        byte* inputbufs[RAIDPARTS];
+        const byte* inputbufs[RAIDPARTS];
         for (unsigned i = RAIDPARTS; i--; )
         {
             FilePiece* inputPiece = raidinputparts[i].front();
@@ -589,51 +921,12 @@ RaidBufferManager::FilePiece* RaidBufferManager::combineRaidParts(size_t partsle
         }
 
         byte* b = result->buf.datastart() + prevleftoverchunk.buf.datalen();
-        byte* endpos = b + partslen * EFFECTIVE_RAIDPARTS;
-
-        for (unsigned i = 0; b < endpos; i += RAIDSECTOR)
-        {
-            for (unsigned j = 1; j < RAIDPARTS; ++j)
-            {
-                assert(b + RAIDSECTOR <= result->buf.datastart() + result->buf.datalen());
-                if (inputbufs[j])
-                {
-                    memcpy(b, inputbufs[j] + i, RAIDSECTOR);
-                }
-                else
-                {
-                    recoverSectorFromParity(b, inputbufs, i);
-                }
-                b += RAIDSECTOR;
-            }
-        }
-        assert(b == endpos);
+        assert(b + partslen * EFFECTIVE_RAIDPARTS <= result->buf.datastart() + result->buf.datalen());
+        combineRaidLines(b, inputbufs, partslen);
     }
     return result;
 }
 
-void RaidBufferManager::recoverSectorFromParity(byte* dest, byte* inputbufs[], unsigned offset)
-{
-    assert(sizeof(m_off_t)*2 == RAIDSECTOR);
-    bool set = false;
-    for (unsigned i = RAIDPARTS; i--; )
-    {
-        if (inputbufs[i])
-        {
-            if (!set)
-            {
-                memcpy(dest, inputbufs[i] + offset, RAIDSECTOR);
-                set = true;
-            }
-            else
-            {
-                *(m_off_t*)dest ^= *(m_off_t*)(inputbufs[i] + offset);
-                *(m_off_t*)(dest + sizeof(m_off_t)) ^= *(m_off_t*)(inputbufs[i] + offset + sizeof(m_off_t));
-            }
-        }
-    }
-}
-
 void RaidBufferManager::combineLastRaidLine(byte* dest, size_t remainingbytes)
 {
     // we have to be careful to use the right number of bytes from each sector
@@ -655,10 +948,7 @@ void RaidBufferManager::combineLastRaidLine(byte* dest, size_t remainingbytes)
                     if (!raidinputparts[j].empty() && !raidinputparts[j].front()->buf.isNull())
                     {
                         FilePiece* xs = raidinputparts[j].front();
-                        for (size_t x = std::min(n, xs->buf.datalen()); x--; )
-                        { // Integer promotion with bitwise operators
-                            dest[x] = static_cast<byte>(dest[x] ^ xs->buf.datastart()[x]);
-                        }
+                        xorBytes(dest, xs->buf.datastart(), std::min(n, xs->buf.datalen()));
                     }
                 }
             }
@@ -1185,6 +1475,7 @@ public:
             start();
         }
         RaidProxy::RaidReq::Params raidReqParams(tempUrls, cfilesize, cstart, creqlen);
+        raidReqParams.bwclass = mTSlot->bandwidthClass();
         mRaidReqPoolArray[connection].reset(new RaidProxy::RaidReqPool());
         mRaidReqPoolArray[connection]->request(raidReqParams, mTSlot->getcloudRaidPtr());
         return mRaidReqPoolArray[connection]->rr() != nullptr;
@@ -1284,6 +1575,23 @@ public:
     }
 };
 
+bool TransferBufferBudget::acquire(m_off_t size, bool mustGrant)
+{
+    if (!mustGrant && mLimit > 0 && mUsed + size > mLimit)
+    {
+        return false;
+    }
+
+    mUsed += size;
+    return true;
+}
+
+void TransferBufferBudget::release(m_off_t size)
+{
+    assert(size <= mUsed);
+    mUsed -= std::min(size, mUsed);
+}
+
 CloudRaid::CloudRaid()
 {
 }
@@ -256,6 +256,91 @@ int PartFetcher::onFailure()
     return -1;
 }
 
+void PartThroughput::addSample(m_off_t bytes, int64_t ms)
+{
+    double x = static_cast<double>(bytes);
+    double y = static_cast<double>(std::max<int64_t>(ms, 1)); // sub-millisecond requests would not be comparable
+    double w = mSamples ? SAMPLE_WEIGHT : 1;
+
+    mBytes += w * (x - mBytes);
+    mMs += w * (y - mMs);
+    mBytesSq += w * (x * x - mBytesSq);
+    mBytesMs += w * (x * y - mBytesMs);
+    mSamples++;
+}
+
+void PartThroughput::reset()
+{
+    *this = PartThroughput();
+}
+
+double PartThroughput::bytesPerMs() const
+{
+    return mSamples ? mBytes / mMs : 0;
+}
+
+double PartThroughput::latencyMs() const
+{
+    // least squares fit of 'ms = latency + bytes / bandwidth' over the rolling moments
+    double variance = mBytesSq - mBytes * mBytes;
+    if (mSamples < 2 || variance <= (mBytes * mBytes) / 100) // sizes too similar to tell the latency apart
+    {
+        return 0;
+    }
+
+    double msPerByte = (mBytesMs - mBytes * mMs) / variance;
+    return std::min(std::max(mMs - msPerByte * mBytes, 0.0), mMs);
+}
+
+double PartThroughput::predictedMs(m_off_t rem) const
+{
+    // the average request already accounts for the latency of each one
+    return mSamples ? static_cast<double>(rem) * mMs / mBytes : 0;
+}
+
+uint8_t ::mega::RaidProxy::predictLaggingPart(const std::array<const PartThroughput*, RAIDPARTS>& models, const std::array<m_off_t, RAIDPARTS>& rem)
+{
+    uint8_t lagging = RAIDPARTS;
+    double laggingMs = 0;
+    unsigned candidates = 0;
+    for (uint8_t i = 0; i < RAIDPARTS; i++)
+    {
+        if (models[i] && models[i]->samples() >= PartThroughput::MIN_SAMPLES && rem[i] > 0)
+        {
+            candidates++;
+            double ms = models[i]->predictedMs(rem[i]);
+            if (lagging == RAIDPARTS || ms > laggingMs)
+            {
+                lagging = i;
+                laggingMs = ms;
+            }
+        }
+    }
+    if (candidates < 2)
+    {
+        return RAIDPARTS;
+    }
+
+    double othersMs = 0;
+    double bytesPerMs = 0;
+    double latencyMs = 0;
+    for (uint8_t i = 0; i < RAIDPARTS; i++)
+    {
+        if (i != lagging && models[i] && models[i]->samples() >= PartThroughput::MIN_SAMPLES && rem[i] > 0)
+        {
+            othersMs = std::max(othersMs, models[i]->predictedMs(rem[i]));
+            bytesPerMs += models[i]->bytesPerMs() / (candidates - 1);
+            latencyMs += models[i]->latencyMs() / (candidates - 1);
+        }
+    }
+
+    double freshMs = latencyMs + static_cast<double>(rem[lagging]) / bytesPerMs;
+    double switchedMs = std::max(othersMs, freshMs);
+
+    // same 5/4 ratio used to compare the speed of two parts
+    return (laggingMs * 4 > switchedMs * 5) ? lagging : static_cast<uint8_t>(RAIDPARTS);
+}
+
 m_off_t PartFetcher::getSocketSpeed() const
 {
     if (!mTimeInflight)
@@ -338,7 +423,7 @@ bool PartFetcher::directTrigger(bool addDirectio)
 void PartFetcher::closesocket(bool reuseSocket)
 {
     mRem = 0;
-    mRemfeed = 0; // need to clear remfeed so that the disconnected channel does not corrupt feedlag
+    mRemfeed = 0; // need to clear remfeed so that the disconnected channel does not corrupt its throughput
 
     mPostCompleted = false;
     if (mInbuf) mInbuf.reset(nullptr);
@@ -460,7 +545,10 @@ int PartFetcher::io()
                 httpReq->buffer_released = true;
                 mReqBytesReceived += mInbuf->datalen();
                 mPostCompleted = true;
-                rr->mFeedlag[part] += static_cast<unsigned>(mInbuf->datalen() ? (((mInbuf->datalen() / static_cast<unsigned>(reqTime)) * 1000) / 1024) : 0); // KB/s
+                if (mInbuf->datalen())
+                {
+                    mThroughput.addSample(static_cast<m_off_t>(mInbuf->datalen()), reqTime);
+                }
                 rr->resumeall(part);
             }
 
@@ -690,6 +778,7 @@ RaidReq::RaidReq(const Params& p, RaidReqPool& rrp, const std::shared_ptr<CloudR
     for(auto& httpReq : mHttpReqs)
     {
         httpReq = std::make_shared<HttpReqType>();
+        httpReq->bwclass = p.bwclass;
     }
     calculateNumLinesAndBufferSizes();
     mData.reset(new byte[mDataSize]);
@@ -731,10 +820,10 @@ RaidReq::~RaidReq()
 {
     LOG_verbose << "[RaidReq::~RaidReq] DESTRUCTOR [this = " << this << "]";
 
-    // Use feedlag to set next unused source
+    // Use the throughput of the parts to set next unused source
     uint8_t slowest, fastest;
     if (!mFaultysourceadded &&
-        getSlowestAndFastestParts(slowest, fastest, false /* no need for the parts to be connected, just have feedlag */) &&
+        getSlowestAndFastestParts(slowest, fastest, false /* no need for the parts to be connected, just have throughput samples */) &&
         differenceBetweenPartsSpeedIsSignificant(fastest, slowest))
     {
         LOG_verbose << "[RaidReq::~RaidReq] Detected slowest part for this RaidReq: " << (int)slowest << ". There's no sources with errors reported, so we will use this one as the unused connection for next RaidReq" << " [this = " << this << "]";
@@ -923,7 +1012,7 @@ void RaidReq::watchdog()
 
 bool RaidReq::differenceBetweenPartsSpeedIsSignificant(uint8_t part1, uint8_t part2) const
 {
-    return mFeedlag[part1] * 4 > mFeedlag[part2] * 5;
+    return mFetcher[part1].mThroughput.bytesPerMs() * 4 > mFetcher[part2].mThroughput.bytesPerMs() * 5;
 }
 
 bool RaidReq::getSlowestAndFastestParts(uint8_t& slowest, uint8_t& fastest, bool mustBeConnected) const
@@ -933,7 +1022,7 @@ bool RaidReq::getSlowestAndFastestParts(uint8_t& slowest, uint8_t& fastest, bool
 
     uint8_t i = RAIDPARTS;
     while (i-- > 0 &&
-        ((mustBeConnected && !mFetcher[slowest].mConnected) || !mFeedlag[slowest]))
+        ((mustBeConnected && !mFetcher[slowest].mConnected) || !mFetcher[slowest].mThroughput.samples()))
     {
         slowest++;
         fastest++;
@@ -945,11 +1034,11 @@ bool RaidReq::getSlowestAndFastestParts(uint8_t& slowest, uint8_t& fastest, bool
     for (i = RAIDPARTS; --i; )
     {
         if ((mFetcher[i].mConnected || !mustBeConnected) &&
-            mFeedlag[i])
+            mFetcher[i].mThroughput.samples())
         {
-            if (mFeedlag[i] < mFeedlag[slowest])
+            if (mFetcher[i].mThroughput.bytesPerMs() < mFetcher[slowest].mThroughput.bytesPerMs())
                 slowest = i;
-            else if (mFeedlag[i] > mFeedlag[fastest])
+            else if (mFetcher[i].mThroughput.bytesPerMs() > mFetcher[fastest].mThroughput.bytesPerMs())
                 fastest = i;
         }
     }
@@ -1056,7 +1145,22 @@ void RaidReq::procdata(uint8_t part, byte* ptr, m_off_t pos, m_off_t len)
     }
 
     // merge new consecutive completed RAID lines so they are ready to be sent, direct from the data[] array
+    // runs of lines missing the same data part are recovered from parity at once
     auto old_completed = mCompleted;
+    m_off_t runStart = mCompleted;
+    int runIndex = -1;
+    auto recoverRun = [this, &runStart, &runIndex]()
+    {
+        if (runIndex > 0 && mCompleted > runStart)
+        {
+            RaidBufferManager::recoverRaidLines(mData.get() + (RAIDLINE * runStart),
+                                                mParity.get() + (RAIDSECTOR * runStart),
+                                                static_cast<unsigned>(runIndex),
+                                                static_cast<size_t>(mCompleted - runStart));
+        }
+        runStart = mCompleted;
+    };
+
     for (; mCompleted < until; mCompleted++)
     {
         unsigned char mask = mInvalid[mCompleted];
@@ -1068,50 +1172,42 @@ void RaidReq::procdata(uint8_t part, byte* ptr, m_off_t pos, m_off_t len)
         {
             break;
         }
-        else
-        {
-            if (!(mask & 1))
-            {
-                // parity involved in this line
 
-                int index = -1;
+        // parity involved in this line if a data part is missing
+        int index = -1;
+        if (!(mask & 1))
+        {
 #ifdef _MSC_VER
-                unsigned long bitIndex;
-                if (_BitScanForward(&bitIndex, mask))
-                {
-                    index = static_cast<int>(bitIndex);
-                }
+            unsigned long bitIndex;
+            if (_BitScanForward(&bitIndex, mask))
+            {
+                index = static_cast<int>(bitIndex);
+            }
 #else
-                // __GNUC__ is defined for both GCC and Clang
+            // __GNUC__ is defined for both GCC and Clang
 #if defined(__GNUC__)
-                index = __builtin_ctz(mask); // counts least significant consecutive 0 bits (ie 0-based index of least significant 1 bit).  Windows equivalent is _bitScanForward
+            index = __builtin_ctz(mask); // counts least significant consecutive 0 bits (ie 0-based index of least significant 1 bit).  Windows equivalent is _bitScanForward
 #else
-                // Fallback to a loop for other compilers
-                for (uint8_t i = 0; i < RAIDLINE; ++i)
+            // Fallback to a loop for other compilers
+            for (uint8_t i = 0; i < RAIDLINE; ++i)
+            {
+                if (mask & (1 << i))
                 {
-                    if (mask & (1 << i))
-                    {
-                        index = i;
-                        break;
-                    }
+                    index = i;
+                    break;
                 }
+            }
 #endif
 #endif
-                if (index != -1) // index > 0 && index < RAIDLINE
-                {
-                    auto sectors = reinterpret_cast<raidsector_t*>(mData.get() + (RAIDLINE * mCompleted));
-                    raidsector_t& target = sectors[index - 1];
-
-                    target = reinterpret_cast<raidsector_t*>(mParity.get())[mCompleted];
-                    if (!(mask & (1 << 1))) target ^= sectors[0]; // this method requires source and target are both aligned to their size
-                    if (!(mask & (1 << 2))) target ^= sectors[1];
-                    if (!(mask & (1 << 3))) target ^= sectors[2];
-                    if (!(mask & (1 << 4))) target ^= sectors[3];
-                    if (!(mask & (1 << 5))) target ^= sectors[4];
-                }
-            }
+        }
+
+        if (index != runIndex)
+        {
+            recoverRun();
+            runIndex = index;
         }
     }
+    recoverRun();
 
     if (mCompleted > old_completed)
     {
@@ -1262,8 +1358,27 @@ uint8_t RaidReq::processFeedLag()
             return RAIDPARTS;
         }
 
+        // switch before the slowest part falls behind if the part predicted to finish last would be finished
+        // sooner by the idle one, given the throughput and latency of the connections
+        std::array<const PartThroughput*, RAIDPARTS> models{};
+        std::array<m_off_t, RAIDPARTS> rem{};
+        for (uint8_t i = RAIDPARTS; i--; )
+        {
+            if (mFetcher[i].mConnected && !mFetcher[i].mFinished)
+            {
+                models[i] = &mFetcher[i].mThroughput;
+                rem[i] = mFetcher[i].mRem;
+            }
+        }
+        uint8_t predicted = predictLaggingPart(models, rem);
+        if (predicted != RAIDPARTS && predicted != slowest)
+        {
+            LOG_verbose << "Part " << (int)predicted << " is predicted to finish last (slowest part: " << (int)slowest << ")" << " [this = " << this << "]";
+            slowest = predicted;
+        }
+
         if (!mMissingSource && mFetcher[slowest].mConnected && !mFetcher[slowest].mFinished && mHttpReqs[slowest]->status != REQ_SUCCESS &&
-            ((mFetcher[slowest].mRem - mFetcher[fastest].mRem) > ((SECTORSPERPART(mNumLines) * LAGINTERVAL * 3) / 4) || differenceBetweenPartsSpeedIsSignificant(fastest, slowest)))
+            (predicted == slowest || (mFetcher[slowest].mRem - mFetcher[fastest].mRem) > ((SECTORSPERPART(mNumLines) * LAGINTERVAL * 3) / 4) || differenceBetweenPartsSpeedIsSignificant(fastest, slowest)))
         {
             // slow channel detected
             {
@@ -1281,6 +1396,7 @@ uint8_t RaidReq::processFeedLag()
                     LOG_verbose << "New fresh channel: " << (int)fresh << " (" << (void*)mHttpReqs[fresh].get() << ")" << " [this = " << this << "]";
                     setNewUnusedRaidConnection(slowest);
                     mFetcher[slowest].closesocket();
+                    mFetcher[slowest].mThroughput.reset();
                     mFetcher[fresh].resume(true);
                     laggedPart = slowest;
                 }
@@ -1288,10 +1404,6 @@ uint8_t RaidReq::processFeedLag()
             }
         }
 
-        if (laggedPart != RAIDPARTS)
-        {
-            std::fill(mFeedlag.begin(), mFeedlag.end(), 0);
-        }
         mLagrounds = 0;
     }
     return laggedPart;
@@ -31,6 +31,11 @@ bool Request::isFetchNodes() const
     return cmds.size() == 1 && dynamic_cast<CommandFetchNodes*>(cmds.back().get());
 }
 
+bool Request::isStreaming() const
+{
+    return cmds.size() == 1 && cmds.back()->mStreaming;
+}
+
 void Request::add(Command* c)
 {
     // Once this becomes the in-progress request, it must not have anything added
@@ -165,8 +170,8 @@ m_off_t Request::processChunk(const char* chunk, MegaClient *client)
         return 0;
     }
 
-    // Only fetchnodes command is currently supported
-    assert(isFetchNodes());
+    // Only single-command requests with streaming filters are supported
+    assert(isFetchNodes() || isStreaming());
 
     m_off_t consumed = 0;
     Command& cmd = *cmds[0];
@@ -419,7 +424,9 @@ void RequestDispatcher::add(Command *c)
         LOG_debug << "Starting an additional Request due to MAX_COMMANDS";
         nextreqs.push_back(Request());
     }
-    if (c->batchSeparately && !nextreqs.back().empty())
+    // streaming processing requires the command to be alone in its Request
+    bool separately = c->batchSeparately || c->mStreaming;
+    if (separately && !nextreqs.back().empty())
     {
         LOG_debug << "Starting an additional Request for a batch-separately command";
         nextreqs.push_back(Request());
@@ -436,7 +443,7 @@ void RequestDispatcher::add(Command *c)
     }
 
     nextreqs.back().add(c);
-    if (c->batchSeparately)
+    if (separately)
     {
         nextreqs.push_back(Request());
     }
@@ -467,7 +474,7 @@ Command* RequestDispatcher::getCurrentCommand(bool currSeqtagSeen)
     return currSeqtagSeen ? inflightreq.getCurrentCommand() : nullptr;
 }
 
-string RequestDispatcher::serverrequest(bool &includesFetchingNodes, bool& v3, MegaClient* client, string& idempotenceId)
+string RequestDispatcher::serverrequest(bool &includesFetchingNodes, bool& streaming, bool& v3, MegaClient* client, string& idempotenceId)
 {
     if (!inflightreq.empty() && inflightFailReason != RETRY_NONE)
     {
@@ -487,6 +494,7 @@ string RequestDispatcher::serverrequest(bool &includesFetchingNodes, bool& v3, M
     }
     string requestJSON = inflightreq.get(client, reqid, idempotenceId);
     includesFetchingNodes = inflightreq.isFetchNodes();
+    streaming = inflightreq.isStreaming();
     v3 = inflightreq.mV3;
 #ifdef MEGA_MEASURE_CODE
     csRequestsSent += inflightreq.size();
@@ -513,6 +521,7 @@ void RequestDispatcher::inflightFailure(retryreason_t reason)
 void RequestDispatcher::serverresponse(std::string&& movestring, MegaClient *client)
 {
     CodeCounter::ScopeTimer ccst(client->performanceStats.csResponseProcessingTime);
+    TRACE_SPAN("cs batch response processing");
 
 #ifdef MEGA_MEASURE_CODE
     csBatchesReceived += 1;
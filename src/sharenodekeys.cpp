@@ -60,27 +60,17 @@ void ShareNodeKeys::add(std::shared_ptr<Node> n, std::shared_ptr<Node> sn, bool
 }
 
 // add a nodecore (!sn: all relevant shares, otherwise starting from sn, fixed: only sn)
+// (the keys are encrypted later, in get())
 void ShareNodeKeys::add(const string& nodekey, handle nodehandle, std::shared_ptr<Node> sn, bool includeParentChain, const byte* item, int itemlen)
 {
-    char buf[96];
-    char* ptr;
-    byte key[FILENODEKEYLENGTH];
-
     int addnode = 0;
 
     // emit all share nodekeys for known shares
     do {
         if (sn->sharekey)
         {
-            snprintf(buf, sizeof(buf), ",%d,%d,\"", addshare(sn), (int)items.size());
-
-            sn->sharekey->ecb_encrypt((byte*)nodekey.data(), key, nodekey.size());
-
-            ptr = strchr(buf + 5, 0);
-            ptr += Base64::btoa(key, int(nodekey.size()), ptr);
-            *ptr++ = '"';
-
-            keys.append(buf, ptr - buf);
+            keys.push_back({ addshare(sn), (int)items.size(), nodekeys.size(), nodekey.size() });
+            nodekeys.append(nodekey);
             addnode = 1;
         }
     } while (includeParentChain && (sn = sn->parent));
@@ -104,6 +94,46 @@ void ShareNodeKeys::get(Command* c, bool skiphandles)
 {
     if (keys.size())
     {
+        // the node keys of each share are encrypted in one go (ECB encrypts each block on its own),
+        // instead of one call per key: folders of many nodes have as many keys
+        string encrypted(nodekeys.size(), '\0');
+        string batch;
+        for (int i = 0; i < static_cast<int>(shares.size()); i++)
+        {
+            batch.clear();
+            for (const Key& key : keys)
+            {
+                if (key.share == i)
+                {
+                    batch.append(nodekeys, key.pos, key.len);
+                }
+            }
+
+            assert(shares[i]->sharekey);
+            shares[i]->sharekey->ecb_encrypt((byte*)batch.data(), nullptr, batch.size());
+
+            size_t offset = 0;
+            for (const Key& key : keys)
+            {
+                if (key.share == i)
+                {
+                    memcpy(&encrypted[key.pos], batch.data() + offset, key.len);
+                    offset += key.len;
+                }
+            }
+        }
+
+        string linkage;
+        linkage.reserve(keys.size() * 64);
+        char buf[96];
+        for (const Key& key : keys)
+        {
+            char* ptr = buf + snprintf(buf, sizeof(buf), ",%d,%d,\"", key.share, key.item);
+            ptr += Base64::btoa((const byte*)&encrypted[key.pos], int(key.len), ptr);
+            *ptr++ = '"';
+            linkage.append(buf, ptr - buf);
+        }
+
         c->beginarray("cr");
 
         // emit share node handles
@@ -130,7 +160,7 @@ void ShareNodeKeys::get(Command* c, bool skiphandles)
 
         // emit linkage/keys
         c->beginarray();
-        c->appendraw(keys.c_str() + 1, int(keys.size() - 1));
+        c->appendraw(linkage.c_str() + 1, int(linkage.size() - 1));
         c->endarray();
 
         c->endarray();
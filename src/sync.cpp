@@ -40,6 +40,10 @@ const int Sync::EXTRA_SCANNING_DELAY_DS = 150;
 const int Sync::FILE_UPDATE_DELAY_DS = 30;
 const int Sync::FILE_UPDATE_MAX_DELAY_SECS = 60;
 const dstime Sync::RECENT_VERSION_INTERVAL_SECS = 10800;
+const dstime Sync::NOTIFIER_RESUME_POINT_SAVE_INTERVAL_DS = 600;
+const unsigned Sync::RECURSION_SLICE_MS = 500;
+const size_t Sync::STATECACHE_BATCH_NODES = 20000;
+const unsigned Sync::STATECACHE_FLUSH_INTERVAL_MS = 5000;
 
 const unsigned Sync::MAX_CLOUD_DEPTH = 64;
 
@@ -48,6 +52,8 @@ const std::chrono::milliseconds Syncs::MAX_DELAY_BETWEEN_SYNC_STALLS_OR_CONFLICT
 const std::chrono::milliseconds Syncs::MIN_DELAY_BETWEEN_SYNC_VERBOSE_TIMED{20000}; // 20 secs
 const std::chrono::milliseconds Syncs::TIME_WINDOW_FOR_SYNC_VERBOSE_TIMED{1000}; // 1 sec
 
+const std::chrono::milliseconds SyncPathStates::PUBLISH_INTERVAL{200};
+
 #define SYNC_verbose if (syncs.mDetailedSyncLogging) LOG_verbose
 #define SYNC_verbose_timed if (syncs.mDetailedSyncLogging) SYNCS_verbose_timed
 #define SYNCS_verbose_timed LOG_verbose_timed(Syncs::MIN_DELAY_BETWEEN_SYNC_VERBOSE_TIMED, Syncs::TIME_WINDOW_FOR_SYNC_VERBOSE_TIMED)
@@ -641,7 +647,10 @@ Sync::Sync(UnifiedSync& us, const string& cdebris,
     if (us.mConfig.mChangeDetectionMethod == CDM_NOTIFICATIONS)
     {
         // Notifications may be queueing from this moment
-        dirnotify.reset(syncs.fsaccess->newdirnotify(*localroot, mLocalPath, syncs.waiter.get()));
+        dirnotify.reset(syncs.fsaccess->newdirnotify(*localroot,
+                                                     mLocalPath,
+                                                     syncs.waiter.get(),
+                                                     us.mConfig.mNotifierResumePoint));
     }
 
     // set specified fsfp or get from fs if none
@@ -671,6 +680,9 @@ Sync::Sync(UnifiedSync& us, const string& cdebris,
     fsstableids = syncs.fsaccess->fsStableIDs(mLocalPath);
     LOG_info << "Filesystem IDs are stable: " << fsstableids;
 
+    // the legacy fingerprint changes when the filesystem is remounted, unlike the UUID
+    mScanSignatureTag = static_cast<uint32_t>(fsfp.fingerprint() ^ (fsfp.fingerprint() >> 32)) | 1;
+
     if (!fsstableids)
     {
 #ifdef __APPLE__
@@ -735,6 +747,12 @@ Sync::Sync(UnifiedSync& us, const string& cdebris,
         // Did the call above create the database?
         us.mConfig.mDatabaseExists |= !!statecachetable;
 
+        // keep the WAL checkpoints of the batched commits out of the sync thread
+        if (statecachetable)
+        {
+            statecachetable->setBackgroundCheckpoints(true);
+        }
+
         // Don't bother trying to read the cache if we couldn't open the database.
         if (us.mConfig.mDatabaseExists)
         {
@@ -761,9 +779,21 @@ Sync::~Sync()
     // unlock tmp lock
     tmpfa.reset();
 
+    // write the changes not flushed yet
+    if (statecachetable)
+    {
+        cachenodes();
+    }
+
     // Deleting localnodes after this will not remove them from the db.
     statecachetable.reset();
 
+    // The LocalNodes don't remove their states while the destructor runs
+    if (localroot)
+    {
+        syncs.mSyncPathStates.remove(localroot->localname, true);
+    }
+
     // This will recursively delete all LocalNodes in the sync.
     // If they have transfers associated, the SyncUpload_inClient and SyncDownload_inClient will have their wasRequesterAbandoned flag set true
     localroot.reset();
@@ -815,6 +845,24 @@ const fsfp_t& Sync::fsfp() const
     return getConfig().mFilesystemFingerprint;
 }
 
+bool Sync::allGeneralScanSlotsBusy() const
+{
+    return std::all_of(mActiveScanRequestsGeneral.begin(), mActiveScanRequestsGeneral.end(),
+                       [](const std::shared_ptr<ScanService::ScanRequest>& request)
+                       {
+                           return request && !request->completed();
+                       });
+}
+
+bool Sync::noGeneralScanRequests() const
+{
+    return std::none_of(mActiveScanRequestsGeneral.begin(), mActiveScanRequestsGeneral.end(),
+                        [](const std::shared_ptr<ScanService::ScanRequest>& request)
+                        {
+                            return !!request;
+                        });
+}
+
 void Sync::addstatecachechildren(uint32_t parent_dbid, idlocalnode_map* tmap, LocalPath& localpath, LocalNode *p, int maxdepth)
 {
     assert(syncs.onSyncThread());
@@ -953,9 +1001,9 @@ void Sync::statecachedel(LocalNode* l)
         return;
     }
 
-    if (l->dbid && statecachetable)
+    if (l->dbid)
     {
-        statecachetable->del(l->dbid);
+        deleteq.push_back(l->dbid);
     }
     l->dbid = 0;
 
@@ -992,15 +1040,35 @@ void Sync::cachenodes()
     if (!statecachetable)
     {
         insertq.clear();
+        deleteq.clear();
         return;
     }
 
+    mLastStatecacheFlush = std::chrono::steady_clock::now();
+
+    if (insertq.empty() && deleteq.empty())
+    {
+        return;
+    }
+
+    // removals and additions are committed together, so the db holds a consistent tree after a crash
+    DBTableTransactionCommitter committer(statecachetable);
+
+    if (deleteq.size())
+    {
+        LOG_debug << syncname << "Saving LocalNode database with " << deleteq.size() << " removals";
+
+        for (uint32_t dbid : deleteq)
+        {
+            statecachetable->del(dbid);
+        }
+        deleteq.clear();
+    }
+
     if (insertq.size())
     {
         LOG_debug << syncname << "Saving LocalNode database with " << insertq.size() << " additions";
 
-        DBTableTransactionCommitter committer(statecachetable);
-
         // additions - we iterate until completion or until we get stuck
         bool added;
 
@@ -1032,6 +1100,23 @@ void Sync::cachenodes()
     }
 }
 
+bool Sync::statecacheFlushDue() const
+{
+    if (insertq.empty() && deleteq.empty())
+    {
+        return false;
+    }
+
+    if (insertq.size() + deleteq.size() >= STATECACHE_BATCH_NODES ||
+        std::chrono::steady_clock::now() - mLastStatecacheFlush >= std::chrono::milliseconds(STATECACHE_FLUSH_INTERVAL_MS))
+    {
+        return true;
+    }
+
+    // nothing else pending, don't leave the last changes unwritten
+    return !localroot->scanRequired() && !localroot->mightHaveMoves() && !localroot->syncRequired();
+}
+
 void Sync::changestate(SyncError newSyncError, bool newEnableFlag, bool notifyApp, bool keepSyncDb)
 {
     mUnifiedSync.changeState(newSyncError, newEnableFlag, notifyApp, keepSyncDb);
@@ -1152,9 +1237,18 @@ LocalNode* Sync::localnodebypath(LocalNode* l, const LocalPath& localpath, Local
             *parent = l;
         }
 
-        localnode_map::iterator it;
-        if ((it = l->children.find(component)) == l->children.end()
-            && (it = l->schildren.find(component)) == l->schildren.end())
+        LocalNode* child = nullptr;
+        auto it = l->children.find(component);
+        if (it != l->children.end())
+        {
+            child = it->second;
+        }
+        else
+        {
+            child = l->childByShortname(component);
+        }
+
+        if (!child)
         {
             // no full match: store residual path, return NULL with the
             // matching component LocalNode in parent
@@ -1171,7 +1265,7 @@ LocalNode* Sync::localnodebypath(LocalNode* l, const LocalPath& localpath, Local
             return NULL;
         }
 
-        l = it->second;
+        l = child;
     }
 
     // full match: no residual path, return corresponding LocalNode
@@ -1396,16 +1490,27 @@ bool SyncStallInfo::empty() const
 bool SyncStallInfo::waitingCloud(handle backupId, const string& mapKeyPath, SyncStallEntry&& e)
 {
     auto& syncStallInfoMap = syncStallInfoMaps[backupId];
-    for (auto i = syncStallInfoMap.cloud.begin(); i != syncStallInfoMap.cloud.end(); )
+    auto& cloud = syncStallInfoMap.cloud;
+
+    // No need to add a new entry as we've already reported some parent.
+    // The entries that could contain this path are the path itself and its prefixes ending before a separator.
+    for (size_t i = mapKeyPath.size() + 1; i--; )
     {
-        // No need to add a new entry as we've already reported some parent.
-        if (IsContainingCloudPathOf(i->first, mapKeyPath) && e.reason == i->second.reason)
+        if (i < mapKeyPath.size() && mapKeyPath[i] != '/') continue;
+
+        auto j = cloud.find(mapKeyPath.substr(0, i));
+        if (j != cloud.end() && e.reason == j->second.reason)
             return false;
+    }
 
-        // Remove entries that are below cloudPath1.
+    // Remove entries that are below cloudPath1.
+    // They follow the path in the map, as they all start with it.
+    for (auto i = cloud.upper_bound(mapKeyPath);
+         i != cloud.end() && !i->first.compare(0, mapKeyPath.size(), mapKeyPath); )
+    {
         if (IsContainingCloudPathOf(mapKeyPath, i->first) && e.reason == i->second.reason)
         {
-            i = syncStallInfoMap.cloud.erase(i);
+            i = cloud.erase(i);
             continue;
         }
 
@@ -1414,28 +1519,176 @@ bool SyncStallInfo::waitingCloud(handle backupId, const string& mapKeyPath, Sync
     }
 
     // Add a new entry.
-    syncStallInfoMap.cloud.emplace(mapKeyPath, move(e));
+    cloud.emplace(mapKeyPath, move(e));
     return true;
 }
 
 bool SyncStallInfo::waitingLocal(handle backupId, const LocalPath& mapKeyPath, SyncStallEntry&& e)
 {
     auto& syncStallInfoMap = syncStallInfoMaps[backupId];
-    for (auto i = syncStallInfoMap.local.begin(); i != syncStallInfoMap.local.end(); )
+    auto& local = syncStallInfoMap.local;
+
+#ifdef _WIN32
+    // Paths are compared case-insensitively, so the containing entries are not found by their key.
+    for (auto i = local.begin(); i != local.end(); )
     {
         if (i->first.isContainingPathOf(mapKeyPath) && e.reason == i->second.reason)
             return false;
 
         if (mapKeyPath.isContainingPathOf(i->first) && e.reason == i->second.reason)
         {
-            i = syncStallInfoMap.local.erase(i);
+            i = local.erase(i);
             continue;
         }
 
         ++i;
     }
+#else
+    // Same as for the cloud: look up the path and its prefixes, with and without the separator.
+    const auto& raw = mapKeyPath.rawValue();
+    auto j = local.find(mapKeyPath);
+    if (j != local.end() && e.reason == j->second.reason)
+        return false;
+
+    for (size_t i = 0; i < raw.size(); ++i)
+    {
+        if (raw[i] != LocalPath::localPathSeparator) continue;
 
-    syncStallInfoMap.local.emplace(mapKeyPath, move(e));
+        for (size_t length : { i, i + 1 })
+        {
+            if (!length || length == raw.size()) continue;
+
+            j = local.find(mapKeyPath.subpathTo(length));
+            if (j != local.end() && e.reason == j->second.reason)
+                return false;
+        }
+    }
+
+    for (auto i = local.upper_bound(mapKeyPath);
+         i != local.end() && !i->first.rawValue().compare(0, raw.size(), raw); )
+    {
+        if (mapKeyPath.isContainingPathOf(i->first) && e.reason == i->second.reason)
+        {
+            i = local.erase(i);
+            continue;
+        }
+
+        ++i;
+    }
+#endif
+
+    local.emplace(mapKeyPath, move(e));
+    return true;
+}
+
+std::pair<LocalPath::string_type, LocalPath::string_type> SyncPathStates::split(const LocalPath& path)
+{
+    const auto& raw = path.rawValue();
+    auto i = raw.find_last_of(LocalPath::localPathSeparator);
+    if (i == LocalPath::string_type::npos)
+    {
+        return std::make_pair(LocalPath::string_type(), raw);
+    }
+    return std::make_pair(raw.substr(0, i + 1), raw.substr(i + 1));
+}
+
+void SyncPathStates::update(const LocalPath& path, treestate_t ts)
+{
+    auto parts = split(path);
+    auto& folder = mCurrent[parts.first];
+
+    // copy the folder before its first change since the last snapshot
+    if (mCopied.insert(parts.first).second)
+    {
+        folder = folder ? std::make_shared<Folder>(*folder) : std::make_shared<Folder>();
+    }
+
+    (*folder)[parts.second] = ts;
+    mChanged = true;
+}
+
+void SyncPathStates::remove(const LocalPath& path, bool withDescendants)
+{
+    auto parts = split(path);
+    auto i = mCurrent.find(parts.first);
+    if (i != mCurrent.end() && i->second->count(parts.second))
+    {
+        if (mCopied.insert(parts.first).second)
+        {
+            i->second = std::make_shared<Folder>(*i->second);
+        }
+
+        i->second->erase(parts.second);
+        if (i->second->empty())
+        {
+            mCopied.erase(i->first);
+            mCurrent.erase(i);
+        }
+        mChanged = true;
+    }
+
+    if (withDescendants)
+    {
+        // the folders below the path are the ones starting with it, and follow it in the map
+        auto prefix = path.rawValue();
+        if (prefix.empty() || prefix.back() != LocalPath::localPathSeparator)
+        {
+            prefix.push_back(LocalPath::localPathSeparator);
+        }
+
+        for (i = mCurrent.lower_bound(prefix);
+             i != mCurrent.end() && !i->first.compare(0, prefix.size(), prefix); )
+        {
+            mCopied.erase(i->first);
+            i = mCurrent.erase(i);
+            mChanged = true;
+        }
+    }
+}
+
+void SyncPathStates::publish()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (!mChanged || now - mLastPublished < PUBLISH_INTERVAL)
+    {
+        return;
+    }
+
+    auto snapshot = std::make_shared<Snapshot>();
+    for (auto& folder : mCurrent)
+    {
+        snapshot->emplace_hint(snapshot->end(), folder.first, folder.second);
+    }
+
+    std::atomic_store(&mPublished, shared_ptr<const Snapshot>(std::move(snapshot)));
+
+    mCopied.clear();
+    mChanged = false;
+    mLastPublished = now;
+}
+
+bool SyncPathStates::lookup(const LocalPath& path, treestate_t& ts) const
+{
+    auto snapshot = std::atomic_load(&mPublished);
+    if (!snapshot)
+    {
+        return false;
+    }
+
+    auto parts = split(path);
+    auto folder = snapshot->find(parts.first);
+    if (folder == snapshot->end())
+    {
+        return false;
+    }
+
+    auto i = folder->second->find(parts.second);
+    if (i == folder->second->end())
+    {
+        return false;
+    }
+
+    ts = i->second;
     return true;
 }
 
@@ -2684,6 +2937,37 @@ bool Sync::scanningWasComplete() const
     return mScanningWasComplete;
 }
 
+void Sync::saveNotifierResumePoint()
+{
+    if (!dirnotify)
+        return;
+
+    // Read before checking the queue: the notifier publishes it after queueing the events.
+    auto point = dirnotify->resumePoint();
+
+    auto& config = mUnifiedSync.mConfig;
+
+    if (!point.mEventID || point == config.mNotifierResumePoint)
+        return;
+
+    // Have all the changes up to this point been synced?
+    if (!dirnotify->empty()
+        || localroot->scanRequired()
+        || localroot->mightHaveMoves()
+        || localroot->syncRequired())
+        return;
+
+    // Resuming from an older point only replays more events, so there's no rush.
+    if (config.mNotifierResumePoint.mEventID
+        && syncs.waiter->ds < mNotifierResumePointSavedDs + NOTIFIER_RESUME_POINT_SAVE_INTERVAL_DS)
+        return;
+
+    config.mNotifierResumePoint = std::move(point);
+    mNotifierResumePointSavedDs = syncs.waiter->ds;
+
+    syncs.saveSyncConfig(config);
+}
+
 bool Sync::checkMovesWereComplete()
 {
     mMovesWereComplete = true;
@@ -6392,6 +6676,7 @@ void Syncs::locallogout_inThread(bool removecaches, bool keepSyncsConfigFile, bo
             if (sync->statecachetable)
             {
                 if (removecaches) sync->statecachetable->remove();
+                else sync->cachenodes();
                 sync->statecachetable.reset();
             }
         }
@@ -7241,6 +7526,73 @@ bool Sync::inferRegeneratableTriplets(vector<CloudNode>& cloudChildren, const Lo
     return true;
 }
 
+bool Sync::inferFlaggedChildTriplets(const SyncRow& row, vector<CloudNode>& cloudNodes, vector<FSNode>& fsNodes, vector<SyncRow>& inferredRows) const
+{
+    assert(syncs.onSyncThread());
+    assert(row.cloudNode && row.syncNode);
+
+    CodeCounter::ScopeTimer rst(syncs.mClient.performanceStats.inferSyncTripletsTime);
+
+    auto& syncParent = *row.syncNode;
+
+    const LocalPath& ignoreFileName = IGNORE_FILE_NAME;
+
+    auto needed = [&ignoreFileName](const LocalNode& child) {
+        if (child.type > FILENODE)
+            return child.scanRequired() || child.mightHaveMoves() || child.syncRequired();
+
+        return child.type == FILENODE
+               && !platformCompareUtf(child.localname, true, ignoreFileName, false);
+    };
+
+    size_t count = 0;
+
+    for (auto& child : syncParent.children)
+        count += needed(*child.second);
+
+    // the rows point into these, so they must not reallocate
+    cloudNodes.reserve(count);
+    fsNodes.reserve(count);
+    inferredRows.reserve(count);
+
+    auto fail = [&]() {
+        cloudNodes.clear();
+        fsNodes.clear();
+        inferredRows.clear();
+        return false;
+    };
+
+    for (auto& child : syncParent.children)
+    {
+        auto& node = *child.second;
+
+        if (!needed(node)) continue;
+
+        if (node.fsid_asScanned == UNDEF ||
+           (!node.scannedFingerprint.isvalid && node.type == FILENODE))
+        {
+            // we haven't scanned yet, or the scans don't match up with LocalNodes yet
+            return fail();
+        }
+
+        CloudNode cloudNode;
+
+        if (!syncs.lookupCloudNode(node.syncedCloudNodeHandle, cloudNode, nullptr, nullptr, nullptr, nullptr, nullptr, Syncs::EXACT_VERSION)
+            || cloudNode.parentHandle != row.cloudNode->handle
+            || cloudNode.parentType == FILENODE)
+        {
+            // the node tree has actually changed so we need to run the full algorithm
+            return fail();
+        }
+
+        cloudNodes.push_back(std::move(cloudNode));
+        fsNodes.push_back(node.getScannedFSDetails());
+        inferredRows.emplace_back(&cloudNodes.back(), &node, &fsNodes.back());
+    }
+
+    return true;
+}
+
 using IndexPair = pair<size_t, size_t>;
 using IndexPairVector = vector<IndexPair>;
 
@@ -7425,12 +7777,36 @@ bool Sync::recursiveSync(SyncRow& row, SyncPath& fullPath, bool belowRemovedClou
         vector<FSNode> fsChildren;
         vector<CloudNode> cloudChildren;
 
-        if (row.cloudNode)
+        // If this folder is only visited for the sake of its descendants, there is nothing to do
+        // for its other children: skip building (and looking at) rows for them.
+        bool flaggedChildrenOnly = wasSynced
+                                   && recurseHere
+                                   && !belowRemovedCloudNode
+                                   && !belowRemovedFsNode
+                                   && row.cloudNode
+                                   && !row.syncNode->lastFolderScan
+                                   && row.syncNode->scanAgain < TREE_ACTION_HERE
+                                   && inferFlaggedChildTriplets(row, cloudChildren, fsInferredChildren, childRows);
+
+        if (flaggedChildrenOnly)
         {
-            syncs.lookupCloudChildren(row.cloudNode->handle, cloudChildren);
+            assert(!syncHere);
+
+            syncs.mSyncFlags->rowsSkippedThisPass += row.syncNode->children.size() - childRows.size();
+            syncs.mClient.performanceStats.syncRowsSkipped += row.syncNode->children.size() - childRows.size();
+        }
+        else
+        {
+            if (row.cloudNode)
+            {
+                syncs.lookupCloudChildren(row.cloudNode->handle, cloudChildren);
+            }
+
+            row.inferOrCalculateChildSyncRows(wasSynced, childRows, fsInferredChildren, fsChildren, cloudChildren, belowRemovedFsNode, syncs.localnodeByScannedFsid);
         }
 
-        row.inferOrCalculateChildSyncRows(wasSynced, childRows, fsInferredChildren, fsChildren, cloudChildren, belowRemovedFsNode, syncs.localnodeByScannedFsid);
+        syncs.mSyncFlags->rowsVisitedThisPass += childRows.size();
+        syncs.mClient.performanceStats.syncRowsVisited += childRows.size();
 
         bool anyNameConflicts = false;
 
@@ -7534,7 +7910,7 @@ bool Sync::recursiveSync(SyncRow& row, SyncPath& fullPath, bool belowRemovedClou
                     // in case of sync failing while we recurse
                     if (getConfig().mError) return false;
 
-                    if (syncs.mSyncFlags->earlyRecurseExitRequested)
+                    if (recursionMustExit())
                     {
                         // restore flags to at least what they were, for when we revisit on next full recurse
                         row.syncNode->scanAgain = std::max<TreeState>(row.syncNode->scanAgain, originalScanAgain);
@@ -7543,7 +7919,9 @@ bool Sync::recursiveSync(SyncRow& row, SyncPath& fullPath, bool belowRemovedClou
                         row.syncNode->conflicts = std::max<TreeState>(row.syncNode->conflicts, originalConflicsFlag);
 
                         LOG_debug << syncname
-                            << "recursiveSync early exit due to pending outside request with "
+                            << "recursiveSync early exit due to "
+                            << (syncs.mSyncFlags->earlyRecurseExitRequested ? "pending outside request" : "time slice")
+                            << " with "
                             << row.syncNode->scanAgain  << "-"
                             << row.syncNode->checkMovesAgain << "-"
                             << row.syncNode->syncAgain << " ("
@@ -7768,10 +8146,11 @@ bool Sync::recursiveSync(SyncRow& row, SyncPath& fullPath, bool belowRemovedClou
             //}
         }
 
-        if (!anyNameConflicts)
+        if (!anyNameConflicts && !flaggedChildrenOnly)
         {
             // here childRows still contains pointers into lastFolderScan, fsAddedSiblings etc
-            row.syncNode->clearRegeneratableFolderScan(fullPath, childRows);
+            // (there is no scan to clear if we only looked at the flagged children)
+            row.syncNode->clearRegeneratableFolderScan(fullPath, childRows, row.fsNode);
         }
 
         // If we still don't match the known fs state, and if we added any FSNodes that
@@ -7835,6 +8214,40 @@ bool Sync::recursiveSync(SyncRow& row, SyncPath& fullPath, bool belowRemovedClou
     return !earlyExit;
 }
 
+void Sync::beginRecursionSlice()
+{
+    auto slice = std::chrono::milliseconds(RECURSION_SLICE_MS) * (1u << std::min(mRecursionSlicesExpired, 16u));
+
+    mRecursionDeadline = std::chrono::steady_clock::now() + slice;
+    mRecursionSliceExpired = false;
+}
+
+bool Sync::endRecursionSlice()
+{
+    if (!mRecursionSliceExpired)
+    {
+        mRecursionSlicesExpired = 0;
+        return false;
+    }
+
+    ++mRecursionSlicesExpired;
+
+    LOG_debug << syncname << "recursiveSync used up its time slice, resuming on the next loop (" << mRecursionSlicesExpired << " in a row)";
+
+    return true;
+}
+
+bool Sync::recursionMustExit()
+{
+    if (syncs.mSyncFlags->earlyRecurseExitRequested)
+        return true;
+
+    if (!mRecursionSliceExpired && std::chrono::steady_clock::now() >= mRecursionDeadline)
+        mRecursionSliceExpired = true;
+
+    return mRecursionSliceExpired;
+}
+
 string Sync::logTriplet(SyncRow& row, SyncPath& fullPath)
 {
     ostringstream s;
@@ -8858,7 +9271,21 @@ bool Sync::syncItem(SyncRow& row, SyncRow& parentRow, SyncPath& fullPath, PerFol
 
         // Item exists locally only. Check if it was moved/renamed here, or Create
         // If creating, next run through will upload it
-        return resolve_makeSyncNode_fromFS(row, parentRow, fullPath, false);
+        if (!isBackupAndMirroring())
+        {
+            return resolve_makeSyncNode_fromFS(row, parentRow, fullPath, false);
+        }
+
+        // Backups (ie. their initial run) upload it right away instead: the next run
+        // through would do just that (SRT_XSF), after another traversal of the whole tree
+        if (makeSyncNode_fromFS(row, parentRow, fullPath, false) &&
+            row.syncNode->type != TYPE_DONOTSYNC &&
+            !row.isLocalOnlyIgnoreFile() &&
+            !row.isNoName())
+        {
+            resolve_upsync(row, parentRow, fullPath, pflsc);
+        }
+        return false;
     }
     case SRT_CXX:
     {
@@ -9684,7 +10111,7 @@ bool Sync::resolve_upsync(SyncRow& row, SyncRow& parentRow, SyncPath& fullPath,
                     {
                         vector<NewNode> nn(1);
                         mc.putnodes_prepareOneFolder(&nn[0], foldername, canChangeVault);
-                        mc.putnodes(targethandle, NoVersioning, move(nn), nullptr, 0, canChangeVault,
+                        mc.putnodesCoalesced(targethandle, NoVersioning, move(nn), 0, PUTNODES_APP, canChangeVault,
                             [createFolderPtr](const Error& e, targettype_t, vector<NewNode>& v, bool targetOverride, int tag){
                                 if (!e && !v.empty())
                                 {
@@ -10835,11 +11262,52 @@ void Syncs::triggerSync(NodeHandle h, bool recurse)
 
     if (mClient.fetchingnodes) return;  // on start everything needs scan+sync anyway
 
+    // changes elsewhere in the account would only be looked up in vain by the sync thread
+    if (!isBelowRunningSyncRoot(h)) return;
+
     lock_guard<mutex> g(triggerMutex);
     auto& entry = triggerHandles[h];
     if (recurse) entry = true;
 }
 
+bool Syncs::isBelowRunningSyncRoot(NodeHandle h)
+{
+    assert(!onSyncThread());
+
+    auto roots = std::atomic_load(&mRunningSyncRoots);
+    if (!roots || roots->empty()) return false;
+
+    // if we don't know the node, let the sync thread work it out
+    shared_ptr<Node> n = mClient.nodeByHandle(h);
+    if (!n) return true;
+
+    for (Node* p = n.get(); p; p = p->parent.get())
+    {
+        if (roots->count(p->nodeHandle())) return true;
+    }
+    return false;
+}
+
+void Syncs::updateRunningSyncRoots()
+{
+    assert(onSyncThread());
+
+    auto roots = std::make_shared<set<NodeHandle>>();
+    for (auto& us : mSyncVec)
+    {
+        if (us->mSync)
+        {
+            roots->insert(us->mConfig.mRemoteNode);
+        }
+    }
+
+    auto current = std::atomic_load(&mRunningSyncRoots);
+    if (!current || *current != *roots)
+    {
+        std::atomic_store(&mRunningSyncRoots, shared_ptr<const set<NodeHandle>>(std::move(roots)));
+    }
+}
+
 void Syncs::processTriggerLocalpaths()
 {
     // Mark nodes to be scanned because upload transfers failed.
@@ -11706,6 +12174,8 @@ bool SyncConfigIOContext::deserialize(SyncConfig& config, JSON& reader, bool isE
     const auto TYPE_TARGET_HANDLE   = MAKENAMEID2('t', 'h');
     const auto TYPE_TARGET_PATH     = MAKENAMEID2('t', 'p');
     const auto TYPE_LEGACY_INELIGIB = MAKENAMEID2('l', 'i');
+    const auto TYPE_NOTIFIER_EVENT  = MAKENAMEID2('n', 'e');
+    const auto TYPE_NOTIFIER_JOURNAL = MAKENAMEID2('n', 'j');
 
     // Temporary storage.
     std::uint64_t fsFingerprint = 0;
@@ -11811,6 +12281,14 @@ bool SyncConfigIOContext::deserialize(SyncConfig& config, JSON& reader, bool isE
             config.mLegacyExclusionsIneligigble = reader.getbool();
             break;
 
+        case TYPE_NOTIFIER_EVENT:
+            config.mNotifierResumePoint.mEventID = reader.getuint64();
+            break;
+
+        case TYPE_NOTIFIER_JOURNAL:
+            reader.storebinary(&config.mNotifierResumePoint.mJournalID);
+            break;
+
         default:
             if (!reader.storeobject())
             {
@@ -11882,6 +12360,13 @@ void SyncConfigIOContext::serialize(const SyncConfig& config,
     writer.arg("cm", config.mChangeDetectionMethod);
     writer.arg("si", config.mScanIntervalSec);
     writer.arg("li", config.mLegacyExclusionsIneligigble);
+
+    if (config.mNotifierResumePoint.mEventID)
+    {
+        writer.arg("ne", static_cast<m_off_t>(config.mNotifierResumePoint.mEventID));
+        writer.arg_B64("nj", config.mNotifierResumePoint.mJournalID);
+    }
+
     writer.endobject();
 }
 
@@ -11937,6 +12422,7 @@ void Syncs::syncLoop()
 {
     syncThreadId = std::this_thread::get_id();
     assert(onSyncThread());
+    TRACE_THREAD_NAME("sync");
 
     std::condition_variable cv;
     std::mutex dummy_mutex;
@@ -12016,6 +12502,7 @@ void Syncs::syncLoop()
             }
         }
 
+        updateRunningSyncRoots();
         processTriggerHandles();
         processTriggerLocalpaths();
 
@@ -12189,6 +12676,9 @@ void Syncs::syncLoop()
         bool earlyExit = false;
         auto recurseStart = std::chrono::high_resolution_clock::now();
         CodeCounter::ScopeTimer rst(mClient.performanceStats.recursiveSyncTime);
+        static auto& recursiveSyncLatency = Metrics::registry().histogram("Sync_recursiveSync");
+        Metrics::ScopedLatency recursiveSyncTimer(recursiveSyncLatency);
+        TRACE_SPAN("Sync_recursiveSync");
 
         if (!lastLoopEarlyExit)
         {
@@ -12197,6 +12687,18 @@ void Syncs::syncLoop()
             mSyncFlags->scanningWasComplete = checkSyncsScanningWasComplete_inThread();
             mSyncFlags->reachableNodesAllScannedLastPass = mSyncFlags->reachableNodesAllScannedThisPass && !mSyncFlags->isInitialPass;
             mSyncFlags->reachableNodesAllScannedThisPass = true;
+
+            mSyncFlags->rowsVisitedLastPass = mSyncFlags->rowsVisitedThisPass;
+            mSyncFlags->rowsSkippedLastPass = mSyncFlags->rowsSkippedThisPass;
+            mSyncFlags->rowsVisitedThisPass = 0;
+            mSyncFlags->rowsSkippedThisPass = 0;
+            ++mClient.performanceStats.syncPasses;
+
+            if (mSyncFlags->rowsVisitedLastPass)
+            {
+                SYNCS_verbose_timed << "[SyncLoop] rows visited last pass: " << mSyncFlags->rowsVisitedLastPass
+                                    << ", skipped: " << mSyncFlags->rowsSkippedLastPass;
+            }
             auto allSyncsMovesWereComplete = checkSyncsMovesWereComplete();
             mSyncFlags->movesWereComplete = scanningWasCompletePreviously && allSyncsMovesWereComplete;
             mSyncFlags->noProgress = mSyncFlags->reachableNodesAllScannedLastPass;
@@ -12273,20 +12775,25 @@ void Syncs::syncLoop()
                 }
 
                 {
-                    bool activeIncomplete = sync->mActiveScanRequestGeneral &&
-                        !sync->mActiveScanRequestGeneral->completed();
+                    bool activeIncomplete = sync->allGeneralScanSlotsBusy();
 
                     bool unscannedIncomplete = sync->mActiveScanRequestUnscanned &&
                         !sync->mActiveScanRequestUnscanned->completed();
 
                     if ((activeIncomplete && unscannedIncomplete) ||
                         (activeIncomplete && sync->threadSafeState->neverScannedFolderCount.load() == 0) ||
-                        (unscannedIncomplete && !sync->mActiveScanRequestGeneral))
+                        (unscannedIncomplete && sync->noGeneralScanRequests()))
                     {
                         // Save CPU by not starting another recurse of the LocalNode tree
                         // if a scan is not finished yet.  Scans can take a fair while for large
                         // folders since they also extract file fingerprints if not known yet.
                         ++skippedForScanning;
+
+                        if (sync->statecacheFlushDue())
+                        {
+                            std::lock_guard<std::timed_mutex> g(mLocalNodeChangeMutex);
+                            sync->cachenodes();
+                        }
                         continue;
                     }
 
@@ -12308,12 +12815,24 @@ void Syncs::syncLoop()
 
                         DBTableTransactionCommitter committer(sync->statecachetable);
 
+                        sync->beginRecursionSlice();
+
                         if (!sync->recursiveSync(row, pathBuffer, false, false, 0))
                         {
                             earlyExit = true;
                         }
 
-                        sync->cachenodes();
+                        // Let the other syncs (and client requests) have their turn, then carry on without waiting.
+                        if (sync->endRecursionSlice())
+                        {
+                            skipWait = true;
+                        }
+
+                        // the changes of several traversals are committed at once while the sync is busy
+                        if (sync->statecacheFlushDue())
+                        {
+                            sync->cachenodes();
+                        }
                     }
 
                     if (!earlyExit)
@@ -12329,6 +12848,11 @@ void Syncs::syncLoop()
                     }
                 }
 
+                if (!earlyExit)
+                {
+                    sync->saveNotifierResumePoint();
+                }
+
                 if (!us->mConfig.mFinishedInitialScanning &&
                     !sync->localroot->scanRequired())
                 {
@@ -12353,6 +12877,9 @@ void Syncs::syncLoop()
             }
         }
 
+        // make the overlay icon states changed meanwhile visible to MegaApiImpl::syncPathState
+        mSyncPathStates.publish();
+
         if (mTransferPauseFlagsChanged.load())
         {
             mTransferPauseFlagsChanged = false;
@@ -16,6 +16,7 @@ namespace mega
 {
 
 class Matcher;
+class MatchSubject;
 class Target;
 
 // For convenience.
@@ -55,8 +56,8 @@ public:
     // it was defined?
     bool inheritable() const;
 
-    // True if this filter matches the string pair p.
-    virtual bool match(const RemotePathPair& p) const = 0;
+    // True if this filter matches the name or the path.
+    virtual bool match(const MatchSubject& name, const MatchSubject& path) const = 0;
 
     virtual string debugDescription() const = 0;
 
@@ -67,7 +68,7 @@ protected:
                  const bool inheritable);
 
     // True if this filter matches the string s.
-    bool match(const string& s) const;
+    bool match(const MatchSubject& s) const;
 
 protected:
     MatcherPtr mMatcher;
@@ -85,7 +86,7 @@ public:
                const bool inclusion,
                const bool inheritable);
 
-    bool match(const RemotePathPair& p) const override;
+    bool match(const MatchSubject& name, const MatchSubject& path) const override;
 
     string debugDescription() const override;
 }; /* NameFilter */
@@ -99,18 +100,39 @@ public:
                const bool inclusion,
                const bool inheritable);
 
-    bool match(const RemotePathPair& p) const override;
+    bool match(const MatchSubject& name, const MatchSubject& path) const override;
 
     string debugDescription() const override;
 }; /* PathFilter */
 
+// A string being matched against the filters of a chain.
+//
+// Its upper-case version is computed once, when the first
+// case-insensitive filter needs it, rather than by every filter.
+class MatchSubject
+{
+public:
+    explicit MatchSubject(const string& text);
+
+    // The string itself.
+    const string& text() const;
+
+    // The string, in upper case.
+    const string& upper() const;
+
+private:
+    const string& mText;
+    mutable string mUpper;
+    mutable bool mUpperComputed = false;
+}; /* MatchSubject */
+
 class Matcher
 {
 public:
     virtual ~Matcher() = default;
 
     // True if this matcher matches the string s.
-    virtual bool match(const string& s) const = 0;
+    virtual bool match(const MatchSubject& s) const = 0;
 
     virtual string debugDescription() const = 0;
 
@@ -125,13 +147,33 @@ public:
     GlobMatcher(const string& pattern, bool caseSensitive);
 
     // True if the wildcard pattern matches the string s.
-    bool match(const string& s) const override;
+    bool match(const MatchSubject& s) const override;
 
     string debugDescription() const override;
 
 private:
+    // Most patterns are a literal with a leading and/or trailing '*'
+    // (e.g. "*.tmp", "Thumbs.db" or "~$*"). They are matched through
+    // string comparisons, without the general wildcard matching.
+    enum Kind
+    {
+        // The literal itself.
+        GK_EXACT,
+        // Strings starting with the literal.
+        GK_PREFIX,
+        // Strings ending with the literal.
+        GK_SUFFIX,
+        // Strings containing the literal.
+        GK_CONTAINS,
+        // Any other pattern.
+        GK_WILDCARD
+    }; // Kind
+
     const string mPattern;
     const bool mCaseSensitive;
+    Kind mKind = GK_WILDCARD;
+    // The pattern without the leading and trailing '*', if not GK_WILDCARD.
+    string mLiteral;
 }; /* GlobMatcher */
 
 class RegexMatcher
@@ -141,7 +183,7 @@ public:
     RegexMatcher(const string& pattern, bool caseSensitive);
 
     // True if the regex pattern matches the string s.
-    bool match(const string& s) const override;
+    bool match(const MatchSubject& s) const override;
 
     string debugDescription() const override;
 
@@ -642,6 +684,10 @@ ExclusionState FilterChain::match(const RemotePathPair& p,
 {
     if (!mLoadSucceeded) return ES_UNKNOWN;
 
+    // Shared by all the filters.
+    MatchSubject name(p.first);
+    MatchSubject path(p.second);
+
     auto i = mStringFilters.rbegin();
     auto j = mStringFilters.rend();
 
@@ -652,7 +698,7 @@ ExclusionState FilterChain::match(const RemotePathPair& p,
             continue;
         }
 
-        if ((*i)->applicable(type) && (*i)->match(p))
+        if ((*i)->applicable(type) && (*i)->match(name, path))
         {
             return (*i)->inclusion() ? ES_INCLUDED : ES_EXCLUDED;
         }
@@ -773,7 +819,7 @@ StringFilter::StringFilter(MatcherPtr matcher,
 {
 }
 
-bool StringFilter::match(const string& s) const
+bool StringFilter::match(const MatchSubject& s) const
 {
     return mMatcher->match(s);
 }
@@ -789,9 +835,9 @@ NameFilter::NameFilter(MatcherPtr matcher,
 {
 }
 
-bool NameFilter::match(const RemotePathPair& p) const
+bool NameFilter::match(const MatchSubject& name, const MatchSubject&) const
 {
-    return StringFilter::match(p.first);
+    return StringFilter::match(name);
 }
 
 string NameFilter::debugDescription() const
@@ -813,9 +859,9 @@ PathFilter::PathFilter(MatcherPtr matcher,
 {
 }
 
-bool PathFilter::match(const RemotePathPair& p) const
+bool PathFilter::match(const MatchSubject&, const MatchSubject& path) const
 {
-    return StringFilter::match(p.second);
+    return StringFilter::match(path);
 }
 
 string PathFilter::debugDescription() const
@@ -826,20 +872,85 @@ string PathFilter::debugDescription() const
     return s;
 }
 
+MatchSubject::MatchSubject(const string& text)
+  : mText(text)
+{
+}
+
+const string& MatchSubject::text() const
+{
+    return mText;
+}
+
+const string& MatchSubject::upper() const
+{
+    if (!mUpperComputed)
+    {
+        mUpper = toUpper(mText);
+        mUpperComputed = true;
+    }
+
+    return mUpper;
+}
+
 GlobMatcher::GlobMatcher(const string &pattern, const bool caseSensitive)
   : mPattern(caseSensitive ? pattern : toUpper(pattern))
   , mCaseSensitive(caseSensitive)
 {
+    const bool leading = !mPattern.empty() && mPattern.front() == '*';
+    const bool trailing = mPattern.size() > 1 && mPattern.back() == '*';
+
+    mLiteral = mPattern.substr(leading, mPattern.size() - leading - trailing);
+
+    // Wildcards within the literal need the general matching.
+    if (mLiteral.find_first_of("*?") != string::npos)
+    {
+        mLiteral.clear();
+        return;
+    }
+
+    if (leading && trailing)
+    {
+        mKind = GK_CONTAINS;
+    }
+    else if (leading)
+    {
+        mKind = GK_SUFFIX;
+    }
+    else if (trailing)
+    {
+        mKind = GK_PREFIX;
+    }
+    else
+    {
+        mKind = GK_EXACT;
+    }
 }
 
-bool GlobMatcher::match(const string& s) const
+bool GlobMatcher::match(const MatchSubject& subject) const
 {
-    if (mCaseSensitive)
+    const string& s = mCaseSensitive ? subject.text() : subject.upper();
+
+    switch (mKind)
     {
-        return wildcardMatch(s, mPattern);
+    case GK_EXACT:
+        return s == mLiteral;
+
+    case GK_PREFIX:
+        return !s.compare(0, mLiteral.size(), mLiteral);
+
+    case GK_SUFFIX:
+        return s.size() >= mLiteral.size()
+               && !s.compare(s.size() - mLiteral.size(), mLiteral.size(), mLiteral);
+
+    case GK_CONTAINS:
+        return s.find(mLiteral) != string::npos;
+
+    case GK_WILDCARD:
+        break;
     }
 
-    return wildcardMatch(toUpper(s), mPattern);
+    return wildcardMatch(s, mPattern);
 }
 
 string GlobMatcher::debugDescription() const
@@ -859,9 +970,9 @@ RegexMatcher::RegexMatcher(const string& pattern, const bool caseSensitive)
 {
 }
 
-bool RegexMatcher::match(const string& s) const
+bool RegexMatcher::match(const MatchSubject& s) const
 {
-    return std::regex_match(s, mRegexp);
+    return std::regex_match(s.text(), mRegexp);
 }
 
 string RegexMatcher::debugDescription() const
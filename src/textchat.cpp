@@ -523,7 +523,11 @@ bool TextChat::serialize(string *d) const
     d->append((char*)&ou, sizeof ou);
     d->append((char*)&ts, sizeof(ts));
 
-    char hasAttachments = attachedNodes.size() != 0;
+    if (!mGrantsInTable)
+    {
+        loadGrants();
+    }
+    char hasAttachments = !mGrantsInTable && attachedNodes.size() != 0;
     d->append((char*)&hasAttachments, 1);
 
     d->append((char*)&flags, 1);
@@ -542,7 +546,15 @@ bool TextChat::serialize(string *d) const
     char hasSheduledMeetings = !mScheduledMeetings.empty() ? 1 : 0;
     d->append((char*)&hasSheduledMeetings, 1);
 
-    d->append("\0\0\0", 3); // additional bytes for backwards compatibility
+    // additional bytes for backwards compatibility: the first field tells whether the grants are in 'chatgrants'
+    if (mGrantsInTable)
+    {
+        d->append("\1\1\0\0", 4);
+    }
+    else
+    {
+        d->append("\0\0\0", 3);
+    }
 
     if (hasAttachments)
     {
@@ -718,10 +730,15 @@ TextChat* TextChat::unserialize(class MegaClient *client, string *d)
     char hasScheduledMeeting = MemAccess::get<char>(ptr);
     ptr += sizeof(char);
 
+    char grantsInTable = 0;
     for (int i = 3; i--;)
     {
         if (ptr + MemAccess::get<unsigned char>(ptr) < end)
         {
+            if (i == 2 && MemAccess::get<unsigned char>(ptr))
+            {
+                grantsInTable = ptr[1];
+            }
             ptr += MemAccess::get<unsigned char>(ptr) + 1;
         }
     }
@@ -861,6 +878,10 @@ TextChat* TextChat::unserialize(class MegaClient *client, string *d)
     chat->ts = ts;
     chat->flags = flags;
     chat->attachedNodes = attachedNodes;
+    chat->mGrantsInTable = grantsInTable;
+    chat->mGrantsLoaded = !grantsInTable;
+    chat->mGrantsChanged.clear();
+    chat->mClient = client;
     chat->unifiedKey = unifiedKey;
     chat->meeting = meetingRoom;
     chat->chatOptions = chatOptions;
@@ -1011,11 +1032,13 @@ m_time_t TextChat::getTs() const
 
 const attachments_map& TextChat::getAttachments() const
 {
+    loadGrants();
     return attachedNodes;
 }
 
 handle_set TextChat::getUsersOfAttachment(handle a) const
 {
+    loadGrants();
     auto ita = attachedNodes.find(a);
     if (ita != attachedNodes.end())
     {
@@ -1027,6 +1050,7 @@ handle_set TextChat::getUsersOfAttachment(handle a) const
 
 bool TextChat::isUserOfAttachment(handle a, handle uid) const
 {
+    loadGrants();
     auto ita = attachedNodes.find(a);
     if (ita != attachedNodes.end())
     {
@@ -1038,7 +1062,68 @@ bool TextChat::isUserOfAttachment(handle a, handle uid) const
 
 void TextChat::addUserForAttachment(handle a, handle uid)
 {
-    attachedNodes[a].insert(uid);
+    loadGrants();
+    if (attachedNodes[a].insert(uid).second && mGrantsInTable)
+    {
+        mGrantsChanged.push_back({a, uid, false});
+    }
+}
+
+void TextChat::loadGrants() const
+{
+    if (mGrantsLoaded)
+    {
+        return;
+    }
+    mGrantsLoaded = true;
+
+    std::vector<ChatGrant> grants;
+    DBTableNodes* table = mClient ? mClient->chatGrantsTable() : nullptr;
+    if (!table || !table->getChatGrants(id, grants))
+    {
+        LOG_err << "Failed to load the grants of the attachments of chat " << Base64Str<MegaClient::CHATHANDLE>(id);
+        return;
+    }
+
+    for (const ChatGrant& grant : grants)
+    {
+        attachedNodes[grant.node].insert(grant.user);
+    }
+}
+
+bool TextChat::saveGrants(DBTableNodes* table)
+{
+    if (!table || !table->hasChatGrants())
+    {
+        loadGrants();
+        mGrantsInTable = false;
+        mGrantsChanged.clear();
+        return true;
+    }
+
+    if (mGrantsInTable)
+    {
+        if (!mGrantsChanged.empty() && !table->putChatGrants(id, mGrantsChanged, false))
+        {
+            return false;
+        }
+        mGrantsChanged.clear();
+        return true;
+    }
+
+    // moved out of the record of the chat
+    loadGrants();
+    std::vector<ChatGrant> grants;
+    for (const auto& attachment : attachedNodes)
+    {
+        for (handle uh : attachment.second)
+        {
+            grants.push_back({attachment.first, uh, false});
+        }
+    }
+    mGrantsChanged.clear();
+    mGrantsInTable = table->putChatGrants(id, grants, true);
+    return mGrantsInTable;
 }
 
 void TextChat::setMeeting(bool m)
@@ -1096,12 +1181,16 @@ void TextChat::resetTag()
 
 bool TextChat::setNodeUserAccess(handle h, handle uh, bool revoke)
 {
+    loadGrants();
     if (revoke)
     {
         attachments_map::iterator uhit = attachedNodes.find(h);
         if (uhit != attachedNodes.end())
         {
-            uhit->second.erase(uh);
+            if (uhit->second.erase(uh) && mGrantsInTable)
+            {
+                mGrantsChanged.push_back({h, uh, true});
+            }
             if (uhit->second.empty())
             {
                 attachedNodes.erase(h);
@@ -1112,7 +1201,10 @@ bool TextChat::setNodeUserAccess(handle h, handle uh, bool revoke)
     }
     else
     {
-        attachedNodes[h].insert(uh);
+        if (attachedNodes[h].insert(uh).second && mGrantsInTable)
+        {
+            mGrantsChanged.push_back({h, uh, false});
+        }
         changed.attachments = true;
         return true;
     }
@@ -101,6 +101,26 @@ Transfer::~Transfer()
         client->fileAttributesUploading.erase(uploadhandle);
     }
 
+#ifdef USE_MEDIAINFO
+    if (!uploadhandle.isUndef())
+    {
+        client->mediaFileInfo.forgetMediaPropertiesExtraction(uploadhandle);
+    }
+#endif
+
+    for (const void* id : mCancelTokenIds)
+    {
+        auto it = client->mTransfersByCancelToken.find(id);
+        if (it != client->mTransfersByCancelToken.end())
+        {
+            it->second.erase(this);
+            if (it->second.empty())
+            {
+                client->mTransfersByCancelToken.erase(it);
+            }
+        }
+    }
+
     for (file_list::iterator it = files.begin(); it != files.end(); it++)
     {
         if (finished)
@@ -175,9 +195,19 @@ bool Transfer::serialize(string *d) const
 
     unsigned short ll;
 
-    d->append((const char*)&type, sizeof(type));
-
     const auto& tmpstr = localfilename.platformEncoded();
+
+    size_t urlsSize = 0;
+    for (const auto& url : tempurls)
+    {
+        urlsSize += url.size() + 1;
+    }
+
+    // about the size of the record (a chunk MAC takes 32 bytes with the usual layouts)
+    CacheableWriter cw(*d);
+    cw.reserve(160 + tmpstr.size() + chunkmacs.size() * 32 + mCachedChunkmacs.size() + urlsSize);
+
+    d->append((const char*)&type, sizeof(type));
     ll = (unsigned short)tmpstr.size();
     d->append((char*)&ll, sizeof(ll));
     d->append(tmpstr.data(), ll);
@@ -187,7 +217,14 @@ bool Transfer::serialize(string *d) const
     d->append((const char*)&metamac, sizeof(metamac));
     d->append((const char*)transferkey.data(), sizeof (transferkey));
 
-    chunkmacs.serialize(*d);
+    if (mCachedChunkmacs.empty())
+    {
+        chunkmacs.serialize(*d);
+    }
+    else
+    {
+        d->append(mCachedChunkmacs);
+    }
 
     if (!FileFingerprint::serialize(d))
     {
@@ -231,7 +268,6 @@ bool Transfer::serialize(string *d) const
     d->append((const char*)&s, sizeof(s));
     d->append((const char*)&priority, sizeof(priority));
 
-    CacheableWriter cw(*d);
     // version. Originally, 0.  Version 1 adds expansion flags, which then work in the usual way
     cw.serializeu8(1);
 
@@ -267,7 +303,7 @@ Transfer *Transfer::unserialize(MegaClient *client, string *d, transfer_multimap
     CacheableReader r(*d);
 
     direction_t type;
-    string filepath;
+    std::string_view filepath;
     if (!r.unserializedirection(type) ||
         (type != GET && type != PUT) ||
         !r.unserializestring(filepath))
@@ -280,16 +316,17 @@ Transfer *Transfer::unserialize(MegaClient *client, string *d, transfer_multimap
     unique_ptr<Transfer> t(new Transfer(client, type));
     if (!filepath.empty())
     {
-        t->localfilename = LocalPath::fromPlatformEncodedAbsolute(filepath);
+        t->localfilename = LocalPath::fromPlatformEncodedAbsolute(string(filepath));
     }
 
     int8_t hasUltoken;  // value 1 was for OLDUPLOADTOKENLEN, but that was from 2016
+    std::string_view chunkmacs;
 
     if (!r.unserializebinary(t->filekey.bytes.data(), sizeof(t->filekey)) ||
         !r.unserializei64(t->ctriv) ||
         !r.unserializei64(t->metamac) ||
         !r.unserializebinary(t->transferkey.data(), SymmCipher::KEYLENGTH) ||
-        !r.unserializechunkmacs(t->chunkmacs) ||
+        !r.unserializechunkmacs(chunkmacs) ||
         !r.unserializefingerprint(*t) ||
         !r.unserializefingerprint(t->badfp) ||
         !r.unserializei64(t->lastaccesstime) ||
@@ -306,7 +343,7 @@ Transfer *Transfer::unserialize(MegaClient *client, string *d, transfer_multimap
     }
 
     unsigned char expansionflags[8] = { 0 };
-    std::string combinedUrls;
+    std::string_view combinedUrls;
     int8_t state;
     int8_t version;
     if ((hasUltoken && !r.unserializebinary(t->ultoken->data(), UPLOADTOKENLEN)) ||
@@ -325,10 +362,14 @@ Transfer *Transfer::unserialize(MegaClient *client, string *d, transfer_multimap
     size_t ll = combinedUrls.size();
     for (size_t p = 0; p < ll; )
     {
-        size_t n = combinedUrls.find('\0');
-        t->tempurls.push_back(combinedUrls.substr(p, n));
+        size_t n = combinedUrls.find('\0', p);
+        if (n == std::string_view::npos)
+        {
+            n = ll;
+        }
+        t->tempurls.emplace_back(combinedUrls.substr(p, n - p));
         assert(!t->tempurls.back().empty());
-        p += (n == std::string::npos) ? ll : (n + 1);
+        p = n + 1;
     }
     if (!t->tempurls.empty() && t->tempurls.size() != 1 && t->tempurls.size() != RAIDPARTS)
     {
@@ -342,12 +383,36 @@ Transfer *Transfer::unserialize(MegaClient *client, string *d, transfer_multimap
         t->state = TRANSFERSTATE_PAUSED;
     }
 
-    t->chunkmacs.calcprogress(t->size, t->pos, t->progresscompleted);
+    // most cached transfers wait a long time to be resumed, if ever, and the MACs of big files take a while to unserialize
+    t->mCachedChunkmacs.assign(chunkmacs);
 
     multi_transfers[type].insert(pair<FileFingerprint*, Transfer*>(t.get(), t.get()));
     return t.release();
 }
 
+bool Transfer::materialize()
+{
+    if (mCachedChunkmacs.empty())
+    {
+        return true;
+    }
+
+    string data;
+    data.swap(mCachedChunkmacs);
+
+    const char* ptr = data.data();
+    chunkmacs.clear();
+    if (!chunkmacs.unserialize(ptr, data.data() + data.size()))
+    {
+        LOG_err << "Transfer unserialization failed - chunk MACs";
+        chunkmacs.clear();
+        return false;
+    }
+
+    chunkmacs.calcprogress(size, pos, progresscompleted);
+    return true;
+}
+
 SymmCipher *Transfer::transfercipher()
 {
     return client->getRecycledTemporaryTransferCipher(transferkey.data());
@@ -580,7 +645,11 @@ void Transfer::addAnyMissingMediaFileAttributes(Node* node, /*const*/ LocalPath&
         // for upload, the key is in the transfer.  for download, the key is in the node.
         uint32_t* attrKey = fileAttributeKeyPtr((type == PUT) ? filekey.bytes.data() : (byte*)node->nodekey().data());
 
-        if (type == PUT || !node->hasfileattribute(fa_media) || client->mediaFileInfo.timeToRetryMediaPropertyExtraction(node->fileattrstring, attrKey))
+        if (type == PUT && client->mediaFileInfo.completeMediaPropertiesExtraction(client, attrKey, uploadhandle, this))
+        {
+            // extracted in the background while uploading
+        }
+        else if (type == PUT || !node->hasfileattribute(fa_media) || client->mediaFileInfo.timeToRetryMediaPropertyExtraction(node->fileattrstring, attrKey))
         {
             // if we don't have the codec id mappings yet, send the request
             client->mediaFileInfo.requestCodecMappingsOneTime(client, LocalPath());
@@ -847,7 +916,7 @@ void Transfer::complete(TransferDbCommitter& committer)
 
                                 if (missingattr)
                                 {
-                                    client->gfx->gendimensionsputfa(localname, NodeOrUploadHandle(n->nodeHandle()), n->nodecipher(), missingattr);
+                                    client->gfx->gendimensionsputfa(localname, NodeOrUploadHandle(n->nodeHandle()), n->nodecipher(), missingattr, n->fingerprint());
                                 }
 
                                 addAnyMissingMediaFileAttributes(n.get(), localname);
@@ -1081,7 +1150,220 @@ void Transfer::completefiles()
 #endif // ENABLE_SYNC
 }
 
+void DirectReadCache::add(handle h, int64_t ctriv, m_off_t pos, string&& data)
+{
+    assert(!(pos % CHUNK_SIZE));
+
+    if (data.empty() || data.size() > mMaxSize)
+    {
+        return;
+    }
+
+    Key key(h, ctriv, pos);
+    auto it = mIndex.find(key);
+    if (it != mIndex.end())
+    {
+        // already cached: refresh it
+        mSize -= it->second->data.size();
+        mEntries.erase(it->second);
+        mIndex.erase(it);
+    }
+
+    mSize += data.size();
+    mEntries.push_front(Entry{key, std::move(data)});
+    mIndex.emplace(key, mEntries.begin());
+
+    evict();
+}
+
+const string* DirectReadCache::find(handle h, int64_t ctriv, m_off_t pos)
+{
+    auto it = mIndex.find(Key(h, ctriv, pos - pos % CHUNK_SIZE));
+    if (it == mIndex.end())
+    {
+        return nullptr;
+    }
+
+    // now it's the most recently used
+    mEntries.splice(mEntries.begin(), mEntries, it->second);
+    return &it->second->data;
+}
+
+void DirectReadCache::clear()
+{
+    mIndex.clear();
+    mEntries.clear();
+    mSize = 0;
+}
+
+size_t DirectReadCache::maxSize() const
+{
+    return mMaxSize;
+}
+
+void DirectReadCache::setMaxSize(size_t maxSize)
+{
+    mMaxSize = maxSize;
+    evict();
+}
+
+size_t DirectReadCache::size() const
+{
+    return mSize;
+}
+
+void DirectReadCache::evict()
+{
+    while (mSize > mMaxSize)
+    {
+        Entry& entry = mEntries.back();
+        mSize -= entry.data.size();
+        mIndex.erase(entry.key);
+        mEntries.pop_back();
+    }
+}
+
+DirectReadAhead::DirectReadAhead(DirectReadNode* drn)
+  : mDrn(drn)
+  , mPattern(PATTERN_UNKNOWN)
+  , mLastEnd(-1)
+  , mFirstDeliveryDs(0)
+  , mDelivered(0)
+{
+}
+
+void DirectReadAhead::requested(m_off_t offset, m_off_t count)
+{
+    mRequestTimes.push_back(Waiter::ds);
+    while (mRequestTimes.front() + SCRUB_INTERVAL_DS < Waiter::ds)
+    {
+        mRequestTimes.pop_front();
+    }
+
+    // the app asks for data being prefetched: its own read takes over
+    DirectRead* current = prefetching();
+    if (current && offset >= current->offset && offset < current->offset + current->count)
+    {
+        LOG_debug << "[DirectReadAhead] Read at " << offset << " supersedes the prefetch at " << current->offset;
+        delete current;
+        current = nullptr;
+    }
+
+    m_off_t size = mDrn->size;
+    if (mRequestTimes.size() >= SCRUB_READS)
+    {
+        mPattern = PATTERN_SCRUBBING;
+    }
+    else if (size > 2 * TAIL_SIZE && offset >= size - TAIL_SIZE && offset != mLastEnd)
+    {
+        mPattern = PATTERN_TAIL_FIRST;
+    }
+    else if (offset == mLastEnd)
+    {
+        mPattern = PATTERN_SEQUENTIAL;
+    }
+    else
+    {
+        mPattern = PATTERN_UNKNOWN;
+    }
+
+    mLastEnd = offset + count;
+
+    if (current)
+    {
+        return;
+    }
+
+    switch (mPattern)
+    {
+        case PATTERN_TAIL_FIRST:
+            // the player will come back to the start once it has parsed the metadata
+            prefetch(0, window(0));
+            break;
+
+        case PATTERN_SEQUENTIAL:
+            // reads ending before the end of the file are followed by the next range
+            if (size && mLastEnd < size)
+            {
+                prefetch(mLastEnd, window(count));
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void DirectReadAhead::delivered(m_off_t len)
+{
+    if (!mDelivered)
+    {
+        mFirstDeliveryDs = Waiter::ds;
+    }
+
+    mDelivered += len;
+}
+
+DirectReadAhead::Pattern DirectReadAhead::pattern() const
+{
+    return mPattern;
+}
+
+bool DirectReadAhead::onData(byte*, m_off_t, m_off_t)
+{
+    return true;
+}
+
+dstime DirectReadAhead::onFailure(const Error& e, int, dstime)
+{
+    LOG_debug << "[DirectReadAhead] Prefetch failed: " << e;
+    return NEVER;
+}
+
+DirectRead* DirectReadAhead::prefetching() const
+{
+    for (DirectRead* dr : mDrn->reads)
+    {
+        if (dr->listener == this)
+        {
+            return dr;
+        }
+    }
+
+    return nullptr;
+}
+
+void DirectReadAhead::prefetch(m_off_t offset, m_off_t count)
+{
+    count = std::min(count, mDrn->size - offset);
+    if (count <= 0)
+    {
+        return;
+    }
+
+    LOG_debug << "[DirectReadAhead] Prefetching " << count << " bytes at " << offset << " (pattern " << mPattern << ")";
+
+    // the listener doubles as appdata, as reads without appdata are discarded
+    mDrn->enqueue(offset, count, 0, this, this);
+}
+
+m_off_t DirectReadAhead::window(m_off_t count) const
+{
+    // a quarter of the cache at most, so prefetched data doesn't push out what's being played
+    m_off_t maxWindow = std::min(MAX_WINDOW, static_cast<m_off_t>(mDrn->client->drcache.maxSize() / 4));
+
+    m_off_t window = std::max(count, MIN_WINDOW);
+    dstime elapsed = Waiter::ds - mFirstDeliveryDs;
+    if (mDelivered && elapsed > 0)
+    {
+        window = std::max(window, mDelivered * WINDOW_DS / static_cast<m_off_t>(elapsed));
+    }
+
+    return std::min(window, maxWindow);
+}
+
 DirectReadNode::DirectReadNode(MegaClient* cclient, handle ch, bool cp, SymmCipher* csymmcipher, int64_t cctriv, const char *privauth, const char *pubauth, const char *cauth)
+  : readahead(this)
 {
     client = cclient;
 
@@ -1185,7 +1467,7 @@ void DirectReadNode::retry(const Error& e, dstime timeleft)
             if (e)
             {
                 LOG_debug << "[DirectReadNode::retry] Calling pread_failure for DirectRead (" << (void*)(*it) << ")" << " [this = " << this << "]";
-                dstime retryds = client->app->pread_failure(e, retries, (*it)->appdata, timeleft);
+                dstime retryds = (*it)->deliverFailure(e, retries, timeleft);
 
                 if (retryds < minretryds && !(e == API_ETOOMANY && e.hasExtraInfo()))
                 {
@@ -1263,18 +1545,12 @@ void DirectReadNode::cmdresult(const Error &e, dstime timeleft)
             DirectRead* dr = *it;
             assert(dr->drq_it == client->drq.end());
 
-            if (dr->drbuf.tempUrlVector().empty())
-            {
-                // DirectRead starting
-                m_off_t streamingMaxReqSize = dr->drMaxReqSize();
-                LOG_debug << "Direct read node size = " << dr->drn->size << ", streaming max request size: " << streamingMaxReqSize;
-                dr->drbuf.setIsRaid(dr->drn->tempurls, dr->offset, dr->offset + dr->count, dr->drn->size, streamingMaxReqSize, false);
-            }
-            else
+            if (!dr->drbuf.tempUrlVector().empty())
             {
                 // URLs have been re-requested, eg. due to temp URL expiry.  Keep any parts downloaded already
                 dr->drbuf.updateUrlsAndResetPos(dr->drn->tempurls);
             }
+            // otherwise the DirectRead starts (see DirectRead::start()) when it gets a slot
 
             dr->drq_it = client->drq.insert(client->drq.end(), *it);
         }
@@ -1305,9 +1581,9 @@ void DirectReadNode::schedule(dstime deltads)
     }
 }
 
-void DirectReadNode::enqueue(m_off_t offset, m_off_t count, int reqtag, void* appdata)
+DirectRead* DirectReadNode::enqueue(m_off_t offset, m_off_t count, int reqtag, void* appdata, DirectReadListener* listener)
 {
-    new DirectRead(this, count, offset, reqtag, appdata);
+    return new DirectRead(this, count, offset, reqtag, appdata, listener);
 }
 
 bool DirectReadSlot::processAnyOutputPieces()
@@ -1330,7 +1606,8 @@ bool DirectReadSlot::processAnyOutputPieces()
             LOG_verbose << "DirectReadSlot -> Delivering assembled part ->"
                         << "len = " << len << ", speed = " << mSpeed << ", meanSpeed = " << (mMeanSpeed / 1024) << " KB/s"
                         << ", slotThroughput = " << ((calcThroughput(mSlotThroughput.first, mSlotThroughput.second) * 1000) / 1024) << " KB/s]" << " [this = " << this << "]";
-            continueDirectRead = mDr->drn->client->app->pread_data(outputPiece->buf.datastart(), len, mPos, mSpeed, mMeanSpeed, mDr->appdata);
+            mDr->cacheData(outputPiece->buf.datastart(), static_cast<m_off_t>(len), mPos);
+            continueDirectRead = mDr->deliverData(outputPiece->buf.datastart(), static_cast<m_off_t>(len), mPos, mSpeed, mMeanSpeed, outputPiece);
         }
         else
         {
@@ -1768,6 +2045,7 @@ bool DirectReadSlot::doio()
                         if (!req)
                         {
                             mReqs[connectionNum] = std::make_unique<HttpReq>(true);
+                            mReqs[connectionNum]->bwclass = BW_STREAMING;
                         }
 
                         if (!mDr->drbuf.isRaid())
@@ -1855,6 +2133,126 @@ void DirectRead::abort()
     }
 }
 
+bool DirectRead::deliverData(byte* buffer, m_off_t len, m_off_t pos, m_off_t speed, m_off_t meanSpeed, std::shared_ptr<const void> owner)
+{
+    if (listener != &drn->readahead)
+    {
+        drn->readahead.delivered(len);
+    }
+
+    if (listener && appdata)
+    {
+        return listener->onData(buffer, len, pos);
+    }
+
+    return drn->client->app->pread_data(buffer, len, pos, speed, meanSpeed, appdata, std::move(owner));
+}
+
+dstime DirectRead::deliverFailure(const Error& e, int retry, dstime timeLeft)
+{
+    if (listener && appdata)
+    {
+        return listener->onFailure(e, retry, timeLeft);
+    }
+
+    return drn->client->app->pread_failure(e, retry, appdata, timeLeft);
+}
+
+bool DirectRead::start()
+{
+    assert(drbuf.tempUrlVector().empty() && !progress);
+
+    // deliver the leading part of the range that has been streamed recently
+    while (appdata && progress < count)
+    {
+        m_off_t pos = offset + progress;
+        const string* chunk = drn->client->drcache.find(drn->h, drn->ctriv, pos);
+        if (!chunk)
+        {
+            break;
+        }
+
+        m_off_t chunkpos = pos - pos % DirectReadCache::CHUNK_SIZE;
+        m_off_t len = std::min(chunkpos + static_cast<m_off_t>(chunk->size()), offset + count) - pos;
+        if (len <= 0)
+        {
+            break;
+        }
+
+        // the app's buffer is writable (and may be kept), don't hand out the cached one
+        auto buffer = std::make_shared<string>(*chunk, static_cast<size_t>(pos - chunkpos), static_cast<size_t>(len));
+
+        LOG_verbose << "[DirectRead::start] Delivering " << len << " cached bytes at " << pos << " [this = " << this << "]";
+        if (!deliverData(reinterpret_cast<byte*>(&(*buffer)[0]), len, pos, 0, 0, buffer))
+        {
+            return false;
+        }
+
+        progress += len;
+    }
+
+    if (progress && progress >= count)
+    {
+        LOG_debug << "[DirectRead::start] Range served from the cache [this = " << this << "]";
+        return false;
+    }
+
+    // fetch the rest from storage
+    m_off_t streamingMaxReqSize = drMaxReqSize();
+    LOG_debug << "Direct read start -> direct read node size = " << drn->size << ", streaming max request size: " << streamingMaxReqSize << ", cached bytes: " << progress;
+    drbuf.setIsRaid(drn->tempurls, offset + progress, offset + count, drn->size, streamingMaxReqSize, false);
+    cachepos = offset + progress;
+
+    return true;
+}
+
+void DirectRead::cacheData(const byte* buffer, m_off_t len, m_off_t pos)
+{
+    DirectReadCache& cache = drn->client->drcache;
+    if (!cache.maxSize())
+    {
+        return;
+    }
+
+    if (pos != cachepos)
+    {
+        // not contiguous with the previous data (ie. the read has been restarted)
+        cachebuf.clear();
+        cachepos = pos;
+    }
+
+    while (len > 0)
+    {
+        m_off_t chunkpos = cachepos - cachepos % DirectReadCache::CHUNK_SIZE;
+        m_off_t chunkend = std::min(chunkpos + DirectReadCache::CHUNK_SIZE, drn->size);
+        m_off_t n = std::min(len, chunkend - cachepos);
+        if (n <= 0)
+        {
+            break;
+        }
+
+        // only chunks received from their start are kept
+        bool fromStart = cachebuf.size() == static_cast<size_t>(cachepos - chunkpos);
+        if (fromStart)
+        {
+            cachebuf.append(reinterpret_cast<const char*>(buffer), static_cast<size_t>(n));
+        }
+
+        buffer += n;
+        len -= n;
+        cachepos += n;
+
+        if (cachepos == chunkend)
+        {
+            if (fromStart)
+            {
+                cache.add(drn->h, drn->ctriv, chunkpos, std::move(cachebuf));
+            }
+            cachebuf.clear();
+        }
+    }
+}
+
 m_off_t DirectRead::drMaxReqSize() const
 {
     m_off_t numParts = drn->tempurls.size() == RAIDPARTS ?
@@ -1863,7 +2261,7 @@ m_off_t DirectRead::drMaxReqSize() const
     return std::max(drn->size / numParts, TransferSlot::MAX_REQ_SIZE);
 }
 
-DirectRead::DirectRead(DirectReadNode* cdrn, m_off_t ccount, m_off_t coffset, int creqtag, void* cappdata)
+DirectRead::DirectRead(DirectReadNode* cdrn, m_off_t ccount, m_off_t coffset, int creqtag, void* cappdata, DirectReadListener* clistener)
     : drbuf(this)
 {
     LOG_debug << "[DirectRead::DirectRead] New DirectRead [cappdata = " << cappdata << "]" << " [this = " << this << "]";
@@ -1874,6 +2272,8 @@ DirectRead::DirectRead(DirectReadNode* cdrn, m_off_t ccount, m_off_t coffset, in
     progress = 0;
     reqtag = creqtag;
     appdata = cappdata;
+    listener = clistener;
+    cachepos = offset;
 
     drs = NULL;
 
@@ -1882,9 +2282,6 @@ DirectRead::DirectRead(DirectReadNode* cdrn, m_off_t ccount, m_off_t coffset, in
     if (!drn->tempurls.empty())
     {
         // we already have tempurl(s): queue for immediate fetching
-        m_off_t streamingMaxReqSize = drMaxReqSize();
-        LOG_debug << "Direct read start -> direct read node size = " << drn->size << ", streaming max request size: " << streamingMaxReqSize;
-        drbuf.setIsRaid(drn->tempurls, offset, offset + count, drn->size, streamingMaxReqSize, false);
         drq_it = drn->client->drq.insert(drn->client->drq.end(), this);
     }
     else
@@ -1954,6 +2351,7 @@ DirectReadSlot::DirectReadSlot(DirectRead* cdr)
         mReqs.push_back(std::make_unique<HttpReq>(true));
         mReqs.back()->status = REQ_READY;
         mReqs.back()->type = REQ_BINARY;
+        mReqs.back()->bwclass = BW_STREAMING;
     }
     LOG_verbose << "[DirectReadSlot::DirectReadSlot] Num requests: " << numReqs << " [this = " << this << "]";
     mThroughput.resize(mReqs.size());
@@ -28,6 +28,7 @@
 #include "mega/megaapp.h"
 #include "mega/utils.h"
 #include "mega/logging.h"
+#include "mega/metrics.h"
 #include "mega/raid.h"
 #include "mega/testhooks.h"
 
@@ -60,6 +61,9 @@ const dstime TransferSlot::XFERTIMEOUT = 600;
 // max time without progress callbacks
 const dstime TransferSlot::PROGRESSTIMEOUT = 10;
 
+// max time without calls to doio() while the connections are in flight without data
+const dstime TransferSlot::IDLE_SERVICE_DS = 5;
+
 #if defined(__ANDROID__) || defined(USE_IOS)
     const m_off_t TransferSlot::MAX_REQ_SIZE = 2097152; // 2 MB
 #elif defined (_WIN32) || defined(HAVE_AIO_RT)
@@ -72,6 +76,75 @@ const m_off_t TransferSlot::MAX_REQ_SIZE_NEW_RAID = 2 * 1024 * 1024; // 2 MB for
 const m_off_t TransferSlot::UPPER_FILESIZE_LIMIT_FOR_SMALLER_CHUNKS = 25 * 1024 * 1024; // 25 MB
 const m_off_t TransferSlot::MIN_FILESIZE_FOR_MULTIPLE_CONNECTIONS = 131072 + 1; // 128 KB + 1 -> legacy value
 const m_off_t TransferSlot::MAX_GAP_SIZE = 256 * 1024 * 1024; // 256 MB
+const m_off_t TransferSlot::MIN_FILESIZE_FOR_DIRECT_WRITES = 4ll * 1024 * 1024 * 1024; // 4 GB
+const m_off_t TransferSlot::MIN_FILESIZE_FOR_PREALLOCATION = 16 * 1024 * 1024; // 16 MB
+const dstime TransferSlot::DOWNLOAD_PROGRESS_CACHE_INTERVAL_DS = 50; // 5 seconds
+
+// downloaded pieces are written from pooled buffers, which must be suitable for direct writes
+static_assert(HttpBufferPool::ALIGNMENT % FileAccess::DIRECT_WRITE_ALIGNMENT == 0, "HttpBufferPool alignment");
+const m_off_t TransferSlot::MAX_UPLOAD_PREFETCH_BYTES = 64 * 1024 * 1024; // 64 MB
+
+const dstime TransferConnectionController::SAMPLE_INTERVAL_DS = 30;
+const unsigned TransferConnectionController::MIN_GAIN_PERCENT = 10;
+const unsigned TransferConnectionController::HOLD_SAMPLES = 10;
+const dstime TransferConnectionController::SHORT_REQUEST_DS = 20;
+const dstime TransferConnectionController::LONG_REQUEST_DS = 150;
+
+TransferConnectionController::TransferConnectionController(unsigned initialConnections, unsigned maxConnections,
+                                                           m_off_t initialRequestSize, m_off_t minRequestSize, m_off_t maxRequestSize)
+    : mConnections(std::max(1u, std::min(initialConnections, maxConnections)))
+    , mMaxConnections(std::max(1u, maxConnections))
+    , mRequestSize(std::max(minRequestSize, std::min(initialRequestSize, maxRequestSize)))
+    , mMinRequestSize(minRequestSize)
+    , mMaxRequestSize(std::max(minRequestSize, maxRequestSize))
+{
+}
+
+void TransferConnectionController::sample(m_off_t bytes, unsigned failures, dstime meanRequestDs, bool canGrow)
+{
+    if (failures)
+    {
+        // multiplicative decrease
+        mConnections = std::max(1u, mConnections / 2);
+        mRequestSize = std::max(mMinRequestSize, mRequestSize / 2);
+        mProbing = false;
+        mHold = HOLD_SAMPLES;
+        mLastBytes = 0;
+        return;
+    }
+
+    if (mProbing)
+    {
+        mProbing = false;
+
+        // the extra connection didn't pay off: the link (or the server) is already saturated
+        if (bytes * 100 < mLastBytes * (100 + MIN_GAIN_PERCENT))
+        {
+            --mConnections;
+            mHold = HOLD_SAMPLES;
+        }
+    }
+    else if (mHold)
+    {
+        --mHold;
+    }
+    else if (canGrow && bytes > 0 && mConnections < mMaxConnections)
+    {
+        ++mConnections;
+        mProbing = true;
+    }
+
+    if (meanRequestDs && meanRequestDs < SHORT_REQUEST_DS)
+    {
+        mRequestSize = std::min(mMaxRequestSize, mRequestSize * 2);
+    }
+    else if (meanRequestDs > LONG_REQUEST_DS)
+    {
+        mRequestSize = std::max(mMinRequestSize, mRequestSize / 2);
+    }
+
+    mLastBytes = bytes;
+}
 
 TransferSlot::TransferSlot(Transfer* ctransfer)
     : fa(ctransfer->client->fsaccess->newfileaccess(), ctransfer)
@@ -136,6 +209,14 @@ TransferSlot::TransferSlot(Transfer* ctransfer)
         LOG_warn << "[Windows] Error getting RAM usage info";
     }
 #endif
+
+    // the memory budget of the transfers is shared by the active ones, each with up to MAX_NUM_CONNECTIONS requests
+    if (transfer->client->transferBufferBudget.limit() > 0)
+    {
+        m_off_t share = transfer->client->transferBufferBudget.limit()
+                / static_cast<m_off_t>((transfer->client->tslots.size() + 1) * MegaClient::MAX_NUM_CONNECTIONS);
+        maxRequestSize = std::min(maxRequestSize, std::max<m_off_t>(share, 2097152)); // 2 MB
+    }
 }
 
 bool TransferSlot::createconnectionsonce()
@@ -149,6 +230,16 @@ bool TransferSlot::createconnectionsonce()
         }
 
         connections = transferbuf.isRaid() ? RAIDPARTS : transfer->size >= MIN_FILESIZE_FOR_MULTIPLE_CONNECTIONS ? transfer->client->connections[transfer->type] : 1;
+
+        if (connections > 1 && !transferbuf.isRaid() && !transferbuf.isNewRaid())
+        {
+            // start with the configured connections, probe up to the maximum allowed
+            auto configured = static_cast<unsigned>(connections);
+            connections = static_cast<int>(std::max(configured, MegaClient::MAX_NUM_CONNECTIONS));
+            mConnectionController.reset(new TransferConnectionController(configured, static_cast<unsigned>(connections),
+                                                                         maxRequestSize, 2 * 1024 * 1024, maxRequestSize));
+            mControlSampleDs = Waiter::ds;
+        }
 #ifdef MEGASDK_DEBUG_TEST_HOOKS_ENABLED
         if (transfer->size >= MIN_FILESIZE_FOR_MULTIPLE_CONNECTIONS && transferbuf.isNewRaid())
         {
@@ -158,7 +249,9 @@ bool TransferSlot::createconnectionsonce()
         LOG_debug << "Populating transfer slot with " << connections << " connections, max request size of " << maxRequestSize << " bytes [transferbuf.isNewRaid() = " << transferbuf.isNewRaid() << "] [isDownload = " << (transfer->type == GET) << "]";
         reqs.resize(connections);
         mReqSpeeds.resize(connections);
+        mBufferReserved.resize(connections);
         asyncIO = new AsyncIOContext*[connections]();
+        mUploadPrefetch.resize(connections);
 
         if (transferbuf.isNewRaid())
         {
@@ -178,7 +271,8 @@ TransferSlot::~TransferSlot()
             && transfer->progresscompleted != transfer->size
             && !transfer->asyncopencontext)
     {
-        bool cachetransfer = false; // need to save in cache
+        // need to save in cache (written pieces may not have been saved yet)
+        bool cachetransfer = mDownloadProgressCached >= 0 && mDownloadProgressCached != transfer->progresscompleted;
 
         if (fa && fa->asyncavailable())
         {
@@ -293,6 +387,11 @@ TransferSlot::~TransferSlot()
 
     transfer->slot = NULL;
 
+    for (m_off_t reserved : mBufferReserved)
+    {
+        transfer->client->transferBufferBudget.release(reserved);
+    }
+
     if (slots_it != transfer->client->tslots.end())
     {
         // advance main loop iterator if deleting next in line
@@ -316,6 +415,11 @@ TransferSlot::~TransferSlot()
         transfer->client->asyncfopens--;
     }
 
+    for (auto& prefetch : mUploadPrefetch)
+    {
+        delete prefetch.asyncIO;
+    }
+
     while (connections--)
     {
         delete asyncIO[connections];
@@ -438,6 +542,19 @@ bool TransferSlot::checkMetaMacWithMissingLateEntries()
     return false;
 }
 
+void TransferSlot::cacheDownloadProgress(TransferDbCommitter& committer, MegaClient* client)
+{
+    if (mDownloadProgressCached >= 0 && Waiter::ds - mDownloadProgressCachedDs < DOWNLOAD_PROGRESS_CACHE_INTERVAL_DS)
+    {
+        return;
+    }
+
+    // the first piece is saved right away, later ones are throttled
+    mDownloadProgressCachedDs = Waiter::ds;
+    mDownloadProgressCached = transfer->progresscompleted;
+    client->transfercacheadd(transfer, &committer);
+}
+
 bool TransferSlot::checkDownloadTransferFinished(TransferDbCommitter& committer, MegaClient* client)
 {
     if (transfer->progresscompleted == transfer->size)
@@ -525,10 +642,44 @@ bool TransferSlot::testForSlowRaidConnection(unsigned connectionNum, bool& incre
     return false;
 }
 
+bool TransferSlot::needsService(MegaClient* client)
+{
+    if (Waiter::ds >= mLastServiceDs + IDLE_SERVICE_DS
+            || !fa || pendingcmd || reqs.size() != static_cast<size_t>(connections))
+    {
+        return true;
+    }
+
+    m_off_t transferred = 0;
+    for (auto& req : reqs)
+    {
+        if (!req || req->status != REQ_INFLIGHT)
+        {
+            return true;
+        }
+        transferred += req->transferred(client);
+    }
+    return transferred != mLastServiceTransferred;
+}
+
 // file transfer state machine
 void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
 {
     CodeCounter::ScopeTimer pbt(client->performanceStats.transferslotDoio);
+    static auto& doioLatency = Metrics::registry().histogram("TransferSlot_doio");
+    Metrics::ScopedLatency doioTimer(doioLatency);
+    TRACE_SPAN("TransferSlot_doio");
+
+    // what is known now, for needsService()
+    mLastServiceDs = Waiter::ds;
+    mLastServiceTransferred = 0;
+    for (auto& req : reqs)
+    {
+        if (req && req->status == REQ_INFLIGHT)
+        {
+            mLastServiceTransferred += req->transferred(client);
+        }
+    }
 
     if (!fa || (transfer->size && transfer->progresscompleted == transfer->size)
             || (transfer->type == PUT && transfer->ultoken))
@@ -588,6 +739,11 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
     // main loop over connections
     for (int i = connections; i--; )
     {
+        if (transfer->type == PUT && !processUploadPrefetch(i, backoff))
+        {
+            return transfer->failed(API_EREAD, committer);
+        }
+
         if (reqs[i])
         {
             unsigned slowestStartConnection;
@@ -622,6 +778,12 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
 
                     p += reqs[i]->transferred(client);
 
+                    if (transfer->type == PUT && i < activeConnections())
+                    {
+                        // have the next request of this connection ready when this one finishes
+                        startUploadPrefetch(i);
+                    }
+
                     assert(reqs[i]->lastdata != NEVER);
                     bool incrementErrors = false;
                     if (transfer->type == GET && transferbuf.isRaid()
@@ -647,6 +809,8 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
                 case REQ_SUCCESS:
                 {
                     mReqSpeeds[i].requestProgressed(reqs[i]->size);
+                    mControlRequestsDs += mReqSpeeds[i].requestElapsedDs();
+                    ++mControlRequests;
 
                     if (client->orderdownloadedchunks && transfer->type == GET && !transferbuf.isRaid() && transfer->progresscompleted != static_cast<HttpReqDL*>(reqs[i].get())->dlpos)
                     {
@@ -696,6 +860,17 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
                                         std::this_thread::sleep_for(std::chrono::milliseconds(1));
                                     }
                                 }
+
+                                // same for the read-ahead requests (never sent, but their chunks could have been uploaded by a previous session)
+                                auto& prefetchReq = mUploadPrefetch[j].req;
+                                if (prefetchReq && prefetchReq->status == REQ_ENCRYPTING)
+                                {
+                                    LOG_debug << "Conn " << i << " : Read-ahead request of connection " << j << " is in REQ_ENCRYPTING status. Waiting for encryption of chunk so we know all chunk macs";
+                                    while (prefetchReq->status == REQ_ENCRYPTING)
+                                    {
+                                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                                    }
+                                }
                             }
 
                             // any other connections that have not reported back yet, or we haven't processed yet,
@@ -713,6 +888,14 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
                                     transfer->progresscompleted += reqs[j]->size;
                                     transfer->chunkmacs.finishedUploadChunks(static_cast<HttpReqUL*>(reqs[j].get())->mChunkmacs);
                                 }
+
+                                auto& prefetchReq = mUploadPrefetch[j].req;
+                                if (prefetchReq && prefetchReq->status == REQ_PREPARED)
+                                {
+                                    LOG_debug << "Conn " << i << " : Including chunk MACs from the read-ahead request of connection " << j;
+                                    transfer->progresscompleted += prefetchReq->size;
+                                    transfer->chunkmacs.finishedUploadChunks(static_cast<HttpReqUL*>(prefetchReq.get())->mChunkmacs);
+                                }
                             }
 
                             transfer->chunkmacs.finishedUploadChunks(static_cast<HttpReqUL*>(reqs[i].get())->mChunkmacs);
@@ -964,7 +1147,7 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
                                 return;
                             }
 
-                            client->transfercacheadd(transfer, &committer);
+                            cacheDownloadProgress(committer, client);
                             reqs[i]->status = REQ_READY;
                         }
                     }
@@ -979,30 +1162,8 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
                             if (transfer->type == PUT)
                             {
                                 LOG_verbose << "Conn " << i << " : Async read succeeded (size: " << asyncIO[i]->dataBufferLen << ")";
-                                m_off_t npos = asyncIO[i]->posOfBuffer + asyncIO[i]->dataBufferLen;
-                                string finaltempurl = transferbuf.tempURL(i);
-                                if (client->usealtupport && !memcmp(finaltempurl.c_str(), "http:", 5))
-                                {
-                                    size_t index = finaltempurl.find("/", 8);
-                                    if(index != string::npos && finaltempurl.find(":", 8) == string::npos)
-                                    {
-                                        finaltempurl.insert(index, ":8080");
-                                    }
-                                }
-
-                                auto pos = asyncIO[i]->posOfBuffer;
-                                auto req = reqs[i];    // shared_ptr so no object is deleted out from under the worker
-                                auto transferkey = transfer->transferkey;
-                                auto ctriv = transfer->ctriv;
-                                req->pos = pos;
-                                req->status = REQ_ENCRYPTING;
-
-                                client->mAsyncQueue.push([req, transferkey, ctriv, finaltempurl, pos, npos](SymmCipher& sc)
-                                    {
-                                        sc.setkey(transferkey.data());
-                                        req->prepare(finaltempurl.c_str(), &sc, ctriv, pos, npos);
-                                        req->status = REQ_PREPARED;
-                                    }, true);   // discardable - if the transfer or client are being destroyed, we won't be sending that data.
+                                m_off_t pos = asyncIO[i]->posOfBuffer;
+                                encryptUploadRequest(reqs[i], i, pos, pos + asyncIO[i]->dataBufferLen);
                             }
                             else
                             {
@@ -1018,7 +1179,7 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
                                     return;
                                 }
 
-                                client->transfercacheadd(transfer, &committer);
+                                cacheDownloadProgress(committer, client);
                                 reqs[i]->status = REQ_READY;
 
                                 if (client->orderdownloadedchunks && !transferbuf.isRaid())
@@ -1066,6 +1227,7 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
 
                 case REQ_FAILURE:
                     {
+                        ++mControlFailures;
                         auto failValue = processRequestFailure(client, reqs[i], backoff, i);
                         if (failValue.first != API_OK)
                         {
@@ -1083,11 +1245,17 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
 
         if (!failure)
         {
-            if (!reqs[i] || (reqs[i]->status == REQ_READY))
+            // uploads: if the next request was already read ahead (and maybe encrypted), just take it over
+            // connections beyond the active ones don't start new ranges, nor those without room in the buffer budget
+            m_off_t requestSize = mConnectionController ? mConnectionController->requestSize() : maxRequestSize;
+            if ((!reqs[i] || (reqs[i]->status == REQ_READY))
+                && !(transfer->type == PUT && useUploadPrefetch(i))
+                && i < activeConnections()
+                && reserveRequestBuffer(i, requestSize))
             {
                 bool newInputBufferSupplied = false;
                 bool pauseConnectionInputForRaid = false;
-                std::pair<m_off_t, m_off_t> posrange = transferbuf.nextNPosForConnection(i, maxRequestSize, connections, newInputBufferSupplied, pauseConnectionInputForRaid, client->httpio->uploadSpeed);
+                std::pair<m_off_t, m_off_t> posrange = transferbuf.nextNPosForConnection(i, requestSize, unsigned(activeConnections()), newInputBufferSupplied, pauseConnectionInputForRaid, client->httpio->uploadSpeed);
 
                 // we might have a raid-reassembled block to write, or a previously loaded block, or a skip block to process.
                 bool newOutputBufferSupplied = false;
@@ -1115,6 +1283,7 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
                     {
                         reqs[i].reset(transfer->type == PUT ? (HttpReqXfer*)new HttpReqUL() : (HttpReqXfer*)new HttpReqDL());
                         reqs[i]->logname = client->clientname + (transfer->type == PUT ? "U" : "D") + std::to_string(++client->transferHttpCounter) + " ";
+                        reqs[i]->bwclass = bandwidthClass();
                     }
 
                     bool prepare = true;
@@ -1163,7 +1332,15 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
 
                     if (prepare)
                     {
-                        prepareRequest(reqs[i], transferbuf.isNewRaid() ? std::string() : transferbuf.tempURL(i), posrange.first, posrange.second);
+                        if (transfer->type == PUT)
+                        {
+                            // encrypt at the worker threads, like the chunks read asynchronously
+                            encryptUploadRequest(reqs[i], i, posrange.first, posrange.second);
+                        }
+                        else
+                        {
+                            prepareRequest(reqs[i], transferbuf.isNewRaid() ? std::string() : transferbuf.tempURL(i), posrange.first, posrange.second);
+                        }
                     }
 
                     LOG_verbose << "Conn " << i << " : Request prepared. Pos: " << posrange.first << " to npos: " << posrange.second << ". Size: " << (posrange.second - posrange.first)
@@ -1176,6 +1353,7 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
                 {
                     LOG_verbose << "Conn " << i << " : REQUEST DONE -> REQ_DONE";
                     reqs[i]->status = REQ_DONE;
+                    releaseRequestBuffer(i);
 
                     if (transfer->type == GET)
                     {
@@ -1305,6 +1483,7 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
         {
             m_off_t diff = p - progressreported;
             m_off_t naturalDiff = std::max<m_off_t>(diff, 0);
+            mControlBytes += naturalDiff;
             speed = mTransferSpeed.calculateSpeed(naturalDiff);
             meanSpeed = mTransferSpeed.getMeanSpeed();
             if ((Waiter::ds % 50 == 0) || (diff < 0) || (p > transfer->size)) // every 5s
@@ -1363,6 +1542,7 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
             if (reqs[i] && reqs[i]->status == REQ_INFLIGHT)
             {
                 chunkfailed = true;
+                ++mControlFailures;
                 client->setchunkfailed(&reqs[i]->posturl);
                 reqs[i]->disconnect();
 
@@ -1393,6 +1573,75 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
         retrybt.backoff(backoff);
         retrying = true;  // we don't bother checking the `retrybt` before calling `doio` unless `retrying` is set.
     }
+
+    sampleConnectionController();
+}
+
+int TransferSlot::activeConnections() const
+{
+    return mConnectionController ? static_cast<int>(mConnectionController->connections()) : connections;
+}
+
+bool TransferSlot::reserveRequestBuffer(int connection, m_off_t size)
+{
+    // the buffer of the previous request of the connection is no longer needed
+    releaseRequestBuffer(connection);
+
+    bool first = std::none_of(mBufferReserved.begin(), mBufferReserved.end(), [](m_off_t reserved) { return reserved > 0; });
+    if (!transfer->client->transferBufferBudget.acquire(size, first))
+    {
+        LOG_verbose << "Conn " << connection << " : waiting for room in the transfer buffer budget";
+        return false;
+    }
+
+    mBufferReserved[static_cast<size_t>(connection)] = size;
+    return true;
+}
+
+void TransferSlot::releaseRequestBuffer(int connection)
+{
+    m_off_t& reserved = mBufferReserved[static_cast<size_t>(connection)];
+    transfer->client->transferBufferBudget.release(reserved);
+    reserved = 0;
+}
+
+void TransferSlot::sampleConnectionController()
+{
+    if (!mConnectionController || Waiter::ds < mControlSampleDs + TransferConnectionController::SAMPLE_INTERVAL_DS)
+    {
+        return;
+    }
+
+    // all the transfers share a global limit of connections per direction
+    unsigned inUse = 0;
+    for (auto slot : transfer->client->tslots)
+    {
+        if (slot->transfer->type == transfer->type)
+        {
+            inUse += static_cast<unsigned>(slot->activeConnections());
+        }
+    }
+
+    auto priorConnections = mConnectionController->connections();
+    auto priorRequestSize = mConnectionController->requestSize();
+
+    mConnectionController->sample(mControlBytes,
+                                  mControlFailures,
+                                  mControlRequests ? mControlRequestsDs / mControlRequests : 0,
+                                  inUse < MegaClient::MAXTRANSFERS);
+
+    if (priorConnections != mConnectionController->connections() || priorRequestSize != mConnectionController->requestSize())
+    {
+        LOG_debug << "Transfer connections: " << priorConnections << " -> " << mConnectionController->connections()
+                  << ", request size: " << priorRequestSize << " -> " << mConnectionController->requestSize()
+                  << " [bytes = " << mControlBytes << ", failures = " << mControlFailures << ", requests = " << mControlRequests << "]";
+    }
+
+    mControlSampleDs = Waiter::ds;
+    mControlBytes = 0;
+    mControlFailures = 0;
+    mControlRequestsDs = 0;
+    mControlRequests = 0;
 }
 
 
@@ -1478,6 +1727,119 @@ void TransferSlot::prepareRequest(const std::shared_ptr<HttpReqXfer>& httpReq, c
     httpReq->status = REQ_PREPARED;
 }
 
+void TransferSlot::encryptUploadRequest(const std::shared_ptr<HttpReqXfer>& httpReq, unsigned connectionNum, m_off_t pos, m_off_t npos)
+{
+    string finaltempurl = transferbuf.tempURL(connectionNum);
+    if (transfer->client->usealtupport && !memcmp(finaltempurl.c_str(), "http:", 5))
+    {
+        size_t index = finaltempurl.find("/", 8);
+        if(index != string::npos && finaltempurl.find(":", 8) == string::npos)
+        {
+            finaltempurl.insert(index, ":8080");
+        }
+    }
+
+    auto req = httpReq;    // shared_ptr so no object is deleted out from under the worker
+    auto transferkey = transfer->transferkey;
+    auto ctriv = transfer->ctriv;
+    req->pos = pos;
+    req->status = REQ_ENCRYPTING;
+
+    transfer->client->mAsyncQueue.push([req, transferkey, ctriv, finaltempurl, pos, npos](SymmCipher& sc)
+        {
+            sc.setkey(transferkey.data());
+            req->prepare(finaltempurl.c_str(), &sc, ctriv, pos, npos);
+            req->status = REQ_PREPARED;
+        }, true);   // discardable - if the transfer or client are being destroyed, we won't be sending that data.
+}
+
+void TransferSlot::startUploadPrefetch(unsigned connectionNum)
+{
+    UploadPrefetch& prefetch = mUploadPrefetch[connectionNum];
+    if (prefetch.req || !fa->asyncavailable() || mUploadPrefetchBytes >= MAX_UPLOAD_PREFETCH_BYTES)
+    {
+        return;
+    }
+
+    bool newInputBufferSupplied = false;
+    bool pauseConnectionInputForRaid = false;
+    std::pair<m_off_t, m_off_t> posrange = transferbuf.nextNPosForConnection(connectionNum, maxRequestSize, unsigned(activeConnections()), newInputBufferSupplied, pauseConnectionInputForRaid, transfer->client->httpio->uploadSpeed);
+    if (posrange.second <= posrange.first)
+    {
+        return; // nothing else to read
+    }
+
+    m_off_t pos = posrange.first;
+    unsigned size = (unsigned)(posrange.second - pos);
+
+    prefetch.req = std::make_shared<HttpReqUL>();
+    prefetch.req->logname = transfer->client->clientname + "U" + std::to_string(++transfer->client->transferHttpCounter) + " ";
+    prefetch.req->status = REQ_ASYNCIO;
+    prefetch.req->bwclass = bandwidthClass();
+    prefetch.asyncIO = fa->asyncfread(prefetch.req->out, size, (-(int)size) & (SymmCipher::BLOCKSIZE - 1), pos, FSLogging::logOnError);
+    prefetch.size = size;
+    mUploadPrefetchBytes += size;
+
+    LOG_verbose << "Conn " << connectionNum << " : Reading ahead. Pos: " << pos << " to npos: " << posrange.second << ". Size: " << size
+                << ". Read-ahead bytes: " << mUploadPrefetchBytes;
+    transferbuf.transferPos(connectionNum) = std::max<m_off_t>(transferbuf.transferPos(connectionNum), posrange.second);
+}
+
+bool TransferSlot::processUploadPrefetch(unsigned connectionNum, dstime& backoff)
+{
+    UploadPrefetch& prefetch = mUploadPrefetch[connectionNum];
+    if (!prefetch.asyncIO || !prefetch.asyncIO->finished)
+    {
+        return true;
+    }
+
+    AsyncIOContext* context = prefetch.asyncIO;
+    prefetch.asyncIO = nullptr;
+
+    if (!context->failed)
+    {
+        LOG_verbose << "Conn " << connectionNum << " : Read-ahead succeeded (size: " << context->dataBufferLen << ")";
+        m_off_t pos = context->posOfBuffer;
+        encryptUploadRequest(prefetch.req, connectionNum, pos, pos + context->dataBufferLen);
+        delete context;
+        return true;
+    }
+
+    LOG_warn << "Conn " << connectionNum << " : Read-ahead failed (size: " << context->dataBufferLen << "). Retry: " << context->retry;
+    if (!context->retry)
+    {
+        delete context;
+        return false;
+    }
+
+    // the range is already reserved for this request, read it again
+    m_off_t pos = context->posOfBuffer;
+    unsigned size = context->dataBufferLen;
+    delete context;
+
+    prefetch.asyncIO = fa->asyncfread(prefetch.req->out, size, (-(int)size) & (SymmCipher::BLOCKSIZE - 1), pos, FSLogging::logOnError);
+    lasterror = API_EREAD;
+    backoff = 2;
+    return true;
+}
+
+bool TransferSlot::useUploadPrefetch(unsigned connectionNum)
+{
+    UploadPrefetch& prefetch = mUploadPrefetch[connectionNum];
+    if (!prefetch.req || asyncIO[connectionNum])
+    {
+        return false;
+    }
+
+    LOG_verbose << "Conn " << connectionNum << " : Using the read-ahead request. Status: " << prefetch.req->status;
+    reqs[connectionNum] = std::move(prefetch.req);
+    asyncIO[connectionNum] = prefetch.asyncIO;    // still reading: it continues as REQ_ASYNCIO
+    prefetch.asyncIO = nullptr;
+    mUploadPrefetchBytes -= prefetch.size;
+    prefetch.size = 0;
+    return true;
+}
+
 std::pair<error, dstime> TransferSlot::processRequestFailure(MegaClient* client, const std::shared_ptr<HttpReqXfer>& httpReq, dstime& backoff, int channel)
 {
     LOG_warn << "Conn " << channel << " : Failed chunk. HTTP status: " << httpReq->httpstatus << " [httpReq = " << (void*)httpReq.get() << "]";
@@ -1577,6 +1939,18 @@ std::pair<error, dstime> TransferSlot::processRequestFailure(MegaClient* client,
 }
 
 
+bwclass_t TransferSlot::bandwidthClass() const
+{
+    for (File* f : transfer->files)
+    {
+        if (!f->syncxfer)
+        {
+            return BW_INTERACTIVE;
+        }
+    }
+    return transfer->files.empty() ? BW_INTERACTIVE : BW_BACKGROUND;
+}
+
 bool TransferSlot::initCloudRaid(MegaClient* client)
 {
     assert(transferbuf.isNewRaid());
@@ -84,19 +84,24 @@ void TreeProcApplyKey::proc(MegaClient *client, std::shared_ptr<Node> n)
 
 void TreeProcCopy::allocnodes()
 {
-    nn.resize(nc);
-    allocated = true;
+    if (!allocated)
+    {
+        // the nodes were added children first
+        std::reverse(nn.begin(), nn.end());
+        nc = static_cast<unsigned>(nn.size());
+        allocated = true;
+    }
 }
 
-// determine node tree size (nn = NULL) or write node tree to new nodes array
+// write node tree to new nodes array
 void TreeProcCopy::proc(MegaClient* client, std::shared_ptr<mega::Node> n)
 {
-    if (allocated)
+    if (!allocated)
     {
         string attrstring;
         SymmCipher key;
-        assert(nc > 0);
-        NewNode* t = &nn[--nc];
+        nn.emplace_back();
+        NewNode* t = &nn.back();
 
         // copy node
         t->source = NEW_NODE;
@@ -118,21 +123,24 @@ void TreeProcCopy::proc(MegaClient* client, std::shared_ptr<mega::Node> n)
         {
             key.setkey((const byte*)t->nodekey.data(),n->type);
 
-            AttrMap tattrs;
-            tattrs.map = n->attrs.map;
-            nameid rrname = AttrMap::string2nameid("rr");
-            attr_map::iterator it = tattrs.map.find(rrname);
-            if (it != tattrs.map.end())
+            // the attributes are only copied to drop the rr one
+            static const nameid rrname = AttrMap::string2nameid("rr");
+            if (n->attrs.map.find(rrname) != n->attrs.map.end())
             {
                 LOG_debug << "Removing rr attribute";
-                tattrs.map.erase(it);
+                AttrMap tattrs;
+                tattrs.map = n->attrs.map;
+                tattrs.map.erase(rrname);
+                tattrs.getjson(&attrstring);
+            }
+            else
+            {
+                n->attrs.getjson(&attrstring);
             }
 
-            tattrs.getjson(&attrstring);
             client->makeattr(&key, t->attrstring, attrstring.c_str());
         }
     }
-    else nc++;
 }
 
 #ifdef ENABLE_SYNC
@@ -46,6 +46,21 @@ User::User(const char* cemail)
     memset(&changed, 0, sizeof(changed));
 }
 
+User::~User()
+{
+    if (mClient && mAttrsLoaded)
+    {
+        --mClient->mUsersWithAttrs;
+    }
+}
+
+void User::setClient(MegaClient* client)
+{
+    assert(!mClient);
+    mClient = client;
+    ++mClient->mUsersWithAttrs;
+}
+
 bool User::mergeUserAttribute(attr_t type, const string_map &newValuesMap, TLVstore &tlv)
 {
     bool modified = false;
@@ -91,7 +106,10 @@ bool User::serialize(string* d) const
     // Version 1: attributes are serialized along with its version
     // Version 2: size of attributes use 4B (uint32_t) instead of 2B (unsigned short)
 
+    loadattrs();
+
     d->reserve(d->size() + 100 + attrmap.storagesize(10));
+    const size_t start = d->size();
 
     d->append((char*)&userhandle, sizeof userhandle);
 
@@ -116,6 +134,10 @@ bool User::serialize(string* d) const
     d->append("\0\0\0\0\0", 6);
 
     // serialization of attributes
+    mAttrsOffset = static_cast<uint32_t>(d->size() - start);
+    mAttrsVersion = attrVersion;
+    mAttrsSaved = true;
+
     l = (unsigned char)attrs.size();
     d->append((char*)&l, sizeof l);
     for (userattr_map::const_iterator it = attrs.begin(); it != attrs.end(); it++)
@@ -154,7 +176,6 @@ User* User::unserialize(MegaClient* client, string* d)
     time_t ts;
     visibility_t v;
     unsigned char l;
-    unsigned short ll;
     string m;
     User* u;
     const char* ptr = d->data();
@@ -241,71 +262,37 @@ User* User::unserialize(MegaClient* client, string* d)
     }
     else if (attrVersion == '1' || attrVersion == '2')
     {
-        attr_t key;
-
-        // attrVersion = 1 -> size of value uses 2 bytes
-        // attrVersion = 2 -> size of value uses 4 bytes
-        uint32_t valueSize = 0;
-        size_t sizeLength = (attrVersion == '1') ? sizeof ll : sizeof valueSize;
+        // the attributes of the contacts loaded from the cache are only walked through, until they are used
+        bool lazy = u->mClient && client->sctable && uh != client->me && u->attrs.empty() && u->attrsv.empty();
+        u->mAttrsOffset = static_cast<uint32_t>(ptr - d->data());
+        u->mAttrsVersion = attrVersion;
 
-        if (ptr + sizeof(char) > end)
+        userattr_map attrs, attrsv;
+        if (!readattrs(ptr, end, attrVersion, lazy ? nullptr : &attrs, lazy ? nullptr : &attrsv))
         {
             client->discarduser(uh);
             return NULL;
         }
 
-        l = *ptr++;
-        for (int i = 0; i < l; i++)
+        if (lazy)
         {
-            if (ptr + sizeof key + sizeLength > end)
-            {
-                client->discarduser(uh);
-                return NULL;
-            }
-
-            key = MemAccess::get<attr_t>(ptr);
-            ptr += sizeof key;
-
-            if (attrVersion == '1')
-            {
-                valueSize = MemAccess::get<short>(ptr);
-            }
-            else // attrVersion == '2'
-            {
-                valueSize = MemAccess::get<uint32_t>(ptr);
-            }
-            ptr += sizeLength;
-
-            if (ptr + valueSize + sizeof ll > end)
-            {
-                client->discarduser(uh);
-                return NULL;
-            }
-
-            if (!u->isattrvalid(key))
-            {
-                u->attrs[key].assign(ptr, valueSize);
-            }
-
-            ptr += valueSize;
-
-            ll = MemAccess::get<short>(ptr);
-            ptr += sizeof ll;
-
-            if (ll)
+            u->mAttrsLoaded = false;
+            u->mAttrsSaved = true;
+            --client->mUsersWithAttrs;
+        }
+        else
+        {
+            for (auto& it : attrs)
             {
-                if (ptr + ll > end)
-                {
-                    client->discarduser(uh);
-                    return NULL;
-                }
-
-                if (!u->isattrvalid(key))
+                if (!u->isattrvalid(it.first))
                 {
-                    u->attrsv[key].assign(ptr,ll);
+                    u->attrs[it.first] = std::move(it.second);
+                    auto itv = attrsv.find(it.first);
+                    if (itv != attrsv.end())
+                    {
+                        u->attrsv[it.first] = std::move(itv->second);
+                    }
                 }
-
-                ptr += ll;
             }
         }
     }
@@ -383,6 +370,119 @@ User* User::unserialize(MegaClient* client, string* d)
     return u;
 }
 
+// walks through the attributes of a record, copying them if the maps are given
+bool User::readattrs(const char*& ptr, const char* end, char attrVersion, userattr_map* attrs, userattr_map* attrsv)
+{
+    attr_t key;
+    unsigned short ll;
+
+    // attrVersion = 1 -> size of value uses 2 bytes
+    // attrVersion = 2 -> size of value uses 4 bytes
+    uint32_t valueSize = 0;
+    size_t sizeLength = (attrVersion == '1') ? sizeof ll : sizeof valueSize;
+
+    if (ptr + sizeof(char) > end)
+    {
+        return false;
+    }
+
+    unsigned char l = *ptr++;
+    for (int i = 0; i < l; i++)
+    {
+        if (ptr + sizeof key + sizeLength > end)
+        {
+            return false;
+        }
+
+        key = MemAccess::get<attr_t>(ptr);
+        ptr += sizeof key;
+
+        if (attrVersion == '1')
+        {
+            valueSize = MemAccess::get<short>(ptr);
+        }
+        else // attrVersion == '2'
+        {
+            valueSize = MemAccess::get<uint32_t>(ptr);
+        }
+        ptr += sizeLength;
+
+        if (ptr + valueSize + sizeof ll > end)
+        {
+            return false;
+        }
+
+        if (attrs)
+        {
+            (*attrs)[key].assign(ptr, valueSize);
+        }
+
+        ptr += valueSize;
+
+        ll = MemAccess::get<short>(ptr);
+        ptr += sizeof ll;
+
+        if (ll)
+        {
+            if (ptr + ll > end)
+            {
+                return false;
+            }
+
+            if (attrsv)
+            {
+                (*attrsv)[key].assign(ptr, ll);
+            }
+
+            ptr += ll;
+        }
+    }
+
+    return true;
+}
+
+void User::loadattrs() const
+{
+    if (mClient)
+    {
+        mAttrsLastUse = ++mClient->mUserAttrsClock;
+    }
+
+    if (mAttrsLoaded)
+    {
+        return;
+    }
+
+    mAttrsLoaded = true;
+    ++mClient->mUsersWithAttrs;
+
+    string data;
+    const char* ptr = nullptr;
+    if (!mClient->sctable || !mClient->sctable->get(dbid, &data) || !PaddedCBC::decrypt(&data, &mClient->key)
+            || data.size() < mAttrsOffset || !(ptr = data.data() + mAttrsOffset)
+            || !readattrs(ptr, data.data() + data.size(), mAttrsVersion, &attrs, &attrsv))
+    {
+        LOG_err << "Failed to load the attributes of the user " << uid << " from the cache";
+        attrs.clear();
+        attrsv.clear();
+        mAttrsSaved = false;
+    }
+}
+
+bool User::unloadattrs()
+{
+    if (!mAttrsLoaded || !mAttrsSaved || !mClient || !dbid || userhandle == mClient->me)
+    {
+        return false;
+    }
+
+    attrs.clear();
+    attrsv.clear();
+    mAttrsLoaded = false;
+    --mClient->mUsersWithAttrs;
+    return true;
+}
+
 void User::removepkrs(MegaClient* client)
 {
     while (!pkrs.empty())  // protect any pending pubKey request
@@ -399,6 +499,8 @@ void User::removepkrs(MegaClient* client)
 
 void User::setattr(attr_t at, string *av, string *v)
 {
+    loadattrs();
+    mAttrsSaved = false;
     setChanged(at);
 
     if (at != ATTR_AVATAR)  // avatar is saved to disc
@@ -411,12 +513,16 @@ void User::setattr(attr_t at, string *av, string *v)
 
 void User::invalidateattr(attr_t at)
 {
+    loadattrs();
+    mAttrsSaved = false;
     setChanged(at);
     attrsv.erase(at);
 }
 
 void User::removeattr(attr_t at, const string *version)
 {
+    loadattrs();
+    mAttrsSaved = false;
     if (isattrvalid(at))
     {
         setChanged(at);
@@ -436,6 +542,7 @@ void User::removeattr(attr_t at, const string *version)
 // updates the user attribute value+version only if different
 int User::updateattr(attr_t at, std::string *av, std::string *v)
 {
+    loadattrs();
     if (attrsv[at] == *v)
     {
         return 0;
@@ -447,6 +554,7 @@ int User::updateattr(attr_t at, std::string *av, std::string *v)
 
 bool User::nonExistingAttribute(attr_t at) const
 {
+    loadattrs();
     auto it = attrsv.find(at);
     if (it != attrsv.end() && it->second == NON_EXISTING)
     {
@@ -460,6 +568,8 @@ bool User::nonExistingAttribute(attr_t at) const
 void User::setNonExistingAttribute(attr_t at)
 {
     // Set special value (-9) at attrsv map to indicate that attribute doesn't exist
+    loadattrs();
+    mAttrsSaved = false;
     assert(attrs.find(at) == attrs.end());
     attrsv[at] = NON_EXISTING;
 }
@@ -467,6 +577,7 @@ void User::setNonExistingAttribute(attr_t at)
 // returns the value if there is value (even if it's invalid by now)
 const string * User::getattr(attr_t at)
 {
+    loadattrs();
     userattr_map::const_iterator it = attrs.find(at);
     if (it != attrs.end())
     {
@@ -478,6 +589,7 @@ const string * User::getattr(attr_t at)
 
 bool User::isattrvalid(attr_t at)
 {
+    loadattrs();
     return attrs.count(at) && attrsv.count(at);
 }
 
@@ -1433,6 +1545,7 @@ m_time_t User::getPwdReminderData(int numDetail, const char *data, unsigned int
 
 const string *User::getattrversion(attr_t at)
 {
+    loadattrs();
     userattr_map::iterator it = attrsv.find(at);
     if (it != attrsv.end())
     {
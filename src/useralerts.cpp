@@ -1957,6 +1957,12 @@ void UserAlerts::add(UserAlert::Base* unb)
     // unb is either directly from notification json, or constructed from actionpacket.
     // We take ownership.
 
+    if (mc.lowMemoryMode)
+    {
+        delete unb;
+        return;
+    }
+
     if (provisionalmode)
     {
         provisionals.push_back(unb);
@@ -2827,17 +2833,15 @@ void UserAlerts::purgescalerts() // called from MegaClient::notifypurge()
     LOG_debug << "Notifying " << useralertnotify.size() << " user alerts";
     mc.app->useralerts_updated(&useralertnotify[0], (int)useralertnotify.size());
 
+    // removed alerts are erased at once: bursts of action packets (and the trimming) can remove many of them
+    set<UserAlert::Base*> removedAlerts;
     for (auto a : useralertnotify)
     {
         mc.persistAlert(a); // persist to db (add/update/remove)
 
         if (a->removed())
         {
-            auto it = find(alerts.begin(), alerts.end(), a);
-            assert(it != alerts.end());
-            alerts.erase(it);
-
-            delete a;
+            removedAlerts.insert(a);
         }
         else
         {
@@ -2845,6 +2849,12 @@ void UserAlerts::purgescalerts() // called from MegaClient::notifypurge()
         }
     }
 
+    eraseAlertsFromContainer(alerts, removedAlerts);
+    for (auto a : removedAlerts)
+    {
+        delete a;
+    }
+
     useralertnotify.clear();
 }
 
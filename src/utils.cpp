@@ -47,6 +47,48 @@
 namespace mega {
 
 std::atomic<uint32_t> CancelToken::tokensCancelledCount{0};
+std::mutex CancelToken::recordedCancelsMutex;
+std::deque<std::pair<uint32_t, const void*>> CancelToken::recordedCancels;
+
+void CancelToken::recordCancel(const void* id)
+{
+    lock_guard<std::mutex> g(recordedCancelsMutex);
+    recordedCancels.emplace_back(++tokensCancelledCount, id);
+    if (recordedCancels.size() > MAX_RECORDED_CANCELS)
+    {
+        recordedCancels.pop_front();
+    }
+}
+
+bool CancelToken::haveAnyCancelsOccurredSince(uint32_t& lastKnownCancelCount, vector<const void*>& ids)
+{
+    ids.clear();
+
+    lock_guard<std::mutex> g(recordedCancelsMutex);
+    uint32_t count = tokensCancelledCount.load();
+    uint32_t cancels = count - lastKnownCancelCount;
+    if (!cancels)
+    {
+        return false;
+    }
+    lastKnownCancelCount = count;
+
+    if (cancels > recordedCancels.size())
+    {
+        return true;
+    }
+
+    for (auto it = recordedCancels.end() - cancels; it != recordedCancels.end(); it++)
+    {
+        if (!it->second)
+        {
+            ids.clear();
+            return true;
+        }
+        ids.push_back(it->second);
+    }
+    return true;
+}
 
 string toNodeHandle(handle nodeHandle)
 {
@@ -186,6 +228,15 @@ CacheableWriter::CacheableWriter(string& d)
 {
 }
 
+void CacheableWriter::reserve(size_t len)
+{
+    // keep the geometric growth when serializing several records into the same string
+    if (dest.capacity() - dest.size() < len)
+    {
+        dest.reserve(std::max(dest.size() + len, 2 * dest.capacity()));
+    }
+}
+
 void CacheableWriter::serializebinary(byte* data, size_t len)
 {
     dest.append((char*)data, len);
@@ -316,6 +367,13 @@ CacheableReader::CacheableReader(const string& d)
 {
 }
 
+CacheableReader::CacheableReader(const char* data, size_t len)
+    : ptr(data)
+    , end(data + len)
+    , fieldnum(0)
+{
+}
+
 void CacheableReader::eraseused(string& d)
 {
     assert(end == d.data() + d.size());
@@ -323,6 +381,53 @@ void CacheableReader::eraseused(string& d)
 }
 
 bool CacheableReader::unserializecstr(string& s, bool removeNull)
+{
+    std::string_view v;
+    if (!unserializecstr(v, removeNull))
+    {
+        return false;
+    }
+
+    // empty fields leave the string untouched
+    if (v.data())
+    {
+        s.assign(v.data(), v.size());
+    }
+    return true;
+}
+
+bool CacheableReader::unserializestring(string& s)
+{
+    std::string_view v;
+    if (!unserializestring(v))
+    {
+        return false;
+    }
+
+    if (v.data())
+    {
+        s.assign(v.data(), v.size());
+    }
+    return true;
+}
+
+bool CacheableReader::unserializestring_u32(string& s)
+{
+    std::string_view v;
+    if (!unserializestring_u32(v))
+    {
+        return false;
+    }
+
+    if (v.data())
+    {
+        s.assign(v.data(), v.size());
+    }
+    return true;
+}
+
+// the views of empty fields have no data, the others point into the source
+bool CacheableReader::unserializecstr(std::string_view& s, bool removeNull)
 {
     if (ptr + sizeof(unsigned short) > end)
     {
@@ -337,17 +442,13 @@ bool CacheableReader::unserializecstr(string& s, bool removeNull)
         return false;
     }
 
-    if (len)
-    {
-        s.assign(ptr, len - (removeNull ? 1 : 0));
-    }
+    s = len ? std::string_view(ptr, len - (removeNull ? 1 : 0)) : std::string_view();
     ptr += len;
     fieldnum += 1;
     return true;
 }
 
-
-bool CacheableReader::unserializestring(string& s)
+bool CacheableReader::unserializestring(std::string_view& s)
 {
     if (ptr + sizeof(unsigned short) > end)
     {
@@ -362,16 +463,13 @@ bool CacheableReader::unserializestring(string& s)
         return false;
     }
 
-    if (len)
-    {
-        s.assign(ptr, len);
-    }
+    s = len ? std::string_view(ptr, len) : std::string_view();
     ptr += len;
     fieldnum += 1;
     return true;
 }
 
-bool CacheableReader::unserializestring_u32(string& s)
+bool CacheableReader::unserializestring_u32(std::string_view& s)
 {
     if (ptr + sizeof(uint32_t) > end)
     {
@@ -381,15 +479,12 @@ bool CacheableReader::unserializestring_u32(string& s)
     uint32_t len = MemAccess::get<uint32_t>(ptr);
     ptr += sizeof(len);
 
-    if (ptr + len > end)
+    if (static_cast<size_t>(end - ptr) < len)
     {
         return false;
     }
 
-    if (len)
-    {
-        s.assign(ptr, len);
-    }
+    s = len ? std::string_view(ptr, len) : std::string_view();
     ptr += len;
     fieldnum += 1;
     return true;
@@ -411,8 +506,21 @@ bool CacheableReader::unserializebinary(byte* data, size_t len)
 
 void chunkmac_map::serialize(string& d) const
 {
-    unsigned short ll = (unsigned short)size();
-    d.append((char*)&ll, sizeof(ll));
+    // the count used to be 16 bits, which truncated the MACs of huge downloads with many out-of-order pieces.
+    // Bigger counts are stored as 32 bits after a 0xFFFF marker
+    if (size() < 0xFFFF)
+    {
+        unsigned short ll = (unsigned short)size();
+        d.append((char*)&ll, sizeof(ll));
+    }
+    else
+    {
+        unsigned short marker = 0xFFFF;
+        uint32_t ll = static_cast<uint32_t>(size());
+        d.append((char*)&marker, sizeof(marker));
+        d.append((char*)&ll, sizeof(ll));
+    }
+
     for (auto& it : mMacMap)
     {
         d.append((char*)&it.first, sizeof(it.first));
@@ -420,17 +528,57 @@ void chunkmac_map::serialize(string& d) const
     }
 }
 
-bool chunkmac_map::unserialize(const char*& ptr, const char* end)
+// reads the number of serialized MACs, checking that they are all there
+static bool unserializeMacCount(const char*& ptr, const char* end, size_t recordSize, size_t& ll)
+{
+    if (ptr + sizeof(unsigned short) > end)
+    {
+        return false;
+    }
+
+    ll = MemAccess::get<unsigned short>(ptr);
+    size_t countSize = sizeof(unsigned short);
+    if (ll == 0xFFFF)
+    {
+        if (ptr + countSize + sizeof(uint32_t) > end)
+        {
+            return false;
+        }
+
+        ll = MemAccess::get<uint32_t>(ptr + countSize);
+        countSize += sizeof(uint32_t);
+    }
+
+    if (ll > static_cast<size_t>(end - ptr - countSize) / recordSize)
+    {
+        return false;
+    }
+
+    ptr += countSize;
+    return true;
+}
+
+bool chunkmac_map::skip(const char*& ptr, const char* end)
 {
-    unsigned short ll;
-    if ((ptr + sizeof(ll) > end) || ptr + (ll = MemAccess::get<unsigned short>(ptr)) * (sizeof(m_off_t) + sizeof(ChunkMAC)) + sizeof(ll) > end)
+    size_t ll;
+    if (!unserializeMacCount(ptr, end, sizeof(m_off_t) + sizeof(ChunkMAC), ll))
     {
         return false;
     }
 
-    ptr += sizeof(ll);
+    ptr += ll * (sizeof(m_off_t) + sizeof(ChunkMAC));
+    return true;
+}
+
+bool chunkmac_map::unserialize(const char*& ptr, const char* end)
+{
+    size_t ll;
+    if (!unserializeMacCount(ptr, end, sizeof(m_off_t) + sizeof(ChunkMAC), ll))
+    {
+        return false;
+    }
 
-    for (int i = 0; i < ll; i++)
+    for (size_t i = 0; i < ll; i++)
     {
         m_off_t pos = MemAccess::get<m_off_t>(ptr);
         ptr += sizeof(m_off_t);
@@ -763,6 +911,18 @@ bool CacheableReader::unserializechunkmacs(chunkmac_map& m)
     return false;
 }
 
+bool CacheableReader::unserializechunkmacs(std::string_view& data)
+{
+    const char* start = ptr;
+    if (chunkmac_map::skip(ptr, end))   // ptr is adjusted by reference
+    {
+        data = std::string_view(start, static_cast<size_t>(ptr - start));
+        fieldnum += 1;
+        return true;
+    }
+    return false;
+}
+
 bool CacheableReader::unserializefingerprint(FileFingerprint& fp)
 {
     if (auto newfp = fp.unserialize(ptr, end))   // ptr is adjusted by reference
@@ -1639,8 +1799,40 @@ size_t Utils::utf8SequenceSize(unsigned char c)
     }
 }
 
+bool Utils::isAscii(const string& text)
+{
+    const char* p = text.data();
+    size_t n = text.size();
+    uint64_t bits = 0;
+
+    // 8 bytes at a time
+    for (; n >= 8; p += 8, n -= 8)
+    {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        bits |= word;
+    }
+
+    for (; n; --n)
+    {
+        bits |= static_cast<unsigned char>(*p++);
+    }
+
+    return !(bits & 0x8080808080808080ull);
+}
+
 string  Utils::toUpperUtf8(const string& text)
 {
+    if (isAscii(text))
+    {
+        string result(text);
+        for (char& c : result)
+        {
+            if (c >= 'a' && c <= 'z') c = static_cast<char>(c - 'a' + 'A');
+        }
+        return result;
+    }
+
     string result;
 
     auto n = utf8proc_ssize_t(text.size());
@@ -1669,6 +1861,16 @@ string  Utils::toUpperUtf8(const string& text)
 
 string  Utils::toLowerUtf8(const string& text)
 {
+    if (isAscii(text))
+    {
+        string result(text);
+        for (char& c : result)
+        {
+            if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+        }
+        return result;
+    }
+
     string result;
 
     auto n = utf8proc_ssize_t(text.size());
@@ -2631,34 +2833,103 @@ bool CompareLocalFileMetaMacWithNode(FileAccess* fa, Node* node)
     return CompareLocalFileMetaMacWithNodeKey(fa, node->nodekey(), node->type);
 }
 
-void MegaClientAsyncQueue::push(std::function<void(SymmCipher&)> f, bool discardable)
+void MegaClientAsyncQueue::push(std::function<void(SymmCipher&)> f, bool discardable, Priority priority)
 {
+    assert(f && priority < NUM_PRIORITIES);
     if (mThreads.empty())
     {
-        if (f)
-        {
-            f(mZeroThreadsCipher);
-        }
+        f(mZeroThreadsCipher);
     }
     else
     {
         {
             std::lock_guard<std::mutex> g(mMutex);
-            mQueue.emplace_back(discardable, std::move(f));
+            mQueues[priority].emplace_back(discardable, std::move(f));
         }
         mConditionVariable.notify_one();
     }
 }
 
+void MegaClientAsyncQueue::runBatches(size_t count, size_t batchSize, std::function<void(size_t begin, size_t end, SymmCipher&)> f)
+{
+    assert(batchSize);
+    if (!count)
+    {
+        return;
+    }
+
+    if (mThreads.empty())
+    {
+        for (size_t begin = 0; begin < count; begin += batchSize)
+        {
+            f(begin, std::min(begin + batchSize, count), mZeroThreadsCipher);
+        }
+        return;
+    }
+
+    // The batches are claimed one by one by the workers and by this thread, so they're done even if
+    // no worker gets free meanwhile (ie. the workers may wait for a lock held by the caller).
+    // Workers starting once all of them are claimed leave without touching 'f', which may be gone
+    struct Batches
+    {
+        std::function<void(size_t begin, size_t end, SymmCipher&)>* f = nullptr;
+        size_t count = 0;
+        size_t batchSize = 0;
+        size_t numBatches = 0;
+        std::atomic<size_t> next{0};
+        std::mutex mutex;
+        std::condition_variable cv;
+        size_t done = 0;
+
+        void run(SymmCipher& cipher)
+        {
+            for (size_t i = next++; i < numBatches; i = next++)
+            {
+                size_t begin = i * batchSize;
+                (*f)(begin, std::min(begin + batchSize, count), cipher);
+
+                std::lock_guard<std::mutex> g(mutex);
+                if (++done == numBatches)
+                {
+                    cv.notify_one();
+                }
+            }
+        }
+    };
+
+    auto batches = std::make_shared<Batches>();
+    batches->f = &f;
+    batches->count = count;
+    batches->batchSize = batchSize;
+    batches->numBatches = (count + batchSize - 1) / batchSize;
+
+    for (size_t i = std::min(mThreads.size(), batches->numBatches) - 1; i--; )
+    {
+        push([batches](SymmCipher& cipher) { batches->run(cipher); }, false, INTERACTIVE);
+    }
+
+    SymmCipher cipher;
+    batches->run(cipher);
+
+    std::unique_lock<std::mutex> g(batches->mutex);
+    batches->cv.wait(g, [&batches]() { return batches->done == batches->numBatches; });
+}
+
 MegaClientAsyncQueue::MegaClientAsyncQueue(Waiter& w, unsigned threadCount)
     : mWaiter(w)
 {
-    for (int i = threadCount; i--; )
+    if (threadCount == THREADS_PER_CORE)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned i = threadCount; i--; )
     {
         try
         {
             mThreads.emplace_back([this]()
             {
+                TRACE_THREAD_NAME("transfer");
                 asyncThreadLoop();
             });
         }
@@ -2674,7 +2945,11 @@ MegaClientAsyncQueue::MegaClientAsyncQueue(Waiter& w, unsigned threadCount)
 MegaClientAsyncQueue::~MegaClientAsyncQueue()
 {
     clearDiscardable();
-    push(nullptr, false);
+    {
+        // the threads exit once the rest of the queued operations are done
+        std::lock_guard<std::mutex> g(mMutex);
+        mExit = true;
+    }
     mConditionVariable.notify_all();
     LOG_warn << "~MegaClientAsyncQueue() joining threads";
     for (auto& t : mThreads)
@@ -2687,8 +2962,11 @@ MegaClientAsyncQueue::~MegaClientAsyncQueue()
 void MegaClientAsyncQueue::clearDiscardable()
 {
     std::lock_guard<std::mutex> g(mMutex);
-    auto newEnd = std::remove_if(mQueue.begin(), mQueue.end(), [](Entry& entry){ return entry.discardable; });
-    mQueue.erase(newEnd, mQueue.end());
+    for (auto& queue : mQueues)
+    {
+        auto newEnd = std::remove_if(queue.begin(), queue.end(), [](Entry& entry){ return entry.discardable; });
+        queue.erase(newEnd, queue.end());
+    }
 }
 
 void MegaClientAsyncQueue::asyncThreadLoop()
@@ -2699,13 +2977,28 @@ void MegaClientAsyncQueue::asyncThreadLoop()
         std::function<void(SymmCipher&)> f;
         {
             std::unique_lock<std::mutex> g(mMutex);
-            mConditionVariable.wait(g, [this]() { return !mQueue.empty(); });
-            assert(!mQueue.empty());
-            f = std::move(mQueue.front().f);
-            if (!f) return;   // nullptr is not popped, and causes all the threads to exit
-            mQueue.pop_front();
+            std::deque<Entry>* queue = nullptr;
+            mConditionVariable.wait(g, [this, &queue]()
+            {
+                for (auto& q : mQueues)
+                {
+                    if (!q.empty())
+                    {
+                        queue = &q;
+                        return true;
+                    }
+                }
+                return mExit;
+            });
+
+            if (!queue) return;   // exiting, and nothing left to do
+            f = std::move(queue->front().f);
+            queue->pop_front();
+        }
+        {
+            TRACE_SPAN("MegaClientAsyncQueue_job");
+            f(cipher);
         }
-        f(cipher);
         mWaiter.notify();
     }
 }
@@ -3447,6 +3740,45 @@ int icuLikeCompare(const uint8_t *zPattern,   // LIKE pattern
     return *zString == 0;
 }
 
+std::string foldCaseUtf8(const std::string& value)
+{
+    std::string folded;
+    folded.reserve(value.size());
+
+    const uint8_t* z = reinterpret_cast<const uint8_t*>(value.c_str());
+    while (*z)
+    {
+        uint32_t c;
+        SQLITE_ICU_READ_UTF8(z, c);
+        c = static_cast<uint32_t>(u_foldCase(static_cast<UChar32>(c), U_FOLD_CASE_DEFAULT));
+
+        if (c < 0x80)
+        {
+            folded.push_back(static_cast<char>(c));
+        }
+        else if (c < 0x800)
+        {
+            folded.push_back(static_cast<char>(0xC0 | (c >> 6)));
+            folded.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+        }
+        else if (c < 0x10000)
+        {
+            folded.push_back(static_cast<char>(0xE0 | (c >> 12)));
+            folded.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+            folded.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+        }
+        else
+        {
+            folded.push_back(static_cast<char>(0xF0 | ((c >> 18) & 0x07)));
+            folded.push_back(static_cast<char>(0x80 | ((c >> 12) & 0x3F)));
+            folded.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+            folded.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+        }
+    }
+
+    return folded;
+}
+
 // Get the current process ID
 unsigned long getCurrentPid()
 {
@@ -3648,5 +3980,60 @@ int naturalsorting_compare(const char* i, const char* j)
     return 0;
 }
 
+std::string naturalsorting_key(const char* s)
+{
+    // Same limit as naturalsorting_compare(): numbers are compared by the count of overflows
+    // first, and then by the rest of the value
+    static uint64_t maxNumber = (ULONG_MAX - 57) / 10; // 57 --> ASCII code for '9'
+
+    // Digits sort before any other char, so a number is 0x01 0x00 followed by its fixed-size
+    // value, and the char 0x01 (if any) is escaped as 0x01 0xFF. Other chars are lowercased
+    std::string key;
+    while (*s)
+    {
+        if (!is_digit(*s))
+        {
+            unsigned char c = static_cast<unsigned char>(*s++);
+            if (c == 0x01)
+            {
+                key.push_back('\x01');
+                key.push_back('\xFF');
+            }
+            else
+            {
+                key.push_back(static_cast<char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c));
+            }
+            continue;
+        }
+
+        uint64_t number = 0;
+        uint32_t overflowCount = 0;
+        while (*s && is_digit(*s))
+        {
+            number = number * 10 + static_cast<uint64_t>(*s - 48); // '0' ASCII code is 48
+            ++s;
+
+            if (number >= maxNumber)
+            {
+                number -= maxNumber;
+                overflowCount++;
+            }
+        }
+
+        key.push_back('\x01');
+        key.push_back('\x00');
+        for (int shift = 24; shift >= 0; shift -= 8)
+        {
+            key.push_back(static_cast<char>((overflowCount >> shift) & 0xFF));
+        }
+        for (int shift = 56; shift >= 0; shift -= 8)
+        {
+            key.push_back(static_cast<char>((number >> shift) & 0xFF));
+        }
+    }
+
+    return key;
+}
+
 } // namespace mega
 
@@ -365,6 +365,22 @@ bool WinFileAccess::ftruncate(m_off_t size)
     return false;
 }
 
+bool WinFileAccess::fpreallocate(m_off_t size)
+{
+    // the clusters are reserved without moving the end of the file.
+    // SetFileValidData() is not used: it needs a privilege and would expose the stale data of the disk
+    FILE_ALLOCATION_INFO info;
+    info.AllocationSize.QuadPart = size;
+
+    if (SetFileInformationByHandle(hFile, FileAllocationInfo, &info, sizeof(info)))
+    {
+        return true;
+    }
+
+    LOG_debug << "Preallocation not available. Error: " << GetLastError();
+    return false;
+}
+
 m_time_t FileTime_to_POSIX(FILETIME* ft)
 {
     LARGE_INTEGER date;
@@ -499,7 +515,7 @@ void WinFileAccess::sysclose()
 
 WinAsyncIOContext::WinAsyncIOContext() : AsyncIOContext()
 {
-    overlapped = NULL;
+    memset(&overlapped, 0, sizeof (OVERLAPPED));
 }
 
 WinAsyncIOContext::~WinAsyncIOContext()
@@ -510,7 +526,7 @@ WinAsyncIOContext::~WinAsyncIOContext()
 
 void WinAsyncIOContext::finish()
 {
-    if (overlapped)
+    if (pending)
     {
         if (!finished)
         {
@@ -518,12 +534,21 @@ void WinAsyncIOContext::finish()
             AsyncIOContext::finish();
         }
 
-        delete overlapped;
-        overlapped = NULL;
+        pending = false;
     }
     assert(finished);
 }
 
+OVERLAPPED* WinAsyncIOContext::prepareoverlapped()
+{
+    memset(&overlapped, 0, sizeof (OVERLAPPED));
+    overlapped.Offset = posOfBuffer & 0xFFFFFFFF;
+    overlapped.OffsetHigh = (posOfBuffer >> 32) & 0xFFFFFFFF;
+    overlapped.hEvent = this;
+    pending = true;
+    return &overlapped;
+}
+
 AsyncIOContext *WinFileAccess::newasynccontext()
 {
     return new WinAsyncIOContext();
@@ -531,6 +556,7 @@ AsyncIOContext *WinFileAccess::newasynccontext()
 
 VOID WinFileAccess::asyncopfinished(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfered, LPOVERLAPPED lpOverlapped)
 {
+    // ReadFileEx/WriteFileEx leave hEvent to the caller: it points back to the context holding the OVERLAPPED
     WinAsyncIOContext *context = (WinAsyncIOContext *)(lpOverlapped->hEvent);
     context->failed = dwErrorCode || dwNumberOfBytesTransfered != context->dataBufferLen;
     if (!context->failed)
@@ -597,13 +623,7 @@ void WinFileAccess::asyncsysread(AsyncIOContext *context)
         return;
     }
 
-    OVERLAPPED *overlapped = new OVERLAPPED;
-    memset(overlapped, 0, sizeof (OVERLAPPED));
-
-    overlapped->Offset = winContext->posOfBuffer & 0xFFFFFFFF;
-    overlapped->OffsetHigh = (winContext->posOfBuffer >> 32) & 0xFFFFFFFF;
-    overlapped->hEvent = winContext;
-    winContext->overlapped = overlapped;
+    OVERLAPPED *overlapped = winContext->prepareoverlapped();
 
     if (!ReadFileEx(hFile, winContext->dataBuffer, (DWORD)winContext->dataBufferLen,
                    overlapped, asyncopfinished))
@@ -612,8 +632,7 @@ void WinFileAccess::asyncsysread(AsyncIOContext *context)
         winContext->retry = WinFileSystemAccess::istransient(e);
         winContext->failed = true;
         winContext->finished = true;
-        winContext->overlapped = NULL;
-        delete overlapped;
+        winContext->pending = false;
 
         LOG_warn << "Async read failed at startup: " << e;
         if (winContext->userCallback)
@@ -643,12 +662,7 @@ void WinFileAccess::asyncsyswrite(AsyncIOContext *context)
         return;
     }
 
-    OVERLAPPED *overlapped = new OVERLAPPED;
-    memset(overlapped, 0, sizeof (OVERLAPPED));
-    overlapped->Offset = winContext->posOfBuffer & 0xFFFFFFFF;
-    overlapped->OffsetHigh = (winContext->posOfBuffer >> 32) & 0xFFFFFFFF;
-    overlapped->hEvent = winContext;
-    winContext->overlapped = overlapped;
+    OVERLAPPED *overlapped = winContext->prepareoverlapped();
 
     if (!WriteFileEx(hFile, winContext->dataBuffer, (DWORD)winContext->dataBufferLen,
                    overlapped, asyncopfinished))
@@ -657,8 +671,7 @@ void WinFileAccess::asyncsyswrite(AsyncIOContext *context)
         winContext->retry = WinFileSystemAccess::istransient(e);
         winContext->failed = true;
         winContext->finished = true;
-        winContext->overlapped = NULL;
-        delete overlapped;
+        winContext->pending = false;
 
         LOG_warn << "Async write failed at startup: "  << e;
         if (winContext->userCallback)
@@ -1451,34 +1464,46 @@ void WinDirNotify::process(DWORD dwBytes)
     {
         // No bytes delivered indicates the OS could not deliver some notifications.
         // Maybe it ran out of buffer (maybe we were too slow)
-        // Incrementing mErrorCount will cause a full rescan of the sync
-        // We used to send an additional notification with localnode and empty path to
-        // trigger it but that is not needed anymore
-
-        int errCount = ++mErrorCount;
-        LOG_err << "Empty filesystem notification: " << (localrootnode ? localrootnode->localname.toPath(false).c_str() : "NULL")
-                << " errors: " << errCount;
-
-        // reissue request for notifications
+        // reissue request for notifications first, so that nothing else is missed
         readchanges();
-    }
-    else
-    {
-        assert(dwBytes >= offsetof(FILE_NOTIFY_INFORMATION, FileName)); // 3 uint32_t.  The filename can be entirely absent, with the filename length field 0  (via samba share from qnap device)
 
-        string processbuf;
-        if (dwBytes <= 4096)
+        // The USN journal has the lost changes: queue them, rather than rescanning the whole sync
+        if (recoverFromJournal())
         {
-            processbuf = notifybuf;  // even under high load, usually the buffer is under 4k.
+            LOG_warn << "Empty filesystem notification: " << (localrootnode ? localrootnode->localname.toPath(false).c_str() : "NULL")
+                     << " recovered from the USN journal";
         }
         else
         {
-            processbuf.swap(notifybuf);  // use existing buffer, a new one will be allocated for receiving
+            // Incrementing mErrorCount will cause a full rescan of the sync
+            // We used to send an additional notification with localnode and empty path to
+            // trigger it but that is not needed anymore
+            int errCount = ++mErrorCount;
+            LOG_err << "Empty filesystem notification: " << (localrootnode ? localrootnode->localname.toPath(false).c_str() : "NULL")
+                    << " errors: " << errCount;
         }
+    }
+    else
+    {
+        assert(dwBytes >= offsetof(FILE_NOTIFY_INFORMATION, FileName)); // 3 uint32_t.  The filename can be entirely absent, with the filename length field 0  (via samba share from qnap device)
+
+        // the buffers take turns: the OS fills one while the other is processed,
+        // without copying them or allocating a new one
+        processbuf.swap(notifybuf);
         char* ptr = (char*)processbuf.data();
 
         readchanges();
 
+        // the changes journaled before the previous batch have all been notified by now
+        if (hVolume != INVALID_HANDLE_VALUE)
+        {
+            uint64_t nextUsn;
+            if (queryJournal(nextUsn))
+            {
+                mLastUsn = mPendingUsn.exchange(nextUsn);
+            }
+        }
+
         // ensure accuracy of the notification timestamps
 		WAIT_CLASS::bumpds();
 
@@ -1594,10 +1619,209 @@ void WinDirNotify::notifierThreadFunction()
     LOG_debug << "Filesystem notify thread stopped";
 }
 
+bool WinDirNotify::openJournal(const std::wstring& path)
+{
+    // Which volume is the sync on?
+    wchar_t mountPoint[MAX_PATH + 1];
+    wchar_t volumeName[MAX_PATH + 1];
+    DWORD serialNumber = 0;
+
+    if (!GetVolumePathNameW(path.c_str(), mountPoint, MAX_PATH + 1)
+        || !GetVolumeNameForVolumeMountPointW(mountPoint, volumeName, MAX_PATH + 1)
+        || !GetVolumeInformationW(mountPoint, nullptr, 0, &serialNumber, nullptr, nullptr, nullptr, 0))
+    {
+        return false;
+    }
+
+    // The volume itself is opened without the trailing separator.
+    std::wstring volume(volumeName);
+    if (!volume.empty() && volume.back() == L'\\')
+    {
+        volume.pop_back();
+    }
+
+    hVolume = CreateFileW(volume.c_str(),
+                          GENERIC_READ,
+                          FILE_SHARE_READ | FILE_SHARE_WRITE,
+                          NULL,
+                          OPEN_EXISTING,
+                          0,
+                          NULL);
+
+    if (hVolume == INVALID_HANDLE_VALUE)
+    {
+        LOG_debug << "USN journal not available for " << localbasepath << ". Error: " << GetLastError();
+        return false;
+    }
+
+    USN_JOURNAL_DATA_V0 data;
+    DWORD bytes = 0;
+
+    if (!DeviceIoControl(hVolume, FSCTL_QUERY_USN_JOURNAL, nullptr, 0, &data, sizeof(data), &bytes, nullptr))
+    {
+        LOG_debug << "USN journal not active for " << localbasepath << ". Error: " << GetLastError();
+        CloseHandle(hVolume);
+        hVolume = INVALID_HANDLE_VALUE;
+        return false;
+    }
+
+    // The journal ID changes whenever the journal is recreated, and USNs from another one mean nothing.
+    mJournalID = std::to_string(serialNumber) + ":" + std::to_string(data.UsnJournalID);
+    return true;
+}
+
+bool WinDirNotify::queryJournal(uint64_t& nextUsn)
+{
+    USN_JOURNAL_DATA_V0 data;
+    DWORD bytes = 0;
+
+    if (!DeviceIoControl(hVolume, FSCTL_QUERY_USN_JOURNAL, nullptr, 0, &data, sizeof(data), &bytes, nullptr)
+        || mJournalID.substr(mJournalID.find(':') + 1) != std::to_string(data.UsnJournalID))
+    {
+        return false;
+    }
+
+    nextUsn = static_cast<uint64_t>(data.NextUsn);
+    return true;
+}
+
+bool WinDirNotify::replayJournal(uint64_t fromUsn, uint64_t toUsn)
+{
+    USN_JOURNAL_DATA_V0 journal;
+    DWORD bytes = 0;
+
+    if (!DeviceIoControl(hVolume, FSCTL_QUERY_USN_JOURNAL, nullptr, 0, &journal, sizeof(journal), &bytes, nullptr))
+    {
+        return false;
+    }
+
+    // Records older than the journal's start have been discarded, so some changes would be missed.
+    if (fromUsn < static_cast<uint64_t>(journal.FirstUsn))
+    {
+        LOG_debug << "USN journal no longer has the changes since " << fromUsn << " for " << localbasepath;
+        return false;
+    }
+
+    READ_USN_JOURNAL_DATA_V0 request{};
+    request.StartUsn = static_cast<USN>(fromUsn);
+    request.ReasonMask = 0xFFFFFFFF;
+    request.UsnJournalID = journal.UsnJournalID;
+
+    // The changed paths, by the file ID of their folder.  There are several records per change.
+    map<DWORDLONG, set<std::wstring>> changes;
+    std::vector<char> buffer(65536);
+    size_t numRecords = 0;
+
+    while (static_cast<uint64_t>(request.StartUsn) < toUsn)
+    {
+        if (!DeviceIoControl(hVolume, FSCTL_READ_USN_JOURNAL, &request, sizeof(request),
+                             buffer.data(), static_cast<DWORD>(buffer.size()), &bytes, nullptr))
+        {
+            LOG_debug << "USN journal unreadable at " << request.StartUsn << " for " << localbasepath << ". Error: " << GetLastError();
+            return false;
+        }
+
+        if (bytes <= sizeof(USN))
+        {
+            break;
+        }
+
+        DWORD offset = sizeof(USN);
+        while (offset < bytes)
+        {
+            auto record = reinterpret_cast<const USN_RECORD_V2*>(buffer.data() + offset);
+
+            if (record->MajorVersion == 2 && static_cast<uint64_t>(record->Usn) < toUsn)
+            {
+                auto name = reinterpret_cast<const wchar_t*>(reinterpret_cast<const char*>(record) + record->FileNameOffset);
+                changes[record->ParentFileReferenceNumber].emplace(name, record->FileNameLength / sizeof(wchar_t));
+                ++numRecords;
+            }
+
+            offset += record->RecordLength;
+        }
+
+        request.StartUsn = *reinterpret_cast<const USN*>(buffer.data());
+    }
+
+    // Queue the changes below the sync root, as if they had been notified now.
+    size_t numQueued = 0;
+    for (auto& folder : changes)
+    {
+        FILE_ID_DESCRIPTOR id{};
+        id.dwSize = sizeof(id);
+        id.Type = FileIdType;
+        id.FileId.QuadPart = static_cast<LONGLONG>(folder.first);
+
+        HANDLE h = OpenFileById(hDirectory, &id, FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, FILE_FLAG_BACKUP_SEMANTICS);
+        if (h == INVALID_HANDLE_VALUE)
+        {
+            // removed since, its parent has a record of that
+            continue;
+        }
+
+        std::wstring folderPath(MAX_PATH, L'\0');
+        DWORD length = GetFinalPathNameByHandleW(h, &folderPath[0], static_cast<DWORD>(folderPath.size()), FILE_NAME_NORMALIZED | VOLUME_NAME_DOS);
+        if (length >= folderPath.size())
+        {
+            folderPath.resize(length);
+            length = GetFinalPathNameByHandleW(h, &folderPath[0], static_cast<DWORD>(folderPath.size()), FILE_NAME_NORMALIZED | VOLUME_NAME_DOS);
+        }
+        CloseHandle(h);
+
+        if (!length || length >= folderPath.size())
+        {
+            continue;
+        }
+        folderPath.resize(length);
+
+        if (!folderPath.compare(0, 4, L"\\\\?\\"))
+        {
+            folderPath.erase(0, 4);
+        }
+
+        auto localFolder = LocalPath::fromPlatformEncodedAbsolute(std::move(folderPath));
+        size_t subpathIndex = 0;
+        if (!localbasepath.isContainingPathOf(localFolder, &subpathIndex))
+        {
+            continue;
+        }
+
+        auto relativeFolder = localFolder.subpathFrom(subpathIndex);
+        for (auto& name : folder.second)
+        {
+            auto path = relativeFolder;
+            path.appendWithSeparator(LocalPath::fromPlatformEncodedRelative(std::wstring(name)), false);
+            notify(fsEventq, localrootnode, Notification::NEEDS_PARENT_SCAN, std::move(path));
+            ++numQueued;
+        }
+    }
+
+    LOG_debug << "Replayed " << numQueued << " changes from " << numRecords << " USN journal records for " << localbasepath;
+    return true;
+}
+
+bool WinDirNotify::recoverFromJournal()
+{
+    assert( std::this_thread::get_id() == smNotifierThread->get_id());
+
+    // the changes since the last complete batch of notifications may have been lost
+    uint64_t nextUsn;
+    if (hVolume == INVALID_HANDLE_VALUE || !queryJournal(nextUsn) || !replayJournal(mLastUsn, nextUsn))
+    {
+        return false;
+    }
+
+    mPendingUsn = nextUsn;
+    mLastUsn = nextUsn;
+    return true;
+}
+
 WinDirNotify::WinDirNotify(LocalNode& root,
                            const LocalPath& rootPath,
                            WinFileSystemAccess* owner,
-                           Waiter* waiter)
+                           Waiter* waiter,
+                           const ResumePoint& resumeFrom)
   : DirNotify(rootPath)
 {
     assert(rootPath.isAbsolute());
@@ -1653,6 +1877,9 @@ WinDirNotify::WinDirNotify(LocalNode& root,
     {
         setFailed(0, "");
 
+        // Before the notifications start, as they advance the journal position.
+        bool journaled = openJournal(longname);
+
         // So we know when we've asked the system for directory notifications.
         std::promise<void> requested;
 
@@ -1673,6 +1900,24 @@ WinDirNotify::WinDirNotify(LocalNode& root,
 
         // Wait until the notification thread has processed our request.
         requested.get_future().get();
+
+        // Changes from now on are notified, those since the last run are in the journal.
+        uint64_t nextUsn;
+        if (journaled && queryJournal(nextUsn))
+        {
+            if (resumeFrom.mEventID && resumeFrom.mJournalID == mJournalID && resumeFrom.mEventID <= nextUsn)
+            {
+                LOG_debug << "Resuming filesystem events for "
+                          << rootPath
+                          << " from USN "
+                          << resumeFrom.mEventID;
+
+                mReplaysChanges = replayJournal(resumeFrom.mEventID, nextUsn);
+            }
+
+            mPendingUsn = nextUsn;
+            mLastUsn = nextUsn;
+        }
     }
     else
     {
@@ -1703,6 +1948,11 @@ WinDirNotify::~WinDirNotify()
 
         CloseHandle(hDirectory);
     }
+
+    if (hVolume != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(hVolume);
+    }
     fsaccess->dirnotifys.erase(this);
 
     {
@@ -1724,6 +1974,25 @@ WinDirNotify::~WinDirNotify()
     }
 
 }
+
+bool WinDirNotify::replaysChanges() const
+{
+    return mReplaysChanges;
+}
+
+auto WinDirNotify::resumePoint() const -> ResumePoint
+{
+    ResumePoint point;
+
+    // USNs can't be trusted without the journal's identity.
+    if (mJournalID.empty())
+        return point;
+
+    point.mJournalID = mJournalID;
+    point.mEventID = mLastUsn.load();
+
+    return point;
+}
 #endif   // ENABLE_SYNC
 
 std::unique_ptr<FileAccess> WinFileSystemAccess::newfileaccess(bool followSymLinks)
@@ -1788,9 +2057,9 @@ unique_ptr<DirAccess> WinFileSystemAccess::newdiraccess()
 }
 
 #ifdef ENABLE_SYNC
-DirNotify* WinFileSystemAccess::newdirnotify(LocalNode& root, const LocalPath& rootPath, Waiter* waiter)
+DirNotify* WinFileSystemAccess::newdirnotify(LocalNode& root, const LocalPath& rootPath, Waiter* waiter, const DirNotify::ResumePoint& resumeFrom)
 {
-    return new WinDirNotify(root, rootPath, this, waiter);
+    return new WinDirNotify(root, rootPath, this, waiter, resumeFrom);
 }
 #endif
 
@@ -1921,7 +2190,7 @@ bool  WinFileSystemAccess::checkForSymlink(const LocalPath& lp)
     return false;
 }
 
-ScanResult WinFileSystemAccess::directoryScan(const LocalPath& path, handle expectedFsid, map<LocalPath, FSNode>& known, std::vector<FSNode>& results, bool followSymLinks, unsigned& nFingerprinted)
+ScanResult WinFileSystemAccess::directoryScan(const LocalPath& path, handle expectedFsid, map<LocalPath, FSNode>& known, std::vector<FSNode>& results, bool followSymLinks, unsigned& nFingerprinted, std::vector<size_t>* unfingerprinted)
 {
     assert(path.isAbsolute());
     assert(!followSymLinks && "Symlinks are not supported on Windows!");
@@ -1962,11 +2231,15 @@ ScanResult WinFileSystemAccess::directoryScan(const LocalPath& path, handle expe
         return SCAN_INACCESSIBLE;
     }
 
-    alignas(8) byte bytes[1024 * 10];
+    // each call fills the buffer with as many entries as fit (each one takes ~100 bytes + the name):
+    // a big buffer takes big directories in few calls. Its memory is aligned for the entries
+    static constexpr DWORD DIRECTORY_INFO_BUFFER_SIZE = 64 * 1024;
+    std::unique_ptr<byte[]> buffer(new byte[DIRECTORY_INFO_BUFFER_SIZE]);
+    byte* bytes = buffer.get();
 
     if (GetFileInformationByHandleEx( rightTypeHandle.get(),
         FileIdBothDirectoryRestartInfo,  // starts the listing from the beginning
-        bytes, sizeof(bytes)))
+        bytes, DIRECTORY_INFO_BUFFER_SIZE))
     {
         do
         {
@@ -2067,21 +2340,22 @@ ScanResult WinFileSystemAccess::directoryScan(const LocalPath& path, handle expe
                         result.fingerprint = std::move(it->second.fingerprint);
                         known.erase(it);
                     }
+                    else if (unfingerprinted)
+                    {
+                        // The caller fingerprints it
+                        unfingerprinted->push_back(results.size());
+                    }
                     else
                     {
                         LocalPath p = path;
                         p.appendWithSeparator(result.localname, false);
-                        auto fa = newfileaccess();
-                        if (fa->fopen(p, true, false, FSLogging::logOnError))
+
+                        // The file may be opened exclusively by another process
+                        // In this case, the fingerprint (the crc portion) is invalid (for now)
+                        if (fingerprintScannedFile(p, result.fingerprint))
                         {
-                            result.fingerprint.genfingerprint(fa.get());
                             nFingerprinted += 1;
                         }
-                        else
-                        {
-                            // The file may be opened exclusively by another process
-                            // In this case, the fingerprint (the crc portion) is invalid (for now)
-                        }
                     }
                 }
 
@@ -2090,7 +2364,7 @@ ScanResult WinFileSystemAccess::directoryScan(const LocalPath& path, handle expe
         }
         while (GetFileInformationByHandleEx( rightTypeHandle.get(),
             FileIdBothDirectoryInfo,  // continues but does not restart
-            bytes, sizeof(bytes)));
+            bytes, DIRECTORY_INFO_BUFFER_SIZE));
 
     }
 
@@ -0,0 +1,81 @@
+#include "mega/win32/gfx/worker/shared_memory.h"
+#include "mega/logging.h"
+#include "mega/filesystem.h"
+
+namespace mega {
+namespace gfx {
+
+SharedMemory::SharedMemory(const std::string& name, HANDLE mapping, void* data, size_t size)
+    : mName(name)
+    , mMapping(mapping)
+    , mData(data)
+    , mSize(size)
+{
+}
+
+SharedMemory::~SharedMemory()
+{
+    UnmapViewOfFile(mData);
+    CloseHandle(mMapping);
+}
+
+std::wstring SharedMemory::toMappingName(const std::string& name)
+{
+    const std::string mappingName = "Local\\" + name;
+    std::wstring mappingNameW;
+    LocalPath::path2local(&mappingName, &mappingNameW);
+    return mappingNameW;
+}
+
+std::unique_ptr<SharedMemory> SharedMemory::create(const std::string& name, size_t size)
+{
+    const uint64_t size64 = size;
+    HANDLE mapping = CreateFileMappingW(INVALID_HANDLE_VALUE,
+                                        NULL,          // default security: this user only
+                                        PAGE_READWRITE,
+                                        static_cast<DWORD>(size64 >> 32),
+                                        static_cast<DWORD>(size64 & 0xFFFFFFFF),
+                                        toMappingName(name).c_str());
+    if (mapping == NULL || GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        LOG_err << "CreateFileMapping " << name << " failed. error code=" << GetLastError() << " " << mega::winErrorMessage(GetLastError());
+        if (mapping) CloseHandle(mapping);
+        return nullptr;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!data)
+    {
+        LOG_err << "MapViewOfFile " << name << " failed. error code=" << GetLastError() << " " << mega::winErrorMessage(GetLastError());
+        CloseHandle(mapping);
+        return nullptr;
+    }
+
+    return std::unique_ptr<SharedMemory>(new SharedMemory(name, mapping, data, size));
+}
+
+std::unique_ptr<SharedMemory> SharedMemory::open(const std::string& name)
+{
+    HANDLE mapping = OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, toMappingName(name).c_str());
+    if (mapping == NULL)
+    {
+        LOG_err << "OpenFileMapping " << name << " failed. error code=" << GetLastError() << " " << mega::winErrorMessage(GetLastError());
+        return nullptr;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION info;
+    if (!data || !VirtualQuery(data, &info, sizeof(info)))
+    {
+        LOG_err << "Shared memory " << name << " couldn't be mapped. error code=" << GetLastError() << " " << mega::winErrorMessage(GetLastError());
+        if (data) UnmapViewOfFile(data);
+        CloseHandle(mapping);
+        return nullptr;
+    }
+
+    // the size of the view is rounded up to pages, the ring keeps its own
+    return std::unique_ptr<SharedMemory>(new SharedMemory(name, mapping, data, info.RegionSize));
+}
+
+} // namespace
+}
@@ -0,0 +1,84 @@
+/**
+ * @file AttrMap_bench.cpp
+ * @brief Benchmarks of the attributes of the nodes
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <mega/attrmap.h>
+
+#include "fixtures.h"
+
+using namespace mega;
+
+namespace {
+
+// the attributes of a typical file: name, fingerprint and a label
+std::string serializedFileAttributes()
+{
+    AttrMap attrs;
+    attrs.map['n'] = "IMG_20240101_123456.jpg";
+    attrs.map['c'] = "A1b2C3d4E5f6G7h8I9j0K1l2M3n4O5p6";
+    attrs.map[AttrMap::string2nameid("lbl")] = "1";
+
+    std::string d;
+    attrs.serialize(&d);
+    return d;
+}
+
+// memory used by the attributes of the nodes loaded from the database
+void BM_AttrMap_memory(benchmark::State& state)
+{
+    const std::string d = serializedFileAttributes();
+    const size_t count = static_cast<size_t>(state.range(0));
+
+    size_t bytes = 0;
+    for (auto _ : state)
+    {
+        size_t before = bench::allocatedBytes();
+        std::vector<AttrMap> nodes(count);
+        for (auto& attrs : nodes)
+        {
+            attrs.unserialize(d.data(), d.data() + d.size());
+        }
+        bytes = bench::allocatedBytes() - before;
+    }
+
+    state.counters["bytes_per_node"] = static_cast<double>(bytes) / static_cast<double>(count);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+BENCHMARK(BM_AttrMap_memory)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// look-ups done by the listings (name, fav, label...)
+void BM_AttrMap_find(benchmark::State& state)
+{
+    const std::string d = serializedFileAttributes();
+    AttrMap attrs;
+    attrs.unserialize(d.data(), d.data() + d.size());
+
+    static const nameid fav = AttrMap::string2nameid("fav");
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(attrs.map.find('n'));
+        benchmark::DoNotOptimize(attrs.map.find(fav));
+    }
+}
+BENCHMARK(BM_AttrMap_find);
+
+} // namespace
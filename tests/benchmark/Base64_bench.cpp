@@ -0,0 +1,89 @@
+/**
+ * @file Base64_bench.cpp
+ * @brief Benchmarks of the base64 codec
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <mega/base64.h>
+
+#include <random>
+
+using namespace mega;
+
+namespace {
+
+std::string randomBytes(size_t size)
+{
+    std::mt19937 rng(static_cast<unsigned>(size));
+    std::string bytes(size, '\0');
+    for (auto& c : bytes)
+    {
+        c = static_cast<char>(rng());
+    }
+    return bytes;
+}
+
+// sizes of a handle, a node key, and blobs as big as attributes or file attribute strings get
+void BM_Base64_btoa(benchmark::State& state)
+{
+    std::string bytes = randomBytes(static_cast<size_t>(state.range(0)));
+    std::string chars;
+
+    for (auto _ : state)
+    {
+        Base64::btoa(bytes, chars);
+        benchmark::DoNotOptimize(chars.data());
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes.size()));
+}
+BENCHMARK(BM_Base64_btoa)->Arg(6)->Arg(8)->Arg(32)->Arg(256)->Arg(64 * 1024);
+
+void BM_Base64_atob(benchmark::State& state)
+{
+    std::string chars = Base64::btoa(randomBytes(static_cast<size_t>(state.range(0))));
+    std::string bytes;
+
+    for (auto _ : state)
+    {
+        Base64::atob(chars, bytes);
+        benchmark::DoNotOptimize(bytes.data());
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * chars.size()));
+}
+BENCHMARK(BM_Base64_atob)->Arg(6)->Arg(8)->Arg(32)->Arg(256)->Arg(64 * 1024);
+
+// as handles are decoded from the JSON, into a fixed size buffer
+void BM_Base64_atobHandle(benchmark::State& state)
+{
+    Base64Str<sizeof(handle)> chars(reinterpret_cast<const byte*>(randomBytes(sizeof(handle)).data()));
+    handle h = 0;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(Base64::atob(chars, reinterpret_cast<byte*>(&h), sizeof(h)));
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_Base64_atobHandle);
+
+} // namespace
@@ -0,0 +1,83 @@
+/**
+ * @file Crypto_bench.cpp
+ * @brief Benchmarks of the encryption and MAC of file chunks
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <mega.h>
+
+using namespace mega;
+
+namespace {
+
+// CTR encryption and chunk MACs of a file, chunk by chunk, as the upload of a TransferSlot
+void BM_chunkmac_map_ctr_encrypt(benchmark::State& state)
+{
+    const m_off_t fileSize = state.range(0);
+
+    byte key[SymmCipher::KEYLENGTH] = {};
+    SymmCipher cipher;
+    cipher.setkey(key);
+
+    std::string data(static_cast<size_t>(fileSize) + SymmCipher::BLOCKSIZE, 'x');
+
+    for (auto _ : state)
+    {
+        chunkmac_map macs;
+        for (m_off_t pos = 0; pos < fileSize; )
+        {
+            m_off_t next = std::min(ChunkedHash::chunkceil(pos, fileSize), fileSize);
+            macs.ctr_encrypt(pos, &cipher, reinterpret_cast<byte*>(&data[static_cast<size_t>(pos)]),
+                             static_cast<unsigned>(next - pos), pos, 0x0102030405060708, true);
+            pos = next;
+        }
+        benchmark::DoNotOptimize(macs.macsmac(&cipher));
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * fileSize));
+}
+BENCHMARK(BM_chunkmac_map_ctr_encrypt)->Arg(1 << 20)->Arg(64 << 20)->Unit(benchmark::kMillisecond);
+
+// A node key unwrapped with the key of its parent, as many times as nodes the tree has,
+// each time with the key of another folder in the recycled temporary cipher
+void BM_SymmCipher_setkeyAndDecryptNodeKey(benchmark::State& state)
+{
+    std::vector<std::array<byte, SymmCipher::KEYLENGTH>> keys(64);
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        keys[i].fill(static_cast<byte>(i));
+    }
+
+    SymmCipher cipher;
+    byte nodeKey[FILENODEKEYLENGTH] = {};
+    size_t i = 0;
+
+    for (auto _ : state)
+    {
+        cipher.setkey(keys[i++ % keys.size()].data(), FOLDERNODE);
+        cipher.ecb_decrypt(nodeKey, sizeof nodeKey);
+        benchmark::DoNotOptimize(nodeKey);
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_SymmCipher_setkeyAndDecryptNodeKey);
+
+} // namespace
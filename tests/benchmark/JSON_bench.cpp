@@ -0,0 +1,139 @@
+/**
+ * @file JSON_bench.cpp
+ * @brief Benchmarks of the JSON scanner and the JSONSplitter
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <mega/json.h>
+
+#include "fixtures.h"
+
+using namespace mega;
+
+namespace {
+
+// whole response, as the JSON scanner gets it after a non-streamed request
+void BM_JSON_fetchnodes(benchmark::State& state)
+{
+    const std::string& json = bench::fetchnodesJson(static_cast<size_t>(state.range(0)));
+
+    for (auto _ : state)
+    {
+        JSON j;
+        j.begin(json.c_str());
+        j.enterobject();
+        size_t nodes = 0;
+        if (j.getnameid() == MAKENAMEID1('f') && j.enterarray())
+        {
+            while (j.enterobject())
+            {
+                for (nameid name; (name = j.getnameid()) != EOO; )
+                {
+                    j.storeobject();
+                }
+                j.leaveobject();
+                ++nodes;
+            }
+            j.leavearray();
+        }
+        benchmark::DoNotOptimize(nodes);
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * json.size()));
+}
+BENCHMARK(BM_JSON_fetchnodes)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// streamed response, fed in chunks as the network layer does
+void BM_JSONSplitter_fetchnodes(benchmark::State& state)
+{
+    const std::string& json = bench::fetchnodesJson(static_cast<size_t>(state.range(0)));
+    const size_t chunkSize = static_cast<size_t>(state.range(1));
+
+    size_t nodes = 0;
+    std::map<std::string, std::function<bool(JSON*)>> filters;
+    filters["{[f{"] = [&nodes](JSON* j)
+    {
+        ++nodes;
+        return j->storeobject();
+    };
+
+    std::string buffer;
+    for (auto _ : state)
+    {
+        JSONSplitter splitter;
+        buffer.clear();
+        for (size_t offset = 0; offset < json.size(); offset += chunkSize)
+        {
+            buffer.append(json, offset, chunkSize);
+            m_off_t consumed = splitter.processChunk(&filters, buffer.c_str());
+            buffer.erase(0, static_cast<size_t>(consumed));
+        }
+        if (!splitter.hasFinished() || splitter.hasFailed())
+        {
+            state.SkipWithError("the fetchnodes fixture wasn't parsed");
+            break;
+        }
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * json.size()));
+    state.counters["nodes"] = benchmark::Counter(static_cast<double>(nodes), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_JSONSplitter_fetchnodes)->Args({100000, 16 * 1024})->Args({100000, 256 * 1024})->Unit(benchmark::kMillisecond);
+
+// the action packets of a sc response, scanned as MegaClient::procsc does (without applying them)
+void BM_JSON_actionPackets(benchmark::State& state)
+{
+    const std::string& json = bench::actionPacketsJson(static_cast<size_t>(state.range(0)));
+
+    for (auto _ : state)
+    {
+        JSON j;
+        j.begin(json.c_str());
+        j.enterobject();
+        size_t packets = 0;
+        for (nameid name; (name = j.getnameid()) != EOO; )
+        {
+            if (name != MAKENAMEID1('a'))
+            {
+                j.storeobject();
+                continue;
+            }
+
+            j.enterarray();
+            while (j.enterobject())
+            {
+                std::string type;
+                for (nameid field; (field = j.getnameid()) != EOO; )
+                {
+                    j.storeobject(field == MAKENAMEID1('a') ? &type : nullptr);
+                }
+                j.leaveobject();
+                packets += !type.empty();
+            }
+            j.leavearray();
+        }
+        benchmark::DoNotOptimize(packets);
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * state.range(0)));
+}
+BENCHMARK(BM_JSON_actionPackets)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+} // namespace
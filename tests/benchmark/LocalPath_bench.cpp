@@ -0,0 +1,217 @@
+/**
+ * @file LocalPath_bench.cpp
+ * @brief Benchmarks of the LocalPath operations
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+
+#include <mega/filesystem.h>
+
+#include "fixtures.h"
+
+using namespace mega;
+
+namespace {
+
+std::vector<LocalPath> relativePaths(size_t files)
+{
+    std::vector<LocalPath> paths;
+    for (auto& path : bench::fileTreePaths(files))
+    {
+        paths.push_back(LocalPath::fromRelativePath(path));
+    }
+    return paths;
+}
+
+LocalPath syncRoot()
+{
+#ifdef _WIN32
+    return LocalPath::fromAbsolutePath("C:\\Users\\bench\\MEGA");
+#else
+    return LocalPath::fromAbsolutePath("/home/bench/MEGA");
+#endif
+}
+
+void BM_LocalPath_fromRelativePath(benchmark::State& state)
+{
+    const auto& paths = bench::fileTreePaths(static_cast<size_t>(state.range(0)));
+
+    for (auto _ : state)
+    {
+        for (auto& path : paths)
+        {
+            benchmark::DoNotOptimize(LocalPath::fromRelativePath(path));
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * paths.size()));
+}
+BENCHMARK(BM_LocalPath_fromRelativePath)->Arg(10000);
+
+void BM_LocalPath_appendWithSeparator(benchmark::State& state)
+{
+    auto paths = relativePaths(static_cast<size_t>(state.range(0)));
+    LocalPath root = syncRoot();
+
+    for (auto _ : state)
+    {
+        for (auto& path : paths)
+        {
+            LocalPath full = root;
+            full.appendWithSeparator(path, true);
+            benchmark::DoNotOptimize(full);
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * paths.size()));
+}
+BENCHMARK(BM_LocalPath_appendWithSeparator)->Arg(10000);
+
+// what the sync engine does with every path it visits
+void BM_LocalPath_leafNameAndParent(benchmark::State& state)
+{
+    auto paths = relativePaths(static_cast<size_t>(state.range(0)));
+    LocalPath root = syncRoot();
+    for (auto& path : paths)
+    {
+        LocalPath full = root;
+        full.appendWithSeparator(path, true);
+        path = std::move(full);
+    }
+
+    for (auto _ : state)
+    {
+        for (auto& path : paths)
+        {
+            benchmark::DoNotOptimize(path.leafName());
+            benchmark::DoNotOptimize(path.parentPath());
+            benchmark::DoNotOptimize(root.isContainingPathOf(path));
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * paths.size()));
+}
+BENCHMARK(BM_LocalPath_leafNameAndParent)->Arg(10000);
+
+// The names of every file and its ancestors, from the leaf to the sync root, as kept by the LocalNodes
+std::vector<std::vector<LocalPath>> leafNameChains(size_t files)
+{
+    std::vector<std::vector<LocalPath>> chains;
+    LocalPath root = syncRoot();
+    for (auto& path : relativePaths(files))
+    {
+        std::vector<LocalPath> chain;
+        LocalPath component;
+        size_t index = 0;
+        while (path.nextPathComponent(index, component))
+        {
+            chain.push_back(component);
+        }
+        chain.push_back(root);
+        std::reverse(chain.begin(), chain.end() - 1);
+        chains.push_back(std::move(chain));
+    }
+    return chains;
+}
+
+// how LocalNode::getLocalPath() built the full paths before
+void BM_LocalPath_prependLeafNames(benchmark::State& state)
+{
+    auto chains = leafNameChains(static_cast<size_t>(state.range(0)));
+
+    for (auto _ : state)
+    {
+        for (auto& chain : chains)
+        {
+            LocalPath full;
+            for (auto& name : chain)
+            {
+                full.prependWithSeparator(name);
+            }
+            benchmark::DoNotOptimize(full);
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * chains.size()));
+}
+BENCHMARK(BM_LocalPath_prependLeafNames)->Arg(10000);
+
+void BM_LocalPath_assignFromLeafNames(benchmark::State& state)
+{
+    auto chains = leafNameChains(static_cast<size_t>(state.range(0)));
+
+    for (auto _ : state)
+    {
+        for (auto& chain : chains)
+        {
+            LocalPath full;
+            full.assignFromLeafNames([&chain](auto&& name)
+            {
+                for (auto& n : chain) name(n);
+            });
+            benchmark::DoNotOptimize(full);
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * chains.size()));
+}
+BENCHMARK(BM_LocalPath_assignFromLeafNames)->Arg(10000);
+
+void BM_LocalPath_components(benchmark::State& state)
+{
+    auto paths = relativePaths(static_cast<size_t>(state.range(0)));
+
+    for (auto _ : state)
+    {
+        size_t components = 0;
+        for (auto& path : paths)
+        {
+            LocalPath component;
+            size_t index = 0;
+            while (path.nextPathComponent(index, component))
+            {
+                ++components;
+            }
+        }
+        benchmark::DoNotOptimize(components);
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * paths.size()));
+}
+BENCHMARK(BM_LocalPath_components)->Arg(10000);
+
+void BM_LocalPath_toPath(benchmark::State& state)
+{
+    auto paths = relativePaths(static_cast<size_t>(state.range(0)));
+
+    for (auto _ : state)
+    {
+        for (auto& path : paths)
+        {
+            benchmark::DoNotOptimize(path.toPath(false));
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * paths.size()));
+}
+BENCHMARK(BM_LocalPath_toPath)->Arg(10000);
+
+} // namespace
@@ -0,0 +1,110 @@
+/**
+ * @file NodeManager_bench.cpp
+ * @brief Benchmarks of the NodeManager and the searches of the SqliteAccountState
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <random>
+
+#include <mega.h>
+
+#include "fixtures.h"
+
+using namespace mega;
+
+namespace {
+
+constexpr int DEFAULT_ASC = 1; // MegaApi::ORDER_DEFAULT_ASC
+
+// accounts of 1M nodes take a while to be generated: SDK_BENCH_NODES overrides the default size
+size_t accountNodes()
+{
+    const char* nodes = std::getenv("SDK_BENCH_NODES");
+    return nodes ? std::strtoul(nodes, nullptr, 10) : 1000000;
+}
+
+// look-ups of random nodes: most of them aren't in the cache, so they are loaded from the database
+void BM_NodeManager_getNodeByHandle(benchmark::State& state)
+{
+    size_t nodes = accountNodes();
+    auto& client = bench::clientWithNodes(nodes);
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<handle> pick(100, 100 + nodes - 1);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(client.client->mNodeManager.getNodeByHandle(NodeHandle().set6byte(pick(rng))));
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_NodeManager_getNodeByHandle)->Unit(benchmark::kMicrosecond);
+
+// pages of the children of the root, by name
+void BM_NodeManager_getChildren(benchmark::State& state)
+{
+    auto& client = bench::clientWithNodes(accountNodes());
+
+    NodeSearchFilter filter;
+    filter.byAncestors({ client.root.as8byte(), UNDEF, UNDEF });
+    for (auto _ : state)
+    {
+        auto children = client.client->mNodeManager.getChildren(filter, DEFAULT_ASC, CancelToken(),
+                                                                NodeSearchPage(0, static_cast<size_t>(state.range(0))));
+        benchmark::DoNotOptimize(children);
+    }
+}
+BENCHMARK(BM_NodeManager_getChildren)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+// the same pages, without creating the nodes
+void BM_NodeManager_getChildrenViews(benchmark::State& state)
+{
+    auto& client = bench::clientWithNodes(accountNodes());
+
+    NodeSearchFilter filter;
+    filter.byAncestors({ client.root.as8byte(), UNDEF, UNDEF });
+    for (auto _ : state)
+    {
+        auto children = client.client->mNodeManager.getChildrenViews(filter, DEFAULT_ASC, CancelToken(),
+                                                                     NodeSearchPage(0, static_cast<size_t>(state.range(0))));
+        benchmark::DoNotOptimize(children);
+    }
+}
+BENCHMARK(BM_NodeManager_getChildrenViews)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+// searches by name in the whole account, as MegaApi::search does
+void BM_SqliteAccountState_searchByName(benchmark::State& state)
+{
+    auto& client = bench::clientWithNodes(accountNodes());
+
+    NodeSearchFilter filter;
+    filter.byAncestors({ client.root.as8byte(), UNDEF, UNDEF });
+    filter.byName("ab");
+    for (auto _ : state)
+    {
+        auto found = client.client->mNodeManager.searchNodes(filter, DEFAULT_ASC, CancelToken(),
+                                                             NodeSearchPage(0, static_cast<size_t>(state.range(0))));
+        benchmark::DoNotOptimize(found);
+    }
+}
+BENCHMARK(BM_SqliteAccountState_searchByName)->Arg(100)->Unit(benchmark::kMillisecond);
+
+} // namespace
@@ -0,0 +1,77 @@
+/**
+ * @file Raid_bench.cpp
+ * @brief Benchmarks of the combination of RAID parts
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+
+#include <mega/raid.h>
+
+using namespace mega;
+
+namespace {
+
+// raid lines out of the 5 data parts, or out of 4 of them and the parity when 'missing' isn't 0
+void combine(benchmark::State& state, unsigned missing)
+{
+    const size_t partSize = static_cast<size_t>(state.range(0));
+
+    std::mt19937 rng(1);
+    std::array<std::vector<byte>, RAIDPARTS> parts;
+    for (auto& part : parts)
+    {
+        part.resize(partSize);
+        for (auto& b : part)
+        {
+            b = static_cast<byte>(rng());
+        }
+    }
+
+    const byte* ptrs[RAIDPARTS];
+    for (unsigned i = 0; i < RAIDPARTS; ++i)
+    {
+        ptrs[i] = i == missing && missing ? nullptr : parts[i].data();
+    }
+
+    std::vector<byte> out(partSize * EFFECTIVE_RAIDPARTS);
+    for (auto _ : state)
+    {
+        RaidBufferManager::combineRaidLines(out.data(), ptrs, partSize);
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * out.size()));
+}
+
+void BM_RaidBufferManager_combineRaidLines(benchmark::State& state)
+{
+    combine(state, 0);
+}
+BENCHMARK(BM_RaidBufferManager_combineRaidLines)->Arg(RAIDSECTOR * 1024)->Arg(RAIDSECTOR * 65536);
+
+void BM_RaidBufferManager_combineRaidLines_recovery(benchmark::State& state)
+{
+    combine(state, 3);
+}
+BENCHMARK(BM_RaidBufferManager_combineRaidLines_recovery)->Arg(RAIDSECTOR * 1024)->Arg(RAIDSECTOR * 65536);
+
+} // namespace
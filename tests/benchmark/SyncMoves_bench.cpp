@@ -0,0 +1,154 @@
+/**
+ * @file SyncMoves_bench.cpp
+ * @brief Benchmarks of the fsid and node handle lookups done by the sync move detection
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+
+#include <mega/types.h>
+
+using namespace mega;
+
+namespace {
+
+// the ordered multimaps used before, for comparison
+typedef multimap<handle, LocalNode*> ordered_fsid_map;
+typedef multimap<NodeHandle, LocalNode*> ordered_nodehandle_map;
+
+// the LocalNodes are never dereferenced, only their addresses are compared
+LocalNode* fakeLocalNode(size_t i)
+{
+    return reinterpret_cast<LocalNode*>((i + 1) * 64);
+}
+
+// fsids are inode numbers: mostly consecutive, with gaps
+std::vector<handle> fsids(size_t n)
+{
+    std::mt19937_64 rng(93);
+    std::vector<handle> ids(n);
+    handle id = 1000;
+    for (auto& i : ids)
+    {
+        id += 1 + rng() % 4;
+        i = id;
+    }
+    return ids;
+}
+
+// Every node of the sync is looked up by the fsid of its scanned item, as in the detection of local moves
+template<class Map>
+void BM_SyncMoves_fsidLookup(benchmark::State& state)
+{
+    auto ids = fsids(static_cast<size_t>(state.range(0)));
+
+    Map m;
+    for (size_t i = 0; i < ids.size(); i++)
+    {
+        m.emplace(ids[i], fakeLocalNode(i));
+    }
+
+    for (auto _ : state)
+    {
+        for (handle id : ids)
+        {
+            auto range = m.equal_range(id);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                benchmark::DoNotOptimize(it->second);
+            }
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * ids.size()));
+}
+BENCHMARK_TEMPLATE(BM_SyncMoves_fsidLookup, ordered_fsid_map)->Arg(1000000);
+BENCHMARK_TEMPLATE(BM_SyncMoves_fsidLookup, fsid_localnode_map)->Arg(1000000);
+
+// A set of moves, each one revoking the synced fsid of the source node and assigning it to the target node
+template<class Map>
+void BM_SyncMoves_fsidReassign(benchmark::State& state)
+{
+    auto ids = fsids(static_cast<size_t>(state.range(0)));
+
+    Map m;
+    for (size_t i = 0; i < ids.size(); i++)
+    {
+        m.emplace(ids[i], fakeLocalNode(i));
+    }
+
+    std::mt19937 rng(93);
+    std::uniform_int_distribution<size_t> pick(0, ids.size() - 1);
+    size_t nextNode = ids.size();
+
+    for (auto _ : state)
+    {
+        for (int move = 0; move < 10000; move++)
+        {
+            handle id = ids[pick(rng)];
+            auto range = m.equal_range(id);
+            if (range.first != range.second)
+            {
+                m.erase(range.first);
+            }
+            m.emplace(id, fakeLocalNode(nextNode++));
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * 10000));
+}
+BENCHMARK_TEMPLATE(BM_SyncMoves_fsidReassign, ordered_fsid_map)->Arg(1000000);
+BENCHMARK_TEMPLATE(BM_SyncMoves_fsidReassign, fsid_localnode_map)->Arg(1000000);
+
+// Every synced node is looked up by the handle of its cloud node, as in the detection of remote moves
+template<class Map>
+void BM_SyncMoves_nodeHandleLookup(benchmark::State& state)
+{
+    std::mt19937_64 rng(93);
+    std::vector<NodeHandle> handles(static_cast<size_t>(state.range(0)));
+    for (auto& h : handles)
+    {
+        h.set6byte(rng() & 0xFFFFFFFFFFFF);
+    }
+
+    Map m;
+    for (size_t i = 0; i < handles.size(); i++)
+    {
+        m.emplace(handles[i], fakeLocalNode(i));
+    }
+
+    for (auto _ : state)
+    {
+        for (NodeHandle h : handles)
+        {
+            auto range = m.equal_range(h);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                benchmark::DoNotOptimize(it->second);
+            }
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * handles.size()));
+}
+BENCHMARK_TEMPLATE(BM_SyncMoves_nodeHandleLookup, ordered_nodehandle_map)->Arg(1000000);
+BENCHMARK_TEMPLATE(BM_SyncMoves_nodeHandleLookup, nodehandle_localnode_map)->Arg(1000000);
+
+} // namespace
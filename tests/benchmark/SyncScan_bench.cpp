@@ -0,0 +1,382 @@
+/**
+ * @file SyncScan_bench.cpp
+ * @brief Benchmarks of the passes of the local scanning of the syncs, on trees of different shapes
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+
+#include <mega.h>
+
+#include "fixtures.h"
+
+using namespace mega;
+namespace fs = std::filesystem;
+
+namespace {
+
+enum Shape
+{
+    // folders of 1000 files, all of them in the root
+    WIDE,
+    // a binary tree of folders with 10 files each
+    DEEP,
+};
+
+// the trees are written to disk: SDK_BENCH_SYNC_FILES overrides the default number of files (ie. 1000000)
+size_t treeFiles()
+{
+    const char* files = std::getenv("SDK_BENCH_SYNC_FILES");
+    return files ? std::strtoul(files, nullptr, 10) : 100000;
+}
+
+// a fresh tree under the working directory, removed when it goes out of scope
+class LocalTree
+{
+public:
+    LocalTree(Shape shape, size_t files)
+        : mRoot(fs::absolute(fs::path("sync_bench_tree")))
+    {
+        fs::remove_all(mRoot);
+
+        const size_t filesPerFolder = shape == WIDE ? 1000 : 10;
+        for (size_t i = 0; i * filesPerFolder < files; ++i)
+        {
+            if (shape == WIDE)
+            {
+                mFolders.push_back(mRoot / ("folder" + std::to_string(i)));
+            }
+            else
+            {
+                mFolders.push_back(i ? mFolders[(i - 1) / 2] / ("d" + std::to_string(i)) : mRoot);
+            }
+            fs::create_directories(mFolders.back());
+
+            for (size_t n = 0; n < filesPerFolder && i * filesPerFolder + n < files; ++n)
+            {
+                fs::path file = mFolders.back() / ("file" + std::to_string(n) + ".txt");
+                std::ofstream(file) << std::string(1 + (i * filesPerFolder + n) % 4096, 'x');
+                mFiles.push_back(std::move(file));
+            }
+        }
+    }
+
+    ~LocalTree()
+    {
+        std::error_code ec;
+        fs::remove_all(mRoot, ec);
+    }
+
+    const fs::path& root() const { return mRoot; }
+
+    // every 'step'th file is renamed, as a mass rename by an application would
+    void renameFiles(size_t step)
+    {
+        for (size_t i = 0; i < mFiles.size(); i += step)
+        {
+            fs::rename(mFiles[i], fs::path(mFiles[i]).replace_extension(".renamed"));
+        }
+    }
+
+    // every 'step'th file is removed
+    void deleteFiles(size_t step)
+    {
+        for (size_t i = 0; i < mFiles.size(); i += step)
+        {
+            fs::remove(mFiles[i]);
+        }
+    }
+
+    // every 'step'th file gets a few more bytes
+    void editFiles(size_t step)
+    {
+        for (size_t i = 0; i < mFiles.size(); i += step)
+        {
+            std::ofstream(mFiles[i], std::ios::app) << "edit";
+        }
+    }
+
+private:
+    fs::path mRoot;
+    std::vector<fs::path> mFolders;
+    std::vector<fs::path> mFiles;
+};
+
+class ScanWaiter : public Waiter
+{
+public:
+    int wait() override
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mNotifier.wait(lock, [this]() { return mNotified; });
+        mNotified = false;
+        return 0;
+    }
+
+    void notify() override
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mNotified = true;
+        mNotifier.notify_one();
+    }
+
+private:
+    std::mutex mMutex;
+    std::condition_variable mNotifier;
+    bool mNotified = false;
+};
+
+// The local state of a sync: the last scan of each folder, as the LocalNodes keep it, and its state cache.
+// The cloud side isn't involved: the changes found are only written to the database, as the sync does
+class ScannedTree
+{
+public:
+    ScannedTree(const fs::path& root)
+        : mRoot(LocalPath::fromAbsolutePath(root.string()))
+        , mDbAccess(LocalPath::fromAbsolutePath(fs::current_path().string()))
+        , mVolume(mFsAccess.fsFingerprint(mRoot).fingerprint())
+    {
+        mDb.reset(mDbAccess.open(mRng, mFsAccess, "sync_bench", DB_OPEN_FLAG_TRANSACTED, [](DBError) {}));
+        mDb->truncate();
+    }
+
+    // Every folder is scanned once, with the children known from the previous pass,
+    // and the changes are committed to the database at once. It returns how many entries changed
+    size_t pass()
+    {
+        auto fa = mFsAccess.newfileaccess();
+        if (!fa->fopen(mRoot, true, false, FSLogging::logOnError, nullptr, false, true) || !fa->fsidvalid)
+        {
+            return 0;
+        }
+
+        struct FolderScan
+        {
+            LocalPath path;
+            handle fsid;
+            ScanService::RequestPtr request;
+        };
+
+        std::deque<FolderScan> pending{ FolderScan{ mRoot, fa->fsid, nullptr } };
+        std::vector<FolderScan> scanning;
+        std::set<LocalPath> visited;
+        size_t changes = 0;
+
+        mDb->begin();
+        while (!pending.empty() || !scanning.empty())
+        {
+            while (!pending.empty() && scanning.size() < 2 * ScanService::NUM_THREADS_PER_VOLUME)
+            {
+                FolderScan& scan = pending.front();
+                map<LocalPath, FSNode> known;
+                for (auto& entry : mFolders[scan.path])
+                {
+                    known.emplace(entry.first, entry.second.node.clone());
+                }
+                scan.request = mScanService.queueScan(scan.path, scan.fsid, false, std::move(known), mWaiter, mVolume);
+                scanning.push_back(std::move(scan));
+                pending.pop_front();
+            }
+
+            mWaiter->wait();
+
+            for (auto it = scanning.begin(); it != scanning.end(); )
+            {
+                if (!it->request->completed())
+                {
+                    ++it;
+                    continue;
+                }
+
+                ++mFoldersScanned;
+                visited.insert(it->path);
+                auto& children = mFolders[it->path];
+                std::map<LocalPath, Entry> scanned;
+                if (it->request->completionResult() == SCAN_SUCCESS)
+                {
+                    for (FSNode& node : it->request->resultNodes())
+                    {
+                        if (node.type == FOLDERNODE)
+                        {
+                            LocalPath childPath = it->path;
+                            childPath.appendWithSeparator(node.localname, false);
+                            pending.push_back(FolderScan{ std::move(childPath), node.fsid, nullptr });
+                        }
+
+                        LocalPath name = node.localname;
+                        auto previous = children.find(name);
+                        Entry entry{ std::move(node), previous != children.end() ? previous->second.dbid : ++mNextDbId };
+                        if (previous == children.end() || previous->second.node.fsid != entry.node.fsid
+                            || previous->second.node.fingerprint != entry.node.fingerprint)
+                        {
+                            put(entry);
+                            ++changes;
+                        }
+                        scanned.emplace(std::move(name), std::move(entry));
+                    }
+                }
+
+                for (auto& child : children)
+                {
+                    if (!scanned.count(child.first))
+                    {
+                        mDb->del(child.second.dbid);
+                        ++changes;
+                    }
+                }
+
+                children = std::move(scanned);
+                it = scanning.erase(it);
+            }
+        }
+
+        // the folders that are gone
+        for (auto it = mFolders.begin(); it != mFolders.end(); )
+        {
+            it = visited.count(it->first) ? std::next(it) : mFolders.erase(it);
+        }
+
+        mDb->commit();
+        ++mPasses;
+        return changes;
+    }
+
+    // passes until one of them finds nothing new
+    void converge()
+    {
+        while (pass()) {}
+    }
+
+    size_t passes() const { return mPasses; }
+    size_t foldersScanned() const { return mFoldersScanned; }
+    size_t dbBytes() const { return mDbBytes; }
+
+    void resetCounters()
+    {
+        mPasses = mFoldersScanned = mDbBytes = 0;
+    }
+
+private:
+    struct Entry
+    {
+        FSNode node;
+        uint32_t dbid;
+    };
+
+    // the name and the fingerprint, about the size of the LocalNodes kept by the state cache
+    void put(const Entry& entry)
+    {
+        string record = entry.node.localname.platformEncoded();
+        entry.node.fingerprint.serialize(&record);
+        mDb->put(entry.dbid, &record);
+        mDbBytes += record.size();
+    }
+
+    LocalPath mRoot;
+    FSACCESS_CLASS mFsAccess;
+    PrnGen mRng;
+    SqliteDbAccess mDbAccess;
+    std::unique_ptr<DbTable> mDb;
+    uint64_t mVolume;
+    ScanService mScanService;
+    shared_ptr<ScanWaiter> mWaiter = std::make_shared<ScanWaiter>();
+    std::map<LocalPath, std::map<LocalPath, Entry>> mFolders;
+    uint32_t mNextDbId = 0;
+    size_t mPasses = 0;
+    size_t mFoldersScanned = 0;
+    size_t mDbBytes = 0;
+};
+
+void report(benchmark::State& state, const ScannedTree& tree)
+{
+    state.counters["passes"] = static_cast<double>(tree.passes());
+    state.counters["folders_scanned"] = static_cast<double>(tree.foldersScanned());
+    state.counters["db_bytes"] = static_cast<double>(tree.dbBytes());
+    state.counters["peak_rss_mb"] = static_cast<double>(bench::peakResidentBytes()) / (1024 * 1024);
+}
+
+// A change applied to a tree already in sync, before the passes are measured
+using Mutation = std::function<void(LocalTree&)>;
+
+void runSyncScan(benchmark::State& state, const Mutation& mutation)
+{
+    const size_t files = treeFiles();
+    LocalTree local(static_cast<Shape>(state.range(0)), files);
+    ScannedTree tree(local.root());
+
+    if (mutation)
+    {
+        tree.converge();
+        mutation(local);
+        tree.resetCounters();
+    }
+
+    for (auto _ : state)
+    {
+        tree.converge();
+    }
+
+    report(state, tree);
+    state.SetItemsProcessed(static_cast<int64_t>(files));
+}
+
+// all the files are new and fingerprinted
+void BM_SyncScan_initial(benchmark::State& state)
+{
+    runSyncScan(state, nullptr);
+}
+
+// a tree in sync: only its folders are listed again
+void BM_SyncScan_unchanged(benchmark::State& state)
+{
+    runSyncScan(state, [](LocalTree&) {});
+}
+
+void BM_SyncScan_massRename(benchmark::State& state)
+{
+    runSyncScan(state, [](LocalTree& local) { local.renameFiles(2); });
+}
+
+void BM_SyncScan_massDelete(benchmark::State& state)
+{
+    runSyncScan(state, [](LocalTree& local) { local.deleteFiles(2); });
+}
+
+void BM_SyncScan_smallEdits(benchmark::State& state)
+{
+    runSyncScan(state, [](LocalTree& local) { local.editFiles(100); });
+}
+
+// the scans use several threads: the process CPU time is measured, as well as the real time
+#define SYNC_SCAN_BENCHMARK(name) \
+    BENCHMARK(name)->Arg(WIDE)->Arg(DEEP)->Iterations(1)->MeasureProcessCPUTime()->UseRealTime()->Unit(benchmark::kMillisecond)
+
+SYNC_SCAN_BENCHMARK(BM_SyncScan_initial);
+SYNC_SCAN_BENCHMARK(BM_SyncScan_unchanged);
+SYNC_SCAN_BENCHMARK(BM_SyncScan_massRename);
+SYNC_SCAN_BENCHMARK(BM_SyncScan_massDelete);
+SYNC_SCAN_BENCHMARK(BM_SyncScan_smallEdits);
+
+} // namespace
@@ -0,0 +1,296 @@
+/**
+ * @file Transfer_bench.cpp
+ * @brief Benchmarks of the transfer pipeline against a local storage server
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <mega.h>
+
+#include "fixtures.h"
+#include "storage_server.h"
+
+using namespace mega;
+using namespace std::chrono_literals;
+
+namespace {
+
+constexpr m_off_t FILE_SIZE = 64 * 1024 * 1024;
+constexpr m_off_t MAX_REQUEST_SIZE = 16 * 1024 * 1024;
+constexpr unsigned CONNECTIONS = 4;
+
+struct TransferResult
+{
+    bool succeeded = false;
+    unsigned recoveries = 0;
+    unsigned slowPartSwitches = 0;
+};
+
+// the key and the iv of the synthetic file, the data isn't really encrypted with them
+void setKey(SymmCipher& cipher, Transfer& transfer)
+{
+    byte key[SymmCipher::KEYLENGTH];
+    for (unsigned i = 0; i < sizeof key; ++i)
+    {
+        key[i] = static_cast<byte>(i * 37);
+    }
+    cipher.setkey(key);
+    transfer.ctriv = 0x0123456789abcdefll;
+}
+
+// Drives a download as TransferSlot::doio() does, in short: each connection requests the next range through
+// CurlHttpIO once free, the TransferBufferManager reassembles the raid parts, and the output is decrypted and mac'ed.
+// A raid connection failing or being the slowest to reply is replaced by the unused one
+TransferResult download(MegaClient& client, const std::vector<std::string>& urls, m_off_t size)
+{
+    TransferResult result;
+    Transfer transfer(&client, GET);
+    transfer.size = size;
+    SymmCipher cipher;
+    setKey(cipher, transfer);
+
+    TransferBufferManager buffers;
+    buffers.setIsRaid(&transfer, urls, 0, MAX_REQUEST_SIZE, false);
+    const unsigned connections = buffers.isRaid() ? unsigned(RAIDPARTS) : CONNECTIONS;
+    std::vector<std::shared_ptr<HttpReqDL>> reqs(connections);
+
+    while (transfer.progresscompleted < size)
+    {
+        for (unsigned i = 0; i < connections; ++i)
+        {
+            auto& req = reqs[i];
+
+            unsigned slowest;
+            if (req && buffers.isRaid() && req->contentlength == req->size && buffers.detectSlowestRaidConnection(i, slowest))
+            {
+                reqs[slowest].reset();
+                buffers.resetPart(slowest);
+                ++result.slowPartSwitches;
+            }
+
+            if (req && req->status == REQ_FAILURE)
+            {
+                req.reset();
+                if (!buffers.isRaid() || !buffers.tryRaidHttpGetErrorRecovery(i, true))
+                {
+                    return result;
+                }
+                ++result.recoveries;
+            }
+            else if (req && req->status == REQ_SUCCESS)
+            {
+                buffers.submitBuffer(i, new TransferBufferManager::FilePiece(req->dlpos, req->release_buf()));
+                req.reset();
+            }
+
+            // the output is written in place, synchronously
+            while (auto piece = buffers.getAsyncOutputBufferPointer(i))
+            {
+                if (piece->finalize(false, size, transfer.ctriv, &cipher, &transfer.chunkmacs))
+                {
+                    piece->finalize(true, size, transfer.ctriv, &cipher, nullptr);
+                }
+                buffers.bufferWriteCompleted(i, true);
+            }
+
+            if (req || (buffers.isRaid() && buffers.isUnusedRaidConection(i)))
+            {
+                continue;
+            }
+
+            bool newInputBufferSupplied = false;
+            bool pauseConnectionInputForRaid = false;
+            auto range = buffers.nextNPosForConnection(i, MAX_REQUEST_SIZE, connections, newInputBufferSupplied, pauseConnectionInputForRaid, 0);
+            if (!newInputBufferSupplied && !pauseConnectionInputForRaid && range.second > range.first)
+            {
+                req = std::make_shared<HttpReqDL>();
+                req->prepare(buffers.tempURL(i).c_str(), &cipher, static_cast<uint64_t>(transfer.ctriv), range.first, range.second);
+                req->pos = range.first;
+                req->post(&client);
+                buffers.transferPos(i) = std::max(buffers.transferPos(i), range.second);
+            }
+        }
+
+        client.wait();
+        client.exec();
+    }
+
+    result.succeeded = true;
+    return result;
+}
+
+// Drives an upload as TransferSlot::doio() does, in short: each connection encrypts and posts the next range once free
+TransferResult upload(MegaClient& client, const std::string& url, m_off_t size)
+{
+    TransferResult result;
+    Transfer transfer(&client, PUT);
+    transfer.size = size;
+    SymmCipher cipher;
+    setKey(cipher, transfer);
+
+    TransferBufferManager buffers;
+    buffers.setIsRaid(&transfer, { url }, 0, MAX_REQUEST_SIZE, false);
+    std::vector<std::shared_ptr<HttpReqUL>> reqs(CONNECTIONS);
+
+    m_off_t uploaded = 0;
+    while (uploaded < size)
+    {
+        for (unsigned i = 0; i < CONNECTIONS; ++i)
+        {
+            auto& req = reqs[i];
+            if (req && req->status == REQ_FAILURE)
+            {
+                return result;
+            }
+
+            if (req && req->status == REQ_SUCCESS)
+            {
+                req->mChunkmacs.copyEntriesTo(transfer.chunkmacs);
+                uploaded += req->size;
+                req.reset();
+            }
+
+            if (req)
+            {
+                continue;
+            }
+
+            bool newInputBufferSupplied = false;
+            bool pauseConnectionInputForRaid = false;
+            auto range = buffers.nextNPosForConnection(i, MAX_REQUEST_SIZE, CONNECTIONS, newInputBufferSupplied, pauseConnectionInputForRaid, 0);
+            if (range.second > range.first)
+            {
+                // as read from the file, padded for the encryption
+                const size_t length = static_cast<size_t>(range.second - range.first);
+                req = std::make_shared<HttpReqUL>();
+                req->out->resize(length + (SymmCipher::BLOCKSIZE - length % SymmCipher::BLOCKSIZE) % SymmCipher::BLOCKSIZE);
+                for (size_t n = 0; n < length; ++n)
+                {
+                    (*req->out)[n] = static_cast<char>(bench::StorageServer::fileByte(range.first + static_cast<m_off_t>(n)));
+                }
+
+                req->prepare(url.c_str(), &cipher, static_cast<uint64_t>(transfer.ctriv), range.first, range.second);
+                req->pos = range.first;
+                req->post(&client);
+                buffers.transferPos(i) = std::max(buffers.transferPos(i), range.second);
+            }
+        }
+
+        client.wait();
+        client.exec();
+    }
+
+    result.succeeded = true;
+    return result;
+}
+
+void report(benchmark::State& state, const TransferResult& result, const bench::StorageServer& server)
+{
+    if (!result.succeeded)
+    {
+        state.SkipWithError("The transfer failed");
+        return;
+    }
+
+    state.counters["recoveries"] = result.recoveries;
+    state.counters["slow_part_switches"] = result.slowPartSwitches;
+    state.counters["served_bytes"] = static_cast<double>(server.servedBytes());
+}
+
+void runDownload(benchmark::State& state, const std::array<bench::StorageBehaviour, RAIDPARTS>& parts, bool raid)
+{
+    bench::StorageServer server(FILE_SIZE, parts);
+    bench::Client client(std::string(), std::make_unique<CurlHttpIO>());
+
+    TransferResult result;
+    for (auto _ : state)
+    {
+        result = download(*client.client, raid ? server.raidUrls() : std::vector<std::string>{ server.fileUrl() }, FILE_SIZE);
+        if (!result.succeeded)
+        {
+            break;
+        }
+    }
+
+    report(state, result, server);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * FILE_SIZE);
+}
+
+void BM_Transfer_download(benchmark::State& state)
+{
+    runDownload(state, {}, false);
+}
+
+void BM_Transfer_download_raid(benchmark::State& state)
+{
+    runDownload(state, {}, true);
+}
+
+// every part takes 50 ms to reply
+void BM_Transfer_download_raidLatency(benchmark::State& state)
+{
+    std::array<bench::StorageBehaviour, RAIDPARTS> parts;
+    parts.fill({ 50ms, 0, 0 });
+    runDownload(state, parts, true);
+}
+
+// one of the parts replies late, and at 2 MB/s
+void BM_Transfer_download_raidSlowPart(benchmark::State& state)
+{
+    std::array<bench::StorageBehaviour, RAIDPARTS> parts{};
+    parts[3] = { 500ms, 2 * 1024 * 1024, 0 };
+    runDownload(state, parts, true);
+}
+
+// one of the parts drops 10% of its connections halfway
+void BM_Transfer_download_raidLossyPart(benchmark::State& state)
+{
+    std::array<bench::StorageBehaviour, RAIDPARTS> parts{};
+    parts[2] = { 0ms, 0, 0.1 };
+    runDownload(state, parts, true);
+}
+
+void BM_Transfer_upload(benchmark::State& state)
+{
+    bench::StorageServer server(FILE_SIZE, {});
+    bench::Client client(std::string(), std::make_unique<CurlHttpIO>());
+
+    TransferResult result;
+    for (auto _ : state)
+    {
+        result = upload(*client.client, server.uploadUrl(), FILE_SIZE);
+        if (!result.succeeded)
+        {
+            break;
+        }
+    }
+
+    report(state, result, server);
+    state.counters["uploaded_bytes"] = static_cast<double>(server.uploadedBytes());
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * FILE_SIZE);
+}
+
+BENCHMARK(BM_Transfer_download)->Iterations(3)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Transfer_download_raid)->Iterations(3)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Transfer_download_raidLatency)->Iterations(3)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Transfer_download_raidSlowPart)->Iterations(3)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Transfer_download_raidLossyPart)->Iterations(3)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Transfer_upload)->Iterations(3)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+} // namespace
@@ -0,0 +1,307 @@
+/**
+ * @file fixtures.cpp
+ * @brief Synthetic data for the benchmarks of the SDK
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "fixtures.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <sstream>
+
+#include <mega.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+using namespace mega;
+
+namespace bench {
+
+namespace {
+
+std::string randomName(std::mt19937& rng, size_t minLength = 4, size_t maxLength = 24)
+{
+    static const char chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 _-.";
+    std::uniform_int_distribution<size_t> length(minLength, maxLength);
+    std::uniform_int_distribution<size_t> index(0, sizeof(chars) - 2);
+
+    std::string name(length(rng), ' ');
+    for (auto& c : name)
+    {
+        c = chars[index(rng)];
+    }
+    return name;
+}
+
+std::string randomB64(std::mt19937& rng, size_t bytes)
+{
+    std::string raw(bytes, '\0');
+    for (auto& c : raw)
+    {
+        c = static_cast<char>(rng());
+    }
+    std::string b64;
+    Base64::btoa(raw, b64);
+    return b64;
+}
+
+std::string handleB64(handle h, int size)
+{
+    char buf[16];
+    Base64::btoa(reinterpret_cast<const byte*>(&h), size, buf);
+    return buf;
+}
+
+// a node as sent by the API, with encrypted attributes and key
+void writeNode(std::ostringstream& out, std::mt19937& rng, handle h, handle parent, bool folder)
+{
+    out << "{\"h\":\"" << handleB64(h, MegaClient::NODEHANDLE) << "\""
+        << ",\"p\":\"" << handleB64(parent, MegaClient::NODEHANDLE) << "\""
+        << ",\"u\":\"" << handleB64(0x1234567890ull, MegaClient::USERHANDLE) << "\""
+        << ",\"t\":" << (folder ? 1 : 0)
+        << ",\"a\":\"" << randomB64(rng, 64) << "\""
+        << ",\"k\":\"" << handleB64(0x1234567890ull, MegaClient::USERHANDLE) << ":" << randomB64(rng, folder ? 16 : 32) << "\"";
+    if (!folder)
+    {
+        out << ",\"s\":" << (rng() % (1 << 30));
+    }
+    out << ",\"ts\":" << (1600000000 + rng() % 100000000) << "}";
+}
+
+} // namespace
+
+const std::string& fetchnodesJson(size_t nodes)
+{
+    static std::map<size_t, std::string> cache;
+    auto& json = cache[nodes];
+    if (!json.empty())
+    {
+        return json;
+    }
+
+    std::mt19937 rng(static_cast<unsigned>(nodes));
+    std::ostringstream out;
+    out << "{\"f\":[";
+    handle folder = 1;
+    for (size_t i = 0; i < nodes; ++i)
+    {
+        bool isFolder = !(i % 10);
+        handle h = i + 1;
+        if (i)
+        {
+            out << ",";
+        }
+        writeNode(out, rng, h, folder, isFolder);
+        if (isFolder)
+        {
+            folder = h;
+        }
+    }
+    out << "],\"ok0\":[],\"s\":[],\"u\":[],\"sn\":\"" << randomB64(rng, 8) << "\"}";
+
+    json = out.str();
+    return json;
+}
+
+const std::string& actionPacketsJson(size_t packets)
+{
+    static std::map<size_t, std::string> cache;
+    auto& json = cache[packets];
+    if (!json.empty())
+    {
+        return json;
+    }
+
+    std::mt19937 rng(static_cast<unsigned>(packets) + 1);
+    std::ostringstream out;
+    out << "{\"w\":\"https://w.api.mega.co.nz/abcdef\",\"sn\":\"" << randomB64(rng, 8) << "\",\"a\":[";
+    for (size_t i = 0; i < packets; ++i)
+    {
+        if (i)
+        {
+            out << ",";
+        }
+
+        handle h = 1000000 + i;
+        switch (i % 3)
+        {
+        case 0:
+            out << "{\"a\":\"t\",\"i\":\"" << randomName(rng, 10, 10) << "\",\"t\":{\"f\":[";
+            writeNode(out, rng, h, 1, false);
+            out << "]},\"ou\":\"" << handleB64(0x1234567890ull, MegaClient::USERHANDLE) << "\"}";
+            break;
+        case 1:
+            out << "{\"a\":\"u\",\"i\":\"" << randomName(rng, 10, 10) << "\",\"n\":\"" << handleB64(h - 1, MegaClient::NODEHANDLE)
+                << "\",\"u\":\"" << handleB64(0x1234567890ull, MegaClient::USERHANDLE)
+                << "\",\"at\":\"" << randomB64(rng, 64) << "\",\"ts\":" << (1600000000 + rng() % 100000000) << "}";
+            break;
+        default:
+            out << "{\"a\":\"d\",\"i\":\"" << randomName(rng, 10, 10) << "\",\"n\":\"" << handleB64(h - 2, MegaClient::NODEHANDLE) << "\"}";
+            break;
+        }
+    }
+    out << "]}";
+
+    json = out.str();
+    return json;
+}
+
+const std::vector<std::string>& fileTreePaths(size_t files)
+{
+    static std::map<size_t, std::vector<std::string>> cache;
+    auto& paths = cache[files];
+    if (!paths.empty())
+    {
+        return paths;
+    }
+
+    std::mt19937 rng(static_cast<unsigned>(files) + 2);
+    std::vector<std::string> folders{ "" };
+    std::uniform_int_distribution<int> newFolder(0, 9);
+    for (size_t i = 0; i < files; ++i)
+    {
+        std::uniform_int_distribution<size_t> pick(0, folders.size() - 1);
+        std::string parent = folders[pick(rng)];
+        if (!newFolder(rng) && std::count(parent.begin(), parent.end(), '/') < 8)
+        {
+            parent += randomName(rng) + "/";
+            folders.push_back(parent);
+        }
+        paths.push_back(parent + randomName(rng) + ".jpg");
+    }
+    return paths;
+}
+
+size_t peakResidentBytes()
+{
+#ifndef _WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage))
+    {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#else
+    return 0;
+#endif
+}
+
+Client::Client(const std::string& dbPath, std::unique_ptr<HttpIO> httpio)
+    : httpio(std::move(httpio))
+{
+    struct HttpIo : HttpIO
+    {
+        void addevents(Waiter*, int) override {}
+        void post(struct HttpReq*, const char* = NULL, unsigned = 0) override {}
+        void cancel(HttpReq*) override {}
+        m_off_t postpos(void*) override { return {}; }
+        bool doio(void) override { return {}; }
+        void setuseragent(std::string*) override {}
+    };
+    if (!this->httpio)
+    {
+        this->httpio.reset(new HttpIo);
+    }
+
+    DbAccess* dbAccess = dbPath.empty() ? nullptr : new SqliteDbAccess(LocalPath::fromAbsolutePath(dbPath));
+    client = new MegaClient(&app, std::make_shared<WAIT_CLASS>(), this->httpio.get(), dbAccess, nullptr, "XXX", "sdk_bench", 0);
+}
+
+Client::~Client()
+{
+    delete client;
+}
+
+Client& clientWithNodes(size_t nodes)
+{
+    static std::map<size_t, std::unique_ptr<Client>> cache;
+    auto& cached = cache[nodes];
+    if (cached)
+    {
+        return *cached;
+    }
+
+    cached.reset(new Client(LocalPath::fromRelativePath(".").toPath(false)));
+    MegaClient& client = *cached->client;
+
+    // a different session per size, for a different database
+    std::mt19937 rng(static_cast<unsigned>(nodes) + 3);
+    std::string size = std::to_string(nodes);
+    client.sid.assign(MegaClient::SIDLEN, 'S');
+    client.sid.replace(client.sid.size() - size.size(), size.size(), size);
+    client.opensctable();
+
+    // the database of a previous run is regenerated
+    client.sctable->truncate();
+    dynamic_cast<DBTableNodes&>(*client.sctable).removeNodes();
+    client.mNodeManager.setCacheLRUMaxSize(10000);
+
+    NodeManager::MissingParentNodes missingParentNodes;
+    auto addNode = [&](nodetype_t type, handle h, Node* parent) -> Node*
+    {
+        NodeHandle parentHandle = parent ? parent->nodeHandle() : NodeHandle();
+        auto node = std::make_shared<Node>(client, NodeHandle().set6byte(h), parentHandle, type, type == FILENODE ? 1000 : -1, UNDEF, nullptr, 0);
+        if (type == FILENODE || type == FOLDERNODE)
+        {
+            node->setkey(reinterpret_cast<const byte*>(std::string(type == FILENODE ? FILENODEKEYLENGTH : FOLDERNODEKEYLENGTH, 'X').c_str()));
+            node->attrs.map['n'] = randomName(rng) + (type == FILENODE ? ".jpg" : "");
+        }
+        if (type == FILENODE)
+        {
+            node->size = 1000 + static_cast<m_off_t>(rng() % 1000000);
+            node->mtime = 1600000000 + rng() % 100000000;
+            node->crc[0] = static_cast<int32_t>(rng());
+            node->isvalid = true;
+            node->serializefingerprint(&node->attrs.map['c']);
+        }
+        client.mNodeManager.addNode(node, false, true, missingParentNodes);
+        client.mNodeManager.saveNodeInDb(node.get());
+        return node.get();
+    };
+
+    Node* root = addNode(ROOTNODE, 1, nullptr);
+    addNode(VAULTNODE, 2, nullptr);
+    addNode(RUBBISHNODE, 3, nullptr);
+    cached->root = root->nodeHandle();
+
+    Node* folder = root;
+    for (size_t i = 0; i < nodes; ++i)
+    {
+        handle h = 100 + i;
+        if (!(i % 10))
+        {
+            folder = addNode(FOLDERNODE, h, i % 1000 ? folder : root);
+        }
+        else
+        {
+            addNode(FILENODE, h, folder);
+        }
+    }
+
+    return *cached;
+}
+
+} // namespace bench
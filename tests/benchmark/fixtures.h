@@ -0,0 +1,69 @@
+/**
+ * @file fixtures.h
+ * @brief Synthetic data for the benchmarks of the SDK
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <mega/megaapp.h>
+#include <mega/megaclient.h>
+
+namespace bench {
+
+// The fixtures are generated from fixed seeds, so every run measures the same data.
+// The same data, in the same format, as recorded from the API:
+
+// response of a fetchnodes ('f' command) with 'nodes' nodes, 10 files per folder
+const std::string& fetchnodesJson(size_t nodes);
+
+// sc response with 'packets' action packets mixing new nodes ('t'), updates ('u') and deletions ('d')
+const std::string& actionPacketsJson(size_t packets);
+
+// relative paths of a random file tree with 'files' files, up to 8 levels deep
+const std::vector<std::string>& fileTreePaths(size_t files);
+
+// bytes currently allocated through operator new, which sdk_bench replaces to count them
+// for the memory benchmarks (the allocator's own overhead isn't included)
+size_t allocatedBytes();
+
+// peak resident memory of the process so far, 0 where it isn't available
+size_t peakResidentBytes();
+
+// A MegaClient with no network (unless 'httpio' is given), for the NodeManager and the database.
+// 'dbPath' is where its database is created, when not empty
+struct Client
+{
+    explicit Client(const std::string& dbPath = std::string(), std::unique_ptr<mega::HttpIO> httpio = nullptr);
+    ~Client();
+
+    mega::MegaApp app;
+    mega::MegaClient* client = nullptr;
+    std::unique_ptr<mega::HttpIO> httpio;
+    mega::NodeHandle root;
+};
+
+// A client whose account has 'nodes' nodes (files and folders with names and fingerprints),
+// stored in a database under the working directory. It's kept for the whole run
+Client& clientWithNodes(size_t nodes);
+
+} // namespace bench
@@ -0,0 +1,87 @@
+/**
+ * @file main.cpp
+ * @brief Entry point of the benchmarks of the SDK
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <mega/logging.h>
+
+#include "fixtures.h"
+
+namespace {
+
+std::atomic<size_t> gAllocatedBytes{0};
+
+// the size of each allocation is kept before it, with the alignment of any type
+constexpr size_t HEADER = alignof(std::max_align_t);
+
+} // namespace
+
+void* operator new(size_t size)
+{
+    auto* block = static_cast<char*>(std::malloc(size + HEADER));
+    if (!block)
+    {
+        throw std::bad_alloc();
+    }
+    *reinterpret_cast<size_t*>(block) = size;
+    gAllocatedBytes += size;
+    return block + HEADER;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (ptr)
+    {
+        auto* block = static_cast<char*>(ptr) - HEADER;
+        gAllocatedBytes -= *reinterpret_cast<size_t*>(block);
+        std::free(block);
+    }
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+size_t bench::allocatedBytes()
+{
+    return gAllocatedBytes;
+}
+
+int main(int argc, char** argv)
+{
+    // the SDK logs would be measured too
+    mega::SimpleLogger::setLogLevel(mega::logError);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,346 @@
+/**
+ * @file storage_server.cpp
+ * @brief Local HTTP server standing in for the storage servers, for the transfer benchmarks
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "storage_server.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <sstream>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace mega;
+using std::chrono::steady_clock;
+
+namespace bench {
+
+namespace {
+
+constexpr size_t BLOCK = 64 * 1024;
+
+bool sendAll(int socket, const char* data, size_t len)
+{
+    while (len)
+    {
+        ssize_t n = ::send(socket, data, len, MSG_NOSIGNAL);
+        if (n <= 0)
+        {
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// "a-b" as sent by HttpReqDL::prepare(), both included
+bool parseRange(const std::string& range, m_off_t& start, m_off_t& end)
+{
+    auto dash = range.find('-');
+    if (dash == std::string::npos)
+    {
+        return false;
+    }
+    start = std::strtoll(range.c_str(), nullptr, 10);
+    end = std::strtoll(range.c_str() + dash + 1, nullptr, 10);
+    return start <= end;
+}
+
+} // namespace
+
+StorageServer::StorageServer(m_off_t fileSize, const std::array<StorageBehaviour, RAIDPARTS>& behaviours)
+    : mFileSize(fileSize)
+    , mBehaviours(behaviours)
+{
+    mListener = ::socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    ::setsockopt(mListener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof reuse);
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0; // any free port
+    socklen_t length = sizeof address;
+    if (::bind(mListener, reinterpret_cast<sockaddr*>(&address), length)
+        || ::listen(mListener, 64)
+        || ::getsockname(mListener, reinterpret_cast<sockaddr*>(&address), &length))
+    {
+        ::close(mListener);
+        mListener = -1;
+        return;
+    }
+
+    mPort = ntohs(address.sin_port);
+    mAcceptor = std::thread(&StorageServer::accept, this);
+}
+
+StorageServer::~StorageServer()
+{
+    mStopping = true;
+    if (mListener >= 0)
+    {
+        ::shutdown(mListener, SHUT_RDWR);
+        ::close(mListener);
+    }
+    if (mAcceptor.joinable())
+    {
+        mAcceptor.join();
+    }
+
+    // the connections still open are woken up
+    std::lock_guard<std::mutex> g(mConnectionsLock);
+    for (int socket : mSockets)
+    {
+        ::shutdown(socket, SHUT_RDWR);
+    }
+    for (auto& connection : mConnections)
+    {
+        connection.join();
+    }
+    for (int socket : mSockets)
+    {
+        ::close(socket);
+    }
+}
+
+std::string StorageServer::url(const std::string& path) const
+{
+    return "http://127.0.0.1:" + std::to_string(mPort) + path;
+}
+
+std::vector<std::string> StorageServer::raidUrls() const
+{
+    std::vector<std::string> urls;
+    for (unsigned part = 0; part < RAIDPARTS; ++part)
+    {
+        urls.push_back(url("/dl/" + std::to_string(part)));
+    }
+    return urls;
+}
+
+std::string StorageServer::fileUrl() const
+{
+    return url("/file");
+}
+
+std::string StorageServer::uploadUrl() const
+{
+    return url("/ul");
+}
+
+byte StorageServer::fileByte(m_off_t pos)
+{
+    uint64_t x = static_cast<uint64_t>(pos) * 0x9E3779B97F4A7C15ull;
+    return static_cast<byte>(x >> 56);
+}
+
+byte StorageServer::partByte(unsigned part, m_off_t pos) const
+{
+    // the data parts have consecutive sectors of the file, the parity part has the xor of them
+    if (!part)
+    {
+        byte parity = 0;
+        for (unsigned p = 1; p < RAIDPARTS; ++p)
+        {
+            parity ^= partByte(p, pos);
+        }
+        return parity;
+    }
+
+    m_off_t sector = pos / RAIDSECTOR;
+    m_off_t filePos = (sector * EFFECTIVE_RAIDPARTS + part - 1) * RAIDSECTOR + pos % RAIDSECTOR;
+    return filePos < mFileSize ? fileByte(filePos) : 0;
+}
+
+void StorageServer::accept()
+{
+    while (!mStopping)
+    {
+        int socket = ::accept(mListener, nullptr, nullptr);
+        if (socket < 0)
+        {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> g(mConnectionsLock);
+        if (mStopping)
+        {
+            ::close(socket);
+            break;
+        }
+
+        mSockets.push_back(socket);
+        mConnections.emplace_back(&StorageServer::serve, this, socket);
+    }
+}
+
+void StorageServer::serve(int socket)
+{
+    std::mt19937 rng(static_cast<unsigned>(socket));
+    std::uniform_real_distribution<double> chance(0, 1);
+    std::string in;
+    std::vector<char> buffer(BLOCK);
+
+    auto receive = [&]() {
+        ssize_t n = ::recv(socket, buffer.data(), buffer.size(), 0);
+        if (n <= 0)
+        {
+            return false;
+        }
+        in.append(buffer.data(), static_cast<size_t>(n));
+        return true;
+    };
+
+    while (!mStopping)
+    {
+        size_t headersEnd;
+        while ((headersEnd = in.find("\r\n\r\n")) == std::string::npos)
+        {
+            if (!receive())
+            {
+                ::shutdown(socket, SHUT_RDWR);
+                return;
+            }
+        }
+
+        std::istringstream headers(in.substr(0, headersEnd));
+        in.erase(0, headersEnd + 4);
+
+        std::string method, path, line;
+        headers >> method >> path;
+        size_t contentLength = 0;
+        while (std::getline(headers, line))
+        {
+            if (!strncasecmp(line.c_str(), "Content-Length:", 15))
+            {
+                contentLength = std::strtoul(line.c_str() + 15, nullptr, 10);
+            }
+        }
+
+        // uploads (and the empty bodies of the downloads) are consumed without being kept
+        const bool upload = !path.compare(0, 3, "/ul");
+        while (contentLength)
+        {
+            if (in.empty() && !receive())
+            {
+                ::shutdown(socket, SHUT_RDWR);
+                return;
+            }
+
+            size_t consumed = std::min(in.size(), contentLength);
+            in.erase(0, consumed);
+            contentLength -= consumed;
+            if (upload)
+            {
+                mUploadedBytes += static_cast<m_off_t>(consumed);
+            }
+        }
+
+        // /dl/<part>/<range> or /file/<range>
+        int part = -1;
+        bool whole = false;
+        m_off_t size = 0;
+        m_off_t start = 0, end = -1;
+        if (!path.compare(0, 4, "/dl/"))
+        {
+            part = std::atoi(path.c_str() + 4);
+            auto slash = path.find('/', 4);
+            if (part < 0 || part >= static_cast<int>(RAIDPARTS) || slash == std::string::npos || !parseRange(path.substr(slash + 1), start, end))
+            {
+                part = -1;
+            }
+            else
+            {
+                size = RaidBufferManager::raidPartSize(static_cast<unsigned>(part), mFileSize);
+            }
+        }
+        else if (!path.compare(0, 6, "/file/") && parseRange(path.substr(6), start, end))
+        {
+            part = 0;
+            whole = true;
+            size = mFileSize;
+        }
+
+        if (part < 0 && !upload)
+        {
+            const char notFound[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+            if (!sendAll(socket, notFound, sizeof notFound - 1)) break;
+            continue;
+        }
+
+        const StorageBehaviour& behaviour = mBehaviours[part < 0 ? 0 : static_cast<size_t>(part)];
+        std::this_thread::sleep_for(behaviour.latency);
+
+        end = std::min(end + 1, size);
+        m_off_t length = part < 0 ? 0 : std::max<m_off_t>(end - start, 0);
+        std::string response = "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: "
+                             + std::to_string(length) + "\r\n\r\n";
+        if (!sendAll(socket, response.data(), response.size()))
+        {
+            break;
+        }
+
+        const bool lose = behaviour.lossRate > 0 && chance(rng) < behaviour.lossRate;
+        const auto started = steady_clock::now();
+        m_off_t sent = 0;
+        bool failed = false;
+        while (sent < length)
+        {
+            if (lose && sent >= length / 2)
+            {
+                failed = true;
+                break;
+            }
+
+            size_t block = static_cast<size_t>(std::min<m_off_t>(length - sent, BLOCK));
+            for (size_t i = 0; i < block; ++i)
+            {
+                m_off_t pos = start + sent + static_cast<m_off_t>(i);
+                buffer[i] = static_cast<char>(whole ? fileByte(pos) : partByte(static_cast<unsigned>(part), pos));
+            }
+            if (!sendAll(socket, buffer.data(), block))
+            {
+                failed = true;
+                break;
+            }
+            sent += static_cast<m_off_t>(block);
+            mServedBytes += static_cast<m_off_t>(block);
+
+            if (behaviour.bytesPerSecond)
+            {
+                std::this_thread::sleep_until(started + std::chrono::microseconds(sent * 1000000 / static_cast<m_off_t>(behaviour.bytesPerSecond)));
+            }
+        }
+
+        if (failed)
+        {
+            break;
+        }
+    }
+
+    ::shutdown(socket, SHUT_RDWR);
+}
+
+} // namespace bench
@@ -0,0 +1,105 @@
+/**
+ * @file storage_server.h
+ * @brief Local HTTP server standing in for the storage servers, for the transfer benchmarks
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <mega/raid.h>
+
+namespace bench {
+
+// How the server of one raid part (or of the whole file, for the part 0 of non-raid files) behaves
+struct StorageBehaviour
+{
+    // before the response headers
+    std::chrono::milliseconds latency{0};
+
+    // 0 for no limit
+    size_t bytesPerSecond = 0;
+
+    // probability of dropping the connection halfway through a response
+    double lossRate = 0;
+};
+
+// Serves the ranges of a synthetic file of 'fileSize' bytes, as either the 6 raid parts or as a whole,
+// and takes uploads of any size. Every connection is served by its own thread, with keep-alive
+class StorageServer
+{
+public:
+    StorageServer(m_off_t fileSize, const std::array<StorageBehaviour, mega::RAIDPARTS>& behaviours);
+
+    ~StorageServer();
+
+    // temporary URLs of the raid parts, as returned by the API
+    std::vector<std::string> raidUrls() const;
+
+    // temporary URL of the whole file
+    std::string fileUrl() const;
+
+    // temporary URL for uploads
+    std::string uploadUrl() const;
+
+    m_off_t uploadedBytes() const { return mUploadedBytes; }
+
+    m_off_t servedBytes() const { return mServedBytes; }
+
+    // the byte of the file, or of a raid part, at the given offset (part 0 being the parity ones)
+    static mega::byte fileByte(m_off_t pos);
+    mega::byte partByte(unsigned part, m_off_t pos) const;
+
+private:
+    void accept();
+
+    void serve(int socket);
+
+    std::string url(const std::string& path) const;
+
+    m_off_t mFileSize;
+
+    std::array<StorageBehaviour, mega::RAIDPARTS> mBehaviours;
+
+    int mListener = -1;
+
+    int mPort = 0;
+
+    std::atomic<bool> mStopping{false};
+
+    std::thread mAcceptor;
+
+    std::mutex mConnectionsLock;
+
+    std::vector<std::thread> mConnections;
+
+    std::vector<int> mSockets;
+
+    std::atomic<m_off_t> mUploadedBytes{0};
+
+    std::atomic<m_off_t> mServedBytes{0};
+};
+
+} // namespace bench
@@ -19,6 +19,7 @@
 #include <gtest/gtest.h>
 
 #include <mega/attrmap.h>
+#include <algorithm>
 #include <map>
 #include <string>
 
@@ -60,4 +61,36 @@ TEST(AttrMap, unserialize_32bit)
 
     ASSERT_EQ(expMap.map, newMap.map);
 }
-#endif
\ No newline at end of file
+#endif
+TEST(AttrMap, attr_map_sortedLikeMap)
+{
+    mega::attr_map map;
+    ASSERT_TRUE(map.empty());
+
+    map['n'] = "name";
+    map['c'] = "fingerprint";
+    map[mega::AttrMap::string2nameid("lbl")] = "1";
+    ASSERT_EQ(map.size(), 3u);
+
+    // an existing attribute isn't replaced by emplace, but it is through []
+    ASSERT_FALSE(map.emplace('n', "other").second);
+    ASSERT_EQ(map.at('n'), "name");
+    map['n'] = "other";
+    ASSERT_EQ(map.at('n'), "other");
+
+    ASSERT_TRUE(map.contains('c'));
+    ASSERT_EQ(map.find('x'), map.end());
+    ASSERT_THROW(map.at('x'), std::out_of_range);
+
+    // iterated in the order of a std::map, so the serialization doesn't change
+    std::map<mega::nameid, std::string> reference{ { 'n', "other" }, { 'c', "fingerprint" }, { mega::AttrMap::string2nameid("lbl"), "1" } };
+    ASSERT_TRUE(std::equal(map.begin(), map.end(), reference.begin(), reference.end(),
+                           [](const std::pair<mega::nameid, std::string>& a, const std::pair<const mega::nameid, std::string>& b)
+                           { return a.first == b.first && a.second == b.second; }));
+    ASSERT_EQ(map, mega::attr_map(std::move(reference)));
+
+    ASSERT_EQ(map.erase('c'), 1u);
+    ASSERT_EQ(map.erase('c'), 0u);
+    map.erase(map.find('n'));
+    ASSERT_EQ(map.size(), 1u);
+}
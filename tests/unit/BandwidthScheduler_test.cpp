@@ -0,0 +1,123 @@
+/**
+ * @file BandwidthScheduler_test.cpp
+ * @brief Unitary test for the weighted share of the bandwidth limits
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mega/http.h>
+
+using namespace mega;
+
+namespace {
+
+constexpr m_off_t LIMIT = 10 * 1024 * 1024; // 10 MB/s
+constexpr m_off_t WRITE_SIZE = 16 * 1024;   // bytes delivered by cURL at once
+
+// Requests of the classes in 'wanted' transfer as much as they are allowed for 'seconds'.
+// Returns the bytes transferred by each class
+std::array<m_off_t, BW_CLASSES> run(BandwidthScheduler& scheduler, const std::array<bool, BW_CLASSES>& wanted, dstime& now, int seconds)
+{
+    std::array<m_off_t, BW_CLASSES> transferred{};
+    for (dstime end = now + seconds * SpeedController::DS_PER_SECOND; now < end; now++)
+    {
+        scheduler.refill(now);
+
+        // every class gets some turns per decisecond, the background one first
+        for (int turn = 0; turn < 100; turn++)
+        {
+            for (int c = BW_CLASSES; c--; )
+            {
+                if (wanted[c] && scheduler.available(bwclass_t(c), now) >= WRITE_SIZE)
+                {
+                    scheduler.consume(bwclass_t(c), WRITE_SIZE);
+                    transferred[c] += WRITE_SIZE;
+                }
+            }
+        }
+    }
+    return transferred;
+}
+
+} // namespace
+
+TEST(BandwidthScheduler, WeightedShares)
+{
+    BandwidthScheduler scheduler;
+    scheduler.setLimit(LIMIT);
+    dstime now = 100;
+
+    // warm up until all the classes are active
+    run(scheduler, { true, true, true }, now, 2);
+
+    auto transferred = run(scheduler, { true, true, true }, now, 10);
+    m_off_t total = transferred[BW_STREAMING] + transferred[BW_INTERACTIVE] + transferred[BW_BACKGROUND];
+    ASSERT_NEAR(double(total), double(LIMIT * 10), double(LIMIT) / 2);
+
+    unsigned totalWeight = BandwidthScheduler::WEIGHTS[BW_STREAMING] + BandwidthScheduler::WEIGHTS[BW_INTERACTIVE] + BandwidthScheduler::WEIGHTS[BW_BACKGROUND];
+    for (int c = 0; c < BW_CLASSES; c++)
+    {
+        double expected = double(total) * BandwidthScheduler::WEIGHTS[c] / totalWeight;
+        ASSERT_NEAR(double(transferred[c]), expected, expected * 0.05) << "class " << c;
+    }
+}
+
+TEST(BandwidthScheduler, IdleSharesGoToTheOthers)
+{
+    BandwidthScheduler scheduler;
+    scheduler.setLimit(LIMIT);
+    dstime now = 100;
+
+    // background transfers alone take the whole limit
+    auto transferred = run(scheduler, { false, false, true }, now, 10);
+    ASSERT_NEAR(double(transferred[BW_BACKGROUND]), double(LIMIT * 10), double(LIMIT) / 2);
+
+    // streaming gets its share right away, the rest is still used
+    transferred = run(scheduler, { true, false, true }, now, 10);
+    ASSERT_GT(transferred[BW_STREAMING], transferred[BW_BACKGROUND] * 4);
+    ASSERT_NEAR(double(transferred[BW_STREAMING] + transferred[BW_BACKGROUND]), double(LIMIT * 10), double(LIMIT) / 2);
+
+    // and it is given back once it stops
+    run(scheduler, { false, false, true }, now, 2);
+    transferred = run(scheduler, { false, false, true }, now, 10);
+    ASSERT_NEAR(double(transferred[BW_BACKGROUND]), double(LIMIT * 10), double(LIMIT) / 2);
+}
+
+TEST(BandwidthScheduler, WritesBiggerThanTheBuckets)
+{
+    BandwidthScheduler scheduler;
+    scheduler.setLimit(1024); // 1 KB/s
+    dstime now = 100;
+
+    scheduler.refill(now);
+    m_off_t available = scheduler.available(BW_INTERACTIVE, now);
+    ASSERT_GT(available, 0);
+    ASSERT_LT(available, BandwidthScheduler::MIN_BURST);
+
+    // the debt of a big write is paid back before getting more tokens
+    scheduler.consume(BW_INTERACTIVE, BandwidthScheduler::MIN_BURST);
+    ASSERT_EQ(scheduler.available(BW_INTERACTIVE, now), available - BandwidthScheduler::MIN_BURST);
+
+    dstime start = now;
+    while (scheduler.available(BW_INTERACTIVE, now) <= 0)
+    {
+        scheduler.refill(++now);
+    }
+    ASSERT_GE(now - start, dstime((BandwidthScheduler::MIN_BURST - available) * SpeedController::DS_PER_SECOND / 1024));
+}
@@ -0,0 +1,122 @@
+/**
+ * @file Base64_test.cpp
+ * @brief Unitary test for the base64 codec
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include <mega/base64.h>
+
+using namespace mega;
+
+namespace {
+
+const char* ALPHABET = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// one character at a time, as the codec used to do
+std::string referenceBtoa(const std::string& bytes)
+{
+    std::string chars;
+    unsigned bits = 0;
+    int numBits = 0;
+    for (unsigned char c : bytes)
+    {
+        bits = (bits << 8) | c;
+        numBits += 8;
+        while (numBits >= 6)
+        {
+            numBits -= 6;
+            chars += ALPHABET[(bits >> numBits) & 63];
+        }
+    }
+    if (numBits)
+    {
+        chars += ALPHABET[(bits << (6 - numBits)) & 63];
+    }
+    return chars;
+}
+
+std::string randomBytes(std::mt19937& rng, size_t size)
+{
+    std::string bytes(size, '\0');
+    for (auto& c : bytes)
+    {
+        c = static_cast<char>(rng());
+    }
+    return bytes;
+}
+
+} // namespace
+
+// all the lengths around the vector blocks, so every remainder goes through the scalar code
+TEST(Base64, RoundTrip)
+{
+    std::mt19937 rng(42);
+    for (size_t size = 0; size < 400; ++size)
+    {
+        std::string bytes = randomBytes(rng, size);
+        std::string chars = Base64::btoa(bytes);
+        ASSERT_EQ(chars, referenceBtoa(bytes)) << "size " << size;
+        ASSERT_EQ(Base64::atob(chars), bytes) << "size " << size;
+    }
+}
+
+TEST(Base64, StandardAlphabetIsAccepted)
+{
+    std::mt19937 rng(7);
+    std::string bytes = randomBytes(rng, 300);
+    std::string chars = Base64::btoa(bytes);
+    for (auto& c : chars)
+    {
+        c = c == '-' ? '+' : c == '_' ? '/' : c;
+    }
+    ASSERT_EQ(Base64::atob(chars), bytes);
+}
+
+// decoding ends at the first character out of the alphabet, wherever it is
+TEST(Base64, DecodingStopsAtInvalidCharacters)
+{
+    std::mt19937 rng(3);
+    std::string chars = Base64::btoa(randomBytes(rng, 300));
+    for (char invalid : { '=', '!', ' ', '\0', '\x80', '\xff' })
+    {
+        for (size_t pos = 0; pos < chars.size(); pos += 13)
+        {
+            std::string truncated = chars;
+            truncated[pos] = invalid;
+            ASSERT_EQ(Base64::atob(truncated), Base64::atob(chars.substr(0, pos))) << "position " << pos;
+        }
+    }
+}
+
+// the output is limited by the buffer size
+TEST(Base64, DecodingIntoSmallerBuffers)
+{
+    std::mt19937 rng(5);
+    std::string bytes = randomBytes(rng, 300);
+    std::string chars = Base64::btoa(bytes);
+    for (int size : { 1, 8, 16, 63, 64, 100, 299 })
+    {
+        std::string decoded(static_cast<size_t>(size), '\0');
+        ASSERT_EQ(Base64::atob(chars.c_str(), reinterpret_cast<byte*>(&decoded[0]), size), size);
+        ASSERT_EQ(decoded, bytes.substr(0, static_cast<size_t>(size)));
+    }
+}
@@ -21,6 +21,8 @@
 
 #include <gtest/gtest.h>
 
+#include <thread>
+
 #include <mega/megaclient.h>
 #include <mega/megaapp.h>
 #include <mega/user.h>
@@ -406,6 +408,75 @@ TEST(CacheLRU, getNodeByFingerprint_NoRAM_NoLRU)
 
 }
 
+TEST(CacheLRU, getNodesByFingerprint_filter)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    uint32_t LRUsize = 4;
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+    client->mNodeManager.setCacheLRUMaxSize(LRUsize);
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+
+    std::vector<std::string> fingerprints;
+    auto addFile = [&]()
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), &rootNode);
+        file.size = static_cast<m_off_t>(index);
+        file.crc[0] = file.crc[1] = file.crc[2] = file.crc[3] = static_cast<int32_t>(index);
+        file.isvalid = true;
+        std::string fp;
+        file.mega::FileFingerprint::serialize(&fp);
+        fingerprints.push_back(fp);
+        std::shared_ptr<mega::Node> node(&file);
+        client->mNodeManager.addNode(node, true, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(node.get());
+    };
+
+    auto countNodes = [&client](const std::string& serialized)
+    {
+        const char* ptr = serialized.data();
+        std::unique_ptr<mega::FileFingerprint> fp(mega::FileFingerprint::unserialize(ptr, ptr + serialized.size()));
+        return client->mNodeManager.getNodesByFingerprint(*fp).size();
+    };
+
+    for (uint32_t i = 0; i < 2 * LRUsize; i++)
+    {
+        addFile();
+    }
+
+    // the first lookup builds the filter: a fingerprint that isn't in DB is discarded by it
+    ASSERT_EQ(countNodes(fingerprints.front()), 1u);
+    mega::FileFingerprint unknown;
+    unknown.size = 12345;
+    unknown.isvalid = true;
+    std::string unknownSerialized;
+    unknown.serialize(&unknownSerialized);
+    ASSERT_EQ(countNodes(unknownSerialized), 0u);
+    ASSERT_EQ(client->mNodeManager.getNodeByFingerprint(unknown), nullptr);
+
+    // nodes written afterwards are added to the filter: the first ones are out of RAM already
+    size_t firstNew = fingerprints.size();
+    for (uint32_t i = 0; i < 2 * LRUsize; i++)
+    {
+        addFile();
+    }
+
+    ASSERT_EQ(countNodes(fingerprints[firstNew]), 1u);
+    ASSERT_EQ(countNodes(fingerprints.back()), 1u);
+}
+
 TEST(CacheLRU, searchNode) // processUnserializedNodes
 {
     mega::MegaApp app;
@@ -597,6 +668,619 @@ TEST(CacheLRU, getChildren)
 }
 
 
+TEST(CacheLRU, getChildrenViews)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    uint32_t LRUsize = 2;
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+    client->mNodeManager.setCacheLRUMaxSize(LRUsize);
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarRootNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarRootNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarRootNode.get());
+
+    std::shared_ptr<mega::Node> folder(&mt::makeNode(*client, mega::nodetype_t::FOLDERNODE, mega::NodeHandle().set6byte(index++), &rootNode));
+    folder->attrs.map = std::map<mega::nameid, std::string>{{110, "Folder"}};
+    client->mNodeManager.addNode(folder, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(folder.get());
+
+    std::shared_ptr<mega::Node> auxiliarNode;
+    std::vector<mega::NodeHandle> files;
+    uint32_t numFiles = 10;
+    for (uint32_t i = 0; i < numFiles; i++)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), folder.get());
+        file.size = 100 + i;
+        file.owner = 88;
+        file.ctime = 44;
+        file.attrs.map = std::map<mega::nameid, std::string>{{110, "file" + std::to_string(i)}};
+        auxiliarNode.reset(&file);
+        files.push_back(file.nodeHandle());
+        client->mNodeManager.addNode(auxiliarNode, true, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+    }
+    auxiliarNode.reset(); // only the LRU keeps some of the files in RAM
+
+    uint64_t nodesInRam = client->mNodeManager.getNumberNodesInRam();
+
+    mega::NodeSearchFilter filter;
+    filter.byAncestors({folder->nodehandle, mega::UNDEF, mega::UNDEF});
+
+    constexpr int sizeAsc = 3; // MegaApi::ORDER_SIZE_ASC
+    std::vector<mega::NodeView> views = client->mNodeManager.getChildrenViews(filter, sizeAsc, mega::CancelToken(), mega::NodeSearchPage(2, 3));
+    ASSERT_EQ(views.size(), 3u);
+    for (size_t i = 0; i < views.size(); ++i)
+    {
+        ASSERT_EQ(views[i].mHandle, files[i + 2]);
+        ASSERT_EQ(views[i].mName, "file" + std::to_string(i + 2));
+        ASSERT_EQ(views[i].mType, mega::FILENODE);
+        ASSERT_EQ(views[i].mSize, static_cast<m_off_t>(102 + i));
+        ASSERT_EQ(views[i].mCtime, 44);
+    }
+
+    // listing doesn't load any node
+    ASSERT_EQ(client->mNodeManager.getNumberNodesInRam(), nodesInRam);
+
+    // the Node is created on demand
+    std::shared_ptr<mega::Node> node = client->mNodeManager.getNodeByHandle(views[0].mHandle);
+    ASSERT_TRUE(node);
+    ASSERT_EQ(node->displayname(), views[0].mName);
+    ASSERT_EQ(node->size, views[0].mSize);
+}
+
+TEST(CacheLRU, getChildrenViews_keyset)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarRootNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarRootNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarRootNode.get());
+
+    std::shared_ptr<mega::Node> folder(&mt::makeNode(*client, mega::nodetype_t::FOLDERNODE, mega::NodeHandle().set6byte(index++), &rootNode));
+    folder->attrs.map = std::map<mega::nameid, std::string>{{110, "Folder"}};
+    client->mNodeManager.addNode(folder, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(folder.get());
+
+    // folders and files, with repeated sizes and names so the tiebreakers are needed
+    std::shared_ptr<mega::Node> auxiliarNode;
+    for (uint32_t i = 0; i < 13; i++)
+    {
+        auto type = i % 4 ? mega::nodetype_t::FILENODE : mega::nodetype_t::FOLDERNODE;
+        auto& node = mt::makeNode(*client, type, mega::NodeHandle().set6byte(index++), folder.get());
+        node.size = type == mega::FILENODE ? 100 + i % 3 : -1;
+        node.owner = 88;
+        node.ctime = 44;
+        node.attrs.map = std::map<mega::nameid, std::string>{{110, "node" + std::to_string(i % 5)}};
+        auxiliarNode.reset(&node);
+        client->mNodeManager.addNode(auxiliarNode, true, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+    }
+    auxiliarNode.reset();
+
+    mega::NodeSearchFilter filter;
+    filter.byAncestors({folder->nodehandle, mega::UNDEF, mega::UNDEF});
+
+    constexpr int defaultAsc = 1; // MegaApi::ORDER_DEFAULT_ASC
+    constexpr int sizeDesc = 4;   // MegaApi::ORDER_SIZE_DESC
+    constexpr int labelAsc = 17;  // MegaApi::ORDER_LABEL_ASC
+    for (int order : {defaultAsc, sizeDesc, labelAsc})
+    {
+        std::vector<mega::NodeView> all = client->mNodeManager.getChildrenViews(filter, order, mega::CancelToken(), mega::NodeSearchPage(0, 0));
+        ASSERT_EQ(all.size(), 13u);
+
+        // pages after the last result of the previous one match the offset-based listing
+        std::vector<mega::NodeView> paged = client->mNodeManager.getChildrenViews(filter, order, mega::CancelToken(), mega::NodeSearchPage(0, 4));
+        ASSERT_EQ(paged.size(), 4u);
+        while (paged.size() < all.size())
+        {
+            std::vector<mega::NodeView> page = client->mNodeManager.getChildrenViews(filter, order, mega::CancelToken(), mega::NodeSearchPage(paged.back(), 4));
+            ASSERT_FALSE(page.empty()) << "order " << order;
+            ASSERT_LE(page.size(), 4u);
+            paged.insert(paged.end(), page.begin(), page.end());
+        }
+
+        ASSERT_EQ(paged.size(), all.size());
+        for (size_t i = 0; i < all.size(); ++i)
+        {
+            ASSERT_EQ(paged[i].mHandle, all[i].mHandle) << "order " << order << ", position " << i;
+        }
+
+        // nothing after the last one
+        ASSERT_TRUE(client->mNodeManager.getChildrenViews(filter, order, mega::CancelToken(), mega::NodeSearchPage(all.back(), 4)).empty());
+
+        // the same applies to full nodes
+        mega::sharedNode_vector nodes = client->mNodeManager.getChildren(filter, order, mega::CancelToken(), mega::NodeSearchPage(all[5], 0));
+        ASSERT_EQ(nodes.size(), all.size() - 6);
+        ASSERT_EQ(nodes.front()->nodeHandle(), all[6].mHandle);
+    }
+}
+
+TEST(CacheLRU, concurrentReaders)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarRootNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarRootNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarRootNode.get());
+
+    std::shared_ptr<mega::Node> folder(&mt::makeNode(*client, mega::nodetype_t::FOLDERNODE, mega::NodeHandle().set6byte(index++), &rootNode));
+    folder->attrs.map = std::map<mega::nameid, std::string>{{110, "Folder"}};
+    client->mNodeManager.addNode(folder, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(folder.get());
+
+    auto addFile = [&](uint32_t i)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), folder.get());
+        file.size = 100 + i;
+        file.owner = 88;
+        file.ctime = 44;
+        file.attrs.map = std::map<mega::nameid, std::string>{{110, "file" + std::to_string(i)}};
+        std::shared_ptr<mega::Node> node(&file);
+        client->mNodeManager.addNode(node, true, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(node.get());
+    };
+
+    constexpr uint32_t numFiles = 20;
+    for (uint32_t i = 0; i < numFiles; i++)
+    {
+        addFile(i);
+    }
+
+    auto table = dynamic_cast<mega::DBTableNodes*>(client->sctable.get());
+    ASSERT_TRUE(table);
+
+    // uncommitted changes wouldn't be visible to a reader (a transaction is always started, like MegaClient does)
+    ASSERT_FALSE(table->acquireReader());
+    client->sctable->commit();
+    client->sctable->begin();
+    ASSERT_TRUE(table->acquireReader());
+
+    mega::NodeSearchFilter filter;
+    filter.byAncestors({folder->nodehandle, mega::UNDEF, mega::UNDEF});
+    constexpr int defaultAsc = 1; // MegaApi::ORDER_DEFAULT_ASC
+
+    // more threads than readers: the ones without a reader query the writer
+    std::vector<std::thread> threads;
+    std::atomic<int> failures{0};
+    for (int t = 0; t < 6; ++t)
+    {
+        threads.emplace_back([&]()
+        {
+            for (int i = 0; i < 20; ++i)
+            {
+                if (client->mNodeManager.getChildren(filter, defaultAsc, mega::CancelToken(), mega::NodeSearchPage(0, 0)).size() != numFiles ||
+                    client->mNodeManager.getChildrenViews(filter, defaultAsc, mega::CancelToken(), mega::NodeSearchPage(0, 0)).size() != numFiles)
+                {
+                    ++failures;
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    ASSERT_EQ(failures, 0);
+
+    // a new node isn't missed while it's pending to commit
+    addFile(numFiles);
+    ASSERT_FALSE(table->acquireReader());
+    ASSERT_EQ(client->mNodeManager.getChildren(filter, defaultAsc, mega::CancelToken(), mega::NodeSearchPage(0, 0)).size(), numFiles + 1);
+}
+
+TEST(CacheLRU, snapshot)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarRootNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarRootNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarRootNode.get());
+
+    std::shared_ptr<mega::Node> folder(&mt::makeNode(*client, mega::nodetype_t::FOLDERNODE, mega::NodeHandle().set6byte(index++), &rootNode));
+    folder->attrs.map = std::map<mega::nameid, std::string>{{110, "Folder"}};
+    client->mNodeManager.addNode(folder, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(folder.get());
+
+    auto addFile = [&](uint32_t i)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), folder.get());
+        file.size = 100 + i;
+        file.owner = 88;
+        file.ctime = 44;
+        file.attrs.map = std::map<mega::nameid, std::string>{{110, "file" + std::to_string(i)}};
+        std::shared_ptr<mega::Node> node(&file);
+        client->mNodeManager.addNode(node, true, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(node.get());
+    };
+
+    constexpr uint32_t numFiles = 10;
+    for (uint32_t i = 0; i < numFiles; i++)
+    {
+        addFile(i);
+    }
+
+    // uncommitted changes wouldn't be included
+    ASSERT_FALSE(client->mNodeManager.getSnapshot());
+    client->sctable->commit();
+    client->sctable->begin();
+
+    auto snapshot = client->mNodeManager.getSnapshot();
+    ASSERT_TRUE(snapshot);
+
+    // the changes committed later aren't seen by the snapshot, but by the next one
+    addFile(numFiles);
+    client->sctable->commit();
+    client->sctable->begin();
+
+    mega::NodeSearchFilter filter;
+    filter.byAncestors({folder->nodehandle, mega::UNDEF, mega::UNDEF});
+    ASSERT_EQ(snapshot->getChildren(filter, 0, mega::CancelToken(), mega::NodeSearchPage(0, 0)).size(), numFiles);
+    ASSERT_EQ(snapshot->getNumberOfChildren(folder->nodeHandle()), numFiles);
+    ASSERT_TRUE(snapshot->isAncestor(mega::NodeHandle().set6byte(index - 2), rootNode.nodeHandle(), mega::CancelToken()));
+    ASSERT_FALSE(snapshot->isAncestor(mega::NodeHandle().set6byte(index - 1), rootNode.nodeHandle(), mega::CancelToken()));
+
+    size_t visited = 0;
+    ASSERT_TRUE(snapshot->forEachDescendant(rootNode.nodeHandle(), mega::CancelToken(), [&visited](const mega::NodeView&)
+    {
+        ++visited;
+        return true;
+    }));
+    ASSERT_EQ(visited, numFiles + 1);
+
+    // it can be stopped by the visitor
+    visited = 0;
+    ASSERT_FALSE(snapshot->forEachDescendant(rootNode.nodeHandle(), mega::CancelToken(), [&visited](const mega::NodeView&)
+    {
+        return ++visited < 3;
+    }));
+    ASSERT_EQ(visited, 3u);
+
+    snapshot.reset();
+    snapshot = client->mNodeManager.getSnapshot();
+    ASSERT_TRUE(snapshot);
+    ASSERT_EQ(snapshot->getNumberOfChildren(folder->nodeHandle()), numFiles + 1);
+}
+
+TEST(CacheLRU, benchmarkDbQueries)
+{
+    mega::DbPerformanceProfile profile;
+    ASSERT_FALSE(mega::DbPerformanceProfile::fromPreset(-1, profile));
+    ASSERT_TRUE(mega::DbPerformanceProfile::fromPreset(mega::DbPerformanceProfile::PRESET_DEFAULT, profile));
+    ASSERT_TRUE(profile.isDefault());
+    ASSERT_TRUE(mega::DbPerformanceProfile::fromPreset(mega::DbPerformanceProfile::PRESET_HIGH_PERFORMANCE, profile));
+    ASSERT_FALSE(profile.isDefault());
+
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+    dbAccess->setPerformanceProfile(profile);
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarRootNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarRootNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarRootNode.get());
+
+    for (uint32_t i = 0; i < 50; i++)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), &rootNode);
+        file.size = 100 + i;
+        file.attrs.map = std::map<mega::nameid, std::string>{{110, "name" + std::to_string(i)}};
+        std::shared_ptr<mega::Node> node(&file);
+        client->mNodeManager.addNode(node, true, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(node.get());
+    }
+
+    ASSERT_TRUE(client->mNodeManager.benchmarkDbQueries(0).empty());
+
+    auto results = client->mNodeManager.benchmarkDbQueries(3);
+    std::vector<std::string> workloads;
+    for (auto& result : results)
+    {
+        workloads.push_back(result.first);
+        ASSERT_GE(result.second.count(), 0);
+    }
+
+    std::vector<std::string> expected{"countNodes", "listChildren", "listChildrenBySize", "searchByName", "recentNodes", "fingerprintLookup"};
+    ASSERT_EQ(workloads, expected);
+}
+
+TEST(CacheLRU, childrenTypeCounts_movedNode)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarRootNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarRootNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarRootNode.get());
+
+    auto addNode = [&](mega::nodetype_t type, mega::Node* parent)
+    {
+        std::shared_ptr<mega::Node> node(&mt::makeNode(*client, type, mega::NodeHandle().set6byte(index++), parent));
+        client->mNodeManager.addNode(node, false, true, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(node.get());
+        return node;
+    };
+
+    auto folderA = addNode(mega::nodetype_t::FOLDERNODE, &rootNode);
+    auto folderB = addNode(mega::nodetype_t::FOLDERNODE, &rootNode);
+    auto file = addNode(mega::nodetype_t::FILENODE, folderA.get());
+
+    auto& nodeManager = client->mNodeManager;
+    ASSERT_EQ(nodeManager.getNumberOfChildrenByType(folderA->nodeHandle(), mega::FILENODE), 1u);
+    ASSERT_EQ(nodeManager.getNumberOfChildrenByType(folderB->nodeHandle(), mega::FILENODE), 0u);
+
+    // until it's written, the DB row of the moved file is still under its previous parent
+    file->setparent(folderB, false);
+    ASSERT_EQ(nodeManager.getNumberOfChildrenByType(folderA->nodeHandle(), mega::FILENODE), 1u);
+
+    // the counts of both parents are dropped once it's written
+    nodeManager.saveNodeInDb(file.get());
+    ASSERT_EQ(nodeManager.getNumberOfChildrenByType(folderA->nodeHandle(), mega::FILENODE), 0u);
+    ASSERT_EQ(nodeManager.getNumberOfChildrenByType(folderB->nodeHandle(), mega::FILENODE), 1u);
+}
+
+TEST(CacheLRU, deferredTreeCounters)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarRootNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarRootNode, false, true, missingParentNodes);
+
+    auto addNode = [&](mega::nodetype_t type, mega::Node* parent)
+    {
+        std::shared_ptr<mega::Node> node(&mt::makeNode(*client, type, mega::NodeHandle().set6byte(index++), parent));
+        client->mNodeManager.addNode(node, true, false, missingParentNodes);
+        return node;
+    };
+
+    auto folderA = addNode(mega::nodetype_t::FOLDERNODE, &rootNode);
+    auto folderB = addNode(mega::nodetype_t::FOLDERNODE, &rootNode);
+    auto subfolder = addNode(mega::nodetype_t::FOLDERNODE, folderA.get());
+    ASSERT_EQ(rootNode.getCounter().folders, 3u);
+
+    std::vector<std::shared_ptr<mega::Node>> files;
+    {
+        mega::NodeManager::TreeUpdateBatch batch(client->mNodeManager);
+        for (int i = 0; i < 10; ++i)
+        {
+            files.push_back(addNode(mega::nodetype_t::FILENODE, subfolder.get()));
+        }
+
+        // the ancestors get the new files when the batch ends
+        ASSERT_EQ(rootNode.getCounter().files, 0u);
+
+        // a moved node carries along the changes pending below it
+        subfolder->setparent(folderB);
+        files[0]->setparent(folderA);
+    }
+
+    ASSERT_EQ(rootNode.getCounter().files, 10u);
+    ASSERT_EQ(rootNode.getCounter().folders, 3u);
+    ASSERT_EQ(folderA->getCounter().files, 1u);
+    ASSERT_EQ(folderA->getCounter().folders, 1u);
+    ASSERT_EQ(folderB->getCounter().files, 9u);
+    ASSERT_EQ(folderB->getCounter().folders, 2u);
+    ASSERT_EQ(subfolder->getCounter().files, 9u);
+
+    // counters read while a batch is alive are up to date
+    {
+        mega::NodeManager::TreeUpdateBatch batch(client->mNodeManager);
+        files[1]->setparent(folderA);
+        ASSERT_EQ(folderA->getCounter().files, 1u);
+        ASSERT_EQ(client->mNodeManager.getCounterOfRootNodes().files, 10u);
+        ASSERT_EQ(folderA->getCounter().files, 2u);
+        ASSERT_EQ(folderB->getCounter().files, 8u);
+    }
+}
+
+TEST(CacheLRU, childNodeByNameType_childrenIndex)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+    client->mNodeManager.setCacheLRUMaxSize(10);
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarRootNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarRootNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarRootNode.get());
+
+    std::shared_ptr<mega::Node> folder(&mt::makeNode(*client, mega::nodetype_t::FOLDERNODE, mega::NodeHandle().set6byte(index++), &rootNode));
+    folder->attrs.map = std::map<mega::nameid, std::string>{{110, "Folder"}};
+    client->mNodeManager.addNode(folder, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(folder.get());
+
+    auto addFile = [&](const std::string& name)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), folder.get());
+        file.attrs.map = std::map<mega::nameid, std::string>{{110, name}};
+        std::shared_ptr<mega::Node> node(&file);
+        client->mNodeManager.addNode(node, true, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(node.get());
+        return node->nodeHandle();
+    };
+
+    // more children than the cache LRU: some of them are only in the DB
+    std::vector<mega::NodeHandle> handles;
+    for (int i = 0; i < 30; i++)
+    {
+        handles.push_back(addFile("file" + std::to_string(i)));
+    }
+    ASSERT_LT(client->mNodeManager.getNumberNodesInRam(), handles.size());
+
+    for (int i = 0; i < 30; i++)
+    {
+        auto child = client->mNodeManager.childNodeByNameType(folder.get(), "file" + std::to_string(i), mega::FILENODE);
+        ASSERT_TRUE(child);
+        ASSERT_EQ(child->nodeHandle(), handles[i]);
+    }
+
+    ASSERT_FALSE(client->mNodeManager.childNodeByNameType(folder.get(), "file0", mega::FOLDERNODE));
+    ASSERT_FALSE(client->mNodeManager.childNodeByNameType(folder.get(), "missing", mega::FILENODE));
+
+    // new children aren't missed
+    mega::NodeHandle newFile = addFile("new");
+    auto child = client->mNodeManager.childNodeByNameType(folder.get(), "new", mega::FILENODE);
+    ASSERT_TRUE(child);
+    ASSERT_EQ(child->nodeHandle(), newFile);
+}
+
+TEST(CacheLRU, putNodesInBulk)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+    auto table = dynamic_cast<mega::DBTableNodes*>(client->sctable.get());
+    ASSERT_TRUE(table);
+
+    uint64_t index = 1;
+    std::shared_ptr<mega::Node> rootNode(&mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr));
+
+    std::vector<std::shared_ptr<mega::Node>> keepAlive;
+    std::vector<mega::Node*> nodes{rootNode.get()};
+    for (int i = 0; i < 100; i++)
+    {
+        keepAlive.emplace_back(&mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), rootNode.get()));
+        keepAlive.back()->size = i;
+        keepAlive.back()->attrs.map = std::map<mega::nameid, std::string>{{110, "file" + std::to_string(i)}};
+        nodes.push_back(keepAlive.back().get());
+    }
+
+    ASSERT_TRUE(table->putNodes(nodes));
+    ASSERT_EQ(table->getNumberOfNodes(), nodes.size());
+
+    // every row is complete, not just the last one bound to the statement
+    for (mega::Node* node : nodes)
+    {
+        mega::NodeSerialized serialized;
+        ASSERT_TRUE(table->getNode(node->nodeHandle(), serialized));
+        std::string expected;
+        ASSERT_TRUE(node->serialize(&expected));
+        ASSERT_EQ(serialized.mNode, expected);
+    }
+}
+
+TEST(CacheLRU, ancestryIndex)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+    auto table = dynamic_cast<mega::SqliteAccountState*>(client->sctable.get());
+    ASSERT_TRUE(table);
+    ASSERT_TRUE(table->hasAncestryIndex());
+
+    uint64_t index = 1;
+    std::unique_ptr<mega::Node> rootNode(&mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr));
+    std::unique_ptr<mega::Node> folderA(&mt::makeNode(*client, mega::nodetype_t::FOLDERNODE, mega::NodeHandle().set6byte(index++), rootNode.get()));
+    std::unique_ptr<mega::Node> folderB(&mt::makeNode(*client, mega::nodetype_t::FOLDERNODE, mega::NodeHandle().set6byte(index++), folderA.get()));
+    std::unique_ptr<mega::Node> file(&mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), folderB.get()));
+
+    // descendants written before their ancestors are attached once these are written
+    ASSERT_TRUE(table->put(file.get()));
+    ASSERT_TRUE(table->put(folderB.get()));
+    ASSERT_TRUE(table->put(rootNode.get()));
+    ASSERT_TRUE(table->isAncestor(file->nodeHandle(), folderB->nodeHandle(), mega::CancelToken()));
+    ASSERT_TRUE(table->isAncestor(file->nodeHandle(), folderA->nodeHandle(), mega::CancelToken()));
+    ASSERT_FALSE(table->isAncestor(file->nodeHandle(), rootNode->nodeHandle(), mega::CancelToken()));
+
+    ASSERT_TRUE(table->put(folderA.get()));
+    ASSERT_TRUE(table->isAncestor(file->nodeHandle(), rootNode->nodeHandle(), mega::CancelToken()));
+    ASSERT_FALSE(table->isAncestor(file->nodeHandle(), file->nodeHandle(), mega::CancelToken()));
+    ASSERT_FALSE(table->isAncestor(folderA->nodeHandle(), file->nodeHandle(), mega::CancelToken()));
+
+    // moving a folder moves its subtree
+    folderB->parenthandle = rootNode->nodehandle;
+    ASSERT_TRUE(table->put(folderB.get()));
+    ASSERT_FALSE(table->isAncestor(file->nodeHandle(), folderA->nodeHandle(), mega::CancelToken()));
+    ASSERT_TRUE(table->isAncestor(file->nodeHandle(), folderB->nodeHandle(), mega::CancelToken()));
+    ASSERT_TRUE(table->isAncestor(file->nodeHandle(), rootNode->nodeHandle(), mega::CancelToken()));
+
+    ASSERT_TRUE(table->remove(file->nodeHandle()));
+    ASSERT_FALSE(table->isAncestor(file->nodeHandle(), rootNode->nodeHandle(), mega::CancelToken()));
+}
+
 TEST(CacheLRU, getNodeByHandle)
 {
     mega::MegaApp app;
@@ -669,14 +1353,14 @@ TEST(CacheLRU, getNodeByHandle)
     // Node at RAM and LRU
     auxiliarNode = client->mNodeManager.getNodeByHandle(lasttNodeHandle);
     ASSERT_NE(auxiliarNode, nullptr);
-    ASSERT_NE(auxiliarNode->mNodePosition->second.mLRUPosition, client->mNodeManager.invalidCacheLRUPos());
+    ASSERT_TRUE(auxiliarNode->mNodePosition->second.isAtCacheLRU());
     node = client->mNodeManager.getNodeByHandle(lasttNodeHandle);
     ASSERT_EQ(auxiliarNode.get(), node.get());
 
     // Node at RAM, no at LRU
     //ASSERT_NE(client->mNodeManager.getNodeInRAM(nodeInRAMHandle).get(), nullptr);
     ASSERT_NE(nodeInRAM, nullptr);
-    ASSERT_EQ(nodeInRAM->mNodePosition->second.mLRUPosition, client->mNodeManager.invalidCacheLRUPos());
+    ASSERT_FALSE(nodeInRAM->mNodePosition->second.isAtCacheLRU());
     node = client->mNodeManager.getNodeByHandle(nodeInRAMHandle);
     ASSERT_EQ(nodeInRAM.get(), node.get());
 }
@@ -830,3 +1514,77 @@ TEST(CacheLRU, reduceCacheLRUSize)
     ASSERT_EQ(client->mNodeManager.getNodeCount(), numNodes + 4);
 
 }
+
+TEST(CacheLRU, clockPolicy_secondChance)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    uint32_t LRUsize = 8;
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+    client->mNodeManager.setCacheLRUMaxSize(LRUsize);
+    client->mNodeManager.setCacheLRUPolicy(mega::NodeManager::CacheLRUPolicy::CLOCK);
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarRootNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarRootNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarRootNode.get());
+
+    auto& vaultNode = mt::makeNode(*client, mega::nodetype_t::VAULTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node>auxiliarNode(&vaultNode);
+    client->mNodeManager.addNode(auxiliarNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+
+    auto& rubbishbin = mt::makeNode(*client, mega::nodetype_t::RUBBISHNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    auxiliarNode.reset(&rubbishbin);
+    client->mNodeManager.addNode(auxiliarNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+
+    auto& folder = mt::makeNode(*client, mega::nodetype_t::FOLDERNODE, mega::NodeHandle().set6byte(index++), &rootNode);
+    auxiliarNode.reset(&folder);
+    client->mNodeManager.addNode(auxiliarNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+
+    // fill the cache: 3 root nodes + folder + 4 files
+    std::vector<std::weak_ptr<mega::Node>> files;
+    for (uint32_t i = 0; i < LRUsize - 4; i++)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), &folder);
+        auxiliarNode.reset(&file);
+        client->mNodeManager.addNode(auxiliarNode, true, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+        files.push_back(auxiliarNode);
+    }
+
+    ASSERT_EQ(client->mNodeManager.getNumNodesAtCacheLRU(), LRUsize);
+
+    // a hit only flags the first file as referenced
+    uint64_t hits = client->mNodeManager.getCacheLRUHits();
+    uint64_t misses = client->mNodeManager.getCacheLRUMisses();
+    ASSERT_NE(client->mNodeManager.getNodeByHandle(files[0].lock()->nodeHandle()), nullptr);
+    ASSERT_EQ(client->mNodeManager.getCacheLRUHits(), hits + 1);
+    ASSERT_EQ(client->mNodeManager.getCacheLRUMisses(), misses);
+
+    // new files evict the non-referenced nodes first: vault, rubbish bin and then the second file.
+    // The first file gets a second chance, despite being older than the second one
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), &folder);
+        auxiliarNode.reset(&file);
+        client->mNodeManager.addNode(auxiliarNode, true, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+    }
+
+    ASSERT_EQ(client->mNodeManager.getCacheLRUMisses(), misses + 3);
+    ASSERT_EQ(client->mNodeManager.getNumNodesAtCacheLRU(), LRUsize);
+    ASSERT_FALSE(files[0].expired());
+    ASSERT_TRUE(files[1].expired());
+    ASSERT_FALSE(files[2].expired());
+}
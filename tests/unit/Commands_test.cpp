@@ -24,8 +24,11 @@
 #include <mega/json.h>
 #include <mega/megaapp.h>
 #include <mega/megaclient.h>
+#include <mega/request.h>
 #include <mega/types.h>
 
+#include "utils.h"
+
 using namespace std;
 using namespace mega;
 
@@ -55,8 +58,68 @@ public:
     }
 };
 
+struct StreamingResult
+{
+    vector<string> mItems;
+    bool mFinished = false;
+};
+
+class StreamingCommandMockup : public Command
+{
+public:
+    explicit StreamingCommandMockup(StreamingResult& result)
+    {
+        cmd("test");
+        mStreaming = true;
+
+        mFilters.emplace("{[a{", [&result](JSON* json)
+        {
+            result.mItems.emplace_back();
+            return json->storeobject(&result.mItems.back());
+        });
+
+        mFilters.emplace("{", [&result](JSON*)
+        {
+            result.mFinished = true;
+            return true;
+        });
+    }
+
+    bool procresult(Result, JSON&) override
+    {
+        ADD_FAILURE() << "Streaming commands are processed by their filters";
+        return false;
+    }
+};
+
 } // anonymous
 
+TEST(Commands, StreamingCommandIsProcessedInChunks)
+{
+    MegaApp app;
+    auto client = mt::makeClient(app);
+
+    StreamingResult result;
+    Request request;
+    request.add(new StreamingCommandMockup(result));
+    ASSERT_TRUE(request.isStreaming());
+
+    // feed the response in small pieces, keeping only what was not consumed yet
+    string response = R"([{"a":[{"x":1},{"x":22},{"x":333}]}])";
+    string buffer;
+    for (size_t offset = 0; offset < response.size(); offset += 4)
+    {
+        buffer.append(response, offset, 4);
+        size_t consumed = static_cast<size_t>(request.processChunk(buffer.c_str(), client.get()));
+        buffer.erase(0, consumed);
+    }
+
+    ASSERT_TRUE(buffer.empty());
+    ASSERT_TRUE(result.mFinished);
+    ASSERT_EQ(result.mItems, (vector<string>{R"({"x":1})", R"({"x":22})", R"({"x":333})"}));
+    ASSERT_TRUE(request.empty());
+}
+
 /*TEST(Commands, CommandGetCountryCallingCodes_processResult_happyPath)
 {
     MockApp_CommandGetCountryCallingCodes app;
@@ -393,3 +393,96 @@ TEST(Crypto, SymmCipher_isZeroKey)
     key_test6.replace(SymmCipher::BLOCKSIZE, SymmCipher::BLOCKSIZE, "0123456789ABCDEF");
     ASSERT_EQ(SymmCipher::isZeroKey(reinterpret_cast<byte*>(key_test6.data()), FILENODEKEYLENGTH), true);
 }
+
+// ctr_crypt() may use hardware AES: check it against CTR + CBC-MAC done block by block with ecb_encrypt()
+TEST(Crypto, SymmCipher_ctr_crypt_matches_ecb)
+{
+    PrnGen rng;
+    SymmCipher cipher;
+    cipher.setkey(reinterpret_cast<const byte*>(rng.genstring(SymmCipher::KEYLENGTH).data()));
+
+    for (unsigned len : { 1u, 15u, 16u, 17u, 100u, 1024u, 1040u + 9u })
+    {
+        for (bool encrypt : { true, false })
+        {
+            SymmCipher::ctr_iv ctriv = 0x0102030405060708;
+            m_off_t pos = 4096 * 16;
+
+            // padded to BLOCKSIZE, as ctr_crypt() requires
+            std::string input = rng.genstring(len);
+            input.resize((len + SymmCipher::BLOCKSIZE - 1) & -SymmCipher::BLOCKSIZE, '\0');
+
+            std::string data = input;
+            byte mac[SymmCipher::BLOCKSIZE];
+            cipher.ctr_crypt(reinterpret_cast<byte*>(&data[0]), len, pos, ctriv, mac, encrypt);
+
+            // reference
+            std::string expected = input;
+            byte expectedMac[SymmCipher::BLOCKSIZE];
+            byte ctr[SymmCipher::BLOCKSIZE];
+            MemAccess::set<int64_t>(ctr, static_cast<int64_t>(ctriv));
+            SymmCipher::setint64(pos / SymmCipher::BLOCKSIZE, ctr + sizeof ctriv);
+            memcpy(expectedMac, ctr, sizeof ctriv);
+            memcpy(expectedMac + sizeof ctriv, ctr, sizeof ctriv);
+
+            for (unsigned offset = 0; offset < len; offset += SymmCipher::BLOCKSIZE)
+            {
+                byte* block = reinterpret_cast<byte*>(&expected[offset]);
+                byte keystream[SymmCipher::BLOCKSIZE];
+                cipher.ecb_encrypt(ctr, keystream);
+
+                if (encrypt) SymmCipher::xorblock(block, expectedMac);
+                SymmCipher::xorblock(keystream, block);
+                if (!encrypt) SymmCipher::xorblock(block, expectedMac, static_cast<int>(std::min<unsigned>(len - offset, SymmCipher::BLOCKSIZE)));
+                cipher.ecb_encrypt(expectedMac);
+
+                SymmCipher::incblock(ctr);
+            }
+
+            ASSERT_EQ(data.substr(0, len), expected.substr(0, len)) << "len " << len << ", encrypt " << encrypt;
+            ASSERT_EQ(0, memcmp(mac, expectedMac, sizeof mac)) << "len " << len << ", encrypt " << encrypt;
+        }
+    }
+}
+
+// PBKDF2_HMAC_SHA512 compresses the blocks itself: check it against PKCS5_PBKDF2_HMAC<SHA512>
+TEST(Crypto, PBKDF2_HMAC_SHA512_matches_cryptopp)
+{
+    struct Case
+    {
+        std::string password;
+        std::string salt;
+        unsigned iterations;
+        size_t length;
+    };
+
+    for (const Case& c : { Case{ "password", "salt", 1, 64 },
+                           Case{ "password", "salt", 2, 64 },
+                           Case{ "password", "salt", 4096, 32 },
+                           Case{ "", "salt", 3, 64 },                              // empty HMAC key
+                           Case{ std::string(200, 'x'), std::string(40, 's'), 3, 100 }, // hashed key, several blocks
+                           Case{ "p", std::string(120, 's'), 5, 130 } })           // salt padded in two blocks
+    {
+        std::vector<byte> expected(c.length);
+        CryptoPP::PKCS5_PBKDF2_HMAC<CryptoPP::SHA512> reference;
+        reference.DeriveKey(expected.data(), expected.size(), 0,
+                            reinterpret_cast<const byte*>(c.password.data()), c.password.size(),
+                            reinterpret_cast<const byte*>(c.salt.data()), c.salt.size(), c.iterations);
+
+        std::vector<byte> derived(c.length);
+        PBKDF2_HMAC_SHA512 pbkdf2;
+        ASSERT_TRUE(pbkdf2.deriveKey(derived.data(), derived.size(),
+                                     reinterpret_cast<const byte*>(c.password.data()), c.password.size(),
+                                     reinterpret_cast<const byte*>(c.salt.data()), c.salt.size(), c.iterations));
+        ASSERT_EQ(derived, expected) << c.password.size() << " " << c.salt.size() << " " << c.iterations;
+    }
+
+    // RFC test vector
+    byte derived[64];
+    PBKDF2_HMAC_SHA512 pbkdf2;
+    ASSERT_TRUE(pbkdf2.deriveKey(derived, sizeof derived, reinterpret_cast<const byte*>("password"), 8,
+                                 reinterpret_cast<const byte*>("salt"), 4, 2));
+    ASSERT_EQ(Utils::stringToHex(std::string(reinterpret_cast<const char*>(derived), sizeof derived)),
+              "e1d9c16aa681708a45f5c7c4e215ceb66e011a2e9f0040713f18aefdb866d53c"
+              "f76cab2868a39b9f7840edce4fef5a82be67335c77a6068e04112754f27ccf4e");
+}
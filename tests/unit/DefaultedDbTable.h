@@ -59,6 +59,10 @@ public:
     {
         return false;
     }
+    bool getFingerprints(std::function<void(const std::string&)>) override
+    {
+        return false;
+    }
     bool getNodesByOrigFingerprint(const std::string&, std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>>&) override
     {
         return false;
@@ -95,6 +99,10 @@ public:
         return false;
         //throw NotImplemented(__func__);
     }
+    bool getChildrenViews(const mega::NodeSearchFilter&, int, std::vector<mega::NodeView>&, mega::CancelToken, const mega::NodeSearchPage&) override
+    {
+        return false;
+    }
     bool searchNodes(const mega::NodeSearchFilter&, int, std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>>&, mega::CancelToken, const mega::NodeSearchPage&) override
     {
         return false;
@@ -139,6 +147,10 @@ public:
     {
         return false;
     }
+    bool getVersions(mega::NodeHandle, std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>>&) override
+    {
+        return false;
+    }
     uint64_t getNumberOfNodes() override
     {
         return false;
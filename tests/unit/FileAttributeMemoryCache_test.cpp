@@ -0,0 +1,83 @@
+/**
+ * @file FileAttributeMemoryCache_test.cpp
+ * @brief Unitary test for the in-memory cache of file attributes
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mega/fileattributefetch.h>
+#include <mega/gfx.h>
+
+using namespace mega;
+
+TEST(FileAttributeMemoryCache, GetAndPut)
+{
+    FileAttributeMemoryCache cache;
+    ASSERT_EQ(cache.get(1, GfxProc::THUMBNAIL, "fa"), nullptr);
+
+    cache.put(1, GfxProc::THUMBNAIL, "fa", "thumbnail");
+    const string* data = cache.get(1, GfxProc::THUMBNAIL, "fa");
+    ASSERT_NE(data, nullptr);
+    ASSERT_EQ(*data, "thumbnail");
+    ASSERT_EQ(cache.get(1, GfxProc::PREVIEW, "fa"), nullptr);
+    ASSERT_EQ(cache.size(), 9u);
+
+    // replaced
+    cache.put(1, GfxProc::THUMBNAIL, "fa", "other");
+    ASSERT_EQ(*cache.get(1, GfxProc::THUMBNAIL, "fa"), "other");
+    ASSERT_EQ(cache.size(), 5u);
+
+    // the node has new attributes
+    ASSERT_EQ(cache.get(1, GfxProc::THUMBNAIL, "fa2"), nullptr);
+    ASSERT_EQ(cache.get(1, GfxProc::THUMBNAIL, "fa"), nullptr);
+    ASSERT_EQ(cache.size(), 0u);
+
+    cache.put(2, GfxProc::THUMBNAIL, "fa", "thumbnail");
+    cache.clear();
+    ASSERT_EQ(cache.get(2, GfxProc::THUMBNAIL, "fa"), nullptr);
+    ASSERT_EQ(cache.size(), 0u);
+}
+
+TEST(FileAttributeMemoryCache, LeastRecentlyUsedEviction)
+{
+    FileAttributeMemoryCache cache(30);
+    cache.put(1, GfxProc::THUMBNAIL, "fa", string(10, 'a'));
+    cache.put(2, GfxProc::THUMBNAIL, "fa", string(10, 'b'));
+    cache.put(3, GfxProc::THUMBNAIL, "fa", string(10, 'c'));
+
+    // 1 is used again, so 2 goes when there is no room
+    ASSERT_NE(cache.get(1, GfxProc::THUMBNAIL, "fa"), nullptr);
+    cache.put(4, GfxProc::THUMBNAIL, "fa", string(10, 'd'));
+    ASSERT_EQ(cache.size(), 30u);
+    ASSERT_EQ(cache.get(2, GfxProc::THUMBNAIL, "fa"), nullptr);
+    ASSERT_NE(cache.get(1, GfxProc::THUMBNAIL, "fa"), nullptr);
+    ASSERT_NE(cache.get(3, GfxProc::THUMBNAIL, "fa"), nullptr);
+    ASSERT_NE(cache.get(4, GfxProc::THUMBNAIL, "fa"), nullptr);
+
+    // bigger than the whole cache
+    cache.put(5, GfxProc::THUMBNAIL, "fa", string(31, 'e'));
+    ASSERT_EQ(cache.get(5, GfxProc::THUMBNAIL, "fa"), nullptr);
+    ASSERT_EQ(cache.size(), 30u);
+
+    // everything else goes for a big one
+    cache.put(6, GfxProc::THUMBNAIL, "fa", string(25, 'f'));
+    ASSERT_EQ(cache.size(), 25u);
+    ASSERT_NE(cache.get(6, GfxProc::THUMBNAIL, "fa"), nullptr);
+    ASSERT_EQ(cache.get(1, GfxProc::THUMBNAIL, "fa"), nullptr);
+}
@@ -0,0 +1,120 @@
+/**
+ * @file GfxCache_test.cpp
+ * @brief Unitary test for the cache of generated images
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include <mega/gfx.h>
+#include <mega/utils.h>
+
+using namespace mega;
+
+namespace {
+
+class GfxCacheTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        mFolder = std::filesystem::temp_directory_path() / ("gfxcache_test_" + std::to_string(getCurrentPid()));
+        std::filesystem::remove_all(mFolder);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(mFolder);
+    }
+
+    LocalPath folder() const
+    {
+        return LocalPath::fromAbsolutePath(mFolder.u8string());
+    }
+
+    static FileFingerprint fingerprint(m_off_t size)
+    {
+        FileFingerprint fp;
+        fp.size = size;
+        fp.mtime = 1700000000;
+        fp.crc = { 1, 2, 3, static_cast<int32_t>(size) };
+        fp.isvalid = true;
+        return fp;
+    }
+
+    std::filesystem::path mFolder;
+};
+
+} // namespace
+
+TEST_F(GfxCacheTest, ImagesAreKeptByFingerprintAndType)
+{
+    string image;
+    {
+        GfxCache cache(folder());
+        ASSERT_FALSE(cache.get(fingerprint(100), GfxProc::THUMBNAIL, image));
+
+        cache.put(fingerprint(100), GfxProc::THUMBNAIL, "thumbnail");
+        cache.put(fingerprint(100), GfxProc::PREVIEW, "preview");
+        ASSERT_TRUE(cache.get(fingerprint(100), GfxProc::THUMBNAIL, image));
+        ASSERT_EQ(image, "thumbnail");
+        ASSERT_FALSE(cache.get(fingerprint(200), GfxProc::THUMBNAIL, image));
+    }
+
+    // and they are still there in the next session
+    GfxCache cache(folder());
+    ASSERT_EQ(cache.size(), static_cast<m_off_t>(strlen("thumbnail") + strlen("preview")));
+    ASSERT_TRUE(cache.get(fingerprint(100), GfxProc::PREVIEW, image));
+    ASSERT_EQ(image, "preview");
+}
+
+TEST_F(GfxCacheTest, LeastRecentlyUsedAreRemoved)
+{
+    GfxCache cache(folder(), 2500);
+    string image(1000, 'x');
+    cache.put(fingerprint(1), GfxProc::PREVIEW, image);
+    cache.put(fingerprint(2), GfxProc::PREVIEW, image);
+
+    // the first one is used again, after a second to get a later time
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    ASSERT_TRUE(cache.get(fingerprint(1), GfxProc::PREVIEW, image));
+
+    cache.put(fingerprint(3), GfxProc::PREVIEW, image);
+    ASSERT_LE(cache.size(), 2500);
+    ASSERT_TRUE(cache.get(fingerprint(1), GfxProc::PREVIEW, image));
+    ASSERT_FALSE(cache.get(fingerprint(2), GfxProc::PREVIEW, image));
+    ASSERT_TRUE(cache.get(fingerprint(3), GfxProc::PREVIEW, image));
+
+    // bigger than the whole cache
+    cache.put(fingerprint(4), GfxProc::PREVIEW, string(3000, 'y'));
+    ASSERT_FALSE(cache.get(fingerprint(4), GfxProc::PREVIEW, image));
+}
+
+TEST_F(GfxCacheTest, PartialWritesAreDiscarded)
+{
+    std::filesystem::create_directories(mFolder);
+    std::ofstream(mFolder / "0000000000000064.1.tmp") << "partial";
+
+    GfxCache cache(folder());
+    ASSERT_EQ(cache.size(), 0);
+    ASSERT_FALSE(std::filesystem::exists(mFolder / "0000000000000064.1.tmp"));
+}
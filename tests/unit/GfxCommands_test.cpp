@@ -6,6 +6,10 @@
 using mega::gfx::CommandSerializer;
 using mega::gfx::CommandNewGfx;
 using mega::gfx::CommandNewGfxResponse;
+using mega::gfx::CommandNewGfxBatch;
+using mega::gfx::CommandNewGfxBatchResponse;
+using mega::gfx::GfxTask;
+using mega::gfx::GfxSharedImages;
 using mega::gfx::CommandShutDown;
 using mega::gfx::CommandShutDownResponse;
 using mega::gfx::CommandHello;
@@ -25,9 +29,27 @@ namespace gfx
         return lhs.Task.Path == rhs.Task.Path && lhs.Task.Dimensions == rhs.Task.Dimensions;
     }
 
+    bool operator==(const GfxSharedImages& lhs, const GfxSharedImages& rhs)
+    {
+        return lhs.Name == rhs.Name && lhs.Offset == rhs.Offset && lhs.Generation == rhs.Generation && lhs.Sizes == rhs.Sizes;
+    }
+
     bool operator==(const CommandNewGfxResponse& lhs, const CommandNewGfxResponse& rhs)
     {
-        return lhs.ErrorCode == rhs.ErrorCode && lhs.ErrorText == rhs.ErrorText && lhs.Images == rhs.Images;
+        return lhs.ErrorCode == rhs.ErrorCode && lhs.ErrorText == rhs.ErrorText && lhs.Images == rhs.Images
+               && lhs.SharedImages == rhs.SharedImages;
+    }
+
+    bool operator==(const CommandNewGfxBatch& lhs, const CommandNewGfxBatch& rhs)
+    {
+        return std::equal(lhs.Tasks.begin(), lhs.Tasks.end(), rhs.Tasks.begin(), rhs.Tasks.end(),
+                          [](const GfxTask& l, const GfxTask& r) { return l.Path == r.Path && l.Dimensions == r.Dimensions; });
+    }
+
+    bool operator==(const CommandNewGfxBatchResponse& lhs, const CommandNewGfxBatchResponse& rhs)
+    {
+        return lhs.Index == rhs.Index && lhs.ErrorCode == rhs.ErrorCode && lhs.ErrorText == rhs.ErrorText && lhs.Images == rhs.Images
+               && lhs.SharedImages == rhs.SharedImages;
     }
 
     bool operator==(const CommandShutDown& /*lhs*/, const CommandShutDown& /*rhs*/)
@@ -121,6 +143,82 @@ TEST(GfxCommandSerializer, CommandNewGfxResponseSerializeAndUnserializeSuccessfu
     ASSERT_EQ(sourceCommand, *targetCommand);
 }
 
+TEST(GfxCommandSerializer, CommandNewGfxBatchSerializeAndUnserializeSuccessfully)
+{
+    CommandNewGfxBatch sourceCommand;
+    sourceCommand.Tasks.push_back(GfxTask{ "c:\\path\\image.png", { {1000, 1000}, {200, 0} } });
+    sourceCommand.Tasks.push_back(GfxTask{ "c:\\path\\photo.jpg", { {200, 0} } });
+
+    auto data = CommandSerializer::serialize(&sourceCommand);
+    ASSERT_NE(data, nullptr);
+
+    StringReader reader(std::move(*data));
+    auto command = CommandSerializer::unserialize(reader, TimeoutMs(5000));
+    ASSERT_NE(command, nullptr);
+    auto targetCommand = dynamic_cast<CommandNewGfxBatch*>(command.get());
+    ASSERT_NE(targetCommand, nullptr);
+    ASSERT_EQ(sourceCommand, *targetCommand);
+}
+
+TEST(GfxCommandSerializer, CommandNewGfxBatchWithInvalidTasksIsRejected)
+{
+    CommandNewGfxBatch emptyBatch;
+    auto data = CommandSerializer::serialize(&emptyBatch);
+    ASSERT_NE(data, nullptr);
+    StringReader emptyReader(std::move(*data));
+    ASSERT_EQ(CommandSerializer::unserialize(emptyReader, TimeoutMs(5000)), nullptr);
+
+    // a task without dimensions
+    CommandNewGfxBatch invalidTask;
+    invalidTask.Tasks.push_back(GfxTask{ "c:\\path\\image.png", { {200, 0} } });
+    invalidTask.Tasks.push_back(GfxTask{ "c:\\path\\photo.jpg", {} });
+    data = CommandSerializer::serialize(&invalidTask);
+    ASSERT_NE(data, nullptr);
+    StringReader invalidReader(std::move(*data));
+    ASSERT_EQ(CommandSerializer::unserialize(invalidReader, TimeoutMs(5000)), nullptr);
+}
+
+TEST(GfxCommandSerializer, CommandNewGfxBatchResponseSerializeAndUnserializeSuccessfully)
+{
+    CommandNewGfxBatchResponse sourceCommand;
+    sourceCommand.Index = 7;
+    sourceCommand.ErrorCode = 0;
+    sourceCommand.ErrorText = "OK";
+    sourceCommand.Images.push_back("preview");
+    sourceCommand.Images.push_back("thumbnail");
+
+    auto data = CommandSerializer::serialize(&sourceCommand);
+    ASSERT_NE(data, nullptr);
+
+    StringReader reader(std::move(*data));
+    auto command = CommandSerializer::unserialize(reader, TimeoutMs(5000));
+    ASSERT_NE(command, nullptr);
+    auto targetCommand = dynamic_cast<CommandNewGfxBatchResponse*>(command.get());
+    ASSERT_NE(targetCommand, nullptr);
+    ASSERT_EQ(sourceCommand, *targetCommand);
+}
+
+TEST(GfxCommandSerializer, CommandNewGfxResponseWithSharedImagesSerializeAndUnserializeSuccessfully)
+{
+    CommandNewGfxResponse sourceCommand;
+    sourceCommand.ErrorCode = 0;
+    sourceCommand.ErrorText = "OK";
+    sourceCommand.SharedImages.Name = "megagfx_1234_1";
+    sourceCommand.SharedImages.Offset = 1ULL << 33;
+    sourceCommand.SharedImages.Generation = 42;
+    sourceCommand.SharedImages.Sizes = { 250000, 4500 };
+
+    auto data = CommandSerializer::serialize(&sourceCommand);
+    ASSERT_NE(data, nullptr);
+
+    StringReader reader(std::move(*data));
+    auto command = CommandSerializer::unserialize(reader, TimeoutMs(5000));
+    ASSERT_NE(command, nullptr);
+    auto targetCommand = dynamic_cast<CommandNewGfxResponse*>(command.get());
+    ASSERT_NE(targetCommand, nullptr);
+    ASSERT_EQ(sourceCommand, *targetCommand);
+}
+
 TEST(GfxCommandSerializer, CommandShutdownSerializeAndUnserializeSuccessfully)
 {
     CommandShutDown sourceCommand;
@@ -0,0 +1,254 @@
+/**
+ * @file JSON_test.cpp
+ * @brief Unitary test for the JSON scanner and the JSONSplitter
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include <mega/json.h>
+
+using namespace mega;
+
+namespace {
+
+const char* scalarStringDelimiter(const char* ptr)
+{
+    while (*ptr && *ptr != '"' && *ptr != '\\')
+    {
+        ptr++;
+    }
+    return ptr;
+}
+
+struct PayloadNode
+{
+    std::string handle;
+    std::string attrs;
+    m_off_t size = 0;
+};
+
+// Something that looks like the "f" array of a fetchnodes response
+std::string fetchnodesLikePayload(size_t numNodes, std::vector<PayloadNode>& nodes)
+{
+    std::mt19937 rng(3);
+    auto b64 = [&rng](size_t len)
+    {
+        static const char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+        std::string s;
+        for (size_t i = 0; i < len; ++i) s.push_back(chars[rng() % 64]);
+        return s;
+    };
+
+    std::string json = "{\"f\":[";
+    for (size_t i = 0; i < numNodes; ++i)
+    {
+        PayloadNode node;
+        node.handle = b64(8);
+        node.attrs = b64(64 + rng() % 128);
+        node.size = static_cast<m_off_t>(rng());
+        nodes.push_back(node);
+
+        if (i) json += ",";
+        json += "{\"h\":\"" + node.handle + "\",\"p\":\"" + b64(8) + "\",\"u\":\"" + b64(11)
+              + "\",\"t\":" + std::to_string(i % 2)
+              + ",\"a\":\"" + node.attrs
+              + "\",\"k\":\"" + b64(11) + ":" + b64(22)
+              + "\",\"s\":" + std::to_string(node.size)
+              + ",\"fa\":\"924:1*" + b64(11) + "/924:0*" + b64(11)
+              + "\",\"ts\":" + std::to_string(1700000000 + i) + "}";
+    }
+    json += "],\"ok\":[],\"s\":[],\"sn\":\"" + b64(11) + "\"}";
+    return json;
+}
+
+} // namespace
+
+TEST(JSON, findStringDelimiter_AllAlignments)
+{
+    std::mt19937 rng(11);
+    for (int i = 0; i < 2000; ++i)
+    {
+        std::string s;
+        size_t len = rng() % 80;
+        for (size_t j = 0; j < len; ++j)
+        {
+            unsigned c = rng() % 40;
+            s.push_back(c == 0 ? '"' : c == 1 ? '\\' : char('a' + c % 26));
+        }
+
+        for (size_t offset = 0; offset <= s.size(); ++offset)
+        {
+            ASSERT_EQ(JSON::findStringDelimiter(s.c_str() + offset), scalarStringDelimiter(s.c_str() + offset));
+        }
+    }
+}
+
+TEST(JSON, findStringEnd_Escapes)
+{
+    std::string s = R"(abc\"def\\"tail)";
+    ASSERT_EQ(JSON::findStringEnd(s.c_str()), s.c_str() + 10);
+
+    s = R"(\\\"\\)";
+    ASSERT_EQ(JSON::findStringEnd(s.c_str()), s.c_str() + s.size());
+
+    s = "unterminated\\";
+    ASSERT_EQ(JSON::findStringEnd(s.c_str()), s.c_str() + s.size());
+}
+
+TEST(JSON, storeobject_LongEscapedStrings)
+{
+    std::string value(1000, 'x');
+    value[500] = '\\';
+    value[501] = '"';
+    std::string json = "{\"a\":\"" + value + "\",\"b\":1}";
+
+    JSON j(json);
+    ASSERT_TRUE(j.enterobject());
+    ASSERT_EQ(j.getnameid(), 'a');
+
+    std::string out;
+    ASSERT_TRUE(j.storeobject(&out));
+    ASSERT_EQ(out, value);
+    ASSERT_EQ(j.getnameid(), 'b');
+    ASSERT_EQ(j.getint(), 1);
+}
+
+TEST(JSON, getname_LongNames)
+{
+    std::string longName(100, 'n');
+    std::string json = "{\"" + longName + "\":1,\"^!keys\":2}";
+
+    JSON j(json);
+    ASSERT_TRUE(j.enterobject());
+    ASSERT_EQ(j.getnameWithoutAdvance(), longName);
+    ASSERT_EQ(j.getname(), longName);
+    ASSERT_EQ(j.getint(), 1);
+    ASSERT_EQ(j.getname(), "^!keys");
+    ASSERT_EQ(j.getint(), 2);
+}
+
+TEST(JSON, storeobject_Views)
+{
+    std::string json = R"({"a":"text","b":[1,{"c":"d"}],"e":-12.5})";
+
+    JSON j(json);
+    ASSERT_TRUE(j.enterobject());
+
+    std::string_view value;
+    ASSERT_EQ(j.getnameid(), 'a');
+    ASSERT_TRUE(j.storeobject(value));
+    ASSERT_EQ(value, "text");
+    ASSERT_EQ(value.data(), json.data() + 6); // no copy
+
+    ASSERT_EQ(j.getnameid(), 'b');
+    ASSERT_TRUE(j.storeobject(value));
+    ASSERT_EQ(value, R"([1,{"c":"d"}])");
+
+    ASSERT_EQ(j.getnameid(), 'e');
+    ASSERT_TRUE(j.storeobject(value));
+    ASSERT_EQ(value, "-12.5");
+
+    ASSERT_FALSE(j.storeobject(value));
+}
+
+TEST(JSONSplitter, SplitsStringsWithEscapes)
+{
+    std::string json = R"({"f":[{"h":"a\"b","s":12},{"h":"c\\","s":-3e2}]})";
+
+    std::vector<std::string> nodes;
+    std::map<std::string, std::function<bool(JSON*)>> filters;
+    filters["{[f{"] = [&nodes](JSON* j)
+    {
+        nodes.emplace_back(j->pos);
+        return j->storeobject();
+    };
+
+    JSONSplitter splitter;
+    splitter.processChunk(&filters, json.c_str());
+    ASSERT_TRUE(splitter.hasFinished());
+    ASSERT_FALSE(splitter.hasFailed());
+    ASSERT_EQ(nodes.size(), 2u);
+}
+
+TEST(JSONSplitter, FetchnodesInChunks)
+{
+    static constexpr size_t NUM_NODES = 5000;
+    std::vector<PayloadNode> expected;
+    std::string json = fetchnodesLikePayload(NUM_NODES, expected);
+
+    std::vector<PayloadNode> parsed;
+    std::map<std::string, std::function<bool(JSON*)>> filters;
+    filters["{[f{"] = [&parsed](JSON* j)
+    {
+        if (!j->enterobject())
+        {
+            return false;
+        }
+
+        PayloadNode node;
+        nameid name;
+        while ((name = j->getnameid()) != EOO)
+        {
+            switch (name)
+            {
+                case 'h':
+                    j->storeobject(&node.handle);
+                    break;
+                case 'a':
+                    j->storeobject(&node.attrs);
+                    break;
+                case 's':
+                    node.size = j->getint();
+                    break;
+                default:
+                    if (!j->storeobject())
+                    {
+                        return false;
+                    }
+            }
+        }
+
+        parsed.push_back(node);
+        return j->leaveobject();
+    };
+
+    // feed it in chunks not aligned with the values, as the network layer does
+    JSONSplitter splitter;
+    std::string buffer;
+    static constexpr size_t CHUNK_SIZE = 1000;
+    for (size_t offset = 0; offset < json.size(); offset += CHUNK_SIZE)
+    {
+        buffer.append(json, offset, CHUNK_SIZE);
+        m_off_t consumed = splitter.processChunk(&filters, buffer.c_str());
+        ASSERT_FALSE(splitter.hasFailed());
+        buffer.erase(0, static_cast<size_t>(consumed));
+    }
+
+    ASSERT_TRUE(splitter.hasFinished());
+    ASSERT_EQ(parsed.size(), NUM_NODES);
+
+    for (size_t i = 0; i < NUM_NODES; ++i)
+    {
+        ASSERT_EQ(parsed[i].handle, expected[i].handle) << "node " << i;
+        ASSERT_EQ(parsed[i].attrs, expected[i].attrs) << "node " << i;
+        ASSERT_EQ(parsed[i].size, expected[i].size) << "node " << i;
+    }
+}
@@ -17,6 +17,9 @@
  */
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <thread>
+
 #include <mega/logging.h>
 
 #ifdef NOT_REALLY_NEEDED_BECAUSE_WE_EXERCISE_IT_ALL_THE_TIME_ANYWAY
@@ -517,3 +520,150 @@ TEST(Logging, Extract_file_name_from_full_path)
     ASSERT_EQ(0, strcmp(::mega::log_file_leafname("include/mega/logging.h"), "logging.h"));
     ASSERT_EQ(0, strcmp(::mega::log_file_leafname("include\\mega\\logging.h"), "logging.h" ));
 }
+
+namespace {
+
+class CollectingLogger : public mega::Logger
+{
+public:
+    void log(const char*, int loglevel, const char*, const char *message
+#ifdef ENABLE_LOG_PERFORMANCE
+             , const char**, size_t*, unsigned
+#endif
+             ) override
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        mMessages.emplace_back(loglevel, message);
+    }
+
+    std::mutex mMutex;
+    std::vector<std::pair<int, std::string>> mMessages;
+};
+
+void asyncLog(mega::AsyncLogger& logger, int loglevel, const std::string& message)
+{
+    logger.log(nullptr, loglevel, nullptr, message.c_str()
+#ifdef ENABLE_LOG_PERFORMANCE
+               , nullptr, nullptr, 0
+#endif
+               );
+}
+
+}
+
+TEST(Logging, AsyncLogger_DeliversOrCountsDrops)
+{
+    CollectingLogger target;
+    static constexpr int THREADS = 4;
+    static constexpr int MESSAGES = 1000;
+
+    size_t delivered = 0;
+    uint64_t dropped = 0;
+    {
+        mega::AsyncLogger logger(target, 16);
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; ++t)
+        {
+            threads.emplace_back([&logger, t]()
+            {
+                for (int i = 0; i < MESSAGES; ++i)
+                {
+                    asyncLog(logger, mega::logInfo, "thread " + std::to_string(t) + " message " + std::to_string(i));
+                }
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        // a message longer than the records
+        asyncLog(logger, mega::logDebug, std::string(3 * mega::LOGGER_CHUNKS_SIZE, 'x'));
+        logger.flush();
+
+        dropped = logger.droppedMessages();
+    }
+
+    // the drops are reported as warnings
+    uint64_t reported = 0;
+    std::lock_guard<std::mutex> g(target.mMutex);
+    for (const auto& message : target.mMessages)
+    {
+        if (message.second.find("AsyncLogger: ") == 0)
+        {
+            ASSERT_EQ(message.first, mega::logWarning);
+            reported += std::stoull(message.second.substr(13));
+        }
+        else
+        {
+            delivered++;
+        }
+    }
+    ASSERT_EQ(delivered + dropped, size_t(THREADS * MESSAGES + 1));
+    ASSERT_EQ(reported, dropped);
+    ASSERT_TRUE(std::any_of(target.mMessages.begin(), target.mMessages.end(), [](const std::pair<int, std::string>& message)
+    {
+        return message.second == std::string(3 * mega::LOGGER_CHUNKS_SIZE, 'x');
+    }));
+}
+
+TEST(Logging, AsyncLogger_BinaryMode)
+{
+    std::stringstream binary;
+    {
+        mega::AsyncLogger logger(binary);
+        asyncLog(logger, mega::logError, "first");
+        logger.log("12:00:00", mega::logDebug, "file.cpp:42", "second"
+#ifdef ENABLE_LOG_PERFORMANCE
+                   , nullptr, nullptr, 0
+#endif
+                   );
+    }
+
+    std::ostringstream text;
+    ASSERT_TRUE(mega::AsyncLogger::decodeBinaryLog(binary, text));
+
+    std::string decoded = text.str();
+    ASSERT_NE(decoded.find("[err][t0] first\n"), std::string::npos);
+    ASSERT_NE(decoded.find("[debug][t0] file.cpp:42 second\n"), std::string::npos);
+    ASSERT_LT(decoded.find("first"), decoded.find("second"));
+
+    // truncated logs are detected
+    std::string data = binary.str();
+    std::istringstream truncated(data.substr(0, data.size() - 2));
+    std::ostringstream ignored;
+    ASSERT_FALSE(mega::AsyncLogger::decodeBinaryLog(truncated, ignored));
+}
+
+TEST(Logging, Tracer_ChromeTraceOfThreads)
+{
+    mega::Tracer::dump(true);
+
+    {
+        mega::TraceSpan span("not recorded");
+    }
+
+    mega::Tracer::setEnabled(true);
+    std::thread worker([]()
+    {
+        mega::Tracer::setThreadName("worker");
+        mega::TraceSpan outer("outer");
+        mega::TraceSpan inner("inner");
+    });
+    worker.join();
+    mega::Tracer::setEnabled(false);
+
+    std::string trace = mega::Tracer::dump(true);
+    ASSERT_EQ(trace.find("{\"traceEvents\":["), 0u);
+    ASSERT_EQ(trace.find("not recorded"), std::string::npos);
+    ASSERT_NE(trace.find("\"ph\":\"M\""), std::string::npos);
+    ASSERT_NE(trace.find("\"name\":\"worker "), std::string::npos);
+    ASSERT_NE(trace.find("{\"name\":\"outer\",\"cat\":\"mega\",\"ph\":\"X\""), std::string::npos);
+
+    // the inner span ends first
+    ASSERT_LT(trace.find("\"inner\""), trace.find("\"outer\""));
+
+    // the events were discarded, and so was the finished thread
+    ASSERT_EQ(mega::Tracer::dump(false), "{\"traceEvents\":[],\"displayTimeUnit\":\"ms\"}");
+}
@@ -345,3 +345,60 @@ TEST(MegaApi, MegaApiImpl_calcRecommendedProLevel)
     ASSERT_EQ(test(MegaAccountDetails::ACCOUNT_TYPE_BUSINESS, gb), MegaAccountDetails::ACCOUNT_TYPE_BUSINESS);
     ASSERT_EQ(test(MegaAccountDetails::ACCOUNT_TYPE_PRO_FLEXI, gb), MegaAccountDetails::ACCOUNT_TYPE_PRO_FLEXI);
 }
+
+TEST(MegaApi, NodeChangeBuffer_coalesceAndOverflow)
+{
+    NodeChangeBuffer buffer;
+    ASSERT_FALSE(buffer.enabled());
+    ASSERT_FALSE(buffer.push({{1, 10, MegaNode::CHANGE_TYPE_NEW}}));
+
+    buffer.setCapacity(3);
+    ASSERT_TRUE(buffer.enabled());
+
+    // only the first changes after the buffer was drained require a notification
+    ASSERT_TRUE(buffer.push({{1, 10, MegaNode::CHANGE_TYPE_NEW}, {2, 10, MegaNode::CHANGE_TYPE_NEW}}));
+    ASSERT_FALSE(buffer.push({{1, 20, MegaNode::CHANGE_TYPE_PARENT}, {3, 10, MegaNode::CHANGE_TYPE_NAME}}));
+    ASSERT_EQ(buffer.size(), 3u);
+
+    bool incomplete = true;
+    auto changes = buffer.pop(2, incomplete);
+    ASSERT_FALSE(incomplete);
+    ASSERT_EQ(changes.size(), 2u);
+    ASSERT_EQ(changes[0].mHandle, 1u);
+    ASSERT_EQ(changes[0].mParentHandle, 20u);
+    ASSERT_EQ(changes[0].mChanges, uint64_t(MegaNode::CHANGE_TYPE_NEW | MegaNode::CHANGE_TYPE_PARENT));
+    ASSERT_EQ(changes[1].mHandle, 2u);
+
+    // a node taken by the app gets a new entry, after the pending ones
+    ASSERT_FALSE(buffer.push({{1, 20, MegaNode::CHANGE_TYPE_REMOVED}}));
+    changes = buffer.pop(0, incomplete);
+    ASSERT_EQ(changes.size(), 2u);
+    ASSERT_EQ(changes[0].mHandle, 3u);
+    ASSERT_EQ(changes[1].mHandle, 1u);
+    ASSERT_EQ(changes[1].mChanges, uint64_t(MegaNode::CHANGE_TYPE_REMOVED));
+    ASSERT_EQ(buffer.size(), 0u);
+
+    // more nodes than the capacity: the oldest changes are dropped
+    ASSERT_TRUE(buffer.push({{4, 10, 0}, {5, 10, 0}, {6, 10, 0}, {7, 10, 0}}));
+    changes = buffer.pop(0, incomplete);
+    ASSERT_TRUE(incomplete);
+    ASSERT_EQ(changes.size(), 1u);
+    ASSERT_EQ(changes[0].mHandle, 7u);
+
+    ASSERT_TRUE(buffer.setIncomplete());
+    ASSERT_FALSE(buffer.setIncomplete());
+    changes = buffer.pop(0, incomplete);
+    ASSERT_TRUE(incomplete);
+    ASSERT_TRUE(changes.empty());
+    buffer.pop(0, incomplete);
+    ASSERT_FALSE(incomplete);
+
+    MegaNodeChangeListPrivate list({{8, 9, MegaNode::CHANGE_TYPE_NAME}}, false);
+    unique_ptr<MegaNodeChangeList> copy(list.copy());
+    ASSERT_EQ(copy->size(), 1);
+    ASSERT_EQ(copy->getHandle(0), 8u);
+    ASSERT_EQ(copy->getParentHandle(0), 9u);
+    ASSERT_EQ(copy->getChanges(0), uint64_t(MegaNode::CHANGE_TYPE_NAME));
+    ASSERT_EQ(copy->getHandle(1), INVALID_HANDLE);
+    ASSERT_FALSE(copy->isIncomplete());
+}
@@ -0,0 +1,109 @@
+/**
+ * @file Metrics_test.cpp
+ * @brief Unitary test for the counters, gauges and latency histograms
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include <mega/metrics.h>
+
+using namespace mega;
+
+TEST(Metrics, HistogramBuckets)
+{
+    // the buckets are contiguous and each value falls in the one that contains it
+    uint64_t previousUpperBound = 0;
+    for (unsigned bucket = 1; bucket < Metrics::Histogram::BUCKETS; ++bucket)
+    {
+        uint64_t upperBound = Metrics::Histogram::bucketUpperBound(bucket);
+        ASSERT_GT(upperBound, previousUpperBound);
+        ASSERT_EQ(Metrics::Histogram::bucketOf(previousUpperBound + 1), bucket);
+        ASSERT_EQ(Metrics::Histogram::bucketOf(upperBound), bucket);
+
+        // within 25% at any scale
+        uint64_t lowerBound = previousUpperBound + 1;
+        ASSERT_LE(upperBound - lowerBound, lowerBound / 4) << "bucket " << bucket;
+        previousUpperBound = upperBound;
+    }
+
+    ASSERT_EQ(Metrics::Histogram::bucketOf(UINT64_MAX), Metrics::Histogram::BUCKETS - 1);
+}
+
+TEST(Metrics, HistogramPercentiles)
+{
+    Metrics::Histogram histogram;
+    ASSERT_EQ(histogram.percentile(50), 0u);
+
+    for (uint64_t us = 1; us <= 1000; ++us)
+    {
+        histogram.record(us);
+    }
+    histogram.record(std::chrono::seconds(2));
+
+    ASSERT_EQ(histogram.count(), 1001u);
+    ASSERT_EQ(histogram.max(), 2000000u);
+    ASSERT_EQ(histogram.sum(), 500500u + 2000000u);
+    ASSERT_NEAR(double(histogram.percentile(50)), 500, 125);
+    ASSERT_NEAR(double(histogram.percentile(99)), 990, 250);
+    ASSERT_EQ(histogram.percentile(100), 2000000u);
+
+    histogram.reset();
+    ASSERT_EQ(histogram.count(), 0u);
+    ASSERT_EQ(histogram.percentile(99), 0u);
+}
+
+TEST(Metrics, RegistrySnapshot)
+{
+    Metrics::Registry registry;
+    auto& counter = registry.counter("test_counter");
+    ASSERT_EQ(&counter, &registry.counter("test_counter"));
+    registry.gauge("test_gauge").set(-3);
+
+    auto& histogram = registry.histogram("test_histogram");
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&counter, &histogram]()
+        {
+            for (int i = 0; i < 1000; ++i)
+            {
+                counter.add();
+                histogram.record(uint64_t(10));
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    ASSERT_EQ(registry.snapshot(true),
+              "{\"counters\":{\"test_counter\":4000},\"gauges\":{\"test_gauge\":-3},"
+              "\"histograms\":{\"test_histogram\":{\"count\":4000,\"sum_us\":40000,\"max_us\":10,"
+              "\"p50_us\":10,\"p90_us\":10,\"p99_us\":10,\"p999_us\":10}}}");
+
+    // counters and histograms were reset, gauges are kept
+    ASSERT_EQ(registry.snapshot(false),
+              "{\"counters\":{\"test_counter\":0},\"gauges\":{\"test_gauge\":-3},"
+              "\"histograms\":{\"test_histogram\":{\"count\":0,\"sum_us\":0,\"max_us\":0,"
+              "\"p50_us\":0,\"p90_us\":0,\"p99_us\":0,\"p999_us\":0}}}");
+}
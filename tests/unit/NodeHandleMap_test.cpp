@@ -0,0 +1,218 @@
+/**
+ * @file NodeHandleMap_test.cpp
+ * @brief Unitary test for NodeHandleMap
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <set>
+
+#include <mega/nodehandlemap.h>
+
+using namespace mega;
+
+namespace {
+
+NodeHandle toHandle(uint64_t h)
+{
+    return NodeHandle().set6byte(h & 0xFFFFFFFFFFFF);
+}
+
+std::vector<NodeHandle> randomHandles(size_t count)
+{
+    std::mt19937_64 rng(42);
+    std::set<uint64_t> used;
+    std::vector<NodeHandle> handles;
+    handles.reserve(count);
+
+    while (handles.size() < count)
+    {
+        uint64_t h = rng() & 0xFFFFFFFFFFFF;
+        if (h != 0xFFFFFFFFFFFF && used.insert(h).second)
+        {
+            handles.push_back(toHandle(h));
+        }
+    }
+
+    return handles;
+}
+
+} // namespace
+
+TEST(NodeHandleMap, EmplaceFindErase)
+{
+    NodeHandleMap<int> map;
+    ASSERT_TRUE(map.empty());
+    ASSERT_EQ(map.find(toHandle(1)), map.end());
+
+    auto result = map.emplace(toHandle(1), 10);
+    ASSERT_TRUE(result.second);
+    ASSERT_EQ(result.first->first, toHandle(1));
+    ASSERT_EQ(result.first->second, 10);
+
+    // emplacing an existing key doesn't overwrite the value
+    result = map.emplace(toHandle(1), 20);
+    ASSERT_FALSE(result.second);
+    ASSERT_EQ(result.first->second, 10);
+    ASSERT_EQ(map.size(), 1u);
+
+    map[toHandle(2)] = 30;
+    ASSERT_EQ(map.size(), 2u);
+    ASSERT_EQ(map.find(toHandle(2))->second, 30);
+
+    map.erase(map.find(toHandle(1)));
+    ASSERT_EQ(map.find(toHandle(1)), map.end());
+    ASSERT_EQ(map.erase(toHandle(1)), 0u);
+    ASSERT_EQ(map.erase(toHandle(2)), 1u);
+    ASSERT_TRUE(map.empty());
+    ASSERT_EQ(map.begin(), map.end());
+}
+
+TEST(NodeHandleMap, StableAddressesAcrossGrowth)
+{
+    auto handles = randomHandles(20000);
+
+    NodeHandleMap<std::unique_ptr<int>> map;
+    std::vector<std::pair<NodeHandle, std::unique_ptr<int>*>> addresses;
+
+    for (size_t i = 0; i < handles.size(); ++i)
+    {
+        auto result = map.emplace(handles[i], std::make_unique<int>(static_cast<int>(i)));
+        ASSERT_TRUE(result.second);
+        addresses.emplace_back(handles[i], &result.first->second);
+    }
+
+    // erase half of them: the others must keep their addresses
+    for (size_t i = 0; i < handles.size(); i += 2)
+    {
+        ASSERT_EQ(map.erase(handles[i]), 1u);
+    }
+
+    ASSERT_EQ(map.size(), handles.size() / 2);
+
+    for (size_t i = 1; i < handles.size(); i += 2)
+    {
+        auto it = map.find(handles[i]);
+        ASSERT_NE(it, map.end());
+        ASSERT_EQ(&it->second, addresses[i].second);
+        ASSERT_EQ(*it->second, static_cast<int>(i));
+    }
+
+    for (size_t i = 0; i < handles.size(); i += 2)
+    {
+        ASSERT_EQ(map.find(handles[i]), map.end());
+    }
+
+    // iteration visits every remaining element once
+    size_t visited = 0;
+    for (auto& it : map)
+    {
+        ASSERT_EQ(*it.second % 2, 1);
+        ++visited;
+    }
+    ASSERT_EQ(visited, map.size());
+
+    map.clear();
+    ASSERT_TRUE(map.empty());
+    ASSERT_EQ(map.find(handles[1]), map.end());
+}
+
+TEST(NodeHandleMap, MatchesStdMapUnderRandomOperations)
+{
+    std::mt19937_64 rng(7);
+    NodeHandleMap<uint64_t> map;
+    std::map<NodeHandle, uint64_t> reference;
+
+    // a small key space forces collisions, reinsertions and backward shifts
+    for (int i = 0; i < 200000; ++i)
+    {
+        NodeHandle h = toHandle(rng() % 512);
+        switch (rng() % 3)
+        {
+            case 0:
+                ASSERT_EQ(map.emplace(h, i).second, reference.emplace(h, i).second);
+                break;
+            case 1:
+                ASSERT_EQ(map.erase(h), reference.erase(h));
+                break;
+            default:
+            {
+                auto it = map.find(h);
+                auto rit = reference.find(h);
+                ASSERT_EQ(it == map.end(), rit == reference.end());
+                if (rit != reference.end())
+                {
+                    ASSERT_EQ(it->second, rit->second);
+                }
+            }
+        }
+        ASSERT_EQ(map.size(), reference.size());
+    }
+}
+
+TEST(NodeHandleMap, LookupsAfterEraseAndRehash)
+{
+    auto handles = randomHandles(4000);
+    NodeHandleMap<uint64_t> map;
+    std::set<size_t> erased;
+
+    // erasing while inserting leaves erased slots in the table each time it grows
+    for (size_t i = 0; i < handles.size(); ++i)
+    {
+        ASSERT_TRUE(map.emplace(handles[i], handles[i].as8byte()).second);
+
+        if (i % 3 == 0)
+        {
+            ASSERT_EQ(map.erase(handles[i / 2]), erased.insert(i / 2).second ? 1u : 0u);
+        }
+    }
+
+    ASSERT_EQ(map.size(), handles.size() - erased.size());
+
+    for (size_t i = 0; i < handles.size(); ++i)
+    {
+        auto it = map.find(handles[i]);
+        if (erased.count(i))
+        {
+            ASSERT_EQ(it, map.end());
+            ASSERT_EQ(map.count(handles[i]), 0u);
+        }
+        else
+        {
+            ASSERT_NE(it, map.end());
+            ASSERT_EQ(it->first, handles[i]);
+            ASSERT_EQ(it->second, handles[i].as8byte());
+        }
+    }
+
+    // the erased keys can be inserted again, with new values
+    for (auto i : erased)
+    {
+        ASSERT_TRUE(map.emplace(handles[i], i).second);
+    }
+
+    ASSERT_EQ(map.size(), handles.size());
+
+    for (size_t i = 0; i < handles.size(); ++i)
+    {
+        ASSERT_EQ(map.find(handles[i])->second, erased.count(i) ? i : handles[i].as8byte());
+    }
+}
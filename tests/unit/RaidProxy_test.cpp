@@ -0,0 +1,237 @@
+/**
+ * @file RaidProxy_test.cpp
+ * @brief Unitary test for the slow part detection of the RaidProxy
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include <mega/raidproxy.h>
+
+using namespace mega;
+using namespace mega::RaidProxy;
+
+namespace {
+
+struct SimulatedPart
+{
+    double bytesPerMs;
+    double latencyMs;
+};
+
+struct SimulationResult
+{
+    double finishMs = 0;
+    uint8_t switchedPart = RAIDPARTS;
+};
+
+// Requests of random sizes are fetched from the parts 1..5 (part 0 is left idle, as the unused connection),
+// and the lagging part is handed over to the idle one when predicted, if 'allowSwitch'
+SimulationResult simulate(const std::array<SimulatedPart, RAIDPARTS>& parts, m_off_t partSize, bool allowSwitch, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<m_off_t> requestSize(64 * 1024, 256 * 1024);
+    std::uniform_real_distribution<double> noise(0.9, 1.1);
+
+    std::array<PartThroughput, RAIDPARTS> models;
+    std::array<m_off_t, RAIDPARTS> rem{};
+    std::array<double, RAIDPARTS> clock{};
+    std::array<bool, RAIDPARTS> active{};
+    for (uint8_t i = 1; i < RAIDPARTS; i++)
+    {
+        rem[i] = partSize;
+        active[i] = true;
+    }
+
+    SimulationResult result;
+    for (;;)
+    {
+        // next request to complete
+        uint8_t next = RAIDPARTS;
+        for (uint8_t i = 0; i < RAIDPARTS; i++)
+        {
+            if (active[i] && rem[i] && (next == RAIDPARTS || clock[i] < clock[next]))
+            {
+                next = i;
+            }
+        }
+        if (next == RAIDPARTS)
+        {
+            break;
+        }
+
+        m_off_t bytes = std::min(requestSize(rng), rem[next]);
+        double ms = (parts[next].latencyMs + static_cast<double>(bytes) / parts[next].bytesPerMs) * noise(rng);
+        clock[next] += ms;
+        rem[next] -= bytes;
+        models[next].addSample(bytes, static_cast<int64_t>(std::llround(ms)));
+        result.finishMs = std::max(result.finishMs, clock[next]);
+
+        if (!allowSwitch || result.switchedPart != RAIDPARTS)
+        {
+            continue;
+        }
+
+        std::array<const PartThroughput*, RAIDPARTS> candidates{};
+        for (uint8_t i = 0; i < RAIDPARTS; i++)
+        {
+            candidates[i] = active[i] ? &models[i] : nullptr;
+        }
+
+        uint8_t lagging = predictLaggingPart(candidates, rem);
+        if (lagging != RAIDPARTS)
+        {
+            // the idle part reconstructs the data left by the lagging one
+            result.switchedPart = lagging;
+            active[lagging] = false;
+            active[0] = true;
+            rem[0] = rem[lagging];
+            clock[0] = clock[next];
+            rem[lagging] = 0;
+        }
+    }
+
+    return result;
+}
+
+std::array<SimulatedPart, RAIDPARTS> evenParts()
+{
+    std::array<SimulatedPart, RAIDPARTS> parts;
+    parts.fill({ 1000, 40 }); // ~1 MB/s, 40 ms per request
+    return parts;
+}
+
+} // namespace
+
+TEST(RaidProxy, PartThroughput_ThroughputAndLatency)
+{
+    PartThroughput model;
+    ASSERT_EQ(model.samples(), 0u);
+    ASSERT_EQ(model.bytesPerMs(), 0);
+    ASSERT_EQ(model.predictedMs(1000), 0);
+
+    // 500 bytes/ms with 50 ms of latency per request
+    for (m_off_t bytes : { 50000, 100000, 200000, 50000, 150000, 100000, 200000, 50000 })
+    {
+        model.addSample(bytes, 50 + bytes / 500);
+    }
+
+    ASSERT_NEAR(model.latencyMs(), 50, 1);
+    ASSERT_GT(model.bytesPerMs(), 0);
+    ASSERT_LT(model.bytesPerMs(), 500); // the latency lowers the effective throughput
+
+    // the prediction follows the latest samples
+    for (int i = 0; i < 20; i++)
+    {
+        model.addSample(100000, 1000);
+    }
+    ASSERT_NEAR(model.bytesPerMs(), 100, 1);
+    ASSERT_NEAR(model.predictedMs(1000000), 10000, 100);
+
+    // requests of the same size can't tell the latency apart
+    ASSERT_EQ(model.latencyMs(), 0);
+
+    model.reset();
+    ASSERT_EQ(model.samples(), 0u);
+
+    // zero-length times are not a division by zero
+    model.addSample(1000, 0);
+    ASSERT_GT(model.bytesPerMs(), 0);
+}
+
+TEST(RaidProxy, PredictLaggingPart)
+{
+    std::array<PartThroughput, RAIDPARTS> models;
+    std::array<const PartThroughput*, RAIDPARTS> candidates{};
+    std::array<m_off_t, RAIDPARTS> rem{};
+    for (uint8_t i = 1; i < RAIDPARTS; i++)
+    {
+        models[i].addSample(100000, 100);
+        candidates[i] = &models[i];
+        rem[i] = 10000000;
+    }
+
+    // not enough samples yet
+    ASSERT_EQ(predictLaggingPart(candidates, rem), RAIDPARTS);
+
+    for (unsigned n = 1; n < PartThroughput::MIN_SAMPLES; n++)
+    {
+        for (uint8_t i = 1; i < RAIDPARTS; i++)
+        {
+            models[i].addSample(100000, 100);
+        }
+    }
+
+    // similar parts
+    ASSERT_EQ(predictLaggingPart(candidates, rem), RAIDPARTS);
+
+    // part 4 is predicted to finish much later due to its throughput
+    models[4].addSample(100000, 2000);
+    models[4].addSample(100000, 2000);
+    ASSERT_EQ(predictLaggingPart(candidates, rem), 4);
+
+    // unless it's almost done anyway
+    rem[4] = 100000;
+    ASSERT_EQ(predictLaggingPart(candidates, rem), RAIDPARTS);
+
+    // or the others can't take over its data
+    rem[4] = 10000000;
+    for (uint8_t i = 1; i < RAIDPARTS; i++)
+    {
+        if (i != 4) candidates[i] = nullptr;
+    }
+    ASSERT_EQ(predictLaggingPart(candidates, rem), RAIDPARTS);
+}
+
+// Simulated downloads: only a lagging part is switched, and the download finishes earlier thanks to it
+TEST(RaidProxy, PredictLaggingPart_Simulation)
+{
+    static constexpr m_off_t PART_SIZE = 32 * 1024 * 1024;
+
+    // no part lagging: there must be no switches, despite the noise
+    for (unsigned seed = 1; seed <= 20; seed++)
+    {
+        ASSERT_EQ(simulate(evenParts(), PART_SIZE, true, seed).switchedPart, RAIDPARTS) << "seed " << seed;
+    }
+
+    struct Scenario
+    {
+        const char* name;
+        uint8_t part;
+        SimulatedPart lagging;
+    };
+
+    for (const Scenario& scenario : { Scenario{ "slow bandwidth", 3, { 250, 40 } },
+                                      Scenario{ "high latency", 2, { 1000, 400 } },
+                                      Scenario{ "both", 5, { 500, 200 } } })
+    {
+        auto parts = evenParts();
+        parts[scenario.part] = scenario.lagging;
+
+        SimulationResult withoutSwitch = simulate(parts, PART_SIZE, false, 7);
+        SimulationResult withSwitch = simulate(parts, PART_SIZE, true, 7);
+
+        ASSERT_EQ(withoutSwitch.switchedPart, RAIDPARTS) << scenario.name;
+        ASSERT_EQ(withSwitch.switchedPart, scenario.part) << scenario.name;
+        ASSERT_LT(withSwitch.finishMs, withoutSwitch.finishMs) << scenario.name;
+    }
+}
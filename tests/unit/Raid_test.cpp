@@ -0,0 +1,210 @@
+/**
+ * @file Raid_test.cpp
+ * @brief Unitary test for the raid line kernels of RaidBufferManager
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+
+#include <mega/raid.h>
+
+using namespace mega;
+
+namespace {
+
+struct RaidParts
+{
+    std::vector<byte> data[RAIDPARTS];
+    const byte* ptrs[RAIDPARTS];
+
+    // random data parts and their parity
+    explicit RaidParts(size_t partslen)
+    {
+        std::mt19937 rng(static_cast<unsigned>(partslen));
+        for (unsigned j = 0; j < RAIDPARTS; ++j)
+        {
+            data[j].resize(partslen);
+            ptrs[j] = data[j].data();
+        }
+
+        for (size_t i = 0; i < partslen; ++i)
+        {
+            byte parity = 0;
+            for (unsigned j = 1; j < RAIDPARTS; ++j)
+            {
+                data[j][i] = static_cast<byte>(rng());
+                parity = static_cast<byte>(parity ^ data[j][i]);
+            }
+            data[0][i] = parity;
+        }
+    }
+
+    // the output file: interleaved sectors of the data parts
+    std::vector<byte> expected() const
+    {
+        std::vector<byte> out;
+        for (size_t i = 0; i < data[0].size(); i += RAIDSECTOR)
+        {
+            for (unsigned j = 1; j < RAIDPARTS; ++j)
+            {
+                out.insert(out.end(), data[j].begin() + static_cast<std::ptrdiff_t>(i), data[j].begin() + static_cast<std::ptrdiff_t>(i + RAIDSECTOR));
+            }
+        }
+        return out;
+    }
+};
+
+} // namespace
+
+TEST(Raid, combineRaidLines_AllPartsPresent)
+{
+    for (size_t sectors : { 1, 2, 3, 31, 64 })
+    {
+        RaidParts parts(sectors * RAIDSECTOR);
+        std::vector<byte> out(sectors * RAIDLINE);
+
+        RaidBufferManager::combineRaidLines(out.data(), parts.ptrs, sectors * RAIDSECTOR);
+        ASSERT_EQ(out, parts.expected());
+
+        // the parity is not needed if all the data parts are present
+        parts.ptrs[0] = nullptr;
+        std::fill(out.begin(), out.end(), 0);
+        RaidBufferManager::combineRaidLines(out.data(), parts.ptrs, sectors * RAIDSECTOR);
+        ASSERT_EQ(out, parts.expected());
+    }
+}
+
+TEST(Raid, combineRaidLines_RecoverFromParity)
+{
+    for (size_t sectors : { 1, 2, 3, 31, 64 })
+    {
+        for (unsigned missing = 1; missing < RAIDPARTS; ++missing)
+        {
+            RaidParts parts(sectors * RAIDSECTOR);
+            parts.ptrs[missing] = nullptr;
+
+            std::vector<byte> out(sectors * RAIDLINE);
+            RaidBufferManager::combineRaidLines(out.data(), parts.ptrs, sectors * RAIDSECTOR);
+            ASSERT_EQ(out, parts.expected()) << "sectors " << sectors << ", missing part " << missing;
+        }
+    }
+}
+
+// RaidProxy rebuilds the missing sectors in place, once the other sectors of the lines are interleaved
+TEST(Raid, recoverRaidLines_InPlace)
+{
+    for (size_t lines : { 1, 2, 3, 31, 64 })
+    {
+        for (unsigned missing = 1; missing < RAIDPARTS; ++missing)
+        {
+            RaidParts parts(lines * RAIDSECTOR);
+            std::vector<byte> out = parts.expected();
+            for (size_t i = 0; i < lines; ++i)
+            {
+                std::fill_n(out.begin() + static_cast<std::ptrdiff_t>(i * RAIDLINE + (missing - 1) * RAIDSECTOR), RAIDSECTOR, byte(0));
+            }
+
+            RaidBufferManager::recoverRaidLines(out.data(), parts.data[0].data(), missing, lines);
+            ASSERT_EQ(out, parts.expected()) << "lines " << lines << ", missing part " << missing;
+        }
+    }
+}
+
+// combineLastRaidLine() recovers the non-full sectors at the end of the file byte by byte
+TEST(Raid, xorBytes_Tail)
+{
+    std::mt19937 rng(5);
+    for (size_t n = 0; n <= 3 * RAIDSECTOR + 1; ++n)
+    {
+        std::vector<byte> a(n), b(n), expected(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            a[i] = static_cast<byte>(rng());
+            b[i] = static_cast<byte>(rng());
+            expected[i] = static_cast<byte>(a[i] ^ b[i]);
+        }
+
+        RaidBufferManager::xorBytes(a.data(), b.data(), n);
+        ASSERT_EQ(a, expected);
+    }
+}
+
+// the vectorized implementations must not rely on the alignment of the buffers
+TEST(Raid, combineRaidLines_UnalignedBuffers)
+{
+    static constexpr size_t PARTSLEN = 64 * RAIDSECTOR;
+    RaidParts parts(PARTSLEN);
+    std::vector<byte> expected = parts.expected();
+
+    for (size_t offset = 1; offset < 16; offset += 7)
+    {
+        std::vector<byte> copies[RAIDPARTS];
+        const byte* ptrs[RAIDPARTS];
+        for (unsigned j = 0; j < RAIDPARTS; ++j)
+        {
+            copies[j].resize(PARTSLEN + offset);
+            std::copy(parts.data[j].begin(), parts.data[j].end(), copies[j].begin() + static_cast<std::ptrdiff_t>(offset));
+            ptrs[j] = copies[j].data() + offset;
+        }
+
+        for (unsigned missing = 0; missing < RAIDPARTS; ++missing)
+        {
+            const byte* available[RAIDPARTS];
+            std::copy(ptrs, ptrs + RAIDPARTS, available);
+            available[missing] = nullptr;
+
+            std::vector<byte> out(PARTSLEN * EFFECTIVE_RAIDPARTS + offset);
+            RaidBufferManager::combineRaidLines(out.data() + offset, available, PARTSLEN);
+            ASSERT_TRUE(std::equal(expected.begin(), expected.end(), out.begin() + static_cast<std::ptrdiff_t>(offset)))
+                << "offset " << offset << ", missing part " << missing;
+        }
+    }
+}
+
+TEST(Raid, FilePieceBuffersAreRecycled)
+{
+    HttpBufferPool::clear();
+
+    byte* first;
+    {
+        RaidBufferManager::FilePiece piece(0, 1000 * 1000);
+        first = piece.buf.datastart();
+    }
+    ASSERT_EQ(HttpBufferPool::cachedBytes(), 1024 * 1024u);
+
+    // pooled buffers can be written with direct I/O
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(first) % HttpBufferPool::ALIGNMENT, 0u);
+
+    // a piece of a similar size reuses the released slab
+    {
+        RaidBufferManager::FilePiece piece(0, 900 * 1000);
+        ASSERT_EQ(piece.buf.datastart(), first);
+        ASSERT_EQ(HttpBufferPool::cachedBytes(), 0u);
+    }
+
+    // small and huge buffers are not pooled
+    HttpBufferPool::release(HttpBufferPool::allocate(100));
+    HttpBufferPool::release(HttpBufferPool::allocate(HttpBufferPool::MAX_SLAB_SIZE + 1));
+    ASSERT_EQ(HttpBufferPool::cachedBytes(), 1024 * 1024u);
+
+    HttpBufferPool::clear();
+    ASSERT_EQ(HttpBufferPool::cachedBytes(), 0u);
+}
@@ -190,6 +190,82 @@ TEST(Serialization, CacheableReaderWriter)
     ASSERT_EQ(mp2.no_audio, false);
 }
 
+TEST(Serialization, CacheableReader_views)
+{
+    std::string writestring;
+    mega::CacheableWriter w(writestring);
+    w.reserve(64);
+    ASSERT_GE(writestring.capacity(), 64u);
+
+    w.serializecstr("cstr", true);
+    w.serializestring("string");
+    w.serializestring(std::string());
+    w.serializestring_u32("string_u32");
+    writestring += "\x05"; // truncated field
+
+    mega::CacheableReader r(writestring.data(), writestring.size());
+    std::string_view cstr, str, empty, str32, truncated;
+
+    ASSERT_TRUE(r.unserializecstr(cstr, true));
+    ASSERT_EQ(cstr, "cstr");
+    ASSERT_EQ(cstr.data(), writestring.data() + 2); // no copy
+
+    ASSERT_TRUE(r.unserializestring(str));
+    ASSERT_EQ(str, "string");
+
+    ASSERT_TRUE(r.unserializestring(empty));
+    ASSERT_TRUE(empty.empty());
+
+    ASSERT_TRUE(r.unserializestring_u32(str32));
+    ASSERT_EQ(str32, "string_u32");
+
+    ASSERT_FALSE(r.unserializestring(truncated));
+    ASSERT_EQ(r.fieldnum, 4u);
+}
+
+// huge downloads with out-of-order pieces can have more chunk MACs than a 16-bit count
+TEST(Serialization, chunkmac_map_withManySparseChunks)
+{
+    mega::SymmCipher cipher;
+    mega::byte key[mega::SymmCipher::KEYLENGTH] = { 1 };
+    cipher.setkey(key);
+
+    static constexpr size_t NUM_CHUNKS = 70000;
+    mega::chunkmac_map cm;
+    mega::m_off_t pos = 0;
+    for (size_t i = 0; i < 2 * NUM_CHUNKS; ++i)
+    {
+        // every other chunk is finished
+        if (i % 2)
+        {
+            mega::byte data[mega::SymmCipher::BLOCKSIZE] = { 0 };
+            cm.ctr_encrypt(pos, &cipher, data, sizeof(data), pos, 0, true);
+        }
+        pos = mega::ChunkedHash::chunkceil(pos);
+    }
+    ASSERT_EQ(cm.size(), NUM_CHUNKS);
+
+    std::string d;
+    cm.serialize(d);
+    d += "abc";
+
+    mega::chunkmac_map check_cm;
+    const char* ptr = d.data();
+    ASSERT_TRUE(check_cm.unserialize(ptr, d.data() + d.size()));
+    ASSERT_EQ(std::string(ptr), "abc");
+    ASSERT_EQ(check_cm.size(), NUM_CHUNKS);
+
+    mega::m_off_t chunkpos, completed, check_chunkpos, check_completed;
+    cm.calcprogress(pos, chunkpos, completed);
+    check_cm.calcprogress(pos, check_chunkpos, check_completed);
+    ASSERT_EQ(check_chunkpos, chunkpos);
+    ASSERT_EQ(check_completed, completed);
+
+    // truncated data is rejected
+    ptr = d.data();
+    ASSERT_FALSE(mega::chunkmac_map().unserialize(ptr, d.data() + d.size() - 10));
+}
+
 
 namespace {
 
@@ -298,6 +374,42 @@ TEST(Serialization, Node_whenTypeIsUnsupported)
     ASSERT_FALSE(n.serialize(&data));
 }
 
+TEST(Serialization, NodeData_readsHeaderWithoutDecodingTheRest)
+{
+    MockClient client;
+    auto& parent = mt::makeNode(*client.cli, mega::FOLDERNODE, ::mega::NodeHandle().set6byte(43));
+    std::unique_ptr<mega::Node> n{&mt::makeNode(*client.cli, mega::FILENODE, ::mega::NodeHandle().set6byte(42), &parent)};
+    n->size = 12;
+    n->owner = 88;
+    n->ctime = 44;
+    n->attrs.map = std::map<mega::nameid, std::string>{
+        {101, "foo"},
+        {102, "bar"},
+    };
+    std::string data;
+    ASSERT_TRUE(n->serialize(&data));
+
+    // size/type, handle, parent handle, owner and two timestamps
+    constexpr size_t headerSize = sizeof(m_off_t) + 6 + 6 + 8 + 2 * sizeof(time_t);
+
+    // drop everything after the header: only the header getters must keep working
+    std::string truncated = data.substr(0, headerSize);
+    for (const std::string* blob : {&data, &truncated})
+    {
+        mega::NodeData nd(blob->data(), blob->size(), mega::NodeData::COMPONENT_NONE);
+        ASSERT_EQ(nd.getType(), mega::FILENODE);
+        ASSERT_EQ(nd.getSize(), 12);
+        ASSERT_EQ(nd.getParentHandle(), 43u);
+        ASSERT_EQ(nd.getOwner(), 88u);
+        ASSERT_EQ(nd.getCtime(), 44);
+        ASSERT_EQ(nd.getHandle(), blob == &data ? 42u : mega::UNDEF);
+    }
+
+    mega::NodeData tooShort(data.data(), headerSize - 1, mega::NodeData::COMPONENT_NONE);
+    ASSERT_EQ(tooShort.getType(), mega::TYPE_UNKNOWN);
+    ASSERT_EQ(tooShort.getParentHandle(), mega::UNDEF);
+}
+
 TEST(Serialization, Node_forFile_withoutParent_withoutShares_withoutAttrs_withoutFileAttrString_withoutPlink)
 {
     MockClient client;
@@ -18,7 +18,14 @@
 
 #include <gtest/gtest.h>
 
+#include <mega/base64.h>
+#include <mega/command.h>
+#include <mega/megaapp.h>
+#include <mega/megaclient.h>
 #include <mega/share.h>
+#include <mega/sharenodekeys.h>
+
+#include "utils.h"
 
 void checkNewShares(const mega::NewShare& exp, const mega::NewShare& act)
 {
@@ -69,3 +76,50 @@ TEST(Share, unserialize_32bit)
     const mega::NewShare expectedNewShare{100, -1, 42, mega::RDONLY, 13, key, NULL, 123};
     checkNewShares(expectedNewShare, *newShare);
 }
+
+namespace {
+
+struct CrCommand : public mega::Command
+{
+    bool procresult(Result, mega::JSON&) override { return true; }
+};
+
+} // namespace
+
+TEST(Share, ShareNodeKeys_EncryptedPerShare)
+{
+    mega::MegaApp app;
+    auto client = mt::makeClient(app);
+
+    std::vector<std::shared_ptr<mega::Node>> shares;
+    for (unsigned i = 0; i < 2; i++)
+    {
+        mega::NodeHandle handle = mega::NodeHandle().set6byte(i + 1);
+        mt::makeNode(*client, mega::FOLDERNODE, handle);
+        shares.push_back(client->nodeByHandle(handle));
+        shares.back()->sharekey.reset(new mega::SymmCipher(reinterpret_cast<const mega::byte*>(std::string(mega::SymmCipher::KEYLENGTH, char('a' + i)).data())));
+    }
+
+    // the keys of both shares are interleaved, and of both lengths
+    mega::ShareNodeKeys snk;
+    std::vector<std::string> expected;
+    for (unsigned i = 0; i < 6; i++)
+    {
+        std::string nodekey(i % 3 ? mega::FILENODEKEYLENGTH : mega::FOLDERNODEKEYLENGTH, char('0' + i));
+        unsigned share = i % 2;
+        snk.add(nodekey, mega::handle(100 + i), shares[share], false);
+
+        std::string encrypted(nodekey.size(), '\0');
+        shares[share]->sharekey->ecb_encrypt((mega::byte*)nodekey.data(), (mega::byte*)&encrypted[0], nodekey.size());
+        expected.push_back(std::to_string(share) + "," + std::to_string(i) + ",\"" + mega::Base64::btoa(encrypted) + "\"");
+    }
+
+    CrCommand command;
+    snk.get(&command);
+    std::string json = command.getJSON(client.get());
+
+    for (const std::string& key : expected)
+    {
+        ASSERT_NE(json.find(key), std::string::npos) << key << " not in " << json;
+    }
+}
@@ -0,0 +1,113 @@
+#include "gtest/gtest.h"
+#include "mega/gfx/worker/shared_image_ring.h"
+#include "mega/utils.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using mega::gfx::GfxSharedImages;
+using mega::gfx::SharedImageRing;
+
+namespace
+{
+
+std::string ringName()
+{
+    static unsigned instances = 0;
+    std::ostringstream oss;
+    oss << "megagfx_test_" << mega::getCurrentPid() << "_" << ++instances;
+    return oss.str();
+}
+
+}
+
+TEST(SharedImageRing, WriteAndRead)
+{
+    auto ring = SharedImageRing::create(ringName(), 1024 * 1024);
+    ASSERT_NE(ring, nullptr);
+
+    std::vector<std::string> images{ std::string(300000, 'p'), std::string(4500, 't'), std::string() };
+    GfxSharedImages location = ring->write(images);
+    ASSERT_FALSE(location.Name.empty());
+    ASSERT_EQ(location.Sizes, (std::vector<uint32_t>{ 300000, 4500, 0 }));
+
+    std::vector<std::string> read;
+    ASSERT_TRUE(SharedImageRing::read(location, read));
+    ASSERT_EQ(read, images);
+
+    // it's been freed by the read
+    ASSERT_FALSE(SharedImageRing::read(location, read));
+}
+
+TEST(SharedImageRing, FullRingIsReusedOnceRead)
+{
+    auto ring = SharedImageRing::create(ringName(), 1024 * 1024);
+    ASSERT_NE(ring, nullptr);
+
+    // room for 3 of them
+    std::vector<std::string> images{ std::string(300000, 'a') };
+    std::vector<GfxSharedImages> locations;
+    for (char c = 'a'; c < 'd'; ++c)
+    {
+        images[0].assign(300000, c);
+        locations.push_back(ring->write(images));
+        ASSERT_FALSE(locations.back().Name.empty());
+    }
+
+    // the images go inline then
+    ASSERT_TRUE(ring->write(images).Name.empty());
+
+    // a freed region is reused, wrapping around the end
+    std::vector<std::string> read;
+    ASSERT_TRUE(SharedImageRing::read(locations[0], read));
+    ASSERT_EQ(read[0], std::string(300000, 'a'));
+
+    images[0].assign(300000, 'd');
+    GfxSharedImages reused = ring->write(images);
+    ASSERT_FALSE(reused.Name.empty());
+    ASSERT_EQ(reused.Offset, locations[0].Offset);
+
+    // the others are still there
+    for (size_t i = 1; i < locations.size(); ++i)
+    {
+        ASSERT_TRUE(SharedImageRing::read(locations[i], read));
+        ASSERT_EQ(read[0], std::string(300000, static_cast<char>('a' + i)));
+    }
+    ASSERT_TRUE(SharedImageRing::read(reused, read));
+    ASSERT_EQ(read[0], std::string(300000, 'd'));
+
+    // and the whole ring once it's empty
+    images[0].assign(ring->capacity() - 1024, 'e');
+    ASSERT_FALSE(ring->write(images).Name.empty());
+}
+
+TEST(SharedImageRing, InvalidLocationsAreRejected)
+{
+    auto ring = SharedImageRing::create(ringName(), 64 * 1024);
+    ASSERT_NE(ring, nullptr);
+
+    // bigger than the ring
+    std::vector<std::string> images{ std::string(128 * 1024, 'x') };
+    ASSERT_TRUE(ring->write(images).Name.empty());
+
+    images[0].resize(1000);
+    GfxSharedImages location = ring->write(images);
+    ASSERT_FALSE(location.Name.empty());
+
+    std::vector<std::string> read;
+    GfxSharedImages wrong = location;
+    wrong.Generation++;
+    ASSERT_FALSE(SharedImageRing::read(wrong, read));
+
+    wrong = location;
+    wrong.Sizes[0] = 64 * 1024;
+    ASSERT_FALSE(SharedImageRing::read(wrong, read));
+
+    wrong = location;
+    wrong.Name += "_missing";
+    ASSERT_FALSE(SharedImageRing::read(wrong, read));
+
+    ASSERT_TRUE(SharedImageRing::read(location, read));
+    ASSERT_EQ(read, images);
+}
@@ -86,4 +86,251 @@ TEST(Transfer, serialize_unserialize)
     checkTransfers(tf, *newTf);
 }
 
+TEST(Transfer, CachedChunkMacsAreUnserializedOnDemand)
+{
+    mega::MegaApp app;
+    auto client = mt::makeClient(app);
+
+    mega::Transfer tf{client.get(), mega::PUT};
+    tf.localfilename = ::mega::LocalPath::fromAbsolutePath("foo");
+    tf.size = 1024;
+    tf.isvalid = true;
+
+    std::string d;
+    ASSERT_TRUE(tf.serialize(&d));
+
+    mega::transfer_multimap tfMap[2];
+    auto newTf = std::unique_ptr<mega::Transfer>{mega::Transfer::unserialize(client.get(), &d, tfMap)};
+    ASSERT_TRUE(newTf);
+    ASSERT_FALSE(newTf->mCachedChunkmacs.empty());
+
+    // a cached transfer serializes the same without being materialized
+    std::string cached;
+    ASSERT_TRUE(newTf->serialize(&cached));
+    ASSERT_EQ(cached, d);
+
+    ASSERT_TRUE(newTf->materialize());
+    ASSERT_TRUE(newTf->mCachedChunkmacs.empty());
+    ASSERT_EQ(newTf->pos, 0);
+
+    std::string materialized;
+    ASSERT_TRUE(newTf->serialize(&materialized));
+    ASSERT_EQ(materialized, d);
+
+    // a truncated record isn't taken for one with chunk MACs
+    std::string truncated = d.substr(0, d.size() / 2);
+    ASSERT_FALSE(mega::Transfer::unserialize(client.get(), &truncated, tfMap));
+}
+
+
+
+TEST(Transfer, ConnectionControllerProbesWhileThroughputImproves)
+{
+    using mega::TransferConnectionController;
+
+    const m_off_t MB = 1024 * 1024;
+    TransferConnectionController controller(3, 6, 16 * MB, 2 * MB, 16 * MB);
+    ASSERT_EQ(controller.connections(), 3u);
+
+    // every extra connection adds throughput: keep probing up to the maximum
+    m_off_t bytes = 10 * MB;
+    for (int i = 0; i < 10; ++i)
+    {
+        controller.sample(bytes, 0, 50, true);
+        bytes += 5 * MB;
+    }
+    ASSERT_EQ(controller.connections(), 6u);
+}
+
+TEST(Transfer, ConnectionControllerGivesBackUselessConnections)
+{
+    using mega::TransferConnectionController;
+
+    const m_off_t MB = 1024 * 1024;
+    TransferConnectionController controller(3, 6, 16 * MB, 2 * MB, 16 * MB);
+
+    // a saturated link: the probed connection is given back, and not retried for a while
+    controller.sample(10 * MB, 0, 50, true);
+    ASSERT_EQ(controller.connections(), 4u);
+    controller.sample(10 * MB, 0, 50, true);
+    ASSERT_EQ(controller.connections(), 3u);
+
+    for (unsigned i = 0; i < TransferConnectionController::HOLD_SAMPLES; ++i)
+    {
+        controller.sample(10 * MB, 0, 50, true);
+        ASSERT_EQ(controller.connections(), 3u);
+    }
+
+    controller.sample(10 * MB, 0, 50, true);
+    ASSERT_EQ(controller.connections(), 4u);
+
+    // no probing beyond the global limit
+    TransferConnectionController capped(3, 6, 16 * MB, 2 * MB, 16 * MB);
+    capped.sample(10 * MB, 0, 50, false);
+    ASSERT_EQ(capped.connections(), 3u);
+}
+
+TEST(Transfer, ConnectionControllerBacksOffOnErrors)
+{
+    using mega::TransferConnectionController;
+
+    const m_off_t MB = 1024 * 1024;
+    TransferConnectionController controller(6, 6, 16 * MB, 2 * MB, 16 * MB);
+
+    controller.sample(10 * MB, 1, 50, true);
+    ASSERT_EQ(controller.connections(), 3u);
+    ASSERT_EQ(controller.requestSize(), 8 * MB);
+
+    controller.sample(0, 2, 0, true);
+    controller.sample(0, 1, 0, true);
+    ASSERT_EQ(controller.connections(), 1u);
+    ASSERT_EQ(controller.requestSize(), 2 * MB);
+}
+
+TEST(Transfer, ConnectionControllerSizesRequestsByDuration)
+{
+    using mega::TransferConnectionController;
+
+    const m_off_t MB = 1024 * 1024;
+    TransferConnectionController controller(3, 3, 4 * MB, 2 * MB, 16 * MB);
+
+    // requests finishing quickly are latency bound: make them larger
+    controller.sample(10 * MB, 0, TransferConnectionController::SHORT_REQUEST_DS - 1, true);
+    ASSERT_EQ(controller.requestSize(), 8 * MB);
+    controller.sample(10 * MB, 0, TransferConnectionController::SHORT_REQUEST_DS - 1, true);
+    controller.sample(10 * MB, 0, TransferConnectionController::SHORT_REQUEST_DS - 1, true);
+    ASSERT_EQ(controller.requestSize(), 16 * MB);
+
+    // no requests finished: no change
+    controller.sample(10 * MB, 0, 0, true);
+    ASSERT_EQ(controller.requestSize(), 16 * MB);
 
+    controller.sample(10 * MB, 0, TransferConnectionController::LONG_REQUEST_DS + 1, true);
+    ASSERT_EQ(controller.requestSize(), 8 * MB);
+}
+
+TEST(Transfer, TinyUploadsShareTransferSlots)
+{
+    mega::MegaApp app;
+    auto client = mt::makeClient(app);
+
+    mega::Transfer upload{client.get(), mega::PUT};
+    upload.size = mega::MegaClient::MAX_TINY_UPLOAD_SIZE - 1;
+    ASSERT_DOUBLE_EQ(mega::MegaClient::transferSlotWeight(&upload), 1.0 / mega::MegaClient::TINY_UPLOADS_PER_SLOT);
+
+    upload.size = mega::MegaClient::MAX_TINY_UPLOAD_SIZE;
+    ASSERT_DOUBLE_EQ(mega::MegaClient::transferSlotWeight(&upload), 1.0);
+
+    // downloads of tiny files are not affected
+    mega::Transfer download{client.get(), mega::GET};
+    download.size = 1024;
+    ASSERT_DOUBLE_EQ(mega::MegaClient::transferSlotWeight(&download), 1.0);
+}
+
+TEST(Transfer, DirectReadCacheEvictsLeastRecentlyUsedChunks)
+{
+    using mega::DirectReadCache;
+
+    const size_t CHUNK = static_cast<size_t>(DirectReadCache::CHUNK_SIZE);
+    DirectReadCache cache;
+    cache.setMaxSize(2 * CHUNK);
+
+    cache.add(1, 2, 0, std::string(CHUNK, 'a'));
+    cache.add(1, 2, DirectReadCache::CHUNK_SIZE, std::string(CHUNK, 'b'));
+    ASSERT_EQ(cache.size(), 2 * CHUNK);
+
+    // any position inside a chunk finds it, but only for the same file and key
+    const std::string* chunk = cache.find(1, 2, DirectReadCache::CHUNK_SIZE + 10);
+    ASSERT_NE(chunk, nullptr);
+    ASSERT_EQ(chunk->front(), 'b');
+    ASSERT_EQ(cache.find(1, 3, 0), nullptr);
+    ASSERT_EQ(cache.find(2, 2, 0), nullptr);
+
+    // the first chunk is now the least recently used one
+    cache.add(1, 2, 2 * DirectReadCache::CHUNK_SIZE, std::string(10, 'c'));
+    ASSERT_EQ(cache.find(1, 2, 0), nullptr);
+    ASSERT_NE(cache.find(1, 2, DirectReadCache::CHUNK_SIZE), nullptr);
+    ASSERT_EQ(cache.size(), CHUNK + 10);
+
+    cache.setMaxSize(0);
+    ASSERT_EQ(cache.size(), 0u);
+    ASSERT_EQ(cache.find(1, 2, 2 * DirectReadCache::CHUNK_SIZE), nullptr);
+}
+
+TEST(Transfer, DirectReadAheadFollowsAccessPatterns)
+{
+    using mega::DirectReadAhead;
+    using mega::DirectReadCache;
+    using mega::Waiter;
+
+    mega::MegaApp app;
+    auto client = mt::makeClient(app);
+
+    mega::SymmCipher key;
+    client->queueread(1, true, &key, 0, 0, 1, &app);
+    ASSERT_EQ(client->hdrns.size(), 1u);
+
+    mega::DirectReadNode* drn = client->hdrns.begin()->second;
+    drn->size = 64 * DirectReadCache::CHUNK_SIZE;
+
+    auto prefetch = [drn]() -> mega::DirectRead*
+    {
+        for (auto* dr : drn->reads)
+        {
+            if (dr->listener == &drn->readahead) return dr;
+        }
+        return nullptr;
+    };
+
+    // the end of the file is read first: the start comes next
+    Waiter::ds += DirectReadAhead::SCRUB_INTERVAL_DS + 1;
+    drn->readahead.requested(drn->size - DirectReadCache::CHUNK_SIZE, DirectReadCache::CHUNK_SIZE);
+    ASSERT_EQ(drn->readahead.pattern(), DirectReadAhead::PATTERN_TAIL_FIRST);
+    ASSERT_NE(prefetch(), nullptr);
+    ASSERT_EQ(prefetch()->offset, 0);
+
+    // the app asking for the prefetched range takes over
+    Waiter::ds += DirectReadAhead::SCRUB_INTERVAL_DS + 1;
+    drn->readahead.requested(0, 2 * DirectReadCache::CHUNK_SIZE);
+    ASSERT_EQ(prefetch(), nullptr);
+
+    // bounded sequential reads are followed by the next range
+    Waiter::ds += DirectReadAhead::SCRUB_INTERVAL_DS + 1;
+    drn->readahead.requested(2 * DirectReadCache::CHUNK_SIZE, 2 * DirectReadCache::CHUNK_SIZE);
+    ASSERT_EQ(drn->readahead.pattern(), DirectReadAhead::PATTERN_SEQUENTIAL);
+    ASSERT_NE(prefetch(), nullptr);
+    ASSERT_EQ(prefetch()->offset, 4 * DirectReadCache::CHUNK_SIZE);
+    ASSERT_EQ(prefetch()->count, 2 * DirectReadCache::CHUNK_SIZE);
+
+    // quick seeks around the file
+    drn->readahead.requested(20 * DirectReadCache::CHUNK_SIZE, DirectReadCache::CHUNK_SIZE);
+    drn->readahead.requested(40 * DirectReadCache::CHUNK_SIZE, DirectReadCache::CHUNK_SIZE);
+    ASSERT_EQ(drn->readahead.pattern(), DirectReadAhead::PATTERN_SCRUBBING);
+}
+
+TEST(Transfer, BufferBudgetAppliesBackPressure)
+{
+    using mega::TransferBufferBudget;
+
+    const m_off_t MB = 1024 * 1024;
+    TransferBufferBudget budget;
+
+    // no limit by default
+    ASSERT_TRUE(budget.acquire(100 * MB, false));
+    budget.release(100 * MB);
+    ASSERT_EQ(budget.used(), 0);
+
+    budget.setLimit(16 * MB);
+    ASSERT_TRUE(budget.acquire(8 * MB, false));
+    ASSERT_TRUE(budget.acquire(8 * MB, false));
+    ASSERT_FALSE(budget.acquire(MB, false));
+
+    // the first request of a transfer is always granted, even beyond the limit
+    ASSERT_TRUE(budget.acquire(8 * MB, true));
+    ASSERT_EQ(budget.used(), 24 * MB);
+
+    budget.release(8 * MB);
+    budget.release(8 * MB);
+    ASSERT_TRUE(budget.acquire(8 * MB, false));
+    ASSERT_EQ(budget.used(), 16 * MB);
+}
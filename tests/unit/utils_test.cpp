@@ -17,10 +17,13 @@
  */
 
 #include <array>
+#include <atomic>
+#include <thread>
 #include <tuple>
 
 #include <gtest/gtest.h>
 
+#include <mega/backofftimer.h>
 #include <mega/base64.h>
 #include <mega/filesystem.h>
 #include <mega/utils.h>
@@ -594,6 +597,255 @@ TEST(Filesystem, isContainingPathOf)
 #undef SEP
 }
 
+TEST(Filesystem, AsyncWriteAndRead)
+{
+    using namespace mega;
+
+    FSACCESS_CLASS fsAccess;
+    WAIT_CLASS waiter;
+    fsAccess.waiter = &waiter;
+
+    if (!fsAccess.newfileaccess(false)->asyncavailable())
+    {
+        GTEST_SKIP() << "Async file operations not available";
+    }
+
+    LocalPath path;
+    ASSERT_TRUE(fsAccess.cwd(path));
+    path.appendWithSeparator(LocalPath::fromRelativePath("async_io_test.bin"), false);
+
+    // more operations than fit in the submission queue at once
+    static constexpr unsigned NUM_BLOCKS = 600;
+    static constexpr unsigned BLOCK_SIZE = 8192;
+    static constexpr unsigned PAD = 13;
+
+    {
+        auto fa = fsAccess.newfileaccess(false);
+        ASSERT_TRUE(fa->fopen(path, false, true, FSLogging::logOnError));
+
+        vector<string> blocks(NUM_BLOCKS);
+        vector<unique_ptr<AsyncIOContext>> contexts;
+        for (unsigned i = 0; i < NUM_BLOCKS; ++i)
+        {
+            blocks[i].assign(BLOCK_SIZE, static_cast<char>(i));
+            contexts.emplace_back(fa->asyncfwrite(reinterpret_cast<const ::mega::byte*>(blocks[i].data()), BLOCK_SIZE, m_off_t(i) * BLOCK_SIZE));
+        }
+
+        for (auto& context : contexts)
+        {
+            context->finish();
+            ASSERT_FALSE(context->failed);
+        }
+    }
+
+    {
+        auto fa = fsAccess.newfileaccess(false);
+        ASSERT_TRUE(fa->fopen(path, true, false, FSLogging::logOnError));
+
+        vector<string> blocks(NUM_BLOCKS);
+        vector<unique_ptr<AsyncIOContext>> contexts;
+        for (unsigned i = 0; i < NUM_BLOCKS; ++i)
+        {
+            // read backwards, the data must match the position anyway
+            unsigned blockNum = NUM_BLOCKS - 1 - i;
+            contexts.emplace_back(fa->asyncfread(&blocks[i], BLOCK_SIZE, PAD, m_off_t(blockNum) * BLOCK_SIZE, FSLogging::logOnError));
+        }
+
+        for (unsigned i = 0; i < NUM_BLOCKS; ++i)
+        {
+            contexts[i]->finish();
+            ASSERT_FALSE(contexts[i]->failed);
+
+            unsigned blockNum = NUM_BLOCKS - 1 - i;
+            ASSERT_EQ(blocks[i].size(), BLOCK_SIZE + PAD);
+            ASSERT_EQ(blocks[i].substr(0, BLOCK_SIZE), string(BLOCK_SIZE, static_cast<char>(blockNum)));
+            ASSERT_EQ(blocks[i].substr(BLOCK_SIZE), string(PAD, '\0'));
+        }
+    }
+
+    ASSERT_TRUE(fsAccess.unlinklocal(path));
+}
+
+#ifndef _WIN32
+TEST(Waiter, PersistentFdsOnlyReportReadyOnes)
+{
+    using namespace mega;
+
+    if (!PosixWaiter::persistentfds())
+    {
+        GTEST_SKIP() << "Neither epoll nor kqueue available";
+    }
+
+    PosixWaiter waiter;
+    int ready[2];
+    int idle[2];
+    ASSERT_EQ(pipe(ready), 0);
+    ASSERT_EQ(pipe(idle), 0);
+
+    waiter.watchfd(ready[0], PosixWaiter::WATCH_READ, 1);
+    waiter.watchfd(idle[0], PosixWaiter::WATCH_READ, 1);
+    ASSERT_EQ(write(ready[1], "x", 1), 1);
+
+    // the group is not enabled in this cycle (i.e. paused transfers): nothing is reported
+    waiter.init(1);
+    waiter.wait();
+    ASSERT_FALSE(MEGA_FD_ISSET(ready[0], &waiter.rfds));
+
+    waiter.init(1);
+    waiter.enablegroup(1);
+    ASSERT_TRUE(waiter.wait() & Waiter::NEEDEXEC);
+    ASSERT_TRUE(MEGA_FD_ISSET(ready[0], &waiter.rfds));
+    ASSERT_FALSE(MEGA_FD_ISSET(idle[0], &waiter.rfds));
+
+    // registrations persist across cycles, and per-cycle fds still work alongside them
+    waiter.init(1);
+    waiter.enablegroup(1);
+    MEGA_FD_SET(idle[0], &waiter.rfds);
+    ASSERT_TRUE(waiter.wait() & Waiter::NEEDEXEC);
+    ASSERT_TRUE(MEGA_FD_ISSET(ready[0], &waiter.rfds));
+    ASSERT_FALSE(MEGA_FD_ISSET(idle[0], &waiter.rfds));
+
+    waiter.watchfd(ready[0], 0, 1);
+    waiter.init(1);
+    waiter.enablegroup(1);
+    waiter.wait();
+    ASSERT_FALSE(MEGA_FD_ISSET(ready[0], &waiter.rfds));
+
+    close(ready[0]);
+    close(ready[1]);
+    close(idle[0]);
+    close(idle[1]);
+}
+#endif
+
+TEST(Filesystem, ScanServiceScansFoldersConcurrently)
+{
+    using namespace mega;
+
+    FSACCESS_CLASS fsAccess;
+
+    LocalPath rootPath;
+    ASSERT_TRUE(fsAccess.cwd(rootPath));
+    rootPath.appendWithSeparator(LocalPath::fromRelativePath("scan_service_test"), false);
+    fsAccess.emptydirlocal(rootPath);
+    fsAccess.rmdirlocal(rootPath);
+    ASSERT_TRUE(fsAccess.mkdirlocal(rootPath, false, true));
+
+    // more folders than threads per volume, spread over two volumes
+    static constexpr size_t NUM_FOLDERS = 3 * ScanService::NUM_THREADS_PER_VOLUME;
+    static constexpr size_t NUM_FILES = 20;
+
+    ScanService scanService;
+    auto waiter = std::make_shared<WAIT_CLASS>();
+    vector<ScanService::RequestPtr> requests;
+
+    for (size_t i = 0; i < NUM_FOLDERS; ++i)
+    {
+        LocalPath folderPath = rootPath;
+        folderPath.appendWithSeparator(LocalPath::fromRelativePath("f" + std::to_string(i)), false);
+        ASSERT_TRUE(fsAccess.mkdirlocal(folderPath, false, true));
+
+        for (size_t j = 0; j <= i % NUM_FILES; ++j)
+        {
+            LocalPath filePath = folderPath;
+            filePath.appendWithSeparator(LocalPath::fromRelativePath("file" + std::to_string(j)), false);
+            auto fa = fsAccess.newfileaccess(false);
+            ASSERT_TRUE(fa->fopen(filePath, false, true, FSLogging::logOnError));
+            ASSERT_TRUE(fa->fwrite(reinterpret_cast<const ::mega::byte*>("data"), 4, 0));
+        }
+
+        auto fa = fsAccess.newfileaccess(false);
+        ASSERT_TRUE(fa->fopen(folderPath, FSLogging::logOnError));
+        requests.emplace_back(scanService.queueScan(folderPath, fa->fsid, false, {}, waiter, i % 2));
+    }
+
+    for (size_t i = 0; i < NUM_FOLDERS; ++i)
+    {
+        while (!requests[i]->completed())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        ASSERT_EQ(requests[i]->completionResult(), SCAN_SUCCESS);
+
+        auto results = requests[i]->resultNodes();
+        ASSERT_EQ(results.size(), i % NUM_FILES + 1);
+        for (auto& result : results)
+        {
+            ASSERT_EQ(result.type, FILENODE);
+            ASSERT_EQ(result.fingerprint.size, 4);
+            ASSERT_TRUE(result.fingerprint.isvalid);
+        }
+    }
+
+    fsAccess.emptydirlocal(rootPath);
+    ASSERT_TRUE(fsAccess.rmdirlocal(rootPath));
+}
+
+TEST(Filesystem, ScanServiceFingerprintCacheHonoursRecompute)
+{
+    using namespace mega;
+
+    FSACCESS_CLASS fsAccess;
+
+    LocalPath folderPath;
+    ASSERT_TRUE(fsAccess.cwd(folderPath));
+    folderPath.appendWithSeparator(LocalPath::fromRelativePath("scan_cache_test"), false);
+    fsAccess.emptydirlocal(folderPath);
+    fsAccess.rmdirlocal(folderPath);
+    ASSERT_TRUE(fsAccess.mkdirlocal(folderPath, false, true));
+
+    auto fileName = LocalPath::fromRelativePath("file");
+    LocalPath filePath = folderPath;
+    filePath.appendWithSeparator(fileName, false);
+
+    auto write = [&](const char* data) {
+        auto fa = fsAccess.newfileaccess(false);
+        return fa->fopen(filePath, false, true, FSLogging::logOnError)
+               && fa->fwrite(reinterpret_cast<const ::mega::byte*>(data), 4, 0);
+    };
+
+    ScanService scanService;
+    auto waiter = std::make_shared<WAIT_CLASS>();
+
+    auto scan = [&](std::set<LocalPath>&& recompute) {
+        auto fa = fsAccess.newfileaccess(false);
+        EXPECT_TRUE(fa->fopen(folderPath, FSLogging::logOnError));
+
+        // the cache is only used for known volumes
+        auto request = scanService.queueScan(folderPath, fa->fsid, false, {}, waiter, 1, std::move(recompute));
+        while (!request->completed())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        EXPECT_EQ(request->completionResult(), SCAN_SUCCESS);
+
+        auto results = request->resultNodes();
+        EXPECT_EQ(results.size(), 1u);
+        return results.empty() ? FileFingerprint() : results.front().fingerprint;
+    };
+
+    ASSERT_TRUE(write("aaaa"));
+    auto original = scan({});
+    ASSERT_TRUE(original.isvalid);
+
+    // same size and mtime, different content
+    ASSERT_TRUE(write("bbbb"));
+    ASSERT_TRUE(fsAccess.setmtimelocal(filePath, original.mtime));
+
+    // nothing told the scan the file changed: the cached fingerprint is reused
+    ASSERT_TRUE(scan({}) == original);
+
+    // a notified change reads the file again
+    auto recomputed = scan({fileName});
+    ASSERT_TRUE(recomputed.isvalid);
+    ASSERT_NE(recomputed.crc, original.crc);
+
+    fsAccess.emptydirlocal(folderPath);
+    ASSERT_TRUE(fsAccess.rmdirlocal(folderPath));
+}
+
 class SqliteDBTest
   : public ::testing::Test
 {
@@ -725,6 +977,223 @@ TEST_F(SqliteDBTest, ProbeNone)
     EXPECT_FALSE(dbAccess.probe(fsAccess, name));
 }
 
+TEST_F(SqliteDBTest, ChatGrants)
+{
+    SqliteDbAccess dbAccess(rootPath);
+    DbTablePtr dbTable(dbAccess.openTableWithNodes(rng, fsAccess, name, 0, nullptr));
+    ASSERT_TRUE(!!dbTable);
+
+    auto table = dynamic_cast<DBTableNodes*>(dbTable.get());
+    ASSERT_TRUE(table && table->hasChatGrants());
+
+    auto grantsOf = [table](handle chatid)
+    {
+        std::vector<ChatGrant> grants;
+        EXPECT_TRUE(table->getChatGrants(chatid, grants));
+        std::set<std::pair<handle, handle>> result;
+        for (auto& grant : grants)
+        {
+            result.emplace(grant.node, grant.user);
+        }
+        return result;
+    };
+
+    // grants and revocations are applied in order, and per chat
+    ASSERT_TRUE(table->putChatGrants(1, {{10, 100, false}, {10, 101, false}, {11, 100, false}}, false));
+    ASSERT_TRUE(table->putChatGrants(2, {{10, 100, false}}, false));
+    ASSERT_TRUE(table->putChatGrants(1, {{10, 101, true}, {12, 102, false}, {12, 102, false}}, false));
+
+    using Grants = std::set<std::pair<handle, handle>>;
+    EXPECT_EQ(grantsOf(1), (Grants{{10, 100}, {11, 100}, {12, 102}}));
+    EXPECT_EQ(grantsOf(2), (Grants{{10, 100}}));
+    EXPECT_TRUE(grantsOf(3).empty());
+
+    // replaced
+    ASSERT_TRUE(table->putChatGrants(1, {{13, 103, false}}, true));
+    EXPECT_EQ(grantsOf(1), (Grants{{13, 103}}));
+    EXPECT_EQ(grantsOf(2), (Grants{{10, 100}}));
+
+    // gone with the rest of the cache
+    dbTable->truncate();
+    EXPECT_TRUE(grantsOf(1).empty());
+    EXPECT_TRUE(grantsOf(2).empty());
+}
+
+
+TEST(MegaClientAsyncQueue, PrioritiesAndBatches)
+{
+    using namespace mega;
+
+    WAIT_CLASS waiter;
+    auto queue = std::make_unique<MegaClientAsyncQueue>(waiter, 1);
+
+    // keep the only worker busy while the rest are queued
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool started = false;
+    bool release = false;
+    std::vector<int> order;
+
+    queue->push([&](SymmCipher&)
+    {
+        std::unique_lock<std::mutex> g(mutex);
+        started = true;
+        cv.notify_all();
+        cv.wait(g, [&]() { return release; });
+    }, false);
+
+    {
+        std::unique_lock<std::mutex> g(mutex);
+        cv.wait(g, [&]() { return started; });
+    }
+
+    auto record = [&](int n)
+    {
+        return [&, n](SymmCipher&)
+        {
+            std::lock_guard<std::mutex> g(mutex);
+            order.push_back(n);
+        };
+    };
+    queue->push(record(3), false, MegaClientAsyncQueue::BACKGROUND);
+    queue->push(record(2), false, MegaClientAsyncQueue::TRANSFER);
+    queue->push(record(4), true, MegaClientAsyncQueue::TRANSFER);
+    queue->push(record(1), false, MegaClientAsyncQueue::INTERACTIVE);
+    queue->clearDiscardable();
+
+    {
+        std::lock_guard<std::mutex> g(mutex);
+        release = true;
+    }
+    cv.notify_all();
+
+    // the batches wait for the operations queued before them at their priority only
+    std::vector<size_t> items(1000);
+    queue->runBatches(items.size(), 64, [&items](size_t begin, size_t end, SymmCipher&)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            items[i] = i + 1;
+        }
+    });
+
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        ASSERT_EQ(items[i], i + 1);
+    }
+
+    // the queued operations are done before the threads exit
+    queue.reset();
+    ASSERT_EQ(order, (std::vector<int>{ 1, 2, 3 }));
+}
+
+TEST(MegaClientAsyncQueue, BatchesWithoutFreeWorkers)
+{
+    using namespace mega;
+
+    WAIT_CLASS waiter;
+    MegaClientAsyncQueue queue(waiter, 1);
+
+    // the only worker waits for the batches to be done, as a job waiting for a lock held by the caller would
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool started = false;
+    bool release = false;
+    queue.push([&](SymmCipher&)
+    {
+        std::unique_lock<std::mutex> g(mutex);
+        started = true;
+        cv.notify_all();
+        cv.wait(g, [&]() { return release; });
+    }, false, MegaClientAsyncQueue::BACKGROUND);
+
+    {
+        std::unique_lock<std::mutex> g(mutex);
+        cv.wait(g, [&]() { return started; });
+    }
+
+    std::vector<size_t> items(1000);
+    queue.runBatches(items.size(), 64, [&items](size_t begin, size_t end, SymmCipher&)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            items[i] = i + 1;
+        }
+    });
+
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        ASSERT_EQ(items[i], i + 1);
+    }
+
+    // nothing to do
+    queue.runBatches(0, 64, [](size_t, size_t, SymmCipher&) { FAIL(); });
+
+    {
+        std::lock_guard<std::mutex> g(mutex);
+        release = true;
+    }
+    cv.notify_all();
+}
+
+TEST(DbCommitLatency, Percentiles)
+{
+    using std::chrono::microseconds;
+
+    mega::DbCommitLatency latency;
+    EXPECT_EQ(latency.numCommits(), 0u);
+    EXPECT_EQ(latency.percentile(50), microseconds(0));
+
+    // 90 fast commits and 10 slow ones (ie. waiting for fsync)
+    for (int i = 0; i < 90; ++i)
+    {
+        latency.add(microseconds(100));
+    }
+    for (int i = 0; i < 10; ++i)
+    {
+        latency.add(microseconds(50000));
+    }
+
+    EXPECT_EQ(latency.numCommits(), 100u);
+
+    // buckets are powers of two: 100 us -> [64, 128), 50 ms -> [32768, 65536)
+    EXPECT_EQ(latency.percentile(50), microseconds(128));
+    EXPECT_EQ(latency.percentile(90), microseconds(128));
+    EXPECT_EQ(latency.percentile(91), microseconds(65536));
+    EXPECT_EQ(latency.percentile(100), microseconds(65536));
+}
+
+TEST(SqliteAccountState, NameIndexQuery)
+{
+    // wildcards split the pattern, and fragments shorter than a trigram are ignored
+    EXPECT_EQ(SqliteAccountState::nameIndexQuery("*foo*"), "\"foo\"");
+    EXPECT_EQ(SqliteAccountState::nameIndexQuery("*ab*"), "");
+    EXPECT_EQ(SqliteAccountState::nameIndexQuery("*na?me.txt*"), "\"me.txt\"");
+    EXPECT_EQ(SqliteAccountState::nameIndexQuery("*abc*def*"), "\"abc\" AND \"def\"");
+
+    // double quotes are escaped
+    EXPECT_EQ(SqliteAccountState::nameIndexQuery("*say \"hi\"*"), "\"say \"\"hi\"\"\"");
+
+    // length is measured in characters
+    EXPECT_EQ(SqliteAccountState::nameIndexQuery("*\xc3\xb1\xc3\xba*"), "");
+    EXPECT_EQ(SqliteAccountState::nameIndexQuery("*\xc3\xb1\xc3\xba" "a*"), "\"\xc3\xb1\xc3\xba" "a\"");
+}
+
+TEST(Utils, FoldCaseUtf8)
+{
+    // tags of the tag index are folded, so they're equal if icuLikeCompare() finds them equal
+    const std::vector<std::string> tags{"tag", "TAG", "Tag", "\xc3\x91and\xc3\xba", "\xc3\xb1AND\xc3\x9a", "tags", "ta"};
+    for (const auto& i : tags)
+    {
+        for (const auto& j : tags)
+        {
+            bool equal = icuLikeCompare(reinterpret_cast<const uint8_t*>(i.c_str()), reinterpret_cast<const uint8_t*>(j.c_str()), ESCAPE_CHARACTER);
+            EXPECT_EQ(foldCaseUtf8(i) == foldCaseUtf8(j), equal) << "'" << i << "' vs '" << j << "'";
+        }
+    }
+
+    EXPECT_EQ(foldCaseUtf8("\xc3\x91and\xc3\xba"), "\xc3\xb1" "and\xc3\xba");
+}
 
 TEST_F(SqliteDBTest, RootPath)
 {
@@ -797,6 +1266,38 @@ TEST(LocalPath, PrependWithSeparator)
     EXPECT_EQ(target.toPath(false), "b" SEP "a");
 }
 
+TEST(LocalPath, AssignFromLeafNames)
+{
+    std::vector<LocalPath> names = {
+        LocalPath::fromRelativePath("leaf"),
+        LocalPath::fromRelativePath(SEP "b"),
+        LocalPath::fromRelativePath("a" SEP),
+        LocalPath::fromRelativePath("c"),
+        LocalPath::fromRelativePath("root"),
+    };
+
+    auto forEachName = [&names](auto&& name)
+    {
+        for (auto& n : names) name(n);
+    };
+
+    // the same path as prepending the names
+    LocalPath expected;
+    for (auto& name : names)
+    {
+        expected.prependWithSeparator(name);
+    }
+
+    LocalPath target = LocalPath::fromRelativePath("something else");
+    target.assignFromLeafNames(forEachName);
+    EXPECT_EQ(target.toPath(false), "root" SEP "c" SEP "a" SEP "b" SEP "leaf");
+    EXPECT_EQ(target, expected);
+
+    names.clear();
+    target.assignFromLeafNames(forEachName);
+    EXPECT_TRUE(target.empty());
+}
+
 #undef SEP
 
 TEST(JSONWriter, arg_stringWithEscapes)
@@ -863,6 +1364,21 @@ TEST(Utils, replace_string)
     ASSERT_EQ(Utils::replace(string("abc"), "", "@"), "abc");
 }
 
+TEST(Utils, isAscii)
+{
+    ASSERT_TRUE(Utils::isAscii(""));
+    ASSERT_TRUE(Utils::isAscii("abc"));
+    ASSERT_TRUE(Utils::isAscii(string("a long name\0with a NUL", 23)));
+    ASSERT_FALSE(Utils::isAscii("\xc3\xa1"));
+    ASSERT_FALSE(Utils::isAscii("a long ascii name, then \xc3\xa1"));
+    ASSERT_FALSE(Utils::isAscii("\xc3\xa1 then a long ascii name"));
+
+    // the ASCII fast path maps the case like the full one
+    ASSERT_EQ(Utils::toUpperUtf8("Some Name.TXT"), "SOME NAME.TXT");
+    ASSERT_EQ(Utils::toLowerUtf8("Some Name.TXT"), "some name.txt");
+    ASSERT_EQ(Utils::toUpperUtf8("\xc3\xa1rbol"), "\xc3\x81RBOL");
+}
+
 TEST(RemotePath, nextPathComponent)
 {
     // Absolute path.
@@ -1303,3 +1819,228 @@ TEST(Split, with_delimiter)
     EXPECT_EQ(result.second.second, 4u);
 }
 
+
+namespace
+{
+
+struct InboxItem
+{
+    int producer = 0;
+    int value = 0;
+    InboxItem* next = nullptr;
+};
+
+using Inbox = mega::MpscInbox<InboxItem, &InboxItem::next>;
+
+} // anonymous
+
+TEST(MpscInbox, PushOrder)
+{
+    Inbox inbox;
+    std::array<InboxItem, 3> items;
+
+    ASSERT_TRUE(inbox.empty());
+    ASSERT_TRUE(inbox.push(&items[0]));
+    ASSERT_FALSE(inbox.push(&items[1]));
+    ASSERT_FALSE(inbox.push(&items[2]));
+    ASSERT_FALSE(inbox.empty());
+
+    std::vector<InboxItem*> drained;
+    inbox.drain([&drained](InboxItem* item) { drained.push_back(item); });
+    ASSERT_EQ(drained, (std::vector<InboxItem*>{ &items[0], &items[1], &items[2] }));
+    ASSERT_TRUE(inbox.empty());
+
+    // items are unlinked, and the next push starts a new batch
+    for (auto& item : items)
+    {
+        ASSERT_EQ(item.next, nullptr);
+    }
+    ASSERT_TRUE(inbox.push(&items[1]));
+}
+
+TEST(MpscInbox, PushRange)
+{
+    Inbox inbox;
+    std::array<InboxItem, 4> items;
+    std::vector<InboxItem*> range{ &items[1], &items[2], &items[3] };
+
+    ASSERT_FALSE(inbox.push(range.begin(), range.begin()));
+    ASSERT_TRUE(inbox.empty());
+
+    // the range is drained after the element pushed before, in its own order
+    ASSERT_TRUE(inbox.push(&items[0]));
+    ASSERT_FALSE(inbox.push(range.begin(), range.end()));
+
+    std::vector<InboxItem*> drained;
+    inbox.drain([&drained](InboxItem* item) { drained.push_back(item); });
+    ASSERT_EQ(drained, (std::vector<InboxItem*>{ &items[0], &items[1], &items[2], &items[3] }));
+
+    ASSERT_TRUE(inbox.push(range.begin(), range.end()));
+}
+
+TEST(MpscInbox, ConcurrentProducers)
+{
+    static constexpr int PRODUCERS = 4;
+    static constexpr int ITEMS = 10000;
+
+    Inbox inbox;
+    std::vector<InboxItem> items(PRODUCERS * ITEMS);
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; p++)
+    {
+        producers.emplace_back([&, p]()
+        {
+            for (int i = 0; i < ITEMS; i++)
+            {
+                InboxItem& item = items[p * ITEMS + i];
+                item.producer = p;
+                item.value = i;
+                inbox.push(&item);
+            }
+        });
+    }
+
+    // the consumer drains while the producers push: every producer's items arrive in order
+    std::array<int, PRODUCERS> expected{};
+    int received = 0;
+    auto consume = [&](InboxItem* item)
+    {
+        ASSERT_EQ(item->value, expected[item->producer]);
+        expected[item->producer]++;
+        received++;
+    };
+
+    while (received < PRODUCERS * ITEMS)
+    {
+        inbox.drain(consume);
+    }
+
+    for (auto& t : producers)
+    {
+        t.join();
+    }
+
+    ASSERT_TRUE(inbox.empty());
+}
+
+TEST(CancelToken, CancelledSince)
+{
+    uint32_t lastKnown = CancelToken::tokensCancelledCount.load();
+    std::vector<const void*> ids;
+    ASSERT_FALSE(CancelToken::haveAnyCancelsOccurredSince(lastKnown, ids));
+
+    CancelToken a(false), b(false), c(false);
+    a.cancel();
+    c.cancel();
+    ASSERT_TRUE(CancelToken::haveAnyCancelsOccurredSince(lastKnown, ids));
+    ASSERT_EQ(ids, (std::vector<const void*>{ a.id(), c.id() }));
+    ASSERT_FALSE(CancelToken::haveAnyCancelsOccurredSince(lastKnown, ids));
+
+    // tokens created already cancelled could be assigned to anything
+    b.cancel();
+    CancelToken cancelled(true);
+    ASSERT_TRUE(CancelToken::haveAnyCancelsOccurredSince(lastKnown, ids));
+    ASSERT_TRUE(ids.empty());
+
+    // and so could any of the tokens, after too many cancels
+    for (int i = 0; i < 2000; i++)
+    {
+        CancelToken(false).cancel();
+    }
+    ASSERT_TRUE(CancelToken::haveAnyCancelsOccurredSince(lastKnown, ids));
+    ASSERT_TRUE(ids.empty());
+}
+
+TEST(BackoffTimerGroupTracker, SoonestTimeout)
+{
+    PrnGen rng;
+    BackoffTimerGroupTracker tracker;
+    BackoffTimerTracked a(rng, tracker), b(rng, tracker);
+
+    Waiter::bumpds();
+    dstime now = Waiter::ds;
+    a.backoff(50);
+    b.backoff(20);
+
+    // the loop sleeps until the soonest timeout
+    dstime waituntil = NEVER;
+    tracker.update(&waituntil, false);
+    ASSERT_EQ(waituntil, now + 20);
+
+    // and wakes up right away when one of them expired
+    b.set(now);
+    waituntil = NEVER;
+    tracker.update(&waituntil, true);
+    ASSERT_EQ(waituntil, 0);
+    ASSERT_EQ(b.nextset(), 0);
+
+    // expired transfer backoffs fire once
+    waituntil = NEVER;
+    tracker.update(&waituntil, true);
+    ASSERT_EQ(waituntil, now + 50);
+}
+
+TEST(BackoffTimer, DecorrelatedJitter)
+{
+    PrnGen rng;
+    BackoffTimer timer(rng);
+
+    Waiter::bumpds();
+    dstime previous = 1;
+    for (int i = 0; i < 100; ++i)
+    {
+        timer.backoffDecorrelated();
+        dstime delay = timer.retryin();
+
+        // between the minimum and three times the previous one, within the cap
+        ASSERT_GE(delay, 1u);
+        ASSERT_LE(delay, std::min<dstime>(6000, previous * 3));
+        previous = delay;
+    }
+}
+
+TEST(NaturalSorting, KeysSortLikeTheComparison)
+{
+    const std::vector<std::string> names{"",
+                                         "a",
+                                         "A",
+                                         "a1",
+                                         "a01",
+                                         "a2",
+                                         "a10",
+                                         "a1b",
+                                         "a1B",
+                                         "ab",
+                                         "a_b",
+                                         "a b",
+                                         "a\x01",
+                                         "a\x01z",
+                                         "1",
+                                         "9",
+                                         "10",
+                                         "18446744073709551615",
+                                         "18446744073709551616",
+                                         "184467440737095516150",
+                                         "99999999999999999999999999",
+                                         "z",
+                                         "Z10",
+                                         "\xc3\xa9t\xc3\xa9",
+                                         "~"};
+
+    auto sign = [](int value)
+    {
+        return (value > 0) - (value < 0);
+    };
+
+    for (const auto& i : names)
+    {
+        for (const auto& j : names)
+        {
+            std::string keyI = naturalsorting_key(i.c_str());
+            std::string keyJ = naturalsorting_key(j.c_str());
+            ASSERT_EQ(sign(keyI.compare(keyJ)), sign(naturalsorting_compare(i.c_str(), j.c_str())))
+                << "'" << i << "' vs '" << j << "'";
+        }
+    }
+}
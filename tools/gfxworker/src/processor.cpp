@@ -8,10 +8,13 @@
 #include "mega/gfx/worker/comms.h"
 #include "mega/gfx/worker/command_serializer.h"
 #include "mega/logging.h"
+#include "mega/utils.h"
 
+#include <atomic>
 #include <iterator>
 #include <numeric>
 #include <algorithm>
+#include <sstream>
 
 namespace mega {
 namespace gfx {
@@ -56,7 +59,7 @@ GfxTaskResult GfxProcessor::process(const GfxTask& task)
 
     // generate thumbnails
     LOG_info << "generate for, " << path;
-    auto images = mGfxProvider->generateImages(path, sortedDimensions);
+    auto images = generateImages(path, sortedDimensions);
 
     // assign back to original order
     for (int i = 0; i < images.size(); ++i)
@@ -67,6 +70,31 @@ GfxTaskResult GfxProcessor::process(const GfxTask& task)
     return GfxTaskResult(std::move(outputImages), GfxTaskProcessStatus::SUCCESS);
 }
 
+std::vector<std::string> GfxProcessor::generateImages(const LocalPath& path, const std::vector<GfxDimension>& dimensions)
+{
+    std::unique_ptr<IGfxProvider> provider;
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        if (!mIdleProviders.empty())
+        {
+            provider = std::move(mIdleProviders.back());
+            mIdleProviders.pop_back();
+        }
+    }
+
+    if (!provider && !(provider = mGfxProvider->clone()))
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        return mGfxProvider->generateImages(path, dimensions);
+    }
+
+    auto images = provider->generateImages(path, dimensions);
+
+    std::lock_guard<std::mutex> g(mMutex);
+    mIdleProviders.push_back(std::move(provider));
+    return images;
+}
+
 //
 // Put more probmatic format (likely crash) by freeimage here in extraFormatsByWorker
 // note order by length of ext. If we has this order: .tiff.tif, the match with .tif fails
@@ -88,8 +116,34 @@ std::string GfxProcessor::supportedvideoformats() const
 RequestProcessor::RequestProcessor(size_t threadCount,
                                    size_t maxQueueSize)
                                    : mGfxProcessor()
+                                   , mThreadCount(threadCount)
                                    , mThreadPool(threadCount, maxQueueSize)
 {
+    // unique while this process runs, even for several instances
+    static std::atomic<unsigned> instances{0};
+    std::ostringstream name;
+    name << "megagfx_" << getCurrentPid() << "_" << ++instances;
+
+    mImageRing = SharedImageRing::create(name.str());
+    if (!mImageRing)
+    {
+        LOG_warn << "The images are sent in the responses: the shared memory couldn't be created";
+    }
+}
+
+void RequestProcessor::setImages(std::vector<std::string>&& images,
+                                 std::vector<std::string>& inlineImages,
+                                 GfxSharedImages& sharedImages)
+{
+    if (mImageRing)
+    {
+        sharedImages = mImageRing->write(images);
+    }
+
+    if (sharedImages.Name.empty())
+    {
+        inlineImages = std::move(images);
+    }
 }
 
 bool RequestProcessor::process(std::unique_ptr<IEndpoint> endpoint)
@@ -118,6 +172,12 @@ bool RequestProcessor::process(std::unique_ptr<IEndpoint> endpoint)
 
     std::shared_ptr<IEndpoint> sharedEndpoint = std::move(endpoint);
 
+    if (command->type() == CommandType::NEW_GFX_BATCH)
+    {
+        processGfxBatch(sharedEndpoint, std::static_pointer_cast<CommandNewGfxBatch>(command));
+        return stopRunning;
+    }
+
     mThreadPool.push(
         [sharedEndpoint, command, this]() {
             switch (command->type())
@@ -176,7 +236,7 @@ void RequestProcessor::processGfx(IEndpoint* endpoint, CommandNewGfx* request)
     CommandNewGfxResponse response;
     response.ErrorCode = static_cast<uint32_t>(result.ProcessStatus);
     response.ErrorText = result.ProcessStatus == GfxTaskProcessStatus::SUCCESS ? "OK" : "ERROR";
-    response.Images = std::move(result.OutputImages);
+    setImages(std::move(result.OutputImages), response.Images, response.SharedImages);
 
     LOG_info << "gfx result, " << response.ErrorText;
 
@@ -184,6 +244,69 @@ void RequestProcessor::processGfx(IEndpoint* endpoint, CommandNewGfx* request)
     writer.writeCommand(&response, WRITE_TIMEOUT);
 }
 
+void RequestProcessor::processGfxBatch(std::shared_ptr<IEndpoint> endpoint, std::shared_ptr<CommandNewGfxBatch> request)
+{
+    assert(endpoint);
+    assert(request);
+
+    LOG_info << "gfx batch processing, " << request->Tasks.size() << " tasks";
+
+    struct Batch
+    {
+        std::shared_ptr<IEndpoint> endpoint;
+        std::shared_ptr<CommandNewGfxBatch> request;
+        std::atomic<size_t> next{0};
+        std::mutex writeMutex;
+    };
+
+    auto batch = std::make_shared<Batch>();
+    batch->endpoint = std::move(endpoint);
+    batch->request = std::move(request);
+
+    auto writeResult = [batch, this](size_t index, GfxTaskResult&& result)
+    {
+        CommandNewGfxBatchResponse response;
+        response.Index = static_cast<uint32_t>(index);
+        response.ErrorCode = static_cast<uint32_t>(result.ProcessStatus);
+        response.ErrorText = result.ProcessStatus == GfxTaskProcessStatus::SUCCESS ? "OK" : "ERROR";
+        setImages(std::move(result.OutputImages), response.Images, response.SharedImages);
+
+        LOG_info << "gfx batch result " << index << ", " << response.ErrorText;
+
+        std::lock_guard<std::mutex> g(batch->writeMutex);
+        ProtocolWriter writer{ batch->endpoint.get() };
+        writer.writeCommand(&response, WRITE_TIMEOUT);
+    };
+
+    // every thread takes the next task until there are none left
+    auto& tasks = batch->request->Tasks;
+    size_t drainers = 0;
+    for (size_t i = 0; i < std::min(tasks.size(), mThreadCount); ++i)
+    {
+        bool queued = mThreadPool.push(
+            [batch, writeResult, this]() {
+                auto& tasks = batch->request->Tasks;
+                for (size_t index; (index = batch->next++) < tasks.size(); )
+                {
+                    writeResult(index, mGfxProcessor.process(tasks[index]));
+                }
+            });
+
+        if (!queued) break;
+        ++drainers;
+    }
+
+    if (!drainers)
+    {
+        LOG_err << "gfx batch couldn't be queued";
+        for (size_t index = 0; index < tasks.size(); ++index)
+        {
+            writeResult(index, GfxTaskResult(std::vector<std::string>(tasks[index].Dimensions.size()),
+                                             GfxTaskProcessStatus::ERR));
+        }
+    }
+}
+
 void RequestProcessor::processSupportFormats(IEndpoint* endpoint)
 {
     assert(endpoint);
@@ -6,11 +6,13 @@
 #include "mega/gfx/worker/commands.h"
 #include "mega/gfx/freeimage.h"
 #include "mega/gfx/worker/tasks.h"
+#include "mega/gfx/worker/shared_image_ring.h"
 #include "megafs.h"
 
 #include <memory>
 #include <unordered_map>
 #include <mutex>
+#include <vector>
 
 namespace mega {
 namespace gfx {
@@ -20,6 +22,7 @@ class GfxProcessor
 public:
     GfxProcessor();
 
+    // thread safe: each concurrent call uses its own provider
     GfxTaskResult process(const GfxTask& task);
 
     std::string supportedformats() const;
@@ -27,9 +30,17 @@ public:
     std::string supportedvideoformats() const;
 private:
 
+    std::vector<std::string> generateImages(const LocalPath& path, const std::vector<GfxDimension>& dimensions);
+
     mega::FSACCESS_CLASS mFaccess;
 
     std::unique_ptr<::mega::IGfxProvider> mGfxProvider;
+
+    // copies of mGfxProvider not in use by any thread
+    std::vector<std::unique_ptr<::mega::IGfxProvider>> mIdleProviders;
+
+    // protects mIdleProviders, and mGfxProvider if it can't be copied
+    std::mutex mMutex;
 };
 
 class RequestProcessor
@@ -48,10 +59,21 @@ private:
 
     void processGfx(IEndpoint* endpoint, CommandNewGfx* request);
 
+    // the tasks are shared by up to mThreadCount threads, each result is written as soon as it's ready
+    void processGfxBatch(std::shared_ptr<IEndpoint> endpoint, std::shared_ptr<CommandNewGfxBatch> request);
+
     void processSupportFormats(IEndpoint* endpoint);
 
+    // the images go to the shared memory if there is room, otherwise inline in the response
+    void setImages(std::vector<std::string>&& images, std::vector<std::string>& inlineImages, GfxSharedImages& sharedImages);
+
     GfxProcessor mGfxProcessor;
 
+    // for the images of the responses, null if it's not available
+    std::unique_ptr<SharedImageRing> mImageRing;
+
+    size_t mThreadCount;
+
     ThreadPool mThreadPool;
 
     const static TimeoutMs READ_TIMEOUT;
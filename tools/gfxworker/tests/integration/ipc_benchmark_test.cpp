@@ -0,0 +1,123 @@
+#include "mega/gfx/worker/command_serializer.h"
+#include "mega/gfx/worker/commands.h"
+#include "mega/gfx/worker/shared_image_ring.h"
+#include "mega/utils.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(WIN32)
+#include "mega/posix/gfx/worker/comms.h"
+
+#include <sys/socket.h>
+#endif
+
+using mega::gfx::CommandNewGfxResponse;
+using mega::gfx::IEndpoint;
+using mega::gfx::ProtocolReader;
+using mega::gfx::ProtocolWriter;
+using mega::gfx::SharedImageRing;
+using mega::gfx::TimeoutMs;
+
+namespace
+{
+
+constexpr int RESPONSES = 200;
+
+// a preview and a thumbnail
+std::vector<std::string> sampleImages()
+{
+    return { std::string(1024 * 1024, 'p'), std::string(5 * 1024, 't') };
+}
+
+// Sends RESPONSES responses with the sample images from one end to the other, like the worker does,
+// the images inline or in the ring. Returns the MB/s of images received
+double measure(IEndpoint& serverEnd, IEndpoint& clientEnd, SharedImageRing* ring)
+{
+    const auto images = sampleImages();
+    const size_t imagesSize = images[0].size() + images[1].size();
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread server([&serverEnd, &images, ring]()
+    {
+        ProtocolWriter writer(&serverEnd);
+        for (int i = 0; i < RESPONSES; ++i)
+        {
+            CommandNewGfxResponse response;
+            response.ErrorCode = 0;
+            response.ErrorText = "OK";
+            if (ring)
+            {
+                // the ring is big enough for the ones on their way
+                while ((response.SharedImages = ring->write(images)).Name.empty())
+                {
+                    std::this_thread::yield();
+                }
+            }
+            else
+            {
+                response.Images = images;
+            }
+            EXPECT_TRUE(writer.writeCommand(&response, TimeoutMs(5000)));
+        }
+    });
+
+    ProtocolReader reader(&clientEnd);
+    size_t received = 0;
+    for (int i = 0; i < RESPONSES; ++i)
+    {
+        auto command = reader.readCommand(TimeoutMs(5000));
+        auto response = dynamic_cast<CommandNewGfxResponse*>(command.get());
+        EXPECT_NE(response, nullptr);
+        if (!response) break;
+
+        if (!response->SharedImages.Name.empty())
+        {
+            EXPECT_TRUE(SharedImageRing::read(response->SharedImages, response->Images));
+        }
+        EXPECT_EQ(response->Images, images);
+        received += imagesSize;
+    }
+
+    server.join();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(received) / (1024 * 1024) / elapsed.count();
+}
+
+}
+
+// Not a strict benchmark, but it reports the throughput of the images from the worker with and without the shared memory
+TEST(IpcBenchmark, ImagesThroughput)
+{
+#if defined(WIN32)
+    GTEST_SKIP() << "it uses a socket pair for the pipe";
+#else
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    mega::gfx::Socket serverEnd(fds[0], "benchmark_server");
+    mega::gfx::Socket clientEnd(fds[1], "benchmark_client");
+
+    std::ostringstream name;
+    name << "megagfx_bench_" << mega::getCurrentPid();
+    auto ring = SharedImageRing::create(name.str());
+    ASSERT_NE(ring, nullptr);
+
+    double inlineMBs = measure(serverEnd, clientEnd, nullptr);
+    double sharedMBs = measure(serverEnd, clientEnd, ring.get());
+
+    std::cout << "[ IpcBenchmark ] images inline: " << static_cast<long long>(inlineMBs) << " MB/s, "
+              << "in shared memory: " << static_cast<long long>(sharedMBs) << " MB/s" << std::endl;
+
+    ASSERT_GT(inlineMBs, 0);
+    ASSERT_GT(sharedMBs, 0);
+#endif
+}